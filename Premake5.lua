@@ -62,6 +62,15 @@ workspace "OTTER"
 		"Release"
 	}
 
+	-- ENTT hands out component type IDs from counters, these make them safe to use from more than one thread (NOU
+	-- scenes can be loaded in the background)
+	defines { "ENTT_USE_ATOMIC" }
+
+	-- Compiles LOG_INFO and LOG_TRACE out of release builds, this needs to be the same for everything that includes spdlog
+	filter "configurations:Release"
+		defines { "SPDLOG_ACTIVE_LEVEL=SPDLOG_LEVEL_WARN" }
+	filter {}
+
 -- The directory name for our output
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
@@ -92,6 +101,7 @@ ProjIncludes = {
 	"dependencies/tinyGLTF",
 	"dependencies/json",
 	"dependencies/bullet3/include",
+	"dependencies/bullet3/include/bullet",
 }
 
 -- These are all the default dependencies that require linking
@@ -131,11 +141,11 @@ DependenciesRelease = {
 ProjLinks = { }
 for k, v in pairs(Dependencies) do ProjLinks[k] = v end
 
-ProjDebugLinks = { }
-for k, v in pairs(DependenciesDebug) do ProjDebugLinks[k] = v end
+ProjLinksDebug = { }
+for k, v in pairs(DependenciesDebug) do ProjLinksDebug[k] = v end
 
-ProjReleaseLinks = { }
-for k, v in pairs(DependenciesRelease) do ProjDebugLinks[k] = v end
+ProjLinksRelease = { }
+for k, v in pairs(DependenciesRelease) do ProjLinksRelease[k] = v end
 
 -- This function handles creating the default project for a module, if no premake folder is given
 -- @param folderName The path to the module, as collected from os.matchdirs
@@ -375,6 +385,9 @@ function AddProjects(groupName, folders)
 					"WINDOWS"
 				}
 
+				-- Winsock, for the remote profiler
+				links { "Ws2_32" }
+
 			-- Filters for our debug configurations
 			filter "configurations:Debug"
 				runtime "Debug"
@@ -399,4 +412,79 @@ for k, proj in pairs(sampleGroups) do
 	local name = path.getbasename(proj);
     local samples = os.matchdirs(proj .. "/*")
     AddProjects("Samples - " .. name, samples)
-end
\ No newline at end of file
+end
+-- The micro-benchmarks build the game's source (minus it's main) against a mocked out OpenGL, so engine code can be
+-- timed without a window. They borrow the first project's resources for the models they load
+if #projects > 0 then
+	local gameRelpath = path.getrelative(rootDir, projects[1])
+	local gameSrcdir = path.join(gameRelpath, "src")
+
+	premake.info("Building Group: Benchmarks")
+	group("Benchmarks")
+	premake.info(" Adding project: benchmarks")
+	premake.info("  Source: benchmarks (and " .. gameSrcdir .. ")")
+
+	filter {}
+	project("benchmarks")
+		location("benchmarks")
+		kind "ConsoleApp"
+		language "C++"
+		cppdialect "C++17"
+		staticruntime "on"
+
+		targetdir ("%{wks.location}\\bin\\" .. outputdir .. "\\%{prj.name}")
+		objdir ("%{wks.location}\\obj\\" .. outputdir .. "\\%{prj.name}")
+		debugdir ("%{wks.location}bin\\%{outputdir}\\%{prj.name}")
+
+		absdir = "%{wks.location}bin\\%{outputdir}\\%{prj.name}"
+		resdir = "%{wks.location}" .. gameRelpath .. "\\res"
+
+		postbuildcommands {
+			"(xcopy /Q /E /Y /I /C \"%{wks.location}shared_assets\\dll\" \"%{absdir}\")",
+			"(xcopy /Q /E /Y /I /C \"%{wks.location}dependencies\\dll\" \"%{absdir}\")",
+			"(xcopy /Q /E /Y /I /C \"%{wks.location}shared_assets\\res\" \"%{absdir}\")",
+			"(xcopy /Q /E /Y /I /C \"%{resdir}\" \"%{absdir}\")"
+		}
+
+		files {
+			"%{prj.location}\\src\\**.h",
+			"%{prj.location}\\src\\**.cpp",
+			path.join(gameSrcdir, "**.h"),
+			path.join(gameSrcdir, "**.cpp"),
+			path.join(gameSrcdir, "**.c"),
+			path.join(gameSrcdir, "**.hpp")
+		}
+		-- The benchmarks have their own main
+		removefiles { path.join(gameSrcdir, "main.cpp") }
+
+		defines {
+			"_CRT_SECURE_NO_WARNINGS"
+		}
+
+		ProjIncludes[1] = gameSrcdir
+		includedirs(ProjIncludes)
+		includedirs { "benchmarks/src" }
+
+		links(ProjLinks)
+
+		buildoptions { "/bigobj" }
+
+		filter "system:windows"
+			systemversion "latest"
+			defines {
+				"GLFW_INCLUDE_NONE",
+				"WINDOWS"
+			}
+			links { "Ws2_32" }
+
+		filter "configurations:Debug"
+			runtime "Debug"
+			symbols "on"
+			links(ProjLinksDebug)
+
+		filter "configurations:Release"
+			runtime "Release"
+			optimize "on"
+			links(ProjLinksRelease)
+	filter {}
+end
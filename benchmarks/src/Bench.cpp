@@ -0,0 +1,141 @@
+#include "Bench.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <json.hpp>
+
+#include "Logging.h"
+
+namespace bench
+{
+	// The most iterations a benchmark gets, so something the compiler folded away can't run forever
+	static const uint64_t MAX_ITERATIONS = 1000000000;
+
+	// Function local, so benchmarks in other files can register before main no matter what order they start up in
+	static std::vector<std::unique_ptr<Benchmark>>& GetBenchmarks() {
+		static std::vector<std::unique_ptr<Benchmark>> benchmarks;
+		return benchmarks;
+	}
+
+	// Shortens a rate to something readable, ex: 1234567 becomes 1.23M
+	static std::string FormatRate(double perSecond) {
+		static const char* suffixes[] = { "", "k", "M", "G", "T" };
+		int ix = 0;
+		while (perSecond >= 1000.0 && ix < 4) {
+			perSecond /= 1000.0;
+			ix++;
+		}
+		return fmt::format("{:.2f}{}/s", perSecond, suffixes[ix]);
+	}
+
+	void State::PauseTiming() {
+		if (!_isPaused) {
+			_seconds += std::chrono::duration<double>(Clock::now() - _start).count();
+			_isPaused = true;
+		}
+	}
+
+	void State::ResumeTiming() {
+		if (_isPaused) {
+			_start = Clock::now();
+			_isPaused = false;
+		}
+	}
+
+	void State::_Start() {
+		_seconds = 0.0;
+		_isPaused = false;
+		_start = Clock::now();
+	}
+
+	void State::_Stop() {
+		PauseTiming();
+	}
+
+	Benchmark* Register(const char* name, Function function) {
+		GetBenchmarks().push_back(std::make_unique<Benchmark>(name, function));
+		return GetBenchmarks().back().get();
+	}
+
+	int RunAll(int argc, char** argv) {
+		using nlohmann::json;
+
+		std::string filter;
+		std::string jsonPath;
+		double minTime = 0.5;
+		for (int ix = 1; ix < argc; ix++) {
+			const std::string arg = argv[ix];
+			if (arg == "--filter" && ix + 1 < argc) {
+				filter = argv[++ix];
+			} else if (arg == "--min-time" && ix + 1 < argc) {
+				minTime = std::max(std::atof(argv[++ix]), 0.001);
+			} else if (arg == "--json" && ix + 1 < argc) {
+				jsonPath = argv[++ix];
+			}
+		}
+
+		int result = 0;
+		json results = json::array();
+		fmt::print("{:<44} {:>14} {:>12} {:>14} {:>14}\n", "Benchmark", "Time", "Iterations", "Items", "Bytes");
+		fmt::print("{}\n", std::string(102, '-'));
+		for (const std::unique_ptr<Benchmark>& benchmark : GetBenchmarks()) {
+			if (!filter.empty() && benchmark->GetName().find(filter) == std::string::npos) {
+				continue;
+			}
+			std::vector<int64_t> args = benchmark->GetArgs();
+			if (args.empty()) {
+				args.push_back(0);
+			}
+			for (int64_t arg : args) {
+				const std::string name = benchmark->GetArgs().empty() ? benchmark->GetName() : fmt::format("{}/{}", benchmark->GetName(), arg);
+
+				// Same as Google Benchmark, we keep growing the iterations until a run takes long enough to trust.
+				// Once we're close we jump straight to about what we need, with a bit extra so we don't fall short
+				uint64_t iterations = 1;
+				std::unique_ptr<State> state;
+				for (;;) {
+					state = std::make_unique<State>(iterations, arg);
+					benchmark->GetFunction()(*state);
+					if (!state->GetError().empty() || state->GetSeconds() >= minTime || iterations >= MAX_ITERATIONS) {
+						break;
+					}
+					const double seconds = std::max(state->GetSeconds(), 1e-9);
+					const double multiplier = seconds / minTime > 0.1 ? minTime * 1.4 / seconds : 10.0;
+					iterations = std::min(std::max(static_cast<uint64_t>(iterations * multiplier), iterations + 1), MAX_ITERATIONS);
+				}
+
+				if (!state->GetError().empty()) {
+					fmt::print("{:<44} ERROR: {}\n", name, state->GetError());
+					results.push_back({ { "name", name }, { "error", state->GetError() } });
+					result = 1;
+					continue;
+				}
+				const double seconds = state->GetSeconds();
+				const double perIteration = seconds * 1e9 / iterations;
+				const double items = state->GetItems() / seconds;
+				const double bytes = state->GetBytes() / seconds;
+				fmt::print("{:<44} {:>11.1f} ns {:>12} {:>14} {:>14} {}\n", name, perIteration, iterations,
+					state->GetItems() > 0 ? FormatRate(items) : "", state->GetBytes() > 0 ? FormatRate(bytes) : "", state->GetLabel());
+				results.push_back({
+					{ "name", name },
+					{ "label", state->GetLabel() },
+					{ "iterations", iterations },
+					{ "ns_per_iteration", perIteration },
+					{ "items_per_second", items },
+					{ "bytes_per_second", bytes }
+				});
+			}
+		}
+
+		if (!jsonPath.empty()) {
+			std::ofstream file(jsonPath);
+			if (!file.is_open()) {
+				LOG_ERROR("Failed to open {} for writing the benchmark results", jsonPath);
+				return 1;
+			}
+			file << json({ { "benchmarks", results } }).dump(1, '\t');
+		}
+		return result;
+	}
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// A small micro-benchmark harness in the style of Google Benchmark. Benchmarks are plain functions that loop over
+/// their state, and get registered with BENCHMARK:
+///
+///     static void Transform_Compose(bench::State& state) {
+///         for (auto _ : state) {
+///             ...
+///         }
+///         state.SetItemsProcessed(state.GetIterations() * count);
+///     }
+///     BENCHMARK(Transform_Compose)->Arg(1000);
+///
+/// Each benchmark is run with more and more iterations until it takes at least the minimum time, and the last run
+/// is what gets reported, along with how many items and bytes a second it got through
+/// </summary>
+namespace bench
+{
+	/// <summary>
+	/// Stops the compiler from throwing away a value that's only computed for the benchmark
+	/// </summary>
+	template <typename T>
+	inline void DoNotOptimize(const T& value) {
+		static volatile const void* sink;
+		sink = &value;
+	}
+
+	/// <summary>
+	/// What a benchmark function is handed, it times the loop and collects the counters
+	/// </summary>
+	class State final {
+	public:
+		// Lets benchmarks loop with for (auto _ : state), the clock runs from the first step until the loop ends
+		struct Value { };
+		class Iterator final {
+		public:
+			Iterator(State* state, uint64_t remaining) : _state(state), _remaining(remaining) { }
+			Value operator*() const { return Value(); }
+			Iterator& operator++() { _remaining--; return *this; }
+			bool operator!=(const Iterator&) {
+				if (_remaining != 0) {
+					return true;
+				}
+				_state->_Stop();
+				return false;
+			}
+		private:
+			State*   _state;
+			uint64_t _remaining;
+		};
+
+		State(uint64_t iterations, int64_t arg) : _iterations(iterations), _arg(arg) { }
+
+		Iterator begin() { _Start(); return Iterator(this, _iterations); }
+		Iterator end() { return Iterator(this, 0); }
+
+		/// <summary>
+		/// Gets the argument this run was registered with (see Benchmark::Arg), or 0 if there wasn't one
+		/// </summary>
+		int64_t GetArg() const { return _arg; }
+		uint64_t GetIterations() const { return _iterations; }
+
+		/// <summary>
+		/// Sets how many items (ex: vertices, lookups) the whole run got through, for the items per second
+		/// </summary>
+		void SetItemsProcessed(int64_t items) { _items = items; }
+		/// <summary>
+		/// Sets how many bytes the whole run got through, for the bytes per second
+		/// </summary>
+		void SetBytesProcessed(int64_t bytes) { _bytes = bytes; }
+		/// <summary>
+		/// Sets some text to show next to the result (ex: which file was loaded)
+		/// </summary>
+		void SetLabel(const std::string& label) { _label = label; }
+		/// <summary>
+		/// Marks the benchmark as unable to run (ex: a file is missing), it's reported as an error instead of a time
+		/// </summary>
+		void SkipWithError(const std::string& error) { _error = error; _iterations = 0; }
+
+		/// <summary>
+		/// Stops the clock while the loop does setup that shouldn't count towards the time
+		/// </summary>
+		void PauseTiming();
+		void ResumeTiming();
+
+		double GetSeconds() const { return _seconds; }
+		int64_t GetItems() const { return _items; }
+		int64_t GetBytes() const { return _bytes; }
+		const std::string& GetLabel() const { return _label; }
+		const std::string& GetError() const { return _error; }
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		uint64_t          _iterations;
+		int64_t           _arg;
+		int64_t           _items = 0;
+		int64_t           _bytes = 0;
+		std::string       _label;
+		std::string       _error;
+		Clock::time_point _start;
+		double            _seconds = 0.0;
+		bool              _isPaused = false;
+
+		void _Start();
+		void _Stop();
+	};
+
+	typedef void(*Function)(State& state);
+
+	/// <summary>
+	/// A registered benchmark, the setters return the benchmark so they can be chained
+	/// </summary>
+	class Benchmark final {
+	public:
+		Benchmark(const char* name, Function function) : _name(name), _function(function) { }
+
+		/// <summary>
+		/// Adds a run with the given argument, a benchmark with no arguments gets a single run with 0
+		/// </summary>
+		Benchmark* Arg(int64_t arg) { _args.push_back(arg); return this; }
+		/// <summary>
+		/// Adds a run for every argument from first to last (inclusive)
+		/// </summary>
+		Benchmark* DenseRange(int64_t first, int64_t last) {
+			for (int64_t arg = first; arg <= last; arg++) {
+				_args.push_back(arg);
+			}
+			return this;
+		}
+
+		const std::string& GetName() const { return _name; }
+		Function GetFunction() const { return _function; }
+		const std::vector<int64_t>& GetArgs() const { return _args; }
+
+	private:
+		std::string          _name;
+		Function             _function;
+		std::vector<int64_t> _args;
+	};
+
+	/// <summary>
+	/// Adds a benchmark to the list that RunAll goes through, used by BENCHMARK
+	/// </summary>
+	Benchmark* Register(const char* name, Function function);
+
+	/// <summary>
+	/// Runs every registered benchmark and prints a table of the results. Takes --filter [text] to only run the
+	/// benchmarks with the text in their names, --min-time [seconds] to set how long each one runs for, and
+	/// --json [file] to write the results out for comparing between builds
+	/// </summary>
+	/// <returns>0 if every benchmark ran, 1 if any were skipped with an error</returns>
+	int RunAll(int argc, char** argv);
+}
+
+#define BENCH_CONCAT_INNER(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_INNER(a, b)
+#define BENCHMARK(function) static bench::Benchmark* BENCH_CONCAT(_benchmark, __LINE__) = bench::Register(#function, &function)
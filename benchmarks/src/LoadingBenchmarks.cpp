@@ -0,0 +1,52 @@
+#include "Bench.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Utilities/MeshBuilder.h"
+#include "Utilities/MeshFactory.h"
+#include "Utilities/ObjLoader.h"
+
+// The models that ship with the game, copied next to the executable with the rest of res
+static const std::vector<std::string> MODELS = {
+	"models/Dunce.obj", "models/Duncet.obj", "models/Slide.obj", "models/Swing.obj", "models/Table.obj",
+	"models/Balloon.obj", "models/TreeSmall.obj", "models/TreeBig.obj", "models/RoundAbout.obj", "models/monkey.obj"
+};
+
+static void ObjLoader_LoadFromFile(bench::State& state) {
+	const std::string& path = MODELS[static_cast<size_t>(state.GetArg())];
+	std::error_code error;
+	const uintmax_t fileSize = std::filesystem::file_size(path, error);
+	if (error) {
+		state.SkipWithError("Could not find " + path);
+		return;
+	}
+	// Parse it once up front so we know how many vertices each load gets through
+	MeshBuilder<VertexPosNormTexCol> mesh;
+	ObjLoader::ParseFile(path, mesh);
+
+	for (auto _ : state) {
+		VertexArrayObject::sptr vao = ObjLoader::LoadFromFile(path);
+		bench::DoNotOptimize(vao);
+	}
+	state.SetLabel(path);
+	state.SetItemsProcessed(static_cast<int64_t>(state.GetIterations() * mesh.GetVertexCount()));
+	state.SetBytesProcessed(static_cast<int64_t>(state.GetIterations() * fileSize));
+}
+BENCHMARK(ObjLoader_LoadFromFile)->DenseRange(0, static_cast<int64_t>(MODELS.size()) - 1);
+
+static void MeshFactory_AddIcoSphere(bench::State& state) {
+	const int tessellation = static_cast<int>(state.GetArg());
+	MeshBuilder<VertexPosNormTexCol> mesh;
+	size_t vertices = 0;
+	for (auto _ : state) {
+		mesh.Clear();
+		MeshFactory::AddIcoSphere(mesh, glm::vec3(0.0f), 1.0f, tessellation);
+		vertices = mesh.GetVertexCount();
+		bench::DoNotOptimize(mesh);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.GetIterations() * vertices));
+	state.SetBytesProcessed(static_cast<int64_t>(state.GetIterations() * vertices * sizeof(VertexPosNormTexCol)));
+}
+BENCHMARK(MeshFactory_AddIcoSphere)->DenseRange(0, 5);
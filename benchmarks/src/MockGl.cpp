@@ -0,0 +1,229 @@
+#include "MockGl.h"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+	std::atomic<uint64_t> Calls(0);
+	std::atomic<GLuint>   NextName(1);
+	std::atomic<GLint>    NextLocation(0);
+
+	// The memory behind each buffer, so mapping one hands back somewhere real to write to
+	std::mutex                                         BufferLock;
+	std::unordered_map<GLuint, std::vector<uint8_t>>   Buffers;
+
+	void* MapBuffer(GLuint buffer, GLintptr offset, GLsizeiptr length) {
+		std::lock_guard<std::mutex> lock(BufferLock);
+		std::vector<uint8_t>& storage = Buffers[buffer];
+		if (storage.size() < static_cast<size_t>(offset + length)) {
+			storage.resize(static_cast<size_t>(offset + length));
+		}
+		return storage.data() + offset;
+	}
+
+	uint64_t APIENTRY Ignore() {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	const GLubyte* APIENTRY GetString(GLenum name) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		switch (name) {
+		case GL_VERSION:                  return reinterpret_cast<const GLubyte*>("4.6.0 Mock");
+		case GL_SHADING_LANGUAGE_VERSION: return reinterpret_cast<const GLubyte*>("4.60 Mock");
+		default:                          return reinterpret_cast<const GLubyte*>("Mock");
+		}
+	}
+	// glad won't load without at least one extension, so we claim the ones the engine leans on
+	const char* EXTENSIONS[] = { "GL_ARB_direct_state_access", "GL_ARB_bindless_texture" };
+	const GLint EXTENSION_COUNT = sizeof(EXTENSIONS) / sizeof(EXTENSIONS[0]);
+
+	const GLubyte* APIENTRY GetStringi(GLenum, GLuint index) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return reinterpret_cast<const GLubyte*>(index < static_cast<GLuint>(EXTENSION_COUNT) ? EXTENSIONS[index] : "");
+	}
+
+	// Limits are the smallest the spec allows at 4.6, everything else reads as 0
+	void APIENTRY GetIntegerv(GLenum name, GLint* data) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		switch (name) {
+		case GL_MAJOR_VERSION:                     *data = 4; break;
+		case GL_MINOR_VERSION:                     *data = 6; break;
+		case GL_NUM_EXTENSIONS:                    *data = EXTENSION_COUNT; break;
+		case GL_MAX_TEXTURE_IMAGE_UNITS:           *data = 16; break;
+		case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS:  *data = 80; break;
+		case GL_MAX_TEXTURE_SIZE:                  *data = 16384; break;
+		case GL_MAX_UNIFORM_BLOCK_SIZE:            *data = 16384; break;
+		case GL_MAX_SHADER_STORAGE_BLOCK_SIZE:     *data = 1 << 27; break;
+		case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:   *data = 256; break;
+		case GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT: *data = 256; break;
+		default:                                   *data = 0; break;
+		}
+	}
+	void APIENTRY GetInteger64v(GLenum, GLint64* data) { Calls.fetch_add(1, std::memory_order_relaxed); *data = 0; }
+	void APIENTRY GetFloatv(GLenum, GLfloat* data) { Calls.fetch_add(1, std::memory_order_relaxed); *data = 0.0f; }
+	void APIENTRY GetBooleanv(GLenum, GLboolean* data) { Calls.fetch_add(1, std::memory_order_relaxed); *data = GL_FALSE; }
+
+	// Every compile and link succeeds straight away, with nothing in the logs
+	void APIENTRY GetShaderiv(GLuint, GLenum name, GLint* params) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		*params = name == GL_COMPILE_STATUS || name == GL_COMPLETION_STATUS_KHR ? GL_TRUE : 0;
+	}
+	void APIENTRY GetProgramiv(GLuint, GLenum name, GLint* params) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		*params = name == GL_LINK_STATUS || name == GL_VALIDATE_STATUS || name == GL_COMPLETION_STATUS_KHR ? GL_TRUE : 0;
+	}
+	// Programs have no resources to reflect, so materials fall back to plain uniforms
+	void APIENTRY GetProgramInterfaceiv(GLuint, GLenum, GLenum, GLint* params) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		*params = 0;
+	}
+	void APIENTRY GetProgramResourceiv(GLuint, GLenum, GLuint, GLsizei, const GLenum*, GLsizei count, GLsizei* length, GLint* params) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		for (GLsizei ix = 0; ix < count; ix++) {
+			params[ix] = 0;
+		}
+		if (length != nullptr) {
+			*length = 0;
+		}
+	}
+	GLuint APIENTRY GetProgramResourceIndex(GLuint, GLenum, const GLchar*) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return GL_INVALID_INDEX;
+	}
+	// Every uniform exists, and gets it's own location
+	GLint APIENTRY GetUniformLocation(GLuint, const GLchar*) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return NextLocation.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	GLuint APIENTRY CreateName() {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return NextName.fetch_add(1, std::memory_order_relaxed);
+	}
+	GLuint APIENTRY CreateShader(GLenum) {
+		return CreateName();
+	}
+	void APIENTRY CreateNames(GLsizei count, GLuint* names) {
+		for (GLsizei ix = 0; ix < count; ix++) {
+			names[ix] = CreateName();
+		}
+	}
+	// glCreateTextures and glCreateQueries take a target first
+	void APIENTRY CreateTargetNames(GLenum, GLsizei count, GLuint* names) {
+		CreateNames(count, names);
+	}
+	GLuint64 APIENTRY GetTextureHandle(GLuint) {
+		return CreateName();
+	}
+	GLuint64 APIENTRY GetTextureSamplerHandle(GLuint, GLuint) {
+		return CreateName();
+	}
+	GLboolean APIENTRY IsName(GLuint name) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return name != 0 ? GL_TRUE : GL_FALSE;
+	}
+
+	void APIENTRY NamedBufferStorage(GLuint buffer, GLsizeiptr size, const void* data, GLbitfield) {
+		void* storage = MapBuffer(buffer, 0, size);
+		if (data != nullptr) {
+			std::memcpy(storage, data, static_cast<size_t>(size));
+		}
+	}
+	void APIENTRY NamedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum) {
+		NamedBufferStorage(buffer, size, data, 0);
+	}
+	void* APIENTRY MapNamedBufferRange(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return MapBuffer(buffer, offset, length);
+	}
+	void* APIENTRY MapNamedBuffer(GLuint buffer, GLenum) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return MapBuffer(buffer, 0, 0);
+	}
+	GLboolean APIENTRY UnmapNamedBuffer(GLuint) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return GL_TRUE;
+	}
+
+	GLsync APIENTRY FenceSync(GLenum, GLbitfield) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return reinterpret_cast<GLsync>(static_cast<uintptr_t>(CreateName()));
+	}
+	GLenum APIENTRY ClientWaitSync(GLsync, GLbitfield, GLuint64) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return GL_ALREADY_SIGNALED;
+	}
+	GLenum APIENTRY CheckFramebufferStatus(GLenum) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return GL_FRAMEBUFFER_COMPLETE;
+	}
+	GLenum APIENTRY CheckNamedFramebufferStatus(GLuint, GLenum) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		return GL_FRAMEBUFFER_COMPLETE;
+	}
+
+	void* GetProc(const char* name) {
+		static const std::unordered_map<std::string, void*> overrides = {
+			{ "glGetString",                  reinterpret_cast<void*>(&GetString) },
+			{ "glGetStringi",                 reinterpret_cast<void*>(&GetStringi) },
+			{ "glGetIntegerv",                reinterpret_cast<void*>(&GetIntegerv) },
+			{ "glGetInteger64v",              reinterpret_cast<void*>(&GetInteger64v) },
+			{ "glGetFloatv",                  reinterpret_cast<void*>(&GetFloatv) },
+			{ "glGetBooleanv",                reinterpret_cast<void*>(&GetBooleanv) },
+			{ "glGetShaderiv",                reinterpret_cast<void*>(&GetShaderiv) },
+			{ "glGetProgramiv",               reinterpret_cast<void*>(&GetProgramiv) },
+			{ "glGetProgramInterfaceiv",      reinterpret_cast<void*>(&GetProgramInterfaceiv) },
+			{ "glGetProgramResourceiv",       reinterpret_cast<void*>(&GetProgramResourceiv) },
+			{ "glGetProgramResourceIndex",    reinterpret_cast<void*>(&GetProgramResourceIndex) },
+			{ "glGetUniformLocation",         reinterpret_cast<void*>(&GetUniformLocation) },
+			{ "glCreateProgram",              reinterpret_cast<void*>(&CreateName) },
+			{ "glCreateShader",               reinterpret_cast<void*>(&CreateShader) },
+			{ "glCreateBuffers",              reinterpret_cast<void*>(&CreateNames) },
+			{ "glCreateSamplers",             reinterpret_cast<void*>(&CreateNames) },
+			{ "glCreateVertexArrays",         reinterpret_cast<void*>(&CreateNames) },
+			{ "glCreateFramebuffers",         reinterpret_cast<void*>(&CreateNames) },
+			{ "glCreateRenderbuffers",        reinterpret_cast<void*>(&CreateNames) },
+			{ "glCreateTextures",             reinterpret_cast<void*>(&CreateTargetNames) },
+			{ "glCreateQueries",              reinterpret_cast<void*>(&CreateTargetNames) },
+			{ "glGenBuffers",                 reinterpret_cast<void*>(&CreateNames) },
+			{ "glGenTextures",                reinterpret_cast<void*>(&CreateNames) },
+			{ "glGenVertexArrays",            reinterpret_cast<void*>(&CreateNames) },
+			{ "glGenFramebuffers",            reinterpret_cast<void*>(&CreateNames) },
+			{ "glGenQueries",                 reinterpret_cast<void*>(&CreateNames) },
+			{ "glGenSamplers",                reinterpret_cast<void*>(&CreateNames) },
+			{ "glGetTextureHandleARB",        reinterpret_cast<void*>(&GetTextureHandle) },
+			{ "glGetTextureSamplerHandleARB", reinterpret_cast<void*>(&GetTextureSamplerHandle) },
+			{ "glIsTexture",                  reinterpret_cast<void*>(&IsName) },
+			{ "glIsBuffer",                   reinterpret_cast<void*>(&IsName) },
+			{ "glIsProgram",                  reinterpret_cast<void*>(&IsName) },
+			{ "glNamedBufferStorage",         reinterpret_cast<void*>(&NamedBufferStorage) },
+			{ "glNamedBufferData",            reinterpret_cast<void*>(&NamedBufferData) },
+			{ "glMapNamedBufferRange",        reinterpret_cast<void*>(&MapNamedBufferRange) },
+			{ "glMapNamedBuffer",             reinterpret_cast<void*>(&MapNamedBuffer) },
+			{ "glUnmapNamedBuffer",           reinterpret_cast<void*>(&UnmapNamedBuffer) },
+			{ "glFenceSync",                  reinterpret_cast<void*>(&FenceSync) },
+			{ "glClientWaitSync",             reinterpret_cast<void*>(&ClientWaitSync) },
+			{ "glCheckFramebufferStatus",     reinterpret_cast<void*>(&CheckFramebufferStatus) },
+			{ "glCheckNamedFramebufferStatus", reinterpret_cast<void*>(&CheckNamedFramebufferStatus) }
+		};
+		auto it = overrides.find(name);
+		return it != overrides.end() ? it->second : reinterpret_cast<void*>(&Ignore);
+	}
+}
+
+bool MockGl::Init() {
+	return gladLoadGLLoader(&GetProc) != 0;
+}
+
+uint64_t MockGl::GetCallCount() {
+	return Calls.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// Stands in for the OpenGL driver, so code that issues GL calls can be timed without a window or a context, and
+/// without the driver's own cost muddying the numbers. Init loads glad with our own entry points instead of the
+/// driver's
+///
+/// Anything that hands back a handle, a status or a mapping gets a believable answer (new names, successful
+/// compiles and links, real memory to write into). Everything else goes to a function that ignores it's arguments
+/// and returns 0. That's only safe because the caller cleans up the stack on x64, which is all we build for
+/// </summary>
+class MockGl final
+{
+public:
+	/// <summary>
+	/// Points every GL function at the mock, returns false if glad rejected it
+	/// </summary>
+	static bool Init();
+	/// <summary>
+	/// Gets the number of GL calls made so far, so benchmarks can report how many calls a path makes
+	/// </summary>
+	static uint64_t GetCallCount();
+};
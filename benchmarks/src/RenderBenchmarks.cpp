@@ -0,0 +1,71 @@
+#include "Bench.h"
+
+#include "Logging.h"
+
+#include "Gameplay/ShaderMaterial.h"
+#include "Graphics/Shader.h"
+#include "Graphics/Texture2D.h"
+#include "MockGl.h"
+
+static const char* VERTEX_SOURCE = R"LIT(
+#version 460
+layout(location = 0) in vec3 inPosition;
+void main() { gl_Position = vec4(inPosition, 1.0); }
+)LIT";
+
+static const char* FRAGMENT_SOURCE = R"LIT(
+#version 460
+uniform sampler2D s_Diffuse;
+uniform sampler2D s_Specular;
+uniform float u_Shininess;
+uniform float u_TextureMix;
+uniform vec3 u_Tint;
+out vec4 outColor;
+void main() { outColor = vec4(u_Tint * u_Shininess * u_TextureMix, 1.0) + texture(s_Diffuse, vec2(0.0)) + texture(s_Specular, vec2(0.0)); }
+)LIT";
+
+static ShaderMaterial::sptr CreateMaterial(const Shader::sptr& shader, float shininess) {
+	Texture2DDescription desc;
+	desc.Width = 4;
+	desc.Height = 4;
+	desc.Format = InternalFormat::RGBA8;
+
+	ShaderMaterial::sptr material = ShaderMaterial::Create();
+	material->Shader = shader;
+	material->Set("s_Diffuse", Texture2D::Create(desc));
+	material->Set("s_Specular", Texture2D::Create(desc));
+	material->Set("u_Shininess", shininess);
+	material->Set("u_TextureMix", 0.5f);
+	material->Set("u_Tint", glm::vec3(1.0f, 0.5f, 0.25f));
+	return material;
+}
+
+// With 0 the same material is applied every time, so only what changed gets sent. With 1 two materials take turns,
+// which is the worst case of a draw list that's sorted badly
+static void ShaderMaterial_Apply(bench::State& state) {
+	// Nothing gets compiled, so there's nothing worth caching
+	Shader::BinaryCacheDirectory = "";
+	Shader::sptr shader = Shader::Create();
+	shader->LoadShaderPart(VERTEX_SOURCE, GL_VERTEX_SHADER);
+	shader->LoadShaderPart(FRAGMENT_SOURCE, GL_FRAGMENT_SHADER);
+	if (!shader->Link()) {
+		state.SkipWithError("Failed to link the shader");
+		return;
+	}
+	ShaderMaterial::sptr materials[2] = { CreateMaterial(shader, 4.0f), CreateMaterial(shader, 8.0f) };
+	const bool isAlternating = state.GetArg() != 0;
+
+	const uint64_t calls = MockGl::GetCallCount();
+	uint64_t ix = 0;
+	for (auto _ : state) {
+		shader->Bind();
+		materials[isAlternating ? ix & 1 : 0]->Apply();
+		ix++;
+	}
+	const uint64_t callsPerApply = state.GetIterations() > 0 ? (MockGl::GetCallCount() - calls) / state.GetIterations() : 0;
+	state.SetLabel(fmt::format("{}, {} GL calls each", isAlternating ? "alternating" : "same material", callsPerApply));
+	state.SetItemsProcessed(static_cast<int64_t>(state.GetIterations()));
+	// Each apply sends the three values and two textures
+	state.SetBytesProcessed(static_cast<int64_t>(state.GetIterations() * (sizeof(float) * 2 + sizeof(glm::vec3) + sizeof(GLuint) * 2)));
+}
+BENCHMARK(ShaderMaterial_Apply)->Arg(0)->Arg(1);
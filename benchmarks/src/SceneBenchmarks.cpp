@@ -0,0 +1,114 @@
+#include "Bench.h"
+
+#include <string>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Behaviours/FollowPathBehaviour.h"
+#include "Gameplay/IBehaviour.h"
+#include "Gameplay/Scene.h"
+#include "Gameplay/Transform.h"
+
+// How many transforms each of the scene benchmarks works through per iteration
+static const uint32_t TRANSFORM_COUNT = 10000;
+
+static void Transform_Compose(bench::State& state) {
+	GameScene scene("Compose");
+	std::vector<entt::handle> entities;
+	entities.reserve(TRANSFORM_COUNT);
+	for (uint32_t ix = 0; ix < TRANSFORM_COUNT; ix++) {
+		entities.push_back(scene.CreateEntity());
+	}
+
+	float time = 0.0f;
+	for (auto _ : state) {
+		time += 0.01f;
+		for (entt::handle& entity : entities) {
+			Transform& transform = entity.get<Transform>();
+			transform.SetLocalPosition(time, 1.0f, 2.0f);
+			transform.SetLocalRotation(time * 10.0f, 20.0f, 30.0f);
+			transform.SetLocalScale(1.0f, time, 1.0f);
+			bench::DoNotOptimize(transform.LocalTransform());
+		}
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.GetIterations() * TRANSFORM_COUNT));
+	state.SetBytesProcessed(static_cast<int64_t>(state.GetIterations() * TRANSFORM_COUNT * sizeof(glm::mat4)));
+}
+BENCHMARK(Transform_Compose);
+
+// The argument is how deep each chain of transforms is, 1 being a flat scene
+static void Transform_UpdateWorldMatrices(bench::State& state) {
+	const uint32_t depth = static_cast<uint32_t>(state.GetArg());
+	GameScene scene("Hierarchy");
+	std::vector<entt::handle> roots;
+	entt::entity parent = entt::null;
+	for (uint32_t ix = 0; ix < TRANSFORM_COUNT; ix++) {
+		entt::handle entity = scene.CreateEntity();
+		entity.get<Transform>().SetLocalPosition(0.0f, 1.0f, 0.0f);
+		if (ix % depth == 0) {
+			roots.push_back(entity);
+		} else {
+			entity.get<Transform>().SetParent(entt::handle(scene.Registry(), parent));
+		}
+		parent = entity.entity();
+	}
+	Transform::UpdateWorldMatrices(scene.Registry());
+
+	// Moving the roots dirties everything hanging off of them, so every transform gets updated each time
+	float time = 0.0f;
+	for (auto _ : state) {
+		time += 0.01f;
+		for (entt::handle& root : roots) {
+			root.get<Transform>().SetLocalPosition(time, 0.0f, 0.0f);
+		}
+		Transform::UpdateWorldMatrices(scene.Registry());
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.GetIterations() * TRANSFORM_COUNT));
+	state.SetBytesProcessed(static_cast<int64_t>(state.GetIterations() * TRANSFORM_COUNT * sizeof(glm::mat4)));
+}
+BENCHMARK(Transform_UpdateWorldMatrices)->Arg(1)->Arg(4)->Arg(16);
+
+static void BehaviourBinding_Get(bench::State& state) {
+	GameScene scene("Behaviours");
+	std::vector<entt::handle> entities;
+	entities.reserve(TRANSFORM_COUNT);
+	for (uint32_t ix = 0; ix < TRANSFORM_COUNT; ix++) {
+		entt::handle entity = scene.CreateEntity();
+		BehaviourBinding::Bind<FollowPathBehaviour>(entity);
+		entities.push_back(entity);
+	}
+
+	for (auto _ : state) {
+		for (entt::handle& entity : entities) {
+			bench::DoNotOptimize(BehaviourBinding::Get<FollowPathBehaviour>(entity));
+		}
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.GetIterations() * TRANSFORM_COUNT));
+	state.SetBytesProcessed(static_cast<int64_t>(state.GetIterations() * TRANSFORM_COUNT * sizeof(BehaviourBinding)));
+}
+BENCHMARK(BehaviourBinding_Get);
+
+// The argument is how many named entities are in the scene
+static void GameScene_FindFirst(bench::State& state) {
+	const uint32_t count = static_cast<uint32_t>(state.GetArg());
+	GameScene scene("Names");
+	std::vector<std::string> names;
+	names.reserve(count);
+	for (uint32_t ix = 0; ix < count; ix++) {
+		names.push_back("Entity" + std::to_string(ix));
+		scene.CreateEntity(names.back());
+	}
+
+	// Look up every name in turn, so it's not just the first one being found over and over
+	size_t bytes = 0;
+	size_t ix = 0;
+	for (auto _ : state) {
+		const std::string& name = names[ix];
+		bench::DoNotOptimize(scene.FindFirst(name));
+		bytes += name.size();
+		ix = ix + 1 < names.size() ? ix + 1 : 0;
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.GetIterations()));
+	state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(GameScene_FindFirst)->Arg(100)->Arg(10000);
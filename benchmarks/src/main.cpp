@@ -0,0 +1,20 @@
+#include "Bench.h"
+#include "Logging.h"
+#include "MockGl.h"
+#include "Utilities/ThreadPool.h"
+
+int main(int argc, char** argv) {
+	Logger::Init();
+	if (!MockGl::Init()) {
+		LOG_ERROR("Failed to load the mock GL functions");
+		Logger::Uninitialize();
+		return 2;
+	}
+	ThreadPool::Instance().Init();
+
+	const int result = bench::RunAll(argc, argv);
+
+	ThreadPool::Instance().Shutdown();
+	Logger::Uninitialize();
+	return result;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "fmod_studio.hpp"
+
+/// <summary>
+/// Owns the FMOD Studio system, and runs it's update on a thread of it's own at a fixed rate so that audio keeps
+/// going no matter how long a frame takes. Everything here is meant to be called from the main thread, FMOD's API
+/// is thread safe so calls go straight through, apart from the 3D attributes which are handed over once per frame
+/// and applied in a single batch right before the next update
+///
+/// Banks are loaded without blocking, so events can't be found until their banks (and the strings bank) have
+/// finished loading. Anything asking for an event should be ready to try again on a later frame
+/// </summary>
+class AudioEngine final
+{
+public:
+	typedef std::shared_ptr<AudioEngine> sptr;
+	static inline sptr Create() {
+		return std::make_shared<AudioEngine>();
+	}
+
+	/// <summary>
+	/// Where something is in the world, and where it's facing, in the same right handed space as the scene
+	/// </summary>
+	struct Attributes3D {
+		glm::vec3 Position = glm::vec3(0.0f);
+		glm::vec3 Velocity = glm::vec3(0.0f);
+		glm::vec3 Forward  = glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 Up       = glm::vec3(0.0f, 0.0f, 1.0f);
+	};
+
+	/// <summary>
+	/// The 3D attributes for a single playing event, as submitted with a frame
+	/// </summary>
+	struct Emitter {
+		FMOD::Studio::EventInstance* Instance;
+		Attributes3D                 Attributes;
+	};
+
+	AudioEngine();
+	~AudioEngine();
+
+	AudioEngine(const AudioEngine& other) = delete;
+	AudioEngine& operator=(const AudioEngine& other) = delete;
+
+	/// <summary>
+	/// Creates the FMOD Studio system and starts the update thread
+	/// </summary>
+	/// <param name="maxChannels">The most sounds that can play at once</param>
+	/// <param name="updateRate">How many times a second the system gets updated</param>
+	/// <returns>True if FMOD started, if not the engine stays silent but can still be used</returns>
+	bool Init(int maxChannels = 512, float updateRate = 60.0f);
+	/// <summary>
+	/// Stops the update thread, and releases every instance and bank along with the system
+	/// </summary>
+	void Shutdown();
+
+	/// <summary>
+	/// Starts loading a bank in the background, loading the same bank twice does nothing
+	/// </summary>
+	/// <param name="path">The path of the .bank file</param>
+	void LoadBank(const std::string& path);
+	/// <summary>
+	/// Gets the number of banks that haven't finished loading yet
+	/// </summary>
+	uint32_t GetLoadingBankCount() const;
+
+	/// <summary>
+	/// Loads an event's sample data as soon as it's bank is in, rather than the first time it plays, so events that
+	/// play often (or need to start on time) never wait on the disk. The data stays loaded until shutdown
+	/// </summary>
+	/// <param name="eventPath">The event's path (ex: "event:/Ambience/Wind")</param>
+	void PreloadSampleData(const std::string& eventPath);
+
+	/// <summary>
+	/// Gets the range an event is heard over, as set up in FMOD Studio
+	/// </summary>
+	/// <param name="eventPath">The event's path (ex: "event:/Ambience/Wind")</param>
+	/// <param name="minDistance">Will store the distance the event starts to fade out at</param>
+	/// <param name="maxDistance">Will store the distance the event can't be heard past</param>
+	/// <returns>True if the event was found, false if it's bank hasn't loaded (yet)</returns>
+	bool GetEventDistances(const std::string& eventPath, float& minDistance, float& maxDistance) const;
+
+	/// <summary>
+	/// Creates an instance of an event, which needs to be released with ReleaseInstance once it's not needed
+	/// </summary>
+	/// <param name="eventPath">The event's path (ex: "event:/Ambience/Wind")</param>
+	/// <returns>The instance, or nullptr if the event can't be found (yet)</returns>
+	FMOD::Studio::EventInstance* CreateInstance(const std::string& eventPath);
+	/// <summary>
+	/// Stops an instance (letting it fade out) and releases it once it's done
+	/// </summary>
+	void ReleaseInstance(FMOD::Studio::EventInstance* instance);
+
+	/// <summary>
+	/// Hands over this frame's listener and emitter attributes, which get applied all at once on the update thread.
+	/// If the thread hasn't picked up the last frame yet, it just gets replaced
+	/// </summary>
+	/// <param name="listeners">The attributes for each listener, up to FMOD_MAX_LISTENERS</param>
+	/// <param name="emitters">The attributes for each playing 3D event</param>
+	void SubmitFrame(const std::vector<Attributes3D>& listeners, const std::vector<Emitter>& emitters);
+
+	/// <summary>
+	/// Gets the FMOD Studio system, or nullptr if it didn't start
+	/// </summary>
+	FMOD::Studio::System* GetSystem() const { return _system; }
+	/// <summary>
+	/// Gets the native handle of the update thread, so it can be given a core of it's own
+	/// </summary>
+	std::thread::native_handle_type GetUpdateThread() { return _thread.native_handle(); }
+
+	/// <summary>
+	/// Converts our attributes into FMOD's
+	/// </summary>
+	static FMOD_3D_ATTRIBUTES ToFmod(const Attributes3D& attributes);
+
+protected:
+	// What the main thread hands over each frame
+	struct Frame {
+		std::vector<Attributes3D> Listeners;
+		std::vector<Emitter>      Emitters;
+	};
+
+	FMOD::Studio::System*                                _system;
+	std::unordered_map<std::string, FMOD::Studio::Bank*> _banks;
+
+	std::thread                                          _thread;
+	std::atomic<bool>                                    _isRunning;
+	std::mutex                                           _mutex;
+	std::condition_variable                              _wake;
+	float                                                _updateRate;
+	// Guarded by _mutex, the frame waiting to be applied and the events waiting to be preloaded
+	Frame                                                _pending;
+	bool                                                 _hasPending;
+	std::vector<std::string>                             _preloads;
+
+	// Runs on the update thread until shutdown
+	void _Run();
+	// Tries to start loading the sample data for any preloads whose banks are in, leaving the rest in the list
+	void _StartPreloads(std::vector<std::string>& preloads);
+};
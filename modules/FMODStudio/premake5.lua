@@ -0,0 +1,47 @@
+project "FMODStudio"
+    kind "StaticLib"
+    language "C++"
+    cppdialect "C++17"
+    -- Sets RuntimLibrary to MultiThreaded (non DLL version for static linking)
+    staticruntime "on"
+
+    targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+    objdir ("obj/" .. outputdir .. "/%{prj.name}")
+
+    files
+    {
+        "src\\**.cpp",
+        "include\\**.h",
+        "include\\**.hpp"
+    }
+
+    -- The studio API sits on top of the core API, so we need both
+    links {
+        "toolkit",
+        "%{prj.location}\\libs\\fmodstudio_vc.lib",
+        "%{wks.location}\\dependencies\\fmod\\fmod64.lib"
+    }
+
+    -- We log through the toolkit, so unlike a generated module we need it's headers as well
+    includedirs {
+        "%{prj.location}\\include",
+        "%{wks.location}\\modules\\toolkit\\include",
+        "%{wks.location}\\dependencies\\fmod",
+        "%{wks.location}\\dependencies\\spdlog\\include",
+        "%{wks.location}\\dependencies\\GLM\\include"
+    }
+
+    filter "system:windows"
+        systemversion "latest"
+
+        defines {
+            "WINDOWS"
+        }
+
+    filter "configurations:Debug"
+        runtime "Debug"
+        symbols "on"
+
+    filter "configurations:Release"
+        runtime "Release"
+        optimize "on"
@@ -0,0 +1,228 @@
+#include "AudioEngine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fmod_errors.h>
+
+#include "Logging.h"
+
+static inline FMOD_VECTOR ToFmod(const glm::vec3& value) {
+	return FMOD_VECTOR{ value.x, value.y, value.z };
+}
+
+AudioEngine::AudioEngine() :
+	_system(nullptr),
+	_isRunning(false),
+	_updateRate(60.0f),
+	_hasPending(false)
+{ }
+
+AudioEngine::~AudioEngine() {
+	Shutdown();
+}
+
+bool AudioEngine::Init(int maxChannels, float updateRate) {
+	LOG_ASSERT(_system == nullptr, "Audio engine has already been initialized!");
+	FMOD_RESULT result = FMOD::Studio::System::create(&_system);
+	if (result != FMOD_OK) {
+		LOG_WARN("Failed to create the FMOD Studio system: {}", FMOD_ErrorString(result));
+		_system = nullptr;
+		return false;
+	}
+	// We run the update on our own thread, so Studio doesn't need one of it's own as well. The scene is right
+	// handed, and so is everything we hand over
+	result = _system->initialize(maxChannels, FMOD_STUDIO_INIT_SYNCHRONOUS_UPDATE, FMOD_INIT_3D_RIGHTHANDED, nullptr);
+	if (result != FMOD_OK) {
+		LOG_WARN("Failed to initialize FMOD Studio: {}", FMOD_ErrorString(result));
+		_system->release();
+		_system = nullptr;
+		return false;
+	}
+
+	_updateRate = std::max(updateRate, 1.0f);
+	_isRunning = true;
+	_thread = std::thread(&AudioEngine::_Run, this);
+	LOG_INFO("FMOD Studio started with {} channels, updating {} times a second", maxChannels, _updateRate);
+	return true;
+}
+
+void AudioEngine::Shutdown() {
+	if (_system == nullptr) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_isRunning = false;
+	}
+	_wake.notify_all();
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+	// Releasing the system takes every bank, event and instance with it
+	_system->release();
+	_system = nullptr;
+	_banks.clear();
+	_pending = Frame();
+	_hasPending = false;
+	_preloads.clear();
+}
+
+void AudioEngine::LoadBank(const std::string& path) {
+	if (_system == nullptr || _banks.find(path) != _banks.end()) {
+		return;
+	}
+	FMOD::Studio::Bank* bank = nullptr;
+	FMOD_RESULT result = _system->loadBankFile(path.c_str(), FMOD_STUDIO_LOAD_BANK_NONBLOCKING, &bank);
+	if (result != FMOD_OK) {
+		LOG_WARN("Failed to start loading bank \"{}\": {}", path, FMOD_ErrorString(result));
+		return;
+	}
+	_banks[path] = bank;
+}
+
+uint32_t AudioEngine::GetLoadingBankCount() const {
+	uint32_t result = 0;
+	for (const auto& [path, bank] : _banks) {
+		FMOD_STUDIO_LOADING_STATE state;
+		if (bank->getLoadingState(&state) == FMOD_OK && state == FMOD_STUDIO_LOADING_STATE_LOADING) {
+			result++;
+		}
+	}
+	return result;
+}
+
+void AudioEngine::PreloadSampleData(const std::string& eventPath) {
+	if (_system == nullptr) {
+		return;
+	}
+	// The bank it's in probably hasn't loaded yet, so the update thread keeps trying until it has
+	std::lock_guard<std::mutex> lock(_mutex);
+	_preloads.push_back(eventPath);
+}
+
+bool AudioEngine::GetEventDistances(const std::string& eventPath, float& minDistance, float& maxDistance) const {
+	if (_system == nullptr) {
+		return false;
+	}
+	FMOD::Studio::EventDescription* description = nullptr;
+	if (_system->getEvent(eventPath.c_str(), &description) != FMOD_OK) {
+		return false;
+	}
+	return description->getMinimumDistance(&minDistance) == FMOD_OK && description->getMaximumDistance(&maxDistance) == FMOD_OK;
+}
+
+FMOD::Studio::EventInstance* AudioEngine::CreateInstance(const std::string& eventPath) {
+	if (_system == nullptr) {
+		return nullptr;
+	}
+	FMOD::Studio::EventDescription* description = nullptr;
+	if (_system->getEvent(eventPath.c_str(), &description) != FMOD_OK) {
+		return nullptr;
+	}
+	FMOD::Studio::EventInstance* instance = nullptr;
+	FMOD_RESULT result = description->createInstance(&instance);
+	if (result != FMOD_OK) {
+		LOG_WARN("Failed to create an instance of \"{}\": {}", eventPath, FMOD_ErrorString(result));
+		return nullptr;
+	}
+	return instance;
+}
+
+void AudioEngine::ReleaseInstance(FMOD::Studio::EventInstance* instance) {
+	if (_system == nullptr || instance == nullptr) {
+		return;
+	}
+	// FMOD hangs onto released instances until they've finished fading out
+	instance->stop(FMOD_STUDIO_STOP_ALLOWFADEOUT);
+	instance->release();
+}
+
+void AudioEngine::SubmitFrame(const std::vector<Attributes3D>& listeners, const std::vector<Emitter>& emitters) {
+	if (_system == nullptr) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	// Assigning keeps the vectors' memory from the frame that was handed back to us last time
+	_pending.Listeners.assign(listeners.begin(), listeners.begin() + std::min(listeners.size(), (size_t)FMOD_MAX_LISTENERS));
+	_pending.Emitters.assign(emitters.begin(), emitters.end());
+	_hasPending = true;
+}
+
+FMOD_3D_ATTRIBUTES AudioEngine::ToFmod(const Attributes3D& attributes) {
+	FMOD_3D_ATTRIBUTES result;
+	result.position = ::ToFmod(attributes.Position);
+	result.velocity = ::ToFmod(attributes.Velocity);
+	result.forward  = ::ToFmod(attributes.Forward);
+	result.up       = ::ToFmod(attributes.Up);
+	return result;
+}
+
+void AudioEngine::_Run() {
+	typedef std::chrono::steady_clock Clock;
+	const Clock::duration interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(1.0f / _updateRate));
+	Clock::time_point next = Clock::now();
+	Frame applying;
+	std::vector<std::string> preloads;
+
+	while (_isRunning) {
+		bool hasFrame = false;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_hasPending) {
+				std::swap(applying, _pending);
+				_hasPending = false;
+				hasFrame = true;
+			}
+			preloads.insert(preloads.end(), _preloads.begin(), _preloads.end());
+			_preloads.clear();
+		}
+
+		// The whole frame goes in at once, so the listener and the emitters never disagree about where things are
+		if (hasFrame) {
+			if (!applying.Listeners.empty()) {
+				_system->setNumListeners(static_cast<int>(applying.Listeners.size()));
+			}
+			for (size_t ix = 0; ix < applying.Listeners.size(); ix++) {
+				const FMOD_3D_ATTRIBUTES attributes = ToFmod(applying.Listeners[ix]);
+				_system->setListenerAttributes(static_cast<int>(ix), &attributes);
+			}
+			// Instances that were released since the frame was submitted just fail, FMOD checks it's handles
+			for (const Emitter& emitter : applying.Emitters) {
+				const FMOD_3D_ATTRIBUTES attributes = ToFmod(emitter.Attributes);
+				emitter.Instance->set3DAttributes(&attributes);
+			}
+		}
+		if (!preloads.empty()) {
+			_StartPreloads(preloads);
+		}
+
+		FMOD_RESULT result = _system->update();
+		if (result != FMOD_OK) {
+			LOG_WARN("FMOD Studio update failed: {}", FMOD_ErrorString(result));
+		}
+
+		// Sleep until the next tick, if we've fallen behind we skip ahead rather than trying to catch up
+		next += interval;
+		const Clock::time_point now = Clock::now();
+		if (next < now) {
+			next = now;
+		}
+		std::unique_lock<std::mutex> lock(_mutex);
+		_wake.wait_until(lock, next, [this]() { return !_isRunning; });
+	}
+}
+
+void AudioEngine::_StartPreloads(std::vector<std::string>& preloads) {
+	// Events that can't be found yet are still in banks that are loading, they'll get another go next update
+	preloads.erase(std::remove_if(preloads.begin(), preloads.end(), [this](const std::string& path) {
+		FMOD::Studio::EventDescription* description = nullptr;
+		if (_system->getEvent(path.c_str(), &description) != FMOD_OK) {
+			return false;
+		}
+		FMOD_RESULT result = description->loadSampleData();
+		if (result != FMOD_OK) {
+			LOG_WARN("Failed to preload the samples for \"{}\": {}", path, FMOD_ErrorString(result));
+		}
+		return true;
+	}), preloads.end());
+}
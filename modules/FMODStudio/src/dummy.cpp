@@ -1,2 +0,0 @@
-#pragma once
-#include "fmod_studio.hpp"
\ No newline at end of file
@@ -15,7 +15,7 @@ Shader::~Shader() {
 	if (_handle != 0) {
 		glDeleteProgram(_handle);
 		_handle = 0;
-		LOG_INFO("Deleting shader program");
+		LOG_TRACE("Deleting shader program");
 	}
 }
 
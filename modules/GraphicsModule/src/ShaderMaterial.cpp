@@ -20,7 +20,7 @@ ShaderMaterial::ShaderMaterial()
 }
 
 ShaderMaterial::~ShaderMaterial() {
-	LOG_INFO("Deleting material");
+	LOG_TRACE("Deleting material");
 }
 
 void ShaderMaterial::Apply()
@@ -0,0 +1,161 @@
+/*
+NOU Framework - Created for INFR 2310 at Ontario Tech.
+(c) Samantha Stahlke 2020
+
+Animation.h
+Keyframed animation clips (e.g., loaded from glTF), sampling them over
+time, and blending several clips together into one pose.
+*/
+
+#pragma once
+
+#include "GLM/glm.hpp"
+#include "GLM/gtc/quaternion.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nou
+{
+	//The keyframes for one property (translation, rotation or scale) of one node.
+	//The times and values are kept in separate arrays, so stepping through the
+	//times only touches the times.
+	struct AnimChannel
+	{
+		std::vector<float> times;
+
+		//Translations and scales use x, y and z.
+		//Rotations are quaternions, stored as x, y, z, w (the same as glTF).
+		std::vector<glm::vec4> values;
+
+		//Whether to jump straight from one key to the next instead of
+		//interpolating between them.
+		bool step = false;
+
+		bool IsEmpty() const { return times.empty(); }
+	};
+
+	//Every channel that animates a single node.
+	//Channels without any keys leave that property of the node alone.
+	struct NodeTrack
+	{
+		int node = -1;
+
+		AnimChannel translation;
+		AnimChannel rotation;
+		AnimChannel scale;
+	};
+
+	struct AnimationClip
+	{
+		std::string name;
+
+		//The time of the last key, in seconds.
+		float duration = 0.0f;
+
+		std::vector<NodeTrack> tracks;
+	};
+
+	//The local position, rotation and scale of a set of nodes (e.g., a skeleton).
+	//Each component is stored in its own array, so blending can work on several
+	//nodes at once with SIMD instructions.
+	struct Pose
+	{
+		std::vector<float> posX, posY, posZ;
+		std::vector<float> rotX, rotY, rotZ, rotW;
+		std::vector<float> scaleX, scaleY, scaleZ;
+
+		void Resize(size_t count);
+		size_t Size() const { return posX.size(); }
+
+		void Set(size_t index, const glm::vec3& pos, const glm::quat& rot, const glm::vec3& scale);
+
+		glm::vec3 GetPos(size_t index) const;
+		glm::quat GetRotation(size_t index) const;
+		glm::vec3 GetScale(size_t index) const;
+	};
+
+	//Remembers which key each channel of a clip was on the last time it was sampled.
+	//Playing a clip forward only moves a key or two each frame, so stepping ahead
+	//from here is much cheaper than searching for the right key every time.
+	//Use one cursor per clip per character.
+	class AnimationCursor
+	{
+		public:
+
+		//Sends every channel back to its first key.
+		void Reset();
+
+		protected:
+
+		friend void SampleClip(const AnimationClip&, float, AnimationCursor&, Pose&);
+
+		//Three keys per track (translation, rotation and scale).
+		std::vector<uint32_t> m_keys;
+		const AnimationClip* m_clip = nullptr;
+	};
+
+	//Samples a clip at the time given, writing the result into pose.
+	//Nodes (and properties) the clip doesn't animate keep whatever pose already has,
+	//so start from a base pose (e.g., from GLTF::GetPose).
+	void SampleClip(const AnimationClip& clip, float time, AnimationCursor& cursor, Pose& pose);
+
+	//Blends several poses together by the weights given, which should add up to 1.
+	//Positions and scales are blended linearly, and rotations with a normalized
+	//lerp (nlerp), which is close enough to slerp for blending animations and
+	//a lot cheaper. Every pose must have the same number of nodes.
+	void BlendPoses(const Pose* const* poses, const float* weights, size_t count, Pose& out);
+
+	//Plays one or more clips on a single character, blending them together.
+	class Animator
+	{
+		public:
+
+		//The base pose is used for anything the clips don't animate.
+		Animator(const Pose& basePose);
+		~Animator() = default;
+
+		//Adds a clip to be blended in. Returns its index, for the functions below.
+		//The clip must outlive the animator.
+		size_t AddClip(const AnimationClip& clip, float weight = 1.0f, bool loop = true);
+
+		void SetWeight(size_t index, float weight);
+		void SetSpeed(size_t index, float speed);
+		void SetTime(size_t index, float time);
+		float GetTime(size_t index) const { return m_layers[index].time; }
+
+		//Moves every clip forward and rebuilds the pose.
+		//Clips with a weight of 0 don't get sampled.
+		void Update(float deltaTime);
+
+		const Pose& GetPose() const { return m_pose; }
+
+		//Updates a lot of animators at once, split up across several threads.
+		//Each animator only touches its own data, so they can update in any order.
+		//Passing 0 threads uses one per CPU core.
+		static void UpdateAll(const std::vector<Animator*>& animators, float deltaTime,
+							  unsigned threads = 0);
+
+		protected:
+
+		struct Layer
+		{
+			const AnimationClip* clip;
+			float time;
+			float weight;
+			float speed;
+			bool loop;
+			AnimationCursor cursor;
+			Pose pose;
+		};
+
+		Pose m_base;
+		Pose m_pose;
+		std::vector<Layer> m_layers;
+
+		//Kept around so we don't allocate them every update.
+		std::vector<const Pose*> m_blendPoses;
+		std::vector<float> m_blendWeights;
+	};
+}
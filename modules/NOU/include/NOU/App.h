@@ -20,6 +20,7 @@ Minimal utility class for GLFW window management.
 #include "GLFW/glfw3.h"
 #include "GLM/glm.hpp"
 
+#include <cstdint>
 #include <string>
 
 namespace nou
@@ -44,6 +45,22 @@ namespace nou
 		static float GetDeltaTime();
 		static bool IsClosing();
 
+		//Seconds since GLFW started, as a double.
+		//(Floats run out of precision after the app has been open for a while.)
+		static double GetTime();
+
+		//Turns vsync on or off. Adaptive vsync waits for the screen if we're on time,
+		//but swaps right away if we're late instead of waiting a whole extra refresh
+		//(if the driver doesn't support it, we get regular vsync).
+		static void SetVSync(bool vsync, bool adaptive = false);
+
+		//Caps the frame rate (0 for no cap). FrameStart waits until the next frame
+		//is due before polling input - it sleeps for most of the wait, then spins
+		//for the last spinTime seconds, since sleeping isn't very precise.
+		//inputLead lets us out that many seconds early, so setting it to about how
+		//long a frame's work takes means input is sampled as late as possible.
+		static void SetFrameLimit(float fps, double inputLead = 0.0, double spinTime = 0.002);
+
 		static void SetClearColor(const glm::vec4& clearColor);
 
 		protected:
@@ -53,8 +70,19 @@ namespace nou
 		App() = default;
 
 		static GLFWwindow* m_window;
-		static float m_prevTime;
+		//We keep time as GLFW's integer timer ticks, and only turn differences
+		//into seconds, so nothing drifts no matter how long we run.
+		static uint64_t m_prevTicks;
 		static float m_deltaTime;
 		static bool m_imguiInit;
+
+		//The frame limiter's settings, in timer ticks, and when the next frame is due.
+		static uint64_t m_frameTicks;
+		static uint64_t m_leadTicks;
+		static uint64_t m_spinTicks;
+		static uint64_t m_nextFrame;
+
+		//Waits until the next frame is due (see SetFrameLimit).
+		static void WaitForFrame();
 	};
 }
\ No newline at end of file
@@ -13,6 +13,10 @@ that we intend the class for use as a component with the ENTT framework.
 
 #include "Entity.h"
 
+#include "glad/glad.h"
+
+#include <cstdint>
+
 namespace nou
 {
 	class CCamera
@@ -24,11 +28,18 @@ namespace nou
 		//(e.g., for UI, portals, security cameras, etc.)
 		static Entity* current;
 
+		//The uniform block binding that our shaders read the current
+		//camera from. (See the "Camera" block in our vertex shaders.)
+		static const GLuint UBO_BINDING = 0;
+
 		CCamera(Entity& owner);
 		virtual ~CCamera();
 
 		void Update();
 
+		//The entity this camera belongs to.
+		Entity* GetOwner() const { return m_owner; }
+
 		//Returns the viewprojection matrix for rendering.
 		//VP = projection * view.
 		const glm::mat4& GetVP();
@@ -42,11 +53,26 @@ namespace nou
 		//Sets up a 3D perspective projection using GLM.
 		void Perspective(float fovYDegrees, float aspect, float near, float far);
 
+		//Makes sure the camera uniform block holds the current camera's
+		//matrices and is bound for our shaders.
+		//This only sends data to the GPU if the current camera has been
+		//updated (or switched) since the last time, so it's cheap to call
+		//before every draw.
+		static void BindCurrent();
+
 		protected:
 
 		Entity* m_owner;
 		glm::mat4 m_view;
 		glm::mat4 m_projection;
 		glm::mat4 m_viewProjection;
+
+		//Changes every time the camera is updated, so we can tell if
+		//the uniform block is out of date. Unique across all cameras.
+		uint32_t m_version;
+
+		static uint32_t m_nextVersion;
+		static uint32_t m_uploadedVersion;
+		static GLuint m_ubo;
 	};
 }
\ No newline at end of file
@@ -47,10 +47,17 @@ namespace nou
 		void SetMaterial(Material& mat);
 		virtual void Draw();
 
+		//These are used by RenderQueue to sort and batch renderers.
+		Entity* GetOwner() const { return m_owner; }
+		Material* GetMaterial() const { return m_mat; }
+		const Mesh* GetMesh() const { return m_mesh; }
+		VertexArray& GetVAO() const { return *m_vao; }
+
 		protected:
 
 		Entity* m_owner;
 		Material* m_mat;
+		const Mesh* m_mesh;
 		std::unique_ptr<VertexArray> m_vao;
 
 		//Having a default constructor makes it easier for us to inherit from
@@ -14,6 +14,8 @@ Minimal and lightly OOP wrapper for the ENTT framework.
 
 namespace nou
 {
+	class Scene;
+
 	class Entity
 	{
 		public:
@@ -28,10 +30,17 @@ namespace nou
 		//in a hierarchy with transforms storing pointers to parent/child objects.
 		Transform transform;
 
+		//These create the entity in the active scene (see Scene::Active).
 		static Entity Create();
 		static std::unique_ptr<Entity> Allocate();
 
+		//These create the entity in the scene given.
+		//The entity must be destroyed before the scene is.
+		static Entity Create(Scene& scene);
+		static std::unique_ptr<Entity> Allocate(Scene& scene);
+
 		Entity(entt::entity id);
+		Entity(entt::registry& registry, entt::entity id);
 		Entity(Entity&&) = delete;
 
 		virtual ~Entity();
@@ -39,24 +48,29 @@ namespace nou
 		template<typename T, typename... Args>
 		T& Add(Args&&... args)
 		{
-			return ecs.emplace<T>(m_id, std::forward<Args>(args)...);
+			return m_registry->emplace<T>(m_id, std::forward<Args>(args)...);
 		}
 
 		template<typename T>
 		T& Get()
 		{
-			return ecs.get<T>(m_id);
+			return m_registry->get<T>(m_id);
 		}
 
 		template<typename T>
 		void Remove()
 		{
-			ecs.remove<T>(m_id);
+			m_registry->remove<T>(m_id);
 		}
 
+		//The registry (i.e., the scene) that this entity's components live in.
+		entt::registry& GetRegistry() const { return *m_registry; }
+
 		protected:
 
-		static entt::registry ecs;
+		//Each scene has its own registry, so entities need to remember
+		//which one they belong to.
+		entt::registry* m_registry;
 		entt::entity m_id;	
 	};
 }
\ No newline at end of file
@@ -9,9 +9,10 @@ You'll be learning a LOT more about this in your graphics class.
 
 #pragma once
 
+#include <array>
+#include <cstdio>
 #include <memory>
 #include <vector>
-#include <map>
 #include <string>
 
 #include "glad/glad.h"
@@ -34,12 +35,34 @@ namespace nou
 			m_elementLen = elementLen;
 			m_startIndex = 0;
 			m_len = 0;
+			m_capacity = 0;
 			m_dynamic = dynamic;
 
 			glGenBuffers(1, &m_id);
 			UpdateData(data);
 		}
 
+		//This uploads a raw block of bytes, without saying what is in it.
+		//This is useful when the data is already laid out the way OpenGL wants it
+		//(e.g., a bufferView from a glTF file), possibly with several attributes
+		//(or even indices) packed into the same buffer.
+		//Use an AttribLayout or IndexLayout to tell OpenGL where to find things.
+		VertexBuffer(const void* data, GLsizeiptr size, bool dynamic = false)
+		{
+			m_elementLen = 1;
+			m_elementSize = 1;
+			m_startIndex = 0;
+			m_len = (GLsizei)size;
+			m_capacity = size;
+			m_dynamic = dynamic;
+
+			GLenum usage = (m_dynamic) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+
+			glGenBuffers(1, &m_id);
+			glBindBuffer(GL_ARRAY_BUFFER, m_id);
+			glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+		}
+
 		~VertexBuffer()
 		{
 			glDeleteBuffers(1, &m_id);
@@ -80,16 +103,80 @@ namespace nou
 		GLuint GetID() const { return m_id; }
 
 		//This uploads the data specified into our OpenGL buffer on the GPU.
+		//If the data fits in the storage we already have, it is written in place
+		//with glBufferSubData - Asking OpenGL for new storage every time is slow
+		//for meshes we update every frame (e.g., animated meshes).
 		template<typename T>
 		void UpdateData(const std::vector<T>& data)
 		{
 			m_len = (GLsizei)data.size();
 			m_elementSize = sizeof(T);
 
+			GLsizeiptr size = (GLsizeiptr)m_len * m_elementSize;
+
+			glBindBuffer(GL_ARRAY_BUFFER, m_id);
+
+			if (size > 0 && size <= m_capacity)
+			{
+				glBufferSubData(GL_ARRAY_BUFFER, 0, size, data.data());
+				return;
+			}
+
+			GLenum usage = (m_dynamic) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+
+			glBufferData(GL_ARRAY_BUFFER, size, data.data(), usage);
+			m_capacity = size;
+		}
+
+		//This overwrites part of our buffer, starting offset bytes in.
+		//The buffer must already be big enough (see Resize).
+		void UpdateSubData(const void* data, GLsizeiptr offset, GLsizeiptr size)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_id);
+			glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+		}
+
+		//This makes room for len data points of elementSize bytes each, without
+		//uploading anything. Whatever was in the buffer before may be lost,
+		//so follow this up with Map or UpdateSubData.
+		void Resize(GLsizei elementSize, GLsizei len)
+		{
+			m_elementSize = elementSize;
+			m_len = len;
+
+			GLsizeiptr size = (GLsizeiptr)m_len * m_elementSize;
+
+			if (size <= m_capacity)
+				return;
+
 			GLenum usage = (m_dynamic) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
 
 			glBindBuffer(GL_ARRAY_BUFFER, m_id);
-			glBufferData(GL_ARRAY_BUFFER, m_len * m_elementSize, &(data[0]), usage);
+			glBufferData(GL_ARRAY_BUFFER, size, nullptr, usage);
+			m_capacity = size;
+		}
+
+		//This gives us a pointer we can write our data straight into, which saves
+		//building a copy of it on the CPU first (e.g., when interleaving vertices).
+		//The old contents are thrown away, so the whole buffer should be written.
+		//Returns nullptr if the buffer could not be mapped.
+		//Call Unmap when you're done, and before drawing with the buffer.
+		void* Map()
+		{
+			if (m_capacity == 0)
+				return nullptr;
+
+			glBindBuffer(GL_ARRAY_BUFFER, m_id);
+			return glMapBufferRange(GL_ARRAY_BUFFER, 0, m_capacity,
+									GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		}
+
+		//Returns false if the data written since Map was lost (which can happen
+		//if, e.g., the window is resized), in which case it needs to be written again.
+		bool Unmap()
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_id);
+			return glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
 		}
 
 		protected:
@@ -105,6 +192,10 @@ namespace nou
 		//The number of data points in our buffer.
 		GLsizei m_len;
 
+		//The size of the storage OpenGL has given us, in bytes.
+		//This can be more than we are using if our data has shrunk.
+		GLsizeiptr m_capacity;
+
 		//Any offset we should take to get to the "first" element in our buffer.
 		//(Usually this will be 0 unless you are doing something Fancy(TM).)
 		GLsizei m_startIndex;
@@ -113,6 +204,50 @@ namespace nou
 		bool m_dynamic;
 	};
 
+	//Describes where to find one attribute's data inside of a VertexBuffer.
+	//Several attributes can point into the same buffer with different offsets
+	//(e.g., interleaved positions, normals and UVs).
+	struct AttribLayout
+	{
+		const VertexBuffer* buffer = nullptr;
+
+		//The number of components in a single data point (e.g., Vector3 = 3 components).
+		GLint elementLen = 0;
+		//The type of each component (e.g., GL_FLOAT, GL_UNSIGNED_SHORT).
+		GLenum type = GL_FLOAT;
+		//Whether integer components should be mapped to the 0-1 (or -1-1) range.
+		GLboolean normalized = GL_FALSE;
+		//The number of bytes from the start of one data point to the next.
+		//0 means the data is tightly packed.
+		GLsizei stride = 0;
+		//The number of bytes from the start of the buffer to the first data point.
+		GLsizeiptr offset = 0;
+		//The number of data points (i.e., vertices).
+		//0 means "however many the buffer holds", which is what we want for
+		//buffers that only hold this one attribute.
+		GLsizei count = 0;
+
+		GLsizei Count() const
+		{
+			return (count > 0 || buffer == nullptr) ? count : buffer->Length();
+		}
+	};
+
+	//Describes where to find the indices for a mesh inside of a VertexBuffer.
+	//Indices tell OpenGL which vertices make up each triangle, so vertices shared
+	//between triangles only need to be stored once.
+	struct IndexLayout
+	{
+		const VertexBuffer* buffer = nullptr;
+
+		//GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+		GLenum type = GL_UNSIGNED_INT;
+		//The number of bytes from the start of the buffer to the first index.
+		GLsizeiptr offset = 0;
+		//The number of indices.
+		GLsizei count = 0;
+	};
+
 	//Class for managing OpenGL Vertex Array Objects (VAOs).
 	//Just as with VertexBuffer, as written, this class is intended to be used via pointers.
 	class VertexArray
@@ -129,6 +264,10 @@ namespace nou
 			TRIANGLE_STRIP = GL_TRIANGLE_STRIP
 		};
 
+		//The number of attribute locations we keep track of.
+		//OpenGL guarantees at least this many.
+		static const GLuint MAX_ATTRIBS = 16;
+
 		DrawMode m_drawMode;
 
 		VertexArray()
@@ -136,6 +275,7 @@ namespace nou
 			m_drawMode = DrawMode::TRIANGLES;
 			glGenVertexArrays(1, &m_id);
 			m_len = 0;
+			m_firstAttrib = -1;
 		}
 
 		~VertexArray()
@@ -153,9 +293,10 @@ namespace nou
 			m_len = other.m_len;
 			m_drawMode = other.m_drawMode;
 
-			for (auto& [attribLoc, buf] : other.m_vbos)
+			for (GLuint attribLoc = 0; attribLoc < MAX_ATTRIBS; ++attribLoc)
 			{
-				BindAttrib(*buf, attribLoc);
+				if (other.m_vbos[attribLoc].buffer != nullptr)
+					BindAttrib(other.m_vbos[attribLoc], attribLoc);
 			}
 
 			other.m_id = 0;
@@ -171,9 +312,10 @@ namespace nou
 			m_len = other.m_len;
 			m_drawMode = other.m_drawMode;
 
-			for (auto& [attribLoc, buf] : other.m_vbos)
+			for (GLuint attribLoc = 0; attribLoc < MAX_ATTRIBS; ++attribLoc)
 			{
-				BindAttrib(*buf, attribLoc);
+				if (other.m_vbos[attribLoc].buffer != nullptr)
+					BindAttrib(other.m_vbos[attribLoc], attribLoc);
 			}
 		}
 
@@ -183,15 +325,17 @@ namespace nou
 			if (this != &other)
 			{
 				glDeleteVertexArrays(1, &m_id);
-				m_vbos.clear();
+				m_vbos.fill(AttribLayout());
+				m_firstAttrib = -1;
 
 				m_id = other.m_id;
 				m_len = other.m_len;
 				m_drawMode = other.m_drawMode;
 
-				for (auto& [attribLoc, buf] : other.m_vbos)
+				for (GLuint attribLoc = 0; attribLoc < MAX_ATTRIBS; ++attribLoc)
 				{
-					BindAttrib(*buf, attribLoc);
+					if (other.m_vbos[attribLoc].buffer != nullptr)
+						BindAttrib(other.m_vbos[attribLoc], attribLoc);
 				}
 
 				other.m_id = 0;
@@ -206,15 +350,17 @@ namespace nou
 			if (this != &other)
 			{
 				glDeleteVertexArrays(1, &m_id);
-				m_vbos.clear();
+				m_vbos.fill(AttribLayout());
+				m_firstAttrib = -1;
 
 				glGenVertexArrays(1, &m_id);
 				m_len = other.m_len;
 				m_drawMode = other.m_drawMode;
 
-				for (auto& [attribLoc, buf] : other.m_vbos)
+				for (GLuint attribLoc = 0; attribLoc < MAX_ATTRIBS; ++attribLoc)
 				{
-					BindAttrib(*buf, attribLoc);
+					if (other.m_vbos[attribLoc].buffer != nullptr)
+						BindAttrib(other.m_vbos[attribLoc], attribLoc);
 				}
 			}
 
@@ -227,17 +373,51 @@ namespace nou
 		//buffer specified to be found in the location specified.
 		void BindAttrib(const VertexBuffer& buf, GLuint attribLoc)
 		{
-			m_vbos[attribLoc] = &buf;
+			AttribLayout layout;
+			layout.buffer = &buf;
+			layout.elementLen = buf.ElementLength();
+			layout.offset = (GLsizeiptr)buf.StartIndex() * (GLsizeiptr)buf.ElementSize();
+
+			BindAttrib(layout, attribLoc);
+		}
+
+		//As above, but with full control over where the data lives in the buffer
+		//and what format it is in.
+		void BindAttrib(const AttribLayout& layout, GLuint attribLoc)
+		{
+			if (attribLoc >= MAX_ATTRIBS)
+			{
+				printf("Attribute location %u is out of range.\n", attribLoc);
+				return;
+			}
 
-			m_len = buf.Length();
+			m_vbos[attribLoc] = layout;
+
+			//We count our vertices using the lowest location we have.
+			if (m_firstAttrib < 0 || (GLint)attribLoc < m_firstAttrib)
+				m_firstAttrib = (GLint)attribLoc;
+
+			m_len = m_vbos[m_firstAttrib].Count();
 
 			glBindVertexArray(m_id);
 			glEnableVertexAttribArray(attribLoc);
-			glBindBuffer(GL_ARRAY_BUFFER, buf.GetID());
-			glVertexAttribPointer(attribLoc, buf.ElementLength(), 
-								  GL_FLOAT, GL_FALSE, 0,
-								 reinterpret_cast<void*>((long long)buf.StartIndex() *
-														 (long long)buf.ElementSize()));
+			glBindBuffer(GL_ARRAY_BUFFER, layout.buffer->GetID());
+			glVertexAttribPointer(attribLoc, layout.elementLen, 
+								  layout.type, layout.normalized, layout.stride,
+								  reinterpret_cast<void*>(layout.offset));
+		}
+
+		//This associates an index buffer with our vertex array object.
+		//Once we have one, Draw will use it to look up our vertices.
+		//Pass in a layout with no buffer to go back to drawing without indices.
+		void BindIndices(const IndexLayout& layout)
+		{
+			m_indices = layout;
+
+			//The VAO remembers which index buffer is bound while it is bound.
+			glBindVertexArray(m_id);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 
+						 (layout.buffer != nullptr) ? layout.buffer->GetID() : 0);
 		}
 
 		void SetDrawMode(DrawMode drawMode)
@@ -245,14 +425,47 @@ namespace nou
 			m_drawMode = drawMode;
 		}
 
+		GLuint GetID() const { return m_id; }
+
 		void Draw()
 		{
-			m_len = m_vbos.begin()->second->Length();
-
 			glBindVertexArray(m_id);
+
+			if (m_indices.buffer != nullptr)
+			{
+				glDrawElements((int)m_drawMode, m_indices.count, m_indices.type,
+							   reinterpret_cast<void*>(m_indices.offset));
+				return;
+			}
+
+			if (m_firstAttrib < 0)
+				return;
+
+			m_len = m_vbos[m_firstAttrib].Count();
 			glDrawArrays((int)m_drawMode, 0, m_len);
 		}
 
+		//As with Draw, but draws several copies (instances) at once.
+		//The shader tells them apart with gl_InstanceID, or with attributes
+		//that have a divisor set (see RenderQueue).
+		void DrawInstanced(GLsizei instanceCount)
+		{
+			glBindVertexArray(m_id);
+
+			if (m_indices.buffer != nullptr)
+			{
+				glDrawElementsInstanced((int)m_drawMode, m_indices.count, m_indices.type,
+										reinterpret_cast<void*>(m_indices.offset), instanceCount);
+				return;
+			}
+
+			if (m_firstAttrib < 0)
+				return;
+
+			m_len = m_vbos[m_firstAttrib].Count();
+			glDrawArraysInstanced((int)m_drawMode, 0, m_len, instanceCount);
+		}
+
 		void DrawElements(const std::vector<GLuint>& indices, size_t count)
 		{
 			if (count == 0)
@@ -273,8 +486,15 @@ namespace nou
 		//The number of elements in our VAO (typically equals the number of vertices in a 3D model).
 		GLsizei m_len;
 
-		//A record of the VBOs associated with this VAO.
-		std::map<GLint, const VertexBuffer*> m_vbos;
+		//A record of the VBOs associated with this VAO, by attribute location.
+		//Locations we have not bound have no buffer.
+		std::array<AttribLayout, MAX_ATTRIBS> m_vbos;
+
+		//The lowest attribute location we have bound, or -1 if there are none.
+		GLint m_firstAttrib;
+
+		//The index buffer associated with this VAO, if we have one.
+		IndexLayout m_indices;
 	};
 }
 
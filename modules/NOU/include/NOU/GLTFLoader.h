@@ -9,15 +9,20 @@ Helpful reference: https://www.khronos.org/files/gltf20-reference-guide.pdf
 
 #pragma once
 
+#include "Animation.h"
 #include "Mesh.h"
+#include "Transform.h"
 
 #include <string>
+#include <vector>
+#include <memory>
 
 //Forward declaration of objects defined by the tinyGLTF library.
 namespace tinygltf
 {
 	class Model;
 	struct Primitive;
+	struct AnimationSampler;
 }
 
 namespace nou::GLTF
@@ -28,11 +33,103 @@ namespace nou::GLTF
 		size_t len;
 		int stride;
 		int elementSize;
+		//The type of each component (e.g., GL_FLOAT), how many components
+		//make up an element, and whether integer components are normalized.
+		int componentType;
+		int components;
+		bool normalized;
+	};
+
+	//A single node from a glTF scene.
+	//Each node's transform is parented to the node above it in the file.
+	struct Node
+	{
+		std::string name;
+		Transform transform;
+
+		//The mesh in Model::meshes that this node draws, or -1 if it doesn't draw anything.
+		int mesh = -1;
+
+		//The skin in Model::skins that deforms this node's mesh, or -1 if it isn't skinned.
+		int skin = -1;
+	};
+
+	//The joints (bones) that deform a skinned mesh.
+	//Each joint is a node in the file, and animating those nodes moves the mesh.
+	struct Skin
+	{
+		std::string name;
+
+		//The index in Model::nodes of each joint, in the order that
+		//a vertex's joint indices (JOINTS_0) refer to them.
+		std::vector<int> joints;
+
+		//Takes a vertex from the mesh's bind pose into each joint's local space.
+		std::vector<glm::mat4> inverseBinds;
+	};
+
+	//Everything we load from a glTF file.
+	struct Model
+	{
+		//Each glTF mesh is made up of one or more primitives (usually one per material).
+		//Every primitive becomes its own Mesh, since each one needs its own VAO.
+		std::vector<std::vector<std::unique_ptr<Mesh>>> meshes;
+
+		//Every node in the file.
+		//We store pointers, since transforms keep pointers to their parents and children.
+		std::vector<std::unique_ptr<Node>> nodes;
+
+		std::vector<Skin> skins;
+
+		//Each clip's tracks refer to nodes by their index in nodes.
+		std::vector<AnimationClip> animations;
+
+		//The nodes at the top of the hierarchy in the file's default scene.
+		//Calling DoFK on these will update every node in the scene.
+		std::vector<Node*> roots;
+
+		Model() = default;
+		Model(const Model&) = delete;
+
+		//Parents can get destroyed before their children, so we break up the hierarchy first.
+		~Model()
+		{
+			for (auto& node : nodes)
+				node->transform.SetParent(nullptr);
+		}
 	};
 
 	//Loads a 3D model into the mesh object given.
+	//If the file's first mesh has a single primitive, its data is uploaded directly
+	//(see LoadModel). Otherwise all of its primitives are merged into one indexed mesh.
 	void LoadMesh(const std::string& filename, Mesh& mesh, bool flipUVY = true);
+
+	//Loads every mesh, primitive and node in a glTF file.
+	//Vertex and index data is uploaded straight from the file's buffers
+	//(one VBO per bufferView) and keeps its indices, so nothing gets unpacked.
+	//The exception is UVs when flipUVY is set, since those need to be changed first.
+	bool LoadModel(const std::string& filename, Model& model, bool flipUVY = true);
 	
+	//Builds the matrix palette for a skinned node from the current pose of its
+	//skin's joints (call DoFK on the model's roots first), ready for
+	//SkinnedMesh::SetJointMatrices. The palette is relative to the node itself,
+	//so the skinned mesh can still be drawn with the node's transform.
+	//Returns false if the node isn't skinned.
+	bool GetJointMatrices(const Model& model, const Node& node, std::vector<glm::mat4>& palette);
+
+	//Fills in a pose with the current position, rotation and scale of every node,
+	//e.g., to use as the base pose for an Animator.
+	void GetPose(const Model& model, Pose& pose);
+
+	//Copies a pose (e.g., from Animator::GetPose) onto the model's nodes.
+	//Call DoFK on the model's roots afterwards to update them.
+	void ApplyPose(const Pose& pose, Model& model);
+
+	//Reads the keyframes of an animation sampler into a channel.
+	//components is 3 for translations and scales, and 4 for rotations.
+	bool ReadChannel(const tinygltf::Model& gltf, const tinygltf::AnimationSampler& sampler,
+					 int components, AnimChannel& channel);
+
 	void DumpErrorsAndWarnings(const std::string& filename,
 							   const std::string& err,
 							   const std::string& warn);
@@ -41,17 +138,34 @@ namespace nou::GLTF
 	bool ParseGLTF(const std::string& filename, tinygltf::Model& gltf,
 				   std::string& err, std::string& warn);
 
-	//Takes a glTF model and extracts vertex positions, normals, and texture coordinates.
+	//Takes a glTF model and extracts vertex positions, normals, texture coordinates
+	//and indices from every primitive of its first mesh, merged into one mesh.
 	bool ExtractGeometry(const tinygltf::Model& gltf, Mesh& mesh, bool flipUVY,
 					     std::string& err, std::string& warn);
 
-	bool ProcessPrimitive(const tinygltf::Model& gltf, size_t geomIndex, 
+	//Appends the vertices and indices of a primitive to the lists given.
+	//Indices are offset so they point past the vertices already in the lists.
+	bool ProcessPrimitive(const tinygltf::Model& gltf, const tinygltf::Primitive& geom,
 					      std::vector<glm::vec3>& verts, std::vector<glm::vec2>& uvs,
-						  std::vector<glm::vec3>& normals, bool flipUVY,
-						  bool& hasNormals, bool& hasUVs,
+						  std::vector<glm::vec3>& normals, std::vector<GLuint>& indices,
+						  bool flipUVY, bool& hasNormals, bool& hasUVs,
 						  std::string& err, std::string& warn);
 
+	//Sets up a mesh that draws a primitive straight out of the file's bufferViews.
+	//Each bufferView is uploaded the first time it is needed, and stored in views
+	//so that other primitives can share it.
+	bool BuildPrimitive(const tinygltf::Model& gltf, const tinygltf::Primitive& geom,
+						Mesh& mesh, std::vector<std::shared_ptr<VertexBuffer>>& views,
+						bool flipUVY, std::string& err, std::string& warn);
+
 	//Utility functions for more easily accessing data stored in glTF buffers.
 	int FindAccessor(const tinygltf::Primitive& geom, const std::string& name);
 	DataGetter BuildGetter(const tinygltf::Model& gltf, int accIndex);
+
+	//Reads one element from an accessor as floats, converting normalized integers.
+	//Returns false if the data is in a format we can't convert.
+	bool ReadFloats(const DataGetter& getter, size_t index, float* out, int count);
+
+	//Reads a single index from an accessor.
+	GLuint ReadIndex(const DataGetter& getter, size_t index);
 }
\ No newline at end of file
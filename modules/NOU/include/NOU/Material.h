@@ -35,6 +35,13 @@ namespace nou
 		//Should be called by the material's user before drawing the object (i.e., mesh).
 		void Use();
 
+		//Sets our color and textures without binding our shader program.
+		//Use this when you know the program is already bound (e.g., when
+		//drawing several materials that share a program in a row).
+		void Apply();
+
+		const ShaderProgram* GetProgram() const { return m_program; }
+
 		protected:
 
 		//Small utility struct for managing how and where OpenGL will deal with our texture(s).
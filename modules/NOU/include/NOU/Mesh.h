@@ -12,9 +12,9 @@ Very basic class for managing the data associated with a 3D model.
 
 #include "GLM/glm.hpp"
 
+#include <array>
 #include <vector>
 #include <string>
-#include <map>
 #include <memory>
 
 namespace nou
@@ -34,47 +34,157 @@ namespace nou
 			SKIN_WEIGHT = 4
 		};
 
-		Mesh() = default;
+		//The number of values in Attrib, so we can keep one of something per attribute.
+		static const size_t ATTRIB_COUNT = 5;
+
+		//One vertex of a skinned mesh, laid out the way the skinning compute
+		//shader reads it (every member takes up 16 bytes, so there's no padding).
+		//Each vertex is moved by up to four joints, blended by their weights.
+		struct SkinVertex
+		{
+			glm::vec4 pos;
+			glm::vec4 normal;
+			glm::uvec4 joints;
+			glm::vec4 weights;
+		};
+
+		//How the mesh stores its positions, normals and UVs on the GPU.
+		enum class Storage
+		{
+			//One buffer per attribute. Updating one attribute only uploads that attribute.
+			SEPARATE,
+			//One buffer with each vertex's position, normal and UV next to each other.
+			//The GPU can fetch a whole vertex at once, which is faster to draw, but
+			//updating any attribute uploads the whole vertex.
+			INTERLEAVED
+		};
+
+		//Dynamic meshes are ones we expect to update often (e.g., every frame for
+		//an animated mesh), which lets OpenGL pick a better place to keep them.
+		Mesh(Storage storage = Storage::SEPARATE, bool dynamic = false);
 		virtual ~Mesh() = default;
 
 		void SetVerts(const std::vector<glm::vec3>& verts);
 		void SetNormals(const std::vector<glm::vec3>& normals);
 		void SetUVs(const std::vector<glm::vec2>& uvs);
 
+		//Sets the positions, normals and UVs all at once.
+		//For interleaved meshes, this uploads the vertices once instead of three times,
+		//so it is the one to use when updating a mesh every frame.
+		void SetVertexData(const std::vector<glm::vec3>& verts,
+						   const std::vector<glm::vec3>& normals,
+						   const std::vector<glm::vec2>& uvs);
+
+		//Sets the indices used to draw the mesh (three per triangle).
+		//Pass in an empty list to go back to drawing the vertices in order.
+		void SetIndices(const std::vector<GLuint>& indices);
+
+		//Adds a buffer of raw data for this mesh's attributes or indices to point into.
+		//The mesh keeps the buffer alive, and it can be shared between meshes
+		//(e.g., every primitive that a glTF file packs into the same bufferView).
+		const VertexBuffer* AddBuffer(const std::shared_ptr<VertexBuffer>& buffer);
+
+		//Points an attribute at data inside of a buffer given to AddBuffer,
+		//rather than uploading a separate copy of it.
+		void SetAttrib(Attrib attrib, const AttribLayout& layout);
+
+		//As above, for indices inside of a buffer given to AddBuffer.
+		void SetIndices(const IndexLayout& layout);
+
 		//Fetches a vertex buffer associated with the desired attribute.
 		//Used by mesh rendering components to grab the requisite data
 		//associated with this model in OpenGL.
 		const VertexBuffer* GetVBO(Attrib attrib) const;
 
+		//Fetches the full description of where an attribute lives in its buffer,
+		//or nullptr if the mesh does not have the attribute.
+		const AttribLayout* GetAttrib(Attrib attrib) const;
+
+		//Fetches the indices for the mesh, or nullptr if it is drawn without them.
+		const IndexLayout* GetIndices() const;
+
+		//Sets the vertices used to skin this mesh (see SkinnedMesh).
+		//These are kept separately from the vertices we draw, since the skinned
+		//result goes into a different buffer for each animated copy of the mesh.
+		void SetSkin(const std::vector<SkinVertex>& verts);
+
+		bool IsSkinned() const { return m_skinBuffer != nullptr; }
+		const std::vector<SkinVertex>& GetSkinVerts() const { return m_skinVerts; }
+		const VertexBuffer* GetSkinBuffer() const { return m_skinBuffer.get(); }
+
+		Storage GetStorage() const { return m_storage; }
+
 		protected:
 
+		//One vertex of an interleaved mesh, as it is laid out on the GPU.
+		struct InterleavedVertex
+		{
+			glm::vec3 pos;
+			glm::vec3 normal;
+			glm::vec2 uv;
+		};
+
+		Storage m_storage;
+		bool m_dynamic;
+
 		std::vector<glm::vec3> m_verts;
 		std::vector<glm::vec3> m_normals;
 		std::vector<glm::vec2> m_uvs;
+		std::vector<GLuint> m_indices;
+
+		//Buffers holding a single attribute each, created by SetVerts, SetNormals, etc.
+		//for meshes with separate storage. Indexed by Attrib.
+		std::array<std::unique_ptr<VertexBuffer>, ATTRIB_COUNT> m_vbo;
+		//The buffer holding every vertex for meshes with interleaved storage.
+		std::unique_ptr<VertexBuffer> m_interleaved;
+		//Buffers added with AddBuffer, which may hold any number of attributes.
+		std::vector<std::shared_ptr<VertexBuffer>> m_buffers;
+		//Where each attribute lives, in one of the buffers above. Indexed by Attrib.
+		//Attributes the mesh does not have have no buffer.
+		std::array<AttribLayout, ATTRIB_COUNT> m_attribs;
 
-		std::map<Attrib, std::unique_ptr<VertexBuffer>> m_vbo;
+		std::unique_ptr<VertexBuffer> m_ibo;
+		IndexLayout m_indexLayout;
+
+		std::vector<SkinVertex> m_skinVerts;
+		std::unique_ptr<VertexBuffer> m_skinBuffer;
 
 		//Sets up a VertexBuffer for the desired attribute.
 		template<typename T>
 		void SetVBO(Attrib attrib, GLint elementLen, const std::vector<T>& data)
 		{
+			//Interleaved meshes keep every attribute in the same buffer.
+			if (m_storage == Storage::INTERLEAVED)
+			{
+				UploadInterleaved();
+				return;
+			}
+
+			size_t index = (size_t)attrib;
+
 			//We shouldn't be trying to send an empty array!
 			//A VBO with no data would just lead to memory access errors.
 			if (data.size() == 0)
 			{
-				m_vbo.erase(attrib);
+				m_vbo[index] = nullptr;
+				m_attribs[index] = AttribLayout();
 				return;
 			}
 
-			auto it = m_vbo.find(attrib);
-
 			//If our VBO does not already exist, make a new one.
-			if (it == m_vbo.end())
-				m_vbo.insert({attrib,
-					std::make_unique<VertexBuffer>(elementLen, data)});
+			if (m_vbo[index] == nullptr)
+				m_vbo[index] = std::make_unique<VertexBuffer>(elementLen, data, m_dynamic);
 			//If our VBO does exist, update it with the new data specified.
 			else
-				it->second->UpdateData(data);
+				m_vbo[index]->UpdateData(data);
+
+			AttribLayout layout;
+			layout.buffer = m_vbo[index].get();
+			layout.elementLen = elementLen;
+			m_attribs[index] = layout;
 		}
+
+		//Packs our positions, normals and UVs into the interleaved buffer.
+		void UploadInterleaved();
 	};
 }
\ No newline at end of file
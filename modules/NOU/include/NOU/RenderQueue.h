@@ -0,0 +1,79 @@
+/*
+NOU Framework - Created for INFR 2310 at Ontario Tech.
+(c) Samantha Stahlke 2020
+
+RenderQueue.h
+Collects mesh renderers for a frame, then draws them sorted by shader
+program, material and mesh so that we change as little OpenGL state as
+possible. Renderers that share a mesh and material are drawn together
+with instancing.
+*/
+
+#pragma once
+
+#include "CMeshRenderer.h"
+
+#include "GLM/glm.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace nou
+{
+	class RenderQueue
+	{
+		public:
+
+		//The attribute locations our shaders read each instance's model
+		//matrix (5-8) and normal matrix (9-11) from.
+		static const GLuint INSTANCE_MODEL_LOC = 5;
+		static const GLuint INSTANCE_NORMAL_LOC = 9;
+
+		RenderQueue() = default;
+		~RenderQueue() = default;
+
+		//Adds a renderer to be drawn on the next Flush.
+		//Since ENTT may move components around in memory, don't add or
+		//remove any components between adding renderers and flushing.
+		void Add(CMeshRenderer& renderer);
+
+		//Draws everything that has been added since the last flush.
+		//Make sure all of the transforms have been updated first (e.g., with DoFK).
+		void Flush();
+
+		//The number of draw calls the last flush made.
+		size_t GetDrawCount() const { return m_drawCount; }
+
+		protected:
+
+		struct Item
+		{
+			const ShaderProgram* program;
+			Material* mat;
+			const Mesh* mesh;
+			CMeshRenderer* renderer;
+			//Only plain CMeshRenderers can be instanced, anything that
+			//inherits from it may draw differently.
+			bool instanceable;
+			//Where this item's matrices are in m_instances.
+			size_t instance;
+		};
+
+		//Laid out to match the inModel and inNormal attributes in our shaders.
+		struct InstanceData
+		{
+			glm::mat4 model;
+			glm::mat3 normal;
+		};
+
+		//Points the instance attributes on vao at our instance buffer,
+		//starting from the given instance.
+		void BindInstances(VertexArray& vao, size_t first);
+		void UnbindInstances(VertexArray& vao);
+
+		std::vector<Item> m_items;
+		std::vector<InstanceData> m_instances;
+		std::unique_ptr<VertexBuffer> m_instanceVbo;
+		size_t m_drawCount = 0;
+	};
+}
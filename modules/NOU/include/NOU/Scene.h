@@ -0,0 +1,97 @@
+/*
+NOU Framework - Created for INFR 2310 at Ontario Tech.
+(c) Samantha Stahlke 2020
+
+Scene.h
+Owns an ENTT registry (and optionally the entities in it), so that
+each level can have its own set of entities and components.
+Scenes can be loaded on a background thread and swapped in once
+they are ready.
+*/
+
+#pragma once
+
+#include "Entity.h"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace nou
+{
+	class Scene
+	{
+		public:
+
+		Scene() = default;
+		Scene(const Scene&) = delete;
+		Scene& operator=(const Scene&) = delete;
+
+		//Destroys every entity the scene owns.
+		//Anything with OpenGL resources (e.g., renderers) gets cleaned up here,
+		//so scenes should be destroyed on the main thread.
+		~Scene();
+
+		entt::registry& Registry() { return m_registry; }
+
+		//Creates an entity that the scene owns and will destroy along with itself.
+		//The reference stays valid for as long as the scene does, so it is safe
+		//to use in transform hierarchies.
+		Entity& CreateEntity();
+
+		//The scene that Entity::Create and Entity::Allocate use when they
+		//aren't given one. There is always an active scene.
+		static Scene& Active();
+
+		//Makes the scene given the active one, and hands back the old one.
+		//If the current camera belonged to the old scene, the new scene's
+		//first camera (if it has one) becomes the current camera.
+		//Call this on the main thread, between frames.
+		static std::unique_ptr<Scene> Swap(std::unique_ptr<Scene> scene);
+
+		protected:
+
+		//Declared before m_entities so that it outlives them.
+		entt::registry m_registry;
+		std::vector<std::unique_ptr<Entity>> m_entities;
+
+		//Holds the active scene.
+		static std::unique_ptr<Scene>& ActivePtr();
+	};
+
+	//Builds a new scene on a background thread, then swaps it in on the
+	//main thread once it is done, so level transitions don't stall the game.
+	//
+	//OpenGL can only be used from the main thread, so loading is split in two:
+	//load runs on the background thread and should do everything else
+	//(reading files, creating entities, setting up transforms, etc.).
+	//finish runs on the main thread right before the swap, and should create
+	//anything that needs OpenGL (meshes, textures, renderers, etc.).
+	class SceneLoader
+	{
+		public:
+
+		SceneLoader(std::function<void(Scene&)> load,
+					std::function<void(Scene&)> finish = nullptr);
+
+		//Waits for the background thread if it is still running.
+		~SceneLoader() = default;
+
+		//Returns true once the background part of loading is done.
+		bool IsReady() const;
+
+		//Call this once per frame. If the background part of loading is done,
+		//this runs finish, swaps the new scene in and returns the old one.
+		//Otherwise (or if it has already swapped) it returns nullptr.
+		//Destroying the old scene is up to you - it has to happen on the main
+		//thread, but you may want to wait for a loading screen, etc.
+		std::unique_ptr<Scene> Poll();
+
+		protected:
+
+		std::function<void(Scene&)> m_finish;
+		std::unique_ptr<Scene> m_scene;
+		std::future<void> m_future;
+	};
+}
@@ -10,6 +10,7 @@ Utility classes for managing OpenGL shaders and shader programs.
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "glad/glad.h"
@@ -64,6 +65,9 @@ namespace nou
 
 		//Utility functions for managing uniforms - variables
 		//we send to the shader that persist until we change them.
+		//Locations are looked up once when the program is linked
+		//(and cached the first time for any names we missed), so these
+		//don't have to ask OpenGL every time.
 		GLint GetUniformLoc(const std::string& name) const;
 
 		template<typename T>
@@ -80,6 +84,13 @@ namespace nou
 		//The shader program currently in use.
 		static const ShaderProgram* m_current;
 
+		//The location of each uniform by name, filled in when we link.
+		//Mutable since looking up a name we haven't seen before adds it.
+		mutable std::unordered_map<std::string, GLint> m_uniformLocs;
+
+		//Fills in m_uniformLocs with every active uniform in the program.
+		void ReflectUniforms();
+
 		void Link();
 	};
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+/*
+NOU Framework - Created for INFR 2310 at Ontario Tech.
+(c) Samantha Stahlke 2020
+
+Skinning.h
+Deforms a skinned mesh by its joints (bones) once per frame, so that every
+pass that draws it (shadows, depth, colour, etc.) can use the result
+without skinning it again.
+*/
+
+#pragma once
+
+#include "Mesh.h"
+#include "Shader.h"
+
+#include "GLM/glm.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace nou
+{
+	//An animated copy of a skinned mesh (see Mesh::SetSkin and GLTF::LoadModel).
+	//Each copy has its own joint palette and its own skinned vertices, but shares
+	//its UVs and indices with the source mesh - so the source has to outlive it.
+	//
+	//Skinning runs as a compute shader when OpenGL 4.3 is available, writing
+	//straight into the vertex buffer we draw from. Otherwise it runs on the CPU.
+	class SkinnedMesh
+	{
+		public:
+
+		//The shader storage buffer bindings our skinning shader reads and writes.
+		static const GLuint SOURCE_BINDING = 0;
+		static const GLuint JOINT_BINDING = 1;
+		static const GLuint OUTPUT_BINDING = 2;
+
+		SkinnedMesh(const Mesh& source);
+		~SkinnedMesh() = default;
+
+		SkinnedMesh(const SkinnedMesh&) = delete;
+		SkinnedMesh& operator=(const SkinnedMesh&) = delete;
+
+		//Sets the matrix for each joint, in the order the source mesh's
+		//joint indices refer to them (see GLTF::GetJointMatrices).
+		//This only stores the palette - nothing is skinned until Update.
+		void SetJointMatrices(const std::vector<glm::mat4>& palette);
+
+		//Skins the mesh with the current joint matrices. Call this once per frame,
+		//after setting the matrices and before any pass draws the mesh.
+		//Does nothing if the matrices haven't changed since the last update.
+		void Update();
+
+		//The skinned mesh, to hand to a CMeshRenderer (or anything else that draws meshes).
+		//It has positions and normals from the skinning pass, and the source's UVs and indices.
+		Mesh& GetMesh() { return m_output; }
+
+		//Compute shaders write to memory in a way OpenGL doesn't keep track of on its own,
+		//so we have to tell it to wait before drawing with what they wrote.
+		//Call this once after updating every skinned mesh for the frame, rather than
+		//after each one, so the GPU can skin them all before it has to wait.
+		static void Barrier();
+
+		//Whether skinning runs on the GPU. This is on by default when it is supported,
+		//but can be turned off (e.g., to compare against the CPU version).
+		static bool UsingCompute();
+		static void SetUseCompute(bool useCompute);
+
+		protected:
+
+		//One skinned vertex, as our skinning shader writes it.
+		//Positions and normals are vec4s so the layout matches std430 with no padding.
+		struct OutputVertex
+		{
+			glm::vec4 pos;
+			glm::vec4 normal;
+		};
+
+		const Mesh* m_source;
+		Mesh m_output;
+
+		std::shared_ptr<VertexBuffer> m_outBuffer;
+		std::unique_ptr<VertexBuffer> m_jointBuffer;
+		std::vector<glm::mat4> m_palette;
+		//Whether the palette has changed since we last skinned the mesh.
+		bool m_dirty;
+
+		//Only used when skinning on the CPU.
+		std::vector<OutputVertex> m_cpuVerts;
+
+		void SkinCompute();
+		void SkinCPU();
+
+		static bool m_useCompute;
+		//Loaded the first time a mesh gets skinned on the GPU.
+		static std::unique_ptr<ShaderProgram> m_program;
+
+		//The number of vertices each compute shader work group skins.
+		//This has to match local_size_x in skinning.comp.
+		static const GLuint GROUP_SIZE = 64;
+	};
+}
@@ -13,6 +13,7 @@ Simple class for managing object transforms with basic hierarchy support.
 #include "GLM/glm.hpp"
 #include "GLM/gtx/quaternion.hpp"
 
+#include <cstdint>
 #include <vector>
 
 //Simple implementation of a transform component.
@@ -37,10 +38,14 @@ namespace nou
 		//call this once per frame before making all of your draw
 		//calls on the root node of your Scene.
 		//(FK stands for "forward kinematics", by the way.)
+		//Only objects whose position, rotation or scale changed
+		//since the last update (or that have a parent that changed)
+		//are actually recomputed.
 		void DoFK();
 
 		//This will recompute and return the global transform
-		//of this object.
+		//of this object, updating any of its parents that have
+		//changed along the way.
 		const glm::mat4& RecomputeGlobal();
 
 		//This will return the current global transform of the
@@ -62,9 +67,34 @@ namespace nou
 
 		Transform* m_parent;
 		std::vector<Transform*> m_children;
+		//Where we are in our parent's list of children, so we can
+		//be removed without searching for ourselves.
+		size_t m_childIndex;
 
+		glm::mat4 m_local;
 		glm::mat4 m_global;
 
+		//The position, rotation and scale that m_local was built from,
+		//so we can tell when they have been changed.
+		glm::vec3 m_cachedPos;
+		glm::vec3 m_cachedScale;
+		glm::quat m_cachedRotation;
+		//Forces a recompute on the next update (when we are new or
+		//have just switched parents).
+		bool m_dirty;
+		//Goes up by one every time m_global changes, so children can
+		//tell if they need to update without their parent telling them.
+		uint32_t m_version;
+		//The version of our parent's m_global we were last computed with.
+		uint32_t m_parentVersion;
+
+		//Rebuilds m_local if our position, rotation or scale has changed,
+		//returning true if it did.
+		bool UpdateLocal();
+		//Rebuilds m_global if we or our parent has changed, assuming our
+		//parent's m_global is already up to date.
+		void UpdateGlobal();
+
 		//These functions are protected since they will be handled
 		//by SetParent - we don't want to have to manually update this ourselves
 		//whenever we switch an object's parent!
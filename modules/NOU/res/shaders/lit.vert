@@ -12,7 +12,16 @@ to the fragment shader.
 
 uniform mat4 model;
 uniform mat3 normal;
-uniform mat4 viewproj;
+//When a RenderQueue draws several copies of a mesh at once, each copy's
+//matrices come from these attributes instead of the uniforms above.
+uniform bool instanced;
+layout(location = 5) in mat4 inModel;
+layout(location = 9) in mat3 inNormal;
+//Shared by every shader, updated by CCamera::BindCurrent.
+layout(std140, binding = 0) uniform Camera
+{
+    mat4 viewproj;
+};
 
 layout(location = 0) in vec4 inPos;
 layout(location = 1) in vec3 inNorm;
@@ -22,8 +31,8 @@ layout(location = 1) out vec3 outNorm;
 
 void main()
 {
-    outNorm = normal * inNorm;
-    outPos = model * inPos;
+    outNorm = (instanced ? inNormal : normal) * inNorm;
+    outPos = (instanced ? inModel : model) * inPos;
 
     gl_Position = viewproj * outPos;
 }
\ No newline at end of file
@@ -12,7 +12,16 @@ to the fragment shader.
 
 uniform mat4 model;
 uniform mat3 normal;
-uniform mat4 viewproj;
+//When a RenderQueue draws several copies of a mesh at once, each copy's
+//matrices come from these attributes instead of the uniforms above.
+uniform bool instanced;
+layout(location = 5) in mat4 inModel;
+layout(location = 9) in mat3 inNormal;
+//Shared by every shader, updated by CCamera::BindCurrent.
+layout(std140, binding = 0) uniform Camera
+{
+    mat4 viewproj;
+};
 
 layout(location = 0) in vec4 inPos;
 layout(location = 1) in vec3 inNorm;
@@ -24,8 +33,8 @@ layout(location = 2) out vec2 outUV;
 
 void main()
 {
-    outNorm = normal * inNorm;
-    outPos = model * inPos;
+    outNorm = (instanced ? inNormal : normal) * inNorm;
+    outPos = (instanced ? inModel : model) * inPos;
     outUV = inUV;
 
     gl_Position = viewproj * outPos;
@@ -15,10 +15,18 @@ layout(location = 2) in vec2 inUV;
 layout(location = 2) out vec2 outUV;
 
 uniform mat4 model;
-uniform mat4 viewproj;
+//When a RenderQueue draws several copies of a mesh at once, each copy's
+//model matrix comes from inModel instead of the uniform above.
+uniform bool instanced;
+layout(location = 5) in mat4 inModel;
+//Shared by every shader, updated by CCamera::BindCurrent.
+layout(std140, binding = 0) uniform Camera
+{
+    mat4 viewproj;
+};
 
 void main()
 {
     outUV = inUV;
-    gl_Position = viewproj * model * inPos;
+    gl_Position = viewproj * (instanced ? inModel : model) * inPos;
 }
\ No newline at end of file
@@ -12,9 +12,17 @@ Passes world vertex position to the fragment shader.
 layout(location = 0) in vec4 inPos;
 
 uniform mat4 model;
-uniform mat4 viewproj;
+//When a RenderQueue draws several copies of a mesh at once, each copy's
+//model matrix comes from inModel instead of the uniform above.
+uniform bool instanced;
+layout(location = 5) in mat4 inModel;
+//Shared by every shader, updated by CCamera::BindCurrent.
+layout(std140, binding = 0) uniform Camera
+{
+    mat4 viewproj;
+};
 
 void main()
 {
-    gl_Position = viewproj * model * inPos;
+    gl_Position = viewproj * (instanced ? inModel : model) * inPos;
 }
\ No newline at end of file
@@ -0,0 +1,359 @@
+/*
+NOU Framework - Created for INFR 2310 at Ontario Tech.
+(c) Samantha Stahlke 2020
+
+Animation.cpp
+Keyframed animation clips (e.g., loaded from glTF), sampling them over
+time, and blending several clips together into one pose.
+*/
+
+#include "NOU/Animation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <thread>
+
+//SSE2 is always there on x64, so we use it to blend four nodes at a time.
+//Anywhere else we blend one at a time (which the compiler may vectorize for us).
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define NOU_ANIMATION_SSE
+	#include <emmintrin.h>
+#endif
+
+namespace nou
+{
+	void Pose::Resize(size_t count)
+	{
+		for (std::vector<float>* component : { &posX, &posY, &posZ, &rotX, &rotY, &rotZ, &rotW,
+											  &scaleX, &scaleY, &scaleZ })
+			component->resize(count);
+	}
+
+	void Pose::Set(size_t index, const glm::vec3& pos, const glm::quat& rot, const glm::vec3& scale)
+	{
+		posX[index] = pos.x; posY[index] = pos.y; posZ[index] = pos.z;
+		rotX[index] = rot.x; rotY[index] = rot.y; rotZ[index] = rot.z; rotW[index] = rot.w;
+		scaleX[index] = scale.x; scaleY[index] = scale.y; scaleZ[index] = scale.z;
+	}
+
+	glm::vec3 Pose::GetPos(size_t index) const
+	{
+		return glm::vec3(posX[index], posY[index], posZ[index]);
+	}
+
+	glm::quat Pose::GetRotation(size_t index) const
+	{
+		//GLM takes w first.
+		return glm::quat(rotW[index], rotX[index], rotY[index], rotZ[index]);
+	}
+
+	glm::vec3 Pose::GetScale(size_t index) const
+	{
+		return glm::vec3(scaleX[index], scaleY[index], scaleZ[index]);
+	}
+
+	void AnimationCursor::Reset()
+	{
+		std::fill(m_keys.begin(), m_keys.end(), 0);
+	}
+
+	//Finds the value of a channel at the time given, starting from the key we
+	//were on last time.
+	static glm::vec4 SampleChannel(const AnimChannel& channel, float time, uint32_t& key, bool rotation)
+	{
+		const std::vector<float>& times = channel.times;
+		uint32_t last = (uint32_t)times.size() - 1;
+
+		//If we've gone back in time (e.g., the clip looped), we start over.
+		if (key > last || times[key] > time)
+			key = 0;
+
+		while (key < last && times[key + 1] <= time)
+			++key;
+
+		if (channel.step || key == last || time <= times[key])
+			return channel.values[key];
+
+		float t = (time - times[key]) / (times[key + 1] - times[key]);
+		glm::vec4 a = channel.values[key];
+		glm::vec4 b = channel.values[key + 1];
+
+		if (!rotation)
+			return glm::mix(a, b, t);
+
+		//q and -q are the same rotation, so we flip b if we need to in order
+		//to take the short way around.
+		if (glm::dot(a, b) < 0.0f)
+			b = -b;
+
+		return glm::normalize(glm::mix(a, b, t));
+	}
+
+	void SampleClip(const AnimationClip& clip, float time, AnimationCursor& cursor, Pose& pose)
+	{
+		//A cursor that was last used with a different clip has nothing useful in it.
+		if (cursor.m_clip != &clip || cursor.m_keys.size() != clip.tracks.size() * 3)
+		{
+			cursor.m_clip = &clip;
+			cursor.m_keys.assign(clip.tracks.size() * 3, 0);
+		}
+
+		for (size_t i = 0; i < clip.tracks.size(); ++i)
+		{
+			const NodeTrack& track = clip.tracks[i];
+
+			if (track.node < 0 || track.node >= (int)pose.Size())
+				continue;
+
+			size_t n = (size_t)track.node;
+			uint32_t* keys = &cursor.m_keys[i * 3];
+
+			if (!track.translation.IsEmpty())
+			{
+				glm::vec4 pos = SampleChannel(track.translation, time, keys[0], false);
+				pose.posX[n] = pos.x; pose.posY[n] = pos.y; pose.posZ[n] = pos.z;
+			}
+
+			if (!track.rotation.IsEmpty())
+			{
+				glm::vec4 rot = SampleChannel(track.rotation, time, keys[1], true);
+				pose.rotX[n] = rot.x; pose.rotY[n] = rot.y; pose.rotZ[n] = rot.z; pose.rotW[n] = rot.w;
+			}
+
+			if (!track.scale.IsEmpty())
+			{
+				glm::vec4 scale = SampleChannel(track.scale, time, keys[2], false);
+				pose.scaleX[n] = scale.x; pose.scaleY[n] = scale.y; pose.scaleZ[n] = scale.z;
+			}
+		}
+	}
+
+	//Blends a single node, for whatever is left over after the SIMD version.
+	static void BlendNode(const Pose* const* poses, const float* weights, size_t count,
+						  Pose& out, size_t n)
+	{
+		glm::vec3 pos(0.0f), scale(0.0f);
+		glm::vec4 rot(0.0f);
+		glm::vec4 ref(poses[0]->rotX[n], poses[0]->rotY[n], poses[0]->rotZ[n], poses[0]->rotW[n]);
+
+		for (size_t p = 0; p < count; ++p)
+		{
+			const Pose& pose = *poses[p];
+			float w = weights[p];
+
+			pos += pose.GetPos(n) * w;
+			scale += pose.GetScale(n) * w;
+
+			glm::vec4 q(pose.rotX[n], pose.rotY[n], pose.rotZ[n], pose.rotW[n]);
+			rot += q * ((glm::dot(ref, q) < 0.0f) ? -w : w);
+		}
+
+		float len = glm::length(rot);
+		rot = (len > 0.0f) ? rot / len : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+		out.Set(n, pos, glm::quat(rot.w, rot.x, rot.y, rot.z), scale);
+	}
+
+	void BlendPoses(const Pose* const* poses, const float* weights, size_t count, Pose& out)
+	{
+		if (count == 0)
+			return;
+
+		size_t size = poses[0]->Size();
+		out.Resize(size);
+		size_t n = 0;
+
+		#ifdef NOU_ANIMATION_SSE
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		const __m128 tiny = _mm_set1_ps(1e-12f);
+
+		for (; n + 4 <= size; n += 4)
+		{
+			__m128 px = zero, py = zero, pz = zero;
+			__m128 sx = zero, sy = zero, sz = zero;
+			__m128 qx = zero, qy = zero, qz = zero, qw = zero;
+
+			//Every rotation gets lined up with the first pose's, so that q and -q
+			//(the same rotation) don't cancel each other out.
+			const Pose& first = *poses[0];
+			const __m128 rx = _mm_loadu_ps(&first.rotX[n]);
+			const __m128 ry = _mm_loadu_ps(&first.rotY[n]);
+			const __m128 rz = _mm_loadu_ps(&first.rotZ[n]);
+			const __m128 rw = _mm_loadu_ps(&first.rotW[n]);
+
+			for (size_t p = 0; p < count; ++p)
+			{
+				const Pose& pose = *poses[p];
+				const __m128 w = _mm_set1_ps(weights[p]);
+
+				px = _mm_add_ps(px, _mm_mul_ps(_mm_loadu_ps(&pose.posX[n]), w));
+				py = _mm_add_ps(py, _mm_mul_ps(_mm_loadu_ps(&pose.posY[n]), w));
+				pz = _mm_add_ps(pz, _mm_mul_ps(_mm_loadu_ps(&pose.posZ[n]), w));
+
+				sx = _mm_add_ps(sx, _mm_mul_ps(_mm_loadu_ps(&pose.scaleX[n]), w));
+				sy = _mm_add_ps(sy, _mm_mul_ps(_mm_loadu_ps(&pose.scaleY[n]), w));
+				sz = _mm_add_ps(sz, _mm_mul_ps(_mm_loadu_ps(&pose.scaleZ[n]), w));
+
+				const __m128 x = _mm_loadu_ps(&pose.rotX[n]);
+				const __m128 y = _mm_loadu_ps(&pose.rotY[n]);
+				const __m128 z = _mm_loadu_ps(&pose.rotZ[n]);
+				const __m128 qwp = _mm_loadu_ps(&pose.rotW[n]);
+
+				__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, x), _mm_mul_ps(ry, y)),
+										_mm_add_ps(_mm_mul_ps(rz, z), _mm_mul_ps(rw, qwp)));
+
+				//Flips the sign of the weight in every lane where the dot product is negative.
+				__m128 signedW = _mm_xor_ps(w, _mm_and_ps(_mm_cmplt_ps(dot, zero), signBit));
+
+				qx = _mm_add_ps(qx, _mm_mul_ps(x, signedW));
+				qy = _mm_add_ps(qy, _mm_mul_ps(y, signedW));
+				qz = _mm_add_ps(qz, _mm_mul_ps(z, signedW));
+				qw = _mm_add_ps(qw, _mm_mul_ps(qwp, signedW));
+			}
+
+			__m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)),
+									 _mm_add_ps(_mm_mul_ps(qz, qz), _mm_mul_ps(qw, qw)));
+			__m128 invLen = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(len2, tiny)));
+
+			_mm_storeu_ps(&out.posX[n], px);
+			_mm_storeu_ps(&out.posY[n], py);
+			_mm_storeu_ps(&out.posZ[n], pz);
+			_mm_storeu_ps(&out.scaleX[n], sx);
+			_mm_storeu_ps(&out.scaleY[n], sy);
+			_mm_storeu_ps(&out.scaleZ[n], sz);
+			_mm_storeu_ps(&out.rotX[n], _mm_mul_ps(qx, invLen));
+			_mm_storeu_ps(&out.rotY[n], _mm_mul_ps(qy, invLen));
+			_mm_storeu_ps(&out.rotZ[n], _mm_mul_ps(qz, invLen));
+			_mm_storeu_ps(&out.rotW[n], _mm_mul_ps(qw, invLen));
+		}
+		#endif
+
+		for (; n < size; ++n)
+			BlendNode(poses, weights, count, out, n);
+	}
+
+	Animator::Animator(const Pose& basePose)
+	{
+		m_base = basePose;
+		m_pose = basePose;
+	}
+
+	size_t Animator::AddClip(const AnimationClip& clip, float weight, bool loop)
+	{
+		Layer layer;
+		layer.clip = &clip;
+		layer.time = 0.0f;
+		layer.weight = weight;
+		layer.speed = 1.0f;
+		layer.loop = loop;
+		layer.pose = m_base;
+
+		m_layers.push_back(std::move(layer));
+		return m_layers.size() - 1;
+	}
+
+	void Animator::SetWeight(size_t index, float weight)
+	{
+		m_layers[index].weight = weight;
+	}
+
+	void Animator::SetSpeed(size_t index, float speed)
+	{
+		m_layers[index].speed = speed;
+	}
+
+	void Animator::SetTime(size_t index, float time)
+	{
+		m_layers[index].time = time;
+	}
+
+	void Animator::Update(float deltaTime)
+	{
+		m_blendPoses.clear();
+		m_blendWeights.clear();
+
+		float totalWeight = 0.0f;
+
+		for (Layer& layer : m_layers)
+		{
+			float duration = layer.clip->duration;
+			layer.time += deltaTime * layer.speed;
+
+			if (layer.loop && duration > 0.0f)
+			{
+				layer.time = std::fmod(layer.time, duration);
+
+				if (layer.time < 0.0f)
+					layer.time += duration;
+			}
+			else
+				layer.time = glm::clamp(layer.time, 0.0f, duration);
+
+			if (layer.weight <= 0.0f)
+				continue;
+
+			//Copying the base pose in doesn't allocate, since the sizes match.
+			layer.pose = m_base;
+			SampleClip(*layer.clip, layer.time, layer.cursor, layer.pose);
+
+			m_blendPoses.push_back(&layer.pose);
+			m_blendWeights.push_back(layer.weight);
+			totalWeight += layer.weight;
+		}
+
+		if (m_blendPoses.empty())
+		{
+			m_pose = m_base;
+			return;
+		}
+
+		if (m_blendPoses.size() == 1)
+		{
+			m_pose = *m_blendPoses[0];
+			return;
+		}
+
+		for (float& weight : m_blendWeights)
+			weight /= totalWeight;
+
+		BlendPoses(m_blendPoses.data(), m_blendWeights.data(), m_blendPoses.size(), m_pose);
+	}
+
+	void Animator::UpdateAll(const std::vector<Animator*>& animators, float deltaTime, unsigned threads)
+	{
+		if (threads == 0)
+			threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+		size_t count = animators.size();
+		threads = (unsigned)std::min<size_t>(threads, count);
+
+		if (threads <= 1)
+		{
+			for (Animator* animator : animators)
+				animator->Update(deltaTime);
+
+			return;
+		}
+
+		size_t batch = (count + threads - 1) / threads;
+
+		auto updateRange = [&animators, deltaTime](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+				animators[i]->Update(deltaTime);
+		};
+
+		//We hand a batch to each extra thread, and do the first batch ourselves.
+		std::vector<std::future<void>> others;
+
+		for (size_t begin = batch; begin < count; begin += batch)
+			others.push_back(std::async(std::launch::async, updateRange, begin, std::min(begin + batch, count)));
+
+		updateRange(0, std::min(batch, count));
+
+		for (auto& other : others)
+			other.get();
+	}
+}
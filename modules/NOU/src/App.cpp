@@ -16,14 +16,20 @@ Minimal utility class for GLFW window management.
 
 #include "glad/glad.h"
 
+#include <chrono>
 #include <iostream>
+#include <thread>
 
 namespace nou
 {
 	GLFWwindow* App::m_window = nullptr;
-	float App::m_prevTime = 0.0f;
+	uint64_t App::m_prevTicks = 0;
 	float App::m_deltaTime = 0.0f;
 	bool App::m_imguiInit = false;
+	uint64_t App::m_frameTicks = 0;
+	uint64_t App::m_leadTicks = 0;
+	uint64_t App::m_spinTicks = 0;
+	uint64_t App::m_nextFrame = 0;
 
 	//Creates our GLFW window.
 	void App::Init(const std::string& name, int width, int height)
@@ -90,6 +96,11 @@ namespace nou
 		//This initializes the background colour we want to use to clear our window.
 		//This default is black.
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+		//Vsync stops us from drawing frames the screen will never show.
+		SetVSync(true);
+
+		m_prevTicks = glfwGetTimerValue();
 	}
 
 	void App::InitImgui()
@@ -135,13 +146,45 @@ namespace nou
 
 	void App::Tick()
 	{
-		float time = static_cast<float>(glfwGetTime());
-		m_deltaTime = time - m_prevTime;
-		m_prevTime = time;
+		uint64_t ticks = glfwGetTimerValue();
+		m_deltaTime = static_cast<float>(static_cast<double>(ticks - m_prevTicks) / 
+										 static_cast<double>(glfwGetTimerFrequency()));
+		m_prevTicks = ticks;
+	}
+
+	void App::WaitForFrame()
+	{
+		uint64_t now = glfwGetTimerValue();
+
+		if (m_frameTicks == 0)
+			return;
+
+		//We schedule each frame from when the last one was due (rather than from now)
+		//so we don't drift. If we've fallen way behind, we start the schedule over.
+		m_nextFrame += m_frameTicks;
+
+		if (m_nextFrame + m_frameTicks < now || m_nextFrame > now + m_frameTicks)
+			m_nextFrame = now;
+
+		uint64_t wakeAt = (m_nextFrame > m_leadTicks) ? m_nextFrame - m_leadTicks : 0;
+
+		if (wakeAt > now + m_spinTicks)
+		{
+			double seconds = static_cast<double>(wakeAt - now - m_spinTicks) / 
+							 static_cast<double>(glfwGetTimerFrequency());
+			std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		}
+
+		while (glfwGetTimerValue() < wakeAt)
+			std::this_thread::yield();
 	}
 
 	void App::FrameStart()
 	{
+		//Wait for the frame to be due (if we have a frame limit), so that
+		//the input we poll below is as fresh as possible.
+		WaitForFrame();
+
 		//Calculate our delta time for this frame.
 		Tick();
 
@@ -193,6 +236,32 @@ namespace nou
 		return glfwWindowShouldClose(m_window);
 	}
 
+	double App::GetTime()
+	{
+		return glfwGetTime();
+	}
+
+	void App::SetVSync(bool vsync, bool adaptive)
+	{
+		//A swap interval of -1 asks for adaptive vsync, which needs an extension.
+		if (vsync && adaptive &&
+			(glfwExtensionSupported("WGL_EXT_swap_control_tear") ||
+			 glfwExtensionSupported("GLX_EXT_swap_control_tear")))
+			glfwSwapInterval(-1);
+		else
+			glfwSwapInterval(vsync ? 1 : 0);
+	}
+
+	void App::SetFrameLimit(float fps, double inputLead, double spinTime)
+	{
+		double freq = static_cast<double>(glfwGetTimerFrequency());
+
+		m_frameTicks = (fps > 0.0f) ? static_cast<uint64_t>(freq / fps) : 0;
+		m_leadTicks = static_cast<uint64_t>(inputLead * freq);
+		m_spinTicks = static_cast<uint64_t>(spinTime * freq);
+		m_nextFrame = glfwGetTimerValue();
+	}
+
 	void App::SetClearColor(const glm::vec4& clearColor)
 	{
 		glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
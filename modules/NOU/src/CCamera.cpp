@@ -10,18 +10,24 @@ that we intend the class for use as a component with the ENTT framework.
 */
 
 #include "NOU/CCamera.h"
+#include "NOU/Scene.h"
 
 #include "GLM/gtx/transform.hpp"
 
 namespace nou
 {
 	Entity* CCamera::current = nullptr;
+	uint32_t CCamera::m_nextVersion = 0;
+	uint32_t CCamera::m_uploadedVersion = 0;
+	GLuint CCamera::m_ubo = 0;
 
 	CCamera::CCamera(Entity& owner)
 	{
 		//If there is no camera currently in use (i.e., we are the first one being created)
 		//then set the current camera owner to this camera's entity.
-		if (current == nullptr)
+		//Cameras in a scene that is still loading (possibly on another thread)
+		//are picked up when the scene is swapped in instead.
+		if (&owner.GetRegistry() == &Scene::Active().Registry() && current == nullptr)
 			current = &owner;
 
 		m_owner = &owner;
@@ -29,6 +35,8 @@ namespace nou
 		//Initialize our projection and view matrices to identity.
 		m_projection = glm::mat4(1.0f);
 		m_viewProjection = glm::mat4(1.0f);
+
+		m_version = ++m_nextVersion;
 	}
 
 	CCamera::~CCamera()
@@ -42,6 +50,8 @@ namespace nou
 	{
 		m_view = glm::inverse(m_owner->transform.RecomputeGlobal());
 		m_viewProjection = m_projection * m_view;
+
+		m_version = ++m_nextVersion;
 	}
 
 	const glm::mat4& CCamera::GetVP()
@@ -70,4 +80,27 @@ namespace nou
 		m_projection = glm::perspective(glm::radians(fovYDegrees), aspect, near, far);
 		Update();
 	}
+
+	void CCamera::BindCurrent()
+	{
+		if (current == nullptr)
+			return;
+
+		//The buffer is made the first time anything is drawn, and
+		//stays bound for the rest of the program.
+		if (m_ubo == 0)
+		{
+			glCreateBuffers(1, &m_ubo);
+			glNamedBufferData(m_ubo, sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+			glBindBufferBase(GL_UNIFORM_BUFFER, UBO_BINDING, m_ubo);
+		}
+
+		CCamera& cam = current->Get<CCamera>();
+
+		if (cam.m_version == m_uploadedVersion)
+			return;
+
+		glNamedBufferSubData(m_ubo, 0, sizeof(glm::mat4), &cam.m_viewProjection[0][0]);
+		m_uploadedVersion = cam.m_version;
+	}
 }
\ No newline at end of file
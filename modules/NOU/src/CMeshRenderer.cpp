@@ -19,6 +19,7 @@ namespace nou
 	{
 		m_owner = nullptr;
 		m_mat = nullptr;
+		m_mesh = nullptr;
 		m_vao = nullptr;
 	}
 
@@ -28,6 +29,7 @@ namespace nou
 	{
 		m_owner = &owner;
 		m_mat = &mat;
+		m_mesh = nullptr;
 		m_vao = std::make_unique<VertexArray>();
 		SetMesh(mesh);	
 	}
@@ -38,16 +40,22 @@ namespace nou
 	//the data needed to draw our 3D model.
 	void CMeshRenderer::SetMesh(const Mesh& mesh)
 	{
-		const VertexBuffer* vbo;
+		m_mesh = &mesh;
 
-		if ((vbo = mesh.GetVBO(Mesh::Attrib::POSITION)) != nullptr)
-			m_vao->BindAttrib(*vbo, (GLint)Mesh::Attrib::POSITION);
+		//Our attributes are numbered by the layout locations they use,
+		//so we can just walk through all of them.
+		for (size_t i = 0; i < Mesh::ATTRIB_COUNT; ++i)
+		{
+			const AttribLayout* layout = mesh.GetAttrib((Mesh::Attrib)i);
 
-		if ((vbo = mesh.GetVBO(Mesh::Attrib::NORMAL)) != nullptr)
-			m_vao->BindAttrib(*vbo, (GLint)Mesh::Attrib::NORMAL);
+			if (layout != nullptr)
+				m_vao->BindAttrib(*layout, (GLuint)i);
+		}
 
-		if ((vbo = mesh.GetVBO(Mesh::Attrib::UV)) != nullptr)
-			m_vao->BindAttrib(*vbo, (GLint)Mesh::Attrib::UV);
+		//Meshes without indices get an empty layout, so we don't keep
+		//using the indices from a mesh we were showing before.
+		const IndexLayout* indices = mesh.GetIndices();
+		m_vao->BindIndices((indices != nullptr) ? *indices : IndexLayout());
 	}
 
 	void CMeshRenderer::SetMaterial(Material& mat)
@@ -61,10 +69,13 @@ namespace nou
 
 		auto& transform = m_owner->transform;
 
+		//The camera's matrices live in a uniform block shared by all of
+		//our shaders, which only gets updated when the camera changes.
+		CCamera::BindCurrent();
+
 		//We are assuming the names used by uniform shader variables as a convention here.
 		//In a larger project, we would have a more elegant system for registering
 		//or even automatically detecting uniform names.
-		ShaderProgram::Current()->SetUniform("viewproj", CCamera::current->Get<CCamera>().GetVP());
 		ShaderProgram::Current()->SetUniform("model", transform.GetGlobal());
 		ShaderProgram::Current()->SetUniform("normal", transform.GetNormal());
 		
@@ -7,31 +7,46 @@ Minimal and lightly OOP wrapper for the ENTT framework.
 */
 
 #include "NOU/Entity.h"
+#include "NOU/Scene.h"
 
 namespace nou
 {
-	entt::registry Entity::ecs;
-
 	Entity Entity::Create()
 	{
-		entt::entity id = ecs.create();
-		return Entity(id);
+		return Create(Scene::Active());
 	}
 
 	std::unique_ptr<Entity> Entity::Allocate()
 	{
-		entt::entity id = ecs.create();
-		return std::move(std::make_unique<Entity>(id));
+		return Allocate(Scene::Active());
+	}
+
+	Entity Entity::Create(Scene& scene)
+	{
+		entt::entity id = scene.Registry().create();
+		return Entity(scene.Registry(), id);
+	}
+
+	std::unique_ptr<Entity> Entity::Allocate(Scene& scene)
+	{
+		entt::entity id = scene.Registry().create();
+		return std::make_unique<Entity>(scene.Registry(), id);
 	}
 
 	Entity::Entity(entt::entity id)
+		: Entity(Scene::Active().Registry(), id)
+	{
+	}
+
+	Entity::Entity(entt::registry& registry, entt::entity id)
 	{
+		m_registry = &registry;
 		m_id = id;
 	}
 
 	Entity::~Entity()
 	{
 		if(m_id != entt::null)
-			ecs.destroy(m_id);
+			m_registry->destroy(m_id);
 	}
-}
\ No newline at end of file
+}
@@ -9,8 +9,12 @@ Helpful reference: https://www.khronos.org/files/gltf20-reference-guide.pdf
 
 #include "NOU/GLTFLoader.h"
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
+#include "GLM/gtc/type_ptr.hpp"
+#include "GLM/gtx/matrix_decompose.hpp"
 #include "tiny_gltf.h"
 
 namespace nou::GLTF
@@ -29,7 +33,16 @@ namespace nou::GLTF
 			return;
 		}
 
-		result = ExtractGeometry(*gltf, mesh, flipUVY, err, warn);
+		//With only one primitive, we can draw straight out of the file's buffers.
+		//Otherwise the primitives need to be merged, since a mesh only has one VAO.
+		if (gltf->meshes.size() > 0 && gltf->meshes[0].primitives.size() == 1)
+		{
+			std::vector<std::shared_ptr<VertexBuffer>> views(gltf->bufferViews.size());
+			result = BuildPrimitive(*gltf, gltf->meshes[0].primitives[0], mesh, 
+									views, flipUVY, err, warn);
+		}
+		else
+			result = ExtractGeometry(*gltf, mesh, flipUVY, err, warn);
 
 		if (!result)
 		{
@@ -41,6 +54,322 @@ namespace nou::GLTF
 		printf("Loaded mesh from %s.\n", filename.c_str());
 	}
 
+	//Sets a transform up to match a node from the file.
+	//Nodes can either give us a full matrix, or a separate translation, rotation and scale.
+	static void ApplyNodeTransform(const tinygltf::Node& node, Transform& transform)
+	{
+		if (node.matrix.size() == 16)
+		{
+			//glTF matrices are column-major, same as GLM.
+			glm::mat4 matrix;
+			for (int i = 0; i < 16; ++i)
+				glm::value_ptr(matrix)[i] = (float)node.matrix[i];
+
+			glm::vec3 skew;
+			glm::vec4 perspective;
+			glm::decompose(matrix, transform.m_scale, transform.m_rotation, 
+						   transform.m_pos, skew, perspective);
+			return;
+		}
+
+		if (node.translation.size() == 3)
+			transform.m_pos = glm::vec3((float)node.translation[0], 
+										(float)node.translation[1], 
+										(float)node.translation[2]);
+
+		//glTF stores quaternions as x, y, z, w, but GLM takes w first.
+		if (node.rotation.size() == 4)
+			transform.m_rotation = glm::quat((float)node.rotation[3], 
+											 (float)node.rotation[0],
+											 (float)node.rotation[1], 
+											 (float)node.rotation[2]);
+
+		if (node.scale.size() == 3)
+			transform.m_scale = glm::vec3((float)node.scale[0], 
+										  (float)node.scale[1], 
+										  (float)node.scale[2]);
+	}
+
+	bool LoadModel(const std::string& filename, Model& model, bool flipUVY)
+	{
+		//Clear out anything we loaded before.
+		for (auto& node : model.nodes)
+			node->transform.SetParent(nullptr);
+
+		model.roots.clear();
+		model.nodes.clear();
+		model.meshes.clear();
+		model.skins.clear();
+		model.animations.clear();
+
+		auto gltf = std::make_unique<tinygltf::Model>();
+
+		std::string err, warn;
+
+		if (!ParseGLTF(filename, *gltf, err, warn))
+		{
+			DumpErrorsAndWarnings(filename, err, warn);
+			return false;
+		}
+
+		//Every bufferView gets uploaded once, the first time a primitive needs it.
+		std::vector<std::shared_ptr<VertexBuffer>> views(gltf->bufferViews.size());
+
+		model.meshes.resize(gltf->meshes.size());
+
+		for (size_t m = 0; m < gltf->meshes.size(); ++m)
+		{
+			const tinygltf::Mesh& meshData = gltf->meshes[m];
+
+			for (size_t p = 0; p < meshData.primitives.size(); ++p)
+			{
+				auto mesh = std::make_unique<Mesh>();
+				std::string primErr;
+
+				//One bad primitive shouldn't stop us from loading the rest of the file.
+				if (!BuildPrimitive(*gltf, meshData.primitives[p], *mesh, 
+									views, flipUVY, primErr, warn))
+				{
+					warn += "\nSkipping primitive " + std::to_string(p) + 
+							" of mesh " + std::to_string(m) + ": " + primErr;
+					continue;
+				}
+
+				model.meshes[m].push_back(std::move(mesh));
+			}
+		}
+
+		std::vector<bool> hasParent(gltf->nodes.size(), false);
+
+		for (const tinygltf::Node& nodeData : gltf->nodes)
+		{
+			auto node = std::make_unique<Node>();
+			node->name = nodeData.name;
+			node->mesh = (nodeData.mesh >= 0 && nodeData.mesh < (int)model.meshes.size()) 
+						 ? nodeData.mesh : -1;
+			node->skin = (nodeData.skin >= 0 && nodeData.skin < (int)gltf->skins.size())
+						 ? nodeData.skin : -1;
+			ApplyNodeTransform(nodeData, node->transform);
+
+			model.nodes.push_back(std::move(node));
+		}
+
+		for (const tinygltf::Skin& skinData : gltf->skins)
+		{
+			Skin skin;
+			skin.name = skinData.name;
+
+			for (int joint : skinData.joints)
+				skin.joints.push_back((joint >= 0 && joint < (int)model.nodes.size()) ? joint : -1);
+
+			//Joints without an inverse bind matrix use the identity.
+			skin.inverseBinds.resize(skin.joints.size(), glm::mat4(1.0f));
+
+			if (skinData.inverseBindMatrices >= 0)
+			{
+				DataGetter getter = BuildGetter(*gltf, skinData.inverseBindMatrices);
+
+				if (getter.data != nullptr && getter.components == 16)
+				{
+					size_t count = std::min(getter.len, skin.inverseBinds.size());
+
+					for (size_t j = 0; j < count; ++j)
+						ReadFloats(getter, j, glm::value_ptr(skin.inverseBinds[j]), 16);
+				}
+				else
+					warn += "\nInverse bind matrices for skin " + skin.name + 
+							" are in a currently unsupported format.";
+			}
+
+			model.skins.push_back(std::move(skin));
+		}
+
+		for (const tinygltf::Animation& animData : gltf->animations)
+		{
+			AnimationClip clip;
+			clip.name = animData.name;
+
+			//Where each node's track is in the clip, or -1 if it doesn't have one yet.
+			std::vector<int> trackIndex(model.nodes.size(), -1);
+
+			for (const tinygltf::AnimationChannel& channelData : animData.channels)
+			{
+				int node = channelData.target_node;
+
+				if (node < 0 || node >= (int)model.nodes.size() ||
+					channelData.sampler < 0 || channelData.sampler >= (int)animData.samplers.size())
+					continue;
+
+				AnimChannel* channel = nullptr;
+				int components = 3;
+
+				if (trackIndex[node] < 0)
+				{
+					trackIndex[node] = (int)clip.tracks.size();
+					clip.tracks.emplace_back();
+					clip.tracks.back().node = node;
+				}
+
+				NodeTrack& track = clip.tracks[trackIndex[node]];
+
+				if (channelData.target_path == "translation")
+					channel = &track.translation;
+				else if (channelData.target_path == "rotation")
+				{
+					channel = &track.rotation;
+					components = 4;
+				}
+				else if (channelData.target_path == "scale")
+					channel = &track.scale;
+				else
+				{
+					warn += "\nSkipping " + channelData.target_path + " channel in animation " + 
+							clip.name + " (only translation, rotation and scale are supported).";
+					continue;
+				}
+
+				if (!ReadChannel(*gltf, animData.samplers[channelData.sampler], components, *channel))
+				{
+					warn += "\nKeyframes in animation " + clip.name + 
+							" are in a currently unsupported format.";
+					continue;
+				}
+
+				clip.duration = std::max(clip.duration, channel->times.back());
+			}
+
+			model.animations.push_back(std::move(clip));
+		}
+
+		//Now that every node exists, we can hook up the hierarchy.
+		for (size_t i = 0; i < gltf->nodes.size(); ++i)
+		{
+			for (int child : gltf->nodes[i].children)
+			{
+				if (child < 0 || child >= (int)model.nodes.size())
+					continue;
+
+				model.nodes[child]->transform.SetParent(&model.nodes[i]->transform);
+				hasParent[child] = true;
+			}
+		}
+
+		//Use the file's default scene, or else the first one.
+		//Files without any scenes just get every node without a parent.
+		int scene = (gltf->defaultScene >= 0) ? gltf->defaultScene 
+				  : (gltf->scenes.size() > 0) ? 0 : -1;
+
+		if (scene >= 0 && scene < (int)gltf->scenes.size())
+		{
+			for (int root : gltf->scenes[scene].nodes)
+			{
+				if (root >= 0 && root < (int)model.nodes.size())
+					model.roots.push_back(model.nodes[root].get());
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < model.nodes.size(); ++i)
+			{
+				if (!hasParent[i])
+					model.roots.push_back(model.nodes[i].get());
+			}
+		}
+
+		DumpErrorsAndWarnings(filename, err, warn);
+		printf("Loaded %zu meshes, %zu nodes and %zu animations from %s.\n", 
+			   model.meshes.size(), model.nodes.size(), model.animations.size(), filename.c_str());
+
+		return true;
+	}
+
+	bool GetJointMatrices(const Model& model, const Node& node, std::vector<glm::mat4>& palette)
+	{
+		if (node.skin < 0 || node.skin >= (int)model.skins.size())
+			return false;
+
+		const Skin& skin = model.skins[node.skin];
+
+		//The node's own transform gets applied when we draw, so we take it
+		//back out here to avoid applying it twice.
+		glm::mat4 toNode = glm::inverse(node.transform.GetGlobal());
+
+		palette.resize(skin.joints.size());
+
+		for (size_t j = 0; j < skin.joints.size(); ++j)
+		{
+			if (skin.joints[j] < 0)
+			{
+				palette[j] = glm::mat4(1.0f);
+				continue;
+			}
+
+			const Transform& joint = model.nodes[skin.joints[j]]->transform;
+			palette[j] = toNode * joint.GetGlobal() * skin.inverseBinds[j];
+		}
+
+		return true;
+	}
+
+	void GetPose(const Model& model, Pose& pose)
+	{
+		pose.Resize(model.nodes.size());
+
+		for (size_t i = 0; i < model.nodes.size(); ++i)
+		{
+			const Transform& transform = model.nodes[i]->transform;
+			pose.Set(i, transform.m_pos, transform.m_rotation, transform.m_scale);
+		}
+	}
+
+	void ApplyPose(const Pose& pose, Model& model)
+	{
+		size_t count = std::min(pose.Size(), model.nodes.size());
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			Transform& transform = model.nodes[i]->transform;
+			transform.m_pos = pose.GetPos(i);
+			transform.m_rotation = pose.GetRotation(i);
+			transform.m_scale = pose.GetScale(i);
+		}
+	}
+
+	bool ReadChannel(const tinygltf::Model& gltf, const tinygltf::AnimationSampler& sampler,
+					 int components, AnimChannel& channel)
+	{
+		if (sampler.input < 0 || sampler.output < 0)
+			return false;
+
+		DataGetter input = BuildGetter(gltf, sampler.input);
+		DataGetter output = BuildGetter(gltf, sampler.output);
+
+		if (input.data == nullptr || input.components != 1 || input.len == 0 ||
+			output.data == nullptr || output.components != components)
+			return false;
+
+		//Cubic splines store an in-tangent, a value and an out-tangent for every key.
+		//We only keep the values, and interpolate between them linearly.
+		bool cubic = sampler.interpolation == "CUBICSPLINE";
+		size_t stride = cubic ? 3 : 1;
+
+		if (output.len < input.len * stride)
+			return false;
+
+		channel.step = sampler.interpolation == "STEP";
+		channel.times.resize(input.len);
+		channel.values.resize(input.len);
+
+		for (size_t k = 0; k < input.len; ++k)
+		{
+			ReadFloats(input, k, &channel.times[k], 1);
+			//Anything past the components we read is left as 0.
+			ReadFloats(output, k * stride + (cubic ? 1 : 0), &channel.values[k].x, 4);
+		}
+
+		return true;
+	}
+
 	void DumpErrorsAndWarnings(const std::string& filename,
 							   const std::string& err,
 							   const std::string& warn)
@@ -122,12 +451,13 @@ namespace nou::GLTF
 		std::vector<glm::vec3> verts;
 		std::vector<glm::vec3> normals;
 		std::vector<glm::vec2> uvs;
+		std::vector<GLuint> indices;
 
 		bool hasNormals = true, hasUVs = true;
 
 		for (size_t i = 0; i < meshData.primitives.size(); ++i)
 		{
-			if(!ProcessPrimitive(gltf, i, verts, uvs, normals, 
+			if(!ProcessPrimitive(gltf, meshData.primitives[i], verts, uvs, normals, indices,
 						         flipUVY, hasNormals, hasUVs, err, warn))
 				return false;
 		}
@@ -140,68 +470,48 @@ namespace nou::GLTF
 		if(hasUVs)
 			mesh.SetUVs(uvs);
 
+		mesh.SetIndices(indices);
+
 		return true;
 	}
 
-	bool ProcessPrimitive(const tinygltf::Model& gltf, size_t geomIndex,
+	bool ProcessPrimitive(const tinygltf::Model& gltf, const tinygltf::Primitive& geom,
 		                  std::vector<glm::vec3>& verts, std::vector<glm::vec2>& uvs,
-		                  std::vector<glm::vec3>& normals, bool flipUVY,
-						  bool& hasNormals, bool& hasUVs,
+		                  std::vector<glm::vec3>& normals, std::vector<GLuint>& indices,
+						  bool flipUVY, bool& hasNormals, bool& hasUVs,
 		                  std::string& err, std::string& warn)
 	{
-		const tinygltf::Primitive geom = gltf.meshes[0].primitives[geomIndex];
-
-		if (geom.indices == -1)
-		{
-			err = "File is missing primitive indices. "\
-				"Consider changing your GLTF export settings, or else this loader " \
-				"must be augmented to support files without indices.";
-
-			return false;
-		}
-
-		//glTF stores data per-vertex.
-		//This indexer will allow us to access the data that tells
-		//us which vertices make up the faces of the object.
-		//This allows us to specify our data in the order we need it
-		//for OpenGL vertex buffers - in other words, spelling out the vertex
-		//data as a set of triangles.
-		DataGetter faceIndexer = BuildGetter(gltf, geom.indices);
-
-		if (faceIndexer.elementSize != sizeof(GLshort))
+		if (geom.mode != TINYGLTF_MODE_TRIANGLES)
 		{
-			err = "Primitive indices are in a currently unsupported format. " \
-				"Consider changing your GLTF export settings, or else this loader " \
-				"must be augmented to support the provided format.";
-
-			return false;
+			warn += "\nSkipping a primitive that is not made of triangles.";
+			return true;
 		}
 
 		int vID = FindAccessor(geom, "POSITION");
 
 		if (vID == -1)
 		{
-			err = "No vertex positions found in mesh primitive " + std::to_string(geomIndex);
+			err = "No vertex positions found in mesh primitive.";
 			return false;
 		}
 
 		int nID = FindAccessor(geom, "NORMAL");
 		hasNormals = hasNormals && nID != -1;
 
-		if (!hasNormals)
-			warn += "\nNo normals found in mesh primitive " + std::to_string(geomIndex);
+		if (nID == -1)
+			warn += "\nNo normals found in mesh primitive.";
 
 		int uvID = FindAccessor(geom, "TEXCOORD_0");
 		hasUVs = hasUVs && uvID != -1;
 
 		if (uvID == -1)
-			warn += "\nNo UVs found in mesh primitive " + std::to_string(geomIndex);
+			warn += "\nNo UVs found in mesh primitive.";
 
 		DataGetter vGetter, nGetter, uvGetter;
 
 		vGetter = BuildGetter(gltf, vID);
 
-		if (vGetter.elementSize != sizeof(glm::vec3))
+		if (vGetter.data == nullptr || vGetter.components != 3)
 		{
 			err = "Vertex position data is in a currently unsupported format. " \
 				"Consider changing your GLTF export settings, or else this loader " \
@@ -214,67 +524,280 @@ namespace nou::GLTF
 		{
 			nGetter = BuildGetter(gltf, nID);
 
-			if (nGetter.elementSize != sizeof(glm::vec3))
+			if (nGetter.data == nullptr || nGetter.components != 3)
 			{
 				hasNormals = false;
-				warn += "\nNormal data is in a currently unsupported format. " \
-					"Consider changing your GLTF export settings, or else this loader " \
-					"must be augmented to support the provided format.";
+				warn += "\nNormal data is in a currently unsupported format.";
 			}
 		}
 
-
 		if (hasUVs)
 		{
 			uvGetter = BuildGetter(gltf, uvID);
 
-			if (uvGetter.elementSize != sizeof(glm::vec2))
+			if (uvGetter.data == nullptr || uvGetter.components != 2)
 			{
 				hasUVs = false;
-				warn += "\nUV data is in a currently unsupported format. " \
-					"Consider changing your GLTF export settings, or else this loader " \
-					"must be augmented to support the provided format.";
+				warn += "\nUV data is in a currently unsupported format.";
 			}
 		}
 
+		//Our indices need to point past the vertices from any primitives before this one.
 		size_t startIndex = verts.size();
 
-		verts.resize(verts.size() + faceIndexer.len);
+		verts.resize(startIndex + vGetter.len);
 
 		if (hasNormals)
-			normals.resize(normals.size() + faceIndexer.len);
+			normals.resize(startIndex + vGetter.len);
 
 		if (hasUVs)
-			uvs.resize(uvs.size() + faceIndexer.len);
+			uvs.resize(startIndex + vGetter.len);
 
-		//This is the bit where we actually get to extracting our data.
-		for (size_t i = startIndex, f = 0; i < startIndex + faceIndexer.len && f < faceIndexer.len; ++i, ++f)
+		//glTF stores data per-vertex, so we can copy the vertices over as they are.
+		for (size_t i = 0; i < vGetter.len; ++i)
 		{
-			//What vertex do we need to look at?
-			GLshort vertIndex;
-			memcpy(&vertIndex, &faceIndexer.data[f * faceIndexer.stride], sizeof(GLshort));
-
-			size_t vert = vertIndex;
-
-			//Grab our vertex position.
-			memcpy(&verts[i], &vGetter.data[vert * vGetter.stride], sizeof(glm::vec3));
+			if (!ReadFloats(vGetter, i, &verts[startIndex + i].x, 3))
+			{
+				err = "Vertex position data is in a currently unsupported format.";
+				return false;
+			}
 
-			//Grab our vertex normal.
 			if (hasNormals)
-				memcpy(&normals[i], &nGetter.data[vert * nGetter.stride], sizeof(glm::vec3));
+				ReadFloats(nGetter, i, &normals[startIndex + i].x, 3);
 
-			//Grab our texture coordinates.
 			if (hasUVs)
 			{
-				memcpy(&uvs[i], &uvGetter.data[vert * uvGetter.stride], sizeof(glm::vec2));
+				glm::vec2& uv = uvs[startIndex + i];
+				ReadFloats(uvGetter, i, &uv.x, 2);
 
 				//We may need to flip our vertical UV-coordinate.
 				//You will probably need to do this, depending on your export settings/texture.
 				if (flipUVY)
+					uv.y = 1.0f - uv.y;
+			}
+		}
+
+		//The indices tell us which vertices make up the faces of the object.
+		//Primitives without them just use every three vertices as a triangle.
+		if (geom.indices == -1)
+		{
+			for (size_t i = 0; i < vGetter.len; ++i)
+				indices.push_back((GLuint)(startIndex + i));
+
+			return true;
+		}
+
+		DataGetter faceIndexer = BuildGetter(gltf, geom.indices);
+
+		if (faceIndexer.data == nullptr)
+		{
+			err = "Primitive indices are in a currently unsupported format.";
+			return false;
+		}
+
+		indices.reserve(indices.size() + faceIndexer.len);
+
+		for (size_t f = 0; f < faceIndexer.len; ++f)
+			indices.push_back((GLuint)startIndex + ReadIndex(faceIndexer, f));
+
+		return true;
+	}
+
+	//Gets the VertexBuffer holding a bufferView, uploading it if this is the first time we need it.
+	static const VertexBuffer* GetView(const tinygltf::Model& gltf, int viewIndex, Mesh& mesh,
+									   std::vector<std::shared_ptr<VertexBuffer>>& views)
+	{
+		std::shared_ptr<VertexBuffer>& view = views[viewIndex];
+
+		if (view == nullptr)
+		{
+			const tinygltf::BufferView& bv = gltf.bufferViews[viewIndex];
+			const tinygltf::Buffer& buf = gltf.buffers[bv.buffer];
+
+			view = std::make_shared<VertexBuffer>(&(buf.data[bv.byteOffset]), (GLsizeiptr)bv.byteLength);
+		}
+
+		return mesh.AddBuffer(view);
+	}
+
+	//Works out where an accessor's data lives within its bufferView.
+	static bool BuildLayout(const tinygltf::Model& gltf, int accIndex, Mesh& mesh,
+							std::vector<std::shared_ptr<VertexBuffer>>& views,
+							AttribLayout& layout)
+	{
+		const tinygltf::Accessor& acc = gltf.accessors[accIndex];
+
+		//Sparse accessors store their values as changes to some other data,
+		//so there isn't anything in a buffer for us to point at.
+		if (acc.bufferView < 0 || acc.sparse.isSparse)
+			return false;
+
+		const tinygltf::BufferView& bv = gltf.bufferViews[acc.bufferView];
+		int stride = acc.ByteStride(bv);
+
+		if (stride <= 0)
+			return false;
+
+		layout.buffer = GetView(gltf, acc.bufferView, mesh, views);
+		layout.elementLen = tinygltf::GetNumComponentsInType(acc.type);
+		layout.type = (GLenum)acc.componentType;
+		layout.normalized = acc.normalized ? GL_TRUE : GL_FALSE;
+		layout.stride = stride;
+		layout.offset = (GLsizeiptr)acc.byteOffset;
+		layout.count = (GLsizei)acc.count;
+
+		return true;
+	}
+
+	//Sets up the joint and weight attributes of a skinned primitive, and gathers
+	//everything the skinning pass needs into the mesh's skin vertices.
+	static bool BuildSkin(const tinygltf::Model& gltf, const tinygltf::Primitive& geom,
+						  int jID, int wID, Mesh& mesh,
+						  std::vector<std::shared_ptr<VertexBuffer>>& views,
+						  AttribLayout& layout)
+	{
+		DataGetter vGetter = BuildGetter(gltf, FindAccessor(geom, "POSITION"));
+		DataGetter jGetter = BuildGetter(gltf, jID);
+		DataGetter wGetter = BuildGetter(gltf, wID);
+
+		if (jGetter.data == nullptr || jGetter.components != 4 ||
+			wGetter.data == nullptr || wGetter.components != 4 ||
+			jGetter.len != vGetter.len || wGetter.len != vGetter.len)
+			return false;
+
+		int nID = FindAccessor(geom, "NORMAL");
+		DataGetter nGetter = (nID != -1) ? BuildGetter(gltf, nID) : DataGetter{ nullptr };
+
+		std::vector<Mesh::SkinVertex> skin(vGetter.len);
+
+		for (size_t i = 0; i < vGetter.len; ++i)
+		{
+			Mesh::SkinVertex& vert = skin[i];
+
+			ReadFloats(vGetter, i, &vert.pos.x, 3);
+			vert.pos.w = 1.0f;
+
+			if (nGetter.data != nullptr)
+				ReadFloats(nGetter, i, &vert.normal.x, 3);
+			vert.normal.w = 0.0f;
+
+			//Joint indices are unsigned integers, which ReadFloats leaves as they are.
+			glm::vec4 joints;
+			ReadFloats(jGetter, i, &joints.x, 4);
+			vert.joints = glm::uvec4(joints);
+
+			ReadFloats(wGetter, i, &vert.weights.x, 4);
+
+			//Exporters don't always make the weights add up to exactly 1.
+			float total = vert.weights.x + vert.weights.y + vert.weights.z + vert.weights.w;
+
+			if (total > 0.0f)
+				vert.weights /= total;
+			else
+				vert.weights = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+		}
+
+		mesh.SetSkin(skin);
+
+		//The attributes are there too, for shaders that want to skin as they draw.
+		if (BuildLayout(gltf, jID, mesh, views, layout))
+			mesh.SetAttrib(Mesh::Attrib::JOINT_INFLUENCE, layout);
+
+		if (BuildLayout(gltf, wID, mesh, views, layout))
+			mesh.SetAttrib(Mesh::Attrib::SKIN_WEIGHT, layout);
+
+		return true;
+	}
+
+	bool BuildPrimitive(const tinygltf::Model& gltf, const tinygltf::Primitive& geom,
+						Mesh& mesh, std::vector<std::shared_ptr<VertexBuffer>>& views,
+						bool flipUVY, std::string& err, std::string& warn)
+	{
+		if (geom.mode != TINYGLTF_MODE_TRIANGLES)
+		{
+			err = "Only primitives made of triangles are supported.";
+			return false;
+		}
+
+		int vID = FindAccessor(geom, "POSITION");
+		AttribLayout layout;
+
+		if (vID == -1 || !BuildLayout(gltf, vID, mesh, views, layout) || layout.elementLen != 3)
+		{
+			err = "No vertex positions in a supported format found in mesh primitive.";
+			return false;
+		}
+
+		mesh.SetAttrib(Mesh::Attrib::POSITION, layout);
+
+		int nID = FindAccessor(geom, "NORMAL");
+
+		if (nID == -1)
+			warn += "\nNo normals found in mesh primitive.";
+		else if (BuildLayout(gltf, nID, mesh, views, layout) && layout.elementLen == 3)
+			mesh.SetAttrib(Mesh::Attrib::NORMAL, layout);
+		else
+			warn += "\nNormal data is in a currently unsupported format.";
+
+		int uvID = FindAccessor(geom, "TEXCOORD_0");
+
+		if (uvID == -1)
+			warn += "\nNo UVs found in mesh primitive.";
+		else if (flipUVY)
+		{
+			//Flipping the UVs means changing them, so these get their own copy.
+			DataGetter uvGetter = BuildGetter(gltf, uvID);
+
+			if (uvGetter.data != nullptr && uvGetter.components == 2)
+			{
+				std::vector<glm::vec2> uvs(uvGetter.len);
+
+				for (size_t i = 0; i < uvGetter.len; ++i)
+				{
+					ReadFloats(uvGetter, i, &uvs[i].x, 2);
 					uvs[i].y = 1.0f - uvs[i].y;
+				}
+
+				mesh.SetUVs(uvs);
 			}
+			else
+				warn += "\nUV data is in a currently unsupported format.";
+		}
+		else if (BuildLayout(gltf, uvID, mesh, views, layout) && layout.elementLen == 2)
+			mesh.SetAttrib(Mesh::Attrib::UV, layout);
+		else
+			warn += "\nUV data is in a currently unsupported format.";
+
+		int jID = FindAccessor(geom, "JOINTS_0");
+		int wID = FindAccessor(geom, "WEIGHTS_0");
+
+		if (jID != -1 && wID != -1 && !BuildSkin(gltf, geom, jID, wID, mesh, views, layout))
+			warn += "\nSkinning data is in a currently unsupported format.";
+
+		//Primitives without indices just draw their vertices in order.
+		if (geom.indices == -1)
+			return true;
+
+		const tinygltf::Accessor& acc = gltf.accessors[geom.indices];
+
+		if (acc.bufferView < 0 || acc.sparse.isSparse ||
+			(acc.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
+			 acc.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT &&
+			 acc.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT))
+		{
+			err = "Primitive indices are in a currently unsupported format.";
+			return false;
 		}
 
+		//Index data is always tightly packed, so all we need is where it starts.
+		IndexLayout indices;
+		indices.buffer = GetView(gltf, acc.bufferView, mesh, views);
+		indices.type = (GLenum)acc.componentType;
+		indices.offset = (GLsizeiptr)acc.byteOffset;
+		indices.count = (GLsizei)acc.count;
+
+		mesh.SetIndices(indices);
+
 		return true;
 	}
 
@@ -291,15 +814,96 @@ namespace nou::GLTF
 	DataGetter BuildGetter(const tinygltf::Model& gltf, int accIndex)
 	{
 		const tinygltf::Accessor& acc = gltf.accessors[accIndex];
+
+		size_t len = acc.count;
+		int components = tinygltf::GetNumComponentsInType(acc.type);
+		int size = tinygltf::GetComponentSizeInBytes(acc.componentType) * components;
+
+		//We can't read accessors that don't point at a buffer (e.g., sparse ones).
+		if (acc.bufferView < 0 || acc.sparse.isSparse)
+			return { nullptr, len, 0, size, acc.componentType, components, acc.normalized };
+
 		const tinygltf::BufferView& bv = gltf.bufferViews[acc.bufferView];
 		const tinygltf::Buffer& buf = gltf.buffers[bv.buffer];
 
 		const unsigned char* data = &(buf.data[bv.byteOffset + acc.byteOffset]);
-		size_t len = acc.count;
 		int stride = acc.ByteStride(bv);
-		int size = tinygltf::GetComponentSizeInBytes(acc.componentType) *
-				   tinygltf::GetNumComponentsInType(acc.type);
 
-		return { data, len, stride, size };
+		if (stride <= 0)
+			data = nullptr;
+
+		return { data, len, stride, size, acc.componentType, components, acc.normalized };
+	}
+
+	//Converts a single component to a float, following the glTF rules for normalized integers.
+	template<typename T>
+	static float ReadComponent(const unsigned char* data, bool normalized, float scale)
+	{
+		T value;
+		memcpy(&value, data, sizeof(T));
+
+		if (!normalized)
+			return (float)value;
+
+		//Signed values have one more negative value than positive, so we clamp to -1.
+		return std::max((float)value / scale, -1.0f);
+	}
+
+	bool ReadFloats(const DataGetter& getter, size_t index, float* out, int count)
+	{
+		const unsigned char* element = &getter.data[index * getter.stride];
+		int available = std::min(count, getter.components);
+
+		for (int c = 0; c < available; ++c)
+		{
+			switch (getter.componentType)
+			{
+				case TINYGLTF_COMPONENT_TYPE_FLOAT:
+					memcpy(&out[c], element + c * sizeof(float), sizeof(float));
+					break;
+				case TINYGLTF_COMPONENT_TYPE_BYTE:
+					out[c] = ReadComponent<int8_t>(element + c, getter.normalized, 127.0f);
+					break;
+				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+					out[c] = ReadComponent<uint8_t>(element + c, getter.normalized, 255.0f);
+					break;
+				case TINYGLTF_COMPONENT_TYPE_SHORT:
+					out[c] = ReadComponent<int16_t>(element + c * 2, getter.normalized, 32767.0f);
+					break;
+				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+					out[c] = ReadComponent<uint16_t>(element + c * 2, getter.normalized, 65535.0f);
+					break;
+				default:
+					return false;
+			}
+		}
+
+		for (int c = available; c < count; ++c)
+			out[c] = 0.0f;
+
+		return true;
+	}
+
+	GLuint ReadIndex(const DataGetter& getter, size_t index)
+	{
+		const unsigned char* element = &getter.data[index * getter.stride];
+
+		switch (getter.componentType)
+		{
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+				return element[0];
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			{
+				uint16_t value;
+				memcpy(&value, element, sizeof(uint16_t));
+				return value;
+			}
+			default:
+			{
+				uint32_t value;
+				memcpy(&value, element, sizeof(uint32_t));
+				return value;
+			}
+		}
 	}
 }
\ No newline at end of file
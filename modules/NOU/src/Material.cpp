@@ -40,6 +40,11 @@ namespace nou
 	{
 		m_program->Bind();
 
+		Apply();
+	}
+
+	void Material::Apply()
+	{
 		m_program->SetUniform("matColor", m_color);
 
 		//Bind the textures used by this material.
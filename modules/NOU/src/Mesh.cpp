@@ -8,8 +8,17 @@ Very basic class for managing the data associated with a 3D model.
 
 #include "NOU/Mesh.h"
 
+#include <cstddef>
+#include <cstdio>
+
 namespace nou
 {
+	Mesh::Mesh(Storage storage, bool dynamic)
+	{
+		m_storage = storage;
+		m_dynamic = dynamic;
+	}
+
 	void Mesh::SetVerts(const std::vector<glm::vec3>& verts)
 	{
 		m_verts = verts;
@@ -28,13 +37,173 @@ namespace nou
 		SetVBO(Attrib::UV, 2, m_uvs);
 	}
 
+	void Mesh::SetVertexData(const std::vector<glm::vec3>& verts,
+							 const std::vector<glm::vec3>& normals,
+							 const std::vector<glm::vec2>& uvs)
+	{
+		m_verts = verts;
+		m_normals = normals;
+		m_uvs = uvs;
+
+		if (m_storage == Storage::INTERLEAVED)
+		{
+			UploadInterleaved();
+			return;
+		}
+
+		SetVBO(Attrib::POSITION, 3, m_verts);
+		SetVBO(Attrib::NORMAL, 3, m_normals);
+		SetVBO(Attrib::UV, 2, m_uvs);
+	}
+
+	void Mesh::SetIndices(const std::vector<GLuint>& indices)
+	{
+		m_indices = indices;
+
+		if (m_indices.size() == 0)
+		{
+			m_ibo = nullptr;
+			m_indexLayout = IndexLayout();
+			return;
+		}
+
+		if (m_ibo == nullptr)
+			m_ibo = std::make_unique<VertexBuffer>(1, m_indices);
+		else
+			m_ibo->UpdateData(m_indices);
+
+		m_indexLayout.buffer = m_ibo.get();
+		m_indexLayout.type = GL_UNSIGNED_INT;
+		m_indexLayout.offset = 0;
+		m_indexLayout.count = (GLsizei)m_indices.size();
+	}
+
+	void Mesh::SetSkin(const std::vector<SkinVertex>& verts)
+	{
+		m_skinVerts = verts;
+
+		if (m_skinVerts.size() == 0)
+		{
+			m_skinBuffer = nullptr;
+			return;
+		}
+
+		if (m_skinBuffer == nullptr)
+			m_skinBuffer = std::make_unique<VertexBuffer>(1, m_skinVerts);
+		else
+			m_skinBuffer->UpdateData(m_skinVerts);
+	}
+
+	const VertexBuffer* Mesh::AddBuffer(const std::shared_ptr<VertexBuffer>& buffer)
+	{
+		m_buffers.push_back(buffer);
+		return buffer.get();
+	}
+
+	void Mesh::SetAttrib(Attrib attrib, const AttribLayout& layout)
+	{
+		//Any copy we were keeping for this attribute is no longer needed.
+		m_vbo[(size_t)attrib] = nullptr;
+		m_attribs[(size_t)attrib] = layout;
+	}
+
+	void Mesh::SetIndices(const IndexLayout& layout)
+	{
+		m_indices.clear();
+		m_ibo = nullptr;
+		m_indexLayout = layout;
+	}
+
 	const VertexBuffer* Mesh::GetVBO(Mesh::Attrib attrib) const
 	{
-		auto it = m_vbo.find(attrib);
+		const AttribLayout* layout = GetAttrib(attrib);
 
-		if (it == m_vbo.end())
+		if (layout == nullptr)
 			return nullptr;
 
-		return it->second.get();
+		return layout->buffer;
+	}
+
+	const AttribLayout* Mesh::GetAttrib(Mesh::Attrib attrib) const
+	{
+		const AttribLayout& layout = m_attribs[(size_t)attrib];
+
+		if (layout.buffer == nullptr)
+			return nullptr;
+
+		return &layout;
+	}
+
+	const IndexLayout* Mesh::GetIndices() const
+	{
+		if (m_indexLayout.buffer == nullptr)
+			return nullptr;
+
+		return &m_indexLayout;
+	}
+
+	void Mesh::UploadInterleaved()
+	{
+		size_t count = m_verts.size();
+
+		size_t pos = (size_t)Attrib::POSITION;
+		size_t normal = (size_t)Attrib::NORMAL;
+		size_t uv = (size_t)Attrib::UV;
+
+		//Without positions, there are no vertices to draw.
+		if (count == 0)
+		{
+			m_interleaved = nullptr;
+			m_attribs[pos] = AttribLayout();
+			m_attribs[normal] = AttribLayout();
+			m_attribs[uv] = AttribLayout();
+			return;
+		}
+
+		if (m_interleaved == nullptr)
+			m_interleaved = std::make_unique<VertexBuffer>(nullptr, 0, m_dynamic);
+
+		m_interleaved->Resize(sizeof(InterleavedVertex), (GLsizei)count);
+
+		//Normals and UVs that don't have one entry per vertex get left out.
+		//(This happens between calls to SetVerts and SetNormals when
+		//the number of vertices changes - Use SetVertexData to avoid it.)
+		bool hasNormals = (m_normals.size() == count);
+		bool hasUVs = (m_uvs.size() == count);
+
+		//We write the vertices straight into the buffer rather than packing
+		//them into a copy first, which saves a copy of the mesh on the CPU.
+		InterleavedVertex* dest = static_cast<InterleavedVertex*>(m_interleaved->Map());
+
+		if (dest == nullptr)
+		{
+			printf("Failed to map the vertex buffer for an interleaved mesh.\n");
+			return;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			dest[i].pos = m_verts[i];
+			dest[i].normal = (hasNormals) ? m_normals[i] : glm::vec3(0.0f);
+			dest[i].uv = (hasUVs) ? m_uvs[i] : glm::vec2(0.0f);
+		}
+
+		if (!m_interleaved->Unmap())
+			printf("Vertex data for an interleaved mesh was lost, it will be uploaded on the next update.\n");
+
+		AttribLayout layout;
+		layout.buffer = m_interleaved.get();
+		layout.stride = sizeof(InterleavedVertex);
+
+		layout.elementLen = 3;
+		layout.offset = offsetof(InterleavedVertex, pos);
+		m_attribs[pos] = layout;
+
+		layout.offset = offsetof(InterleavedVertex, normal);
+		m_attribs[normal] = (hasNormals) ? layout : AttribLayout();
+
+		layout.elementLen = 2;
+		layout.offset = offsetof(InterleavedVertex, uv);
+		m_attribs[uv] = (hasUVs) ? layout : AttribLayout();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,193 @@
+/*
+NOU Framework - Created for INFR 2310 at Ontario Tech.
+(c) Samantha Stahlke 2020
+
+RenderQueue.cpp
+Collects mesh renderers for a frame, then draws them sorted by shader
+program, material and mesh so that we change as little OpenGL state as
+possible. Renderers that share a mesh and material are drawn together
+with instancing.
+*/
+
+#include "NOU/RenderQueue.h"
+#include "NOU/CCamera.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <typeinfo>
+
+namespace nou
+{
+	void RenderQueue::Add(CMeshRenderer& renderer)
+	{
+		Material* mat = renderer.GetMaterial();
+
+		Item item;
+		item.program = mat->GetProgram();
+		item.mat = mat;
+		item.mesh = renderer.GetMesh();
+		item.renderer = &renderer;
+		item.instanceable = (typeid(renderer) == typeid(CMeshRenderer)) && item.mesh != nullptr;
+		item.instance = 0;
+
+		m_items.push_back(item);
+	}
+
+	void RenderQueue::Flush()
+	{
+		m_drawCount = 0;
+
+		if (m_items.empty())
+			return;
+
+		//Sorting puts everything that uses the same program next to each other,
+		//then the same material, then the same mesh. We only need to switch
+		//programs and materials when they actually change, and identical
+		//mesh + material pairs end up in a row, ready to be instanced.
+		std::sort(m_items.begin(), m_items.end(), [](const Item& a, const Item& b)
+		{
+			if (a.program != b.program)
+				return a.program < b.program;
+			if (a.mat != b.mat)
+				return a.mat < b.mat;
+			return a.mesh < b.mesh;
+		});
+
+		//Gather up the matrices for everything we might instance and send
+		//them to the GPU in one go.
+		m_instances.clear();
+
+		for (auto& item : m_items)
+		{
+			if (!item.instanceable)
+				continue;
+
+			const Transform& transform = item.renderer->GetOwner()->transform;
+
+			item.instance = m_instances.size();
+			m_instances.push_back({ transform.GetGlobal(), transform.GetNormal() });
+		}
+
+		if (!m_instances.empty())
+		{
+			if (m_instanceVbo == nullptr)
+				m_instanceVbo = std::make_unique<VertexBuffer>(1, m_instances, true);
+			else
+				m_instanceVbo->UpdateData(m_instances);
+		}
+
+		CCamera::BindCurrent();
+
+		const ShaderProgram* program = nullptr;
+		Material* mat = nullptr;
+		size_t i = 0;
+
+		while (i < m_items.size())
+		{
+			Item& item = m_items[i];
+
+			if (!item.instanceable)
+			{
+				//We don't know what a custom renderer does, so let it
+				//handle everything and assume it changed our state.
+				item.renderer->Draw();
+				++m_drawCount;
+
+				program = nullptr;
+				mat = nullptr;
+				++i;
+				continue;
+			}
+
+			if (item.program != program)
+			{
+				item.program->Bind();
+				program = item.program;
+				mat = nullptr;
+			}
+
+			if (item.mat != mat)
+			{
+				item.mat->Apply();
+				mat = item.mat;
+			}
+
+			//Find how many of the following items share our mesh and material.
+			size_t end = i + 1;
+
+			while (end < m_items.size() && m_items[end].instanceable &&
+				   m_items[end].mat == item.mat && m_items[end].mesh == item.mesh)
+				++end;
+
+			//Shaders that don't know about instancing have to draw each copy
+			//on its own.
+			if (end - i == 1 || program->GetUniformLoc("instanced") < 0)
+			{
+				for (size_t j = i; j < end; ++j)
+				{
+					const InstanceData& data = m_instances[m_items[j].instance];
+					program->SetUniform("model", data.model);
+					program->SetUniform("normal", data.normal);
+					m_items[j].renderer->GetVAO().Draw();
+					++m_drawCount;
+				}
+			}
+			else
+			{
+				VertexArray& vao = item.renderer->GetVAO();
+
+				BindInstances(vao, item.instance);
+				program->SetUniform("instanced", 1);
+				vao.DrawInstanced((GLsizei)(end - i));
+				program->SetUniform("instanced", 0);
+				UnbindInstances(vao);
+				++m_drawCount;
+			}
+
+			i = end;
+		}
+
+		m_items.clear();
+	}
+
+	void RenderQueue::BindInstances(VertexArray& vao, size_t first)
+	{
+		GLsizei stride = (GLsizei)sizeof(InstanceData);
+		size_t base = first * sizeof(InstanceData);
+
+		glBindVertexArray(vao.GetID());
+		glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo->GetID());
+
+		//A mat4 takes up 4 attribute locations (one per column),
+		//and a mat3 takes up 3.
+		for (GLuint col = 0; col < 4; ++col)
+		{
+			GLuint loc = INSTANCE_MODEL_LOC + col;
+			size_t offset = base + offsetof(InstanceData, model) + col * sizeof(glm::vec4);
+
+			glEnableVertexAttribArray(loc);
+			glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset));
+			glVertexAttribDivisor(loc, 1);
+		}
+
+		for (GLuint col = 0; col < 3; ++col)
+		{
+			GLuint loc = INSTANCE_NORMAL_LOC + col;
+			size_t offset = base + offsetof(InstanceData, normal) + col * sizeof(glm::vec3);
+
+			glEnableVertexAttribArray(loc);
+			glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset));
+			glVertexAttribDivisor(loc, 1);
+		}
+	}
+
+	void RenderQueue::UnbindInstances(VertexArray& vao)
+	{
+		//Leaving these enabled would be harmless for our shaders (they ignore
+		//them when not instancing), but the VAO belongs to the renderer.
+		glBindVertexArray(vao.GetID());
+
+		for (GLuint loc = INSTANCE_MODEL_LOC; loc < INSTANCE_NORMAL_LOC + 3; ++loc)
+			glDisableVertexAttribArray(loc);
+	}
+}
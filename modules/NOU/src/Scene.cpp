@@ -0,0 +1,102 @@
+/*
+NOU Framework - Created for INFR 2310 at Ontario Tech.
+(c) Samantha Stahlke 2020
+
+Scene.cpp
+Owns an ENTT registry (and optionally the entities in it), so that
+each level can have its own set of entities and components.
+Scenes can be loaded on a background thread and swapped in once
+they are ready.
+*/
+
+#include "NOU/Scene.h"
+#include "NOU/CCamera.h"
+
+#include <chrono>
+
+namespace nou
+{
+	Scene::~Scene()
+	{
+		//Parents may be destroyed before their children, so we break up
+		//the hierarchy first.
+		for (auto& entity : m_entities)
+			entity->transform.SetParent(nullptr);
+
+		m_entities.clear();
+	}
+
+	Entity& Scene::CreateEntity()
+	{
+		m_entities.push_back(std::make_unique<Entity>(m_registry, m_registry.create()));
+		return *m_entities.back();
+	}
+
+	std::unique_ptr<Scene>& Scene::ActivePtr()
+	{
+		//Function statics are created the first time they're reached, and C++
+		//makes sure that only happens once even if several threads get here.
+		static std::unique_ptr<Scene> active = std::make_unique<Scene>();
+		return active;
+	}
+
+	Scene& Scene::Active()
+	{
+		return *ActivePtr();
+	}
+
+	std::unique_ptr<Scene> Scene::Swap(std::unique_ptr<Scene> scene)
+	{
+		if (scene == nullptr)
+			scene = std::make_unique<Scene>();
+
+		std::swap(ActivePtr(), scene);
+
+		//The old scene is now in scene. If our camera was in there, we switch
+		//to one in the new scene, so we're never drawing from a camera that
+		//is about to be destroyed.
+		if (CCamera::current == nullptr || &CCamera::current->GetRegistry() == &scene->Registry())
+		{
+			CCamera::current = nullptr;
+
+			auto cameras = Active().Registry().view<CCamera>();
+
+			if (!cameras.empty())
+				CCamera::current = cameras.get(*cameras.begin()).GetOwner();
+		}
+
+		return scene;
+	}
+
+	SceneLoader::SceneLoader(std::function<void(Scene&)> load,
+							 std::function<void(Scene&)> finish)
+	{
+		m_finish = finish;
+		m_scene = std::make_unique<Scene>();
+
+		//Nothing else touches the new scene until the future is ready,
+		//so the loading thread can have it all to itself.
+		Scene* scene = m_scene.get();
+		m_future = std::async(std::launch::async, [load, scene]() { load(*scene); });
+	}
+
+	bool SceneLoader::IsReady() const
+	{
+		return m_future.valid() &&
+			   m_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	std::unique_ptr<Scene> SceneLoader::Poll()
+	{
+		if (!IsReady())
+			return nullptr;
+
+		//This will rethrow anything that went wrong on the loading thread.
+		m_future.get();
+
+		if (m_finish)
+			m_finish(*m_scene);
+
+		return Scene::Swap(std::move(m_scene));
+	}
+}
@@ -10,6 +10,7 @@ Utility classes for managing OpenGL shaders and shader programs.
 
 #include "GLM/glm.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
@@ -148,7 +149,10 @@ namespace nou
 
 		//Provide feedback on the program's linking.
 		if (result)
+		{
 			printf("Linked shader program successfully.\n");
+			ReflectUniforms();
+		}
 		else
 		{
 			GLint buflen = 0;
@@ -184,7 +188,50 @@ namespace nou
 
 	GLint ShaderProgram::GetUniformLoc(const std::string& name) const
 	{
-		return glGetUniformLocation(m_id, name.c_str());
+		auto it = m_uniformLocs.find(name);
+
+		if (it != m_uniformLocs.end())
+			return it->second;
+
+		//Names we didn't see when linking (e.g., a single element of
+		//an array) get looked up once and remembered, even if they
+		//don't exist (location -1).
+		GLint loc = glGetUniformLocation(m_id, name.c_str());
+		m_uniformLocs[name] = loc;
+
+		return loc;
+	}
+
+	void ShaderProgram::ReflectUniforms()
+	{
+		GLint count = 0, maxLen = 0;
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+
+		std::vector<GLchar> name(std::max(maxLen, 1));
+
+		for (GLint i = 0; i < count; ++i)
+		{
+			GLsizei len = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(m_id, (GLuint)i, (GLsizei)name.size(), &len, &size, &type, name.data());
+
+			//Uniforms inside of blocks (like our camera block) don't
+			//have locations, so there's nothing to cache.
+			GLint loc = glGetUniformLocation(m_id, name.data());
+
+			if (loc < 0)
+				continue;
+
+			std::string uniformName(name.data(), len);
+			m_uniformLocs[uniformName] = loc;
+
+			//Arrays are reported as "name[0]", but we usually set
+			//them by just "name".
+			if (len > 3 && uniformName.compare(len - 3, 3, "[0]") == 0)
+				m_uniformLocs[uniformName.substr(0, uniformName.find('['))] = loc;
+		}
 	}
 
 	template<>
@@ -0,0 +1,148 @@
+/*
+NOU Framework - Created for INFR 2310 at Ontario Tech.
+(c) Samantha Stahlke 2020
+
+Skinning.cpp
+Deforms a skinned mesh by its joints (bones) once per frame, so that every
+pass that draws it (shadows, depth, colour, etc.) can use the result
+without skinning it again.
+*/
+
+#include "NOU/Skinning.h"
+
+#include <cstddef>
+
+namespace nou
+{
+	bool SkinnedMesh::m_useCompute = true;
+	std::unique_ptr<ShaderProgram> SkinnedMesh::m_program = nullptr;
+
+	SkinnedMesh::SkinnedMesh(const Mesh& source)
+		: m_output(Mesh::Storage::SEPARATE, true)
+	{
+		m_source = &source;
+		m_dirty = true;
+
+		const std::vector<Mesh::SkinVertex>& skin = source.GetSkinVerts();
+
+		if (skin.size() == 0)
+			printf("Creating a SkinnedMesh from a mesh without any skin data.\n");
+
+		//Start out in the bind pose, in case we get drawn before being updated.
+		m_cpuVerts.resize(skin.size());
+
+		for (size_t i = 0; i < skin.size(); ++i)
+			m_cpuVerts[i] = { skin[i].pos, skin[i].normal };
+
+		m_outBuffer = std::make_shared<VertexBuffer>(1, m_cpuVerts, true);
+		const VertexBuffer* out = m_output.AddBuffer(m_outBuffer);
+
+		AttribLayout layout;
+		layout.buffer = out;
+		layout.elementLen = 3;
+		layout.stride = sizeof(OutputVertex);
+		layout.offset = offsetof(OutputVertex, pos);
+		layout.count = (GLsizei)skin.size();
+		m_output.SetAttrib(Mesh::Attrib::POSITION, layout);
+
+		layout.offset = offsetof(OutputVertex, normal);
+		m_output.SetAttrib(Mesh::Attrib::NORMAL, layout);
+
+		//UVs and indices don't change when we animate, so we point at the source's.
+		if (const AttribLayout* uvs = source.GetAttrib(Mesh::Attrib::UV))
+			m_output.SetAttrib(Mesh::Attrib::UV, *uvs);
+
+		if (const IndexLayout* indices = source.GetIndices())
+			m_output.SetIndices(*indices);
+	}
+
+	void SkinnedMesh::SetJointMatrices(const std::vector<glm::mat4>& palette)
+	{
+		m_palette = palette;
+		m_dirty = true;
+	}
+
+	void SkinnedMesh::Update()
+	{
+		if (!m_dirty || m_palette.size() == 0 || !m_source->IsSkinned())
+			return;
+
+		if (UsingCompute())
+			SkinCompute();
+		else
+			SkinCPU();
+
+		m_dirty = false;
+	}
+
+	void SkinnedMesh::SkinCompute()
+	{
+		if (m_program == nullptr)
+		{
+			Shader shader("shaders/skinning.comp", GL_COMPUTE_SHADER);
+			m_program = std::make_unique<ShaderProgram>(std::vector<Shader*>{ &shader });
+		}
+
+		if (m_jointBuffer == nullptr)
+			m_jointBuffer = std::make_unique<VertexBuffer>(1, m_palette, true);
+		else
+			m_jointBuffer->UpdateData(m_palette);
+
+		GLuint count = (GLuint)m_source->GetSkinVerts().size();
+
+		m_program->Bind();
+		m_program->SetUniform("vertexCount", (int)count);
+		m_program->SetUniform("jointCount", (int)m_palette.size());
+
+		//Any buffer can be used as shader storage, so our vertex buffers
+		//can be read and written by the compute shader directly.
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SOURCE_BINDING, m_source->GetSkinBuffer()->GetID());
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, JOINT_BINDING, m_jointBuffer->GetID());
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OUTPUT_BINDING, m_outBuffer->GetID());
+
+		glDispatchCompute((count + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+	}
+
+	void SkinnedMesh::SkinCPU()
+	{
+		const std::vector<Mesh::SkinVertex>& skin = m_source->GetSkinVerts();
+		GLuint jointCount = (GLuint)m_palette.size();
+
+		for (size_t i = 0; i < skin.size(); ++i)
+		{
+			const Mesh::SkinVertex& vert = skin[i];
+
+			//Each vertex is moved by a blend of its joints' matrices.
+			glm::mat4 blend(0.0f);
+
+			for (int j = 0; j < 4; ++j)
+			{
+				if (vert.joints[j] < jointCount)
+					blend += m_palette[vert.joints[j]] * vert.weights[j];
+			}
+
+			m_cpuVerts[i].pos = blend * vert.pos;
+			//This is fine for normals so long as the joints don't scale unevenly.
+			m_cpuVerts[i].normal = glm::vec4(glm::normalize(glm::vec3(blend * vert.normal)), 0.0f);
+		}
+
+		m_outBuffer->UpdateData(m_cpuVerts);
+	}
+
+	void SkinnedMesh::Barrier()
+	{
+		if (UsingCompute())
+			glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+	}
+
+	bool SkinnedMesh::UsingCompute()
+	{
+		//Compute shaders and shader storage buffers need OpenGL 4.3.
+		return m_useCompute && GLAD_GL_VERSION_4_3;
+	}
+
+	void SkinnedMesh::SetUseCompute(bool useCompute)
+	{
+		m_useCompute = useCompute;
+	}
+}
@@ -15,12 +15,18 @@ namespace nou
 	Transform::Transform()
 	{
 		m_parent = nullptr;
+		m_childIndex = 0;
 
 		m_pos = glm::vec3(0.0f);
 		m_scale = glm::vec3(1.0f);
 		m_rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
 
+		m_local = glm::mat4(1.0f);
 		m_global = glm::mat4(1.0f);
+
+		m_dirty = true;
+		m_version = 0;
+		m_parentVersion = 0;
 	}
 
 	Transform::~Transform()
@@ -30,24 +36,14 @@ namespace nou
 
 	void Transform::DoFK()
 	{
-		//First, grab our local transform...
-		glm::mat4 local = glm::translate(m_pos) *
-						  glm::toMat4(glm::normalize(m_rotation)) *
-						  glm::scale(m_scale);
-
-		//If we have a parent, we need to multiply by our parent's
-		//global transform.
-		if (m_parent != nullptr)
-			m_global = m_parent->m_global * local;
-
-		//If we have no parent object, our global transform is our
-		//local transform!
-		else
-			m_global = local;
+		//Update ourselves first, since our children need our
+		//global transform...
+		UpdateGlobal();
 
 		//FK is recursive - we now repeat this process on our child nodes.
 		//Eventually, we'll be at the bottom of the hierarchy and this will
-		//return.
+		//return. Each node is only visited once, and children of a node
+		//that didn't change skip straight past the matrix math.
 		for (auto* child : m_children)
 		{
 			child->DoFK();
@@ -56,19 +52,62 @@ namespace nou
 
 	const glm::mat4& Transform::RecomputeGlobal()
 	{
-		//Just as with FK, compute our local, then multiply with
-		//our parent's transform if applicable.
+		//Make sure our parents are up to date, then do the same
+		//as FK (without touching our children).
+		if (m_parent != nullptr)
+			m_parent->RecomputeGlobal();
+
+		UpdateGlobal();
+
+		return m_global;
+	}
+
+	bool Transform::UpdateLocal()
+	{
+		//Comparing a few floats is much cheaper than rebuilding
+		//the matrix, so we only rebuild it when something changed.
+		if (!m_dirty && m_pos == m_cachedPos && m_scale == m_cachedScale &&
+			m_rotation == m_cachedRotation)
+			return false;
+
+		m_local = glm::translate(m_pos) *
+				  glm::toMat4(glm::normalize(m_rotation)) *
+				  glm::scale(m_scale);
+
+		m_cachedPos = m_pos;
+		m_cachedScale = m_scale;
+		m_cachedRotation = m_rotation;
+
+		return true;
+	}
+
+	void Transform::UpdateGlobal()
+	{
+		bool changed = UpdateLocal();
 
-		glm::mat4 local = glm::translate(m_pos) *
-						  glm::toMat4(m_rotation) *
-						  glm::scale(m_scale);
+		//If our parent's global transform has changed since we last
+		//used it, we need to update too.
+		if (m_parent != nullptr && m_parent->m_version != m_parentVersion)
+			changed = true;
 
+		if (!changed)
+			return;
+
+		//If we have a parent, we need to multiply by our parent's
+		//global transform.
 		if (m_parent != nullptr)
-			m_global = m_parent->RecomputeGlobal() * local;
+		{
+			m_global = m_parent->m_global * m_local;
+			m_parentVersion = m_parent->m_version;
+		}
+
+		//If we have no parent object, our global transform is our
+		//local transform!
 		else
-			m_global = local;
+			m_global = m_local;
 
-		return m_global;
+		++m_version;
+		m_dirty = false;
 	}
 
 	const glm::mat4& Transform::GetGlobal() const
@@ -106,6 +145,7 @@ namespace nou
 			m_parent->RemoveChild(this);
 
 		m_parent = parent;
+		m_dirty = true;
 
 		//If we have a parent now, add this as a child to that object.
 		if(m_parent != nullptr)
@@ -114,19 +154,20 @@ namespace nou
 
 	void Transform::AddChild(Transform* child)
 	{
+		child->m_childIndex = m_children.size();
 		m_children.push_back(child);
 	}
 
 	void Transform::RemoveChild(Transform* child)
 	{
-		for (auto it = m_children.begin(); it != m_children.end(); ++it)
-		{
-			if (*it == child)
-			{
-				m_children.erase(it);
-				break;
-			}
-
-		}
+		//Rather than searching for the child and shuffling everything
+		//after it down, we move our last child into its spot.
+		size_t index = child->m_childIndex;
+		if (index >= m_children.size() || m_children[index] != child)
+			return;
+
+		m_children[index] = m_children.back();
+		m_children[index]->m_childIndex = index;
+		m_children.pop_back();
 	}
 }
\ No newline at end of file
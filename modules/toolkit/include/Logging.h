@@ -1,4 +1,9 @@
 #pragma once
+// Release builds define SPDLOG_ACTIVE_LEVEL as warn (see Premake5.lua), which compiles LOG_INFO and LOG_TRACE out
+// entirely. spdlog defaults to info, so we have to default to trace ourselves to keep trace logging in debug
+#ifndef SPDLOG_ACTIVE_LEVEL
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
 #include "spdlog/spdlog.h"
 #include "spdlog/fmt/ostr.h"
 #include "spdlog/logger.h"
@@ -11,10 +16,13 @@ public:
 		bool OutputToConsole;
 		std::string LogFileName;
 		LoggerSettings() :
-			OutputToFile(false), OutputToConsole(true), LogFileName("logs.txt") {}
+			OutputToFile(false), OutputToConsole(true), LogFileName("logs.txt"), QueueSize(8192) {}
+		// The number of messages that can be waiting for the logging thread, once it's full the oldest are dropped
+		size_t QueueSize;
 	};
 	/*
-		Initializes the logging subsystem, and sets up the color logger and debug trace utilities
+		Initializes the logging subsystem, and sets up the color logger and debug trace utilities. Messages are
+		formatted on the calling thread, and written out to the sinks on a background thread
 	*/
 	static void Init(const LoggerSettings& settings = LoggerSettings());
 
@@ -27,6 +35,11 @@ public:
 		Gets the logging instance
 	*/
 	inline static std::shared_ptr<spdlog::logger>& GetLogger() { return myLogger; }
+	/*
+		Writes a message straight to the sinks on the calling thread, skipping the queue. This is for messages that
+		need to be written before we break or crash, everything else should go through the LOG_ macros
+	*/
+	static void LogSync(spdlog::level::level_enum level, const std::string& message);
 	/*
 		Dumps the current stack trace into a string for logging
 	*/
@@ -37,11 +50,12 @@ private:
 	static bool isInitialized;
 };
 
-// Client log macros
-#define LOG_TRACE(...) ::Logger::GetLogger()->trace(__VA_ARGS__)
-#define LOG_INFO(...)  ::Logger::GetLogger()->info(__VA_ARGS__)
-#define LOG_WARN(...)  ::Logger::GetLogger()->warn(__VA_ARGS__)
-#define LOG_ERROR(...) { ::Logger::GetLogger()->error(__VA_ARGS__); ::Logger::GetLogger()->error("Location: \n{}", ::Logger::DumpStackTrace()); }
+// Client log macros, anything below SPDLOG_ACTIVE_LEVEL compiles to nothing (and it's arguments are never evaluated)
+#define LOG_TRACE(...) SPDLOG_LOGGER_TRACE(::Logger::GetLogger(), __VA_ARGS__)
+#define LOG_INFO(...)  SPDLOG_LOGGER_INFO(::Logger::GetLogger(), __VA_ARGS__)
+#define LOG_WARN(...)  SPDLOG_LOGGER_WARN(::Logger::GetLogger(), __VA_ARGS__)
+#define LOG_ERROR(...) { SPDLOG_LOGGER_ERROR(::Logger::GetLogger(), __VA_ARGS__); SPDLOG_LOGGER_ERROR(::Logger::GetLogger(), "Location: \n{}", ::Logger::DumpStackTrace()); }
 
-// Allows us to assert if a value is true, and automagically debug break if it is false
-#define LOG_ASSERT(x, ...) { if (!(x)) { ::Logger::GetLogger()->error(__VA_ARGS__); __debugbreak(); } }
\ No newline at end of file
+// Allows us to assert if a value is true, and automagically debug break if it is false. The message skips the queue so
+// that it's written out before we break
+#define LOG_ASSERT(x, ...) { if (!(x)) { ::Logger::LogSync(spdlog::level::err, fmt::format(__VA_ARGS__)); __debugbreak(); } }
\ No newline at end of file
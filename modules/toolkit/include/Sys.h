@@ -1,5 +1,7 @@
 #pragma once
 #include <cstdint>
+#include <string>
+#include <vector>
 
 class System
 {
@@ -8,7 +10,9 @@ public:
 	inline static double GetMemoryUsageKB() { return GetMemoryUsageBytes() / 1024.0; }
 	inline static double GetMemoryUsageMB()  { return GetMemoryUsageKB() / 1024.0; }
 	inline static double GetMemoryUsageGB() { return GetMemoryUsageMB() / 1024.0; }
-	
+
+	// On Windows this is the paged pool usage, on Linux it's how much of the process has been swapped out, and on
+	// macOS it's always 0
 	static size_t GetPageUsageBytes();
 	inline static double GetPageUsageKB() { return GetPageUsageBytes() / 1024.0; }
 	inline static double GetPageUsageMB() { return GetPageUsageKB() / 1024.0; }
@@ -19,12 +23,62 @@ public:
 	inline static double GetPeakMemoryUsageMB() { return GetPeakMemoryUsageKB() / 1024.0; }
 	inline static double GetPeakMemoryUsageGB() { return GetPeakMemoryUsageMB() / 1024.0; }
 
+	// Gets the percentage of all the CPU's cores that the process has used since the last call
 	static double GetCpuUsage();
-		
+
+	// Gets the total CPU time the calling thread has used, in seconds
+	static double GetThreadCpuSeconds();
+
+	// Gets the GPU's dedicated memory and how much of it is free, through GL_NVX_gpu_memory_info or
+	// GL_ATI_meminfo. Needs a current OpenGL context, returns false if neither extension is supported
+	static bool GetGpuMemory(size_t& totalBytes, size_t& availableBytes);
+
 private:
 	static void __Init();
-	
+
 	static unsigned long long lastCPU, lastSysCPU, lastUserCPU;
 	static int      numProcessors;
 	static void*    self;
 };
+
+// Samples the process' memory and CPU usage on a background thread, along with the CPU usage of any threads that
+// register themselves, and keeps a short history of each for graphing. GPU memory can only be queried on the thread
+// with the OpenGL context, so that gets sampled when the render thread calls SampleGpu
+class SystemMonitor
+{
+public:
+	static const int HISTORY_SIZE = 128;
+
+	struct ThreadHistory {
+		std::string Name;
+		// Percent of a single core, for each sample
+		float       Usage[HISTORY_SIZE];
+	};
+
+	// A copy of everything that's been sampled. The histories are rings, Offset is the index of the oldest sample
+	struct Snapshot {
+		int   Offset;
+		float MemoryMB[HISTORY_SIZE];
+		float CpuUsage[HISTORY_SIZE];
+		// AMD only tells us how much is free, so that's what we keep for both
+		float GpuFreeMB[HISTORY_SIZE];
+		float PeakMemoryMB;
+		// 0 if the GPU doesn't tell us
+		float GpuTotalMB;
+		std::vector<ThreadHistory> Threads;
+	};
+
+	// Starts sampling every interval seconds
+	static void Start(double interval = 0.25);
+	static void Stop();
+
+	// Adds the calling thread to the threads we track, under the given name. Threads must unregister before they exit
+	static void RegisterThread(const std::string& name);
+	static void UnregisterThread();
+
+	// Queries the GPU's memory if it hasn't been for an interval, should be called on the render thread every frame
+	static void SampleGpu();
+
+	// Copies out everything that's been sampled so far
+	static void GetSnapshot(Snapshot& result);
+};
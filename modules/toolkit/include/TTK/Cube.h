@@ -1,44 +1,24 @@
 #pragma once
+#include <cstdint>
 /*
- * This is a cube, defined in the worst possible format ever.
- * This is literally just every single position and normal in the model, written out in a float
- * array. Do not do this. This is really dumb. Just don't. Please.
+ * This is a unit cube centered on the origin, as an indexed triangle list
  */
-const float CubeData[] = {
--0.50000f, 0.50000f, 0.50000f, 0.00000f, 1.00000f, 0.00000f,
-0.50000f, 0.50000f, -0.50000f, 0.00000f, 1.00000f, 0.00000f,
--0.50000f, 0.50000f, -0.50000f, 0.00000f, 1.00000f, 0.00000f,
-0.50000f, 0.50000f, 0.50000f, 1.00000f, 0.00000f, 0.00000f,
-0.50000f, -0.50000f, -0.50000f, 1.00000f, 0.00000f, 0.00000f,
-0.50000f, 0.50000f, -0.50000f, 1.00000f, 0.00000f, 0.00000f,
-0.50000f, -0.50000f, 0.50000f, 0.00000f, -1.00000f, 0.00000f,
--0.50000f, -0.50000f, -0.50000f, 0.00000f, -1.00000f, 0.00000f,
-0.50000f, -0.50000f, -0.50000f, 0.00000f, -1.00000f, 0.00000f,
--0.50000f, -0.50000f, 0.50000f, -1.00000f, 0.00000f, 0.00000f,
--0.50000f, 0.50000f, -0.50000f, -1.00000f, 0.00000f, 0.00000f,
--0.50000f, -0.50000f, -0.50000f, -1.00000f, 0.00000f, 0.00000f,
-0.50000f, -0.50000f, -0.50000f, 0.00000f, 0.00000f, -1.00000f,
--0.50000f, 0.50000f, -0.50000f, 0.00000f, 0.00000f, -1.00000f,
-0.50000f, 0.50000f, -0.50000f, 0.00000f, 0.00000f, -1.00000f,
-0.50000f, 0.50000f, 0.50000f, 0.00000f, 0.00000f, 1.00000f,
--0.50000f, -0.50000f, 0.50000f, 0.00000f, 0.00000f, 1.00000f,
-0.50000f, -0.50000f, 0.50000f, 0.00000f, 0.00000f, 1.00000f,
--0.50000f, 0.50000f, 0.50000f, 0.00000f, 1.00000f, 0.00000f,
-0.50000f, 0.50000f, 0.50000f, 0.00000f, 1.00000f, 0.00000f,
-0.50000f, 0.50000f, -0.50000f, 0.00000f, 1.00000f, 0.00000f,
-0.50000f, 0.50000f, 0.50000f, 1.00000f, 0.00000f, 0.00000f,
-0.50000f, -0.50000f, 0.50000f, 1.00000f, 0.00000f, 0.00000f,
-0.50000f, -0.50000f, -0.50000f, 1.00000f, 0.00000f, 0.00000f,
-0.50000f, -0.50000f, 0.50000f, 0.00000f, -1.00000f, 0.00000f,
--0.50000f, -0.50000f, 0.50000f, 0.00000f, -1.00000f, 0.00000f,
--0.50000f, -0.50000f, -0.50000f, 0.00000f, -1.00000f, 0.00000f,
--0.50000f, -0.50000f, 0.50000f, -1.00000f, 0.00000f, 0.00000f,
--0.50000f, 0.50000f, 0.50000f, -1.00000f, 0.00000f, 0.00000f,
--0.50000f, 0.50000f, -0.50000f, -1.00000f, 0.00000f, 0.00000f,
-0.50000f, -0.50000f, -0.50000f, 0.00000f, 0.00000f, -1.00000f,
--0.50000f, -0.50000f, -0.50000f, 0.00000f, 0.00000f, -1.00000f,
--0.50000f, 0.50000f, -0.50000f, 0.00000f, 0.00000f, -1.00000f,
-0.50000f, 0.50000f, 0.50000f, 0.00000f, 0.00000f, 1.00000f,
--0.50000f, 0.50000f, 0.50000f, 0.00000f, 0.00000f, 1.00000f,
--0.50000f, -0.50000f, 0.50000f, 0.00000f, 0.00000f, 1.00000f,
-};
\ No newline at end of file
+const float CubePositions[] = {
+-0.50000f, 0.50000f, 0.50000f,
+0.50000f, 0.50000f, -0.50000f,
+-0.50000f, 0.50000f, -0.50000f,
+0.50000f, 0.50000f, 0.50000f,
+0.50000f, -0.50000f, -0.50000f,
+0.50000f, -0.50000f, 0.50000f,
+-0.50000f, -0.50000f, -0.50000f,
+-0.50000f, -0.50000f, 0.50000f
+};
+
+const uint16_t CubeIndices[] = {
+0, 1, 2, 3, 4, 1,
+5, 6, 4, 7, 2, 6,
+4, 2, 1, 3, 7, 5,
+0, 3, 1, 3, 5, 4,
+5, 7, 6, 7, 0, 2,
+4, 6, 2, 3, 0, 7
+};
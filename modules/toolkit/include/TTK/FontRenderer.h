@@ -13,16 +13,19 @@
 //////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <string>
+#include <vector>
 #include "GLM/glm.hpp"
 #include "glad/glad.h"
 #include "stb_truetype.h"
 
 namespace  TTK
 {
+	// Where a glyph sits in a font's atlas, with it's bounds relative to the pen in pixels at the font's size (y down)
 	struct GlyphInfo {
-		glm::vec2 Positions[4];
-		glm::vec2 UVs[4];
-		float OffsetX, OffsetY;
+		glm::vec2 Min, Max;
+		glm::vec2 UVMin, UVMax;
+		float     Advance;
 	};
 
 	/* TODO: Font alignment
@@ -43,14 +46,60 @@ namespace  TTK
 		char R, G, B, A;
 	};
 
+	// One glyph of some text, the vertex shader expands it into a quad from the font's glyph table
+	struct GlyphInstance {
+		glm::vec2 Position;
+		float     Scale;
+		uint32_t  Glyph;
+		Col8      Color;
+	};
+
 	class FontRenderer;
+	class TrueTypeTextureFont;
+
+	/*
+	 * A piece of text that keeps it's glyphs between frames, for text that rarely changes (HUD labels, scores, etc)
+	 * The glyphs are only rebuilt when the text, color or scale change, moving it is free
+	 */
+	class TextHandle {
+	public:
+		TextHandle(const TrueTypeTextureFont& font, const std::string& text = "", const glm::vec2& position = glm::vec2(0.0f),
+				   const glm::vec4& color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), float scale = 1.0f);
+
+		void SetText(const std::string& text);
+		const std::string& GetText() const { return m_Text; }
+		void SetPosition(const glm::vec2& position) { m_Position = position; }
+		const glm::vec2& GetPosition() const { return m_Position; }
+		void SetColor(const glm::vec4& color);
+		const glm::vec4& GetColor() const { return m_Color; }
+		void SetScale(float scale);
+		float GetScale() const { return m_Scale; }
+
+	private:
+		friend class FontRenderer;
+		const TrueTypeTextureFont* m_Font;
+		std::string                m_Text;
+		glm::vec2                  m_Position;
+		glm::vec4                  m_Color;
+		float                      m_Scale;
+		// The glyphs relative to the text's position, rebuilt when dirty
+		std::vector<GlyphInstance> m_Glyphs;
+		bool                       m_Dirty;
+	};
 	
+	/*
+	 * A font baked into a signed distance field atlas, once when it's loaded. The atlas holds the distance to each
+	 * glyph's edge rather than it's coverage, so the same atlas stays sharp at any scale. Each glyph's bounds and atlas
+	 * rect also go into a small table texture, so text can be drawn from just a glyph index per character
+	 */
 	class TrueTypeTextureFont {
 	public:
 		TrueTypeTextureFont(const char* fileName, uint32_t size);
 		~TrueTypeTextureFont();
 		
-		GlyphInfo GetGlyph(int codePoint, float offsetX, float offsetY) const;
+		// Gets the index of a glyph in the font's tables, characters the font doesn't have get a space
+		uint32_t GetGlyphIndex(int codePoint) const;
+		const GlyphInfo& GetGlyph(int codePoint) const { return myGlyphs[GetGlyphIndex(codePoint)]; }
 		float  GetKerning(int char1, int char2) const;
 		float  GetLineHeight() const;
 
@@ -62,15 +111,19 @@ namespace  TTK
 		friend class FontRenderer;
 		GLuint   myTexture;
 		GLuint64 m_TexHandle;
+		// Two RGBA32F texels per glyph, it's bounds then it's atlas rect
+		GLuint   myGlyphTable;
+		GLuint64 m_GlyphTableHandle;
 
 		const uint32_t ATLAS_WIDTH = 1024;
 		const uint32_t ATLAS_HEIGHT = 1024;
-		const uint32_t FONT_OVERSAMPLE_X = 2;
-		const uint32_t FONT_OVERSAMPLE_Y = 2;
+		// The glyphs are baked at this pixel height, with this many pixels of distance around them
+		const uint32_t SDF_SIZE = 64;
+		const uint32_t SDF_PADDING = 8;
 		const uint32_t FIRST_CHAR = ' ';
 		const uint32_t CHAR_COUNT = '~' - ' ';
 
-		stbtt_packedchar* myCharInfo;
+		std::vector<GlyphInfo> myGlyphs;
 		uint32_t          myFontSize;
 		stbtt_fontinfo    myFontInfo;
 		float             myPixelHeightScale;
@@ -95,23 +148,45 @@ namespace  TTK
 	private:
 		static FontRenderer* m_Instance;
 
-		struct Vert {
-			glm::vec2 Position;
-			Col8      Color;
-			glm::vec2 UV;
-		};
-
 	public:
 		~FontRenderer();
 
+		// Text isn't drawn right away, everything rendered in a frame is batched up and drawn on the next flush, with
+		// one draw for each run of text in the same font
 		void Render(const TrueTypeTextureFont& font, const char* text, const glm::vec2& pos, const glm::vec4& color, float scale = 1.0f);
+		void Render(TextHandle& text);
+
+		// Draws all of the text that's been rendered since the last flush. This leaves blending disabled and depth
+		// writes enabled, rather than querying the GL state to put it back how it was
+		void Flush();
+
+		// Lays out the glyphs for some text, relative to origin, and adds them to the end of glyphs
+		static void BuildGlyphs(const TrueTypeTextureFont& font, const char* text, const glm::vec2& origin, const glm::vec4& color, float scale, std::vector<GlyphInstance>& glyphs);
 		
 	private:
 		FontRenderer();
+
+		// The buffers are split into this many segments, so we can write one while the GPU reads the others
+		static const size_t SegmentCount = 3;
+		// A run of glyphs that all use the same font
+		struct Batch {
+			const TrueTypeTextureFont* Font;
+			size_t                     First;
+			size_t                     Count;
+		};
+
+		// Makes sure the last batch is for the given font, and returns it
+		Batch& __GetBatch(const TrueTypeTextureFont& font);
+		// Moves to a new buffer with room for at least the given number of glyphs in each segment
+		void __Grow(size_t glyphs);
 				
-		GLuint   m_ShaderHandle;
-		GLuint   m_VAO, m_VBO, m_EBO;
-		Vert     m_MeshData[256 * 4];
-		GLuint   m_IndexData[256 * 6];
+		GLuint                     m_ShaderHandle;
+		GLuint                     m_VAO, m_VBO;
+		std::vector<GlyphInstance> m_Glyphs;
+		std::vector<Batch>         m_Batches;
+		GlyphInstance*             m_Mapped;
+		size_t                     m_GlyphCapacity;
+		size_t                     m_Segment;
+		GLsync                     m_Fences[SegmentCount];
 	};
 }
\ No newline at end of file
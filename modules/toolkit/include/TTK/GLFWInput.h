@@ -3,6 +3,8 @@
 #ifdef TTK_GLFW
 
 #include "Input.h"
+#include "InputQueue.h"
+#include <vector>
 #include "GLFW/glfw3.h"
 
 namespace TTK {
@@ -20,9 +22,27 @@ namespace TTK {
 		void __Poll() override;
 		void __Init(void* windowPtr) override;
 
+		// GLFW calls these from glfwPollEvents, they just queue up the event for the next Poll
+		static void __HandleKey(GLFWwindow* window, int key, int scancode, int action, int mods);
+		static void __HandleMouseButton(GLFWwindow* window, int button, int action, int mods);
+		static void __HandleMouseMove(GLFWwindow* window, double x, double y);
+		static void __HandleMouseScroll(GLFWwindow* window, double xDiff, double yDiff);
+		void __Push(const InputEvent& event);
+
 		GLFWwindow* m_Window;
-		char m_PrevKeys[(size_t)TTK_KEY_LAST + 1];
-		char m_PrevMouse[(size_t)TTK_MOUSEBUTTON_LAST + 1];
+		// Filled in by the GLFW callbacks on the thread that polls events, and emptied by Poll (which may be
+		// called from another thread, ex: a simulation thread)
+		SpscQueue<InputEvent, 4096> m_Events;
+		std::atomic<uint32_t> m_DroppedEvents;
+
+		// Everything below is only touched by Poll and the getters, so it belongs to whichever thread calls Poll
+		ButtonState m_Keys[(size_t)TTK_KEY_LAST + 1];
+		ButtonState m_Mouse[(size_t)TTK_MOUSEBUTTON_LAST + 1];
+		glm::vec2   m_MousePos;
+		glm::vec2   m_MouseScroll;
+		glm::vec2   m_MouseScrollDelta;
+		// Releases of buttons that were pressed in the same frame, which get applied on the next poll
+		std::vector<InputEvent> m_Deferred;
 	};
 }
 #endif
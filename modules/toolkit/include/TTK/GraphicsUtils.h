@@ -13,6 +13,7 @@
 #ifndef GRAPHICS_UTILS_H
 #define GRAPHICS_UTILS_H
 
+#include <cstdint>
 #include <string>
 #include <glm/glm.hpp>
 
@@ -20,6 +21,8 @@ struct GLFWwindow;
 
 namespace TTK
 {
+	class TextHandle;
+
 	/*
 	 * Represents how the world is aligned, can be either Y up or Z up
 	 */
@@ -51,6 +54,11 @@ namespace TTK
 		 * @param fontSize The size of the text to draw, default is 16
 		 */
 		static void DrawText2D(const std::string& text, float posX, float posY, const glm::vec4& color, float fontSize = 16);
+		/*
+		 * Draws text that keeps it's mesh between frames, see TTK::TextHandle
+		 * @param text The text to draw, made with TTK::Context::Instance().GetDefaultFont() or a font of your own
+		 */
+		static void DrawText2D(TextHandle& text);
 
 		/*
 		 * Initializes ImGUI, using the given window
@@ -150,14 +158,15 @@ namespace TTK
 		// This will set the camera mode to model view, push matrix apply the
 		// cube's transformation and pop matrix
 		// Colour is expected to be an array of four floats (rgba)
-		static void DrawCube(const glm::vec3& p0, float size, const glm::vec4& colour = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+		// flags is a combination of TTK::DrawFlags, for drawing over everything or as a wireframe
+		static void DrawCube(const glm::vec3& p0, float size, const glm::vec4& colour = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), uint32_t flags = 0);
 		static void DrawCube(float *p0, float size = 1.0f, float *colour = nullptr);
 		
 		//static void DrawPrism(TTK::Matrix4x4, TTK::Vector3 colour, float scale);
 
 		// Description:
 		// Draws teabro
-		static void DrawTeapot(const glm::vec3& p0, float size, const glm::vec4 colour = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+		static void DrawTeapot(const glm::vec3& p0, float size, const glm::vec4 colour = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), uint32_t flags = 0);
 		static void DrawTeapot(float *p0, float size = 1.0f, float *colour = nullptr);
 
 		/*
@@ -165,8 +174,9 @@ namespace TTK
 		 * @param center The center of the sphere
 		 * @param size The radius of the sphere
 		 * @param colour The color to draw the sphere in
+		 * @param flags A combination of TTK::DrawFlags, for drawing over everything or as a wireframe
 		 */
-		static void DrawSphere(const glm::vec3& center, float size, const glm::vec4& colour = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+		static void DrawSphere(const glm::vec3& center, float size, const glm::vec4& colour = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), uint32_t flags = 0);
 		/*
 		 * Draws a sphere in the scene, with the given transformation
 		 * @param p0 The transformation to apply to the unit sphere (note that the radius of the sphere is 1 by default)
@@ -179,8 +189,9 @@ namespace TTK
 		 * Draws a sphere in the scene, with the given transformation
 		 * @param p0 The transformation to apply to the unit sphere (note that the radius of the sphere is 1 by default)
 		 * @param colour The color to draw the sphere in
+		 * @param flags A combination of TTK::DrawFlags, for drawing over everything or as a wireframe
 		 */
-		static void DrawSphere(const glm::mat4& transform, const glm::vec4& colour = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+		static void DrawSphere(const glm::mat4& transform, const glm::vec4& colour = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), uint32_t flags = 0);
 		/*
 		 * Draws a sphere in the scene, with the given position, size, and color
 		 * @param p0 The center of the sphere, array of 3 floats
@@ -1,6 +1,9 @@
 ﻿#pragma once
+#include <functional>
+#include <vector>
 #include <GLM/detail/type_vec2.hpp>
 #include "../EnumToString.h"
+#include "InputQueue.h"
 
 namespace TTK {
 
@@ -241,16 +244,39 @@ namespace TTK {
 		 */
 		static void Uninitialize();
 		/*
-		 * Allows the TTK input system to check for changes in input devices, this should be called at the end of a
-		 * frame, before glfwPollEvents
+		 * Applies every input event that has come in since the last call, which updates the states the getters
+		 * return. This should be called once per frame (or simulation tick), after glfwPollEvents.
+		 * Events are queued up by the window's callbacks, so this and the getters may be called from a different
+		 * thread than the one polling events (ex: a simulation thread), as long as it's always the same thread
 		 */
 		static void Poll();
 
+		/*
+		 * Sets a function that gets handed every event as Poll applies it (ex: for recording input), or an empty
+		 * function to stop. It's called on the thread that calls Poll
+		 */
+		static void SetEventListener(const std::function<void(const InputEvent&)>& listener);
+		/*
+		 * While replaying, events from the window are thrown away and Poll only applies the events given to Inject,
+		 * so a recording can be played back without the real devices getting in the way
+		 */
+		static void SetReplaying(bool isReplaying);
+		static bool IsReplaying();
+		/*
+		 * Queues up an event for the next Poll, should be called from the thread that calls Poll. Only used while
+		 * replaying, anything injected otherwise is dropped
+		 */
+		static void Inject(const InputEvent& event);
+
 	private:
 		static Input* m_Instance;
 
 	protected:
 		Input() = default;
+
+		std::function<void(const InputEvent&)> m_Listener;
+		bool                                   m_IsReplaying = false;
+		std::vector<InputEvent>                m_Injected;
 		
 		virtual ButtonState  __GetKeyState(KeyCode key) = 0;
 		virtual ButtonState __GetMouseState(MouseButton button) = 0;
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+namespace TTK {
+
+	/*
+	 * A single thing that happened to an input device, as reported by the windowing system
+	 */
+	struct InputEvent {
+		enum class Type : uint8_t {
+			Key,
+			MouseButton,
+			MouseMove,
+			Scroll
+		};
+
+		Type      EventType;
+		// The key or mouse button, unused for mouse moves and scrolling
+		uint16_t  Code;
+		// True if the key or button went down, false if it went up
+		bool      IsDown;
+		// The new cursor position for mouse moves, or the amount scrolled for scroll events
+		glm::vec2 Value;
+	};
+
+	/*
+	 * A fixed size, lock-free queue for handing items from one thread to another. Exactly one thread may push
+	 * (the producer) and exactly one thread may pop (the consumer), which may be the same thread
+	 */
+	template <typename T, size_t Capacity>
+	class SpscQueue {
+	public:
+		static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+		SpscQueue() : m_Head(0), m_Tail(0) {}
+
+		/*
+		 * Adds an item to the back of the queue, should only be called from the producer thread
+		 * @returns False if the queue was full, in which case the item is dropped
+		 */
+		bool Push(const T& item) {
+			const size_t tail = m_Tail.load(std::memory_order_relaxed);
+			if (tail - m_Head.load(std::memory_order_acquire) >= Capacity)
+				return false;
+			m_Items[tail & (Capacity - 1)] = item;
+			// Release makes sure the consumer sees the item once it sees the new tail
+			m_Tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		/*
+		 * Takes the item from the front of the queue, should only be called from the consumer thread
+		 * @returns False if the queue was empty
+		 */
+		bool Pop(T& item) {
+			const size_t head = m_Head.load(std::memory_order_relaxed);
+			if (head == m_Tail.load(std::memory_order_acquire))
+				return false;
+			item = m_Items[head & (Capacity - 1)];
+			m_Head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		// The head and tail are only ever written by one thread each, keeping them on separate cache lines stops
+		// the two threads from fighting over the same line
+		alignas(64) std::atomic<size_t> m_Head;
+		alignas(64) std::atomic<size_t> m_Tail;
+		T m_Items[Capacity];
+	};
+}
@@ -4,8 +4,8 @@
 // You may not use this header in your GDW games.
 //
 // This header contains a helper class for drawing the primitive types that
-// were originally supported by GLUT. This file was purposefully built to
-// be non-optimal
+// were originally supported by GLUT. Meshes are queued up and drawn
+// instanced, one draw for each mesh and draw mode
 //
 // Based off of TTK by Michael Gharbharan 2017
 // Shawn Matthews 2019
@@ -13,6 +13,7 @@
 //////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <vector>
 #include "TTKContext.h"
 
 namespace TTK {
@@ -21,21 +22,51 @@ namespace TTK {
 		public:
 			~MeshHelper();
 			MeshHelper();
-			void RenderTeapot(const glm::mat4& transform, const glm::vec4& color) const;
-			void RenderSphere(const glm::mat4& transform, const glm::vec4& color) const;
-			void RenderCube(const glm::mat4& transform, const glm::vec4& color) const;
+			// Queues a mesh to be drawn on the next flush, transform should already include the view projection
+			void QueueTeapot(const glm::mat4& transform, const glm::vec4& color, uint32_t flags);
+			void QueueSphere(const glm::mat4& transform, const glm::vec4& color, uint32_t flags);
+			void QueueCube(const glm::mat4& transform, const glm::vec4& color, uint32_t flags);
+
+			// Draws everything that's been queued, with one instanced draw per mesh and draw mode
+			void Flush();
 			
 		private:
+			// One for each combination of DrawFlags
+			static const size_t ModeCount = 4;
+			// The instance buffer is split into this many segments, so we can write one while the GPU reads the others
+			static const size_t SegmentCount = 3;
+
+			struct Instance {
+				glm::mat4 Transform;
+				glm::vec4 Color;
+			};
 			struct mesh {
-				GLuint VAO;
-				GLuint VBO;
+				GLuint VAO = 0;
+				GLuint VBO = 0;
+				GLuint EBO = 0;
+				GLsizei IndexCount = 0;
+				// The resource the mesh is loaded from the first time it's drawn, or nullptr if it's built in
+				const char* Path = nullptr;
+				bool Attempted = false;
+				std::vector<Instance> Queued[ModeCount];
 			};
-			mesh __MakeMesh(const float* data, size_t size) const;
+			// Uploads an indexed mesh of positions, returns false if there's nothing to upload
+			bool __MakeMesh(mesh& result, const float* positions, size_t vertexCount, const uint16_t* indices, size_t indexCount);
+			// Loads a mesh from it's resource file, returns false if it couldn't be read
+			bool __LoadMesh(mesh& result);
+			// Moves to a new instance buffer with room for at least count instances in each segment
+			void __GrowInstances(size_t count);
 			
 			mesh m_Teapot;
 			mesh m_Sphere;
 			mesh m_Cube;
 			GLuint m_Shader;
+
+			GLuint   m_InstanceVBO;
+			uint8_t* m_InstanceMapped;
+			size_t   m_InstanceCapacity;
+			size_t   m_Segment;
+			GLsync   m_Fences[SegmentCount];
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// This class gathers up sprites and draws them instanced, with one draw
+// for each texture that they use
+//
+// Shawn Matthews - 2019
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <GLM/glm.hpp>
+#include "glad/glad.h"
+#include "Texture2D.h"
+
+namespace TTK {
+
+	struct SpriteCoordinates;
+
+	class SpriteBatch
+	{
+	public:
+		/*
+		 * Creates a new empty sprite batch, the buffers are made on the first flush
+		 */
+		SpriteBatch();
+		~SpriteBatch();
+
+		SpriteBatch(const SpriteBatch& other) = delete;
+		SpriteBatch& operator=(const SpriteBatch& other) = delete;
+
+		/*
+		 * Queues a sprite to be drawn on the next flush. The sprite is a quad from -1 to 1 on the X and Y axes
+		 * @param texture The texture to draw the sprite from
+		 * @param matrix The MVP matrix to render the sprite with, this should transform it directly into clip space
+		 * @param coords The part of the texture to draw, only the normalized coordinates are used
+		 * @param color The color to multiply the sprite by
+		 */
+		void Add(const Texture2D& texture, const glm::mat4& matrix, const SpriteCoordinates& coords, const glm::vec4& color = glm::vec4(1.0f));
+
+		/*
+		 * Draws every sprite that has been added since the last flush, with one instanced draw per texture. Sprites
+		 * that share a texture are drawn in the order they were added
+		 */
+		void Flush();
+
+		/*
+		 * Gets the number of sprites waiting to be drawn
+		 */
+		size_t GetCount() const { return m_Queued.size(); }
+
+	private:
+		// The instance buffer is split into this many segments, so we can write one while the GPU reads the others
+		static const size_t SegmentCount = 3;
+
+		struct Instance {
+			glm::mat4 Transform;
+			// The min U, min V, max U and max V of the part of the texture to draw
+			glm::vec4 UVRect;
+			glm::vec4 Color;
+		};
+		struct Queued {
+			GLuint   Texture;
+			Instance Data;
+		};
+
+		// Moves to a new instance buffer with room for at least count sprites in each segment
+		void __Grow(size_t count);
+
+		std::vector<Queued> m_Queued;
+		GLuint              m_VAO, m_VBO, m_Shader;
+		Instance*           m_Mapped;
+		size_t              m_Capacity;
+		size_t              m_Segment;
+		GLsync              m_Fences[SegmentCount];
+	};
+
+}
@@ -14,6 +14,7 @@
 
 #include <GLM/glm.hpp>
 #include "Texture2D.h"
+#include "SpriteBatch.h"
 #include <vector>
 
 namespace TTK {
@@ -80,6 +81,13 @@ namespace TTK {
 		 * @param matrix The MVP matrix to render this sprite with
 		 */
 		void Draw(const glm::mat4& matrix);
+		/*
+		 * Queues this sprite's current frame into a batch, to be drawn instanced with every other sprite that shares
+		 * it's texture when the batch is flushed. Prefer this when drawing lots of sprites
+		 * @param batch The batch to add the sprite to
+		 * @param matrix The MVP matrix to render this sprite with
+		 */
+		void Draw(SpriteBatch& batch, const glm::mat4& matrix) const;
 
 		/*
 		 * Sets a given frame to last for a given duration in seconds
@@ -21,6 +21,16 @@ namespace TTK
 	namespace Impl {
 		class MeshHelper;
 	}
+
+	// How the debug meshes (teapots, spheres and cubes) get drawn, these can be combined
+	enum DrawFlags : uint32_t {
+		// Depth tested and filled in
+		DrawDefault   = 0,
+		// Drawn over the top of everything, ignoring depth
+		DrawOverlay   = 1 << 0,
+		// Drawn as the outlines of it's triangles
+		DrawWireframe = 1 << 1
+	};
 	
 	class Context {
 	public:
@@ -65,10 +75,15 @@ namespace TTK
 		void SetViewport(int x, int y, int w, int h);
 
 		void RenderText(const char* text, const glm::vec2& position, const glm::vec4& color, float scale = 1.0f);
+		void RenderText(TextHandle& text);
+		// The font that RenderText uses, for making TextHandles with
+		const TrueTypeTextureFont& GetDefaultFont() const { return *m_DefaultFont; }
 		
-		void DrawTeapot(const glm::mat4& mat, const glm::vec4& color = glm::vec4(1.0f)) const;
-		void DrawSphere(const glm::mat4& mat, const glm::vec4& color = glm::vec4(1.0f)) const;
-		void DrawCube(const glm::mat4& mat, const glm::vec4& color = glm::vec4(1.0f)) const;
+		// The debug meshes are queued up and drawn instanced on the next flush, so any number of them only costs a
+		// few draw calls. They use the view projection as it was when they were queued
+		void DrawTeapot(const glm::mat4& mat, const glm::vec4& color = glm::vec4(1.0f), uint32_t flags = DrawDefault) const;
+		void DrawSphere(const glm::mat4& mat, const glm::vec4& color = glm::vec4(1.0f), uint32_t flags = DrawDefault) const;
+		void DrawCube(const glm::mat4& mat, const glm::vec4& color = glm::vec4(1.0f), uint32_t flags = DrawDefault) const;
 
 		void AddLine(const glm::vec3& a, const glm::vec3& b, const glm::vec4& color = {0, 0, 0, 1});
 		void AddTri(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec4& color = { 0, 0, 0, 1 });
@@ -87,29 +102,36 @@ namespace TTK
 
 		GLuint m_ShaderHandle;
 		GLuint m_PointShaderHandle;
+		// Each buffer is persistently mapped and split into segments, the Add functions write straight into the
+		// current one, and flushing draws it then moves on to the next. A segment is fenced once it's been drawn, so
+		// we only wait on the GPU if it's still reading a segment by the time we come back around to it
+		static const size_t SegmentCount = 3;
 		struct GLBuff {
-			GLuint VBO, VAO;
-			size_t Count;
-			size_t ElemSize;
-			GLenum Mode;
-			void*  Data;
-			GLuint Shader;
+			GLuint   VBO, VAO;
+			size_t   Count;
+			size_t   ElemSize;
+			size_t   MaxElems;
+			GLenum   Mode;
+			uint8_t* Mapped;
+			size_t   Segment;
+			GLsync   Fences[SegmentCount];
+			GLuint   Shader;
 		};
 		GLBuff m_Tris, m_Lines, m_Points;
 
 		int m_WindowWidth, m_WindowHeight;
 		int m_viewportX, m_viewportY;
 
-		GLBuff __InitBuff(GLenum mode, GLuint shader, void* dataSource, size_t elemSize, size_t maxElems);
+		GLBuff __InitBuff(GLenum mode, GLuint shader, size_t elemSize, size_t maxElems);
+		void __FreeBuff(GLBuff& buff);
 		void __Flush(GLBuff& buff);
+		// Gets where the next element of a buffer should be written
+		template <typename T>
+		T* __Next(GLBuff& buff) { return reinterpret_cast<T*>(buff.Mapped + (buff.Segment * buff.MaxElems + buff.Count) * buff.ElemSize); }
 		GLuint __CompileShader(const char* vsSource, const char* fsSource);
 
 		static const size_t MaxPointVerts = 512;
 		static const size_t MaxLineVerts = 512 * 2;
 		static const size_t MaxTriVerts = 512 * 3;
-
-		PointVert  m_PointVerts[MaxPointVerts];
-		SimpleVert m_LineVerts[MaxLineVerts];
-		SimpleVert m_TriVerts[MaxTriVerts];
 	};
 }
@@ -2,6 +2,7 @@
 #include <sstream>
 
 #include "spdlog/common.h"
+#include "spdlog/async.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/sinks/basic_file_sink.h"
 #include "spdlog/sinks/ansicolor_sink.h"
@@ -19,14 +20,19 @@ void Logger::Init(const LoggerSettings& settings) {
 		// Set our spd logging pattern
 		spdlog::set_pattern("%^[%l] %n: %v%$");
 
+		// A single thread writes to the sinks, if it falls behind we drop the oldest messages rather than stalling the
+		// thread that's logging
+		spdlog::init_thread_pool(settings.QueueSize, 1);
+
 		// Create a new color logger
 		if (settings.OutputToConsole) {
-			myLogger = spdlog::stdout_color_mt("APP", spdlog::color_mode::automatic);
+			myLogger = spdlog::stdout_color_mt<spdlog::async_factory_nonblock>("APP", spdlog::color_mode::automatic);
 		}
 		if (settings.OutputToFile) {
+			// Locked, since LogSync can write to it from any thread
 			myLogger->sinks().emplace(
 				myLogger->sinks().begin(),
-				std::make_shared<spdlog::sinks::basic_file_sink<spdlog::details::null_mutex>>(
+				std::make_shared<spdlog::sinks::basic_file_sink_mt>(
 					settings.LogFileName.empty() ? "logs.txt" : settings.LogFileName)
 			);
 		}
@@ -58,11 +64,30 @@ void Logger::Uninitialize()
 		HANDLE process = GetCurrentProcess();
 		SymCleanup(process);
 		#endif
+		size_t dropped = spdlog::thread_pool()->overrun_counter();
+		if (dropped > 0) {
+			myLogger->warn("Dropped {} log messages because the queue was full", dropped);
+		}
 		myLogger = nullptr;
+		// Waits for the logging thread to write out everything that's still queued
 		spdlog::shutdown();
 	}
 }
 
+void Logger::LogSync(spdlog::level::level_enum level, const std::string& message)
+{
+	if (myLogger == nullptr || !myLogger->should_log(level)) {
+		return;
+	}
+	spdlog::details::log_msg msg(myLogger->name(), level, message);
+	for (const spdlog::sink_ptr& sink : myLogger->sinks()) {
+		if (sink->should_log(level)) {
+			sink->log(msg);
+			sink->flush();
+		}
+	}
+}
+
 std::string Logger::DumpStackTrace()
 {
 	std::stringstream ss;
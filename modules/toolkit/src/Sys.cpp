@@ -1,8 +1,37 @@
 #include "Sys.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <glad/glad.h>
+
 #ifdef WINDOWS
 #include "windows.h"
 #include "psapi.h"
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include <cstdio>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// Neither extension is in our GL loader, so we need their enums ourselves
+#ifndef GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX
+#define GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX 0x9047
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+#define GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
 #endif
 
 size_t System::GetMemoryUsageBytes() {
@@ -10,6 +39,25 @@ size_t System::GetMemoryUsageBytes() {
 	static PROCESS_MEMORY_COUNTERS pmc;
 	GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
 	return pmc.WorkingSetSize;
+	#elif defined(__APPLE__)
+	mach_task_basic_info info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+		return 0;
+	}
+	return info.resident_size;
+	#else
+	// The second field is the number of resident pages
+	size_t size = 0, resident = 0;
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (file == nullptr) {
+		return 0;
+	}
+	if (fscanf(file, "%zu %zu", &size, &resident) != 2) {
+		resident = 0;
+	}
+	fclose(file);
+	return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
 	#endif
 }
 
@@ -19,6 +67,23 @@ size_t System::GetPageUsageBytes()
 	static PROCESS_MEMORY_COUNTERS pmc;
 	GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
 	return pmc.QuotaPagedPoolUsage;
+	#elif defined(__APPLE__)
+	return 0;
+	#else
+	size_t result = 0;
+	FILE* file = fopen("/proc/self/status", "r");
+	if (file == nullptr) {
+		return 0;
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), file) != nullptr) {
+		if (strncmp(line, "VmSwap:", 7) == 0) {
+			result = strtoull(line + 7, nullptr, 10) * 1024;
+			break;
+		}
+	}
+	fclose(file);
+	return result;
 	#endif
 }
 
@@ -27,6 +92,15 @@ size_t System::GetPeakMemoryUsageBytes() {
 	static PROCESS_MEMORY_COUNTERS pmc;
 	GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
 	return pmc.PeakWorkingSetSize;
+	#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	// Linux gives the max resident size in kilobytes, macOS gives it in bytes
+	#ifdef __APPLE__
+	return static_cast<size_t>(usage.ru_maxrss);
+	#else
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+	#endif
 	#endif
 }
 
@@ -37,7 +111,7 @@ double System::GetCpuUsage()
 	FILETIME ftime, fsys, fuser;
 	unsigned __int64 now, sys, user;
 	double percent;
-	
+
 	GetSystemTimeAsFileTime(&ftime);
 	memcpy(&now, &ftime, sizeof(FILETIME));
 
@@ -51,13 +125,145 @@ double System::GetCpuUsage()
 	lastUserCPU = user;
 	lastSysCPU = sys;
 
+	return percent * 100.0;
+	#else
+	// Everything is kept in microseconds
+	timespec wall;
+	clock_gettime(CLOCK_MONOTONIC, &wall);
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	const unsigned long long now = wall.tv_sec * 1000000ull + wall.tv_nsec / 1000;
+	const unsigned long long user = usage.ru_utime.tv_sec * 1000000ull + usage.ru_utime.tv_usec;
+	const unsigned long long sys = usage.ru_stime.tv_sec * 1000000ull + usage.ru_stime.tv_usec;
+	if (now == lastCPU) {
+		return 0.0;
+	}
+	double percent = static_cast<double>(sys - lastSysCPU) + (user - lastUserCPU);
+	percent /= (now - lastCPU);
+	percent /= numProcessors;
+	lastCPU = now;
+	lastUserCPU = user;
+	lastSysCPU = sys;
+
 	return percent * 100.0;
 	#endif
 }
 
+// The native handle we need to read a thread's CPU time from another thread
+#ifdef WINDOWS
+typedef HANDLE NativeThread;
+#elif defined(__APPLE__)
+typedef mach_port_t NativeThread;
+#else
+typedef clockid_t NativeThread;
+#endif
+
+static NativeThread OpenCurrentThread() {
+	#ifdef WINDOWS
+	return OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, GetCurrentThreadId());
+	#elif defined(__APPLE__)
+	return mach_thread_self();
+	#else
+	clockid_t clock;
+	if (pthread_getcpuclockid(pthread_self(), &clock) != 0) {
+		return CLOCK_THREAD_CPUTIME_ID;
+	}
+	return clock;
+	#endif
+}
+
+static void CloseThread(NativeThread thread) {
+	#ifdef WINDOWS
+	CloseHandle(thread);
+	#elif defined(__APPLE__)
+	mach_port_deallocate(mach_task_self(), thread);
+	#endif
+}
+
+static double GetThreadSeconds(NativeThread thread) {
+	#ifdef WINDOWS
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(thread, &creation, &exit, &kernel, &user)) {
+		return 0.0;
+	}
+	unsigned long long kernelTime, userTime;
+	memcpy(&kernelTime, &kernel, sizeof(FILETIME));
+	memcpy(&userTime, &user, sizeof(FILETIME));
+	// File times are in 100 nanosecond ticks
+	return (kernelTime + userTime) / 10000000.0;
+	#elif defined(__APPLE__)
+	thread_basic_info_data_t info;
+	mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+	if (thread_info(thread, THREAD_BASIC_INFO, (thread_info_t)&info, &count) != KERN_SUCCESS) {
+		return 0.0;
+	}
+	return info.user_time.seconds + info.system_time.seconds + (info.user_time.microseconds + info.system_time.microseconds) / 1000000.0;
+	#else
+	timespec time;
+	if (clock_gettime(thread, &time) != 0) {
+		return 0.0;
+	}
+	return time.tv_sec + time.tv_nsec / 1000000000.0;
+	#endif
+}
+
+double System::GetThreadCpuSeconds() {
+	#ifdef WINDOWS
+	return GetThreadSeconds(GetCurrentThread());
+	#elif defined(__APPLE__)
+	NativeThread thread = mach_thread_self();
+	const double result = GetThreadSeconds(thread);
+	mach_port_deallocate(mach_task_self(), thread);
+	return result;
+	#else
+	return GetThreadSeconds(CLOCK_THREAD_CPUTIME_ID);
+	#endif
+}
+
+bool System::GetGpuMemory(size_t& totalBytes, size_t& availableBytes) {
+	// Looking through the extensions is slow, so we only do it once
+	enum class Source { Unknown, None, Nvidia, Amd };
+	static Source source = Source::Unknown;
+	if (source == Source::Unknown) {
+		source = Source::None;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint ix = 0; ix < count; ix++) {
+			const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, ix));
+			if (strcmp(name, "GL_NVX_gpu_memory_info") == 0) {
+				source = Source::Nvidia;
+				break;
+			}
+			if (strcmp(name, "GL_ATI_meminfo") == 0) {
+				source = Source::Amd;
+			}
+		}
+	}
+
+	// Both extensions report in kilobytes
+	if (source == Source::Nvidia) {
+		GLint total = 0, available = 0;
+		glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &total);
+		glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &available);
+		totalBytes = static_cast<size_t>(total) * 1024;
+		availableBytes = static_cast<size_t>(available) * 1024;
+		return true;
+	}
+	if (source == Source::Amd) {
+		// The first value is the total free memory in the pool, AMD doesn't tell us how much there is to begin with
+		GLint free[4] = { 0, 0, 0, 0 };
+		glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, free);
+		availableBytes = static_cast<size_t>(free[0]) * 1024;
+		totalBytes = 0;
+		return true;
+	}
+	return false;
+}
+
 void System::__Init() {
 	static bool isInit = false;
 	if (!isInit) {
+		#ifdef WINDOWS
 		SYSTEM_INFO sysInfo;
 		FILETIME ftime, fsys, fuser;
 
@@ -71,6 +277,17 @@ void System::__Init() {
 		GetProcessTimes(self, &ftime, &ftime, &fsys, &fuser);
 		memcpy(&lastSysCPU, &fsys, sizeof(FILETIME));
 		memcpy(&lastUserCPU, &fuser, sizeof(FILETIME));
+		#else
+		numProcessors = std::max(1, static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN)));
+		timespec wall;
+		clock_gettime(CLOCK_MONOTONIC, &wall);
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		lastCPU = wall.tv_sec * 1000000ull + wall.tv_nsec / 1000;
+		lastUserCPU = usage.ru_utime.tv_sec * 1000000ull + usage.ru_utime.tv_usec;
+		lastSysCPU = usage.ru_stime.tv_sec * 1000000ull + usage.ru_stime.tv_usec;
+		self = nullptr;
+		#endif
 
 		isInit = true;
 	}
@@ -81,3 +298,134 @@ void* System::self;
 unsigned long long System::lastUserCPU;
 unsigned long long System::lastSysCPU;
 unsigned long long System::lastCPU;
+
+// Everything the monitor shares between it's sampling thread and everyone else, guarded by monitorMutex
+namespace {
+	struct TrackedThread {
+		std::thread::id Id;
+		NativeThread    Handle;
+		double          LastSeconds;
+		SystemMonitor::ThreadHistory History;
+	};
+
+	std::mutex                 monitorMutex;
+	std::condition_variable    monitorWake;
+	std::thread                monitorThread;
+	bool                       monitorRunning = false;
+	double                     monitorInterval = 0.25;
+	int                        monitorCursor = 0;
+	float                      monitorMemory[SystemMonitor::HISTORY_SIZE];
+	float                      monitorCpu[SystemMonitor::HISTORY_SIZE];
+	float                      monitorGpuFree[SystemMonitor::HISTORY_SIZE];
+	float                      monitorPeakMemory = 0.0f;
+	// Written by the render thread, and pushed into the history on the next sample
+	std::atomic<float>         latestGpuFree(0.0f);
+	std::atomic<float>         latestGpuTotal(0.0f);
+	std::vector<TrackedThread> trackedThreads;
+}
+
+static void MonitorMain() {
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point last = Clock::now();
+	std::unique_lock<std::mutex> lock(monitorMutex);
+	while (monitorRunning) {
+		monitorWake.wait_for(lock, std::chrono::duration<double>(monitorInterval), []() { return !monitorRunning; });
+		if (!monitorRunning) {
+			break;
+		}
+		const Clock::time_point now = Clock::now();
+		const double elapsed = std::chrono::duration<double>(now - last).count();
+		last = now;
+
+		monitorMemory[monitorCursor] = static_cast<float>(System::GetMemoryUsageMB());
+		monitorCpu[monitorCursor] = static_cast<float>(System::GetCpuUsage());
+		monitorGpuFree[monitorCursor] = latestGpuFree.load();
+		monitorPeakMemory = static_cast<float>(System::GetPeakMemoryUsageMB());
+		for (TrackedThread& thread : trackedThreads) {
+			const double seconds = GetThreadSeconds(thread.Handle);
+			thread.History.Usage[monitorCursor] = elapsed > 0.0 ? static_cast<float>((seconds - thread.LastSeconds) / elapsed * 100.0) : 0.0f;
+			thread.LastSeconds = seconds;
+		}
+		monitorCursor = (monitorCursor + 1) % SystemMonitor::HISTORY_SIZE;
+	}
+}
+
+void SystemMonitor::Start(double interval) {
+	std::lock_guard<std::mutex> lock(monitorMutex);
+	if (monitorRunning) {
+		return;
+	}
+	monitorInterval = std::max(interval, 0.01);
+	monitorCursor = 0;
+	std::fill(monitorMemory, monitorMemory + HISTORY_SIZE, 0.0f);
+	std::fill(monitorCpu, monitorCpu + HISTORY_SIZE, 0.0f);
+	std::fill(monitorGpuFree, monitorGpuFree + HISTORY_SIZE, 0.0f);
+	// The first CPU reading is relative to the last call, so get that out of the way now
+	System::GetCpuUsage();
+	monitorRunning = true;
+	monitorThread = std::thread(&MonitorMain);
+}
+
+void SystemMonitor::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(monitorMutex);
+		if (!monitorRunning) {
+			return;
+		}
+		monitorRunning = false;
+	}
+	monitorWake.notify_all();
+	monitorThread.join();
+}
+
+void SystemMonitor::RegisterThread(const std::string& name) {
+	TrackedThread thread;
+	thread.Id = std::this_thread::get_id();
+	thread.Handle = OpenCurrentThread();
+	thread.LastSeconds = GetThreadSeconds(thread.Handle);
+	thread.History.Name = name;
+	std::fill(thread.History.Usage, thread.History.Usage + HISTORY_SIZE, 0.0f);
+	std::lock_guard<std::mutex> lock(monitorMutex);
+	trackedThreads.push_back(thread);
+}
+
+void SystemMonitor::UnregisterThread() {
+	std::lock_guard<std::mutex> lock(monitorMutex);
+	auto it = std::find_if(trackedThreads.begin(), trackedThreads.end(), [](const TrackedThread& thread) {
+		return thread.Id == std::this_thread::get_id();
+	});
+	if (it != trackedThreads.end()) {
+		CloseThread(it->Handle);
+		trackedThreads.erase(it);
+	}
+}
+
+void SystemMonitor::SampleGpu() {
+	// The query is cheap, but there's no point doing it more often than we sample everything else
+	typedef std::chrono::steady_clock Clock;
+	static Clock::time_point last;
+	const Clock::time_point now = Clock::now();
+	if (std::chrono::duration<double>(now - last).count() < monitorInterval) {
+		return;
+	}
+	last = now;
+	size_t total = 0, available = 0;
+	if (System::GetGpuMemory(total, available)) {
+		latestGpuTotal = total / (1024.0f * 1024.0f);
+		latestGpuFree = available / (1024.0f * 1024.0f);
+	}
+}
+
+void SystemMonitor::GetSnapshot(Snapshot& result) {
+	std::lock_guard<std::mutex> lock(monitorMutex);
+	result.Offset = monitorCursor;
+	std::copy(monitorMemory, monitorMemory + HISTORY_SIZE, result.MemoryMB);
+	std::copy(monitorCpu, monitorCpu + HISTORY_SIZE, result.CpuUsage);
+	std::copy(monitorGpuFree, monitorGpuFree + HISTORY_SIZE, result.GpuFreeMB);
+	result.PeakMemoryMB = monitorPeakMemory;
+	result.GpuTotalMB = latestGpuTotal.load();
+	result.Threads.resize(trackedThreads.size());
+	for (size_t ix = 0; ix < trackedThreads.size(); ix++) {
+		result.Threads[ix] = trackedThreads[ix].History;
+	}
+}
@@ -11,6 +11,8 @@
 //////////////////////////////////////////////////////////////////////////
 
 #include "TTK/FontRenderer.h"
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include "Logging.h"
 #include <GLM/gtc/matrix_transform.hpp>
@@ -53,18 +55,20 @@ char* readFile(const char* filename) {
 
 TTK::FontRenderer* TTK::FontRenderer::m_Instance = nullptr;
 
-TTK::TrueTypeTextureFont::TrueTypeTextureFont(const char* fileName, uint32_t size)
+TTK::TrueTypeTextureFont::TrueTypeTextureFont(const char* fileName, uint32_t size) :
+	myTexture(0),
+	m_TexHandle(0),
+	myGlyphTable(0),
+	m_GlyphTableHandle(0)
 {
 	myFontSize = size;
+	// Missing glyphs stay empty, so a font that fails to load draws nothing rather than reading garbage
+	myGlyphs.resize(CHAR_COUNT, GlyphInfo());
 
 	unsigned char* fontData = (unsigned char*)readFile(fileName);
-	uint8_t* atlasData = new uint8_t[static_cast<size_t>(ATLAS_WIDTH) * ATLAS_HEIGHT];
-
-	myCharInfo = new stbtt_packedchar[CHAR_COUNT];
 
-	if (!stbtt_InitFont(&myFontInfo, fontData, 0)) {
+	if (fontData == nullptr || !stbtt_InitFont(&myFontInfo, fontData, 0)) {
 		LOG_ERROR("Failed to initialize font");
-		delete[] atlasData;
 		delete[] fontData;
 		return;
 	}
@@ -75,33 +79,61 @@ TTK::TrueTypeTextureFont::TrueTypeTextureFont(const char* fileName, uint32_t siz
 	myPixelHeightScale = stbtt_ScaleForPixelHeight(&myFontInfo, static_cast<float>(size));
 	myEmToPixel = stbtt_ScaleForMappingEmToPixels(&myFontInfo, 1.0f);
 
-	stbtt_pack_context context;
-	if (!stbtt_PackBegin(&context, atlasData, ATLAS_WIDTH, ATLAS_HEIGHT, 0, 1, nullptr)) {
-		LOG_ERROR("Failed to pack font texture");
-		delete[] atlasData;
-		delete[] fontData;
-		return;
-	}
+	// The glyphs are baked at SDF_SIZE, and their bounds scaled to the size the font was asked for
+	const float sdfScale = stbtt_ScaleForPixelHeight(&myFontInfo, static_cast<float>(SDF_SIZE));
+	const float toFontSize = static_cast<float>(size) / static_cast<float>(SDF_SIZE);
+	// The edge sits at 128, and the distance falls off to 0 or 255 over the padding
+	const unsigned char onEdge = 128;
+	const float distanceScale = static_cast<float>(onEdge) / static_cast<float>(SDF_PADDING);
 
-	stbtt_PackSetOversampling(&context, FONT_OVERSAMPLE_X, FONT_OVERSAMPLE_Y);
-	if (!stbtt_PackFontRange(&context, fontData, 0, static_cast<float>(size), FIRST_CHAR, CHAR_COUNT, myCharInfo)) {
-		LOG_ERROR("Failed to pack font range");
-		delete[] atlasData;
-		delete[] fontData;
-		return;
-	}
-	stbtt_PackEnd(&context);
+	uint8_t* atlasData = new uint8_t[static_cast<size_t>(ATLAS_WIDTH) * ATLAS_HEIGHT];
+	memset(atlasData, 0, static_cast<size_t>(ATLAS_WIDTH) * ATLAS_HEIGHT);
+
+	// The glyphs are packed into rows, left to right, with a pixel between them so they don't bleed into each other
+	uint32_t rowX = 1, rowY = 1, rowHeight = 0;
+	for (uint32_t ix = 0; ix < CHAR_COUNT; ix++) {
+		GlyphInfo& glyph = myGlyphs[ix];
+		int advance, bearing;
+		stbtt_GetCodepointHMetrics(&myFontInfo, FIRST_CHAR + ix, &advance, &bearing);
+		glyph.Advance = advance * myPixelHeightScale;
+
+		int width, height, xOff, yOff;
+		unsigned char* sdf = stbtt_GetCodepointSDF(&myFontInfo, sdfScale, FIRST_CHAR + ix, SDF_PADDING, onEdge, distanceScale, &width, &height, &xOff, &yOff);
+		// Glyphs with no outline (ex: space) only move the pen
+		if (sdf == nullptr) {
+			continue;
+		}
+		if (rowX + width + 1 > ATLAS_WIDTH) {
+			rowX = 1;
+			rowY += rowHeight + 1;
+			rowHeight = 0;
+		}
+		if (rowY + height + 1 > ATLAS_HEIGHT) {
+			LOG_ERROR("Font atlas is full, glyphs from '{}' on will be missing", static_cast<char>(FIRST_CHAR + ix));
+			stbtt_FreeSDF(sdf, nullptr);
+			break;
+		}
+		for (int row = 0; row < height; row++) {
+			memcpy(atlasData + (rowY + row) * ATLAS_WIDTH + rowX, sdf + row * width, width);
+		}
+		stbtt_FreeSDF(sdf, nullptr);
 
-	for (uint32_t ix = FIRST_CHAR; ix < FIRST_CHAR + CHAR_COUNT; ix++) {
-		// TODO: Grab glyph data
+		glyph.Min = glm::vec2(xOff, yOff) * toFontSize;
+		glyph.Max = glm::vec2(xOff + width, yOff + height) * toFontSize;
+		glyph.UVMin = { rowX / static_cast<float>(ATLAS_WIDTH), rowY / static_cast<float>(ATLAS_HEIGHT) };
+		glyph.UVMax = { (rowX + width) / static_cast<float>(ATLAS_WIDTH), (rowY + height) / static_cast<float>(ATLAS_HEIGHT) };
+
+		rowX += width + 1;
+		rowHeight = std::max(rowHeight, static_cast<uint32_t>(height));
 	}
 
-	// Create and upload the texture to store our font in
+	// Create and upload the texture to store our font in. The distances are filtered, so plain bilinear keeps the
+	// edges smooth without needing any mips
 	LOG_ASSERT(glGetError() == GL_NONE, "Some error has occured!");
 	glCreateTextures(GL_TEXTURE_2D, 1, &myTexture);
 	glTextureParameteri(myTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTextureParameteri(myTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTextureParameteri(myTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	glTextureParameteri(myTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTextureParameteri(myTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	LOG_ASSERT(glGetError() == GL_NONE, "Some error has occured!");
 	glTextureStorage2D(myTexture, 1, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT);
@@ -111,38 +143,35 @@ TTK::TrueTypeTextureFont::TrueTypeTextureFont(const char* fileName, uint32_t siz
 	m_TexHandle = glGetTextureHandleARB(myTexture);
 	glMakeTextureHandleResidentARB(m_TexHandle);
 
+	// The glyph table is read with texelFetch, so it never gets filtered
+	std::vector<glm::vec4> table(CHAR_COUNT * 2);
+	for (uint32_t ix = 0; ix < CHAR_COUNT; ix++) {
+		table[ix * 2 + 0] = glm::vec4(myGlyphs[ix].Min, myGlyphs[ix].Max);
+		table[ix * 2 + 1] = glm::vec4(myGlyphs[ix].UVMin, myGlyphs[ix].UVMax);
+	}
+	glCreateTextures(GL_TEXTURE_1D, 1, &myGlyphTable);
+	glTextureParameteri(myGlyphTable, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(myGlyphTable, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureStorage1D(myGlyphTable, 1, GL_RGBA32F, static_cast<GLsizei>(table.size()));
+	glTextureSubImage1D(myGlyphTable, 0, 0, static_cast<GLsizei>(table.size()), GL_RGBA, GL_FLOAT, table.data());
+	m_GlyphTableHandle = glGetTextureHandleARB(myGlyphTable);
+	glMakeTextureHandleResidentARB(m_GlyphTableHandle);
+
 	delete[] atlasData;
 	delete[] fontData;
 }
 
 TTK::TrueTypeTextureFont::~TrueTypeTextureFont()
 {
-	delete[] myCharInfo;
 	glDeleteTextures(1, &myTexture);
+	glDeleteTextures(1, &myGlyphTable);
 }
 
-TTK::GlyphInfo TTK::TrueTypeTextureFont::GetGlyph(int codePoint, float offsetX, float offsetY) const {
-	stbtt_aligned_quad quad;
-
-	stbtt_GetPackedQuad(myCharInfo, ATLAS_WIDTH, ATLAS_HEIGHT, codePoint - FIRST_CHAR, &offsetX, &offsetY, &quad, 1);
-	auto xmin = quad.x0;
-	auto xmax = quad.x1;
-	auto ymin = -quad.y1;
-	auto ymax = -quad.y0;
-
-	GlyphInfo info = GlyphInfo();
-	info.OffsetX = offsetX;
-	info.OffsetY = offsetY;
-	info.Positions[0] = { xmax, -ymin };
-	info.Positions[1] = { xmax, -ymax };
-	info.Positions[2] = { xmin, -ymax };
-	info.Positions[3] = { xmin, -ymin };
-	info.UVs[0] = { quad.s1, quad.t1 };
-	info.UVs[1] = { quad.s1, quad.t0 };
-	info.UVs[2] = { quad.s0, quad.t0 };
-	info.UVs[3] = { quad.s0, quad.t1 };
-
-	return info;
+uint32_t TTK::TrueTypeTextureFont::GetGlyphIndex(int codePoint) const {
+	if (codePoint < static_cast<int>(FIRST_CHAR) || codePoint >= static_cast<int>(FIRST_CHAR + CHAR_COUNT)) {
+		return 0;
+	}
+	return static_cast<uint32_t>(codePoint) - FIRST_CHAR;
 }
 
 float TTK::TrueTypeTextureFont::GetKerning(int char1, int char2) const {
@@ -154,65 +183,150 @@ float TTK::TrueTypeTextureFont::GetLineHeight() const {
 }
 
 glm::vec2 TTK::TrueTypeTextureFont::MeausureString(const char* text, const float scale) {
-	float multiplier = scale;
-
-	glm::vec2 originPos = glm::vec2();
-
-	GlyphInfo glyph;
-
 	size_t length = strlen(text);
 	float xOff{ 0 }, yOff{ 0 };
-	float lineHeight = 0.0f;
-	float maxWidth = 0.0f;
-	float totalHeight = 0.0f;
 
 	for (size_t i = 0; i < length; i++) {
-		glyph = GetGlyph(text[i], xOff, yOff);
-		xOff = glyph.OffsetX;
-		yOff = glyph.OffsetY;
-
-		lineHeight = glm::max(lineHeight, -glyph.Positions[1].y);
-		maxWidth = glm::max(maxWidth, xOff);
-
 		if (text[i] == '\n')
 		{
-			yOff += GetLineHeight() * multiplier;
-			totalHeight += lineHeight;
-			lineHeight = 0.0f;
+			yOff += GetLineHeight();
 			xOff = 0;
 		}
 		else if (text[i] == '\r') {
 			xOff = 0;
 		}
 		else if (text[i] == '\t') {
-			float xOffTemp{ 0 }, yOffTemp{ 0 };
-			glyph = GetGlyph(' ', xOffTemp, yOffTemp);
-			xOff += glyph.OffsetX * 4;
+			xOff += GetGlyph(' ').Advance * 4;
+		}
+		else {
+			xOff += GetGlyph(text[i]).Advance;
 		}
 	}
-	GlyphInfo space = GetGlyph('|', xOff, yOff);
-	yOff += -(space.Positions[1].y - space.Positions[0].y);
-	return glm::vec2(xOff, yOff);
+	const GlyphInfo& bar = GetGlyph('|');
+	yOff += bar.Max.y - bar.Min.y;
+	return glm::vec2(xOff, yOff) * scale;
 }
 
+TTK::TextHandle::TextHandle(const TrueTypeTextureFont& font, const std::string& text, const glm::vec2& position, const glm::vec4& color, float scale) :
+	m_Font(&font),
+	m_Text(text),
+	m_Position(position),
+	m_Color(color),
+	m_Scale(scale),
+	m_Dirty(true)
+{ }
+
+void TTK::TextHandle::SetText(const std::string& text) {
+	if (text != m_Text) {
+		m_Text = text;
+		m_Dirty = true;
+	}
+}
+
+void TTK::TextHandle::SetColor(const glm::vec4& color) {
+	if (color != m_Color) {
+		m_Color = color;
+		m_Dirty = true;
+	}
+}
+
+void TTK::TextHandle::SetScale(float scale) {
+	if (scale != m_Scale) {
+		m_Scale = scale;
+		m_Dirty = true;
+	}
+}
+
+// The fewest glyphs the buffer will hold in each segment, so we don't grow a few at a time at startup
+static const size_t MinGlyphCapacity = 4096;
+
 TTK::FontRenderer::~FontRenderer()
 {
-	glDeleteShader(m_ShaderHandle);
+	for (GLsync fence : m_Fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+		}
+	}
+	glDeleteProgram(m_ShaderHandle);
+	glDeleteBuffers(1, &m_VBO);
 	glDeleteVertexArrays(1, &m_VAO);
 }
 
 void TTK::FontRenderer::Render(const TrueTypeTextureFont& font, const char* text, const glm::vec2& pos, const glm::vec4& color, float scale)
 {
-	size_t length = strlen(text);
-	
-	float multiplier = scale;
+	Batch& batch = __GetBatch(font);
+	const size_t before = m_Glyphs.size();
+	BuildGlyphs(font, text, pos, color, scale, m_Glyphs);
+	batch.Count += m_Glyphs.size() - before;
+}
 
-	// The number of quads ACTUALLY drawn Shit-For-Brains
-	int quads = 0;
+void TTK::FontRenderer::Render(TextHandle& text)
+{
+	if (text.m_Dirty) {
+		text.m_Glyphs.clear();
+		BuildGlyphs(*text.m_Font, text.m_Text.c_str(), glm::vec2(0.0f), text.m_Color, text.m_Scale, text.m_Glyphs);
+		text.m_Dirty = false;
+	}
+	Batch& batch = __GetBatch(*text.m_Font);
+	for (GlyphInstance glyph : text.m_Glyphs) {
+		glyph.Position += text.m_Position;
+		m_Glyphs.push_back(glyph);
+	}
+	batch.Count += text.m_Glyphs.size();
+}
 
-	glm::vec2 originPos = glm::vec2(pos.x, pos.y);
+void TTK::FontRenderer::Flush()
+{
+	const size_t glyphs = m_Glyphs.size();
+	if (glyphs == 0) {
+		m_Batches.clear();
+		return;
+	}
+	if (glyphs > m_GlyphCapacity) {
+		__Grow(glyphs);
+	}
 
-	static GlyphInfo glyph;
+	// The segment was last drawn a couple of flushes ago, so this should rarely have to wait
+	GLsync& fence = m_Fences[m_Segment];
+	if (fence != nullptr) {
+		if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX) == GL_WAIT_FAILED) {
+			LOG_WARN("Failed to wait on the text buffer, it may be overwritten while it's being drawn");
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	std::copy(m_Glyphs.begin(), m_Glyphs.end(), m_Mapped + m_Segment * m_GlyphCapacity);
+
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+	glm::mat4 proj = TTK::Context::Instance().GetOrthoProjection();
+	glUseProgram(m_ShaderHandle);
+	glProgramUniformMatrix4fv(m_ShaderHandle, 0, 1, false, &proj[0][0]);
+	glBindVertexArray(m_VAO);
+	// Each glyph is one instance of a four corner strip, the base instance picks out the segment and the batch
+	const size_t segmentBase = m_Segment * m_GlyphCapacity;
+	for (const Batch& batch : m_Batches) {
+		if (batch.Count == 0) {
+			continue;
+		}
+		glProgramUniformHandleui64ARB(m_ShaderHandle, 1, batch.Font->m_TexHandle);
+		glProgramUniformHandleui64ARB(m_ShaderHandle, 2, batch.Font->m_GlyphTableHandle);
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(batch.Count), static_cast<GLuint>(segmentBase + batch.First));
+	}
+	glBindVertexArray(0);
+	glDisable(GL_BLEND);
+	glDepthMask(GL_TRUE);
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_Segment = (m_Segment + 1) % SegmentCount;
+	m_Glyphs.clear();
+	m_Batches.clear();
+}
+
+void TTK::FontRenderer::BuildGlyphs(const TrueTypeTextureFont& font, const char* text, const glm::vec2& origin, const glm::vec4& color, float scale, std::vector<GlyphInstance>& glyphs)
+{
+	size_t length = strlen(text);
 
 	Col8 gpuCol;
 	gpuCol.R = static_cast<char>(color.r * 255);
@@ -220,121 +334,108 @@ void TTK::FontRenderer::Render(const TrueTypeTextureFont& font, const char* text
 	gpuCol.B = static_cast<char>(color.b * 255);
 	gpuCol.A = static_cast<char>(color.a * 255);
 
+	// The pen moves in the font's pixels, and gets scaled when it's placed
 	float xOff{ 0 }, yOff{ 0 };
 
-	for (int i = 0; i < length; i++) {
-		glyph = font.GetGlyph(text[i], xOff, yOff);
-		xOff = glyph.OffsetX;
-		yOff = glyph.OffsetY;
-
+	for (size_t i = 0; i < length; i++) {
 		if (text[i] == '\n')
 		{
-			yOff += font.GetLineHeight() * multiplier;
+			yOff += font.GetLineHeight();
 			xOff = 0;
 		}
 		else if (text[i] == '\r') {
 			xOff = 0;
 		}
 		else if (text[i] == '\t') {
-			float xOffTemp{ 0 }, yOffTemp{ 0 };
-			glyph = font.GetGlyph(' ', xOffTemp, yOffTemp);
-			xOff += glyph.OffsetX * 4;
+			xOff += font.GetGlyph(' ').Advance * 4;
 		}
 		else {
-			m_MeshData[quads * 4 + 0].Position = originPos + glyph.Positions[0] * multiplier;
-			m_MeshData[quads * 4 + 0].UV = glyph.UVs[0];
-			m_MeshData[quads * 4 + 0].Color = gpuCol;
-
-			m_MeshData[quads * 4 + 1].Position = originPos + glyph.Positions[1] * multiplier;
-			m_MeshData[quads * 4 + 1].UV = glyph.UVs[1];
-			m_MeshData[quads * 4 + 1].Color = gpuCol;
-
-			m_MeshData[quads * 4 + 2].Position = originPos + glyph.Positions[2] * multiplier;
-			m_MeshData[quads * 4 + 2].UV = glyph.UVs[2];
-			m_MeshData[quads * 4 + 2].Color = gpuCol;
-
-			m_MeshData[quads * 4 + 3].Position = originPos + glyph.Positions[3] * multiplier;
-			m_MeshData[quads * 4 + 3].UV = glyph.UVs[3];
-			m_MeshData[quads * 4 + 3].Color = gpuCol;
-
-
-			m_IndexData[quads * 6 + 0] = quads * 4 + 0;
-			m_IndexData[quads * 6 + 1] = quads * 4 + 1;
-			m_IndexData[quads * 6 + 2] = quads * 4 + 2;
-
-			m_IndexData[quads * 6 + 3] = quads * 4 + 0;
-			m_IndexData[quads * 6 + 4] = quads * 4 + 2;
-			m_IndexData[quads * 6 + 5] = quads * 4 + 3;
-
-			quads++;
+			const uint32_t index = font.GetGlyphIndex(text[i]);
+			const GlyphInfo& glyph = font.myGlyphs[index];
+			// Glyphs with nothing to draw (ex: spaces) only move the pen
+			if (glyph.Max.x > glyph.Min.x) {
+				glyphs.push_back({ origin + glm::vec2(xOff, yOff) * scale, scale, index, gpuCol });
+			}
+			xOff += glyph.Advance;
 		}
 	}
+}
 
-	length = quads;
+TTK::FontRenderer::Batch& TTK::FontRenderer::__GetBatch(const TrueTypeTextureFont& font)
+{
+	if (m_Batches.empty() || m_Batches.back().Font != &font) {
+		m_Batches.push_back({ &font, m_Glyphs.size(), 0 });
+	}
+	return m_Batches.back();
+}
 
-	// Update and render our meshes
-	bool blendState = glIsEnabled(GL_BLEND);
-	GLboolean depthMaskEnabled = false;
-	glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMaskEnabled);
-	glDepthMask(GL_FALSE);
-	glEnable(GL_BLEND);
-	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
-	glGetError();
-	glm::mat4 proj = TTK::Context::Instance().GetOrthoProjection();
-	glUseProgram(m_ShaderHandle);
-	glProgramUniformMatrix4fv(m_ShaderHandle, 0, 1, false, &proj[0][0]);
-	glProgramUniformHandleui64ARB(m_ShaderHandle, 1, font.m_TexHandle);	
-	glBindVertexArray(m_VAO);
-	glNamedBufferSubData(m_VBO, 0, length * 4 * sizeof(Vert), m_MeshData);
-	glNamedBufferSubData(m_EBO, 0, length * 6 * sizeof(GLuint), m_IndexData);
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(length * 6), GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
-	LOG_ASSERT(glGetError() == GL_NONE, "Failed to draw our text mesh!");
-	if (!blendState) glDisable(GL_BLEND);
-	glDepthMask(depthMaskEnabled);
+void TTK::FontRenderer::__Grow(size_t glyphs)
+{
+	// The driver keeps the old buffer around until the GPU is done with it, so it's fences don't matter any more
+	for (GLsync& fence : m_Fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	glDeleteBuffers(1, &m_VBO);
+	m_GlyphCapacity = std::max({ glyphs + glyphs / 2, m_GlyphCapacity * 2, MinGlyphCapacity });
+	m_Segment = 0;
+
+	const GLsizeiptr size = static_cast<GLsizeiptr>(sizeof(GlyphInstance) * m_GlyphCapacity * SegmentCount);
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &m_VBO);
+	glNamedBufferStorage(m_VBO, size, nullptr, flags);
+	m_Mapped = static_cast<GlyphInstance*>(glMapNamedBufferRange(m_VBO, 0, size, flags));
+	LOG_ASSERT(m_Mapped != nullptr, "Failed to map the text buffer!");
+
+	glVertexArrayVertexBuffer(m_VAO, 0, m_VBO, 0, sizeof(GlyphInstance));
 }
 
-TTK::FontRenderer::FontRenderer() {
+TTK::FontRenderer::FontRenderer() :
+	m_VBO(0),
+	m_Mapped(nullptr),
+	m_GlyphCapacity(0),
+	m_Segment(0)
+{
 	LOG_INFO("Initializing font renderer");
+	std::fill(m_Fences, m_Fences + SegmentCount, nullptr);
 
-	memset(m_MeshData, 0, sizeof(m_MeshData));
-	memset(m_IndexData, 0, sizeof(m_IndexData));
-
+	// The buffer gets made on the first flush, once we know how much room we need. Every attribute is per glyph, the
+	// corners come from gl_VertexID
 	glCreateVertexArrays(1, &m_VAO);
-	glBindVertexArray(m_VAO);
-	GLuint buffers[2];
-	glCreateBuffers(2, buffers);
-	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
-	glNamedBufferData(buffers[0], 256 * 4 * sizeof(Vert), m_MeshData, GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
-	glNamedBufferData(buffers[1], 256 * 6 * sizeof(GLuint), m_IndexData, GL_DYNAMIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-	#pragma warning(push)
-	#pragma warning(disable: 6011)
-	Vert* v = nullptr;
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vert), &v->Position);
-	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, false, sizeof(Vert), &v->Color);
-	glVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(Vert), &v->UV);
-	#pragma warning(pop)
-	
-	glBindVertexArray(0);
-
-	m_VBO = buffers[0];
-	m_EBO = buffers[1];
+	glEnableVertexArrayAttrib(m_VAO, 0);
+	glEnableVertexArrayAttrib(m_VAO, 1);
+	glEnableVertexArrayAttrib(m_VAO, 2);
+	glEnableVertexArrayAttrib(m_VAO, 3);
+	glVertexArrayAttribFormat(m_VAO, 0, 2, GL_FLOAT, false, offsetof(GlyphInstance, Position));
+	glVertexArrayAttribFormat(m_VAO, 1, 1, GL_FLOAT, false, offsetof(GlyphInstance, Scale));
+	glVertexArrayAttribIFormat(m_VAO, 2, 1, GL_UNSIGNED_INT, offsetof(GlyphInstance, Glyph));
+	glVertexArrayAttribFormat(m_VAO, 3, 4, GL_UNSIGNED_BYTE, true, offsetof(GlyphInstance, Color));
+	for (GLuint attrib = 0; attrib < 4; attrib++) {
+		glVertexArrayAttribBinding(m_VAO, attrib, 0);
+	}
+	glVertexArrayBindingDivisor(m_VAO, 0, 1);
 
 	const char* vsSource = R"LIT(#version 430
-            layout (location = 0) in vec2 vertexPosition;
-            layout (location = 1) in vec4 vertexColor;
-            layout (location = 2) in vec2 vertexTexture;	
+			#extension GL_ARB_bindless_texture : enable
+            layout (location = 0) in vec2 glyphPosition;
+            layout (location = 1) in float glyphScale;
+            layout (location = 2) in uint glyphIndex;
+            layout (location = 3) in vec4 glyphColor;
             layout (location = 0) out vec4 fragmentColor;
             layout (location = 1) out vec2 fragmentTexture;
-            layout (location = 0) uniform mat4 xTransform;	
+            layout (location = 0) uniform mat4 xTransform;
+            // Two texels per glyph, it's bounds relative to the pen then it's rect in the atlas
+            layout (bindless_sampler, location = 2) uniform sampler1D xGlyphs;
             void main() {
-                gl_Position = xTransform * vec4(vertexPosition, 0, 1);
-                fragmentColor = vertexColor;
-                fragmentTexture = vertexTexture;
+                vec4 bounds = texelFetch(xGlyphs, int(glyphIndex) * 2, 0);
+                vec4 rect = texelFetch(xGlyphs, int(glyphIndex) * 2 + 1, 0);
+                // The strip's corners go (0, 0), (1, 0), (0, 1), (1, 1)
+                vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+                gl_Position = xTransform * vec4(glyphPosition + mix(bounds.xy, bounds.zw, corner) * glyphScale, 0, 1);
+                fragmentColor = glyphColor;
+                fragmentTexture = mix(rect.xy, rect.zw, corner);
             })LIT";
 
 	const char* fsSource = R"LIT(#version 430
@@ -344,8 +445,11 @@ TTK::FontRenderer::FontRenderer() {
             layout (location = 1) in vec2 fragUv;            	
             out vec4 frag_color;            	
             void main() {
+                // The edge is at 0.5, and the ramp across it is kept to about a pixel wide at any scale
+                float dist = texture(xSampler, fragUv).r;
+                float width = max(fwidth(dist) * 0.5, 0.0001);
                 frag_color = fragColor;
-				frag_color.a = texture2D(xSampler, fragUv).r;
+                frag_color.a *= smoothstep(0.5 - width, 0.5 + width, dist);
             })LIT";
 
 	m_ShaderHandle = glCreateProgram();
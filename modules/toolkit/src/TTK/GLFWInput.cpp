@@ -2,74 +2,182 @@
 #include "GLFW/glfw3.h"
 #include "Logging.h"
 
-struct NativeWindowProxy {
-	void* spacer0;
-	int   spacer1[6];
-	void* userPointer;
-	GLFWvidmode videoMode;
-	void* spacer2[2];
-	int   spacer3[10];
-	char  mouseButtons[GLFW_MOUSE_BUTTON_LAST + 1];
-	char  keys[GLFW_KEY_LAST + 1];
-};
-
-GLFWscrollfun g_PrevScrollCallback = nullptr;
-glm::dvec2    g_CurrentMouseScroll = glm::dvec2(0.0);
-glm::dvec2    g_CurrentMouseScrollDelta = glm::dvec2(0.0);
-
-void __HandleMouseScroll(GLFWwindow* window, double xDiff, double yDiff) {
-	g_CurrentMouseScrollDelta.x += xDiff;
-	g_CurrentMouseScrollDelta.y += yDiff;
-	g_CurrentMouseScroll.x += xDiff;
-	g_CurrentMouseScroll.y += yDiff;
-
-	// Callback chaining
-	if (g_PrevScrollCallback)
-		g_PrevScrollCallback(window, xDiff, yDiff);
+// GLFW callbacks are plain functions, so they need to find their way back to our instance
+TTK::GlfwInput* g_Instance = nullptr;
+
+// The callbacks that were installed before ours (ex: ImGui's), which we pass every event on to
+GLFWkeyfun         g_PrevKeyCallback = nullptr;
+GLFWmousebuttonfun g_PrevMouseButtonCallback = nullptr;
+GLFWcursorposfun   g_PrevCursorCallback = nullptr;
+GLFWscrollfun      g_PrevScrollCallback = nullptr;
+
+// Works out a button's new state from it's old one and one event
+static TTK::ButtonState __ApplyEvent(TTK::ButtonState state, bool isDown) {
+	if (isDown) {
+		return (*state & *TTK::ButtonState::Pressed) ? state : TTK::ButtonState::Pressed;
+	}
+	return (*state & *TTK::ButtonState::Pressed) ? TTK::ButtonState::Released : state;
 }
 
-TTK::GlfwInput::GlfwInput() : TTK::Input() {
-	memset(m_PrevKeys, 0, sizeof(m_PrevKeys));
-	memset(m_PrevMouse, 0, sizeof(m_PrevMouse));
+// Moves a button's state on by a frame, Pressed becomes Down and Released becomes Up
+static TTK::ButtonState __Settle(TTK::ButtonState state) {
+	if (state == TTK::ButtonState::Pressed) return TTK::ButtonState::Down;
+	if (state == TTK::ButtonState::Released) return TTK::ButtonState::Up;
+	return state;
 }
 
-TTK::GlfwInput::~GlfwInput() = default;
+TTK::GlfwInput::GlfwInput() : TTK::Input(), m_Window(nullptr), m_DroppedEvents(0) {
+	std::fill(std::begin(m_Keys), std::end(m_Keys), ButtonState::Up);
+	std::fill(std::begin(m_Mouse), std::end(m_Mouse), ButtonState::Up);
+	m_MousePos = m_MouseScroll = m_MouseScrollDelta = glm::vec2(0.0f);
+}
+
+TTK::GlfwInput::~GlfwInput() {
+	if (m_Window != nullptr) {
+		glfwSetKeyCallback(m_Window, g_PrevKeyCallback);
+		glfwSetMouseButtonCallback(m_Window, g_PrevMouseButtonCallback);
+		glfwSetCursorPosCallback(m_Window, g_PrevCursorCallback);
+		glfwSetScrollCallback(m_Window, g_PrevScrollCallback);
+	}
+	if (g_Instance == this) {
+		g_Instance = nullptr;
+	}
+}
 
 TTK::ButtonState TTK::GlfwInput::__GetKeyState(KeyCode key) {
-	return (TTK::ButtonState)(!!glfwGetKey(m_Window, (size_t)key) | (!!m_PrevKeys[(size_t)key] << 1));
+	return m_Keys[(size_t)key];
 }
 
 TTK::ButtonState TTK::GlfwInput::__GetMouseState(MouseButton button) {
-	return (TTK::ButtonState)(!!glfwGetMouseButton(m_Window, *button) | (!!m_PrevMouse[*button] << 1));
+	return m_Mouse[*button];
 }
 
 glm::vec2 TTK::GlfwInput::__GetMousePos() {
-	glm::dvec2 pos;
-	glfwGetCursorPos(m_Window, &pos.x, &pos.y);
-	return pos;
+	return m_MousePos;
 }
 
 glm::vec2 TTK::GlfwInput::__GetMouseScroll() {
-	return g_CurrentMouseScroll;
+	return m_MouseScroll;
 }
 
 glm::vec2 TTK::GlfwInput::__GetMouseScrollDelta() {
-	return g_CurrentMouseScrollDelta;
+	return m_MouseScrollDelta;
 }
 
 void TTK::GlfwInput::__Poll() {
-	NativeWindowProxy* proxy = (NativeWindowProxy*)m_Window;
-	// Copy our mouse state and key state from our GLFW window proxy struct
-	memcpy(m_PrevKeys, proxy->keys, sizeof(m_PrevKeys));
-	memcpy(m_PrevMouse, proxy->mouseButtons, sizeof(m_PrevMouse));
-	// Reset the scroll wheel delta
-	g_CurrentMouseScrollDelta = { 0, 0 };
-	// We will assume that glfwPollEvents has been called
+	// Last frame's edges become steady states, then we apply everything that has happened since
+	for (ButtonState& state : m_Keys) {
+		state = __Settle(state);
+	}
+	for (ButtonState& state : m_Mouse) {
+		state = __Settle(state);
+	}
+	m_MouseScrollDelta = glm::vec2(0.0f);
+
+	// Releases held over from last frame go first, see below
+	std::vector<InputEvent> deferred;
+	deferred.swap(m_Deferred);
+	for (const InputEvent& event : deferred) {
+		ButtonState& state = event.EventType == InputEvent::Type::Key ? m_Keys[event.Code] : m_Mouse[event.Code];
+		state = __ApplyEvent(state, false);
+	}
+
+	// While replaying, the real devices are drained and ignored, and the injected events take their place
+	std::vector<InputEvent> injected;
+	injected.swap(m_Injected);
+	InputEvent event;
+	size_t injectedIx = 0;
+	while (true) {
+		if (m_IsReplaying) {
+			while (m_Events.Pop(event)) {}
+			if (injectedIx >= injected.size())
+				break;
+			event = injected[injectedIx++];
+		} else if (!m_Events.Pop(event)) {
+			break;
+		}
+		if (m_Listener)
+			m_Listener(event);
+
+		switch (event.EventType) {
+		case InputEvent::Type::Key:
+		case InputEvent::Type::MouseButton:
+		{
+			ButtonState& state = event.EventType == InputEvent::Type::Key ? m_Keys[event.Code] : m_Mouse[event.Code];
+			// A button that was pressed and released since the last poll would never be seen as pressed, so the
+			// release waits for the next poll. Quick taps still show up for a frame that way
+			if (!event.IsDown && state == ButtonState::Pressed) {
+				m_Deferred.push_back(event);
+			} else {
+				state = __ApplyEvent(state, event.IsDown);
+			}
+			break;
+		}
+		case InputEvent::Type::MouseMove:
+			m_MousePos = event.Value;
+			break;
+		case InputEvent::Type::Scroll:
+			m_MouseScroll += event.Value;
+			m_MouseScrollDelta += event.Value;
+			break;
+		}
+	}
+
+	const uint32_t dropped = m_DroppedEvents.exchange(0);
+	if (dropped > 0) {
+		LOG_WARN("Input queue overflowed, dropped {} events", dropped);
+	}
 }
+
 void TTK::GlfwInput::__Init(void* windowPtr) {
 	m_Window = (GLFWwindow*)windowPtr;
-	memset(m_PrevKeys, 0, sizeof(m_PrevKeys));
-	memset(m_PrevMouse, 0, sizeof(m_PrevMouse));
+	g_Instance = this;
+
+	double x, y;
+	glfwGetCursorPos(m_Window, &x, &y);
+	m_MousePos = glm::vec2(x, y);
 
+	g_PrevKeyCallback = glfwSetKeyCallback(m_Window, __HandleKey);
+	g_PrevMouseButtonCallback = glfwSetMouseButtonCallback(m_Window, __HandleMouseButton);
+	g_PrevCursorCallback = glfwSetCursorPosCallback(m_Window, __HandleMouseMove);
 	g_PrevScrollCallback = glfwSetScrollCallback(m_Window, __HandleMouseScroll);
 }
+
+void TTK::GlfwInput::__Push(const InputEvent& event) {
+	if (!m_Events.Push(event)) {
+		m_DroppedEvents++;
+	}
+}
+
+void TTK::GlfwInput::__HandleKey(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	// Repeats don't change whether the key is down, and unknown keys (-1) have nowhere to go
+	if (g_Instance != nullptr && action != GLFW_REPEAT && key >= 0 && key <= (int)TTK_KEY_LAST) {
+		g_Instance->__Push({ InputEvent::Type::Key, (uint16_t)key, action == GLFW_PRESS, glm::vec2(0.0f) });
+	}
+	if (g_PrevKeyCallback)
+		g_PrevKeyCallback(window, key, scancode, action, mods);
+}
+
+void TTK::GlfwInput::__HandleMouseButton(GLFWwindow* window, int button, int action, int mods) {
+	if (g_Instance != nullptr && button >= 0 && button <= *TTK_MOUSEBUTTON_LAST) {
+		g_Instance->__Push({ InputEvent::Type::MouseButton, (uint16_t)button, action == GLFW_PRESS, glm::vec2(0.0f) });
+	}
+	if (g_PrevMouseButtonCallback)
+		g_PrevMouseButtonCallback(window, button, action, mods);
+}
+
+void TTK::GlfwInput::__HandleMouseMove(GLFWwindow* window, double x, double y) {
+	if (g_Instance != nullptr) {
+		g_Instance->__Push({ InputEvent::Type::MouseMove, 0, false, glm::vec2(x, y) });
+	}
+	if (g_PrevCursorCallback)
+		g_PrevCursorCallback(window, x, y);
+}
+
+void TTK::GlfwInput::__HandleMouseScroll(GLFWwindow* window, double xDiff, double yDiff) {
+	if (g_Instance != nullptr) {
+		g_Instance->__Push({ InputEvent::Type::Scroll, 0, false, glm::vec2(xDiff, yDiff) });
+	}
+	if (g_PrevScrollCallback)
+		g_PrevScrollCallback(window, xDiff, yDiff);
+}
@@ -104,6 +104,10 @@ void TTK::Graphics::DrawText2D(const std::string& text, float posX, float posY,
 	TTK::Context::Instance().RenderText(text.c_str(), { posX, posY }, color, fontSize / 32.0f);
 }
 
+void TTK::Graphics::DrawText2D(TextHandle& text) {
+	TTK::Context::Instance().RenderText(text);
+}
+
 void TTK::Graphics::InitImGUI(GLFWwindow* window) {
 	// Creates a new ImGUI context5
 	ImGui::CreateContext();
@@ -214,19 +218,19 @@ void TTK::Graphics::DrawPoint(float* p0, float pointSize, float* colour) {
 	DrawPoint(VEC3(p0), pointSize, DEFAULT_BLACK(colour));
 }
 
-void TTK::Graphics::DrawCube(const glm::vec3& p0, float size, const glm::vec4& colour) {
+void TTK::Graphics::DrawCube(const glm::vec3& p0, float size, const glm::vec4& colour, uint32_t flags) {
 	glm::mat4 transform = glm::translate(glm::mat4(1.0f), p0) * glm::scale(glm::mat4(1.0f), glm::vec3(size));
-	TTK::Context::Instance().DrawCube(transform, colour);
+	TTK::Context::Instance().DrawCube(transform, colour, flags);
 }
 
 void TTK::Graphics::DrawCube(float* p0, float size, float* colour) {
 	DrawCube(VEC3(p0), size, DEFAULT_BLACK(colour));
 }
 
-void TTK::Graphics::DrawTeapot(const glm::vec3& p0, float size, const glm::vec4 colour)
+void TTK::Graphics::DrawTeapot(const glm::vec3& p0, float size, const glm::vec4 colour, uint32_t flags)
 {
 	glm::mat4 transform = glm::translate(glm::mat4(1.0f), p0) * glm::scale(glm::mat4(1.0f), glm::vec3(size));
-	TTK::Context::Instance().DrawTeapot(transform, colour);
+	TTK::Context::Instance().DrawTeapot(transform, colour, flags);
 }
 
 void TTK::Graphics::DrawTeapot(float* p0, float size, float* colour)
@@ -235,17 +239,17 @@ void TTK::Graphics::DrawTeapot(float* p0, float size, float* colour)
 	TTK::Context::Instance().DrawTeapot(transform, DEFAULT_BLACK(colour));
 }
 
-void TTK::Graphics::DrawSphere(const glm::vec3& center, float size, const glm::vec4& colour) {
+void TTK::Graphics::DrawSphere(const glm::vec3& center, float size, const glm::vec4& colour, uint32_t flags) {
 	glm::mat4 transform = glm::translate(glm::mat4(1.0f), center) * glm::scale(glm::mat4(1.0f), glm::vec3(size));
-	TTK::Context::Instance().DrawSphere(transform, colour);
+	TTK::Context::Instance().DrawSphere(transform, colour, flags);
 }
 
 void TTK::Graphics::DrawSphere(const glm::mat4& p0, float size, const glm::vec4& colour) {
 	TTK::Context::Instance().DrawSphere(p0, colour);
 }
 
-void TTK::Graphics::DrawSphere(const glm::mat4& transform, const glm::vec4& colour) {
-	TTK::Context::Instance().DrawSphere(transform, colour);
+void TTK::Graphics::DrawSphere(const glm::mat4& transform, const glm::vec4& colour, uint32_t flags) {
+	TTK::Context::Instance().DrawSphere(transform, colour, flags);
 }
 
 void TTK::Graphics::DrawSphere(float* p0, float size, float* colour) {
@@ -57,6 +57,26 @@ glm::vec2 TTK::Input::GetMouseScrollDelta() { PROXY(__GetMouseScrollDelta); }
 
 void TTK::Input::Poll() { PROXY(__Poll); }
 
+void TTK::Input::SetEventListener(const std::function<void(const InputEvent&)>& listener) {
+	LOG_ASSERT(m_Instance != nullptr, "TTK Input has not been initialized!");
+	m_Instance->m_Listener = listener;
+}
+
+void TTK::Input::SetReplaying(bool isReplaying) {
+	LOG_ASSERT(m_Instance != nullptr, "TTK Input has not been initialized!");
+	m_Instance->m_IsReplaying = isReplaying;
+	m_Instance->m_Injected.clear();
+}
+
+bool TTK::Input::IsReplaying() {
+	return m_Instance != nullptr && m_Instance->m_IsReplaying;
+}
+
+void TTK::Input::Inject(const InputEvent& event) {
+	LOG_ASSERT(m_Instance != nullptr, "TTK Input has not been initialized!");
+	m_Instance->m_Injected.push_back(event);
+}
+
 void TTK::Input::Init(void* windowPtr) {
 #ifdef TTK_GLFW
 	m_Instance = new TTK::GlfwInput();
@@ -11,82 +11,245 @@
 //////////////////////////////////////////////////////////////////////////
 #include "TTK/MeshHelper.h"
 
-#include "TTK/Teapot.h"
-#include "TTK/Sphere.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
 #include "TTK/Cube.h"
 #include "Logging.h"
 
 
+// The fewest instances the buffer will hold in each segment, so we don't grow a few at a time at startup
+static const size_t MinInstanceCapacity = 256;
+
+// The header at the start of a .ttkmesh file, it's followed by VertexCount positions (3 floats each) and then
+// IndexCount 16 bit indices making up a triangle list
+struct TTKMeshHeader {
+	char     Magic[4];
+	uint32_t Version;
+	uint32_t VertexCount;
+	uint32_t IndexCount;
+};
+static const uint32_t TTKMeshVersion = 1;
+
 TTK::Impl::MeshHelper::~MeshHelper() {
-	glDeleteBuffers(1, &m_Teapot.VBO);
-	glDeleteBuffers(1, &m_Sphere.VBO);
-	glDeleteBuffers(1, &m_Cube.VBO);
-	glDeleteVertexArrays(1, &m_Teapot.VAO);
-	glDeleteVertexArrays(1, &m_Sphere.VAO);
-	glDeleteVertexArrays(1, &m_Cube.VAO);
+	for (GLsync fence : m_Fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+		}
+	}
+	glDeleteBuffers(1, &m_InstanceVBO);
+	for (mesh* m : { &m_Teapot, &m_Sphere, &m_Cube }) {
+		glDeleteBuffers(1, &m->VBO);
+		glDeleteBuffers(1, &m->EBO);
+		glDeleteVertexArrays(1, &m->VAO);
+	}
 	glDeleteProgram(m_Shader);
 }
 
-void TTK::Impl::MeshHelper::RenderTeapot(const glm::mat4& transform, const glm::vec4& color) const {
-	glUseProgram(m_Shader);
-	glm::mat4 t = Context::Instance().GetViewProjection() * transform;
-	glProgramUniformMatrix4fv(m_Shader, 0, 1, FALSE, &t[0][0]);
-	glProgramUniform4fv(m_Shader, 1, 1, &color[0]);
-	glBindVertexArray(m_Teapot.VAO);
-	glDrawArrays(GL_TRIANGLES, 0, sizeof(TeapotData) / (sizeof(float) * 6));
+void TTK::Impl::MeshHelper::QueueTeapot(const glm::mat4& transform, const glm::vec4& color, uint32_t flags) {
+	m_Teapot.Queued[flags % ModeCount].push_back({ transform, color });
 }
 
-void TTK::Impl::MeshHelper::RenderSphere(const glm::mat4& transform, const glm::vec4& color) const {
-	glUseProgram(m_Shader);
-	glm::mat4 t = Context::Instance().GetViewProjection() * transform;
-	glProgramUniformMatrix4fv(m_Shader, 0, 1, FALSE, &t[0][0]);
-	glProgramUniform4fv(m_Shader, 1, 1, &color[0]);
-	glBindVertexArray(m_Sphere.VAO);
-	glDrawArrays(GL_TRIANGLES, 0, sizeof(SphereData) / (sizeof(float) * 6));
+void TTK::Impl::MeshHelper::QueueSphere(const glm::mat4& transform, const glm::vec4& color, uint32_t flags) {
+	m_Sphere.Queued[flags % ModeCount].push_back({ transform, color });
 }
 
-void TTK::Impl::MeshHelper::RenderCube(const glm::mat4& transform, const glm::vec4& color) const
-{
+void TTK::Impl::MeshHelper::QueueCube(const glm::mat4& transform, const glm::vec4& color, uint32_t flags) {
+	m_Cube.Queued[flags % ModeCount].push_back({ transform, color });
+}
+
+void TTK::Impl::MeshHelper::Flush() {
+	mesh* const meshes[] = { &m_Teapot, &m_Sphere, &m_Cube };
+	size_t total = 0;
+	for (mesh* m : meshes) {
+		// Meshes are only loaded once something actually draws them, if that fails they're just skipped
+		if (m->VAO == 0) {
+			if (!m->Attempted) {
+				m->Attempted = true;
+				__LoadMesh(*m);
+			}
+			if (m->VAO == 0) {
+				for (std::vector<Instance>& queued : m->Queued) {
+					queued.clear();
+				}
+				continue;
+			}
+		}
+		for (const std::vector<Instance>& queued : m->Queued) {
+			total += queued.size();
+		}
+	}
+	if (total == 0) {
+		return;
+	}
+	if (total > m_InstanceCapacity) {
+		__GrowInstances(total);
+	}
+
+	// The segment was last drawn a couple of flushes ago, so this should rarely have to wait
+	GLsync& fence = m_Fences[m_Segment];
+	if (fence != nullptr) {
+		if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX) == GL_WAIT_FAILED) {
+			LOG_WARN("Failed to wait on the TTK instance buffer, it may be overwritten while it's being drawn");
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	// We change the depth test and polygon mode for each mode, so we put them back how we found them afterwards
+	const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	GLint polygonMode[2];
+	glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+
+	Instance* write = reinterpret_cast<Instance*>(m_InstanceMapped) + m_Segment * m_InstanceCapacity;
+	GLuint first = static_cast<GLuint>(m_Segment * m_InstanceCapacity);
 	glUseProgram(m_Shader);
-	glm::mat4 t = Context::Instance().GetViewProjection() * transform;
-	glProgramUniformMatrix4fv(m_Shader, 0, 1, FALSE, &t[0][0]);
-	glProgramUniform4fv(m_Shader, 1, 1, &color[0]);
-	glBindVertexArray(m_Cube.VAO);
-	glDrawArrays(GL_TRIANGLES, 0, sizeof(CubeData) / (sizeof(float) * 6));
+	for (uint32_t mode = 0; mode < ModeCount; mode++) {
+		if (mode & DrawOverlay) {
+			glDisable(GL_DEPTH_TEST);
+		} else {
+			glEnable(GL_DEPTH_TEST);
+		}
+		glPolygonMode(GL_FRONT_AND_BACK, (mode & DrawWireframe) ? GL_LINE : GL_FILL);
+		for (mesh* m : meshes) {
+			std::vector<Instance>& queued = m->Queued[mode];
+			if (queued.empty()) {
+				continue;
+			}
+			std::copy(queued.begin(), queued.end(), write);
+			glBindVertexArray(m->VAO);
+			glDrawElementsInstancedBaseInstance(GL_TRIANGLES, m->IndexCount, GL_UNSIGNED_SHORT, nullptr, static_cast<GLsizei>(queued.size()), first);
+			write += queued.size();
+			first += static_cast<GLuint>(queued.size());
+			queued.clear();
+		}
+	}
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_Segment = (m_Segment + 1) % SegmentCount;
+
+	if (depthTest) {
+		glEnable(GL_DEPTH_TEST);
+	} else {
+		glDisable(GL_DEPTH_TEST);
+	}
+	glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+	glBindVertexArray(0);
+}
+
+void TTK::Impl::MeshHelper::__GrowInstances(size_t count) {
+	// The driver keeps the old buffer around until the GPU is done with it, so it's fences don't matter any more
+	for (GLsync& fence : m_Fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	if (m_InstanceVBO != 0) {
+		glDeleteBuffers(1, &m_InstanceVBO);
+	}
+	m_InstanceCapacity = std::max({ count + count / 2, m_InstanceCapacity * 2, MinInstanceCapacity });
+	m_Segment = 0;
+
+	const GLsizeiptr size = static_cast<GLsizeiptr>(sizeof(Instance) * m_InstanceCapacity * SegmentCount);
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &m_InstanceVBO);
+	glNamedBufferStorage(m_InstanceVBO, size, nullptr, flags);
+	m_InstanceMapped = static_cast<uint8_t*>(glMapNamedBufferRange(m_InstanceVBO, 0, size, flags));
+	LOG_ASSERT(m_InstanceMapped != nullptr, "Failed to map the TTK instance buffer!");
+
+	for (mesh* m : { &m_Teapot, &m_Sphere, &m_Cube }) {
+		if (m->VAO != 0) {
+			glVertexArrayVertexBuffer(m->VAO, 1, m_InstanceVBO, 0, sizeof(Instance));
+		}
+	}
 }
 
-TTK::Impl::MeshHelper::mesh TTK::Impl::MeshHelper::__MakeMesh(const float* data, size_t size) const {
-	mesh result;
+bool TTK::Impl::MeshHelper::__MakeMesh(mesh& result, const float* positions, size_t vertexCount, const uint16_t* indices, size_t indexCount) {
+	if (vertexCount == 0 || indexCount == 0) {
+		return false;
+	}
+	result.IndexCount = static_cast<GLsizei>(indexCount);
 	glCreateVertexArrays(1, &result.VAO);
-	glBindVertexArray(result.VAO);
 	glCreateBuffers(1, &result.VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, result.VBO);
-	glNamedBufferData(result.VBO, size, data, GL_DYNAMIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(float) * 6, 0);
-	return result;
+	glNamedBufferStorage(result.VBO, sizeof(float) * 3 * vertexCount, positions, 0);
+	glCreateBuffers(1, &result.EBO);
+	glNamedBufferStorage(result.EBO, sizeof(uint16_t) * indexCount, indices, 0);
+	glVertexArrayVertexBuffer(result.VAO, 0, result.VBO, 0, sizeof(float) * 3);
+	glVertexArrayElementBuffer(result.VAO, result.EBO);
+	glEnableVertexArrayAttrib(result.VAO, 0);
+	glVertexArrayAttribFormat(result.VAO, 0, 3, GL_FLOAT, false, 0);
+	glVertexArrayAttribBinding(result.VAO, 0, 0);
+
+	// The transform takes up locations 1 to 4, one for each column, and the color is in 5. They all come from the
+	// instance buffer, which gets attached to binding 1 once it's made
+	for (GLuint ix = 0; ix < 4; ix++) {
+		glEnableVertexArrayAttrib(result.VAO, 1 + ix);
+		glVertexArrayAttribFormat(result.VAO, 1 + ix, 4, GL_FLOAT, false, static_cast<GLuint>(offsetof(Instance, Transform) + sizeof(glm::vec4) * ix));
+		glVertexArrayAttribBinding(result.VAO, 1 + ix, 1);
+	}
+	glEnableVertexArrayAttrib(result.VAO, 5);
+	glVertexArrayAttribFormat(result.VAO, 5, 4, GL_FLOAT, false, static_cast<GLuint>(offsetof(Instance, Color)));
+	glVertexArrayAttribBinding(result.VAO, 5, 1);
+	glVertexArrayBindingDivisor(result.VAO, 1, 1);
+	if (m_InstanceVBO != 0) {
+		glVertexArrayVertexBuffer(result.VAO, 1, m_InstanceVBO, 0, sizeof(Instance));
+	}
+	return true;
+}
+
+bool TTK::Impl::MeshHelper::__LoadMesh(mesh& result) {
+	std::ifstream file(result.Path, std::ios::binary);
+	TTKMeshHeader header;
+	if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(TTKMeshHeader))) {
+		LOG_WARN("Failed to open the TTK mesh \"{}\", it won't be drawn", result.Path);
+		return false;
+	}
+	if (memcmp(header.Magic, "TTKM", 4) != 0 || header.Version != TTKMeshVersion) {
+		LOG_WARN("\"{}\" is not a version {} TTK mesh, it won't be drawn", result.Path, TTKMeshVersion);
+		return false;
+	}
+	std::vector<float> positions(static_cast<size_t>(header.VertexCount) * 3);
+	std::vector<uint16_t> indices(header.IndexCount);
+	file.read(reinterpret_cast<char*>(positions.data()), positions.size() * sizeof(float));
+	file.read(reinterpret_cast<char*>(indices.data()), indices.size() * sizeof(uint16_t));
+	if (!file) {
+		LOG_WARN("The TTK mesh \"{}\" is truncated, it won't be drawn", result.Path);
+		return false;
+	}
+	return __MakeMesh(result, positions.data(), header.VertexCount, indices.data(), header.IndexCount);
 }
 
-TTK::Impl::MeshHelper::MeshHelper()
+TTK::Impl::MeshHelper::MeshHelper() :
+	m_InstanceVBO(0),
+	m_InstanceMapped(nullptr),
+	m_InstanceCapacity(0),
+	m_Segment(0)
 {
-	m_Teapot = __MakeMesh(TeapotData, sizeof(TeapotData));
-	m_Sphere = __MakeMesh(SphereData, sizeof(SphereData));
-	m_Cube   = __MakeMesh(CubeData, sizeof(CubeData));
-	
-	glBindVertexArray(0);
+	std::fill(m_Fences, m_Fences + SegmentCount, nullptr);
+	// The teapot and sphere are too big to build in, so they get loaded from the toolkit's resources when they're
+	// first drawn. The cube is small enough to just make now
+	m_Teapot.Path = "ttk/teapot.ttkmesh";
+	m_Sphere.Path = "ttk/sphere.ttkmesh";
+	m_Cube.Attempted = true;
+	__MakeMesh(m_Cube, CubePositions, sizeof(CubePositions) / (sizeof(float) * 3), CubeIndices, sizeof(CubeIndices) / sizeof(uint16_t));
 	
 	const char* vsSource = R"LIT(#version 430
             layout (location = 0) in vec3 vertexPosition;
-            layout (location = 0) uniform mat4 xTransform;	
+            layout (location = 1) in mat4 instanceTransform;
+            layout (location = 5) in vec4 instanceColor;
+	
+            layout (location = 0) out vec4 fragmentColor;
             void main() {
-                gl_Position = xTransform * vec4(vertexPosition, 1);
+                gl_Position = instanceTransform * vec4(vertexPosition, 1);
+                fragmentColor = instanceColor;
             })LIT";
 
 	const char* fsSource = R"LIT(#version 430   
-            layout (location = 1) uniform vec4 xColor;		
+            layout (location = 0) in vec4 fragColor;		
             out vec4 frag_color;            	
             void main() {
-                frag_color = xColor;
+                frag_color = fragColor;
             })LIT";
 
 	m_Shader = glCreateProgram();
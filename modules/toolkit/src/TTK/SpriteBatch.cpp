@@ -0,0 +1,179 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this file in your GDW games.
+//
+// This file implements the TTK sprite batch
+//
+// Shawn Matthews 2019
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "TTK/SpriteBatch.h"
+#include <algorithm>
+
+#include "Logging.h"
+#include "TTK/SpriteSheetQuad.h"
+
+// The fewest sprites the buffer will hold in each segment, so we don't grow a few at a time at startup
+static const size_t MinSpriteCapacity = 1024;
+
+TTK::SpriteBatch::SpriteBatch() :
+	m_VBO(0),
+	m_Mapped(nullptr),
+	m_Capacity(0),
+	m_Segment(0)
+{
+	std::fill(m_Fences, m_Fences + SegmentCount, nullptr);
+
+	// Everything comes from the instance buffer, the corners of the quad are worked out from the vertex ID. The
+	// transform takes up locations 0 to 3, one for each column
+	glCreateVertexArrays(1, &m_VAO);
+	for (GLuint ix = 0; ix < 4; ix++) {
+		glEnableVertexArrayAttrib(m_VAO, ix);
+		glVertexArrayAttribFormat(m_VAO, ix, 4, GL_FLOAT, false, static_cast<GLuint>(offsetof(Instance, Transform) + sizeof(glm::vec4) * ix));
+		glVertexArrayAttribBinding(m_VAO, ix, 0);
+	}
+	glEnableVertexArrayAttrib(m_VAO, 4);
+	glVertexArrayAttribFormat(m_VAO, 4, 4, GL_FLOAT, false, static_cast<GLuint>(offsetof(Instance, UVRect)));
+	glVertexArrayAttribBinding(m_VAO, 4, 0);
+	glEnableVertexArrayAttrib(m_VAO, 5);
+	glVertexArrayAttribFormat(m_VAO, 5, 4, GL_FLOAT, false, static_cast<GLuint>(offsetof(Instance, Color)));
+	glVertexArrayAttribBinding(m_VAO, 5, 0);
+	glVertexArrayBindingDivisor(m_VAO, 0, 1);
+
+	// Same quad as SpriteSheetQuad, drawn as a strip of (-1, 1), (1, 1), (-1, -1), (1, -1)
+	const char* vsSource = R"LIT(#version 440
+            layout (location = 0) in mat4 instanceTransform;
+            layout (location = 4) in vec4 instanceUVRect;
+            layout (location = 5) in vec4 instanceColor;
+            layout (location = 0) out vec2 fragmentTexture;
+            layout (location = 1) out vec4 fragmentColor;
+            void main() {
+                vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+                gl_Position = instanceTransform * vec4(corner.x * 2 - 1, 1 - corner.y * 2, 0, 1);
+                fragmentTexture = mix(instanceUVRect.xy, instanceUVRect.zw, corner);
+                fragmentColor = instanceColor;
+            })LIT";
+
+	const char* fsSource = R"LIT(#version 440
+            layout(binding = 0) uniform sampler2D xSampler;
+            layout (location = 0) in vec2 fragUv;
+            layout (location = 1) in vec4 fragColor;
+            out vec4 frag_color;
+            void main() {
+				frag_color = texture2D(xSampler, fragUv) * fragColor;
+            })LIT";
+
+	m_Shader = glCreateProgram();
+
+	GLuint programs[2];
+	programs[0] = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(programs[0], 1, &vsSource, NULL);
+	glCompileShader(programs[0]);
+	programs[1] = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(programs[1], 1, &fsSource, NULL);
+	glCompileShader(programs[1]);
+
+	// Attach our two shaders
+	glAttachShader(m_Shader, programs[0]);
+	glAttachShader(m_Shader, programs[1]);
+
+	// Perform linking
+	glLinkProgram(m_Shader);
+
+	// Remove shader parts to save space
+	glDetachShader(m_Shader, programs[0]);
+	glDeleteShader(programs[0]);
+	glDetachShader(m_Shader, programs[1]);
+	glDeleteShader(programs[1]);
+}
+
+TTK::SpriteBatch::~SpriteBatch() {
+	for (GLsync fence : m_Fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+		}
+	}
+	glDeleteBuffers(1, &m_VBO);
+	glDeleteVertexArrays(1, &m_VAO);
+	glDeleteProgram(m_Shader);
+}
+
+void TTK::SpriteBatch::Add(const Texture2D& texture, const glm::mat4& matrix, const SpriteCoordinates& coords, const glm::vec4& color) {
+	Queued sprite;
+	sprite.Texture = texture.GetID();
+	sprite.Data.Transform = matrix;
+	sprite.Data.UVRect = glm::vec4(coords.uMin, coords.vMin, coords.uMax, coords.vMax);
+	sprite.Data.Color = color;
+	m_Queued.push_back(sprite);
+}
+
+void TTK::SpriteBatch::Flush() {
+	if (m_Queued.empty()) {
+		return;
+	}
+	if (m_Queued.size() > m_Capacity) {
+		__Grow(m_Queued.size());
+	}
+
+	// The segment was last drawn a couple of flushes ago, so this should rarely have to wait
+	GLsync& fence = m_Fences[m_Segment];
+	if (fence != nullptr) {
+		if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX) == GL_WAIT_FAILED) {
+			LOG_WARN("Failed to wait on the sprite buffer, it may be overwritten while it's being drawn");
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	// Stable, so sprites that share a texture still overlap in the order they were added
+	std::stable_sort(m_Queued.begin(), m_Queued.end(), [](const Queued& l, const Queued& r) {
+		return l.Texture < r.Texture;
+	});
+	Instance* write = m_Mapped + m_Segment * m_Capacity;
+	for (const Queued& sprite : m_Queued) {
+		*write++ = sprite.Data;
+	}
+
+	glUseProgram(m_Shader);
+	glBindVertexArray(m_VAO);
+	const GLuint segmentStart = static_cast<GLuint>(m_Segment * m_Capacity);
+	size_t first = 0;
+	while (first < m_Queued.size()) {
+		const GLuint texture = m_Queued[first].Texture;
+		size_t last = first + 1;
+		while (last < m_Queued.size() && m_Queued[last].Texture == texture) {
+			last++;
+		}
+		glBindTextureUnit(0, texture);
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(last - first), segmentStart + static_cast<GLuint>(first));
+		first = last;
+	}
+	glBindVertexArray(0);
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_Segment = (m_Segment + 1) % SegmentCount;
+	m_Queued.clear();
+}
+
+void TTK::SpriteBatch::__Grow(size_t count) {
+	// The driver keeps the old buffer around until the GPU is done with it, so it's fences don't matter any more
+	for (GLsync& fence : m_Fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	glDeleteBuffers(1, &m_VBO);
+	m_Capacity = std::max({ count + count / 2, m_Capacity * 2, MinSpriteCapacity });
+	m_Segment = 0;
+
+	const GLsizeiptr size = static_cast<GLsizeiptr>(sizeof(Instance) * m_Capacity * SegmentCount);
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &m_VBO);
+	glNamedBufferStorage(m_VBO, size, nullptr, flags);
+	m_Mapped = static_cast<Instance*>(glMapNamedBufferRange(m_VBO, 0, size, flags));
+	LOG_ASSERT(m_Mapped != nullptr, "Failed to map the sprite buffer!");
+	glVertexArrayVertexBuffer(m_VAO, 0, m_VBO, 0, sizeof(Instance));
+}
@@ -182,6 +182,11 @@ void TTK::SpriteSheetQuad::Draw(const glm::mat4& matrix)
 	glUseProgram(currentProgram);
 }
 
+void TTK::SpriteSheetQuad::Draw(SpriteBatch& batch, const glm::mat4& matrix) const
+{
+	batch.Add(m_Texture, matrix, m_SpriteCoordinates[m_CurrentFrame], m_Color);
+}
+
 void TTK::SpriteSheetQuad::SetFrameLength(int frameNumber, float time)
 {
 	if (frameNumber >= 0 && frameNumber < m_FrameLength.size()) {
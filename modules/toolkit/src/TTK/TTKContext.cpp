@@ -12,6 +12,7 @@
 
 #include "TTK/TTKContext.h"
 #include <GLM/gtc/matrix_transform.hpp>
+#include <algorithm>
 #include <string>
 #include "Logging.h"
 #include "TTK/MeshHelper.h"
@@ -21,12 +22,9 @@ TTK::Context* TTK::Context::m_Instance = nullptr;
 TTK::Context::~Context() {
 	delete m_MeshHelper;
 	delete m_DefaultFont;
-	glDeleteBuffers(1, &m_Tris.VBO);
-	glDeleteBuffers(1, &m_Lines.VBO);
-	glDeleteBuffers(1, &m_Points.VBO);
-	glDeleteVertexArrays(1, &m_Tris.VAO);
-	glDeleteVertexArrays(1, &m_Lines.VAO);
-	glDeleteVertexArrays(1, &m_Points.VAO);
+	__FreeBuff(m_Tris);
+	__FreeBuff(m_Lines);
+	__FreeBuff(m_Points);
 	glDeleteProgram(m_ShaderHandle);
 }
 
@@ -56,23 +54,28 @@ void TTK::Context::RenderText(const char* text, const glm::vec2& position, const
 	TTK::FontRenderer::Instance().Render(*m_DefaultFont, text, position, color, scale);
 }
 
-void TTK::Context::DrawTeapot(const glm::mat4& mat, const glm::vec4& color) const {
-	m_MeshHelper->RenderTeapot(mat, color);
+void TTK::Context::RenderText(TextHandle& text) {
+	TTK::FontRenderer::Instance().Render(text);
 }
 
-void TTK::Context::DrawSphere(const glm::mat4& mat, const glm::vec4& color) const {
-	m_MeshHelper->RenderSphere(mat, color);
+void TTK::Context::DrawTeapot(const glm::mat4& mat, const glm::vec4& color, uint32_t flags) const {
+	m_MeshHelper->QueueTeapot(m_ViewProjection * mat, color, flags);
 }
 
-void TTK::Context::DrawCube(const glm::mat4& mat, const glm::vec4& color) const {
-	m_MeshHelper->RenderCube(mat, color);
+void TTK::Context::DrawSphere(const glm::mat4& mat, const glm::vec4& color, uint32_t flags) const {
+	m_MeshHelper->QueueSphere(m_ViewProjection * mat, color, flags);
+}
+
+void TTK::Context::DrawCube(const glm::mat4& mat, const glm::vec4& color, uint32_t flags) const {
+	m_MeshHelper->QueueCube(m_ViewProjection * mat, color, flags);
 }
 
 void TTK::Context::AddLine(const glm::vec3& a, const glm::vec3& b, const glm::vec4& color) {
-	m_LineVerts[m_Lines.Count + 0].Position = a;
-	m_LineVerts[m_Lines.Count + 0].Color = color;
-	m_LineVerts[m_Lines.Count + 1].Position = b;
-	m_LineVerts[m_Lines.Count + 1].Color = color;
+	SimpleVert* verts = __Next<SimpleVert>(m_Lines);
+	verts[0].Position = a;
+	verts[0].Color = color;
+	verts[1].Position = b;
+	verts[1].Color = color;
 	m_Lines.Count += 2;
 	if (m_Lines.Count == MaxLineVerts) {
 		__Flush(m_Lines);
@@ -80,12 +83,13 @@ void TTK::Context::AddLine(const glm::vec3& a, const glm::vec3& b, const glm::ve
 }
 
 void TTK::Context::AddTri(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec4& color) {
-	m_TriVerts[m_Tris.Count + 0].Position = a;
-	m_TriVerts[m_Tris.Count + 0].Color = color;
-	m_TriVerts[m_Tris.Count + 1].Position = b;
-	m_TriVerts[m_Tris.Count + 1].Color = color;
-	m_TriVerts[m_Tris.Count + 2].Position = c;
-	m_TriVerts[m_Tris.Count + 2].Color = color;
+	SimpleVert* verts = __Next<SimpleVert>(m_Tris);
+	verts[0].Position = a;
+	verts[0].Color = color;
+	verts[1].Position = b;
+	verts[1].Color = color;
+	verts[2].Position = c;
+	verts[2].Color = color;
 	m_Tris.Count += 3;
 	if (m_Tris.Count == MaxTriVerts) {
 		__Flush(m_Tris);
@@ -101,9 +105,10 @@ void TTK::Context::AddQuad(const glm::vec3& min, const glm::vec3& max, const glm
 
 void TTK::Context::AddPoint(const glm::vec3& pos, float size, const glm::vec4& color)
 {
-	m_PointVerts[m_Points.Count].Position = pos;
-	m_PointVerts[m_Points.Count].Color = color;
-	m_PointVerts[m_Points.Count].Size = size;
+	PointVert* vert = __Next<PointVert>(m_Points);
+	vert->Position = pos;
+	vert->Color = color;
+	vert->Size = size;
 	m_Points.Count += 1;
 	if (m_Points.Count == MaxPointVerts) {
 		__Flush(m_Points);
@@ -111,9 +116,12 @@ void TTK::Context::AddPoint(const glm::vec3& pos, float size, const glm::vec4& c
 }
 
 void TTK::Context::Flush() {
+	m_MeshHelper->Flush();
 	__Flush(m_Tris);
 	__Flush(m_Lines);
 	__Flush(m_Points);
+	// Text goes over the top of everything else
+	TTK::FontRenderer::Instance().Flush();
 }
 
 TTK::Context::Context() {
@@ -159,19 +167,19 @@ TTK::Context::Context() {
 	m_PointShaderHandle = __CompileShader(vsSourcePoint, fsSource);
 
 
-	m_Tris = __InitBuff(GL_TRIANGLES, m_ShaderHandle, m_TriVerts, sizeof(SimpleVert), MaxTriVerts);
+	m_Tris = __InitBuff(GL_TRIANGLES, m_ShaderHandle, sizeof(SimpleVert), MaxTriVerts);
 	glEnableVertexAttribArray(0);
 	glEnableVertexAttribArray(1);
 	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Position));
 	glVertexAttribPointer(1, 4, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Color));
 
-	m_Lines = __InitBuff(GL_LINES, m_ShaderHandle, m_LineVerts, sizeof(SimpleVert), MaxLineVerts);
+	m_Lines = __InitBuff(GL_LINES, m_ShaderHandle, sizeof(SimpleVert), MaxLineVerts);
 	glEnableVertexAttribArray(0);
 	glEnableVertexAttribArray(1);
 	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Position));
 	glVertexAttribPointer(1, 4, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Color));
 
-	m_Points = __InitBuff(GL_POINTS, m_PointShaderHandle, m_PointVerts, sizeof(PointVert), MaxLineVerts);
+	m_Points = __InitBuff(GL_POINTS, m_PointShaderHandle, sizeof(PointVert), MaxPointVerts);
 	glEnableVertexAttribArray(0);
 	glEnableVertexAttribArray(1);
 	glEnableVertexAttribArray(2);
@@ -188,32 +196,60 @@ TTK::Context::Context() {
 	glEnable(GL_PROGRAM_POINT_SIZE);
 }
 
-TTK::Context::GLBuff TTK::Context::__InitBuff(GLenum mode, GLuint shader, void* dataSource, size_t elemSize, size_t maxElems)
+TTK::Context::GLBuff TTK::Context::__InitBuff(GLenum mode, GLuint shader, size_t elemSize, size_t maxElems)
 {
 	GLBuff result;
 	result.Mode = mode;
 	result.Count = 0;
-	result.Data = dataSource;
 	result.ElemSize = elemSize;
+	result.MaxElems = maxElems;
+	result.Segment = 0;
 	result.Shader = shader;
+	std::fill(result.Fences, result.Fences + SegmentCount, nullptr);
 
 	glCreateVertexArrays(1, &result.VAO);
 	glBindVertexArray(result.VAO);
 	glCreateBuffers(1, &result.VBO);
 	glBindBuffer(GL_ARRAY_BUFFER, result.VBO);
-	glNamedBufferData(result.VBO, elemSize * maxElems, nullptr, GL_STREAM_DRAW);
+	// Coherent, so anything written before the draw is issued is seen by it without us flushing ranges
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glNamedBufferStorage(result.VBO, elemSize * maxElems * SegmentCount, nullptr, flags);
+	result.Mapped = static_cast<uint8_t*>(glMapNamedBufferRange(result.VBO, 0, elemSize * maxElems * SegmentCount, flags));
+	LOG_ASSERT(result.Mapped != nullptr, "Failed to map a TTK vertex buffer!");
 
 	return result;
 }
 
+void TTK::Context::__FreeBuff(GLBuff& buff) {
+	for (GLsync fence : buff.Fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+		}
+	}
+	glUnmapNamedBuffer(buff.VBO);
+	glDeleteBuffers(1, &buff.VBO);
+	glDeleteVertexArrays(1, &buff.VAO);
+}
+
 void TTK::Context::__Flush(GLBuff& buff) {
 	if (buff.Count > 0) {
 		glUseProgram(buff.Shader);
 		glUniformMatrix4fv(0, 1, false, &m_ViewProjection[0][0]);
-		glNamedBufferSubData(buff.VBO, 0, buff.Count * buff.ElemSize, buff.Data);
 		glBindVertexArray(buff.VAO);
-		glDrawArrays(buff.Mode, 0, static_cast<GLsizei>(buff.Count));
+		glDrawArrays(buff.Mode, static_cast<GLint>(buff.Segment * buff.MaxElems), static_cast<GLsizei>(buff.Count));
+		buff.Fences[buff.Segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 		buff.Count = 0;
+
+		// Move on to the next segment, it was drawn a couple of flushes ago so this should rarely have to wait
+		buff.Segment = (buff.Segment + 1) % SegmentCount;
+		GLsync& fence = buff.Fences[buff.Segment];
+		if (fence != nullptr) {
+			if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX) == GL_WAIT_FAILED) {
+				LOG_WARN("Failed to wait on a TTK vertex buffer, it may be overwritten while it's being drawn");
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
 	}
 }
 
@@ -0,0 +1,37 @@
+#version 430
+
+// Shrinks the scene's depth down to half resolution for the ambient occlusion (see AmbientOcclusion), as linear view
+// depth. Each texel alternates between the nearest and farthest of the four under it in a checkerboard, so both
+// sides of an edge make it into the smaller texture. The sky is written as 0, which the other passes skip over
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D s_Depth;
+layout(r32f, binding = 0) uniform writeonly image2D u_Target;
+
+// The projection's [2][2] and [3][2] terms, which turn NDC depth back into view depth
+uniform vec2 u_DepthParams;
+
+void main() {
+	ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(coord, imageSize(u_Target)))) {
+		return;
+	}
+	ivec2 sourceMax = textureSize(s_Depth, 0) - 1;
+	ivec2 source = coord * 2;
+	vec4 depths = vec4(
+		texelFetch(s_Depth, min(source, sourceMax), 0).r,
+		texelFetch(s_Depth, min(source + ivec2(1, 0), sourceMax), 0).r,
+		texelFetch(s_Depth, min(source + ivec2(0, 1), sourceMax), 0).r,
+		texelFetch(s_Depth, min(source + ivec2(1, 1), sourceMax), 0).r
+	);
+	bool useNearest = ((coord.x + coord.y) & 1) == 0;
+	float depth = useNearest ?
+		min(min(depths.x, depths.y), min(depths.z, depths.w)) :
+		max(max(depths.x, depths.y), max(depths.z, depths.w));
+
+	float linear = 0.0;
+	if (depth < 1.0) {
+		linear = u_DepthParams.y / (depth * 2.0 - 1.0 + u_DepthParams.x);
+	}
+	imageStore(u_Target, coord, vec4(linear));
+}
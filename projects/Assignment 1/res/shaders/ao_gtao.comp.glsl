@@ -0,0 +1,140 @@
+#version 430
+
+// Works out how much of the hemisphere over each texel is open (see AmbientOcclusion). A couple of slices through the
+// view direction get searched for the highest horizon on either side, then the cosine weighted arc between the two
+// horizons is integrated against the normal (Jimenez et al., "Practical Realtime Strategies for Accurate Indirect
+// Occlusion"). The slices and steps get rotated by noise that changes every frame, for the temporal pass to average out
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// The half resolution linear depth, 0 where there's sky
+layout(binding = 0) uniform sampler2D s_Depth;
+layout(r8, binding = 0) uniform writeonly image2D u_Target;
+
+// Turns a texel's NDC position into view space, once it's multiplied by the texel's linear depth
+uniform vec2  u_ProjectionScale;
+// How many texels a world unit covers at a linear depth of 1
+uniform float u_PixelScale;
+uniform float u_Radius;
+uniform float u_Intensity;
+uniform int   u_StepCount;
+uniform int   u_Frame;
+
+#define SLICE_COUNT 2
+// Keeps the search close by up close, so it doesn't go reading all over the texture
+#define MAX_RADIUS_TEXELS 48.0
+
+const float PI = 3.14159265359;
+const float HALF_PI = 1.57079632679;
+
+vec3 GetViewPos(vec2 uv, float depth) {
+	return vec3((uv * 2.0 - 1.0) * u_ProjectionScale * depth, -depth);
+}
+
+// Noise that's evenly spread between neighbours, offset a little each frame
+float GetNoise(vec2 coord, float offset) {
+	coord += (float(u_Frame) + offset) * 5.588238;
+	return fract(52.9829189 * fract(dot(coord, vec2(0.06711056, 0.00583715))));
+}
+
+void main() {
+	ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(u_Target);
+	if (any(greaterThanEqual(coord, size))) {
+		return;
+	}
+	vec2 texelSize = 1.0 / vec2(size);
+	vec2 uv = (vec2(coord) + 0.5) * texelSize;
+	float depth = texelFetch(s_Depth, coord, 0).r;
+	float radiusTexels = min(u_Radius * u_PixelScale / max(depth, 1e-4), MAX_RADIUS_TEXELS);
+	// Nothing to occlude the sky, and anything far enough away would only sample itself
+	if (depth <= 0.0 || radiusTexels < 1.0) {
+		imageStore(u_Target, coord, vec4(1.0));
+		return;
+	}
+	vec3 pos = GetViewPos(uv, depth);
+	vec3 viewDir = normalize(-pos);
+
+	// Rebuild the normal from the neighbour on whichever side is closer in depth, so it holds up along edges
+	ivec2 maxCoord = size - 1;
+	float left   = texelFetch(s_Depth, clamp(coord - ivec2(1, 0), ivec2(0), maxCoord), 0).r;
+	float right  = texelFetch(s_Depth, clamp(coord + ivec2(1, 0), ivec2(0), maxCoord), 0).r;
+	float bottom = texelFetch(s_Depth, clamp(coord - ivec2(0, 1), ivec2(0), maxCoord), 0).r;
+	float top    = texelFetch(s_Depth, clamp(coord + ivec2(0, 1), ivec2(0), maxCoord), 0).r;
+	vec3 dx = abs(right - depth) < abs(depth - left) && right > 0.0 ?
+		GetViewPos(uv + vec2(texelSize.x, 0.0), right) - pos :
+		pos - GetViewPos(uv - vec2(texelSize.x, 0.0), left);
+	vec3 dy = abs(top - depth) < abs(depth - bottom) && top > 0.0 ?
+		GetViewPos(uv + vec2(0.0, texelSize.y), top) - pos :
+		pos - GetViewPos(uv - vec2(0.0, texelSize.y), bottom);
+	vec3 normal = normalize(cross(dx, dy));
+	if (dot(normal, viewDir) < 0.0) {
+		normal = -normal;
+	}
+
+	// Samples fade out towards the edge of the radius, rather than cutting off
+	float falloffRange = 0.6 * u_Radius;
+	float falloffMul = -1.0 / falloffRange;
+	float falloffAdd = (u_Radius - falloffRange) / falloffRange + 1.0;
+
+	float sliceNoise = GetNoise(vec2(coord), 0.0);
+	float stepNoise = GetNoise(vec2(coord), 7.0);
+	float visibility = 0.0;
+	for (int slice = 0; slice < SLICE_COUNT; slice++) {
+		float phi = (float(slice) + sliceNoise) * PI / float(SLICE_COUNT);
+		vec2 omega = vec2(cos(phi), sin(phi));
+		vec3 direction = vec3(omega, 0.0);
+		vec3 orthoDirection = direction - dot(direction, viewDir) * viewDir;
+		vec3 axis = normalize(cross(orthoDirection, viewDir));
+
+		// The normal, flattened onto the slice
+		vec3 projectedNormal = normal - axis * dot(normal, axis);
+		float projectedLength = length(projectedNormal);
+		if (projectedLength < 1e-4) {
+			visibility += 1.0;
+			continue;
+		}
+		float cosNormal = clamp(dot(projectedNormal, viewDir) / projectedLength, 0.0, 1.0);
+		float n = sign(dot(orthoDirection, projectedNormal)) * acos(cosNormal);
+
+		// Start from the lowest the horizons could be, and raise them as we go
+		float lowCos0 = cos(n + HALF_PI);
+		float lowCos1 = cos(n - HALF_PI);
+		float horizonCos0 = lowCos0;
+		float horizonCos1 = lowCos1;
+		for (int step = 0; step < u_StepCount; step++) {
+			// Squared, so the samples bunch up close by where the detail is
+			float s = (float(step) + stepNoise) / float(u_StepCount);
+			s = s * s;
+			vec2 offset = omega * max(s * radiusTexels, float(step) + 1.0) * texelSize;
+
+			vec2 uv0 = uv + offset;
+			float depth0 = texture(s_Depth, uv0).r;
+			if (depth0 > 0.0) {
+				vec3 delta = GetViewPos(uv0, depth0) - pos;
+				float dist = length(delta);
+				float weight = clamp(dist * falloffMul + falloffAdd, 0.0, 1.0);
+				horizonCos0 = max(horizonCos0, mix(lowCos0, dot(delta / dist, viewDir), weight));
+			}
+
+			vec2 uv1 = uv - offset;
+			float depth1 = texture(s_Depth, uv1).r;
+			if (depth1 > 0.0) {
+				vec3 delta = GetViewPos(uv1, depth1) - pos;
+				float dist = length(delta);
+				float weight = clamp(dist * falloffMul + falloffAdd, 0.0, 1.0);
+				horizonCos1 = max(horizonCos1, mix(lowCos1, dot(delta / dist, viewDir), weight));
+			}
+		}
+
+		// Keep the horizons within the hemisphere around the normal, then integrate the arc between them
+		float h0 = -acos(clamp(horizonCos1, -1.0, 1.0));
+		float h1 = acos(clamp(horizonCos0, -1.0, 1.0));
+		h0 = n + clamp(h0 - n, -HALF_PI, HALF_PI);
+		h1 = n + clamp(h1 - n, -HALF_PI, HALF_PI);
+		float arc0 = (cosNormal + 2.0 * h0 * sin(n) - cos(2.0 * h0 - n)) * 0.25;
+		float arc1 = (cosNormal + 2.0 * h1 * sin(n) - cos(2.0 * h1 - n)) * 0.25;
+		visibility += projectedLength * (arc0 + arc1);
+	}
+	visibility = clamp(visibility / float(SLICE_COUNT), 0.0, 1.0);
+	imageStore(u_Target, coord, vec4(pow(visibility, u_Intensity)));
+}
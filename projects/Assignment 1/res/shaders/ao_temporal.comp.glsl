@@ -0,0 +1,67 @@
+#version 430
+
+// Smooths out the ambient occlusion's noise and accumulates it over time (see AmbientOcclusion). The raw occlusion
+// gets a small blur that stays on it's own side of any edges, then each texel is reprojected into last frame's result
+// and blended with it, as long as last frame saw the same surface there. The result keeps the depth alongside the
+// occlusion, for the next frame's reprojection and the upsample in the lit shaders
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D s_Depth;
+layout(binding = 1) uniform sampler2D s_Occlusion;
+// Last frame's result, the occlusion and it's linear depth
+layout(binding = 2) uniform sampler2D s_History;
+layout(rg16f, binding = 0) uniform writeonly image2D u_Target;
+
+uniform vec2  u_ProjectionScale;
+uniform mat4  u_InverseView;
+uniform mat4  u_PreviousViewProjection;
+// How much of this frame goes into the result, 1 when there's no history to blend with
+uniform float u_HistoryBlend;
+
+// How far apart two depths can be (relative to the depth) and still be treated as the same surface
+#define DEPTH_TOLERANCE 0.05
+
+void main() {
+	ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(u_Target);
+	if (any(greaterThanEqual(coord, size))) {
+		return;
+	}
+	float depth = texelFetch(s_Depth, coord, 0).r;
+	if (depth <= 0.0) {
+		imageStore(u_Target, coord, vec4(1.0, 0.0, 0.0, 0.0));
+		return;
+	}
+
+	ivec2 maxCoord = size - 1;
+	float occlusion = 0.0;
+	float totalWeight = 0.0;
+	for (int y = -1; y <= 1; y++) {
+		for (int x = -1; x <= 1; x++) {
+			ivec2 neighbour = clamp(coord + ivec2(x, y), ivec2(0), maxCoord);
+			float neighbourDepth = texelFetch(s_Depth, neighbour, 0).r;
+			float weight = max(1.0 - abs(neighbourDepth - depth) / (depth * DEPTH_TOLERANCE), 0.0);
+			occlusion += texelFetch(s_Occlusion, neighbour, 0).r * weight;
+			totalWeight += weight;
+		}
+	}
+	// The center always matches itself, so the weights never add up to nothing
+	occlusion /= totalWeight;
+
+	if (u_HistoryBlend < 1.0) {
+		vec2 uv = (vec2(coord) + 0.5) / vec2(size);
+		vec4 world = u_InverseView * vec4(vec3((uv * 2.0 - 1.0) * u_ProjectionScale * depth, -depth), 1.0);
+		vec4 previousClip = u_PreviousViewProjection * world;
+		if (previousClip.w > 0.0) {
+			vec2 previousUv = previousClip.xy / previousClip.w * 0.5 + 0.5;
+			if (all(greaterThanEqual(previousUv, vec2(0.0))) && all(lessThan(previousUv, vec2(1.0)))) {
+				vec2 history = texelFetch(s_History, ivec2(previousUv * vec2(size)), 0).rg;
+				// The w of a perspective projection is the linear depth, so it lines up with what last frame stored
+				if (abs(history.g - previousClip.w) < previousClip.w * DEPTH_TOLERANCE) {
+					occlusion = mix(history.r, occlusion, u_HistoryBlend);
+				}
+			}
+		}
+	}
+	imageStore(u_Target, coord, vec4(occlusion, depth, 0.0, 0.0));
+}
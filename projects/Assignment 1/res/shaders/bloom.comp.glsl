@@ -0,0 +1,73 @@
+#version 430
+
+// The passes of the bloom chain in PostProcessing, which one runs is picked with a define:
+//   PREFILTER   - Downsamples the scene to half size, keeping only what is brighter than the threshold
+//   DOWNSAMPLE  - Downsamples a level of the chain to half it's size
+//   UPSAMPLE    - Blurs a level of the chain up to the size of the one above it, and adds it on
+// Going down and back up the chain gives a very wide blur from a few small filters. The filters are the ones from
+// Jimenez's "Next Generation Post Processing in Call of Duty: Advanced Warfare" (SIGGRAPH 2014), the 13 tap
+// downsample keeps bright pixels from flickering as they move, and the tent upsample hides the blockiness of the
+// smaller levels
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+layout(binding = 0) uniform sampler2D s_Source;
+#if defined(UPSAMPLE)
+layout(rgba16f, binding = 0) uniform image2D u_Target;
+#else
+layout(rgba16f, binding = 0) uniform writeonly image2D u_Target;
+#endif
+
+// PREFILTER only, the threshold (x), the threshold minus the knee (y), twice the knee (z) and 0.25 / the knee (w).
+// Pixels fade in over the knee below the threshold, so there's no hard edge where bloom starts
+uniform vec4 u_Threshold;
+
+vec3 Sample(vec2 uv) {
+	return textureLod(s_Source, uv, 0.0).rgb;
+}
+
+void main() {
+	ivec2 id = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(u_Target);
+	if (id.x >= size.x || id.y >= size.y) {
+		return;
+	}
+	vec2 uv = (vec2(id) + 0.5) / vec2(size);
+	vec2 texel = 1.0 / vec2(textureSize(s_Source, 0));
+
+#if defined(UPSAMPLE)
+	// 3x3 tent, the source is the smaller level
+	vec3 result = Sample(uv) * 4.0;
+	result += (Sample(uv + vec2(-texel.x, 0.0)) + Sample(uv + vec2(texel.x, 0.0)) +
+	           Sample(uv + vec2(0.0, -texel.y)) + Sample(uv + vec2(0.0, texel.y))) * 2.0;
+	result += Sample(uv + vec2(-texel.x, -texel.y)) + Sample(uv + vec2(texel.x, -texel.y)) +
+	          Sample(uv + vec2(-texel.x, texel.y)) + Sample(uv + vec2(texel.x, texel.y));
+	result /= 16.0;
+	imageStore(u_Target, id, vec4(imageLoad(u_Target, id).rgb + result, 1.0));
+
+#else
+	// 13 taps, as 4 overlapping 2x2 boxes around the corners and one in the middle. The bilinear filter averages each
+	// tap over 4 texels for us
+	vec3 a = Sample(uv + texel * vec2(-2.0,  2.0));
+	vec3 b = Sample(uv + texel * vec2( 0.0,  2.0));
+	vec3 c = Sample(uv + texel * vec2( 2.0,  2.0));
+	vec3 d = Sample(uv + texel * vec2(-2.0,  0.0));
+	vec3 e = Sample(uv);
+	vec3 f = Sample(uv + texel * vec2( 2.0,  0.0));
+	vec3 g = Sample(uv + texel * vec2(-2.0, -2.0));
+	vec3 h = Sample(uv + texel * vec2( 0.0, -2.0));
+	vec3 i = Sample(uv + texel * vec2( 2.0, -2.0));
+	vec3 j = Sample(uv + texel * vec2(-1.0,  1.0));
+	vec3 k = Sample(uv + texel * vec2( 1.0,  1.0));
+	vec3 l = Sample(uv + texel * vec2(-1.0, -1.0));
+	vec3 m = Sample(uv + texel * vec2( 1.0, -1.0));
+	vec3 result = e * 0.125 + (a + c + g + i) * 0.03125 + (b + d + f + h) * 0.0625 + (j + k + l + m) * 0.125;
+
+#if defined(PREFILTER)
+	float brightness = max(result.r, max(result.g, result.b));
+	float soft = clamp(brightness - u_Threshold.y, 0.0, u_Threshold.z);
+	soft = soft * soft * u_Threshold.w;
+	result *= max(soft, brightness - u_Threshold.x) / max(brightness, 0.0001);
+#endif
+	imageStore(u_Target, id, vec4(result, 1.0));
+#endif
+}
@@ -0,0 +1,18 @@
+#version 430
+
+// Lays down the depth of the opaque scene before it gets shaded, so the lit shaders only run once per pixel
+
+layout(location = 0) in vec3 inPosition;
+
+// Per-instance data, see InstanceTransform in VertexTypes.h
+layout(location = 4) in mat4 inModel;
+
+#include "include/frame_data.glsl"
+
+// Must match vertex_shader.glsl exactly, since the colour pass tests against these depths with GL_EQUAL
+invariant gl_Position;
+
+void main() {
+	vec4 worldPos = inModel * vec4(inPosition, 1.0);
+	gl_Position = u_ViewProjection * worldPos;
+}
@@ -0,0 +1,31 @@
+#version 430
+
+// Builds one level of the depth pyramid (see DepthPyramid), each texel gets the farthest depth of every source texel
+// it covers. The first level shrinks the scene's depth by anywhere up to half, so a texel can cover parts of up to
+// three source texels along each side, the rest are exactly half of the level before them
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D s_Source;
+layout(r32f, binding = 0) uniform writeonly image2D u_Target;
+
+uniform int u_SourceLevel;
+
+void main() {
+	ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 targetSize = imageSize(u_Target);
+	if (any(greaterThanEqual(coord, targetSize))) {
+		return;
+	}
+	ivec2 sourceSize = textureSize(s_Source, u_SourceLevel);
+
+	// The source texels that overlap this one, rounded outwards so nothing in between gets missed
+	ivec2 first = (coord * sourceSize) / targetSize;
+	ivec2 last = min(((coord + 1) * sourceSize + targetSize - 1) / targetSize, sourceSize) - 1;
+	float farthest = 0.0;
+	for (int y = first.y; y <= min(last.y, first.y + 2); y++) {
+		for (int x = first.x; x <= min(last.x, first.x + 2); x++) {
+			farthest = max(farthest, texelFetch(s_Source, ivec2(x, y), u_SourceLevel).r);
+		}
+	}
+	imageStore(u_Target, coord, vec4(farthest));
+}
@@ -0,0 +1,120 @@
+#version 430
+
+// Prefilters an environment map for reflections and ambient light (see EnvironmentPrefilter). Each invocation fills
+// one texel of one face of the level being written, which one of the passes it runs is picked with a define:
+//   DOWNSAMPLE  - Averages the source texels under the target texel, used to shrink the source to the working size
+//   SPECULAR    - Convolves the source with a GGX lobe of the given roughness, one pass per mip level
+//   IRRADIANCE  - Convolves the source with a cosine lobe, for the light a diffuse surface facing each way receives
+// See https://learnopengl.com/PBR/IBL/Specular-IBL and
+// https://developer.nvidia.com/gpugems/gpugems3/part-iii-rendering/chapter-20-gpu-based-importance-sampling
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+layout(binding = 0) uniform samplerCube s_Source;
+layout(rgba16f, binding = 0) uniform writeonly imageCube u_Target;
+
+// The size of a face of the level being written
+uniform int   u_TargetSize;
+// The size of a face of the source's top level, used to pick which of it's mips each sample reads
+uniform float u_SourceSize;
+// The roughness the level is being filtered for, only used by SPECULAR
+uniform float u_Roughness;
+
+const float PI = 3.14159265359;
+
+// Gets the direction through a point on a face of the target, in texels. Matches the face layout in the GL spec
+vec3 GetDirection(vec2 coord, int face) {
+	vec2 st = coord / float(u_TargetSize) * 2.0 - 1.0;
+	vec3 result;
+	switch (face) {
+		case 0:  result = vec3( 1.0,  -st.y, -st.x); break;
+		case 1:  result = vec3(-1.0,  -st.y,  st.x); break;
+		case 2:  result = vec3( st.x,  1.0,   st.y); break;
+		case 3:  result = vec3( st.x, -1.0,  -st.y); break;
+		case 4:  result = vec3( st.x, -st.y,  1.0);  break;
+		default: result = vec3(-st.x, -st.y, -1.0);  break;
+	}
+	return normalize(result);
+}
+
+// Builds a basis around N, so that samples generated around +Z can be turned to face along it
+mat3 GetBasis(vec3 N) {
+	vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+	vec3 tangent = normalize(cross(up, N));
+	return mat3(tangent, cross(N, tangent), N);
+}
+
+// A low discrepancy sequence, covers the square more evenly than random numbers would for the same sample count
+vec2 Hammersley(uint ix, uint count) {
+	return vec2(float(ix) / float(count), float(bitfieldReverse(ix)) * 2.3283064365386963e-10);
+}
+
+// Picks the mip of the source whose texels cover about the same solid angle as a sample with the given pdf. Reading
+// that level instead of the top one lets a few samples stand in for the whole lobe without sparkling
+float GetSourceLod(float pdf, uint sampleCount) {
+	float texelAngle  = 4.0 * PI / (6.0 * u_SourceSize * u_SourceSize);
+	float sampleAngle = 1.0 / (float(sampleCount) * pdf + 0.0001);
+	return max(0.5 * log2(sampleAngle / texelAngle) + 1.0, 0.0);
+}
+
+void main() {
+	ivec3 id = ivec3(gl_GlobalInvocationID);
+	if (id.x >= u_TargetSize || id.y >= u_TargetSize) {
+		return;
+	}
+
+	vec3 result = vec3(0.0);
+#if defined(DOWNSAMPLE)
+	// The source's top level is usually a lot bigger than the target, so we take a grid of taps across the texel
+	const int TAPS = 4;
+	for (int y = 0; y < TAPS; y++) {
+		for (int x = 0; x < TAPS; x++) {
+			vec2 coord = vec2(id.xy) + (vec2(x, y) + 0.5) / float(TAPS);
+			result += textureLod(s_Source, GetDirection(coord, id.z), 0.0).rgb;
+		}
+	}
+	result /= float(TAPS * TAPS);
+
+#elif defined(SPECULAR)
+	// The view is assumed to look straight down the normal, so the lobe is the same shape in every direction and
+	// the reflection vector can be used to look it up
+	const uint SAMPLE_COUNT = 64u;
+	vec3  N = GetDirection(vec2(id.xy) + 0.5, id.z);
+	mat3  basis = GetBasis(N);
+	float alpha2 = u_Roughness * u_Roughness * u_Roughness * u_Roughness;
+	float weight = 0.0;
+	for (uint ix = 0u; ix < SAMPLE_COUNT; ix++) {
+		vec2  xi = Hammersley(ix, SAMPLE_COUNT);
+		float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (alpha2 - 1.0) * xi.y));
+		float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+		float phi = 2.0 * PI * xi.x;
+		vec3  H = basis * vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+		vec3  L = reflect(-N, H);
+		float NdotL = dot(N, L);
+		if (NdotL > 0.0) {
+			// With the view along the normal, the pdf of L is D(H) / 4
+			float denom = cosTheta * cosTheta * (alpha2 - 1.0) + 1.0;
+			float pdf = alpha2 / (PI * denom * denom) * 0.25;
+			result += textureLod(s_Source, L, GetSourceLod(pdf, SAMPLE_COUNT)).rgb * NdotL;
+			weight += NdotL;
+		}
+	}
+	result /= max(weight, 0.0001);
+
+#elif defined(IRRADIANCE)
+	// Samples are spread by the cosine lobe, so it cancels out of the estimate and we can just average them
+	const uint SAMPLE_COUNT = 256u;
+	vec3 N = GetDirection(vec2(id.xy) + 0.5, id.z);
+	mat3 basis = GetBasis(N);
+	for (uint ix = 0u; ix < SAMPLE_COUNT; ix++) {
+		vec2  xi = Hammersley(ix, SAMPLE_COUNT);
+		float cosTheta = sqrt(1.0 - xi.y);
+		float sinTheta = sqrt(xi.y);
+		float phi = 2.0 * PI * xi.x;
+		vec3  L = basis * vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+		result += textureLod(s_Source, L, GetSourceLod(cosTheta / PI, SAMPLE_COUNT)).rgb;
+	}
+	result /= float(SAMPLE_COUNT);
+#endif
+
+	imageStore(u_Target, id, vec4(result, 1.0));
+}
@@ -1,4 +1,4 @@
-#version 410
+#version 430
 
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inColor;
@@ -11,69 +11,74 @@ uniform sampler2D s_Specular;
 
 // 
 uniform sampler2D s_Reflectivity;
+// Prefiltered by EnvironmentPrefilter, each mip of s_Environment is blurred for a rougher surface than the last, and
+// s_Irradiance holds the diffuse light coming from each direction
 uniform samplerCube s_Environment;
+uniform samplerCube s_Irradiance;
 uniform mat3 u_EnvironmentRotation;
 
-uniform vec3  u_AmbientCol;
-uniform float u_AmbientStrength;
-
-uniform vec3  u_LightPos;
-uniform vec3  u_LightCol;
-uniform float u_AmbientLightStrength;
-uniform float u_SpecularLightStrength;
 uniform float u_Shininess;
-// NEW in week 7, see https://learnopengl.com/Lighting/Light-casters for a good reference on how this all works, or
-// https://developer.valvesoftware.com/wiki/Constant-Linear-Quadratic_Falloff
-uniform float u_LightAttenuationConstant;
-uniform float u_LightAttenuationLinear;
-uniform float u_LightAttenuationQuadratic;
 
 uniform float u_TextureMix;
 
-uniform vec3  u_CamPos;
+// Pulls in the frame data as well
+#include "include/lighting.glsl"
 
 out vec4 frag_color;
 
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
 void main() {
-	// Lecture 5
-	vec3 ambient = u_AmbientLightStrength * u_LightCol;
-
-	// Diffuse
 	vec3 N = normalize(inNormal);
 	vec3 toEye = normalize(inPos - u_CamPos);
 	vec3 reflected = reflect(toEye, N);
-	vec3 lightDir = normalize(u_LightPos - inPos);
+	vec3 viewDir = -toEye;
+	// Get the specular power from the specular map
+	float texSpec = texture(s_Specular, inUV).x;
 
-	float dif = max(dot(N, lightDir), 0.0);
-	vec3 diffuse = dif * u_LightCol;// add diffuse intensity
+	// Lecture 5, summed over every light in our cluster
+	vec3 lighting = vec3(0.0);
+	// Creases and corners only see part of the light that comes from all around
+	float occlusion = GetAmbientOcclusion(inPos);
+	uint cluster = GetCluster(inPos);
+	uint first = cluster * u_MaxClusterLights;
+	uint count = u_ClusterLightCounts[cluster];
+	for (uint ix = 0; ix < count; ix++) {
+		LightData light = u_Lights[u_ClusterLightIndices[first + ix]];
 
-	//Attenuation
-	float dist = length(u_LightPos - inPos);
-	float attenuation = 1.0f / (
-		u_LightAttenuationConstant + 
-		u_LightAttenuationLinear * dist +
-		u_LightAttenuationQuadratic * dist * dist);
+		vec3  toLight  = light.Position - inPos;
+		float dist     = length(toLight);
+		vec3  lightDir = light.Type == LIGHT_DIRECTIONAL ? -light.Direction : toLight / dist;
 
-	// Specular
-	vec3 viewDir  = normalize(u_CamPos - inPos);
-	vec3 h        = normalize(lightDir + viewDir);
+		vec3 ambient = light.AmbientStrength * light.Color * occlusion;
 
-	// Get the specular power from the specular map
-	float texSpec = texture(s_Specular, inUV).x;
-	float spec = pow(max(dot(N, h), 0.0), u_Shininess); // Shininess coefficient (can be a uniform)
-	vec3 specular = u_SpecularLightStrength * texSpec * spec * u_LightCol; // Can also use a specular color
+		// Diffuse
+		float dif = max(dot(N, lightDir), 0.0);
+		vec3 diffuse = dif * light.Color;// add diffuse intensity
+
+		// Specular
+		vec3 h = normalize(lightDir + viewDir);
+		float spec = pow(max(dot(N, h), 0.0), u_Shininess); // Shininess coefficient (can be a uniform)
+		vec3 specular = light.SpecularStrength * texSpec * spec * light.Color; // Can also use a specular color
+
+		// Shadows only block the light coming straight from the light, the ambient part still gets through
+		float shadow = GetShadow(light, inPos, N, lightDir);
+		lighting += (ambient + (diffuse + specular) * shadow) * GetAttenuation(light, lightDir, dist);
+	}
 
 	// Get the albedo from the diffuse / albedo map
 	vec4 textureColor1 = texture(s_Diffuse, inUV);
 	vec4 textureColor2 = texture(s_Diffuse2, inUV);
 	vec4 textureColor = mix(textureColor1, textureColor2, u_TextureMix);
 
-	vec3 environment = texture(s_Environment, u_EnvironmentRotation * reflected).rgb;
+	// Blinn-Phong exponents map to a roughness of (2 / (n + 2)) ^ 1/4, which picks the mip blurred to match our highlight
+	float roughness = pow(2.0 / (u_Shininess + 2.0), 0.25);
+	float lod = roughness * float(textureQueryLevels(s_Environment) - 1);
+	vec3 environment = textureLod(s_Environment, u_EnvironmentRotation * reflected, lod).rgb;
+	vec3 irradiance = texture(s_Irradiance, u_EnvironmentRotation * N).rgb;
 
 	vec3 result = (
-		(u_AmbientCol * u_AmbientStrength) + // global ambient light
-		(ambient + diffuse + specular) * attenuation // light factors from our single light
+		(u_AmbientCol * u_AmbientStrength * irradiance * occlusion) + // global ambient light, tinted by the environment
+		lighting // light factors from the lights in our cluster
 		) * inColor * textureColor.rgb; // Object color
 
 	vec3 outColor = mix(result, environment, texture(s_Reflectivity, inUV).r);
@@ -1,39 +1,189 @@
-#version 410
+#version 430
 
+// With bindless textures each material keeps it's texture handles in the material buffer, so materials with
+// different textures can still be drawn together
+#ifdef GL_ARB_bindless_texture
+#extension GL_ARB_bindless_texture : require
+#define BINDLESS
+#endif
+
+// The deferred lighting pass is drawn full screen, and reads the surface from the G-buffer instead
+#ifndef DEFERRED_LIGHTING
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV;
+layout(location = 4) flat in uint inMaterialIndex;
+layout(location = 5) flat in vec3 inOrigin;
+#ifdef NORMAL_MAP
+layout(location = 10) in vec4 inTangent;
+#endif
+#endif
+
+// With IMPOSTOR defined the surface comes from an atlas of views baked around a mesh (see Impostor), drawn on a quad
+// by impostor.vert.glsl. The atlases are laid out the same as the G-buffer
+#ifdef IMPOSTOR
+layout(location = 6) flat in vec4 inImpostorFrame;
+layout(location = 7) flat in mat3 inImpostorNormalMatrix;
+uniform sampler2D s_ImpostorAlbedo;
+uniform sampler2D s_ImpostorNormal;
+uniform float     u_ImpostorFrames;
+#endif
 
+// With DIFFUSE_ARRAY defined, the diffuse map is a layer of a texture array shared by all our materials (see
+// TextureArrayBuilder), so materials that only differ in their diffuse map can be drawn together without bindless
+#ifndef BINDLESS
+#ifdef DIFFUSE_ARRAY
+uniform sampler2DArray s_DiffuseArray;
+#else
 uniform sampler2D s_Diffuse;
+#endif
 uniform sampler2D s_Diffuse2;
 uniform sampler2D s_Specular;
+#ifdef NORMAL_MAP
+uniform sampler2D s_NormalMap;
+#endif
+#endif
+
+// With LIGHTMAPPED defined the ambient and diffuse light from the scene's lights were baked into an atlas shared by all
+// the static geometry (see Lightmapper), so the full lighting model is a single fetch. The specular isn't baked, since
+// it depends on where the camera is. The other lighting modes are for looking at each term on it's own, so they still
+// loop over the lights
+#ifdef LIGHTMAPPED
+layout(location = 6) in vec2 inLightmapUV;
+uniform sampler2D s_Lightmap;
+#if !defined(LIGHTING_OFF) && !defined(AMBIENT_ONLY) && !defined(SPECULAR_ONLY) && !defined(AMBIENT_SPECULAR) && !defined(TOON)
+#define BAKED_LIGHTING
+#endif
+#endif
+
+// With VIRTUAL_TEXTURE defined the diffuse map is a virtual texture laid over the ground from above (see
+// VirtualTexture), only the pages that have been seen recently are in it's cache. Each texel of the page table points
+// at where it's page is in the cache, or the closest coarser page that is, and the page we wanted gets written to the
+// feedback image so it can be loaded. Depth is tested first so hidden ground doesn't ask for pages
+#ifdef VIRTUAL_TEXTURE
+layout(early_fragment_tests) in;
+uniform sampler2D s_VirtualPageTable;
+uniform sampler2D s_VirtualCache;
+// The corner of the area the texture covers with the smallest X and Y, and one over the length of it's sides
+uniform vec4 u_VirtualRegion;
+// The size of the largest level in texels, the size of a page, the border around each page, and the coarsest level
+uniform vec4 u_VirtualInfo;
+// One over the size of the cache, how many times smaller the feedback is than the view, and which pixel of each
+// block of the view writes it's request this frame
+uniform vec4 u_VirtualCache;
+// Must match VIRTUAL_FEEDBACK_IMAGE in UniformBlocks.h
+layout(r32ui, binding = 7) uniform writeonly uimage2D u_VirtualFeedback;
 
-uniform vec3  u_AmbientCol;
-uniform float u_AmbientStrength;
+vec4 SampleVirtual(vec2 uv) {
+	// The level comes from how many of the largest level's texels the pixel covers
+	vec2 texels = uv * u_VirtualInfo.x;
+	vec2 dx = dFdx(texels);
+	vec2 dy = dFdy(texels);
+	int level = int(clamp(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy)))), 0.0, u_VirtualInfo.w));
+	uv = clamp(uv, 0.0, 0.999999);
+	int pages = int(u_VirtualInfo.x / u_VirtualInfo.y) >> level;
+	ivec2 page = ivec2(uv * float(pages));
 
-uniform vec3  u_LightPos;
-uniform vec3  u_LightCol;
-uniform float u_AmbientLightStrength;
-uniform float u_SpecularLightStrength;
-uniform float u_Shininess;
-// NEW in week 7, see https://learnopengl.com/Lighting/Light-casters for a good reference on how this all works, or
-// https://developer.valvesoftware.com/wiki/Constant-Linear-Quadratic_Falloff
-uniform float u_LightAttenuationConstant;
-uniform float u_LightAttenuationLinear;
-uniform float u_LightAttenuationQuadratic;
+	// Must match the keys in VirtualTexture
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	int scale = int(u_VirtualCache.y);
+	if (all(equal(pixel % scale, ivec2(u_VirtualCache.zw)))) {
+		imageStore(u_VirtualFeedback, pixel / scale, uvec4((uint(level) << 28) | (uint(page.y) << 14) | uint(page.x)));
+	}
+
+	// The page we got may be coarser than the one we wanted, so we find where we are in it's level
+	uvec3 entry = uvec3(texelFetch(s_VirtualPageTable, page, level).rgb * 255.0 + 0.5);
+	vec2 inPage = fract(uv * (u_VirtualInfo.x / u_VirtualInfo.y / exp2(float(entry.b))));
+	vec2 cached = vec2(entry.rg) * (u_VirtualInfo.y + 2.0 * u_VirtualInfo.z) + u_VirtualInfo.z + inPage * u_VirtualInfo.y;
+	return textureLod(s_VirtualCache, cached * u_VirtualCache.x, 0.0);
+}
+#endif
 
-uniform float u_TextureMix;
+// The values that differ between our materials come from the shared material buffer (see MaterialBuffer), the
+// members are named after the uniforms they replace so that materials can set them the same way
+struct MaterialData {
+#ifdef BINDLESS
+#ifdef DIFFUSE_ARRAY
+	sampler2DArray s_DiffuseArray;
+#else
+	sampler2D s_Diffuse;
+#endif
+	sampler2D s_Diffuse2;
+	sampler2D s_Specular;
+#endif
+	float u_Shininess;
+	float u_TextureMix;
+#ifdef DIFFUSE_ARRAY
+	// The layer of s_DiffuseArray that holds this material's diffuse map
+	float u_DiffuseLayer;
+#endif
+	// The distances over which a mesh with DITHER_FADE defined fades out, and it's impostor fades in. The two switch
+	// over at once if the ends are the same, and nothing fades while they're both zero
+	vec2  u_FadeRange;
+#if defined(BINDLESS) && defined(NORMAL_MAP)
+	// Last, so the members before it line up with the materials that don't have one
+	sampler2D s_NormalMap;
+#endif
+};
 
-uniform vec3  u_CamPos;
+layout(std430, binding = 1) readonly buffer b_MaterialData {
+	MaterialData u_Materials[];
+};
 
-uniform int u_lightoff;
-uniform int u_ambient;
-uniform int u_specular;
-uniform int u_ambientspecular;
-uniform int u_ambientspeculartoon;
+// Pulls in the frame data as well
+#include "include/lighting.glsl"
 
+// The lighting mode is picked by compiling with one of these defined (see ShaderVariants), if none are defined
+// we use the full lighting model
+// LIGHTING_OFF, AMBIENT_ONLY, SPECULAR_ONLY, AMBIENT_SPECULAR, TOON
+//
+// For deferred shading (see DeferredShading) the geometry gets drawn with GBUFFER defined, which writes the surface
+// out instead of lighting it, then a full screen pass with DEFERRED_LIGHTING defined lights every pixel once
+//
+// Blended materials that don't get sorted (see WeightedBlending) draw with WEIGHTED_BLEND defined, which adds the lit
+// color into the accumulation and revealage targets instead of writing it
+
+#ifdef GBUFFER
+layout(location = 0) out vec4 gb_AlbedoSpecular;
+layout(location = 1) out vec4 gb_NormalShininess;
+#elif defined(WEIGHTED_BLEND)
+layout(location = 0) out vec4  oit_Accumulation;
+layout(location = 1) out float oit_Revealage;
+#else
 out vec4 frag_color;
+#endif
+
+#ifdef DEFERRED_LIGHTING
+// Must match the units in UniformBlocks.h
+layout(binding = 27) uniform sampler2D s_GBufferAlbedo;
+layout(binding = 28) uniform sampler2D s_GBufferNormal;
+layout(binding = 29) uniform sampler2D s_GBufferDepth;
+#endif
+
+// Shininess gets stored as it's log, so the whole useful range fits in the G-buffer
+const float MAX_SHININESS_LOG2 = 11.0;
+
+// Octahedral normal packing, folds the unit sphere onto a square so a normal fits in two channels
+// See https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+vec2 EncodeNormal(vec3 n) {
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signs;
+}
+
+vec3 DecodeNormal(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+	return normalize(n);
+}
+
+// Interleaved gradient noise, a dither pattern without visible repeats
+// See http://www.iryoku.com/next-generation-post-processing-in-call-of-duty-advanced-warfare
+float GetDither() {
+	return fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+}
 
 //Add stuff for toon shading
 const int bands = 5;
@@ -41,65 +191,203 @@ const float scaling = 1.0/bands;
 
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
 void main() {
-	// Lecture 5
-	vec3 ambient = u_AmbientLightStrength * u_LightCol;
+	// The surface we're lighting, either straight from the material or read back from the G-buffer
+	vec3  pos;
+	vec3  N;
+	vec3  albedo;
+	float alpha;
+	float texSpec;
+	float shininess;
+#ifdef DEFERRED_LIGHTING
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	float depth = texelFetch(s_GBufferDepth, texel, 0).r;
+	// Nothing was drawn here, so we leave it for the skybox
+	if (depth >= 1.0) {
+		discard;
+	}
+	// Anything drawn forward after us still needs to be depth tested against the scene
+	gl_FragDepth = depth;
+	vec4 albedoSpecular = texelFetch(s_GBufferAlbedo, texel, 0);
+	vec4 normalShininess = texelFetch(s_GBufferNormal, texel, 0);
 
-	// Diffuse
-	vec3 N = normalize(inNormal);
-	vec3 lightDir = normalize(u_LightPos - inPos);
+	// Rebuild the position from the depth, the view matrix is rigid so it's inverse is just it's transpose
+	vec4 viewPos = u_InverseProjection * vec4(gl_FragCoord.xy / u_ScreenSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	pos = transpose(mat3(u_View)) * (viewPos.xyz / viewPos.w - u_View[3].xyz);
+	N = DecodeNormal(normalShininess.xy * 2.0 - 1.0);
+	albedo = albedoSpecular.rgb;
+	alpha = 1.0;
+	texSpec = albedoSpecular.a;
+	shininess = exp2(normalShininess.z * MAX_SHININESS_LOG2);
+#else
+	MaterialData material = u_Materials[inMaterialIndex];
+#if defined(DITHER_FADE) || defined(IMPOSTOR)
+	// Between the ends of the fade range the mesh and it's impostor both get drawn, with opposite halves of the same
+	// dither so that each pixel only keeps one of them
+	if (material.u_FadeRange.y > 0.0) {
+		float dist = distance(u_CamPos, inOrigin);
+		float fade = material.u_FadeRange.y > material.u_FadeRange.x ?
+			clamp((dist - material.u_FadeRange.x) / (material.u_FadeRange.y - material.u_FadeRange.x), 0.0, 1.0) :
+			step(material.u_FadeRange.x, dist);
+#ifdef IMPOSTOR
+		if (fade <= GetDither()) {
+			discard;
+		}
+#else
+		if (fade > GetDither()) {
+			discard;
+		}
+#endif
+	}
+#endif
+#ifdef IMPOSTOR
+	// Blend the four closest views by how far between them the camera is. The views are blank outside of the mesh, so
+	// dividing through by the coverage keeps the edges from going dark
+	vec4 albedoSpecular = vec4(0.0);
+	vec4 normalShininess = vec4(0.0);
+	for (int ix = 0; ix < 4; ix++) {
+		vec2 offset = vec2(ix & 1, ix >> 1);
+		vec2 weights = mix(1.0 - inImpostorFrame.zw, inImpostorFrame.zw, offset);
+		vec2 uv = (inImpostorFrame.xy + offset + clamp(inUV, 0.0, 1.0)) / u_ImpostorFrames;
+		albedoSpecular += texture(s_ImpostorAlbedo, uv) * weights.x * weights.y;
+		normalShininess += texture(s_ImpostorNormal, uv) * weights.x * weights.y;
+	}
+	if (normalShininess.w < 0.5) {
+		discard;
+	}
+	albedoSpecular /= normalShininess.w;
+	normalShininess /= normalShininess.w;
 
-	float dif = max(dot(N, lightDir), 0.0);
-	vec3 diffuse = dif * u_LightCol;// add diffuse intensity
+	pos = inPos;
+	N = normalize(inImpostorNormalMatrix * DecodeNormal(normalShininess.xy * 2.0 - 1.0));
+	albedo = albedoSpecular.rgb;
+	alpha = 1.0;
+	texSpec = albedoSpecular.a;
+	shininess = exp2(normalShininess.z * MAX_SHININESS_LOG2);
+#else
+#ifdef BINDLESS
+	sampler2D diffuseMap2 = material.s_Diffuse2;
+	sampler2D specularMap = material.s_Specular;
+#else
+	#define diffuseMap2 s_Diffuse2
+	#define specularMap s_Specular
+#endif
+#if defined(NORMAL_MAP) && defined(BINDLESS)
+	sampler2D normalMap = material.s_NormalMap;
+#elif defined(NORMAL_MAP)
+	#define normalMap s_NormalMap
+#endif
+#if defined(VIRTUAL_TEXTURE)
+	// The virtual texture is laid over the world from above, so it doesn't use the mesh's UVs
+	#define sampleDiffuse(uv) SampleVirtual((inPos.xy - u_VirtualRegion.xy) * u_VirtualRegion.z)
+#elif defined(DIFFUSE_ARRAY) && defined(BINDLESS)
+	#define sampleDiffuse(uv) texture(material.s_DiffuseArray, vec3(uv, material.u_DiffuseLayer))
+#elif defined(DIFFUSE_ARRAY)
+	#define sampleDiffuse(uv) texture(s_DiffuseArray, vec3(uv, material.u_DiffuseLayer))
+#elif defined(BINDLESS)
+	#define sampleDiffuse(uv) texture(material.s_Diffuse, uv)
+#else
+	#define sampleDiffuse(uv) texture(s_Diffuse, uv)
+#endif
 
-	if(u_ambientspeculartoon == 1){
-		diffuse = floor(diffuse * bands) * scaling;
+	// Lecture 5
+	pos = inPos;
+	N = normalize(inNormal);
+#ifdef NORMAL_MAP
+	// The same reconstruction MikkTSpace bakes against: the bitangent is rebuilt from the interpolated vectors before
+	// any of them get normalized. Vertices without a tangent keep the vertex normal
+	if (dot(inTangent.xyz, inTangent.xyz) > 1e-8) {
+		vec3 bitangent = inTangent.w * cross(inNormal, inTangent.xyz);
+		vec3 tangentNormal = texture(normalMap, inUV).xyz * 2.0 - 1.0;
+		N = normalize(tangentNormal.x * inTangent.xyz + tangentNormal.y * bitangent + tangentNormal.z * inNormal);
 	}
+#endif
+	// Get the specular power from the specular map
+	texSpec = texture(specularMap, inUV).x;
+	shininess = material.u_Shininess;
 
-	//Attenuation
-	float dist = length(u_LightPos - inPos);
-	float attenuation = 1.0f / (
-		u_LightAttenuationConstant + 
-		u_LightAttenuationLinear * dist +
-		u_LightAttenuationQuadratic * dist * dist);
+	// Get the albedo from the diffuse / albedo map
+	vec4 textureColor1 = sampleDiffuse(inUV);
+	vec4 textureColor2 = texture(diffuseMap2, inUV);
+	vec4 textureColor = mix(textureColor1, textureColor2, material.u_TextureMix);
+	albedo = inColor * textureColor.rgb;
+	alpha = textureColor.a;
+#endif
+#endif
 
-	// Specular
-	vec3 viewDir  = normalize(u_CamPos - inPos);
-	vec3 h        = normalize(lightDir + viewDir);
+#ifdef GBUFFER
+	gb_AlbedoSpecular = vec4(albedo, texSpec);
+	// The alpha marks that something was drawn, which impostor atlases use for their coverage
+	gb_NormalShininess = vec4(EncodeNormal(N) * 0.5 + 0.5, log2(clamp(shininess, 1.0, 2048.0)) / MAX_SHININESS_LOG2, 1.0);
+#else
+	vec3 viewDir = normalize(u_CamPos - pos);
 
-	// Get the specular power from the specular map
-	float texSpec = texture(s_Specular, inUV).x;
-	float spec = pow(max(dot(N, h), 0.0), u_Shininess); // Shininess coefficient (can be a uniform)
-	vec3 specular = u_SpecularLightStrength * texSpec * spec * u_LightCol; // Can also use a specular color
+	// The light factors from every light in our cluster, each already scaled by it's attenuation
+	vec3 ambient  = vec3(0.0);
+	vec3 diffuse  = vec3(0.0);
+	vec3 specular = vec3(0.0);
+#if !defined(LIGHTING_OFF) && !defined(BAKED_LIGHTING)
+	uint cluster = GetCluster(pos);
+	uint first = cluster * u_MaxClusterLights;
+	uint count = u_ClusterLightCounts[cluster];
+	for (uint ix = 0; ix < count; ix++) {
+		LightData light = u_Lights[u_ClusterLightIndices[first + ix]];
 
-	// Get the albedo from the diffuse / albedo map
-	vec4 textureColor1 = texture(s_Diffuse, inUV);
-	vec4 textureColor2 = texture(s_Diffuse2, inUV);
-	vec4 textureColor = mix(textureColor1, textureColor2, u_TextureMix);
+		vec3  toLight  = light.Position - pos;
+		float dist     = length(toLight);
+		vec3  lightDir = light.Type == LIGHT_DIRECTIONAL ? -light.Direction : toLight / dist;
+		float attenuation = GetAttenuation(light, lightDir, dist);
+		// Shadows only block the light coming straight from the light, the ambient part still gets through
+		float shadow = GetShadow(light, pos, N, lightDir);
 
-	vec3 result = (
-		(u_AmbientCol * u_AmbientStrength) + // global ambient light
-		(ambient + diffuse + specular) * attenuation // light factors from our single light
-		) * inColor * textureColor.rgb; // Object color
+		// Diffuse
+		float dif = max(dot(N, lightDir), 0.0);
+		vec3 lightDiffuse = dif * light.Color;// add diffuse intensity
+#ifdef TOON
+		lightDiffuse = floor(lightDiffuse * bands) * scaling;
+#endif
 
-	if(u_lightoff == 1){
-		result =  inColor * textureColor.rgb;
-	}
-	
-	if(u_ambient == 1){
-		result = ((ambient) * attenuation) * inColor * textureColor.rgb;
-	}
-	
-	if(u_specular == 1){
-		result = ((specular) * attenuation) * inColor * textureColor.rgb;
-	}
-	
-	if(u_ambientspecular == 1){
-		 result = ((ambient + specular) * attenuation) * inColor * textureColor.rgb;
-	}
-	
-	if(u_ambientspeculartoon == 1){
-		 result = ((u_AmbientCol * u_AmbientStrength) + (ambient + diffuse + specular) * attenuation) * inColor * textureColor.rgb;
+		// Specular
+		vec3 h = normalize(lightDir + viewDir);
+		float spec = pow(max(dot(N, h), 0.0), shininess); // Shininess coefficient (can be a uniform)
+
+		ambient  += light.AmbientStrength * light.Color * attenuation;
+		diffuse  += lightDiffuse * attenuation * shadow;
+		specular += light.SpecularStrength * texSpec * spec * light.Color * attenuation * shadow; // Can also use a specular color
 	}
+#endif
+
+#if !defined(LIGHTING_OFF)
+	// Creases and corners only see part of the light that comes from all around
+	float occlusion = GetAmbientOcclusion(pos);
+	ambient *= occlusion;
+#endif
+
+#if defined(LIGHTING_OFF)
+	vec3 result = albedo;
+#elif defined(AMBIENT_ONLY)
+	vec3 result = (ambient) * albedo;
+#elif defined(SPECULAR_ONLY)
+	vec3 result = (specular) * albedo;
+#elif defined(AMBIENT_SPECULAR)
+	vec3 result = (ambient + specular) * albedo;
+#elif defined(BAKED_LIGHTING)
+	vec3 result = ((u_AmbientCol * u_AmbientStrength * occlusion) + texture(s_Lightmap, inLightmapUV).rgb) * albedo;
+#else
+	// Note that toon shading uses the full model, with the banded diffuse from above
+	vec3 result = (
+		(u_AmbientCol * u_AmbientStrength * occlusion) + // global ambient light
+		(ambient + diffuse + specular) // light factors from the lights in our cluster
+		) * albedo; // Object color
+#endif
 
-	frag_color = vec4(result, textureColor.a);
-}
\ No newline at end of file
+#ifdef WEIGHTED_BLEND
+	// McGuire and Bavoil's depth weight, nearer and more opaque fragments count for more in the average. The clamp
+	// keeps the sums inside what the half floats can hold
+	float weight = clamp(pow(min(1.0, alpha * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+	oit_Accumulation = vec4(result * alpha, alpha) * weight;
+	oit_Revealage = alpha;
+#else
+	frag_color = vec4(result, alpha);
+#endif
+#endif
+}
@@ -1,14 +1,17 @@
-#version 410
+#version 430
 
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV;
 
+// Prefiltered by EnvironmentPrefilter, each mip is blurred for a rougher surface than the last
 uniform samplerCube s_Environment;
 uniform mat3 u_EnvironmentRotation;
+// 0 is a perfect mirror, 1 picks the blurriest mip
+uniform float u_Roughness;
 
-uniform vec3  u_CamPos;
+#include "include/frame_data.glsl"
 
 out vec4 frag_color;
 
@@ -19,8 +22,9 @@ void main() {
 	vec3 toEye = normalize(inPos - u_CamPos);
 	vec3 reflected = reflect(toEye, N);
 
-	// Look up the environment texture
-	vec3 environment = texture(s_Environment, u_EnvironmentRotation * reflected).rgb;
+	// Look up the environment texture, the blur for our roughness is already baked into the mips
+	float lod = u_Roughness * float(textureQueryLevels(s_Environment) - 1);
+	vec3 environment = textureLod(s_Environment, u_EnvironmentRotation * reflected, lod).rgb;
 
 	// For now just return the result, fully reflective!
 	frag_color = vec4(environment, 1.0);
@@ -0,0 +1,67 @@
+#version 430
+
+// Draws a mesh that's far away as a quad facing the camera, textured from an atlas of views baked around the mesh
+// (see Impostor). The views sit on an octahedral grid of directions, the four closest to the camera get picked here
+// and blended in the fragment shader (frag_blinn_phong_textured.glsl with IMPOSTOR defined)
+
+// The quad, with corners from -1 to 1 in x and y
+layout(location = 0) in vec3 inPosition;
+
+// Per-instance data, see InstanceTransform in VertexTypes.h
+layout(location = 4) in mat4 inModel;
+layout(location = 8) in mat3 inNormalMatrix;
+layout(location = 11) in uint inMaterialIndex;
+
+layout(location = 0) out vec3 outPos;
+layout(location = 1) out vec3 outColor;
+layout(location = 2) out vec3 outNormal;
+layout(location = 3) out vec2 outUV;
+layout(location = 4) flat out uint outMaterialIndex;
+layout(location = 5) flat out vec3 outOrigin;
+// The grid position of the first of the four views to blend, and how far towards the next ones the camera is
+layout(location = 6) flat out vec4 outImpostorFrame;
+// The baked normals are in the mesh's space
+layout(location = 7) flat out mat3 outImpostorNormalMatrix;
+
+#include "include/frame_data.glsl"
+
+// The bounding sphere the views were baked around, in the mesh's space
+uniform vec3  u_ImpostorCenter;
+uniform float u_ImpostorRadius;
+// The number of views along each side of the atlas
+uniform float u_ImpostorFrames;
+
+// Must match the encoding in Impostor.cpp, folds the unit sphere onto a square
+vec2 EncodeOctahedron(vec3 n) {
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signs;
+}
+
+void main() {
+	vec3 center = (inModel * vec4(u_ImpostorCenter, 1.0)).xyz;
+	// The direction to the camera in the mesh's space, the inverse of the model's rotation and scale is the transpose
+	// of the normal matrix
+	vec3 dir = normalize(transpose(inNormalMatrix) * (u_CamPos - center));
+
+	// Must match the basis the views were baked with
+	vec3 reference = abs(dir.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+	vec3 right = normalize(cross(reference, dir));
+	vec3 up = cross(dir, right);
+	vec3 local = u_ImpostorCenter + (right * inPosition.x + up * inPosition.y) * u_ImpostorRadius;
+
+	vec4 worldPos = inModel * vec4(local, 1.0);
+	outPos = worldPos.xyz;
+	gl_Position = u_ViewProjection * worldPos;
+
+	vec2 grid = (EncodeOctahedron(dir) * 0.5 + 0.5) * (u_ImpostorFrames - 1.0);
+	vec2 first = min(floor(grid), vec2(u_ImpostorFrames - 2.0));
+	outImpostorFrame = vec4(first, grid - first);
+	outImpostorNormalMatrix = inNormalMatrix;
+
+	outNormal = inNormalMatrix * dir;
+	outUV = inPosition.xy * 0.5 + 0.5;
+	outColor = vec3(1.0);
+	outMaterialIndex = inMaterialIndex;
+	outOrigin = inModel[3].xyz;
+}
@@ -0,0 +1,9 @@
+// The values shared by everything drawn in a frame, must match FrameData in UniformBlocks.h
+layout(std140, binding = 0) uniform b_FrameData {
+	mat4  u_View;
+	mat4  u_Projection;
+	mat4  u_ViewProjection;
+	mat4  u_SkyboxMatrix;
+	vec3  u_CamPos;
+	float u_Time;
+};
@@ -0,0 +1,38 @@
+// The frame's lights and how the view is split into clusters, shared by the pass that bins the lights into the
+// clusters and the shaders that light with them (see lighting.glsl)
+
+// Must match LightData in UniformBlocks.h
+struct LightData {
+	vec3  Position;
+	float Range;
+	vec3  Color;
+	uint  Type;
+	vec3  Direction;
+	float CosOuterAngle;
+	vec3  Attenuation;
+	float CosInnerAngle;
+	float AmbientStrength;
+	float SpecularStrength;
+	int   ShadowIndex;
+};
+
+// Must match LightType in Light.h
+const uint LIGHT_POINT       = 0;
+const uint LIGHT_SPOT        = 1;
+const uint LIGHT_DIRECTIONAL = 2;
+
+layout(std140, binding = 1) uniform b_ClusterData {
+	mat4  u_InverseProjection;
+	uvec4 u_ClusterGrid;
+	vec2  u_ScreenSize;
+	float u_SliceScale;
+	float u_SliceBias;
+	float u_NearPlane;
+	float u_FarPlane;
+	uint  u_LightCount;
+	uint  u_MaxClusterLights;
+};
+
+layout(std430, binding = 6) readonly buffer b_Lights {
+	LightData u_Lights[];
+};
@@ -0,0 +1,111 @@
+#include "frame_data.glsl"
+#include "light_data.glsl"
+
+// The lights are binned into clusters of the view each frame (see ClusteredLighting), so we only need to loop over the
+// lights in the fragment's cluster. See https://learnopengl.com/Lighting/Light-casters for a good reference on how
+// the attenuation and spot light cones work, or https://developer.valvesoftware.com/wiki/Constant-Linear-Quadratic_Falloff
+layout(std430, binding = 7) readonly buffer b_ClusterLightCounts {
+	uint u_ClusterLightCounts[];
+};
+
+layout(std430, binding = 8) readonly buffer b_ClusterLightIndices {
+	uint u_ClusterLightIndices[];
+};
+
+// Finds the cluster that this fragment falls in, from it's position on screen and it's depth in the view
+uint GetCluster(vec3 pos) {
+	float depth = max(-(u_View * vec4(pos, 1.0)).z, u_NearPlane);
+	uvec3 coord = uvec3(
+		uvec2(gl_FragCoord.xy / u_ScreenSize * vec2(u_ClusterGrid.xy)),
+		uint(max(log(depth) * u_SliceScale + u_SliceBias, 0.0)));
+	coord = min(coord, u_ClusterGrid.xyz - 1u);
+	return coord.x + u_ClusterGrid.x * (coord.y + u_ClusterGrid.y * coord.z);
+}
+
+// How much of a light reaches this fragment, from it's distance and (for spot lights) the angle to it's axis.
+// Directional lights are the same everywhere
+float GetAttenuation(LightData light, vec3 lightDir, float dist) {
+	if (light.Type == LIGHT_DIRECTIONAL) {
+		return 1.0;
+	}
+	float attenuation = 1.0 / dot(light.Attenuation, vec3(1.0, dist, dist * dist));
+	if (light.Type == LIGHT_SPOT) {
+		attenuation *= smoothstep(light.CosOuterAngle, light.CosInnerAngle, dot(-lightDir, light.Direction));
+	}
+	return attenuation;
+}
+
+// Must match ShadowData in UniformBlocks.h
+layout(std140, binding = 2) uniform b_ShadowData {
+	mat4  u_CascadeViewProjection[4];
+	vec4  u_CascadeSplits;
+	uint  u_CascadeCount;
+	float u_ShadowDepthBias;
+	float u_ShadowNormalBias;
+};
+
+// Must match SceneLighting in UniformBlocks.h
+layout(std140, binding = 3) uniform b_SceneLighting {
+	vec3  u_AmbientCol;
+	float u_AmbientStrength;
+};
+
+// The shadow maps rendered by ShadowMaps, see SHADOW_CASCADE_UNIT and POINT_SHADOW_UNIT in UniformBlocks.h
+layout(binding = 30) uniform sampler2DArrayShadow  s_ShadowCascades;
+layout(binding = 31) uniform samplerCubeArrayShadow s_PointShadows;
+
+// How much of a light isn't blocked by a shadow caster on the way to this fragment, 1 if it's fully lit. The sample
+// point gets pushed out along the normal so surfaces facing away from the light don't shadow themselves
+float GetShadow(LightData light, vec3 pos, vec3 N, vec3 lightDir) {
+	if (light.ShadowIndex < 0) {
+		return 1.0;
+	}
+	float slope = 1.0 - max(dot(N, lightDir), 0.0);
+	if (light.Type == LIGHT_DIRECTIONAL) {
+		// Pick the first cascade that covers the fragment's depth in the view
+		float depth = -(u_View * vec4(pos, 1.0)).z;
+		uint cascade = 0;
+		while (cascade < u_CascadeCount && depth > u_CascadeSplits[cascade]) {
+			cascade++;
+		}
+		if (cascade >= u_CascadeCount) {
+			return 1.0;
+		}
+		// Further cascades have bigger texels, so they need a bigger offset
+		float scale = u_CascadeSplits[cascade] / u_CascadeSplits[0];
+		vec3 samplePos = pos + N * u_ShadowNormalBias * slope * scale;
+		vec4 coord = u_CascadeViewProjection[cascade] * vec4(samplePos, 1.0);
+		coord.xyz = coord.xyz / coord.w * 0.5 + 0.5;
+		return texture(s_ShadowCascades, vec4(coord.xy, float(cascade), coord.z - u_ShadowDepthBias * scale));
+	} else {
+		// The cube maps store the distance to the light over it's range
+		vec3 samplePos = pos + N * u_ShadowNormalBias * slope;
+		vec3 fromLight = samplePos - light.Position;
+		return texture(s_PointShadows, vec4(fromLight, float(light.ShadowIndex)), length(fromLight) / light.Range - u_ShadowDepthBias);
+	}
+}
+
+// The half resolution ambient occlusion worked out by AmbientOcclusion, the red channel holds how much ambient light
+// gets through and the green holds the linear depth it was worked out at. Must match AMBIENT_OCCLUSION_UNIT in
+// UniformBlocks.h
+layout(binding = 25) uniform sampler2D s_AmbientOcclusion;
+
+// How much of the ambient light reaches this fragment. The four nearest texels of the occlusion get blended like a
+// bilinear filter would, except that any that are at a different depth than the fragment are left out, so the
+// occlusion doesn't bleed across edges. Anything that none of them match (ex: something transparent, or another view
+// where a 1x1 white texture is bound) is left unoccluded
+float GetAmbientOcclusion(vec3 pos) {
+	vec2 size = vec2(textureSize(s_AmbientOcclusion, 0));
+	vec2 texel = gl_FragCoord.xy / u_ScreenSize * size - 0.5;
+	vec2 f = fract(texel);
+	// The gather picks up the 2x2 texels around this point, in the order (0, 1), (1, 1), (1, 0), (0, 0)
+	vec2 uv = (floor(texel) + 1.0) / size;
+	vec4 occlusion = textureGather(s_AmbientOcclusion, uv, 0);
+	vec4 depths = textureGather(s_AmbientOcclusion, uv, 1);
+
+	float depth = -(u_View * vec4(pos, 1.0)).z;
+	vec4 weights = vec4((1.0 - f.x) * f.y, f.x * f.y, f.x * (1.0 - f.y), (1.0 - f.x) * (1.0 - f.y));
+	weights *= max(1.0 - abs(depths - depth) / (depth * 0.1), 0.0);
+	float totalWeight = dot(weights, vec4(1.0));
+	return totalWeight > 1e-4 ? dot(occlusion, weights) / totalWeight : 1.0;
+}
@@ -0,0 +1,9 @@
+// Declares a constant that's set when the program loads instead of being written into the source, see
+// Shader::LoadSpecialized. Cooked to SPIR-V it's a specialization constant with the given id, and the default is used
+// for anything the program doesn't set. Compiled from GLSL the value comes from the SPEC_[name] define instead, which
+// the program always passes in
+#ifdef GL_SPIRV
+#define SPECIALIZATION_CONSTANT(id, type, name, value) layout(constant_id = id) const type name = value
+#else
+#define SPECIALIZATION_CONSTANT(id, type, name, value) const type name = SPEC_##name
+#endif
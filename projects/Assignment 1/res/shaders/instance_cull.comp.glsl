@@ -0,0 +1,145 @@
+#version 460
+
+// Culls every instance in a batch, and writes a draw command at the right level of detail for each one that might be
+// visible (see InstanceCuller). Each invocation handles one instance, big batches spill over into the y work groups
+layout(local_size_x = 64) in;
+
+// Must match DrawElementsIndirectCommand in IndirectBuffer.h
+struct DrawCommand {
+	uint Count;
+	uint InstanceCount;
+	uint FirstIndex;
+	int  BaseVertex;
+	uint BaseInstance;
+};
+
+#include "include/frame_data.glsl"
+
+// Must match InstanceCuller::MAX_LEVELS
+const int MAX_LEVELS = 8;
+
+// Last frame's depth pyramid, each texel holds the farthest depth under it. Must match DEPTH_PYRAMID_UNIT
+layout(binding = 26) uniform sampler2D s_DepthPyramid;
+
+// The batch's instance buffer, InstanceTransform isn't a valid std430 struct (the mat3 would get padded) so we read
+// it as plain floats: a mat4, a mat3 and the material index
+layout(std430, binding = 3) readonly buffer b_Instances {
+	float u_Instances[];
+};
+layout(std430, binding = 4) writeonly buffer b_Commands {
+	DrawCommand u_Commands[];
+};
+layout(std430, binding = 5) buffer b_Counts {
+	uint u_Counts[];
+};
+
+const uint INSTANCE_STRIDE = 26;
+
+// The frustum planes as (normal, distance), with the normals pointing inwards
+uniform vec4  u_FrustumPlanes[6];
+// The first index and index count of each level in the arena, full detail first, and how far each one's surface is
+// from the full detail mesh relative to it's size
+uniform ivec2 u_LevelRanges[MAX_LEVELS];
+uniform float u_LevelErrors[MAX_LEVELS];
+uniform int   u_LevelCount;
+// How far an instance has to be, relative to it's radius and a level's error, to be drawn at that level
+uniform float u_LodScale;
+uniform int   u_BaseVertex;
+// Each instance's bounding sphere in it's own space, and the distances from the camera it's drawn between
+uniform vec4  u_Bounds;
+uniform vec2  u_DrawRange;
+uniform int   u_InstanceCount;
+uniform int   u_BaseInstance;
+// Where this batch's commands start, and which counter holds the number of commands written
+uniform int   u_FirstCommand;
+uniform int   u_CountIndex;
+// Whether to test against the depth pyramid, and the view-projection it was drawn with
+uniform int   u_OcclusionCulling;
+uniform mat4  u_OcclusionViewProjection;
+uniform int   u_PyramidLevels;
+
+// Returns true if the sphere was completely hidden behind what was drawn into the depth pyramid. The sphere's box
+// gets projected onto the screen, and it's nearest depth tested against the level where it covers at most 2x2 texels
+bool IsOccluded(vec3 center, float radius) {
+	vec2 rectMin = vec2(1.0);
+	vec2 rectMax = vec2(0.0);
+	float nearest = 1.0;
+	for (int ix = 0; ix < 8; ix++) {
+		vec3 corner = center + radius * vec3((ix & 1) != 0 ? 1.0 : -1.0, (ix & 2) != 0 ? 1.0 : -1.0, (ix & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = u_OcclusionViewProjection * vec4(corner, 1.0);
+		// Anything poking through the near plane could be anywhere on screen
+		if (clip.w <= 1e-5) {
+			return false;
+		}
+		vec3 ndc = clip.xyz / clip.w;
+		rectMin = min(rectMin, ndc.xy * 0.5 + 0.5);
+		rectMax = max(rectMax, ndc.xy * 0.5 + 0.5);
+		nearest = min(nearest, ndc.z * 0.5 + 0.5);
+	}
+	// The pyramid only knows about what was on screen when it was drawn
+	if (any(lessThan(rectMin, vec2(0.0))) || any(greaterThan(rectMax, vec2(1.0)))) {
+		return false;
+	}
+
+	vec2 size = (rectMax - rectMin) * vec2(textureSize(s_DepthPyramid, 0));
+	int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0, u_PyramidLevels - 1);
+	ivec2 levelSize = textureSize(s_DepthPyramid, level);
+	ivec2 first = min(ivec2(rectMin * vec2(levelSize)), levelSize - 1);
+	ivec2 last = min(ivec2(rectMax * vec2(levelSize)), levelSize - 1);
+	float farthest = max(
+		max(texelFetch(s_DepthPyramid, first, level).r, texelFetch(s_DepthPyramid, ivec2(last.x, first.y), level).r),
+		max(texelFetch(s_DepthPyramid, ivec2(first.x, last.y), level).r, texelFetch(s_DepthPyramid, last, level).r));
+	return nearest > farthest;
+}
+
+void main() {
+	uint local = gl_GlobalInvocationID.x + gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x;
+	if (local >= uint(u_InstanceCount)) {
+		return;
+	}
+	uint instance = uint(u_BaseInstance) + local;
+
+	// Only the model matrix is needed, the bounds don't care which way the normals point
+	uint base = instance * INSTANCE_STRIDE;
+	mat4 model;
+	for (int col = 0; col < 4; col++) {
+		model[col] = vec4(u_Instances[base + col * 4 + 0], u_Instances[base + col * 4 + 1], u_Instances[base + col * 4 + 2], u_Instances[base + col * 4 + 3]);
+	}
+
+	// The largest scale axis keeps the sphere conservative under non-uniform scales
+	vec3 center = (model * vec4(u_Bounds.xyz, 1.0)).xyz;
+	float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+	float radius = u_Bounds.w * scale;
+
+	// Skip instances that are entirely nearer or farther than the batch is drawn (ex: past an impostor's fade)
+	float distance = length(center - u_CamPos.xyz);
+	if (distance + radius < u_DrawRange.x || distance - radius > u_DrawRange.y) {
+		return;
+	}
+
+	// Skip instances that are completely outside of any of the planes
+	for (int ix = 0; ix < 6; ix++) {
+		if (dot(u_FrustumPlanes[ix].xyz, center) + u_FrustumPlanes[ix].w < -radius) {
+			return;
+		}
+	}
+
+	// Skip instances that were hidden behind last frame's depth, this is the priciest test so it goes last
+	if (u_OcclusionCulling != 0 && IsOccluded(center, radius)) {
+		return;
+	}
+
+	// Pick the coarsest level whose error stays under the limit, the same as RendererComponent::UpdateLod
+	float nearest = max(distance - radius, 1e-3);
+	int level = 0;
+	for (int ix = 1; ix < u_LevelCount; ix++) {
+		if (u_LevelErrors[ix] * radius * u_LodScale > nearest) {
+			break;
+		}
+		level = ix;
+	}
+
+	uint slot = atomicAdd(u_Counts[u_CountIndex], 1);
+	ivec2 range = u_LevelRanges[level];
+	u_Commands[uint(u_FirstCommand) + slot] = DrawCommand(uint(range.y), 1, uint(range.x), u_BaseVertex, instance);
+}
@@ -0,0 +1,88 @@
+#version 430
+
+// Bins the frame's lights into the clusters of the view (see ClusteredLighting). The view is split into tiles on screen,
+// and each tile into exponentially spaced depth slices. Each invocation handles one cluster, working out it's view space
+// bounds and testing every light's sphere of influence against them. The lights get loaded into shared memory a group
+// at a time, so each one is only read from the light buffer once per work group
+// The size of the groups comes from ClusteredLighting, as a specialization constant when we're cooked to SPIR-V
+#ifdef GL_SPIRV
+layout(local_size_x = 64, local_size_x_id = 0) in;
+const uint GROUP_SIZE = gl_WorkGroupSize.x;
+#else
+layout(local_size_x = SPEC_GROUP_SIZE) in;
+const uint GROUP_SIZE = SPEC_GROUP_SIZE;
+#endif
+
+#include "include/frame_data.glsl"
+#include "include/light_data.glsl"
+
+layout(std430, binding = 7) writeonly buffer b_ClusterLightCounts {
+	uint u_ClusterLightCounts[];
+};
+
+layout(std430, binding = 8) writeonly buffer b_ClusterLightIndices {
+	uint u_ClusterLightIndices[];
+};
+
+// The view space position (xyz) and range (w) of the lights in the batch we're testing
+shared vec4 s_Lights[GROUP_SIZE];
+
+// Finds the view space point at a given depth along the line through a point on the screen. Going through the inverse
+// projection means this works for orthographic views as well as perspective ones
+vec3 PointAtDepth(vec2 ndc, float depth) {
+	vec4 nearPoint = u_InverseProjection * vec4(ndc, -1.0, 1.0);
+	vec4 farPoint  = u_InverseProjection * vec4(ndc,  1.0, 1.0);
+	vec3 a = nearPoint.xyz / nearPoint.w;
+	vec3 b = farPoint.xyz / farPoint.w;
+	return mix(a, b, (-depth - a.z) / (b.z - a.z));
+}
+
+void main() {
+	uint cluster = gl_GlobalInvocationID.x;
+	// The last group may run past the end of the grid, those invocations still need to help load the lights
+	bool isCluster = cluster < u_ClusterGrid.x * u_ClusterGrid.y * u_ClusterGrid.z;
+
+	// Work out the cluster's view space bounds from it's tile and depth slice
+	uvec3 coord = uvec3(cluster % u_ClusterGrid.x, (cluster / u_ClusterGrid.x) % u_ClusterGrid.y, cluster / (u_ClusterGrid.x * u_ClusterGrid.y));
+	vec2 tileMin = vec2(coord.xy) / vec2(u_ClusterGrid.xy) * 2.0 - 1.0;
+	vec2 tileMax = vec2(coord.xy + 1u) / vec2(u_ClusterGrid.xy) * 2.0 - 1.0;
+	float depthRatio = u_FarPlane / u_NearPlane;
+	float nearDepth = u_NearPlane * pow(depthRatio, float(coord.z) / float(u_ClusterGrid.z));
+	float farDepth  = u_NearPlane * pow(depthRatio, float(coord.z + 1u) / float(u_ClusterGrid.z));
+	vec3 minBounds = vec3( 1.0e30);
+	vec3 maxBounds = vec3(-1.0e30);
+	for (int corner = 0; corner < 4; corner++) {
+		vec2 ndc = vec2((corner & 1) == 0 ? tileMin.x : tileMax.x, (corner & 2) == 0 ? tileMin.y : tileMax.y);
+		vec3 front = PointAtDepth(ndc, nearDepth);
+		vec3 back  = PointAtDepth(ndc, farDepth);
+		minBounds = min(minBounds, min(front, back));
+		maxBounds = max(maxBounds, max(front, back));
+	}
+
+	uint first = cluster * u_MaxClusterLights;
+	uint count = 0;
+	for (uint base = 0; base < u_LightCount; base += GROUP_SIZE) {
+		uint light = base + gl_LocalInvocationIndex;
+		if (light < u_LightCount) {
+			s_Lights[gl_LocalInvocationIndex] = vec4((u_View * vec4(u_Lights[light].Position, 1.0)).xyz, u_Lights[light].Range);
+		}
+		barrier();
+
+		// Spot lights are tested with the sphere around their whole range, the fragments sort out their cones
+		uint batchSize = min(GROUP_SIZE, u_LightCount - base);
+		for (uint ix = 0; isCluster && ix < batchSize && count < u_MaxClusterLights; ix++) {
+			vec4 sphere = s_Lights[ix];
+			vec3 offset = clamp(sphere.xyz, minBounds, maxBounds) - sphere.xyz;
+			if (dot(offset, offset) <= sphere.w * sphere.w) {
+				u_ClusterLightIndices[first + count] = base + ix;
+				count++;
+			}
+		}
+		// Everyone needs to be done with this batch before the next one overwrites it
+		barrier();
+	}
+
+	if (isCluster) {
+		u_ClusterLightCounts[cluster] = count;
+	}
+}
@@ -0,0 +1,156 @@
+#version 460
+
+// Culls the meshlets of one mesh for every instance in a batch, and writes a draw command for each cluster that might
+// be visible (see MeshletCuller). Each invocation handles one meshlet of one instance, the y work group is the instance
+layout(local_size_x = 64) in;
+
+// Must match Meshlet in MeshletBuffer.h
+struct Meshlet {
+	vec3  Center;
+	float Radius;
+	vec3  ConeApex;
+	uint  VertexCount;
+	vec3  ConeAxis;
+	float ConeCutoff;
+	uint  FirstIndex;
+	uint  IndexCount;
+	uint  Padding[2];
+};
+
+// Must match DrawElementsIndirectCommand in IndirectBuffer.h
+struct DrawCommand {
+	uint Count;
+	uint InstanceCount;
+	uint FirstIndex;
+	int  BaseVertex;
+	uint BaseInstance;
+};
+
+#include "include/frame_data.glsl"
+
+// Last frame's depth pyramid, each texel holds the farthest depth under it. Must match DEPTH_PYRAMID_UNIT
+layout(binding = 26) uniform sampler2D s_DepthPyramid;
+
+layout(std430, binding = 2) readonly buffer b_Meshlets {
+	Meshlet u_Meshlets[];
+};
+// The frame's instance buffer, InstanceTransform isn't a valid std430 struct (the mat3 would get padded) so we read
+// it as plain floats: a mat4, a mat3 and the material index
+layout(std430, binding = 3) readonly buffer b_Instances {
+	float u_Instances[];
+};
+layout(std430, binding = 4) writeonly buffer b_Commands {
+	DrawCommand u_Commands[];
+};
+layout(std430, binding = 5) buffer b_Counts {
+	uint u_Counts[];
+};
+
+const uint INSTANCE_STRIDE = 26;
+
+// The frustum planes as (normal, distance), with the normals pointing inwards
+uniform vec4 u_FrustumPlanes[6];
+uniform int  u_MeshletCount;
+uniform int  u_BaseInstance;
+// Where the mesh lives in the arena, the meshlets' index ranges are relative to this
+uniform int  u_FirstIndex;
+uniform int  u_BaseVertex;
+// Where this batch's commands start, and which counter holds the number of commands written
+uniform int  u_FirstCommand;
+uniform int  u_CountIndex;
+// Whether to test against the depth pyramid, and the view-projection it was drawn with
+uniform int  u_OcclusionCulling;
+uniform mat4 u_OcclusionViewProjection;
+uniform int  u_PyramidLevels;
+
+// Returns true if the sphere was completely hidden behind what was drawn into the depth pyramid. The sphere's box
+// gets projected onto the screen, and it's nearest depth tested against the level where it covers at most 2x2 texels
+bool IsOccluded(vec3 center, float radius) {
+	vec2 rectMin = vec2(1.0);
+	vec2 rectMax = vec2(0.0);
+	float nearest = 1.0;
+	for (int ix = 0; ix < 8; ix++) {
+		vec3 corner = center + radius * vec3((ix & 1) != 0 ? 1.0 : -1.0, (ix & 2) != 0 ? 1.0 : -1.0, (ix & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = u_OcclusionViewProjection * vec4(corner, 1.0);
+		// Anything poking through the near plane could be anywhere on screen
+		if (clip.w <= 1e-5) {
+			return false;
+		}
+		vec3 ndc = clip.xyz / clip.w;
+		rectMin = min(rectMin, ndc.xy * 0.5 + 0.5);
+		rectMax = max(rectMax, ndc.xy * 0.5 + 0.5);
+		nearest = min(nearest, ndc.z * 0.5 + 0.5);
+	}
+	// The pyramid only knows about what was on screen when it was drawn
+	if (any(lessThan(rectMin, vec2(0.0))) || any(greaterThan(rectMax, vec2(1.0)))) {
+		return false;
+	}
+
+	vec2 size = (rectMax - rectMin) * vec2(textureSize(s_DepthPyramid, 0));
+	int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0, u_PyramidLevels - 1);
+	ivec2 levelSize = textureSize(s_DepthPyramid, level);
+	ivec2 first = min(ivec2(rectMin * vec2(levelSize)), levelSize - 1);
+	ivec2 last = min(ivec2(rectMax * vec2(levelSize)), levelSize - 1);
+	float farthest = max(
+		max(texelFetch(s_DepthPyramid, first, level).r, texelFetch(s_DepthPyramid, ivec2(last.x, first.y), level).r),
+		max(texelFetch(s_DepthPyramid, ivec2(first.x, last.y), level).r, texelFetch(s_DepthPyramid, last, level).r));
+	return nearest > farthest;
+}
+
+void main() {
+	uint meshletIx = gl_GlobalInvocationID.x;
+	if (meshletIx >= uint(u_MeshletCount)) {
+		return;
+	}
+	uint instance = uint(u_BaseInstance) + gl_WorkGroupID.y;
+	Meshlet meshlet = u_Meshlets[meshletIx];
+
+	uint base = instance * INSTANCE_STRIDE;
+	mat4 model;
+	for (int col = 0; col < 4; col++) {
+		model[col] = vec4(u_Instances[base + col * 4 + 0], u_Instances[base + col * 4 + 1], u_Instances[base + col * 4 + 2], u_Instances[base + col * 4 + 3]);
+	}
+	mat3 normalMatrix;
+#ifdef DERIVE_NORMAL_MATRIX
+	// Same as the vertex shader, the cofactor matrix points the same way as the inverse transpose
+	normalMatrix = mat3(cross(model[1].xyz, model[2].xyz), cross(model[2].xyz, model[0].xyz), cross(model[0].xyz, model[1].xyz));
+	normalMatrix *= sign(dot(model[0].xyz, normalMatrix[0]));
+#else
+	for (int col = 0; col < 3; col++) {
+		normalMatrix[col] = vec3(u_Instances[base + 16 + col * 3 + 0], u_Instances[base + 16 + col * 3 + 1], u_Instances[base + 16 + col * 3 + 2]);
+	}
+#endif
+
+	// Skip clusters that are completely outside of any of the planes, the largest scale axis keeps the sphere
+	// conservative under non-uniform scales
+	vec3 center = (model * vec4(meshlet.Center, 1.0)).xyz;
+	float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+	float radius = meshlet.Radius * scale;
+	for (int ix = 0; ix < 6; ix++) {
+		if (dot(u_FrustumPlanes[ix].xyz, center) + u_FrustumPlanes[ix].w < -radius) {
+			return;
+		}
+	}
+
+	// Skip clusters where every triangle faces away from the camera. The cone is only exact for rotations and uniform
+	// scales, but props are rarely stretched far enough for that to matter
+	if (meshlet.ConeCutoff <= 1.0) {
+		vec3 apex = (model * vec4(meshlet.ConeApex, 1.0)).xyz;
+		vec3 axis = normalize(normalMatrix * meshlet.ConeAxis);
+		// Mirroring transforms swap which side of the triangles the rasterizer thinks is the front
+		if (determinant(mat3(model)) < 0.0) {
+			axis = -axis;
+		}
+		if (dot(normalize(apex - u_CamPos), axis) >= meshlet.ConeCutoff) {
+			return;
+		}
+	}
+
+	// Skip clusters that were hidden behind last frame's depth, this is the priciest test so it goes last
+	if (u_OcclusionCulling != 0 && IsOccluded(center, radius)) {
+		return;
+	}
+
+	uint slot = atomicAdd(u_Counts[u_CountIndex], 1);
+	u_Commands[uint(u_FirstCommand) + slot] = DrawCommand(meshlet.IndexCount, 1, uint(u_FirstIndex) + meshlet.FirstIndex, u_BaseVertex, instance);
+}
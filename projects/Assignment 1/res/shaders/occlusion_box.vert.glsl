@@ -0,0 +1,16 @@
+#version 430
+
+// Draws a world space box for an occlusion query (see OcclusionQueries), as a 14 vertex triangle strip with no
+// vertex inputs. Each bit of the masks says whether that vertex of the strip is on the max side of the box on the
+// x, y or z axis
+
+#include "include/frame_data.glsl"
+
+uniform vec3 u_BoxMin;
+uniform vec3 u_BoxMax;
+
+void main() {
+	uint bit = 1u << uint(gl_VertexID);
+	vec3 corner = vec3((0x287Au & bit) != 0u, (0x02AFu & bit) != 0u, (0x31E3u & bit) != 0u);
+	gl_Position = u_ViewProjection * vec4(mix(u_BoxMin, u_BoxMax, corner), 1.0);
+}
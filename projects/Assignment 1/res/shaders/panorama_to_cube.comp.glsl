@@ -0,0 +1,71 @@
+#version 430
+
+// Fills a level of a cube map from an equirectangular panorama (see PanoramaConverter). Each invocation fills one
+// texel of one face, with SHARED_EXPONENT defined the cube map is RGB9_E5 and gets written through an R32UI view
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+layout(binding = 0) uniform sampler2D s_Panorama;
+#if defined(SHARED_EXPONENT)
+layout(r32ui, binding = 0) uniform writeonly uimageCube u_Target;
+#else
+layout(rgba8, binding = 0) uniform writeonly imageCube u_Target;
+#endif
+
+// The size of a face of the level being written
+uniform int   u_TargetSize;
+// The mip of the panorama with about the same texel size as the level being written
+uniform float u_SourceLod;
+
+const float PI = 3.14159265359;
+
+// Gets the direction through a point on a face of the target, in texels. Matches the face layout in the GL spec
+vec3 GetDirection(vec2 coord, int face) {
+	vec2 st = coord / float(u_TargetSize) * 2.0 - 1.0;
+	vec3 result;
+	switch (face) {
+		case 0:  result = vec3( 1.0,  -st.y, -st.x); break;
+		case 1:  result = vec3(-1.0,  -st.y,  st.x); break;
+		case 2:  result = vec3( st.x,  1.0,   st.y); break;
+		case 3:  result = vec3( st.x, -1.0,  -st.y); break;
+		case 4:  result = vec3( st.x, -st.y,  1.0);  break;
+		default: result = vec3(-st.x, -st.y, -1.0);  break;
+	}
+	return normalize(result);
+}
+
+// Packs a color the way GL_RGB9_E5 stores it, see "Shared Exponent Texture Color Conversion" in the GL spec. The three
+// 9 bit mantissas share the exponent of the brightest channel
+uint PackSharedExponent(vec3 color) {
+	// The largest value the format can hold, (2^9 - 1) / 2^9 * 2^(31 - 15)
+	const float MAX_VALUE = 65408.0;
+	vec3 clamped = clamp(color, 0.0, MAX_VALUE);
+	float brightest = max(clamped.r, max(clamped.g, clamped.b));
+	int exponent = max(-16, int(floor(log2(max(brightest, 1e-30))))) + 1 + 15;
+	float scale = exp2(float(exponent - 15 - 9));
+	// Rounding can carry the brightest channel over 9 bits, in which case it needs the next exponent up
+	if (floor(brightest / scale + 0.5) >= 512.0) {
+		exponent++;
+		scale *= 2.0;
+	}
+	uvec3 mantissa = uvec3(floor(clamped / scale + 0.5));
+	return mantissa.r | (mantissa.g << 9) | (mantissa.b << 18) | (uint(exponent) << 27);
+}
+
+void main() {
+	ivec3 id = ivec3(gl_GlobalInvocationID);
+	if (id.x >= u_TargetSize || id.y >= u_TargetSize) {
+		return;
+	}
+
+	// The panorama's columns go around the horizon and it's rows from straight down to straight up (our images are
+	// loaded bottom row first)
+	vec3 dir = GetDirection(vec2(id.xy) + 0.5, id.z);
+	vec2 uv = vec2(atan(dir.z, dir.x) / (2.0 * PI) + 0.5, asin(clamp(dir.y, -1.0, 1.0)) / PI + 0.5);
+	vec3 color = textureLod(s_Panorama, uv, u_SourceLod).rgb;
+
+#if defined(SHARED_EXPONENT)
+	imageStore(u_Target, id, uvec4(PackSharedExponent(color)));
+#else
+	imageStore(u_Target, id, vec4(color, 1.0));
+#endif
+}
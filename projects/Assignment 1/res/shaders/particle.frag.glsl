@@ -0,0 +1,15 @@
+#version 430
+
+// A soft round sprite, the emitter's blend mode decides how it goes over the scene (see ParticleSystem)
+layout(location = 0) in vec4 inColor;
+layout(location = 1) in vec2 inUV;
+
+out vec4 frag_color;
+
+void main() {
+	float falloff = 1.0 - dot(inUV, inUV);
+	if (falloff <= 0.0) {
+		discard;
+	}
+	frag_color = vec4(inColor.rgb, inColor.a * smoothstep(0.0, 0.5, falloff));
+}
@@ -0,0 +1,54 @@
+#version 430
+
+// Draws each of an emitter's live particles as a quad facing the camera (see ParticleSystem). There's no vertex
+// buffer, the corners come from the vertex ID of a 4 vertex triangle strip and the particle from the instance ID
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec2 outUV;
+
+// Must match GpuParticle in ParticleSystem.cpp
+struct Particle {
+	vec3  Position;
+	float Age;
+	vec3  Velocity;
+	float Lifetime;
+	float Hue;
+	uint  Padding[3];
+};
+
+#include "include/frame_data.glsl"
+
+layout(std430, binding = 2) readonly buffer b_Particles {
+	Particle u_Particles[];
+};
+// The survivors from this frame's simulation, sorted back to front for blended emitters
+layout(std430, binding = 5) readonly buffer b_Alive {
+	uint u_Alive[];
+};
+
+uniform vec4 u_StartColor;
+uniform vec4 u_EndColor;
+uniform vec2 u_Size;
+
+// Turns a color around the grey axis of the RGB cube, by a fraction of a full turn
+vec3 ShiftHue(vec3 color, float turns) {
+	const vec3 axis = vec3(0.57735027);
+	float angle = turns * 6.28318530718;
+	float c = cos(angle);
+	return color * c + cross(axis, color) * sin(angle) + axis * dot(axis, color) * (1.0 - c);
+}
+
+void main() {
+	Particle particle = u_Particles[u_Alive[gl_InstanceID]];
+	float t = clamp(particle.Age / particle.Lifetime, 0.0, 1.0);
+
+	// The rows of the view's rotation are the camera's axes in world space
+	vec3 right = vec3(u_View[0][0], u_View[1][0], u_View[2][0]);
+	vec3 up = vec3(u_View[0][1], u_View[1][1], u_View[2][1]);
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+	float halfSize = mix(u_Size.x, u_Size.y, t) * 0.5;
+	gl_Position = u_ViewProjection * vec4(particle.Position + (right * corner.x + up * corner.y) * halfSize, 1.0);
+
+	vec4 color = mix(u_StartColor, u_EndColor, t);
+	outColor = vec4(max(ShiftHue(color.rgb, particle.Hue), 0.0), color.a);
+	outUV = corner;
+}
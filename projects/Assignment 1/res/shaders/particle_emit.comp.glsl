@@ -0,0 +1,100 @@
+#version 430
+
+// Spawns an emitter's new particles (see ParticleSystem). Each invocation pops a free slot off the dead list, fills
+// in a particle leaving the emitter and appends it to the alive list, so it gets simulated along with the rest
+layout(local_size_x = 64) in;
+
+// Must match GpuParticle in ParticleSystem.cpp
+struct Particle {
+	vec3  Position;
+	float Age;
+	vec3  Velocity;
+	float Lifetime;
+	float Hue;
+	uint  Padding[3];
+};
+
+layout(std430, binding = 2) writeonly buffer b_Particles {
+	Particle u_Particles[];
+};
+layout(std430, binding = 3) readonly buffer b_Dead {
+	uint u_Dead[];
+};
+layout(std430, binding = 4) writeonly buffer b_AliveIn {
+	uint u_AliveIn[];
+};
+// Must match ParticleCounters in ParticleSystem.cpp
+layout(std430, binding = 6) buffer b_Counters {
+	uint u_DeadCount;
+	uint u_AliveCount;
+	uint u_EmitCount;
+	uint u_Padding;
+	uint u_EmitArgs[3];
+	uint u_SimulateArgs[3];
+	uint u_DrawArgs[4];
+};
+
+// Changes every frame, so each frame's particles get their own random numbers
+uniform int   u_Seed;
+// In world space, the direction is normalized
+uniform vec3  u_EmitterPosition;
+uniform float u_EmitRadius;
+uniform vec3  u_Direction;
+// The cosine of the spread's half angle
+uniform float u_SpreadCos;
+uniform vec2  u_Speed;
+uniform vec2  u_Lifetime;
+uniform float u_HueVariation;
+
+const float TWO_PI = 6.28318530718;
+
+// PCG hash, see Scatter.cpp
+uint Hash(uint value) {
+	uint state = value * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+// Steps the state along and returns a float from 0 to 1
+float Random(inout uint state) {
+	state = Hash(state);
+	return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+// A direction picked evenly from the cap of the unit sphere around +Z with the given minimum Z
+vec3 RandomInCap(inout uint state, float minZ) {
+	float z = mix(minZ, 1.0, Random(state));
+	float angle = Random(state) * TWO_PI;
+	float r = sqrt(max(1.0 - z * z, 0.0));
+	return vec3(r * cos(angle), r * sin(angle), z);
+}
+
+void main() {
+	uint id = gl_GlobalInvocationID.x;
+	if (id >= u_EmitCount) {
+		return;
+	}
+	// The kickoff made sure there are at least as many free slots as we're emitting
+	uint index = u_Dead[atomicAdd(u_DeadCount, 0xFFFFFFFFu) - 1u];
+	uint state = Hash(id ^ Hash(uint(u_Seed)));
+
+	// Turn the cone around +Z to face down the emitter's direction
+	vec3 reference = abs(u_Direction.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+	vec3 tangent = normalize(cross(reference, u_Direction));
+	vec3 bitangent = cross(u_Direction, tangent);
+	vec3 local = RandomInCap(state, u_SpreadCos);
+	vec3 direction = tangent * local.x + bitangent * local.y + u_Direction * local.z;
+	// The cube root spreads the starting points evenly through the sphere, rather than bunching them in the middle
+	vec3 offset = RandomInCap(state, -1.0) * u_EmitRadius * pow(Random(state), 1.0 / 3.0);
+
+	Particle particle;
+	particle.Position = u_EmitterPosition + offset;
+	particle.Age = 0.0;
+	particle.Velocity = direction * mix(u_Speed.x, u_Speed.y, Random(state));
+	particle.Lifetime = mix(u_Lifetime.x, u_Lifetime.y, Random(state));
+	particle.Hue = (Random(state) - 0.5) * u_HueVariation;
+	particle.Padding = uint[3](0u, 0u, 0u);
+	u_Particles[index] = particle;
+
+	u_AliveIn[atomicAdd(u_AliveCount, 1u)] = index;
+}
@@ -0,0 +1,38 @@
+#version 430
+
+// Starts an emitter's frame on the GPU (see ParticleSystem), so the CPU never needs to know how many particles are
+// alive. Last frame's survivors become this frame's particles to simulate, and the emit and simulate passes get sized
+// for their indirect dispatches. Runs as a single invocation
+layout(local_size_x = 1) in;
+
+// Must match ParticleCounters in ParticleSystem.cpp
+layout(std430, binding = 6) buffer b_Counters {
+	uint u_DeadCount;
+	uint u_AliveCount;
+	uint u_EmitCount;
+	uint u_Padding;
+	uint u_EmitArgs[3];
+	uint u_SimulateArgs[3];
+	// Count, instance count, first and base instance. The instance count doubles as the number of survivors
+	uint u_DrawArgs[4];
+};
+
+// Must match local_size_x in particle_emit.comp.glsl and particle_simulate.comp.glsl
+const uint GROUP_SIZE = 64;
+
+// The number of particles the CPU would like to emit this frame
+uniform int u_EmitRequest;
+
+void main() {
+	u_AliveCount = u_DrawArgs[1];
+	u_DrawArgs[1] = 0;
+	// We can only emit as many particles as there are free slots
+	u_EmitCount = min(uint(u_EmitRequest), u_DeadCount);
+
+	u_EmitArgs[0] = (u_EmitCount + GROUP_SIZE - 1) / GROUP_SIZE;
+	u_EmitArgs[1] = 1;
+	u_EmitArgs[2] = 1;
+	u_SimulateArgs[0] = (u_AliveCount + u_EmitCount + GROUP_SIZE - 1) / GROUP_SIZE;
+	u_SimulateArgs[1] = 1;
+	u_SimulateArgs[2] = 1;
+}
@@ -0,0 +1,79 @@
+#version 430
+
+// Moves an emitter's particles along by a frame (see ParticleSystem). Particles that have lived out their lifetime
+// go back on the dead list, the rest get appended to the other alive list, which is drawn from and becomes next
+// frame's list to simulate. The draw's instance count is the survivor counter, so the draw always matches
+layout(local_size_x = 64) in;
+
+// Must match GpuParticle in ParticleSystem.cpp
+struct Particle {
+	vec3  Position;
+	float Age;
+	vec3  Velocity;
+	float Lifetime;
+	float Hue;
+	uint  Padding[3];
+};
+
+#include "include/frame_data.glsl"
+
+layout(std430, binding = 2) buffer b_Particles {
+	Particle u_Particles[];
+};
+layout(std430, binding = 3) writeonly buffer b_Dead {
+	uint u_Dead[];
+};
+layout(std430, binding = 4) readonly buffer b_AliveIn {
+	uint u_AliveIn[];
+};
+layout(std430, binding = 5) writeonly buffer b_AliveOut {
+	uint u_AliveOut[];
+};
+// Must match ParticleCounters in ParticleSystem.cpp
+layout(std430, binding = 6) buffer b_Counters {
+	uint u_DeadCount;
+	uint u_AliveCount;
+	uint u_EmitCount;
+	uint u_Padding;
+	uint u_EmitArgs[3];
+	uint u_SimulateArgs[3];
+	uint u_DrawArgs[4];
+};
+// Only written for emitters that get sorted, the survivors' distances from the camera
+layout(std430, binding = 7) writeonly buffer b_Keys {
+	uint u_Keys[];
+};
+
+uniform float u_DeltaTime;
+uniform vec3  u_Gravity;
+uniform float u_Drag;
+uniform int   u_Sorted;
+
+void main() {
+	uint id = gl_GlobalInvocationID.x;
+	if (id >= u_AliveCount) {
+		return;
+	}
+	uint index = u_AliveIn[id];
+	Particle particle = u_Particles[index];
+
+	particle.Age += u_DeltaTime;
+	if (particle.Age >= particle.Lifetime) {
+		u_Dead[atomicAdd(u_DeadCount, 1u)] = index;
+		return;
+	}
+	particle.Velocity += u_Gravity * u_DeltaTime;
+	particle.Velocity *= max(1.0 - u_Drag * u_DeltaTime, 0.0);
+	particle.Position += particle.Velocity * u_DeltaTime;
+	u_Particles[index].Position = particle.Position;
+	u_Particles[index].Age = particle.Age;
+	u_Particles[index].Velocity = particle.Velocity;
+
+	uint slot = atomicAdd(u_DrawArgs[1], 1u);
+	u_AliveOut[slot] = index;
+	if (u_Sorted != 0) {
+		// Positive floats sort the same as their bits do, the distance is kept above zero so it always sorts ahead
+		// of the padding (see particle_sort.comp.glsl)
+		u_Keys[slot] = floatBitsToUint(max(distance(particle.Position, u_CamPos), 1e-6));
+	}
+}
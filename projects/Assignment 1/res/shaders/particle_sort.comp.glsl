@@ -0,0 +1,54 @@
+#version 430
+
+// One step of a bitonic sort over an emitter's alive list (see ParticleSystem), ordering the particles from farthest
+// to nearest so they blend correctly. The sort runs over the whole power of two sized list, so first the keys past
+// the survivors get padded with zeros, which sorts them to the end where they're never drawn
+// See https://en.wikipedia.org/wiki/Bitonic_sorter
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 5) buffer b_AliveOut {
+	uint u_AliveOut[];
+};
+// Must match ParticleCounters in ParticleSystem.cpp
+layout(std430, binding = 6) readonly buffer b_Counters {
+	uint u_DeadCount;
+	uint u_AliveCount;
+	uint u_EmitCount;
+	uint u_Padding;
+	uint u_EmitArgs[3];
+	uint u_SimulateArgs[3];
+	uint u_DrawArgs[4];
+};
+layout(std430, binding = 7) buffer b_Keys {
+	uint u_Keys[];
+};
+
+// Non zero for the padding pass, otherwise the size of the bitonic sequences being merged and the compare distance
+uniform int u_Pad;
+uniform int u_K;
+uniform int u_J;
+
+void main() {
+	uint ix = gl_GlobalInvocationID.x;
+	if (u_Pad != 0) {
+		if (ix >= u_DrawArgs[1]) {
+			u_Keys[ix] = 0u;
+		}
+		return;
+	}
+	uint other = ix ^ uint(u_J);
+	if (other <= ix) {
+		return;
+	}
+	uint a = u_Keys[ix];
+	uint b = u_Keys[other];
+	// The sequences alternate direction, the last merge covers everything so the whole list ends up descending
+	bool descending = (ix & uint(u_K)) == 0u;
+	if (descending ? a < b : a > b) {
+		u_Keys[ix] = b;
+		u_Keys[other] = a;
+		uint index = u_AliveOut[ix];
+		u_AliveOut[ix] = u_AliveOut[other];
+		u_AliveOut[other] = index;
+	}
+}
@@ -0,0 +1,12 @@
+#version 430
+
+layout(location = 0) flat in int inInstance;
+
+layout(location = 0) out uint outId;
+
+// The ID of the draw's first instance, less one since 0 is left for nothing being there
+uniform int u_PickBase;
+
+void main() {
+	outId = uint(u_PickBase + inInstance + 1);
+}
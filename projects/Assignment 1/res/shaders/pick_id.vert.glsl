@@ -0,0 +1,17 @@
+#version 430
+
+layout(location = 0) in vec3 inPosition;
+
+// Per-instance data, see InstanceTransform in VertexTypes.h
+layout(location = 4) in mat4 inModel;
+
+// Which instance of the draw this is, GpuPicker turns it into an ID
+layout(location = 0) flat out int outInstance;
+
+// The view projection zoomed in on the pixel being picked
+uniform mat4 u_PickViewProjection;
+
+void main() {
+	outInstance = gl_InstanceID;
+	gl_Position = u_PickViewProjection * (inModel * vec4(inPosition, 1.0));
+}
@@ -0,0 +1,130 @@
+#version 430
+
+// Fast approximate anti-aliasing for PostProcessing, after Lottes' FXAA 3.11. Each pixel works out whether it sits on
+// an edge from the luma around it, searches along the edge for it's ends, and blends across the edge by how close it
+// is to one of them. See http://blog.simonrodriguez.fr/articles/2016/07/implementing_fxaa.html for a walk through
+layout(binding = 0) uniform sampler2D s_Image;
+
+#include "include/specialization.glsl"
+
+// Edges with less contrast than this are left alone, the second is relative to the brightest luma around the pixel.
+// These are set by PostProcessing
+SPECIALIZATION_CONSTANT(0, float, EDGE_THRESHOLD_MIN, 0.0312);
+SPECIALIZATION_CONSTANT(1, float, EDGE_THRESHOLD_MAX, 0.125);
+// How much to blend away single pixel features, 0 keeps them sharp and 1 blurs them the most
+SPECIALIZATION_CONSTANT(2, float, SUBPIXEL_QUALITY, 0.75);
+// How far along the edge each step of the search goes, in pixels
+const int   SEARCH_STEPS = 10;
+const float STEP_SCALE[SEARCH_STEPS] = float[](1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 4.0, 8.0);
+
+layout(location = 0) out vec4 frag_color;
+
+// The tonemap pass stores the luma in alpha
+float Luma(vec2 uv) {
+	return textureLod(s_Image, uv, 0.0).a;
+}
+
+void main() {
+	vec2 texel = 1.0 / vec2(textureSize(s_Image, 0));
+	vec2 uv = gl_FragCoord.xy * texel;
+	vec4 center = textureLod(s_Image, uv, 0.0);
+
+	float lumaC = center.a;
+	float lumaN = Luma(uv + vec2(0.0, texel.y));
+	float lumaS = Luma(uv - vec2(0.0, texel.y));
+	float lumaE = Luma(uv + vec2(texel.x, 0.0));
+	float lumaW = Luma(uv - vec2(texel.x, 0.0));
+	float lumaMin = min(lumaC, min(min(lumaN, lumaS), min(lumaE, lumaW)));
+	float lumaMax = max(lumaC, max(max(lumaN, lumaS), max(lumaE, lumaW)));
+	float range = lumaMax - lumaMin;
+	if (range < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD_MAX)) {
+		frag_color = vec4(center.rgb, 1.0);
+		return;
+	}
+
+	float lumaNE = Luma(uv + texel);
+	float lumaSW = Luma(uv - texel);
+	float lumaNW = Luma(uv + vec2(-texel.x, texel.y));
+	float lumaSE = Luma(uv + vec2(texel.x, -texel.y));
+	float lumaNS = lumaN + lumaS;
+	float lumaEW = lumaE + lumaW;
+	float lumaNCorners = lumaNE + lumaNW;
+	float lumaSCorners = lumaSE + lumaSW;
+	float lumaECorners = lumaNE + lumaSE;
+	float lumaWCorners = lumaNW + lumaSW;
+
+	// Which way does the edge run?
+	float edgeH = abs(-2.0 * lumaW + lumaWCorners) + abs(-2.0 * lumaC + lumaNS) * 2.0 + abs(-2.0 * lumaE + lumaECorners);
+	float edgeV = abs(-2.0 * lumaN + lumaNCorners) + abs(-2.0 * lumaC + lumaEW) * 2.0 + abs(-2.0 * lumaS + lumaSCorners);
+	bool isHorizontal = edgeH >= edgeV;
+
+	// And which side of the pixel is it on?
+	float luma1 = isHorizontal ? lumaS : lumaW;
+	float luma2 = isHorizontal ? lumaN : lumaE;
+	float gradient1 = luma1 - lumaC;
+	float gradient2 = luma2 - lumaC;
+	bool is1Steepest = abs(gradient1) >= abs(gradient2);
+	float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+	float stepLength = isHorizontal ? texel.y : texel.x;
+	float lumaLocalAverage;
+	if (is1Steepest) {
+		stepLength = -stepLength;
+		lumaLocalAverage = 0.5 * (luma1 + lumaC);
+	} else {
+		lumaLocalAverage = 0.5 * (luma2 + lumaC);
+	}
+	vec2 edgeUv = uv;
+	if (isHorizontal) {
+		edgeUv.y += stepLength * 0.5;
+	} else {
+		edgeUv.x += stepLength * 0.5;
+	}
+
+	// Walk both ways along the edge until the luma no longer matches it
+	vec2 offset = isHorizontal ? vec2(texel.x, 0.0) : vec2(0.0, texel.y);
+	vec2 uv1 = edgeUv - offset;
+	vec2 uv2 = edgeUv + offset;
+	float lumaEnd1 = 0.0;
+	float lumaEnd2 = 0.0;
+	bool reached1 = false;
+	bool reached2 = false;
+	for (int ix = 0; ix < SEARCH_STEPS && !(reached1 && reached2); ix++) {
+		if (!reached1) {
+			lumaEnd1 = Luma(uv1) - lumaLocalAverage;
+			reached1 = abs(lumaEnd1) >= gradientScaled;
+			if (!reached1) {
+				uv1 -= offset * STEP_SCALE[ix];
+			}
+		}
+		if (!reached2) {
+			lumaEnd2 = Luma(uv2) - lumaLocalAverage;
+			reached2 = abs(lumaEnd2) >= gradientScaled;
+			if (!reached2) {
+				uv2 += offset * STEP_SCALE[ix];
+			}
+		}
+	}
+
+	// The closer end decides how far to shift, as long as the luma changes the way we'd expect towards it
+	float distance1 = isHorizontal ? (uv.x - uv1.x) : (uv.y - uv1.y);
+	float distance2 = isHorizontal ? (uv2.x - uv.x) : (uv2.y - uv.y);
+	bool isDirection1 = distance1 < distance2;
+	float pixelOffset = -min(distance1, distance2) / (distance1 + distance2) + 0.5;
+	bool isLumaCenterSmaller = lumaC < lumaLocalAverage;
+	bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+	float finalOffset = correctVariation ? pixelOffset : 0.0;
+
+	// Single pixel features don't have an edge to search along, so they get blended by how much they stand out
+	float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaNS + lumaEW) + lumaWCorners + lumaECorners);
+	float subPixel = clamp(abs(lumaAverage - lumaC) / range, 0.0, 1.0);
+	subPixel = (-2.0 * subPixel + 3.0) * subPixel * subPixel;
+	finalOffset = max(finalOffset, subPixel * subPixel * SUBPIXEL_QUALITY);
+
+	vec2 finalUv = uv;
+	if (isHorizontal) {
+		finalUv.y += finalOffset * stepLength;
+	} else {
+		finalUv.x += finalOffset * stepLength;
+	}
+	frag_color = vec4(textureLod(s_Image, finalUv, 0.0).rgb, 1.0);
+}
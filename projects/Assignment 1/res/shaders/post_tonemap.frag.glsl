@@ -0,0 +1,41 @@
+#version 430
+
+// Brings the HDR scene from PostProcessing down to the range the screen can show, with the bloom added on first
+layout(binding = 0) uniform sampler2D s_Scene;
+layout(binding = 1) uniform sampler2D s_Bloom;
+
+uniform float u_Exposure;
+// 0 when bloom is turned off
+uniform float u_BloomIntensity;
+// Must match Tonemapper in PostProcessing.h
+uniform int   u_Tonemapper;
+
+const int TONEMAP_NONE     = 0;
+const int TONEMAP_REINHARD = 1;
+const int TONEMAP_ACES     = 2;
+
+out vec4 frag_color;
+
+// Narkowicz's fit of the ACES filmic curve, see https://knarkowicz.wordpress.com/2016/01/06/aces-filmic-tone-mapping-curve/
+vec3 Aces(vec3 x) {
+	return (x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14);
+}
+
+void main() {
+	vec3 color = texelFetch(s_Scene, ivec2(gl_FragCoord.xy), 0).rgb;
+	if (u_BloomIntensity > 0.0) {
+		vec2 uv = gl_FragCoord.xy / vec2(textureSize(s_Scene, 0));
+		color += textureLod(s_Bloom, uv, 0.0).rgb * u_BloomIntensity;
+	}
+	color *= u_Exposure;
+
+	if (u_Tonemapper == TONEMAP_REINHARD) {
+		color = color / (1.0 + color);
+	} else if (u_Tonemapper == TONEMAP_ACES) {
+		color = Aces(color);
+	}
+	color = clamp(color, 0.0, 1.0);
+
+	// FXAA finds edges from the luma, and expects it in alpha
+	frag_color = vec4(color, dot(color, vec3(0.299, 0.587, 0.114)));
+}
@@ -0,0 +1,34 @@
+#version 430
+
+// Stretches the scene from the resolution it was drawn at (see DynamicResolution) up to the screen, sharpening it to
+// win back some of the detail the bilinear filter smears out. The sharpening is contrast adaptive, after AMD's
+// FidelityFX CAS: it backs off where the neighbourhood already has a lot of contrast, so edges don't ring
+layout(binding = 0) uniform sampler2D s_Image;
+
+// The part of the screen being drawn to, as x, y, width and height in pixels
+uniform vec4  u_OutputRect;
+// 0 is the lightest sharpening, 1 the strongest
+uniform float u_Sharpness;
+
+out vec4 frag_color;
+
+void main() {
+	vec2 uv = (gl_FragCoord.xy - u_OutputRect.xy) / u_OutputRect.zw;
+	vec2 texel = 1.0 / vec2(textureSize(s_Image, 0));
+
+	vec3 c = textureLod(s_Image, uv, 0.0).rgb;
+	vec3 n = textureLod(s_Image, uv + vec2(0.0, texel.y), 0.0).rgb;
+	vec3 s = textureLod(s_Image, uv - vec2(0.0, texel.y), 0.0).rgb;
+	vec3 e = textureLod(s_Image, uv + vec2(texel.x, 0.0), 0.0).rgb;
+	vec3 w = textureLod(s_Image, uv - vec2(texel.x, 0.0), 0.0).rgb;
+
+	// How much room there is to sharpen before we'd clip, per channel
+	vec3 lo = min(c, min(min(n, s), min(e, w)));
+	vec3 hi = max(c, max(max(n, s), max(e, w)));
+	vec3 amount = sqrt(clamp(min(lo, 1.0 - hi) / max(hi, 0.0001), 0.0, 1.0));
+
+	// A negative lobe on the cross around the pixel
+	vec3 weight = amount * -1.0 / mix(8.0, 5.0, u_Sharpness);
+	vec3 result = (c + (n + s + e + w) * weight) / (1.0 + 4.0 * weight);
+	frag_color = vec4(clamp(result, 0.0, 1.0), 1.0);
+}
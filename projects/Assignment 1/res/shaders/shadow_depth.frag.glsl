@@ -0,0 +1,15 @@
+#version 430
+
+layout(location = 0) in vec3 inPos;
+
+#ifdef LINEAR_DEPTH
+// Point light shadows store the distance to the light over it's range, so every face of the cube compares the same way
+uniform vec3  u_LightPos;
+uniform float u_LightRange;
+#endif
+
+void main() {
+#ifdef LINEAR_DEPTH
+	gl_FragDepth = length(inPos - u_LightPos) / u_LightRange;
+#endif
+}
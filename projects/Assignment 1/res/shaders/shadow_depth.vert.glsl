@@ -0,0 +1,36 @@
+#version 430
+#ifdef LAYERED
+// Either of these lets the vertex shader pick the layer, so a whole cube can be drawn in one pass
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+#endif
+
+layout(location = 0) in vec3 inPosition;
+
+// Per-instance data, see InstanceTransform in VertexTypes.h
+layout(location = 4) in mat4 inModel;
+#ifdef LAYERED
+// Which face of the cube this instance is drawn into, ShadowMaps stores it in place of the material
+layout(location = 11) in uint inFace;
+#endif
+
+layout(location = 0) out vec3 outPos;
+
+#ifdef LAYERED
+uniform mat4 u_LayerViewProjection[6];
+// The layer of the cube's first face in the cube map array
+uniform int  u_FirstLayer;
+#else
+uniform mat4 u_ShadowViewProjection;
+#endif
+
+void main() {
+	vec4 worldPos = inModel * vec4(inPosition, 1.0);
+	outPos = worldPos.xyz;
+#ifdef LAYERED
+	gl_Position = u_LayerViewProjection[inFace] * worldPos;
+	gl_Layer = u_FirstLayer + int(inFace);
+#else
+	gl_Position = u_ShadowViewProjection * worldPos;
+#endif
+}
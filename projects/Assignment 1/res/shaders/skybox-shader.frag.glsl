@@ -1,8 +1,8 @@
-#version 410
+#version 430
 
 layout(location = 0) in vec3 inNormal;
 
-uniform samplerCube s_Environment;
+layout(binding = 0) uniform samplerCube s_Environment;
 
 out vec4 frag_color;
 
@@ -10,4 +10,4 @@ void main() {
     vec3 norm = normalize(inNormal);
 
     frag_color = vec4(texture(s_Environment, norm).rgb, 1.0);
-}
\ No newline at end of file
+}
@@ -1,17 +1,20 @@
-#version 410
+#version 430
 
-layout(location = 0) in vec3 inPosition;
+// The sky is a single triangle that covers the whole screen (see SkyboxPass), so there are no vertex inputs
 
 layout(location = 0) out vec3 outNormal;
 
-uniform mat4 u_SkyboxMatrix;
+#include "include/frame_data.glsl"
+
 uniform mat3 u_EnvironmentRotation;
 
 void main() {
-    vec4 pos = u_SkyboxMatrix * vec4(inPosition, 1.0);
-    gl_Position = pos.xyww;
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+	// z = w puts the triangle on the far plane, so the depth test hides it behind anything that's been drawn
+	gl_Position = vec4(corner, 1.0, 1.0);
 
-    // Normals
-    outNormal = u_EnvironmentRotation * inPosition;
+	// The skybox matrix is the view projection without the camera's position, so un-projecting a point on the far
+	// plane gives us the direction we're looking in. It's linear across the screen, so the fragments can interpolate it
+	vec4 direction = inverse(u_SkyboxMatrix) * vec4(corner, 1.0, 1.0);
+	outNormal = u_EnvironmentRotation * (direction.xyz / direction.w);
 }
-
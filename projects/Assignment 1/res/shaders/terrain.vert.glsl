@@ -0,0 +1,65 @@
+#version 430
+
+// Draws the nodes of a TerrainComponent's quadtree, each one a flat grid that gets pushed up by the heightmap. Nodes
+// get lit the same way as meshes, by frag_blinn_phong_textured.glsl
+
+// The grid, with it's corners on whole numbers from 0 to the grid's size
+layout(location = 0) in vec3 inPosition;
+
+// Per-instance data, see InstanceTransform in VertexTypes.h. The model places the grid and scales the heights, the
+// first column of the normal matrix holds the distances the grid morphs into the next level's over (see TerrainComponent)
+layout(location = 4) in mat4 inModel;
+layout(location = 8) in mat3 inNormalMatrix;
+layout(location = 11) in uint inMaterialIndex;
+
+layout(location = 0) out vec3 outPos;
+layout(location = 1) out vec3 outColor;
+layout(location = 2) out vec3 outNormal;
+layout(location = 3) out vec2 outUV;
+layout(location = 4) flat out uint outMaterialIndex;
+layout(location = 5) flat out vec3 outOrigin;
+
+#include "include/frame_data.glsl"
+
+uniform sampler2D s_Heightmap;
+// The terrain's corner with the smallest X and Y, one over the length of it's sides, and how many times the textures
+// repeat per unit
+uniform vec4 u_TerrainRegion;
+
+// Gets the height at a point on the terrain from 0 to 1, the heightmap's samples sit on the terrain's corners
+float SampleHeight(vec2 world, vec2 samples) {
+	vec2 uv = ((world - u_TerrainRegion.xy) * u_TerrainRegion.z * (samples - 1.0) + 0.5) / samples;
+	return textureLod(s_Heightmap, uv, 0.0).r;
+}
+
+void main() {
+	vec2 samples = vec2(textureSize(s_Heightmap, 0));
+	vec2 grid = inPosition.xy;
+
+	// How far the vertex is from the camera before it morphs decides how far it morphs
+	vec2 world = (inModel * vec4(grid, 0.0, 1.0)).xy;
+	float height = inModel[3].z + SampleHeight(world, samples) * inModel[2].z;
+	float dist = distance(u_CamPos, vec3(world, height));
+	vec2 morphRange = inNormalMatrix[0].xy;
+	float morph = clamp((dist - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+	// Odd vertices slide back onto their even neighbours, which is where the next level's grid has them
+	grid -= fract(grid * 0.5) * 2.0 * morph;
+
+	world = (inModel * vec4(grid, 0.0, 1.0)).xy;
+	vec4 worldPos = inModel * vec4(grid, SampleHeight(world, samples), 1.0);
+	outPos = worldPos.xyz;
+	gl_Position = u_ViewProjection * worldPos;
+
+	// The slope across the neighbouring samples gives the normal
+	vec2 spacing = 1.0 / (u_TerrainRegion.z * (samples - 1.0));
+	float left  = SampleHeight(world - vec2(spacing.x, 0.0), samples);
+	float right = SampleHeight(world + vec2(spacing.x, 0.0), samples);
+	float down  = SampleHeight(world - vec2(0.0, spacing.y), samples);
+	float up    = SampleHeight(world + vec2(0.0, spacing.y), samples);
+	outNormal = normalize(vec3((left - right) * inModel[2].z / (2.0 * spacing.x), (down - up) * inModel[2].z / (2.0 * spacing.y), 1.0));
+
+	outUV = world * u_TerrainRegion.w;
+	outColor = vec3(1.0);
+	outMaterialIndex = inMaterialIndex;
+	outOrigin = worldPos.xyz;
+}
@@ -0,0 +1,11 @@
+#version 430
+
+// Lays the cached UI (see UiCache) over the screen. The UI was drawn over a transparent target, which leaves it's
+// colors already multiplied by their alpha, so this gets blended with GL_ONE, GL_ONE_MINUS_SRC_ALPHA
+layout(binding = 0) uniform sampler2D s_Ui;
+
+out vec4 frag_color;
+
+void main() {
+	frag_color = texelFetch(s_Ui, ivec2(gl_FragCoord.xy), 0);
+}
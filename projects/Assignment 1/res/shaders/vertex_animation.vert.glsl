@@ -0,0 +1,70 @@
+#version 430
+
+// Plays back a clip baked by VertexAnimationTexture, each vertex reads where it is from the texture and blends between
+// the two frames either side of the current time. Lit the same way as meshes, by frag_blinn_phong_textured.glsl
+
+layout(location = 0) in vec3 inPosition;
+// The vertex's index, one byte in each channel (see VertexAnimationTexture::Bake)
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec3 inNormal;
+layout(location = 3) in vec2 inUV;
+
+// Per-instance data, see InstanceTransform in VertexTypes.h
+layout(location = 4) in mat4 inModel;
+layout(location = 8) in mat3 inNormalMatrix;
+layout(location = 11) in uint inMaterialIndex;
+
+layout(location = 0) out vec3 outPos;
+layout(location = 1) out vec3 outColor;
+layout(location = 2) out vec3 outNormal;
+layout(location = 3) out vec2 outUV;
+layout(location = 4) flat out uint outMaterialIndex;
+layout(location = 5) flat out vec3 outOrigin;
+
+#include "include/frame_data.glsl"
+
+// Each frame's offsets from the rest pose, followed by it's normals
+uniform sampler2D s_VertexAnimation;
+// The number of frames, frames per second, rows in each block of the texture, and how much of the clip instances
+// get spread over
+uniform vec4 u_VertexAnimation;
+
+// Reads a texel from one of the blocks, 0 and 1 are the first frame's positions and normals
+vec3 FetchBlock(int block, int vertex, int width) {
+	int blockRows = int(u_VertexAnimation.z);
+	return texelFetch(s_VertexAnimation, ivec2(vertex % width, block * blockRows + vertex / width), 0).xyz;
+}
+
+void main() {
+	int vertex = int(dot(round(inColor * 255.0), vec3(1.0, 256.0, 65536.0)));
+	int width = textureSize(s_VertexAnimation, 0).x;
+
+	// Instances start at different points in the clip depending on where they are
+	float phase = fract(sin(dot(inModel[3].xyz, vec3(12.9898, 78.233, 37.719))) * 43758.5453) * u_VertexAnimation.w;
+	int frameCount = int(u_VertexAnimation.x);
+	float frame = mod(u_Time * u_VertexAnimation.y + phase * u_VertexAnimation.x, u_VertexAnimation.x);
+	int current = int(frame);
+	int next = (current + 1) % frameCount;
+	float blend = fract(frame);
+
+	vec3 position = inPosition + mix(FetchBlock(current * 2, vertex, width), FetchBlock(next * 2, vertex, width), blend);
+	vec3 normal = mix(FetchBlock(current * 2 + 1, vertex, width), FetchBlock(next * 2 + 1, vertex, width), blend);
+
+	vec4 worldPos = inModel * vec4(position, 1.0);
+	outPos = worldPos.xyz;
+	gl_Position = u_ViewProjection * worldPos;
+
+#ifdef DERIVE_NORMAL_MATRIX
+	mat3 model = mat3(inModel);
+	mat3 cofactor = mat3(cross(model[1], model[2]), cross(model[2], model[0]), cross(model[0], model[1]));
+	outNormal = cofactor * normal * sign(dot(model[0], cofactor[0]));
+#else
+	outNormal = inNormalMatrix * normal;
+#endif
+
+	outUV = inUV;
+	// The color holds the index, so it can't tint the surface
+	outColor = vec3(1.0);
+	outMaterialIndex = inMaterialIndex;
+	outOrigin = inModel[3].xyz;
+}
@@ -1,38 +1,86 @@
-#version 410
+#version 430
 
 layout(location = 0) in vec3 inPosition;
+#ifdef LIGHTMAPPED
+// Where the vertex lands in the lightmap, packed into the color with 16 bits per axis (see Lightmapper)
+layout(location = 1) in vec4 inColor;
+#else
 layout(location = 1) in vec3 inColor;
+#endif
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV;
 
+// Per-instance data, see InstanceTransform in VertexTypes.h
+layout(location = 4) in mat4 inModel;
+layout(location = 8) in mat3 inNormalMatrix;
+layout(location = 11) in uint inMaterialIndex;
+#ifdef NORMAL_MAP
+// The tangent, with the handedness of the bitangent in w (see VertexPosNormTanTexCol in VertexTypes.h)
+layout(location = 12) in vec4 inTangent;
+#endif
+
 layout(location = 0) out vec3 outPos;
 layout(location = 1) out vec3 outColor;
 layout(location = 2) out vec3 outNormal;
 layout(location = 3) out vec2 outUV;
+layout(location = 4) flat out uint outMaterialIndex;
+// Where the instance is, for fading it against it's impostor by distance (see DITHER_FADE)
+layout(location = 5) flat out vec3 outOrigin;
+#ifdef LIGHTMAPPED
+layout(location = 6) out vec2 outLightmapUV;
+#endif
+#ifdef NORMAL_MAP
+// After the impostor's inputs in frag_blinn_phong_textured.glsl, so the two never overlap
+layout(location = 10) out vec4 outTangent;
+#endif
 
-uniform mat4 u_ModelViewProjection;
-uniform mat4 u_View;
-uniform mat4 u_Model;
-uniform mat3 u_NormalMatrix;
-uniform vec3 u_LightPos;
+#include "include/frame_data.glsl"
 
+// The depth pre-pass (see depth_prepass.vert.glsl) needs to land on exactly the same depths for the GL_EQUAL test
+invariant gl_Position;
 
 void main() {
 
-	gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
-
 	// Lecture 5
 	// Pass vertex pos in world space to frag shader
-	outPos = (u_Model * vec4(inPosition, 1.0)).xyz;
+	vec4 worldPos = inModel * vec4(inPosition, 1.0);
+	outPos = worldPos.xyz;
+
+	gl_Position = u_ViewProjection * worldPos;
 
 	// Normals
-	outNormal = u_NormalMatrix * inNormal;
+#ifdef DERIVE_NORMAL_MATRIX
+	// The cofactor matrix is the inverse transpose scaled by the determinant, and the fragment shader normalizes anyways
+	mat3 model = mat3(inModel);
+	mat3 cofactor = mat3(cross(model[1], model[2]), cross(model[2], model[0]), cross(model[0], model[1]));
+	outNormal = cofactor * inNormal * sign(dot(model[0], cofactor[0]));
+#else
+	outNormal = inNormalMatrix * inNormal;
+#endif
+
+#ifdef NORMAL_MAP
+	// Tangents lie along the surface, so they get transformed like positions rather than like normals. Mirroring an
+	// instance flips the cross product the bitangent is rebuilt from, so the handedness has to flip with it
+	mat3 tangentModel = mat3(inModel);
+	outTangent = vec4(tangentModel * inTangent.xyz, inTangent.w * sign(determinant(tangentModel)));
+#endif
 
 	// Pass our UV coords to the fragment shader
 	outUV = inUV;
 
 	///////////
+#ifdef LIGHTMAPPED
+	// The color holds the lightmap coordinates, so it can't tint the surface
+	vec4 bytes = round(inColor * 255.0);
+	outLightmapUV = (bytes.xz + bytes.yw * 256.0) / 65535.0;
+	outColor = vec3(1.0);
+#else
 	outColor = inColor;
+#endif
+
+	// Used to look up per-material values in the material buffer
+	outMaterialIndex = inMaterialIndex;
+	outOrigin = inModel[3].xyz;
 
 }
 
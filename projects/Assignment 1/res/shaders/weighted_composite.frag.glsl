@@ -0,0 +1,25 @@
+#version 430
+
+// Blends the weighted blended transparency over the scene (see WeightedBlending). Must match the units in
+// WeightedBlending.h
+layout(binding = 0) uniform sampler2D s_Accumulation;
+layout(binding = 1) uniform sampler2D s_Revealage;
+
+out vec4 frag_color;
+
+void main() {
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	float revealage = texelFetch(s_Revealage, texel, 0).r;
+	// Nothing blended was drawn here
+	if (revealage >= 1.0) {
+		discard;
+	}
+	vec4 accumulation = texelFetch(s_Accumulation, texel, 0);
+	// Enough bright layers can overflow the half floats, the alpha's weights are still there to average by then
+	if (isinf(max(max(abs(accumulation.r), abs(accumulation.g)), abs(accumulation.b)))) {
+		accumulation.rgb = vec3(accumulation.a);
+	}
+	// The weighted average color of everything drawn here, covering as much of the scene as wasn't revealed
+	vec3 average = accumulation.rgb / max(accumulation.a, 1e-5);
+	frag_color = vec4(average, 1.0 - revealage);
+}
@@ -3,6 +3,7 @@
 #include "Gameplay/Application.h"
 #include "Gameplay/Timing.h"
 #include "Gameplay/Transform.h"
+#include "TTK/Input.h"
 
 
 void CameraControlBehaviour::OnLoad(entt::handle entity) {
@@ -12,12 +13,11 @@ void CameraControlBehaviour::OnLoad(entt::handle entity) {
 void CameraControlBehaviour::Update(entt::handle entity)
 {
 	float dt = Timing::Instance().DeltaTime;
-	GLFWwindow* window = Application::Instance().Window;
-	double mx, my;
-	glfwGetCursorPos(window, &mx, &my);
+	const glm::vec2 mousePos = TTK::Input::GetMousePos();
+	const double mx = mousePos.x, my = mousePos.y;
 	Transform& transform = entity.get<Transform>();
 
-	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_1) == GLFW_PRESS) {
+	if (TTK::Input::GetMouseDown(TTK::MouseButton::Left)) {
 		if (!_isPressed) {
 			_isPressed = true;
 			_prevMouseX = mx;
@@ -37,26 +37,26 @@ void CameraControlBehaviour::Update(entt::handle entity)
 	}
 
 	glm::vec3 movement = glm::vec3(0.0f);
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::A)) {
 		movement.x += -1.0f * dt;
 	}
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::D)) {
 		movement.x += 1.0f * dt;
 	}
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::W)) {
 		movement.z += -1.0f * dt;
 	}
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::S)) {
 		movement.z += 1.0f * dt;
 	}
-	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::Space)) {
 		movement.y += 1.0f * dt;
 	}
-	if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS) {
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::LeftControl)) {
 		movement.y += -1.0f * dt;
 	}
 	movement *= 2.0f;
-	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT)) {
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::LeftShift)) {
 		movement *= 1.5f;
 	}
 	transform.MoveLocal(movement);
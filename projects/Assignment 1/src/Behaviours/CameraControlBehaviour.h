@@ -9,6 +9,12 @@ public:
 	void OnLoad(entt::handle entity) override;
 	void Update(entt::handle entity) override;
 
+	// Everything else is picked up from the camera again in OnLoad
+	template <typename Archive>
+	void serialize(Archive& archive) {
+		archive(Enabled);
+	}
+
 protected:
 	double _prevMouseX, _prevMouseY;
 	float _rotationX, _rotationY;
@@ -1,22 +1,35 @@
 #pragma once
 #include "Gameplay/IBehaviour.h"
+#include "Gameplay/PathAsset.h"
 #include <vector>
 #include <GLM/glm.hpp>
 
+/// <summary>
+/// Moves an entity along a smooth loop through it's points. For lots of entities, use a FollowPathComponent and
+/// PathFollowSystem instead
+/// </summary>
 class FollowPathBehaviour final : public IBehaviour
 {
 public:
 	FollowPathBehaviour() :
 		Points(std::vector<glm::vec3>()),
 		Speed(1.0f),
-		_nextPointIx(0) { }
+		_path(PathAsset::INVALID),
+		_distance(0.0f) { }
 	~FollowPathBehaviour() override = default;
 
 	std::vector<glm::vec3> Points;
 	float                  Speed;
 
 	void Update(entt::handle entity) override;
-	
+
+	template <typename Archive>
+	void serialize(Archive& archive) {
+		archive(Enabled, Points, Speed, _distance);
+	}
+
 private:
-	int _nextPointIx;
-};
\ No newline at end of file
+	// The path through Points, made again whenever they change
+	PathAsset::Id _path;
+	float         _distance;
+};
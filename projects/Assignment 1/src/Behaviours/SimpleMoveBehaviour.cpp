@@ -1,92 +1,89 @@
 #include "SimpleMoveBehaviour.h"
 #include "Gameplay/Application.h"
 #include "Gameplay/Transform.h"
+#include "Gameplay/Scene.h"
 #include "Gameplay/Timing.h"
 
-#include "GLFW/glfw3.h"
+#include "TTK/Input.h"
 
 void SimpleMoveBehaviour::Update(entt::handle entity)
 {
-	float dt = Timing::Instance().DeltaTime;
-	GLFWwindow* window = Application::Instance().Window;
-	Transform& transform = entity.get<Transform>();
+	_Apply(entity.get<Transform>(), _ReadInput(Timing::Instance().DeltaTime), Relative);
+}
 
-	if (Relative) {
-		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-			transform.MoveLocal(0.0f, -1.0f * dt, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-			transform.MoveLocal(0.0f, 1.0f * dt, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-			transform.MoveLocal(-1.0f * dt, 0.0f, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-			transform.MoveLocal(1.0f * dt, 0.0f, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
-			transform.MoveLocal(0.0f, 0.0f, 1.0f * dt);
-		}
-		if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS) {
-			transform.MoveLocal(0.0f, 0.0f, -1.0f * dt);
+void SimpleMoveBehaviour::UpdateSystem(GameScene& scene, float deltaTime)
+{
+	// The keys are the same for everyone, so we only need to ask GLFW once
+	const Input input = _ReadInput(deltaTime);
+	if (input.Movement == glm::vec3(0.0f) && input.Rotation == glm::vec3(0.0f)) {
+		return;
+	}
+	scene.Registry().view<SimpleMoveComponent, Transform>().each([&input](const SimpleMoveComponent& move, Transform& transform) {
+		if (move.Enabled) {
+			_Apply(transform, input, move.Relative);
 		}
+	});
+}
 
-		if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-			transform.RotateLocal(0.0f, -45.0f * dt, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-			transform.RotateLocal(0.0f, 45.0f * dt, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-			transform.RotateLocal(45.0f * dt, 0.0f, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-			transform.RotateLocal(-45.0f * dt, 0.0f, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
-			transform.RotateLocal(0.0f, 0.0f, 45.0f * dt);
-		}
-		if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
-			transform.RotateLocal(0.0f, 0.0f, -45.0f * dt);
-		}
-	} else
-	{
-		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-			transform.MoveLocalFixed(0.0f, -1.0f * dt, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-			transform.MoveLocalFixed(0.0f, 1.0f * dt, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-			transform.MoveLocalFixed(-1.0f * dt, 0.0f, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-			transform.MoveLocalFixed(1.0f * dt, 0.0f, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
-			transform.MoveLocalFixed(0.0f, 0.0f, 1.0f * dt);
-		}
-		if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS) {
-			transform.MoveLocalFixed(0.0f, 0.0f, -1.0f * dt);
-		}
+SimpleMoveBehaviour::Input SimpleMoveBehaviour::_ReadInput(float dt)
+{
+	Input result = { glm::vec3(0.0f), glm::vec3(0.0f) };
 
-		if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-			transform.RotateLocalFixed(0.0f, -45.0f * dt, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-			transform.RotateLocalFixed(0.0f, 45.0f * dt, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-			transform.RotateLocalFixed(45.0f * dt, 0.0f, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-			transform.RotateLocalFixed(-45.0f * dt, 0.0f, 0.0f);
-		}
-		if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
-			transform.RotateLocalFixed(0.0f, 0.0f, 45.0f * dt);
-		}
-		if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
-			transform.RotateLocalFixed(0.0f, 0.0f, -45.0f * dt);
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::A)) {
+		result.Movement.y -= 1.0f * dt;
+	}
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::D)) {
+		result.Movement.y += 1.0f * dt;
+	}
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::W)) {
+		result.Movement.x -= 1.0f * dt;
+	}
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::S)) {
+		result.Movement.x += 1.0f * dt;
+	}
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::Space)) {
+		result.Movement.z += 1.0f * dt;
+	}
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::LeftControl)) {
+		result.Movement.z -= 1.0f * dt;
+	}
+
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::Up)) {
+		result.Rotation.y -= 45.0f * dt;
+	}
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::Down)) {
+		result.Rotation.y += 45.0f * dt;
+	}
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::Left)) {
+		result.Rotation.x += 45.0f * dt;
+	}
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::Right)) {
+		result.Rotation.x -= 45.0f * dt;
+	}
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::Q)) {
+		result.Rotation.z += 45.0f * dt;
+	}
+	if (TTK::Input::GetKeyDown(TTK::KeyCode::E)) {
+		result.Rotation.z -= 45.0f * dt;
+	}
+	return result;
+}
+
+void SimpleMoveBehaviour::_Apply(Transform& transform, const Input& input, bool relative)
+{
+	// Movement adds up the same no matter the order, but rotations don't, so we keep the order the keys were checked
+	// in. Anything that isn't held is skipped so we don't mark the transform as moved for nothing
+	if (input.Movement != glm::vec3(0.0f)) {
+		relative ? transform.MoveLocal(input.Movement) : transform.MoveLocalFixed(input.Movement);
+	}
+	const glm::vec3 steps[3] = {
+		glm::vec3(0.0f, input.Rotation.y, 0.0f),
+		glm::vec3(input.Rotation.x, 0.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, input.Rotation.z)
+	};
+	for (const glm::vec3& step : steps) {
+		if (step != glm::vec3(0.0f)) {
+			relative ? transform.RotateLocal(step) : transform.RotateLocalFixed(step);
 		}
 	}
 }
@@ -1,6 +1,24 @@
 #pragma once
 #include "Gameplay/IBehaviour.h"
+#include <GLM/glm.hpp>
 
+class Transform;
+class GameScene;
+
+/// <summary>
+/// Lets the keyboard move an entity when it's updated by SimpleMoveBehaviour::UpdateSystem, which reads the keys once
+/// per frame and moves every entity with one of these
+/// </summary>
+struct SimpleMoveComponent
+{
+	bool Relative = true;
+	bool Enabled = true;
+
+	template <typename Archive>
+	void serialize(Archive& archive) {
+		archive(Relative, Enabled);
+	}
+};
 
 class SimpleMoveBehaviour : public IBehaviour
 {
@@ -10,4 +28,26 @@ public:
 	~SimpleMoveBehaviour() = default;
 
 	void Update(entt::handle entity) override;
+
+	/// <summary>
+	/// Moves every entity with a SimpleMoveComponent based on the keys held down this frame
+	/// </summary>
+	/// <param name="scene">The scene to update the entities in</param>
+	/// <param name="deltaTime">The time since the last frame, in seconds</param>
+	static void UpdateSystem(GameScene& scene, float deltaTime);
+
+	template <typename Archive>
+	void serialize(Archive& archive) {
+		archive(Enabled, Relative);
+	}
+
+private:
+	// How far the held keys move and rotate things this frame
+	struct Input {
+		glm::vec3 Movement;
+		glm::vec3 Rotation;
+	};
+
+	static Input _ReadInput(float deltaTime);
+	static void _Apply(Transform& transform, const Input& input, bool relative);
 };
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <GLM/glm.hpp>
+
+#include "AudioEngine.h"
+
+/// <summary>
+/// Plays an FMOD event from an entity's position. The event gets created by the scene's SceneAudio once it's bank has
+/// loaded, and follows the entity's world transform from then on
+///
+/// Sources that play on their own (AutoPlay) are treated as ambience, and only the most audible of them near the
+/// listener get an event instance at any one time. The rest are virtual, and start over from the top once they get
+/// a voice back. Sources that gameplay starts itself always get an instance
+///
+/// Copying a source only copies it's settings, the copy gets an event instance of it's own
+/// </summary>
+struct AudioSource
+{
+	// The event's path (ex: "event:/Ambience/Wind")
+	std::string Event;
+	// Whether the event starts as soon as it's created
+	bool        AutoPlay       = true;
+	// Whether the event's samples get loaded along with it's bank, for events that need to start right away
+	bool        PreloadSamples = false;
+	// How loud the source is compared to others, used for the event's volume and to rank ambient sources
+	float       Volume         = 1.0f;
+
+	AudioSource() = default;
+	AudioSource(const AudioSource& other) { _CopySettings(other); }
+	AudioSource(AudioSource&& other) = default;
+	AudioSource& operator=(const AudioSource& other) { _CopySettings(other); return *this; }
+	AudioSource& operator=(AudioSource&& other) = default;
+
+	/// <summary>
+	/// Gets the source's event instance, or nullptr if it's bank hasn't loaded yet
+	/// </summary>
+	FMOD::Studio::EventInstance* GetInstance() const { return _instance; }
+	/// <summary>
+	/// Returns true if the source is ambience that doesn't currently have a voice
+	/// </summary>
+	bool IsVirtual() const { return _instance == nullptr && _ambientIndex != NOT_AMBIENT; }
+
+	template <typename Archive>
+	void serialize(Archive& archive) {
+		archive(Event, AutoPlay, PreloadSamples, Volume);
+	}
+
+private:
+	friend class SceneAudio;
+	static const uint32_t NOT_AMBIENT = UINT32_MAX;
+
+	FMOD::Studio::EventInstance* _instance = nullptr;
+	// Where the source was last frame, for working out it's velocity
+	glm::vec3                    _lastPosition = glm::vec3(0.0f);
+	// The range the event is heard over, filled in once it's bank has loaded
+	float                        _minDistance = 0.0f;
+	float                        _maxDistance = 0.0f;
+	// Where ambient sources are in SceneAudio's list and grid
+	uint32_t                     _ambientIndex = NOT_AMBIENT;
+	uint64_t                     _cell = 0;
+
+	void _CopySettings(const AudioSource& other) {
+		Event = other.Event;
+		AutoPlay = other.AutoPlay;
+		PreloadSamples = other.PreloadSamples;
+		Volume = other.Volume;
+	}
+};
+
+/// <summary>
+/// Hears the scene from an entity's position, usually the camera. Listeners face down their local -Z axis with +Y
+/// up, same as the camera. FMOD supports up to FMOD_MAX_LISTENERS at once, any more than that are ignored
+/// </summary>
+struct AudioListener
+{
+	template <typename Archive>
+	void serialize(Archive& archive) { }
+
+private:
+	friend class SceneAudio;
+	glm::vec3 _lastPosition = glm::vec3(0.0f);
+	bool      _hasLastPosition = false;
+};
@@ -0,0 +1,203 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Logging.h"
+
+class IBehaviour;
+
+/// <summary>
+/// The type-erased side of a BehaviourPool, so bindings can free and copy behaviours without knowing their types
+/// </summary>
+class IBehaviourPool
+{
+public:
+	/// <summary>
+	/// Marks a slot that doesn't hold anything
+	/// </summary>
+	static const uint32_t INVALID_INDEX = UINT32_MAX;
+
+	virtual ~IBehaviourPool() = default;
+
+	/// <summary>
+	/// Destroys the behaviour in a slot, and hands the slot back out to the next behaviour that gets allocated
+	/// </summary>
+	virtual void Release(uint32_t index) = 0;
+	/// <summary>
+	/// Copy constructs a new behaviour from the one in a slot
+	/// </summary>
+	/// <returns>The slot of the copy</returns>
+	virtual uint32_t Clone(uint32_t index) = 0;
+	/// <summary>
+	/// Gets the behaviour in a slot, the pointer stays valid until the slot is released
+	/// </summary>
+	virtual IBehaviour* GetBase(uint32_t index) const = 0;
+	/// <summary>
+	/// Gets the generation of a slot, which goes up every time it's released so old handles can tell it's changed
+	/// </summary>
+	virtual uint32_t GetGeneration(uint32_t index) const = 0;
+
+	/// <summary>
+	/// Gets the number of behaviours that are alive in the pool
+	/// </summary>
+	uint32_t GetLiveCount() const { return _liveCount; }
+	/// <summary>
+	/// Gets the number of slots the pool has room for without growing
+	/// </summary>
+	uint32_t GetCapacity() const { return _capacity; }
+
+protected:
+	IBehaviourPool() = default;
+	uint32_t _liveCount = 0;
+	uint32_t _capacity = 0;
+};
+
+/// <summary>
+/// Stores every behaviour of one type in chunks of slots, so binding a behaviour reuses a freed slot instead of
+/// going to the heap, and behaviours of the same type sit next to each other. Chunks never move, so a behaviour stays
+/// at the same address for as long as it's alive. Pools are only touched on the main thread (binding, and destroying
+/// entities in GameScene::Poll)
+/// </summary>
+/// <typeparam name="T">The type of behaviour to store</typeparam>
+template <typename T>
+class BehaviourPool final : public IBehaviourPool
+{
+public:
+	/// <summary>
+	/// The number of slots added each time the pool runs out
+	/// </summary>
+	static const uint32_t CHUNK_SIZE = 64;
+
+	/// <summary>
+	/// Gets the pool for this type of behaviour. Pools are never destroyed, since bindings in static registries (ex:
+	/// the prefabs) may still be freeing into them as the program exits
+	/// </summary>
+	static BehaviourPool& Instance() {
+		static BehaviourPool* instance = new BehaviourPool();
+		return *instance;
+	}
+
+	/// <summary>
+	/// Constructs a new behaviour in a free slot, growing the pool by a chunk if there aren't any
+	/// </summary>
+	/// <param name="args">The arguments to forward to the behaviour's constructor</param>
+	/// <returns>The slot that the behaviour was made in</returns>
+	template <typename ... TArgs>
+	uint32_t Allocate(TArgs&&... args) {
+		if (_freeList == INVALID_INDEX) {
+			_Grow();
+		}
+		const uint32_t index = _freeList;
+		Slot& slot = _GetSlot(index);
+		_freeList = slot.NextFree;
+		new (&slot.Storage) T(std::forward<TArgs>(args)...);
+		slot.NextFree = INVALID_INDEX;
+		slot.IsAlive = true;
+		_liveCount++;
+		return index;
+	}
+
+	/// <summary>
+	/// Gets the behaviour in a slot, if the slot is still on the same generation
+	/// </summary>
+	/// <returns>The behaviour, or nullptr if it has been released since the generation was read</returns>
+	T* Get(uint32_t index, uint32_t generation) const {
+		if (index >= _capacity) {
+			return nullptr;
+		}
+		const Slot& slot = _GetSlot(index);
+		return slot.IsAlive && slot.Generation == generation ? _GetObject(index) : nullptr;
+	}
+
+	void Release(uint32_t index) override {
+		Slot& slot = _GetSlot(index);
+		LOG_ASSERT(slot.IsAlive, "Behaviour was released twice!");
+		_GetObject(index)->~T();
+		slot.IsAlive = false;
+		slot.Generation++;
+		slot.NextFree = _freeList;
+		_freeList = index;
+		_liveCount--;
+	}
+
+	uint32_t Clone(uint32_t index) override {
+		if constexpr (std::is_copy_constructible_v<T>) {
+			// Growing the pool adds chunks without moving the old ones, so the source is safe to copy from
+			return Allocate(static_cast<const T&>(*_GetObject(index)));
+		} else {
+			LOG_ASSERT(false, "Behaviour can't be copied!");
+			return INVALID_INDEX;
+		}
+	}
+
+	IBehaviour* GetBase(uint32_t index) const override { return _GetObject(index); }
+	uint32_t GetGeneration(uint32_t index) const override { return _GetSlot(index).Generation; }
+
+	BehaviourPool(const BehaviourPool& other) = delete;
+	BehaviourPool& operator=(const BehaviourPool& other) = delete;
+
+private:
+	struct Slot {
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+		uint32_t Generation = 0;
+		uint32_t NextFree = INVALID_INDEX;
+		bool     IsAlive = false;
+	};
+
+	std::vector<std::unique_ptr<Slot[]>> _chunks;
+	uint32_t _freeList = INVALID_INDEX;
+
+	BehaviourPool() = default;
+
+	Slot& _GetSlot(uint32_t index) const { return _chunks[index / CHUNK_SIZE][index % CHUNK_SIZE]; }
+	T* _GetObject(uint32_t index) const { return std::launder(reinterpret_cast<T*>(&_GetSlot(index).Storage)); }
+
+	void _Grow() {
+		_chunks.emplace_back(new Slot[CHUNK_SIZE]);
+		// Thread the new slots onto the free list in order, so they get handed out front to back
+		const uint32_t first = _capacity;
+		_capacity += CHUNK_SIZE;
+		for (uint32_t ix = _capacity; ix-- > first;) {
+			_GetSlot(ix).NextFree = _freeList;
+			_freeList = ix;
+		}
+	}
+};
+
+/// <summary>
+/// Refers to a behaviour in a BehaviourPool by it's slot and generation. Handles don't own the behaviour, the
+/// binding it was bound to does, so a handle to a behaviour whose entity has been destroyed just returns nullptr
+/// </summary>
+/// <typeparam name="T">The type of behaviour</typeparam>
+template <typename T>
+class BehaviourHandle
+{
+public:
+	BehaviourHandle() = default;
+	BehaviourHandle(std::nullptr_t) {}
+	BehaviourHandle(uint32_t index, uint32_t generation) : _index(index), _generation(generation) {}
+
+	/// <summary>
+	/// Gets the behaviour, or nullptr if the handle is empty or the behaviour has been destroyed
+	/// </summary>
+	T* get() const {
+		return _index != IBehaviourPool::INVALID_INDEX ? BehaviourPool<T>::Instance().Get(_index, _generation) : nullptr;
+	}
+	T* operator->() const {
+		T* result = get();
+		LOG_ASSERT(result != nullptr, "Behaviour handle is empty or out of date!");
+		return result;
+	}
+	T& operator*() const { return *operator->(); }
+	explicit operator bool() const { return get() != nullptr; }
+	bool operator==(std::nullptr_t) const { return get() == nullptr; }
+	bool operator!=(std::nullptr_t) const { return get() != nullptr; }
+
+private:
+	uint32_t _index = IBehaviourPool::INVALID_INDEX;
+	uint32_t _generation = 0;
+};
@@ -0,0 +1,90 @@
+#include "BehaviourSystems.h"
+
+#include "Scene.h"
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/ThreadPool.h"
+
+std::vector<BehaviourSystems::System> BehaviourSystems::_systems;
+std::vector<BehaviourSystems::System> BehaviourSystems::_fixedSystems;
+
+bool SystemAccess::ConflictsWith(const SystemAccess& other) const {
+	if (!_isDeclared || !other._isDeclared) {
+		return true;
+	}
+	for (const Component& ours : _components) {
+		for (const Component& theirs : other._components) {
+			if (ours.Type == theirs.Type && (ours.IsWrite || theirs.IsWrite)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void SystemAccess::Prepare(entt::registry& registry) const {
+	for (const Component& component : _components) {
+		component.Prepare(registry);
+	}
+}
+
+void BehaviourSystems::Register(const char* name, SystemFunction system, const SystemAccess& access) {
+	_systems.push_back({ name, system, access });
+}
+
+void BehaviourSystems::RegisterFixed(const char* name, SystemFunction system, const SystemAccess& access) {
+	_fixedSystems.push_back({ name, system, access });
+}
+
+void BehaviourSystems::Update(GameScene& scene, float deltaTime) {
+	_Run(_systems, scene, deltaTime);
+}
+
+void BehaviourSystems::FixedUpdate(GameScene& scene, float fixedTimeStep) {
+	_Run(_fixedSystems, scene, fixedTimeStep);
+}
+
+void BehaviourSystems::_Run(const std::vector<System>& systems, GameScene& scene, float deltaTime) {
+	ThreadPool& pool = ThreadPool::Instance();
+	std::vector<Task<void>> tasks;
+	for (size_t begin = 0; begin < systems.size();) {
+		// Grow the group until we hit something that has to wait for one of the systems already in it
+		size_t end = begin + 1;
+		while (end < systems.size()) {
+			bool conflicts = false;
+			for (size_t ix = begin; ix < end && !conflicts; ix++) {
+				conflicts = systems[end].Access.ConflictsWith(systems[ix].Access);
+			}
+			if (conflicts) {
+				break;
+			}
+			end++;
+		}
+
+		for (size_t ix = begin; ix < end; ix++) {
+			systems[ix].Access.Prepare(scene.Registry());
+		}
+		// Hand off everything that can run on a worker first, so they get going while we do the rest here
+		tasks.clear();
+		for (size_t ix = begin; ix < end; ix++) {
+			const System& system = systems[ix];
+			if (!system.Access.IsMainThread() && end - begin > 1) {
+				tasks.push_back(pool.Schedule([&system, &scene, deltaTime]() {
+					PROFILE_SCOPE(system.Name);
+					system.Function(scene, deltaTime);
+				}, JobThread::Worker, JobPriority::Frame));
+			}
+		}
+		for (size_t ix = begin; ix < end; ix++) {
+			const System& system = systems[ix];
+			if (system.Access.IsMainThread() || end - begin == 1) {
+				PROFILE_SCOPE(system.Name);
+				system.Function(scene, deltaTime);
+			}
+		}
+		for (const Task<void>& task : tasks) {
+			pool.Wait(task);
+		}
+
+		begin = end;
+	}
+}
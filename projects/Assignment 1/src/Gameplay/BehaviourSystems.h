@@ -0,0 +1,137 @@
+#pragma once
+#include <vector>
+#include <entt.hpp>
+
+class GameScene;
+
+/// <summary>
+/// The components a system reads and writes, so the scheduler knows which systems are safe to run at the same time.
+/// Systems that haven't declared anything are assumed to touch everything, and run on their own on the main thread
+/// </summary>
+class SystemAccess final
+{
+public:
+	SystemAccess() : _isDeclared(false), _isMainThread(false) { }
+
+	/// <summary>
+	/// Declares components that the system only reads from
+	/// </summary>
+	template <typename ... Components>
+	SystemAccess& Reads() {
+		(_Add<Components>(false), ...);
+		return *this;
+	}
+	/// <summary>
+	/// Declares components that the system changes
+	/// </summary>
+	template <typename ... Components>
+	SystemAccess& Writes() {
+		(_Add<Components>(true), ...);
+		return *this;
+	}
+	/// <summary>
+	/// Marks the system as needing to run on the main thread, ex: if it reads input or touches OpenGL
+	/// </summary>
+	SystemAccess& OnMainThread() {
+		_isDeclared = true;
+		_isMainThread = true;
+		return *this;
+	}
+
+	bool IsMainThread() const { return !_isDeclared || _isMainThread; }
+
+	/// <summary>
+	/// Returns true if the two systems can't run at the same time, because one of them writes to a component the
+	/// other one uses
+	/// </summary>
+	bool ConflictsWith(const SystemAccess& other) const;
+	/// <summary>
+	/// Makes sure the registry has a pool for each of our components, since creating one isn't safe to do while
+	/// other threads are using the registry
+	/// </summary>
+	void Prepare(entt::registry& registry) const;
+
+protected:
+	struct Component {
+		entt::id_type Type;
+		bool          IsWrite;
+		void(*Prepare)(entt::registry& registry);
+	};
+
+	std::vector<Component> _components;
+	bool                   _isDeclared;
+	bool                   _isMainThread;
+
+	template <typename T>
+	void _Add(bool isWrite) {
+		_isDeclared = true;
+		_components.push_back({ entt::type_info<T>::id(), isWrite, [](entt::registry& registry) { registry.prepare<T>(); } });
+	}
+};
+
+/// <summary>
+/// Runs behaviours that have been written as systems, where a behaviour type updates every entity with it's component
+/// in one call per frame instead of each entity having it's own IBehaviour. The components sit packed together in
+/// their entt pools, so big crowds of the same behaviour don't have to chase a pointer and make a virtual call each
+///
+/// Systems that declare which components they use are grouped with their neighbours in the update order that they
+/// don't conflict with, and each group runs across the thread pool. Systems running on workers must not add or remove
+/// entities or components directly, those changes go through GameScene::Commands
+///
+/// IBehaviour is still there for one-off scripts, systems are for the behaviours we have lots of
+/// </summary>
+class BehaviourSystems final
+{
+public:
+	/// <summary>
+	/// A function that updates every entity in the scene that uses the system
+	/// </summary>
+	/// <param name="scene">The scene to update the entities in</param>
+	/// <param name="deltaTime">The time since the last frame, in seconds</param>
+	typedef void(*SystemFunction)(GameScene& scene, float deltaTime);
+
+	/// <summary>
+	/// Adds a system to the end of the update order
+	/// </summary>
+	/// <param name="name">The name to show the system under in the profiler, must outlive the system</param>
+	/// <param name="system">The function to run every frame</param>
+	/// <param name="access">The components the system uses, leave empty to run it on it's own on the main thread</param>
+	static void Register(const char* name, SystemFunction system, const SystemAccess& access = SystemAccess());
+	/// <summary>
+	/// Adds a system to the end of the fixed update order, these run zero or more times a frame with a delta time of
+	/// Timing::FixedTimeStep
+	/// </summary>
+	/// <param name="name">The name to show the system under in the profiler, must outlive the system</param>
+	/// <param name="system">The function to run every simulation step</param>
+	/// <param name="access">The components the system uses, leave empty to run it on it's own on the main thread</param>
+	static void RegisterFixed(const char* name, SystemFunction system, const SystemAccess& access = SystemAccess());
+
+	/// <summary>
+	/// Runs every registered system once. Systems that conflict always run in the order they were registered
+	/// </summary>
+	/// <param name="scene">The scene to update</param>
+	/// <param name="deltaTime">The time since the last frame, in seconds</param>
+	static void Update(GameScene& scene, float deltaTime);
+	/// <summary>
+	/// Runs every registered fixed system once, for a single simulation step
+	/// </summary>
+	/// <param name="scene">The scene to update</param>
+	/// <param name="fixedTimeStep">The length of the simulation step, in seconds</param>
+	static void FixedUpdate(GameScene& scene, float fixedTimeStep);
+
+protected:
+	BehaviourSystems() = default;
+	~BehaviourSystems() = default;
+
+	struct System {
+		const char*    Name;
+		SystemFunction Function;
+		SystemAccess   Access;
+	};
+
+	static std::vector<System> _systems;
+	static std::vector<System> _fixedSystems;
+
+	// Runs a list of systems, a group of non-conflicting neighbours at a time
+	static void _Run(const std::vector<System>& systems, GameScene& scene, float deltaTime);
+};
@@ -2,9 +2,12 @@
 
 #include <GLM/gtc/matrix_transform.hpp>
 
+#include "Gameplay/Transform.h"
+
 Camera::Camera() :
-    _isOrtho(false),
+	_isOrtho(false),
 	_orthoHeight(1.0f),
+	_isReverseZ(false),
 	_nearPlane(0.1f),
 	_farPlane(1000.0f),
 	_fovRadians(glm::radians(90.0f)),
@@ -13,13 +16,54 @@ Camera::Camera() :
 	_normal(glm::vec3(0.0f, 0.0f, 1.0f)),
 	_up(glm::vec3(0.0f, 1.0f, 0.0f)), // Using Y-up coordinate system by default
 	_view(glm::mat4(1.0f)),
+	_inverseView(glm::mat4(1.0f)),
 	_projection(glm::mat4(1.0f)),
+	_inverseProjection(glm::mat4(1.0f)),
+	_cullProjection(glm::mat4(1.0f)),
+	_transformVersion(0),
+	_hasTransform(false),
 	_viewProjection(glm::mat4(1.0f)),
+	_viewProjectionNoTranslate(glm::mat4(1.0f)),
+	_inverseViewProjection(glm::mat4(1.0f)),
+	_frustum(),
 	_isDirty(true)
 {
 	__CalculateProjection();
 }
 
+bool Camera::Update(const Transform& transform) {
+	if (_hasTransform && transform.GetWorldVersion() == _transformVersion) {
+		return false;
+	}
+	_hasTransform = true;
+	_transformVersion = transform.GetWorldVersion();
+
+	const glm::mat4& world = transform.WorldTransform();
+	const glm::mat3 rotation = glm::mat3(world);
+	const glm::vec3 translation = glm::vec3(world[3]);
+	const glm::vec3 scale = glm::vec3(glm::dot(rotation[0], rotation[0]), glm::dot(rotation[1], rotation[1]), glm::dot(rotation[2], rotation[2]));
+	// Cameras are almost never scaled, in which case the inverse is just the transposed rotation, otherwise we do it the long way
+	if (glm::all(glm::lessThan(glm::abs(scale - glm::vec3(1.0f)), glm::vec3(1e-4f)))) {
+		const glm::mat3 inverseRotation = glm::transpose(rotation);
+		_view = glm::mat4(inverseRotation);
+		_view[3] = glm::vec4(-(inverseRotation * translation), 1.0f);
+	} else {
+		_view = glm::inverse(world);
+	}
+	_inverseView = world;
+
+	_position = translation;
+	_normal = -glm::normalize(rotation[2]);
+	_up = glm::normalize(rotation[1]);
+	_isDirty = true;
+	return true;
+}
+
+void Camera::SetIsReverseZ(bool isReverseZ) {
+	_isReverseZ = isReverseZ;
+	__CalculateProjection();
+}
+
 void Camera::SetIsOrtho(bool isOrtho) {
 	_isOrtho = isOrtho;
 	__CalculateProjection();
@@ -67,22 +111,35 @@ void Camera::SetFovDegrees(float value) {
 }
 
 const glm::mat4& Camera::GetViewProjection() const {
-	if (_isDirty) {
-		_viewProjection = _projection * _view;
-		_viewProjectionNoTranslate = _projection * glm::mat4(glm::mat3(_view));
-		_isDirty = false;
-	}
+	__CalculateDerived();
 	return _viewProjection;
 }
 
 const glm::mat4& Camera::GetViewProjNoTranslation() const
 {
+	__CalculateDerived();
+	return _viewProjectionNoTranslate;
+}
+
+const glm::mat4& Camera::GetInverseViewProjection() const {
+	__CalculateDerived();
+	return _inverseViewProjection;
+}
+
+const Frustum& Camera::GetFrustum() const {
+	__CalculateDerived();
+	return _frustum;
+}
+
+void Camera::__CalculateDerived() const {
 	if (_isDirty) {
 		_viewProjection = _projection * _view;
 		_viewProjectionNoTranslate = _projection * glm::mat4(glm::mat3(_view));
+		// Both halves are cheap to invert on their own, unlike the combined matrix
+		_inverseViewProjection = _inverseView * _inverseProjection;
+		_frustum = Frustum(_cullProjection * _view);
 		_isDirty = false;
 	}
-	return _viewProjectionNoTranslate;
 }
 
 void Camera::__CalculateProjection() {
@@ -95,10 +152,23 @@ void Camera::__CalculateProjection() {
 	else {
 		_projection = glm::perspective(_fovRadians, _aspectRatio, _nearPlane, _farPlane);
 	}
+	_cullProjection = _projection;
+	if (!_isOrtho && _isReverseZ) {
+		// Same as an infinite perspective, but with depth flipped and mapped to [0, 1], so the near plane lands on 1
+		// and depth falls off towards 0 as things get further away
+		const float focal = 1.0f / glm::tan(_fovRadians * 0.5f);
+		_projection = glm::mat4(0.0f);
+		_projection[0][0] = focal / _aspectRatio;
+		_projection[1][1] = focal;
+		_projection[2][3] = -1.0f;
+		_projection[3][2] = _nearPlane;
+	}
+	_inverseProjection = glm::inverse(_projection);
 	_isDirty = true;
 }
 
 void Camera::__CalculateView() {
 	_view = glm::lookAt(_position, _position + _normal, _up);
+	_inverseView = glm::inverse(_view);
 	_isDirty = true;
 }
@@ -1,10 +1,19 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <GLM/glm.hpp>
 
+#include "Graphics/Frustum.h"
+
+class Transform;
+
 /// <summary>
 /// Represents a simple perspective camera for use by first person or third person games
+///
+/// When the camera is a component, Update makes it follow the transform it's attached to. The view, view-projection,
+/// their inverses and the frustum are all cached, and only get worked out again when the transform moves or the
+/// projection changes, so everything that needs them during a frame (culling, LODs, the frame uniforms) shares one copy
 /// </summary>
 class Camera
 {
@@ -34,6 +43,17 @@ public:
 	/// </summary>
 	/// <param name="orthoHeight">The distance from the camera to the top/bottom of the orthographic box when in ortho mode</param>
 	void SetOrthoHeight(float orthoHeight);
+	/// <summary>
+	/// Gets whether the perspective projection maps the near plane to a depth of 1 and an infinitely far plane to 0
+	/// </summary>
+	bool GetIsReverseZ() const { return _isReverseZ; }
+	/// <summary>
+	/// Switches the perspective projection to reverse-Z with an infinite far plane, which spreads a float depth
+	/// buffer's precision evenly over the whole view. Drawing with it needs glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE),
+	/// depth cleared to 0 and tested with GL_GEQUAL. The frustum keeps the far plane either way, so culling still has
+	/// a limit
+	/// </summary>
+	void SetIsReverseZ(bool isReverseZ);
 
 	/// <summary>
 	/// Sets this camera's position in world space
@@ -67,6 +87,14 @@ public:
 	/// </summary>
 	void SetFovDegrees(float value);
 
+	/// <summary>
+	/// Follows the transform the camera is attached to, looking down it's -Z axis with it's Y axis up. The cached
+	/// matrices and frustum are only rebuilt if the transform has moved since the last call
+	/// </summary>
+	/// <param name="transform">The camera's transform, it's world matrix must be up to date</param>
+	/// <returns>True if the camera moved</returns>
+	bool Update(const Transform& transform);
+
 	/// <summary>
 	/// Gets the camera's position in world space
 	/// </summary>
@@ -81,6 +109,7 @@ public:
 	const glm::vec3& GetUp() const { return _up; }
 
 	float GetFovDegrees() const { return glm::degrees(_fovRadians); }
+	float GetAspectRatio() const { return _aspectRatio; }
 	
 	/// <summary>
 	/// Gets the view matrix for this camera
@@ -98,11 +127,33 @@ public:
 	/// Gets the combined view-projection matrix for this camera without any translations applied (ex: for skyboxes), calculating if needed
 	/// </summary>
 	const glm::mat4& GetViewProjNoTranslation() const;
-	void SetView(glm::mat4 mat) { _view = mat; _isDirty = true; }
+	/// <summary>
+	/// Gets the matrix that takes clip space back to world space (ex: for un-projecting the cursor)
+	/// </summary>
+	const glm::mat4& GetInverseViewProjection() const;
+	/// <summary>
+	/// Gets the planes of the camera's view volume, normalized and in world space
+	/// </summary>
+	const Frustum& GetFrustum() const;
+	void SetView(glm::mat4 mat) { _view = mat; _inverseView = glm::inverse(mat); _isDirty = true; }
+
+	template <typename Archive>
+	void save(Archive& archive) const {
+		archive(_isOrtho, _orthoHeight, _nearPlane, _farPlane, _fovRadians, _aspectRatio, _position, _normal, _up);
+	}
+	template <typename Archive>
+	void load(Archive& archive) {
+		archive(_isOrtho, _orthoHeight, _nearPlane, _farPlane, _fovRadians, _aspectRatio, _position, _normal, _up);
+		__CalculateProjection();
+		__CalculateView();
+		_hasTransform = false;
+		_isDirty = true;
+	}
 
 protected:
 	bool _isOrtho;
 	float _orthoHeight;
+	bool _isReverseZ;
 	
 	float _nearPlane;
 	float _farPlane;
@@ -114,12 +165,21 @@ protected:
 	glm::vec3 _up;
 
 	glm::mat4 _view;
+	glm::mat4 _inverseView;
 	glm::mat4 _projection;
+	glm::mat4 _inverseProjection;
+	// The projection with a finite far plane, which the frustum gets built from even when we're in reverse-Z
+	glm::mat4 _cullProjection;
+	// The world version of the transform we last followed, so we can tell when it's moved
+	uint32_t  _transformVersion;
+	bool      _hasTransform;
 
 	// The view projection, it is mutable so we can re-calculate it during const methods
 	mutable glm::mat4 _viewProjection;
-	// We'l 
+	// The view projection with the translation dropped, for the skybox
 	mutable glm::mat4 _viewProjectionNoTranslate;
+	mutable glm::mat4 _inverseViewProjection;
+	mutable Frustum   _frustum;
 	// A dirty flag that indicates whether we need to re-calculate our view projection matrix
 	mutable bool      _isDirty;
 
@@ -127,4 +187,6 @@ protected:
 	void __CalculateProjection();
 	// Recalculates the view matrix
 	void __CalculateView();
+	// Recalculates everything derived from the view and projection, if they've changed
+	void __CalculateDerived() const;
 };
\ No newline at end of file
@@ -0,0 +1,290 @@
+#include "DynamicBvh.h"
+#include <algorithm>
+
+#include "Logging.h"
+#include "Utilities/ThreadPool.h"
+
+float DynamicBvh::FatMargin = 0.1f;
+
+// Half the surface area of a box, which is proportional to the chance that a random ray hits it
+static float GetArea(const glm::vec3& min, const glm::vec3& max) {
+	const glm::vec3 size = max - min;
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+DynamicBvh::DynamicBvh() :
+	_root(NULL_NODE),
+	_freeList(NULL_NODE),
+	_leafCount(0),
+	_insertsSinceRebuild(0)
+{ }
+
+DynamicBvh::NodeId DynamicBvh::Insert(const BoundingVolume& bounds, entt::entity entity) {
+	const NodeId leaf = _AllocateNode();
+	Node& node = _nodes[leaf];
+	node.Min = bounds.Min - glm::vec3(FatMargin);
+	node.Max = bounds.Max + glm::vec3(FatMargin);
+	node.Entity = entity;
+	_InsertLeaf(leaf);
+	_leafCount++;
+	_insertsSinceRebuild++;
+	return leaf;
+}
+
+void DynamicBvh::Remove(NodeId leaf) {
+	LOG_ASSERT(leaf >= 0 && leaf < static_cast<NodeId>(_nodes.size()) && _nodes[leaf].IsLeaf(), "Node is not a leaf in the tree!");
+	_RemoveLeaf(leaf);
+	_FreeNode(leaf);
+	_leafCount--;
+}
+
+DynamicBvh::NodeId DynamicBvh::Move(NodeId leaf, const BoundingVolume& bounds) {
+	Node& node = _nodes[leaf];
+	// Still inside of the fattened box, so nothing that uses the tree can tell the difference
+	if (glm::all(glm::greaterThanEqual(bounds.Min, node.Min)) && glm::all(glm::lessThanEqual(bounds.Max, node.Max))) {
+		return leaf;
+	}
+	_RemoveLeaf(leaf);
+	_nodes[leaf].Min = bounds.Min - glm::vec3(FatMargin);
+	_nodes[leaf].Max = bounds.Max + glm::vec3(FatMargin);
+	_InsertLeaf(leaf);
+	_insertsSinceRebuild++;
+	return leaf;
+}
+
+DynamicBvh::NodeId DynamicBvh::_AllocateNode() {
+	NodeId result;
+	if (_freeList != NULL_NODE) {
+		result = _freeList;
+		_freeList = _nodes[result].Parent;
+	} else {
+		result = static_cast<NodeId>(_nodes.size());
+		_nodes.emplace_back();
+	}
+	Node& node = _nodes[result];
+	node.Parent = node.Left = node.Right = NULL_NODE;
+	node.Height = 0;
+	node.Entity = entt::null;
+	return result;
+}
+
+void DynamicBvh::_FreeNode(NodeId node) {
+	_nodes[node].Parent = _freeList;
+	_nodes[node].Height = -1;
+	_freeList = node;
+}
+
+void DynamicBvh::_InsertLeaf(NodeId leaf) {
+	if (_root == NULL_NODE) {
+		_root = leaf;
+		_nodes[leaf].Parent = NULL_NODE;
+		return;
+	}
+
+	// Walk down the tree towards whichever child would grow the least by taking the leaf, stopping once it's
+	// cheaper to pair the leaf with the current node than to push it any further down
+	const glm::vec3 leafMin = _nodes[leaf].Min;
+	const glm::vec3 leafMax = _nodes[leaf].Max;
+	NodeId sibling = _root;
+	while (!_nodes[sibling].IsLeaf()) {
+		const Node& node = _nodes[sibling];
+		const float area = GetArea(node.Min, node.Max);
+		const float combinedArea = GetArea(glm::min(node.Min, leafMin), glm::max(node.Max, leafMax));
+		// Making a new parent here costs the combined area, and every ancestor has to grow to fit the leaf
+		const float cost = 2.0f * combinedArea;
+		const float inheritedCost = 2.0f * (combinedArea - area);
+
+		auto descendCost = [&](NodeId child) {
+			const Node& c = _nodes[child];
+			const float grown = GetArea(glm::min(c.Min, leafMin), glm::max(c.Max, leafMax));
+			return c.IsLeaf() ? grown + inheritedCost : grown - GetArea(c.Min, c.Max) + inheritedCost;
+		};
+		const float leftCost = descendCost(node.Left);
+		const float rightCost = descendCost(node.Right);
+		if (cost < leftCost && cost < rightCost) {
+			break;
+		}
+		sibling = leftCost < rightCost ? node.Left : node.Right;
+	}
+
+	// Put a new parent in between the sibling and it's old parent
+	const NodeId oldParent = _nodes[sibling].Parent;
+	const NodeId newParent = _AllocateNode();
+	Node& parent = _nodes[newParent];
+	parent.Parent = oldParent;
+	parent.Left = sibling;
+	parent.Right = leaf;
+	_nodes[sibling].Parent = newParent;
+	_nodes[leaf].Parent = newParent;
+	if (oldParent == NULL_NODE) {
+		_root = newParent;
+	} else if (_nodes[oldParent].Left == sibling) {
+		_nodes[oldParent].Left = newParent;
+	} else {
+		_nodes[oldParent].Right = newParent;
+	}
+	_Refit(newParent);
+}
+
+void DynamicBvh::_RemoveLeaf(NodeId leaf) {
+	if (leaf == _root) {
+		_root = NULL_NODE;
+		return;
+	}
+	// The leaf's sibling takes it's parent's place
+	const NodeId parent = _nodes[leaf].Parent;
+	const NodeId grandParent = _nodes[parent].Parent;
+	const NodeId sibling = _nodes[parent].Left == leaf ? _nodes[parent].Right : _nodes[parent].Left;
+	_nodes[sibling].Parent = grandParent;
+	if (grandParent == NULL_NODE) {
+		_root = sibling;
+	} else {
+		if (_nodes[grandParent].Left == parent) {
+			_nodes[grandParent].Left = sibling;
+		} else {
+			_nodes[grandParent].Right = sibling;
+		}
+		_Refit(grandParent);
+	}
+	_FreeNode(parent);
+	_nodes[leaf].Parent = NULL_NODE;
+}
+
+void DynamicBvh::_Refit(NodeId node) {
+	while (node != NULL_NODE) {
+		Node& current = _nodes[node];
+		const Node& left = _nodes[current.Left];
+		const Node& right = _nodes[current.Right];
+		current.Min = glm::min(left.Min, right.Min);
+		current.Max = glm::max(left.Max, right.Max);
+		current.Height = 1 + std::max(left.Height, right.Height);
+		node = current.Parent;
+	}
+}
+
+void DynamicBvh::_Rebuild() {
+	std::vector<BuildLeaf> leaves;
+	leaves.reserve(_leafCount);
+	for (const Node& node : _nodes) {
+		if (node.Height == 0) {
+			leaves.push_back({ node.Min, node.Max, (node.Min + node.Max) * 0.5f, node.Entity });
+		}
+	}
+	LOG_ASSERT(leaves.size() == _leafCount, "Lost track of the leaves in the tree!");
+
+	_nodes.clear();
+	_freeList = NULL_NODE;
+	_insertsSinceRebuild = 0;
+	if (leaves.empty()) {
+		_root = NULL_NODE;
+		return;
+	}
+	_nodes.resize(leaves.size() * 2 - 1);
+	_root = 0;
+
+	// Split the top of the tree here until the ranges are small enough to hand out, then build those in parallel
+	std::vector<size_t> deferred;
+	_BuildRange(leaves, 0, leaves.size(), _root, NULL_NODE, &deferred);
+	ThreadPool::Instance().ParallelFor(deferred.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t ix = begin; ix < end; ix++) {
+			const Node& node = _nodes[deferred[ix]];
+			// Deferred ranges stash where their leaves are in the node until they get built
+			_BuildRange(leaves, static_cast<size_t>(node.Left), static_cast<size_t>(node.Right), static_cast<NodeId>(deferred[ix]), node.Parent, nullptr);
+		}
+	});
+	_FinishRange(_root);
+}
+
+void DynamicBvh::_BuildRange(std::vector<BuildLeaf>& leaves, size_t first, size_t count, NodeId node, NodeId parent, std::vector<size_t>* deferred) {
+	Node& result = _nodes[node];
+	result.Parent = parent;
+	if (count == 1) {
+		const BuildLeaf& leaf = leaves[first];
+		result.Min = leaf.Min;
+		result.Max = leaf.Max;
+		result.Left = result.Right = NULL_NODE;
+		result.Height = 0;
+		result.Entity = leaf.Entity;
+		return;
+	}
+	if (deferred != nullptr && count <= PARALLEL_BUILD_BATCH) {
+		result.Left = static_cast<NodeId>(first);
+		result.Right = static_cast<NodeId>(count);
+		deferred->push_back(static_cast<size_t>(node));
+		return;
+	}
+
+	// Split at the median along the longest axis of the centroids
+	glm::vec3 centroidMin = leaves[first].Centroid;
+	glm::vec3 centroidMax = leaves[first].Centroid;
+	for (size_t ix = first + 1; ix < first + count; ix++) {
+		centroidMin = glm::min(centroidMin, leaves[ix].Centroid);
+		centroidMax = glm::max(centroidMax, leaves[ix].Centroid);
+	}
+	const glm::vec3 size = centroidMax - centroidMin;
+	const int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+	const size_t leftCount = count / 2;
+	std::nth_element(leaves.begin() + first, leaves.begin() + first + leftCount, leaves.begin() + first + count,
+		[axis](const BuildLeaf& l, const BuildLeaf& r) { return l.Centroid[axis] < r.Centroid[axis]; });
+
+	// The left branch comes right after this node, and the right one after all of the left's nodes
+	const NodeId left = node + 1;
+	const NodeId right = node + static_cast<NodeId>(leftCount * 2);
+	result.Entity = entt::null;
+	result.Left = left;
+	result.Right = right;
+	_BuildRange(leaves, first, leftCount, left, node, deferred);
+	_BuildRange(leaves, first + leftCount, count - leftCount, right, node, deferred);
+
+	// The top of the tree has to wait for the branches the workers are building, see _FinishRange
+	if (deferred != nullptr) {
+		result.Height = UNFINISHED;
+		return;
+	}
+	result.Min = glm::min(_nodes[left].Min, _nodes[right].Min);
+	result.Max = glm::max(_nodes[left].Max, _nodes[right].Max);
+	result.Height = 1 + std::max(_nodes[left].Height, _nodes[right].Height);
+}
+
+void DynamicBvh::_FinishRange(NodeId node) {
+	Node& current = _nodes[node];
+	if (current.Height != UNFINISHED) {
+		return;
+	}
+	_FinishRange(current.Left);
+	_FinishRange(current.Right);
+	const Node& left = _nodes[current.Left];
+	const Node& right = _nodes[current.Right];
+	current.Min = glm::min(left.Min, right.Min);
+	current.Max = glm::max(left.Max, right.Max);
+	current.Height = 1 + std::max(left.Height, right.Height);
+}
+
+int DynamicBvh::_Classify(const glm::vec4* planes, const glm::vec3& min, const glm::vec3& max) {
+	const glm::vec3 center = (min + max) * 0.5f;
+	const glm::vec3 extents = (max - min) * 0.5f;
+	int result = 1;
+	for (int ix = 0; ix < 6; ix++) {
+		const glm::vec3 normal = glm::vec3(planes[ix]);
+		// How far the box reaches along the plane's normal, and where it's center is
+		const float reach = glm::dot(extents, glm::abs(normal));
+		const float distance = glm::dot(normal, center) + planes[ix].w;
+		if (distance + reach < 0.0f) {
+			return -1;
+		}
+		if (distance - reach < 0.0f) {
+			result = 0;
+		}
+	}
+	return result;
+}
+
+bool DynamicBvh::_RayBox(const glm::vec3& origin, const glm::vec3& inverseDir, const glm::vec3& min, const glm::vec3& max, float maxDistance, float& enter) {
+	const glm::vec3 t0 = (min - origin) * inverseDir;
+	const glm::vec3 t1 = (max - origin) * inverseDir;
+	const glm::vec3 near = glm::min(t0, t1);
+	const glm::vec3 far = glm::max(t0, t1);
+	enter = glm::max(glm::max(near.x, near.y), glm::max(near.z, 0.0f));
+	const float exit = glm::min(glm::min(far.x, far.y), glm::min(far.z, maxDistance));
+	return enter <= exit;
+}
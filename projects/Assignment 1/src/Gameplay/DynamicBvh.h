@@ -0,0 +1,390 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+#include <entt.hpp>
+
+#include "Graphics/BoundingVolume.h"
+#include "Graphics/Frustum.h"
+
+/// <summary>
+/// A bounding volume hierarchy over world space boxes that can be changed one entry at a time. Each leaf stores a
+/// box slightly bigger than what it was given, so small movements don't touch the tree at all, and anything that
+/// moves further gets pulled out and re-inserted next to whatever it's closest to
+///
+/// Inserting things one at a time builds a worse tree than building it all at once, so Rebuild can be used to
+/// build a fresh tree from all of the leaves, splitting the work across the thread pool
+///
+/// Queries don't change the tree, so several of them can run at once as long as nothing is being added, moved or
+/// removed at the same time
+/// </summary>
+class DynamicBvh final
+{
+public:
+	typedef int32_t NodeId;
+	static const NodeId NULL_NODE = -1;
+
+	/// <summary>
+	/// How much bigger than their bounds leaves are made, in world units
+	/// </summary>
+	static float FatMargin;
+
+	DynamicBvh();
+	~DynamicBvh() = default;
+
+	/// <summary>
+	/// Adds an entity to the tree
+	/// </summary>
+	/// <param name="bounds">The entity's bounds, in world space</param>
+	/// <param name="entity">The entity the leaf is for, handed back by the queries</param>
+	/// <returns>The leaf that was added, which stays valid until it's removed or the tree is rebuilt</returns>
+	NodeId Insert(const BoundingVolume& bounds, entt::entity entity);
+	/// <summary>
+	/// Removes a leaf from the tree
+	/// </summary>
+	void Remove(NodeId leaf);
+	/// <summary>
+	/// Updates the bounds of a leaf, only touching the tree if the new bounds have left the leaf's fattened box
+	/// </summary>
+	/// <param name="leaf">The leaf to update</param>
+	/// <param name="bounds">The new bounds, in world space</param>
+	/// <returns>The leaf's new id, leaves get a new id when they're re-inserted</returns>
+	NodeId Move(NodeId leaf, const BoundingVolume& bounds);
+
+	/// <summary>
+	/// Throws away the tree's structure and builds a new one from the leaves, splitting each range of leaves down
+	/// the middle of it's longest axis. The top of the tree is built on the calling thread, and the branches below
+	/// it are built in parallel. Every leaf gets a new id, which are handed to the callback
+	/// </summary>
+	/// <param name="onLeafMoved">Called with the entity and new id of every leaf</param>
+	template <typename Func>
+	void Rebuild(Func onLeafMoved);
+
+	/// <summary>
+	/// Visits every leaf that is at least partially inside of a frustum. Branches that are completely inside are
+	/// accepted without testing anything under them
+	/// </summary>
+	/// <param name="frustum">The frustum to test against</param>
+	/// <param name="visit">Called with the entity and id of each leaf in the frustum</param>
+	template <typename Func>
+	void QueryFrustum(const Frustum& frustum, Func visit) const;
+	/// <summary>
+	/// Visits every leaf that is at least partially inside of any of several frustums, in a single walk of the tree.
+	/// Each node is only tested against the frustums it might still be in, and a frustum that completely contains a
+	/// branch isn't tested again below it
+	/// </summary>
+	/// <param name="frustums">The frustums to test against</param>
+	/// <param name="count">The number of frustums, at most 32</param>
+	/// <param name="visit">Called with the entity, id and a mask of the frustums (bit N for frustums[N]) of each leaf
+	/// that is in at least one of them</param>
+	template <typename Func>
+	void QueryFrustums(const Frustum* frustums, uint32_t count, Func visit) const;
+	/// <summary>
+	/// Visits every leaf whose box overlaps a box
+	/// </summary>
+	template <typename Func>
+	void QueryBox(const glm::vec3& min, const glm::vec3& max, Func visit) const;
+	/// <summary>
+	/// Visits every leaf whose box overlaps a sphere
+	/// </summary>
+	template <typename Func>
+	void QuerySphere(const glm::vec3& center, float radius, Func visit) const;
+	/// <summary>
+	/// Finds the closest leaf along a ray. The visitor decides what counts as a hit, so callers can test against
+	/// the actual geometry, it's handed the distance to the leaf's box and returns the distance to the hit, or a
+	/// negative number for a miss. Leaves further away than the closest hit so far are never visited
+	/// </summary>
+	/// <param name="origin">The start of the ray</param>
+	/// <param name="direction">The direction of the ray, doesn't need to be normalized</param>
+	/// <param name="maxDistance">How far along the ray to look, in multiples of direction</param>
+	/// <param name="hit">Called with the entity and box distance of each candidate leaf, closest first where possible</param>
+	/// <param name="distance">Will store the distance to the closest hit</param>
+	/// <returns>The entity that was hit, or entt::null</returns>
+	template <typename Func>
+	entt::entity Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Func hit, float& distance) const;
+
+	/// <summary>
+	/// Gets the fattened box stored for a leaf
+	/// </summary>
+	void GetFatBounds(NodeId leaf, glm::vec3& min, glm::vec3& max) const {
+		min = _nodes[leaf].Min;
+		max = _nodes[leaf].Max;
+	}
+	/// <summary>
+	/// Gets one more than the largest node id in use, for anything that wants to store extra data per node
+	/// </summary>
+	size_t GetNodeCapacity() const { return _nodes.size(); }
+	/// <summary>
+	/// Gets the number of leaves in the tree
+	/// </summary>
+	size_t GetLeafCount() const { return _leafCount; }
+	/// <summary>
+	/// Gets the number of leaves that have been inserted or re-inserted since the tree was last rebuilt
+	/// </summary>
+	size_t GetInsertsSinceRebuild() const { return _insertsSinceRebuild; }
+	/// <summary>
+	/// Gets the number of levels in the tree, a well balanced tree has around log2 of the leaf count
+	/// </summary>
+	int GetHeight() const { return _root == NULL_NODE ? 0 : _nodes[_root].Height; }
+
+protected:
+	struct Node {
+		glm::vec3    Min;
+		glm::vec3    Max;
+		// For nodes on the free list, this is the next free node instead
+		NodeId       Parent;
+		NodeId       Left;
+		NodeId       Right;
+		// The number of levels below this one, leaves are 0
+		int32_t      Height;
+		entt::entity Entity;
+
+		bool IsLeaf() const { return Left == NULL_NODE; }
+	};
+
+	// A leaf being carried through a rebuild
+	struct BuildLeaf {
+		glm::vec3    Min;
+		glm::vec3    Max;
+		glm::vec3    Centroid;
+		entt::entity Entity;
+	};
+
+	// Branches with fewer leaves than this get built by a single thread
+	static const size_t PARALLEL_BUILD_BATCH = 2048;
+	// The height given to nodes at the top of a rebuild, until their bounds have been filled in
+	static const int32_t UNFINISHED = -2;
+
+	std::vector<Node> _nodes;
+	NodeId            _root;
+	NodeId            _freeList;
+	size_t            _leafCount;
+	size_t            _insertsSinceRebuild;
+
+	NodeId _AllocateNode();
+	void _FreeNode(NodeId node);
+	void _InsertLeaf(NodeId leaf);
+	void _RemoveLeaf(NodeId leaf);
+	// Recomputes the bounds and heights of a node and everything above it
+	void _Refit(NodeId node);
+
+	// Gathers the leaves and builds the new tree, the template Rebuild just hands out the new ids
+	void _Rebuild();
+	// Builds the branch for a range of leaves into the nodes starting at the given index, a range of n leaves
+	// always takes 2n - 1 nodes so branches can be built side by side without fighting over the node array
+	void _BuildRange(std::vector<BuildLeaf>& leaves, size_t first, size_t count, NodeId node, NodeId parent, std::vector<size_t>* deferred);
+	// Fills in the bounds of the nodes built by _BuildRange above the ranges that were deferred to other threads
+	void _FinishRange(NodeId node);
+
+	// Checks which side of the frustum's planes a box is on, -1 for outside, 1 for inside, and 0 for in between
+	static int _Classify(const glm::vec4* planes, const glm::vec3& min, const glm::vec3& max);
+	// Finds where a ray enters a box, returns false if it doesn't
+	static bool _RayBox(const glm::vec3& origin, const glm::vec3& inverseDir, const glm::vec3& min, const glm::vec3& max, float maxDistance, float& enter);
+	// Visits every leaf below a node, without testing anything
+	template <typename Func>
+	void _VisitAll(NodeId node, Func& visit) const;
+};
+
+template <typename Func>
+void DynamicBvh::Rebuild(Func onLeafMoved) {
+	_Rebuild();
+	for (NodeId ix = 0; ix < static_cast<NodeId>(_nodes.size()); ix++) {
+		if (_nodes[ix].IsLeaf()) {
+			onLeafMoved(_nodes[ix].Entity, ix);
+		}
+	}
+}
+
+template <typename Func>
+void DynamicBvh::_VisitAll(NodeId node, Func& visit) const {
+	std::vector<NodeId> stack;
+	stack.reserve(64);
+	stack.push_back(node);
+	while (!stack.empty()) {
+		const NodeId id = stack.back();
+		stack.pop_back();
+		const Node& current = _nodes[id];
+		if (current.IsLeaf()) {
+			visit(current.Entity, id);
+		} else {
+			stack.push_back(current.Left);
+			stack.push_back(current.Right);
+		}
+	}
+}
+
+template <typename Func>
+void DynamicBvh::QueryFrustum(const Frustum& frustum, Func visit) const {
+	if (_root == NULL_NODE) {
+		return;
+	}
+	const glm::vec4* planes = frustum.GetPlanes();
+	std::vector<NodeId> stack;
+	stack.reserve(64);
+	stack.push_back(_root);
+	while (!stack.empty()) {
+		const NodeId id = stack.back();
+		stack.pop_back();
+		const Node& node = _nodes[id];
+		const int side = _Classify(planes, node.Min, node.Max);
+		if (side < 0) {
+			continue;
+		}
+		if (side > 0) {
+			_VisitAll(id, visit);
+		} else if (node.IsLeaf()) {
+			visit(node.Entity, id);
+		} else {
+			stack.push_back(node.Left);
+			stack.push_back(node.Right);
+		}
+	}
+}
+
+template <typename Func>
+void DynamicBvh::QueryFrustums(const Frustum* frustums, uint32_t count, Func visit) const {
+	if (_root == NULL_NODE || count == 0) {
+		return;
+	}
+	// Each entry carries the frustums the node might be in, and the ones it's already known to be inside of
+	struct Entry {
+		NodeId   Id;
+		uint32_t Partial;
+		uint32_t Inside;
+	};
+	std::vector<Entry> stack;
+	stack.reserve(64);
+	stack.push_back({ _root, count >= 32 ? ~0u : (1u << count) - 1u, 0u });
+	while (!stack.empty()) {
+		Entry entry = stack.back();
+		stack.pop_back();
+		const Node& node = _nodes[entry.Id];
+		for (uint32_t ix = 0; ix < count; ix++) {
+			const uint32_t bit = 1u << ix;
+			if ((entry.Partial & bit) == 0) {
+				continue;
+			}
+			const int side = _Classify(frustums[ix].GetPlanes(), node.Min, node.Max);
+			if (side != 0) {
+				entry.Partial &= ~bit;
+				entry.Inside |= side > 0 ? bit : 0u;
+			}
+		}
+		if ((entry.Partial | entry.Inside) == 0) {
+			continue;
+		}
+		if (entry.Partial == 0) {
+			const uint32_t mask = entry.Inside;
+			auto visitInside = [&](entt::entity entity, NodeId id) { visit(entity, id, mask); };
+			_VisitAll(entry.Id, visitInside);
+		} else if (node.IsLeaf()) {
+			visit(node.Entity, entry.Id, entry.Partial | entry.Inside);
+		} else {
+			stack.push_back({ node.Left, entry.Partial, entry.Inside });
+			stack.push_back({ node.Right, entry.Partial, entry.Inside });
+		}
+	}
+}
+
+template <typename Func>
+void DynamicBvh::QueryBox(const glm::vec3& min, const glm::vec3& max, Func visit) const {
+	if (_root == NULL_NODE) {
+		return;
+	}
+	std::vector<NodeId> stack;
+	stack.reserve(64);
+	stack.push_back(_root);
+	while (!stack.empty()) {
+		const NodeId id = stack.back();
+		stack.pop_back();
+		const Node& node = _nodes[id];
+		if (glm::any(glm::lessThan(node.Max, min)) || glm::any(glm::greaterThan(node.Min, max))) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			visit(node.Entity, id);
+		} else {
+			stack.push_back(node.Left);
+			stack.push_back(node.Right);
+		}
+	}
+}
+
+template <typename Func>
+void DynamicBvh::QuerySphere(const glm::vec3& center, float radius, Func visit) const {
+	if (_root == NULL_NODE) {
+		return;
+	}
+	const float radiusSq = radius * radius;
+	std::vector<NodeId> stack;
+	stack.reserve(64);
+	stack.push_back(_root);
+	while (!stack.empty()) {
+		const NodeId id = stack.back();
+		stack.pop_back();
+		const Node& node = _nodes[id];
+		// The closest point in the box to the center tells us if they overlap
+		const glm::vec3 offset = glm::clamp(center, node.Min, node.Max) - center;
+		if (glm::dot(offset, offset) > radiusSq) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			visit(node.Entity, id);
+		} else {
+			stack.push_back(node.Left);
+			stack.push_back(node.Right);
+		}
+	}
+}
+
+template <typename Func>
+entt::entity DynamicBvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Func hit, float& distance) const {
+	entt::entity result = entt::null;
+	distance = maxDistance;
+	if (_root == NULL_NODE) {
+		return result;
+	}
+	// Dividing by zero gives infinities, which the slab test handles on it's own
+	const glm::vec3 inverseDir = 1.0f / direction;
+	std::vector<std::pair<NodeId, float>> stack;
+	stack.reserve(64);
+	float enter;
+	if (_RayBox(origin, inverseDir, _nodes[_root].Min, _nodes[_root].Max, distance, enter)) {
+		stack.push_back({ _root, enter });
+	}
+	while (!stack.empty()) {
+		const std::pair<NodeId, float> entry = stack.back();
+		stack.pop_back();
+		// Something closer may have been hit since this was pushed
+		if (entry.second > distance) {
+			continue;
+		}
+		const Node& node = _nodes[entry.first];
+		if (node.IsLeaf()) {
+			const float hitDistance = hit(node.Entity, entry.second);
+			if (hitDistance >= 0.0f && hitDistance < distance) {
+				distance = hitDistance;
+				result = node.Entity;
+			}
+			continue;
+		}
+		// Push the further child first, so the closer one gets visited first and can cut the other one off
+		float enterLeft, enterRight;
+		const bool hitLeft  = _RayBox(origin, inverseDir, _nodes[node.Left].Min, _nodes[node.Left].Max, distance, enterLeft);
+		const bool hitRight = _RayBox(origin, inverseDir, _nodes[node.Right].Min, _nodes[node.Right].Max, distance, enterRight);
+		if (hitLeft && hitRight) {
+			if (enterLeft < enterRight) {
+				stack.push_back({ node.Right, enterRight });
+				stack.push_back({ node.Left, enterLeft });
+			} else {
+				stack.push_back({ node.Left, enterLeft });
+				stack.push_back({ node.Right, enterRight });
+			}
+		} else if (hitLeft) {
+			stack.push_back({ node.Left, enterLeft });
+		} else if (hitRight) {
+			stack.push_back({ node.Right, enterRight });
+		}
+	}
+	return result;
+}
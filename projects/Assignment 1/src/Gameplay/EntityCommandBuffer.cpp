@@ -0,0 +1,31 @@
+#include "EntityCommandBuffer.h"
+
+#include "Scene.h"
+
+void EntityCommandBuffer::Create(const std::string& name, std::function<void(entt::handle)> setup) {
+	_commands.push_back([name, setup](GameScene& scene) {
+		entt::handle entity = scene.CreateEntity(name);
+		if (setup) {
+			setup(entity);
+		}
+	});
+}
+
+void EntityCommandBuffer::Destroy(entt::entity entity) {
+	_destroyed.push_back(entity);
+}
+
+void EntityCommandBuffer::Playback(GameScene& scene, std::vector<entt::entity>& destroyed) {
+	// Setup callbacks can record more commands, so we swap the list out before running it
+	std::vector<std::function<void(GameScene&)>> commands;
+	commands.swap(_commands);
+	for (const std::function<void(GameScene&)>& command : commands) {
+		command(scene);
+	}
+	destroyed.insert(destroyed.end(), _destroyed.begin(), _destroyed.end());
+	_destroyed.clear();
+}
+
+entt::registry& EntityCommandBuffer::_GetRegistry(GameScene& scene) {
+	return scene.Registry();
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include <entt.hpp>
+
+class GameScene;
+
+/// <summary>
+/// Records changes to a scene's entities (creating, destroying, adding and removing components) so they can be made
+/// later on the main thread. The registry can't have entities or components added or removed while systems are
+/// running on other threads, so anything that does should go through the scene's command buffer instead
+///
+/// Every thread gets it's own buffer from GameScene::Commands, so recording never needs a lock. The buffers are
+/// played back by GameScene::Poll, in the order the commands were recorded on each thread
+/// </summary>
+class EntityCommandBuffer final
+{
+public:
+	EntityCommandBuffer() = default;
+	~EntityCommandBuffer() = default;
+
+	EntityCommandBuffer(const EntityCommandBuffer& other) = delete;
+	EntityCommandBuffer& operator=(const EntityCommandBuffer& other) = delete;
+
+	/// <summary>
+	/// Queues up a new entity to be created
+	/// </summary>
+	/// <param name="name">The name of the new entity</param>
+	/// <param name="setup">Will be called with the new entity once it's been created, can be used to add components</param>
+	void Create(const std::string& name, std::function<void(entt::handle)> setup = nullptr);
+	/// <summary>
+	/// Queues up an entity to be destroyed, after every other command has been played back
+	/// </summary>
+	void Destroy(entt::entity entity);
+
+	/// <summary>
+	/// Queues up a component to be added to an entity, replacing it if the entity already has one. Skipped if the
+	/// entity is gone by the time the command is played back
+	/// </summary>
+	/// <typeparam name="T">The type of component to add, must be copyable</typeparam>
+	/// <param name="entity">The entity to add the component to</param>
+	/// <param name="args">The arguments to construct the component with</param>
+	template <typename T, typename ... TArgs>
+	void Emplace(entt::entity entity, TArgs&&... args) {
+		_commands.push_back([entity, component = T{ std::forward<TArgs>(args)... }](GameScene& scene) {
+			entt::registry& registry = _GetRegistry(scene);
+			if (registry.valid(entity)) {
+				registry.emplace_or_replace<T>(entity, component);
+			}
+		});
+	}
+
+	/// <summary>
+	/// Queues up a component to be removed from an entity, if it still has one when the command is played back
+	/// </summary>
+	/// <typeparam name="T">The type of component to remove</typeparam>
+	/// <param name="entity">The entity to remove the component from</param>
+	template <typename T>
+	void Remove(entt::entity entity) {
+		_commands.push_back([entity](GameScene& scene) {
+			entt::registry& registry = _GetRegistry(scene);
+			if (registry.valid(entity)) {
+				registry.remove_if_exists<T>(entity);
+			}
+		});
+	}
+
+	/// <summary>
+	/// Returns true if nothing has been recorded since the last playback
+	/// </summary>
+	bool IsEmpty() const { return _commands.empty() && _destroyed.empty(); }
+
+	/// <summary>
+	/// Runs every recorded command against the scene and clears the buffer. Entities queued for destruction are added
+	/// to the end of the given list rather than destroyed, so they can be destroyed after every buffer has played back
+	/// </summary>
+	/// <param name="scene">The scene to apply the commands to</param>
+	/// <param name="destroyed">Will have the entities to destroy appended to it</param>
+	void Playback(GameScene& scene, std::vector<entt::entity>& destroyed);
+
+protected:
+	std::vector<std::function<void(GameScene&)>> _commands;
+	std::vector<entt::entity>                    _destroyed;
+
+	// Lets the templates get at the registry without needing the whole scene header
+	static entt::registry& _GetRegistry(GameScene& scene);
+};
@@ -0,0 +1,150 @@
+#include "FrameScheduler.h"
+
+#include <algorithm>
+
+#include "Utilities/CpuProfiler.h"
+
+float    FrameScheduler::HeadroomFraction = 0.5f;
+float    FrameScheduler::MaxBudgetMs      = 4.0f;
+uint32_t FrameScheduler::MaxWaitFrames    = 120;
+
+std::recursive_mutex                   FrameScheduler::_mutex;
+std::vector<FrameScheduler::Entry>     FrameScheduler::_tasks;
+std::unordered_map<std::string, float> FrameScheduler::_costs;
+FrameScheduler::TaskId                 FrameScheduler::_nextId = 1;
+size_t                                 FrameScheduler::_cursor = 0;
+float                                  FrameScheduler::_scale = 1.0f;
+FrameScheduler::Stats                  FrameScheduler::_stats = FrameScheduler::Stats();
+
+// How far over the frame period a frame can go before we count it as late, so timer noise doesn't trip it
+static const double LATE_FRAME = 1.05;
+// How much of the headroom we give up each late frame, and get back each frame that's on time
+static const float  BACK_OFF = 0.5f;
+static const float  RECOVER = 1.1f;
+static const float  MIN_SCALE = 1.0f / 16.0f;
+
+// Turns milliseconds into ticks for Timing::GetTicks
+static int64_t ToTicks(double milliseconds) {
+	return static_cast<int64_t>(milliseconds * Timing::TicksPerSecond() / 1000.0);
+}
+
+FrameScheduler::TaskId FrameScheduler::Add(const char* name, float estimateMs, SliceFunc&& slice) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	auto cost = _costs.find(name);
+	const TaskId id = _nextId++;
+	_tasks.push_back({ id, name, cost != _costs.end() ? cost->second : estimateMs, 0, std::move(slice) });
+	return id;
+}
+
+void FrameScheduler::Remove(TaskId task) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	// Only marked here, since we might be inside of a slice that Run is iterating over. Run sweeps them up after
+	for (Entry& entry : _tasks) {
+		if (entry.Id == task) {
+			entry.Id = INVALID_TASK;
+		}
+	}
+}
+
+bool FrameScheduler::IsPending(TaskId task) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return task != INVALID_TASK && std::any_of(_tasks.begin(), _tasks.end(), [task](const Entry& entry) { return entry.Id == task; });
+}
+
+void FrameScheduler::Clear() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_tasks.clear();
+	_cursor = 0;
+}
+
+FrameScheduler::Stats FrameScheduler::GetStats() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _stats;
+}
+
+void FrameScheduler::Run() {
+	PROFILE_SCOPE("FrameScheduler");
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	const Timing& timing = Timing::Instance();
+	const int64_t start = Timing::GetTicks();
+
+	// Headroom only tells us about the CPU side of this frame, if frames are still running over (ex: when we're waiting
+	// on the GPU) we back off until they aren't
+	const bool wasLate = timing.DeltaTime > timing.GetFramePeriod() * LATE_FRAME;
+	_scale = wasLate ? std::max(_scale * BACK_OFF, MIN_SCALE) : std::min(_scale * RECOVER, 1.0f);
+	const double headroomMs = timing.GetFrameHeadroom() * 1000.0;
+	const float budgetMs = static_cast<float>(std::clamp(headroomMs * HeadroomFraction * _scale, 0.0, static_cast<double>(MaxBudgetMs)));
+	_stats = Stats();
+	_stats.BudgetMs = budgetMs;
+
+	const size_t count = _tasks.size();
+	if (count > 0) {
+		// A task that has waited too long gets this frame to itself, the one that's waited longest first
+		size_t forced = count;
+		for (size_t ix = 0; ix < count; ix++) {
+			if (_tasks[ix].Id != INVALID_TASK && _tasks[ix].WaitedFrames >= MaxWaitFrames &&
+				(forced == count || _tasks[ix].WaitedFrames > _tasks[forced].WaitedFrames)) {
+				forced = ix;
+			}
+		}
+		if (forced != count) {
+			_RunSlice(forced, start + ToTicks(_tasks[forced].CostMs));
+			_stats.Forced++;
+			for (size_t ix = 0; ix < count; ix++) {
+				_tasks[ix].WaitedFrames += ix != forced ? 1 : 0;
+			}
+		} else {
+			// Everyone takes turns, starting after whoever went last, so one big task can't keep the rest waiting
+			const int64_t end = start + ToTicks(budgetMs);
+			size_t last = _cursor;
+			for (size_t turn = 0; turn < count; turn++) {
+				const size_t ix = (_cursor + turn) % count;
+				if (_tasks[ix].Id == INVALID_TASK) {
+					continue;
+				}
+				const double remainingMs = static_cast<double>(end - Timing::GetTicks()) * 1000.0 / Timing::TicksPerSecond();
+				if (_tasks[ix].CostMs > remainingMs) {
+					_tasks[ix].WaitedFrames++;
+					continue;
+				}
+				_RunSlice(ix, end);
+				last = ix;
+			}
+			_cursor = last + 1;
+		}
+	}
+
+	// Sweep up everything that finished or was removed
+	_tasks.erase(std::remove_if(_tasks.begin(), _tasks.end(), [](const Entry& entry) { return entry.Id == INVALID_TASK; }), _tasks.end());
+	_cursor = _tasks.empty() ? 0 : _cursor % _tasks.size();
+	_stats.Tasks = static_cast<uint32_t>(_tasks.size());
+	_stats.UsedMs = static_cast<float>(static_cast<double>(Timing::GetTicks() - start) * 1000.0 / Timing::TicksPerSecond());
+}
+
+void FrameScheduler::_RunSlice(size_t index, int64_t endTicks) {
+	// The slice might add tasks (moving the list around) or remove itself, so it runs from a copy of it's function
+	const TaskId id = _tasks[index].Id;
+	const char* name = _tasks[index].Name;
+	SliceFunc slice = std::move(_tasks[index].Slice);
+	const int64_t start = Timing::GetTicks();
+	bool isDone;
+	{
+		PROFILE_SCOPE(name);
+		isDone = slice(TimeSlice{ endTicks });
+	}
+	const float elapsedMs = static_cast<float>(static_cast<double>(Timing::GetTicks() - start) * 1000.0 / Timing::TicksPerSecond());
+
+	// Costs go up straight away but come down slowly, since running over the budget is worse than waiting a frame
+	Entry& entry = _tasks[index];
+	entry.CostMs = elapsedMs > entry.CostMs ? elapsedMs : entry.CostMs * 0.8f + elapsedMs * 0.2f;
+	entry.WaitedFrames = 0;
+	_costs[name] = entry.CostMs;
+	if (entry.Id == id) {
+		entry.Slice = std::move(slice);
+		if (isDone) {
+			entry.Id = INVALID_TASK;
+			_stats.Finished++;
+		}
+	}
+	_stats.Slices++;
+}
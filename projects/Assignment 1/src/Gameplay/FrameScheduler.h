@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Timing.h"
+
+/// <summary>
+/// The time a slice of amortized work has to run in, see FrameScheduler
+/// </summary>
+struct TimeSlice {
+	// When the slice should hand back control, in Timing::GetTicks
+	int64_t EndTicks;
+
+	/// <summary>
+	/// Returns true while the slice still has time left, work made of many small steps should check this between them
+	/// </summary>
+	bool HasTime() const { return Timing::GetTicks() < EndTicks; }
+};
+
+/// <summary>
+/// Runs work that doesn't need to finish in one frame (ex: rebuilding a BVH, baking, cooking) in slices, using the time
+/// that's left at the end of each frame. Each task comes with a guess at how long a slice of it takes, and a slice is
+/// only started if it fits in what's left of the frame's budget, so maintenance never pushes a frame past it's
+/// deadline. Tasks take turns, so a long task can't hold up the rest
+///
+/// The budget comes from the frame's measured headroom (see Timing::GetFrameHeadroom), and backs off whenever a frame
+/// runs over. The actual time each slice takes replaces the guess as tasks run, and is remembered by name for the
+/// next task with the same name
+///
+/// Add and Remove can be called from any thread, Run only from the main thread
+/// </summary>
+class FrameScheduler final
+{
+public:
+	typedef uint32_t TaskId;
+	static const TaskId INVALID_TASK = 0;
+	/// <summary>
+	/// Runs one slice of a task, returns true once the task is done and can be dropped
+	/// </summary>
+	typedef std::function<bool(const TimeSlice&)> SliceFunc;
+
+	/// <summary>
+	/// The fraction of the frame's headroom we let the tasks have, the rest covers the swap and any noise
+	/// </summary>
+	static float    HeadroomFraction;
+	/// <summary>
+	/// The most time the tasks can have in a frame, in milliseconds, no matter how much headroom there is
+	/// </summary>
+	static float    MaxBudgetMs;
+	/// <summary>
+	/// A task whose slices never fit gets a slice anyways after waiting this many frames, on it's own, so it can't be
+	/// put off forever
+	/// </summary>
+	static uint32_t MaxWaitFrames;
+
+	struct Stats {
+		uint32_t Tasks;
+		uint32_t Slices;
+		uint32_t Finished;
+		// Slices that ran after waiting MaxWaitFrames, despite not fitting
+		uint32_t Forced;
+		float    BudgetMs;
+		float    UsedMs;
+	};
+
+	/// <summary>
+	/// Adds a task, it's first slice runs in the first frame with room for it
+	/// </summary>
+	/// <param name="name">The name of the task, which is also it's zone in the profiler, so it has to be a literal</param>
+	/// <param name="estimateMs">About how long a slice takes, only used until a task with this name has run</param>
+	/// <param name="slice">Runs a slice of the task, returning true once the task is done</param>
+	/// <returns>The task's id, for Remove and IsPending</returns>
+	static TaskId Add(const char* name, float estimateMs, SliceFunc&& slice);
+	/// <summary>
+	/// Drops a task that hasn't finished, once this returns the task will never run again (if it's running on the main
+	/// thread right now, this waits for the slice to finish)
+	/// </summary>
+	static void Remove(TaskId task);
+	/// <summary>
+	/// Returns true if a task hasn't finished or been removed yet
+	/// </summary>
+	static bool IsPending(TaskId task);
+
+	/// <summary>
+	/// Runs as many slices as fit in what's left of the frame, should be called once per frame on the main thread,
+	/// as late as possible before the swap and once nothing else is touching the scene
+	/// </summary>
+	static void Run();
+	/// <summary>
+	/// Drops every task
+	/// </summary>
+	static void Clear();
+
+	/// <summary>
+	/// Gets the counts from the last Run
+	/// </summary>
+	static Stats GetStats();
+
+protected:
+	FrameScheduler() = default;
+
+	struct Entry {
+		TaskId      Id;
+		const char* Name;
+		float       CostMs;
+		uint32_t    WaitedFrames;
+		SliceFunc   Slice;
+	};
+
+	// Recursive, so slices can add and remove tasks
+	static std::recursive_mutex _mutex;
+	static std::vector<Entry>   _tasks;
+	// How long a slice of each task took the last time one ran, by name
+	static std::unordered_map<std::string, float> _costs;
+	static TaskId               _nextId;
+	// Where the next frame's turns start from
+	static size_t               _cursor;
+	// How much of the headroom we're using, which drops when frames run over and recovers while they don't
+	static float                _scale;
+	static Stats                _stats;
+
+	// Runs a slice of the task at an index, and updates it's cost with how long it took
+	static void _RunSlice(size_t index, int64_t endTicks);
+};
@@ -2,38 +2,45 @@
 #include <string>
 #include <entt.hpp>
 
+#include "Utilities/NameTable.h"
+
 /// <summary>
 /// Represents information associated with a game object within our scene
+///
+/// The name lives in the NameTable, the tag only holds it's id and hash, so tags can be copied, moved and sorted
+/// without allocating
 /// </summary>
 struct GameObjectTag
 {
-	std::string Name;
-	uint32_t    HashedName;
-	GameObjectTag() : Name(""), HashedName(""_hs) {}
-	GameObjectTag(const GameObjectTag& other) {
-		Name = other.Name;
-		HashedName = other.HashedName;
-	}
-	GameObjectTag(GameObjectTag&& other) noexcept {
-		Name = other.Name;
-		HashedName = other.HashedName;
-	}
-	GameObjectTag& operator=(GameObjectTag&& other) noexcept{
-		Name = other.Name;
-		HashedName = other.HashedName;
-		return *this;
-	}
-	GameObjectTag& operator=(const GameObjectTag& other) noexcept {
-		Name = other.Name;
-		HashedName = other.HashedName;
-		return *this;
-	}
+	NameTable::Id NameId;
+	uint32_t      HashedName;
+
+	GameObjectTag() : NameId(NameTable::EMPTY), HashedName(""_hs) {}
+	GameObjectTag(const std::string& name) : GameObjectTag(NameTable::Intern(name)) {}
+	GameObjectTag(const char* name) : GameObjectTag(NameTable::Intern(name)) {}
+	explicit GameObjectTag(NameTable::Id name) : NameId(name), HashedName(NameTable::GetHash(name)) {}
+	GameObjectTag(const GameObjectTag& other) noexcept = default;
+	GameObjectTag(GameObjectTag&& other) noexcept = default;
+	GameObjectTag& operator=(const GameObjectTag& other) noexcept = default;
+	GameObjectTag& operator=(GameObjectTag&& other) noexcept = default;
 	~GameObjectTag() = default;
-	
-	GameObjectTag(const std::string& name) {
-		Name = name;
-		HashedName = entt::hashed_string::value(name.c_str());
+
+	/// <summary>
+	/// Gets the name of the game object
+	/// </summary>
+	const std::string& GetName() const { return NameTable::Get(NameId); }
+
+	template <typename Archive>
+	void save(Archive& archive) const {
+		archive(GetName());
+	}
+	template <typename Archive>
+	void load(Archive& archive) {
+		std::string name;
+		archive(name);
+		NameId = NameTable::Intern(name);
+		HashedName = NameTable::GetHash(NameId);
 	}
 
 	// TODO: we could expand this in the future for properties that all game objects should have
-};
\ No newline at end of file
+};
@@ -0,0 +1,154 @@
+#include "GpuPicker.h"
+
+#include <cmath>
+
+#include "Graphics/GpuResources.h"
+#include "Graphics/RenderState.h"
+#include "Logging.h"
+
+GpuPicker::GpuPicker() :
+	_isReady(false),
+	_ids(0),
+	_depth(0),
+	_framebuffer(0),
+	_readback(0),
+	_fence(nullptr),
+	_hasRequest(false),
+	_requestPoint(glm::vec2(0.0f)),
+	_requestScale(glm::vec2(1.0f))
+{
+	GPU_RESOURCE_OWNER("GpuPicker");
+	_shader = Shader::Create();
+	_shader->LoadShaderPartFromFile("shaders/pick_id.vert.glsl", GL_VERTEX_SHADER);
+	_shader->LoadShaderPartFromFile("shaders/pick_id.frag.glsl", GL_FRAGMENT_SHADER);
+	_isReady = _shader->Link();
+	if (!_isReady) {
+		LOG_WARN("Picking ID shader failed to compile, nothing can be picked on the GPU");
+	}
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &_ids);
+	glTextureStorage2D(_ids, 1, GL_R32UI, 1, 1);
+	GpuResources::AddRaw(GL_TEXTURE, _ids, 4, "Picking IDs");
+	glCreateTextures(GL_TEXTURE_2D, 1, &_depth);
+	glTextureStorage2D(_depth, 1, GL_DEPTH_COMPONENT32F, 1, 1);
+	GpuResources::AddRaw(GL_TEXTURE, _depth, 4, "Picking Depth");
+	glCreateFramebuffers(1, &_framebuffer);
+	glNamedFramebufferTexture(_framebuffer, GL_COLOR_ATTACHMENT0, _ids, 0);
+	glNamedFramebufferTexture(_framebuffer, GL_DEPTH_ATTACHMENT, _depth, 0);
+	glNamedFramebufferReadBuffer(_framebuffer, GL_COLOR_ATTACHMENT0);
+
+	glCreateBuffers(1, &_readback);
+	glNamedBufferStorage(_readback, sizeof(uint32_t), nullptr, GL_MAP_READ_BIT);
+	GpuResources::AddRaw(GL_BUFFER, _readback, sizeof(uint32_t), "Picking Readback");
+}
+
+GpuPicker::~GpuPicker() {
+	if (_fence != nullptr) {
+		glDeleteSync(_fence);
+	}
+	const GLuint textures[2] = { _ids, _depth };
+	for (GLuint texture : textures) {
+		RenderState::OnTextureDeleted(texture);
+		GpuResources::RemoveRaw(GL_TEXTURE, texture);
+	}
+	glDeleteTextures(2, textures);
+	glDeleteFramebuffers(1, &_framebuffer);
+	GpuResources::RemoveRaw(GL_BUFFER, _readback);
+	glDeleteBuffers(1, &_readback);
+}
+
+void GpuPicker::Request(int viewWidth, int viewHeight, double x, double y) {
+	if (viewWidth <= 0 || viewHeight <= 0) {
+		return;
+	}
+	// The middle of the pixel, so it lands on the same samples the scene does
+	_requestPoint = glm::vec2(
+		static_cast<float>((std::floor(x) + 0.5) / viewWidth * 2.0 - 1.0),
+		static_cast<float>(1.0 - (std::floor(y) + 0.5) / viewHeight * 2.0));
+	_requestScale = glm::vec2(static_cast<float>(viewWidth), static_cast<float>(viewHeight));
+	_hasRequest = true;
+}
+
+void GpuPicker::Render(const RenderSnapshot& snapshot, const VertexBuffer::sptr& records) {
+	// Only one pick is in flight at a time, a new one waits for the last to come back
+	if (!_isReady || !_hasRequest || _fence != nullptr) {
+		return;
+	}
+	_hasRequest = false;
+	_entities.clear();
+
+	// Zoom the projection in on the pixel, so that it covers the whole of our 1x1 target. Done in clip space, so it
+	// works the same for any projection
+	glm::mat4 zoom = glm::mat4(1.0f);
+	zoom[0][0] = _requestScale.x;
+	zoom[1][1] = _requestScale.y;
+	zoom[3][0] = -_requestPoint.x * _requestScale.x;
+	zoom[3][1] = -_requestPoint.y * _requestScale.y;
+
+	GLint viewport[4];
+	GLint previousFramebuffer;
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	glViewport(0, 0, 1, 1);
+	const GLuint noId = 0;
+	const float clearDepth = 1.0f;
+	glClearNamedFramebufferuiv(_framebuffer, GL_COLOR, 0, &noId);
+	glClearNamedFramebufferfv(_framebuffer, GL_DEPTH, 0, &clearDepth);
+	RenderState::SetEnabled(GL_DEPTH_TEST, true);
+	RenderState::SetDepthFunc(GL_LESS);
+	RenderState::SetDepthMask(true);
+	RenderState::SetEnabled(GL_BLEND, false);
+	// Whatever's nearest wins, so there's no need to know which way each material culls
+	RenderState::SetEnabled(GL_CULL_FACE, false);
+
+	_shader->Bind();
+	_shader->SetUniformMatrix("u_PickViewProjection"_hs, zoom * snapshot.Frame.ViewProjection);
+	_DrawBatches(snapshot.Batches, snapshot, records);
+	_DrawBatches(snapshot.WeightedBatches, snapshot, records);
+	_DrawBatches(snapshot.TransparentBatches, snapshot, records);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _readback);
+	glReadPixels(0, 0, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void GpuPicker::_DrawBatches(const std::vector<DrawBatch>& batches, const RenderSnapshot& snapshot, const VertexBuffer::sptr& records) {
+	for (const DrawBatch& batch : batches) {
+		// Batches either draw from the snapshot's instances or the records, anything else (ex: scatters) isn't an
+		// entity per instance
+		const entt::entity* entities = nullptr;
+		if (batch.Instances == nullptr) {
+			const size_t first = static_cast<size_t>(batch.BaseInstance - snapshot.Instances.First);
+			if (first + batch.InstanceCount <= snapshot.InstanceEntities.size()) {
+				entities = snapshot.InstanceEntities.data() + first;
+			}
+		} else if (batch.Instances == records && static_cast<size_t>(batch.BaseInstance + batch.InstanceCount) <= snapshot.RecordEntities.size()) {
+			entities = snapshot.RecordEntities.data() + batch.BaseInstance;
+		}
+		if (entities == nullptr) {
+			continue;
+		}
+		_shader->SetUniform("u_PickBase"_hs, static_cast<int>(_entities.size()));
+		_entities.insert(_entities.end(), entities, entities + batch.InstanceCount);
+		batch.Mesh->SetInstanceBuffer(batch.Instances != nullptr ? batch.Instances : snapshot.Instances.Buffer, InstanceTransform::V_DECL);
+		batch.Mesh->RenderInstanced(batch.InstanceCount, batch.BaseInstance);
+	}
+}
+
+bool GpuPicker::Poll(entt::entity& result) {
+	if (_fence == nullptr || glClientWaitSync(_fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+		return false;
+	}
+	glDeleteSync(_fence);
+	_fence = nullptr;
+
+	uint32_t id = 0;
+	glGetNamedBufferSubData(_readback, 0, sizeof(uint32_t), &id);
+	result = id > 0 && id <= _entities.size() ? _entities[id - 1] : entt::null;
+	return true;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <entt.hpp>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+#include "Graphics/Shader.h"
+#include "Graphics/VertexBuffer.h"
+#include "RenderSnapshot.h"
+
+/// <summary>
+/// Picks the renderer under a point on the screen on the GPU, as an alternative to raycasting the spatial index. The
+/// snapshot's batches get drawn again with a projection zoomed in on the one pixel under the cursor, into a 1x1 target
+/// holding the ID of whichever instance ends up nearest. That pixel is read back through a pixel buffer and resolved
+/// a frame or so later, once it's fence has passed, so neither side ever waits on the other. Every instance is exact
+/// to the pixel, and there's no geometry work on the CPU however dense the scene is
+///
+/// The IDs are handed out per pick, as a table of the entities behind each drawn instance (see
+/// RenderSnapshot::InstanceEntities), so the snapshot needs building with RenderSnapshotSettings::GatherEntities
+/// while the picker is in use. Renderers in the render group are covered whether they're drawn from the snapshot's
+/// instances or the records, scatters and terrains are not. Meshes are drawn as they're stored, so anything moved
+/// by it's vertex shader (ex: billboards, vertex animation) is picked in it's rest pose
+///
+/// Usage: Request with the cursor, Render once per frame with the snapshot being drawn, and Poll for the result
+/// </summary>
+class GpuPicker final
+{
+public:
+	typedef std::shared_ptr<GpuPicker> sptr;
+	static inline sptr Create() {
+		return std::make_shared<GpuPicker>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	GpuPicker(const GpuPicker& other) = delete;
+	GpuPicker(GpuPicker&& other) = delete;
+	GpuPicker& operator=(const GpuPicker& other) = delete;
+	GpuPicker& operator=(GpuPicker&& other) = delete;
+
+public:
+	/// <summary>
+	/// Compiles the ID shader and creates the 1x1 target and the read back buffer
+	/// </summary>
+	GpuPicker();
+	~GpuPicker();
+
+	/// <summary>
+	/// Returns true if the ID shader compiled, if not nothing can be picked
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Asks for whatever's under a point of the view, it gets drawn the next time Render is called. Replaces any
+	/// request that hasn't been drawn yet
+	/// </summary>
+	/// <param name="viewWidth">The width of the view, in pixels</param>
+	/// <param name="viewHeight">The height of the view, in pixels</param>
+	/// <param name="x">The pixel to pick, from the left of the view</param>
+	/// <param name="y">The pixel to pick, from the top of the view</param>
+	void Request(int viewWidth, int viewHeight, double x, double y);
+	/// <summary>
+	/// Returns true if a pick has been asked for and hasn't come back yet
+	/// </summary>
+	bool IsPending() const { return _hasRequest || _fence != nullptr; }
+
+	/// <summary>
+	/// Draws the requested pick, if there is one and the last one has come back. Must be called on the main thread
+	/// after the snapshot's records have been applied, and leaves the depth test on and face culling off
+	/// </summary>
+	/// <param name="snapshot">The snapshot being drawn this frame, built with GatherEntities</param>
+	/// <param name="records">The buffer the snapshot's records are in, or nullptr if there are none</param>
+	void Render(const RenderSnapshot& snapshot, const VertexBuffer::sptr& records);
+	/// <summary>
+	/// Picks up the last pick if the GPU is done with it, without waiting
+	/// </summary>
+	/// <param name="result">Set to the entity that was picked, or entt::null if there was nothing there</param>
+	/// <returns>True if a pick came back</returns>
+	bool Poll(entt::entity& result);
+
+	/// <summary>
+	/// Gets the number of instances drawn by the last pick
+	/// </summary>
+	uint32_t GetDrawnCount() const { return static_cast<uint32_t>(_entities.size()); }
+
+protected:
+	Shader::sptr _shader;
+	bool         _isReady;
+	GLuint       _ids;
+	GLuint       _depth;
+	GLuint       _framebuffer;
+	GLuint       _readback;
+	GLsync       _fence;
+	// The pixel waiting to be drawn, in normalized device coordinates, and how many pixels there are per unit
+	bool         _hasRequest;
+	glm::vec2    _requestPoint;
+	glm::vec2    _requestScale;
+	// The entity behind each ID drawn by the pick in flight, an ID of 0 is nothing so they're offset by one
+	std::vector<entt::entity> _entities;
+
+	// Draws a run of batches, giving each instance the next IDs along. Batches whose instances we can't trace back to
+	// an entity are skipped
+	void _DrawBatches(const std::vector<DrawBatch>& batches, const RenderSnapshot& snapshot, const VertexBuffer::sptr& records);
+};
@@ -2,6 +2,8 @@
 #include <memory>
 #include <entt.hpp>
 #include <typeindex>
+#include <vector>
+#include "BehaviourPool.h"
 struct BehaviourBinding;
 
 /*
@@ -54,10 +56,70 @@ protected:
 };
 
 /*
- * The component added to an entt entity to connect a behaviour to a specific entity
+ * A behaviour owned by a BehaviourBinding, which lives in the BehaviourPool for it's type
+ */
+struct BehaviourSlot {
+	IBehaviour*     Behaviour;
+	IBehaviourPool* Pool;
+	uint32_t        Index;
+
+	IBehaviour* get() const { return Behaviour; }
+	IBehaviour* operator->() const { return Behaviour; }
+	IBehaviour& operator*() const { return *Behaviour; }
+};
+
+/*
+ * The component added to an entt entity to connect a behaviour to a specific entity. The binding owns it's
+ * behaviours, they go back to their pools when it's removed or it's entity is destroyed
  */
 struct BehaviourBinding {
-	std::vector<std::shared_ptr<IBehaviour>> Behaviours;
+	/*
+	 * A small id for each type of behaviour, handed out the first time the type is bound to anything
+	 */
+	typedef entt::family<IBehaviour> Family;
+
+	std::vector<BehaviourSlot> Behaviours;
+	/*
+	 * For each behaviour type id, the index + 1 of the first behaviour of that type in Behaviours, or 0 if there is
+	 * none. Lets Get and Has find a behaviour without scanning the list and comparing type info
+	 */
+	std::vector<uint32_t> Slots;
+
+	BehaviourBinding() = default;
+	/*
+	 * Copies get their own copy of each behaviour (ex: when stamping a prefab), rather than sharing them
+	 */
+	BehaviourBinding(const BehaviourBinding& other) : Slots(other.Slots) {
+		Behaviours.reserve(other.Behaviours.size());
+		for (const BehaviourSlot& slot : other.Behaviours) {
+			const uint32_t index = slot.Pool->Clone(slot.Index);
+			Behaviours.push_back({ slot.Pool->GetBase(index), slot.Pool, index });
+		}
+	}
+	BehaviourBinding(BehaviourBinding&& other) noexcept :
+		Behaviours(std::move(other.Behaviours)),
+		Slots(std::move(other.Slots))
+	{
+		other.Behaviours.clear();
+		other.Slots.clear();
+	}
+	BehaviourBinding& operator=(const BehaviourBinding& other) {
+		if (this != &other) {
+			*this = BehaviourBinding(other);
+		}
+		return *this;
+	}
+	BehaviourBinding& operator=(BehaviourBinding&& other) noexcept {
+		if (this != &other) {
+			_Clear();
+			Behaviours = std::move(other.Behaviours);
+			Slots = std::move(other.Slots);
+			other.Behaviours.clear();
+			other.Slots.clear();
+		}
+		return *this;
+	}
+	~BehaviourBinding() { _Clear(); }
 
 	/*
 	 * Binds an IBehaviour interface to the given entt entity
@@ -66,17 +128,11 @@ struct BehaviourBinding {
 	 * @param registry The registry that the entity is part of
 	 * @param entity The entity to add the behaviour to
 	 * @param args The arguments to forward to the behaviour's constructor
+	 * @returns A handle to the new behaviour, which goes stale once the behaviour is destroyed
 	 */
 	template <typename T, typename ... TArgs, typename = typename std::enable_if<std::is_base_of<IBehaviour, T>::value>::type>
-	static std::shared_ptr<T> Bind(entt::handle entity, TArgs&&... args) {
-		// Get the binding component
-		BehaviourBinding& binding = entity.get_or_emplace<BehaviourBinding>();
-		// Make a new behaviour, forwarding the arguments
-		const std::shared_ptr<IBehaviour> behaviour = std::make_shared<T>(std::forward<TArgs>(args)...);
-		// Append it to the binding component's storage, and invoke the OnLoad
-		binding.Behaviours.push_back(behaviour);
-		behaviour->OnLoad(entity);
-		return std::dynamic_pointer_cast<T>(behaviour);
+	static BehaviourHandle<T> Bind(entt::handle entity, TArgs&&... args) {
+		return _Bind<T>(entity, true, std::forward<TArgs>(args)...);
 	}
 
 	/*
@@ -86,18 +142,11 @@ struct BehaviourBinding {
 	 * @param registry The registry that the entity is part of
 	 * @param entity The entity to add the behaviour to
 	 * @param args The arguments to forward to the behaviour's constructor
+	 * @returns A handle to the new behaviour, which goes stale once the behaviour is destroyed
 	 */
 	template <typename T, typename ... TArgs, typename = typename std::enable_if<std::is_base_of<IBehaviour, T>::value>::type>
-	static std::shared_ptr<T> BindDisabled(entt::handle entity, TArgs&&... args) {
-		// Get the binding component
-		BehaviourBinding& binding = entity.get_or_emplace<BehaviourBinding>();
-		// Make a new behaviour, forwarding the arguments
-		const std::shared_ptr<IBehaviour> behaviour = std::make_shared<T>(std::forward<TArgs>(args)...);
-		behaviour->Enabled = false;
-		// Append it to the binding component's storage, and invoke the OnLoad
-		binding.Behaviours.push_back(behaviour);
-		behaviour->OnLoad(entity);
-		return std::dynamic_pointer_cast<T>(behaviour);
+	static BehaviourHandle<T> BindDisabled(entt::handle entity, TArgs&&... args) {
+		return _Bind<T>(entity, false, std::forward<TArgs>(args)...);
 	}
 
 	
@@ -111,19 +160,8 @@ struct BehaviourBinding {
 	template <typename T, typename = typename std::enable_if<std::is_base_of<IBehaviour, T>::value>::type>
 	static bool Has(entt::handle entity) {
 		// Check to see if the entity has a behaviour binding attached
-		if (entity.has<BehaviourBinding>()) {
-			// Get the binding component
-			const auto& binding = entity.get<BehaviourBinding>();
-			// Iterate over all the pointers in the binding list
-			for (const auto& ptr : binding.Behaviours) {
-				// If the pointer type matches T, we return true
-				if (std::type_index(typeid(*ptr.get())) == std::type_index(typeid(T))) {
-					return true;
-				}
-			}
-			return false;
-		}
-		else return false;
+		const BehaviourBinding* binding = entity.try_get<BehaviourBinding>();
+		return binding != nullptr && binding->_Find(Family::type<T>) != nullptr;
 	}
 
 	/*
@@ -131,23 +169,60 @@ struct BehaviourBinding {
 	 * @param T The type of behaviour to check for
 	 * @param registry The registry that the entity is part of
 	 * @param entity The entity to search
-	 * @returns The behaviour of type T that is attached to entity, or nullptr if no behaviour of that type is attached
+	 * @returns The behaviour of type T that is attached to entity, or an empty handle if no behaviour of that type is attached
 	 */
 	template <typename T, typename = typename std::enable_if<std::is_base_of<IBehaviour, T>::value>::type>
-	static std::shared_ptr<T> Get(entt::handle entity) {
+	static BehaviourHandle<T> Get(entt::handle entity) {
 		// Check to see if the entity has a behaviour binding attached
-		if (entity.has<BehaviourBinding>()) {
-			// Get the binding component
-			const auto& binding = entity.get<BehaviourBinding>();
-			// Iterate over all the pointers in the binding list
-			for (const auto& ptr : binding.Behaviours) {
-				// If the pointer type matches T, we return that behaviour, making sure to cast it back to the requested type
-				if (std::type_index(typeid(*ptr.get())) == std::type_index(typeid(T))) {
-					return std::dynamic_pointer_cast<T>(ptr);
-				}
+		const BehaviourBinding* binding = entity.try_get<BehaviourBinding>();
+		if (binding != nullptr) {
+			// The slot was filled in by Bind<T>, so we know the behaviour really is a T in T's pool
+			const BehaviourSlot* behaviour = binding->_Find(Family::type<T>);
+			if (behaviour != nullptr) {
+				return BehaviourHandle<T>(behaviour->Index, behaviour->Pool->GetGeneration(behaviour->Index));
 			}
-			return nullptr;
 		}
-		else return nullptr;
+		return nullptr;
+	}
+
+private:
+	friend class SceneSerializer;
+
+	template <typename T, typename ... TArgs>
+	static BehaviourHandle<T> _Bind(entt::handle entity, bool enabled, TArgs&&... args) {
+		// Get the binding component
+		BehaviourBinding& binding = entity.get_or_emplace<BehaviourBinding>();
+		// Make a new behaviour in a free slot of it's pool, forwarding the arguments
+		BehaviourPool<T>& pool = BehaviourPool<T>::Instance();
+		const uint32_t index = pool.Allocate(std::forward<TArgs>(args)...);
+		IBehaviour* behaviour = pool.GetBase(index);
+		behaviour->Enabled = enabled;
+		// Append it to the binding component's storage, and invoke the OnLoad
+		binding._Add(Family::type<T>, { behaviour, &pool, index });
+		behaviour->OnLoad(entity);
+		return BehaviourHandle<T>(index, pool.GetGeneration(index));
+	}
+
+	void _Add(Family::family_type type, const BehaviourSlot& behaviour) {
+		Behaviours.push_back(behaviour);
+		if (type >= Slots.size()) {
+			Slots.resize(type + 1, 0);
+		}
+		// Get only ever returned the first behaviour of a type, so later ones don't take over the slot
+		if (Slots[type] == 0) {
+			Slots[type] = static_cast<uint32_t>(Behaviours.size());
+		}
+	}
+
+	const BehaviourSlot* _Find(Family::family_type type) const {
+		return type < Slots.size() && Slots[type] != 0 ? &Behaviours[Slots[type] - 1] : nullptr;
+	}
+
+	void _Clear() {
+		for (const BehaviourSlot& behaviour : Behaviours) {
+			behaviour.Pool->Release(behaviour.Index);
+		}
+		Behaviours.clear();
+		Slots.clear();
 	}
 };
\ No newline at end of file
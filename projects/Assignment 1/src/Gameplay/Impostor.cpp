@@ -0,0 +1,159 @@
+#include "Impostor.h"
+
+#include <GLM/gtc/matrix_transform.hpp>
+
+#include "Graphics/GpuResources.h"
+#include "Graphics/RenderState.h"
+#include "Graphics/UniformBlocks.h"
+#include "Graphics/UniformBuffer.h"
+#include "Graphics/VertexBuffer.h"
+#include "Logging.h"
+#include "Utilities/MeshBuilder.h"
+#include "Utilities/VertexTypes.h"
+
+// Must match EncodeOctahedron in impostor.vert.glsl, unfolds a point on the square back onto the unit sphere
+static glm::vec3 DecodeOctahedron(const glm::vec2& e) {
+	glm::vec3 n(e, 1.0f - glm::abs(e.x) - glm::abs(e.y));
+	const float t = glm::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+
+Impostor::sptr Impostor::Bake(const VertexArrayObject::sptr& mesh, const ShaderMaterial::sptr& material, const Shader::sptr& gbufferShader, const Shader::sptr& impostorShader) {
+	GPU_RESOURCE_OWNER("Impostor");
+	if (mesh == nullptr || material == nullptr || gbufferShader == nullptr || !gbufferShader->IsReady()) {
+		LOG_WARN("Can't bake an impostor without a mesh, a material and a G-buffer shader that's ready");
+		return nullptr;
+	}
+	const BoundingVolume& bounds = mesh->GetBounds();
+	if (bounds.Radius <= 0.0f) {
+		LOG_WARN("Can't bake an impostor for a mesh without bounds");
+		return nullptr;
+	}
+
+	sptr result = std::make_shared<Impostor>();
+	result->_source = material;
+
+	// The atlases get mip mapped, so views that are only a few pixels tall still blend nicely
+	Texture2DDescription desc;
+	desc.Width = desc.Height = FRAMES * FRAME_SIZE;
+	desc.Format = InternalFormat::RGBA8;
+	desc.HorizontalWrap = desc.VerticalWrap = WrapMode::ClampToEdge;
+	desc.MinificationFilter = MinFilter::LinearMipLinear;
+	desc.MagnificationFilter = MagFilter::Linear;
+	result->_albedo = Texture2D::Create(desc);
+	result->_normal = Texture2D::Create(desc);
+
+	GLuint depth = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &depth);
+	glTextureStorage2D(depth, 1, GL_DEPTH_COMPONENT32F, desc.Width, desc.Height);
+	GLuint framebuffer = 0;
+	glCreateFramebuffers(1, &framebuffer);
+	glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, result->_albedo->GetHandle(), 0);
+	glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT1, result->_normal->GetHandle(), 0);
+	glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, depth, 0);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glNamedFramebufferDrawBuffers(framebuffer, 2, drawBuffers);
+	const bool isComplete = glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	if (isComplete) {
+		// Borrow the frame data binding and the framebuffer, and put them back once we're done
+		GLint previousFramebuffer = 0, previousFrameData = 0;
+		GLint previousViewport[4];
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, FRAME_DATA_BINDING, &previousFrameData);
+		glGetIntegerv(GL_VIEWPORT, previousViewport);
+		UniformBuffer<FrameData>::sptr frameUniforms = UniformBuffer<FrameData>::Create();
+		frameUniforms->Bind(FRAME_DATA_BINDING);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		const float clearDepth = 1.0f;
+		RenderState::SetDepthMask(true);
+		RenderState::SetEnabled(GL_DEPTH_TEST, true);
+		glClearNamedFramebufferfv(framebuffer, GL_COLOR, 0, clearColor);
+		glClearNamedFramebufferfv(framebuffer, GL_COLOR, 1, clearColor);
+		glClearNamedFramebufferfv(framebuffer, GL_DEPTH, 0, &clearDepth);
+
+		// Swap in the G-buffer variant, assigning the shader straight back lets the material look it's parameters up
+		// again whenever it's next applied
+		const Shader::sptr previousShader = material->Shader;
+		material->SetShader(gbufferShader);
+		material->Apply();
+
+		// The mesh gets drawn as a single instance in it's own space, so the baked normals are in the mesh's space too
+		VertexBuffer::sptr instance = VertexBuffer::Create();
+		const InstanceTransform identity(glm::mat4(1.0f), glm::mat3(1.0f), material->GetMaterialIndex());
+		instance->LoadData(&identity, 1);
+		mesh->SetInstanceBuffer(instance, InstanceTransform::V_DECL);
+
+		const float radius = bounds.Radius;
+		const glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.0f, radius * 2.0f);
+		for (int y = 0; y < FRAMES; y++) {
+			for (int x = 0; x < FRAMES; x++) {
+				// Each view looks back at the mesh from a point on the grid, with the same basis as impostor.vert.glsl
+				const glm::vec3 dir = DecodeOctahedron(glm::vec2(x, y) / static_cast<float>(FRAMES - 1) * 2.0f - 1.0f);
+				const glm::vec3 reference = glm::abs(dir.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+				const glm::vec3 up = glm::cross(dir, glm::normalize(glm::cross(reference, dir)));
+
+				FrameData& frame = frameUniforms->GetData();
+				frame.View = glm::lookAt(bounds.Center + dir * radius, bounds.Center, up);
+				frame.Projection = projection;
+				frame.ViewProjection = projection * frame.View;
+				frame.CamPos = bounds.Center + dir * radius;
+				frameUniforms->Update();
+				glViewport(x * FRAME_SIZE, y * FRAME_SIZE, FRAME_SIZE, FRAME_SIZE);
+				mesh->RenderInstanced(1, 0);
+			}
+		}
+		material->Shader = previousShader;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+		glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+		glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, previousFrameData);
+		glGenerateTextureMipmap(result->_albedo->GetHandle());
+		glGenerateTextureMipmap(result->_normal->GetHandle());
+	} else {
+		LOG_ERROR("Impostor atlas is incomplete");
+	}
+	glDeleteFramebuffers(1, &framebuffer);
+	RenderState::OnTextureDeleted(depth);
+	glDeleteTextures(1, &depth);
+	if (!isComplete) {
+		return nullptr;
+	}
+
+	// A quad from -1 to 1, the vertex shader turns it to face the camera
+	MeshBuilder<VertexPosNormTexCol> quad;
+	const glm::vec3 normal(0.0f, 0.0f, 1.0f);
+	const glm::vec4 color(1.0f);
+	const uint32_t a = quad.AddVertex(glm::vec3(-1.0f, -1.0f, 0.0f), normal, glm::vec2(0.0f, 0.0f), color);
+	const uint32_t b = quad.AddVertex(glm::vec3( 1.0f, -1.0f, 0.0f), normal, glm::vec2(1.0f, 0.0f), color);
+	const uint32_t c = quad.AddVertex(glm::vec3( 1.0f,  1.0f, 0.0f), normal, glm::vec2(1.0f, 1.0f), color);
+	const uint32_t d = quad.AddVertex(glm::vec3(-1.0f,  1.0f, 0.0f), normal, glm::vec2(0.0f, 1.0f), color);
+	quad.AddIndexTri(a, b, c);
+	quad.AddIndexTri(a, c, d);
+	result->_quad = quad.Bake();
+	// Culling needs bounds that cover the quad whichever way it turns
+	result->_quad->SetBounds(BoundingVolume(bounds.Center - glm::vec3(bounds.Radius), bounds.Center + glm::vec3(bounds.Radius)));
+
+	result->_material = ShaderMaterial::Create();
+	result->_material->Shader = impostorShader;
+	result->_material->RenderLayer = material->RenderLayer;
+	result->_material->DebugName = material->DebugName + " (impostor)";
+	result->_material->Set("s_ImpostorAlbedo", result->_albedo);
+	result->_material->Set("s_ImpostorNormal", result->_normal);
+	result->_material->Set("u_ImpostorCenter", bounds.Center);
+	result->_material->Set("u_ImpostorRadius", bounds.Radius);
+	result->_material->Set("u_ImpostorFrames", static_cast<float>(FRAMES));
+	return result;
+}
+
+void Impostor::SetFadeRange(float start, float end) {
+	_fadeStart = start;
+	_fadeEnd = end;
+	const glm::vec2 range(start, end);
+	_material->Set("u_FadeRange", range);
+	_source->Set("u_FadeRange", range);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+#include "Graphics/Shader.h"
+#include "Graphics/Texture2D.h"
+#include "Graphics/VertexArrayObject.h"
+#include "ShaderMaterial.h"
+
+/// <summary>
+/// A stand in for a mesh that's far from the camera: a single quad facing the camera, textured from an atlas of views
+/// of the mesh baked from FRAMES x FRAMES directions around it. The directions sit on an octahedral grid, which folds
+/// the whole sphere of directions onto a square so the views are spread evenly and the closest ones are easy to find.
+/// The atlases are laid out like the G-buffer (albedo and specular, then normal, shininess and coverage), so the quad
+/// gets lit the same way as the mesh it stands in for
+///
+/// A RendererComponent with an impostor swaps it in past the start of the fade range, the two get dithered against
+/// each other until the end of the range (see DITHER_FADE and IMPOSTOR in frag_blinn_phong_textured.glsl)
+/// </summary>
+class Impostor final
+{
+public:
+	typedef std::shared_ptr<Impostor> sptr;
+	// We'll disallow moving and copying, since we own GPU resources
+	Impostor(const Impostor& other) = delete;
+	Impostor(Impostor&& other) = delete;
+	Impostor& operator=(const Impostor& other) = delete;
+	Impostor& operator=(Impostor&& other) = delete;
+
+public:
+	// The number of views along each side of the atlas
+	static const int FRAMES = 8;
+	// The size of each view, in pixels
+	static const int FRAME_SIZE = 128;
+
+	Impostor() = default;
+	~Impostor() = default;
+
+	/// <summary>
+	/// Bakes the views of a mesh, by drawing it with the G-buffer variant of it's material's shader. Must be called on
+	/// the main thread, the frame data binding gets borrowed and put back
+	/// </summary>
+	/// <param name="mesh">The mesh to bake, must have it's bounds set</param>
+	/// <param name="material">The material the mesh gets drawn with, it's shader gets swapped out while we bake</param>
+	/// <param name="gbufferShader">The variant of the material's shader that writes the G-buffer, must be ready</param>
+	/// <param name="impostorShader">The shader to draw the quads with (impostor.vert.glsl with IMPOSTOR defined)</param>
+	/// <returns>The impostor, or nullptr if the bake failed</returns>
+	static sptr Bake(const VertexArrayObject::sptr& mesh, const ShaderMaterial::sptr& material, const Shader::sptr& gbufferShader, const Shader::sptr& impostorShader);
+
+	/// <summary>
+	/// Sets the distances from the camera that the mesh fades out and the impostor fades in over. Both the impostor's
+	/// material and the source material get updated, since the mesh has to fade out as well
+	/// </summary>
+	/// <param name="start">The distance where the impostor starts getting drawn</param>
+	/// <param name="end">The distance where the mesh stops getting drawn, no more than start to switch without fading</param>
+	void SetFadeRange(float start, float end);
+	float GetFadeStart() const { return _fadeStart; }
+	float GetFadeEnd() const { return _fadeEnd; }
+
+	/// <summary>
+	/// Gets the material to draw the quad with, it's shader needs swapping along with the lighting mode
+	/// </summary>
+	const ShaderMaterial::sptr& GetMaterial() const { return _material; }
+	/// <summary>
+	/// Gets the quad to draw in place of the mesh
+	/// </summary>
+	const VertexArrayObject::sptr& GetMesh() const { return _quad; }
+
+protected:
+	ShaderMaterial::sptr    _source;
+	ShaderMaterial::sptr    _material;
+	VertexArrayObject::sptr _quad;
+	Texture2D::sptr         _albedo;
+	Texture2D::sptr         _normal;
+	float                   _fadeStart = 0.0f;
+	float                   _fadeEnd = 0.0f;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// The kinds of lights we support, the values match the LIGHT_ constants in the shaders
+/// </summary>
+enum class LightType : uint32_t
+{
+	// Shines in every direction from the entity's position
+	Point = 0,
+	// Shines in a cone down the entity's local -Z axis, same as the camera
+	Spot  = 1,
+	// Shines down the entity's local -Z axis from infinitely far away (ex: the sun or moon), and reaches everything
+	Directional = 2
+};
+
+/// <summary>
+/// Lights the scene from an entity's position. Lights get gathered into the render snapshot each frame and binned into
+/// the view's clusters (see ClusteredLighting), so each fragment only shades the lights that can reach it
+///
+/// See https://learnopengl.com/Lighting/Light-casters for how the attenuation and spot light cones work
+/// </summary>
+struct Light
+{
+	LightType Type                 = LightType::Point;
+	glm::vec3 Color                = glm::vec3(1.0f);
+	// How much of the light's color gets added to everything it reaches, regardless of which way it faces
+	float     AmbientStrength      = 0.0f;
+	float     SpecularStrength     = 1.0f;
+	// The light's intensity at a distance d is 1 / (Constant + Linear * d + Quadratic * d * d)
+	float     AttenuationConstant  = 1.0f;
+	float     AttenuationLinear    = 0.09f;
+	float     AttenuationQuadratic = 0.032f;
+	// The angles (in degrees, from the light's forward axis) where a spot light starts to fade out, and where it's gone
+	float     InnerAngle           = 20.0f;
+	float     OuterAngle           = 30.0f;
+	// Whether the light gets a shadow map (see ShadowMaps). Only the first directional light and the closest few
+	// other lights get one
+	bool      CastShadows          = false;
+
+	/// <summary>
+	/// The fraction of a light's brightest channel below which we treat it as not reaching a surface at all
+	/// </summary>
+	static constexpr float CUTOFF = 1.0f / 256.0f;
+	/// <summary>
+	/// The furthest any light may reach, for lights that don't fall off
+	/// </summary>
+	static constexpr float MAX_RANGE = 1000.0f;
+
+	/// <summary>
+	/// Gets the distance where the light's attenuated brightness drops below CUTOFF, directional lights don't fall off
+	/// so they always reach MAX_RANGE
+	/// </summary>
+	float GetRange() const {
+		if (Type == LightType::Directional) {
+			return MAX_RANGE;
+		}
+		// The most the light can add to a surface is it's ambient, diffuse and specular terms all at full strength
+		const float brightest = glm::max(Color.r, glm::max(Color.g, Color.b)) * (AmbientStrength + 1.0f + SpecularStrength);
+		// We want the distance where Constant + Linear * d + Quadratic * d * d = brightest / CUTOFF
+		const float c = AttenuationConstant - brightest / CUTOFF;
+		if (c >= 0.0f) {
+			return 0.0f;
+		}
+		float range = MAX_RANGE;
+		if (AttenuationQuadratic > 0.0f) {
+			range = (-AttenuationLinear + glm::sqrt(AttenuationLinear * AttenuationLinear - 4.0f * AttenuationQuadratic * c)) / (2.0f * AttenuationQuadratic);
+		} else if (AttenuationLinear > 0.0f) {
+			range = -c / AttenuationLinear;
+		}
+		return glm::min(range, MAX_RANGE);
+	}
+
+	template <typename Archive>
+	void serialize(Archive& archive) {
+		archive(Type, Color, AmbientStrength, SpecularStrength,
+			AttenuationConstant, AttenuationLinear, AttenuationQuadratic, InnerAngle, OuterAngle, CastShadows);
+	}
+};
@@ -0,0 +1,528 @@
+#include "Lightmapper.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+
+#include <GLM/gtc/packing.hpp>
+
+#include "Graphics/GpuResources.h"
+#include "Graphics/MeshArena.h"
+#include "Graphics/Texture2DData.h"
+#include "Graphics/UniformBlocks.h"
+#include "Logging.h"
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/MeshBuilder.h"
+#include "Utilities/TriangleBvh.h"
+#include "Utilities/VertexTypes.h"
+#include "Light.h"
+#include "RendererComponent.h"
+#include "StaticBatcher.h"
+#include "Transform.h"
+
+// How many times to scale the charts down before giving up on fitting them into the atlas
+static const int   MAX_FIT_ATTEMPTS = 12;
+// How far outside of a triangle a texel's center can be and still get lit from it, so texels that the edges only
+// partly cover don't end up empty
+static const float MAX_COVER_DISTANCE = 0.75f;
+// How far the shadow rays start off of the surface, so they don't hit the triangle they start from
+static const float SHADOW_BIAS = 0.02f;
+
+struct Lightmapper::Result {
+	// A static mesh, that either gets a lightmap or just casts shadows onto the ones that do
+	struct Source {
+		entt::entity            Entity;
+		VertexArrayObject::sptr Mesh;
+		ShaderMaterial::sptr    Material;
+		glm::mat4               World;
+		glm::mat3               NormalMatrix;
+		bool                    IsReceiver;
+		// As read back from the arena, in VertexPackedPosNormTexCol's layout
+		std::vector<uint8_t>    Vertices;
+		std::vector<uint32_t>   Indices;
+		// The unwrapped copy, and where each of it's vertices lands in the atlas in texels. Receivers only
+		MeshBuilder<VertexPosNormTexCol> Builder;
+		std::vector<glm::vec2>  Texels;
+	};
+	std::vector<Source>    Sources;
+	// ShadowIndex is only used to mark which lights cast shadows
+	std::vector<LightData> Lights;
+	Settings               Layout;
+
+	std::vector<glm::vec4> Atlas;
+	Stats                  Totals;
+};
+
+// Finds the point on a triangle closest to a point, all in the atlas' texel space. Returns the point as weights of the
+// corners, and how far it is from the point
+static glm::vec3 ClosestBarycentric(const glm::vec2& p, const glm::vec2 corners[3], float denom, float& distance) {
+	const glm::vec2 ab = corners[1] - corners[0];
+	const glm::vec2 ac = corners[2] - corners[0];
+	const glm::vec2 ap = p - corners[0];
+	const float v = (ap.x * ac.y - ap.y * ac.x) / denom;
+	const float w = (ab.x * ap.y - ab.y * ap.x) / denom;
+	if (v >= 0.0f && w >= 0.0f && v + w <= 1.0f) {
+		distance = 0.0f;
+		return glm::vec3(1.0f - v - w, v, w);
+	}
+	// Outside of the triangle the closest point is on one of the edges
+	glm::vec3 result(0.0f);
+	distance = FLT_MAX;
+	for (int edge = 0; edge < 3; edge++) {
+		const int next = (edge + 1) % 3;
+		const glm::vec2 d = corners[next] - corners[edge];
+		const float t = glm::clamp(glm::dot(p - corners[edge], d) / glm::max(glm::dot(d, d), 1e-12f), 0.0f, 1.0f);
+		const float edgeDistance = glm::length(p - (corners[edge] + d * t));
+		if (edgeDistance < distance) {
+			distance = edgeDistance;
+			result = glm::vec3(0.0f);
+			result[edge] = 1.0f - t;
+			result[next] = t;
+		}
+	}
+	return result;
+}
+
+// Lights a point on a surface the same way frag_blinn_phong_textured.glsl does, without the specular
+static glm::vec3 LightTexel(const glm::vec3& pos, const glm::vec3& N, const std::vector<LightData>& lights, const TriangleBvh* occluders) {
+	glm::vec3 ambient(0.0f);
+	glm::vec3 diffuse(0.0f);
+	for (const LightData& light : lights) {
+		glm::vec3 lightDir;
+		float dist;
+		float attenuation = 1.0f;
+		if (light.Type == static_cast<uint32_t>(LightType::Directional)) {
+			lightDir = -light.Direction;
+			dist = Light::MAX_RANGE;
+		} else {
+			const glm::vec3 toLight = light.Position - pos;
+			dist = glm::length(toLight);
+			// The clusters only pick up lights within their range
+			if (dist > light.Range) {
+				continue;
+			}
+			lightDir = toLight / glm::max(dist, 1e-4f);
+			attenuation = 1.0f / glm::dot(light.Attenuation, glm::vec3(1.0f, dist, dist * dist));
+			if (light.Type == static_cast<uint32_t>(LightType::Spot)) {
+				attenuation *= glm::smoothstep(light.CosOuterAngle, light.CosInnerAngle, glm::dot(-lightDir, light.Direction));
+			}
+		}
+		ambient += light.AmbientStrength * light.Color * attenuation;
+
+		const float dif = glm::max(glm::dot(N, lightDir), 0.0f);
+		if (dif <= 0.0f) {
+			continue;
+		}
+		// Shadows only block the light coming straight from the light, the ambient part still gets through
+		TriangleHit hit;
+		if (light.ShadowIndex >= 0 && occluders != nullptr && occluders->Raycast(pos + N * SHADOW_BIAS, lightDir, dist - SHADOW_BIAS, hit)) {
+			continue;
+		}
+		diffuse += dif * light.Color * attenuation;
+	}
+	return ambient + diffuse;
+}
+
+// Unwraps the receivers, packs their charts into the atlas and works out where each vertex lands in it
+static bool LayOutAtlas(std::vector<Lightmapper::Result::Source>& sources, const Lightmapper::Settings& settings, Lightmapper::Stats& stats) {
+	PROFILE_SCOPE("LayOutLightmap");
+	std::vector<ChartPacker::Unwrap> unwraps(sources.size());
+	std::vector<glm::vec2> chartSizes;
+	std::vector<uint32_t> firstCharts(sources.size(), 0);
+	for (size_t ix = 0; ix < sources.size(); ix++) {
+		Lightmapper::Result::Source& source = sources[ix];
+		if (!source.IsReceiver) {
+			continue;
+		}
+		// Unpack the arena's vertices so the copy can be built like any other mesh
+		const VertexPackedPosNormTexCol* packed = reinterpret_cast<const VertexPackedPosNormTexCol*>(source.Vertices.data());
+		const size_t vertexCount = source.Vertices.size() / sizeof(VertexPackedPosNormTexCol);
+		source.Builder.ReserveVertexSpace(vertexCount);
+		for (size_t vx = 0; vx < vertexCount; vx++) {
+			source.Builder.AddVertex(packed[vx].Position, glm::vec3(glm::unpackSnorm3x10_1x2(packed[vx].Normal)),
+				glm::unpackHalf2x16(packed[vx].UV), glm::unpackUnorm4x8(packed[vx].Color));
+		}
+		source.Builder.ReserveIndexSpace(source.Indices.size());
+		for (uint32_t index : source.Indices) {
+			source.Builder.AddIndex(index);
+		}
+		// The charts are measured in world units, so every receiver gets the same texel density
+		unwraps[ix] = source.Builder.GenerateLightmapCharts(source.World);
+		firstCharts[ix] = static_cast<uint32_t>(chartSizes.size());
+		chartSizes.insert(chartSizes.end(), unwraps[ix].ChartSizes.begin(), unwraps[ix].ChartSizes.end());
+	}
+	if (chartSizes.empty()) {
+		return false;
+	}
+
+	// Keep shrinking the charts until they fit, the atlas starts out roughly square
+	const uint32_t padding = std::max(settings.Padding, 1u);
+	float density = settings.TexelsPerUnit;
+	std::vector<glm::uvec2> sizes(chartSizes.size());
+	std::vector<glm::uvec2> offsets;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	for (int attempt = 0; attempt < MAX_FIT_ATTEMPTS && height == 0; attempt++) {
+		if (attempt > 0) {
+			density *= 0.8f;
+		}
+		double area = 0.0;
+		uint32_t widest = 0;
+		for (size_t ix = 0; ix < chartSizes.size(); ix++) {
+			sizes[ix] = glm::uvec2(glm::ceil(chartSizes[ix] * density)) + 1u + padding * 2;
+			area += static_cast<double>(sizes[ix].x) * sizes[ix].y;
+			widest = std::max(widest, sizes[ix].x);
+		}
+		width = std::max(static_cast<uint32_t>(glm::ceil(glm::sqrt(area * 1.2))), widest);
+		width = glm::clamp((width + 3u) & ~3u, 64u, settings.MaxSize);
+		height = ChartPacker::Pack(sizes, width, settings.MaxSize, offsets);
+	}
+	if (height == 0) {
+		LOG_WARN("Couldn't fit {} lightmap charts into a {}x{} atlas", chartSizes.size(), settings.MaxSize, settings.MaxSize);
+		return false;
+	}
+	height = (height + 3u) & ~3u;
+
+	// The vertices don't have room for another set of UVs, so the atlas coordinates get packed into the colors with 16
+	// bits per axis (see LIGHTMAPPED in vertex_shader.glsl). The coloring isn't needed, since the lightmap replaces it
+	const glm::vec2 atlasSize = glm::vec2(width, height);
+	for (size_t ix = 0; ix < sources.size(); ix++) {
+		Lightmapper::Result::Source& source = sources[ix];
+		if (!source.IsReceiver) {
+			continue;
+		}
+		const ChartPacker::Unwrap& unwrap = unwraps[ix];
+		source.Texels.resize(unwrap.Coords.size());
+		for (size_t vx = 0; vx < unwrap.Coords.size(); vx++) {
+			const glm::uvec2 offset = offsets[firstCharts[ix] + unwrap.VertexCharts[vx]];
+			source.Texels[vx] = glm::vec2(offset) + (padding + 0.5f) + unwrap.Coords[vx] * density;
+			const glm::uvec2 uv = glm::uvec2(glm::round(glm::clamp(source.Texels[vx] / atlasSize, 0.0f, 1.0f) * 65535.0f));
+			source.Builder.GetVertex(vx).Color = glm::vec4(uv.x & 0xFF, uv.x >> 8, uv.y & 0xFF, uv.y >> 8) / 255.0f;
+		}
+	}
+
+	stats.Charts = static_cast<uint32_t>(chartSizes.size());
+	stats.Width = width;
+	stats.Height = height;
+	stats.TexelsPerUnit = density;
+	return true;
+}
+
+// Does all of the CPU work for a bake, on the workers
+static void RunBake(Lightmapper::Result& result) {
+	PROFILE_SCOPE("BakeLightmap");
+	const auto start = std::chrono::steady_clock::now();
+	result.Totals = Lightmapper::Stats();
+	if (!LayOutAtlas(result.Sources, result.Layout, result.Totals)) {
+		return;
+	}
+	const uint32_t width = result.Totals.Width;
+	const uint32_t height = result.Totals.Height;
+
+	// Everything static casts shadows, so it all goes into one tree in world space
+	std::vector<glm::vec3> occluderPositions;
+	std::vector<uint32_t> occluderIndices;
+	for (const Lightmapper::Result::Source& source : result.Sources) {
+		const VertexPackedPosNormTexCol* packed = reinterpret_cast<const VertexPackedPosNormTexCol*>(source.Vertices.data());
+		const size_t vertexCount = source.Vertices.size() / sizeof(VertexPackedPosNormTexCol);
+		const uint32_t baseVertex = static_cast<uint32_t>(occluderPositions.size());
+		for (size_t vx = 0; vx < vertexCount; vx++) {
+			occluderPositions.push_back(glm::vec3(source.World * glm::vec4(packed[vx].Position, 1.0f)));
+		}
+		for (uint32_t index : source.Indices) {
+			occluderIndices.push_back(baseVertex + index);
+		}
+	}
+	TriangleBvh::sptr occluders = TriangleBvh::Build(occluderPositions.empty() ? nullptr : &occluderPositions[0].x, sizeof(glm::vec3),
+		occluderPositions.size(), occluderIndices.data(), occluderIndices.size());
+
+	// Work out which point on which surface each texel covers. The charts don't overlap (and each has padding around
+	// it), so the receivers can all be drawn in at once
+	const size_t texelCount = static_cast<size_t>(width) * height;
+	std::vector<glm::vec3> positions(texelCount);
+	std::vector<glm::vec3> normals(texelCount);
+	std::vector<float> coverage(texelCount, FLT_MAX);
+	ThreadPool::Instance().ParallelFor(result.Sources.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t ix = begin; ix < end; ix++) {
+			Lightmapper::Result::Source& source = result.Sources[ix];
+			if (!source.IsReceiver) {
+				continue;
+			}
+			const VertexPosNormTexCol* vertices = source.Builder.GetVertexDataPtr();
+			const uint32_t* indices = source.Builder.GetIndexDataPtr();
+			for (size_t tri = 0; tri + 2 < source.Builder.GetIndexCount(); tri += 3) {
+				glm::vec2 corners[3];
+				glm::vec3 cornerPositions[3];
+				glm::vec3 cornerNormals[3];
+				for (int corner = 0; corner < 3; corner++) {
+					const uint32_t index = indices[tri + corner];
+					corners[corner] = source.Texels[index];
+					cornerPositions[corner] = source.World * glm::vec4(vertices[index].Position, 1.0f);
+					cornerNormals[corner] = source.NormalMatrix * vertices[index].Normal;
+				}
+				const glm::vec2 ab = corners[1] - corners[0];
+				const glm::vec2 ac = corners[2] - corners[0];
+				const float denom = ab.x * ac.y - ab.y * ac.x;
+				if (glm::abs(denom) < 1e-8f) {
+					continue;
+				}
+				const glm::ivec2 min = glm::max(glm::ivec2(glm::floor(glm::min(corners[0], glm::min(corners[1], corners[2])))) - 1, glm::ivec2(0));
+				const glm::ivec2 max = glm::min(glm::ivec2(glm::ceil(glm::max(corners[0], glm::max(corners[1], corners[2])))) + 1,
+					glm::ivec2(width - 1, height - 1));
+				for (int y = min.y; y <= max.y; y++) {
+					for (int x = min.x; x <= max.x; x++) {
+						float distance;
+						const glm::vec3 weights = ClosestBarycentric(glm::vec2(x + 0.5f, y + 0.5f), corners, denom, distance);
+						const size_t texel = static_cast<size_t>(y) * width + x;
+						// Texels the triangle actually covers win over ones it only comes close to
+						if (distance > MAX_COVER_DISTANCE || distance >= coverage[texel]) {
+							continue;
+						}
+						coverage[texel] = distance;
+						positions[texel] = cornerPositions[0] * weights.x + cornerPositions[1] * weights.y + cornerPositions[2] * weights.z;
+						normals[texel] = cornerNormals[0] * weights.x + cornerNormals[1] * weights.y + cornerNormals[2] * weights.z;
+					}
+				}
+			}
+		}
+	});
+
+	// Light every texel that ended up on a surface
+	result.Atlas.assign(texelCount, glm::vec4(0.0f));
+	ThreadPool::Instance().ParallelFor(height, 4, [&](size_t begin, size_t end) {
+		for (size_t texel = begin * width; texel < end * width; texel++) {
+			const float length = glm::length(normals[texel]);
+			if (coverage[texel] == FLT_MAX || length <= 0.0f) {
+				continue;
+			}
+			result.Atlas[texel] = glm::vec4(LightTexel(positions[texel], normals[texel] / length, result.Lights, occluders.get()), 1.0f);
+		}
+	});
+
+	// Grow the charts out into their padding, so bilinear filtering at their edges doesn't blend in the empty space
+	std::vector<uint8_t> filled(texelCount);
+	for (size_t texel = 0; texel < texelCount; texel++) {
+		filled[texel] = coverage[texel] != FLT_MAX ? 1 : 0;
+	}
+	std::vector<uint8_t> nextFilled;
+	for (uint32_t pass = 0; pass < std::max(result.Layout.Padding, 1u); pass++) {
+		nextFilled = filled;
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				const size_t texel = static_cast<size_t>(y) * width + x;
+				if (filled[texel]) {
+					continue;
+				}
+				glm::vec4 sum(0.0f);
+				for (int dy = -1; dy <= 1; dy++) {
+					for (int dx = -1; dx <= 1; dx++) {
+						const int nx = static_cast<int>(x) + dx;
+						const int ny = static_cast<int>(y) + dy;
+						if (nx >= 0 && ny >= 0 && nx < static_cast<int>(width) && ny < static_cast<int>(height) && filled[static_cast<size_t>(ny) * width + nx]) {
+							sum += result.Atlas[static_cast<size_t>(ny) * width + nx];
+						}
+					}
+				}
+				// The alpha counts how many neighbours were filled, since they all have an alpha of 1
+				if (sum.w > 0.0f) {
+					result.Atlas[texel] = sum / sum.w;
+					nextFilled[texel] = 1;
+				}
+			}
+		}
+		filled.swap(nextFilled);
+	}
+
+	// The copies need the same extras as the meshes they replace, apart from the LODs since simplifying would ignore
+	// the chart seams. The triangles stay in the same order, so any StaticBatch ranges still line up
+	ThreadPool::Instance().ParallelFor(result.Sources.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t ix = begin; ix < end; ix++) {
+			if (result.Sources[ix].IsReceiver) {
+				result.Sources[ix].Builder.BuildMeshlets();
+				result.Sources[ix].Builder.BuildTriangleBvh();
+			}
+		}
+	});
+
+	for (const Lightmapper::Result::Source& source : result.Sources) {
+		result.Totals.Receivers += source.IsReceiver ? 1 : 0;
+	}
+	result.Totals.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+Lightmapper::Lightmapper() :
+	_bake(Task<std::shared_ptr<Result>>()),
+	_shader(nullptr),
+	_atlas(nullptr),
+	_sources(),
+	_materials(),
+	_isEnabled(true),
+	_stats(Stats())
+{ }
+
+Lightmapper::~Lightmapper() {
+	// The workers still hold on to the bake's data, so we wait for them rather than leaving it dangling
+	Wait();
+}
+
+void Lightmapper::Wait() {
+	if (_bake.IsValid()) {
+		ThreadPool::Instance().Wait(_bake);
+	}
+}
+
+bool Lightmapper::Bake(GameScene& scene, const std::vector<ShaderMaterial::sptr>& materials, const Shader::sptr& shader, const Settings& settings) {
+	if (_bake.IsValid() || shader == nullptr) {
+		return false;
+	}
+	PROFILE_SCOPE("GatherLightmap");
+	entt::registry& registry = scene.Registry();
+	const MeshArena::sptr& arena = MeshArena::Get<VertexPackedPosNormTexCol>();
+	std::shared_ptr<Result> result = std::make_shared<Result>();
+	result->Layout = settings;
+	result->Layout.MaxSize = std::min(settings.MaxSize, static_cast<uint32_t>(ITexture::GetLimits().MAX_TEXTURE_SIZE));
+
+	// Reading the meshes back waits on the GPU, but it only happens once per bake
+	uint32_t receiverCount = 0;
+	auto view = registry.view<StaticTag, RendererComponent, Transform>();
+	for (entt::entity entity : view) {
+		const RendererComponent& renderer = view.get<RendererComponent>(entity);
+		// Entities that already have a lightmap get baked from their originals again
+		const LightmapComponent* lightmap = registry.try_get<LightmapComponent>(entity);
+		const VertexArrayObject::sptr& mesh = lightmap != nullptr ? lightmap->OriginalMesh : renderer.Mesh;
+		const ShaderMaterial::sptr& material = lightmap != nullptr ? lightmap->OriginalMaterial : renderer.Material;
+		if (!renderer.Cullable || mesh == nullptr || mesh->GetArenaSlice().Arena != arena || mesh->GetArenaSlice().IndexCount == 0) {
+			continue;
+		}
+		const Transform& transform = view.get<Transform>(entity);
+		transform.UpdateWorldMatrix();
+
+		Result::Source& source = result->Sources.emplace_back();
+		source.Entity = entity;
+		source.Mesh = mesh;
+		source.Material = material;
+		source.World = transform.WorldTransform();
+		source.NormalMatrix = transform.WorldNormalMatrix();
+		source.IsReceiver = std::find(materials.begin(), materials.end(), material) != materials.end();
+		arena->Read(mesh->GetArenaSlice(), source.Vertices, source.Indices);
+		receiverCount += source.IsReceiver ? 1 : 0;
+	}
+	if (receiverCount == 0) {
+		LOG_WARN("There's no static geometry to bake a lightmap for");
+		return false;
+	}
+
+	// Same as RenderSnapshotBuilder gathers them, but every light counts since the whole scene gets baked at once
+	registry.view<Light, Transform>().each([&](entt::entity, const Light& light, const Transform& transform) {
+		transform.UpdateWorldMatrix();
+		const glm::mat4& world = transform.WorldTransform();
+		LightData data;
+		data.Position = world[3];
+		data.Range = light.GetRange();
+		data.Color = light.Color;
+		data.Type = static_cast<uint32_t>(light.Type);
+		data.Direction = glm::normalize(-glm::vec3(world[2]));
+		data.CosOuterAngle = glm::cos(glm::radians(light.OuterAngle));
+		data.Attenuation = glm::vec3(light.AttenuationConstant, light.AttenuationLinear, light.AttenuationQuadratic);
+		data.CosInnerAngle = glm::cos(glm::radians(glm::min(light.InnerAngle, light.OuterAngle)));
+		data.AmbientStrength = light.AmbientStrength;
+		data.SpecularStrength = light.SpecularStrength;
+		data.ShadowIndex = light.CastShadows ? 0 : -1;
+		data.Padding = 0.0f;
+		if (data.Range > 0.0f) {
+			result->Lights.push_back(data);
+		}
+	});
+
+	_shader = shader;
+	_bake = ThreadPool::Instance().Schedule([result]() {
+		RunBake(*result);
+		return result;
+	});
+	LOG_INFO("Baking lightmaps for {} static meshes with {} lights", receiverCount, result->Lights.size());
+	return true;
+}
+
+bool Lightmapper::Poll(GameScene& scene) {
+	if (!_bake.IsValid() || !_bake.IsDone()) {
+		return false;
+	}
+	Task<std::shared_ptr<Result>> bake = _bake;
+	_bake = Task<std::shared_ptr<Result>>();
+	if (bake.HasFailed() || bake.Get()->Atlas.empty()) {
+		LOG_WARN("Failed to bake the lightmaps, static geometry will keep being lit in real time");
+		return false;
+	}
+	GPU_RESOURCE_OWNER("Lightmapper");
+	PROFILE_SCOPE("UploadLightmap");
+	Result& result = *bake.Get();
+	_stats = result.Totals;
+
+	// The texels get blended between, but not mipmapped, since the smaller levels would bleed between the charts
+	Texture2DDescription description;
+	description.Width = _stats.Width;
+	description.Height = _stats.Height;
+	description.Format = InternalFormat::RGBA16F;
+	description.HorizontalWrap = WrapMode::ClampToEdge;
+	description.VerticalWrap = WrapMode::ClampToEdge;
+	description.MinificationFilter = MinFilter::Linear;
+	description.MagnificationFilter = MagFilter::Linear;
+	description.GenerateMipMaps = false;
+	_atlas = Texture2D::Create(description);
+	_atlas->LoadData(std::make_shared<Texture2DData>(_stats.Width, _stats.Height, PixelFormat::RGBA, PixelType::Float, result.Atlas.data(), InternalFormat::RGBA16F));
+
+	entt::registry& registry = scene.Registry();
+	for (Result::Source& source : result.Sources) {
+		if (!source.IsReceiver || !registry.valid(source.Entity) || !registry.has<RendererComponent>(source.Entity)) {
+			continue;
+		}
+		// Anything that had it's renderer changed while we were baking gets left alone
+		RendererComponent& renderer = registry.get<RendererComponent>(source.Entity);
+		const LightmapComponent* existing = registry.try_get<LightmapComponent>(source.Entity);
+		const bool isOriginal = renderer.Mesh == source.Mesh && renderer.Material == source.Material;
+		const bool isLightmapped = existing != nullptr && renderer.Mesh == existing->Mesh && renderer.Material == existing->Material;
+		if (!isOriginal && !isLightmapped) {
+			continue;
+		}
+
+		LightmapComponent lightmap;
+		lightmap.OriginalMesh = source.Mesh;
+		lightmap.OriginalMaterial = source.Material;
+		lightmap.Mesh = source.Builder.Bake<VertexPackedPosNormTexCol>();
+		lightmap.Material = _GetCopy(source.Material);
+		if (_isEnabled) {
+			renderer.SetMesh(lightmap.Mesh).SetMaterial(lightmap.Material);
+		} else {
+			renderer.SetMesh(lightmap.OriginalMesh).SetMaterial(lightmap.OriginalMaterial);
+		}
+		registry.emplace_or_replace<LightmapComponent>(source.Entity, std::move(lightmap));
+	}
+	for (const ShaderMaterial::sptr& material : _materials) {
+		material->Set("s_Lightmap", _atlas);
+	}
+
+	LOG_INFO("Baked {} lightmapped meshes into a {}x{} atlas ({} charts, {:.1f} texels per unit) in {:.1f}ms", _stats.Receivers,
+		_stats.Width, _stats.Height, _stats.Charts, _stats.TexelsPerUnit, _stats.Milliseconds);
+	return true;
+}
+
+void Lightmapper::SetEnabled(GameScene& scene, bool enabled) {
+	_isEnabled = enabled;
+	scene.Registry().view<LightmapComponent, RendererComponent>().each([enabled](const LightmapComponent& lightmap, RendererComponent& renderer) {
+		if (enabled) {
+			renderer.SetMesh(lightmap.Mesh).SetMaterial(lightmap.Material);
+		} else {
+			renderer.SetMesh(lightmap.OriginalMesh).SetMaterial(lightmap.OriginalMaterial);
+		}
+	});
+}
+
+const ShaderMaterial::sptr& Lightmapper::_GetCopy(const ShaderMaterial::sptr& source) {
+	auto it = std::find(_sources.begin(), _sources.end(), source);
+	if (it != _sources.end()) {
+		return _materials[it - _sources.begin()];
+	}
+	_sources.push_back(source);
+	_materials.push_back(source->Clone(_shader));
+	return _materials.back();
+}
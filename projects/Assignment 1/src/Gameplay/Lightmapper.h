@@ -0,0 +1,148 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <entt.hpp>
+
+#include "Graphics/Shader.h"
+#include "Graphics/Texture2D.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Utilities/ThreadPool.h"
+#include "Scene.h"
+#include "ShaderMaterial.h"
+
+/// <summary>
+/// Stored on each entity that gets drawn with a lightmap, keeps what it's renderer had before so the lightmap can be
+/// turned off again, or baked again from the original mesh
+/// </summary>
+struct LightmapComponent
+{
+	VertexArrayObject::sptr OriginalMesh;
+	ShaderMaterial::sptr    OriginalMaterial;
+	// A copy of the original mesh, split into charts with it's place in the atlas packed into the vertex colors
+	VertexArrayObject::sptr Mesh;
+	// A copy of the original material, drawn with the lightmapped variant of it's shader
+	ShaderMaterial::sptr    Material;
+};
+
+/// <summary>
+/// Bakes the lighting on static geometry into an atlas, so it's fragments only need a texture fetch instead of looping
+/// over every light in their cluster. Each static mesh gets a copy that's unwrapped into charts (see ChartPacker), and
+/// all the charts get packed into one atlas. Every texel of the atlas is lit the same way frag_blinn_phong_textured.glsl
+/// lights a fragment (ambient and diffuse from every light, with shadows cast by the static geometry for the lights
+/// that cast shadows), but specular depends on where the camera is, so it doesn't get baked
+///
+/// The mesh copies stay in model space, so the entities keep their transforms. Their atlas coordinates are packed into
+/// the vertex colors, 16 bits per axis, since the vertices don't have room for a second set of UVs (see LIGHTMAPPED in
+/// vertex_shader.glsl). Anything that moves keeps being lit in real time
+///
+/// Baking runs on the workers, the meshes get read back from their arena on the main thread when it starts, and the
+/// copies get uploaded and swapped in on the main thread once it's done (see Poll)
+/// </summary>
+class Lightmapper final
+{
+public:
+	typedef std::shared_ptr<Lightmapper> sptr;
+	static inline sptr Create() {
+		return std::make_shared<Lightmapper>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	Lightmapper(const Lightmapper& other) = delete;
+	Lightmapper(Lightmapper&& other) = delete;
+	Lightmapper& operator=(const Lightmapper& other) = delete;
+	Lightmapper& operator=(Lightmapper&& other) = delete;
+
+public:
+	/// <summary>
+	/// How a bake gets laid out
+	/// </summary>
+	struct Settings {
+		// How many texels each unit of surface gets along each axis, this gets lowered if the charts don't fit
+		float    TexelsPerUnit = 8.0f;
+		// The largest the atlas can get along either axis
+		uint32_t MaxSize       = 2048;
+		// The texels left around each chart, which get filled in from the chart's edges so filtering doesn't pick up
+		// the empty space (or the next chart) between them
+		uint32_t Padding       = 2;
+	};
+
+	/// <summary>
+	/// What the last bake did
+	/// </summary>
+	struct Stats {
+		uint32_t Receivers     = 0;
+		uint32_t Charts        = 0;
+		uint32_t Width         = 0;
+		uint32_t Height        = 0;
+		// The density the charts were packed at, after any scaling down to fit
+		float    TexelsPerUnit = 0.0f;
+		// How long the workers spent baking
+		double   Milliseconds  = 0.0;
+	};
+
+	// The meshes and lights a bake works on, and what it makes from them
+	struct Result;
+
+	Lightmapper();
+	~Lightmapper();
+
+	/// <summary>
+	/// Starts baking the lighting for every entity with a StaticTag and a RendererComponent whose material is one of
+	/// the given materials, and whose mesh lives in the VertexPackedPosNormTexCol arena. Everything static in that
+	/// arena casts shadows. Must be called on the main thread, after the static batches have been merged, and does
+	/// nothing if a bake is already running. Entities that already have a lightmap get baked again from their
+	/// original meshes, so this can be called again after the lights have changed
+	/// </summary>
+	/// <param name="scene">The scene to bake</param>
+	/// <param name="materials">The materials whose renderers should get lightmaps</param>
+	/// <param name="shader">The lightmapped variant for the copies of the materials to use</param>
+	/// <param name="settings">How to lay out the atlas</param>
+	/// <returns>True if the bake was started</returns>
+	bool Bake(GameScene& scene, const std::vector<ShaderMaterial::sptr>& materials, const Shader::sptr& shader, const Settings& settings);
+	/// <summary>
+	/// Finishes off the bake once the workers are done with it, uploading the meshes and the atlas and swapping them
+	/// into the renderers if the lightmaps are turned on. Should be called once a frame on the main thread
+	/// </summary>
+	/// <returns>True if a bake was just finished, and the materials may have changed</returns>
+	bool Poll(GameScene& scene);
+	/// <summary>
+	/// Returns true while a bake is running on the workers
+	/// </summary>
+	bool IsBaking() const { return _bake.IsValid(); }
+	/// <summary>
+	/// Blocks until the workers are done with the running bake, if there is one. Poll still needs to be called after
+	/// to finish it off
+	/// </summary>
+	void Wait();
+
+	/// <summary>
+	/// Swaps the baked meshes and materials in or out of the renderers, the lightmaps are on to begin with
+	/// </summary>
+	void SetEnabled(GameScene& scene, bool enabled);
+	bool IsEnabled() const { return _isEnabled; }
+
+	/// <summary>
+	/// Gets the copies of the materials that draw with the lightmap, these need to follow the lighting mode like the
+	/// originals
+	/// </summary>
+	const std::vector<ShaderMaterial::sptr>& GetMaterials() const { return _materials; }
+	/// <summary>
+	/// Gets the baked atlas, or nullptr if nothing has been baked yet
+	/// </summary>
+	const Texture2D::sptr& GetAtlas() const { return _atlas; }
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	Task<std::shared_ptr<Result>> _bake;
+	Shader::sptr                  _shader;
+	Texture2D::sptr               _atlas;
+	// The originals of the lightmapped materials, and the copies of them
+	std::vector<ShaderMaterial::sptr> _sources;
+	std::vector<ShaderMaterial::sptr> _materials;
+	bool                          _isEnabled;
+	Stats                         _stats;
+
+	// Gets the lightmapped copy of a material, making it if it doesn't exist yet
+	const ShaderMaterial::sptr& _GetCopy(const ShaderMaterial::sptr& source);
+};
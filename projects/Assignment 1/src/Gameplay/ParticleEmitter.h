@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// How an emitter's particles get blended over the scene
+/// </summary>
+enum class ParticleBlend : uint32_t
+{
+	// Particles add their light to what's behind them, so the order they're drawn in doesn't matter (ex: sparks, spray)
+	Additive = 0,
+	// Particles cover what's behind them, so they get sorted back to front before they're drawn (ex: confetti, smoke)
+	Alpha    = 1
+};
+
+/// <summary>
+/// Sprays particles out from an entity's position. The emitter only holds the settings, the particles themselves live
+/// on the GPU and never come back to the CPU (see ParticleSystem), so an emitter costs the same on the CPU whether it
+/// has a hundred particles or a million
+///
+/// The direction is in the entity's space, so the spray turns with the entity. Everything else is in world space,
+/// particles don't follow the emitter once they've left it
+/// </summary>
+struct ParticleEmitter
+{
+	bool          Enabled      = true;
+	// The most particles that can be alive at once, changing it throws away the particles that are alive
+	uint32_t      MaxParticles = 1024;
+	// The number of particles emitted per second, emission stops while the emitter is full
+	float         EmitRate     = 100.0f;
+	// The range of how long each particle lives for, in seconds
+	glm::vec2     Lifetime     = glm::vec2(1.0f, 2.0f);
+	// Particles start somewhere in a sphere of this radius around the emitter
+	float         EmitRadius   = 0.0f;
+	// The particles leave in a cone around the direction, the spread is the cone's half angle in degrees
+	glm::vec3     Direction    = glm::vec3(0.0f, 0.0f, 1.0f);
+	float         Spread       = 15.0f;
+	// The range of speeds the particles leave the emitter at
+	glm::vec2     Speed        = glm::vec2(1.0f, 2.0f);
+	// The acceleration applied to every particle, and the fraction of it's speed each particle loses per second
+	glm::vec3     Gravity      = glm::vec3(0.0f, 0.0f, -9.81f);
+	float         Drag         = 0.0f;
+	// The color and size (the width of the sprite, in world units) at the start and end of each particle's life
+	glm::vec4     StartColor   = glm::vec4(1.0f);
+	glm::vec4     EndColor     = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+	glm::vec2     Size         = glm::vec2(0.1f, 0.1f);
+	// How far each particle's hue may be shifted from the colors (0 to 1, where 1 picks any hue)
+	float         HueVariation = 0.0f;
+	ParticleBlend Blend        = ParticleBlend::Additive;
+
+	ParticleEmitter& SetCapacity(uint32_t maxParticles, float emitRate) { MaxParticles = maxParticles; EmitRate = emitRate; return *this; }
+	ParticleEmitter& SetLifetime(float min, float max) { Lifetime = glm::vec2(min, max); return *this; }
+	ParticleEmitter& SetDirection(const glm::vec3& direction, float spread) { Direction = direction; Spread = spread; return *this; }
+	ParticleEmitter& SetSpeed(float min, float max) { Speed = glm::vec2(min, max); return *this; }
+	ParticleEmitter& SetColors(const glm::vec4& start, const glm::vec4& end) { StartColor = start; EndColor = end; return *this; }
+	ParticleEmitter& SetSize(float start, float end) { Size = glm::vec2(start, end); return *this; }
+	ParticleEmitter& SetBlend(ParticleBlend blend) { Blend = blend; return *this; }
+};
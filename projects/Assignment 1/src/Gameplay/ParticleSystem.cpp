@@ -0,0 +1,272 @@
+#include "ParticleSystem.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <GLM/gtc/constants.hpp>
+
+#include "Graphics/GpuResources.h"
+#include "Graphics/RenderState.h"
+#include "Graphics/RenderStats.h"
+#include "Logging.h"
+#include "Transform.h"
+#include "Utilities/CpuProfiler.h"
+
+// The storage bindings used by the particle passes, must match the particle shaders. These overlap the meshlet
+// culler's and the clustered lights', which rebind theirs every frame before they're used
+static const GLuint PARTICLE_BINDING  = 2;
+static const GLuint DEAD_BINDING      = 3;
+static const GLuint ALIVE_IN_BINDING  = 4;
+static const GLuint ALIVE_OUT_BINDING = 5;
+static const GLuint COUNTER_BINDING   = 6;
+static const GLuint KEY_BINDING       = 7;
+// Must match local_size_x in particle_sort.comp.glsl, the smallest alive list we'll sort
+static const uint32_t SORT_GROUP_SIZE = 256;
+
+// Must match Particle in the particle shaders
+struct GpuParticle {
+	glm::vec3 Position;
+	float     Age;
+	glm::vec3 Velocity;
+	float     Lifetime;
+	float     Hue;
+	uint32_t  Padding[3];
+};
+
+// Must match b_Counters in the particle shaders, the args get read straight out of the buffer by the indirect calls
+struct ParticleCounters {
+	GLuint DeadCount;
+	GLuint AliveCount;
+	GLuint EmitCount;
+	GLuint Padding;
+	GLuint EmitArgs[3];
+	GLuint SimulateArgs[3];
+	// A DrawArraysIndirectCommand: count, instance count, first and base instance
+	GLuint DrawArgs[4];
+};
+
+static const GLintptr EMIT_ARGS_OFFSET     = offsetof(ParticleCounters, EmitArgs);
+static const GLintptr SIMULATE_ARGS_OFFSET = offsetof(ParticleCounters, SimulateArgs);
+static const GLintptr DRAW_ARGS_OFFSET     = offsetof(ParticleCounters, DrawArgs);
+
+static Shader::sptr LoadComputeShader(const char* path) {
+	Shader::sptr result = Shader::Create();
+	result->LoadShaderPartFromFile(path, GL_COMPUTE_SHADER);
+	return result->Link() ? result : nullptr;
+}
+
+ParticleSystem::ParticleSystem() :
+	_isReady(false),
+	_emptyVao(0),
+	_deltaTime(0.0f),
+	_frame(0)
+{
+	_kickoffShader = LoadComputeShader("shaders/particle_kickoff.comp.glsl");
+	_emitShader = LoadComputeShader("shaders/particle_emit.comp.glsl");
+	_simulateShader = LoadComputeShader("shaders/particle_simulate.comp.glsl");
+	_sortShader = LoadComputeShader("shaders/particle_sort.comp.glsl");
+	_drawShader = Shader::Create();
+	_drawShader->LoadShaderPartFromFile("shaders/particle.vert.glsl", GL_VERTEX_SHADER);
+	_drawShader->LoadShaderPartFromFile("shaders/particle.frag.glsl", GL_FRAGMENT_SHADER);
+	_isReady = _drawShader->Link() && _kickoffShader != nullptr && _emitShader != nullptr && _simulateShader != nullptr && _sortShader != nullptr;
+	if (!_isReady) {
+		LOG_WARN("Particle shaders failed to compile, particles will not be drawn");
+	}
+	// The quads are built from the vertex and instance IDs, but GL still wants a VAO bound to draw
+	glCreateVertexArrays(1, &_emptyVao);
+}
+
+ParticleSystem::~ParticleSystem() {
+	RenderState::OnVertexArrayDeleted(_emptyVao);
+	glDeleteVertexArrays(1, &_emptyVao);
+}
+
+std::unique_ptr<ParticleSystem::Pool> ParticleSystem::_CreatePool(uint32_t capacity, bool sorted) {
+	GPU_RESOURCE_OWNER("ParticleSystem");
+	std::unique_ptr<Pool> pool = std::make_unique<Pool>();
+	pool->Capacity = capacity;
+	pool->SortSize = SORT_GROUP_SIZE;
+	while (pool->SortSize < capacity) {
+		pool->SortSize <<= 1;
+	}
+	pool->Current = 0;
+	pool->Carry = 0.0f;
+	pool->IsSeen = false;
+
+	// Only the dead list and counters need filling in, everything else gets written before it's read
+	pool->Particles = StorageBuffer::Create(GL_DYNAMIC_COPY);
+	pool->Particles->LoadData(static_cast<const GpuParticle*>(nullptr), capacity);
+	std::vector<GLuint> dead(capacity);
+	for (uint32_t ix = 0; ix < capacity; ix++) {
+		dead[ix] = ix;
+	}
+	pool->Dead = StorageBuffer::Create(GL_DYNAMIC_COPY);
+	pool->Dead->LoadData(dead.data(), dead.size());
+	for (int ix = 0; ix < 2; ix++) {
+		pool->Alive[ix] = StorageBuffer::Create(GL_DYNAMIC_COPY);
+		pool->Alive[ix]->LoadData(static_cast<const GLuint*>(nullptr), pool->SortSize);
+	}
+	if (sorted) {
+		pool->Keys = StorageBuffer::Create(GL_DYNAMIC_COPY);
+		pool->Keys->LoadData(static_cast<const GLuint*>(nullptr), pool->SortSize);
+	}
+	ParticleCounters counters = {};
+	counters.DeadCount = capacity;
+	counters.DrawArgs[0] = 4;
+	pool->Counters = IndirectBuffer::Create(GL_DYNAMIC_COPY);
+	pool->Counters->LoadData(&counters, 1);
+	return pool;
+}
+
+void ParticleSystem::Update(entt::registry& registry, float deltaTime) {
+	PROFILE_SCOPE("Particles");
+	_emissions.clear();
+	_deltaTime = deltaTime;
+	_stats = Stats();
+	if (!_isReady) {
+		return;
+	}
+	for (auto& [entity, pool] : _pools) {
+		pool->IsSeen = false;
+	}
+
+	registry.view<ParticleEmitter, Transform>().each([&](entt::entity entity, const ParticleEmitter& emitter, const Transform& transform) {
+		const uint32_t capacity = std::clamp(emitter.MaxParticles, 1u, MAX_PARTICLES);
+		const bool sorted = emitter.Blend == ParticleBlend::Alpha;
+		std::unique_ptr<Pool>& pool = _pools[entity];
+		if (pool == nullptr || pool->Capacity != capacity || (pool->Keys != nullptr) != sorted) {
+			pool = _CreatePool(capacity, sorted);
+		}
+		pool->IsSeen = true;
+
+		// Disabled emitters still get simulated, so their particles can finish out their lives
+		uint32_t count = 0;
+		if (emitter.Enabled) {
+			pool->Carry += emitter.EmitRate * deltaTime;
+			count = static_cast<uint32_t>(std::min(pool->Carry, static_cast<float>(capacity)));
+			pool->Carry = std::min(pool->Carry - count, 1.0f);
+		} else {
+			pool->Carry = 0.0f;
+		}
+
+		const glm::mat4& world = transform.WorldTransform();
+		const glm::vec3 direction = glm::mat3(world) * emitter.Direction;
+		const float length = glm::length(direction);
+		_emissions.push_back({ pool.get(), emitter, glm::vec3(world[3]), length > 0.0f ? direction / length : glm::vec3(0.0f, 0.0f, 1.0f), count });
+		_stats.Emitters++;
+		_stats.Capacity += capacity;
+		_stats.Emitted += count;
+	});
+
+	// Emitters that have gone away take their particles with them
+	for (auto it = _pools.begin(); it != _pools.end();) {
+		if (!it->second->IsSeen) {
+			it = _pools.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void ParticleSystem::Simulate() {
+	if (!_isReady || _emissions.empty()) {
+		return;
+	}
+	_frame++;
+	for (const Emission& emission : _emissions) {
+		Pool& pool = *emission.Target;
+		const ParticleEmitter& settings = emission.Settings;
+		RenderState::BindStorageBuffer(PARTICLE_BINDING, pool.Particles->GetHandle());
+		RenderState::BindStorageBuffer(DEAD_BINDING, pool.Dead->GetHandle());
+		RenderState::BindStorageBuffer(ALIVE_IN_BINDING, pool.Alive[pool.Current]->GetHandle());
+		RenderState::BindStorageBuffer(ALIVE_OUT_BINDING, pool.Alive[1 - pool.Current]->GetHandle());
+		RenderState::BindStorageBuffer(COUNTER_BINDING, pool.Counters->GetHandle());
+		if (pool.Keys != nullptr) {
+			RenderState::BindStorageBuffer(KEY_BINDING, pool.Keys->GetHandle());
+		}
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, pool.Counters->GetHandle());
+
+		_kickoffShader->Bind();
+		_kickoffShader->SetUniform("u_EmitRequest"_hs, static_cast<int>(emission.Count));
+		glDispatchCompute(1, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+		_emitShader->Bind();
+		_emitShader->SetUniform("u_Seed"_hs, static_cast<int>(_frame * 7919u + static_cast<uint32_t>(&emission - _emissions.data())));
+		_emitShader->SetUniform("u_EmitterPosition"_hs, emission.Position);
+		_emitShader->SetUniform("u_EmitRadius"_hs, settings.EmitRadius);
+		_emitShader->SetUniform("u_Direction"_hs, emission.Direction);
+		_emitShader->SetUniform("u_SpreadCos"_hs, glm::cos(glm::radians(glm::clamp(settings.Spread, 0.0f, 180.0f))));
+		_emitShader->SetUniform("u_Speed"_hs, settings.Speed);
+		_emitShader->SetUniform("u_Lifetime"_hs, glm::max(settings.Lifetime, glm::vec2(0.001f)));
+		_emitShader->SetUniform("u_HueVariation"_hs, settings.HueVariation);
+		glDispatchComputeIndirect(EMIT_ARGS_OFFSET);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		_simulateShader->Bind();
+		_simulateShader->SetUniform("u_DeltaTime"_hs, _deltaTime);
+		_simulateShader->SetUniform("u_Gravity"_hs, settings.Gravity);
+		_simulateShader->SetUniform("u_Drag"_hs, settings.Drag);
+		_simulateShader->SetUniform("u_Sorted"_hs, pool.Keys != nullptr ? 1 : 0);
+		glDispatchComputeIndirect(SIMULATE_ARGS_OFFSET);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		if (pool.Keys != nullptr) {
+			_Sort(pool);
+		}
+		// This frame's survivors get drawn, and are next frame's particles to simulate
+		pool.Current = 1 - pool.Current;
+	}
+	// The draws read the particles as storage buffers, and their instance counts through the indirect binding
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void ParticleSystem::_Sort(const Pool& pool) {
+	// Every step covers the whole list, one invocation per entry. The number of steps only depends on the list's size,
+	// so they can all be queued up without knowing how many particles survived
+	const GLuint groups = pool.SortSize / SORT_GROUP_SIZE;
+	_sortShader->Bind();
+	_sortShader->SetUniform("u_Pad"_hs, 1);
+	glDispatchCompute(groups, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	_sortShader->SetUniform("u_Pad"_hs, 0);
+	for (uint32_t k = 2; k <= pool.SortSize; k <<= 1) {
+		_sortShader->SetUniform("u_K"_hs, static_cast<int>(k));
+		for (uint32_t j = k >> 1; j > 0; j >>= 1) {
+			_sortShader->SetUniform("u_J"_hs, static_cast<int>(j));
+			glDispatchCompute(groups, 1, 1);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		}
+	}
+}
+
+void ParticleSystem::Render() {
+	if (!_isReady || _emissions.empty()) {
+		return;
+	}
+	_drawShader->Bind();
+	RenderState::BindVertexArray(_emptyVao);
+	RenderState::SetEnabled(GL_BLEND, true);
+	RenderState::SetDepthMask(false);
+	// The sorted emitters go first, so the additive ones still get added over them
+	for (int pass = 0; pass < 2; pass++) {
+		const ParticleBlend blend = pass == 0 ? ParticleBlend::Alpha : ParticleBlend::Additive;
+		for (const Emission& emission : _emissions) {
+			if (emission.Settings.Blend != blend) {
+				continue;
+			}
+			const Pool& pool = *emission.Target;
+			const ParticleEmitter& settings = emission.Settings;
+			RenderState::SetBlendFunc(GL_SRC_ALPHA, blend == ParticleBlend::Alpha ? GL_ONE_MINUS_SRC_ALPHA : GL_ONE);
+			RenderState::BindStorageBuffer(PARTICLE_BINDING, pool.Particles->GetHandle());
+			RenderState::BindStorageBuffer(ALIVE_OUT_BINDING, pool.Alive[pool.Current]->GetHandle());
+			_drawShader->SetUniform("u_StartColor"_hs, settings.StartColor);
+			_drawShader->SetUniform("u_EndColor"_hs, settings.EndColor);
+			_drawShader->SetUniform("u_Size"_hs, settings.Size);
+			pool.Counters->Bind();
+			RenderStats::CountIndirectDraw();
+			glDrawArraysIndirect(GL_TRIANGLE_STRIP, reinterpret_cast<const void*>(DRAW_ARGS_OFFSET));
+		}
+	}
+	RenderState::SetDepthMask(true);
+	RenderState::SetEnabled(GL_BLEND, false);
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <entt.hpp>
+
+#include "Graphics/IndirectBuffer.h"
+#include "Graphics/Shader.h"
+#include "Graphics/StorageBuffer.h"
+#include "ParticleEmitter.h"
+
+/// <summary>
+/// Simulates and draws the particles of every ParticleEmitter in a scene entirely on the GPU. Each emitter gets a pool
+/// of particles in storage buffers, along with a list of the free slots (the dead list) and two lists of the slots in
+/// use (the alive lists). Every frame a compute pass pops new particles off the dead list, another moves every live
+/// particle along and either pushes it back onto the dead list or appends it to the other alive list, and the
+/// survivors get drawn as instanced quads with glDrawArraysIndirect. The counts never leave the GPU, the kickoff pass
+/// sizes the other passes' indirect dispatches from them, so all the CPU does per emitter is set a few uniforms
+///
+/// Alpha blended emitters have their survivors bitonic sorted back to front before they're drawn, additive ones don't
+/// need sorting
+///
+/// Usage each frame: Update once the world matrices are up to date, then Simulate and Render once the scene's
+/// depth has been drawn (the particles are depth tested but don't write depth)
+/// </summary>
+class ParticleSystem final
+{
+public:
+	typedef std::shared_ptr<ParticleSystem> sptr;
+	static inline sptr Create() {
+		return std::make_shared<ParticleSystem>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	ParticleSystem(const ParticleSystem& other) = delete;
+	ParticleSystem(ParticleSystem&& other) = delete;
+	ParticleSystem& operator=(const ParticleSystem& other) = delete;
+	ParticleSystem& operator=(ParticleSystem&& other) = delete;
+
+public:
+	/// <summary>
+	/// The most particles a single emitter may have alive at once
+	/// </summary>
+	static const uint32_t MAX_PARTICLES = 1 << 20;
+
+	/// <summary>
+	/// What the particle system did last frame, for the debug UI
+	/// </summary>
+	struct Stats {
+		int      Emitters = 0;
+		uint32_t Capacity = 0;
+		uint32_t Emitted  = 0;
+	};
+
+	/// <summary>
+	/// Creates a new particle system, and compiles it's shaders
+	/// </summary>
+	ParticleSystem();
+	~ParticleSystem();
+
+	/// <summary>
+	/// Returns true if all the particle shaders compiled, if not nothing gets simulated or drawn
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Gathers this frame's emitters, and works out how many particles each one should emit. Pools get created for
+	/// new emitters and freed for ones that are gone. Must be called on the main thread once the world matrices are up
+	/// to date, and not while a snapshot is being built
+	/// </summary>
+	/// <param name="registry">The registry to gather the emitters from</param>
+	/// <param name="deltaTime">The time since the last frame, in seconds</param>
+	void Update(entt::registry& registry, float deltaTime);
+	/// <summary>
+	/// Runs the emit, simulate and sort passes for every emitter gathered by the last Update. The frame data must be
+	/// bound, the blended emitters are sorted by their distance from it's camera
+	/// </summary>
+	void Simulate();
+	/// <summary>
+	/// Draws the particles that survived the last Simulate, into whatever framebuffer is bound
+	/// </summary>
+	void Render();
+
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	// The particles and lists for a single emitter
+	struct Pool {
+		StorageBuffer::sptr  Particles;
+		StorageBuffer::sptr  Dead;
+		StorageBuffer::sptr  Alive[2];
+		// Only allocated for sorted emitters
+		StorageBuffer::sptr  Keys;
+		// Read as the indirect dispatch and draw commands, as well as written as a storage buffer
+		IndirectBuffer::sptr Counters;
+		uint32_t             Capacity;
+		// The alive lists are padded up to a power of two, so they can be bitonic sorted
+		uint32_t             SortSize;
+		// Which alive list holds the particles to simulate, the other gets the survivors
+		int                  Current;
+		// The fraction of a particle left over from the last frame's emission
+		float                Carry;
+		bool                 IsSeen;
+	};
+	// An emitter gathered by Update, waiting for Simulate
+	struct Emission {
+		Pool*           Target;
+		ParticleEmitter Settings;
+		glm::vec3       Position;
+		glm::vec3       Direction;
+		uint32_t        Count;
+	};
+
+	Shader::sptr _kickoffShader;
+	Shader::sptr _emitShader;
+	Shader::sptr _simulateShader;
+	Shader::sptr _sortShader;
+	Shader::sptr _drawShader;
+	bool         _isReady;
+	GLuint       _emptyVao;
+
+	std::unordered_map<entt::entity, std::unique_ptr<Pool>> _pools;
+	std::vector<Emission> _emissions;
+	float                 _deltaTime;
+	uint32_t              _frame;
+	Stats                 _stats;
+
+	// Allocates a pool with every particle on the dead list
+	static std::unique_ptr<Pool> _CreatePool(uint32_t capacity, bool sorted);
+	// Sorts the survivors in a pool from farthest to nearest
+	void _Sort(const Pool& pool);
+};
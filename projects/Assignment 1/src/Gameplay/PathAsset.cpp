@@ -0,0 +1,109 @@
+#include "PathAsset.h"
+
+#include <cstring>
+
+#include "Logging.h"
+
+std::vector<std::unique_ptr<PathAsset>> PathAsset::_paths;
+std::unordered_multimap<uint64_t, PathAsset::Id> PathAsset::_pathsByHash;
+
+// How many steps each segment is split into when measuring it, the even samples are picked out from these
+static const uint32_t MEASURE_STEPS = 64;
+
+// A point on the uniform Catmull-Rom segment from b to c
+static glm::vec3 CatmullRom(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d, float t) {
+	const float t2 = t * t;
+	const float t3 = t2 * t;
+	return 0.5f * (
+		(2.0f * b) +
+		(c - a) * t +
+		(2.0f * a - 5.0f * b + 4.0f * c - d) * t2 +
+		(3.0f * b - a - 3.0f * c + d) * t3);
+}
+
+// FNV-1a over the raw bytes of the points
+static uint64_t HashPoints(const std::vector<glm::vec3>& points) {
+	uint64_t hash = 14695981039346656037ull;
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(points.data());
+	const size_t size = points.size() * sizeof(glm::vec3);
+	for (size_t ix = 0; ix < size; ix++) {
+		hash = (hash ^ bytes[ix]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+PathAsset::PathAsset(const std::vector<glm::vec3>& points) :
+	_points(points),
+	_samples(),
+	_length(0.0f),
+	_inverseSpacing(0.0f)
+{
+	const uint32_t count = static_cast<uint32_t>(points.size());
+
+	// Measure the curve in small steps, keeping how far along it each step ends
+	std::vector<glm::vec3> steps;
+	std::vector<float> distances;
+	steps.reserve(count * MEASURE_STEPS + 1);
+	distances.reserve(count * MEASURE_STEPS + 1);
+	steps.push_back(points[0]);
+	distances.push_back(0.0f);
+	for (uint32_t segment = 0; segment < count; segment++) {
+		const glm::vec3& a = points[(segment + count - 1) % count];
+		const glm::vec3& b = points[segment];
+		const glm::vec3& c = points[(segment + 1) % count];
+		const glm::vec3& d = points[(segment + 2) % count];
+		for (uint32_t step = 1; step <= MEASURE_STEPS; step++) {
+			const glm::vec3 point = CatmullRom(a, b, c, d, static_cast<float>(step) / MEASURE_STEPS);
+			distances.push_back(distances.back() + glm::distance(steps.back(), point));
+			steps.push_back(point);
+		}
+	}
+	_length = distances.back();
+
+	// A single point, or a path that never goes anywhere, only has the one place to be
+	if (_length <= 0.0f) {
+		_length = 0.0f;
+		_samples = { points[0], points[0] };
+		return;
+	}
+
+	// Pick out points at even distances, walking forwards through the steps since the distances only go up
+	const uint32_t sampleCount = count * SAMPLES_PER_SEGMENT;
+	const float spacing = _length / sampleCount;
+	_inverseSpacing = 1.0f / spacing;
+	_samples.resize(sampleCount + 1);
+	size_t stepIx = 1;
+	for (uint32_t ix = 0; ix < sampleCount; ix++) {
+		const float target = spacing * ix;
+		while (stepIx < distances.size() - 1 && distances[stepIx] < target) {
+			stepIx++;
+		}
+		const float stepLength = distances[stepIx] - distances[stepIx - 1];
+		const float t = stepLength > 0.0f ? (target - distances[stepIx - 1]) / stepLength : 0.0f;
+		_samples[ix] = glm::mix(steps[stepIx - 1], steps[stepIx], t);
+	}
+	_samples[sampleCount] = _samples[0];
+}
+
+PathAsset::Id PathAsset::Create(const std::vector<glm::vec3>& points) {
+	LOG_ASSERT(!points.empty(), "A path needs at least one point!");
+
+	const uint64_t hash = HashPoints(points);
+	auto range = _pathsByHash.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		const std::vector<glm::vec3>& existing = _paths[it->second]->_points;
+		if (existing.size() == points.size() && memcmp(existing.data(), points.data(), points.size() * sizeof(glm::vec3)) == 0) {
+			return it->second;
+		}
+	}
+
+	const Id result = static_cast<Id>(_paths.size());
+	_paths.emplace_back(new PathAsset(points));
+	_pathsByHash.emplace(hash, result);
+	return result;
+}
+
+void PathAsset::ReleaseAll() {
+	_pathsByHash.clear();
+	_paths.clear();
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// A closed Catmull-Rom spline through a list of points, shared by everything that follows it. The curve gets
+/// sampled at even steps along it's length when it's created, so finding the point a given distance along it is
+/// a lookup and a lerp, and followers that move at a set speed really do cover that much ground each second
+///
+/// Paths are created and looked up through their ids, creating a path through the same points as an existing one
+/// hands back the existing one. Create must be called from the main thread while no systems are running, Get can
+/// be called from anywhere
+/// </summary>
+class PathAsset final
+{
+public:
+	typedef uint32_t Id;
+	static const Id INVALID = UINT32_MAX;
+
+	// How many even steps each segment of the curve is split into
+	static const uint32_t SAMPLES_PER_SEGMENT = 16;
+
+	PathAsset(const PathAsset& other) = delete;
+	PathAsset(PathAsset&& other) = delete;
+	PathAsset& operator=(const PathAsset& other) = delete;
+	PathAsset& operator=(PathAsset&& other) = delete;
+
+	/// <summary>
+	/// Gets the path through the given points, creating it if there isn't one yet. The path loops back from the
+	/// last point to the first
+	/// </summary>
+	/// <param name="points">The points to pass through, must not be empty</param>
+	static Id Create(const std::vector<glm::vec3>& points);
+	/// <summary>
+	/// Gets a path by it's id
+	/// </summary>
+	static const PathAsset& Get(Id id) { return *_paths[id]; }
+	/// <summary>
+	/// Gets the number of paths that have been created
+	/// </summary>
+	static size_t GetCount() { return _paths.size(); }
+	/// <summary>
+	/// Releases every path, any ids still held onto become invalid
+	/// </summary>
+	static void ReleaseAll();
+
+	/// <summary>
+	/// Gets the point a distance along the path, distances past either end wrap around
+	/// </summary>
+	glm::vec3 Evaluate(float distance) const {
+		const float position = Wrap(distance) * _inverseSpacing;
+		const uint32_t ix = glm::min(static_cast<uint32_t>(position), static_cast<uint32_t>(_samples.size() - 2));
+		return glm::mix(_samples[ix], _samples[ix + 1], position - static_cast<float>(ix));
+	}
+	/// <summary>
+	/// Wraps a distance to between 0 and the length of the path
+	/// </summary>
+	float Wrap(float distance) const {
+		if (_length <= 0.0f) {
+			return 0.0f;
+		}
+		const float result = distance - _length * glm::floor(distance / _length);
+		return result < _length ? result : 0.0f;
+	}
+
+	/// <summary>
+	/// Gets the length of the whole loop
+	/// </summary>
+	float GetLength() const { return _length; }
+	/// <summary>
+	/// Gets the points the path was created from
+	/// </summary>
+	const std::vector<glm::vec3>& GetPoints() const { return _points; }
+
+private:
+	PathAsset(const std::vector<glm::vec3>& points);
+
+	std::vector<glm::vec3> _points;
+	// Points on the curve at even steps along it, the first is repeated at the end so lookups never need to wrap
+	std::vector<glm::vec3> _samples;
+	float                  _length;
+	// One over the distance between samples
+	float                  _inverseSpacing;
+
+	static std::vector<std::unique_ptr<PathAsset>>     _paths;
+	// The paths by a hash of their points, so paths through the same points get shared
+	static std::unordered_multimap<uint64_t, Id>       _pathsByHash;
+};
@@ -0,0 +1,16 @@
+#include "PathFollowSystem.h"
+
+#include "Gameplay/Scene.h"
+#include "Gameplay/Transform.h"
+
+void PathFollowSystem::Update(GameScene& scene, float deltaTime) {
+	scene.Registry().view<FollowPathComponent, Transform>().each([deltaTime](FollowPathComponent& follow, Transform& transform) {
+		if (!follow.Enabled || follow.Path == PathAsset::INVALID) {
+			return;
+		}
+		const PathAsset& path = PathAsset::Get(follow.Path);
+		// Keep the distance wrapped, so it doesn't lose precision after following the path for a long time
+		follow.Distance = path.Wrap(follow.Distance + follow.Speed * deltaTime);
+		transform.SetLocalPosition(follow.Origin + path.Evaluate(follow.Distance));
+	});
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/PathAsset.h"
+
+class GameScene;
+
+/// <summary>
+/// Makes an entity follow a path when it's updated by PathFollowSystem::Update, which handles every entity with one
+/// of these in a single pass. Use this over binding a FollowPathBehaviour when there are lots of them
+///
+/// Entities following the same points share one PathAsset, so each one only needs to know how far along it they are.
+/// The path is placed relative to Origin, so entities doing the same thing in different places can share one too
+/// </summary>
+struct FollowPathComponent
+{
+	PathAsset::Id Path = PathAsset::INVALID;
+	// Where the path is placed, it's points are relative to this
+	glm::vec3     Origin = glm::vec3(0.0f);
+	// How far along the path the entity is, in world units
+	float         Distance = 0.0f;
+	// How fast the entity moves along the path, in world units per second
+	float         Speed = 1.0f;
+	bool          Enabled = true;
+
+	// Paths are saved as their points, so they can be shared again when they're loaded
+	template <typename Archive>
+	void save(Archive& archive) const {
+		std::vector<glm::vec3> points;
+		if (Path != PathAsset::INVALID) {
+			points = PathAsset::Get(Path).GetPoints();
+		}
+		archive(points, Origin, Distance, Speed, Enabled);
+	}
+	template <typename Archive>
+	void load(Archive& archive) {
+		std::vector<glm::vec3> points;
+		archive(points, Origin, Distance, Speed, Enabled);
+		Path = points.empty() ? PathAsset::INVALID : PathAsset::Create(points);
+	}
+};
+
+/// <summary>
+/// Moves entities with a FollowPathComponent along their paths
+/// </summary>
+class PathFollowSystem final
+{
+public:
+	/// <summary>
+	/// Moves every enabled entity with a FollowPathComponent along it's path. Each entity only touches it's own
+	/// component and transform, and reads the paths they share
+	/// </summary>
+	/// <param name="scene">The scene to update the entities in</param>
+	/// <param name="deltaTime">The time since the last step, in seconds</param>
+	static void Update(GameScene& scene, float deltaTime);
+
+private:
+	PathFollowSystem() = default;
+	~PathFollowSystem() = default;
+};
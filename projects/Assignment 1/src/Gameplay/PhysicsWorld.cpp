@@ -0,0 +1,526 @@
+#include "PhysicsWorld.h"
+
+#include <algorithm>
+#include <cmath>
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+
+#include "Logging.h"
+#include "Transform.h"
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/MemoryTracker.h"
+
+const float PhysicsWorld::STATIC_CHUNK_SIZE = 25.0f;
+
+// The fewest queries worth handing to another thread, each one is a tree walk and a few shape tests
+static const size_t QUERY_BATCH = 32;
+
+// GLM quaternions are stored w first, Bullet's are w last
+static inline btVector3 ToBullet(const glm::vec3& value) {
+	return btVector3(value.x, value.y, value.z);
+}
+static inline btQuaternion ToBullet(const glm::quat& value) {
+	return btQuaternion(value.x, value.y, value.z, value.w);
+}
+static inline glm::vec3 ToGlm(const btVector3& value) {
+	return glm::vec3(value.x(), value.y(), value.z());
+}
+static inline glm::quat ToGlm(const btQuaternion& value) {
+	return glm::quat(value.w(), value.x(), value.y(), value.z());
+}
+
+// Bullet asks the motion state where kinematic bodies are every step, and tells it whenever it moves a dynamic body.
+// The second only ever happens while stepping on the worker, so it only touches the body's own slot and the moved list
+class PhysicsWorld::MotionState : public btMotionState
+{
+public:
+	btTransform Current;
+
+	MotionState(PhysicsWorld& world, uint32_t slot, const btTransform& start) :
+		Current(start),
+		_world(world),
+		_slot(slot)
+	{ }
+
+	void getWorldTransform(btTransform& transform) const override {
+		transform = Current;
+	}
+
+	void setWorldTransform(const btTransform& transform) override {
+		Current = transform;
+		Slot& slot = _world._slots[_slot];
+		slot.Position = ToGlm(transform.getOrigin());
+		slot.Rotation = ToGlm(transform.getRotation());
+		if (!slot.IsMoved) {
+			slot.IsMoved = true;
+			_world._moved.push_back(_slot);
+		}
+	}
+
+private:
+	PhysicsWorld& _world;
+	uint32_t      _slot;
+};
+
+// Tests a ray or sweep against each collision object the broadphase finds along it, keeping the closest hit. The
+// callbacks are Bullet's own, this is just what btCollisionWorld::rayTest and convexSweepTest do, minus the shared
+// stack that the broadphase keeps for it's own ray tests
+struct QueryCollector : btDbvt::ICollide
+{
+	btTransform                                     From;
+	btTransform                                     To;
+	const btConvexShape*                            Sweep = nullptr;
+	btCollisionWorld::ClosestRayResultCallback*     Ray = nullptr;
+	btCollisionWorld::ClosestConvexResultCallback*  Convex = nullptr;
+
+	void Process(const btDbvtNode* leaf) override {
+		btBroadphaseProxy* proxy = static_cast<btBroadphaseProxy*>(leaf->data);
+		const btCollisionObject* object = static_cast<const btCollisionObject*>(proxy->m_clientObject);
+		if (Sweep == nullptr && Ray->needsCollision(proxy)) {
+			btCollisionWorld::rayTestSingle(From, To, const_cast<btCollisionObject*>(object), object->getCollisionShape(), object->getWorldTransform(), *Ray);
+		} else if (Sweep != nullptr && Convex->needsCollision(proxy)) {
+			btCollisionWorld::objectQuerySingle(Sweep, From, To, const_cast<btCollisionObject*>(object), object->getCollisionShape(), object->getWorldTransform(), *Convex, 0.0f);
+		}
+	}
+};
+
+static void* BulletAllocate(size_t size) {
+	MEMORY_SCOPE(MemoryTag::Physics);
+	return operator new(size);
+}
+
+static void BulletFree(void* memory) {
+	operator delete(memory);
+}
+
+void PhysicsWorld::TrackAllocations() {
+	btAlignedAllocSetCustom(BulletAllocate, BulletFree);
+}
+
+PhysicsWorld* PhysicsWorld::Get(entt::registry& registry) {
+	PhysicsWorld** world = registry.try_ctx<PhysicsWorld*>();
+	return world != nullptr ? *world : nullptr;
+}
+
+PhysicsWorld::PhysicsWorld(GameScene& scene) :
+	_scene(scene),
+	_queryBatch(1),
+	_runningBatch(0),
+	_resultBatch(0),
+	_bodyCount(0),
+	_activeCount(0)
+{
+	_configuration = std::make_unique<btDefaultCollisionConfiguration>();
+	_dispatcher = std::make_unique<btCollisionDispatcher>(_configuration.get());
+	_broadphase = std::make_unique<btDbvtBroadphase>();
+	_solver = std::make_unique<btSequentialImpulseConstraintSolver>();
+	_world = std::make_unique<btDiscreteDynamicsWorld>(_dispatcher.get(), _broadphase.get(), _solver.get(), _configuration.get());
+	// Our worlds are Z up
+	SetGravity(glm::vec3(0.0f, 0.0f, -9.81f));
+
+	entt::registry& registry = _scene.Registry();
+	registry.on_construct<RigidBody>().connect<&PhysicsWorld::_OnConstruct>(*this);
+	registry.on_update<RigidBody>().connect<&PhysicsWorld::_OnUpdate>(*this);
+	registry.on_destroy<RigidBody>().connect<&PhysicsWorld::_OnDestroy>(*this);
+	registry.set<PhysicsWorld*>(this);
+	// Anything that was added before we were around still needs to be picked up
+	registry.view<RigidBody>().each([this](entt::entity entity, RigidBody&) {
+		_added.push_back(entity);
+	});
+}
+
+PhysicsWorld::~PhysicsWorld() {
+	Wait();
+	entt::registry& registry = _scene.Registry();
+	registry.on_construct<RigidBody>().disconnect<&PhysicsWorld::_OnConstruct>(*this);
+	registry.on_update<RigidBody>().disconnect<&PhysicsWorld::_OnUpdate>(*this);
+	registry.on_destroy<RigidBody>().disconnect<&PhysicsWorld::_OnDestroy>(*this);
+	if (Get(registry) == this) {
+		registry.unset<PhysicsWorld*>();
+	}
+	// The world doesn't own it's bodies, but it does refer to them, so they have to come out before anything is freed
+	for (Slot& slot : _slots) {
+		if (slot.Body != nullptr) {
+			_world->removeRigidBody(slot.Body.get());
+		}
+	}
+	for (auto& [key, chunk] : _chunks) {
+		if (chunk.Body != nullptr) {
+			_world->removeRigidBody(chunk.Body.get());
+		}
+	}
+}
+
+void PhysicsWorld::Sync() {
+	Wait();
+	PROFILE_SCOPE("PhysicsSync");
+	entt::registry& registry = _scene.Registry();
+	_activeCount = 0;
+	for (uint32_t index : _moved) {
+		Slot& slot = _slots[index];
+		if (!slot.IsMoved) {
+			continue;
+		}
+		slot.IsMoved = false;
+		if (slot.IsFree || !registry.valid(slot.Entity)) {
+			continue;
+		}
+		Transform* transform = registry.try_get<Transform>(slot.Entity);
+		if (transform != nullptr) {
+			transform->SetLocalPosition(slot.Position);
+			transform->SetLocalRotation(slot.Rotation);
+			_activeCount++;
+		}
+	}
+	_moved.clear();
+}
+
+void PhysicsWorld::Step(uint32_t steps, float fixedTimeStep) {
+	Wait();
+	PROFILE_SCOPE("Physics");
+	entt::registry& registry = _scene.Registry();
+
+	// Rigid bodies can't be given bodies from inside of the signals (or while we're stepping), so we catch up on them here
+	for (uint32_t slot : _removed) {
+		_DestroyBody(slot);
+	}
+	_removed.clear();
+	for (entt::entity entity : _added) {
+		if (registry.valid(entity) && registry.has<RigidBody>(entity) && registry.get<RigidBody>(entity)._slot == RigidBody::INVALID_SLOT) {
+			_CreateBody(entity);
+		}
+	}
+	_added.clear();
+
+	// Kinematic and static bodies follow their transforms, which only needs doing when the world version changed
+	registry.view<RigidBody, Transform>().each([this](entt::entity entity, RigidBody& rigidBody, Transform& transform) {
+		if (rigidBody._slot == RigidBody::INVALID_SLOT) {
+			return;
+		}
+		Slot& slot = _slots[rigidBody._slot];
+		if (slot.Type == RigidBodyType::Dynamic || slot.SyncedVersion == transform.GetWorldVersion()) {
+			return;
+		}
+		slot.SyncedVersion = transform.GetWorldVersion();
+		slot.Position = transform.GetLocalPosition();
+		slot.Rotation = transform.GetLocalRotationQuat();
+		if (slot.Type == RigidBodyType::Kinematic) {
+			slot.Motion->Current = btTransform(ToBullet(slot.Rotation), ToBullet(slot.Position));
+			return;
+		}
+		// A static body that moved may have crossed into another chunk
+		ChunkKey key = _GetChunk(slot.Position, rigidBody);
+		if (key != slot.Chunk) {
+			StaticChunk& from = _chunks[slot.Chunk];
+			from.Members.erase(std::find(from.Members.begin(), from.Members.end(), rigidBody._slot));
+			from.IsDirty = true;
+			_chunks[key].Members.push_back(rigidBody._slot);
+			slot.Chunk = key;
+		}
+		_chunks[key].IsDirty = true;
+	});
+
+	for (auto it = _chunks.begin(); it != _chunks.end();) {
+		if (it->second.IsDirty) {
+			_RebuildChunk(it->first, it->second);
+		}
+		it = it->second.Body == nullptr ? _chunks.erase(it) : std::next(it);
+	}
+	// Every compound that referred to these has been rebuilt without them
+	_retiredShapes.clear();
+	_retiredMeshes.clear();
+
+	// This frame's queries run once the steps are done, so they see where everything ends up
+	{
+		std::lock_guard<std::mutex> lock(_queryMutex);
+		_runningQueries.swap(_queries);
+		_queries.clear();
+		_runningBatch = _queryBatch++;
+	}
+
+	if (steps == 0 && _runningQueries.empty()) {
+		return;
+	}
+	// From here on, only the worker touches the Bullet world until the next Wait
+	btDiscreteDynamicsWorld* world = _world.get();
+	_stepping = ThreadPool::Instance().Schedule([this, world, steps, fixedTimeStep]() {
+		{
+			PROFILE_SCOPE("PhysicsStep");
+			// We do our own fixed stepping, so Bullet shouldn't substep or interpolate
+			for (uint32_t step = 0; step < steps; step++) {
+				world->stepSimulation(fixedTimeStep, 0);
+			}
+		}
+		_RunQueries();
+	}, JobThread::Worker, JobPriority::Frame);
+}
+
+void PhysicsWorld::Wait() {
+	if (_stepping.IsValid()) {
+		ThreadPool::Instance().Wait(_stepping);
+		_stepping = Task<void>();
+
+		// Bodies only get destroyed once we're done waiting, so the slots still belong to whatever was hit
+		_results.resize(_runningResults.size());
+		for (size_t ix = 0; ix < _runningResults.size(); ix++) {
+			const QueryResult& result = _runningResults[ix];
+			_results[ix] = result.Hit;
+			if (result.Slot >= 0 && static_cast<size_t>(result.Slot) < _slots.size() && !_slots[result.Slot].IsFree) {
+				_results[ix].Entity = _slots[result.Slot].Entity;
+			}
+		}
+		_resultBatch = _runningBatch;
+		_runningQueries.clear();
+		_runningResults.clear();
+	}
+}
+
+PhysicsWorld::QueryId PhysicsWorld::RayCast(const glm::vec3& from, const glm::vec3& to) {
+	return _Submit(Query{ from, to, 0.0f });
+}
+
+PhysicsWorld::QueryId PhysicsWorld::SphereCast(const glm::vec3& from, const glm::vec3& to, float radius) {
+	return _Submit(Query{ from, to, std::max(radius, 0.0f) });
+}
+
+bool PhysicsWorld::TryGetResult(QueryId id, QueryHit& result) const {
+	const uint32_t batch = static_cast<uint32_t>(id >> 32);
+	const uint32_t index = static_cast<uint32_t>(id);
+	if (id == INVALID_QUERY || batch != _resultBatch || index >= _results.size()) {
+		return false;
+	}
+	result = _results[index];
+	return true;
+}
+
+PhysicsWorld::QueryId PhysicsWorld::_Submit(const Query& query) {
+	std::lock_guard<std::mutex> lock(_queryMutex);
+	const uint32_t index = static_cast<uint32_t>(_queries.size());
+	_queries.push_back(query);
+	return (static_cast<QueryId>(_queryBatch) << 32) | index;
+}
+
+void PhysicsWorld::_RunQueries() {
+	if (_runningQueries.empty()) {
+		return;
+	}
+	PROFILE_SCOPE("PhysicsQueries");
+	_runningResults.assign(_runningQueries.size(), QueryResult());
+	// Our broadphase is always a btDbvtBroadphase, it keeps moving and resting proxies in separate trees
+	const btDbvtBroadphase* broadphase = static_cast<const btDbvtBroadphase*>(_broadphase.get());
+	ThreadPool::Instance().ParallelFor(_runningQueries.size(), QUERY_BATCH, [&](size_t begin, size_t end) {
+		btAlignedObjectArray<const btDbvtNode*> stack;
+		for (size_t ix = begin; ix < end; ix++) {
+			const Query& query = _runningQueries[ix];
+			const btVector3 from = ToBullet(query.From);
+			const btVector3 to = ToBullet(query.To);
+			const btScalar length = (to - from).length();
+			if (length <= SIMD_EPSILON) {
+				continue;
+			}
+			const btVector3 direction = (to - from) / length;
+			btVector3 inverse;
+			unsigned int signs[3];
+			for (int axis = 0; axis < 3; axis++) {
+				inverse[axis] = direction[axis] == btScalar(0.0) ? BT_LARGE_FLOAT : btScalar(1.0) / direction[axis];
+				signs[axis] = inverse[axis] < 0.0f;
+			}
+
+			QueryCollector collector;
+			collector.From = btTransform(btQuaternion::getIdentity(), from);
+			collector.To = btTransform(btQuaternion::getIdentity(), to);
+			btCollisionWorld::ClosestRayResultCallback ray(from, to);
+			btCollisionWorld::ClosestConvexResultCallback convex(from, to);
+			btSphereShape sphere(query.Radius);
+			// The tree is walked with the sweep's bounds around each point along the ray
+			const btVector3 extents(query.Radius, query.Radius, query.Radius);
+			if (query.Radius > 0.0f) {
+				collector.Sweep = &sphere;
+				collector.Convex = &convex;
+			} else {
+				collector.Ray = &ray;
+			}
+			for (const btDbvt& tree : broadphase->m_sets) {
+				tree.rayTestInternal(tree.m_root, from, to, inverse, signs, length, -extents, extents, stack, collector);
+			}
+
+			QueryResult& result = _runningResults[ix];
+			const btCollisionObject* hit = query.Radius > 0.0f ? convex.m_hitCollisionObject : ray.m_collisionObject;
+			if (hit != nullptr) {
+				result.Hit.HasHit   = true;
+				result.Hit.Position = ToGlm(query.Radius > 0.0f ? convex.m_hitPointWorld : ray.m_hitPointWorld);
+				result.Hit.Normal   = ToGlm(query.Radius > 0.0f ? convex.m_hitNormalWorld : ray.m_hitNormalWorld);
+				result.Hit.Fraction = query.Radius > 0.0f ? convex.m_closestHitFraction : ray.m_closestHitFraction;
+				result.Slot         = hit->getUserIndex();
+			}
+		}
+	});
+}
+
+void PhysicsWorld::SetGravity(const glm::vec3& gravity) {
+	Wait();
+	_world->setGravity(ToBullet(gravity));
+}
+
+void PhysicsWorld::_OnConstruct(entt::registry& registry, entt::entity entity) {
+	_added.push_back(entity);
+}
+
+void PhysicsWorld::_OnUpdate(entt::registry& registry, entt::entity entity) {
+	// The settings may have changed the shape or type, so the body gets made again from scratch
+	RigidBody& rigidBody = registry.get<RigidBody>(entity);
+	if (rigidBody._slot != RigidBody::INVALID_SLOT) {
+		_removed.push_back(rigidBody._slot);
+		rigidBody._slot = RigidBody::INVALID_SLOT;
+	}
+	_added.push_back(entity);
+}
+
+void PhysicsWorld::_OnDestroy(entt::registry& registry, entt::entity entity) {
+	RigidBody& rigidBody = registry.get<RigidBody>(entity);
+	if (rigidBody._slot != RigidBody::INVALID_SLOT) {
+		_removed.push_back(rigidBody._slot);
+	}
+}
+
+void PhysicsWorld::_CreateBody(entt::entity entity) {
+	entt::registry& registry = _scene.Registry();
+	RigidBody& rigidBody = registry.get<RigidBody>(entity);
+	const Transform* transform = registry.try_get<Transform>(entity);
+	if (transform == nullptr) {
+		LOG_WARN("A rigid body was added to an entity without a transform, it will be ignored");
+		return;
+	}
+
+	uint32_t index;
+	if (!_freeSlots.empty()) {
+		index = _freeSlots.back();
+		_freeSlots.pop_back();
+	} else {
+		index = static_cast<uint32_t>(_slots.size());
+		_slots.emplace_back();
+	}
+	Slot& slot = _slots[index];
+	slot.Entity = entity;
+	slot.Type = rigidBody.Type;
+	slot.Position = transform->GetLocalPosition();
+	slot.Rotation = transform->GetLocalRotationQuat();
+	slot.SyncedVersion = transform->GetWorldVersion();
+	slot.IsMoved = false;
+	slot.IsFree = false;
+
+	switch (rigidBody.Collider) {
+		case ColliderType::Sphere:
+			slot.Shape = std::make_unique<btSphereShape>(rigidBody.Radius);
+			break;
+		case ColliderType::Capsule:
+			slot.Shape = std::make_unique<btCapsuleShapeZ>(rigidBody.Radius, rigidBody.Height);
+			break;
+		case ColliderType::ConvexHull:
+		case ColliderType::TriangleMesh:
+			slot.Mesh = CollisionCook::GetMesh(rigidBody.Mesh);
+			if (slot.Mesh == nullptr) {
+				LOG_WARN("Could not load the collision mesh \"{}\", the rigid body will use a box instead", rigidBody.Mesh);
+			} else if (rigidBody.Collider == ColliderType::TriangleMesh && rigidBody.Type == RigidBodyType::Static) {
+				slot.Shape = slot.Mesh->CreateTriangleMesh();
+			} else {
+				if (rigidBody.Collider == ColliderType::TriangleMesh) {
+					LOG_WARN("Only static bodies can use triangle meshes, \"{}\" will use it's convex hull instead", rigidBody.Mesh);
+				}
+				slot.Shape = slot.Mesh->CreateHull();
+			}
+			break;
+		default:
+			break;
+	}
+	if (slot.Shape == nullptr) {
+		slot.Shape = std::make_unique<btBoxShape>(ToBullet(rigidBody.HalfExtents));
+	}
+	slot.Shape->setLocalScaling(ToBullet(transform->GetLocalScale()));
+
+	if (rigidBody.Type == RigidBodyType::Static) {
+		slot.Chunk = _GetChunk(slot.Position, rigidBody);
+		StaticChunk& chunk = _chunks[slot.Chunk];
+		chunk.Members.push_back(index);
+		chunk.IsDirty = true;
+	} else {
+		const float mass = rigidBody.Type == RigidBodyType::Dynamic ? rigidBody.Mass : 0.0f;
+		btVector3 inertia(0.0f, 0.0f, 0.0f);
+		if (mass > 0.0f) {
+			slot.Shape->calculateLocalInertia(mass, inertia);
+		}
+		slot.Motion = std::make_unique<MotionState>(*this, index, btTransform(ToBullet(slot.Rotation), ToBullet(slot.Position)));
+		btRigidBody::btRigidBodyConstructionInfo info(mass, slot.Motion.get(), slot.Shape.get(), inertia);
+		info.m_friction = rigidBody.Friction;
+		info.m_restitution = rigidBody.Restitution;
+		slot.Body = std::make_unique<btRigidBody>(info);
+		// So the queries can tell which entity they hit, the static chunks keep the default of -1
+		slot.Body->setUserIndex(static_cast<int>(index));
+		if (rigidBody.Type == RigidBodyType::Kinematic) {
+			slot.Body->setCollisionFlags(slot.Body->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+			slot.Body->setActivationState(DISABLE_DEACTIVATION);
+		}
+		_world->addRigidBody(slot.Body.get());
+	}
+
+	rigidBody._slot = index;
+	_bodyCount++;
+}
+
+void PhysicsWorld::_DestroyBody(uint32_t index) {
+	Slot& slot = _slots[index];
+	// A rigid body that was updated and then destroyed in the same frame gets queued twice
+	if (slot.IsFree) {
+		return;
+	}
+	if (slot.Body != nullptr) {
+		_world->removeRigidBody(slot.Body.get());
+		slot.Body.reset();
+	}
+	slot.Motion.reset();
+	if (slot.Type == RigidBodyType::Static) {
+		StaticChunk& chunk = _chunks[slot.Chunk];
+		chunk.Members.erase(std::find(chunk.Members.begin(), chunk.Members.end(), index));
+		chunk.IsDirty = true;
+	}
+	_retiredShapes.push_back(std::move(slot.Shape));
+	_retiredMeshes.push_back(std::move(slot.Mesh));
+	slot.Entity = entt::null;
+	slot.IsMoved = false;
+	slot.IsFree = true;
+	_freeSlots.push_back(index);
+	_bodyCount--;
+}
+
+void PhysicsWorld::_RebuildChunk(const ChunkKey& key, StaticChunk& chunk) {
+	chunk.IsDirty = false;
+	if (chunk.Body != nullptr) {
+		_world->removeRigidBody(chunk.Body.get());
+		chunk.Body.reset();
+	}
+	chunk.Shape.reset();
+	if (chunk.Members.empty()) {
+		return;
+	}
+
+	chunk.Shape = std::make_unique<btCompoundShape>(true, static_cast<int>(chunk.Members.size()));
+	for (uint32_t index : chunk.Members) {
+		const Slot& slot = _slots[index];
+		chunk.Shape->addChildShape(btTransform(ToBullet(slot.Rotation), ToBullet(slot.Position)), slot.Shape.get());
+	}
+	// Every member is made of the same stuff, since it's part of the key
+	btRigidBody::btRigidBodyConstructionInfo info(0.0f, nullptr, chunk.Shape.get());
+	info.m_friction = std::get<2>(key);
+	info.m_restitution = std::get<3>(key);
+	chunk.Body = std::make_unique<btRigidBody>(info);
+	_world->addRigidBody(chunk.Body.get());
+}
+
+PhysicsWorld::ChunkKey PhysicsWorld::_GetChunk(const glm::vec3& position, const RigidBody& rigidBody) const {
+	return ChunkKey(
+		static_cast<int>(std::floor(position.x / STATIC_CHUNK_SIZE)),
+		static_cast<int>(std::floor(position.y / STATIC_CHUNK_SIZE)),
+		rigidBody.Friction,
+		rigidBody.Restitution
+	);
+}
@@ -0,0 +1,266 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+#include "RigidBody.h"
+#include "Scene.h"
+#include "Utilities/CollisionCook.h"
+#include "Utilities/ThreadPool.h"
+
+class btBroadphaseInterface;
+class btCollisionConfiguration;
+class btCollisionDispatcher;
+class btCollisionShape;
+class btCompoundShape;
+class btConstraintSolver;
+class btDiscreteDynamicsWorld;
+class btRigidBody;
+
+/// <summary>
+/// Simulates the rigid bodies in a scene with Bullet. The simulation steps on a worker, starting once the frame's
+/// world matrices are up to date and running while the frame is drawn, and it's results get written back to the
+/// transforms on the next frame's first fixed step. Only bodies that Bullet moved (the active ones) get written back,
+/// so a pile of sleeping bodies costs next to nothing
+///
+/// Kinematic and static bodies follow their transforms the other way, picking up any change in the world version.
+/// Static bodies are merged into compound shapes per chunk of the world, so a level's worth of colliders is a handful
+/// of broadphase entries instead of one each
+///
+/// Rigid bodies can be added and removed at any time (ex: while streaming the world in), the world picks the changes
+/// up the next time it isn't stepping
+///
+/// Ray casts and sphere sweeps are batched rather than run one at a time. Anything can submit them during the frame
+/// (from any thread), they all run in parallel against the broadphase on the worker once the frame's steps are done,
+/// and their results can be picked up from the next frame's first fixed step on. Behaviours can find their scene's
+/// world with Get
+/// </summary>
+class PhysicsWorld final
+{
+public:
+	typedef std::shared_ptr<PhysicsWorld> sptr;
+	static inline sptr Create(GameScene& scene) {
+		return std::make_shared<PhysicsWorld>(scene);
+	}
+
+	/// <summary>
+	/// The width of the chunks that static bodies get merged into, along the X and Y axes
+	/// </summary>
+	static const float STATIC_CHUNK_SIZE;
+
+	/// <summary>
+	/// Routes all of Bullet's allocations through operator new, so they get charged to MemoryTag::Physics. Must be
+	/// called before anything is made with Bullet (including by CollisionCook), since it can't free what it
+	/// allocated beforehand
+	/// </summary>
+	static void TrackAllocations();
+
+	/// <summary>
+	/// Creates a world for the rigid bodies in a scene, including any it already has
+	/// </summary>
+	/// <param name="scene">The scene to simulate, must outlive the world</param>
+	PhysicsWorld(GameScene& scene);
+	~PhysicsWorld();
+
+	PhysicsWorld(const PhysicsWorld& other) = delete;
+	PhysicsWorld& operator=(const PhysicsWorld& other) = delete;
+
+	/// <summary>
+	/// Identifies a query submitted with RayCast or SphereCast, for getting it's result
+	/// </summary>
+	typedef uint64_t QueryId;
+	/// <summary>
+	/// Never returned for a real query
+	/// </summary>
+	static const QueryId INVALID_QUERY = ~0ull;
+
+	/// <summary>
+	/// The closest thing a ray or sweep ran into
+	/// </summary>
+	struct QueryHit {
+		bool         HasHit   = false;
+		// The entity that was hit, static bodies are merged into chunks so hitting one of those gives entt::null
+		entt::entity Entity   = entt::null;
+		// Where the ray hit, or where the sweep's sphere was touching the surface
+		glm::vec3    Position = glm::vec3(0.0f);
+		glm::vec3    Normal   = glm::vec3(0.0f);
+		// How far along from the start to the end the hit was, between 0 and 1
+		float        Fraction = 1.0f;
+	};
+
+	/// <summary>
+	/// Gets the world that is simulating a scene, or nullptr if there isn't one
+	/// </summary>
+	static PhysicsWorld* Get(entt::registry& registry);
+	/// <summary>
+	/// Waits for the last steps to finish, and writes the bodies they moved back into their transforms. Should be
+	/// called from the first fixed step of a frame, so the new positions count as that step's simulation state
+	/// </summary>
+	void Sync();
+	/// <summary>
+	/// Adds, removes and rebuilds bodies for any rigid bodies that changed, moves kinematic and static bodies to
+	/// follow their transforms, then starts stepping the simulation on a worker. Should be called once a frame after
+	/// the world matrices have been updated
+	/// </summary>
+	/// <param name="steps">The number of fixed steps that ran this frame, nothing gets stepped if this is 0</param>
+	/// <param name="fixedTimeStep">The length of each step, in seconds</param>
+	void Step(uint32_t steps, float fixedTimeStep);
+	/// <summary>
+	/// Blocks until the simulation has finished stepping, without writing anything back. Anything that wants to use
+	/// the Bullet world directly (ex: for ray casts) needs to call this first
+	/// </summary>
+	void Wait();
+
+	/// <summary>
+	/// Submits a ray cast, to be run with the next call to Step. Safe to call from any thread
+	/// </summary>
+	/// <param name="from">Where the ray starts, in world space</param>
+	/// <param name="to">Where the ray ends, in world space</param>
+	/// <returns>The id to get the result with, once the query has run</returns>
+	QueryId RayCast(const glm::vec3& from, const glm::vec3& to);
+	/// <summary>
+	/// Submits a sphere sweep, to be run with the next call to Step. Safe to call from any thread
+	/// </summary>
+	/// <param name="from">Where the sphere's center starts, in world space</param>
+	/// <param name="to">Where the sphere's center ends, in world space</param>
+	/// <param name="radius">The radius of the sphere</param>
+	/// <returns>The id to get the result with, once the query has run</returns>
+	QueryId SphereCast(const glm::vec3& from, const glm::vec3& to, float radius);
+	/// <summary>
+	/// Gets the result of a query. Queries run alongside the steps started at the end of the frame they were submitted
+	/// in, and their results come in with the next Sync (or Wait). They stay around until the results of the next
+	/// frame's queries replace them, so each result has to be picked up in the frame after it was submitted
+	/// </summary>
+	/// <param name="id">The id returned when the query was submitted</param>
+	/// <param name="result">Set to the query's result, if it's ready</param>
+	/// <returns>False if the query hasn't run yet, or it's result has already been replaced</returns>
+	bool TryGetResult(QueryId id, QueryHit& result) const;
+	/// <summary>
+	/// Gets the number of queries that ran with the last step
+	/// </summary>
+	uint32_t GetQueryCount() const { return static_cast<uint32_t>(_results.size()); }
+
+	/// <summary>
+	/// Sets the acceleration applied to every dynamic body
+	/// </summary>
+	void SetGravity(const glm::vec3& gravity);
+
+	/// <summary>
+	/// Gets the Bullet world, see Wait
+	/// </summary>
+	btDiscreteDynamicsWorld* GetWorld() const { return _world.get(); }
+	/// <summary>
+	/// Gets the number of rigid bodies in the world, including static ones
+	/// </summary>
+	uint32_t GetBodyCount() const { return _bodyCount; }
+	/// <summary>
+	/// Gets the number of bodies that were written back by the last Sync
+	/// </summary>
+	uint32_t GetActiveCount() const { return _activeCount; }
+	/// <summary>
+	/// Gets the number of compound shapes that the static bodies have been merged into
+	/// </summary>
+	uint32_t GetStaticChunkCount() const { return static_cast<uint32_t>(_chunks.size()); }
+
+private:
+	class MotionState;
+
+	// A ray cast or sphere sweep waiting to run, a radius of 0 is a ray
+	struct Query {
+		glm::vec3 From;
+		glm::vec3 To;
+		float     Radius;
+	};
+	// A query's result as the worker leaves it, the entity gets filled in from the body's slot once it's done
+	struct QueryResult {
+		QueryHit  Hit;
+		int       Slot = -1;
+	};
+
+	// Static bodies only get merged with neighbours made of the same stuff, since the compound has a single friction
+	// and restitution. Keyed by the cell along X and Y, then the friction and restitution
+	typedef std::tuple<int, int, float, float> ChunkKey;
+
+	// Everything we keep for a single rigid body
+	struct Slot {
+		entt::entity                      Entity = entt::null;
+		RigidBodyType                     Type = RigidBodyType::Dynamic;
+		// The model that hull and triangle mesh shapes were made from, which the shape may refer to
+		CollisionMesh::sptr               Mesh;
+		std::unique_ptr<btCollisionShape> Shape;
+		// Static bodies are children of their chunk's compound shape, and don't have bodies of their own
+		std::unique_ptr<MotionState>      Motion;
+		std::unique_ptr<btRigidBody>      Body;
+		ChunkKey                          Chunk;
+		// The world version of the transform the body was last placed at
+		uint32_t                          SyncedVersion = 0;
+		// Written by the motion state while stepping, and copied into the transform by Sync
+		glm::vec3                         Position = glm::vec3(0.0f);
+		glm::quat                         Rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		bool                              IsMoved = false;
+		bool                              IsFree = true;
+	};
+
+	// The static bodies in one part of the world, merged into a single compound
+	struct StaticChunk {
+		std::vector<uint32_t>             Members;
+		std::unique_ptr<btCompoundShape>  Shape;
+		std::unique_ptr<btRigidBody>      Body;
+		bool                              IsDirty = true;
+	};
+
+	GameScene&                                    _scene;
+	std::unique_ptr<btCollisionConfiguration>     _configuration;
+	std::unique_ptr<btCollisionDispatcher>        _dispatcher;
+	std::unique_ptr<btBroadphaseInterface>        _broadphase;
+	std::unique_ptr<btConstraintSolver>           _solver;
+	std::unique_ptr<btDiscreteDynamicsWorld>      _world;
+
+	std::vector<Slot>                             _slots;
+	std::vector<uint32_t>                         _freeSlots;
+	std::map<ChunkKey, StaticChunk>               _chunks;
+	// Shapes of static bodies that were removed, which their chunk's compound refers to until it's rebuilt
+	std::vector<std::unique_ptr<btCollisionShape>> _retiredShapes;
+	std::vector<CollisionMesh::sptr>              _retiredMeshes;
+	// Filled in by the motion states while stepping, so Sync only has to visit the bodies that moved
+	std::vector<uint32_t>                         _moved;
+	// Changes to the rigid bodies that happened while we might have been stepping, applied by the next Step
+	std::vector<entt::entity>                     _added;
+	std::vector<uint32_t>                         _removed;
+	Task<void>                                    _stepping;
+	// The queries submitted this frame, the ones running with the step, and the results of the last ones that ran.
+	// The batch numbers go in the top half of each query's id, so old ids can't pick up newer results
+	std::mutex                                    _queryMutex;
+	std::vector<Query>                            _queries;
+	std::vector<Query>                            _runningQueries;
+	std::vector<QueryResult>                      _runningResults;
+	std::vector<QueryHit>                         _results;
+	uint32_t                                      _queryBatch;
+	uint32_t                                      _runningBatch;
+	uint32_t                                      _resultBatch;
+	uint32_t                                      _bodyCount;
+	uint32_t                                      _activeCount;
+
+	void _OnConstruct(entt::registry& registry, entt::entity entity);
+	void _OnUpdate(entt::registry& registry, entt::entity entity);
+	void _OnDestroy(entt::registry& registry, entt::entity entity);
+
+	// Makes the body for a rigid body that doesn't have one yet
+	void _CreateBody(entt::entity entity);
+	// Takes a body out of the world and frees it's slot
+	void _DestroyBody(uint32_t slot);
+	// Rebuilds the compound shape of a chunk that had static bodies added, removed or moved
+	void _RebuildChunk(const ChunkKey& key, StaticChunk& chunk);
+	// Submits a query for the next step
+	QueryId _Submit(const Query& query);
+	// Runs the queries that were handed to the worker, must only be called while nothing else touches the Bullet world
+	void _RunQueries();
+	// Gets the chunk that a static body at the given position belongs to
+	ChunkKey _GetChunk(const glm::vec3& position, const RigidBody& rigidBody) const;
+};
@@ -0,0 +1,851 @@
+#include "RenderSnapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+
+#include "Logging.h"
+#include "SpatialIndex.h"
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/FrameArena.h"
+#include "Utilities/RadixSort.h"
+#include "Utilities/ThreadPool.h"
+
+// The range given to directional lights, big enough to reach every cluster from the camera without overflowing when squared
+static const float DIRECTIONAL_LIGHT_RANGE = 1.0e18f;
+// Marks the scatter cells that draw their meshes and impostors, above the bits for the views that can see them
+static const uint32_t CELL_DRAWS_MESH = 0x100u;
+static const uint32_t CELL_DRAWS_IMPOSTOR = 0x200u;
+
+void RenderSnapshot::Clear() {
+	Batches.clear();
+	TransparentBatches.clear();
+	WeightedBatches.clear();
+	PendingMaterials.clear();
+	UpcomingMaterials.clear();
+	Lights.clear();
+	Shadows.Static = nullptr;
+	Shadows.Dynamic.clear();
+	QueryBoxes.clear();
+	RecordPatch.Clear();
+	InstanceEntities.clear();
+	RecordEntities.clear();
+	InstanceCount = 0;
+	VisibleCount = 0;
+	CulledCount = 0;
+	OccludedCount = 0;
+	PendingCount = 0;
+	LodCount = 0;
+	TransparentCount = 0;
+	WeightedCount = 0;
+	ImpostorCount = 0;
+	ScatterCount = 0;
+	ScatterImpostorCount = 0;
+	ScatterCellCount = 0;
+	GpuCulledCount = 0;
+	TerrainPatchCount = 0;
+	CulledLightCount = 0;
+	for (SnapshotView& view : Views) {
+		view.Batches.clear();
+		view.TransparentBatches.clear();
+		view.WeightedBatches.clear();
+		view.VisibleCount = 0;
+	}
+}
+
+bool RenderSnapshot::IsInAnyView(const BoundingVolume& bounds) const {
+	if (ViewFrustum.Intersects(bounds)) {
+		return true;
+	}
+	for (const SnapshotView& view : Views) {
+		if (view.ViewFrustum.Intersects(bounds)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+RenderSnapshotBuilder::RenderSnapshotBuilder(GameScene& scene) :
+	_scene(scene),
+	_group(scene.Registry().group<RendererComponent, WorldMatrix>()),
+	_lights(scene.Registry().view<Light, Transform>()),
+	_statics(scene.Registry().view<StaticTag>()),
+	_scatters(scene.Registry().view<ScatterComponent>()),
+	_terrains(scene.Registry().view<TerrainComponent>()),
+	_staticSignature(0),
+	_staticVersion(0),
+	_sortedCount(0),
+	_spareInstances(0),
+	_transparentFirst(0),
+	_recordCapacity(0),
+	_recordSequence(0),
+	_recordsValid(false),
+	_drawRecords(false)
+{ }
+
+void RenderSnapshotBuilder::Build(RenderSnapshot& snapshot, const RenderSnapshotSettings& settings) {
+	_Sort();
+
+	PROFILE_SCOPE("Gather");
+	snapshot.Clear();
+	LOG_ASSERT(snapshot.Instances.Capacity >= _group.size(), "Snapshot's instance region is too small for the render group!");
+	LOG_ASSERT(snapshot.Views.size() < RenderSnapshot::MAX_VIEWS, "Snapshot has too many views!");
+	const uint32_t viewCount = static_cast<uint32_t>(snapshot.Views.size() + 1);
+	// The terrains' room is kept aside, so the impostors can't take it
+	_spareInstances = std::max(static_cast<int>(snapshot.Instances.Capacity - _group.size()) - static_cast<int>(GetTerrainCapacity(viewCount)), 0);
+
+	// The BVH finds everything in the views in one pass, instead of testing every renderer's bounds
+	if (settings.FrustumCulling) {
+		Frustum frustums[RenderSnapshot::MAX_VIEWS];
+		for (uint32_t view = 0; view < viewCount; view++) {
+			frustums[view] = snapshot.GetViewFrustum(view);
+		}
+		_scene.Spatial().CullFrustums(frustums, viewCount);
+	}
+	// Only the materials are wanted from the predicted view, so there's no need to disturb the culling results
+	if (settings.PredictView) {
+		PROFILE_SCOPE("Predict");
+		const entt::registry& registry = _scene.Registry();
+		_scene.Spatial().GetTree().QueryFrustum(Frustum(settings.PredictedViewProjection), [&](entt::entity entity, DynamicBvh::NodeId) {
+			const ShaderMaterial::sptr& material = registry.get<RendererComponent>(entity).Material;
+			if (material != nullptr && std::find(snapshot.UpcomingMaterials.begin(), snapshot.UpcomingMaterials.end(), material) == snapshot.UpcomingMaterials.end()) {
+				snapshot.UpcomingMaterials.push_back(material);
+			}
+		});
+	}
+	_GatherLights(snapshot, settings);
+	if (settings.Shadows) {
+		_GatherShadowCasters(snapshot);
+	}
+
+	// Renderers culled on the GPU draw out of the records, which only need patching where something changed. Growing
+	// them, or turning them back on, starts them over with every record
+	_drawRecords = settings.GpuCulling && settings.Records != nullptr && viewCount == 1;
+	RenderRecordPatch& patch = snapshot.RecordPatch;
+	if (_drawRecords) {
+		const bool grow = _group.size() > _recordCapacity;
+		if (grow) {
+			_recordCapacity = std::max(static_cast<uint32_t>(_group.size()), std::max(_recordCapacity * 2, static_cast<uint32_t>(CHUNK_SIZE)));
+		}
+		if (grow || !_recordsValid || settings.RefreshRecords) {
+			_recordKeys.assign(_recordCapacity, { entt::null, 0, 0 });
+			patch.IsFull = true;
+		}
+		patch.Sequence = ++_recordSequence;
+		patch.Capacity = _recordCapacity;
+	}
+	_recordsValid = _drawRecords;
+
+	// Every chunk gets culled and batched on it's own
+	const uint32_t chunks = static_cast<uint32_t>((_group.size() + CHUNK_SIZE - 1) / CHUNK_SIZE);
+	if (_buckets.size() < chunks) {
+		_buckets.resize(chunks);
+	}
+	ThreadPool::Instance().ParallelFor(chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t chunk = begin; chunk < end; chunk++) {
+			_GatherChunk(static_cast<uint32_t>(chunk), snapshot, settings);
+		}
+	});
+
+	// Then stitched together in order, merging batches that carry on across the edge of a chunk
+	for (uint32_t chunk = 0; chunk < chunks; chunk++) {
+		Bucket& bucket = _buckets[chunk];
+		bucket.First = static_cast<uint32_t>(snapshot.InstanceCount);
+		if (viewCount == 1) {
+			for (const DrawBatch& batch : bucket.Batches) {
+				if (!snapshot.Batches.empty() &&
+					snapshot.Batches.back().Material == batch.Material &&
+					snapshot.Batches.back().Mesh == batch.Mesh &&
+					snapshot.Batches.back().Query == OcclusionQueries::NONE &&
+					!snapshot.Batches.back().GpuCulled &&
+					batch.Query == OcclusionQueries::NONE)
+				{
+					snapshot.Batches.back().InstanceCount += batch.InstanceCount;
+				} else {
+					snapshot.Batches.push_back({ batch.Material, batch.Mesh, static_cast<int>(snapshot.Instances.First + bucket.First) + batch.BaseInstance, batch.InstanceCount, nullptr, batch.Query });
+				}
+			}
+			for (const DrawBatch& batch : bucket.GpuBatches) {
+				if (!snapshot.Batches.empty() &&
+					snapshot.Batches.back().GpuCulled &&
+					snapshot.Batches.back().Material == batch.Material &&
+					snapshot.Batches.back().Mesh == batch.Mesh &&
+					snapshot.Batches.back().BaseInstance + snapshot.Batches.back().InstanceCount == batch.BaseInstance)
+				{
+					snapshot.Batches.back().InstanceCount += batch.InstanceCount;
+				} else {
+					snapshot.Batches.push_back(batch);
+				}
+				snapshot.GpuCulledCount += batch.InstanceCount;
+			}
+			const RendererComponent* renderers = _group.raw<RendererComponent>();
+			const WorldMatrix* worlds = _group.raw<WorldMatrix>();
+			for (uint32_t slot : bucket.Patch) {
+				patch.Slots.push_back(slot);
+				patch.Records.emplace_back(worlds[slot].Model, worlds[slot].Normal, renderers[slot].Material->GetMaterialIndex());
+			}
+		} else {
+			// Each view only draws the instances it can see, so the chunk's batches get split up around the rest
+			const int firstInstance = static_cast<int>(snapshot.Instances.First + bucket.First);
+			_AddViewBatches(bucket, 0, firstInstance, snapshot.Batches);
+			for (uint32_t view = 1; view < viewCount; view++) {
+				snapshot.Views[view - 1].VisibleCount += _AddViewBatches(bucket, view, firstInstance, snapshot.Views[view - 1].Batches);
+			}
+		}
+		snapshot.QueryBoxes.insert(snapshot.QueryBoxes.end(), bucket.QueryBoxes.begin(), bucket.QueryBoxes.end());
+		for (const ShaderMaterial::sptr& material : bucket.PendingMaterials) {
+			if (std::find(snapshot.PendingMaterials.begin(), snapshot.PendingMaterials.end(), material) == snapshot.PendingMaterials.end()) {
+				snapshot.PendingMaterials.push_back(material);
+			}
+		}
+		snapshot.InstanceCount += static_cast<int>(bucket.Visible.size());
+		snapshot.VisibleCount += static_cast<int>(bucket.Visible.size());
+		snapshot.CulledCount += bucket.CulledCount;
+		snapshot.OccludedCount += bucket.OccludedCount;
+		snapshot.PendingCount += bucket.PendingCount;
+		snapshot.LodCount += bucket.LodCount;
+		snapshot.ImpostorCount += static_cast<int>(bucket.Impostors.size());
+	}
+
+	// The order independent blended renderers keep their instances where the chunks put them, they only need drawing
+	// after the rest
+	snapshot.WeightedCount = _SplitWeighted(snapshot.Batches, snapshot.WeightedBatches);
+	for (SnapshotView& view : snapshot.Views) {
+		_SplitWeighted(view.Batches, view.WeightedBatches);
+	}
+
+	// The blended renderers go after all the chunks' instances, in their own order
+	_GatherTransparent(snapshot, chunks);
+
+	// The scatters draw out of their own instances, so they go after all the chunks
+	_GatherScatters(snapshot, settings);
+	// And the terrains' nodes go after everything else in the region
+	_GatherTerrains(snapshot);
+
+	// The entities go alongside the instances, every chunk writes it's own part of the list
+	if (settings.GatherEntities) {
+		snapshot.InstanceEntities.assign(_transparentFirst + _transparent.size(), entt::null);
+		if (_drawRecords) {
+			snapshot.RecordEntities.assign(_group.data(), _group.data() + _group.size());
+		}
+	}
+
+	// Now that every chunk knows where it's instances go, they can all write them at once
+	ThreadPool::Instance().ParallelFor(chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t chunk = begin; chunk < end; chunk++) {
+			_WriteChunk(static_cast<uint32_t>(chunk), snapshot);
+		}
+	});
+	_WriteTransparent(snapshot);
+}
+
+void RenderSnapshotBuilder::_GatherLights(RenderSnapshot& snapshot, const RenderSnapshotSettings& settings) {
+	PROFILE_SCOPE("GatherLights");
+	FrameArena::Scope scratch;
+	// The point and spot lights that want shadows, and how far they are from the camera
+	FrameVector<std::pair<float, size_t>> shadowed;
+	bool hasCascades = false;
+	for (entt::entity entity : _lights) {
+		const Light& light = _lights.get<Light>(entity);
+		float range = light.GetRange();
+		if (range <= 0.0f) {
+			continue;
+		}
+		const glm::mat4& world = _lights.get<Transform>(entity).WorldTransform();
+		glm::vec3 position = world[3];
+		if (light.Type == LightType::Directional) {
+			// Directional lights reach everywhere, so we center them on the camera with a range that touches every cluster
+			position = snapshot.Frame.CamPos;
+			range = DIRECTIONAL_LIGHT_RANGE;
+		} else if (!snapshot.IsInAnyView(BoundingVolume(position - glm::vec3(range), position + glm::vec3(range)))) {
+			// Lights that can't reach into any of the views don't need to be binned
+			snapshot.CulledLightCount++;
+			continue;
+		}
+		LightData data;
+		data.Position = position;
+		data.Range = range;
+		data.Color = light.Color;
+		data.Type = static_cast<uint32_t>(light.Type);
+		// Spot and directional lights shine down their -Z axis, same as the camera
+		data.Direction = glm::normalize(-glm::vec3(world[2]));
+		data.CosOuterAngle = glm::cos(glm::radians(light.OuterAngle));
+		data.Attenuation = glm::vec3(light.AttenuationConstant, light.AttenuationLinear, light.AttenuationQuadratic);
+		data.CosInnerAngle = glm::cos(glm::radians(glm::min(light.InnerAngle, light.OuterAngle)));
+		data.AmbientStrength = light.AmbientStrength;
+		data.SpecularStrength = light.SpecularStrength;
+		data.ShadowIndex = -1;
+		data.Padding = 0.0f;
+		if (settings.Shadows && light.CastShadows) {
+			// Only the first directional light gets the cascades
+			if (light.Type == LightType::Directional && !hasCascades) {
+				data.ShadowIndex = 0;
+				hasCascades = true;
+			} else if (light.Type != LightType::Directional) {
+				shadowed.emplace_back(glm::length(position - snapshot.Frame.CamPos), snapshot.Lights.size());
+			}
+		}
+		snapshot.Lights.push_back(data);
+	}
+
+	// There's only so many cube maps to go around, so the lights closest to the camera get them
+	const size_t shadowCount = std::min(shadowed.size(), static_cast<size_t>(MAX_POINT_SHADOWS));
+	std::partial_sort(shadowed.begin(), shadowed.begin() + shadowCount, shadowed.end());
+	for (size_t ix = 0; ix < shadowCount; ix++) {
+		snapshot.Lights[shadowed[ix].second].ShadowIndex = static_cast<int32_t>(ix);
+	}
+}
+
+void RenderSnapshotBuilder::_GatherShadowCasters(RenderSnapshot& snapshot) {
+	PROFILE_SCOPE("GatherShadowCasters");
+	const entt::entity* entities = _group.data();
+	const RendererComponent* renderers = _group.raw<RendererComponent>();
+	const WorldMatrix* worlds = _group.raw<WorldMatrix>();
+	// Everything static gets summed into a signature that changes whenever one is added, removed, moved or has it's
+	// mesh swapped. Adding keeps it independent of the order of the group, which changes whenever it gets sorted
+	uint64_t signature = 0;
+	for (size_t ix = 0; ix < _group.size(); ix++) {
+		const RendererComponent& renderer = renderers[ix];
+		// Anything that doesn't get culled (ex: the skybox) is not part of the world, so it doesn't cast shadows
+		if (!renderer.Cullable || renderer.Mesh == nullptr) {
+			continue;
+		}
+		if (_statics.contains(entities[ix])) {
+			uint64_t hash = static_cast<uint64_t>(entt::to_integral(entities[ix]));
+			hash = hash * 0x9E3779B97F4A7C15ull + worlds[ix].Version;
+			hash = hash * 0x9E3779B97F4A7C15ull + reinterpret_cast<uintptr_t>(renderer.Mesh.get());
+			signature += hash ^ (hash >> 31);
+		} else {
+			snapshot.Shadows.Dynamic.push_back({ renderer.Mesh, worlds[ix].Model, renderer.WorldBounds });
+		}
+	}
+
+	if (_staticCasters == nullptr || signature != _staticSignature) {
+		// The snapshot being drawn may still be using the old list, so we start a new one
+		_staticCasters = std::make_shared<std::vector<ShadowCaster>>();
+		for (size_t ix = 0; ix < _group.size(); ix++) {
+			const RendererComponent& renderer = renderers[ix];
+			if (renderer.Cullable && renderer.Mesh != nullptr && _statics.contains(entities[ix])) {
+				_staticCasters->push_back({ renderer.Mesh, worlds[ix].Model, renderer.WorldBounds });
+			}
+		}
+		// Versions are unique across builders, so a new scene's casters can't be mistaken for the last one's
+		static std::atomic<uint64_t> nextVersion(0);
+		_staticSignature = signature;
+		_staticVersion = ++nextVersion;
+	}
+	snapshot.Shadows.Static = _staticCasters;
+	snapshot.Shadows.StaticVersion = _staticVersion;
+}
+
+void RenderSnapshotBuilder::_GatherScatters(RenderSnapshot& snapshot, const RenderSnapshotSettings& settings) {
+	PROFILE_SCOPE("GatherScatters");
+	FrameArena::Scope scratch;
+	const glm::vec3 cameraPos = snapshot.Frame.CamPos;
+	// Adds a cell to the last batch if it carries on from it in the instance buffer
+	auto addCell = [](FrameVector<DrawBatch>& batches, const ShaderMaterial::sptr& material, const VertexArrayObject::sptr& mesh,
+		const VertexBuffer::sptr& instances, const ScatterComponent::Cell& cell) {
+		if (!batches.empty() && batches.back().BaseInstance + batches.back().InstanceCount == static_cast<int>(cell.First)) {
+			batches.back().InstanceCount += static_cast<int>(cell.Count);
+		} else {
+			batches.push_back({ material, mesh, static_cast<int>(cell.First), static_cast<int>(cell.Count), instances });
+		}
+	};
+	FrameVector<DrawBatch> meshes, impostors;
+	// The views that can see each cell, and which halves of the fade it draws
+	FrameVector<uint32_t> cellFlags;
+	const uint32_t viewCount = static_cast<uint32_t>(snapshot.Views.size() + 1);
+	// Culled on the GPU, the snapshot's own view takes every instance and only the extra views need cells
+	const uint32_t firstCellView = settings.GpuCulling ? 1u : 0u;
+	const uint32_t cellViews = ((1u << viewCount) - 1u) & ~((1u << firstCellView) - 1u);
+	for (entt::entity entity : _scatters) {
+		const ScatterComponent& scatter = _scatters.get<ScatterComponent>(entity);
+		if (!scatter.IsGenerated()) {
+			continue;
+		}
+		if (!scatter.Material->IsPrepared()) {
+			snapshot.PendingCount += static_cast<int>(scatter.GetInstanceCount());
+			if (std::find(snapshot.PendingMaterials.begin(), snapshot.PendingMaterials.end(), scatter.Material) == snapshot.PendingMaterials.end()) {
+				snapshot.PendingMaterials.push_back(scatter.Material);
+			}
+			continue;
+		}
+		// The impostor takes over once it's ready
+		const Impostor* impostor = scatter.Billboard.get();
+		if (impostor != nullptr && !impostor->GetMaterial()->IsPrepared()) {
+			if (std::find(snapshot.PendingMaterials.begin(), snapshot.PendingMaterials.end(), impostor->GetMaterial()) == snapshot.PendingMaterials.end()) {
+				snapshot.PendingMaterials.push_back(impostor->GetMaterial());
+			}
+			impostor = nullptr;
+		}
+
+		if (settings.GpuCulling) {
+			// The meshes give way to the impostors over the fade range, the shaders dither each instance across it
+			const BoundingVolume& meshBounds = scatter.Mesh->GetBounds();
+			DrawBatch batch = { scatter.Material, scatter.Mesh, 0, static_cast<int>(scatter.GetInstanceCount()), scatter.GetInstances() };
+			batch.GpuCulled = true;
+			batch.CullBounds = glm::vec4(meshBounds.Center, meshBounds.Radius);
+			batch.DrawRange = glm::vec2(0.0f, impostor != nullptr ? impostor->GetFadeEnd() : FLT_MAX);
+			snapshot.Batches.push_back(batch);
+			if (impostor != nullptr) {
+				batch.Material = impostor->GetMaterial();
+				batch.Mesh = impostor->GetMesh();
+				batch.DrawRange = glm::vec2(impostor->GetFadeStart(), FLT_MAX);
+				snapshot.Batches.push_back(batch);
+			}
+			if (cellViews == 0) {
+				continue;
+			}
+		}
+
+		// Each cell is culled once, then every view adds the cells it can see to it's own batches
+		const std::vector<ScatterComponent::Cell>& cells = scatter.GetCells();
+		cellFlags.clear();
+		for (const ScatterComponent::Cell& cell : cells) {
+			uint32_t views = cellViews;
+			if (settings.FrustumCulling) {
+				views = 0;
+				for (uint32_t view = firstCellView; view < viewCount; view++) {
+					views |= snapshot.GetViewFrustum(view).Intersects(cell.Bounds) ? 1u << view : 0u;
+				}
+				if (views == 0) {
+					snapshot.CulledCount += static_cast<int>(cell.Count);
+					cellFlags.push_back(0);
+					continue;
+				}
+			}
+			// The occlusion map only covers the snapshot's own view
+			if ((views & 1u) != 0 && settings.Occlusion != nullptr && settings.Occlusion->IsOccluded(cell.Bounds)) {
+				views &= ~1u;
+				if (views == 0) {
+					snapshot.OccludedCount += static_cast<int>(cell.Count);
+					cellFlags.push_back(0);
+					continue;
+				}
+			}
+			snapshot.ScatterCellCount++;
+			// Whole cells go to one side of the fade, unless they straddle it. Then both get drawn, and the shader
+			// dithers each instance by it's own distance
+			bool drawMesh = true;
+			bool drawImpostor = false;
+			if (impostor != nullptr) {
+				const float nearest = glm::length(glm::max(glm::max(cell.Bounds.Min - cameraPos, cameraPos - cell.Bounds.Max), glm::vec3(0.0f)));
+				const float farthest = glm::length(glm::max(glm::abs(cell.Bounds.Min - cameraPos), glm::abs(cell.Bounds.Max - cameraPos)));
+				drawMesh = nearest < impostor->GetFadeEnd();
+				drawImpostor = farthest > impostor->GetFadeStart();
+			}
+			cellFlags.push_back(views | (drawMesh ? CELL_DRAWS_MESH : 0u) | (drawImpostor ? CELL_DRAWS_IMPOSTOR : 0u));
+			if (drawImpostor) {
+				snapshot.ScatterImpostorCount += static_cast<int>(cell.Count);
+			}
+			snapshot.ScatterCount += static_cast<int>(cell.Count);
+			snapshot.VisibleCount += static_cast<int>(cell.Count);
+		}
+		for (uint32_t view = firstCellView; view < viewCount; view++) {
+			meshes.clear();
+			impostors.clear();
+			for (size_t ix = 0; ix < cells.size(); ix++) {
+				const uint32_t flags = cellFlags[ix];
+				if ((flags & (1u << view)) == 0) {
+					continue;
+				}
+				if ((flags & CELL_DRAWS_MESH) != 0) {
+					addCell(meshes, scatter.Material, scatter.Mesh, scatter.GetInstances(), cells[ix]);
+				}
+				if ((flags & CELL_DRAWS_IMPOSTOR) != 0) {
+					addCell(impostors, impostor->GetMaterial(), impostor->GetMesh(), scatter.GetInstances(), cells[ix]);
+				}
+				if (view > 0) {
+					snapshot.Views[view - 1].VisibleCount += static_cast<int>(cells[ix].Count);
+				}
+			}
+			std::vector<DrawBatch>& batches = snapshot.GetViewBatches(view);
+			batches.insert(batches.end(), meshes.begin(), meshes.end());
+			batches.insert(batches.end(), impostors.begin(), impostors.end());
+		}
+	}
+}
+
+void RenderSnapshotBuilder::_GatherTerrains(RenderSnapshot& snapshot) {
+	PROFILE_SCOPE("GatherTerrains");
+	FrameArena::Scope scratch;
+	// The nodes get picked somewhere we can read back from, the region is only good for writing to
+	FrameVector<InstanceTransform> picked(TerrainComponent::MAX_PATCHES);
+	InstanceTransform* instances = static_cast<InstanceTransform*>(snapshot.Instances.Data);
+	const uint32_t viewCount = static_cast<uint32_t>(snapshot.Views.size() + 1);
+	for (entt::entity entity : _terrains) {
+		const TerrainComponent& terrain = _terrains.get<TerrainComponent>(entity);
+		if (!terrain.IsBuilt()) {
+			continue;
+		}
+		if (!terrain.Material->IsPrepared()) {
+			if (std::find(snapshot.PendingMaterials.begin(), snapshot.PendingMaterials.end(), terrain.Material) == snapshot.PendingMaterials.end()) {
+				snapshot.PendingMaterials.push_back(terrain.Material);
+			}
+			continue;
+		}
+		// Each view picks it's own nodes, since the levels depend on where it's looking from
+		for (uint32_t view = 0; view < viewCount; view++) {
+			const glm::vec3 cameraPos = view == 0 ? snapshot.Frame.CamPos : snapshot.Views[view - 1].Frame.CamPos;
+			uint32_t quarters = 0;
+			const uint32_t count = terrain.Select(cameraPos, snapshot.GetViewFrustum(view), picked.data(), quarters);
+			if (count == 0 || static_cast<uint32_t>(snapshot.InstanceCount) + count > snapshot.Instances.Capacity) {
+				continue;
+			}
+			std::copy(picked.begin(), picked.begin() + count, instances + snapshot.InstanceCount);
+			const int first = static_cast<int>(snapshot.Instances.First) + snapshot.InstanceCount;
+			std::vector<DrawBatch>& batches = snapshot.GetViewBatches(view);
+			if (count > quarters) {
+				batches.push_back({ terrain.Material, terrain.GetPatch(), first, static_cast<int>(count - quarters) });
+			}
+			if (quarters > 0) {
+				batches.push_back({ terrain.Material, terrain.GetQuarterPatch(), first + static_cast<int>(count - quarters), static_cast<int>(quarters) });
+			}
+			snapshot.InstanceCount += static_cast<int>(count);
+			snapshot.TerrainPatchCount += static_cast<int>(count);
+		}
+	}
+}
+
+void RenderSnapshotBuilder::_GatherChunk(uint32_t chunk, const RenderSnapshot& snapshot, const RenderSnapshotSettings& settings) {
+	Bucket& bucket = _buckets[chunk];
+	bucket.Visible.clear();
+	bucket.Impostors.clear();
+	bucket.VisibleViews.clear();
+	bucket.ImpostorViews.clear();
+	bucket.Batches.clear();
+	bucket.GpuBatches.clear();
+	bucket.Patch.clear();
+	bucket.PendingMaterials.clear();
+	bucket.Transparent.clear();
+	bucket.QueryBoxes.clear();
+	bucket.CulledCount = 0;
+	bucket.OccludedCount = 0;
+	bucket.PendingCount = 0;
+	bucket.LodCount = 0;
+
+	const glm::vec3 cameraPos = snapshot.Frame.CamPos;
+	const uint32_t allViews = (1u << (snapshot.Views.size() + 1)) - 1u;
+	// The row of the view matrix that gives the view space Z, which points back towards the camera
+	const glm::vec4 viewZ(snapshot.Frame.View[0][2], snapshot.Frame.View[1][2], snapshot.Frame.View[2][2], snapshot.Frame.View[3][2]);
+	const SpatialIndex& spatial = _scene.Spatial();
+	const entt::entity* entities = _group.data();
+	RendererComponent* renderers = _group.raw<RendererComponent>();
+	const WorldMatrix* worlds = _group.raw<WorldMatrix>();
+	const uint32_t end = std::min(static_cast<uint32_t>(_group.size()), (chunk + 1) * CHUNK_SIZE);
+	for (uint32_t ix = chunk * CHUNK_SIZE; ix < end; ix++) {
+		RendererComponent& renderer = renderers[ix];
+		// Anything whose shader is still compiling gets skipped until it's ready. Only the main thread can ask the
+		// driver how it's going, so we hand the material back for it to prepare
+		if (!renderer.Material->IsPrepared()) {
+			bucket.PendingCount++;
+			if (std::find(bucket.PendingMaterials.begin(), bucket.PendingMaterials.end(), renderer.Material) == bucket.PendingMaterials.end()) {
+				bucket.PendingMaterials.push_back(renderer.Material);
+			}
+			continue;
+		}
+		// Opaque renderers drawn out of the records skip the rest, they only need their record patched if it changed
+		// and a place in a run of their mesh and material. The GPU culls them and picks their levels of detail
+		if (_drawRecords && renderer.Cullable && renderer.Mesh != nullptr && renderer.Billboard == nullptr && !renderer.Material->Pipeline.Blend &&
+			!(settings.QueryOcclusion && renderer.QueryOcclusion))
+		{
+			const uint32_t materialIndex = renderer.Material->GetMaterialIndex();
+			RecordKey& key = _recordKeys[ix];
+			if (key.Entity != entities[ix] || key.Version != worlds[ix].Version || key.MaterialIndex != materialIndex) {
+				key = { entities[ix], worlds[ix].Version, materialIndex };
+				bucket.Patch.push_back(ix);
+			}
+			renderer.LodLevel = 0;
+			if (bucket.GpuBatches.empty() ||
+				bucket.GpuBatches.back().Material != renderer.Material ||
+				bucket.GpuBatches.back().Mesh != renderer.Mesh ||
+				bucket.GpuBatches.back().BaseInstance + bucket.GpuBatches.back().InstanceCount != static_cast<int>(ix))
+			{
+				const BoundingVolume& meshBounds = renderer.Mesh->GetBounds();
+				DrawBatch batch = { renderer.Material, renderer.Mesh, static_cast<int>(ix), 0, settings.Records->GetBuffer() };
+				batch.GpuCulled = true;
+				batch.CullBounds = glm::vec4(meshBounds.Center, meshBounds.Radius);
+				batch.DrawRange = glm::vec2(0.0f, FLT_MAX);
+				bucket.GpuBatches.push_back(batch);
+			}
+			bucket.GpuBatches.back().InstanceCount++;
+			continue;
+		}
+		// Skip any renderers whose bounds are completely outside of every view
+		uint32_t views = allViews;
+		if (renderer.Cullable && settings.FrustumCulling) {
+			views = spatial.GetVisibleMask(entities[ix]);
+			if (views == 0) {
+				bucket.CulledCount++;
+				continue;
+			}
+		}
+		// And any whose bounds were hidden behind what got drawn last time we looked, which only covers our own view
+		if (renderer.Cullable && (views & 1u) != 0 && settings.Occlusion != nullptr && settings.Occlusion->IsOccluded(renderer.WorldBounds)) {
+			views &= ~1u;
+			if (views == 0) {
+				bucket.OccludedCount++;
+				continue;
+			}
+		}
+		// Past the start of it's impostor's fade range the renderer gets drawn as the impostor, and it's mesh stops
+		// getting drawn past the end of the range. In between the two get dithered against each other
+		if (renderer.Billboard != nullptr) {
+			const Impostor& impostor = *renderer.Billboard;
+			const float distance = glm::length(cameraPos - glm::vec3(worlds[ix].Model[3]));
+			bool drawImpostor = distance > impostor.GetFadeStart();
+			bool drawMesh = distance < impostor.GetFadeEnd();
+			if (drawImpostor && !impostor.GetMaterial()->IsPrepared()) {
+				// Until the impostor's shader is ready the mesh stands in for it
+				if (std::find(bucket.PendingMaterials.begin(), bucket.PendingMaterials.end(), impostor.GetMaterial()) == bucket.PendingMaterials.end()) {
+					bucket.PendingMaterials.push_back(impostor.GetMaterial());
+				}
+				drawImpostor = false;
+				drawMesh = true;
+			} else if (drawImpostor && drawMesh && _spareInstances.fetch_sub(1) <= 0) {
+				// There's no room left for both, so we draw whichever side of the fade is closer
+				drawMesh = distance < (impostor.GetFadeStart() + impostor.GetFadeEnd()) * 0.5f;
+				drawImpostor = !drawMesh;
+			}
+			if (drawImpostor) {
+				bucket.Impostors.push_back(ix);
+				bucket.ImpostorViews.push_back(static_cast<uint8_t>(views));
+			}
+			if (!drawMesh) {
+				continue;
+			}
+		}
+		// Pick the level of detail, the sort key follows the level so renderers at the same level still batch
+		// together from the next frame on
+		if (renderer.Cullable && settings.Lods) {
+			renderer.UpdateLod(cameraPos, settings.PixelsPerUnit, settings.LodPixelError);
+		} else {
+			renderer.LodLevel = 0;
+		}
+		bucket.LodCount += renderer.LodLevel > 0 ? 1 : 0;
+		// Blended renderers can't be drawn in sort key order, they get sorted by depth once every chunk is done. The
+		// farthest has the smallest view space Z, so it gets the smallest key. Order independent ones batch as usual
+		if (renderer.Material->Pipeline.Blend && !renderer.Material->Pipeline.OrderIndependent) {
+			const glm::vec3 position = worlds[ix].Model[3];
+			bucket.Transparent.push_back({ RadixSort::FloatToKey(glm::dot(viewZ, glm::vec4(position, 1.0f))), ix, views });
+			continue;
+		}
+		// Merge runs of renderers that share a material and mesh into a single batch (the sort keeps renderers with
+		// the same material next to each other). Renderers drawn conditionally on their occlusion queries get a batch
+		// of their own, the queries only cover our own view
+		const VertexArrayObject::sptr& mesh = renderer.GetLodMesh();
+		const uint32_t query = settings.QueryOcclusion && renderer.QueryOcclusion && renderer.Cullable && (views & 1u) != 0 ?
+			entt::to_integral(entities[ix]) : OcclusionQueries::NONE;
+		if (query != OcclusionQueries::NONE) {
+			bucket.QueryBoxes.push_back({ query, renderer.WorldBounds });
+		}
+		if (bucket.Batches.empty() ||
+			bucket.Batches.back().Material != renderer.Material ||
+			bucket.Batches.back().Mesh != mesh ||
+			bucket.Batches.back().Query != OcclusionQueries::NONE ||
+			query != OcclusionQueries::NONE)
+		{
+			bucket.Batches.push_back({ renderer.Material, mesh, static_cast<int>(bucket.Visible.size()), 0, nullptr, query });
+		}
+		bucket.Batches.back().InstanceCount++;
+		bucket.Visible.push_back(ix);
+		bucket.VisibleViews.push_back(static_cast<uint8_t>(views));
+	}
+
+	// The impostors all share a quad, so they get batched together after the chunk's meshes instead of breaking up
+	// the sorted runs
+	for (size_t impostorIx = 0; impostorIx < bucket.Impostors.size(); impostorIx++) {
+		const uint32_t ix = bucket.Impostors[impostorIx];
+		const Impostor& impostor = *renderers[ix].Billboard;
+		if (bucket.Batches.empty() ||
+			bucket.Batches.back().Material != impostor.GetMaterial() ||
+			bucket.Batches.back().Mesh != impostor.GetMesh() ||
+			bucket.Batches.back().Query != OcclusionQueries::NONE)
+		{
+			bucket.Batches.push_back({ impostor.GetMaterial(), impostor.GetMesh(), static_cast<int>(bucket.Visible.size()), 0 });
+		}
+		bucket.Batches.back().InstanceCount++;
+		bucket.Visible.push_back(ix | IMPOSTOR_BIT);
+		bucket.VisibleViews.push_back(bucket.ImpostorViews[impostorIx]);
+	}
+}
+
+int RenderSnapshotBuilder::_AddViewBatches(const Bucket& bucket, uint32_t view, int firstInstance, std::vector<DrawBatch>& batches) const {
+	const uint8_t bit = static_cast<uint8_t>(1u << view);
+	int result = 0;
+	for (const DrawBatch& batch : bucket.Batches) {
+		for (int ix = batch.BaseInstance; ix < batch.BaseInstance + batch.InstanceCount; ix++) {
+			if ((bucket.VisibleViews[ix] & bit) == 0) {
+				continue;
+			}
+			// Runs carry on for as long as the view can see the instances next to each other. Only our own view's
+			// batches get drawn conditionally, since that's the view the queries were drawn from
+			const int instance = firstInstance + ix;
+			const uint32_t query = view == 0 ? batch.Query : OcclusionQueries::NONE;
+			if (!batches.empty() &&
+				batches.back().Material == batch.Material &&
+				batches.back().Mesh == batch.Mesh &&
+				batches.back().BaseInstance + batches.back().InstanceCount == instance &&
+				batches.back().Query == OcclusionQueries::NONE &&
+				query == OcclusionQueries::NONE)
+			{
+				batches.back().InstanceCount++;
+			} else {
+				batches.push_back({ batch.Material, batch.Mesh, instance, 1, nullptr, query });
+			}
+			result++;
+		}
+	}
+	return result;
+}
+
+void RenderSnapshotBuilder::_WriteChunk(uint32_t chunk, RenderSnapshot& snapshot) {
+	const Bucket& bucket = _buckets[chunk];
+	const RendererComponent* renderers = _group.raw<RendererComponent>();
+	const WorldMatrix* worlds = _group.raw<WorldMatrix>();
+	// The region is write combined memory, so we only ever write to it front to back and never read it back
+	InstanceTransform* instances = static_cast<InstanceTransform*>(snapshot.Instances.Data) + bucket.First;
+	for (uint32_t entry : bucket.Visible) {
+		const uint32_t ix = entry & ~IMPOSTOR_BIT;
+		const ShaderMaterial::sptr& material = (entry & IMPOSTOR_BIT) != 0 ? renderers[ix].Billboard->GetMaterial() : renderers[ix].Material;
+		*instances++ = InstanceTransform(worlds[ix].Model, worlds[ix].Normal, material->GetMaterialIndex());
+	}
+	// Impostors belong to the renderer they stand in for
+	if (!snapshot.InstanceEntities.empty()) {
+		const entt::entity* entities = _group.data();
+		for (size_t ix = 0; ix < bucket.Visible.size(); ix++) {
+			snapshot.InstanceEntities[bucket.First + ix] = entities[bucket.Visible[ix] & ~IMPOSTOR_BIT];
+		}
+	}
+}
+
+int RenderSnapshotBuilder::_SplitWeighted(std::vector<DrawBatch>& batches, std::vector<DrawBatch>& weighted) {
+	// Compacted in place, so the rest keep their order without needing any scratch space
+	int result = 0;
+	size_t kept = 0;
+	for (size_t ix = 0; ix < batches.size(); ix++) {
+		if (batches[ix].Material->Pipeline.OrderIndependent) {
+			result += batches[ix].InstanceCount;
+			weighted.push_back(std::move(batches[ix]));
+		} else {
+			if (kept != ix) {
+				batches[kept] = std::move(batches[ix]);
+			}
+			kept++;
+		}
+	}
+	batches.erase(batches.begin() + kept, batches.end());
+	return result;
+}
+
+void RenderSnapshotBuilder::_GatherTransparent(RenderSnapshot& snapshot, uint32_t chunks) {
+	PROFILE_SCOPE("SortTransparent");
+	RendererComponent* renderers = _group.raw<RendererComponent>();
+	// Each renderer goes back into the spot it had last frame, and anything new goes on the end. The camera rarely
+	// moves far enough in a frame to change much of the order, so this is usually sorted already
+	const size_t previousCount = _transparent.size();
+	_transparent.assign(previousCount, { 0, UINT32_MAX, 0 });
+	_transparentScratch.clear();
+	for (uint32_t chunk = 0; chunk < chunks; chunk++) {
+		for (const TransparentEntry& entry : _buckets[chunk].Transparent) {
+			const uint32_t order = renderers[entry.Index].DepthOrder;
+			if (order < previousCount && _transparent[order].Index == UINT32_MAX) {
+				_transparent[order] = entry;
+			} else {
+				_transparentScratch.push_back(entry);
+			}
+		}
+	}
+	_transparent.erase(std::remove_if(_transparent.begin(), _transparent.end(), [](const TransparentEntry& entry) {
+		return entry.Index == UINT32_MAX;
+	}), _transparent.end());
+	_transparent.insert(_transparent.end(), _transparentScratch.begin(), _transparentScratch.end());
+	RadixSort::SortCoherent(_transparent, _transparentScratch);
+
+	// Renderers next to each other in the order can still share a draw, if they share a material and mesh
+	_transparentFirst = static_cast<uint32_t>(snapshot.InstanceCount);
+	auto addToBatches = [&](std::vector<DrawBatch>& batches, size_t ix) {
+		const RendererComponent& renderer = renderers[_transparent[ix].Index];
+		const VertexArrayObject::sptr& mesh = renderer.GetLodMesh();
+		const int instance = static_cast<int>(snapshot.Instances.First + _transparentFirst + ix);
+		if (batches.empty() ||
+			batches.back().Material != renderer.Material ||
+			batches.back().Mesh != mesh ||
+			batches.back().BaseInstance + batches.back().InstanceCount != instance)
+		{
+			batches.push_back({ renderer.Material, mesh, instance, 0 });
+		}
+		batches.back().InstanceCount++;
+	};
+	for (size_t ix = 0; ix < _transparent.size(); ix++) {
+		renderers[_transparent[ix].Index].DepthOrder = static_cast<uint32_t>(ix);
+		if ((_transparent[ix].Views & 1u) != 0) {
+			addToBatches(snapshot.TransparentBatches, ix);
+		}
+	}
+
+	// The other views can be looking from somewhere else entirely, so each one sorts what it can see by it's own
+	// depth. The instances are already in the region in our order, so only the batches are the view's own
+	const WorldMatrix* worlds = _group.raw<WorldMatrix>();
+	for (size_t view = 0; view < snapshot.Views.size(); view++) {
+		SnapshotView& target = snapshot.Views[view];
+		const uint32_t bit = 2u << view;
+		const glm::vec4 viewZ(target.Frame.View[0][2], target.Frame.View[1][2], target.Frame.View[2][2], target.Frame.View[3][2]);
+		_viewTransparent.clear();
+		for (size_t ix = 0; ix < _transparent.size(); ix++) {
+			if ((_transparent[ix].Views & bit) != 0) {
+				const glm::vec3 position = worlds[_transparent[ix].Index].Model[3];
+				_viewTransparent.push_back({ RadixSort::FloatToKey(glm::dot(viewZ, glm::vec4(position, 1.0f))), static_cast<uint32_t>(ix), bit });
+			}
+		}
+		RadixSort::Sort(_viewTransparent, _transparentScratch);
+		for (const TransparentEntry& entry : _viewTransparent) {
+			addToBatches(target.TransparentBatches, entry.Index);
+		}
+		target.VisibleCount += static_cast<int>(_viewTransparent.size());
+	}
+	snapshot.TransparentCount = static_cast<int>(_transparent.size());
+	snapshot.InstanceCount += snapshot.TransparentCount;
+	snapshot.VisibleCount += snapshot.TransparentCount;
+}
+
+void RenderSnapshotBuilder::_WriteTransparent(RenderSnapshot& snapshot) {
+	const RendererComponent* renderers = _group.raw<RendererComponent>();
+	const WorldMatrix* worlds = _group.raw<WorldMatrix>();
+	InstanceTransform* instances = static_cast<InstanceTransform*>(snapshot.Instances.Data) + _transparentFirst;
+	for (const TransparentEntry& entry : _transparent) {
+		*instances++ = InstanceTransform(worlds[entry.Index].Model, worlds[entry.Index].Normal, renderers[entry.Index].Material->GetMaterialIndex());
+	}
+	if (!snapshot.InstanceEntities.empty()) {
+		const entt::entity* entities = _group.data();
+		for (size_t ix = 0; ix < _transparent.size(); ix++) {
+			snapshot.InstanceEntities[_transparentFirst + ix] = entities[_transparent[ix].Index];
+		}
+	}
+}
+
+void RenderSnapshotBuilder::_Sort() {
+	PROFILE_SCOPE("Sort");
+	// Sort the renderers by shader and material, we will go for a minimizing context switches approach here, but you
+	// could for instance sort front to back to optimize for fill rate if you have intensive fragment shaders
+	// The order is baked into each renderer's sort key, which only gets rebuilt when it's mesh or material changes
+	std::atomic<bool> needsSort = _group.size() != _sortedCount;
+	RendererComponent* renderers = _group.raw<RendererComponent>();
+	ThreadPool::Instance().ParallelFor(_group.size(), CHUNK_SIZE, [&](size_t begin, size_t end) {
+		bool changed = false;
+		for (size_t ix = begin; ix < end; ix++) {
+			changed |= renderers[ix].UpdateSortKey();
+		}
+		if (changed) {
+			needsSort = true;
+		}
+	});
+	// The group stays in order between frames, so we only need a pass when something changed. Since only a few keys
+	// change at a time the group is nearly sorted, which is the best case for insertion sort
+	if (needsSort) {
+		_group.sort<RendererComponent>([](const RendererComponent& l, const RendererComponent& r) {
+			return l.SortKey < r.SortKey;
+		}, entt::insertion_sort{});
+		_sortedCount = _group.size();
+	}
+}
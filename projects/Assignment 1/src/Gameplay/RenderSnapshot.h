@@ -0,0 +1,357 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <entt.hpp>
+
+#include "Graphics/DepthPyramid.h"
+#include "Graphics/Frustum.h"
+#include "Graphics/InstanceStream.h"
+#include "Graphics/OcclusionQueries.h"
+#include "Graphics/RenderRecords.h"
+#include "Graphics/ShadowMaps.h"
+#include "Graphics/UniformBlocks.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Light.h"
+#include "RendererComponent.h"
+#include "Scatter.h"
+#include "Scene.h"
+#include "ShaderMaterial.h"
+#include "StaticBatcher.h"
+#include "Terrain.h"
+#include "Transform.h"
+#include "Utilities/VertexTypes.h"
+
+/// <summary>
+/// Represents a run of renderers that share the same material and mesh, and can be drawn with a single instanced call
+/// </summary>
+struct DrawBatch {
+	// The material that all instances in the batch use
+	ShaderMaterial::sptr    Material;
+	// The mesh that all instances in the batch use
+	VertexArrayObject::sptr Mesh;
+	// The index of the batch's first element in the instance buffer
+	int                     BaseInstance;
+	// The number of instances in the batch
+	int                     InstanceCount;
+	// Where the instances come from if not the snapshot's instance region (ex: a ScatterComponent's instances)
+	VertexBuffer::sptr      Instances = nullptr;
+	// The key of the occlusion query the batch is drawn conditionally on, these batches only ever hold one renderer.
+	// OcclusionQueries::NONE for batches that always get drawn
+	uint32_t                Query = OcclusionQueries::NONE;
+	// Batches that are culled instance by instance on the GPU (see InstanceCuller) rather than by the snapshot. Each
+	// instance's bounding sphere in it's own space, and the distances from the camera that the instances get drawn
+	// between. Drawn without culling, every instance is drawn
+	bool                    GpuCulled = false;
+	glm::vec4               CullBounds = glm::vec4(0.0f);
+	glm::vec2               DrawRange = glm::vec2(0.0f);
+};
+
+/// <summary>
+/// One of the extra views a snapshot can be built for (ex: a second player's half of the screen, a mirror or a probe
+/// face). It shares the snapshot's culling, sorting and instances, so only it's frame uniforms and the runs of
+/// instances it can see are it's own
+/// </summary>
+struct SnapshotView {
+	// The camera data for the view, filled in before the snapshot is built
+	FrameData              Frame;
+	// The view's volume, filled in before the snapshot is built
+	Frustum                ViewFrustum;
+	// The runs of the snapshot's instances that this view can see, in draw order
+	std::vector<DrawBatch> Batches;
+	// The runs of blended instances this view can see, back to front from this view
+	std::vector<DrawBatch> TransparentBatches;
+	// The runs of order independent blended instances this view can see (see WeightedBlending)
+	std::vector<DrawBatch> WeightedBatches;
+	int                    VisibleCount = 0;
+};
+
+/// <summary>
+/// Everything needed to draw one frame of a scene, captured from the scene so that it can be drawn without touching
+/// the registry. The simulation fills in a new one each frame while the last one gets drawn
+/// </summary>
+struct RenderSnapshot {
+	// The most views a snapshot can be built for, counting it's own
+	static const uint32_t MAX_VIEWS = 8;
+
+	// The camera data for the frame, uploaded to the frame uniforms before drawing
+	FrameData                      Frame;
+	// The camera's view volume, for culling anything finer grained than a renderer (ex: meshlets)
+	Frustum                        ViewFrustum;
+	// Where the per instance data gets written in draw order, this needs to be acquired before the snapshot is built
+	// and released once it has been drawn
+	InstanceStream::Region            Instances;
+	// The runs of instances that can be drawn together, in draw order. Their base instances already include the
+	// start of the instance region
+	std::vector<DrawBatch>            Batches;
+	// The runs of instances whose materials blend, back to front. These get drawn after everything else in the scene
+	std::vector<DrawBatch>            TransparentBatches;
+	// The runs of instances whose materials blend without sorting (see PipelineState::OrderIndependent), in the same
+	// order as the opaque ones. These get drawn into WeightedBlending's targets once the opaque scene is done
+	std::vector<DrawBatch>            WeightedBatches;
+	// The materials that renderers were skipped for because their shaders are still compiling (or haven't been
+	// looked up in yet), these need to be prepared on the main thread before they can be drawn
+	std::vector<ShaderMaterial::sptr> PendingMaterials;
+	// The materials of renderers in the predicted view (see RenderSnapshotSettings::PredictedViewProjection), their
+	// textures should be marked as used so any placeholders start loading before they come into view
+	std::vector<ShaderMaterial::sptr> UpcomingMaterials;
+	// The lights that reach into the view, ready to upload to the light buffer
+	std::vector<LightData>            Lights;
+	// The bounds of the renderers with QueryOcclusion set that the snapshot's own view can see, to be queried once
+	// the opaque scene has been drawn
+	std::vector<OcclusionQueries::Box> QueryBoxes;
+	// The renderers to draw into the shadow maps, empty if shadows are turned off
+	ShadowCasterSet                   Shadows;
+	// Any other views to draw the snapshot from, each one's Frame and ViewFrustum should be filled in before it's
+	// built. Levels of detail, impostor fades, occlusion and shadows all follow the snapshot's own view
+	std::vector<SnapshotView>         Views;
+	// The renderers' records that changed, to apply to RenderSnapshotSettings::Records before the snapshot is drawn
+	RenderRecordPatch                 RecordPatch;
+	// Only filled in with RenderSnapshotSettings::GatherEntities, for working out what was drawn where (see GpuPicker).
+	// The entity each of the renderers' instances belongs to, from the start of the instance region (scatters and
+	// terrains are left out), and the entity in each slot of the records
+	std::vector<entt::entity>         InstanceEntities;
+	std::vector<entt::entity>         RecordEntities;
+
+	int InstanceCount = 0;
+	// Everything that any of the views can see
+	int VisibleCount = 0;
+	int CulledCount  = 0;
+	int OccludedCount = 0;
+	int PendingCount = 0;
+	int LodCount     = 0;
+	int TransparentCount = 0;
+	int WeightedCount = 0;
+	// The renderers drawn as impostors, including the ones fading between the two
+	int ImpostorCount = 0;
+	// The instances drawn out of scatters, the ones drawn as impostors, and the number of cells they were culled in
+	int ScatterCount = 0;
+	int ScatterImpostorCount = 0;
+	int ScatterCellCount = 0;
+	// The renderers handed over to be culled on the GPU, out of the records
+	int GpuCulledCount = 0;
+	// The terrain nodes drawn, across all of the views
+	int TerrainPatchCount = 0;
+	int CulledLightCount = 0;
+
+	/// <summary>
+	/// Empties the snapshot's draws, keeping their storage around for the next frame. The views stay, but lose their
+	/// draws too
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// Gets the volume of one of the views, 0 for the snapshot's own and N for Views[N - 1]
+	/// </summary>
+	const Frustum& GetViewFrustum(size_t view) const { return view == 0 ? ViewFrustum : Views[view - 1].ViewFrustum; }
+	/// <summary>
+	/// Gets the batches of one of the views, 0 for the snapshot's own and N for Views[N - 1]
+	/// </summary>
+	std::vector<DrawBatch>& GetViewBatches(size_t view) { return view == 0 ? Batches : Views[view - 1].Batches; }
+	/// <summary>
+	/// Checks whether a world space volume reaches into any of the views
+	/// </summary>
+	bool IsInAnyView(const BoundingVolume& bounds) const;
+};
+
+/// <summary>
+/// The settings a RenderSnapshot gets built with, copied into the build so the UI can change them mid frame
+/// </summary>
+struct RenderSnapshotSettings {
+	bool  FrustumCulling = true;
+	bool  Lods = true;
+	// The most a level of detail may move the surface on screen, in pixels
+	float LodPixelError = 1.0f;
+	// The size in pixels of something one unit across, one unit in front of the camera
+	float PixelsPerUnit = 1.0f;
+	// Whether to gather shadow casters and hand out shadow maps to the lights
+	bool  Shadows = true;
+	// What was drawn a few frames ago, renderers hidden behind it get skipped. Null to skip occlusion culling
+	OcclusionMap::sptr Occlusion = nullptr;
+	// Whether renderers with QueryOcclusion set get their own batches, drawn conditionally on their queries. If not
+	// they batch like everything else
+	bool  QueryOcclusion = false;
+	// Whether scatters are culled and given levels of detail instance by instance on the GPU in the snapshot's own
+	// view, rather than cell by cell here. Their batches cover every instance, and are marked GpuCulled
+	bool  GpuCulling = false;
+	// Where the renderers' records live, if set (and GpuCulling is) the opaque renderers are culled on the GPU too,
+	// drawn straight out of the records. Only for snapshots without extra views
+	RenderRecords::sptr Records = nullptr;
+	// Whether to send every record again, because the records missed a patch (see RenderRecords::IsStale)
+	bool  RefreshRecords = false;
+	// Where the view is expected to be a little while from now, the materials of everything in it get handed back
+	// in UpcomingMaterials. Only used if PredictView is set
+	bool      PredictView = false;
+	glm::mat4 PredictedViewProjection = glm::mat4(1.0f);
+	// Whether to fill in the snapshot's InstanceEntities and RecordEntities
+	bool      GatherEntities = false;
+};
+
+/// <summary>
+/// Sorts, culls and gathers a scene's renderers into a RenderSnapshot. Building reads the registry and writes to the
+/// renderers (their sort keys and levels of detail) and the spatial index's culling results, but makes no OpenGL
+/// calls, so it can run on a worker while the main thread is drawing the previous snapshot. Nothing else may touch
+/// the renderers, transforms or spatial index while a build is running
+///
+/// The render group gets split into chunks that are culled and batched across the thread pool, each into a bucket
+/// of it's own. The buckets are stitched together in order (the group is kept sorted, so this is all the sorting the
+/// opaque renderers need), then each chunk writes it's instances straight into the snapshot's mapped instance region
+///
+/// Renderers whose materials blend need drawing back to front instead, so they get pulled out of the chunks and sorted
+/// by their depth in the view. Their order carries over between frames, which keeps that sort cheap. Ones whose
+/// materials are order independent (see WeightedBlending) skip that, and batch along with the opaque renderers
+///
+/// Snapshots with extra views get culled against all of them in one walk of the BVH, which hands back a mask of the
+/// views each renderer is in. Everything any view can see gets it's instance written once, and each view gets batches
+/// over just the instances it can see. Blended renderers are sorted again for each extra view, by their depth in it
+/// </summary>
+class RenderSnapshotBuilder final
+{
+public:
+	// The group owns the world matrices along with the renderers, so both are packed in the same order
+	typedef entt::basic_group<entt::entity, entt::exclude_t<>, entt::get_t<>, RendererComponent, WorldMatrix> RenderGroup;
+	typedef entt::basic_view<entt::entity, entt::exclude_t<>, Light, Transform> LightView;
+	typedef entt::basic_view<entt::entity, entt::exclude_t<>, StaticTag> StaticView;
+	typedef entt::basic_view<entt::entity, entt::exclude_t<>, ScatterComponent> ScatterView;
+	typedef entt::basic_view<entt::entity, entt::exclude_t<>, TerrainComponent> TerrainView;
+
+	/// <summary>
+	/// Creates a builder for a scene, this needs to happen on the main thread since it may create the render group
+	/// </summary>
+	/// <param name="scene">The scene to draw, must outlive the builder</param>
+	explicit RenderSnapshotBuilder(GameScene& scene);
+
+	RenderSnapshotBuilder(const RenderSnapshotBuilder& other) = delete;
+	RenderSnapshotBuilder& operator=(const RenderSnapshotBuilder& other) = delete;
+
+	/// <summary>
+	/// The number of renderers in each chunk that gets handed to a worker
+	/// </summary>
+	static const uint32_t CHUNK_SIZE = 512;
+
+	/// <summary>
+	/// Fills in a snapshot's draws and lights from the scene, the snapshot's Frame and ViewFrustum should already be filled
+	/// in (ex: from the Camera) since the camera position and view volume are taken from them, and it's instance region
+	/// needs room for every renderer in the group.
+	/// Renderers fading over to their impostors take two instances, any room past the group's size and the terrain's
+	/// (see GetTerrainCapacity) goes to those, and the rest get drawn as whichever side of the fade they're closest to
+	/// </summary>
+	/// <param name="snapshot">The snapshot to fill, any draws already in it will be cleared</param>
+	/// <param name="settings">The culling and level of detail settings to build with</param>
+	void Build(RenderSnapshot& snapshot, const RenderSnapshotSettings& settings);
+
+	/// <summary>
+	/// Gets the group of renderers that get drawn
+	/// </summary>
+	RenderGroup& GetGroup() { return _group; }
+	/// <summary>
+	/// Gets the room the terrains need in a snapshot's instance region, on top of the group's
+	/// </summary>
+	/// <param name="viewCount">The number of views the snapshot gets built for, counting it's own</param>
+	uint32_t GetTerrainCapacity(uint32_t viewCount) const {
+		return static_cast<uint32_t>(_terrains.size()) * TerrainComponent::MAX_PATCHES * viewCount;
+	}
+
+private:
+	// Marks the entries in a bucket's visible list that draw the renderer's impostor instead of it's mesh
+	static const uint32_t IMPOSTOR_BIT = 0x80000000u;
+
+	// A blended renderer, and it's depth in the view as a key that sorts back to front
+	struct TransparentEntry {
+		uint32_t Key;
+		uint32_t Index;
+		// The views that can see the renderer, bit 0 for the snapshot's own and bit N for Views[N - 1]
+		uint32_t Views;
+	};
+
+	// What a single chunk of the group found, before the chunks get stitched together
+	struct Bucket {
+		// The positions in the group of the renderers that will be drawn, with IMPOSTOR_BIT set for impostors
+		std::vector<uint32_t>             Visible;
+		// The positions of the renderers whose impostors get drawn, these go after the rest of the chunk
+		std::vector<uint32_t>             Impostors;
+		// The views that can see each entry in Visible and Impostors, bit 0 for the snapshot's own
+		std::vector<uint8_t>              VisibleViews;
+		std::vector<uint8_t>              ImpostorViews;
+		// The chunk's batches, with base instances relative to the chunk's first visible renderer
+		std::vector<DrawBatch>            Batches;
+		std::vector<ShaderMaterial::sptr> PendingMaterials;
+		// The chunk's blended renderers, these get sorted along with every other chunk's
+		std::vector<TransparentEntry>     Transparent;
+		// The chunk's renderers that get drawn conditionally on their occlusion queries
+		std::vector<OcclusionQueries::Box> QueryBoxes;
+		// The chunk's batches that draw out of the records and get culled on the GPU, with base instances that are
+		// positions in the group, and the positions of the records that changed
+		std::vector<DrawBatch>            GpuBatches;
+		std::vector<uint32_t>             Patch;
+		// Where the chunk's instances start in the snapshot, once the buckets have been stitched together
+		uint32_t                          First = 0;
+		int                               CulledCount = 0;
+		int                               OccludedCount = 0;
+		int                               PendingCount = 0;
+		int                               LodCount = 0;
+	};
+
+	GameScene&          _scene;
+	RenderGroup         _group;
+	LightView           _lights;
+	StaticView          _statics;
+	ScatterView         _scatters;
+	TerrainView         _terrains;
+	// The static shadow casters, and what they were built from. The list is shared with the snapshots, so it gets
+	// replaced rather than changed when something static moves
+	std::shared_ptr<std::vector<ShadowCaster>> _staticCasters;
+	uint64_t            _staticSignature;
+	uint64_t            _staticVersion;
+	// The number of renderers in the render group the last time we sorted it
+	size_t              _sortedCount;
+	// Kept between frames so the chunks don't need to allocate once they've warmed up
+	std::vector<Bucket> _buckets;
+	// The instances left in the snapshot's region for renderers that draw both their mesh and their impostor
+	std::atomic<int>    _spareInstances;
+	// The blended renderers in back to front order, kept so the next frame can start from it
+	std::vector<TransparentEntry> _transparent;
+	std::vector<TransparentEntry> _transparentScratch;
+	// The blended renderers one of the extra views can see, sorted for that view
+	std::vector<TransparentEntry> _viewTransparent;
+	// Where the blended renderers' instances start in the snapshot's region
+	uint32_t            _transparentFirst;
+
+	// What each record was last written from, so only the ones that changed get patched
+	struct RecordKey {
+		entt::entity Entity;
+		uint32_t     Version;
+		uint32_t     MaterialIndex;
+	};
+	std::vector<RecordKey> _recordKeys;
+	uint32_t            _recordCapacity;
+	uint64_t            _recordSequence;
+	// Whether the records matched the keys as of the last build, and whether this build draws out of them
+	bool                _recordsValid;
+	bool                _drawRecords;
+
+	// Sorts the renderers by their sort keys, if any of them changed
+	void _Sort();
+	// Culls and batches one chunk of the group into it's bucket
+	void _GatherChunk(uint32_t chunk, const RenderSnapshot& snapshot, const RenderSnapshotSettings& settings);
+	// Writes the instances of one chunk into the snapshot's instance region
+	void _WriteChunk(uint32_t chunk, RenderSnapshot& snapshot);
+	// Adds the runs of a chunk's instances that one of the views can see to that view's batches, returning how many
+	// instances it can see
+	int _AddViewBatches(const Bucket& bucket, uint32_t view, int firstInstance, std::vector<DrawBatch>& batches) const;
+	// Moves the batches whose materials blend without sorting out of a view's batches, returning how many instances
+	// they hold
+	static int _SplitWeighted(std::vector<DrawBatch>& batches, std::vector<DrawBatch>& weighted);
+	// Sorts the chunks' blended renderers back to front, and batches them after the rest of the chunks
+	void _GatherTransparent(RenderSnapshot& snapshot, uint32_t chunks);
+	// Writes the instances of the blended renderers into the snapshot's instance region
+	void _WriteTransparent(RenderSnapshot& snapshot);
+	// Gathers the lights whose range reaches into the view, and hands out the shadow maps to them
+	void _GatherLights(RenderSnapshot& snapshot, const RenderSnapshotSettings& settings);
+	// Gathers the renderers that get drawn into the shadow maps, rebuilding the static list if anything static changed
+	void _GatherShadowCasters(RenderSnapshot& snapshot);
+	// Culls the scatters' cells and adds batches for the ones that survive, straight out of their instance buffers
+	void _GatherScatters(RenderSnapshot& snapshot, const RenderSnapshotSettings& settings);
+	// Picks the terrains' nodes for each view, and writes their instances after everything else
+	void _GatherTerrains(RenderSnapshot& snapshot);
+};
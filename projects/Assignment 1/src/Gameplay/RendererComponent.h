@@ -1,12 +1,119 @@
 #pragma once
+#include <cstdint>
 #include "Graphics/VertexArrayObject.h"
 #include "Gameplay/ShaderMaterial.h"
+#include "Gameplay/Impostor.h"
 
 class RendererComponent {
 public:
 	VertexArrayObject::sptr Mesh;
 	ShaderMaterial::sptr    Material;
+	// Whether this renderer can be skipped when it's outside of the camera's view (ex: skyboxes should disable this)
+	bool                    Cullable = true;
+	// The world space bounds of the mesh, updated each frame during culling
+	BoundingVolume          WorldBounds;
+	// Packed key that renderers get sorted by, from most to least significant: layer | shader | material | mesh
+	uint64_t                SortKey = 0;
+	// The level of detail that gets drawn, 0 is the full mesh and anything higher picks from the mesh's LODs
+	int                     LodLevel = 0;
+	// Drawn in place of the mesh past the impostor's fade range, null to always draw the mesh
+	Impostor::sptr          Billboard;
+	// Where a blended renderer came in last frame's back to front order, so the next sort starts out nearly sorted
+	uint32_t                DepthOrder = UINT32_MAX;
+	// Whether the mesh only gets drawn if it's bounds passed a hardware occlusion query last frame (see
+	// OcclusionQueries). Each query costs a draw of it's own, so this is for the few meshes that are expensive to draw
+	bool                    QueryOcclusion = false;
 
 	RendererComponent& SetMesh(const VertexArrayObject::sptr& mesh) { Mesh = mesh; return *this; }
 	RendererComponent& SetMaterial(const ShaderMaterial::sptr& material) { Material = material; return *this; }
+	RendererComponent& SetCullable(bool cullable) { Cullable = cullable; return *this; }
+	RendererComponent& SetQueryOcclusion(bool query) { QueryOcclusion = query; return *this; }
+
+	/// <summary>
+	/// Gets the mesh for the current level of detail
+	/// </summary>
+	const VertexArrayObject::sptr& GetLodMesh() const {
+		if (LodLevel == 0 || Mesh == nullptr || static_cast<size_t>(LodLevel) > Mesh->GetLods().size()) {
+			return Mesh;
+		}
+		return Mesh->GetLods()[LodLevel - 1].Mesh;
+	}
+
+	/// <summary>
+	/// Picks the coarsest level of detail whose error stays under the given number of pixels on screen, using the
+	/// world bounds to work out how big the mesh is. A coarser level only replaces the current one once it's error
+	/// is a bit under the limit, so renderers sitting right at a threshold don't pop back and forth between levels
+	/// </summary>
+	/// <param name="cameraPos">The position of the camera in world space</param>
+	/// <param name="pixelsPerUnit">The size in pixels of something one unit across, one unit in front of the camera</param>
+	/// <param name="maxPixelError">The most the surface may move on screen, in pixels</param>
+	/// <returns>True if the level changed</returns>
+	bool UpdateLod(const glm::vec3& cameraPos, float pixelsPerUnit, float maxPixelError) {
+		const std::vector<VertexArrayObject::Lod>& lods = Mesh->GetLods();
+		if (lods.empty()) {
+			const bool changed = LodLevel != 0;
+			LodLevel = 0;
+			return changed;
+		}
+		// Lod errors are relative to the mesh's size, which the bounding sphere's diameter covers
+		const float distance = glm::max(glm::length(WorldBounds.Center - cameraPos) - WorldBounds.Radius, 1e-3f);
+		const float pixelsPerError = WorldBounds.Radius * 2.0f * pixelsPerUnit / distance;
+
+		int level = 0;
+		for (size_t ix = 0; ix < lods.size(); ix++) {
+			const int candidate = static_cast<int>(ix) + 1;
+			// Levels coarser than the current one have to clear a lower bar than the ones we're already using
+			const float limit = candidate > LodLevel ? maxPixelError * LOD_HYSTERESIS : maxPixelError;
+			if (lods[ix].Error * pixelsPerError > limit) {
+				break;
+			}
+			level = candidate;
+		}
+		const bool changed = level != LodLevel;
+		LodLevel = level;
+		return changed;
+	}
+
+	/// <summary>
+	/// Recalculates the sort key if the mesh, material, or the material's layer, pipeline state or shader have changed
+	/// since the last call
+	/// </summary>
+	/// <returns>True if the sort key changed and the renderers need to be re-sorted</returns>
+	bool UpdateSortKey() {
+		if (GetLodMesh().get() == _keyMesh && Material.get() == _keyMaterial && 
+			Material->RenderLayer == _keyLayer && Material->Shader.get() == _keyShader &&
+			Material->Pipeline.GetSortKey() == _keyPipeline) {
+			return false;
+		}
+		_keyMesh = GetLodMesh().get();
+		_keyMaterial = Material.get();
+		_keyLayer = Material->RenderLayer;
+		_keyShader = Material->Shader.get();
+		_keyPipeline = Material->Pipeline.GetSortKey();
+
+		// Bias the layer so negative layers still sort before positive ones
+		uint64_t layer  = static_cast<uint64_t>(glm::clamp(_keyLayer + 128, 0, 255));
+		// Within a layer, draws are grouped by their fixed function state first since that's the priciest to switch
+		uint64_t pipeline = _keyPipeline;
+		uint64_t shader = _keyShader != nullptr ? _keyShader->GetHandle() & 0xFFF : 0;
+		uint64_t material = Material->GetId() & 0xFFFF;
+		// Meshes that share a vertex layout sit next to each other, so drawing them never switches VAOs
+		uint64_t mesh = ((GetLodMesh()->GetHandle() & 0xFF) << 12) | (GetLodMesh()->GetId() & 0xFFF);
+		uint64_t key = (layer << 56) | (pipeline << 48) | (shader << 36) | (material << 20) | mesh;
+
+		bool changed = key != SortKey;
+		SortKey = key;
+		return changed;
+	}
+
+protected:
+	// How far under the error limit a coarser level has to be before we switch to it
+	static constexpr float LOD_HYSTERESIS = 0.75f;
+
+	// The state that the sort key was last built from
+	const VertexArrayObject* _keyMesh = nullptr;
+	const ShaderMaterial*    _keyMaterial = nullptr;
+	const Shader*            _keyShader = nullptr;
+	int                      _keyLayer = 0;
+	uint8_t                  _keyPipeline = 0;
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// How a rigid body takes part in the simulation
+/// </summary>
+enum class RigidBodyType : uint8_t {
+	// Never moves, static bodies get merged into compound shapes with their neighbours
+	Static,
+	// Moved by the simulation, which writes it back into the transform
+	Dynamic,
+	// Moved by gameplay, the simulation follows the transform and pushes dynamic bodies out of the way
+	Kinematic
+};
+
+/// <summary>
+/// The shape of a rigid body's collider, in the entity's local space (the transform's scale gets applied on top)
+/// </summary>
+enum class ColliderType : uint8_t {
+	Box,
+	Sphere,
+	// A cylinder with rounded ends, running along the local Z axis
+	Capsule,
+	// A convex hull around the model in Mesh, any type of body can use one
+	ConvexHull,
+	// The triangles of the model in Mesh, these can only be used by static bodies (other types get a hull instead)
+	TriangleMesh
+};
+
+/// <summary>
+/// Gives an entity a body in it's scene's PhysicsWorld. The simulation works in world space and writes straight into
+/// the local position and rotation, so rigid bodies should be on transforms without a parent. Dynamic bodies should
+/// usually have an InterpolatedTransform as well, since they only move on the fixed steps
+///
+/// Copying a rigid body only copies it's settings, the copy gets a body of it's own once it's in a world
+/// </summary>
+struct RigidBody
+{
+	RigidBodyType Type        = RigidBodyType::Dynamic;
+	ColliderType  Collider    = ColliderType::Box;
+	// Half the size of a box collider along each axis
+	glm::vec3     HalfExtents = glm::vec3(0.5f);
+	// The radius of a sphere or capsule collider
+	float         Radius      = 0.5f;
+	// The length of a capsule's straight section, not counting the rounded ends
+	float         Height      = 1.0f;
+	// The path of the model for hull and triangle mesh colliders, see CollisionCook
+	std::string   Mesh;
+	// Only used by dynamic bodies, the other types act as if they're infinitely heavy
+	float         Mass        = 1.0f;
+	float         Friction    = 0.5f;
+	float         Restitution = 0.0f;
+
+	/// <summary>
+	/// Marks a rigid body that hasn't been given a body by a PhysicsWorld
+	/// </summary>
+	static const uint32_t INVALID_SLOT = UINT32_MAX;
+
+	RigidBody() = default;
+	RigidBody(const RigidBody& other) { _CopySettings(other); }
+	RigidBody(RigidBody&& other) = default;
+	// Replacing a rigid body keeps it's body, the world rebuilds it with the new settings
+	RigidBody& operator=(const RigidBody& other) { _CopySettings(other); return *this; }
+	RigidBody& operator=(RigidBody&& other) = default;
+
+	/// <summary>
+	/// Gets the rigid body's slot in the PhysicsWorld that owns it's body, or INVALID_SLOT
+	/// </summary>
+	uint32_t GetSlot() const { return _slot; }
+
+	template <typename Archive>
+	void serialize(Archive& archive) {
+		archive(Type, Collider, HalfExtents, Radius, Height, Mesh, Mass, Friction, Restitution);
+	}
+
+private:
+	friend class PhysicsWorld;
+	uint32_t _slot = INVALID_SLOT;
+
+	void _CopySettings(const RigidBody& other) {
+		Type = other.Type;
+		Collider = other.Collider;
+		HalfExtents = other.HalfExtents;
+		Radius = other.Radius;
+		Height = other.Height;
+		Mesh = other.Mesh;
+		Mass = other.Mass;
+		Friction = other.Friction;
+		Restitution = other.Restitution;
+	}
+};
@@ -0,0 +1,199 @@
+#include "Scatter.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <GLM/gtc/constants.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+#include "Graphics/GpuResources.h"
+#include "Logging.h"
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/VertexTypes.h"
+
+// The number of candidates tried around each point before it's retired, the usual choice for Bridson's algorithm
+static const int CANDIDATES = 30;
+
+// PCG hash, gives each instance it's own random numbers without a generator to share between threads
+static uint32_t Hash(uint32_t value) {
+	const uint32_t state = value * 747796405u + 2891336453u;
+	const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+// Turns a hash into a float from 0 to 1
+static float HashToFloat(uint32_t hash) {
+	return static_cast<float>(hash >> 8) * (1.0f / 16777216.0f);
+}
+
+// The shortest offset between two points on a tile that wraps around at it's edges
+static glm::vec2 WrappedOffset(const glm::vec2& a, const glm::vec2& b, float size) {
+	glm::vec2 offset = glm::abs(a - b);
+	return glm::min(offset, glm::vec2(size) - offset);
+}
+
+// Bridson's algorithm over a square tile that wraps around at it's edges, so copies of the tile laid side by side
+// still keep every pair of points at least the spacing apart
+// See https://www.cs.ubc.ca/~rbridson/docs/bridson-siggraph07-poissondisk.pdf
+static std::vector<glm::vec2> SampleTile(float size, float spacing, uint32_t seed) {
+	// Each grid square is small enough to only ever hold a single point
+	const int gridSize = static_cast<int>(std::ceil(size * glm::root_two<float>() / spacing));
+	const float squareSize = size / gridSize;
+	std::vector<int> grid(static_cast<size_t>(gridSize) * gridSize, -1);
+	std::vector<glm::vec2> points;
+	std::vector<int> active;
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	auto add = [&](const glm::vec2& point) {
+		const int x = std::min(static_cast<int>(point.x / squareSize), gridSize - 1);
+		const int y = std::min(static_cast<int>(point.y / squareSize), gridSize - 1);
+		grid[y * gridSize + x] = static_cast<int>(points.size());
+		active.push_back(static_cast<int>(points.size()));
+		points.push_back(point);
+	};
+	auto isFree = [&](const glm::vec2& point) {
+		const int x = std::min(static_cast<int>(point.x / squareSize), gridSize - 1);
+		const int y = std::min(static_cast<int>(point.y / squareSize), gridSize - 1);
+		// The spacing covers just under two grid squares, so checking two each way catches every neighbour
+		for (int dy = -2; dy <= 2; dy++) {
+			for (int dx = -2; dx <= 2; dx++) {
+				const int other = grid[((y + dy + gridSize) % gridSize) * gridSize + (x + dx + gridSize) % gridSize];
+				if (other != -1 && glm::length(WrappedOffset(point, points[other], size)) < spacing) {
+					return false;
+				}
+			}
+		}
+		return true;
+	};
+
+	add(glm::vec2(unit(random), unit(random)) * size);
+	while (!active.empty()) {
+		const size_t slot = static_cast<size_t>(unit(random) * active.size()) % active.size();
+		const glm::vec2 center = points[active[slot]];
+		bool found = false;
+		for (int ix = 0; ix < CANDIDATES && !found; ix++) {
+			// Somewhere in the ring between one and two spacings away, wrapped back onto the tile
+			const float angle = unit(random) * glm::two_pi<float>();
+			const float distance = spacing * (1.0f + unit(random));
+			glm::vec2 candidate = center + glm::vec2(std::cos(angle), std::sin(angle)) * distance;
+			candidate -= glm::floor(candidate / size) * size;
+			if (isFree(candidate)) {
+				add(candidate);
+				found = true;
+			}
+		}
+		if (!found) {
+			active[slot] = active.back();
+			active.pop_back();
+		}
+	}
+	return points;
+}
+
+bool ScatterComponent::Update() {
+	if (Mesh == nullptr || Material == nullptr || !Material->IsPrepared()) {
+		return false;
+	}
+	if (!_isDirty && _builtMesh == Mesh.get() && _builtMaterialIndex == Material->GetMaterialIndex()) {
+		return false;
+	}
+	_Generate();
+	_isDirty = false;
+	_builtMesh = Mesh.get();
+	_builtMaterialIndex = Material->GetMaterialIndex();
+	return true;
+}
+
+bool ScatterComponent::_IsExcluded(const glm::vec2& position) const {
+	for (const ScatterExclusion& exclusion : Exclusions) {
+		if (position.x >= exclusion.Min.x && position.y >= exclusion.Min.y && position.x <= exclusion.Max.x && position.y <= exclusion.Max.y) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void ScatterComponent::_Generate() {
+	GPU_RESOURCE_OWNER("Scatter");
+	PROFILE_SCOPE("Scatter");
+	_cells.clear();
+	_instanceCount = 0;
+	if (Spacing <= 0.0f) {
+		LOG_WARN("Can't scatter instances without a spacing");
+		return;
+	}
+
+	// The tile only needs sampling once, then each cell picks out it's part of it
+	const float cellSize = Spacing * CELL_SPACINGS;
+	const float tileSize = cellSize * TILE_CELLS;
+	std::vector<std::vector<glm::vec2>> tileCells(TILE_CELLS * TILE_CELLS);
+	for (const glm::vec2& point : SampleTile(tileSize, Spacing, Seed)) {
+		const int x = std::min(static_cast<int>(point.x / cellSize), TILE_CELLS - 1);
+		const int y = std::min(static_cast<int>(point.y / cellSize), TILE_CELLS - 1);
+		tileCells[y * TILE_CELLS + x].push_back(point - glm::vec2(x, y) * cellSize);
+	}
+
+	const glm::vec2 size = glm::max(RegionMax - RegionMin, glm::vec2(0.0f));
+	const int cellsX = std::max(static_cast<int>(std::ceil(size.x / cellSize)), 1);
+	const int cellsY = std::max(static_cast<int>(std::ceil(size.y / cellSize)), 1);
+	const uint32_t materialIndex = Material->GetMaterialIndex();
+	const glm::mat3 baseRotation = glm::mat3_cast(Rotation);
+	const BoundingVolume& meshBounds = Mesh->GetBounds();
+
+	// Every cell fills in it's own instances, they get packed together once we know how many each one got
+	std::vector<std::vector<InstanceTransform>> instances(static_cast<size_t>(cellsX) * cellsY);
+	std::vector<BoundingVolume> bounds(instances.size());
+	ThreadPool::Instance().ParallelFor(instances.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t ix = begin; ix < end; ix++) {
+			const int cellX = static_cast<int>(ix % cellsX);
+			const int cellY = static_cast<int>(ix / cellsX);
+			const glm::vec2 origin = RegionMin + glm::vec2(cellX, cellY) * cellSize;
+			const std::vector<glm::vec2>& points = tileCells[(cellY % TILE_CELLS) * TILE_CELLS + cellX % TILE_CELLS];
+			std::vector<InstanceTransform>& cell = instances[ix];
+			cell.reserve(points.size());
+			glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+			for (size_t point = 0; point < points.size(); point++) {
+				const glm::vec2 position = origin + points[point];
+				if (position.x > RegionMax.x || position.y > RegionMax.y || _IsExcluded(position)) {
+					continue;
+				}
+				const uint32_t hash = Hash(Seed ^ Hash(static_cast<uint32_t>(ix) ^ Hash(static_cast<uint32_t>(point))));
+				const float yaw = HashToFloat(hash) * glm::two_pi<float>();
+				const float scale = glm::mix(ScaleRange.x, ScaleRange.y, HashToFloat(Hash(hash)));
+				const glm::mat3 rotation = glm::mat3_cast(glm::angleAxis(yaw, glm::vec3(0.0f, 0.0f, 1.0f))) * baseRotation;
+				glm::mat4 model = glm::mat4(rotation * scale);
+				model[3] = glm::vec4(position, Height, 1.0f);
+				// The scale is uniform, so the normal matrix is just the rotation with the scale taken back out
+				cell.emplace_back(model, rotation / scale, materialIndex);
+				const BoundingVolume world = meshBounds.Transformed(model);
+				min = glm::min(min, world.Min);
+				max = glm::max(max, world.Max);
+			}
+			if (!cell.empty()) {
+				bounds[ix] = BoundingVolume(min, max);
+			}
+		}
+	});
+
+	std::vector<InstanceTransform> packed;
+	for (size_t ix = 0; ix < instances.size(); ix++) {
+		if (instances[ix].empty()) {
+			continue;
+		}
+		_cells.push_back({ bounds[ix], static_cast<uint32_t>(packed.size()), static_cast<uint32_t>(instances[ix].size()) });
+		packed.insert(packed.end(), instances[ix].begin(), instances[ix].end());
+	}
+	_instanceCount = static_cast<uint32_t>(packed.size());
+	if (packed.empty()) {
+		LOG_WARN("Scatter region is empty, nothing to draw");
+		return;
+	}
+	if (_instances == nullptr) {
+		_instances = VertexBuffer::Create();
+	}
+	_instances->LoadData(packed.data(), packed.size());
+	LOG_INFO("Scattered {} instances over {} cells", _instanceCount, _cells.size());
+}
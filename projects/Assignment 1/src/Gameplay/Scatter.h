@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+#include "Graphics/BoundingVolume.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Graphics/VertexBuffer.h"
+#include "Gameplay/Impostor.h"
+#include "Gameplay/ShaderMaterial.h"
+
+/// <summary>
+/// A rectangle on the ground that a ScatterComponent leaves empty
+/// </summary>
+struct ScatterExclusion {
+	glm::vec2 Min;
+	glm::vec2 Max;
+};
+
+/// <summary>
+/// Fills a rectangle on the ground (the XY plane) with copies of a mesh, without an entity for each one. The
+/// positions come from a Poisson disk sampled over a tile that wraps around at it's edges, so the tile can be laid
+/// down side by side over any size of region and every instance still keeps at least the spacing from the others.
+/// Each instance gets a random yaw and scale from a hash of where it is, so the repeats of the tile don't stand out
+///
+/// The instances are written straight into an instance buffer of their own, grouped into square cells. The
+/// snapshot builder culls whole cells and draws the ones that survive right out of the buffer, so nothing needs to
+/// be touched per instance once they've been generated. The component's entity's transform is ignored, the region
+/// is in world space
+/// </summary>
+class ScatterComponent {
+public:
+	// The rectangle to fill, and the height the instances sit at
+	glm::vec2 RegionMin = glm::vec2(-1.0f);
+	glm::vec2 RegionMax = glm::vec2(1.0f);
+	float     Height = 0.0f;
+	// The rectangles to leave empty
+	std::vector<ScatterExclusion> Exclusions;
+	// The smallest distance between any two instances
+	float     Spacing = 1.0f;
+	uint32_t  Seed = 0;
+	// The rotation applied to every instance before it's random yaw around Z (ex: to stand Y up meshes up)
+	glm::quat Rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	// The range the instances' uniform scales are picked from
+	glm::vec2 ScaleRange = glm::vec2(1.0f);
+
+	VertexArrayObject::sptr Mesh;
+	ShaderMaterial::sptr    Material;
+	// Drawn in place of the mesh past the impostor's fade range, null to always draw the mesh. The impostors are
+	// drawn from the same instances, so they read the mesh's material data (which holds the same fade range)
+	Impostor::sptr          Billboard;
+
+	/// <summary>
+	/// A square of the region, the instances in it sit next to each other in the instance buffer
+	/// </summary>
+	struct Cell {
+		BoundingVolume Bounds;
+		uint32_t       First;
+		uint32_t       Count;
+	};
+
+	/// <summary>
+	/// The number of cells along each side of the tile the positions get sampled over
+	/// </summary>
+	static const int TILE_CELLS = 4;
+	/// <summary>
+	/// The size of each cell, in multiples of the spacing
+	/// </summary>
+	static const int CELL_SPACINGS = 8;
+
+	ScatterComponent& SetMesh(const VertexArrayObject::sptr& mesh) { Mesh = mesh; return *this; }
+	ScatterComponent& SetMaterial(const ShaderMaterial::sptr& material) { Material = material; return *this; }
+	ScatterComponent& SetRegion(const glm::vec2& min, const glm::vec2& max, float height) { RegionMin = min; RegionMax = max; Height = height; _isDirty = true; return *this; }
+	ScatterComponent& AddExclusion(const glm::vec2& min, const glm::vec2& max) { Exclusions.push_back({ min, max }); _isDirty = true; return *this; }
+	ScatterComponent& SetSpacing(float spacing) { Spacing = spacing; _isDirty = true; return *this; }
+
+	/// <summary>
+	/// Marks the instances to be generated again on the next update, after changing any of the settings directly
+	/// </summary>
+	void Invalidate() { _isDirty = true; }
+
+	/// <summary>
+	/// Generates the instances if the settings or mesh have changed, or the material has moved to another slot of
+	/// the material buffer (the index is baked into every instance). Waits until the mesh has loaded and the
+	/// material has been prepared. Must be called on the main thread, and not while a snapshot is being built
+	/// </summary>
+	/// <returns>True if the instances were generated again</returns>
+	bool Update();
+
+	/// <summary>
+	/// Returns true once there are instances to draw
+	/// </summary>
+	bool IsGenerated() const { return _instances != nullptr && !_cells.empty(); }
+	const std::vector<Cell>& GetCells() const { return _cells; }
+	const VertexBuffer::sptr& GetInstances() const { return _instances; }
+	uint32_t GetInstanceCount() const { return _instanceCount; }
+
+protected:
+	std::vector<Cell>  _cells;
+	VertexBuffer::sptr _instances;
+	uint32_t           _instanceCount = 0;
+	// What the instances were last generated from
+	bool                     _isDirty = true;
+	const VertexArrayObject* _builtMesh = nullptr;
+	uint32_t                 _builtMaterialIndex = 0;
+
+	// Fills the cells and the instance buffer
+	void _Generate();
+	// Returns true if the position lands in one of the exclusions
+	bool _IsExcluded(const glm::vec2& position) const;
+};
@@ -2,19 +2,62 @@
 
 #include "Transform.h"
 #include "GameObjectTag.h"
+#include "RendererComponent.h"
+#include "SpatialIndex.h"
 #include "Logging.h"
+#include "Utilities/MemoryTracker.h"
+#include "Utilities/ThreadPool.h"
 
 entt::registry GameScene::_prefabRegistry;
 std::unordered_map<entt::id_type, StampFunction> GameScene::_stampFunctions;
+std::unordered_map<entt::id_type, BulkStampFunction> GameScene::_bulkStampFunctions;
 
 GameScene::GameScene(const std::string& name) {
 	Name = name;
 
-	RegisterComponentType<Transform>();
+	RegisterComponentType<Transform>(&Transform::Stamp, &Transform::StampMany);
 	RegisterComponentType<GameObjectTag>();
+	// Keeps the hierarchy links valid when something with children gets destroyed
+	_registry.on_destroy<Transform>().connect<&Transform::OnDestroy>();
+	// Anything that draws gets a copy of it's world matrices that the renderers' group can own (see WorldMatrix)
+	_registry.on_construct<RendererComponent>().connect<&entt::registry::emplace_or_replace<WorldMatrix>>();
+	_registry.on_construct<WorldMatrix>().connect<&Transform::OnWorldMatrixAdded>();
+	// Keeps the name index in sync with the tags
+	_registry.on_construct<GameObjectTag>().connect<&GameScene::_OnTagChanged>(*this);
+	_registry.on_update<GameObjectTag>().connect<&GameScene::_OnTagChanged>(*this);
+	_registry.on_destroy<GameObjectTag>().connect<&GameScene::_OnTagDestroyed>(*this);
+
+	// Every thread records into it's own buffer, so they don't need to fight over a lock
+	const uint32_t bufferCount = ThreadPool::Instance().GetThreadCount() + 1;
+	for (uint32_t ix = 0; ix < bufferCount; ix++) {
+		_commandBuffers.push_back(std::make_unique<EntityCommandBuffer>());
+	}
+	_spatial = std::make_unique<SpatialIndex>(_registry);
+}
+
+GameScene::~GameScene() = default;
+
+EntityCommandBuffer& GameScene::Commands() {
+	const size_t index = static_cast<size_t>(ThreadPool::GetWorkerIndex() + 1);
+	LOG_ASSERT(index < _commandBuffers.size(), "Scenes must be created after the thread pool has been initialized!");
+	return *_commandBuffers[index];
+}
+
+void GameScene::Poll() {
+	for (const std::unique_ptr<EntityCommandBuffer>& buffer : _commandBuffers) {
+		buffer->Playback(*this, _deletionQueue);
+	}
+	for (entt::entity instance : _deletionQueue) {
+		// The same entity could have been queued from more than one thread
+		if (_registry.valid(instance)) {
+			_registry.destroy(instance);
+		}
+	}
+	_deletionQueue.clear();
 }
 
 entt::handle GameScene::CreateEntity(const std::string& name) {
+	MEMORY_SCOPE(MemoryTag::ECS);
 	entt::entity entity = _registry.create();
 	entt::handle result = entt::handle(_registry, entity);
 	// pass the handle to the transform constructor
@@ -26,25 +69,115 @@ entt::handle GameScene::CreateEntity(const std::string& name) {
 entt::handle GameScene::CreateEntity(entt::entity prefab, const std::string& name) {
 	LOG_ASSERT(_prefabRegistry.valid(prefab), "Entity is not a valid prefab! You may need to call CreatePrefab(entity_id) first!");
 
+	MEMORY_SCOPE(MemoryTag::ECS);
 	const entt::entity instance = StampEntity(_prefabRegistry, prefab, _registry);
 	return entt::handle(_registry, instance);
 }
 
+std::vector<entt::entity> GameScene::Instantiate(entt::entity prefab, size_t count, const InstancePlacement* placements) {
+	LOG_ASSERT(_prefabRegistry.valid(prefab), "Entity is not a valid prefab! You may need to call CreatePrefab(entity_id) first!");
+
+	MEMORY_SCOPE(MemoryTag::ECS);
+	std::vector<entt::entity> result(count);
+	if (count == 0) {
+		return result;
+	}
+	_registry.create(result.begin(), result.end());
+	if (_prefabRegistry.has<GameObjectTag>(prefab)) {
+		_nameIndex.reserve(_nameIndex.size() + count);
+		_indexedNames.reserve(_indexedNames.size() + count);
+	}
+	const entt::entity* first = result.data();
+	const entt::entity* last  = result.data() + count;
+
+	// One column at a time, so each pool only grows once
+	_prefabRegistry.visit(prefab, [&](const auto typeId) {
+		BulkStampFunction bulk = _bulkStampFunctions[typeId];
+		if (bulk != nullptr) {
+			bulk(_prefabRegistry, prefab, _registry, first, last);
+		} else {
+			StampFunction stamp = _stampFunctions[typeId];
+			for (const entt::entity* entity = first; entity != last; entity++) {
+				stamp(_prefabRegistry, prefab, _registry, *entity);
+			}
+		}
+	});
+
+	if (placements != nullptr) {
+		LOG_ASSERT(_registry.has<Transform>(result[0]), "Prefab needs a transform to be placed!");
+		for (size_t ix = 0; ix < count; ix++) {
+			_registry.get<Transform>(result[ix])
+				.SetLocalPosition(placements[ix].Position)
+				.SetLocalRotation(placements[ix].Rotation)
+				.SetLocalScale(placements[ix].Scale);
+		}
+	}
+	return result;
+}
+
 entt::handle GameScene::FindFirst(const std::string& name)
 {
-	entt::entity result = entt::null;
-	uint32_t hash = entt::hashed_string::value(name.c_str());
-	const auto view = _registry.view<GameObjectTag>();
-	
-	for(const entt::entity& entity : view) {
-		const GameObjectTag& tag = _registry.get<GameObjectTag>(entity);
-		if (tag.HashedName == hash && tag.Name == name) {
-			return entt::handle(_registry, entity);
+	// A name that was never interned can't be on any of our tags
+	NameTable::Id id;
+	if (!NameTable::Find(name, id)) {
+		return entt::handle(_registry, entt::null);
+	}
+	const auto range = _nameIndex.equal_range(NameTable::GetHash(id));
+	for (auto it = range.first; it != range.second; ++it) {
+		// Different names can end up with the same hash, so we still need to check the actual name
+		if (_registry.get<GameObjectTag>(it->second).NameId == id) {
+			return entt::handle(_registry, it->second);
 		}
 	}
 	return entt::handle(_registry, entt::null);
 }
 
+std::vector<entt::handle> GameScene::FindAll(const std::string& name)
+{
+	std::vector<entt::handle> result;
+	NameTable::Id id;
+	if (!NameTable::Find(name, id)) {
+		return result;
+	}
+	const auto range = _nameIndex.equal_range(NameTable::GetHash(id));
+	for (auto it = range.first; it != range.second; ++it) {
+		if (_registry.get<GameObjectTag>(it->second).NameId == id) {
+			result.push_back(entt::handle(_registry, it->second));
+		}
+	}
+	return result;
+}
+
+void GameScene::_OnTagChanged(entt::registry& registry, entt::entity entity)
+{
+	const uint32_t hash = registry.get<GameObjectTag>(entity).HashedName;
+	auto indexed = _indexedNames.find(entity);
+	if (indexed != _indexedNames.end()) {
+		if (indexed->second == hash) {
+			return;
+		}
+		_OnTagDestroyed(registry, entity);
+	}
+	_nameIndex.emplace(hash, entity);
+	_indexedNames[entity] = hash;
+}
+
+void GameScene::_OnTagDestroyed(entt::registry& registry, entt::entity entity)
+{
+	auto indexed = _indexedNames.find(entity);
+	if (indexed == _indexedNames.end()) {
+		return;
+	}
+	const auto range = _nameIndex.equal_range(indexed->second);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == entity) {
+			_nameIndex.erase(it);
+			break;
+		}
+	}
+	_indexedNames.erase(indexed);
+}
+
 entt::handle GameScene::StampEntity(const entt::registry& from, entt::entity src, entt::registry& to) {
 	entt::entity dst = to.create();
 	from.visit(src, [&from, &to, src, dst](const auto type_id) {
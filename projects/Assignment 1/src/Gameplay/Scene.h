@@ -1,14 +1,36 @@
 #pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
 #include "entt.hpp"
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
 #include "Utilities/Macros.h"
+#include "EntityCommandBuffer.h"
+
+class SpatialIndex;
 
 /// <summary>
 /// Represents a callback that may be used to customize how entity stamping works between registries
 /// </summary>
 typedef void(*StampFunction)(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity dst);
 
+/// <summary>
+/// Like a StampFunction, but copies a component onto a whole range of new entities at once
+/// </summary>
+typedef void(*BulkStampFunction)(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity* first, const entt::entity* last);
+
 typedef entt::handle GameObject;
 
+/// <summary>
+/// Where to put a single instance made by GameScene::Instantiate, replacing the prefab's local transform
+/// </summary>
+struct InstancePlacement {
+	glm::vec3 Position = glm::vec3(0.0f);
+	glm::quat Rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 Scale    = glm::vec3(1.0f);
+};
+
 class GameScene final
 {
 	SMART_MEMORY_MANAGED(GameScene)
@@ -17,24 +39,63 @@ public:
 	std::string Name;
 
 	GameScene(const std::string& name = "<default>");
-	~GameScene() = default;
+	~GameScene();
 	
 	entt::handle CreateEntity(const std::string& name = "");
 	entt::handle CreateEntity(entt::entity prefab, const std::string& name = "");
+	/// <summary>
+	/// Makes many copies of a prefab at once. The entities are created in one go, and each component type is
+	/// copied onto all of them before moving on to the next, which is much quicker than calling CreateEntity in a loop
+	/// </summary>
+	/// <param name="prefab">The entity in the prefab registry to copy</param>
+	/// <param name="count">The number of instances to make</param>
+	/// <param name="placements">The transform for each instance, must have count entries. If nullptr, every instance keeps the prefab's transform</param>
+	/// <returns>The new entities, in the same order as the placements</returns>
+	std::vector<entt::entity> Instantiate(entt::entity prefab, size_t count, const InstancePlacement* placements = nullptr);
+	/// <summary>
+	/// Makes one copy of a prefab for each placement, see Instantiate above
+	/// </summary>
+	std::vector<entt::entity> Instantiate(entt::entity prefab, const std::vector<InstancePlacement>& placements) {
+		return Instantiate(prefab, placements.size(), placements.data());
+	}
 
+	/// <summary>
+	/// Finds an entity by the name in it's GameObjectTag, through an index that's kept up to date as tags are added,
+	/// replaced or removed. Names should be changed with patch or replace, so the index hears about it
+	/// </summary>
+	/// <param name="name">The name to search for</param>
+	/// <returns>A handle to one of the entities with the name, or a handle to entt::null if there are none</returns>
 	entt::handle FindFirst(const std::string& name);
+	/// <summary>
+	/// Finds every entity with the given name in it's GameObjectTag
+	/// </summary>
+	/// <param name="name">The name to search for</param>
+	/// <returns>Handles to all of the entities with the name, in no particular order</returns>
+	std::vector<entt::handle> FindAll(const std::string& name);
 
 	entt::registry& Registry() { return _registry; }
 
 	/// <summary>
-	/// Perform any tasks that should happen at the end of a loop, such as deleting queued objects
+	/// Gets the tree over the bounds of the scene's renderers, for culling, picking and finding things nearby
 	/// </summary>
-	void Poll() {
-		for(entt::entity instance : _deletionQueue) {
-			_registry.destroy(instance);
-		}
-		_deletionQueue.clear();
-	}
+	SpatialIndex& Spatial() { return *_spatial; }
+
+	/// <summary>
+	/// Gets the command buffer for the calling thread, anything that adds or removes entities or components while
+	/// systems might be running on other threads should be recorded here
+	/// </summary>
+	EntityCommandBuffer& Commands();
+
+	/// <summary>
+	/// Queues an entity to be destroyed at the end of the frame, by the next call to Poll
+	/// </summary>
+	void DestroyEntity(entt::entity entity) { Commands().Destroy(entity); }
+
+	/// <summary>
+	/// Perform any tasks that should happen at the end of a loop, such as playing back the command buffers and
+	/// deleting queued objects
+	/// </summary>
+	void Poll();
 
 	/// <summary>
 	/// Creates a new entity in the <i>to</i> registry, copying the components from the <i>src</i> entity in the from registry
@@ -45,21 +106,51 @@ public:
 	/// <returns>A handle for the newly created entity</returns>
 	static entt::handle StampEntity(const entt::registry& from, entt::entity src, entt::registry& to);
 
+	/// <summary>
+	/// Lets a component type be copied from prefabs
+	/// </summary>
+	/// <param name="stampOverride">Copies the component onto a single entity, if nullptr the component is copy constructed</param>
+	/// <param name="bulkOverride">Copies the component onto many entities at once for Instantiate. If nullptr, Instantiate uses the stampOverride on each entity, or a single insert if there's no stampOverride either</param>
 	template <typename Type>
-	static void RegisterComponentType(StampFunction stampOverride = nullptr) {
+	static void RegisterComponentType(StampFunction stampOverride = nullptr, BulkStampFunction bulkOverride = nullptr) {
 		_stampFunctions[entt::type_info<Type>::id()] = stampOverride != nullptr ? stampOverride : &_DefaultComponentStamp<Type>;
+		_bulkStampFunctions[entt::type_info<Type>::id()] = bulkOverride != nullptr ? bulkOverride : stampOverride != nullptr ? nullptr : &_DefaultBulkStamp<Type>;
 	}
 	static entt::registry& Prefabs() { return _prefabRegistry; }
 	
 private:
 	entt::registry _registry;
 	std::vector<entt::entity> _deletionQueue;
+	// Maps hashed names to the entities with them, and each entity back to the hash it's indexed under so we can
+	// find it again when it's name changes
+	std::unordered_multimap<uint32_t, entt::entity> _nameIndex;
+	std::unordered_map<entt::entity, uint32_t>      _indexedNames;
+	// One for the main thread, then one for each worker in the thread pool
+	std::vector<std::unique_ptr<EntityCommandBuffer>> _commandBuffers;
+	std::unique_ptr<SpatialIndex> _spatial;
 
 	static entt::registry _prefabRegistry;
 	static std::unordered_map<entt::id_type, StampFunction> _stampFunctions;
+	static std::unordered_map<entt::id_type, BulkStampFunction> _bulkStampFunctions;
+
+	void _OnTagChanged(entt::registry& registry, entt::entity entity);
+	void _OnTagDestroyed(entt::registry& registry, entt::entity entity);
 
+	// Empty components (ex: tags) have no instance to get, so they're just added
 	template <typename T>
 	static void _DefaultComponentStamp(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity dst) {
-		to.emplace_or_replace<T>(dst, from.get<T>(src));
+		if constexpr (entt::is_eto_eligible_v<T>) {
+			to.emplace_or_replace<T>(dst);
+		} else {
+			to.emplace_or_replace<T>(dst, from.get<T>(src));
+		}
+	}
+	template <typename T>
+	static void _DefaultBulkStamp(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity* first, const entt::entity* last) {
+		if constexpr (entt::is_eto_eligible_v<T>) {
+			to.insert<T>(first, last);
+		} else {
+			to.insert<T>(first, last, from.get<T>(src));
+		}
 	}
 };
@@ -0,0 +1,318 @@
+#include "SceneAudio.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+#include "Logging.h"
+#include "Transform.h"
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/FrameArena.h"
+#include "Utilities/MemoryTracker.h"
+
+const float SceneAudio::CELL_SIZE = 25.0f;
+
+static void* F_CALL FmodAllocate(unsigned int size, FMOD_MEMORY_TYPE, const char*) {
+	MEMORY_SCOPE(MemoryTag::Audio);
+	return operator new(size, std::nothrow);
+}
+
+static void* F_CALL FmodReallocate(void* memory, unsigned int size, FMOD_MEMORY_TYPE type, const char* source) {
+	void* result = FmodAllocate(size, type, source);
+	if (result != nullptr && memory != nullptr) {
+		memcpy(result, memory, std::min(static_cast<size_t>(size), MemoryTracker::GetAllocationSize(memory)));
+		operator delete(memory);
+	}
+	return result;
+}
+
+static void F_CALL FmodFree(void* memory, FMOD_MEMORY_TYPE, const char*) {
+	operator delete(memory);
+}
+
+// Ambient sources that stand still never change cell, so we only check a slice of them each frame and get through
+// all of them every this many frames
+static const uint32_t REBIN_FRAMES = 8;
+// Sources that already have a voice count as this much louder, so two sources that are about as loud as each other
+// don't keep trading places
+static const float VOICED_BIAS = 1.25f;
+
+void SceneAudio::TrackAllocations() {
+	FMOD_RESULT result = FMOD::Memory_Initialize(nullptr, 0, FmodAllocate, FmodReallocate, FmodFree);
+	if (result != FMOD_OK) {
+		LOG_WARN("Failed to hand FMOD our allocator, it's memory won't be tracked");
+	}
+}
+
+SceneAudio::SceneAudio(GameScene& scene, const AudioEngine::sptr& engine) :
+	_scene(scene),
+	_engine(engine),
+	_maxReach(0.0f),
+	_rebinCursor(0),
+	_voiceLimit(32),
+	_playingCount(0)
+{
+	entt::registry& registry = _scene.Registry();
+	registry.on_construct<AudioSource>().connect<&SceneAudio::_OnConstruct>(*this);
+	registry.on_update<AudioSource>().connect<&SceneAudio::_OnUpdate>(*this);
+	registry.on_destroy<AudioSource>().connect<&SceneAudio::_OnDestroy>(*this);
+	// Anything that was added before we were around still needs to be picked up
+	registry.view<AudioSource>().each([this](entt::entity entity, AudioSource&) {
+		_waiting.push_back(entity);
+	});
+}
+
+SceneAudio::~SceneAudio() {
+	entt::registry& registry = _scene.Registry();
+	registry.on_construct<AudioSource>().disconnect<&SceneAudio::_OnConstruct>(*this);
+	registry.on_update<AudioSource>().disconnect<&SceneAudio::_OnUpdate>(*this);
+	registry.on_destroy<AudioSource>().disconnect<&SceneAudio::_OnDestroy>(*this);
+	registry.view<AudioSource>().each([this](entt::entity entity, AudioSource& source) {
+		_Forget(entity, source);
+	});
+}
+
+void SceneAudio::Update(float deltaTime) {
+	PROFILE_SCOPE("Audio");
+	entt::registry& registry = _scene.Registry();
+
+	// Banks load in the background, so sources keep waiting until theirs is in. Once nothing is loading any more,
+	// whatever is left is never going to turn up
+	if (!_waiting.empty()) {
+		const bool isLoading = _engine->GetLoadingBankCount() > 0;
+		_waiting.erase(std::remove_if(_waiting.begin(), _waiting.end(), [&](entt::entity entity) {
+			if (!registry.valid(entity) || !registry.has<AudioSource>(entity)) {
+				return true;
+			}
+			AudioSource& source = registry.get<AudioSource>(entity);
+			if (source._instance != nullptr || source._ambientIndex != AudioSource::NOT_AMBIENT) {
+				return true;
+			}
+			if (!_engine->GetEventDistances(source.Event, source._minDistance, source._maxDistance)) {
+				if (!isLoading) {
+					LOG_WARN("Could not find the audio event \"{}\", the source will stay silent", source.Event);
+					return true;
+				}
+				return false;
+			}
+			if (source.PreloadSamples && _preloaded.insert(source.Event).second) {
+				_engine->PreloadSampleData(source.Event);
+			}
+			if (source.AutoPlay) {
+				_AddAmbient(entity, source);
+			} else if (_StartInstance(entity, source)) {
+				_manual.push_back(entity);
+			}
+			return true;
+		}), _waiting.end());
+	}
+
+	_listeners.clear();
+	registry.view<AudioListener, Transform>().each([&](entt::entity entity, AudioListener& listener, Transform& transform) {
+		if (!listener._hasLastPosition) {
+			listener._lastPosition = glm::vec3(transform.WorldTransform()[3]);
+			listener._hasLastPosition = true;
+		}
+		_listeners.push_back(_GetAttributes(transform.WorldTransform(), listener._lastPosition, deltaTime));
+	});
+
+	_UpdateVoices();
+
+	// Only sources with a voice have anything to hand over, the engine applies it all on it's own thread
+	_emitters.clear();
+	for (const std::vector<entt::entity>* list : { &_voiced, &_manual }) {
+		for (entt::entity entity : *list) {
+			AudioSource& source = registry.get<AudioSource>(entity);
+			const Transform* transform = registry.try_get<Transform>(entity);
+			if (transform != nullptr) {
+				_emitters.push_back({ source._instance, _GetAttributes(transform->WorldTransform(), source._lastPosition, deltaTime) });
+			}
+		}
+	}
+	_playingCount = static_cast<uint32_t>(_voiced.size() + _manual.size());
+	_engine->SubmitFrame(_listeners, _emitters);
+}
+
+void SceneAudio::_UpdateVoices() {
+	PROFILE_SCOPE("AudioVoices");
+	entt::registry& registry = _scene.Registry();
+
+	// Moving sources catch up with the grid a slice at a time, they can't get far in a few frames
+	if (!_ambient.empty()) {
+		const size_t count = (_ambient.size() + REBIN_FRAMES - 1) / REBIN_FRAMES;
+		for (size_t ix = 0; ix < count; ix++) {
+			_rebinCursor = _rebinCursor < _ambient.size() ? _rebinCursor : 0;
+			const entt::entity entity = _ambient[_rebinCursor++];
+			AudioSource& source = registry.get<AudioSource>(entity);
+			const Transform* transform = registry.try_get<Transform>(entity);
+			const uint64_t cell = transform != nullptr ? _GetCell(transform->WorldTransform()[3]) : source._cell;
+			if (cell != source._cell) {
+				std::vector<entt::entity>& from = _cells[source._cell];
+				from.erase(std::find(from.begin(), from.end(), entity));
+				if (from.empty()) {
+					_cells.erase(source._cell);
+				}
+				_cells[cell].push_back(entity);
+				source._cell = cell;
+			}
+		}
+	}
+
+	// Rank everything within earshot of a listener by how loud it should be, visiting each cell once
+	_candidates.clear();
+	FrameVector<uint64_t> visited;
+	for (const AudioEngine::Attributes3D& listener : _listeners) {
+		const int minX = static_cast<int>(std::floor((listener.Position.x - _maxReach) / CELL_SIZE));
+		const int maxX = static_cast<int>(std::floor((listener.Position.x + _maxReach) / CELL_SIZE));
+		const int minY = static_cast<int>(std::floor((listener.Position.y - _maxReach) / CELL_SIZE));
+		const int maxY = static_cast<int>(std::floor((listener.Position.y + _maxReach) / CELL_SIZE));
+		for (int x = minX; x <= maxX; x++) {
+			for (int y = minY; y <= maxY; y++) {
+				const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+				auto cell = _cells.find(key);
+				if (cell == _cells.end() || std::find(visited.begin(), visited.end(), key) != visited.end()) {
+					continue;
+				}
+				visited.push_back(key);
+				for (entt::entity entity : cell->second) {
+					const AudioSource& source = registry.get<AudioSource>(entity);
+					const Transform* transform = registry.try_get<Transform>(entity);
+					const glm::vec3 position = transform != nullptr ? glm::vec3(transform->WorldTransform()[3]) : glm::vec3(0.0f);
+					float distance = source._maxDistance;
+					for (const AudioEngine::Attributes3D& other : _listeners) {
+						distance = std::min(distance, glm::distance(position, other.Position));
+					}
+					if (distance >= source._maxDistance) {
+						continue;
+					}
+					// Roughly FMOD's default inverse rolloff, it only needs to put the sources in the right order
+					float audibility = source.Volume * (distance <= source._minDistance ? 1.0f : source._minDistance / distance);
+					audibility *= source._instance != nullptr ? VOICED_BIAS : 1.0f;
+					_candidates.push_back({ audibility, entity });
+				}
+			}
+		}
+	}
+
+	// The loudest few get voices, we only need to know which ones they are rather than their exact order
+	const size_t selected = std::min(_candidates.size(), static_cast<size_t>(_voiceLimit));
+	std::nth_element(_candidates.begin(), _candidates.begin() + selected, _candidates.end(), [](const auto& l, const auto& r) {
+		return l.first > r.first;
+	});
+	std::sort(_candidates.begin(), _candidates.begin() + selected, [](const auto& l, const auto& r) {
+		return l.second < r.second;
+	});
+	auto isSelected = [&](entt::entity entity) {
+		return std::binary_search(_candidates.begin(), _candidates.begin() + selected, std::make_pair(0.0f, entity), [](const auto& l, const auto& r) {
+			return l.second < r.second;
+		});
+	};
+
+	// Anything that lost it's voice goes virtual, and anything that gained one starts up
+	for (entt::entity entity : _voiced) {
+		if (!isSelected(entity)) {
+			AudioSource& source = registry.get<AudioSource>(entity);
+			_engine->ReleaseInstance(source._instance);
+			source._instance = nullptr;
+		}
+	}
+	_voiced.clear();
+	for (size_t ix = 0; ix < selected; ix++) {
+		const entt::entity entity = _candidates[ix].second;
+		AudioSource& source = registry.get<AudioSource>(entity);
+		if (source._instance != nullptr || _StartInstance(entity, source)) {
+			_voiced.push_back(entity);
+		}
+	}
+}
+
+void SceneAudio::_OnConstruct(entt::registry& registry, entt::entity entity) {
+	_waiting.push_back(entity);
+}
+
+void SceneAudio::_OnUpdate(entt::registry& registry, entt::entity entity) {
+	// The event may have changed, so the source starts again from scratch
+	_Forget(entity, registry.get<AudioSource>(entity));
+	_waiting.push_back(entity);
+}
+
+void SceneAudio::_OnDestroy(entt::registry& registry, entt::entity entity) {
+	_Forget(entity, registry.get<AudioSource>(entity));
+}
+
+bool SceneAudio::_StartInstance(entt::entity entity, AudioSource& source) {
+	source._instance = _engine->CreateInstance(source.Event);
+	if (source._instance == nullptr) {
+		return false;
+	}
+	// The instance should start out where the source is, rather than waiting for the next batch to move it there
+	const Transform* transform = _scene.Registry().try_get<Transform>(entity);
+	if (transform != nullptr) {
+		source._lastPosition = glm::vec3(transform->WorldTransform()[3]);
+		const FMOD_3D_ATTRIBUTES attributes = AudioEngine::ToFmod(_GetAttributes(transform->WorldTransform(), source._lastPosition, 0.0f));
+		source._instance->set3DAttributes(&attributes);
+	}
+	source._instance->setVolume(source.Volume);
+	if (source.AutoPlay) {
+		source._instance->start();
+	}
+	return true;
+}
+
+void SceneAudio::_Forget(entt::entity entity, AudioSource& source) {
+	if (source._ambientIndex != AudioSource::NOT_AMBIENT) {
+		_RemoveAmbient(entity, source);
+	}
+	if (source._instance != nullptr) {
+		_engine->ReleaseInstance(source._instance);
+		source._instance = nullptr;
+		for (std::vector<entt::entity>* list : { &_voiced, &_manual }) {
+			auto it = std::find(list->begin(), list->end(), entity);
+			if (it != list->end()) {
+				list->erase(it);
+			}
+		}
+	}
+}
+
+void SceneAudio::_AddAmbient(entt::entity entity, AudioSource& source) {
+	const Transform* transform = _scene.Registry().try_get<Transform>(entity);
+	source._cell = _GetCell(transform != nullptr ? glm::vec3(transform->WorldTransform()[3]) : glm::vec3(0.0f));
+	source._ambientIndex = static_cast<uint32_t>(_ambient.size());
+	_ambient.push_back(entity);
+	_cells[source._cell].push_back(entity);
+	_maxReach = std::max(_maxReach, source._maxDistance);
+}
+
+void SceneAudio::_RemoveAmbient(entt::entity entity, AudioSource& source) {
+	// Swap the last source into the hole, so the list doesn't need shuffling down
+	const entt::entity last = _ambient.back();
+	_ambient[source._ambientIndex] = last;
+	_scene.Registry().get<AudioSource>(last)._ambientIndex = source._ambientIndex;
+	_ambient.pop_back();
+	source._ambientIndex = AudioSource::NOT_AMBIENT;
+
+	std::vector<entt::entity>& cell = _cells[source._cell];
+	cell.erase(std::find(cell.begin(), cell.end(), entity));
+	if (cell.empty()) {
+		_cells.erase(source._cell);
+	}
+}
+
+uint64_t SceneAudio::_GetCell(const glm::vec3& position) {
+	const int x = static_cast<int>(std::floor(position.x / CELL_SIZE));
+	const int y = static_cast<int>(std::floor(position.y / CELL_SIZE));
+	return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+AudioEngine::Attributes3D SceneAudio::_GetAttributes(const glm::mat4& world, glm::vec3& lastPosition, float deltaTime) {
+	AudioEngine::Attributes3D result;
+	result.Position = glm::vec3(world[3]);
+	result.Velocity = deltaTime > 0.0f ? (result.Position - lastPosition) / deltaTime : glm::vec3(0.0f);
+	// Same as the camera, things face down their local -Z axis with +Y up
+	result.Forward = -glm::normalize(glm::vec3(world[2]));
+	result.Up = glm::normalize(glm::vec3(world[1]));
+	lastPosition = result.Position;
+	return result;
+}
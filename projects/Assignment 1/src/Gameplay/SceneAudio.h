@@ -0,0 +1,123 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <entt.hpp>
+
+#include "AudioComponents.h"
+#include "AudioEngine.h"
+#include "Scene.h"
+
+/// <summary>
+/// Connects the audio sources and listeners in a scene to an AudioEngine. Sources get going once their banks have
+/// loaded, and are released when the source is removed. Once a frame, every listener's and playing source's 3D
+/// attributes are gathered from their world transforms and handed to the engine in a single batch
+///
+/// Ambient sources (see AudioSource) are kept in a grid over the X and Y axes. Each frame only the cells within
+/// earshot of a listener are visited, the sources there are ranked by how loud they should be given their distance
+/// and attenuation, and only the loudest few get a voice (an event instance). Everything else stays virtual, so the
+/// cost of the audio stays flat no matter how many sources a scene has
+/// </summary>
+class SceneAudio final
+{
+public:
+	typedef std::shared_ptr<SceneAudio> sptr;
+	static inline sptr Create(GameScene& scene, const AudioEngine::sptr& engine) {
+		return std::make_shared<SceneAudio>(scene, engine);
+	}
+
+	/// <summary>
+	/// The width of the grid cells that ambient sources are sorted into, along the X and Y axes
+	/// </summary>
+	static const float CELL_SIZE;
+
+	/// <summary>
+	/// Routes all of FMOD's allocations through operator new, so they get charged to MemoryTag::Audio. Must be called
+	/// before the audio engine is initialized
+	/// </summary>
+	static void TrackAllocations();
+
+	/// <summary>
+	/// Creates the audio for a scene, including any sources it already has
+	/// </summary>
+	/// <param name="scene">The scene to play, must outlive this</param>
+	/// <param name="engine">The engine to play it through</param>
+	SceneAudio(GameScene& scene, const AudioEngine::sptr& engine);
+	~SceneAudio();
+
+	SceneAudio(const SceneAudio& other) = delete;
+	SceneAudio& operator=(const SceneAudio& other) = delete;
+
+	/// <summary>
+	/// Picks up sources whose banks have loaded, gives voices to the most audible ambient sources, and submits this
+	/// frame's 3D attributes. Should be called once a frame after the world matrices have been updated
+	/// </summary>
+	/// <param name="deltaTime">The time since the last update, in seconds, for working out velocities</param>
+	void Update(float deltaTime);
+
+	/// <summary>
+	/// Sets the most ambient sources that can have a voice at once
+	/// </summary>
+	void SetVoiceLimit(uint32_t limit) { _voiceLimit = limit; }
+	/// <summary>
+	/// Gets the most ambient sources that can have a voice at once
+	/// </summary>
+	uint32_t GetVoiceLimit() const { return _voiceLimit; }
+
+	/// <summary>
+	/// Gets the number of sources that have an event instance
+	/// </summary>
+	uint32_t GetPlayingCount() const { return _playingCount; }
+	/// <summary>
+	/// Gets the number of ambient sources that don't have a voice
+	/// </summary>
+	uint32_t GetVirtualCount() const { return static_cast<uint32_t>(_ambient.size() - _voiced.size()); }
+	/// <summary>
+	/// Gets the number of sources still waiting on their banks
+	/// </summary>
+	uint32_t GetWaitingCount() const { return static_cast<uint32_t>(_waiting.size()); }
+
+private:
+	GameScene&                                               _scene;
+	AudioEngine::sptr                                        _engine;
+	// Sources that are waiting on their banks to load
+	std::vector<entt::entity>                                _waiting;
+	// The events we've already asked the engine to preload
+	std::unordered_set<std::string>                          _preloaded;
+	// Every ambient source, and the ones that are in each cell of the grid
+	std::vector<entt::entity>                                _ambient;
+	std::unordered_map<uint64_t, std::vector<entt::entity>>  _cells;
+	// The ambient sources that have a voice, and the sources gameplay plays itself (which always have one)
+	std::vector<entt::entity>                                _voiced;
+	std::vector<entt::entity>                                _manual;
+	// The ambient sources within earshot this frame, and how loud each of them should be
+	std::vector<std::pair<float, entt::entity>>              _candidates;
+	// The farthest any ambient source can be heard from, which is how far around the listeners we need to look
+	float                                                    _maxReach;
+	// Where we're up to in checking whether ambient sources have moved to another cell
+	size_t                                                   _rebinCursor;
+	uint32_t                                                 _voiceLimit;
+	uint32_t                                                 _playingCount;
+	// Kept between frames so gathering doesn't allocate
+	std::vector<AudioEngine::Attributes3D>                   _listeners;
+	std::vector<AudioEngine::Emitter>                        _emitters;
+
+	void _OnConstruct(entt::registry& registry, entt::entity entity);
+	void _OnUpdate(entt::registry& registry, entt::entity entity);
+	void _OnDestroy(entt::registry& registry, entt::entity entity);
+
+	// Works out which sources get a voice this frame, and starts or stops instances to match
+	void _UpdateVoices();
+	// Creates and starts the event instance for a source, returns false if it couldn't be made
+	bool _StartInstance(entt::entity entity, AudioSource& source);
+	// Takes a source out of every list it's in, and releases it's instance
+	void _Forget(entt::entity entity, AudioSource& source);
+
+	void _AddAmbient(entt::entity entity, AudioSource& source);
+	void _RemoveAmbient(entt::entity entity, AudioSource& source);
+	// Gets the key of the grid cell that a position is in
+	static uint64_t _GetCell(const glm::vec3& position);
+	// Works out an entity's attributes from it's world transform and where it was last frame
+	static AudioEngine::Attributes3D _GetAttributes(const glm::mat4& world, glm::vec3& lastPosition, float deltaTime);
+};
@@ -0,0 +1,145 @@
+#include "SceneManager.h"
+
+#include <algorithm>
+#include <istream>
+#include <stdexcept>
+#include <streambuf>
+
+#include "Application.h"
+#include "Logging.h"
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/IoScheduler.h"
+
+SceneManager::LoadState                  SceneManager::_state = SceneManager::LoadState::None;
+std::string                              SceneManager::_path;
+SceneAssets                              SceneManager::_assets;
+GameScene::sptr                          SceneManager::_preloaded;
+Task<VirtualFile::sptr>                  SceneManager::_read;
+std::vector<Task<void>>                  SceneManager::_meshLoads;
+std::vector<Task<void>>                  SceneManager::_retiring;
+
+// Reads straight out of a file's contents, so they don't need to be copied into a stringstream first
+class MemoryStreamBuffer final : public std::streambuf
+{
+public:
+	MemoryStreamBuffer(const char* data, size_t size) {
+		char* begin = const_cast<char*>(data);
+		setg(begin, begin, begin + size);
+	}
+};
+
+bool SceneManager::Preload(const std::string& path, const SceneAssets& assets) {
+	if (_state != LoadState::None && _state != LoadState::Ready) {
+		LOG_WARN("Can't preload {}, {} is still loading", path, _path);
+		return false;
+	}
+	// A scene that was ready but never switched to gets replaced
+	if (_preloaded != nullptr) {
+		Retire(_preloaded);
+	}
+	_ResetPreload();
+	_state = LoadState::Reading;
+	_path = path;
+	_assets = assets;
+	_preloaded = GameScene::Create(path);
+	// The I/O threads fault every page of the file in, rather than the main thread doing it while it parses
+	_read = IoScheduler::Read(path, IoPriority::Prefetch);
+	return true;
+}
+
+GameScene::sptr SceneManager::SwitchToPreloaded() {
+	if (_state != LoadState::Ready) {
+		return nullptr;
+	}
+	GameScene::sptr scene = _preloaded;
+	_preloaded = nullptr;
+	_ResetPreload();
+	SwitchTo(scene);
+	return scene;
+}
+
+void SceneManager::SwitchTo(const GameScene::sptr& scene) {
+	GameScene::sptr previous = Application::Instance().ActiveScene;
+	Application::Instance().ActiveScene = scene;
+	if (previous != scene) {
+		Retire(std::move(previous));
+	}
+}
+
+void SceneManager::Retire(GameScene::sptr scene) {
+	if (scene == nullptr) {
+		return;
+	}
+	// The worker's reference is the last one (unless someone else is holding on to the scene), so the registry gets
+	// torn down over there
+	_retiring.push_back(ThreadPool::Instance().Schedule([scene = std::move(scene)]() mutable {
+		scene = nullptr;
+	}));
+}
+
+void SceneManager::Update() {
+	_retiring.erase(std::remove_if(_retiring.begin(), _retiring.end(), [](const Task<void>& destroyed) {
+		return destroyed.IsDone();
+	}), _retiring.end());
+
+	if (_state == LoadState::Reading && _read.IsDone()) {
+		if (_read.HasFailed()) {
+			LOG_ERROR("Failed to preload scene {}", _path);
+			_ResetPreload();
+			_preloaded = nullptr;
+			return;
+		}
+		PROFILE_SCOPE("Preload Scene");
+		const VirtualFile::sptr file = _read.Get();
+		const bool isJson = _path.size() >= 5 && _path.compare(_path.size() - 5, 5, ".json") == 0;
+		MemoryStreamBuffer buffer(file->GetData(), file->GetSize());
+		std::istream stream(&buffer);
+		try {
+			_meshLoads = SceneSerializer::BeginLoad(*_preloaded, stream, isJson ? SceneFormat::Json : SceneFormat::Binary, _assets);
+		} catch (const std::exception& e) {
+			LOG_ERROR("Failed to preload scene {}: {}", _path, e.what());
+			Retire(_preloaded);
+			_preloaded = nullptr;
+			_ResetPreload();
+			return;
+		}
+		_read = Task<VirtualFile::sptr>();
+		_state = LoadState::LoadingAssets;
+	}
+
+	if (_state == LoadState::LoadingAssets) {
+		for (const Task<void>& load : _meshLoads) {
+			if (!load.IsDone()) {
+				return;
+			}
+		}
+		_meshLoads.clear();
+		SceneSerializer::FinishLoad(*_preloaded);
+		_state = LoadState::Ready;
+		LOG_INFO("Preloaded scene {}", _path);
+	}
+}
+
+void SceneManager::Shutdown() {
+	// The meshes write into the preloaded scene's registry when they land, so it has to outlive them
+	for (const Task<void>& load : _meshLoads) {
+		ThreadPool::Instance().Wait(load);
+	}
+	if (_read.IsValid()) {
+		ThreadPool::Instance().Wait(_read);
+	}
+	_preloaded = nullptr;
+	_ResetPreload();
+	for (const Task<void>& destroyed : _retiring) {
+		ThreadPool::Instance().Wait(destroyed);
+	}
+	_retiring.clear();
+}
+
+void SceneManager::_ResetPreload() {
+	_state = LoadState::None;
+	_path.clear();
+	_assets = SceneAssets();
+	_read = Task<VirtualFile::sptr>();
+	_meshLoads.clear();
+}
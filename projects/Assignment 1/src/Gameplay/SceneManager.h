@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Scene.h"
+#include "SceneSerializer.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/VirtualFileSystem.h"
+
+/// <summary>
+/// Switches between scenes without a loading screen. The next scene gets loaded in the background while the active
+/// one keeps running: it's file is read on a worker, it's entities are created on the main thread, and then it's
+/// meshes load across the thread pool. Once it's ready, SwitchToPreloaded makes it the active scene within a frame
+///
+/// Assets that both scenes use are never loaded twice, or dropped in between. The AssetManager only holds weak
+/// references, so while the next scene loads it gets handed the same meshes and textures the active scene is
+/// holding, and it's references keep them resident through the switch. Anything only the old scene used is freed
+/// along with it
+///
+/// Tearing down a big scene takes a while, so the old scene is destroyed on a worker. Any GPU resources it was the
+/// last to use are safe to let go of over there, their handles get deleted later on by the GpuDeletionQueue
+/// </summary>
+class SceneManager final
+{
+public:
+	/// <summary>
+	/// Where the scene being preloaded is at
+	/// </summary>
+	enum class LoadState {
+		// Nothing is being preloaded
+		None,
+		// The scene's file is being read on a worker
+		Reading,
+		// The scene's entities are in, and it's waiting on it's meshes
+		LoadingAssets,
+		// The scene can be switched to
+		Ready
+	};
+
+	/// <summary>
+	/// Starts loading a scene file in the background, see SceneSerializer for the format. Only one scene can be
+	/// preloaded at a time. Must be called on the main thread
+	/// </summary>
+	/// <param name="path">The scene file to load, files ending in .json are read as JSON</param>
+	/// <param name="assets">The materials that the scene's renderers can use</param>
+	/// <returns>False if another scene is still being preloaded</returns>
+	static bool Preload(const std::string& path, const SceneAssets& assets);
+	/// <summary>
+	/// Makes the preloaded scene the active scene, and retires the one it replaces
+	/// </summary>
+	/// <returns>The new active scene, or nullptr if the preloaded scene isn't ready yet (nothing changes)</returns>
+	static GameScene::sptr SwitchToPreloaded();
+	/// <summary>
+	/// Makes a scene the active scene (ex: one that was built in code), and retires the one it replaces
+	/// </summary>
+	/// <param name="scene">The scene to make active</param>
+	static void SwitchTo(const GameScene::sptr& scene);
+	/// <summary>
+	/// Hands a scene off to be destroyed on a worker. Other references to the scene are allowed, but then it won't be
+	/// destroyed until the last one goes. Must be called on the main thread
+	/// </summary>
+	/// <param name="scene">The scene to destroy, must not be in use anywhere else (ex: by a RenderSnapshotBuilder)</param>
+	static void Retire(GameScene::sptr scene);
+
+	/// <summary>
+	/// Moves the preload along and forgets about any scenes the workers have finished destroying, should be called
+	/// once per frame on the main thread
+	/// </summary>
+	static void Update();
+	/// <summary>
+	/// Waits for any preload or retired scenes to finish, and lets go of everything. Should be called before the
+	/// OpenGL context is destroyed, and before the ThreadPool is shut down
+	/// </summary>
+	static void Shutdown();
+
+	static LoadState GetLoadState() { return _state; }
+	static bool IsReady() { return _state == LoadState::Ready; }
+	/// <summary>
+	/// Gets the path of the scene being preloaded, or an empty string if there isn't one
+	/// </summary>
+	static const std::string& GetPreloadPath() { return _path; }
+	/// <summary>
+	/// Gets the number of retired scenes that are still being destroyed
+	/// </summary>
+	static uint32_t GetRetiringCount() { return static_cast<uint32_t>(_retiring.size()); }
+
+protected:
+	SceneManager() = default;
+	~SceneManager() = default;
+
+	static LoadState                  _state;
+	static std::string                _path;
+	static SceneAssets                _assets;
+	static GameScene::sptr            _preloaded;
+	static Task<VirtualFile::sptr>    _read;
+	static std::vector<Task<void>>    _meshLoads;
+	// Each finishes once a worker has destroyed a retired scene
+	static std::vector<Task<void>>    _retiring;
+
+	// Drops the preload, once nothing is left running that refers to it
+	static void _ResetPreload();
+};
@@ -0,0 +1,291 @@
+#include "SceneSerializer.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Logging.h"
+#include "Camera.h"
+#include "GameObjectTag.h"
+#include "RendererComponent.h"
+#include "Transform.h"
+#include "Utilities/AssetManager.h"
+#include "Utilities/MemoryTracker.h"
+
+std::vector<SceneSerializer::ComponentType>                       SceneSerializer::_componentTypes;
+std::unordered_map<std::string, size_t>                           SceneSerializer::_componentsByName;
+std::vector<SceneSerializer::BehaviourType>                       SceneSerializer::_behaviourTypes;
+std::unordered_map<std::string, size_t>                           SceneSerializer::_behavioursByName;
+std::unordered_map<BehaviourBinding::Family::family_type, size_t> SceneSerializer::_behavioursByFamily;
+
+// Bumped whenever the layout of a scene file changes, so old files get rejected instead of read as garbage
+static const uint32_t SCENE_VERSION = 2;
+
+void SceneSerializer::_RegisterBuiltIns() {
+	static bool isRegistered = false;
+	if (isRegistered) {
+		return;
+	}
+	isRegistered = true;
+
+	// The scene registers it's own stamp functions for these, so we only need to add them to our list
+	_AddComponentType<Transform>("Transform", {
+		"", &_SaveSnapshot<Transform, BinaryOutput>, &_SaveSnapshot<Transform, JsonOutput>,
+		&_LoadSnapshot<Transform, BinaryInput>, &_LoadSnapshot<Transform, JsonInput>
+	});
+	_AddComponentType<GameObjectTag>("GameObjectTag", {
+		"", &_SaveSnapshot<GameObjectTag, BinaryOutput>, &_SaveSnapshot<GameObjectTag, JsonOutput>,
+		&_LoadSnapshot<GameObjectTag, BinaryInput>, &_LoadSnapshot<GameObjectTag, JsonInput>
+	});
+
+	GameScene::RegisterComponentType<RendererComponent>();
+	_AddComponentType<RendererComponent>("RendererComponent", {
+		"", &_SaveRenderers<BinaryOutput>, &_SaveRenderers<JsonOutput>,
+		&_LoadRenderers<BinaryInput>, &_LoadRenderers<JsonInput>
+	});
+	GameScene::RegisterComponentType<BehaviourBinding>();
+	_AddComponentType<BehaviourBinding>("BehaviourBinding", {
+		"", &_SaveBindings<BinaryOutput>, &_SaveBindings<JsonOutput>,
+		&_LoadBindings<BinaryInput>, &_LoadBindings<JsonInput>
+	});
+	RegisterComponentType<Camera>("Camera");
+}
+
+void SceneSerializer::Save(GameScene& scene, const std::string& path, const SceneAssets& assets, SceneFormat format) {
+	_RegisterBuiltIns();
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open scene file for writing: " + path);
+	}
+	if (format == SceneFormat::Json) {
+		JsonOutput archive(file);
+		_Save(scene, archive, assets);
+	} else {
+		BinaryOutput archive(file);
+		_Save(scene, archive, assets);
+	}
+}
+
+void SceneSerializer::Load(GameScene& scene, const std::string& path, const SceneAssets& assets) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open scene file: " + path);
+	}
+	const bool isJson = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+	// The render loop expects every renderer to have a mesh, so we can't hand the scene back until they're in
+	for (const Task<void>& load : BeginLoad(scene, file, isJson ? SceneFormat::Json : SceneFormat::Binary, assets)) {
+		ThreadPool::Instance().Wait(load);
+	}
+	FinishLoad(scene);
+}
+
+std::vector<Task<void>> SceneSerializer::BeginLoad(GameScene& scene, std::istream& stream, SceneFormat format, const SceneAssets& assets) {
+	MEMORY_SCOPE(MemoryTag::ECS);
+	_RegisterBuiltIns();
+	if (format == SceneFormat::Json) {
+		JsonInput archive(stream);
+		return _Load(scene, archive, assets);
+	} else {
+		BinaryInput archive(stream);
+		return _Load(scene, archive, assets);
+	}
+}
+
+void SceneSerializer::FinishLoad(GameScene& scene) {
+	entt::registry& registry = scene.Registry();
+	// Any renderers whose mesh failed to load get dropped
+	std::vector<entt::entity> missing;
+	registry.view<const RendererComponent>().each([&missing](entt::entity entity, const RendererComponent& renderer) {
+		if (renderer.Mesh == nullptr) {
+			missing.push_back(entity);
+		}
+	});
+	for (entt::entity entity : missing) {
+		registry.remove<RendererComponent>(entity);
+	}
+	// Behaviours get told they've been added, the same as when they're bound in code
+	registry.view<BehaviourBinding>().each([&registry](entt::entity entity, BehaviourBinding& binding) {
+		for (const BehaviourSlot& behaviour : binding.Behaviours) {
+			behaviour->OnLoad(entt::handle(registry, entity));
+		}
+	});
+}
+
+// Picks the right function pointer for the archive we were handed
+template <typename Archive, typename Type>
+static auto SaveFunction(const Type& type) {
+	if constexpr (std::is_same_v<Archive, SceneSerializer::BinaryOutput>) { return type.SaveBinary; } else { return type.SaveJson; }
+}
+template <typename Archive, typename Type>
+static auto LoadFunction(const Type& type) {
+	if constexpr (std::is_same_v<Archive, SceneSerializer::BinaryInput>) { return type.LoadBinary; } else { return type.LoadJson; }
+}
+
+template <typename Archive>
+void SceneSerializer::_Save(GameScene& scene, Archive& archive, const SceneAssets& assets) {
+	const entt::registry& registry = scene.Registry();
+	const entt::snapshot snapshot(registry);
+	const SaveContext context = { snapshot, registry, assets };
+
+	archive(cereal::make_nvp("Version", SCENE_VERSION));
+	snapshot.entities(archive);
+	archive(cereal::make_nvp("ComponentTypes", static_cast<uint32_t>(_componentTypes.size())));
+	for (const ComponentType& type : _componentTypes) {
+		archive(cereal::make_nvp("Type", type.Name));
+		SaveFunction<Archive>(type)(context, archive);
+	}
+}
+
+template <typename Archive>
+std::vector<Task<void>> SceneSerializer::_Load(GameScene& scene, Archive& archive, const SceneAssets& assets) {
+	uint32_t version = 0;
+	archive(cereal::make_nvp("Version", version));
+	if (version != SCENE_VERSION) {
+		throw std::runtime_error("Scene file is version " + std::to_string(version) + ", expected " + std::to_string(SCENE_VERSION));
+	}
+
+	// Snapshots can only be loaded into an empty registry
+	entt::registry& registry = scene.Registry();
+	registry.clear();
+	const entt::snapshot_loader loader(registry);
+	LoadContext context = { loader, registry, assets, {} };
+
+	try {
+		loader.entities(archive);
+		uint32_t typeCount = 0;
+		archive(cereal::make_nvp("ComponentTypes", typeCount));
+		for (uint32_t ix = 0; ix < typeCount; ix++) {
+			std::string name;
+			archive(cereal::make_nvp("Type", name));
+			auto type = _componentsByName.find(name);
+			if (type == _componentsByName.end()) {
+				throw std::runtime_error("Scene file has components of a type that hasn't been registered: " + name);
+			}
+			LoadFunction<Archive>(_componentTypes[type->second])(context, archive);
+		}
+	} catch (...) {
+		// The meshes that already started loading will write into the registry, so they need to land before the
+		// caller gets a chance to throw the scene away
+		for (const Task<void>& load : context.MeshLoads) {
+			ThreadPool::Instance().Wait(load);
+		}
+		throw;
+	}
+
+	Transform::AttachLoaded(registry);
+	return std::move(context.MeshLoads);
+}
+
+template <typename Archive>
+void SceneSerializer::_SaveRenderers(const SaveContext& context, Archive& archive) {
+	auto view = context.Registry.view<const RendererComponent>();
+	archive(static_cast<uint32_t>(view.size()));
+	for (entt::entity entity : view) {
+		const RendererComponent& renderer = view.get<const RendererComponent>(entity);
+		// Meshes from the AssetManager are stored by path, anything else needs a name from the assets
+		std::string meshPath, meshName;
+		glm::vec4 color(1.0f);
+		if (renderer.Mesh != nullptr && !AssetManager::GetMeshSource(renderer.Mesh, meshPath, color)) {
+			for (const auto& mesh : context.Assets.Meshes) {
+				if (mesh.second == renderer.Mesh) {
+					meshName = mesh.first;
+					break;
+				}
+			}
+			if (meshName.empty()) {
+				LOG_WARN("A renderer's mesh has no path or name, it won't be loaded with the scene");
+			}
+		}
+		const std::string material = renderer.Material != nullptr ? renderer.Material->DebugName : "";
+		archive(entity, meshPath, color, meshName, material, renderer.Cullable, renderer.QueryOcclusion);
+	}
+}
+
+template <typename Archive>
+void SceneSerializer::_LoadRenderers(LoadContext& context, Archive& archive) {
+	uint32_t count = 0;
+	archive(count);
+	for (uint32_t ix = 0; ix < count; ix++) {
+		entt::entity entity;
+		std::string meshPath, meshName, materialName;
+		glm::vec4 color;
+		bool cullable, queryOcclusion;
+		archive(entity, meshPath, color, meshName, materialName, cullable, queryOcclusion);
+
+		auto material = context.Assets.Materials.find(materialName);
+		auto mesh = context.Assets.Meshes.find(meshName);
+		if (material == context.Assets.Materials.end() || (meshPath.empty() && mesh == context.Assets.Meshes.end())) {
+			LOG_WARN("Skipping a renderer with mesh \"{}\" and material \"{}\", one of them is missing", meshPath.empty() ? meshName : meshPath, materialName);
+			continue;
+		}
+		RendererComponent& renderer = context.Registry.emplace<RendererComponent>(entity);
+		renderer.SetMaterial(material->second).SetCullable(cullable).SetQueryOcclusion(queryOcclusion);
+		if (meshPath.empty()) {
+			renderer.SetMesh(mesh->second);
+			continue;
+		}
+
+		// Every mesh starts loading before we wait on any of them, so they load side by side
+		entt::registry* registry = &context.Registry;
+		context.MeshLoads.push_back(AssetManager::GetMeshAsync(meshPath, color).Then([registry, entity](VertexArrayObject::sptr& mesh) {
+			if (registry->valid(entity) && registry->has<RendererComponent>(entity)) {
+				registry->get<RendererComponent>(entity).SetMesh(mesh);
+			}
+		}, JobThread::Main));
+	}
+}
+
+template <typename Archive>
+void SceneSerializer::_SaveBindings(const SaveContext& context, Archive& archive) {
+	auto view = context.Registry.view<const BehaviourBinding>();
+	archive(static_cast<uint32_t>(view.size()));
+	for (entt::entity entity : view) {
+		const BehaviourBinding& binding = view.get<const BehaviourBinding>(entity);
+		// Only the behaviours we know how to save get counted, the rest are dropped with a warning
+		std::vector<const BehaviourType*> types;
+		std::vector<const IBehaviour*> behaviours;
+		for (const BehaviourSlot& behaviour : binding.Behaviours) {
+			const BehaviourType* found = nullptr;
+			for (const auto& entry : _behavioursByFamily) {
+				const BehaviourSlot* slot = binding._Find(entry.first);
+				if (slot != nullptr && typeid(**slot) == typeid(*behaviour)) {
+					found = &_behaviourTypes[entry.second];
+					break;
+				}
+			}
+			if (found != nullptr) {
+				types.push_back(found);
+				behaviours.push_back(behaviour.get());
+			} else {
+				LOG_WARN("A behaviour of type {} hasn't been registered with the SceneSerializer, it won't be saved", typeid(*behaviour).name());
+			}
+		}
+
+		archive(entity, static_cast<uint32_t>(behaviours.size()));
+		for (size_t ix = 0; ix < behaviours.size(); ix++) {
+			archive(types[ix]->Name);
+			SaveFunction<Archive>(*types[ix])(*behaviours[ix], archive);
+		}
+	}
+}
+
+template <typename Archive>
+void SceneSerializer::_LoadBindings(LoadContext& context, Archive& archive) {
+	uint32_t count = 0;
+	archive(count);
+	for (uint32_t ix = 0; ix < count; ix++) {
+		entt::entity entity;
+		uint32_t behaviourCount = 0;
+		archive(entity, behaviourCount);
+		BehaviourBinding& binding = context.Registry.emplace<BehaviourBinding>(entity);
+		for (uint32_t behaviour = 0; behaviour < behaviourCount; behaviour++) {
+			std::string name;
+			archive(name);
+			auto type = _behavioursByName.find(name);
+			if (type == _behavioursByName.end()) {
+				throw std::runtime_error("Scene file has a behaviour of a type that hasn't been registered: " + name);
+			}
+			LoadFunction<Archive>(_behaviourTypes[type->second])(binding, archive);
+		}
+	}
+}
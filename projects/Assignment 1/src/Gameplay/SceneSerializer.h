@@ -0,0 +1,238 @@
+#pragma once
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <entt.hpp>
+#include <cereal/archives/binary.hpp>
+#include <cereal/archives/json.hpp>
+#include <cereal/types/common.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+#include <GLM/gtc/quaternion.hpp>
+#include <CerealGLM.h>
+
+#include "Scene.h"
+#include "Graphics/VertexArrayObject.h"
+#include "ShaderMaterial.h"
+#include "IBehaviour.h"
+#include "Utilities/ThreadPool.h"
+
+/// <summary>
+/// The formats a scene can be saved in
+/// </summary>
+enum class SceneFormat {
+	// Compact and quick to load, for shipping levels
+	Binary,
+	// Readable and diffable, for keeping levels under source control
+	Json
+};
+
+/// <summary>
+/// What a scene file needs from the game to be loaded, things that are created in code rather than loaded from a file
+/// </summary>
+struct SceneAssets {
+	/// <summary>
+	/// The materials that renderers can refer to, keyed by their DebugName
+	/// </summary>
+	std::unordered_map<std::string, ShaderMaterial::sptr> Materials;
+	/// <summary>
+	/// Meshes that were built in code instead of loaded with the AssetManager (ex: the skybox), keyed by any name
+	/// </summary>
+	std::unordered_map<std::string, VertexArrayObject::sptr> Meshes;
+};
+
+/// <summary>
+/// Saves and loads every component of a scene to a file. Components are written as entt snapshots, one pool at a
+/// time, so loading bulk-inserts each pool instead of running the code that built the scene
+///
+/// Only component types registered here are saved, RegisterComponentType also registers the type with
+/// GameScene::RegisterComponentType so prefabs can use it. Renderers are saved as references to their assets (the
+/// mesh's file and the material's name) rather than the assets themselves, and behaviours are saved by the name they
+/// were registered under with RegisterBehaviour
+/// </summary>
+class SceneSerializer final
+{
+public:
+	// The archives that everything gets written to and read from
+	typedef cereal::BinaryOutputArchive BinaryOutput;
+	typedef cereal::BinaryInputArchive  BinaryInput;
+	typedef cereal::JSONOutputArchive   JsonOutput;
+	typedef cereal::JSONInputArchive    JsonInput;
+
+	/// <summary>
+	/// Registers a component type to be saved with the scene, under the given name. The type needs cereal
+	/// serialize (or save and load) functions, unless it is one of the types handled by SceneSerializer itself
+	/// </summary>
+	/// <typeparam name="T">The type of component</typeparam>
+	/// <param name="name">The name the type is stored under, must not change once scenes have been saved</param>
+	/// <param name="stampOverride">Passed on to GameScene::RegisterComponentType</param>
+	template <typename T>
+	static void RegisterComponentType(const std::string& name, StampFunction stampOverride = nullptr);
+
+	/// <summary>
+	/// Registers a behaviour type so BehaviourBindings using it can be saved. The type needs a cereal serialize (or
+	/// save and load) function, and a default constructor
+	/// </summary>
+	/// <typeparam name="T">The type of behaviour</typeparam>
+	/// <param name="name">The name the type is stored under, must not change once scenes have been saved</param>
+	template <typename T>
+	static void RegisterBehaviour(const std::string& name);
+
+	/// <summary>
+	/// Saves all of the registered components in the scene to a file
+	/// </summary>
+	/// <param name="scene">The scene to save</param>
+	/// <param name="path">The path of the file to write</param>
+	/// <param name="assets">Names for any meshes the renderers use that didn't come from the AssetManager</param>
+	/// <param name="format">The format to save in</param>
+	static void Save(GameScene& scene, const std::string& path, const SceneAssets& assets, SceneFormat format = SceneFormat::Binary);
+	/// <summary>
+	/// Replaces everything in the scene with the contents of a file. Files ending in .json are read as JSON, anything
+	/// else as binary. Meshes are loaded across the thread pool, and this returns once they've all finished
+	/// </summary>
+	/// <param name="scene">The scene to load into</param>
+	/// <param name="path">The path of the file to read</param>
+	/// <param name="assets">The materials that the scene's renderers can use</param>
+	static void Load(GameScene& scene, const std::string& path, const SceneAssets& assets);
+	/// <summary>
+	/// Like Load, but reads the scene out of a stream and doesn't wait for it's meshes, so it can be spread over
+	/// several frames (see SceneManager). The renderers get their meshes as the returned tasks finish, and FinishLoad
+	/// must be called once they all have, before the scene is used. Must be called on the main thread
+	/// </summary>
+	/// <param name="scene">The scene to load into</param>
+	/// <param name="stream">The contents of a scene file</param>
+	/// <param name="format">The format the contents were saved in</param>
+	/// <param name="assets">The materials that the scene's renderers can use</param>
+	/// <returns>The tasks loading the scene's meshes</returns>
+	static std::vector<Task<void>> BeginLoad(GameScene& scene, std::istream& stream, SceneFormat format, const SceneAssets& assets);
+	/// <summary>
+	/// Drops the renderers whose mesh failed to load, then tells the behaviours they've been loaded
+	/// </summary>
+	/// <param name="scene">The scene that BeginLoad loaded into</param>
+	static void FinishLoad(GameScene& scene);
+
+	// What the save functions get to work with
+	struct SaveContext {
+		const entt::snapshot& Snapshot;
+		const entt::registry& Registry;
+		const SceneAssets&    Assets;
+	};
+	// What the load functions get to work with, they're handed the same loader so entt only sees one snapshot
+	struct LoadContext {
+		const entt::snapshot_loader& Loader;
+		entt::registry&              Registry;
+		const SceneAssets&           Assets;
+		// The meshes that are still loading, renderers get theirs once these finish
+		std::vector<Task<void>>      MeshLoads;
+	};
+
+protected:
+	SceneSerializer() = default;
+	~SceneSerializer() = default;
+
+	struct ComponentType {
+		std::string Name;
+		void(*SaveBinary)(const SaveContext& context, BinaryOutput& archive);
+		void(*SaveJson)(const SaveContext& context, JsonOutput& archive);
+		void(*LoadBinary)(LoadContext& context, BinaryInput& archive);
+		void(*LoadJson)(LoadContext& context, JsonInput& archive);
+	};
+
+	struct BehaviourType {
+		std::string Name;
+		void(*SaveBinary)(const IBehaviour& behaviour, BinaryOutput& archive);
+		void(*SaveJson)(const IBehaviour& behaviour, JsonOutput& archive);
+		void(*LoadBinary)(BehaviourBinding& binding, BinaryInput& archive);
+		void(*LoadJson)(BehaviourBinding& binding, JsonInput& archive);
+	};
+
+	static std::vector<ComponentType>                               _componentTypes;
+	static std::unordered_map<std::string, size_t>                  _componentsByName;
+	static std::vector<BehaviourType>                               _behaviourTypes;
+	static std::unordered_map<std::string, size_t>                  _behavioursByName;
+	static std::unordered_map<BehaviourBinding::Family::family_type, size_t> _behavioursByFamily;
+
+	// Registers the types that every scene has, the first time anything gets saved or loaded
+	static void _RegisterBuiltIns();
+
+	template <typename Archive>
+	static void _Save(GameScene& scene, Archive& archive, const SceneAssets& assets);
+	template <typename Archive>
+	static std::vector<Task<void>> _Load(GameScene& scene, Archive& archive, const SceneAssets& assets);
+
+	// The default way to store a pool, as a plain entt snapshot
+	template <typename T, typename Archive>
+	static void _SaveSnapshot(const SaveContext& context, Archive& archive) {
+		context.Snapshot.component<T>(archive);
+	}
+	template <typename T, typename Archive>
+	static void _LoadSnapshot(LoadContext& context, Archive& archive) {
+		context.Loader.component<T>(archive);
+	}
+
+	// Renderers and behaviour bindings refer to things outside of the registry, so they get their own formats
+	template <typename Archive>
+	static void _SaveRenderers(const SaveContext& context, Archive& archive);
+	template <typename Archive>
+	static void _LoadRenderers(LoadContext& context, Archive& archive);
+	template <typename Archive>
+	static void _SaveBindings(const SaveContext& context, Archive& archive);
+	template <typename Archive>
+	static void _LoadBindings(LoadContext& context, Archive& archive);
+
+	template <typename T, typename Archive>
+	static void _SaveBehaviour(const IBehaviour& behaviour, Archive& archive) {
+		archive(static_cast<const T&>(behaviour));
+	}
+	template <typename T, typename Archive>
+	static void _LoadBehaviour(BehaviourBinding& binding, Archive& archive) {
+		BehaviourPool<T>& pool = BehaviourPool<T>::Instance();
+		const uint32_t index = pool.Allocate();
+		// The binding owns the slot from here, so it still gets freed if the archive throws
+		binding._Add(BehaviourBinding::Family::type<T>, { pool.GetBase(index), &pool, index });
+		archive(static_cast<T&>(*pool.GetBase(index)));
+	}
+
+	template <typename T>
+	static void _AddComponentType(const std::string& name, ComponentType type);
+};
+
+template <typename T>
+void SceneSerializer::_AddComponentType(const std::string& name, ComponentType type) {
+	type.Name = name;
+	auto existing = _componentsByName.find(name);
+	if (existing != _componentsByName.end()) {
+		_componentTypes[existing->second] = type;
+	} else {
+		_componentsByName[name] = _componentTypes.size();
+		_componentTypes.push_back(type);
+	}
+}
+
+template <typename T>
+void SceneSerializer::RegisterComponentType(const std::string& name, StampFunction stampOverride) {
+	GameScene::RegisterComponentType<T>(stampOverride);
+	_AddComponentType<T>(name, {
+		name,
+		&_SaveSnapshot<T, BinaryOutput>, &_SaveSnapshot<T, JsonOutput>,
+		&_LoadSnapshot<T, BinaryInput>, &_LoadSnapshot<T, JsonInput>
+	});
+}
+
+template <typename T>
+void SceneSerializer::RegisterBehaviour(const std::string& name) {
+	BehaviourType type = {
+		name,
+		&_SaveBehaviour<T, BinaryOutput>, &_SaveBehaviour<T, JsonOutput>,
+		&_LoadBehaviour<T, BinaryInput>, &_LoadBehaviour<T, JsonInput>
+	};
+	auto existing = _behavioursByName.find(name);
+	if (existing != _behavioursByName.end()) {
+		_behaviourTypes[existing->second] = type;
+	} else {
+		_behavioursByName[name] = _behaviourTypes.size();
+		_behaviourTypes.push_back(type);
+	}
+	_behavioursByFamily[BehaviourBinding::Family::type<T>] = _behavioursByName[name];
+}
@@ -1,92 +1,393 @@
 #include "ShaderMaterial.h"
+#include "Graphics/RenderState.h"
+#include "Graphics/RenderStats.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
 
-template<typename T>
-void SubmitUniforms(const Shader::sptr& shader, const std::unordered_map<ShaderParamName, T>& values) {
-	for (auto& kvp : values) {
-		shader->SetUniform(kvp.first.Location, kvp.second);
-	}
-}
-
-template<typename T>
-void SubmitUniformsMat(const Shader::sptr& shader, const std::unordered_map<ShaderParamName, T>& values) {
-	for (auto& kvp : values) {
-		shader->SetUniformMatrix(kvp.first.Location, kvp.second);
-	}
-}
+uint32_t ShaderMaterial::_nextId = 0;
 
 ShaderMaterial::ShaderMaterial()
-	: Shader(nullptr),  RenderLayer(0)
+	: Shader(nullptr),  RenderLayer(0),
+	_dirtyMask(~0ull), _texturesDirty(true), _isFinalized(true),
+	_resolvedFor(nullptr), _materialBuffer(nullptr), _materialIndex(0),
+	_id(_nextId++)
 {
 }
 
 ShaderMaterial::~ShaderMaterial() {
-	LOG_INFO("Deleting material");
+	LOG_TRACE("Deleting material");
+	if (_materialBuffer != nullptr) {
+		_materialBuffer->Free(_materialIndex);
+	}
 }
 
 void ShaderMaterial::Apply()
-{	
+{
+	// The shader may have been swapped out by assigning to it directly
+	if (Shader.get() != _resolvedFor) {
+		_Resolve();
+	}
+	if (!_isFinalized) {
+		_Finalize();
+	}
+
+	RenderStats::CountMaterialSwitch();
+
+	// If another material was the last to touch this program, the values in it are not ours
+	const bool isProgramOurs = Shader->GetLastMaterialId() == _id;
+
+	// Our block parameters are already in the buffer, the draw picks them out with our material index
+	if (_materialBuffer != nullptr) {
+		_materialBuffer->Bind();
+	}
+
+	// Our textures go in consecutive units starting from 1, so we can bind them all with one call each for the
+	// textures and samplers
+	GLuint textures[RenderState::MAX_TRACKED_UNITS];
+	GLuint samplers[RenderState::MAX_TRACKED_UNITS];
 	int slot = 1;
-	for (auto& kvp : Textures) {
-		if (kvp.first.Location != -1 && kvp.second != nullptr) {
-			Shader->SetUniform(kvp.first.Location, slot);
-			kvp.second->Bind(slot);
+	UseTextures();
+	for (const TextureParam& texture : _textures) {
+		// Textures with a handle in the material block don't need a unit
+		if (texture.Location != -1 && texture.Texture != nullptr) {
+			if (!isProgramOurs || _texturesDirty) {
+				Shader->SetUniform(texture.Location, slot);
+			}
+			if (slot < RenderState::MAX_TRACKED_UNITS) {
+				const Sampler::sptr& sampler = texture.Texture->GetSampler();
+				textures[slot] = texture.Texture->GetHandle();
+				samplers[slot] = sampler != nullptr ? sampler->GetHandle() : 0;
+			} else {
+				texture.Texture->Bind(slot);
+			}
 			slot++;
 		}
 	}
+	GLsizei count = (slot < RenderState::MAX_TRACKED_UNITS ? slot : RenderState::MAX_TRACKED_UNITS) - 1;
+	RenderState::BindTextureUnits(1, count, textures + 1);
+	RenderState::BindSamplers(1, count, samplers + 1);
+
+	for (size_t ix = 0; ix < _params.size(); ix++) {
+		const Param& param = _params[ix];
+		if (param.Location == -1) {
+			continue;
+		}
+		if (!isProgramOurs || ix >= 64 || (_dirtyMask & (1ull << ix)) != 0) {
+			_Submit(param);
+		}
+	}
 
-	SubmitUniforms(Shader, FloatParams);
-	SubmitUniforms(Shader, Vec2Params);
-	SubmitUniforms(Shader, Vec3Params);
-	SubmitUniforms(Shader, Vec4Params);
-	SubmitUniformsMat(Shader, Mat4Params);
-	SubmitUniformsMat(Shader, Mat3Params);
+	_dirtyMask = 0;
+	_texturesDirty = false;
+	Shader->SetLastMaterialId(_id);
+}
+
+void ShaderMaterial::SetShader(const Shader::sptr& shader) {
+	LOG_ASSERT(shader != nullptr, "Material shader cannot be null");
+	Shader = shader;
+	_Resolve();
+}
+
+ShaderMaterial::sptr ShaderMaterial::Clone(const Shader::sptr& shader) const {
+	LOG_ASSERT(shader != nullptr, "Material shader cannot be null");
+	ShaderMaterial::sptr result = ShaderMaterial::Create();
+	result->Shader = shader;
+	result->RenderLayer = RenderLayer;
+	result->DebugName = DebugName;
+	result->Pipeline = Pipeline;
+	for (size_t ix = 0; ix < _params.size(); ix++) {
+		result->_SetParam(_paramNames[ix], _params[ix].Type, _data.data() + _params[ix].Offset, _params[ix].Size);
+	}
+	for (size_t ix = 0; ix < _textures.size(); ix++) {
+		result->Set(_textureNames[ix], _textures[ix].Texture);
+	}
+	return result;
+}
+
+bool ShaderMaterial::Prepare() {
+	// There's nothing to look up until the shader has finished compiling
+	if (Shader.get() != _resolvedFor && Shader->IsReady()) {
+		_Resolve();
+	}
+	return IsPrepared();
+}
+
+void ShaderMaterial::UseTextures() {
+	for (TextureParam& texture : _textures) {
+		if (texture.Texture == nullptr) {
+			continue;
+		}
+		// Lets TextureResidency know we still need these, even if they never get bound to a unit
+		texture.Texture->MarkUsed();
+		if (texture.BlockOffset != -1 && texture.Texture->GetBindlessHandle() != texture.Handle) {
+			_WriteBlockTexture(texture);
+		}
+	}
+}
+
+bool ShaderMaterial::CanShareDrawWith(const ShaderMaterial::sptr& other) const {
+	if (other.get() == this) {
+		return true;
+	}
+	// Only finalized materials are in a canonical order we can compare against
+	if (other == nullptr || _materialBuffer == nullptr || !_isFinalized || !other->_isFinalized ||
+		other->Shader != Shader || other->_resolvedFor != _resolvedFor || _resolvedFor != Shader.get() ||
+		other->Pipeline != Pipeline) {
+		return false;
+	}
+	if (other->_textures.size() != _textures.size() || other->_params.size() != _params.size()) {
+		return false;
+	}
+	for (size_t ix = 0; ix < _textures.size(); ix++) {
+		const TextureParam& a = _textures[ix];
+		const TextureParam& b = other->_textures[ix];
+		if (a.Location != b.Location || a.BlockOffset != b.BlockOffset) {
+			return false;
+		}
+		// Bindless textures are read from each material's own block entry, so only bound textures need to match
+		if (a.BlockOffset == -1 && a.Texture != b.Texture) {
+			return false;
+		}
+	}
+	// Any plain uniforms need to match exactly, block parameters are allowed to differ
+	for (size_t ix = 0; ix < _params.size(); ix++) {
+		const Param& a = _params[ix];
+		const Param& b = other->_params[ix];
+		if (a.Location != b.Location || a.Type != b.Type || a.BlockOffset != b.BlockOffset) {
+			return false;
+		}
+		if (a.BlockOffset == -1 && a.Location != -1 && memcmp(_data.data() + a.Offset, other->_data.data() + b.Offset, a.Size) != 0) {
+			return false;
+		}
+	}
+	return true;
 }
 
 void ShaderMaterial::Set(const std::string& name, const ITexture::sptr& texture) {
 	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Textures[pName] = texture;
+	if (Shader.get() != _resolvedFor) {
+		_Resolve();
+	}
+	auto it = std::find(_textureNames.begin(), _textureNames.end(), name);
+	if (it != _textureNames.end()) {
+		TextureParam& param = _textures[it - _textureNames.begin()];
+		param.Texture = texture;
+		if (param.BlockOffset != -1) {
+			_WriteBlockTexture(param);
+		}
+	} else {
+		TextureParam param;
+		param.Texture = texture;
+		_ResolveTexture(param, name);
+		if (param.BlockOffset != -1) {
+			_WriteBlockTexture(param);
+		}
+		_textures.push_back(param);
+		_textureNames.push_back(name);
+		_isFinalized = false;
+	}
+	_texturesDirty = true;
 }
 
 void ShaderMaterial::Set(const std::string& name, float value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	FloatParams[pName] = value;
+	_SetParam(name, ParamType::Float, &value, sizeof(value));
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::vec2& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Vec2Params[pName] = value;
+	_SetParam(name, ParamType::Vec2, &value, sizeof(value));
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::vec3& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Vec3Params[pName] = value;
+	_SetParam(name, ParamType::Vec3, &value, sizeof(value));
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::vec4& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Vec4Params[pName] = value;
+	_SetParam(name, ParamType::Vec4, &value, sizeof(value));
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::mat4& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Mat4Params[pName] = value;
+	_SetParam(name, ParamType::Mat4, &value, sizeof(value));
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::mat3& value) {
+	_SetParam(name, ParamType::Mat3, &value, sizeof(value));
+}
+
+void ShaderMaterial::_SetParam(const std::string& name, ParamType type, const void* value, uint32_t size) {
 	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Mat3Params[pName] = value;
+	if (Shader.get() != _resolvedFor) {
+		_Resolve();
+	}
+	auto it = std::find(_paramNames.begin(), _paramNames.end(), name);
+	if (it != _paramNames.end()) {
+		size_t ix = it - _paramNames.begin();
+		Param& param = _params[ix];
+		LOG_ASSERT(param.Type == type, "Parameter \"{}\" was set with a different type than it was created with", name);
+		memcpy(_data.data() + param.Offset, value, size);
+		if (param.BlockOffset != -1) {
+			_WriteBlockParam(param);
+		} else if (ix < 64) {
+			_dirtyMask |= 1ull << ix;
+		}
+	} else {
+		Param param;
+		param.Type     = type;
+		param.Offset   = static_cast<uint32_t>(_data.size());
+		param.Size     = size;
+		_ResolveParam(param, name);
+		_data.resize(_data.size() + size);
+		memcpy(_data.data() + param.Offset, value, size);
+		_params.push_back(param);
+		_paramNames.push_back(name);
+		_isFinalized = false;
+		if (param.BlockOffset != -1) {
+			_WriteBlockParam(param);
+		}
+	}
+}
+
+void ShaderMaterial::_ResolveParam(Param& param, const std::string& name) const {
+	const Shader::MaterialBlockLayout& layout = Shader->GetMaterialBlock();
+	auto it = layout.Offsets.find(name);
+	if (it != layout.Offsets.end()) {
+		param.Location    = -1;
+		param.BlockOffset = static_cast<int32_t>(it->second);
+	} else {
+		param.Location    = Shader->GetUniformLocation(name);
+		param.BlockOffset = -1;
+	}
+}
+
+void ShaderMaterial::_Resolve() {
+	// If the shader is still compiling we can't look anything up yet, so we'll try again once it's ready
+	_resolvedFor = Shader->IsReady() ? Shader.get() : nullptr;
+
+	// Move to the buffer that matches the new shader's block layout, if it has changed
+	const Shader::MaterialBlockLayout& layout = Shader->GetMaterialBlock();
+	uint32_t stride = _materialBuffer != nullptr ? _materialBuffer->GetStride() : 0;
+	if (layout.Stride != stride) {
+		if (_materialBuffer != nullptr) {
+			_materialBuffer->Free(_materialIndex);
+			_materialBuffer = nullptr;
+			_materialIndex = 0;
+		}
+		if (layout.Stride != 0) {
+			_materialBuffer = MaterialBuffer::Get(layout.Stride);
+			_materialIndex = _materialBuffer->Allocate();
+		}
+	}
+
+	for (size_t ix = 0; ix < _params.size(); ix++) {
+		_ResolveParam(_params[ix], _paramNames[ix]);
+		if (_params[ix].BlockOffset != -1) {
+			_WriteBlockParam(_params[ix]);
+		}
+	}
+	for (size_t ix = 0; ix < _textures.size(); ix++) {
+		_ResolveTexture(_textures[ix], _textureNames[ix]);
+		if (_textures[ix].BlockOffset != -1) {
+			_WriteBlockTexture(_textures[ix]);
+		}
+	}
+
+	// Locations have changed, so our sort order is no longer valid
+	_isFinalized = false;
+	_dirtyMask = ~0ull;
+	_texturesDirty = true;
+}
+
+void ShaderMaterial::_WriteBlockParam(const Param& param) {
+	const uint8_t* value = _data.data() + param.Offset;
+	if (param.Type == ParamType::Mat3) {
+		// In std430 each column of a mat3 is padded out to a vec4
+		for (uint32_t col = 0; col < 3; col++) {
+			_materialBuffer->Write(_materialIndex, param.BlockOffset + col * sizeof(glm::vec4), value + col * sizeof(glm::vec3), sizeof(glm::vec3));
+		}
+	} else {
+		_materialBuffer->Write(_materialIndex, param.BlockOffset, value, param.Size);
+	}
+}
+
+void ShaderMaterial::_ResolveTexture(TextureParam& texture, const std::string& name) const {
+	// Shaders only put samplers in the material block when bindless textures are available, but we'll check
+	// anyways so we never write a handle the driver didn't give us
+	if (ITexture::IsBindlessSupported()) {
+		const Shader::MaterialBlockLayout& layout = Shader->GetMaterialBlock();
+		auto it = layout.Offsets.find(name);
+		if (it != layout.Offsets.end()) {
+			texture.Location    = -1;
+			texture.BlockOffset = static_cast<int32_t>(it->second);
+			return;
+		}
+	}
+	texture.Location    = Shader->GetUniformLocation(name);
+	texture.BlockOffset = -1;
+}
+
+void ShaderMaterial::_WriteBlockTexture(TextureParam& texture) {
+	// A null handle is fine as long as the shader never samples it
+	texture.Handle = texture.Texture != nullptr ? texture.Texture->GetBindlessHandle() : 0;
+	_materialBuffer->Write(_materialIndex, texture.BlockOffset, &texture.Handle, sizeof(texture.Handle));
+}
+
+void ShaderMaterial::_Finalize() {
+	// Sort the parameters by location, and repack the blob in the same order so Apply walks memory linearly
+	std::vector<size_t> order(_params.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return _params[a].Location < _params[b].Location;
+	});
+
+	std::vector<Param>       params;
+	std::vector<std::string> names;
+	std::vector<uint8_t>     data;
+	params.reserve(_params.size());
+	names.reserve(_params.size());
+	data.reserve(_data.size());
+	for (size_t ix : order) {
+		Param param = _params[ix];
+		const uint8_t* src = _data.data() + param.Offset;
+		param.Offset = static_cast<uint32_t>(data.size());
+		data.insert(data.end(), src, src + param.Size);
+		params.push_back(param);
+		names.push_back(std::move(_paramNames[ix]));
+	}
+	_params     = std::move(params);
+	_paramNames = std::move(names);
+	_data       = std::move(data);
+
+	std::vector<size_t> texOrder(_textures.size());
+	std::iota(texOrder.begin(), texOrder.end(), 0);
+	std::stable_sort(texOrder.begin(), texOrder.end(), [&](size_t a, size_t b) {
+		return _textures[a].Location < _textures[b].Location;
+	});
+	std::vector<TextureParam> textures;
+	std::vector<std::string>  texNames;
+	textures.reserve(_textures.size());
+	texNames.reserve(_textures.size());
+	for (size_t ix : texOrder) {
+		textures.push_back(std::move(_textures[ix]));
+		texNames.push_back(std::move(_textureNames[ix]));
+	}
+	_textures     = std::move(textures);
+	_textureNames = std::move(texNames);
+
+	// Indices have moved around, so everything needs to go out next time
+	_dirtyMask = ~0ull;
+	_texturesDirty = true;
+	_isFinalized = true;
+}
+
+void ShaderMaterial::_Submit(const Param& param) const {
+	const uint8_t* value = _data.data() + param.Offset;
+	switch (param.Type) {
+		case ParamType::Float: Shader->SetUniform(param.Location, reinterpret_cast<const float*>(value), 1); break;
+		case ParamType::Vec2:  Shader->SetUniform(param.Location, reinterpret_cast<const glm::vec2*>(value), 1); break;
+		case ParamType::Vec3:  Shader->SetUniform(param.Location, reinterpret_cast<const glm::vec3*>(value), 1); break;
+		case ParamType::Vec4:  Shader->SetUniform(param.Location, reinterpret_cast<const glm::vec4*>(value), 1); break;
+		case ParamType::Mat3:  Shader->SetUniformMatrix(param.Location, reinterpret_cast<const glm::mat3*>(value), 1); break;
+		case ParamType::Mat4:  Shader->SetUniformMatrix(param.Location, reinterpret_cast<const glm::mat4*>(value), 1); break;
+		default: break;
+	}
 }
@@ -1,35 +1,21 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <vector>
 #include "Graphics/Shader.h"
 #include "Graphics/ITexture.h"
+#include "Graphics/MaterialBuffer.h"
+#include "Graphics/PipelineState.h"
 #include "Utilities/Macros.h"
-#include <EnumToString.h>
-
-struct ShaderParamName {
-	std::string Name;
-	int         Location;
-
-	ShaderParamName(const std::string& name) :
-		Name(name), Location(-1) {}
-
-	bool operator ==(const ShaderParamName& r) const {
-		return Name == r.Name;
-	}
-	bool operator !=(const ShaderParamName& r) const {
-		return Name != r.Name;
-	}
-};
-
-namespace  std
-{
-	template<>
-	struct hash<ShaderParamName> {
-		std::size_t operator()(const ShaderParamName& p) const noexcept {
-			return std::hash<std::string>()(p.Name);
-		}
-	};
-}
 
+/// <summary>
+/// A material stores a shader along with the textures and uniform values to use with it. Parameters are kept
+/// in flat arrays sorted by uniform location, with their values packed into a single byte blob, so applying a
+/// material is a single linear pass that only resubmits the values that have changed
+///
+/// If the shader declares a b_MaterialData block, any parameters that match a member of it are written into
+/// the material's entry in the shared MaterialBuffer instead of being set as uniforms
+/// </summary>
 class ShaderMaterial {
 	SMART_MEMORY_MANAGED(ShaderMaterial)
 public:
@@ -38,18 +24,67 @@ public:
 	virtual ~ShaderMaterial();
 
 	Shader::sptr Shader;
-	std::unordered_map<ShaderParamName, ITexture::sptr> Textures;
-	std::unordered_map<ShaderParamName, float> FloatParams;
-	std::unordered_map<ShaderParamName, glm::vec2> Vec2Params;
-	std::unordered_map<ShaderParamName, glm::vec3> Vec3Params;
-	std::unordered_map<ShaderParamName, glm::vec4> Vec4Params;
-	std::unordered_map<ShaderParamName, glm::mat4> Mat4Params;
-	std::unordered_map<ShaderParamName, glm::mat3> Mat3Params;
 
 	int RenderLayer;
 	std::string DebugName;
+	/// <summary>
+	/// The depth, blend, cull and polygon state to draw with. The renderer applies this along with the material, and
+	/// it's part of the sort key so draws that share a state end up next to each other
+	/// </summary>
+	PipelineState Pipeline;
 
 	void Apply();
+	/// <summary>
+	/// Lets TextureResidency know the material's textures are needed (which also loads any that are placeholders),
+	/// and writes new bindless handles for any textures whose storage has been replaced. Apply does this itself, it
+	/// only needs to be called for materials that are drawn without being applied (ex: ones sharing another
+	/// material's draw) or that are about to be drawn
+	/// </summary>
+	void UseTextures();
+
+	/// <summary>
+	/// Switches the material to another shader (ex: a different variant of the same source), looking up the
+	/// uniform locations of all of the parameters that have already been set in the new shader
+	/// </summary>
+	/// <param name="shader">The shader to switch to</param>
+	void SetShader(const Shader::sptr& shader);
+	/// <summary>
+	/// Makes a new material with the same parameters, textures and state as this one, but drawn with another shader
+	/// (ex: the lightmapped variant of the same source). The copy gets it's own entry in the material buffer
+	/// </summary>
+	/// <param name="shader">The shader for the copy to use</param>
+	ShaderMaterial::sptr Clone(const Shader::sptr& shader) const;
+	/// <summary>
+	/// Looks up the parameters in the shader if it has been swapped or finished compiling since the last lookup. This
+	/// happens on it's own when the material is applied, but anything that reads the material index ahead of time
+	/// (ex: RenderSnapshotBuilder on a worker) needs it done first. Must be called on the main thread
+	/// </summary>
+	/// <returns>True if the shader is ready and the material can be drawn</returns>
+	bool Prepare();
+	/// <summary>
+	/// Checks whether the material's parameters have been looked up in it's current shader, which also means the
+	/// shader is ready. This makes no OpenGL calls, so it's safe to check from other threads
+	/// </summary>
+	bool IsPrepared() const { return Shader != nullptr && Shader.get() == _resolvedFor; }
+
+	/// <summary>
+	/// Gets a small unique ID for this material, used to build render sort keys
+	/// </summary>
+	uint32_t GetId() const { return _id; }
+
+	/// <summary>
+	/// Gets the index of this material's entry in the shared material buffer, this should be passed along with
+	/// each instance that uses the material. Will be 0 if the shader does not use the material buffer
+	/// </summary>
+	uint32_t GetMaterialIndex() const { return _materialIndex; }
+
+	/// <summary>
+	/// Checks whether a draw using the other material can be issued while this material is applied. This is the
+	/// case when both use the same shader, textures and pipeline state, and only differ in values that live in the
+	/// material buffer
+	/// </summary>
+	/// <param name="other">The material to compare against</param>
+	bool CanShareDrawWith(const ShaderMaterial::sptr& other) const;
 
 	void Set(const std::string& name, const ITexture::sptr& texture);
 	void Set(const std::string& name, float value);
@@ -60,4 +95,69 @@ public:
 	void Set(const std::string& name, const glm::mat3& value);
 
 protected:
+	enum class ParamType : uint8_t {
+		Float,
+		Vec2,
+		Vec3,
+		Vec4,
+		Mat3,
+		Mat4
+	};
+
+	// A single uniform value, the value itself lives in _data
+	struct Param {
+		int       Location;
+		ParamType Type;
+		uint32_t  Offset;
+		uint32_t  Size;
+		// The offset of the value within our material buffer entry, or -1 if it is a plain uniform
+		int32_t   BlockOffset;
+	};
+	// A texture, and the location of the sampler uniform that reads it
+	struct TextureParam {
+		int            Location;
+		ITexture::sptr Texture;
+		// The offset of the texture's bindless handle within our material buffer entry, or -1 if it's bound to a unit
+		int32_t        BlockOffset;
+		// The bindless handle last written to our entry, textures get a new one when their storage is replaced
+		uint64_t       Handle = 0;
+	};
+
+	// Adds or updates a parameter, marking it as dirty
+	void _SetParam(const std::string& name, ParamType type, const void* value, uint32_t size);
+	// Sorts the parameters by location and repacks the value blob, called by Apply when parameters have been added
+	void _Finalize();
+	// Sends a single parameter to the shader
+	void _Submit(const Param& param) const;
+	// Looks up where a parameter lives in the current shader
+	void _ResolveParam(Param& param, const std::string& name) const;
+	// Re-resolves all parameters against the current shader, and moves us to the matching material buffer
+	void _Resolve();
+	// Copies a parameter's value into our material buffer entry
+	void _WriteBlockParam(const Param& param);
+	// Looks up where a texture lives in the current shader, preferring a bindless handle in the material block
+	void _ResolveTexture(TextureParam& texture, const std::string& name) const;
+	// Copies a texture's bindless handle into our material buffer entry
+	void _WriteBlockTexture(TextureParam& texture);
+
+	// Parameters sorted by location (once finalized), the names are stored separately since Apply doesn't need them
+	std::vector<Param>        _params;
+	std::vector<std::string>  _paramNames;
+	std::vector<uint8_t>      _data;
+	std::vector<TextureParam> _textures;
+	std::vector<std::string>  _textureNames;
+
+	// Bit n is set if _params[n] has changed since we last applied, parameters past the 64th are always submitted
+	uint64_t _dirtyMask;
+	bool     _texturesDirty;
+	bool     _isFinalized;
+
+	// The shader that our locations were last resolved against
+	const ::Shader* _resolvedFor;
+	// The shared buffer that holds our block parameters, and our entry in it
+	MaterialBuffer::sptr _materialBuffer;
+	uint32_t             _materialIndex;
+
+	uint32_t _id;
+	static uint32_t _nextId;
 };
@@ -0,0 +1,175 @@
+#include "SpatialIndex.h"
+
+#include "RendererComponent.h"
+#include "Transform.h"
+#include "Utilities/CpuProfiler.h"
+
+float SpatialIndex::RebuildThreshold = 0.5f;
+
+// Trees smaller than this are cheap enough to search that rebuilding them isn't worth it
+static const size_t MIN_REBUILD_LEAVES = 256;
+// Our guess at how long a rebuild takes, until the FrameScheduler has timed one
+static const float  REBUILD_ESTIMATE_MS = 2.0f;
+
+SpatialIndex::SpatialIndex(entt::registry& registry) :
+	_registry(registry),
+	_frame(0),
+	_movedCount(0),
+	_rebuildTask(FrameScheduler::INVALID_TASK)
+{
+	_registry.on_construct<RendererComponent>().connect<&SpatialIndex::_OnRendererAdded>(*this);
+	_registry.on_destroy<RendererComponent>().connect<&SpatialIndex::_OnRendererRemoved>(*this);
+	_registry.on_destroy<SpatialProxy>().connect<&SpatialIndex::_OnProxyRemoved>(*this);
+	// Anything that was added before we were around still needs to be picked up
+	_registry.view<RendererComponent>().each([this](entt::entity entity, RendererComponent&) {
+		_added.push_back(entity);
+	});
+}
+
+SpatialIndex::~SpatialIndex() {
+	FrameScheduler::Remove(_rebuildTask);
+	_registry.on_construct<RendererComponent>().disconnect<&SpatialIndex::_OnRendererAdded>(*this);
+	_registry.on_destroy<RendererComponent>().disconnect<&SpatialIndex::_OnRendererRemoved>(*this);
+	_registry.on_destroy<SpatialProxy>().disconnect<&SpatialIndex::_OnProxyRemoved>(*this);
+}
+
+void SpatialIndex::Update() {
+	PROFILE_SCOPE("SpatialIndex");
+	// Components can't be added or removed from inside of the signals, so we catch up on them here
+	for (entt::entity entity : _removed) {
+		if (_registry.valid(entity) && !_registry.has<RendererComponent>(entity) && _registry.has<SpatialProxy>(entity)) {
+			_registry.remove<SpatialProxy>(entity);
+		}
+	}
+	_removed.clear();
+	for (entt::entity entity : _added) {
+		if (_registry.valid(entity) && _registry.has<RendererComponent>(entity) && !_registry.has<SpatialProxy>(entity)) {
+			_registry.emplace<SpatialProxy>(entity);
+		}
+	}
+	_added.clear();
+
+	// Transforms don't tell anyone when they move, but their world version changes, so checking it is all it takes
+	// to skip everything that stood still
+	_movedCount = 0;
+	_registry.view<SpatialProxy, RendererComponent, Transform>().each([this](entt::entity entity, SpatialProxy& proxy, RendererComponent& renderer, Transform& transform) {
+		if (!renderer.Cullable || renderer.Mesh == nullptr) {
+			if (proxy.Node != DynamicBvh::NULL_NODE) {
+				_tree.Remove(proxy.Node);
+				proxy.Node = DynamicBvh::NULL_NODE;
+			}
+			return;
+		}
+		if (proxy.Node != DynamicBvh::NULL_NODE && proxy.WorldVersion == transform.GetWorldVersion() && proxy.Mesh == renderer.Mesh.get()) {
+			return;
+		}
+		proxy.WorldVersion = transform.GetWorldVersion();
+		proxy.Mesh = renderer.Mesh.get();
+		_movedCount++;
+		renderer.WorldBounds = renderer.Mesh->GetBounds().Transformed(transform.WorldTransform());
+		proxy.Node = proxy.Node == DynamicBvh::NULL_NODE ? _tree.Insert(renderer.WorldBounds, entity) : _tree.Move(proxy.Node, renderer.WorldBounds);
+	});
+
+	// Searching a slightly worse tree for a few more frames costs far less than a hitch
+	if (_tree.GetLeafCount() >= MIN_REBUILD_LEAVES && _tree.GetInsertsSinceRebuild() > _tree.GetLeafCount() * RebuildThreshold &&
+		!FrameScheduler::IsPending(_rebuildTask))
+	{
+		_rebuildTask = FrameScheduler::Add("SpatialRebuild", REBUILD_ESTIMATE_MS, [this](const TimeSlice&) {
+			Rebuild();
+			return true;
+		});
+	}
+}
+
+void SpatialIndex::Rebuild() {
+	PROFILE_SCOPE("RebuildBvh");
+	_tree.Rebuild([this](entt::entity entity, DynamicBvh::NodeId node) {
+		_registry.get<SpatialProxy>(entity).Node = node;
+	});
+	// Node ids have all changed, so whatever was visible before no longer lines up
+	_visibleFrame.clear();
+}
+
+uint32_t SpatialIndex::CullFrustum(const Frustum& frustum) {
+	return CullFrustums(&frustum, 1);
+}
+
+uint32_t SpatialIndex::CullFrustums(const Frustum* frustums, uint32_t count) {
+	_frame++;
+	_visibleFrame.resize(_tree.GetNodeCapacity(), 0);
+	_visibleMask.resize(_tree.GetNodeCapacity(), 0);
+	uint32_t result = 0;
+	_tree.QueryFrustums(frustums, count, [&](entt::entity, DynamicBvh::NodeId node, uint32_t mask) {
+		_visibleFrame[node] = _frame;
+		_visibleMask[node] = mask;
+		result++;
+	});
+	return result;
+}
+
+uint32_t SpatialIndex::GetVisibleMask(entt::entity entity) const {
+	const SpatialProxy* proxy = _registry.try_get<SpatialProxy>(entity);
+	if (proxy == nullptr || proxy->Node == DynamicBvh::NULL_NODE ||
+		static_cast<size_t>(proxy->Node) >= _visibleFrame.size() || _visibleFrame[proxy->Node] != _frame) {
+		return 0;
+	}
+	return _visibleMask[proxy->Node];
+}
+
+entt::entity SpatialIndex::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance, TriangleHit* triangle) const {
+	// The leaves store fattened boxes, so we test the renderer's actual world bounds before calling it a hit
+	const glm::vec3 inverseDir = 1.0f / direction;
+	TriangleHit closest;
+	entt::entity closestEntity = entt::null;
+	const entt::entity result = _tree.Raycast(origin, direction, maxDistance, [&](entt::entity entity, float) {
+		const RendererComponent& renderer = _registry.get<RendererComponent>(entity);
+		const BoundingVolume& bounds = renderer.WorldBounds;
+		const glm::vec3 t0 = (bounds.Min - origin) * inverseDir;
+		const glm::vec3 t1 = (bounds.Max - origin) * inverseDir;
+		const glm::vec3 near = glm::min(t0, t1);
+		const glm::vec3 far = glm::max(t0, t1);
+		const float enter = glm::max(glm::max(near.x, near.y), glm::max(near.z, 0.0f));
+		const float exit = glm::min(glm::min(far.x, far.y), far.z);
+		if (enter > exit) {
+			return -1.0f;
+		}
+
+		// Move the ray into the mesh's space to test the triangles, since the transform is affine the distances
+		// along the ray stay the same
+		const TriangleBvh* triangles = renderer.Mesh != nullptr ? renderer.Mesh->GetTriangleBvh().get() : nullptr;
+		const Transform* transform = _registry.try_get<Transform>(entity);
+		if (triangles == nullptr || transform == nullptr) {
+			return enter;
+		}
+		const glm::mat4 toLocal = glm::inverse(transform->WorldTransform());
+		TriangleHit hit;
+		if (!triangles->Raycast(glm::vec3(toLocal * glm::vec4(origin, 1.0f)), glm::vec3(toLocal * glm::vec4(direction, 0.0f)), maxDistance, hit)) {
+			return -1.0f;
+		}
+		if (closestEntity == entt::null || hit.Distance < closest.Distance) {
+			closest = hit;
+			closestEntity = entity;
+		}
+		return hit.Distance;
+	}, distance);
+	if (triangle != nullptr && result != entt::null && result == closestEntity) {
+		*triangle = closest;
+	}
+	return result;
+}
+
+void SpatialIndex::_OnRendererAdded(entt::registry& registry, entt::entity entity) {
+	_added.push_back(entity);
+}
+
+void SpatialIndex::_OnRendererRemoved(entt::registry& registry, entt::entity entity) {
+	_removed.push_back(entity);
+}
+
+void SpatialIndex::_OnProxyRemoved(entt::registry& registry, entt::entity entity) {
+	SpatialProxy& proxy = registry.get<SpatialProxy>(entity);
+	if (proxy.Node != DynamicBvh::NULL_NODE) {
+		_tree.Remove(proxy.Node);
+		proxy.Node = DynamicBvh::NULL_NODE;
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <entt.hpp>
+
+#include "DynamicBvh.h"
+#include "FrameScheduler.h"
+#include "Graphics/Frustum.h"
+#include "Utilities/TriangleBvh.h"
+
+class VertexArrayObject;
+
+/// <summary>
+/// Ties an entity with a RendererComponent to it's leaf in the scene's SpatialIndex. Added and removed by the
+/// index itself, so it shouldn't be touched by anything else
+/// </summary>
+struct SpatialProxy {
+	DynamicBvh::NodeId       Node = DynamicBvh::NULL_NODE;
+	// What the renderer's world bounds were last calculated from
+	uint32_t                 WorldVersion = 0;
+	const VertexArrayObject* Mesh = nullptr;
+};
+
+/// <summary>
+/// Keeps a DynamicBvh over the world bounds of every cullable renderer in a scene, so culling, picking and
+/// proximity queries don't need to test every renderer. Renderers are added and removed as their components are,
+/// and only the ones whose transform or mesh changed since the last Update get their bounds recalculated
+///
+/// Update also keeps each RendererComponent's WorldBounds up to date, so nothing else needs to recalculate them
+/// </summary>
+class SpatialIndex final
+{
+public:
+	/// <summary>
+	/// Update rebuilds the whole tree once this many leaves (as a fraction of all of the leaves) have been inserted
+	/// since it was last built, since inserting one at a time slowly makes the tree worse. The rebuild is handed to
+	/// the FrameScheduler, so it waits for a frame with room for it
+	/// </summary>
+	static float RebuildThreshold;
+
+	SpatialIndex(entt::registry& registry);
+	~SpatialIndex();
+
+	// We'll disallow moving and copying, since we're connected to the registry's signals
+	SpatialIndex(const SpatialIndex& other) = delete;
+	SpatialIndex(SpatialIndex&& other) = delete;
+	SpatialIndex& operator=(const SpatialIndex& other) = delete;
+	SpatialIndex& operator=(SpatialIndex&& other) = delete;
+
+	/// <summary>
+	/// Brings the tree up to date with the renderers, should be called after the world matrices have been updated.
+	/// Must be called from the main thread
+	/// </summary>
+	void Update();
+	/// <summary>
+	/// Rebuilds the tree from scratch, across the thread pool
+	/// </summary>
+	void Rebuild();
+	/// <summary>
+	/// Gets the number of renderers that were added, moved or changed mesh in the last Update
+	/// </summary>
+	uint32_t GetMovedCount() const { return _movedCount; }
+
+	/// <summary>
+	/// Finds every renderer in a frustum, they can then be checked with IsVisible until the next call
+	/// </summary>
+	/// <returns>The number of renderers in the frustum</returns>
+	uint32_t CullFrustum(const Frustum& frustum);
+	/// <summary>
+	/// Finds every renderer in any of several frustums (ex: one for each view being drawn) in one walk of the tree,
+	/// they can then be checked with IsVisible or GetVisibleMask until the next call
+	/// </summary>
+	/// <param name="frustums">The frustums to cull against</param>
+	/// <param name="count">The number of frustums, at most 32</param>
+	/// <returns>The number of renderers in at least one of the frustums</returns>
+	uint32_t CullFrustums(const Frustum* frustums, uint32_t count);
+	/// <summary>
+	/// Checks whether a renderer was found by the last call to CullFrustum(s). Renderers that aren't in the tree (ex:
+	/// ones that aren't cullable) are never visible
+	/// </summary>
+	bool IsVisible(entt::entity entity) const { return GetVisibleMask(entity) != 0; }
+	/// <summary>
+	/// Gets which of the frustums in the last call to CullFrustums a renderer was found in, bit N for frustums[N]
+	/// </summary>
+	uint32_t GetVisibleMask(entt::entity entity) const;
+
+	/// <summary>
+	/// Finds the closest renderer that a ray hits. Renderers whose mesh has a TriangleBvh are tested against their
+	/// triangles, anything else only has it's world bounds to go on
+	/// </summary>
+	/// <param name="origin">The start of the ray</param>
+	/// <param name="direction">The direction of the ray, doesn't need to be normalized</param>
+	/// <param name="maxDistance">How far along the ray to look, in multiples of direction</param>
+	/// <param name="distance">Will store the distance to the hit, in multiples of direction</param>
+	/// <param name="triangle">If not null, will store the triangle that was hit (left alone for hits on bounds)</param>
+	/// <returns>The entity that was hit, or entt::null</returns>
+	entt::entity Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance, TriangleHit* triangle = nullptr) const;
+
+	/// <summary>
+	/// Visits every renderer whose bounds overlap a sphere (ex: for behaviours looking for things nearby)
+	/// </summary>
+	/// <param name="visit">Called with each entity whose bounds overlap the sphere</param>
+	template <typename Func>
+	void QuerySphere(const glm::vec3& center, float radius, Func visit) const {
+		_tree.QuerySphere(center, radius, [&](entt::entity entity, DynamicBvh::NodeId) { visit(entity); });
+	}
+	/// <summary>
+	/// Visits every renderer whose bounds overlap a box (ex: for assigning lights to the things they reach)
+	/// </summary>
+	/// <param name="visit">Called with each entity whose bounds overlap the box</param>
+	template <typename Func>
+	void QueryBox(const glm::vec3& min, const glm::vec3& max, Func visit) const {
+		_tree.QueryBox(min, max, [&](entt::entity entity, DynamicBvh::NodeId) { visit(entity); });
+	}
+
+	/// <summary>
+	/// Gets the tree itself, for queries that need more control
+	/// </summary>
+	const DynamicBvh& GetTree() const { return _tree; }
+
+protected:
+	entt::registry& _registry;
+	DynamicBvh      _tree;
+	// Renderers that have been added or removed since the last update
+	std::vector<entt::entity> _added;
+	std::vector<entt::entity> _removed;
+	// The last frustum cull that found each node, and which of it's frustums found it, indexed by node id
+	std::vector<uint32_t> _visibleFrame;
+	std::vector<uint32_t> _visibleMask;
+	uint32_t              _frame;
+	uint32_t              _movedCount;
+	// The rebuild waiting on the FrameScheduler, if there is one
+	FrameScheduler::TaskId _rebuildTask;
+
+	void _OnRendererAdded(entt::registry& registry, entt::entity entity);
+	void _OnRendererRemoved(entt::registry& registry, entt::entity entity);
+	void _OnProxyRemoved(entt::registry& registry, entt::entity entity);
+};
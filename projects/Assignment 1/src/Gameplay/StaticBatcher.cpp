@@ -0,0 +1,253 @@
+#include "StaticBatcher.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include <GLM/gtc/packing.hpp>
+
+#include "Logging.h"
+#include "Graphics/GpuResources.h"
+#include "Graphics/MeshArena.h"
+#include "Utilities/MeshOptimizer.h"
+#include "RendererComponent.h"
+#include "Transform.h"
+
+const float StaticBatcher::DEFAULT_CHUNK_SIZE = 25.0f;
+
+// Renderers can only be merged if they share all of these
+struct BatchKey {
+	const ShaderMaterial* Material;
+	const MeshArena*      Arena;
+	glm::ivec3            Chunk;
+
+	bool operator<(const BatchKey& other) const {
+		if (Material != other.Material) return Material < other.Material;
+		if (Arena != other.Arena) return Arena < other.Arena;
+		if (Chunk.x != other.Chunk.x) return Chunk.x < other.Chunk.x;
+		if (Chunk.y != other.Chunk.y) return Chunk.y < other.Chunk.y;
+		return Chunk.z < other.Chunk.z;
+	}
+};
+
+// We need to be able to move the positions to pre-transform them, so the arena needs plain float positions
+static bool HasFloatPositions(const MeshArena& arena) {
+	for (const BufferAttribute& attrib : arena.GetVertexDecl()) {
+		if (attrib.Usage == AttribUsage::Position) {
+			return attrib.Type == GL_FLOAT && attrib.Size == 3;
+		}
+	}
+	return false;
+}
+
+// Finds where the positions live within each of the arena's vertices, HasFloatPositions must have passed
+static size_t GetPositionOffset(const MeshArena& arena) {
+	for (const BufferAttribute& attrib : arena.GetVertexDecl()) {
+		if (attrib.Usage == AttribUsage::Position) {
+			return attrib.Offset;
+		}
+	}
+	return 0;
+}
+
+// Moves a block of vertices into world space, using the arena's layout to find the positions and normals. The bounds
+// of the transformed positions are stored in min and max
+static void TransformVertices(uint8_t* vertices, size_t count, const MeshArena& arena, const glm::mat4& model,
+	const glm::mat3& normalMatrix, glm::vec3& min, glm::vec3& max)
+{
+	const size_t stride = arena.GetVertexStride();
+	min = glm::vec3(FLT_MAX);
+	max = glm::vec3(-FLT_MAX);
+	for (const BufferAttribute& attrib : arena.GetVertexDecl()) {
+		uint8_t* data = vertices + attrib.Offset;
+		if (attrib.Usage == AttribUsage::Position) {
+			for (size_t ix = 0; ix < count; ix++, data += stride) {
+				glm::vec3 position;
+				memcpy(&position, data, sizeof(glm::vec3));
+				position = model * glm::vec4(position, 1.0f);
+				memcpy(data, &position, sizeof(glm::vec3));
+				min = glm::min(min, position);
+				max = glm::max(max, position);
+			}
+		} else if (attrib.Usage == AttribUsage::Normal) {
+			if (attrib.Type == GL_FLOAT && attrib.Size == 3) {
+				for (size_t ix = 0; ix < count; ix++, data += stride) {
+					glm::vec3 normal;
+					memcpy(&normal, data, sizeof(glm::vec3));
+					normal = glm::normalize(normalMatrix * normal);
+					memcpy(data, &normal, sizeof(glm::vec3));
+				}
+			} else if (attrib.Type == GL_INT_2_10_10_10_REV) {
+				// Packed normals (see VertexPackedPosNormTexCol), we keep whatever was in the 2 bit component
+				for (size_t ix = 0; ix < count; ix++, data += stride) {
+					uint32_t packed;
+					memcpy(&packed, data, sizeof(uint32_t));
+					glm::vec4 normal = glm::unpackSnorm3x10_1x2(packed);
+					normal = glm::vec4(glm::normalize(normalMatrix * glm::vec3(normal)), normal.w);
+					packed = glm::packSnorm3x10_1x2(normal);
+					memcpy(data, &packed, sizeof(uint32_t));
+				}
+			} else {
+				LOG_WARN("Static batches don't know how to transform normals of type 0x{:x}, they will be left alone", attrib.Type);
+			}
+		}
+	}
+}
+
+// Appends a mesh's triangles to a batch's index list, flipping their winding if the mesh was mirrored
+static void AppendTriangles(std::vector<uint32_t>& indices, const std::vector<uint32_t>& source, uint32_t baseVertex, bool flip) {
+	for (size_t ix = 0; ix + 2 < source.size(); ix += 3) {
+		indices.push_back(baseVertex + source[ix]);
+		indices.push_back(baseVertex + source[ix + (flip ? 2 : 1)]);
+		indices.push_back(baseVertex + source[ix + (flip ? 1 : 2)]);
+	}
+}
+
+StaticBatcher::Stats StaticBatcher::Bake(GameScene& scene, float chunkSize) {
+	GPU_RESOURCE_OWNER("StaticBatcher");
+	Stats result;
+	entt::registry& registry = scene.Registry();
+
+	// Sort the static renderers into groups that can be merged
+	std::map<BatchKey, std::vector<entt::entity>> groups;
+	auto view = registry.view<StaticTag, RendererComponent, Transform>();
+	for (entt::entity entity : view) {
+		const RendererComponent& renderer = view.get<RendererComponent>(entity);
+		const Transform& transform = view.get<Transform>(entity);
+		// Batches are static too, but they've already been merged. Renderers with their own occlusion queries stay
+		// on their own, or their queries would cover the whole batch
+		if (renderer.Mesh == nullptr || renderer.Material == nullptr || registry.has<StaticBatch>(entity) || renderer.QueryOcclusion) {
+			continue;
+		}
+		const MeshArenaSlice& slice = renderer.Mesh->GetArenaSlice();
+		if (slice.Arena == nullptr || slice.IndexCount == 0 || !HasFloatPositions(*slice.Arena)) {
+			continue;
+		}
+		// The game loop hasn't necessarily run yet, so the world matrix may still be out of date
+		transform.UpdateWorldMatrix();
+		const glm::vec3 center = renderer.Mesh->GetBounds().Transformed(transform.WorldTransform()).Center;
+		const glm::ivec3 chunk = glm::ivec3(glm::floor(center / chunkSize));
+		groups[{ renderer.Material.get(), slice.Arena.get(), chunk }].push_back(entity);
+	}
+
+	std::vector<uint8_t> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<uint8_t> sourceVertices;
+	std::vector<uint32_t> sourceIndices;
+	std::vector<std::vector<uint32_t>> lodIndices;
+	std::vector<float> lodErrors;
+	for (const auto& kvp : groups) {
+		const std::vector<entt::entity>& sources = kvp.second;
+		if (sources.size() < 2) {
+			continue;
+		}
+		const RendererComponent& first = registry.get<RendererComponent>(sources[0]);
+		const MeshArena::sptr arena = first.Mesh->GetArenaSlice().Arena;
+		const ShaderMaterial::sptr material = first.Material;
+		const size_t stride = arena->GetVertexStride();
+
+		// The batch gets as many levels of detail as it's most detailed source, sources with fewer levels just keep
+		// using their last one
+		size_t lodCount = 0;
+		for (entt::entity source : sources) {
+			lodCount = std::max(lodCount, registry.get<RendererComponent>(source).Mesh->GetLods().size());
+		}
+		lodIndices.resize(lodCount);
+		lodErrors.assign(lodCount, 0.0f);
+		for (std::vector<uint32_t>& level : lodIndices) {
+			level.clear();
+		}
+
+		vertices.clear();
+		indices.clear();
+		StaticBatch batch;
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+		for (entt::entity source : sources) {
+			const RendererComponent& renderer = registry.get<RendererComponent>(source);
+			const Transform& transform = registry.get<Transform>(source);
+			arena->Read(renderer.Mesh->GetArenaSlice(), sourceVertices, sourceIndices);
+
+			const size_t sourceVertexCount = sourceVertices.size() / stride;
+			StaticBatchEntry entry;
+			entry.Source = source;
+			entry.FirstIndex = static_cast<uint32_t>(indices.size());
+			entry.IndexCount = static_cast<uint32_t>(sourceIndices.size());
+			glm::vec3 sourceMin, sourceMax;
+			TransformVertices(sourceVertices.data(), sourceVertexCount, *arena, transform.WorldTransform(), transform.WorldNormalMatrix(), sourceMin, sourceMax);
+			entry.Bounds = BoundingVolume(sourceMin, sourceMax);
+			min = glm::min(min, sourceMin);
+			max = glm::max(max, sourceMax);
+
+			// Mirroring transforms turn triangles inside out, so the winding needs to be flipped back
+			const bool flip = glm::determinant(glm::mat3(transform.WorldTransform())) < 0.0f;
+			const uint32_t baseVertex = static_cast<uint32_t>(vertices.size() / stride);
+			AppendTriangles(indices, sourceIndices, baseVertex, flip);
+
+			// The levels of detail re-use the full detail vertices, so their indices just need the same offset
+			const std::vector<VertexArrayObject::Lod>& sourceLods = renderer.Mesh->GetLods();
+			for (size_t level = 0; level < lodCount; level++) {
+				if (sourceLods.empty()) {
+					AppendTriangles(lodIndices[level], sourceIndices, baseVertex, flip);
+					continue;
+				}
+				const VertexArrayObject::Lod& lod = sourceLods[std::min(level, sourceLods.size() - 1)];
+				arena->ReadIndices(lod.Mesh->GetArenaSlice(), sourceIndices);
+				AppendTriangles(lodIndices[level], sourceIndices, baseVertex, flip);
+				lodErrors[level] = std::max(lodErrors[level], lod.Error);
+			}
+			vertices.insert(vertices.end(), sourceVertices.begin(), sourceVertices.end());
+			batch.Entries.push_back(entry);
+		}
+
+		// Same as any other mesh, a standalone copy for regular draws and a copy in the arena for multi-draw indirect
+		const size_t vertexCount = vertices.size() / stride;
+		VertexBuffer::sptr vbo = VertexBuffer::Create();
+		vbo->LoadImmutable(vertices.data(), stride, vertexCount);
+		IndexBuffer::sptr ebo = IndexBuffer::Create();
+		ebo->LoadCompact(indices.data(), indices.size(), vertexCount, true);
+
+		VertexArrayObject::sptr mesh = VertexArrayObject::Create();
+		mesh->AddVertexBuffer(vbo, arena->GetVertexDecl());
+		mesh->SetIndexBuffer(ebo);
+		mesh->SetBounds(BoundingVolume(min, max));
+		mesh->SetArenaSlice(arena->Allocate(vertices.data(), vertexCount, indices.data(), indices.size()));
+		// Merging a few props can easily add up to a big mesh, so it gets split up for cluster culling like any other
+		if (indices.size() / 3 >= MeshOptimizer::MESHLET_MIN_TRIANGLES) {
+			const float* positions = reinterpret_cast<const float*>(vertices.data() + GetPositionOffset(*arena));
+			mesh->SetMeshlets(MeshletBuffer::Create(MeshOptimizer::BuildMeshlets(indices.data(), indices.size(), positions, vertexCount, stride)));
+		}
+		// The errors are relative to the size of each source, and the batch is bigger than any of them, so the
+		// largest one is a safe bound for the batch
+		for (size_t level = 0; level < lodCount; level++) {
+			mesh->AddLod(lodIndices[level].data(), lodIndices[level].size(), lodErrors[level]);
+		}
+
+		// The batch's vertices are already in world space, so the batch itself sits at the origin
+		GameObject batchObject = scene.CreateEntity("StaticBatch" + std::to_string(result.Batches));
+		batchObject.emplace<RendererComponent>().SetMesh(mesh).SetMaterial(material);
+		// The batch never moves either, which lets it share the cached static shadows
+		batchObject.emplace<StaticTag>();
+		for (uint32_t ix = 0; ix < batch.Entries.size(); ix++) {
+			registry.remove<RendererComponent>(batch.Entries[ix].Source);
+			registry.emplace<StaticBatchMember>(batch.Entries[ix].Source, StaticBatchMember{ batchObject.entity(), ix });
+		}
+		result.Merged += static_cast<uint32_t>(batch.Entries.size());
+		result.Batches++;
+		batchObject.emplace<StaticBatch>(std::move(batch));
+	}
+
+	LOG_INFO("Merged {} static renderers into {} batches", result.Merged, result.Batches);
+	return result;
+}
+
+const StaticBatchEntry* StaticBatcher::FindEntry(const entt::registry& registry, entt::entity source) {
+	const StaticBatchMember* member = registry.try_get<StaticBatchMember>(source);
+	if (member == nullptr) {
+		return nullptr;
+	}
+	const StaticBatch* batch = registry.try_get<StaticBatch>(member->Batch);
+	return batch != nullptr && member->Entry < batch->Entries.size() ? &batch->Entries[member->Entry] : nullptr;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <entt.hpp>
+
+#include "Graphics/BoundingVolume.h"
+#include "Scene.h"
+
+/// <summary>
+/// Marks an entity that never moves once it has been set up, so StaticBatcher can merge it's mesh with others
+/// </summary>
+struct StaticTag { };
+
+/// <summary>
+/// Where one of the original renderers ended up within a merged static batch
+/// </summary>
+struct StaticBatchEntry
+{
+	/// <summary>
+	/// The entity that the mesh was taken from, it keeps it's transform and tag but no longer has a renderer
+	/// </summary>
+	entt::entity   Source;
+	/// <summary>
+	/// The first index of the mesh within the batch's index buffer, can be used to draw just this mesh (ex: outlines)
+	/// </summary>
+	uint32_t       FirstIndex;
+	/// <summary>
+	/// The number of indices in the mesh
+	/// </summary>
+	uint32_t       IndexCount;
+	/// <summary>
+	/// The world space bounds of the mesh, so it can still be picked or culled on it's own
+	/// </summary>
+	BoundingVolume Bounds;
+};
+
+/// <summary>
+/// Stored on the entity that draws a merged static batch, maps each index range of the batch back to it's source
+/// </summary>
+struct StaticBatch
+{
+	std::vector<StaticBatchEntry> Entries;
+};
+
+/// <summary>
+/// Stored on each entity that was merged into a static batch, points back to the batch and it's entry
+/// </summary>
+struct StaticBatchMember
+{
+	entt::entity Batch;
+	uint32_t     Entry;
+};
+
+/// <summary>
+/// Merges the meshes of static entities that share a material into a handful of pre-transformed meshes, so a scene
+/// full of props costs a few draws instead of one (or one instance) per prop. Entities are grouped into a grid of
+/// chunks so each merged mesh stays small enough for frustum culling to still skip it
+/// </summary>
+class StaticBatcher final
+{
+public:
+	// The size of a chunk along each axis, in world units
+	static const float DEFAULT_CHUNK_SIZE;
+
+	/// <summary>
+	/// What a call to Bake did
+	/// </summary>
+	struct Stats {
+		// The number of renderers that were merged into batches
+		uint32_t Merged  = 0;
+		// The number of batches that were created
+		uint32_t Batches = 0;
+	};
+
+	/// <summary>
+	/// Merges every entity with a StaticTag, a RendererComponent and a mesh in a MeshArena. Each batch gets it's own
+	/// entity with a RendererComponent and a StaticBatch, and the merged entities lose their RendererComponent but get
+	/// a StaticBatchMember. Groups with only one renderer are left alone, since merging them would not save anything.
+	/// Meshes need to have finished loading, and anything tagged static mustn't move afterwards
+	/// </summary>
+	/// <param name="scene">The scene to bake the static entities of</param>
+	/// <param name="chunkSize">The size of the grid cells that batches are split into</param>
+	static Stats Bake(GameScene& scene, float chunkSize = DEFAULT_CHUNK_SIZE);
+
+	/// <summary>
+	/// Finds where a merged entity's mesh lives within it's batch
+	/// </summary>
+	/// <returns>The entry for the entity, or nullptr if the entity isn't part of a batch</returns>
+	static const StaticBatchEntry* FindEntry(const entt::registry& registry, entt::entity source);
+
+protected:
+	StaticBatcher() = default;
+};
@@ -0,0 +1,130 @@
+#include "StressScene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <GLM/gtc/constants.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+#include "GameObjectTag.h"
+#include "Light.h"
+#include "Logging.h"
+#include "PathFollowSystem.h"
+#include "RendererComponent.h"
+#include "Transform.h"
+#include "Utilities/CpuProfiler.h"
+
+const std::vector<std::string> StressScene::MESH_PATHS = {
+	"models/Dunce.obj", "models/Duncet.obj", "models/Slide.obj", "models/Swing.obj", "models/Table.obj",
+	"models/Balloon.obj", "models/TreeSmall.obj", "models/TreeBig.obj", "models/RoundAbout.obj", "models/monkey.obj"
+};
+
+// How far each link of a chain sits above the one it hangs off of, and how much smaller it is
+static const float LINK_OFFSET = 1.5f;
+static const float LINK_SCALE = 0.8f;
+// How far the moving renderers bob, and how fast
+static const float BOB_HEIGHT = 1.0f;
+static const float BOB_SPEED = 0.5f;
+
+size_t StressScene::Build(GameScene& scene, const StressSceneSettings& settings, const std::vector<VertexArrayObject::sptr>& meshes,
+	const std::vector<ShaderMaterial::sptr>& materials)
+{
+	LOG_ASSERT(!meshes.empty() && !materials.empty(), "A stress scene needs at least one mesh and one material!");
+	PROFILE_SCOPE("StressScene::Build");
+
+	const uint32_t count = settings.EntityCount;
+	const uint32_t depth = std::max(settings.HierarchyDepth, 1u);
+	const uint32_t roots = (count + depth - 1) / depth;
+	const float halfSize = std::sqrt(static_cast<float>(roots)) * settings.Spacing * 0.5f;
+	std::mt19937 random(settings.Seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	// Our meshes are modelled Y up, so the roots get stood up in the world (which is Z up). Each link of a chain sits
+	// in it's parent's space, where up is already Y
+	const glm::quat standUp = glm::angleAxis(glm::half_pi<float>(), glm::vec3(1.0f, 0.0f, 0.0f));
+	const size_t combinations = meshes.size() * materials.size();
+	std::vector<std::vector<InstancePlacement>> placements(combinations);
+	std::vector<std::vector<uint32_t>> renderers(combinations);
+	std::vector<glm::vec3> ups(count);
+	for (uint32_t ix = 0; ix < count; ix++) {
+		InstancePlacement placement;
+		const float yaw = unit(random) * glm::two_pi<float>();
+		if (ix % depth == 0) {
+			placement.Position = glm::vec3((unit(random) * 2.0f - 1.0f) * halfSize, (unit(random) * 2.0f - 1.0f) * halfSize, 0.0f);
+			placement.Rotation = glm::angleAxis(yaw, glm::vec3(0.0f, 0.0f, 1.0f)) * standUp;
+			ups[ix] = glm::vec3(0.0f, 0.0f, 1.0f);
+		} else {
+			placement.Position = glm::vec3(0.0f, LINK_OFFSET, 0.0f);
+			placement.Rotation = glm::angleAxis(yaw, glm::vec3(0.0f, 1.0f, 0.0f));
+			placement.Scale = glm::vec3(LINK_SCALE);
+			ups[ix] = glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+		const size_t combination = ix % combinations;
+		placements[combination].push_back(placement);
+		renderers[combination].push_back(ix);
+	}
+
+	// Each combination gets stamped out of it's own prefab in one go
+	entt::registry& prefabs = GameScene::Prefabs();
+	entt::registry& registry = scene.Registry();
+	std::vector<entt::entity> entities(count);
+	for (size_t combination = 0; combination < combinations; combination++) {
+		if (placements[combination].empty()) {
+			continue;
+		}
+		const entt::entity prefab = prefabs.create();
+		prefabs.emplace<Transform>(prefab, entt::handle(prefabs, prefab));
+		prefabs.emplace<GameObjectTag>(prefab, "Stress");
+		prefabs.emplace<RendererComponent>(prefab)
+			.SetMesh(meshes[combination % meshes.size()])
+			.SetMaterial(materials[combination / meshes.size()]);
+		const std::vector<entt::entity> made = scene.Instantiate(prefab, placements[combination]);
+		for (size_t ix = 0; ix < made.size(); ix++) {
+			entities[renderers[combination][ix]] = made[ix];
+		}
+		prefabs.destroy(prefab);
+	}
+
+	// Then the chains get linked up all at once, so the transforms only get sorted the one time
+	if (depth > 1) {
+		std::vector<std::pair<entt::entity, entt::entity>> links;
+		links.reserve(count - roots);
+		for (uint32_t ix = 0; ix < count; ix++) {
+			if (ix % depth != 0) {
+				links.emplace_back(entities[ix], entities[ix - 1]);
+			}
+		}
+		Transform::SetParents(registry, links);
+	}
+
+	// Everything bobs along one of two paths, placed wherever the entity started
+	const PathAsset::Id bobPaths[2] = {
+		PathAsset::Create({ glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, BOB_HEIGHT) }),
+		PathAsset::Create({ glm::vec3(0.0f), glm::vec3(0.0f, BOB_HEIGHT, 0.0f) })
+	};
+	uint32_t moving = 0;
+	for (uint32_t ix = 0; ix < count; ix++) {
+		if (unit(random) < settings.MovingFraction) {
+			const glm::vec3 start = registry.get<Transform>(entities[ix]).GetLocalPosition();
+			FollowPathComponent& path = registry.emplace<FollowPathComponent>(entities[ix]);
+			path.Path = ups[ix].z > 0.0f ? bobPaths[0] : bobPaths[1];
+			path.Origin = start;
+			path.Speed = BOB_SPEED;
+			moving++;
+		}
+	}
+
+	for (uint32_t ix = 0; ix < settings.LightCount; ix++) {
+		entt::handle lamp = scene.CreateEntity("StressLight");
+		lamp.get<Transform>().SetLocalPosition((unit(random) * 2.0f - 1.0f) * halfSize, (unit(random) * 2.0f - 1.0f) * halfSize,
+			0.5f + unit(random) * 1.5f);
+		Light& light = lamp.emplace<Light>();
+		light.Color = glm::vec3(0.2f) + glm::vec3(unit(random), unit(random), unit(random)) * 0.8f;
+		light.AttenuationLinear = 0.7f;
+		light.AttenuationQuadratic = 1.8f;
+	}
+
+	LOG_INFO("Built a stress scene of {} renderers ({} moving, chains of {}) and {} lights over {:.0f}x{:.0f} units, from {} meshes and {} materials",
+		count, moving, depth, settings.LightCount, halfSize * 2.0f, halfSize * 2.0f, meshes.size(), materials.size());
+	return static_cast<size_t>(count) + settings.LightCount;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Graphics/VertexArrayObject.h"
+#include "Gameplay/Scene.h"
+#include "Gameplay/ShaderMaterial.h"
+
+/// <summary>
+/// How big and how varied a stress scene is, all of it set at runtime (see the --stress arguments in main)
+/// </summary>
+struct StressSceneSettings
+{
+	// The number of renderers to make, 0 to leave the stress scene out
+	uint32_t EntityCount = 0;
+	// How many different meshes (see StressScene::MESH_PATHS) and materials get spread over the renderers
+	uint32_t UniqueMeshes = 4;
+	uint32_t UniqueMaterials = 4;
+	// How many renderers are chained together, parent to child. 1 leaves every renderer at the root
+	uint32_t HierarchyDepth = 1;
+	// The fraction of the renderers, from 0 to 1, that bob up and down every frame
+	float    MovingFraction = 0.1f;
+	// The number of point lights scattered over the scene
+	uint32_t LightCount = 0;
+	// The average distance between neighbouring roots, the scene grows with the entity count to keep it
+	float    Spacing = 2.0f;
+	uint32_t Seed = 0;
+};
+
+/// <summary>
+/// Fills a scene with lots of renderers built from our existing assets, so we can see how the frame scales as the
+/// scene grows without recompiling. The roots are placed at random over a square centred on the origin that's sized
+/// to keep them Spacing apart on average, and each one is the top of a chain of HierarchyDepth renderers. The meshes
+/// and materials are handed out in turn, so every combination gets used about equally
+///
+/// Every combination of mesh and material becomes a prefab that all of it's renderers get instantiated from in one
+/// go, which keeps building a million renderers down to a few seconds. The renderers aren't tagged as static, so they
+/// measure the per object path rather than the static batches
+/// </summary>
+class StressScene final
+{
+public:
+	/// <summary>
+	/// The meshes a stress scene picks from, in order
+	/// </summary>
+	static const std::vector<std::string> MESH_PATHS;
+
+	/// <summary>
+	/// Builds the stress scene into a scene
+	/// </summary>
+	/// <param name="scene">The scene to add the entities to</param>
+	/// <param name="settings">How big to make the scene</param>
+	/// <param name="meshes">The meshes to use, at least one</param>
+	/// <param name="materials">The materials to use, at least one</param>
+	/// <returns>The number of entities that were made, including the lights</returns>
+	static size_t Build(GameScene& scene, const StressSceneSettings& settings, const std::vector<VertexArrayObject::sptr>& meshes,
+		const std::vector<ShaderMaterial::sptr>& materials);
+};
@@ -0,0 +1,236 @@
+#include "Terrain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stb_image.h>
+#include <GLM/gtc/matrix_transform.hpp>
+
+#include "Graphics/GpuResources.h"
+#include "Graphics/Texture2DData.h"
+#include "Logging.h"
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/MeshBuilder.h"
+#include "Utilities/VirtualFileSystem.h"
+
+// How far through it's range a level starts morphing into the next, the CDLOD paper's suggestion
+static const float MORPH_START = 0.7f;
+
+// Checks whether any part of a box is within a distance of a point
+static bool IsInRange(const BoundingVolume& bounds, const glm::vec3& point, float range) {
+	const glm::vec3 closest = glm::clamp(point, bounds.Min, bounds.Max);
+	const glm::vec3 offset = closest - point;
+	return glm::dot(offset, offset) <= range * range;
+}
+
+// Builds a grid of quads with it's corners on whole numbers from 0 to size, the vertex shader places it
+static VertexArrayObject::sptr BuildGrid(int size) {
+	MeshBuilder<VertexPosNormTexCol> grid;
+	const glm::vec3 normal(0.0f, 0.0f, 1.0f);
+	const glm::vec4 color(1.0f);
+	for (int y = 0; y <= size; y++) {
+		for (int x = 0; x <= size; x++) {
+			grid.AddVertex(glm::vec3(x, y, 0.0f), normal, glm::vec2(x, y) / static_cast<float>(size), color);
+		}
+	}
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			const uint32_t a = y * (size + 1) + x;
+			const uint32_t b = a + 1;
+			const uint32_t c = a + size + 1;
+			const uint32_t d = c + 1;
+			grid.AddIndexTri(a, b, d);
+			grid.AddIndexTri(a, d, c);
+		}
+	}
+	return grid.Bake<VertexPackedPosNormTexCol>();
+}
+
+TerrainComponent& TerrainComponent::SetHeights(uint32_t width, uint32_t height, std::vector<uint16_t> heights) {
+	LOG_ASSERT(width >= 2 && height >= 2 && heights.size() == static_cast<size_t>(width) * height, "Terrain heights must be at least 2x2, and match their size!");
+	_width = width;
+	_height = height;
+	_heights = std::move(heights);
+	_isDirty = true;
+	return *this;
+}
+
+bool TerrainComponent::LoadHeightmap(const std::string& path) {
+	Texture2DData::InitDecoder();
+	VirtualFile::sptr source = VirtualFileSystem::Open(path);
+	int width = 0, height = 0, channels = 0;
+	// 8 bit images get scaled up to 16 bits
+	uint16_t* data = source == nullptr ? nullptr : stbi_load_16_from_memory(reinterpret_cast<const stbi_uc*>(source->GetData()),
+		static_cast<int>(source->GetSize()), &width, &height, &channels, 1);
+	if (data == nullptr || width < 2 || height < 2) {
+		LOG_WARN("Failed to load terrain heightmap from \"{}\"", path);
+		stbi_image_free(data);
+		return false;
+	}
+	SetHeights(width, height, std::vector<uint16_t>(data, data + static_cast<size_t>(width) * height));
+	stbi_image_free(data);
+	return true;
+}
+
+bool TerrainComponent::Update() {
+	if (!_isDirty || _heights.empty() || Material == nullptr) {
+		return false;
+	}
+	GPU_RESOURCE_OWNER("Terrain");
+	PROFILE_SCOPE("Terrain");
+	_isDirty = false;
+
+	// Each of the most detailed nodes covers about a grid's worth of samples, so the closest ground is drawn at the
+	// heightmap's own resolution
+	const uint32_t samples = std::max(_width, _height) - 1;
+	_levelCount = 1;
+	while (_levelCount < MAX_LEVELS && (PATCH_SIZE << (_levelCount - 1)) < static_cast<int>(samples)) {
+		_levelCount++;
+	}
+	_BuildBounds();
+
+	// The heights get filtered between samples, but never blended across levels of the mip chain
+	Texture2DDescription description;
+	description.Width = _width;
+	description.Height = _height;
+	description.Format = InternalFormat::R16;
+	description.HorizontalWrap = WrapMode::ClampToEdge;
+	description.VerticalWrap = WrapMode::ClampToEdge;
+	description.MinificationFilter = MinFilter::Linear;
+	description.MagnificationFilter = MagFilter::Linear;
+	description.GenerateMipMaps = false;
+	_heightmap = Texture2D::Create(description);
+	_heightmap->LoadData(std::make_shared<Texture2DData>(_width, _height, PixelFormat::Red, PixelType::UShort, _heights.data(), InternalFormat::R16));
+
+	if (_patch == nullptr) {
+		_patch = BuildGrid(PATCH_SIZE);
+		_quarterPatch = BuildGrid(PATCH_SIZE / 2);
+	}
+
+	Material->Set("s_Heightmap", _heightmap);
+	Material->Set("u_TerrainRegion", glm::vec4(RegionMin, 1.0f / Size, TextureTiling));
+	return true;
+}
+
+void TerrainComponent::_BuildBounds() {
+	_bounds.resize(_levelCount);
+	const float scale = HeightScale / 65535.0f;
+
+	// The most detailed level looks at the samples under each node, including the ones on it's edges
+	const uint32_t leaves = 1u << (_levelCount - 1);
+	std::vector<glm::vec2>& leafBounds = _bounds[_levelCount - 1];
+	leafBounds.resize(static_cast<size_t>(leaves) * leaves);
+	for (uint32_t y = 0; y < leaves; y++) {
+		const uint32_t firstRow = static_cast<uint32_t>(std::floor(static_cast<float>(y) / leaves * (_height - 1)));
+		const uint32_t lastRow = std::min(static_cast<uint32_t>(std::ceil(static_cast<float>(y + 1) / leaves * (_height - 1))), _height - 1);
+		for (uint32_t x = 0; x < leaves; x++) {
+			const uint32_t firstColumn = static_cast<uint32_t>(std::floor(static_cast<float>(x) / leaves * (_width - 1)));
+			const uint32_t lastColumn = std::min(static_cast<uint32_t>(std::ceil(static_cast<float>(x + 1) / leaves * (_width - 1))), _width - 1);
+			uint16_t low = UINT16_MAX;
+			uint16_t high = 0;
+			for (uint32_t row = firstRow; row <= lastRow; row++) {
+				const uint16_t* samples = _heights.data() + static_cast<size_t>(row) * _width;
+				for (uint32_t column = firstColumn; column <= lastColumn; column++) {
+					low = std::min(low, samples[column]);
+					high = std::max(high, samples[column]);
+				}
+			}
+			leafBounds[y * leaves + x] = glm::vec2(BaseHeight + low * scale, BaseHeight + high * scale);
+		}
+	}
+
+	// Every other level covers the heights of it's four children
+	for (int level = _levelCount - 2; level >= 0; level--) {
+		const uint32_t nodes = 1u << level;
+		const std::vector<glm::vec2>& children = _bounds[level + 1];
+		std::vector<glm::vec2>& parents = _bounds[level];
+		parents.resize(static_cast<size_t>(nodes) * nodes);
+		for (uint32_t y = 0; y < nodes; y++) {
+			for (uint32_t x = 0; x < nodes; x++) {
+				const size_t first = static_cast<size_t>(y * 2) * (nodes * 2) + x * 2;
+				const glm::vec2 a = children[first];
+				const glm::vec2 b = children[first + 1];
+				const glm::vec2 c = children[first + nodes * 2];
+				const glm::vec2 d = children[first + nodes * 2 + 1];
+				parents[y * nodes + x] = glm::vec2(
+					std::min(std::min(a.x, b.x), std::min(c.x, d.x)),
+					std::max(std::max(a.y, b.y), std::max(c.y, d.y)));
+			}
+		}
+	}
+}
+
+BoundingVolume TerrainComponent::_GetNodeBounds(int level, uint32_t x, uint32_t y) const {
+	const float nodeSize = Size / static_cast<float>(1u << level);
+	const glm::vec2 min = RegionMin + glm::vec2(x, y) * nodeSize;
+	const glm::vec2 heights = _bounds[level][y * (1u << level) + x];
+	return BoundingVolume(glm::vec3(min, heights.x), glm::vec3(min + nodeSize, heights.y));
+}
+
+float TerrainComponent::_GetRange(int level) const {
+	return LodDistance * static_cast<float>(1u << (_levelCount - 1 - level));
+}
+
+InstanceTransform TerrainComponent::_MakeInstance(int level, const glm::vec2& corner) const {
+	const float spacing = Size / static_cast<float>(1u << level) / PATCH_SIZE;
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(corner, BaseHeight));
+	model = glm::scale(model, glm::vec3(spacing, spacing, HeightScale));
+	// The grid morphs into the next level's over the end of this level's range
+	const float end = _GetRange(level);
+	const float previous = level == _levelCount - 1 ? 0.0f : _GetRange(level + 1);
+	glm::mat3 morph(0.0f);
+	morph[0] = glm::vec3(previous + (end - previous) * MORPH_START, end, 0.0f);
+	return InstanceTransform(model, morph, Material->GetMaterialIndex());
+}
+
+bool TerrainComponent::_Select(int level, uint32_t x, uint32_t y, SelectContext& context) const {
+	const BoundingVolume bounds = _GetNodeBounds(level, x, y);
+	// The root covers whatever is past the end of every range
+	if (level > 0 && !IsInRange(bounds, context.CameraPos, _GetRange(level))) {
+		return false;
+	}
+	if (!context.ViewFrustum->Intersects(bounds)) {
+		return true;
+	}
+	const float nodeSize = Size / static_cast<float>(1u << level);
+	if (level == _levelCount - 1 || !IsInRange(bounds, context.CameraPos, _GetRange(level + 1))) {
+		if (context.WholeCount + context.QuarterCount < MAX_PATCHES) {
+			context.Whole[context.WholeCount++] = _MakeInstance(level, RegionMin + glm::vec2(x, y) * nodeSize);
+		}
+		return true;
+	}
+	for (uint32_t child = 0; child < 4; child++) {
+		const uint32_t childX = x * 2 + (child & 1);
+		const uint32_t childY = y * 2 + (child >> 1);
+		// Children that are too far for their own level get drawn at ours, a quarter of our grid at a time
+		if (!_Select(level + 1, childX, childY, context) &&
+			context.ViewFrustum->Intersects(_GetNodeBounds(level + 1, childX, childY)) &&
+			context.WholeCount + context.QuarterCount < MAX_PATCHES)
+		{
+			context.QuarterCount++;
+			context.Quarters[MAX_PATCHES - context.QuarterCount] = _MakeInstance(level, RegionMin + glm::vec2(childX, childY) * (nodeSize * 0.5f));
+		}
+	}
+	return true;
+}
+
+uint32_t TerrainComponent::Select(const glm::vec3& cameraPos, const Frustum& frustum, InstanceTransform* instances, uint32_t& quarterCount) const {
+	quarterCount = 0;
+	if (!IsBuilt()) {
+		return 0;
+	}
+	SelectContext context;
+	context.CameraPos = cameraPos;
+	context.ViewFrustum = &frustum;
+	context.Whole = instances;
+	context.WholeCount = 0;
+	context.Quarters = instances;
+	context.QuarterCount = 0;
+	_Select(0, 0, 0, context);
+
+	// The quarters were written from the end backwards, they go straight after the whole nodes
+	if (context.QuarterCount > 0 && context.WholeCount != MAX_PATCHES - context.QuarterCount) {
+		std::copy(instances + MAX_PATCHES - context.QuarterCount, instances + MAX_PATCHES, instances + context.WholeCount);
+	}
+	quarterCount = context.QuarterCount;
+	return context.WholeCount + context.QuarterCount;
+}
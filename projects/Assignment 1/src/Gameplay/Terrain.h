@@ -0,0 +1,154 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Graphics/Frustum.h"
+#include "Graphics/Texture2D.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Gameplay/ShaderMaterial.h"
+#include "Utilities/VertexTypes.h"
+
+/// <summary>
+/// A square of ground shaped by a 16 bit heightmap, drawn with continuous distance-dependent levels of detail (CDLOD).
+/// The heightmap is split into a quadtree, and every node gets drawn with the same small grid of vertices, so nodes
+/// further from the camera cover more ground with the same number of triangles. Each level only reaches out to a set
+/// distance from the camera (LodDistance, doubling with each level), and the vertices near the end of a level's range
+/// slide over to where the next level's grid would put them, so there are no cracks or pops where levels meet
+///
+/// The grid is displaced in the vertex shader (terrain.vert.glsl) by sampling the heightmap, so the whole terrain
+/// only needs the heightmap and a couple of grid meshes on the GPU. The snapshot builder picks the nodes for each
+/// view, skipping any outside of it, and writes an instance for each one:
+///   Model places the grid's vertices (which are whole numbers from 0 to PATCH_SIZE) on the ground and scales the
+///   heightmap's 0 to 1 up to HeightScale, NormalMatrix[0] holds the distances the node's grid morphs over
+///
+/// The component's entity's transform is ignored, the terrain is in world space with Z up
+/// </summary>
+class TerrainComponent {
+public:
+	// The corner of the terrain with the smallest X and Y, and the length of it's sides
+	glm::vec2 RegionMin = glm::vec2(-32.0f);
+	float     Size = 64.0f;
+	// The height of the heightmap's lowest value, and how far above that the highest value is
+	float     BaseHeight = 0.0f;
+	float     HeightScale = 8.0f;
+	// How far from the camera the most detailed level reaches, each level after reaches twice as far
+	float     LodDistance = 16.0f;
+	// How many times the material's textures repeat per unit
+	float     TextureTiling = 0.25f;
+
+	// Drawn with the terrain variant of a lit shader, the heightmap gets bound to it as s_Heightmap
+	ShaderMaterial::sptr Material;
+
+	/// <summary>
+	/// The number of quads along each side of the grid every node is drawn with
+	/// </summary>
+	static const int PATCH_SIZE = 32;
+	/// <summary>
+	/// The most levels the quadtree will be split into
+	/// </summary>
+	static const int MAX_LEVELS = 12;
+	/// <summary>
+	/// The most nodes that get drawn for each view, the rest get skipped
+	/// </summary>
+	static const uint32_t MAX_PATCHES = 1024;
+
+	TerrainComponent& SetMaterial(const ShaderMaterial::sptr& material) { Material = material; return *this; }
+	TerrainComponent& SetRegion(const glm::vec2& min, float size) { RegionMin = min; Size = size; _isDirty = true; return *this; }
+	TerrainComponent& SetHeightRange(float base, float scale) { BaseHeight = base; HeightScale = scale; _isDirty = true; return *this; }
+
+	/// <summary>
+	/// Replaces the heights, the first row is along the terrain's smallest Y
+	/// </summary>
+	/// <param name="width">The number of samples along X, at least 2</param>
+	/// <param name="height">The number of samples along Y, at least 2</param>
+	/// <param name="heights">width x height samples, where 0 is BaseHeight and 65535 is BaseHeight + HeightScale</param>
+	TerrainComponent& SetHeights(uint32_t width, uint32_t height, std::vector<uint16_t> heights);
+	/// <summary>
+	/// Loads the heights from an image, using it's first channel. 16 bit images (ex: 16 bit grayscale PNGs) keep all of
+	/// their precision, 8 bit ones get scaled up
+	/// </summary>
+	/// <param name="path">The path of the image to load</param>
+	/// <returns>True if the image could be loaded</returns>
+	bool LoadHeightmap(const std::string& path);
+
+	/// <summary>
+	/// Marks everything to be built again on the next update, after changing any of the settings directly
+	/// </summary>
+	void Invalidate() { _isDirty = true; }
+
+	/// <summary>
+	/// Creates the heightmap texture, grid meshes and node bounds if the heights or region have changed, and hands the
+	/// heightmap to the material. Waits until there are heights and a material. Must be called on the main thread, and
+	/// not while a snapshot is being built
+	/// </summary>
+	/// <returns>True if anything was built again</returns>
+	bool Update();
+
+	/// <summary>
+	/// Returns true once there's something to draw
+	/// </summary>
+	bool IsBuilt() const { return _heightmap != nullptr && !_bounds.empty(); }
+
+	/// <summary>
+	/// Picks the nodes to draw for a view and writes an instance for each one, nodes drawn with their whole grid come
+	/// first, followed by the nodes that are only drawn a quarter at a time. Safe to call from any thread once built
+	/// </summary>
+	/// <param name="cameraPos">Where the view is being drawn from</param>
+	/// <param name="frustum">The view's volume, nodes outside of it get skipped</param>
+	/// <param name="instances">Where to write the instances, needs room for MAX_PATCHES</param>
+	/// <param name="quarterCount">Will store how many of the instances need the quarter grid (see GetQuarterPatch)</param>
+	/// <returns>The number of instances written</returns>
+	uint32_t Select(const glm::vec3& cameraPos, const Frustum& frustum, InstanceTransform* instances, uint32_t& quarterCount) const;
+
+	/// <summary>
+	/// Gets the grid that whole nodes get drawn with
+	/// </summary>
+	const VertexArrayObject::sptr& GetPatch() const { return _patch; }
+	/// <summary>
+	/// Gets the grid that a quarter of a node gets drawn with, at the node's spacing. Nodes whose children are only
+	/// partly in range draw the children that aren't this way
+	/// </summary>
+	const VertexArrayObject::sptr& GetQuarterPatch() const { return _quarterPatch; }
+	/// <summary>
+	/// Gets the number of levels the quadtree was split into
+	/// </summary>
+	int GetLevelCount() const { return _levelCount; }
+
+protected:
+	std::vector<uint16_t> _heights;
+	uint32_t              _width = 0;
+	uint32_t              _height = 0;
+	bool                  _isDirty = false;
+
+	Texture2D::sptr         _heightmap;
+	VertexArrayObject::sptr _patch;
+	VertexArrayObject::sptr _quarterPatch;
+	int                     _levelCount = 0;
+	// The lowest and highest heights under each node, level by level from the root down, each level in rows along X
+	std::vector<std::vector<glm::vec2>> _bounds;
+
+	// Where a node is being drawn from, and where to put what gets picked
+	struct SelectContext {
+		glm::vec3          CameraPos;
+		const Frustum*     ViewFrustum;
+		InstanceTransform* Whole;
+		uint32_t           WholeCount;
+		// Quarters get written from the end of the instances backwards, so they can be moved after the whole nodes
+		InstanceTransform* Quarters;
+		uint32_t           QuarterCount;
+	};
+
+	// Builds the node bounds from the heights
+	void _BuildBounds();
+	// Gets the world space box around a node
+	BoundingVolume _GetNodeBounds(int level, uint32_t x, uint32_t y) const;
+	// Gets how far from the camera a level reaches, level 0 being the root
+	float _GetRange(int level) const;
+	// Picks the nodes to draw under a node, returns false if the node is out of it's level's range so it's parent
+	// needs to cover it's area
+	bool _Select(int level, uint32_t x, uint32_t y, SelectContext& context) const;
+	// Makes the instance that draws an area of the terrain with the grid spacing and morph of a level
+	InstanceTransform _MakeInstance(int level, const glm::vec2& corner) const;
+};
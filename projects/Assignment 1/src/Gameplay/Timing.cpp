@@ -0,0 +1,84 @@
+#include "Timing.h"
+#include <chrono>
+#include <thread>
+#include <GLFW/glfw3.h>
+#include <Logging.h>
+
+typedef std::chrono::steady_clock Clock;
+
+Timing::Timing() {
+	_startTicks = GetTicks();
+	_frameStartTicks = _startTicks;
+	CurrentFrame = LastFrame = 0.0;
+	DeltaTime = 0.0f;
+}
+
+int64_t Timing::GetTicks() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+int64_t Timing::TicksPerSecond() {
+	return 1000000000ll;
+}
+
+double Timing::GetTime() const {
+	// Subtracting in integers first keeps full precision, only the (small) difference gets turned into a double
+	return static_cast<double>(GetTicks() - _startTicks) / static_cast<double>(TicksPerSecond());
+}
+
+double Timing::GetFramePeriod() const {
+	return TargetFrameRate > 0.0f ? 1.0 / TargetFrameRate : DefaultFramePeriod;
+}
+
+double Timing::GetFrameHeadroom() const {
+	return GetFramePeriod() - static_cast<double>(GetTicks() - _frameStartTicks) / static_cast<double>(TicksPerSecond());
+}
+
+void Timing::BeginFrame() {
+	_frameStartTicks = GetTicks();
+	if (FixedDeltaTime > 0.0f) {
+		DeltaTime = FixedDeltaTime;
+		CurrentFrame = LastFrame + FixedDeltaTime;
+		return;
+	}
+	CurrentFrame = GetTime();
+	DeltaTime = static_cast<float>(CurrentFrame - LastFrame);
+	DeltaTime = DeltaTime > MaxDeltaTime ? MaxDeltaTime : DeltaTime;
+}
+
+void Timing::WaitForNextFrame() {
+	const int64_t now = GetTicks();
+	if (TargetFrameRate <= 0.0f) {
+		_nextFrameTicks = now;
+		return;
+	}
+
+	const int64_t period   = static_cast<int64_t>(TicksPerSecond() / static_cast<double>(TargetFrameRate));
+	const int64_t lead     = static_cast<int64_t>(InputLeadTime * TicksPerSecond());
+	const int64_t spin     = static_cast<int64_t>(SpinTime * TicksPerSecond());
+	// Frames are scheduled from when the last one was due rather than from now, so the rate doesn't drift. If we've
+	// fallen more than a frame behind (or just turned the cap on), we start the schedule over instead of rushing
+	_nextFrameTicks += period;
+	if (_nextFrameTicks < now - period || _nextFrameTicks > now + period) {
+		_nextFrameTicks = now;
+	}
+
+	const int64_t wakeAt = _nextFrameTicks - lead;
+	if (wakeAt - now > spin) {
+		std::this_thread::sleep_for(std::chrono::nanoseconds(wakeAt - now - spin));
+	}
+	while (GetTicks() < wakeAt) {
+		std::this_thread::yield();
+	}
+}
+
+void Timing::SetVSync(VSyncMode mode) {
+	if (mode == VSyncMode::Adaptive &&
+		!glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+		!glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+		LOG_WARN("Adaptive vsync is not supported, using regular vsync instead");
+		mode = VSyncMode::On;
+	}
+	glfwSwapInterval(static_cast<int>(mode));
+	_vsync = mode;
+}
@@ -1,4 +1,18 @@
 #pragma once
+#include <cstdint>
+
+/// <summary>
+/// How the swap waits for the display's refresh
+/// </summary>
+enum class VSyncMode {
+	// Swap as soon as the frame is done, which may tear
+	Off      = 0,
+	// Wait for the next refresh
+	On       = 1,
+	// Wait for the refresh if we're on time, but swap straight away (and tear) if we missed it, rather than waiting a
+	// whole extra refresh. Falls back to On if the driver doesn't support it
+	Adaptive = -1
+};
 
 class Timing
 {
@@ -8,10 +22,105 @@ public:
 		return instance;
 	}
 
+	// Seconds since the clock started. These come from a 64 bit tick count, so they don't lose precision the
+	// way a float time does after running for days
 	double CurrentFrame;
 	double LastFrame;
 	float  DeltaTime;
+	// The longest DeltaTime can be, so a hitch (or sitting in the debugger) doesn't launch everything across the map
+	float  MaxDeltaTime = 1.0f;
+	// When above 0, every frame advances the clock by exactly this much no matter how long it really took, so runs
+	// play out the same way every time (ex: for benchmarks)
+	float  FixedDeltaTime = 0.0f;
+
+	// The frame rate to cap to, or 0 to run as fast as we can (or as fast as vsync allows)
+	float  TargetFrameRate = 0.0f;
+	// The limiter sleeps until this long before the frame is due, then spins for the rest. Sleeping is only accurate
+	// to a millisecond or so (worse on some systems), spinning is exact but keeps a core busy
+	double SpinTime = 0.002;
+	// How long before the frame is due the limiter lets us go, which is when input gets sampled. Setting this to
+	// about how long our CPU work for a frame takes means we sample input as late as possible and still swap on
+	// time, which cuts input latency
+	double InputLeadTime = 0.0;
+	// The length of a frame we aim for when there's no TargetFrameRate (ex: the display's refresh, with vsync on),
+	// which is what GetFrameHeadroom measures against
+	double DefaultFramePeriod = 1.0 / 60.0;
+
+	/// <summary>
+	/// Gets the number of ticks on the monotonic clock, see TicksPerSecond
+	/// </summary>
+	static int64_t GetTicks();
+	/// <summary>
+	/// Gets the number of ticks per second for GetTicks
+	/// </summary>
+	static int64_t TicksPerSecond();
+	/// <summary>
+	/// Gets the number of seconds since the clock started
+	/// </summary>
+	double GetTime() const;
+	/// <summary>
+	/// Gets the length of a frame we're aiming for, in seconds, from TargetFrameRate or DefaultFramePeriod
+	/// </summary>
+	double GetFramePeriod() const;
+	/// <summary>
+	/// Gets how long is left until this frame is due, in seconds, measured from BeginFrame. Negative once the
+	/// frame has run over
+	/// </summary>
+	double GetFrameHeadroom() const;
+
+	/// <summary>
+	/// Updates CurrentFrame and DeltaTime for a new frame, should be called once right after WaitForNextFrame
+	/// </summary>
+	void BeginFrame();
+	/// <summary>
+	/// Holds off the next frame until it's due according to TargetFrameRate (and InputLeadTime), returns straight away
+	/// when there's no cap. Should be called at the very top of the frame, before polling input
+	/// </summary>
+	void WaitForNextFrame();
+
+	/// <summary>
+	/// Sets how the swap waits for the display, needs the window's context to be current
+	/// </summary>
+	void SetVSync(VSyncMode mode);
+	VSyncMode GetVSync() const { return _vsync; }
+
+	// The length of a single simulation step, FixedUpdate always advances the simulation by exactly this much
+	float    FixedTimeStep = 1.0f / 60.0f;
+	// How far we are between the last simulation step and the next one, from 0 to 1, for interpolating what we draw
+	float    Alpha = 0.0f;
+	// The most steps we'll run in one frame, so a slow frame can't snowball into even more simulation work
+	uint32_t MaxFixedSteps = 8;
+
+	/// <summary>
+	/// Adds a frame's worth of time to the simulation clock, and works out how many fixed steps we need to run to
+	/// catch up. Updates Alpha with whatever is left over
+	/// </summary>
+	/// <param name="deltaTime">The time since the last frame, in seconds</param>
+	/// <returns>The number of times FixedUpdate should be run this frame</returns>
+	uint32_t AccumulateFixedSteps(float deltaTime) {
+		_accumulator += deltaTime;
+		uint32_t steps = 0;
+		while (_accumulator >= FixedTimeStep && steps < MaxFixedSteps) {
+			_accumulator -= FixedTimeStep;
+			steps++;
+		}
+		// If we hit the cap we just let the simulation fall behind, rather than trying to make it up next frame
+		if (_accumulator >= FixedTimeStep) {
+			_accumulator = 0.0;
+		}
+		Alpha = static_cast<float>(_accumulator / FixedTimeStep);
+		return steps;
+	}
 
 protected:
-	Timing() = default;
-};
\ No newline at end of file
+	Timing();
+
+	double _accumulator = 0.0;
+
+	// The tick the clock started on, and the tick the next frame is due on (for the limiter)
+	int64_t   _startTicks;
+	int64_t   _nextFrameTicks = 0;
+	// The tick BeginFrame was last called on, even when FixedDeltaTime is faking the clock
+	int64_t   _frameStartTicks = 0;
+	VSyncMode _vsync = VSyncMode::Off;
+};
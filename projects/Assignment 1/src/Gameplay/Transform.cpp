@@ -1,41 +1,43 @@
 #include "Transform.h"
 
+#include <algorithm>
+#include <vector>
 #include <GLM/gtc/matrix_transform.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <GLM/gtx/quaternion.hpp>
 
 #include "Logging.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/TransformKernel.h"
 
 const glm::mat4 IDENTITY = glm::mat4(1.0f);
 
+// Zero scales can't be inverted, those axes just keep the rotation (the object is flat along them anyways)
+static inline float SafeReciprocal(float value) {
+	return value != 0.0f ? 1.0f / value : 1.0f;
+}
+
 Transform& Transform::SetLocalRotation(const glm::vec3 eulerDegrees) {
-	_rotationEulerDeg = eulerDegrees;
 	_rotation = glm::quat(glm::radians(eulerDegrees));
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
 Transform& Transform::SetLocalRotation(const glm::quat& quaternion) {
 	_rotation = quaternion;
-	_rotationEulerDeg = glm::degrees(glm::eulerAngles(_rotation));
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
 Transform& Transform::SetLocalRotation(float yawDeg, float pitchDeg, float rollDeg) {
-	_rotationEulerDeg.x = yawDeg;
-	_rotationEulerDeg.y = pitchDeg;
-	_rotationEulerDeg.z = rollDeg;
-	_rotation = glm::quat(glm::radians(_rotationEulerDeg));
-	_isLocalDirty = true;
-	return *this;
+	return SetLocalRotation(glm::vec3(yawDeg, pitchDeg, rollDeg));
 }
 
 Transform& Transform::SetLocalPosition(float x, float y, float z) {
 	_position.x = x;
 	_position.y = y;
 	_position.z = z;
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
@@ -43,7 +45,7 @@ Transform& Transform::SetLocalScale(float x, float y, float z) {
 	_scale.x = x;
 	_scale.y = y;
 	_scale.z = z;
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
@@ -54,8 +56,7 @@ Transform& Transform::RotateLocal(float yawDeg, float pitchDeg, float rollDeg) {
 
 Transform& Transform::RotateLocalFixed(const glm::vec3& rotationDeg) {
 	_rotation = glm::quat(glm::radians(rotationDeg)) * _rotation;
-	_rotationEulerDeg = glm::degrees(glm::eulerAngles(_rotation));
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
@@ -66,27 +67,26 @@ Transform& Transform::RotateLocalFixed(float yawDeg, float pitchDeg, float rollD
 
 Transform& Transform::SetLocalPosition(const glm::vec3 value) {
 	_position = value;
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
 Transform& Transform::SetLocalScale(const glm::vec3 value) {
 	_scale = value;
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
 Transform& Transform::RotateLocal(const glm::vec3& rotation) {
 	_rotation = _rotation * glm::quat(glm::radians(rotation));
-	_rotationEulerDeg = glm::degrees(glm::eulerAngles(_rotation));
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
 Transform& Transform::MoveLocal(const glm::vec3& localMovement)
 {
 	_position += _rotation * localMovement;
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
@@ -98,7 +98,7 @@ Transform& Transform::MoveLocal(float x, float y, float z) {
 Transform& Transform::MoveLocalFixed(const glm::vec3& localMovement)
 {
 	_position += localMovement;
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
@@ -106,15 +106,14 @@ Transform& Transform::MoveLocalFixed(float x, float y, float z) {
 	_position.x += x;
 	_position.y += y;
 	_position.z += z;
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
 Transform& Transform::LookAt(const glm::vec3& localSpace)
 {
 	_rotation = glm::quatLookAt(-glm::normalize(_position - localSpace), glm::normalize(_rotation * glm::vec3(0, 0, 1)));
-	_rotationEulerDeg = glm::degrees(glm::eulerAngles(_rotation));
-	_isLocalDirty = true;
+	_isLocalDirty = _isWorldDirty = true;
 	return *this;
 }
 
@@ -134,44 +133,398 @@ const glm::mat3& Transform::NormalMatrix() const {
 
 void Transform::SetParent(entt::handle parent)
 {
-	_parent = parent;
+	entt::registry& registry = _gameObject.registry();
+	entt::entity newParent = entt::null;
 	// If we passed in a handle, make sure it has a transform and belongs to the same scene
 	if (&parent.registry() != nullptr && parent.entity() != entt::null) {
 		LOG_ASSERT(parent.has<Transform>(), "Parent entity must have a transform component");
-		LOG_ASSERT(&parent.registry() == &_gameObject.registry(), "Parent entity must be in same registry!");
-		_hierarchyDepth = parent.get<Transform>()._hierarchyDepth + 1;
+		LOG_ASSERT(&parent.registry() == &registry, "Parent entity must be in same registry!");
+		newParent = parent.entity();
+	}
+	_Link(registry, newParent);
+	// Only our own subtree changes depth, the pool gets sorted the next time we update the world matrices
+	_UpdateChildDepths(registry);
+}
+
+void Transform::SetParents(entt::registry& registry, const std::vector<std::pair<entt::entity, entt::entity>>& links)
+{
+	for (const auto& link : links) {
+		registry.get<Transform>(link.first)._Link(registry, link.second);
+	}
+	// The depths only need fixing from the roots of whatever moved, we mark the children first so we can skip any
+	// that are below another moved transform
+	std::vector<bool> moved(registry.size(), false);
+	for (const auto& link : links) {
+		moved[entt::to_integral(link.first) & entt::entt_traits<entt::entity>::entity_mask] = true;
+	}
+	for (const auto& link : links) {
+		bool nested = false;
+		for (entt::entity ancestor = link.second; ancestor != entt::null; ancestor = registry.get<Transform>(ancestor)._parent) {
+			if (moved[entt::to_integral(ancestor) & entt::entt_traits<entt::entity>::entity_mask]) {
+				nested = true;
+				break;
+			}
+		}
+		if (!nested) {
+			registry.get<Transform>(link.first)._UpdateChildDepths(registry);
+		}
+	}
+	_SortHierarchy(registry);
+}
+
+void Transform::OnDestroy(entt::registry& registry, entt::entity entity)
+{
+	Transform& transform = registry.get<Transform>(entity);
+	transform._Link(registry, entt::null);
+	while (transform._firstChild != entt::null) {
+		Transform& child = registry.get<Transform>(transform._firstChild);
+		child._Link(registry, entt::null);
+		child._UpdateChildDepths(registry);
+	}
+}
+
+void Transform::OnWorldMatrixAdded(entt::registry& registry, entt::entity entity)
+{
+	// Without a transform (yet) there's nothing to copy, a new transform starts dirty so the next update fills it in
+	const Transform* transform = registry.try_get<Transform>(entity);
+	if (transform != nullptr) {
+		transform->_Publish(registry.get<WorldMatrix>(entity));
+	}
+}
+
+void Transform::Stamp(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity dst)
+{
+	Transform& result = to.emplace_or_replace<Transform>(dst, from.get<Transform>(src));
+	result._gameObject = entt::handle(to, dst);
+	result._parent = result._firstChild = result._nextSibling = result._prevSibling = entt::null;
+	result._hierarchyDepth = 0;
+	result._parentIndex = INVALID_INDEX;
+	result._isWorldDirty = true;
+}
+
+void Transform::StampMany(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity* first, const entt::entity* last)
+{
+	Transform stamp = from.get<Transform>(src);
+	stamp._parent = stamp._firstChild = stamp._nextSibling = stamp._prevSibling = entt::null;
+	stamp._hierarchyDepth = 0;
+	stamp._parentIndex = INVALID_INDEX;
+	stamp._isWorldDirty = true;
+	to.insert<Transform>(first, last, stamp);
+
+	// Groups that own transforms may shuffle the pool as they're added, so we look each one up again
+	for (const entt::entity* entity = first; entity != last; entity++) {
+		to.get<Transform>(*entity)._gameObject = entt::handle(to, *entity);
+	}
+}
+
+Transform::Transform() :
+	// Handles always need a registry, so unattached transforms point at an empty one until AttachLoaded
+	Transform(entt::handle(_DetachedRegistry()))
+{}
+
+entt::registry& Transform::_DetachedRegistry()
+{
+	static entt::registry detached;
+	return detached;
+}
+
+void Transform::AttachLoaded(entt::registry& registry)
+{
+	registry.view<Transform>().each([&registry](entt::entity entity, Transform& transform) {
+		transform._gameObject = entt::handle(registry, entity);
+	});
+}
+
+void Transform::_Link(entt::registry& registry, entt::entity parent)
+{
+	const entt::entity self = _gameObject.entity();
+	// A transform can't be attached to anything underneath it, we'd end up with a loop
+	for (entt::entity ancestor = parent; ancestor != entt::null; ancestor = registry.get<Transform>(ancestor)._parent) {
+		if (ancestor == self) {
+			LOG_WARN("Cannot attach a transform to one of it's own children");
+			return;
+		}
+	}
+
+	// Take ourselves out of the old parent's list of children
+	if (_parent != entt::null) {
+		Transform& oldParent = registry.get<Transform>(_parent);
+		if (oldParent._firstChild == self) {
+			oldParent._firstChild = _nextSibling;
+		}
+	}
+	if (_prevSibling != entt::null) {
+		registry.get<Transform>(_prevSibling)._nextSibling = _nextSibling;
+	}
+	if (_nextSibling != entt::null) {
+		registry.get<Transform>(_nextSibling)._prevSibling = _prevSibling;
+	}
+	_prevSibling = _nextSibling = entt::null;
+
+	// And add ourselves to the front of the new one's
+	_parent = parent;
+	if (parent != entt::null) {
+		Transform& newParent = registry.get<Transform>(parent);
+		_nextSibling = newParent._firstChild;
+		if (_nextSibling != entt::null) {
+			registry.get<Transform>(_nextSibling)._prevSibling = self;
+		}
+		newParent._firstChild = self;
+		_hierarchyDepth = newParent._hierarchyDepth + 1;
 	} else {
 		_hierarchyDepth = 0;
 	}
-	
-	// Re-calculate hierarchy depth for all children recursively
-	_gameObject.registry().view<Transform>().each([&](entt::entity entity, Transform& t) {
-		if (t._parent == _gameObject) {
-			t.SetParent(entt::handle(parent.registry(), _gameObject));
+
+	// Our world matrix needs to be re-built against the new parent, which may be anywhere in the pool
+	_isWorldDirty = true;
+	_parentIndex = INVALID_INDEX;
+}
+
+void Transform::_UpdateChildDepths(entt::registry& registry) const
+{
+	// Walk the subtree with our own stack, deep hierarchies could overflow the call stack
+	std::vector<entt::entity> stack;
+	for (entt::entity child = _firstChild; child != entt::null; child = registry.get<Transform>(child)._nextSibling) {
+		stack.push_back(child);
+	}
+	while (!stack.empty()) {
+		Transform& transform = registry.get<Transform>(stack.back());
+		stack.pop_back();
+		transform._hierarchyDepth = registry.get<Transform>(transform._parent)._hierarchyDepth + 1;
+		for (entt::entity child = transform._firstChild; child != entt::null; child = registry.get<Transform>(child)._nextSibling) {
+			stack.push_back(child);
 		}
-	});
-	// Re-sort components
-	_gameObject.registry().sort<Transform>([](const Transform& l, const Transform& r) {
-		return l.GetHierarchyDepth() < r.GetHierarchyDepth();
-	});
+	}
 }
 
 void Transform::UpdateWorldMatrix() const {
 	if (_parent != entt::null) {
-		_worldTransform = _gameObject.registry().get<Transform>(_parent)._worldTransform * LocalTransform();
-		_worldNormalMatrix = glm::mat3(glm::transpose(glm::inverse(_worldTransform)));
+		const Transform& parent = _gameObject.registry().get<Transform>(_parent);
+		_ComposeWorld(parent._worldTransform, parent._worldNormalMatrix, parent._worldScaleClass, parent._worldScale);
+		_parentVersion = parent._worldVersion;
 	} else {
-		_worldTransform = LocalTransform();
-		_worldNormalMatrix = _normalMatrix;
+		_ComposeWorld(IDENTITY, glm::mat3(1.0f), ScaleClass::Identity, 1.0f);
+	}
+	_isWorldDirty = false;
+	_worldVersion++;
+	if (_gameObject.entity() != entt::null) {
+		WorldMatrix* world = _gameObject.registry().try_get<WorldMatrix>(_gameObject.entity());
+		if (world != nullptr) {
+			_Publish(*world);
+		}
+	}
+}
+
+// A copy of each transform's world matrices, in the same order as the pool, so children can grab their parent's
+// without going back through the registry
+struct WorldCacheEntry {
+	glm::mat4 World;
+	glm::mat3 Normal;
+	float     Scale;
+	uint32_t  Version;
+	Transform::ScaleClass Class;
+};
+static std::vector<WorldCacheEntry> WorldCache;
+
+uint32_t Transform::ParallelUpdateThreshold = 16384;
+
+// The smallest chunk of the pool worth handing to another thread
+static const size_t PARALLEL_BATCH = 1024;
+
+void Transform::UpdateWorldMatrices(entt::registry& registry) {
+	auto view = registry.view<Transform>();
+	auto worlds = registry.view<WorldMatrix>();
+	Transform* transforms = view.raw();
+	const entt::entity* entities = view.data();
+	const uint32_t count = static_cast<uint32_t>(view.size());
+	ThreadPool& pool = ThreadPool::Instance();
+	const bool parallel = count >= ParallelUpdateThreshold && pool.GetThreadCount() > 0 && !ThreadPool::IsWorkerThread();
+
+	// The pool is stored in reverse of it's iteration order, so walking it backwards should visit parents before
+	// children. The parallel update goes a level at a time, so it also needs the levels to be in order
+	bool outOfOrder = false;
+	for (uint32_t ix = count; ix-- > 0;) {
+		Transform& transform = transforms[ix];
+		if (transform._parent != entt::null) {
+			// We only need to find our parent again when the pool has been sorted, or something else was destroyed
+			if (transform._parentIndex >= count || entities[transform._parentIndex] != transform._parent) {
+				if (view.contains(transform._parent)) {
+					transform._parentIndex = static_cast<uint32_t>(&view.get(transform._parent) - transforms);
+				} else {
+					// Our parent was destroyed without OnDestroy being connected, so we become a root
+					transform._parent = transform._nextSibling = transform._prevSibling = entt::null;
+					transform._hierarchyDepth = 0;
+					transform._UpdateChildDepths(registry);
+					transform._isWorldDirty = true;
+				}
+			}
+			// Something was destroyed and swapped a child in front of it's parent
+			outOfOrder |= transform._parent != entt::null && transform._parentIndex < ix;
+		}
+		outOfOrder |= parallel && ix + 1 < count && transform._hierarchyDepth < transforms[ix + 1]._hierarchyDepth;
+	}
+	if (outOfOrder) {
+		_SortHierarchy(registry);
+		UpdateWorldMatrices(registry);
+		return;
+	}
+
+	WorldCache.resize(count);
+	// Whatever moved gets copied out to it's WorldMatrix if it has one, the lookups only read the pool's sparse set so
+	// the workers can share them
+	auto update = [transforms, entities, &worlds](uint32_t ix) {
+		if (transforms[ix]._UpdateCachedWorld(ix) && worlds.contains(entities[ix])) {
+			transforms[ix]._Publish(worlds.get(entities[ix]));
+		}
+	};
+	if (!parallel) {
+		_ComposeDirtyLocals(transforms, count);
+		for (uint32_t ix = count; ix-- > 0;) {
+			update(ix);
+		}
+		return;
+	}
+
+	// Local matrices don't depend on anything else, so they can all be built at once
+	pool.ParallelFor(count, PARALLEL_BATCH, [transforms](size_t begin, size_t end) {
+		_ComposeDirtyLocals(transforms + begin, static_cast<uint32_t>(end - begin));
+	});
+	// Everything on the same level only reads from the levels above it, so each level can be split across the
+	// workers as long as we finish one before starting the next
+	for (uint32_t levelEnd = count; levelEnd > 0;) {
+		const uint32_t depth = transforms[levelEnd - 1]._hierarchyDepth;
+		uint32_t levelBegin = levelEnd - 1;
+		while (levelBegin > 0 && transforms[levelBegin - 1]._hierarchyDepth == depth) {
+			levelBegin--;
+		}
+		pool.ParallelFor(levelEnd - levelBegin, PARALLEL_BATCH, [&update, levelBegin](size_t begin, size_t end) {
+			for (size_t ix = levelBegin + begin; ix < levelBegin + end; ix++) {
+				update(static_cast<uint32_t>(ix));
+			}
+		});
+		levelEnd = levelBegin;
 	}
 }
 
+bool Transform::_UpdateCachedWorld(uint32_t index) const {
+	bool changed = false;
+	if (_parent == entt::null) {
+		if (_isWorldDirty) {
+			_ComposeWorld(IDENTITY, glm::mat3(1.0f), ScaleClass::Identity, 1.0f);
+			_isWorldDirty = false;
+			_worldVersion++;
+			changed = true;
+		}
+	} else {
+		const WorldCacheEntry& parent = WorldCache[_parentIndex];
+		if (_isWorldDirty || _parentVersion != parent.Version) {
+			_ComposeWorld(parent.World, parent.Normal, parent.Class, parent.Scale);
+			_parentVersion = parent.Version;
+			_isWorldDirty = false;
+			_worldVersion++;
+			changed = true;
+		}
+	}
+
+	WorldCacheEntry& entry = WorldCache[index];
+	entry.World = _worldTransform;
+	entry.Normal = _worldNormalMatrix;
+	entry.Scale = _worldScale;
+	entry.Version = _worldVersion;
+	entry.Class = _worldScaleClass;
+	return changed;
+}
+
+void Transform::_Publish(WorldMatrix& world) const {
+	world.Model = _worldTransform;
+	world.Normal = _worldNormalMatrix;
+	world.Version = _worldVersion;
+}
+
+void Transform::_SortHierarchy(entt::registry& registry) {
+	registry.sort<Transform>([](const Transform& l, const Transform& r) {
+		return l.GetHierarchyDepth() < r.GetHierarchyDepth();
+	});
+}
+
 void Transform::_UpdateLocalTransformIfDirty() const {
 	if (_isLocalDirty) {
 		// TRS
 		_localTransform = glm::translate(IDENTITY, _position) * glm::toMat4(_rotation) * glm::scale(IDENTITY, _scale);
-		_normalMatrix = glm::mat3(glm::transpose(glm::inverse(_localTransform)));
-
+		_UpdateNormalMatrix();
 		_isLocalDirty = false;
 	}
 }
+
+void Transform::_UpdateNormalMatrix() const {
+	// The inverse transpose of a TRS matrix is just the rotation with the scale inverted, which is much cheaper than
+	// inverting the whole matrix. Rigid and uniformly scaled transforms (most of them) don't even need the per axis part
+	_normalMatrix = glm::toMat3(_rotation);
+	if (_scale.x == 1.0f && _scale.y == 1.0f && _scale.z == 1.0f) {
+		_scaleClass = ScaleClass::Identity;
+	} else if (_scale.x == _scale.y && _scale.x == _scale.z) {
+		_scaleClass = ScaleClass::Uniform;
+		_normalMatrix *= SafeReciprocal(_scale.x);
+	} else {
+		_scaleClass = ScaleClass::NonUniform;
+		_normalMatrix[0] *= SafeReciprocal(_scale.x);
+		_normalMatrix[1] *= SafeReciprocal(_scale.y);
+		_normalMatrix[2] *= SafeReciprocal(_scale.z);
+	}
+}
+
+// Each thread gathers into it's own scratch, since the parallel update builds local matrices on all of them at once
+static thread_local TransformSoA DirtyLocals;
+static thread_local std::vector<uint32_t> DirtyIndices;
+static thread_local std::vector<glm::mat4> DirtyMatrices;
+
+void Transform::_ComposeDirtyLocals(Transform* transforms, uint32_t count) {
+	DirtyIndices.clear();
+	for (uint32_t ix = 0; ix < count; ix++) {
+		if (transforms[ix]._isLocalDirty) {
+			DirtyIndices.push_back(ix);
+		}
+	}
+	// A handful of moved objects isn't worth gathering, the hierarchy pass will build them one at a time
+	if (DirtyIndices.size() < TransformKernel::WIDTH * 2) {
+		return;
+	}
+
+	const size_t dirtyCount = DirtyIndices.size();
+	DirtyLocals.Resize(dirtyCount);
+	for (size_t ix = 0; ix < dirtyCount; ix++) {
+		const Transform& transform = transforms[DirtyIndices[ix]];
+		DirtyLocals.Set(ix, transform._position, transform._rotation, transform._scale);
+	}
+	DirtyMatrices.resize(dirtyCount);
+	TransformKernel::Compose(DirtyLocals, 0, dirtyCount, DirtyMatrices.data());
+	for (size_t ix = 0; ix < dirtyCount; ix++) {
+		const Transform& transform = transforms[DirtyIndices[ix]];
+		transform._localTransform = DirtyMatrices[ix];
+		transform._UpdateNormalMatrix();
+		transform._isLocalDirty = false;
+	}
+}
+
+void Transform::_ComposeWorld(const glm::mat4& parentWorld, const glm::mat3& parentNormal, ScaleClass parentClass, float parentScale) const {
+	_UpdateLocalTransformIfDirty();
+	_worldTransform = parentWorld * _localTransform;
+	_worldScaleClass = std::max(parentClass, _scaleClass);
+	switch (_worldScaleClass) {
+		// Nothing in the chain scales, so the world matrix is a pure rotation and translation
+		case ScaleClass::Identity:
+			_worldScale = 1.0f;
+			_worldNormalMatrix = glm::mat3(_worldTransform);
+			break;
+		// Uniform scales commute with the rotations, so we only need to divide out the combined scale
+		case ScaleClass::Uniform:
+			_worldScale = parentScale * (_scaleClass == ScaleClass::Uniform ? _scale.x : 1.0f);
+			_worldNormalMatrix = glm::mat3(_worldTransform) * SafeReciprocal(_worldScale * _worldScale);
+			break;
+		// The inverse transpose of a product is the product of the inverse transposes, so we still don't need a full inverse
+		default:
+			_worldScale = 1.0f;
+			_worldNormalMatrix = parentNormal * _normalMatrix;
+			break;
+	}
+}
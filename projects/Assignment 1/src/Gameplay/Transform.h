@@ -1,9 +1,26 @@
 #pragma once
 #include <entt.hpp>
 #include <memory>
+#include <utility>
+#include <vector>
 #include <GLM/glm.hpp>
 #include <GLM/gtc/quaternion.hpp>
 
+namespace cereal { class access; }
+
+/// <summary>
+/// The world matrices of a transform that something draws, which is all the render path reads. They're copied out of
+/// the Transform whenever it moves into a component of their own, so the renderers' group can own them alongside
+/// RendererComponent and read both in one packed walk, without touching the rest of the (much larger) Transform.
+/// Added to every entity with a RendererComponent by the scene, and kept up to date by Transform::UpdateWorldMatrices
+/// </summary>
+struct WorldMatrix {
+	glm::mat4 Model = glm::mat4(1.0f);
+	glm::mat3 Normal = glm::mat3(1.0f);
+	// The transform's world version when it was copied, see Transform::GetWorldVersion
+	uint32_t  Version = 0;
+};
+
 /// <summary>
 /// A simple transformation class, without parent/child relationships
 /// </summary>
@@ -11,22 +28,44 @@ class Transform final
 {
 public:
 	struct TransformDirtyTag { };
+
+	/// <summary>
+	/// Describes how a transform scales, which decides how much work it takes to build the normal matrix. Ordered
+	/// from cheapest to most expensive, so the class of a combined transform is the largest of it's parts
+	/// </summary>
+	enum class ScaleClass : uint8_t {
+		Identity,
+		Uniform,
+		NonUniform
+	};
 	
 	Transform(entt::handle gameObject) :
 		_isLocalDirty(true),
 		_localTransform(glm::mat4(1.0f)),
 		_normalMatrix(glm::mat3(1.0f)),
+		_scaleClass(ScaleClass::Identity),
 		_isWorldDirty(true),
 		_worldTransform(glm::mat4(1.0f)),
 		_worldNormalMatrix(glm::mat3(1.0f)),
+		_worldScaleClass(ScaleClass::Identity),
+		_worldScale(1.0f),
 		_rotation(glm::quat(1.0f, 0.0f, 0.0f, 0.0f)),
-		_rotationEulerDeg(glm::vec3(0.0f)),
 		_position(glm::vec3(0.0f)),
 		_scale(glm::vec3(1.0f)),
 		_parent(entt::null),
+		_firstChild(entt::null),
+		_nextSibling(entt::null),
+		_prevSibling(entt::null),
 		_gameObject(gameObject),
-		_hierarchyDepth(0)
+		_hierarchyDepth(0),
+		_worldVersion(0),
+		_parentVersion(0),
+		_parentIndex(INVALID_INDEX)
 	{}
+	/// <summary>
+	/// Creates a transform that isn't attached to anything yet, used when loading scenes (see AttachLoaded)
+	/// </summary>
+	Transform();
 	Transform(const Transform& other) = default;
 	Transform(Transform&& other) = default;
 	Transform& operator =(const Transform & other) = default;
@@ -36,9 +75,10 @@ public:
 	// Rotation Getters/Setters
 
 	/// <summary>
-	/// Gets the local rotation of the transform in euler degrees
+	/// Gets the local rotation of the transform in euler degrees. Only the quaternion is stored, so this is worked out
+	/// from it each time and may not match the angles it was set with
 	/// </summary>
-	const glm::vec3& GetLocalRotation() const { return _rotationEulerDeg; }
+	glm::vec3 GetLocalRotation() const { return glm::degrees(glm::eulerAngles(_rotation)); }
 	/// <summary>
 	/// Returns the local rotation as a quaternion
 	/// </summary>
@@ -188,13 +228,69 @@ public:
 	/// </summary>
 	const glm::mat3& NormalMatrix() const;
 
+	/// <summary>
+	/// Attaches this transform to a new parent, or detaches it if the handle is null. Only this transform's own
+	/// subtree gets touched, the pool gets re-sorted by the next UpdateWorldMatrices if it needs to be
+	/// </summary>
+	/// <param name="parent">The new parent, must be in the same registry</param>
 	void SetParent(entt::handle parent);
+	/// <summary>
+	/// Re-parents many transforms at once, and sorts the pool a single time at the end. Use this when building
+	/// large hierarchies (ex: spawning a prefab with lots of parts)
+	/// </summary>
+	/// <param name="registry">The registry that all of the transforms are in</param>
+	/// <param name="links">Pairs of (child, parent) entities, parents may be entt::null to detach the child</param>
+	static void SetParents(entt::registry& registry, const std::vector<std::pair<entt::entity, entt::entity>>& links);
+
+	/// <summary>
+	/// Gets the entity this transform is attached to, or entt::null if it's a root
+	/// </summary>
+	entt::entity GetParent() const { return _parent; }
+	/// <summary>
+	/// Gets the first of this transform's children, or entt::null if it has none. The rest can be found by
+	/// following GetNextSibling on each child
+	/// </summary>
+	entt::entity GetFirstChild() const { return _firstChild; }
+	/// <summary>
+	/// Gets the next child of this transform's parent, or entt::null if this is the last one
+	/// </summary>
+	entt::entity GetNextSibling() const { return _nextSibling; }
 
 	void UpdateWorldMatrix() const;
 
+	/// <summary>
+	/// Updates the world matrices of every transform in the registry in a single pass over the pool, which is kept
+	/// sorted by hierarchy depth so parents are always done before their children. Transforms that haven't moved
+	/// (and whose parents haven't moved) are skipped, so static scenes cost next to nothing
+	///
+	/// Registries with at least ParallelUpdateThreshold transforms are updated a hierarchy level at a time, with each
+	/// level split across the thread pool
+	/// </summary>
+	/// <param name="registry">The registry to update the transforms for</param>
+	static void UpdateWorldMatrices(entt::registry& registry);
+
+	/// <summary>
+	/// The number of transforms a registry needs before UpdateWorldMatrices spreads the work across the thread pool,
+	/// below this the cost of handing out the work outweighs the gain
+	/// </summary>
+	static uint32_t ParallelUpdateThreshold;
+
 	const glm::mat4& WorldTransform() const { return _worldTransform; }
+	/// <summary>
+	/// Gets a number that changes every time the world transform does, so other systems can tell when it's moved
+	/// </summary>
+	uint32_t GetWorldVersion() const { return _worldVersion; }
 	const glm::mat3& WorldNormalMatrix() const { return _worldNormalMatrix; };
 
+	/// <summary>
+	/// Gets how this transform scales in local space, updating it if required
+	/// </summary>
+	ScaleClass GetScaleClass() const { _UpdateLocalTransformIfDirty(); return _scaleClass; }
+	/// <summary>
+	/// Gets how this transform scales in world space, as of the last world matrix update
+	/// </summary>
+	ScaleClass GetWorldScaleClass() const { return _worldScaleClass; }
+
 	/// <summary>
 	/// Gets the depth of this transform within the scene hierarchy (ie. how many parents
 	/// to the root)
@@ -202,23 +298,96 @@ public:
 	/// <returns></returns>
 	int GetHierarchyDepth() const { return _hierarchyDepth; }
 
+	/// <summary>
+	/// Unlinks a transform from the hierarchy when it's destroyed, it's children become roots. Connected to the
+	/// registry's on_destroy signal by the scene
+	/// </summary>
+	static void OnDestroy(entt::registry& registry, entt::entity entity);
+	/// <summary>
+	/// Fills in a new WorldMatrix from the entity's transform, as of the last world matrix update. Connected to the
+	/// registry's on_construct signal by the scene
+	/// </summary>
+	static void OnWorldMatrixAdded(entt::registry& registry, entt::entity entity);
+	/// <summary>
+	/// Copies a transform into another registry without any of it's hierarchy, since the parent and children are
+	/// entities in the source registry. Used by the scene to stamp prefabs
+	/// </summary>
+	static void Stamp(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity dst);
+	/// <summary>
+	/// Same as Stamp, but for a whole range of new entities at once. Used by the scene to instantiate prefabs in bulk
+	/// </summary>
+	static void StampMany(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity* first, const entt::entity* last);
+	/// <summary>
+	/// Points every transform in the registry back at it's own entity, should be called once transforms have been
+	/// loaded from a scene file, since the file can't store the registry they belong to
+	/// </summary>
+	static void AttachLoaded(entt::registry& registry);
+
 private:
+	friend class cereal::access;
+
+	// Only the local state and the hierarchy are saved, everything else gets rebuilt by the next update
+	template <typename Archive>
+	void save(Archive& archive) const {
+		archive(_position, _rotation, _scale, _parent, _firstChild, _nextSibling, _prevSibling, _hierarchyDepth);
+	}
+	template <typename Archive>
+	void load(Archive& archive) {
+		archive(_position, _rotation, _scale, _parent, _firstChild, _nextSibling, _prevSibling, _hierarchyDepth);
+		_isLocalDirty = _isWorldDirty = true;
+		_parentIndex = INVALID_INDEX;
+	}
+	// The registry that transforms made with the default constructor point at
+	static entt::registry& _DetachedRegistry();
+
 	mutable bool _isLocalDirty;
 	mutable glm::mat4 _localTransform;
 	mutable glm::mat3 _normalMatrix;
+	mutable ScaleClass _scaleClass;
 
 	mutable bool _isWorldDirty;
 	mutable glm::mat4 _worldTransform;
 	mutable glm::mat3 _worldNormalMatrix;
+	mutable ScaleClass _worldScaleClass;
+	// The combined scale of everything up to the root, only valid when the world scale class is uniform
+	mutable float _worldScale;
 	
 	glm::quat _rotation;
-	glm::vec3 _rotationEulerDeg;
 	glm::vec3 _position;
 	glm::vec3 _scale;
 
 	entt::entity _parent;
+	// Children are kept in a doubly linked list through their siblings, so re-parenting never has to search for them
+	entt::entity _firstChild;
+	entt::entity _nextSibling;
+	entt::entity _prevSibling;
 	entt::handle _gameObject;
 	int _hierarchyDepth;
 
+	// Bumped every time the world matrix changes, so children can tell if they need to update
+	mutable uint32_t _worldVersion;
+	// The parent's version when we last updated, and where the parent was in the pool at the time
+	mutable uint32_t _parentVersion;
+	mutable uint32_t _parentIndex;
+
+	static const uint32_t INVALID_INDEX = ~0u;
+
 	void _UpdateLocalTransformIfDirty() const;
+	// Builds our normal matrix and scale class from our rotation and scale, once the local matrix is up to date
+	void _UpdateNormalMatrix() const;
+	// Builds the local matrices of every dirty transform in the pool with the batched kernel, when there's enough of them
+	static void _ComposeDirtyLocals(Transform* transforms, uint32_t count);
+	// Updates our world matrix from our parent's entry in the world cache if either of us moved, and stores the result
+	// in our own entry. Returns true if the world matrix changed
+	bool _UpdateCachedWorld(uint32_t index) const;
+	// Copies our world matrices out to the entity's WorldMatrix
+	void _Publish(WorldMatrix& world) const;
+	// Builds our world matrix from our parent's, picking the cheapest way to get the normal matrix for our scale class
+	void _ComposeWorld(const glm::mat4& parentWorld, const glm::mat3& parentNormal, ScaleClass parentClass, float parentScale) const;
+	// Sorts the transform pool so that parents always come before their children
+	static void _SortHierarchy(entt::registry& registry);
+	// Moves this transform from it's current parent's list of children to the new parent's
+	void _Link(entt::registry& registry, entt::entity parent);
+	// Re-calculates the depths of everything below this transform
+	void _UpdateChildDepths(entt::registry& registry) const;
 };
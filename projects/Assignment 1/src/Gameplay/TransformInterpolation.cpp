@@ -0,0 +1,43 @@
+#include "TransformInterpolation.h"
+
+#include "Transform.h"
+
+void TransformInterpolation::BeginFixedStep(entt::registry& registry) {
+	registry.view<InterpolatedTransform, Transform>().each([](InterpolatedTransform& state, Transform& transform) {
+		if (state.IsSmoothed) {
+			// Drawing left the transform somewhere between two steps, the simulation needs to carry on from the last one
+			transform.SetLocalPosition(state.Position);
+			transform.SetLocalRotation(state.Rotation);
+			transform.SetLocalScale(state.Scale);
+			state.IsSmoothed = false;
+		}
+		state.PreviousPosition = transform.GetLocalPosition();
+		state.PreviousRotation = transform.GetLocalRotationQuat();
+		state.PreviousScale = transform.GetLocalScale();
+	});
+}
+
+void TransformInterpolation::Interpolate(entt::registry& registry, float alpha, bool stepped) {
+	registry.view<InterpolatedTransform, Transform>().each([alpha, stepped](InterpolatedTransform& state, Transform& transform) {
+		if (stepped || !state.HasState) {
+			state.Position = transform.GetLocalPosition();
+			state.Rotation = transform.GetLocalRotationQuat();
+			state.Scale = transform.GetLocalScale();
+			if (!state.HasState) {
+				// Nothing to blend from yet
+				state.PreviousPosition = state.Position;
+				state.PreviousRotation = state.Rotation;
+				state.PreviousScale = state.Scale;
+				state.HasState = true;
+			}
+		}
+		// Things that didn't move this step don't need their matrices rebuilt
+		if (state.PreviousPosition == state.Position && state.PreviousRotation == state.Rotation && state.PreviousScale == state.Scale) {
+			return;
+		}
+		transform.SetLocalPosition(glm::mix(state.PreviousPosition, state.Position, alpha));
+		transform.SetLocalRotation(glm::slerp(state.PreviousRotation, state.Rotation, alpha));
+		transform.SetLocalScale(glm::mix(state.PreviousScale, state.Scale, alpha));
+		state.IsSmoothed = true;
+	});
+}
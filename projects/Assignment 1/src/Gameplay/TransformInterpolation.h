@@ -0,0 +1,55 @@
+#pragma once
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+/// <summary>
+/// Marks an entity that is moved by the fixed rate simulation, so what we draw can be smoothed between the last two
+/// simulation steps instead of jumping once per step. Entities with this should only be moved from FixedUpdate, since
+/// their transform holds the smoothed state while we're drawing
+/// </summary>
+struct InterpolatedTransform
+{
+	glm::vec3 PreviousPosition;
+	glm::quat PreviousRotation;
+	glm::vec3 PreviousScale;
+	glm::vec3 Position;
+	glm::quat Rotation;
+	glm::vec3 Scale;
+	// False until we've seen the first simulation step, before that the transform is already the simulation state
+	bool      HasState = false;
+	// True while the transform holds a blended state for drawing, rather than the simulation state
+	bool      IsSmoothed = false;
+
+	// The simulation state is in the transform, so there's nothing to save until the first step after loading
+	template <typename Archive>
+	void serialize(Archive& archive) { }
+};
+
+/// <summary>
+/// Swaps interpolated transforms between their simulation state (for FixedUpdate) and their smoothed state (for
+/// drawing) around the fixed steps each frame
+/// </summary>
+class TransformInterpolation final
+{
+public:
+	/// <summary>
+	/// Puts every interpolated transform back to it's simulation state and remembers it as the previous state, call
+	/// before each fixed step
+	/// </summary>
+	/// <param name="registry">The registry to update the transforms in</param>
+	static void BeginFixedStep(entt::registry& registry);
+
+	/// <summary>
+	/// Moves every interpolated transform part way between it's previous and current simulation states, call once a
+	/// frame after the fixed steps
+	/// </summary>
+	/// <param name="registry">The registry to update the transforms in</param>
+	/// <param name="alpha">How far between the two states to go, from 0 to 1 (see Timing::Alpha)</param>
+	/// <param name="stepped">True if any fixed steps ran this frame, meaning the transforms hold a new simulation state</param>
+	static void Interpolate(entt::registry& registry, float alpha, bool stepped);
+
+protected:
+	TransformInterpolation() = default;
+	~TransformInterpolation() = default;
+};
@@ -0,0 +1,90 @@
+#include "VertexAnimationTexture.h"
+
+#include <algorithm>
+
+#include "Graphics/GpuResources.h"
+#include "Graphics/Texture2DData.h"
+#include "Logging.h"
+#include "Utilities/CpuProfiler.h"
+
+std::atomic<uint32_t> VertexAnimationTexture::_liveCount(0);
+
+VertexAnimationTexture::VertexAnimationTexture() {
+	_liveCount++;
+}
+
+VertexAnimationTexture::~VertexAnimationTexture() {
+	_liveCount--;
+}
+
+VertexAnimationTexture::sptr VertexAnimationTexture::Bake(MeshBuilder<VertexPosNormTexCol>& mesh, uint32_t frameCount, float duration, const PoseFunc& pose) {
+	LOG_ASSERT(frameCount > 0 && duration > 0.0f, "Vertex animations need at least one frame and a length!");
+	GPU_RESOURCE_OWNER("VertexAnimation");
+	PROFILE_SCOPE("BakeVertexAnimation");
+
+	const uint32_t vertexCount = static_cast<uint32_t>(mesh.GetVertexCount());
+	const uint32_t width = std::min(vertexCount, MAX_WIDTH);
+	const uint32_t blockRows = width == 0 ? 0 : (vertexCount + width - 1) / width;
+	const uint32_t height = frameCount * 2 * blockRows;
+	// The index has to fit in the color's first three channels
+	if (vertexCount == 0 || vertexCount > 0xFFFFFF || height > static_cast<uint32_t>(ITexture::GetLimits().MAX_TEXTURE_SIZE)) {
+		LOG_WARN("Can't bake a vertex animation of {} frames for a mesh with {} vertices", frameCount, vertexCount);
+		return nullptr;
+	}
+
+	// Each vertex remembers it's index, and the rest pose is what each frame starts from
+	std::vector<glm::vec3> restPositions(vertexCount);
+	std::vector<glm::vec3> restNormals(vertexCount);
+	for (uint32_t ix = 0; ix < vertexCount; ix++) {
+		VertexPosNormTexCol& vertex = mesh.GetVertex(ix);
+		restPositions[ix] = vertex.Position;
+		restNormals[ix] = vertex.Normal;
+		vertex.Color = glm::vec4(ix & 0xFF, (ix >> 8) & 0xFF, (ix >> 16) & 0xFF, 255.0f) / 255.0f;
+	}
+
+	// The bounds need to cover every frame, not just the rest pose
+	glm::vec3 min = restPositions[0];
+	glm::vec3 max = restPositions[0];
+	std::vector<glm::vec4> texels(static_cast<size_t>(width) * height, glm::vec4(0.0f));
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		positions = restPositions;
+		normals = restNormals;
+		pose(duration * frame / frameCount, positions, normals);
+		glm::vec4* positionBlock = texels.data() + static_cast<size_t>(frame * 2) * blockRows * width;
+		glm::vec4* normalBlock = positionBlock + static_cast<size_t>(blockRows) * width;
+		for (uint32_t ix = 0; ix < vertexCount; ix++) {
+			positionBlock[ix] = glm::vec4(positions[ix] - restPositions[ix], 1.0f);
+			normalBlock[ix] = glm::vec4(glm::normalize(normals[ix]), 0.0f);
+			min = glm::min(min, positions[ix]);
+			max = glm::max(max, positions[ix]);
+		}
+	}
+
+	sptr result = std::make_shared<VertexAnimationTexture>();
+	result->_frameCount = frameCount;
+	result->_duration = duration;
+	result->_blockRows = blockRows;
+	result->_mesh = mesh.Bake<VertexPackedPosNormTexCol>();
+	result->_mesh->SetBounds(BoundingVolume(min, max));
+
+	// The shader blends between frames itself, so the texels are never filtered
+	Texture2DDescription description;
+	description.Width = width;
+	description.Height = height;
+	description.Format = InternalFormat::RGBA16F;
+	description.HorizontalWrap = WrapMode::ClampToEdge;
+	description.VerticalWrap = WrapMode::ClampToEdge;
+	description.MinificationFilter = MinFilter::Nearest;
+	description.MagnificationFilter = MagFilter::Nearest;
+	description.GenerateMipMaps = false;
+	result->_texture = Texture2D::Create(description);
+	result->_texture->LoadData(std::make_shared<Texture2DData>(width, height, PixelFormat::RGBA, PixelType::Float, texels.data(), InternalFormat::RGBA16F));
+	return result;
+}
+
+void VertexAnimationTexture::Apply(const ShaderMaterial::sptr& material, float phaseSpread) const {
+	material->Set("s_VertexAnimation", _texture);
+	material->Set("u_VertexAnimation", glm::vec4(static_cast<float>(_frameCount), _frameCount / _duration, static_cast<float>(_blockRows), phaseSpread));
+}
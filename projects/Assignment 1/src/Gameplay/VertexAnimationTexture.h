@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Graphics/Texture2D.h"
+#include "Graphics/VertexArrayObject.h"
+#include "ShaderMaterial.h"
+#include "Utilities/MeshBuilder.h"
+#include "Utilities/VertexTypes.h"
+
+/// <summary>
+/// A looping animation baked into a texture, so animated props can be drawn by vertex_animation.vert.glsl without any
+/// bones or updates on the CPU. Every instance of the mesh plays the clip back on the GPU from the frame time, so any
+/// number of them still draw as one batch
+///
+/// The texture is RGBA16F, and holds a block of texels for each frame's positions followed by a block for it's normals.
+/// Each block has a texel for each vertex, in rows of up to MAX_WIDTH. Positions are stored as offsets from the rest
+/// pose (which stays in the mesh) since they keep more precision that way. The shader finds a vertex's texels from
+/// it's index, which gets written into the vertex's color since gl_VertexID doesn't account for the base vertex of
+/// a mesh in the arena
+///
+/// Instances start the clip at different points based on where they are, so a field of the same prop doesn't move in
+/// lockstep
+/// </summary>
+class VertexAnimationTexture final
+{
+public:
+	typedef std::shared_ptr<VertexAnimationTexture> sptr;
+	// We'll disallow moving and copying, since we own GPU resources
+	VertexAnimationTexture(const VertexAnimationTexture& other) = delete;
+	VertexAnimationTexture(VertexAnimationTexture&& other) = delete;
+	VertexAnimationTexture& operator=(const VertexAnimationTexture& other) = delete;
+	VertexAnimationTexture& operator=(VertexAnimationTexture&& other) = delete;
+
+public:
+	/// <summary>
+	/// Moves the vertices into their pose at a point in the clip. The positions and normals start out in the rest
+	/// pose, in the mesh's own space
+	/// </summary>
+	typedef std::function<void(float time, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals)> PoseFunc;
+
+	/// <summary>
+	/// The most texels in each row of the texture
+	/// </summary>
+	static const uint32_t MAX_WIDTH = 2048;
+
+	/// <summary>
+	/// Records a clip by posing the mesh at evenly spaced times, and bakes the mesh with each vertex's index in it's
+	/// color. Anything that changes the vertices (ex: welding or optimizing the mesh) must be done before baking. Must
+	/// be called on the main thread
+	/// </summary>
+	/// <param name="mesh">The mesh to animate, it's vertex colors get replaced</param>
+	/// <param name="frameCount">The number of frames to record, the clip loops back from the last to the first</param>
+	/// <param name="duration">The length of the clip, in seconds</param>
+	/// <param name="pose">Poses the mesh for each frame</param>
+	/// <returns>The baked animation, or nullptr if the mesh is too big to fit in a texture</returns>
+	static sptr Bake(MeshBuilder<VertexPosNormTexCol>& mesh, uint32_t frameCount, float duration, const PoseFunc& pose);
+
+	VertexAnimationTexture();
+	~VertexAnimationTexture();
+
+	/// <summary>
+	/// Gets the number of animations that are alive, anything drawn with one of them moves every frame
+	/// </summary>
+	static uint32_t GetLiveCount() { return _liveCount; }
+
+	/// <summary>
+	/// Points a material (using a variant of vertex_animation.vert.glsl) at the animation
+	/// </summary>
+	/// <param name="material">The material to set up</param>
+	/// <param name="phaseSpread">How much of the clip instances get spread over, 0 plays every instance in step</param>
+	void Apply(const ShaderMaterial::sptr& material, float phaseSpread = 1.0f) const;
+
+	/// <summary>
+	/// Gets the mesh to draw, it's bounds cover every frame of the clip
+	/// </summary>
+	const VertexArrayObject::sptr& GetMesh() const { return _mesh; }
+	/// <summary>
+	/// Gets the texture holding the frames
+	/// </summary>
+	const Texture2D::sptr& GetTexture() const { return _texture; }
+	uint32_t GetFrameCount() const { return _frameCount; }
+	float GetDuration() const { return _duration; }
+
+protected:
+	VertexArrayObject::sptr _mesh;
+	Texture2D::sptr         _texture;
+	uint32_t                _frameCount = 0;
+	float                   _duration = 0.0f;
+	// The rows each block of positions or normals takes up
+	uint32_t                _blockRows = 0;
+
+	static std::atomic<uint32_t> _liveCount;
+};
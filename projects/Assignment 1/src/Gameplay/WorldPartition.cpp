@@ -0,0 +1,269 @@
+#include "WorldPartition.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+#include "Logging.h"
+#include "RendererComponent.h"
+#include "StaticBatcher.h"
+#include "Transform.h"
+#include "Utilities/AssetManager.h"
+#include "Utilities/CpuProfiler.h"
+
+const char* WorldPartition::MANIFEST_NAME = "world.json";
+
+// Bumped whenever the layout of the manifest changes
+static const uint32_t WORLD_VERSION = 1;
+
+uint32_t WorldPartition::Partition(GameScene& scene, const std::string& folder, float cellSize, const SceneAssets& assets) {
+	LOG_ASSERT(cellSize > 0.0f, "Cells must have a size!");
+	entt::registry& registry = scene.Registry();
+
+	// Sort the scenery into cells by where it sits, the map keeps the cells in a stable order for the manifest
+	std::map<std::pair<int, int>, std::vector<entt::entity>> cells;
+	registry.view<StaticTag, RendererComponent, Transform>().each([&](entt::entity entity, RendererComponent& renderer, Transform& transform) {
+		std::string path;
+		glm::vec4 color;
+		// Hierarchies would get split between cells, and meshes made in code have no file to stream them from
+		if (transform.GetParent() != entt::null || transform.GetFirstChild() != entt::null ||
+			!AssetManager::GetMeshSource(renderer.Mesh, path, color)) {
+			return;
+		}
+		const glm::vec3& position = transform.GetLocalPosition();
+		cells[{ (int)glm::floor(position.x / cellSize), (int)glm::floor(position.y / cellSize) }].push_back(entity);
+	});
+
+	std::vector<CellInfo> infos;
+	infos.reserve(cells.size());
+	for (const auto& [coord, entities] : cells) {
+		CellInfo info;
+		info.Coord = glm::ivec2(coord.first, coord.second);
+		info.File = "cell_" + std::to_string(coord.first) + "_" + std::to_string(coord.second) + ".scene";
+		info.EntityCount = static_cast<uint32_t>(entities.size());
+
+		// Copy the cell's entities into a scene of their own so they can be saved like any other scene
+		GameScene::sptr staging = GameScene::Create(info.File);
+		for (entt::entity entity : entities) {
+			GameScene::StampEntity(registry, entity, staging->Registry());
+
+			std::string path;
+			glm::vec4 color;
+			AssetManager::GetMeshSource(registry.get<RendererComponent>(entity).Mesh, path, color);
+			bool isListed = false;
+			for (size_t ix = 0; ix < info.Meshes.size() && !isListed; ix++) {
+				isListed = info.Meshes[ix] == path && info.Colors[ix] == color;
+			}
+			if (!isListed) {
+				info.Meshes.push_back(path);
+				info.Colors.push_back(color);
+			}
+		}
+		SceneSerializer::Save(*staging, folder + "/" + info.File, assets);
+		registry.destroy(entities.begin(), entities.end());
+		infos.push_back(std::move(info));
+	}
+
+	std::ofstream file(folder + "/" + MANIFEST_NAME);
+	if (!file) {
+		throw std::runtime_error("Failed to open world manifest for writing: " + folder + "/" + MANIFEST_NAME);
+	}
+	cereal::JSONOutputArchive archive(file);
+	archive(cereal::make_nvp("Version", WORLD_VERSION), cereal::make_nvp("CellSize", cellSize), cereal::make_nvp("Cells", infos));
+	return static_cast<uint32_t>(infos.size());
+}
+
+WorldPartition::WorldPartition(GameScene& scene, const SceneAssets& assets) :
+	_scene(scene),
+	_assets(assets),
+	_folder(""),
+	_cellSize(1.0f),
+	_lastCameraPos(glm::vec3(0.0f)),
+	_velocity(glm::vec3(0.0f)),
+	_hasCameraPos(false)
+{ }
+
+void WorldPartition::Open(const std::string& folder) {
+	// Anything from the last world we were streaming goes right away
+	for (Cell& cell : _cells) {
+		for (entt::entity entity : cell.Entities) {
+			if (_scene.Registry().valid(entity)) {
+				_scene.Registry().destroy(entity);
+			}
+		}
+	}
+	_cells.clear();
+	_hasCameraPos = false;
+	_velocity = glm::vec3(0.0f);
+
+	const std::string path = folder + "/" + MANIFEST_NAME;
+	std::ifstream file(path);
+	if (!file) {
+		throw std::runtime_error("Failed to open world manifest: " + path);
+	}
+	cereal::JSONInputArchive archive(file);
+	uint32_t version = 0;
+	archive(cereal::make_nvp("Version", version));
+	if (version != WORLD_VERSION) {
+		throw std::runtime_error("World manifest is version " + std::to_string(version) + ", expected " + std::to_string(WORLD_VERSION));
+	}
+	std::vector<CellInfo> infos;
+	archive(cereal::make_nvp("CellSize", _cellSize), cereal::make_nvp("Cells", infos));
+	_folder = folder;
+	_cells.resize(infos.size());
+	for (size_t ix = 0; ix < infos.size(); ix++) {
+		_cells[ix].Info = std::move(infos[ix]);
+	}
+	LOG_INFO("Opened world \"{}\" with {} cells", folder, _cells.size());
+}
+
+void WorldPartition::Update(const glm::vec3& cameraPos, float deltaTime) {
+	if (_cells.empty()) {
+		return;
+	}
+	PROFILE_SCOPE("WorldPartition");
+
+	// Smooth the velocity out a bit, so a single jittery frame doesn't send us loading the wrong side of the map
+	if (_hasCameraPos && deltaTime > 0.0f) {
+		_velocity = glm::mix(_velocity, (cameraPos - _lastCameraPos) / deltaTime, 0.2f);
+	}
+	_lastCameraPos = cameraPos;
+	_hasCameraPos = true;
+	const glm::vec3 predicted = cameraPos + _velocity * PrefetchTime;
+
+	// Work out which cells should be coming in and which should be going out
+	std::vector<std::pair<float, size_t>> wanted;
+	uint32_t loading = 0;
+	for (size_t ix = 0; ix < _cells.size(); ix++) {
+		Cell& cell = _cells[ix];
+		const float distance = glm::min(_DistanceToCell(cell, cameraPos), _DistanceToCell(cell, predicted));
+		switch (cell.State) {
+			case CellState::Unloaded:
+				if (distance <= LoadRadius) {
+					wanted.push_back({ distance, ix });
+				}
+				break;
+			case CellState::LoadingAssets:
+				if (distance > UnloadRadius) {
+					// Nothing has been spawned yet, so we can just forget about it. The meshes still finish loading
+					_ResetCell(cell);
+				} else {
+					loading++;
+				}
+				break;
+			case CellState::Spawning:
+			case CellState::Loaded:
+				if (distance > UnloadRadius) {
+					cell.Staging = nullptr;
+					cell.StagedEntities.clear();
+					cell.State = CellState::Unloading;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	// The closest cells get to start loading first
+	std::sort(wanted.begin(), wanted.end());
+	for (const auto& [distance, ix] : wanted) {
+		if (loading >= MaxConcurrentLoads) {
+			break;
+		}
+		Cell& cell = _cells[ix];
+		for (size_t mesh = 0; mesh < cell.Info.Meshes.size(); mesh++) {
+			cell.MeshLoads.push_back(AssetManager::GetMeshAsync(cell.Info.Meshes[mesh], cell.Info.Colors[mesh]));
+		}
+		cell.State = CellState::LoadingAssets;
+		loading++;
+	}
+
+	// Then move every cell along as far as the budgets allow
+	uint32_t spawnBudget = LoadBudget;
+	uint32_t destroyBudget = UnloadBudget;
+	for (Cell& cell : _cells) {
+		if (cell.State == CellState::LoadingAssets) {
+			if (!std::all_of(cell.MeshLoads.begin(), cell.MeshLoads.end(), [](const Task<VertexArrayObject::sptr>& load) { return load.IsDone(); })) {
+				continue;
+			}
+			for (const Task<VertexArrayObject::sptr>& load : cell.MeshLoads) {
+				if (!load.HasFailed()) {
+					cell.Meshes.push_back(load.Get());
+				}
+			}
+			cell.MeshLoads.clear();
+			// With the meshes in the AssetManager's cache, reading the cell's file doesn't have to wait on anything
+			if (_StageCell(cell)) {
+				cell.State = CellState::Spawning;
+			} else {
+				_ResetCell(cell);
+				cell.State = CellState::Failed;
+			}
+		}
+		if (cell.State == CellState::Spawning) {
+			while (spawnBudget > 0 && !cell.StagedEntities.empty()) {
+				cell.Entities.push_back(GameScene::StampEntity(cell.Staging->Registry(), cell.StagedEntities.back(), _scene.Registry()).entity());
+				cell.StagedEntities.pop_back();
+				spawnBudget--;
+			}
+			if (cell.StagedEntities.empty()) {
+				cell.Staging = nullptr;
+				cell.State = CellState::Loaded;
+			}
+		} else if (cell.State == CellState::Unloading) {
+			while (destroyBudget > 0 && !cell.Entities.empty()) {
+				// Gameplay may have already gotten rid of some of them
+				if (_scene.Registry().valid(cell.Entities.back())) {
+					_scene.DestroyEntity(cell.Entities.back());
+				}
+				cell.Entities.pop_back();
+				destroyBudget--;
+			}
+			if (cell.Entities.empty()) {
+				_ResetCell(cell);
+			}
+		}
+	}
+}
+
+uint32_t WorldPartition::GetLoadedCount() const {
+	return static_cast<uint32_t>(std::count_if(_cells.begin(), _cells.end(), [](const Cell& cell) { return cell.State == CellState::Loaded; }));
+}
+
+uint32_t WorldPartition::GetPendingCount() const {
+	return static_cast<uint32_t>(std::count_if(_cells.begin(), _cells.end(), [](const Cell& cell) {
+		return cell.State == CellState::LoadingAssets || cell.State == CellState::Spawning || cell.State == CellState::Unloading;
+	}));
+}
+
+float WorldPartition::_DistanceToCell(const Cell& cell, const glm::vec3& point) const {
+	const glm::vec2 min = glm::vec2(cell.Info.Coord) * _cellSize;
+	const glm::vec2 max = min + glm::vec2(_cellSize);
+	const glm::vec2 flat = glm::vec2(point);
+	return glm::length(flat - glm::clamp(flat, min, max));
+}
+
+bool WorldPartition::_StageCell(Cell& cell) {
+	cell.Staging = GameScene::Create(cell.Info.File);
+	try {
+		SceneSerializer::Load(*cell.Staging, _folder + "/" + cell.Info.File, _assets);
+	} catch (const std::exception& e) {
+		LOG_WARN("Failed to load world cell \"{}\": {}", cell.Info.File, e.what());
+		return false;
+	}
+	cell.StagedEntities.clear();
+	cell.Staging->Registry().each([&](entt::entity entity) {
+		cell.StagedEntities.push_back(entity);
+	});
+	return true;
+}
+
+void WorldPartition::_ResetCell(Cell& cell) {
+	cell.State = CellState::Unloaded;
+	cell.MeshLoads.clear();
+	cell.Meshes.clear();
+	cell.Staging = nullptr;
+	cell.StagedEntities.clear();
+	cell.Entities.clear();
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+
+#include "Scene.h"
+#include "SceneSerializer.h"
+#include "Utilities/ThreadPool.h"
+
+/// <summary>
+/// Splits the static scenery of a world into a grid of cells on disk, and streams those cells in and out of a scene
+/// around the camera so that worlds much bigger than what fits in memory can be explored
+///
+/// Each cell is a scene file (see SceneSerializer) holding it's entities, along with the list of meshes those
+/// entities use. Cells that come into range first load their meshes across the thread pool, then have their
+/// entities copied into the scene a few at a time so no single frame takes the hit. Cells that fall out of range are
+/// destroyed a few entities at a time, which lets go of their meshes once nothing else is using them
+/// </summary>
+class WorldPartition final
+{
+public:
+	typedef std::shared_ptr<WorldPartition> sptr;
+	static inline sptr Create(GameScene& scene, const SceneAssets& assets) {
+		return std::make_shared<WorldPartition>(scene, assets);
+	}
+
+	/// <summary>
+	/// The name of the file in a world's folder that lists it's cells
+	/// </summary>
+	static const char* MANIFEST_NAME;
+
+	/// <summary>
+	/// Cells with any part closer than this to the camera (or to where it's heading) get loaded
+	/// </summary>
+	float LoadRadius = 40.0f;
+	/// <summary>
+	/// Loaded cells stay loaded until they're further than this, should be larger than LoadRadius so cells on the
+	/// edge don't flicker in and out
+	/// </summary>
+	float UnloadRadius = 60.0f;
+	/// <summary>
+	/// How many seconds ahead to predict the camera's position from it's velocity, cells around the predicted
+	/// position start loading before the camera gets there
+	/// </summary>
+	float PrefetchTime = 2.0f;
+	/// <summary>
+	/// The most entities to copy into the scene each frame, across all loading cells
+	/// </summary>
+	uint32_t LoadBudget = 256;
+	/// <summary>
+	/// The most entities to destroy each frame, across all unloading cells
+	/// </summary>
+	uint32_t UnloadBudget = 512;
+	/// <summary>
+	/// The most cells that can be waiting on their meshes at once
+	/// </summary>
+	uint32_t MaxConcurrentLoads = 4;
+
+	/// <summary>
+	/// Moves the static scenery of a scene out into cells on disk, and writes a manifest for Open. Entities are
+	/// partitioned if they have a StaticTag, a renderer whose mesh came from the AssetManager, and a transform with
+	/// no parent or children. Everything else stays in the scene. This should be done before StaticBatcher::Bake
+	/// </summary>
+	/// <param name="scene">The scene to take the scenery out of</param>
+	/// <param name="folder">The folder to write the cells and manifest to, must already exist</param>
+	/// <param name="cellSize">The width of each cell, along the X and Y axes</param>
+	/// <param name="assets">The materials that the scenery's renderers use</param>
+	/// <returns>The number of cells that were written</returns>
+	static uint32_t Partition(GameScene& scene, const std::string& folder, float cellSize, const SceneAssets& assets);
+
+	/// <summary>
+	/// Creates a partition that streams cells into a scene, call Open to pick the world to stream
+	/// </summary>
+	/// <param name="scene">The scene to stream into, must outlive the partition</param>
+	/// <param name="assets">The materials that the cells' renderers can use</param>
+	WorldPartition(GameScene& scene, const SceneAssets& assets);
+
+	WorldPartition(const WorldPartition& other) = delete;
+	WorldPartition& operator=(const WorldPartition& other) = delete;
+
+	/// <summary>
+	/// Reads the manifest of a world written by Partition, nothing gets loaded until the first Update
+	/// </summary>
+	/// <param name="folder">The folder the world was partitioned into</param>
+	void Open(const std::string& folder);
+
+	/// <summary>
+	/// Starts and finishes loading and unloading cells around the camera, should be called once per frame before
+	/// the world matrices are updated, so new entities get placed the frame they show up
+	/// </summary>
+	/// <param name="cameraPos">The position of the camera in the world</param>
+	/// <param name="deltaTime">The time since the last update, for estimating the camera's velocity</param>
+	void Update(const glm::vec3& cameraPos, float deltaTime);
+
+	/// <summary>
+	/// Gets the number of cells in the world
+	/// </summary>
+	size_t GetCellCount() const { return _cells.size(); }
+	/// <summary>
+	/// Gets the number of cells that are fully loaded
+	/// </summary>
+	uint32_t GetLoadedCount() const;
+	/// <summary>
+	/// Gets the number of cells that are loading or unloading
+	/// </summary>
+	uint32_t GetPendingCount() const;
+
+	// What's written to the manifest for each cell
+	struct CellInfo {
+		glm::ivec2               Coord;
+		std::string              File;
+		std::vector<std::string> Meshes;
+		std::vector<glm::vec4>   Colors;
+		uint32_t                 EntityCount = 0;
+
+		template <typename Archive>
+		void serialize(Archive& archive) {
+			archive(CEREAL_NVP(Coord), CEREAL_NVP(File), CEREAL_NVP(Meshes), CEREAL_NVP(Colors), CEREAL_NVP(EntityCount));
+		}
+	};
+
+private:
+	enum class CellState {
+		Unloaded,
+		// Waiting for the cell's meshes to finish loading
+		LoadingAssets,
+		// Copying the cell's entities into the scene
+		Spawning,
+		Loaded,
+		// Destroying the cell's entities
+		Unloading,
+		// The cell's file couldn't be read, so we don't keep trying
+		Failed
+	};
+
+	struct Cell {
+		CellInfo                                   Info;
+		CellState                                  State = CellState::Unloaded;
+		std::vector<Task<VertexArrayObject::sptr>> MeshLoads;
+		// Keeps the cell's meshes alive while it's loaded, so they don't get dropped between spawning batches
+		std::vector<VertexArrayObject::sptr>       Meshes;
+		// The cell's scene file, loaded on it's own so entities can be copied over a few at a time
+		GameScene::sptr                            Staging;
+		std::vector<entt::entity>                  StagedEntities;
+		// The entities in our scene that belong to this cell
+		std::vector<entt::entity>                  Entities;
+	};
+
+	GameScene&        _scene;
+	SceneAssets       _assets;
+	std::string       _folder;
+	float             _cellSize;
+	std::vector<Cell> _cells;
+
+	// For guessing where the camera is headed
+	glm::vec3 _lastCameraPos;
+	glm::vec3 _velocity;
+	bool      _hasCameraPos;
+
+	// Gets how far a point is from the nearest part of a cell, along the X and Y axes
+	float _DistanceToCell(const Cell& cell, const glm::vec3& point) const;
+	// Loads a cell's scene file once it's meshes are in, and returns false if it couldn't be read
+	bool _StageCell(Cell& cell);
+	// Drops everything a cell was holding on to, once it's entities are gone
+	void _ResetCell(Cell& cell);
+};
@@ -0,0 +1,164 @@
+#include "AmbientOcclusion.h"
+
+#include <algorithm>
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderState.h"
+#include "UniformBlocks.h"
+
+// Must match local_size_x and local_size_y in the ao_*.comp.glsl shaders
+static const int GROUP_SIZE = 8;
+// The units the passes read and write through, they run before anything is lit so they can use any of them
+static const int DEPTH_UNIT = 0;
+static const int OCCLUSION_UNIT = 1;
+static const int HISTORY_UNIT = 2;
+static const int TARGET_IMAGE_UNIT = 0;
+
+AmbientOcclusion::AmbientOcclusion() :
+	Radius(0.75f),
+	Intensity(1.5f),
+	HistoryBlend(0.1f),
+	StepCount(4),
+	_isReady(false),
+	_depth(0),
+	_occlusion(0),
+	_history{ 0, 0 },
+	_current(0),
+	_hasHistory(false),
+	_white(0),
+	_width(0),
+	_height(0),
+	_frame(0),
+	_previousViewProjection(glm::mat4(1.0f))
+{
+	GPU_RESOURCE_OWNER("AmbientOcclusion");
+	_depthShader = Shader::Create();
+	_depthShader->LoadShaderPartFromFile("shaders/ao_depth.comp.glsl", GL_COMPUTE_SHADER);
+	_occlusionShader = Shader::Create();
+	_occlusionShader->LoadShaderPartFromFile("shaders/ao_gtao.comp.glsl", GL_COMPUTE_SHADER);
+	_temporalShader = Shader::Create();
+	_temporalShader->LoadShaderPartFromFile("shaders/ao_temporal.comp.glsl", GL_COMPUTE_SHADER);
+	_isReady = _depthShader->Link() && _occlusionShader->Link() && _temporalShader->Link();
+	if (!_isReady) {
+		LOG_WARN("Ambient occlusion shaders failed to compile, the ambient light will go unoccluded");
+	}
+
+	// Fully open, at a depth that every fragment matches closely enough
+	const float white[2] = { 1.0f, 1.0f };
+	glCreateTextures(GL_TEXTURE_2D, 1, &_white);
+	glTextureStorage2D(_white, 1, GL_RG16F, 1, 1);
+	glTextureSubImage2D(_white, 0, 0, 0, 1, 1, GL_RG, GL_FLOAT, white);
+	GpuResources::AddRaw(GL_TEXTURE, _white, 4, "AO White");
+}
+
+AmbientOcclusion::~AmbientOcclusion() {
+	_DeleteTargets();
+	RenderState::OnTextureDeleted(_white);
+	GpuResources::RemoveRaw(GL_TEXTURE, _white);
+	glDeleteTextures(1, &_white);
+}
+
+void AmbientOcclusion::_DeleteTargets() {
+	const GLuint textures[4] = { _depth, _occlusion, _history[0], _history[1] };
+	for (GLuint texture : textures) {
+		if (texture != 0) {
+			RenderState::OnTextureDeleted(texture);
+			GpuResources::RemoveRaw(GL_TEXTURE, texture);
+		}
+	}
+	glDeleteTextures(4, textures);
+	_depth = _occlusion = _history[0] = _history[1] = 0;
+	_width = _height = 0;
+	_hasHistory = false;
+}
+
+void AmbientOcclusion::Reset() {
+	_hasHistory = false;
+}
+
+void AmbientOcclusion::Compute(GLuint depth, int width, int height, const glm::mat4& view, const glm::mat4& projection) {
+	GPU_RESOURCE_OWNER("AmbientOcclusion");
+	if (!_isReady) {
+		return;
+	}
+	const int halfWidth = std::max((width + 1) / 2, 1);
+	const int halfHeight = std::max((height + 1) / 2, 1);
+	if (halfWidth != _width || halfHeight != _height) {
+		_DeleteTargets();
+		_width = halfWidth;
+		_height = halfHeight;
+		const GLenum formats[4] = { GL_R32F, GL_R8, GL_RG16F, GL_RG16F };
+		const char* names[4] = { "AO Depth", "AO Raw", "AO History", "AO History" };
+		const size_t sizes[4] = { 4, 1, 4, 4 };
+		GLuint* textures[4] = { &_depth, &_occlusion, &_history[0], &_history[1] };
+		for (int ix = 0; ix < 4; ix++) {
+			glCreateTextures(GL_TEXTURE_2D, 1, textures[ix]);
+			glTextureStorage2D(*textures[ix], 1, formats[ix], _width, _height);
+			// The upsample gathers the history's texels itself, everything else is fetched a texel at a time
+			glTextureParameteri(*textures[ix], GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTextureParameteri(*textures[ix], GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTextureParameteri(*textures[ix], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(*textures[ix], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			GpuResources::AddRaw(GL_TEXTURE, *textures[ix], static_cast<size_t>(_width) * _height * sizes[ix], names[ix]);
+		}
+	}
+
+	// Turns view space positions into texels and back, assuming the projection is centered
+	const glm::vec2 projectionScale(1.0f / projection[0][0], 1.0f / projection[1][1]);
+	const glm::ivec2 groups((_width + GROUP_SIZE - 1) / GROUP_SIZE, (_height + GROUP_SIZE - 1) / GROUP_SIZE);
+	const int previous = _current;
+	_current = 1 - _current;
+	_frame++;
+
+	const GLuint samplers[3] = { 0, 0, 0 };
+	RenderState::BindSamplers(DEPTH_UNIT, 3, samplers);
+
+	// Shrink the depth down, as linear depth so the passes after this don't need to undo the projection every sample
+	_depthShader->Bind();
+	_depthShader->SetUniform("u_DepthParams"_hs, glm::vec2(projection[2][2], projection[3][2]));
+	RenderState::BindTextureUnit(DEPTH_UNIT, depth);
+	glBindImageTexture(TARGET_IMAGE_UNIT, _depth, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glDispatchCompute(groups.x, groups.y, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	// Search for the horizons
+	_occlusionShader->Bind();
+	_occlusionShader->SetUniform("u_ProjectionScale"_hs, projectionScale);
+	// A world unit at a linear depth of 1 covers this many half resolution texels
+	_occlusionShader->SetUniform("u_PixelScale"_hs, projection[1][1] * 0.5f * _height);
+	_occlusionShader->SetUniform("u_Radius"_hs, Radius);
+	_occlusionShader->SetUniform("u_Intensity"_hs, Intensity);
+	_occlusionShader->SetUniform("u_StepCount"_hs, std::max(StepCount, 1));
+	_occlusionShader->SetUniform("u_Frame"_hs, static_cast<int>(_frame % 64));
+	RenderState::BindTextureUnit(DEPTH_UNIT, _depth);
+	glBindImageTexture(TARGET_IMAGE_UNIT, _occlusion, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+	glDispatchCompute(groups.x, groups.y, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	// Soften the noise, then blend it into what we had last frame
+	_temporalShader->Bind();
+	_temporalShader->SetUniform("u_ProjectionScale"_hs, projectionScale);
+	_temporalShader->SetUniformMatrix("u_InverseView"_hs, glm::inverse(view));
+	_temporalShader->SetUniformMatrix("u_PreviousViewProjection"_hs, _previousViewProjection);
+	_temporalShader->SetUniform("u_HistoryBlend"_hs, _hasHistory ? std::clamp(HistoryBlend, 0.01f, 1.0f) : 1.0f);
+	RenderState::BindTextureUnit(OCCLUSION_UNIT, _occlusion);
+	RenderState::BindTextureUnit(HISTORY_UNIT, _history[previous]);
+	glBindImageTexture(TARGET_IMAGE_UNIT, _history[_current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+	glDispatchCompute(groups.x, groups.y, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	_previousViewProjection = projection * view;
+	_hasHistory = true;
+}
+
+void AmbientOcclusion::Bind() {
+	const GLuint texture = _history[_current];
+	RenderState::BindTextureUnit(AMBIENT_OCCLUSION_UNIT, texture != 0 && _isReady ? texture : _white);
+	RenderState::BindSampler(AMBIENT_OCCLUSION_UNIT, 0);
+}
+
+void AmbientOcclusion::Unbind() {
+	RenderState::BindTextureUnit(AMBIENT_OCCLUSION_UNIT, _white);
+	RenderState::BindSampler(AMBIENT_OCCLUSION_UNIT, 0);
+}
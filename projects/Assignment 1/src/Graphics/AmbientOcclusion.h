@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <GLM/glm.hpp>
+
+#include "Shader.h"
+
+/// <summary>
+/// Ground truth ambient occlusion (GTAO) worked out from the scene's depth at half resolution, so that the ambient
+/// light fades out in creases and under things instead of lighting everything evenly
+///
+/// Each frame the depth gets shrunk down to half resolution as linear view depth, then every texel searches a few
+/// slices around it for the horizon on either side and works out how much of the hemisphere above it is open. That
+/// only takes a handful of samples, so the result is noisy, but the noise is rotated every frame and gets averaged
+/// out over time: the last frame's result is reprojected onto this one, and blended in wherever the depths line up.
+/// The result holds the occlusion along with it's depth, so the forward shaders can upsample it without bleeding
+/// across edges (see GetAmbientOcclusion in lighting.glsl)
+/// </summary>
+class AmbientOcclusion final
+{
+public:
+	typedef std::shared_ptr<AmbientOcclusion> sptr;
+	static inline sptr Create() {
+		return std::make_shared<AmbientOcclusion>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	AmbientOcclusion(const AmbientOcclusion& other) = delete;
+	AmbientOcclusion(AmbientOcclusion&& other) = delete;
+	AmbientOcclusion& operator=(const AmbientOcclusion& other) = delete;
+	AmbientOcclusion& operator=(AmbientOcclusion&& other) = delete;
+
+public:
+	/// <summary>
+	/// How far out the occlusion reaches, in world units
+	/// </summary>
+	float Radius;
+	/// <summary>
+	/// The power the open part of the hemisphere gets raised to, higher values darken the occlusion
+	/// </summary>
+	float Intensity;
+	/// <summary>
+	/// How much of each new frame gets blended into the history, lower values are smoother but slower to catch up
+	/// </summary>
+	float HistoryBlend;
+	/// <summary>
+	/// How many samples each side of a slice takes
+	/// </summary>
+	int   StepCount;
+
+	/// <summary>
+	/// Compiles the shaders, the targets get created the first time Compute knows how big they need to be
+	/// </summary>
+	AmbientOcclusion();
+	~AmbientOcclusion();
+
+	/// <summary>
+	/// Returns true if the shaders compiled, if not the ambient light goes unoccluded
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Works out the occlusion for a frame, should be called once the scene's depth has been drawn and before
+	/// anything that's lit gets drawn
+	/// </summary>
+	/// <param name="depth">The scene's depth texture, must be sampleable</param>
+	/// <param name="width">The width of the depth texture, in pixels</param>
+	/// <param name="height">The height of the depth texture, in pixels</param>
+	/// <param name="view">The view matrix the depth was drawn with</param>
+	/// <param name="projection">The projection matrix the depth was drawn with, must be a perspective projection</param>
+	void Compute(GLuint depth, int width, int height, const glm::mat4& view, const glm::mat4& projection);
+	/// <summary>
+	/// Forgets the history, so the next frame starts fresh (ex: after a camera cut)
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Binds the latest result to AMBIENT_OCCLUSION_UNIT, for the lit shaders to pick up
+	/// </summary>
+	void Bind();
+	/// <summary>
+	/// Binds a texture that leaves the ambient light alone to AMBIENT_OCCLUSION_UNIT, for anything drawn from another
+	/// view (or with the occlusion turned off)
+	/// </summary>
+	void Unbind();
+
+	/// <summary>
+	/// Gets the latest result, an RG16F texture holding the amount of ambient light that gets through and the
+	/// linear depth it was worked out at, or 0 if nothing has been computed yet
+	/// </summary>
+	GLuint GetTexture() const { return _history[_current]; }
+
+protected:
+	Shader::sptr _depthShader;
+	Shader::sptr _occlusionShader;
+	Shader::sptr _temporalShader;
+	bool         _isReady;
+	// The half resolution linear depth, and the raw occlusion worked out from it
+	GLuint       _depth;
+	GLuint       _occlusion;
+	// The accumulated occlusion and it's depth, one is read from while the other is written
+	GLuint       _history[2];
+	int          _current;
+	bool         _hasHistory;
+	// A 1x1 texture that's fully open, bound when the occlusion shouldn't apply
+	GLuint       _white;
+	int          _width;
+	int          _height;
+	uint32_t     _frame;
+	glm::mat4    _previousViewProjection;
+
+	// Deletes the targets, if they exist
+	void _DeleteTargets();
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Stores both an axis aligned bounding box and a bounding sphere for a mesh, so we can do a cheap sphere test
+/// first and fall back to the tighter box test
+/// </summary>
+struct BoundingVolume
+{
+	/// <summary>
+	/// The minimum corner of the axis aligned bounding box
+	/// </summary>
+	glm::vec3 Min;
+	/// <summary>
+	/// The maximum corner of the axis aligned bounding box
+	/// </summary>
+	glm::vec3 Max;
+	/// <summary>
+	/// The center of both the box and the sphere
+	/// </summary>
+	glm::vec3 Center;
+	/// <summary>
+	/// The radius of the bounding sphere
+	/// </summary>
+	float     Radius;
+
+	BoundingVolume() : Min(glm::vec3(0.0f)), Max(glm::vec3(0.0f)), Center(glm::vec3(0.0f)), Radius(0.0f) {}
+	BoundingVolume(const glm::vec3& min, const glm::vec3& max) :
+		Min(min), Max(max), Center((min + max) * 0.5f), Radius(glm::length(max - min) * 0.5f) {}
+
+	/// <summary>
+	/// Gets the half size of the bounding box along each axis
+	/// </summary>
+	glm::vec3 GetExtents() const { return (Max - Min) * 0.5f; }
+
+	/// <summary>
+	/// Calculates the bounds of this volume after it has been transformed by the given matrix
+	/// </summary>
+	/// <param name="transform">The transformation to apply (ex: a world transform)</param>
+	/// <returns>A new volume that encloses the transformed volume</returns>
+	BoundingVolume Transformed(const glm::mat4& transform) const {
+		glm::vec3 center = transform * glm::vec4(Center, 1.0f);
+		// Projecting the extents onto the absolute value of each basis vector gives the new extents of the box
+		glm::mat3 basis = glm::mat3(transform);
+		glm::mat3 absBasis = glm::mat3(glm::abs(basis[0]), glm::abs(basis[1]), glm::abs(basis[2]));
+		glm::vec3 extents = absBasis * GetExtents();
+		// The sphere only needs to grow by the largest scaling factor
+		float scale = glm::max(glm::length(basis[0]), glm::max(glm::length(basis[1]), glm::length(basis[2])));
+
+		BoundingVolume result;
+		result.Min = center - extents;
+		result.Max = center + extents;
+		result.Center = center;
+		result.Radius = Radius * scale;
+		return result;
+	}
+};
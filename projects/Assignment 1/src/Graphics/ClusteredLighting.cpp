@@ -0,0 +1,68 @@
+#include "ClusteredLighting.h"
+
+#include <cmath>
+#include "Frustum.h"
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderState.h"
+
+// The shader gets it's local_size_x from this, see LoadSpecialized
+static const uint32_t GROUP_SIZE = 64;
+
+ClusteredLighting::ClusteredLighting() :
+	_isReady(false)
+{
+	GPU_RESOURCE_OWNER("ClusteredLighting");
+	_shader = Shader::Create();
+	_shader->LoadSpecialized({
+		{ "shaders/light_cluster.comp.glsl", GL_COMPUTE_SHADER, { ShaderStage::Constant::Int("GROUP_SIZE", 0, GROUP_SIZE) } }
+	});
+	_isReady = _shader->Link();
+	if (!_isReady) {
+		LOG_WARN("Light clustering shader failed to compile, only ambient light will be drawn");
+	}
+
+	_clusterData = UniformBuffer<ClusterData>::Create();
+	_clusterData->GetData().Grid = glm::uvec4(GRID_X, GRID_Y, GRID_Z, 0);
+	_clusterData->GetData().MaxClusterLights = MAX_CLUSTER_LIGHTS;
+	_clusterData->Bind(CLUSTER_DATA_BINDING);
+
+	_lights = StorageBuffer::Create();
+	_counts = StorageBuffer::Create(GL_DYNAMIC_COPY);
+	_indices = StorageBuffer::Create(GL_DYNAMIC_COPY);
+	// Until the first pass runs, every cluster is empty
+	const std::vector<GLuint> zeroCounts(GetClusterCount(), 0);
+	_counts->LoadData(zeroCounts.data(), zeroCounts.size());
+	_indices->LoadData(static_cast<const GLuint*>(nullptr), GetClusterCount() * MAX_CLUSTER_LIGHTS);
+}
+
+void ClusteredLighting::Update(const std::vector<LightData>& lights, const FrameData& frame, int screenWidth, int screenHeight) {
+	ClusterData& data = _clusterData->GetData();
+	data.InverseProjection = glm::inverse(frame.Projection);
+	data.ScreenSize = glm::vec2(glm::max(screenWidth, 1), glm::max(screenHeight, 1));
+	Frustum::GetClipPlanes(frame.Projection, data.NearPlane, data.FarPlane);
+	// The slices are spaced in log space, so the near plane can't sit on the camera
+	data.NearPlane = glm::max(data.NearPlane, 0.01f);
+	data.FarPlane = glm::max(data.FarPlane, data.NearPlane * 2.0f);
+	const float logRatio = std::log(data.FarPlane / data.NearPlane);
+	data.SliceScale = static_cast<float>(GRID_Z) / logRatio;
+	data.SliceBias = -static_cast<float>(GRID_Z) * std::log(data.NearPlane) / logRatio;
+	data.LightCount = _isReady ? static_cast<uint32_t>(lights.size()) : 0;
+	_clusterData->Update();
+
+	if (data.LightCount > 0) {
+		_lights->LoadData(lights.data(), lights.size());
+	}
+	RenderState::BindStorageBuffer(LIGHT_DATA_BINDING, _lights->GetHandle());
+	RenderState::BindStorageBuffer(CLUSTER_LIGHT_COUNT_BINDING, _counts->GetHandle());
+	RenderState::BindStorageBuffer(CLUSTER_LIGHT_INDEX_BINDING, _indices->GetHandle());
+	if (!_isReady) {
+		return;
+	}
+
+	// The pass still runs with no lights, so that every cluster's count gets reset
+	_shader->Bind();
+	glDispatchCompute((GetClusterCount() + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+	// The fragment shaders read the lists as storage buffers
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Shader.h"
+#include "StorageBuffer.h"
+#include "UniformBlocks.h"
+#include "UniformBuffer.h"
+
+/// <summary>
+/// Bins the lights of a frame into a grid of clusters that splits the view into tiles on screen, and each tile into
+/// exponentially spaced depth slices. A compute pass writes the list of lights that reach each cluster, so the lit
+/// shaders only need to loop over the lights near the fragment they're shading, rather than every light in the scene
+///
+/// The lights, the cluster grid's layout and the per-cluster lists stay bound to LIGHT_DATA_BINDING,
+/// CLUSTER_DATA_BINDING, CLUSTER_LIGHT_COUNT_BINDING and CLUSTER_LIGHT_INDEX_BINDING for the shaders to read
+///
+/// Usage each frame: Update after the frame uniforms have been uploaded, and before anything lit gets drawn
+/// </summary>
+class ClusteredLighting final
+{
+public:
+	typedef std::shared_ptr<ClusteredLighting> sptr;
+	static inline sptr Create() {
+		return std::make_shared<ClusteredLighting>();
+	}
+	// We'll disallow moving and copying, since we own GPU buffers
+	ClusteredLighting(const ClusteredLighting& other) = delete;
+	ClusteredLighting(ClusteredLighting&& other) = delete;
+	ClusteredLighting& operator=(const ClusteredLighting& other) = delete;
+	ClusteredLighting& operator=(ClusteredLighting&& other) = delete;
+
+public:
+	// The number of clusters along each axis of the view, the tiles are roughly square on a 16:9 screen
+	static const uint32_t GRID_X = 16;
+	static const uint32_t GRID_Y = 9;
+	static const uint32_t GRID_Z = 24;
+	// The most lights a single cluster can hold, any more than this that reach it are ignored
+	static const uint32_t MAX_CLUSTER_LIGHTS = 64;
+
+	/// <summary>
+	/// Creates the cluster buffers, and compiles the binning shader
+	/// </summary>
+	ClusteredLighting();
+	~ClusteredLighting() = default;
+
+	/// <summary>
+	/// Returns true if the binning shader compiled, if not no lights will reach anything
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Uploads the frame's lights, and bins them into the clusters of the view
+	/// </summary>
+	/// <param name="lights">The lights to draw with this frame</param>
+	/// <param name="frame">The frame uniforms that are being drawn with, must already be uploaded</param>
+	/// <param name="screenWidth">The width of the framebuffer being drawn to, in pixels</param>
+	/// <param name="screenHeight">The height of the framebuffer being drawn to, in pixels</param>
+	void Update(const std::vector<LightData>& lights, const FrameData& frame, int screenWidth, int screenHeight);
+
+	/// <summary>
+	/// Gets the number of lights that were binned this frame
+	/// </summary>
+	uint32_t GetLightCount() const { return _clusterData->GetData().LightCount; }
+	/// <summary>
+	/// Gets the total number of clusters in the grid
+	/// </summary>
+	static uint32_t GetClusterCount() { return GRID_X * GRID_Y * GRID_Z; }
+
+protected:
+	Shader::sptr                     _shader;
+	bool                             _isReady;
+	UniformBuffer<ClusterData>::sptr _clusterData;
+	StorageBuffer::sptr              _lights;
+	// Written by the binning pass, so we only ever size them on the CPU
+	StorageBuffer::sptr              _counts;
+	StorageBuffer::sptr              _indices;
+};
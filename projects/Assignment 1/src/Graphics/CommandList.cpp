@@ -0,0 +1,61 @@
+#include "CommandList.h"
+
+#include "RenderState.h"
+
+void CommandList::Reset() {
+	_commands.clear();
+	_shaders.clear();
+	_pipelines.clear();
+	_calls.clear();
+	_draws.clear();
+}
+
+void CommandList::BindShader(const Shader::sptr& shader) {
+	if (!_shaders.empty() && _shaders.back() == shader) {
+		return;
+	}
+	_commands.push_back({ CommandType::BindShader, static_cast<uint32_t>(_shaders.size()) });
+	_shaders.push_back(shader);
+}
+
+void CommandList::SetPipeline(const PipelineState& state) {
+	if (!_pipelines.empty() && _pipelines.back() == state) {
+		return;
+	}
+	_commands.push_back({ CommandType::SetPipeline, static_cast<uint32_t>(_pipelines.size()) });
+	_pipelines.push_back(state);
+}
+
+void CommandList::Call(std::function<void()>&& callback) {
+	_commands.push_back({ CommandType::Call, static_cast<uint32_t>(_calls.size()) });
+	_calls.push_back(std::move(callback));
+}
+
+void CommandList::DrawInstanced(const VertexArrayObject::sptr& mesh, const VertexBuffer::sptr& instances,
+	const std::vector<BufferAttribute>& attributes, int instanceCount, int baseInstance)
+{
+	_commands.push_back({ CommandType::Draw, static_cast<uint32_t>(_draws.size()) });
+	_draws.push_back({ mesh, instances, &attributes, instanceCount, baseInstance });
+}
+
+void CommandList::Execute() const {
+	for (const Command& command : _commands) {
+		switch (command.Type) {
+			case CommandType::BindShader:
+				_shaders[command.Index]->Bind();
+				break;
+			case CommandType::SetPipeline:
+				RenderState::ApplyPipeline(_pipelines[command.Index]);
+				break;
+			case CommandType::Call:
+				_calls[command.Index]();
+				break;
+			case CommandType::Draw: {
+				const Draw& draw = _draws[command.Index];
+				draw.Mesh->SetInstanceBuffer(draw.Instances, *draw.Attributes);
+				draw.Mesh->RenderInstanced(draw.InstanceCount, draw.BaseInstance);
+				break;
+			}
+		}
+	}
+}
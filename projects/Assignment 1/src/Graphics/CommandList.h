@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "PipelineState.h"
+#include "Shader.h"
+#include "VertexArrayObject.h"
+
+/// <summary>
+/// A list of rendering commands that can be recorded on any thread and replayed later on the thread that owns the
+/// context. Recording only stores the objects and arguments (and skips shader and pipeline changes the list has
+/// already made), it never calls OpenGL, so several lists can be filled in parallel on the ThreadPool while the main
+/// thread is busy, and then executed back to back
+///
+/// This is the layer the drawing code talks to rather than the backend, anything the list doesn't have a command
+/// for can be recorded as a Call, which runs on the main thread when the list is executed
+///
+/// Usage: Reset, record, then Execute on the main thread. A list can be executed any number of times
+/// </summary>
+class CommandList final
+{
+public:
+	typedef std::shared_ptr<CommandList> sptr;
+	static inline sptr Create() {
+		return std::make_shared<CommandList>();
+	}
+	// We'll disallow moving and copying, since lists hold on to the objects they refer to until they're reset
+	CommandList(const CommandList& other) = delete;
+	CommandList(CommandList&& other) = delete;
+	CommandList& operator=(const CommandList& other) = delete;
+	CommandList& operator=(CommandList&& other) = delete;
+
+	CommandList() = default;
+	~CommandList() = default;
+
+	/// <summary>
+	/// Empties the list so it can be recorded again, keeping it's storage around
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Records binding a shader, skipped if it's the last shader the list bound
+	/// </summary>
+	void BindShader(const Shader::sptr& shader);
+	/// <summary>
+	/// Records applying a pipeline state, skipped if it's the same as the last state the list applied
+	/// </summary>
+	void SetPipeline(const PipelineState& state);
+	/// <summary>
+	/// Records a function to run when the list is executed, for anything the list doesn't know how to record (ex:
+	/// applying a material's uniforms and textures)
+	/// </summary>
+	void Call(std::function<void()>&& callback);
+	/// <summary>
+	/// Records an instanced draw of a mesh
+	/// </summary>
+	/// <param name="mesh">The mesh to draw</param>
+	/// <param name="instances">The buffer to attach as the mesh's instance data</param>
+	/// <param name="attributes">The layout of the instance data, must outlive the list (ex: a vertex type's V_DECL)</param>
+	/// <param name="instanceCount">The number of instances to draw</param>
+	/// <param name="baseInstance">The first instance to draw</param>
+	void DrawInstanced(const VertexArrayObject::sptr& mesh, const VertexBuffer::sptr& instances,
+		const std::vector<BufferAttribute>& attributes, int instanceCount, int baseInstance);
+
+	/// <summary>
+	/// Replays the commands in the order they were recorded, must be called on the main thread
+	/// </summary>
+	void Execute() const;
+
+	/// <summary>
+	/// Gets the number of commands in the list
+	/// </summary>
+	size_t GetCommandCount() const { return _commands.size(); }
+	/// <summary>
+	/// Gets the number of draws in the list
+	/// </summary>
+	size_t GetDrawCount() const { return _draws.size(); }
+
+protected:
+	enum class CommandType : uint8_t {
+		BindShader,
+		SetPipeline,
+		Call,
+		Draw
+	};
+	// Each command is just it's type and where it's arguments are in the list of that type
+	struct Command {
+		CommandType Type;
+		uint32_t    Index;
+	};
+	struct Draw {
+		VertexArrayObject::sptr             Mesh;
+		VertexBuffer::sptr                  Instances;
+		const std::vector<BufferAttribute>* Attributes;
+		int                                 InstanceCount;
+		int                                 BaseInstance;
+	};
+
+	std::vector<Command>               _commands;
+	std::vector<Shader::sptr>          _shaders;
+	std::vector<PipelineState>         _pipelines;
+	std::vector<std::function<void()>> _calls;
+	std::vector<Draw>                  _draws;
+};
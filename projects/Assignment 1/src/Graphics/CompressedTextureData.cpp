@@ -0,0 +1,376 @@
+#include "CompressedTextureData.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "Utilities/FileUtils.h"
+
+// See https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+struct DDSPixelFormat {
+	uint32_t Size;
+	uint32_t Flags;
+	uint32_t FourCC;
+	uint32_t RGBBitCount;
+	uint32_t RBitMask;
+	uint32_t GBitMask;
+	uint32_t BBitMask;
+	uint32_t ABitMask;
+};
+struct DDSHeader {
+	uint32_t       Size;
+	uint32_t       Flags;
+	uint32_t       Height;
+	uint32_t       Width;
+	uint32_t       PitchOrLinearSize;
+	uint32_t       Depth;
+	uint32_t       MipMapCount;
+	uint32_t       Reserved1[11];
+	DDSPixelFormat PixelFormat;
+	uint32_t       Caps;
+	uint32_t       Caps2;
+	uint32_t       Caps3;
+	uint32_t       Caps4;
+	uint32_t       Reserved2;
+};
+struct DDSHeaderDX10 {
+	uint32_t DXGIFormat;
+	uint32_t ResourceDimension;
+	uint32_t MiscFlag;
+	uint32_t ArraySize;
+	uint32_t MiscFlags2;
+};
+static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+
+// See https://github.khronos.org/KTX-Specification/
+struct KTX2Header {
+	uint8_t  Identifier[12];
+	uint32_t VkFormat;
+	uint32_t TypeSize;
+	uint32_t PixelWidth;
+	uint32_t PixelHeight;
+	uint32_t PixelDepth;
+	uint32_t LayerCount;
+	uint32_t FaceCount;
+	uint32_t LevelCount;
+	uint32_t SupercompressionScheme;
+	uint32_t DfdByteOffset;
+	uint32_t DfdByteLength;
+	uint32_t KvdByteOffset;
+	uint32_t KvdByteLength;
+	uint64_t SgdByteOffset;
+	uint64_t SgdByteLength;
+};
+struct KTX2LevelIndex {
+	uint64_t ByteOffset;
+	uint64_t ByteLength;
+	uint64_t UncompressedByteLength;
+};
+static_assert(sizeof(KTX2Header) == 80, "KTX2 header must be 80 bytes");
+
+static constexpr uint32_t MakeFourCC(char a, char b, char c, char d) {
+	return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+}
+
+static const uint32_t DDS_MAGIC             = MakeFourCC('D', 'D', 'S', ' ');
+static const uint32_t DDS_PIXEL_FOURCC      = 0x4;
+static const uint32_t DDS_PIXEL_ALPHAPIXELS = 0x1;
+static const uint8_t  KTX2_IDENTIFIER[12]   = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+// The header at the start of a sidecar written by SaveSidecar, followed by every level's blocks from largest to
+// smallest (the size of each level follows from the size and format)
+struct CompressedSidecarHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Width;
+	uint32_t Height;
+	GLint    Format;
+	uint32_t LevelCount;
+	// Used to detect when the source image has changed since it was compressed
+	uint64_t SourceSize;
+	int64_t  SourceWriteTime;
+};
+static const uint32_t SIDECAR_MAGIC   = MakeFourCC('T', 'B', 'C', 'S');
+// Bump this whenever the layout of the file or the way we compress changes, so old sidecars get compressed again
+static const uint32_t SIDECAR_VERSION = 1;
+
+// Maps a DXGI_FORMAT from a DX10 DDS header to one of our formats
+static InternalFormat FormatFromDXGI(uint32_t format) {
+	switch (format) {
+		case 71: return InternalFormat::BC1A;     // DXGI_FORMAT_BC1_UNORM
+		case 74: return InternalFormat::BC2;      // DXGI_FORMAT_BC2_UNORM
+		case 77: return InternalFormat::BC3;      // DXGI_FORMAT_BC3_UNORM
+		case 80: return InternalFormat::BC4;      // DXGI_FORMAT_BC4_UNORM
+		case 83: return InternalFormat::BC5;      // DXGI_FORMAT_BC5_UNORM
+		case 95: return InternalFormat::BC6H;     // DXGI_FORMAT_BC6H_UF16
+		case 96: return InternalFormat::BC6H_SIGNED; // DXGI_FORMAT_BC6H_SF16
+		case 98: return InternalFormat::BC7;      // DXGI_FORMAT_BC7_UNORM
+		case 99: return InternalFormat::BC7_SRGB; // DXGI_FORMAT_BC7_UNORM_SRGB
+		default: return InternalFormat::Unknown;
+	}
+}
+
+// Maps a VkFormat from a KTX2 header to one of our formats
+static InternalFormat FormatFromVulkan(uint32_t format) {
+	switch (format) {
+		case 131: return InternalFormat::BC1;      // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+		case 133: return InternalFormat::BC1A;     // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+		case 135: return InternalFormat::BC2;      // VK_FORMAT_BC2_UNORM_BLOCK
+		case 137: return InternalFormat::BC3;      // VK_FORMAT_BC3_UNORM_BLOCK
+		case 139: return InternalFormat::BC4;      // VK_FORMAT_BC4_UNORM_BLOCK
+		case 141: return InternalFormat::BC5;      // VK_FORMAT_BC5_UNORM_BLOCK
+		case 143: return InternalFormat::BC6H;     // VK_FORMAT_BC6H_UFLOAT_BLOCK
+		case 144: return InternalFormat::BC6H_SIGNED; // VK_FORMAT_BC6H_SFLOAT_BLOCK
+		case 145: return InternalFormat::BC7;      // VK_FORMAT_BC7_UNORM_BLOCK
+		case 146: return InternalFormat::BC7_SRGB; // VK_FORMAT_BC7_SRGB_BLOCK
+		default:  return InternalFormat::Unknown;
+	}
+}
+
+CompressedTextureData::CompressedTextureData(uint32_t width, uint32_t height, InternalFormat format) :
+	_width(width), _height(height), _format(format)
+{
+	LOG_ASSERT(width > 0 && height > 0, "Width and height must both be greater than zero! Got {}x{}", width, height);
+	LOG_ASSERT(IsCompressedFormat(format), "Format {} is not block compressed!", format);
+}
+
+void CompressedTextureData::AddLevel(const void* data, size_t size) {
+	const uint32_t level = GetLevelCount();
+	MipLevel result;
+	result.Width  = std::max(_width >> level, 1u);
+	result.Height = std::max(_height >> level, 1u);
+	result.Offset = _data.size();
+	result.Size   = GetLevelSize(result.Width, result.Height, _format);
+	LOG_ASSERT(size == result.Size, "Mip level {} should be {} bytes, got {}", level, result.Size, size);
+	_data.resize(_data.size() + size);
+	memcpy(_data.data() + result.Offset, data, size);
+	_levels.push_back(result);
+}
+
+size_t CompressedTextureData::GetLevelSize(uint32_t width, uint32_t height, InternalFormat format) {
+	// Blocks are always 4x4, so partial blocks on the edges still take up a full block
+	const size_t blocksWide = (width + 3) / 4;
+	const size_t blocksHigh = (height + 3) / 4;
+	return blocksWide * blocksHigh * GetCompressedBlockSize(format);
+}
+
+bool CompressedTextureData::IsSupportedFile(const std::string& file) {
+	std::string extension = std::filesystem::path(file).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower(c); });
+	return extension == ".dds" || extension == ".ktx2";
+}
+
+CompressedTextureData::sptr CompressedTextureData::LoadFromFile(const std::string& file) {
+	std::ifstream stream(file, std::ios::binary | std::ios::ate);
+	if (!stream.is_open()) {
+		LOG_WARN("Failed to open compressed image \"{}\"", file);
+		return nullptr;
+	}
+	std::vector<uint8_t> contents(static_cast<size_t>(stream.tellg()));
+	stream.seekg(0);
+	stream.read(reinterpret_cast<char*>(contents.data()), contents.size());
+	stream.close();
+
+	sptr result = nullptr;
+	if (contents.size() >= sizeof(KTX2_IDENTIFIER) && memcmp(contents.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+		result = _LoadKTX2(contents, file);
+	} else if (contents.size() >= sizeof(uint32_t) && memcmp(contents.data(), &DDS_MAGIC, sizeof(uint32_t)) == 0) {
+		result = _LoadDDS(contents, file);
+	} else {
+		LOG_WARN("\"{}\" is not a DDS or KTX2 file", file);
+	}
+
+	if (result != nullptr) {
+		result->DebugName = std::filesystem::path(file).filename().string();
+	}
+	return result;
+}
+
+CompressedTextureData::sptr CompressedTextureData::_LoadDDS(const std::vector<uint8_t>& file, const std::string& path) {
+	size_t offset = sizeof(uint32_t);
+	if (file.size() < offset + sizeof(DDSHeader)) {
+		LOG_WARN("DDS file \"{}\" is truncated", path);
+		return nullptr;
+	}
+	DDSHeader header;
+	memcpy(&header, file.data() + offset, sizeof(DDSHeader));
+	offset += sizeof(DDSHeader);
+
+	InternalFormat format = InternalFormat::Unknown;
+	if ((header.PixelFormat.Flags & DDS_PIXEL_FOURCC) != 0) {
+		switch (header.PixelFormat.FourCC) {
+			case MakeFourCC('D', 'X', 'T', '1'):
+				format = (header.PixelFormat.Flags & DDS_PIXEL_ALPHAPIXELS) != 0 ? InternalFormat::BC1A : InternalFormat::BC1;
+				break;
+			case MakeFourCC('D', 'X', 'T', '3'): format = InternalFormat::BC2; break;
+			case MakeFourCC('D', 'X', 'T', '5'): format = InternalFormat::BC3; break;
+			case MakeFourCC('A', 'T', 'I', '1'):
+			case MakeFourCC('B', 'C', '4', 'U'): format = InternalFormat::BC4; break;
+			case MakeFourCC('A', 'T', 'I', '2'):
+			case MakeFourCC('B', 'C', '5', 'U'): format = InternalFormat::BC5; break;
+			case MakeFourCC('D', 'X', '1', '0'):
+			{
+				if (file.size() < offset + sizeof(DDSHeaderDX10)) {
+					LOG_WARN("DDS file \"{}\" is truncated", path);
+					return nullptr;
+				}
+				DDSHeaderDX10 dx10;
+				memcpy(&dx10, file.data() + offset, sizeof(DDSHeaderDX10));
+				offset += sizeof(DDSHeaderDX10);
+				if (dx10.ArraySize > 1) {
+					LOG_WARN("DDS texture arrays are not supported, only loading the first layer of \"{}\"", path);
+				}
+				format = FormatFromDXGI(dx10.DXGIFormat);
+				break;
+			}
+			default:
+				break;
+		}
+	}
+	if (format == InternalFormat::Unknown) {
+		LOG_WARN("DDS file \"{}\" is not in a block compressed format we support", path);
+		return nullptr;
+	}
+
+	// The levels are stored back to back, largest first
+	sptr result = std::make_shared<CompressedTextureData>(header.Width, header.Height, format);
+	const uint32_t levelCount = std::max(header.MipMapCount, 1u);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		uint32_t width  = std::max(header.Width >> level, 1u);
+		uint32_t height = std::max(header.Height >> level, 1u);
+		size_t size = GetLevelSize(width, height, format);
+		if (file.size() < offset + size) {
+			LOG_WARN("DDS file \"{}\" is missing data for mip level {}", path, level);
+			break;
+		}
+		result->AddLevel(file.data() + offset, size);
+		offset += size;
+	}
+	return result->GetLevelCount() > 0 ? result : nullptr;
+}
+
+CompressedTextureData::sptr CompressedTextureData::_LoadKTX2(const std::vector<uint8_t>& file, const std::string& path) {
+	if (file.size() < sizeof(KTX2Header)) {
+		LOG_WARN("KTX2 file \"{}\" is truncated", path);
+		return nullptr;
+	}
+	KTX2Header header;
+	memcpy(&header, file.data(), sizeof(KTX2Header));
+
+	if (header.SupercompressionScheme != 0) {
+		LOG_WARN("KTX2 file \"{}\" uses supercompression scheme {}, which we do not support", path, header.SupercompressionScheme);
+		return nullptr;
+	}
+	if (header.PixelDepth > 1 || header.FaceCount > 1 || header.LayerCount > 1) {
+		LOG_WARN("KTX2 file \"{}\" is not a plain 2D texture, only loading the first image", path);
+	}
+	InternalFormat format = FormatFromVulkan(header.VkFormat);
+	if (format == InternalFormat::Unknown) {
+		LOG_WARN("KTX2 file \"{}\" is not in a block compressed format we support (VkFormat {})", path, header.VkFormat);
+		return nullptr;
+	}
+
+	// A level count of 0 asks the loader to generate mips, which we can't do for compressed data
+	const uint32_t levelCount = std::max(header.LevelCount, 1u);
+	if (file.size() < sizeof(KTX2Header) + levelCount * sizeof(KTX2LevelIndex)) {
+		LOG_WARN("KTX2 file \"{}\" is truncated", path);
+		return nullptr;
+	}
+
+	sptr result = std::make_shared<CompressedTextureData>(header.PixelWidth, header.PixelHeight, format);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		KTX2LevelIndex index;
+		memcpy(&index, file.data() + sizeof(KTX2Header) + level * sizeof(KTX2LevelIndex), sizeof(KTX2LevelIndex));
+
+		uint32_t width  = std::max(header.PixelWidth >> level, 1u);
+		uint32_t height = std::max(header.PixelHeight >> level, 1u);
+		size_t size = GetLevelSize(width, height, format);
+		if (index.ByteLength < size || file.size() < index.ByteOffset + size) {
+			LOG_WARN("KTX2 file \"{}\" is missing data for mip level {}", path, level);
+			break;
+		}
+		// If there are more layers or faces, the first one comes first in the level
+		result->AddLevel(file.data() + index.ByteOffset, size);
+	}
+	return result->GetLevelCount() > 0 ? result : nullptr;
+}
+
+CompressedTextureData::sptr CompressedTextureData::LoadSidecar(const std::string& imagePath, const std::string& extension) {
+	const std::string path = imagePath + extension;
+	std::ifstream stream(path, std::ios::binary | std::ios::ate);
+	// Missing sidecars are normal, the image just hasn't been compressed yet
+	if (!stream.is_open()) {
+		return nullptr;
+	}
+	std::vector<uint8_t> contents(static_cast<size_t>(stream.tellg()));
+	stream.seekg(0);
+	stream.read(reinterpret_cast<char*>(contents.data()), contents.size());
+	stream.close();
+
+	CompressedSidecarHeader header;
+	if (contents.size() < sizeof(CompressedSidecarHeader)) {
+		LOG_WARN("Compressed sidecar \"{}\" is truncated", path);
+		return nullptr;
+	}
+	memcpy(&header, contents.data(), sizeof(CompressedSidecarHeader));
+	if (header.Magic != SIDECAR_MAGIC || header.Version != SIDECAR_VERSION) {
+		LOG_INFO("Compressed sidecar \"{}\" is from an older version, it will be compressed again", path);
+		return nullptr;
+	}
+	// The sidecar is only as good as the image it was compressed from
+	uint64_t sourceSize;
+	int64_t  sourceWriteTime;
+	if (GetFileStamp(imagePath, sourceSize, sourceWriteTime) &&
+		(sourceSize != header.SourceSize || sourceWriteTime != header.SourceWriteTime))
+	{
+		LOG_INFO("Compressed sidecar \"{}\" is older than it's image, it will be compressed again", path);
+		return nullptr;
+	}
+	const InternalFormat format = (InternalFormat)header.Format;
+	if (header.Width == 0 || header.Height == 0 || header.LevelCount == 0 || !IsCompressedFormat(format) ||
+		header.LevelCount > GetMipLevelCount(header.Width, header.Height))
+	{
+		LOG_WARN("Compressed sidecar \"{}\" is corrupted", path);
+		return nullptr;
+	}
+
+	sptr result = std::make_shared<CompressedTextureData>(header.Width, header.Height, format);
+	size_t offset = sizeof(CompressedSidecarHeader);
+	for (uint32_t level = 0; level < header.LevelCount; level++) {
+		const size_t size = GetLevelSize(std::max(header.Width >> level, 1u), std::max(header.Height >> level, 1u), format);
+		if (contents.size() < offset + size) {
+			LOG_WARN("Compressed sidecar \"{}\" is missing data for mip level {}", path, level);
+			return nullptr;
+		}
+		result->AddLevel(contents.data() + offset, size);
+		offset += size;
+	}
+	result->DebugName = std::filesystem::path(imagePath).filename().string();
+	return result;
+}
+
+bool CompressedTextureData::SaveSidecar(const std::string& imagePath, const std::string& extension) const {
+	const std::string path = imagePath + extension;
+
+	CompressedSidecarHeader header;
+	header.Magic      = SIDECAR_MAGIC;
+	header.Version    = SIDECAR_VERSION;
+	header.Width      = _width;
+	header.Height     = _height;
+	header.Format     = *_format;
+	header.LevelCount = GetLevelCount();
+	if (!GetFileStamp(imagePath, header.SourceSize, header.SourceWriteTime)) {
+		LOG_WARN("Could not read the source image \"{}\" for a compressed sidecar", imagePath);
+		return false;
+	}
+
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	if (!stream.is_open()) {
+		LOG_WARN("Failed to open \"{}\" for writing", path);
+		return false;
+	}
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(CompressedSidecarHeader));
+	stream.write(reinterpret_cast<const char*>(_data.data()), _data.size());
+	return stream.good();
+}
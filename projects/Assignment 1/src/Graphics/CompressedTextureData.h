@@ -0,0 +1,119 @@
+#pragma once
+#include <memory>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TextureEnums.h"
+
+/// <summary>
+/// Stores a block compressed image (BC1-BC7) along with it's full mip chain, loaded from a DDS or KTX2 file
+///
+/// Note that unlike Texture2DData we can't flip compressed images on load, so these files are expected to already
+/// be stored bottom row first like OpenGL wants (the same way stb_image flips our other images)
+/// </summary>
+class CompressedTextureData final
+{
+public:
+	CompressedTextureData(const CompressedTextureData& other) = delete;
+	CompressedTextureData(CompressedTextureData&& other) = delete;
+	CompressedTextureData& operator=(const CompressedTextureData& other) = delete;
+	CompressedTextureData& operator=(CompressedTextureData&& other) = delete;
+	typedef std::shared_ptr<CompressedTextureData> sptr;
+
+	/// <summary>
+	/// Describes where a single mip level lives in our data
+	/// </summary>
+	struct MipLevel {
+		uint32_t Width;
+		uint32_t Height;
+		size_t   Offset;
+		size_t   Size;
+	};
+
+	std::string DebugName;
+
+	/// <summary>
+	/// Creates a new, empty compressed image, the levels get added with AddLevel
+	/// </summary>
+	/// <param name="width">The width of the largest mip level, in pixels</param>
+	/// <param name="height">The height of the largest mip level, in pixels</param>
+	/// <param name="format">The block compressed format of the data</param>
+	CompressedTextureData(uint32_t width, uint32_t height, InternalFormat format);
+	~CompressedTextureData() = default;
+
+	/// <summary>
+	/// Appends the next mip level, levels must be added from largest to smallest
+	/// </summary>
+	/// <param name="data">The compressed blocks for the level</param>
+	/// <param name="size">The size of the data in bytes, must match the size of the level</param>
+	void AddLevel(const void* data, size_t size);
+
+	/// <summary>
+	/// Loads a compressed image from a .dds or .ktx2 file
+	/// </summary>
+	/// <param name="file">The path of the file to load</param>
+	/// <returns>A pointer to the loaded data, or nullptr if the file could not be loaded</returns>
+	static CompressedTextureData::sptr LoadFromFile(const std::string& file);
+	/// <summary>
+	/// Returns true if the given file is one that LoadFromFile can handle, based on it's extension
+	/// </summary>
+	static bool IsSupportedFile(const std::string& file);
+	/// <summary>
+	/// Loads an image that was compressed at runtime from it's sidecar file, if it exists and is newer than the image
+	/// </summary>
+	/// <param name="imagePath">The path of the source image (not the sidecar)</param>
+	/// <param name="extension">Added to the image path to get the sidecar's path</param>
+	/// <returns>The compressed image, or nullptr if there is no valid sidecar</returns>
+	static CompressedTextureData::sptr LoadSidecar(const std::string& imagePath, const std::string& extension);
+	/// <summary>
+	/// Writes this image to the sidecar file for the image it was compressed from
+	/// </summary>
+	/// <param name="imagePath">The path of the source image (not the sidecar)</param>
+	/// <param name="extension">Added to the image path to get the sidecar's path</param>
+	/// <returns>True if the file was written</returns>
+	bool SaveSidecar(const std::string& imagePath, const std::string& extension) const;
+
+	/// <summary>
+	/// Gets the width of the largest mip level, in pixels
+	/// </summary>
+	uint32_t GetWidth() const { return _width; }
+	/// <summary>
+	/// Gets the height of the largest mip level, in pixels
+	/// </summary>
+	uint32_t GetHeight() const { return _height; }
+	/// <summary>
+	/// Gets the block compressed format of the data
+	/// </summary>
+	InternalFormat GetFormat() const { return _format; }
+	/// <summary>
+	/// Gets the number of mip levels that have been added
+	/// </summary>
+	uint32_t GetLevelCount() const { return static_cast<uint32_t>(_levels.size()); }
+	/// <summary>
+	/// Gets the size and location of a mip level
+	/// </summary>
+	const MipLevel& GetLevel(uint32_t level) const { return _levels[level]; }
+	/// <summary>
+	/// Gets a readonly pointer to the compressed blocks for a mip level
+	/// </summary>
+	const void* GetLevelData(uint32_t level) const { return _data.data() + _levels[level].Offset; }
+	/// <summary>
+	/// Gets the total size of all the levels, in bytes
+	/// </summary>
+	size_t GetDataSize() const { return _data.size(); }
+
+	/// <summary>
+	/// Gets the number of bytes needed to store a single level of an image in the given format
+	/// </summary>
+	static size_t GetLevelSize(uint32_t width, uint32_t height, InternalFormat format);
+
+private:
+	uint32_t              _width, _height;
+	InternalFormat        _format;
+	std::vector<MipLevel> _levels;
+	std::vector<uint8_t>  _data;
+
+	static sptr _LoadDDS(const std::vector<uint8_t>& file, const std::string& path);
+	static sptr _LoadKTX2(const std::vector<uint8_t>& file, const std::string& path);
+};
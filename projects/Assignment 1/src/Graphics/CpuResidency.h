@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// Whether an asset keeps a copy of it's data in CPU memory once it's been uploaded to the GPU. Most assets are only
+/// ever drawn, so they don't need one, and holding onto it can double the memory they take up
+/// </summary>
+enum class CpuResidency : uint8_t
+{
+	// The CPU copy is freed as soon as it's been uploaded, and nothing may ask for it afterwards
+	GpuOnly = 0,
+	// The CPU copy is kept for as long as the asset is alive (ex: for data that gets read every frame)
+	KeepCpuCopy,
+	// The CPU copy is freed after it's been uploaded, and loaded again from the asset's source the first time it's
+	// asked for (ex: a mesh's triangles, for picking)
+	ReloadOnDemand
+};
@@ -0,0 +1,101 @@
+#include "DeferredShading.h"
+
+#include <algorithm>
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderState.h"
+#include "RenderStats.h"
+
+DeferredShading::DeferredShading() :
+	_framebuffer(0),
+	_albedo(0),
+	_normal(0),
+	_depth(0),
+	_emptyVao(0),
+	_width(0),
+	_height(0),
+	_previousFramebuffer(0)
+{
+	GPU_RESOURCE_OWNER("DeferredShading");
+	glCreateFramebuffers(1, &_framebuffer);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glNamedFramebufferDrawBuffers(_framebuffer, 2, drawBuffers);
+	glCreateVertexArrays(1, &_emptyVao);
+}
+
+DeferredShading::~DeferredShading() {
+	_DeleteTargets();
+	glDeleteFramebuffers(1, &_framebuffer);
+	RenderState::OnVertexArrayDeleted(_emptyVao);
+	glDeleteVertexArrays(1, &_emptyVao);
+}
+
+void DeferredShading::_DeleteTargets() {
+	const GLuint textures[3] = { _albedo, _normal, _depth };
+	for (GLuint texture : textures) {
+		if (texture != 0) {
+			RenderState::OnTextureDeleted(texture);
+			GpuResources::RemoveRaw(GL_TEXTURE, texture);
+		}
+	}
+	glDeleteTextures(3, textures);
+	_albedo = _normal = _depth = 0;
+}
+
+void DeferredShading::BeginGeometry(int width, int height) {
+	GPU_RESOURCE_OWNER("DeferredShading");
+	if (width != _width || height != _height) {
+		_DeleteTargets();
+		_width = width;
+		_height = height;
+		// Every pixel gets read exactly once, so there's no need for filtering or mips
+		const GLenum formats[3] = { GL_RGBA8, GL_RGB10_A2, GL_DEPTH_COMPONENT32F };
+		const char* names[3] = { "G-Buffer Albedo", "G-Buffer Normal", "G-Buffer Depth" };
+		GLuint* textures[3] = { &_albedo, &_normal, &_depth };
+		for (int ix = 0; ix < 3; ix++) {
+			glCreateTextures(GL_TEXTURE_2D, 1, textures[ix]);
+			glTextureStorage2D(*textures[ix], 1, formats[ix], std::max(width, 1), std::max(height, 1));
+			glTextureParameteri(*textures[ix], GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTextureParameteri(*textures[ix], GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			// All three formats are 4 bytes a pixel
+			GpuResources::AddRaw(GL_TEXTURE, *textures[ix], static_cast<size_t>(std::max(width, 1)) * std::max(height, 1) * 4, names[ix]);
+		}
+		glNamedFramebufferTexture(_framebuffer, GL_COLOR_ATTACHMENT0, _albedo, 0);
+		glNamedFramebufferTexture(_framebuffer, GL_COLOR_ATTACHMENT1, _normal, 0);
+		glNamedFramebufferTexture(_framebuffer, GL_DEPTH_ATTACHMENT, _depth, 0);
+		if (glCheckNamedFramebufferStatus(_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR("G-buffer is incomplete at {}x{}", width, height);
+		}
+	}
+
+	// The scene might be going into an offscreen target (ex: PostProcessing) rather than the screen
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_previousFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	// Anything we don't draw over gets skipped by the lighting pass, so the colors don't matter
+	const float clearDepth = 1.0f;
+	const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	RenderState::SetDepthMask(true);
+	glClearNamedFramebufferfv(_framebuffer, GL_COLOR, 0, clearColor);
+	glClearNamedFramebufferfv(_framebuffer, GL_COLOR, 1, clearColor);
+	glClearNamedFramebufferfv(_framebuffer, GL_DEPTH, 0, &clearDepth);
+}
+
+void DeferredShading::EndGeometry() {
+	glBindFramebuffer(GL_FRAMEBUFFER, _previousFramebuffer);
+}
+
+void DeferredShading::Light(const Shader::sptr& shader) {
+	shader->Bind();
+	const GLuint textures[3] = { _albedo, _normal, _depth };
+	const GLuint samplers[3] = { 0, 0, 0 };
+	RenderState::BindTextureUnits(GBUFFER_ALBEDO_UNIT, 3, textures);
+	RenderState::BindSamplers(GBUFFER_ALBEDO_UNIT, 3, samplers);
+	// The pass writes the scene's depth out, so it needs to pass the depth test wherever there's something to light
+	RenderState::SetDepthFunc(GL_ALWAYS);
+	RenderState::SetDepthMask(true);
+	RenderState::BindVertexArray(_emptyVao);
+	RenderStats::CountDraw(3);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	RenderState::SetDepthFunc(GL_LEQUAL);
+}
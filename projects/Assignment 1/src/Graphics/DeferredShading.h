@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+#include "Shader.h"
+#include "UniformBlocks.h"
+
+/// <summary>
+/// Owns the G-buffer for deferred shading, and draws the full screen pass that lights it. The G-buffer is kept
+/// compact, two 32 bit targets and depth:
+///
+///     0: RGBA8    albedo (rgb), specular (a)
+///     1: RGB10A2  octahedral normal (rg), log2 shininess (b)
+///     depth: the position gets rebuilt from it, rather than stored
+///
+/// Lit geometry gets drawn into the G-buffer with the GBUFFER variant of our Blinn-Phong shader, then the
+/// DEFERRED_LIGHTING variant shades each pixel once, no matter how many surfaces were drawn over it. The lighting
+/// pass writes the scene's depth back out, so anything that can't be deferred (ex: the skybox, transparent or
+/// reflective materials) can still be drawn forward after it
+///
+/// Usage each frame: BeginGeometry, draw the deferred materials, EndGeometry, then Light with the lighting variant
+/// </summary>
+class DeferredShading final
+{
+public:
+	typedef std::shared_ptr<DeferredShading> sptr;
+	static inline sptr Create() {
+		return std::make_shared<DeferredShading>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	DeferredShading(const DeferredShading& other) = delete;
+	DeferredShading(DeferredShading&& other) = delete;
+	DeferredShading& operator=(const DeferredShading& other) = delete;
+	DeferredShading& operator=(DeferredShading&& other) = delete;
+
+public:
+	/// <summary>
+	/// Creates the framebuffer, the targets get created the first time BeginGeometry knows how big they need to be
+	/// </summary>
+	DeferredShading();
+	~DeferredShading();
+
+	/// <summary>
+	/// Binds and clears the G-buffer, resizing it first if the screen has changed size
+	/// </summary>
+	/// <param name="width">The width of the framebuffer being drawn to, in pixels</param>
+	/// <param name="height">The height of the framebuffer being drawn to, in pixels</param>
+	void BeginGeometry(int width, int height);
+	/// <summary>
+	/// Goes back to drawing to whatever was bound when BeginGeometry was called
+	/// </summary>
+	void EndGeometry();
+	/// <summary>
+	/// Lights the G-buffer into the bound framebuffer with a full screen triangle, the clusters, shadows and frame uniforms need
+	/// to be bound already
+	/// </summary>
+	/// <param name="shader">The DEFERRED_LIGHTING variant of the lit shader, with it's scene uniforms set</param>
+	void Light(const Shader::sptr& shader);
+
+	/// <summary>
+	/// Gets the G-buffer's depth, which holds the deferred materials once EndGeometry has been called
+	/// </summary>
+	GLuint GetDepth() const { return _depth; }
+
+	/// <summary>
+	/// Gets the number of bytes the G-buffer takes up per pixel
+	/// </summary>
+	static uint32_t GetBytesPerPixel() { return 4 + 4 + 4; }
+
+protected:
+	GLuint _framebuffer;
+	GLuint _albedo;
+	GLuint _normal;
+	GLuint _depth;
+	// The lighting pass has no vertices, but drawing still needs a vertex array bound
+	GLuint _emptyVao;
+	int    _width;
+	int    _height;
+	// What was being drawn to before the geometry pass, the lighting pass draws into it
+	GLint  _previousFramebuffer;
+
+	// Deletes the targets, if they exist
+	void _DeleteTargets();
+};
@@ -0,0 +1,232 @@
+#include "DepthPyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderState.h"
+
+// Must match local_size_x and local_size_y in depth_pyramid.comp.glsl
+static const int GROUP_SIZE = 8;
+// The units the reduction reads and writes through, it runs after the scene so it can use any of them
+static const int SOURCE_UNIT = 0;
+static const int TARGET_IMAGE_UNIT = 0;
+
+bool OcclusionMap::IsOccluded(const BoundingVolume& bounds) const {
+	if (Levels.empty()) {
+		return false;
+	}
+	// Find the box's rectangle on screen and it's nearest depth, anything poking through the near plane could be
+	// anywhere on screen so we let it through
+	glm::vec2 rectMin(1.0f), rectMax(0.0f);
+	float nearest = 1.0f;
+	for (int ix = 0; ix < 8; ix++) {
+		const glm::vec3 corner((ix & 1) ? bounds.Max.x : bounds.Min.x, (ix & 2) ? bounds.Max.y : bounds.Min.y, (ix & 4) ? bounds.Max.z : bounds.Min.z);
+		const glm::vec4 clip = ViewProjection * glm::vec4(corner, 1.0f);
+		if (clip.w <= 1e-5f) {
+			return false;
+		}
+		const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		const glm::vec2 uv = glm::vec2(ndc) * 0.5f + 0.5f;
+		rectMin = glm::min(rectMin, uv);
+		rectMax = glm::max(rectMax, uv);
+		nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+	}
+	// The map only knows about what was on screen when it was drawn
+	if (rectMin.x < 0.0f || rectMin.y < 0.0f || rectMax.x > 1.0f || rectMax.y > 1.0f) {
+		return false;
+	}
+
+	// Pick the level where the rectangle is at most a texel across, so it touches no more than 2x2 texels
+	const glm::vec2 size = (rectMax - rectMin) * glm::vec2(Levels[0].Width, Levels[0].Height);
+	const int level = std::clamp(static_cast<int>(std::ceil(std::log2(std::max({ size.x, size.y, 1.0f })))), 0, static_cast<int>(Levels.size()) - 1);
+	const Level& entry = Levels[level];
+	const int x0 = std::min(static_cast<int>(rectMin.x * entry.Width), entry.Width - 1);
+	const int y0 = std::min(static_cast<int>(rectMin.y * entry.Height), entry.Height - 1);
+	const int x1 = std::min(static_cast<int>(rectMax.x * entry.Width), entry.Width - 1);
+	const int y1 = std::min(static_cast<int>(rectMax.y * entry.Height), entry.Height - 1);
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			if (nearest <= Depths[entry.Offset + y * entry.Width + x]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+DepthPyramid::DepthPyramid() :
+	_isReady(false),
+	_texture(0),
+	_width(0),
+	_height(0),
+	_levelCount(0),
+	_hasPyramid(false),
+	_viewProjection(glm::mat4(1.0f)),
+	_nextReadback(0),
+	_occlusionMap(nullptr)
+{
+	GPU_RESOURCE_OWNER("DepthPyramid");
+	_shader = Shader::Create();
+	_shader->LoadShaderPartFromFile("shaders/depth_pyramid.comp.glsl", GL_COMPUTE_SHADER);
+	_isReady = _shader->Link();
+	if (!_isReady) {
+		LOG_WARN("Depth pyramid shader failed to compile, occlusion culling will be skipped");
+	}
+
+	for (Readback& readback : _readbacks) {
+		glCreateBuffers(1, &readback.Buffer);
+		glNamedBufferStorage(readback.Buffer, READBACK_SIZE * READBACK_SIZE * sizeof(float), nullptr, GL_MAP_READ_BIT);
+		GpuResources::AddRaw(GL_BUFFER, readback.Buffer, READBACK_SIZE * READBACK_SIZE * sizeof(float), "Depth Pyramid Readback");
+		readback.Fence = nullptr;
+		readback.Width = readback.Height = 0;
+		readback.ViewProjection = glm::mat4(1.0f);
+	}
+}
+
+DepthPyramid::~DepthPyramid() {
+	Reset();
+	_DeleteTexture();
+	for (Readback& readback : _readbacks) {
+		GpuResources::RemoveRaw(GL_BUFFER, readback.Buffer);
+		glDeleteBuffers(1, &readback.Buffer);
+	}
+}
+
+void DepthPyramid::_DeleteTexture() {
+	if (_texture != 0) {
+		RenderState::OnTextureDeleted(_texture);
+		GpuResources::RemoveRaw(GL_TEXTURE, _texture);
+		glDeleteTextures(1, &_texture);
+		_texture = 0;
+	}
+	_width = _height = _levelCount = 0;
+	_hasPyramid = false;
+}
+
+void DepthPyramid::Reset() {
+	for (Readback& readback : _readbacks) {
+		if (readback.Fence != nullptr) {
+			glDeleteSync(readback.Fence);
+			readback.Fence = nullptr;
+		}
+	}
+	_nextReadback = 0;
+	_hasPyramid = false;
+	_occlusionMap = nullptr;
+}
+
+void DepthPyramid::Build(GLuint depth, int width, int height, const glm::mat4& viewProjection) {
+	GPU_RESOURCE_OWNER("DepthPyramid");
+	_PollReadbacks();
+
+	// The first level is the biggest power of two that fits, so every level after it is exactly half the last one
+	int levelWidth = 1, levelHeight = 1;
+	while (levelWidth * 2 <= width) {
+		levelWidth *= 2;
+	}
+	while (levelHeight * 2 <= height) {
+		levelHeight *= 2;
+	}
+	if (levelWidth != _width || levelHeight != _height) {
+		_DeleteTexture();
+		_width = levelWidth;
+		_height = levelHeight;
+		_levelCount = 1 + static_cast<int>(std::log2(std::max(levelWidth, levelHeight)));
+		glCreateTextures(GL_TEXTURE_2D, 1, &_texture);
+		glTextureStorage2D(_texture, _levelCount, GL_R32F, _width, _height);
+		// The mips add up to a third on top of the first level
+		GpuResources::AddRaw(GL_TEXTURE, _texture, static_cast<size_t>(_width) * _height * 4 * 4 / 3, "Depth Pyramid");
+		glTextureParameteri(_texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTextureParameteri(_texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	// The first level shrinks the scene's depth by up to half, every level after that halves the one before it
+	_shader->Bind();
+	RenderState::BindSampler(SOURCE_UNIT, 0);
+	_Reduce(depth, 0, 0, _width, _height);
+	for (int level = 1; level < _levelCount; level++) {
+		_Reduce(_texture, level - 1, level, std::max(_width >> level, 1), std::max(_height >> level, 1));
+	}
+	_hasPyramid = true;
+	_viewProjection = viewProjection;
+
+	// Read back the first level that's small enough, unless the GPU is still working through the reads we've
+	// already asked for. We'll pick it up once it's fence has passed
+	Readback& readback = _readbacks[_nextReadback];
+	if (readback.Fence != nullptr) {
+		return;
+	}
+	int level = 0;
+	while (level < _levelCount - 1 && (std::max(_width >> level, 1) > READBACK_SIZE || std::max(_height >> level, 1) > READBACK_SIZE)) {
+		level++;
+	}
+	readback.Width = std::max(_width >> level, 1);
+	readback.Height = std::max(_height >> level, 1);
+	readback.ViewProjection = viewProjection;
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer);
+	glGetTextureImage(_texture, level, GL_RED, GL_FLOAT, readback.Width * readback.Height * sizeof(float), nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_nextReadback = (_nextReadback + 1) % GpuProfiler::FRAME_LATENCY;
+}
+
+void DepthPyramid::_Reduce(GLuint source, int sourceLevel, int level, int width, int height) {
+	RenderState::BindTextureUnit(SOURCE_UNIT, source);
+	_shader->SetUniform("u_SourceLevel"_hs, sourceLevel);
+	glBindImageTexture(TARGET_IMAGE_UNIT, _texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glDispatchCompute((width + GROUP_SIZE - 1) / GROUP_SIZE, (height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+	// The next level (or next frame's culling) reads what this one wrote
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void DepthPyramid::_PollReadbacks() {
+	// The oldest read back is the one we're about to write next, and they finish in the order they were asked for
+	for (int ix = 0; ix < GpuProfiler::FRAME_LATENCY; ix++) {
+		Readback& readback = _readbacks[(_nextReadback + ix) % GpuProfiler::FRAME_LATENCY];
+		if (readback.Fence == nullptr) {
+			continue;
+		}
+		if (glClientWaitSync(readback.Fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			break;
+		}
+		glDeleteSync(readback.Fence);
+		readback.Fence = nullptr;
+
+		// Copy the level out, then build the rest of the chain under it on the CPU since it's so small
+		std::shared_ptr<OcclusionMap> map = std::make_shared<OcclusionMap>();
+		map->ViewProjection = readback.ViewProjection;
+		map->Levels.push_back({ readback.Width, readback.Height, 0 });
+		map->Depths.resize(static_cast<size_t>(readback.Width) * readback.Height);
+		const void* data = glMapNamedBufferRange(readback.Buffer, 0, map->Depths.size() * sizeof(float), GL_MAP_READ_BIT);
+		if (data == nullptr) {
+			LOG_WARN("Failed to map a depth pyramid read back");
+			continue;
+		}
+		memcpy(map->Depths.data(), data, map->Depths.size() * sizeof(float));
+		glUnmapNamedBuffer(readback.Buffer);
+		while (map->Levels.back().Width > 1 || map->Levels.back().Height > 1) {
+			const OcclusionMap::Level above = map->Levels.back();
+			OcclusionMap::Level entry = { std::max(above.Width / 2, 1), std::max(above.Height / 2, 1), static_cast<uint32_t>(map->Depths.size()) };
+			map->Depths.resize(map->Depths.size() + static_cast<size_t>(entry.Width) * entry.Height);
+			for (int y = 0; y < entry.Height; y++) {
+				for (int x = 0; x < entry.Width; x++) {
+					float farthest = 0.0f;
+					for (int sy = y * 2; sy <= std::min(y * 2 + 1, above.Height - 1); sy++) {
+						for (int sx = x * 2; sx <= std::min(x * 2 + 1, above.Width - 1); sx++) {
+							farthest = std::max(farthest, map->Depths[above.Offset + sy * above.Width + sx]);
+						}
+					}
+					map->Depths[entry.Offset + y * entry.Width + x] = farthest;
+				}
+			}
+			map->Levels.push_back(entry);
+		}
+		_occlusionMap = map;
+	}
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "BoundingVolume.h"
+#include "GpuProfiler.h"
+#include "Shader.h"
+
+/// <summary>
+/// A small copy of a DepthPyramid that was read back to the CPU, along with the camera it was drawn from. It never
+/// changes once it's been made, so it can be handed to the workers building a RenderSnapshot while the main thread
+/// reads back the next one
+/// </summary>
+struct OcclusionMap
+{
+	typedef std::shared_ptr<const OcclusionMap> sptr;
+
+	// A level of the map, each half the size of the one before it
+	struct Level {
+		int      Width;
+		int      Height;
+		// Where the level starts in Depths
+		uint32_t Offset;
+	};
+
+	// The view-projection the depths were drawn with
+	glm::mat4          ViewProjection;
+	std::vector<Level> Levels;
+	// The farthest depth under each texel of every level, one after the other
+	std::vector<float> Depths;
+
+	/// <summary>
+	/// Checks whether a world space volume was completely hidden behind what was drawn, by testing it's nearest depth
+	/// against the level where it's screen rectangle covers no more than 2x2 texels
+	/// </summary>
+	/// <param name="bounds">The bounding volume to test, in world space</param>
+	/// <returns>True if the volume is definitely hidden, false if it might be visible</returns>
+	bool IsOccluded(const BoundingVolume& bounds) const;
+};
+
+/// <summary>
+/// Builds a hierarchical depth buffer (Hi-Z) from the scene's depth once it's been drawn: a chain of R32F levels where
+/// each texel holds the farthest depth under it, the first level being the largest power of two that fits in the
+/// scene. Anything whose nearest point is behind the farthest depth over it's whole screen rectangle can't be seen
+///
+/// Next frame, the pyramid gets used to skip what was hidden behind this frame's depth. On the GPU the meshlet culling
+/// pass tests each cluster against it (see MeshletCuller), and a small level gets read back to the CPU without
+/// stalling so the snapshot builder can test whole renderers (see OcclusionMap). The read back arrives
+/// GpuProfiler::FRAME_LATENCY frames late, so something that comes out from behind an occluder can take a couple of
+/// frames to show up
+/// </summary>
+class DepthPyramid final
+{
+public:
+	typedef std::shared_ptr<DepthPyramid> sptr;
+	static inline sptr Create() {
+		return std::make_shared<DepthPyramid>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	DepthPyramid(const DepthPyramid& other) = delete;
+	DepthPyramid(DepthPyramid&& other) = delete;
+	DepthPyramid& operator=(const DepthPyramid& other) = delete;
+	DepthPyramid& operator=(DepthPyramid&& other) = delete;
+
+public:
+	// The largest level that gets read back to the CPU, in texels along each side
+	static const int READBACK_SIZE = 64;
+
+	/// <summary>
+	/// Compiles the shader, the pyramid gets created the first time Build knows how big it needs to be
+	/// </summary>
+	DepthPyramid();
+	~DepthPyramid();
+
+	/// <summary>
+	/// Returns true if the shader compiled, if not nothing should be occlusion culled
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Builds the pyramid from the scene's depth, and starts reading back the level that goes to the CPU. Also
+	/// picks up any read backs that have finished since the last call
+	/// </summary>
+	/// <param name="depth">The scene's depth texture, must be sampleable</param>
+	/// <param name="width">The width of the depth texture, in pixels</param>
+	/// <param name="height">The height of the depth texture, in pixels</param>
+	/// <param name="viewProjection">The view-projection that the depth was drawn with</param>
+	void Build(GLuint depth, int width, int height, const glm::mat4& viewProjection);
+	/// <summary>
+	/// Forgets the pyramid and any read backs, so nothing gets culled against a view that's gone stale (ex: when
+	/// occlusion culling gets turned off)
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Returns true if the pyramid has been built since it was created or reset
+	/// </summary>
+	bool HasPyramid() const { return _hasPyramid; }
+	/// <summary>
+	/// Gets the pyramid texture, or 0 if it hasn't been built yet
+	/// </summary>
+	GLuint GetTexture() const { return _texture; }
+	/// <summary>
+	/// Gets the view-projection that the pyramid was built with
+	/// </summary>
+	const glm::mat4& GetViewProjection() const { return _viewProjection; }
+	/// <summary>
+	/// Gets the number of levels in the pyramid
+	/// </summary>
+	int GetLevelCount() const { return _levelCount; }
+	/// <summary>
+	/// Gets the latest level to make it back to the CPU, or nullptr if none have yet
+	/// </summary>
+	const OcclusionMap::sptr& GetOcclusionMap() const { return _occlusionMap; }
+
+protected:
+	// A read back that's on it's way from the GPU
+	struct Readback {
+		GLuint    Buffer;
+		GLsync    Fence;
+		int       Width;
+		int       Height;
+		glm::mat4 ViewProjection;
+	};
+
+	Shader::sptr       _shader;
+	bool               _isReady;
+	GLuint             _texture;
+	int                _width;
+	int                _height;
+	int                _levelCount;
+	bool               _hasPyramid;
+	glm::mat4          _viewProjection;
+	Readback           _readbacks[GpuProfiler::FRAME_LATENCY];
+	int                _nextReadback;
+	OcclusionMap::sptr _occlusionMap;
+
+	// Runs one reduction, from a level of the source into a level of the pyramid
+	void _Reduce(GLuint source, int sourceLevel, int level, int width, int height);
+	// Turns any read backs that the GPU has finished into occlusion maps, oldest first
+	void _PollReadbacks();
+	// Deletes the pyramid and any fences, if they exist
+	void _DeleteTexture();
+};
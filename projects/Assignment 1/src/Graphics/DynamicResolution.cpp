@@ -0,0 +1,58 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "GpuProfiler.h"
+
+// How much each new frame time counts towards the smoothed one
+static const float FRAME_SMOOTHING = 0.2f;
+// How much of the way to the ideal scale each step goes, less than 1 so we don't overshoot on noisy frames
+static const float STEP_GAIN = 0.5f;
+
+DynamicResolution::DynamicResolution() :
+	_scale(1.0f),
+	_frameMs(0.0f),
+	_lastVersion(0),
+	_cooldown(0)
+{ }
+
+void DynamicResolution::Update() {
+	const GpuProfiler& profiler = GpuProfiler::Instance();
+	if (profiler.GetResultsVersion() == _lastVersion || profiler.GetResults().empty()) {
+		return;
+	}
+	_lastVersion = profiler.GetResultsVersion();
+	// The first zone is the whole frame
+	const float frameMs = profiler.GetResults()[0].GetMilliseconds();
+	_frameMs = _frameMs > 0.0f ? _frameMs + (frameMs - _frameMs) * FRAME_SMOOTHING : frameMs;
+
+	// Frames that were drawn before the last change don't tell us anything about it
+	if (_cooldown > 0) {
+		_cooldown--;
+		return;
+	}
+
+	const float target = BudgetMs * Headroom;
+	const float ideal = _scale * std::sqrt(target / std::max(_frameMs, 0.01f));
+	float scale = _scale + (ideal - _scale) * STEP_GAIN;
+	scale = std::round(scale / SCALE_STEP) * SCALE_STEP;
+	scale = std::clamp(scale, MinScale, std::max(MinScale, MaxScale));
+	if (scale != _scale) {
+		_scale = scale;
+		_cooldown = GpuProfiler::FRAME_LATENCY;
+		// The old frame times were for a different resolution
+		_frameMs = 0.0f;
+	}
+}
+
+void DynamicResolution::Reset() {
+	_scale = std::clamp(1.0f, MinScale, std::max(MinScale, MaxScale));
+	_frameMs = 0.0f;
+	_cooldown = 0;
+}
+
+void DynamicResolution::GetRenderSize(int screenWidth, int screenHeight, int& width, int& height) const {
+	width = std::max(static_cast<int>(screenWidth * _scale + 0.5f), 1);
+	height = std::max(static_cast<int>(screenHeight * _scale + 0.5f), 1);
+}
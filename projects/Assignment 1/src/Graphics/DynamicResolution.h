@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+/// <summary>
+/// Picks the resolution the scene gets drawn at each frame, so the GPU's frame time stays under a budget. The frame
+/// time comes from the GpuProfiler's frame zone, which is FRAME_LATENCY frames old by the time we see it. The cost of
+/// a frame is treated as mostly proportional to the number of pixels drawn, so each step scales both sides by the
+/// square root of how far over (or under) the budget we are
+///
+/// The scale moves in steps of SCALE_STEP, and waits for the results of the last change to come back before making
+/// another one, so it settles instead of bouncing around (and the scene targets don't get recreated every frame)
+/// </summary>
+class DynamicResolution final
+{
+public:
+	typedef std::shared_ptr<DynamicResolution> sptr;
+	static inline sptr Create() {
+		return std::make_shared<DynamicResolution>();
+	}
+
+public:
+	// The smallest change the scale can make
+	static constexpr float SCALE_STEP = 0.05f;
+
+	// The GPU frame time to stay under, in milliseconds
+	float BudgetMs = 16.6f;
+	// The fraction of the budget we aim for, the rest is left for spikes
+	float Headroom = 0.9f;
+	// The range of the scale, applied to both the width and height
+	float MinScale = 0.5f;
+	float MaxScale = 1.0f;
+
+	DynamicResolution();
+	~DynamicResolution() = default;
+
+	/// <summary>
+	/// Adjusts the scale if the GpuProfiler has read back a new frame since the last call. Call once a frame
+	/// </summary>
+	void Update();
+	/// <summary>
+	/// Goes back to full resolution, and forgets the frame times seen so far (ex: when it gets turned off)
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Gets the current scale for the width and height of the screen
+	/// </summary>
+	float GetScale() const { return _scale; }
+	/// <summary>
+	/// Gets the smoothed GPU frame time the scale is being picked from, in milliseconds
+	/// </summary>
+	float GetFrameMs() const { return _frameMs; }
+	/// <summary>
+	/// Scales the size of the screen to the size the scene should be drawn at
+	/// </summary>
+	void GetRenderSize(int screenWidth, int screenHeight, int& width, int& height) const;
+
+protected:
+	float    _scale;
+	float    _frameMs;
+	uint64_t _lastVersion;
+	// The number of results left to see before the last change shows up in them
+	int      _cooldown;
+};
@@ -0,0 +1,121 @@
+#include "EnvironmentPrefilter.h"
+
+#include <algorithm>
+#include "GpuResources.h"
+#include "Logging.h"
+#include "Utilities/CpuProfiler.h"
+
+// Must match local_size_x and local_size_y in env_prefilter.comp.glsl
+static const uint32_t GROUP_SIZE = 8;
+// The texture and image units the passes read and write through
+static const int SOURCE_UNIT = 0;
+static const int TARGET_IMAGE_UNIT = 0;
+// The extensions of the sidecars the results are cached in
+static const std::string SPECULAR_EXTENSION = ".specular.mips";
+static const std::string IRRADIANCE_EXTENSION = ".irradiance.mips";
+
+// Compiles one of the passes in env_prefilter.comp.glsl
+static Shader::sptr CreatePass(const std::string& define) {
+	Shader::sptr result = Shader::Create();
+	result->LoadShaderPartFromFile("shaders/env_prefilter.comp.glsl", GL_COMPUTE_SHADER, { define });
+	return result;
+}
+
+EnvironmentPrefilter::EnvironmentPrefilter() :
+	_isReady(false)
+{
+	_downsampleShader = CreatePass("DOWNSAMPLE");
+	_specularShader = CreatePass("SPECULAR");
+	_irradianceShader = CreatePass("IRRADIANCE");
+	_isReady = _downsampleShader->Link() & _specularShader->Link() & _irradianceShader->Link();
+	if (!_isReady) {
+		LOG_WARN("Environment prefilter shaders failed to compile, only cached environments can be loaded");
+	}
+}
+
+EnvironmentPrefilter::Result EnvironmentPrefilter::Load(const std::string& rootImagePath, const TextureCubeMap::sptr& source) {
+	PROFILE_SCOPE("EnvironmentPrefilter::Load");
+	// The sidecars sit next to the first face (or the panorama), so they get re-filtered when it changes. Editing just
+	// one of the other faces needs the sidecars deleting by hand
+	const std::string stampPath = TextureCubeMapData::IsPanorama(rootImagePath) ?
+		rootImagePath : TextureCubeMapData::GetFacePath(rootImagePath, CubeMapFace::PosX);
+
+	MipChainData::sptr specular = MipChainData::LoadSidecar(stampPath, SPECULAR_EXTENSION);
+	MipChainData::sptr irradiance = MipChainData::LoadSidecar(stampPath, IRRADIANCE_EXTENSION);
+	if (specular != nullptr && irradiance != nullptr &&
+		specular->GetWidth() == SPECULAR_SIZE && specular->GetLevelCount() == SPECULAR_LEVELS &&
+		irradiance->GetWidth() == IRRADIANCE_SIZE)
+	{
+		Result result;
+		result.Specular = _CreateTarget(SPECULAR_SIZE, SPECULAR_LEVELS);
+		result.Specular->LoadLevels(specular);
+		result.Irradiance = _CreateTarget(IRRADIANCE_SIZE, 1);
+		result.Irradiance->LoadLevels(irradiance);
+		return result;
+	}
+
+	Result result = Filter(source);
+	if (result.Specular != nullptr && result.Irradiance != nullptr) {
+		bool saved = result.Specular->ReadLevels(PixelFormat::RGBA, PixelType::Half)->SaveSidecar(stampPath, SPECULAR_EXTENSION);
+		saved &= result.Irradiance->ReadLevels(PixelFormat::RGBA, PixelType::Half)->SaveSidecar(stampPath, IRRADIANCE_EXTENSION);
+		if (saved) {
+			LOG_INFO("Prefiltered environment \"{}\" and cached it next to \"{}\"", rootImagePath, stampPath);
+		}
+	}
+	return result;
+}
+
+EnvironmentPrefilter::Result EnvironmentPrefilter::Filter(const TextureCubeMap::sptr& source) {
+	Result result;
+	if (!_isReady || source == nullptr || source->GetSize() == 0) {
+		return result;
+	}
+
+	// The source gets shrunk into a cube with a full mip chain first, so the convolutions can read lower mips for
+	// their wider samples instead of needing thousands of taps each
+	TextureCubeMap::sptr radiance = _CreateTarget(SPECULAR_SIZE, 0);
+	_Dispatch(_downsampleShader, source, radiance, 0);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	glGenerateTextureMipmap(radiance->GetHandle());
+
+	// A roughness of 0 is a mirror, so the top level is just the shrunk source
+	result.Specular = _CreateTarget(SPECULAR_SIZE, SPECULAR_LEVELS);
+	glCopyImageSubData(radiance->GetHandle(), GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+		result.Specular->GetHandle(), GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0, SPECULAR_SIZE, SPECULAR_SIZE, 6);
+	_specularShader->SetUniform("u_SourceSize"_hs, (float)SPECULAR_SIZE);
+	for (uint32_t level = 1; level < SPECULAR_LEVELS; level++) {
+		_specularShader->SetUniform("u_Roughness"_hs, level / (float)(SPECULAR_LEVELS - 1));
+		_Dispatch(_specularShader, radiance, result.Specular, level);
+	}
+
+	result.Irradiance = _CreateTarget(IRRADIANCE_SIZE, 1);
+	_irradianceShader->SetUniform("u_SourceSize"_hs, (float)SPECULAR_SIZE);
+	_Dispatch(_irradianceShader, radiance, result.Irradiance, 0);
+
+	// Anything can read the results next, including reading them back to the CPU
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	return result;
+}
+
+void EnvironmentPrefilter::_Dispatch(const Shader::sptr& shader, const TextureCubeMap::sptr& source, const TextureCubeMap::sptr& target, uint32_t level) {
+	const uint32_t size = std::max(target->GetSize() >> level, 1u);
+	shader->SetUniform("u_TargetSize"_hs, (int)size);
+	shader->Bind();
+	source->Bind(SOURCE_UNIT);
+	// Binding the level as layered gives the shader all 6 faces
+	glBindImageTexture(TARGET_IMAGE_UNIT, target->GetHandle(), level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glDispatchCompute((size + GROUP_SIZE - 1) / GROUP_SIZE, (size + GROUP_SIZE - 1) / GROUP_SIZE, 6);
+}
+
+TextureCubeMap::sptr EnvironmentPrefilter::_CreateTarget(uint32_t size, uint32_t levelCount) {
+	GPU_RESOURCE_OWNER("EnvironmentPrefilter");
+	TextureCubeDesc desc;
+	desc.Size = size;
+	desc.Format = InternalFormat::RGBA16F;
+	desc.MinificationFilter = levelCount == 1 ? MinFilter::Linear : MinFilter::LinearMipLinear;
+	desc.MagnificationFilter = MagFilter::Linear;
+	// A level count of 0 with mips turned on gets us a full chain
+	desc.GenerateMipMaps = levelCount == 0;
+	desc.LevelCount = levelCount;
+	return TextureCubeMap::Create(desc);
+}
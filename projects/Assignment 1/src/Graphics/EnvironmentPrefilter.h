@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "Shader.h"
+#include "TextureCubeMap.h"
+
+/// <summary>
+/// Prefilters environment maps for reflections, so materials can read a blurred reflection with a single textureLod
+/// instead of taking lots of taps around the reflection vector. Each mip of the specular map is the environment
+/// convolved with a wider GGX lobe, from a mirror at the top level to fully rough at the last one, and the irradiance
+/// map is a small cube with the diffuse light coming from each direction
+///
+/// Filtering takes a few milliseconds on the GPU, so the results are read back and saved as sidecars next to the
+/// cube map's images (see MipChainData). After the first run they just get uploaded
+/// </summary>
+class EnvironmentPrefilter final
+{
+public:
+	typedef std::shared_ptr<EnvironmentPrefilter> sptr;
+	static inline sptr Create() {
+		return std::make_shared<EnvironmentPrefilter>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	EnvironmentPrefilter(const EnvironmentPrefilter& other) = delete;
+	EnvironmentPrefilter(EnvironmentPrefilter&& other) = delete;
+	EnvironmentPrefilter& operator=(const EnvironmentPrefilter& other) = delete;
+	EnvironmentPrefilter& operator=(EnvironmentPrefilter&& other) = delete;
+
+public:
+	// The size of a face of the specular map's top level, and how many roughness levels it has (128 down to 4)
+	static const uint32_t SPECULAR_SIZE = 128;
+	static const uint32_t SPECULAR_LEVELS = 6;
+	// The size of a face of the irradiance map, it's so blurry that anything bigger is wasted
+	static const uint32_t IRRADIANCE_SIZE = 16;
+
+	/// <summary>
+	/// The maps made from an environment, either can be null if filtering failed
+	/// </summary>
+	struct Result {
+		// Sample with textureLod(s, dir, roughness * (SPECULAR_LEVELS - 1))
+		TextureCubeMap::sptr Specular;
+		// Sample with the surface normal
+		TextureCubeMap::sptr Irradiance;
+	};
+
+	/// <summary>
+	/// Creates the prefilter, and compiles it's shaders
+	/// </summary>
+	EnvironmentPrefilter();
+	~EnvironmentPrefilter() = default;
+
+	/// <summary>
+	/// Returns true if the filtering shaders compiled, if not only cached results can be loaded
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Gets the prefiltered maps for a cube map, loading them from it's sidecars if they are up to date, and filtering
+	/// them on the GPU and writing the sidecars if not
+	/// </summary>
+	/// <param name="rootImagePath">The path the cube map was loaded from, see TextureCubeMapData::LoadFromImages</param>
+	/// <param name="source">The cube map loaded from that path</param>
+	Result Load(const std::string& rootImagePath, const TextureCubeMap::sptr& source);
+
+	/// <summary>
+	/// Filters a cube map on the GPU, without touching the cache
+	/// </summary>
+	/// <param name="source">The cube map to filter</param>
+	Result Filter(const TextureCubeMap::sptr& source);
+
+protected:
+	Shader::sptr _downsampleShader;
+	Shader::sptr _specularShader;
+	Shader::sptr _irradianceShader;
+	bool         _isReady;
+
+	// Runs one of the filter passes over every face of a level of the target
+	static void _Dispatch(const Shader::sptr& shader, const TextureCubeMap::sptr& source, const TextureCubeMap::sptr& target, uint32_t level);
+	// Creates one of our half float cube maps
+	static TextureCubeMap::sptr _CreateTarget(uint32_t size, uint32_t levelCount);
+};
@@ -0,0 +1,188 @@
+#include "FrameCapture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <stb_image_write.h>
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "Utilities/CpuProfiler.h"
+
+FrameCapture::FrameCapture() :
+	_nextSlot(0),
+	_screenshotPath(""),
+	_isRecording(false),
+	_recordingPrefix(""),
+	_recordingFormat(Format::Raw),
+	_recordedFrames(0),
+	_writtenCount(0),
+	_droppedCount(0)
+{
+	// The buffers get created the first time they're needed, since we don't know how big the back buffer is yet
+	for (Slot& slot : _slots) {
+		slot.Buffer = 0;
+		slot.Size = 0;
+		slot.Data = nullptr;
+		slot.Fence = nullptr;
+		slot.Width = slot.Height = 0;
+		slot.OutputFormat = Format::Png;
+	}
+}
+
+FrameCapture::~FrameCapture() {
+	Flush();
+	for (Slot& slot : _slots) {
+		if (slot.Buffer != 0) {
+			glUnmapNamedBuffer(slot.Buffer);
+			GpuResources::RemoveRaw(GL_BUFFER, slot.Buffer);
+			glDeleteBuffers(1, &slot.Buffer);
+		}
+	}
+}
+
+void FrameCapture::RequestScreenshot(const std::string& path) {
+	_screenshotPath = path;
+}
+
+void FrameCapture::StartRecording(const std::string& prefix, Format format) {
+	_isRecording = true;
+	_recordingPrefix = prefix;
+	_recordingFormat = format;
+	_recordedFrames = 0;
+	LOG_INFO("Recording frames to {}_*{}", prefix, format == Format::Png ? ".png" : ".rgba");
+}
+
+void FrameCapture::StopRecording() {
+	if (_isRecording) {
+		LOG_INFO("Stopped recording after {} frames, {} were dropped so far", _recordedFrames, _droppedCount);
+	}
+	_isRecording = false;
+}
+
+void FrameCapture::Capture(int width, int height) {
+	PROFILE_SCOPE("FrameCapture");
+	_Poll(false);
+	if ((_screenshotPath.empty() && !_isRecording) || width <= 0 || height <= 0) {
+		return;
+	}
+
+	// We'd rather lose a frame than wait on the GPU or the workers
+	Slot& slot = _slots[_nextSlot];
+	if (slot.Fence != nullptr || slot.Write.IsValid()) {
+		_droppedCount++;
+		return;
+	}
+	_nextSlot = (_nextSlot + 1) % RING_SIZE;
+
+	slot.Width = width;
+	slot.Height = height;
+	if (!_screenshotPath.empty()) {
+		slot.OutputFormat = Format::Png;
+		slot.Path = _screenshotPath;
+		_screenshotPath.clear();
+	} else {
+		char frame[16];
+		snprintf(frame, sizeof(frame), "_%06u", _recordedFrames++);
+		slot.OutputFormat = _recordingFormat;
+		slot.Path = _recordingPrefix + frame;
+		slot.Path += _recordingFormat == Format::Png ? ".png" : "_" + std::to_string(width) + "x" + std::to_string(height) + ".rgba";
+	}
+	_Reserve(slot, static_cast<size_t>(width) * height * 4);
+
+	// The copy goes into the buffer instead of client memory, so it's queued up with the frame instead of waiting for it
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glReadBuffer(GL_BACK);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void FrameCapture::Flush() {
+	_Poll(true);
+	for (Slot& slot : _slots) {
+		if (slot.Write.IsValid()) {
+			ThreadPool::Instance().Wait(slot.Write);
+			slot.Write = Task<void>();
+		}
+	}
+}
+
+void FrameCapture::_Poll(bool wait) {
+	for (Slot& slot : _slots) {
+		if (slot.Write.IsValid() && slot.Write.IsDone()) {
+			slot.Write = Task<void>();
+		}
+		if (slot.Fence == nullptr) {
+			continue;
+		}
+		// Waiting has to flush, or we could wait forever on commands the driver hasn't sent yet
+		const GLenum status = wait ?
+			glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX) :
+			glClientWaitSync(slot.Fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			continue;
+		}
+		glDeleteSync(slot.Fence);
+		slot.Fence = nullptr;
+		if (status == GL_WAIT_FAILED) {
+			LOG_WARN("Failed to wait on the capture for {}", slot.Path);
+			continue;
+		}
+		// The buffer is coherent, so once the fence has passed the pixels can be read from any thread
+		std::atomic<uint32_t>* written = &_writtenCount;
+		const Slot* source = &slot;
+		slot.Write = ThreadPool::Instance().Schedule([source, written]() {
+			if (_WriteSlot(*source)) {
+				(*written)++;
+			}
+		});
+	}
+}
+
+void FrameCapture::_Reserve(Slot& slot, size_t size) {
+	if (slot.Size >= size) {
+		return;
+	}
+	GPU_RESOURCE_OWNER("FrameCapture");
+	if (slot.Buffer != 0) {
+		glUnmapNamedBuffer(slot.Buffer);
+		GpuResources::RemoveRaw(GL_BUFFER, slot.Buffer);
+		glDeleteBuffers(1, &slot.Buffer);
+	}
+	const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &slot.Buffer);
+	glNamedBufferStorage(slot.Buffer, size, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+	slot.Data = static_cast<uint8_t*>(glMapNamedBufferRange(slot.Buffer, 0, size, flags));
+	slot.Size = size;
+	GpuResources::AddRaw(GL_BUFFER, slot.Buffer, size, "Frame Capture");
+}
+
+bool FrameCapture::_WriteSlot(const Slot& slot) {
+	PROFILE_SCOPE("WriteCapture");
+	if (slot.Data == nullptr) {
+		LOG_WARN("Failed to map the capture for {}", slot.Path);
+		return false;
+	}
+	// OpenGL reads the bottom row first, images start at the top
+	const size_t rowSize = static_cast<size_t>(slot.Width) * 4;
+	std::vector<uint8_t> pixels(rowSize * slot.Height);
+	for (int row = 0; row < slot.Height; row++) {
+		memcpy(pixels.data() + rowSize * row, slot.Data + rowSize * (slot.Height - 1 - row), rowSize);
+	}
+
+	bool success;
+	if (slot.OutputFormat == Format::Png) {
+		success = stbi_write_png(slot.Path.c_str(), slot.Width, slot.Height, 4, pixels.data(), static_cast<int>(rowSize)) != 0;
+	} else {
+		std::ofstream file(slot.Path, std::ios::binary);
+		success = file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size()).good();
+	}
+	if (!success) {
+		LOG_WARN("Failed to write a capture to {}", slot.Path);
+	}
+	return success;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <glad/glad.h>
+
+#include "Utilities/ThreadPool.h"
+
+/// <summary>
+/// Saves what's in the back buffer to disk without stalling the frame, for screenshots and recording frame sequences.
+/// A capture copies the back buffer into one of a ring of pixel pack buffers, which the GPU fills in whenever it gets
+/// to it. A few frames later, once the copy's fence has passed, a worker reads the pixels straight out of the mapped
+/// buffer and writes them out as a PNG (or as raw RGBA8, which is much cheaper to write when recording)
+///
+/// If every buffer in the ring is still waiting on the GPU or being written out, the frame gets dropped rather than
+/// waiting, so recording can skip frames but never slows the frame down
+/// </summary>
+class FrameCapture final
+{
+public:
+	typedef std::shared_ptr<FrameCapture> sptr;
+	static inline sptr Create() {
+		return std::make_shared<FrameCapture>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	FrameCapture(const FrameCapture& other) = delete;
+	FrameCapture(FrameCapture&& other) = delete;
+	FrameCapture& operator=(const FrameCapture& other) = delete;
+	FrameCapture& operator=(FrameCapture&& other) = delete;
+
+public:
+	/// <summary>
+	/// How the captured frames get written out
+	/// </summary>
+	enum class Format {
+		// Compressed, but slow enough to write that recordings at full rate will drop frames
+		Png,
+		// The pixels as they are, 4 bytes per pixel with the top row first. The size is added to the file's name
+		Raw
+	};
+
+	// The number of captures that can be on their way back from the GPU or being written out at once
+	static const int RING_SIZE = 4;
+
+	FrameCapture();
+	~FrameCapture();
+
+	/// <summary>
+	/// Saves the next frame that gets captured as a PNG
+	/// </summary>
+	/// <param name="path">The path to write the image to, including it's extension</param>
+	void RequestScreenshot(const std::string& path);
+	/// <summary>
+	/// Starts saving every captured frame, numbered from 0 as [prefix]_[frame].png (or .rgba)
+	/// </summary>
+	/// <param name="prefix">The path to write the frames to, without the frame number or extension</param>
+	/// <param name="format">How to write the frames out</param>
+	void StartRecording(const std::string& prefix, Format format = Format::Raw);
+	/// <summary>
+	/// Stops saving frames, any that were already captured still get written out
+	/// </summary>
+	void StopRecording();
+	/// <summary>
+	/// Returns true between StartRecording and StopRecording
+	/// </summary>
+	bool IsRecording() const { return _isRecording; }
+
+	/// <summary>
+	/// Copies the back buffer into the ring if a screenshot was requested or we're recording, and hands any copies the
+	/// GPU has finished to the workers to write out. Should be called once the frame is finished, before the swap
+	/// </summary>
+	/// <param name="width">The width of the back buffer, in pixels</param>
+	/// <param name="height">The height of the back buffer, in pixels</param>
+	void Capture(int width, int height);
+	/// <summary>
+	/// Waits until every capture has been written out, blocking on the GPU if needed
+	/// </summary>
+	void Flush();
+
+	/// <summary>
+	/// Gets the number of frames that have been written out
+	/// </summary>
+	uint32_t GetWrittenCount() const { return _writtenCount; }
+	/// <summary>
+	/// Gets the number of frames that couldn't be captured because the ring was full
+	/// </summary>
+	uint32_t GetDroppedCount() const { return _droppedCount; }
+
+protected:
+	// A capture that's on it's way from the GPU, or being written out
+	struct Slot {
+		GLuint      Buffer;
+		// The size of the buffer, it grows to fit the back buffer
+		size_t      Size;
+		// Persistently mapped, so the workers can read from it without the main thread
+		uint8_t*    Data;
+		// Set while the GPU still has to fill the buffer in
+		GLsync      Fence;
+		// Set while a worker is writing the buffer out
+		Task<void>  Write;
+		int         Width;
+		int         Height;
+		Format      OutputFormat;
+		std::string Path;
+	};
+
+	Slot                  _slots[RING_SIZE];
+	int                   _nextSlot;
+	std::string           _screenshotPath;
+	bool                  _isRecording;
+	std::string           _recordingPrefix;
+	Format                _recordingFormat;
+	uint32_t              _recordedFrames;
+	std::atomic<uint32_t> _writtenCount;
+	uint32_t              _droppedCount;
+
+	// Hands the captures the GPU has finished to the workers, and frees up the slots they're done writing. When
+	// waiting, blocks until every capture has been handed off
+	void _Poll(bool wait);
+	// Makes sure a slot's buffer can hold a capture of a size
+	void _Reserve(Slot& slot, size_t size);
+	// Writes the pixels in a slot out to it's path, flipping them so the top row comes first
+	static bool _WriteSlot(const Slot& slot);
+};
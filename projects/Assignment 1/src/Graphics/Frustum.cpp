@@ -0,0 +1,55 @@
+#include "Frustum.h"
+
+Frustum::Frustum() {
+	for (int ix = 0; ix < 6; ix++) {
+		_planes[ix] = glm::vec4(0.0f);
+	}
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+	// GLM matrices are column major, so we need to pull out the rows ourselves
+	glm::vec4 rows[4];
+	for (int ix = 0; ix < 4; ix++) {
+		rows[ix] = glm::vec4(viewProjection[0][ix], viewProjection[1][ix], viewProjection[2][ix], viewProjection[3][ix]);
+	}
+	// See Gribb and Hartmann, "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix"
+	_planes[0] = rows[3] + rows[0]; // Left
+	_planes[1] = rows[3] - rows[0]; // Right
+	_planes[2] = rows[3] + rows[1]; // Bottom
+	_planes[3] = rows[3] - rows[1]; // Top
+	_planes[4] = rows[3] + rows[2]; // Near
+	_planes[5] = rows[3] - rows[2]; // Far
+
+	// Normalize the planes so that we can measure distances against them
+	for (int ix = 0; ix < 6; ix++) {
+		_planes[ix] /= glm::length(glm::vec3(_planes[ix]));
+	}
+}
+
+bool Frustum::Intersects(const BoundingVolume& bounds) const {
+	glm::vec3 extents = bounds.GetExtents();
+	for (int ix = 0; ix < 6; ix++) {
+		glm::vec3 normal = glm::vec3(_planes[ix]);
+		float distance = glm::dot(normal, bounds.Center) + _planes[ix].w;
+		// Cheap test first, if the whole sphere is behind any plane we can stop
+		if (distance < -bounds.Radius) {
+			return false;
+		}
+		// Otherwise test the box, using the box's projected radius onto the plane normal
+		if (distance < -glm::dot(glm::abs(normal), extents)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Frustum::GetClipPlanes(const glm::mat4& projection, float& nearPlane, float& farPlane) {
+	// The perspective and orthographic cases are told apart by whether clip space w depends on depth
+	if (projection[3][3] == 0.0f) {
+		nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+		farPlane  = projection[3][2] / (projection[2][2] + 1.0f);
+	} else {
+		nearPlane = (projection[3][2] + 1.0f) / projection[2][2];
+		farPlane  = (projection[3][2] - 1.0f) / projection[2][2];
+	}
+}
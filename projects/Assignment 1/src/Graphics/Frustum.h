@@ -0,0 +1,44 @@
+#pragma once
+#include <GLM/glm.hpp>
+#include "BoundingVolume.h"
+
+/// <summary>
+/// Represents the six planes of a camera's view volume, used to cull objects that can't be seen
+/// </summary>
+class Frustum
+{
+public:
+	Frustum();
+	/// <summary>
+	/// Extracts the frustum planes from a combined view-projection matrix
+	/// </summary>
+	/// <param name="viewProjection">The view-projection matrix of the camera</param>
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Checks whether the given world space volume is at least partially inside of the frustum
+	/// </summary>
+	/// <param name="bounds">The bounding volume to test, in world space</param>
+	/// <returns>False if the volume is definitely outside of the frustum, true otherwise</returns>
+	bool Intersects(const BoundingVolume& bounds) const;
+
+	/// <summary>
+	/// Pulls the distances to the near and far clip planes back out of a projection matrix, works for both
+	/// perspective and orthographic projections
+	/// </summary>
+	/// <param name="projection">The projection matrix to read the planes from</param>
+	/// <param name="nearPlane">Will store the distance to the near plane</param>
+	/// <param name="farPlane">Will store the distance to the far plane</param>
+	static void GetClipPlanes(const glm::mat4& projection, float& nearPlane, float& farPlane);
+
+	/// <summary>
+	/// Gets the six planes of the frustum, stored as (normal, distance) with the normals pointing into the frustum.
+	/// In order: left, right, bottom, top, near, far
+	/// </summary>
+	const glm::vec4* GetPlanes() const { return _planes; }
+
+protected:
+	// The planes, stored as (normal, distance) with the normals pointing into the frustum
+	// In order: left, right, bottom, top, near, far
+	glm::vec4 _planes[6];
+};
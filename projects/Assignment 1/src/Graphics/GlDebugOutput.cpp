@@ -0,0 +1,160 @@
+#include "GlDebugOutput.h"
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <GLFW/glfw3.h>
+#include <Logging.h>
+
+#include "Utilities/TraceRecorder.h"
+
+// How often (in seconds) we report a message that keeps being sent
+#define MESSAGE_REPORT_INTERVAL 5.0
+
+bool     GlDebugOutput::_enabled = false;
+bool     GlDebugOutput::_callbackInstalled = false;
+bool     GlDebugOutput::_captureCallStacks = false;
+bool     GlDebugOutput::_logNotifications = false;
+uint32_t GlDebugOutput::_perfLastFrame = 0;
+
+// The callback can come from the driver's threads when the output isn't synchronous, so anything it touches is locked
+struct MessageCount {
+	uint32_t Count = 0;
+	double   LastReport = 0.0;
+};
+static std::mutex                                   messageMutex;
+static std::unordered_map<GLuint, MessageCount>     messageCounts;
+static std::map<GLuint, GlDebugOutput::PerfWarning> perfWarnings;
+static std::atomic<uint32_t>                        perfThisFrame(0);
+
+// Messages that NVIDIA drivers send all the time, which don't tell us anything useful
+static const struct { GLenum Source, Type; GLuint Id; } NoisyMessages[] = {
+	{ GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_OTHER, 131185 }, // Buffer will use video memory
+	{ GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_OTHER, 131169 }, // Framebuffer allocation
+	{ GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_OTHER, 131204 }, // Texture unit has no base level (unused units)
+};
+
+void GlDebugOutput::Init() {
+	for (const auto& noisy : NoisyMessages) {
+		Suppress(noisy.Source, noisy.Type, noisy.Id);
+	}
+	SetLogNotifications(false);
+	// Release builds don't ask for a debug context either, see InitGLFW
+	#ifdef _DEBUG
+	SetEnabled(true);
+	#else
+	SetEnabled(false);
+	#endif
+}
+
+void GlDebugOutput::SetEnabled(bool enabled) {
+	if (enabled && !_callbackInstalled) {
+		glDebugMessageCallback(_Callback, nullptr);
+		_callbackInstalled = true;
+	}
+	if (enabled) {
+		glEnable(GL_DEBUG_OUTPUT);
+	} else {
+		glDisable(GL_DEBUG_OUTPUT);
+	}
+	_enabled = enabled;
+}
+
+void GlDebugOutput::SetCaptureCallStacks(bool capture) {
+	if (capture) {
+		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	} else {
+		glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	}
+	_captureCallStacks = capture;
+}
+
+void GlDebugOutput::SetLogNotifications(bool log) {
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, log);
+	_logNotifications = log;
+}
+
+void GlDebugOutput::Suppress(GLenum source, GLenum type, GLuint id) {
+	glDebugMessageControl(source, type, GL_DONT_CARE, 1, &id, GL_FALSE);
+}
+
+void GlDebugOutput::EndFrame() {
+	_perfLastFrame = perfThisFrame.exchange(0);
+}
+
+void GlDebugOutput::GetPerfWarnings(std::vector<PerfWarning>& result) {
+	std::lock_guard<std::mutex> lock(messageMutex);
+	result.clear();
+	for (const auto& kvp : perfWarnings) {
+		result.push_back(kvp.second);
+	}
+}
+
+void GlDebugOutput::_Callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam) {
+	if (type == GL_DEBUG_TYPE_PERFORMANCE) {
+		_CountPerfWarning(id, message, length);
+		return;
+	}
+
+	// Drivers tend to send the same message every frame, so we log an ID the first time we see it, and after that
+	// only report how many times it's been sent every MESSAGE_REPORT_INTERVAL
+	uint32_t repeats = 0;
+	{
+		std::lock_guard<std::mutex> lock(messageMutex);
+		const double now = glfwGetTime();
+		auto it = messageCounts.find(id);
+		if (it == messageCounts.end()) {
+			messageCounts[id].LastReport = now;
+		} else {
+			it->second.Count++;
+			if (now - it->second.LastReport < MESSAGE_REPORT_INTERVAL) {
+				return;
+			}
+			repeats = it->second.Count;
+			it->second.Count = 0;
+			it->second.LastReport = now;
+		}
+	}
+
+	std::string sourceTxt;
+	switch (source) {
+	case GL_DEBUG_SOURCE_API: sourceTxt = "DEBUG"; break;
+	case GL_DEBUG_SOURCE_WINDOW_SYSTEM: sourceTxt = "WINDOW"; break;
+	case GL_DEBUG_SOURCE_SHADER_COMPILER: sourceTxt = "SHADER"; break;
+	case GL_DEBUG_SOURCE_THIRD_PARTY: sourceTxt = "THIRD PARTY"; break;
+	case GL_DEBUG_SOURCE_APPLICATION: sourceTxt = "APP"; break;
+	case GL_DEBUG_SOURCE_OTHER: default: sourceTxt = "OTHER"; break;
+	}
+	if (repeats > 0) {
+		sourceTxt = fmt::format("{} x{}", sourceTxt, repeats);
+	}
+	switch (severity) {
+	case GL_DEBUG_SEVERITY_LOW:          LOG_INFO("[{}] {}: {}", sourceTxt, id, message); break;
+	case GL_DEBUG_SEVERITY_MEDIUM:       LOG_WARN("[{}] {}: {}", sourceTxt, id, message); break;
+	case GL_DEBUG_SEVERITY_HIGH:
+		// The call stack only points at the call that caused the error when the output is synchronous
+		if (_captureCallStacks) {
+			LOG_ERROR("[{}] {}: {}", sourceTxt, id, message);
+		} else {
+			::Logger::GetLogger()->error("[{}] {}: {}", sourceTxt, id, message);
+		}
+		break;
+	case GL_DEBUG_SEVERITY_NOTIFICATION: LOG_INFO("[{}] {}: {}", sourceTxt, id, message); break;
+	default: break;
+	}
+}
+
+void GlDebugOutput::_CountPerfWarning(GLuint id, const GLchar* message, GLsizei length) {
+	perfThisFrame++;
+	const std::string text(message, length >= 0 ? static_cast<size_t>(length) : strlen(message));
+	{
+		std::lock_guard<std::mutex> lock(messageMutex);
+		PerfWarning& warning = perfWarnings[id];
+		warning.Id = id;
+		warning.Count++;
+		warning.Message = text;
+	}
+	// Warnings like a shader recompile are often the reason for a hitch, so they go in the hitch traces too
+	TraceRecorder::Instance().RecordMessage(text);
+}
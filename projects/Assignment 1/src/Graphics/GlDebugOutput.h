@@ -0,0 +1,80 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Owns how we handle OpenGL's debug output. Debug builds have it on by default, with the messages that drivers send
+/// constantly filtered out. Release builds leave it off entirely (and don't ask for a debug context), so it costs
+/// nothing unless it's switched on at runtime
+///
+/// Performance warnings are counted rather than logged, so they can be shown next to the GPU timings
+/// </summary>
+class GlDebugOutput
+{
+public:
+	/// <summary>
+	/// How many times a performance warning has been sent, along with the last message that was sent with it's ID
+	/// </summary>
+	struct PerfWarning {
+		GLuint      Id;
+		uint32_t    Count;
+		std::string Message;
+	};
+
+	/// <summary>
+	/// Sets up the debug output with the default policy for this build, should be called once the context is current
+	/// </summary>
+	static void Init();
+
+	/// <summary>
+	/// Turns debug output on or off. The callback gets installed the first time it is turned on
+	/// </summary>
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled() { return _enabled; }
+
+	/// <summary>
+	/// When enabled, messages are sent synchronously (on the thread and in the call that caused them), and errors are
+	/// logged with a call stack. This slows down every GL call, so it should only be on while tracking down an error
+	/// </summary>
+	static void SetCaptureCallStacks(bool capture);
+	static bool IsCapturingCallStacks() { return _captureCallStacks; }
+
+	/// <summary>
+	/// Sets whether the driver sends us notifications, there are a lot of them
+	/// </summary>
+	static void SetLogNotifications(bool log);
+	static bool IsLoggingNotifications() { return _logNotifications; }
+
+	/// <summary>
+	/// Stops the driver from sending a message, for ones that are known to be noise. Message IDs are only unique
+	/// within a source and type
+	/// </summary>
+	static void Suppress(GLenum source, GLenum type, GLuint id);
+
+	/// <summary>
+	/// Ends the current frame for the performance warning counts, should be called once per frame
+	/// </summary>
+	static void EndFrame();
+	/// <summary>
+	/// Gets how many performance warnings were sent during the last frame
+	/// </summary>
+	static uint32_t GetPerfWarningsLastFrame() { return _perfLastFrame; }
+	/// <summary>
+	/// Copies out every performance warning we have seen, sorted by ID
+	/// </summary>
+	static void GetPerfWarnings(std::vector<PerfWarning>& result);
+
+protected:
+	GlDebugOutput() = default;
+
+	static void _Callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
+	static void _CountPerfWarning(GLuint id, const GLchar* message, GLsizei length);
+
+	static bool     _enabled;
+	static bool     _callbackInstalled;
+	static bool     _captureCallStacks;
+	static bool     _logNotifications;
+	static uint32_t _perfLastFrame;
+};
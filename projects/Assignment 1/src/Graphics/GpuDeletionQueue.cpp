@@ -0,0 +1,136 @@
+#include "GpuDeletionQueue.h"
+
+#include "RenderState.h"
+#include "VertexLayout.h"
+#include "Utilities/CpuProfiler.h"
+
+uint32_t GpuDeletionQueue::FrameLatency = 2;
+
+GpuDeletionQueue::State& GpuDeletionQueue::_Get() {
+	static State* state = new State();
+	return *state;
+}
+
+void GpuDeletionQueue::DeleteBuffer(GLuint handle) {
+	_Enqueue(Kind::Buffer, handle);
+}
+
+void GpuDeletionQueue::DeleteTexture(GLuint handle, GLuint64 bindlessHandle) {
+	_Enqueue(Kind::Texture, handle, bindlessHandle);
+}
+
+void GpuDeletionQueue::DeleteProgram(GLuint handle) {
+	_Enqueue(Kind::Program, handle);
+}
+
+void GpuDeletionQueue::DeleteShader(GLuint handle) {
+	_Enqueue(Kind::Shader, handle);
+}
+
+void GpuDeletionQueue::DeleteVertexArray(GLuint handle) {
+	_Enqueue(Kind::VertexArray, handle);
+}
+
+void GpuDeletionQueue::_Enqueue(Kind type, GLuint handle, GLuint64 bindlessHandle) {
+	if (handle == 0) {
+		return;
+	}
+	State& state = _Get();
+	std::lock_guard<std::mutex> lock(state.Lock);
+	state.Incoming.push_back({ type, handle, bindlessHandle });
+	state.PendingCount++;
+}
+
+void GpuDeletionQueue::EndFrame() {
+	State& state = _Get();
+	Batch batch;
+	{
+		std::lock_guard<std::mutex> lock(state.Lock);
+		batch.Deletions.swap(state.Incoming);
+	}
+	state.Frame++;
+	if (!batch.Deletions.empty()) {
+		batch.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		batch.Frame = state.Frame;
+		state.Batches.push_back(std::move(batch));
+	}
+
+	// The batches were fenced in order, so the first one that isn't ready holds up the rest
+	while (!state.Batches.empty()) {
+		Batch& oldest = state.Batches.front();
+		if (state.Frame - oldest.Frame < FrameLatency || glClientWaitSync(oldest.Fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			break;
+		}
+		PROFILE_SCOPE("GpuDeletionQueue");
+		glDeleteSync(oldest.Fence);
+		_Delete(oldest.Deletions);
+		{
+			std::lock_guard<std::mutex> lock(state.Lock);
+			state.PendingCount -= oldest.Deletions.size();
+		}
+		state.Batches.pop_front();
+	}
+}
+
+void GpuDeletionQueue::Flush() {
+	State& state = _Get();
+	std::vector<Deletion> incoming;
+	{
+		std::lock_guard<std::mutex> lock(state.Lock);
+		incoming.swap(state.Incoming);
+		state.PendingCount = 0;
+	}
+	for (Batch& batch : state.Batches) {
+		glDeleteSync(batch.Fence);
+		_Delete(batch.Deletions);
+	}
+	state.Batches.clear();
+	_Delete(incoming);
+}
+
+size_t GpuDeletionQueue::GetPendingCount() {
+	State& state = _Get();
+	std::lock_guard<std::mutex> lock(state.Lock);
+	return state.PendingCount;
+}
+
+void GpuDeletionQueue::_Delete(const std::vector<Deletion>& deletions) {
+	// Textures, buffers and VAOs can be deleted many at a time, so we gather them up by kind
+	std::vector<GLuint> textures, buffers, vertexArrays;
+	for (const Deletion& deletion : deletions) {
+		switch (deletion.Type) {
+			case Kind::Buffer:
+				RenderState::OnBufferDeleted(deletion.Handle);
+				VertexLayout::OnBufferDeleted(deletion.Handle);
+				buffers.push_back(deletion.Handle);
+				break;
+			case Kind::Texture:
+				if (deletion.BindlessHandle != 0) {
+					glMakeTextureHandleNonResidentARB(deletion.BindlessHandle);
+				}
+				RenderState::OnTextureDeleted(deletion.Handle);
+				textures.push_back(deletion.Handle);
+				break;
+			case Kind::Program:
+				RenderState::OnProgramDeleted(deletion.Handle);
+				glDeleteProgram(deletion.Handle);
+				break;
+			case Kind::Shader:
+				glDeleteShader(deletion.Handle);
+				break;
+			case Kind::VertexArray:
+				RenderState::OnVertexArrayDeleted(deletion.Handle);
+				vertexArrays.push_back(deletion.Handle);
+				break;
+		}
+	}
+	if (!textures.empty()) {
+		glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+	}
+	if (!buffers.empty()) {
+		glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+	}
+	if (!vertexArrays.empty()) {
+		glDeleteVertexArrays(static_cast<GLsizei>(vertexArrays.size()), vertexArrays.data());
+	}
+}
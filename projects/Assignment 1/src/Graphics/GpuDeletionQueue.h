@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <glad/glad.h>
+
+/// <summary>
+/// Puts off deleting GL objects until the GPU is done with them. Our wrappers (buffers, textures, shaders and the
+/// vertex layouts behind our VAOs) hand their handles over here instead of deleting them in their destructors, so the
+/// last reference to a resource can go on any thread (ex: a worker tearing down a scene, see SceneManager) without
+/// needing a context, and deleting something that's still in flight never makes the driver sync in the middle of
+/// a frame
+///
+/// Handles queued during a frame are fenced together at EndFrame, and deleted on the main thread once FrameLatency
+/// frames have gone by and the fence has signalled. Until then the handles stay valid, so nothing else can be handed
+/// the same name, and the state tracker (see RenderState) only hears about them once they're really gone
+/// </summary>
+class GpuDeletionQueue final
+{
+public:
+	/// <summary>
+	/// How many frames a deletion waits for before it's carried out, on top of waiting for it's frame's fence
+	/// </summary>
+	static uint32_t FrameLatency;
+
+	/// <summary>
+	/// Queues a buffer to be deleted, can be called from any thread
+	/// </summary>
+	static void DeleteBuffer(GLuint handle);
+	/// <summary>
+	/// Queues a texture to be deleted, can be called from any thread
+	/// </summary>
+	/// <param name="handle">The texture to delete</param>
+	/// <param name="bindlessHandle">The texture's bindless handle, which is made non-resident first, or 0 if it doesn't have one</param>
+	static void DeleteTexture(GLuint handle, GLuint64 bindlessHandle = 0);
+	/// <summary>
+	/// Queues a shader program to be deleted, can be called from any thread
+	/// </summary>
+	static void DeleteProgram(GLuint handle);
+	/// <summary>
+	/// Queues a shader stage to be deleted, can be called from any thread
+	/// </summary>
+	static void DeleteShader(GLuint handle);
+	/// <summary>
+	/// Queues a vertex array object to be deleted, can be called from any thread
+	/// </summary>
+	static void DeleteVertexArray(GLuint handle);
+
+	/// <summary>
+	/// Fences everything queued since the last call, then deletes anything that's waited long enough. Should be
+	/// called once per frame on the main thread, after the frame's commands have been submitted
+	/// </summary>
+	static void EndFrame();
+	/// <summary>
+	/// Deletes everything that's queued straight away, should be called on the main thread before the OpenGL context
+	/// is destroyed, once everything that might queue a deletion has been released
+	/// </summary>
+	static void Flush();
+
+	/// <summary>
+	/// Gets the number of handles waiting to be deleted
+	/// </summary>
+	static size_t GetPendingCount();
+
+protected:
+	GpuDeletionQueue() = default;
+	~GpuDeletionQueue() = default;
+
+	enum class Kind : uint8_t {
+		Buffer,
+		Texture,
+		Program,
+		Shader,
+		VertexArray
+	};
+
+	struct Deletion {
+		Kind     Type;
+		GLuint   Handle;
+		GLuint64 BindlessHandle;
+	};
+
+	// Everything queued in one frame, deleted together
+	struct Batch {
+		std::vector<Deletion> Deletions;
+		GLsync                Fence;
+		uint64_t              Frame;
+	};
+
+	struct State {
+		std::mutex            Lock;
+		// Queued since the last EndFrame, from any thread
+		std::vector<Deletion> Incoming;
+		size_t                PendingCount = 0;
+		// Only touched on the main thread
+		std::deque<Batch>     Batches;
+		uint64_t              Frame = 0;
+	};
+
+	// Never freed, since resources held in statics can be released after our own statics are gone
+	static State& _Get();
+	static void _Enqueue(Kind type, GLuint handle, GLuint64 bindlessHandle = 0);
+	// Tells the state trackers the handles are going away, then deletes them a kind at a time
+	static void _Delete(const std::vector<Deletion>& deletions);
+};
@@ -0,0 +1,109 @@
+#include "GpuProfiler.h"
+#include "Logging.h"
+#include "Utilities/CpuProfiler.h"
+
+GpuProfiler::GpuProfiler() :
+	_frameIx(0),
+	_resultsVersion(0),
+	_cpuClockOffset(0),
+	_isCalibrated(false)
+{ }
+
+GpuProfiler::~GpuProfiler() {
+	for (FrameQueries& frame : _frames) {
+		if (frame.Queries.size() > 0) {
+			glDeleteQueries(static_cast<GLsizei>(frame.Queries.size()), frame.Queries.data());
+		}
+	}
+}
+
+void GpuProfiler::BeginFrame() {
+	// Line up the GPU clock with the CPU profiler's clock once, so the two can be shown on the same timeline
+	if (!_isCalibrated) {
+		GLint64 gpuNow = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+		_cpuClockOffset = static_cast<int64_t>(CpuProfiler::Now()) - gpuNow;
+		_isCalibrated = true;
+	}
+
+	_frameIx = (_frameIx + 1) % FRAME_LATENCY;
+	FrameQueries& frame = _frames[_frameIx];
+
+	// This slot was used FRAME_LATENCY frames ago, so it's results should be ready by now
+	if (frame.InFlight) {
+		_Resolve(frame);
+	}
+	frame.QueryCount = 0;
+	frame.Zones.clear();
+	frame.InFlight = true;
+	_openZones.clear();
+
+	BeginZone("Frame");
+}
+
+void GpuProfiler::EndFrame() {
+	EndZone();
+	LOG_ASSERT(_openZones.empty(), "GPU profiler zones were not closed before the end of the frame!");
+}
+
+void GpuProfiler::BeginZone(const char* name) {
+	FrameQueries& frame = _frames[_frameIx];
+	PendingZone zone;
+	zone.Name = name;
+	zone.Depth = static_cast<int>(_openZones.size());
+	zone.BeginQuery = _Timestamp();
+	zone.EndQuery = -1;
+	_openZones.push_back(static_cast<int>(frame.Zones.size()));
+	frame.Zones.push_back(zone);
+}
+
+void GpuProfiler::EndZone() {
+	LOG_ASSERT(!_openZones.empty(), "Ending a GPU profiler zone that was never started!");
+	FrameQueries& frame = _frames[_frameIx];
+	frame.Zones[_openZones.back()].EndQuery = _Timestamp();
+	_openZones.pop_back();
+}
+
+int GpuProfiler::_Timestamp() {
+	FrameQueries& frame = _frames[_frameIx];
+	// Grow the pool as needed, after the first few frames this will no longer allocate
+	if (frame.QueryCount == frame.Queries.size()) {
+		GLuint query = 0;
+		glCreateQueries(GL_TIMESTAMP, 1, &query);
+		frame.Queries.push_back(query);
+	}
+	glQueryCounter(frame.Queries[frame.QueryCount], GL_TIMESTAMP);
+	return static_cast<int>(frame.QueryCount++);
+}
+
+void GpuProfiler::_Resolve(FrameQueries& frame) {
+	frame.InFlight = false;
+	if (frame.QueryCount == 0) {
+		return;
+	}
+
+	// If the GPU is more than FRAME_LATENCY frames behind we drop the results rather than block on them
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(frame.Queries[frame.QueryCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == GL_FALSE) {
+		return;
+	}
+
+	_results.clear();
+	_resultsVersion++;
+	for (const PendingZone& pending : frame.Zones) {
+		if (pending.EndQuery == -1) {
+			continue;
+		}
+		Zone zone;
+		zone.Name = pending.Name;
+		zone.Depth = pending.Depth;
+		glGetQueryObjectui64v(frame.Queries[pending.BeginQuery], GL_QUERY_RESULT, &zone.Start);
+		glGetQueryObjectui64v(frame.Queries[pending.EndQuery], GL_QUERY_RESULT, &zone.End);
+		_results.push_back(zone);
+
+		ZoneHistory& history = _history[zone.Name];
+		history.Samples[history.Index] = zone.GetMilliseconds();
+		history.Index = (history.Index + 1) % HISTORY_SIZE;
+	}
+}
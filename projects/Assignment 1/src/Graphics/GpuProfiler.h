@@ -0,0 +1,142 @@
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Measures how long the GPU spends on named sections of a frame using timestamp queries. Results are read back
+/// FRAME_LATENCY frames later, so that we never stall waiting for the GPU to catch up
+/// </summary>
+class GpuProfiler
+{
+public:
+	static GpuProfiler& Instance() {
+		static GpuProfiler instance;
+		return instance;
+	}
+	~GpuProfiler();
+
+	/// <summary>
+	/// The number of frames we keep in flight before reading back results
+	/// </summary>
+	static const int FRAME_LATENCY = 3;
+	/// <summary>
+	/// The number of frames of timings we keep for each zone for graphing
+	/// </summary>
+	static const int HISTORY_SIZE = 128;
+
+	/// <summary>
+	/// The resolved timing for a single zone
+	/// </summary>
+	struct Zone {
+		/// <summary>
+		/// The name that the zone was started with
+		/// </summary>
+		const char* Name;
+		/// <summary>
+		/// How many zones this zone is nested within (0 for the frame itself)
+		/// </summary>
+		int         Depth;
+		/// <summary>
+		/// The GPU timestamp at the start of the zone, in nanoseconds
+		/// </summary>
+		GLuint64    Start;
+		/// <summary>
+		/// The GPU timestamp at the end of the zone, in nanoseconds
+		/// </summary>
+		GLuint64    End;
+
+		float GetMilliseconds() const { return static_cast<float>(End - Start) / 1000000.0f; }
+	};
+
+	/// <summary>
+	/// Recent timings for a zone, stored as a ring buffer in the same style as our FPS graph
+	/// </summary>
+	struct ZoneHistory {
+		float Samples[HISTORY_SIZE] = { 0.0f };
+		int   Index = 0;
+	};
+
+	/// <summary>
+	/// Starts a new frame, collecting the results from the oldest frame in flight if they are ready. This opens
+	/// a zone covering the whole frame
+	/// </summary>
+	void BeginFrame();
+	/// <summary>
+	/// Ends the current frame, closing the frame zone
+	/// </summary>
+	void EndFrame();
+
+	/// <summary>
+	/// Starts a new named zone, zones may be nested
+	/// </summary>
+	/// <param name="name">The name of the zone, must be a string literal (or otherwise outlive the profiler)</param>
+	void BeginZone(const char* name);
+	/// <summary>
+	/// Ends the innermost open zone
+	/// </summary>
+	void EndZone();
+
+	/// <summary>
+	/// Gets the zones from the most recent frame that has finished on the GPU, in the order they were started
+	/// </summary>
+	const std::vector<Zone>& GetResults() const { return _results; }
+	/// <summary>
+	/// Gets the timing history for all the zones we have seen, keyed by zone name
+	/// </summary>
+	const std::unordered_map<std::string, ZoneHistory>& GetHistory() const { return _history; }
+	/// <summary>
+	/// Gets a counter that increases every time a new set of results is read back, so callers can tell when GetResults changes
+	/// </summary>
+	uint64_t GetResultsVersion() const { return _resultsVersion; }
+	/// <summary>
+	/// Gets the value to add to a GPU timestamp to convert it to the CPU profiler's clock, in nanoseconds
+	/// </summary>
+	int64_t GetCpuClockOffset() const { return _cpuClockOffset; }
+
+protected:
+	GpuProfiler();
+
+	// A zone we have issued queries for, but have not read back yet
+	struct PendingZone {
+		const char* Name;
+		int         Depth;
+		int         BeginQuery;
+		int         EndQuery;
+	};
+	// All the queries for a single frame
+	struct FrameQueries {
+		std::vector<GLuint>      Queries;
+		size_t                   QueryCount = 0;
+		std::vector<PendingZone> Zones;
+		bool                     InFlight = false;
+	};
+
+	// Issues a timestamp query from the current frame's pool, returning it's index in the pool
+	int _Timestamp();
+	// Reads back the results from a frame, if they are available
+	void _Resolve(FrameQueries& frame);
+
+	FrameQueries     _frames[FRAME_LATENCY];
+	int              _frameIx;
+	std::vector<int> _openZones;
+
+	std::vector<Zone> _results;
+	uint64_t          _resultsVersion;
+	int64_t           _cpuClockOffset;
+	bool              _isCalibrated;
+	std::unordered_map<std::string, ZoneHistory> _history;
+};
+
+/// <summary>
+/// Helper for timing a block of code on the GPU, the zone ends when this goes out of scope
+/// </summary>
+struct GpuProfileScope final {
+	GpuProfileScope(const char* name) { GpuProfiler::Instance().BeginZone(name); }
+	~GpuProfileScope() { GpuProfiler::Instance().EndZone(); }
+};
+
+#define GPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define GPU_PROFILE_CONCAT(a, b) GPU_PROFILE_CONCAT_INNER(a, b)
+#define GPU_PROFILE_SCOPE(name) GpuProfileScope GPU_PROFILE_CONCAT(__gpuProfileScope, __LINE__)(name)
@@ -0,0 +1,153 @@
+#include "GpuResources.h"
+
+#include "IBuffer.h"
+#include "Texture2D.h"
+#include "Texture2DArray.h"
+#include "TextureCubeMap.h"
+#include "TextureResidency.h"
+
+namespace {
+	thread_local const char* currentOwner = nullptr;
+
+	const char* GetTextureKind(const ITexture* texture) {
+		if (dynamic_cast<const Texture2D*>(texture) != nullptr) { return "Texture2D"; }
+		if (dynamic_cast<const Texture2DArray*>(texture) != nullptr) { return "Texture2DArray"; }
+		if (dynamic_cast<const TextureCubeMap*>(texture) != nullptr) { return "TextureCubeMap"; }
+		return "Texture";
+	}
+
+	const char* GetBufferKind(GLenum type) {
+		switch (type) {
+			case GL_ARRAY_BUFFER:          return "Vertex Buffer";
+			case GL_ELEMENT_ARRAY_BUFFER:  return "Index Buffer";
+			case GL_UNIFORM_BUFFER:        return "Uniform Buffer";
+			case GL_SHADER_STORAGE_BUFFER: return "Storage Buffer";
+			case GL_DRAW_INDIRECT_BUFFER:  return "Indirect Buffer";
+			default:                       return "Buffer";
+		}
+	}
+
+	const char* GetRawKind(GLenum identifier) {
+		switch (identifier) {
+			case GL_TEXTURE:      return "Texture";
+			case GL_RENDERBUFFER: return "Renderbuffer";
+			case GL_BUFFER:       return "Buffer";
+			default:              return "GL Object";
+		}
+	}
+
+	uint64_t GetRawKey(GLenum identifier, GLuint handle) {
+		return (static_cast<uint64_t>(identifier) << 32) | handle;
+	}
+}
+
+GpuResources::OwnerScope::OwnerScope(const char* owner) :
+	_previous(currentOwner)
+{
+	currentOwner = owner;
+}
+
+GpuResources::OwnerScope::~OwnerScope() {
+	currentOwner = _previous;
+}
+
+const char* GpuResources::GetCurrentOwner() {
+	return currentOwner != nullptr ? currentOwner : "Unowned";
+}
+
+GpuResources::Registry& GpuResources::_Get() {
+	static Registry* registry = new Registry();
+	return *registry;
+}
+
+GpuResources::Entry GpuResources::_MakeEntry() {
+	Entry result;
+	result.Owner = GetCurrentOwner();
+	result.CreatedFrame = TextureResidency::GetFrame();
+	return result;
+}
+
+void GpuResources::Add(const ITexture* texture) {
+	Entry entry = _MakeEntry();
+	entry.Texture = texture;
+	Registry& registry = _Get();
+	std::lock_guard<std::mutex> lock(registry.Lock);
+	registry.Objects[texture] = entry;
+}
+
+void GpuResources::Remove(const ITexture* texture) {
+	Registry& registry = _Get();
+	std::lock_guard<std::mutex> lock(registry.Lock);
+	registry.Objects.erase(texture);
+}
+
+void GpuResources::Add(const IBuffer* buffer) {
+	Entry entry = _MakeEntry();
+	entry.Buffer = buffer;
+	Registry& registry = _Get();
+	std::lock_guard<std::mutex> lock(registry.Lock);
+	registry.Objects[buffer] = entry;
+}
+
+void GpuResources::Remove(const IBuffer* buffer) {
+	Registry& registry = _Get();
+	std::lock_guard<std::mutex> lock(registry.Lock);
+	registry.Objects.erase(buffer);
+}
+
+void GpuResources::AddRaw(GLenum identifier, GLuint handle, size_t bytes, const std::string& name) {
+	if (handle == 0) {
+		return;
+	}
+	Entry entry = _MakeEntry();
+	entry.Kind = GetRawKind(identifier);
+	entry.Name = name;
+	entry.Handle = handle;
+	entry.Bytes = bytes;
+	Registry& registry = _Get();
+	std::lock_guard<std::mutex> lock(registry.Lock);
+	registry.Raw[GetRawKey(identifier, handle)] = entry;
+}
+
+void GpuResources::RemoveRaw(GLenum identifier, GLuint handle) {
+	Registry& registry = _Get();
+	std::lock_guard<std::mutex> lock(registry.Lock);
+	registry.Raw.erase(GetRawKey(identifier, handle));
+}
+
+std::vector<GpuResources::Resource> GpuResources::Collect() {
+	Registry& registry = _Get();
+	std::lock_guard<std::mutex> lock(registry.Lock);
+
+	std::vector<Resource> result;
+	result.reserve(registry.Objects.size() + registry.Raw.size());
+	for (const auto& [key, entry] : registry.Objects) {
+		Resource resource;
+		resource.Owner = entry.Owner;
+		resource.CreatedFrame = entry.CreatedFrame;
+		if (entry.Texture != nullptr) {
+			resource.Kind = GetTextureKind(entry.Texture);
+			resource.Name = entry.Texture->GetDebugName();
+			resource.Handle = entry.Texture->GetHandle();
+			resource.Bytes = entry.Texture->GetMemorySize();
+			resource.LastUsedFrame = entry.Texture->GetLastUsedFrame();
+		} else {
+			resource.Kind = GetBufferKind(entry.Buffer->GetType());
+			resource.Name = entry.Buffer->GetDebugName();
+			resource.Handle = entry.Buffer->GetHandle();
+			resource.Bytes = entry.Buffer->GetTotalSize();
+			resource.LastUsedFrame = entry.Buffer->GetLastUsedFrame();
+		}
+		result.push_back(std::move(resource));
+	}
+	for (const auto& [key, entry] : registry.Raw) {
+		result.push_back({ entry.Kind, entry.Name, entry.Owner, entry.Handle, entry.Bytes, entry.CreatedFrame, 0 });
+	}
+	return result;
+}
+
+size_t GpuResources::GetCount() {
+	Registry& registry = _Get();
+	std::lock_guard<std::mutex> lock(registry.Lock);
+	return registry.Objects.size() + registry.Raw.size();
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+
+class IBuffer;
+class ITexture;
+
+/// <summary>
+/// Keeps a list of every live GPU resource, so we can see where the GPU's memory is going and spot anything that
+/// sticks around longer than it should. Textures and buffers add themselves when they're created, and classes that
+/// make their own GL objects directly (ex: render targets) add those by handle
+///
+/// Each resource is charged to the owner that was current when it was made, see GPU_RESOURCE_OWNER. Sizes, names and
+/// when each was last used are read from the resources themselves whenever the list is collected, so they're always
+/// up to date
+/// </summary>
+class GpuResources final
+{
+public:
+	/// <summary>
+	/// A snapshot of a single resource, as returned by Collect
+	/// </summary>
+	struct Resource {
+		// What sort of resource it is (ex: Texture2D, Vertex Buffer)
+		const char* Kind;
+		// The label given to the GL object, if any
+		std::string Name;
+		const char* Owner;
+		GLuint      Handle;
+		size_t      Bytes;
+		// In TextureResidency frames
+		uint64_t    CreatedFrame;
+		// 0 if we don't know when (or if) it was last used
+		uint64_t    LastUsedFrame;
+	};
+
+	/// <summary>
+	/// Charges every resource created on the calling thread to an owner until it goes out of scope, scopes nest
+	/// </summary>
+	class OwnerScope final {
+	public:
+		OwnerScope(const char* owner);
+		~OwnerScope();
+		OwnerScope(const OwnerScope& other) = delete;
+		OwnerScope& operator=(const OwnerScope& other) = delete;
+	private:
+		const char* _previous;
+	};
+
+	/// <summary>
+	/// Gets the owner new resources are charged to, or "Unowned" outside of any GPU_RESOURCE_OWNER
+	/// </summary>
+	static const char* GetCurrentOwner();
+
+	static void Add(const ITexture* texture);
+	static void Remove(const ITexture* texture);
+	static void Add(const IBuffer* buffer);
+	static void Remove(const IBuffer* buffer);
+	/// <summary>
+	/// Adds (or updates) a GL object that isn't wrapped in one of our classes
+	/// </summary>
+	/// <param name="identifier">The kind of object, as passed to glObjectLabel (ex: GL_TEXTURE, GL_BUFFER)</param>
+	/// <param name="handle">The GL handle of the object</param>
+	/// <param name="bytes">Roughly how much GPU memory the object takes up</param>
+	/// <param name="name">A name to show the object by</param>
+	static void AddRaw(GLenum identifier, GLuint handle, size_t bytes, const std::string& name);
+	static void RemoveRaw(GLenum identifier, GLuint handle);
+
+	/// <summary>
+	/// Gets a snapshot of every live resource, in no particular order
+	/// </summary>
+	static std::vector<Resource> Collect();
+	/// <summary>
+	/// Gets the number of live resources
+	/// </summary>
+	static size_t GetCount();
+
+private:
+	GpuResources() = default;
+
+	struct Entry {
+		const ITexture* Texture = nullptr;
+		const IBuffer*  Buffer = nullptr;
+		const char*     Owner = nullptr;
+		uint64_t        CreatedFrame = 0;
+		// Raw resources only
+		const char*     Kind = nullptr;
+		std::string     Name;
+		GLuint          Handle = 0;
+		size_t          Bytes = 0;
+	};
+
+	struct Registry {
+		std::mutex Lock;
+		std::unordered_map<const void*, Entry> Objects;
+		// Keyed by the identifier in the high bits and the handle in the low bits
+		std::unordered_map<uint64_t, Entry>    Raw;
+	};
+
+	// Never freed, since textures and buffers held in statics can remove themselves after our own statics are gone
+	static Registry& _Get();
+	static Entry _MakeEntry();
+};
+
+#define GPU_RESOURCE_OWNER_CONCAT_INNER(a, b) a##b
+#define GPU_RESOURCE_OWNER_CONCAT(a, b) GPU_RESOURCE_OWNER_CONCAT_INNER(a, b)
+#define GPU_RESOURCE_OWNER(owner) GpuResources::OwnerScope GPU_RESOURCE_OWNER_CONCAT(_gpuOwner, __LINE__)(owner)
@@ -1,30 +1,101 @@
 #include "IBuffer.h"
+#include "GpuDeletionQueue.h"
+#include "GpuResources.h"
+#include "RenderStats.h"
+#include "TextureResidency.h"
+#include "Logging.h"
 
 IBuffer::IBuffer(GLenum type, GLenum usage) :
 	_elementCount(0),
 	_elementSize(0),
-	_handle(0)
+	_handle(0),
+	_mapping(nullptr),
+	_isImmutable(false),
+	_isPersistent(false),
+	_lastUsedFrame(0)
 {
 	_type = type;
 	_usage = usage;
 	glCreateBuffers(1, &_handle);
+	GpuResources::Add(this);
 }
 
 IBuffer::~IBuffer() {
-	if (_handle != 0) {
-		glDeleteBuffers(1, &_handle);
-		_handle = 0;
-	}
+	GpuResources::Remove(this);
+	// Deleting the buffer unmaps it too, which waits until the GPU is done with it
+	GpuDeletionQueue::DeleteBuffer(_handle);
+	_handle = 0;
 }
 
 void IBuffer::LoadData(const void* data, size_t elementSize, size_t elementCount) {
+	LOG_ASSERT(_mapping == nullptr, "Cannot reload a mapped buffer!");
+	LOG_ASSERT(!_isImmutable, "Cannot reload a buffer with immutable storage!");
 	// Note, this is part of the bindless state access stuff added in 4.5    
 	glNamedBufferData(_handle, elementSize * elementCount, data, _usage);
+	if (data != nullptr) {
+		RenderStats::CountBufferUpload(elementSize * elementCount);
+	}
 	_elementCount = elementCount;
 	_elementSize = elementSize;
 }
 
+void IBuffer::LoadImmutable(const void* data, size_t elementSize, size_t elementCount, GLbitfield flags) {
+	LOG_ASSERT(!_isImmutable, "Buffer storage is already immutable!");
+	glNamedBufferStorage(_handle, elementSize * elementCount, data, flags);
+	if (data != nullptr) {
+		RenderStats::CountBufferUpload(elementSize * elementCount);
+	}
+	_elementCount = elementCount;
+	_elementSize = elementSize;
+	_isImmutable = true;
+}
+
+void IBuffer::UpdateSubData(size_t firstElement, const void* data, size_t elementCount) {
+	LOG_ASSERT(firstElement + elementCount <= _elementCount, "Buffer update out of range!");
+	glNamedBufferSubData(_handle, firstElement * _elementSize, elementCount * _elementSize, data);
+	RenderStats::CountBufferUpload(elementCount * _elementSize);
+}
+
+void* IBuffer::Map(GLbitfield access, size_t firstElement, size_t elementCount) {
+	LOG_ASSERT(_mapping == nullptr, "Buffer is already mapped!");
+	LOG_ASSERT(firstElement + elementCount <= _elementCount, "Buffer mapping out of range!");
+	_mapping = glMapNamedBufferRange(_handle, firstElement * _elementSize, elementCount * _elementSize, access);
+	_isPersistent = (access & GL_MAP_PERSISTENT_BIT) != 0;
+	return _mapping;
+}
+
+void IBuffer::Unmap() {
+	LOG_ASSERT(!_isPersistent, "Persistent mappings last as long as the buffer!");
+	if (_mapping != nullptr) {
+		glUnmapNamedBuffer(_handle);
+		_mapping = nullptr;
+	}
+}
+
+void* IBuffer::MapPersistent(size_t elementSize, size_t elementCount) {
+	LOG_ASSERT(_mapping == nullptr, "Buffer is already mapped!");
+	// Storage from glNamedBufferStorage can't be resized, which is what lets us keep it mapped while drawing from it
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	LoadImmutable(nullptr, elementSize, elementCount, flags);
+	Map(flags);
+	LOG_ASSERT(_mapping != nullptr, "Failed to map buffer!");
+	return _mapping;
+}
+
+void IBuffer::SetDebugName(const std::string& name) {
+	if (name.empty()) {
+		return;
+	}
+	_debugName = name;
+	glObjectLabel(GL_BUFFER, _handle, static_cast<GLsizei>(name.length()), name.c_str());
+}
+
+void IBuffer::MarkUsed() const {
+	_lastUsedFrame = TextureResidency::GetFrame();
+}
+
 void IBuffer::Bind() {
+	MarkUsed();
 	glBindBuffer(_type, _handle);
 }
 
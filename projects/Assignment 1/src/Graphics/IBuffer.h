@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <string>
 #include <glad/glad.h>
 
 /// <summary>
@@ -38,6 +40,84 @@ public:
 		IBuffer::LoadData((const void*)(data), sizeof(T), count);
 	}
 
+	/// <summary>
+	/// Allocates immutable storage for the buffer with glNamedBufferStorage, and fills it with the data. Immutable
+	/// storage can't be resized or reloaded, in exchange the driver knows exactly how it will be used and can put it
+	/// wherever suits the GPU best. Meant for data that's uploaded once, like the vertices of static meshes
+	/// </summary>
+	/// <param name="data">The data to fill the buffer with, or nullptr to leave it uninitialized (ex: for copies)</param>
+	/// <param name="elementSize">The size of a single element, in bytes</param>
+	/// <param name="elementCount">The number of elements to make room for</param>
+	/// <param name="flags">The storage flags, GL_DYNAMIC_STORAGE_BIT allows UpdateSubData and the GL_MAP_ bits allow Map</param>
+	void LoadImmutable(const void* data, size_t elementSize, size_t elementCount, GLbitfield flags = 0);
+	/// <summary>
+	/// Allocates immutable storage for an array of data that will never change, see the untyped overload for storage
+	/// that can be updated or mapped
+	/// </summary>
+	/// <typeparam name="T">The type of data you are uploading</typeparam>
+	/// <param name="data">A pointer to the first element in the array</param>
+	/// <param name="count">The number of elements in the array to upload</param>
+	template <typename T>
+	void LoadImmutable(const T* data, size_t count) {
+		IBuffer::LoadImmutable((const void*)(data), sizeof(T), count);
+	}
+
+	/// <summary>
+	/// Overwrites part of the buffer without re-allocating it. Immutable buffers need GL_DYNAMIC_STORAGE_BIT for this
+	/// </summary>
+	/// <param name="firstElement">The index of the first element to overwrite</param>
+	/// <param name="data">The elements to write</param>
+	/// <param name="elementCount">The number of elements to write, must fit in the buffer</param>
+	void UpdateSubData(size_t firstElement, const void* data, size_t elementCount);
+	/// <summary>
+	/// Overwrites part of the buffer with an array of data, the elements must be the same size as the buffer's
+	/// </summary>
+	/// <typeparam name="T">The type of data you are uploading</typeparam>
+	/// <param name="firstElement">The index of the first element to overwrite</param>
+	/// <param name="data">A pointer to the first element in the array</param>
+	/// <param name="count">The number of elements in the array to write</param>
+	template <typename T>
+	void UpdateSubData(size_t firstElement, const T* data, size_t count) {
+		IBuffer::UpdateSubData(firstElement, (const void*)(data), count);
+	}
+
+	/// <summary>
+	/// Maps a range of the buffer into memory until Unmap is called. Nothing may draw from the buffer while it's
+	/// mapped, unless it was mapped with GL_MAP_PERSISTENT_BIT
+	/// </summary>
+	/// <param name="access">The access bits for glMapNamedBufferRange (ex: GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT)</param>
+	/// <param name="firstElement">The index of the first element to map</param>
+	/// <param name="elementCount">The number of elements to map, must fit in the buffer</param>
+	/// <returns>A pointer to the first mapped element, or nullptr if the mapping failed</returns>
+	void* Map(GLbitfield access, size_t firstElement, size_t elementCount);
+	/// <summary>
+	/// Maps the whole buffer into memory until Unmap is called
+	/// </summary>
+	/// <param name="access">The access bits for glMapNamedBufferRange</param>
+	void* Map(GLbitfield access) { return Map(access, 0, _elementCount); }
+	/// <summary>
+	/// Releases the mapping made by Map. Persistent mappings from MapPersistent last as long as the buffer does
+	/// </summary>
+	void Unmap();
+
+	/// <summary>
+	/// Allocates fixed size storage for the buffer and maps it for writing for as long as the buffer lives, so data
+	/// can be written straight into it (from any thread) instead of going through LoadData. The mapping is coherent,
+	/// so anything written before a draw is issued will be seen by it. The buffer can't be resized after this
+	/// </summary>
+	/// <param name="elementSize">The size of a single element, in bytes</param>
+	/// <param name="elementCount">The number of elements to make room for</param>
+	/// <returns>A pointer to the start of the mapped buffer</returns>
+	void* MapPersistent(size_t elementSize, size_t elementCount);
+	/// <summary>
+	/// Gets the pointer returned by Map or MapPersistent, or nullptr if the buffer isn't mapped
+	/// </summary>
+	void* GetMapping() const { return _mapping; }
+	/// <summary>
+	/// Returns true if the buffer's storage was allocated with LoadImmutable or MapPersistent, and can't be resized
+	/// </summary>
+	bool IsImmutable() const { return _isImmutable; }
+
 	/// <summary>
 	/// Returns the number of elements that are loaded into this buffer
 	/// </summary>
@@ -63,6 +143,22 @@ public:
 	/// </summary>
 	GLuint GetHandle() const { return _handle; }
 
+	/// <summary>
+	/// Labels the buffer for graphics debuggers and the GPU resource inspector
+	/// </summary>
+	/// <param name="name">The name to give the buffer, empty names are ignored</param>
+	void SetDebugName(const std::string& name);
+	const std::string& GetDebugName() const { return _debugName; }
+
+	/// <summary>
+	/// Records that this buffer is being drawn with this frame, Bind does this for us
+	/// </summary>
+	void MarkUsed() const;
+	/// <summary>
+	/// Gets the last frame this buffer was used in (see TextureResidency::GetFrame), or 0 if it never has been
+	/// </summary>
+	uint64_t GetLastUsedFrame() const { return _lastUsedFrame; }
+
 	/// <summary>
 	/// Binds this buffer for use to the slot returned by GetType()
 	/// </summary>
@@ -86,4 +182,9 @@ protected:
 	GLuint _handle; // The OpenGL handle for the underlying buffer
 	GLenum _usage; // The buffer usage mode (GL_STATIC_DRAW, GL_DYNAMIC_DRAW)
 	GLenum _type; // The buffer type (ex GL_ARRAY_BUFFER, GL_ARRAY_ELEMENT_BUFFER)
+	void*  _mapping; // Where the buffer is mapped, if it is
+	bool   _isImmutable; // Whether the storage came from glNamedBufferStorage
+	bool   _isPersistent; // Whether the mapping lasts for as long as the buffer does
+	std::string _debugName; // The label given to the GL object, if any
+	mutable uint64_t _lastUsedFrame; // The last frame the buffer was bound in
 };
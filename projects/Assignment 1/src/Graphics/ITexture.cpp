@@ -1,12 +1,17 @@
 #include "ITexture.h"
 
+#include "GpuDeletionQueue.h"
+#include "GpuResources.h"
 #include "Logging.h"
+#include "RenderState.h"
+#include "TextureResidency.h"
 
 ITexture::Limits ITexture::_limits = ITexture::Limits();
 bool ITexture::_isStaticInit = false;
+size_t ITexture::_totalMemory = 0;
 
 ITexture::ITexture()
-	: _handle(0)
+	: _handle(0), _bindlessHandle(0), _memorySize(0), _lastUsedFrame(0)
 {
 	if (!_isStaticInit) {
 		// Example of reading limits from the OpenGL renderer
@@ -27,30 +32,73 @@ ITexture::ITexture()
 		
 		_isStaticInit = true;
 	}
+	GpuResources::Add(this);
 }
 
 ITexture::~ITexture() {
-	if (glIsTexture(_handle)) {
-		glDeleteTextures(1, &_handle);
+	GpuResources::Remove(this);
+	_DeleteTexture();
+}
+
+void ITexture::_DeleteTexture() {
+	// Materials drawn earlier in the frame may still be sampling the old storage, through it's handle or bindless
+	GpuDeletionQueue::DeleteTexture(_handle, _bindlessHandle);
+	_bindlessHandle = 0;
+	_handle = 0;
+	_SetMemorySize(0);
+}
+
+void ITexture::_SetMemorySize(size_t size) {
+	_totalMemory = _totalMemory - _memorySize + size;
+	_memorySize = size;
+}
+
+void ITexture::MarkUsed() const {
+	_lastUsedFrame = TextureResidency::GetFrame();
+}
+
+void ITexture::SetDebugName(const std::string& name) {
+	if (name.empty()) {
+		return;
+	}
+	_debugName = name;
+	if (_handle != 0) {
+		glObjectLabel(GL_TEXTURE, _handle, static_cast<GLsizei>(name.length()), name.c_str());
+	}
+}
+
+uint64_t ITexture::GetBindlessHandle() {
+	if (_bindlessHandle == 0 && _handle != 0 && IsBindlessSupported()) {
+		_bindlessHandle = _sampler != nullptr ? _sampler->GetTextureHandle(_handle) : glGetTextureHandleARB(_handle);
+		glMakeTextureHandleResidentARB(_bindlessHandle);
 	}
+	return _bindlessHandle;
 }
 
 void ITexture::Bind(int slot) const {
+	MarkUsed();
 	if (_handle != 0) {
 		//glActiveTexture(GL_TEXTURE0 + slot);
-		glBindTextureUnit(slot, _handle);
+		RenderState::BindTextureUnit(slot, _handle);
+		RenderState::BindSampler(slot, _sampler != nullptr ? _sampler->GetHandle() : 0);
 	}
 }
 
 void ITexture::Unbind(int slot)
 {
 	//glActiveTexture(GL_TEXTURE0 + slot);
-	glBindTextureUnit(slot, 0);
+	RenderState::BindTextureUnit(slot, 0);
+	RenderState::BindSampler(slot, 0);
 }
 
 
 void ITexture::Clear(const glm::vec4 color) {
 	if (_handle != 0) {
-		glClearTexImage(_handle, 0, GL_RGBA, GL_FLOAT, &color[0]);
+		// Clear the whole mip chain, otherwise the smaller levels are left undefined when sampled
+		GLint levels = 1;
+		glGetTextureParameteriv(_handle, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+		for (GLint level = 0; level < levels; level++) {
+			glClearTexImage(_handle, level, GL_RGBA, GL_FLOAT, &color[0]);
+		}
 	}
 }
@@ -1,9 +1,12 @@
 #pragma once
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <glad/glad.h>
 #include <GLM/glm.hpp>
 
+#include "Sampler.h"
+
 class ITexture
 {
 public:
@@ -28,7 +31,7 @@ public:
 	static const Limits& GetLimits() { return _limits; }
 	
 	/// <summary>
-	/// Unbinds a texture from the given slot
+	/// Unbinds a texture and sampler from the given slot
 	/// </summary>
 	/// <param name="slot">The slot to unbind a texture from</param>
 	static void Unbind(int slot);
@@ -45,17 +48,77 @@ public:
 	void Clear(const glm::vec4 color = glm::vec4(1.0f));
 
 	/// <summary>
-	/// Binds this texture to the given texture slot
+	/// Binds this texture and it's sampler to the given texture slot
 	/// </summary>
 	/// <param name="slot">The slot to bind the texture to</param>
 	void Bind(int slot) const;
+
+	/// <summary>
+	/// Returns true if the driver supports ARB_bindless_texture, so textures can be read through 64 bit handles
+	/// instead of being bound to texture units
+	/// </summary>
+	static bool IsBindlessSupported() { return GLAD_GL_ARB_bindless_texture != 0; }
+
+	/// <summary>
+	/// Gets a resident bindless handle for this texture and sampler, creating it the first time it's requested. Note
+	/// that once a handle exists OpenGL does not allow the sampling parameters (filtering, wrapping) to change
+	/// </summary>
+	/// <returns>The 64 bit texture handle, or 0 if bindless textures are not supported</returns>
+	uint64_t GetBindlessHandle();
+	/// <summary>
+	/// Returns true if a bindless handle has been created for this texture
+	/// </summary>
+	bool HasBindlessHandle() const { return _bindlessHandle != 0; }
+
+	/// <summary>
+	/// Gets the shared sampler that this texture is read with, this is bound along side the texture
+	/// </summary>
+	const Sampler::sptr& GetSampler() const { return _sampler; }
+
+	/// <summary>
+	/// Gets roughly how much GPU memory this texture's storage takes up, in bytes
+	/// </summary>
+	size_t GetMemorySize() const { return _memorySize; }
+	/// <summary>
+	/// Gets roughly how much GPU memory all of our textures take up together, in bytes
+	/// </summary>
+	static size_t GetTotalMemory() { return _totalMemory; }
+
+	/// <summary>
+	/// Records that this texture is being drawn with this frame, so TextureResidency knows not to shrink it. Bind
+	/// does this for us
+	/// </summary>
+	void MarkUsed() const;
+	/// <summary>
+	/// Gets the last frame this texture was used in (see TextureResidency::GetFrame)
+	/// </summary>
+	uint64_t GetLastUsedFrame() const { return _lastUsedFrame; }
+
+	/// <summary>
+	/// Labels the texture for graphics debuggers and the GPU resource inspector
+	/// </summary>
+	/// <param name="name">The name to give the texture, empty names are ignored</param>
+	void SetDebugName(const std::string& name);
+	const std::string& GetDebugName() const { return _debugName; }
 	
 protected:
 	ITexture();
 	virtual ~ITexture();
 
-	GLuint _handle;
+	// Deletes the underlying texture (if any), releasing it's bindless handle
+	void _DeleteTexture();
+	// Updates how much memory our storage uses, should be called whenever the storage is reallocated
+	void _SetMemorySize(size_t size);
+
+	GLuint   _handle;
+	uint64_t _bindlessHandle;
+	// Our sampling state, shared with all other textures that are sampled the same way
+	Sampler::sptr _sampler;
+	size_t           _memorySize;
+	mutable uint64_t _lastUsedFrame;
+	std::string      _debugName;
 
+	static size_t _totalMemory;
 	static Limits _limits;
 	static bool _isStaticInit;
 };
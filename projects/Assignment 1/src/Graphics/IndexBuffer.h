@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <stdexcept>
 #include <memory>
+#include <vector>
 
 /// <summary>
 /// The index buffer will store indices for rendering (uint8_t, uint16_t and uint32_t)
@@ -39,6 +40,19 @@ public:
 		_elementType = elementType;
 	}
 	/// <summary>
+	/// Allocates immutable storage for our indices (see IBuffer::LoadImmutable), specifying the type of indices we are
+	/// using. This hides IBuffer's overloads, so the element type can't be left out
+	/// </summary>
+	/// <param name="data">The pointer to the data to load in, or nullptr to leave it uninitialized</param>
+	/// <param name="elementSize">The size of a single element, in bytes</param>
+	/// <param name="elementCount">The number of elements to make room for</param>
+	/// <param name="elementType">The type of elements you are storing (GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_UNSIGNED_INT)</param>
+	/// <param name="flags">The storage flags, see IBuffer::LoadImmutable</param>
+	inline void LoadImmutable(const void* data, size_t elementSize, size_t elementCount, GLenum elementType, GLbitfield flags = 0) {
+		IBuffer::LoadImmutable(data, elementSize, elementCount, flags);
+		_elementType = elementType;
+	}
+	/// <summary>
 	/// Loads data of a known type into this index buffer
 	/// </summary>
 	/// <typeparam name="T">The type of data to load, must be uint8_t, uint16_t or uint32_t</typeparam>
@@ -46,6 +60,15 @@ public:
 	/// <param name="count">The number of elements in the array to upload</param>
 	template <typename T>
 	void LoadData(const T* data, size_t count) { throw std::runtime_error("Must be one of uint8_t, uint16_t or uint32_t"); } // Note, see template specializations below
+	/// <summary>
+	/// Loads 32 bit indices, storing them as 16 bit indices when every vertex can be addressed with one. Halves the
+	/// index bandwidth for most meshes, and GetElementType will tell the draw calls which one we picked
+	/// </summary>
+	/// <param name="data">A pointer to the start of the indices</param>
+	/// <param name="count">The number of indices to upload</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <param name="immutable">True to allocate immutable storage, for indices that never change</param>
+	void LoadCompact(const uint32_t* data, size_t count, size_t vertexCount, bool immutable = false);
 
 	/// <summary>
 	/// Gets the underlying index type for this buffer (GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_UNSIGNED_INT)
@@ -80,3 +103,19 @@ inline void IndexBuffer::LoadData<uint32_t>(const uint32_t* data, size_t count)
 	IBuffer::LoadData<uint32_t>(data, count);
 	_elementType = GL_UNSIGNED_INT;
 }
+
+inline void IndexBuffer::LoadCompact(const uint32_t* data, size_t count, size_t vertexCount, bool immutable) {
+	// We skip 8 bit indices, since a lot of hardware doesn't support them natively and ends up converting them
+	if (vertexCount <= UINT16_MAX + 1ull) {
+		std::vector<uint16_t> compact(data, data + count);
+		if (immutable) {
+			LoadImmutable(compact.data(), sizeof(uint16_t), count, GL_UNSIGNED_SHORT);
+		} else {
+			LoadData(compact.data(), count);
+		}
+	} else if (immutable) {
+		LoadImmutable(data, sizeof(uint32_t), count, GL_UNSIGNED_INT);
+	} else {
+		LoadData(data, count);
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "IBuffer.h"
+#include <memory>
+
+/// <summary>
+/// The layout of a single command in an indirect buffer, as read by glMultiDrawElementsIndirect
+/// </summary>
+struct DrawElementsIndirectCommand
+{
+	/// <summary>
+	/// The number of indices to draw
+	/// </summary>
+	GLuint Count;
+	/// <summary>
+	/// The number of instances to draw
+	/// </summary>
+	GLuint InstanceCount;
+	/// <summary>
+	/// The index of the first index to read from the bound index buffer
+	/// </summary>
+	GLuint FirstIndex;
+	/// <summary>
+	/// A value added to every index before fetching the vertex
+	/// </summary>
+	GLint  BaseVertex;
+	/// <summary>
+	/// The index of the first element to read from any instanced attributes
+	/// </summary>
+	GLuint BaseInstance;
+};
+
+/// <summary>
+/// The indirect buffer stores draw commands that the GPU reads directly when doing indirect draws
+/// </summary>
+class IndirectBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<IndirectBuffer> sptr;
+	static inline sptr Create(GLenum usage = GL_DYNAMIC_DRAW) {
+		return std::make_shared<IndirectBuffer>(usage);
+	}
+
+public:
+	/// <summary>
+	/// Creates a new indirect buffer, with the given usage. Data will still need to be uploaded before it can be used
+	/// </summary>
+	/// <param name="usage">The usage hint for the buffer, default is GL_DYNAMIC_DRAW</param>
+	IndirectBuffer(GLenum usage = GL_DYNAMIC_DRAW) : IBuffer(GL_DRAW_INDIRECT_BUFFER, usage) { }
+
+	/// <summary>
+	/// Unbinds the current indirect buffer
+	/// </summary>
+	static void UnBind() { IBuffer::UnBind(GL_DRAW_INDIRECT_BUFFER); }
+};
@@ -0,0 +1,133 @@
+#include "InstanceCuller.h"
+
+#include <algorithm>
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "MeshArena.h"
+#include "RenderState.h"
+#include "UniformBlocks.h"
+
+// The storage bindings used by the culling pass, must match instance_cull.comp.glsl
+static const GLuint INSTANCE_BINDING = 3;
+static const GLuint COMMAND_BINDING  = 4;
+static const GLuint COUNT_BINDING    = 5;
+// Must match local_size_x in the shader
+static const uint32_t GROUP_SIZE     = 64;
+// The most work groups a dispatch can have along X that every implementation supports
+static const uint32_t MAX_GROUPS     = 65535;
+
+InstanceCuller::InstanceCuller() :
+	_isReady(false),
+	_commandCount(0),
+	_lodScale(0.0f)
+{
+	GPU_RESOURCE_OWNER("InstanceCuller");
+	_shader = Shader::Create();
+	_shader->LoadShaderPartFromFile("shaders/instance_cull.comp.glsl", GL_COMPUTE_SHADER);
+	_isReady = _shader->Link();
+	if (!_isReady) {
+		LOG_WARN("Instance culling shader failed to compile, GPU culled batches will be drawn whole");
+	}
+
+	_commands = IndirectBuffer::Create(GL_DYNAMIC_COPY);
+	// The counts are only ever read by indirect draws, so they may as well live in an indirect buffer too
+	_counts = IndirectBuffer::Create(GL_DYNAMIC_COPY);
+	for (int ix = 0; ix < 6; ix++) {
+		_planes[ix] = glm::vec4(0.0f);
+	}
+}
+
+void InstanceCuller::BeginFrame(const Frustum& frustum, const DepthPyramid::sptr& occluders, float pixelsPerUnit, float lodPixelError) {
+	_batches.clear();
+	_occluders = (occluders != nullptr && occluders->HasPyramid()) ? occluders : nullptr;
+	_commandCount = 0;
+	for (int ix = 0; ix < 6; ix++) {
+		_planes[ix] = frustum.GetPlanes()[ix];
+	}
+	// A level can be used once Error * diameter * pixelsPerUnit / distance is under the limit
+	_lodScale = lodPixelError > 0.0f ? 2.0f * pixelsPerUnit / lodPixelError : 0.0f;
+}
+
+int InstanceCuller::Cull(const VertexArrayObject::sptr& mesh, const glm::vec4& bounds, const glm::vec2& drawRange,
+	const VertexBuffer::sptr& instances, int baseInstance, int instanceCount)
+{
+	LOG_ASSERT(mesh->GetArenaSlice().Arena != nullptr, "Instance culling requires a mesh in an arena!");
+	Batch batch;
+	batch.Mesh = mesh;
+	batch.Bounds = bounds;
+	batch.DrawRange = drawRange;
+	batch.Instances = instances;
+	batch.BaseInstance = baseInstance;
+	batch.InstanceCount = instanceCount;
+	batch.FirstCommand = _commandCount;
+	_commandCount += static_cast<uint32_t>(instanceCount);
+	_batches.push_back(batch);
+	return static_cast<int>(_batches.size() - 1);
+}
+
+void InstanceCuller::EndFrame() {
+	if (_batches.empty()) {
+		return;
+	}
+	// Every command slot will get written (or skipped) by the pass, so we only re-allocate without uploading anything.
+	// The counters need to start at zero though
+	if (_commands->GetElementCount() < static_cast<GLsizei>(_commandCount)) {
+		_commands->LoadData(static_cast<const DrawElementsIndirectCommand*>(nullptr), _commandCount);
+	}
+	_zeroCounts.assign(_batches.size(), 0);
+	_counts->LoadData(_zeroCounts.data(), _zeroCounts.size());
+
+	_shader->Bind();
+	_shader->SetUniform(_shader->GetUniformLocation("u_FrustumPlanes"_hs), _planes, 6);
+	_shader->SetUniform("u_LodScale"_hs, _lodScale);
+	_shader->SetUniform("u_OcclusionCulling"_hs, _occluders != nullptr ? 1 : 0);
+	if (_occluders != nullptr) {
+		_shader->SetUniformMatrix("u_OcclusionViewProjection"_hs, _occluders->GetViewProjection());
+		_shader->SetUniform("u_PyramidLevels"_hs, _occluders->GetLevelCount());
+		RenderState::BindTextureUnit(DEPTH_PYRAMID_UNIT, _occluders->GetTexture());
+		RenderState::BindSampler(DEPTH_PYRAMID_UNIT, 0);
+	}
+	RenderState::BindStorageBuffer(COMMAND_BINDING, _commands->GetHandle());
+	RenderState::BindStorageBuffer(COUNT_BINDING, _counts->GetHandle());
+
+	// The index range and error of each level, with the full detail mesh first
+	glm::ivec2 ranges[MAX_LEVELS];
+	float errors[MAX_LEVELS];
+	for (size_t ix = 0; ix < _batches.size(); ix++) {
+		const Batch& batch = _batches[ix];
+		const MeshArenaSlice& slice = batch.Mesh->GetArenaSlice();
+		const std::vector<VertexArrayObject::Lod>& lods = batch.Mesh->GetLods();
+		const int levelCount = _lodScale > 0.0f ? std::min(static_cast<int>(lods.size()) + 1, MAX_LEVELS) : 1;
+		ranges[0] = glm::ivec2(slice.FirstIndex, slice.IndexCount);
+		errors[0] = 0.0f;
+		for (int level = 1; level < levelCount; level++) {
+			const MeshArenaSlice& lodSlice = lods[level - 1].Mesh->GetArenaSlice();
+			ranges[level] = glm::ivec2(lodSlice.FirstIndex, lodSlice.IndexCount);
+			errors[level] = lods[level - 1].Error;
+		}
+		_shader->SetUniform(_shader->GetUniformLocation("u_LevelRanges"_hs), ranges, levelCount);
+		_shader->SetUniform(_shader->GetUniformLocation("u_LevelErrors"_hs), errors, levelCount);
+		_shader->SetUniform("u_LevelCount"_hs, levelCount);
+		_shader->SetUniform("u_BaseVertex"_hs, static_cast<int>(slice.BaseVertex));
+		_shader->SetUniform("u_Bounds"_hs, batch.Bounds);
+		_shader->SetUniform("u_DrawRange"_hs, batch.DrawRange);
+		_shader->SetUniform("u_InstanceCount"_hs, batch.InstanceCount);
+		_shader->SetUniform("u_BaseInstance"_hs, batch.BaseInstance);
+		_shader->SetUniform("u_FirstCommand"_hs, static_cast<int>(batch.FirstCommand));
+		_shader->SetUniform("u_CountIndex"_hs, static_cast<int>(ix));
+		RenderState::BindStorageBuffer(INSTANCE_BINDING, batch.Instances->GetHandle());
+		// A million instances is more groups than X is guaranteed to fit, so the rest spill over into Y
+		const uint32_t groups = (static_cast<uint32_t>(batch.InstanceCount) + GROUP_SIZE - 1) / GROUP_SIZE;
+		const uint32_t rows = (groups + MAX_GROUPS - 1) / MAX_GROUPS;
+		glDispatchCompute(std::min(groups, MAX_GROUPS), rows, 1);
+	}
+	// The draws read the commands and counts through the indirect binding points, not as storage buffers
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+	_occluders = nullptr;
+}
+
+void InstanceCuller::Render(int batch, const VertexArrayObject::sptr& vao) const {
+	const Batch& entry = _batches[batch];
+	vao->RenderIndirectCount(_commands, entry.FirstCommand, *_counts, batch, entry.InstanceCount);
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "DepthPyramid.h"
+#include "Frustum.h"
+#include "IndirectBuffer.h"
+#include "Shader.h"
+#include "VertexArrayObject.h"
+
+/// <summary>
+/// Culls big batches of instances on the GPU, so the CPU never has to look at them one by one (ex: the millions of
+/// instances a ScatterComponent can make). Each batch queued with Cull gets a compute dispatch that reads every
+/// instance's transform straight out of it's instance buffer, tests it's bounding sphere against the frustum, the
+/// batch's draw range and (when given one) last frame's DepthPyramid, picks the level of detail it should be drawn at,
+/// and appends a draw command for it. The commands are then drawn with glMultiDrawElementsIndirectCount, so the CPU
+/// never needs to know how many made it
+///
+/// Levels of detail are picked the same way RendererComponent::UpdateLod picks them, without the hysteresis since
+/// nothing is remembered between frames
+///
+/// Usage each frame: BeginFrame, Cull for each batch, EndFrame, then Render for each batch
+/// </summary>
+class InstanceCuller final
+{
+public:
+	typedef std::shared_ptr<InstanceCuller> sptr;
+	static inline sptr Create() {
+		return std::make_shared<InstanceCuller>();
+	}
+	// We'll disallow moving and copying, since we own GPU buffers
+	InstanceCuller(const InstanceCuller& other) = delete;
+	InstanceCuller(InstanceCuller&& other) = delete;
+	InstanceCuller& operator=(const InstanceCuller& other) = delete;
+	InstanceCuller& operator=(InstanceCuller&& other) = delete;
+
+public:
+	// The most levels a mesh can be drawn at, counting the full detail mesh. Any coarser levels are left out
+	static const int MAX_LEVELS = 8;
+
+	/// <summary>
+	/// Creates a new culler, and compiles the culling shader
+	/// </summary>
+	InstanceCuller();
+	~InstanceCuller() = default;
+
+	/// <summary>
+	/// Returns true if the culling shader compiled, if not the batches should just be drawn whole
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Throws away the batches from the last frame and starts a new one
+	/// </summary>
+	/// <param name="frustum">The world space view volume to cull the instances against</param>
+	/// <param name="occluders">The depth pyramid to cull hidden instances against, or nullptr to skip occlusion culling</param>
+	/// <param name="pixelsPerUnit">The size in pixels of something one unit across, one unit in front of the camera</param>
+	/// <param name="lodPixelError">The most a level of detail may move the surface on screen, in pixels. 0 or less to always draw full detail</param>
+	void BeginFrame(const Frustum& frustum, const DepthPyramid::sptr& occluders, float pixelsPerUnit, float lodPixelError);
+	/// <summary>
+	/// Queues the culling for a batch of instances, nothing is dispatched until EndFrame
+	/// </summary>
+	/// <param name="mesh">The mesh to draw, must have an arena slice (as must it's levels of detail)</param>
+	/// <param name="bounds">The bounding sphere of each instance in it's own space, as the center and radius</param>
+	/// <param name="drawRange">The distances from the camera that the instances are drawn between</param>
+	/// <param name="instances">The buffer of InstanceTransforms that the batch draws from</param>
+	/// <param name="baseInstance">The index of the batch's first instance in the buffer</param>
+	/// <param name="instanceCount">The number of instances in the batch</param>
+	/// <returns>The index of the batch, to pass to Render</returns>
+	int Cull(const VertexArrayObject::sptr& mesh, const glm::vec4& bounds, const glm::vec2& drawRange,
+		const VertexBuffer::sptr& instances, int baseInstance, int instanceCount);
+	/// <summary>
+	/// Runs the culling for every batch queued this frame. Must be called after the last Cull, and before the first Render
+	/// </summary>
+	void EndFrame();
+	/// <summary>
+	/// Draws the instances of a batch that survived culling. The material should already be applied
+	/// </summary>
+	/// <param name="batch">The index returned by Cull</param>
+	/// <param name="vao">The VAO of the arena that the batch's mesh lives in, with the instance buffer attached</param>
+	void Render(int batch, const VertexArrayObject::sptr& vao) const;
+
+	/// <summary>
+	/// Gets the number of instances that were tested this frame
+	/// </summary>
+	uint32_t GetTestedCount() const { return _commandCount; }
+
+protected:
+	// What we need to remember about each batch from Cull until the dispatch
+	struct Batch {
+		VertexArrayObject::sptr Mesh;
+		glm::vec4               Bounds;
+		glm::vec2               DrawRange;
+		VertexBuffer::sptr      Instances;
+		int                     BaseInstance;
+		int                     InstanceCount;
+		// Where the batch's commands start, with room for every instance since each one is drawn at a single level
+		uint32_t                FirstCommand;
+	};
+
+	Shader::sptr         _shader;
+	bool                 _isReady;
+	// Written by the culling pass, so we only ever size them on the CPU
+	IndirectBuffer::sptr _commands;
+	IndirectBuffer::sptr _counts;
+	std::vector<Batch>   _batches;
+	std::vector<GLuint>  _zeroCounts;
+	uint32_t             _commandCount;
+	glm::vec4            _planes[6];
+	// Only set for the frame if it has a pyramid to test against
+	DepthPyramid::sptr   _occluders;
+	// How far away an instance has to be, relative to it's radius and a level's error, to be drawn at that level
+	float                _lodScale;
+};
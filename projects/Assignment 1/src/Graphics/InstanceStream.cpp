@@ -0,0 +1,50 @@
+#include "InstanceStream.h"
+#include <algorithm>
+
+#include "GpuResources.h"
+
+// The smallest region we'll make, so a scene that's still loading doesn't grow the buffer every frame
+static const uint32_t MIN_REGION_CAPACITY = 1024;
+
+InstanceStream::InstanceStream(size_t elementSize) :
+	_elementSize(elementSize),
+	_buffer(nullptr),
+	_ring(nullptr)
+{ }
+
+InstanceStream::Region InstanceStream::Acquire(uint32_t count) {
+	if (_ring == nullptr || count > _ring->GetRegionCapacity()) {
+		_Grow(count);
+	}
+	const PersistentRingBuffer::Region ringRegion = _ring->Acquire();
+
+	Region region;
+	region.Buffer = _buffer;
+	region.First = ringRegion.First;
+	region.Data = ringRegion.Data;
+	region.Capacity = _ring->GetRegionCapacity();
+	region.Index = ringRegion.Index;
+	return region;
+}
+
+void InstanceStream::Release(const Region& region) {
+	// Regions from before we grew are in a buffer we'll never write to again
+	if (region.Buffer != _buffer) {
+		return;
+	}
+	PersistentRingBuffer::Region ringRegion;
+	ringRegion.Data = region.Data;
+	ringRegion.First = region.First;
+	ringRegion.Index = region.Index;
+	_ring->Release(ringRegion);
+}
+
+void InstanceStream::_Grow(uint32_t count) {
+	GPU_RESOURCE_OWNER("InstanceStream");
+	// Leave some room to grow, so a scene that's slowly streaming in doesn't make a new buffer every frame
+	const uint32_t capacity = std::max({ count + count / 2, GetRegionCapacity() * 2, MIN_REGION_CAPACITY });
+	// The old buffer stays alive for as long as anyone is holding onto a region of it, and the driver holds onto it
+	// until the GPU is done with it, so none of the old ring's fences matter any more
+	_buffer = VertexBuffer::Create(GL_DYNAMIC_DRAW);
+	_ring = PersistentRingBuffer::Create(_buffer, _elementSize, capacity, REGION_COUNT);
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <glad/glad.h>
+
+#include "PersistentRingBuffer.h"
+#include "VertexBuffer.h"
+
+/// <summary>
+/// A persistently mapped vertex buffer for per instance data, split into a region for each frame that may be in
+/// flight. A region gets acquired on the main thread before a frame's instances are gathered, the instances can then
+/// be written straight into it from any thread, and it gets released (fenced) once the draws reading from it have
+/// been issued. Acquiring waits on the GPU only if it's still reading the region from a few frames ago
+///
+/// Every region lives in the same buffer, so instances are drawn with base instances offset by the region's start
+/// and the buffer only needs to be attached to each VAO once. The regions and their fences are a PersistentRingBuffer,
+/// the stream adds growing into a bigger ring when a frame needs more room
+/// </summary>
+class InstanceStream final
+{
+public:
+	typedef std::shared_ptr<InstanceStream> sptr;
+	static inline sptr Create(size_t elementSize) {
+		return std::make_shared<InstanceStream>(elementSize);
+	}
+
+	/// <summary>
+	/// The number of regions in the buffer, one being written, one being drawn, and one the GPU may still be reading
+	/// </summary>
+	static const uint32_t REGION_COUNT = 3;
+
+	/// <summary>
+	/// A part of the buffer that one frame's instances can be written into
+	/// </summary>
+	struct Region {
+		// The buffer that the region is in, draws should use this rather than the stream's current buffer since the
+		// stream may have grown into a new one since
+		VertexBuffer::sptr Buffer;
+		// Where the region's first element is mapped
+		void*              Data = nullptr;
+		// The index of the region's first element in the buffer, to be added to base instances
+		uint32_t           First = 0;
+		// The most elements that fit in the region
+		uint32_t           Capacity = 0;
+		// Which of the regions this is
+		uint32_t           Index = 0;
+	};
+
+	/// <summary>
+	/// Creates a new stream, the buffer doesn't get made until the first region is acquired
+	/// </summary>
+	/// <param name="elementSize">The size of a single instance, in bytes</param>
+	InstanceStream(size_t elementSize);
+	~InstanceStream() = default;
+
+	InstanceStream(const InstanceStream& other) = delete;
+	InstanceStream& operator=(const InstanceStream& other) = delete;
+
+	/// <summary>
+	/// Takes the next region for writing, waiting on the GPU if it hasn't finished with it yet. If the regions are
+	/// too small the stream moves to a bigger buffer, regions from the old one stay valid until they're released
+	/// </summary>
+	/// <param name="count">The most elements that will be written to the region</param>
+	/// <returns>The region to write into</returns>
+	Region Acquire(uint32_t count);
+	/// <summary>
+	/// Marks a region as being read by the draws that have been issued, so it won't be written to again until the
+	/// GPU is done with them
+	/// </summary>
+	/// <param name="region">The region, as returned by Acquire</param>
+	void Release(const Region& region);
+
+	/// <summary>
+	/// Gets the number of elements each region can hold
+	/// </summary>
+	uint32_t GetRegionCapacity() const { return _ring != nullptr ? _ring->GetRegionCapacity() : 0; }
+
+protected:
+	size_t                     _elementSize;
+	VertexBuffer::sptr         _buffer;
+	PersistentRingBuffer::sptr _ring;
+
+	// Moves to a new buffer with room for at least the given number of elements in each region
+	void _Grow(uint32_t count);
+};
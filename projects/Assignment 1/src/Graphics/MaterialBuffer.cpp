@@ -0,0 +1,75 @@
+#include "MaterialBuffer.h"
+#include "GpuResources.h"
+#include "RenderState.h"
+#include "RenderStats.h"
+#include "UniformBlocks.h"
+#include "Logging.h"
+#include <cstring>
+
+std::unordered_map<uint32_t, MaterialBuffer::sptr> MaterialBuffer::_buffers;
+
+MaterialBuffer::MaterialBuffer(uint32_t stride) :
+	IBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW),
+	_stride(stride),
+	_count(0),
+	_capacity(0)
+{
+	LOG_ASSERT(stride > 0, "Material buffer stride must be greater than zero");
+	_Reserve(16);
+}
+
+uint32_t MaterialBuffer::Allocate() {
+	uint32_t result;
+	if (!_freeEntries.empty()) {
+		result = _freeEntries.back();
+		_freeEntries.pop_back();
+	} else {
+		_Reserve(_count + 1);
+		result = _count++;
+	}
+	std::vector<uint8_t> zeroes(_stride, 0);
+	Write(result, 0, zeroes.data(), _stride);
+	return result;
+}
+
+void MaterialBuffer::Free(uint32_t index) {
+	LOG_ASSERT(index < _count, "Material buffer index out of range!");
+	_freeEntries.push_back(index);
+}
+
+void MaterialBuffer::Write(uint32_t index, uint32_t offset, const void* data, uint32_t size) {
+	LOG_ASSERT(index < _count && offset + size <= _stride, "Material buffer write out of range!");
+	size_t start = static_cast<size_t>(index) * _stride + offset;
+	memcpy(_data.data() + start, data, size);
+	glNamedBufferSubData(_handle, start, size, data);
+	RenderStats::CountBufferUpload(size);
+}
+
+void MaterialBuffer::Bind() {
+	MarkUsed();
+	RenderState::BindStorageBuffer(MATERIAL_DATA_BINDING, _handle);
+}
+
+const MaterialBuffer::sptr& MaterialBuffer::Get(uint32_t stride) {
+	sptr& result = _buffers[stride];
+	if (result == nullptr) {
+		result = Create(stride);
+	}
+	return result;
+}
+
+void MaterialBuffer::_Reserve(uint32_t capacity) {
+	GPU_RESOURCE_OWNER("MaterialBuffer");
+	if (capacity <= _capacity) {
+		return;
+	}
+	// Double the size so we don't need to re-allocate very often
+	uint32_t newCapacity = _capacity == 0 ? capacity : _capacity;
+	while (newCapacity < capacity) {
+		newCapacity *= 2;
+	}
+	_data.resize(static_cast<size_t>(newCapacity) * _stride, 0);
+	// This keeps the same handle, so binds that are already tracked stay valid
+	IBuffer::LoadData(_data.data(), _stride, newCapacity);
+	_capacity = newCapacity;
+}
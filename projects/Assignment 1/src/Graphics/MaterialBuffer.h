@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "IBuffer.h"
+
+/// <summary>
+/// A material buffer is a shader storage buffer holding an array of per-material structures, shared by every material
+/// whose shader uses the same layout. Each material owns one entry, and draws select their entry by index, so switching
+/// between materials that only differ in these values does not need any uniform calls
+///
+/// A CPU side copy of the whole array is kept, so that the buffer can be re-allocated when it grows
+/// </summary>
+class MaterialBuffer final : public IBuffer
+{
+public:
+	typedef std::shared_ptr<MaterialBuffer> sptr;
+	static inline sptr Create(uint32_t stride) {
+		return std::make_shared<MaterialBuffer>(stride);
+	}
+
+public:
+	/// <summary>
+	/// Creates a new empty material buffer for entries of the given size
+	/// </summary>
+	/// <param name="stride">The size of a single entry in bytes, as reflected from the shader</param>
+	MaterialBuffer(uint32_t stride);
+	~MaterialBuffer() = default;
+
+	/// <summary>
+	/// Reserves an entry in the buffer, growing it if needed. The entry will be zeroed
+	/// </summary>
+	/// <returns>The index of the entry</returns>
+	uint32_t Allocate();
+	/// <summary>
+	/// Returns an entry to the buffer so that it can be re-used by another material
+	/// </summary>
+	/// <param name="index">The index of the entry, as returned by Allocate</param>
+	void Free(uint32_t index);
+
+	/// <summary>
+	/// Writes part of an entry, and uploads the changed bytes to the GPU
+	/// </summary>
+	/// <param name="index">The index of the entry to write to</param>
+	/// <param name="offset">The offset in bytes from the start of the entry</param>
+	/// <param name="data">The data to copy in</param>
+	/// <param name="size">The number of bytes to copy, offset + size must not exceed the stride</param>
+	void Write(uint32_t index, uint32_t offset, const void* data, uint32_t size);
+
+	/// <summary>
+	/// Binds this buffer to the material data binding point
+	/// </summary>
+	void Bind() override;
+
+	/// <summary>
+	/// Gets the size of a single entry in the buffer, in bytes
+	/// </summary>
+	uint32_t GetStride() const { return _stride; }
+	/// <summary>
+	/// Gets the number of entries that are currently in use
+	/// </summary>
+	uint32_t GetAllocatedCount() const { return _count - static_cast<uint32_t>(_freeEntries.size()); }
+
+	/// <summary>
+	/// Gets the shared material buffer for entries of the given size, creating it if it does not exist yet
+	/// </summary>
+	/// <param name="stride">The size of a single entry in bytes</param>
+	static const sptr& Get(uint32_t stride);
+
+	/// <summary>
+	/// Releases our references to the shared buffers, any materials still using them will keep theirs alive
+	/// </summary>
+	static void ReleaseAll() { _buffers.clear(); }
+
+protected:
+	// Grows the buffer (if needed) so that it can fit the given number of entries
+	void _Reserve(uint32_t capacity);
+
+	uint32_t _stride;
+	uint32_t _count;
+	uint32_t _capacity;
+	std::vector<uint32_t> _freeEntries;
+	std::vector<uint8_t>  _data;
+
+	// The shared buffers, keyed by their stride
+	static std::unordered_map<uint32_t, sptr> _buffers;
+};
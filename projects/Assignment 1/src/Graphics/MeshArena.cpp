@@ -0,0 +1,148 @@
+#include "MeshArena.h"
+#include <algorithm>
+
+#include "GpuResources.h"
+#include "Logging.h"
+
+std::unordered_map<const void*, MeshArena::sptr> MeshArena::_arenas;
+
+MeshArena::MeshArena(const std::vector<BufferAttribute>& vertexDecl, size_t vertexStride) :
+	_vertexDecl(vertexDecl),
+	_vertexStride(vertexStride),
+	_vertices(nullptr),
+	_indices(nullptr),
+	_vao(nullptr),
+	_vertexCount(0),
+	_indexCount(0),
+	_vertexCapacity(0),
+	_indexCapacity(0)
+{ }
+
+MeshArenaSlice MeshArena::Allocate(const void* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+{
+	// Meshes without indices are just triangle lists, so we can generate the indices for them
+	std::vector<uint32_t> generated;
+	if (indexCount == 0) {
+		generated.resize(vertexCount);
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			generated[ix] = static_cast<uint32_t>(ix);
+		}
+		indices = generated.data();
+		indexCount = generated.size();
+	}
+
+	_Reserve(_vertexCount + vertexCount, _indexCount + indexCount);
+
+	MeshArenaSlice result;
+	result.Arena = shared_from_this();
+	result.BaseVertex = static_cast<GLint>(_vertexCount);
+	result.FirstIndex = static_cast<GLuint>(_indexCount);
+	result.IndexCount = static_cast<GLuint>(indexCount);
+
+	if (vertexCount > 0) {
+		_vertices->UpdateSubData(_vertexCount, vertices, vertexCount);
+	}
+	if (indexCount > 0) {
+		_indices->UpdateSubData(_indexCount, indices, indexCount);
+	}
+	_vertexCount += vertexCount;
+	_indexCount += indexCount;
+
+	return result;
+}
+
+MeshArenaSlice MeshArena::AllocateCopy(GLuint vertices, size_t vertexCount, GLuint indices, size_t indexCount)
+{
+	LOG_ASSERT(indexCount > 0, "Copied meshes must be indexed!");
+	_Reserve(_vertexCount + vertexCount, _indexCount + indexCount);
+
+	MeshArenaSlice result;
+	result.Arena = shared_from_this();
+	result.BaseVertex = static_cast<GLint>(_vertexCount);
+	result.FirstIndex = static_cast<GLuint>(_indexCount);
+	result.IndexCount = static_cast<GLuint>(indexCount);
+
+	if (vertexCount > 0) {
+		glCopyNamedBufferSubData(vertices, _vertices->GetHandle(), 0, _vertexCount * _vertexStride, vertexCount * _vertexStride);
+	}
+	glCopyNamedBufferSubData(indices, _indices->GetHandle(), 0, _indexCount * sizeof(uint32_t), indexCount * sizeof(uint32_t));
+	_vertexCount += vertexCount;
+	_indexCount += indexCount;
+
+	return result;
+}
+
+MeshArenaSlice MeshArena::AllocateIndices(const MeshArenaSlice& vertices, const uint32_t* indices, size_t indexCount)
+{
+	LOG_ASSERT(vertices.Arena.get() == this, "The vertices must be from the same arena!");
+	_Reserve(_vertexCount, _indexCount + indexCount);
+
+	MeshArenaSlice result;
+	result.Arena = shared_from_this();
+	result.BaseVertex = vertices.BaseVertex;
+	result.FirstIndex = static_cast<GLuint>(_indexCount);
+	result.IndexCount = static_cast<GLuint>(indexCount);
+	if (indexCount > 0) {
+		_indices->UpdateSubData(_indexCount, indices, indexCount);
+	}
+	_indexCount += indexCount;
+	return result;
+}
+
+void MeshArena::Read(const MeshArenaSlice& slice, std::vector<uint8_t>& vertices, std::vector<uint32_t>& indices) const
+{
+	ReadIndices(slice, indices);
+	if (slice.IndexCount == 0) {
+		vertices.clear();
+		return;
+	}
+
+	// Slices don't store how many vertices they have, but since the indices are relative to the slice's first vertex
+	// the largest one tells us
+	const size_t vertexCount = *std::max_element(indices.begin(), indices.end()) + 1ull;
+	vertices.resize(vertexCount * _vertexStride);
+	glGetNamedBufferSubData(_vertices->GetHandle(), slice.BaseVertex * _vertexStride, vertices.size(), vertices.data());
+}
+
+void MeshArena::ReadIndices(const MeshArenaSlice& slice, std::vector<uint32_t>& indices) const
+{
+	indices.resize(slice.IndexCount);
+	if (slice.IndexCount > 0) {
+		glGetNamedBufferSubData(_indices->GetHandle(), slice.FirstIndex * sizeof(uint32_t), slice.IndexCount * sizeof(uint32_t), indices.data());
+	}
+}
+
+void MeshArena::_Reserve(size_t vertexCapacity, size_t indexCapacity)
+{
+	GPU_RESOURCE_OWNER("MeshArena");
+	if (vertexCapacity <= _vertexCapacity && indexCapacity <= _indexCapacity) {
+		return;
+	}
+	// Double the size each time we grow so that loading many meshes does not copy the arena over and over
+	vertexCapacity = std::max(vertexCapacity, _vertexCapacity * 2);
+	indexCapacity = std::max(indexCapacity, _indexCapacity * 2);
+
+	VertexBuffer::sptr vertices = VertexBuffer::Create();
+	vertices->LoadData(nullptr, _vertexStride, vertexCapacity);
+	IndexBuffer::sptr indices = IndexBuffer::Create();
+	indices->LoadData(nullptr, sizeof(uint32_t), indexCapacity, GL_UNSIGNED_INT);
+
+	// Copy the existing meshes over to the new buffers on the GPU
+	if (_vertexCount > 0) {
+		glCopyNamedBufferSubData(_vertices->GetHandle(), vertices->GetHandle(), 0, 0, _vertexCount * _vertexStride);
+	}
+	if (_indexCount > 0) {
+		glCopyNamedBufferSubData(_indices->GetHandle(), indices->GetHandle(), 0, 0, _indexCount * sizeof(uint32_t));
+	}
+
+	// The mesh holds onto the buffers it attaches when it draws, so we need a new one that points to the new buffers
+	VertexArrayObject::sptr vao = VertexArrayObject::Create();
+	vao->AddVertexBuffer(vertices, _vertexDecl);
+	vao->SetIndexBuffer(indices);
+
+	_vertices = vertices;
+	_indices = indices;
+	_vao = vao;
+	_vertexCapacity = vertexCapacity;
+	_indexCapacity = indexCapacity;
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "VertexArrayObject.h"
+
+/// <summary>
+/// A mesh arena packs many meshes that share a vertex format into one large vertex and index buffer, so that
+/// they can all be drawn from a single VAO with glMultiDrawElementsIndirect
+/// </summary>
+class MeshArena final : public std::enable_shared_from_this<MeshArena>
+{
+public:
+	typedef std::shared_ptr<MeshArena> sptr;
+	static inline sptr Create(const std::vector<BufferAttribute>& vertexDecl, size_t vertexStride) {
+		return std::make_shared<MeshArena>(vertexDecl, vertexStride);
+	}
+	// We'll disallow moving and copying, since we want to manually control when the destructor is called
+	// We'll use these classes via pointers
+	MeshArena(const MeshArena& other) = delete;
+	MeshArena(MeshArena&& other) = delete;
+	MeshArena& operator=(const MeshArena& other) = delete;
+	MeshArena& operator=(MeshArena&& other) = delete;
+
+public:
+	/// <summary>
+	/// Creates a new empty arena for vertices with the given layout
+	/// </summary>
+	/// <param name="vertexDecl">The attributes of a single vertex in the arena</param>
+	/// <param name="vertexStride">The size of a single vertex, in bytes</param>
+	MeshArena(const std::vector<BufferAttribute>& vertexDecl, size_t vertexStride);
+	~MeshArena() = default;
+
+	/// <summary>
+	/// Copies a mesh into the arena, growing the underlying buffers if needed
+	/// </summary>
+	/// <param name="vertices">A pointer to the vertex data, must match the arena's vertex layout</param>
+	/// <param name="vertexCount">The number of vertices to copy</param>
+	/// <param name="indices">A pointer to the index data, may be nullptr if the mesh is not indexed</param>
+	/// <param name="indexCount">The number of indices to copy, if 0 the vertices are treated as a triangle list</param>
+	/// <returns>The region of the arena that the mesh now occupies</returns>
+	MeshArenaSlice Allocate(const void* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+	/// <summary>
+	/// Copies a mesh that's already on the GPU into the arena, without the data ever coming back to the CPU (ex: meshes
+	/// that were streamed in with MeshUploadStream)
+	/// </summary>
+	/// <param name="vertices">The handle of the buffer holding the vertices, must match the arena's vertex layout</param>
+	/// <param name="vertexCount">The number of vertices to copy</param>
+	/// <param name="indices">The handle of the buffer holding the 32 bit indices</param>
+	/// <param name="indexCount">The number of indices to copy, must be more than 0</param>
+	/// <returns>The region of the arena that the mesh now occupies</returns>
+	MeshArenaSlice AllocateCopy(GLuint vertices, size_t vertexCount, GLuint indices, size_t indexCount);
+	/// <summary>
+	/// Copies another set of indices into the arena that re-use the vertices of a mesh that is already in it (ex: the
+	/// simplified levels of detail of a mesh)
+	/// </summary>
+	/// <param name="vertices">The slice whose vertices the indices refer to, must be from this arena</param>
+	/// <param name="indices">A pointer to the index data, relative to the slice's first vertex</param>
+	/// <param name="indexCount">The number of indices to copy</param>
+	/// <returns>A slice with the same vertices as the given one, but the new indices</returns>
+	MeshArenaSlice AllocateIndices(const MeshArenaSlice& vertices, const uint32_t* indices, size_t indexCount);
+
+	/// <summary>
+	/// Reads a mesh back from the arena, which is slow since it waits on the GPU. Meant for one off work at load time
+	/// (ex: merging static meshes in StaticBatcher)
+	/// </summary>
+	/// <param name="slice">The slice returned by Allocate</param>
+	/// <param name="vertices">Will store the mesh's vertices, in the arena's vertex layout</param>
+	/// <param name="indices">Will store the mesh's indices, relative to it's first vertex</param>
+	void Read(const MeshArenaSlice& slice, std::vector<uint8_t>& vertices, std::vector<uint32_t>& indices) const;
+	/// <summary>
+	/// Reads just the indices of a mesh back from the arena, see Read
+	/// </summary>
+	/// <param name="slice">The slice returned by Allocate or AllocateIndices</param>
+	/// <param name="indices">Will store the mesh's indices, relative to it's first vertex</param>
+	void ReadIndices(const MeshArenaSlice& slice, std::vector<uint32_t>& indices) const;
+
+	/// <summary>
+	/// Gets the attributes of a single vertex in the arena
+	/// </summary>
+	const std::vector<BufferAttribute>& GetVertexDecl() const { return _vertexDecl; }
+	/// <summary>
+	/// Gets the size of a single vertex in the arena, in bytes
+	/// </summary>
+	size_t GetVertexStride() const { return _vertexStride; }
+
+	/// <summary>
+	/// Gets the VAO that draws from this arena. Note that this gets replaced whenever the arena grows
+	/// </summary>
+	const VertexArrayObject::sptr& GetVao() const { return _vao; }
+
+	/// <summary>
+	/// Returns the number of vertices that have been allocated from this arena
+	/// </summary>
+	size_t GetVertexCount() const { return _vertexCount; }
+	/// <summary>
+	/// Returns the number of indices that have been allocated from this arena
+	/// </summary>
+	size_t GetIndexCount() const { return _indexCount; }
+
+	/// <summary>
+	/// Gets the shared arena for the given vertex type, creating it if it does not exist yet
+	/// </summary>
+	/// <typeparam name="VertType">The vertex type, must have a static V_DECL attribute list</typeparam>
+	template <typename VertType>
+	static const sptr& Get() {
+		sptr& result = _arenas[&VertType::V_DECL];
+		if (result == nullptr) {
+			result = Create(VertType::V_DECL, sizeof(VertType));
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// Releases all the shared arenas, should be called before the OpenGL context is destroyed
+	/// </summary>
+	static void ReleaseAll() { _arenas.clear(); }
+
+protected:
+	// Grows the buffers (if needed) so they can fit the given number of vertices and indices
+	void _Reserve(size_t vertexCapacity, size_t indexCapacity);
+
+	std::vector<BufferAttribute> _vertexDecl;
+	size_t _vertexStride;
+
+	VertexBuffer::sptr      _vertices;
+	IndexBuffer::sptr       _indices;
+	VertexArrayObject::sptr _vao;
+
+	size_t _vertexCount;
+	size_t _indexCount;
+	size_t _vertexCapacity;
+	size_t _indexCapacity;
+
+	// The shared arenas, keyed by the address of the vertex type's declaration
+	static std::unordered_map<const void*, sptr> _arenas;
+};
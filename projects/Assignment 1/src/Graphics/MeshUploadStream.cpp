@@ -0,0 +1,98 @@
+#include "MeshUploadStream.h"
+#include <algorithm>
+
+#include "GpuResources.h"
+#include "Logging.h"
+
+size_t MeshUploadStream::StagingBufferSize = 8 * 1024 * 1024;
+StagingBuffer::sptr MeshUploadStream::_staging = nullptr;
+
+MeshUploadStream::MeshUploadStream(const std::vector<BufferAttribute>& vertexDecl, size_t vertexStride, size_t vertexCapacity, size_t indexCapacity) :
+	_vertexDecl(vertexDecl),
+	_vertexStride(vertexStride),
+	_vertices(nullptr),
+	_indices(nullptr),
+	_vertexCount(0),
+	_indexCount(0),
+	_vertexCapacity(0),
+	_indexCapacity(0)
+{
+	GPU_RESOURCE_OWNER("MeshUploadStream");
+	if (_staging == nullptr) {
+		_staging = StagingBuffer::Create(StagingBufferSize);
+	}
+	_Reserve(std::max(vertexCapacity, static_cast<size_t>(1)), std::max(indexCapacity, static_cast<size_t>(1)));
+}
+
+void MeshUploadStream::AppendVertices(const void* vertices, size_t count) {
+	if (count == 0) {
+		return;
+	}
+	_Reserve(_vertexCount + count, _indexCount);
+	_staging->Upload(_vertices->GetHandle(), _vertexCount * _vertexStride, vertices, count * _vertexStride);
+	_vertexCount += count;
+}
+
+void MeshUploadStream::AppendIndices(const uint32_t* indices, size_t count) {
+	if (count == 0) {
+		return;
+	}
+	_Reserve(_vertexCount, _indexCount + count);
+	_staging->Upload(_indices->GetHandle(), _indexCount * sizeof(uint32_t), indices, count * sizeof(uint32_t));
+	_indexCount += count;
+}
+
+VertexArrayObject::sptr MeshUploadStream::Finish(const BoundingVolume& bounds, const MeshArena::sptr& arena) {
+	GPU_RESOURCE_OWNER("MeshUploadStream");
+	if (_vertexCount == 0 || _indexCount == 0) {
+		return nullptr;
+	}
+
+	// Our buffers were grown by doubling, so copy them into ones that are just the right size. The copies stay on the
+	// GPU, and the mesh never changes after this so it gets immutable storage
+	VertexBuffer::sptr vbo = VertexBuffer::Create();
+	vbo->LoadImmutable(nullptr, _vertexStride, _vertexCount);
+	glCopyNamedBufferSubData(_vertices->GetHandle(), vbo->GetHandle(), 0, 0, _vertexCount * _vertexStride);
+	IndexBuffer::sptr ebo = IndexBuffer::Create();
+	ebo->LoadImmutable(nullptr, sizeof(uint32_t), _indexCount, GL_UNSIGNED_INT);
+	glCopyNamedBufferSubData(_indices->GetHandle(), ebo->GetHandle(), 0, 0, _indexCount * sizeof(uint32_t));
+
+	VertexArrayObject::sptr result = VertexArrayObject::Create();
+	result->AddVertexBuffer(vbo, _vertexDecl);
+	result->SetIndexBuffer(ebo);
+	result->SetBounds(bounds);
+
+	LOG_ASSERT(arena->GetVertexStride() == _vertexStride, "Arena does not match the stream's vertex layout!");
+	result->SetArenaSlice(arena->AllocateCopy(vbo->GetHandle(), _vertexCount, ebo->GetHandle(), _indexCount));
+
+	_vertices = nullptr;
+	_indices = nullptr;
+	_vertexCount = _indexCount = 0;
+	_vertexCapacity = _indexCapacity = 0;
+	return result;
+}
+
+void MeshUploadStream::_Reserve(size_t vertexCapacity, size_t indexCapacity) {
+	GPU_RESOURCE_OWNER("MeshUploadStream");
+	if (vertexCapacity > _vertexCapacity) {
+		// Double the size each time we grow, same as the mesh arena
+		vertexCapacity = std::max(vertexCapacity, _vertexCapacity * 2);
+		VertexBuffer::sptr vertices = VertexBuffer::Create();
+		vertices->LoadData(nullptr, _vertexStride, vertexCapacity);
+		if (_vertexCount > 0) {
+			glCopyNamedBufferSubData(_vertices->GetHandle(), vertices->GetHandle(), 0, 0, _vertexCount * _vertexStride);
+		}
+		_vertices = vertices;
+		_vertexCapacity = vertexCapacity;
+	}
+	if (indexCapacity > _indexCapacity) {
+		indexCapacity = std::max(indexCapacity, _indexCapacity * 2);
+		IndexBuffer::sptr indices = IndexBuffer::Create();
+		indices->LoadData(nullptr, sizeof(uint32_t), indexCapacity, GL_UNSIGNED_INT);
+		if (_indexCount > 0) {
+			glCopyNamedBufferSubData(_indices->GetHandle(), indices->GetHandle(), 0, 0, _indexCount * sizeof(uint32_t));
+		}
+		_indices = indices;
+		_indexCapacity = indexCapacity;
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "VertexArrayObject.h"
+#include "StagingBuffer.h"
+#include "MeshArena.h"
+
+/// <summary>
+/// Builds a mesh on the GPU a piece at a time, so loaders can hand off geometry as they produce it instead of
+/// holding the whole mesh in memory until the end. Each piece goes through the shared StagingBuffer, so the GPU
+/// copies it into place while the loader keeps working on the next one
+///
+/// Must only be used from the main thread, since it issues OpenGL calls
+/// </summary>
+class MeshUploadStream final
+{
+public:
+	// We'll disallow moving and copying, since we own OpenGL buffers
+	MeshUploadStream(const MeshUploadStream& other) = delete;
+	MeshUploadStream(MeshUploadStream&& other) = delete;
+	MeshUploadStream& operator=(const MeshUploadStream& other) = delete;
+	MeshUploadStream& operator=(MeshUploadStream&& other) = delete;
+
+	/// <summary>
+	/// The size of the staging buffer shared by all streams, in bytes. Only takes effect before the first stream
+	/// is created
+	/// </summary>
+	static size_t StagingBufferSize;
+
+	/// <summary>
+	/// Starts a new stream
+	/// </summary>
+	/// <param name="vertexDecl">The attributes of a single vertex</param>
+	/// <param name="vertexStride">The size of a single vertex, in bytes</param>
+	/// <param name="vertexCapacity">A guess at how many vertices the mesh will have, the buffers grow if it's wrong</param>
+	/// <param name="indexCapacity">A guess at how many indices the mesh will have</param>
+	MeshUploadStream(const std::vector<BufferAttribute>& vertexDecl, size_t vertexStride, size_t vertexCapacity, size_t indexCapacity);
+	~MeshUploadStream() = default;
+
+	/// <summary>
+	/// Queues some vertices to be copied onto the end of the mesh
+	/// </summary>
+	/// <param name="vertices">The vertices to append, must match the stream's vertex layout</param>
+	/// <param name="count">The number of vertices to append</param>
+	void AppendVertices(const void* vertices, size_t count);
+	/// <summary>
+	/// Queues some indices to be copied onto the end of the mesh. Indices are relative to the first vertex of the
+	/// whole mesh, not the vertices from the last append
+	/// </summary>
+	/// <param name="indices">The indices to append</param>
+	/// <param name="count">The number of indices to append</param>
+	void AppendIndices(const uint32_t* indices, size_t count);
+
+	/// <summary>
+	/// Gets the number of vertices that have been appended so far
+	/// </summary>
+	size_t GetVertexCount() const { return _vertexCount; }
+	/// <summary>
+	/// Gets the number of indices that have been appended so far
+	/// </summary>
+	size_t GetIndexCount() const { return _indexCount; }
+
+	/// <summary>
+	/// Finishes the mesh, trimming the buffers down to size and packing a copy into the given arena
+	/// </summary>
+	/// <param name="bounds">The bounds of the mesh, since we never see all of the vertices at once</param>
+	/// <param name="arena">The arena to pack a copy into, must have the same vertex layout as the stream</param>
+	/// <returns>The finished mesh, or nullptr if nothing was appended</returns>
+	VertexArrayObject::sptr Finish(const BoundingVolume& bounds, const MeshArena::sptr& arena);
+
+	/// <summary>
+	/// Releases the shared staging buffer, should be called before the OpenGL context is destroyed
+	/// </summary>
+	static void ReleaseAll() { _staging = nullptr; }
+
+protected:
+	std::vector<BufferAttribute> _vertexDecl;
+	size_t _vertexStride;
+
+	VertexBuffer::sptr _vertices;
+	IndexBuffer::sptr  _indices;
+	size_t _vertexCount;
+	size_t _indexCount;
+	size_t _vertexCapacity;
+	size_t _indexCapacity;
+
+	static StagingBuffer::sptr _staging;
+
+	// Grows the buffers (if needed) so they can fit the given number of vertices and indices
+	void _Reserve(size_t vertexCapacity, size_t indexCapacity);
+};
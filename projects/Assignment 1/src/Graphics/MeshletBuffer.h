@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <GLM/glm.hpp>
+
+#include "IBuffer.h"
+
+/// <summary>
+/// A small cluster of neighbouring triangles within a mesh, that can be culled on it's own. The layout matches the
+/// std430 Meshlet struct in shaders/meshlet_cull.comp.glsl, so an array of these can be uploaded as is
+/// </summary>
+struct Meshlet
+{
+	/// <summary>
+	/// The center of the sphere enclosing all of the cluster's triangles, in the mesh's local space
+	/// </summary>
+	glm::vec3 Center;
+	/// <summary>
+	/// The radius of the bounding sphere
+	/// </summary>
+	float     Radius;
+	/// <summary>
+	/// The tip of the cone that contains all of the triangle normals, the cluster is facing away from any camera that
+	/// sits inside the cone's negative half
+	/// </summary>
+	glm::vec3 ConeApex;
+	/// <summary>
+	/// The number of unique vertices the cluster's triangles use
+	/// </summary>
+	uint32_t  VertexCount;
+	/// <summary>
+	/// The average direction of the triangle normals
+	/// </summary>
+	glm::vec3 ConeAxis;
+	/// <summary>
+	/// The sine of the cone's spread, the cluster can be skipped when dot(normalize(apex - camera), axis) is at least
+	/// this. Values above 1 mean the normals are spread out too far and the cluster can never be backface culled
+	/// </summary>
+	float     ConeCutoff;
+	/// <summary>
+	/// The first index of the cluster within the mesh's index buffer
+	/// </summary>
+	uint32_t  FirstIndex;
+	/// <summary>
+	/// The number of indices in the cluster
+	/// </summary>
+	uint32_t  IndexCount;
+	uint32_t  Padding[2];
+};
+
+static_assert(sizeof(Meshlet) == 64, "Meshlet must match the std430 layout of the Meshlet struct in the culling shader");
+
+/// <summary>
+/// A shader storage buffer holding the meshlets of a single mesh, read by the meshlet culling pass (see MeshletCuller)
+/// </summary>
+class MeshletBuffer final : public IBuffer
+{
+public:
+	typedef std::shared_ptr<MeshletBuffer> sptr;
+	static inline sptr Create(const std::vector<Meshlet>& meshlets) {
+		return std::make_shared<MeshletBuffer>(meshlets);
+	}
+
+public:
+	/// <summary>
+	/// Creates a new meshlet buffer and uploads the meshlets to it
+	/// </summary>
+	/// <param name="meshlets">The clusters of the mesh, as built by MeshOptimizer::BuildMeshlets</param>
+	MeshletBuffer(const std::vector<Meshlet>& meshlets) : IBuffer(GL_SHADER_STORAGE_BUFFER, GL_STATIC_DRAW) {
+		LoadImmutable(meshlets.data(), meshlets.size());
+	}
+};
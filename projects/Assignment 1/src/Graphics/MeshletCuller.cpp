@@ -0,0 +1,105 @@
+#include "MeshletCuller.h"
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "MeshArena.h"
+#include "RenderState.h"
+#include "UniformBlocks.h"
+
+// The storage bindings used by the culling pass, must match meshlet_cull.comp.glsl
+static const GLuint MESHLET_BINDING  = 2;
+static const GLuint INSTANCE_BINDING = 3;
+static const GLuint COMMAND_BINDING  = 4;
+static const GLuint COUNT_BINDING    = 5;
+// Must match local_size_x in the shader
+static const uint32_t GROUP_SIZE     = 64;
+
+MeshletCuller::MeshletCuller() :
+	_isReady(false),
+	_commandCount(0)
+{
+	GPU_RESOURCE_OWNER("MeshletCuller");
+	_shader = Shader::Create();
+	_shader->LoadShaderPartFromFile("shaders/meshlet_cull.comp.glsl", GL_COMPUTE_SHADER);
+	_isReady = _shader->Link();
+	if (!_isReady) {
+		LOG_WARN("Meshlet culling shader failed to compile, meshes will be drawn whole");
+	}
+
+	_commands = IndirectBuffer::Create(GL_DYNAMIC_COPY);
+	// The counts are only ever read by indirect draws, so they may as well live in an indirect buffer too
+	_counts = IndirectBuffer::Create(GL_DYNAMIC_COPY);
+	for (int ix = 0; ix < 6; ix++) {
+		_planes[ix] = glm::vec4(0.0f);
+	}
+}
+
+void MeshletCuller::BeginFrame(const Frustum& frustum, const DepthPyramid::sptr& occluders) {
+	_batches.clear();
+	_occluders = (occluders != nullptr && occluders->HasPyramid()) ? occluders : nullptr;
+	_commandCount = 0;
+	for (int ix = 0; ix < 6; ix++) {
+		_planes[ix] = frustum.GetPlanes()[ix];
+	}
+}
+
+int MeshletCuller::Cull(const VertexArrayObject::sptr& mesh, const VertexBuffer::sptr& instances, int baseInstance, int instanceCount) {
+	LOG_ASSERT(mesh->GetMeshlets() != nullptr && mesh->GetArenaSlice().Arena != nullptr, "Meshlet culling requires a mesh with meshlets in an arena!");
+	Batch batch;
+	batch.Mesh = mesh;
+	batch.Instances = instances;
+	batch.BaseInstance = baseInstance;
+	batch.InstanceCount = instanceCount;
+	batch.FirstCommand = _commandCount;
+	batch.MaxCommands = static_cast<uint32_t>(mesh->GetMeshlets()->GetElementCount()) * static_cast<uint32_t>(instanceCount);
+	_commandCount += batch.MaxCommands;
+	_batches.push_back(batch);
+	return static_cast<int>(_batches.size() - 1);
+}
+
+void MeshletCuller::EndFrame() {
+	if (_batches.empty()) {
+		return;
+	}
+	// Every command slot will get written (or skipped) by the pass, so we only re-allocate without uploading anything.
+	// The counters need to start at zero though
+	if (_commands->GetElementCount() < static_cast<GLsizei>(_commandCount)) {
+		_commands->LoadData(static_cast<const DrawElementsIndirectCommand*>(nullptr), _commandCount);
+	}
+	_zeroCounts.assign(_batches.size(), 0);
+	_counts->LoadData(_zeroCounts.data(), _zeroCounts.size());
+
+	_shader->Bind();
+	_shader->SetUniform(_shader->GetUniformLocation("u_FrustumPlanes"_hs), _planes, 6);
+	_shader->SetUniform("u_OcclusionCulling"_hs, _occluders != nullptr ? 1 : 0);
+	if (_occluders != nullptr) {
+		_shader->SetUniformMatrix("u_OcclusionViewProjection"_hs, _occluders->GetViewProjection());
+		_shader->SetUniform("u_PyramidLevels"_hs, _occluders->GetLevelCount());
+		RenderState::BindTextureUnit(DEPTH_PYRAMID_UNIT, _occluders->GetTexture());
+		RenderState::BindSampler(DEPTH_PYRAMID_UNIT, 0);
+	}
+	RenderState::BindStorageBuffer(COMMAND_BINDING, _commands->GetHandle());
+	RenderState::BindStorageBuffer(COUNT_BINDING, _counts->GetHandle());
+	for (size_t ix = 0; ix < _batches.size(); ix++) {
+		const Batch& batch = _batches[ix];
+		const MeshArenaSlice& slice = batch.Mesh->GetArenaSlice();
+		const GLsizei meshletCount = batch.Mesh->GetMeshlets()->GetElementCount();
+		_shader->SetUniform("u_MeshletCount"_hs, static_cast<int>(meshletCount));
+		_shader->SetUniform("u_BaseInstance"_hs, batch.BaseInstance);
+		_shader->SetUniform("u_FirstIndex"_hs, static_cast<int>(slice.FirstIndex));
+		_shader->SetUniform("u_BaseVertex"_hs, static_cast<int>(slice.BaseVertex));
+		_shader->SetUniform("u_FirstCommand"_hs, static_cast<int>(batch.FirstCommand));
+		_shader->SetUniform("u_CountIndex"_hs, static_cast<int>(ix));
+		RenderState::BindStorageBuffer(MESHLET_BINDING, batch.Mesh->GetMeshlets()->GetHandle());
+		RenderState::BindStorageBuffer(INSTANCE_BINDING, batch.Instances->GetHandle());
+		glDispatchCompute((meshletCount + GROUP_SIZE - 1) / GROUP_SIZE, batch.InstanceCount, 1);
+	}
+	// The draws read the commands and counts through the indirect binding points, not as storage buffers
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+	_occluders = nullptr;
+}
+
+void MeshletCuller::Render(int batch, const VertexArrayObject::sptr& vao) const {
+	const Batch& entry = _batches[batch];
+	vao->RenderIndirectCount(_commands, entry.FirstCommand, *_counts, batch, entry.MaxCommands);
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "DepthPyramid.h"
+#include "Frustum.h"
+#include "IndirectBuffer.h"
+#include "Shader.h"
+#include "VertexArrayObject.h"
+
+/// <summary>
+/// Culls the meshlets of big meshes on the GPU, so only the clusters that are on screen and facing the camera get
+/// drawn. Each batch queued with Cull gets a compute dispatch that tests every meshlet of every instance against the
+/// frustum, the meshlet's normal cone and (when given one) last frame's DepthPyramid, and appends a draw command for each one that survives. The commands are then
+/// drawn with glMultiDrawElementsIndirectCount, so the CPU never needs to know how many made it
+///
+/// Usage each frame: BeginFrame, Cull for each batch, EndFrame, then Render for each batch
+/// </summary>
+class MeshletCuller final
+{
+public:
+	typedef std::shared_ptr<MeshletCuller> sptr;
+	static inline sptr Create() {
+		return std::make_shared<MeshletCuller>();
+	}
+	// We'll disallow moving and copying, since we own GPU buffers
+	MeshletCuller(const MeshletCuller& other) = delete;
+	MeshletCuller(MeshletCuller&& other) = delete;
+	MeshletCuller& operator=(const MeshletCuller& other) = delete;
+	MeshletCuller& operator=(MeshletCuller&& other) = delete;
+
+public:
+	/// <summary>
+	/// Creates a new culler, and compiles the culling shader
+	/// </summary>
+	MeshletCuller();
+	~MeshletCuller() = default;
+
+	/// <summary>
+	/// Returns true if the culling shader compiled, if not every mesh should just be drawn as a whole
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Throws away the batches from the last frame and starts a new one
+	/// </summary>
+	/// <param name="frustum">The world space view volume to cull the meshlets against</param>
+	/// <param name="occluders">The depth pyramid to cull hidden meshlets against, or nullptr to skip occlusion culling</param>
+	void BeginFrame(const Frustum& frustum, const DepthPyramid::sptr& occluders = nullptr);
+	/// <summary>
+	/// Queues the culling for a batch of instances of a mesh, nothing is dispatched until EndFrame
+	/// </summary>
+	/// <param name="mesh">The mesh to cull, must have meshlets and an arena slice</param>
+	/// <param name="instances">The buffer of InstanceTransforms that the batch draws from</param>
+	/// <param name="baseInstance">The index of the batch's first instance in the buffer</param>
+	/// <param name="instanceCount">The number of instances in the batch</param>
+	/// <returns>The index of the batch, to pass to Render</returns>
+	int Cull(const VertexArrayObject::sptr& mesh, const VertexBuffer::sptr& instances, int baseInstance, int instanceCount);
+	/// <summary>
+	/// Runs the culling for every batch queued this frame. Must be called after the last Cull, and before the first Render
+	/// </summary>
+	void EndFrame();
+	/// <summary>
+	/// Draws the meshlets of a batch that survived culling. The material should already be applied
+	/// </summary>
+	/// <param name="batch">The index returned by Cull</param>
+	/// <param name="vao">The VAO of the arena that the batch's mesh lives in, with the instance buffer attached</param>
+	void Render(int batch, const VertexArrayObject::sptr& vao) const;
+
+	/// <summary>
+	/// Gets the number of meshlet instances that were tested this frame
+	/// </summary>
+	uint32_t GetTestedCount() const { return _commandCount; }
+
+protected:
+	// What we need to remember about each batch from Cull until the dispatch
+	struct Batch {
+		VertexArrayObject::sptr Mesh;
+		VertexBuffer::sptr      Instances;
+		int                     BaseInstance;
+		int                     InstanceCount;
+		// Where the batch's commands start, with room for every meshlet of every instance
+		uint32_t                FirstCommand;
+		uint32_t                MaxCommands;
+	};
+
+	Shader::sptr         _shader;
+	bool                 _isReady;
+	// Written by the culling pass, so we only ever size them on the CPU
+	IndirectBuffer::sptr _commands;
+	IndirectBuffer::sptr _counts;
+	std::vector<Batch>   _batches;
+	std::vector<GLuint>  _zeroCounts;
+	uint32_t             _commandCount;
+	glm::vec4            _planes[6];
+	// Only set for the frame if it has a pyramid to test against
+	DepthPyramid::sptr   _occluders;
+};
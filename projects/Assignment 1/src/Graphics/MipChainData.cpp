@@ -0,0 +1,145 @@
+#include "MipChainData.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "Utilities/FileUtils.h"
+
+// The header at the start of every sidecar, followed by a MipChainLevel for each level and then the pixels
+struct MipChainHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Width;
+	uint32_t Height;
+	GLint    Format;
+	GLint    Type;
+	GLint    RecommendedFormat;
+	uint32_t LevelCount;
+	// Used to detect when the source image has changed since the sidecar was cooked
+	uint64_t SourceSize;
+	int64_t  SourceWriteTime;
+};
+struct MipChainLevel {
+	uint64_t Offset;
+	uint64_t Size;
+};
+
+static const uint32_t MIP_CHAIN_MAGIC   = 'T' | ('M' << 8) | ('I' << 16) | ('P' << 24);
+// Bump this whenever the layout of the file or the way we filter changes, so old sidecars get re-cooked
+static const uint32_t MIP_CHAIN_VERSION = 1;
+
+MipChainData::MipChainData(uint32_t width, uint32_t height, PixelFormat format, PixelType type, InternalFormat recommendedFormat) :
+	_width(width), _height(height), _format(format), _type(type), _recommendedFormat(recommendedFormat)
+{
+	LOG_ASSERT(width > 0 && height > 0, "Width and height must both be greater than zero! Got {}x{}", width, height);
+}
+
+void MipChainData::AddLevel(const void* data) {
+	const uint32_t level = GetLevelCount();
+	LOG_ASSERT(level < GetMipLevelCount(_width, _height), "Mip chain for a {}x{} image already has all of it's levels", _width, _height);
+	MipLevel result;
+	result.Width  = std::max(_width >> level, 1u);
+	result.Height = std::max(_height >> level, 1u);
+	result.Offset = _data.size();
+	result.Size   = result.Width * (size_t)result.Height * GetTexelSize(_format, _type);
+	_data.resize(_data.size() + result.Size);
+	memcpy(_data.data() + result.Offset, data, result.Size);
+	_levels.push_back(result);
+}
+
+std::string MipChainData::GetSidecarPath(const std::string& imagePath, const std::string& extension) {
+	return imagePath + extension;
+}
+
+MipChainData::sptr MipChainData::LoadSidecar(const std::string& imagePath, const std::string& extension) {
+	const std::string path = GetSidecarPath(imagePath, extension);
+	std::ifstream stream(path, std::ios::binary | std::ios::ate);
+	// Missing sidecars are normal, images that haven't been cooked just generate their mips on the GPU
+	if (!stream.is_open()) {
+		return nullptr;
+	}
+	std::vector<uint8_t> contents(static_cast<size_t>(stream.tellg()));
+	stream.seekg(0);
+	stream.read(reinterpret_cast<char*>(contents.data()), contents.size());
+	stream.close();
+
+	if (contents.size() < sizeof(MipChainHeader)) {
+		LOG_WARN("Mip chain \"{}\" is truncated", path);
+		return nullptr;
+	}
+	MipChainHeader header;
+	memcpy(&header, contents.data(), sizeof(MipChainHeader));
+	if (header.Magic != MIP_CHAIN_MAGIC || header.Version != MIP_CHAIN_VERSION) {
+		LOG_WARN("Mip chain \"{}\" is not a sidecar we can read, it should be re-cooked", path);
+		return nullptr;
+	}
+
+	// The sidecar is only as good as the image it was cooked from
+	uint64_t sourceSize;
+	int64_t  sourceWriteTime;
+	if (GetFileStamp(imagePath, sourceSize, sourceWriteTime) &&
+		(sourceSize != header.SourceSize || sourceWriteTime != header.SourceWriteTime))
+	{
+		LOG_WARN("Mip chain \"{}\" is older than it's image, it should be re-cooked", path);
+		return nullptr;
+	}
+
+	if (header.Width == 0 || header.Height == 0 || header.LevelCount == 0 ||
+		header.LevelCount > GetMipLevelCount(header.Width, header.Height) ||
+		contents.size() < sizeof(MipChainHeader) + header.LevelCount * sizeof(MipChainLevel))
+	{
+		LOG_WARN("Mip chain \"{}\" is corrupted", path);
+		return nullptr;
+	}
+
+	sptr result = std::make_shared<MipChainData>(header.Width, header.Height,
+		(PixelFormat)header.Format, (PixelType)header.Type, (InternalFormat)header.RecommendedFormat);
+	const size_t dataStart = sizeof(MipChainHeader) + header.LevelCount * sizeof(MipChainLevel);
+	for (uint32_t level = 0; level < header.LevelCount; level++) {
+		MipChainLevel index;
+		memcpy(&index, contents.data() + sizeof(MipChainHeader) + level * sizeof(MipChainLevel), sizeof(MipChainLevel));
+		uint32_t width  = std::max(header.Width >> level, 1u);
+		uint32_t height = std::max(header.Height >> level, 1u);
+		const size_t size = width * (size_t)height * GetTexelSize(result->_format, result->_type);
+		if (index.Size != size || contents.size() < dataStart + index.Offset + size) {
+			LOG_WARN("Mip chain \"{}\" is missing data for mip level {}", path, level);
+			return nullptr;
+		}
+		result->AddLevel(contents.data() + dataStart + index.Offset);
+	}
+	result->DebugName = std::filesystem::path(imagePath).filename().string();
+	return result;
+}
+
+bool MipChainData::SaveSidecar(const std::string& imagePath, const std::string& extension) const {
+	const std::string path = GetSidecarPath(imagePath, extension);
+
+	MipChainHeader header;
+	header.Magic             = MIP_CHAIN_MAGIC;
+	header.Version           = MIP_CHAIN_VERSION;
+	header.Width             = _width;
+	header.Height            = _height;
+	header.Format            = *_format;
+	header.Type              = *_type;
+	header.RecommendedFormat = *_recommendedFormat;
+	header.LevelCount        = GetLevelCount();
+	if (!GetFileStamp(imagePath, header.SourceSize, header.SourceWriteTime)) {
+		LOG_WARN("Could not read the source image \"{}\" for a mip chain", imagePath);
+		return false;
+	}
+
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	if (!stream.is_open()) {
+		LOG_WARN("Failed to open \"{}\" for writing", path);
+		return false;
+	}
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(MipChainHeader));
+	for (const MipLevel& level : _levels) {
+		MipChainLevel index{ level.Offset, level.Size };
+		stream.write(reinterpret_cast<const char*>(&index), sizeof(MipChainLevel));
+	}
+	stream.write(reinterpret_cast<const char*>(_data.data()), _data.size());
+	return stream.good();
+}
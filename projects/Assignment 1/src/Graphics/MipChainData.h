@@ -0,0 +1,121 @@
+#pragma once
+#include <memory>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TextureEnums.h"
+
+/// <summary>
+/// Stores an uncompressed image along with all of it's mip levels, packed back to back in a single buffer so it can
+/// be staged for upload in one copy. These are normally built ahead of time by TextureCook and saved next to the
+/// source image as a sidecar file (ex: images/grass.jpg -> images/grass.jpg.mips)
+/// </summary>
+class MipChainData final
+{
+public:
+	MipChainData(const MipChainData& other) = delete;
+	MipChainData(MipChainData&& other) = delete;
+	MipChainData& operator=(const MipChainData& other) = delete;
+	MipChainData& operator=(MipChainData&& other) = delete;
+	typedef std::shared_ptr<MipChainData> sptr;
+
+	/// <summary>
+	/// Describes where a single mip level lives in our data
+	/// </summary>
+	struct MipLevel {
+		uint32_t Width;
+		uint32_t Height;
+		size_t   Offset;
+		size_t   Size;
+	};
+
+	std::string DebugName;
+
+	/// <summary>
+	/// Creates a new, empty mip chain, the levels get added with AddLevel
+	/// </summary>
+	/// <param name="width">The width of the largest mip level, in pixels</param>
+	/// <param name="height">The height of the largest mip level, in pixels</param>
+	/// <param name="format">The pixel format or layout of a pixel (ex: RGBA)</param>
+	/// <param name="type">The component type of the pixel (ex: uint8_t)</param>
+	/// <param name="recommendedFormat">The recommended internal format to use when creating textures from this data</param>
+	MipChainData(uint32_t width, uint32_t height, PixelFormat format, PixelType type, InternalFormat recommendedFormat);
+	~MipChainData() = default;
+
+	/// <summary>
+	/// Appends the next mip level, levels must be added from largest to smallest
+	/// </summary>
+	/// <param name="data">The pixels for the level, must be the size of the level</param>
+	void AddLevel(const void* data);
+
+	/// <summary>
+	/// Gets the path of the sidecar file that stores the mip chain for an image
+	/// </summary>
+	/// <param name="imagePath">The path of the source image</param>
+	/// <param name="extension">Added to the image path, images with more than one cooked result use a different one for each</param>
+	static std::string GetSidecarPath(const std::string& imagePath, const std::string& extension = ".mips");
+	/// <summary>
+	/// Loads the mip chain for an image from it's sidecar file, if it exists and is newer than the image
+	/// </summary>
+	/// <param name="imagePath">The path of the source image (not the sidecar)</param>
+	/// <param name="extension">The extension of the sidecar, see GetSidecarPath</param>
+	/// <returns>The mip chain, or nullptr if there is no valid sidecar</returns>
+	static MipChainData::sptr LoadSidecar(const std::string& imagePath, const std::string& extension = ".mips");
+	/// <summary>
+	/// Writes this mip chain to the sidecar file for an image
+	/// </summary>
+	/// <param name="imagePath">The path of the source image (not the sidecar)</param>
+	/// <param name="extension">The extension of the sidecar, see GetSidecarPath</param>
+	/// <returns>True if the file was written</returns>
+	bool SaveSidecar(const std::string& imagePath, const std::string& extension = ".mips") const;
+
+	/// <summary>
+	/// Gets the width of the largest mip level, in pixels
+	/// </summary>
+	uint32_t GetWidth() const { return _width; }
+	/// <summary>
+	/// Gets the height of the largest mip level, in pixels
+	/// </summary>
+	uint32_t GetHeight() const { return _height; }
+	/// <summary>
+	/// Gets the Pixel Format (RG, RGB, RGBA, etc) of the data
+	/// </summary>
+	PixelFormat GetFormat() const { return _format; }
+	/// <summary>
+	/// Gets the underlying data type of a single component
+	/// </summary>
+	PixelType GetPixelType() const { return _type; }
+	/// <summary>
+	/// Gets a recommended internal format to use when creating a texture using this data
+	/// </summary>
+	InternalFormat GetRecommendedFormat() const { return _recommendedFormat; }
+	/// <summary>
+	/// Gets the number of mip levels that have been added
+	/// </summary>
+	uint32_t GetLevelCount() const { return static_cast<uint32_t>(_levels.size()); }
+	/// <summary>
+	/// Gets the size and location of a mip level
+	/// </summary>
+	const MipLevel& GetLevel(uint32_t level) const { return _levels[level]; }
+	/// <summary>
+	/// Gets a readonly pointer to the pixels for a mip level
+	/// </summary>
+	const void* GetLevelData(uint32_t level) const { return _data.data() + _levels[level].Offset; }
+	/// <summary>
+	/// Gets the total size of all the levels, in bytes
+	/// </summary>
+	size_t GetDataSize() const { return _data.size(); }
+	/// <summary>
+	/// Gets a readonly pointer to all the levels, see GetLevel for where each one starts
+	/// </summary>
+	const void* GetDataPtr() const { return _data.data(); }
+
+private:
+	uint32_t              _width, _height;
+	PixelFormat           _format;
+	PixelType             _type;
+	InternalFormat        _recommendedFormat;
+	std::vector<MipLevel> _levels;
+	std::vector<uint8_t>  _data;
+};
@@ -0,0 +1,119 @@
+#include "OcclusionQueries.h"
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderState.h"
+#include "RenderStats.h"
+
+// The box is drawn as a single triangle strip, see occlusion_box.vert.glsl
+static const int BOX_VERTEX_COUNT = 14;
+// How far the camera has to be outside of a box before it gets queried, so the near plane can't clip it's front faces
+static const float NEAR_MARGIN = 0.1f;
+
+OcclusionQueries::OcclusionQueries() :
+	_isReady(false),
+	_emptyVao(0),
+	_entries(),
+	_frame(0),
+	_stats(),
+	_counting()
+{
+	GPU_RESOURCE_OWNER("OcclusionQueries");
+	_shader = Shader::Create();
+	_shader->LoadShaderPartFromFile("shaders/occlusion_box.vert.glsl", GL_VERTEX_SHADER);
+	_shader->LoadShaderPartFromFile("shaders/shadow_depth.frag.glsl", GL_FRAGMENT_SHADER);
+	_isReady = _shader->Link();
+	if (!_isReady) {
+		LOG_WARN("Occlusion query shader failed to compile, queried renderers will always be drawn");
+	}
+	glCreateVertexArrays(1, &_emptyVao);
+}
+
+OcclusionQueries::~OcclusionQueries() {
+	Reset();
+	RenderState::OnVertexArrayDeleted(_emptyVao);
+	glDeleteVertexArrays(1, &_emptyVao);
+}
+
+void OcclusionQueries::BeginFrame() {
+	_counting.Tracked = static_cast<uint32_t>(_entries.size());
+	_stats = _counting;
+	_counting = Stats();
+	_frame++;
+	// Renderers that have been gone for a while (ex: destroyed, or turned off) don't need their queries anymore
+	for (auto it = _entries.begin(); it != _entries.end();) {
+		if (_frame - it->second.LastFrame > RETIRE_FRAMES) {
+			glDeleteQueries(2, it->second.Queries);
+			it = _entries.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+bool OcclusionQueries::BeginConditional(uint32_t key) {
+	if (key == NONE) {
+		return false;
+	}
+	auto it = _entries.find(key);
+	// Only last frame's query says anything about this frame, anything older was drawn from somewhere else
+	if (it == _entries.end() || it->second.LastFrame + 1 != _frame) {
+		return false;
+	}
+	glBeginConditionalRender(it->second.Queries[(_frame - 1) & 1], GL_QUERY_NO_WAIT);
+	_counting.ConditionalDraws++;
+	return true;
+}
+
+void OcclusionQueries::EndConditional() {
+	glEndConditionalRender();
+}
+
+void OcclusionQueries::Render(const std::vector<Box>& boxes, const glm::vec3& cameraPos) {
+	if (!_isReady || boxes.empty()) {
+		return;
+	}
+	_shader->Bind();
+	RenderState::BindVertexArray(_emptyVao);
+	// The boxes only need to be tested, so nothing gets written. Both sides get drawn since the strip's winding
+	// alternates, and the camera is never inside a box we draw
+	RenderState::SetDepthFunc(GL_LEQUAL);
+	RenderState::SetDepthMask(false);
+	RenderState::SetEnabled(GL_DEPTH_TEST, true);
+	RenderState::SetEnabled(GL_CULL_FACE, false);
+	RenderState::SetEnabled(GL_BLEND, false);
+	RenderState::SetPolygonMode(GL_FILL);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	for (const Box& box : boxes) {
+		const glm::vec3 min = box.Bounds.Min - glm::vec3(NEAR_MARGIN);
+		const glm::vec3 max = box.Bounds.Max + glm::vec3(NEAR_MARGIN);
+		if (glm::all(glm::greaterThanEqual(cameraPos, min)) && glm::all(glm::lessThanEqual(cameraPos, max))) {
+			_counting.Skipped++;
+			continue;
+		}
+		auto it = _entries.find(box.Key);
+		if (it == _entries.end()) {
+			Entry entry;
+			glCreateQueries(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, 2, entry.Queries);
+			entry.LastFrame = 0;
+			it = _entries.emplace(box.Key, entry).first;
+		}
+		_shader->SetUniform("u_BoxMin"_hs, box.Bounds.Min);
+		_shader->SetUniform("u_BoxMax"_hs, box.Bounds.Max);
+		glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, it->second.Queries[_frame & 1]);
+		RenderStats::CountDraw(BOX_VERTEX_COUNT);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, BOX_VERTEX_COUNT);
+		glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
+		it->second.LastFrame = _frame;
+		_counting.Queries++;
+	}
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	RenderState::SetDepthMask(true);
+}
+
+void OcclusionQueries::Reset() {
+	for (auto& pair : _entries) {
+		glDeleteQueries(2, pair.second.Queries);
+	}
+	_entries.clear();
+}
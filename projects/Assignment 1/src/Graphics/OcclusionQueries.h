@@ -0,0 +1,122 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+#include "BoundingVolume.h"
+#include "Shader.h"
+
+/// <summary>
+/// Hardware occlusion queries for a handful of expensive renderers (see RendererComponent::QueryOcclusion), a lighter
+/// alternative to the depth pyramid that needs no read back. Each frame a query draws the renderer's world bounds
+/// against the finished opaque depth, and next frame the renderer's mesh gets drawn inside a conditional render on
+/// that query with GL_QUERY_NO_WAIT. The GPU skips the draw if none of the box passed, and if the query hasn't
+/// finished yet it draws anyway, so the CPU never waits on a result
+///
+/// The boxes are tested after the renderers have drawn, but a box always sits in front of the mesh inside it, so the
+/// mesh's own depth never hides it's box
+///
+/// Usage each frame: BeginFrame, then draw each queried batch between BeginConditional and EndConditional, then
+/// Render the boxes once the opaque scene is done
+/// </summary>
+class OcclusionQueries final
+{
+public:
+	typedef std::shared_ptr<OcclusionQueries> sptr;
+	static inline sptr Create() {
+		return std::make_shared<OcclusionQueries>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	OcclusionQueries(const OcclusionQueries& other) = delete;
+	OcclusionQueries(OcclusionQueries&& other) = delete;
+	OcclusionQueries& operator=(const OcclusionQueries& other) = delete;
+	OcclusionQueries& operator=(OcclusionQueries&& other) = delete;
+
+public:
+	// The key of a batch that isn't drawn conditionally
+	static const uint32_t NONE = UINT32_MAX;
+	// How many frames a renderer can go without a query before it's queries get deleted
+	static const uint32_t RETIRE_FRAMES = 60;
+
+	/// <summary>
+	/// A box to query this frame, the key stays the same for a renderer from one frame to the next (ex: it's entity)
+	/// </summary>
+	struct Box {
+		uint32_t       Key;
+		BoundingVolume Bounds;
+	};
+
+	/// <summary>
+	/// What the queries did last frame
+	/// </summary>
+	struct Stats {
+		// The boxes that got queried
+		uint32_t Queries = 0;
+		// The batches that were drawn inside a conditional render
+		uint32_t ConditionalDraws = 0;
+		// The boxes that were skipped since the camera was inside them, their renderers draw unconditionally
+		uint32_t Skipped = 0;
+		// The renderers with queries alive
+		uint32_t Tracked = 0;
+	};
+
+	/// <summary>
+	/// Compiles the box shader, the queries get created as renderers ask for them
+	/// </summary>
+	OcclusionQueries();
+	~OcclusionQueries();
+
+	/// <summary>
+	/// Returns true if the shader compiled, if not nothing gets queried and everything draws as usual
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Starts a new frame, the queries issued last frame become the ones the draws are conditioned on
+	/// </summary>
+	void BeginFrame();
+	/// <summary>
+	/// Starts a conditional render on the query issued for the key last frame, if there was one
+	/// </summary>
+	/// <param name="key">The renderer's key, as given to Render</param>
+	/// <returns>True if a conditional render was started, and EndConditional needs to be called after the draw</returns>
+	bool BeginConditional(uint32_t key);
+	/// <summary>
+	/// Ends the conditional render started by BeginConditional
+	/// </summary>
+	void EndConditional();
+	/// <summary>
+	/// Draws each box inside a query, depth tested against what's been drawn without writing anything. The frame
+	/// uniforms for the view need to be uploaded. Boxes the camera is inside of get skipped, since their near faces
+	/// would be clipped
+	/// </summary>
+	/// <param name="boxes">The boxes to query</param>
+	/// <param name="cameraPos">The position of the camera in world space</param>
+	void Render(const std::vector<Box>& boxes, const glm::vec3& cameraPos);
+	/// <summary>
+	/// Deletes every query, so nothing gets conditioned on a stale view (ex: when the queries get turned off)
+	/// </summary>
+	void Reset();
+
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	// The queries of one renderer, written to on alternate frames
+	struct Entry {
+		GLuint   Queries[2];
+		// The frame the last query was issued on
+		uint64_t LastFrame;
+	};
+
+	Shader::sptr                           _shader;
+	bool                                   _isReady;
+	// The box has no vertices, but drawing still needs a vertex array bound
+	GLuint                                 _emptyVao;
+	std::unordered_map<uint32_t, Entry>    _entries;
+	uint64_t                               _frame;
+	Stats                                  _stats;
+	Stats                                  _counting;
+};
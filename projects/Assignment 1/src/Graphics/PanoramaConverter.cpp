@@ -0,0 +1,99 @@
+#include "PanoramaConverter.h"
+
+#include <algorithm>
+#include <cmath>
+#include "GpuResources.h"
+#include "Logging.h"
+#include "Texture2D.h"
+#include "Utilities/CpuProfiler.h"
+
+// Must match local_size_x and local_size_y in panorama_to_cube.comp.glsl
+static const uint32_t GROUP_SIZE = 8;
+// The texture and image units the pass reads and writes through
+static const int PANORAMA_UNIT = 0;
+static const int TARGET_IMAGE_UNIT = 0;
+
+PanoramaConverter::sptr PanoramaConverter::_shared = nullptr;
+
+// Compiles one of the variants of panorama_to_cube.comp.glsl
+static Shader::sptr CreatePass(const std::vector<std::string>& defines) {
+	Shader::sptr result = Shader::Create();
+	result->LoadShaderPartFromFile("shaders/panorama_to_cube.comp.glsl", GL_COMPUTE_SHADER, defines);
+	return result;
+}
+
+PanoramaConverter::PanoramaConverter() :
+	_isReady(false)
+{
+	_colorShader = CreatePass({});
+	_sharedExponentShader = CreatePass({ "SHARED_EXPONENT" });
+	_isReady = _colorShader->Link() & _sharedExponentShader->Link();
+	if (!_isReady) {
+		LOG_WARN("Panorama conversion shaders failed to compile, panoramas can't be loaded as cube maps");
+	}
+}
+
+const PanoramaConverter::sptr& PanoramaConverter::Get() {
+	if (_shared == nullptr) {
+		_shared = Create();
+	}
+	return _shared;
+}
+
+bool PanoramaConverter::Convert(const Texture2DData::sptr& panorama, TextureCubeMap& target) {
+	if (panorama == nullptr) {
+		return false;
+	}
+	GPU_RESOURCE_OWNER("PanoramaConverter");
+	// Floats go up as halfs, so the panorama's mips can be generated on the GPU (the cube map's format can't be)
+	Texture2DDescription desc;
+	desc.Format = panorama->GetPixelType() == PixelType::Float ? InternalFormat::RGBA16F : InternalFormat::RGBA8;
+	desc.HorizontalWrap = WrapMode::Repeat;
+	desc.VerticalWrap = WrapMode::ClampToEdge;
+	desc.MinificationFilter = MinFilter::LinearMipLinear;
+	desc.MagnificationFilter = MagFilter::Linear;
+	desc.MaxAnisotropic = 1.0f;
+	desc.GenerateMipMaps = true;
+	Texture2D::sptr source = Texture2D::Create(desc);
+	source->LoadData(panorama);
+	return Convert(*source, panorama->GetWidth(), target);
+}
+
+bool PanoramaConverter::Convert(const ITexture& panorama, uint32_t panoramaWidth, TextureCubeMap& target) {
+	PROFILE_SCOPE("PanoramaConverter::Convert");
+	const bool isSharedExponent = target.GetFormat() == InternalFormat::RGB9_E5;
+	if (!_isReady || (!isSharedExponent && target.GetFormat() != InternalFormat::RGBA8)) {
+		LOG_WARN("Can't convert a panorama into a {} cube map", target.GetFormat());
+		return false;
+	}
+
+	// The view shares the cube map's storage, so writing through it fills the cube map itself
+	const uint32_t levelCount = target.GetLevelCount();
+	GLuint image = target.GetHandle();
+	if (isSharedExponent) {
+		glGenTextures(1, &image);
+		glTextureView(image, GL_TEXTURE_CUBE_MAP, target.GetHandle(), GL_R32UI, 0, levelCount, 0, 6);
+	}
+
+	const Shader::sptr& shader = isSharedExponent ? _sharedExponentShader : _colorShader;
+	shader->Bind();
+	panorama.Bind(PANORAMA_UNIT);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		const uint32_t size = std::max(target.GetSize() >> level, 1u);
+		// Each level reads the panorama's mip whose texels are about the size of it's own, so the smaller levels
+		// average the panorama rather than skipping over it
+		const float lod = std::max(std::log2(panoramaWidth / (4.0f * size)), 0.0f);
+		shader->SetUniform("u_TargetSize"_hs, (int)size);
+		shader->SetUniform("u_SourceLod"_hs, lod);
+		// Binding the level as layered gives the shader all 6 faces
+		glBindImageTexture(TARGET_IMAGE_UNIT, image, level, GL_TRUE, 0, GL_WRITE_ONLY, isSharedExponent ? GL_R32UI : GL_RGBA8);
+		glDispatchCompute((size + GROUP_SIZE - 1) / GROUP_SIZE, (size + GROUP_SIZE - 1) / GROUP_SIZE, 6);
+	}
+
+	// Anything can read the cube map next, including reading it back to the CPU
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	if (isSharedExponent) {
+		glDeleteTextures(1, &image);
+	}
+	return true;
+}
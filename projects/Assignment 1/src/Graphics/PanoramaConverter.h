@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+#include "Shader.h"
+#include "Texture2DData.h"
+#include "TextureCubeMap.h"
+
+/// <summary>
+/// Turns equirectangular panoramas (the single 2:1 image most skies are delivered as) into cube maps on the GPU. The
+/// panorama is uploaded once with it's mips, and a compute pass fills every face of every level of the cube map
+/// straight from it, so there's only one file to open and decode instead of six
+///
+/// Cube maps can be RGBA8, or RGB9_E5 for HDR panoramas. RGB9_E5 can't be written as an image, so it's storage gets
+/// viewed as raw 32 bit texels and the shader packs the shared exponent itself
+/// </summary>
+class PanoramaConverter final
+{
+public:
+	typedef std::shared_ptr<PanoramaConverter> sptr;
+	static inline sptr Create() {
+		return std::make_shared<PanoramaConverter>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	PanoramaConverter(const PanoramaConverter& other) = delete;
+	PanoramaConverter(PanoramaConverter&& other) = delete;
+	PanoramaConverter& operator=(const PanoramaConverter& other) = delete;
+	PanoramaConverter& operator=(PanoramaConverter&& other) = delete;
+
+public:
+	/// <summary>
+	/// Creates the converter, and compiles it's shaders
+	/// </summary>
+	PanoramaConverter();
+	~PanoramaConverter() = default;
+
+	/// <summary>
+	/// Gets the converter that cube maps share, it's created the first time it's needed
+	/// </summary>
+	static const sptr& Get();
+	/// <summary>
+	/// Releases the shared converter, should be called before the OpenGL context is destroyed
+	/// </summary>
+	static void ReleaseAll() { _shared = nullptr; }
+
+	/// <summary>
+	/// Returns true if the conversion shaders compiled
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Gets the face size a cube map needs to keep all of a panorama's detail, a panorama wraps 4 faces around it's width
+	/// </summary>
+	static uint32_t GetFaceSize(uint32_t panoramaWidth) { return panoramaWidth / 4 > 0 ? panoramaWidth / 4 : 1; }
+
+	/// <summary>
+	/// Fills every level of a cube map from a panorama
+	/// </summary>
+	/// <param name="panorama">The panorama to convert, 8 bit or float</param>
+	/// <param name="target">The cube map to fill, must be RGBA8 or RGB9_E5</param>
+	/// <returns>True if the cube map was filled</returns>
+	bool Convert(const Texture2DData::sptr& panorama, TextureCubeMap& target);
+	/// <summary>
+	/// Fills every level of a cube map from a panorama that's already been uploaded, see the overload above
+	/// </summary>
+	/// <param name="panorama">The uploaded panorama, should have a full mip chain</param>
+	/// <param name="panoramaWidth">The width of the panorama's top level, in pixels</param>
+	/// <param name="target">The cube map to fill, must be RGBA8 or RGB9_E5</param>
+	bool Convert(const ITexture& panorama, uint32_t panoramaWidth, TextureCubeMap& target);
+
+protected:
+	Shader::sptr _colorShader;
+	Shader::sptr _sharedExponentShader;
+	bool         _isReady;
+
+	static sptr _shared;
+};
@@ -0,0 +1,54 @@
+#include "PersistentRingBuffer.h"
+
+#include "Logging.h"
+
+PersistentRingBuffer::PersistentRingBuffer(const std::shared_ptr<IBuffer>& buffer, size_t elementSize, uint32_t regionCapacity, uint32_t regionCount) :
+	_buffer(buffer),
+	_data(nullptr),
+	_elementSize(elementSize),
+	_regionCapacity(regionCapacity),
+	_next(0),
+	_fences(regionCount, nullptr)
+{
+	LOG_ASSERT(regionCount > 0, "A ring needs at least one region!");
+	_data = static_cast<uint8_t*>(_buffer->MapPersistent(elementSize, static_cast<size_t>(regionCapacity) * regionCount));
+}
+
+PersistentRingBuffer::~PersistentRingBuffer() {
+	// The driver holds onto the buffer until the GPU is done with it, so the fences can go right away
+	for (GLsync fence : _fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+		}
+	}
+}
+
+PersistentRingBuffer::Region PersistentRingBuffer::Acquire() {
+	const uint32_t index = _next;
+	_next = (_next + 1) % static_cast<uint32_t>(_fences.size());
+
+	// The fence went in after the last commands that read the region, which was a lap of the ring ago, so this
+	// should almost never actually have to wait
+	if (_fences[index] != nullptr) {
+		const GLenum result = glClientWaitSync(_fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+		if (result == GL_WAIT_FAILED) {
+			LOG_WARN("Failed to wait on a ring buffer region, it may be overwritten while it's being read");
+		}
+		glDeleteSync(_fences[index]);
+		_fences[index] = nullptr;
+	}
+
+	Region region;
+	region.First = index * _regionCapacity;
+	region.Data = _data + region.First * _elementSize;
+	region.Index = index;
+	return region;
+}
+
+void PersistentRingBuffer::Release(const Region& region) {
+	LOG_ASSERT(region.Index < _fences.size(), "Ring buffer region out of range!");
+	if (_fences[region.Index] != nullptr) {
+		glDeleteSync(_fences[region.Index]);
+	}
+	_fences[region.Index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glad/glad.h>
+
+#include "IBuffer.h"
+
+/// <summary>
+/// Splits a persistently mapped buffer into a ring of equally sized regions, for data that gets rewritten every frame
+/// (instances, uniforms, streamed vertices) without re-allocating or stalling. A region gets acquired before it's
+/// written, written straight through the mapping from any thread, and released (fenced) once the GPU commands that
+/// read it have been issued. Acquiring only waits on the GPU if it's still reading the region from a lap ago
+/// </summary>
+class PersistentRingBuffer final
+{
+public:
+	typedef std::shared_ptr<PersistentRingBuffer> sptr;
+	static inline sptr Create(const std::shared_ptr<IBuffer>& buffer, size_t elementSize, uint32_t regionCapacity, uint32_t regionCount) {
+		return std::make_shared<PersistentRingBuffer>(buffer, elementSize, regionCapacity, regionCount);
+	}
+	// We'll disallow moving and copying, since we own the fences
+	PersistentRingBuffer(const PersistentRingBuffer& other) = delete;
+	PersistentRingBuffer(PersistentRingBuffer&& other) = delete;
+	PersistentRingBuffer& operator=(const PersistentRingBuffer& other) = delete;
+	PersistentRingBuffer& operator=(PersistentRingBuffer&& other) = delete;
+
+	/// <summary>
+	/// A part of the buffer that can be written to
+	/// </summary>
+	struct Region {
+		// Where the region's first element is mapped
+		void*    Data = nullptr;
+		// The index of the region's first element in the buffer
+		uint32_t First = 0;
+		// Which of the regions this is
+		uint32_t Index = 0;
+	};
+
+	/// <summary>
+	/// Allocates and maps storage for every region in the given buffer
+	/// </summary>
+	/// <param name="buffer">A new buffer to map, it's storage can't have been allocated yet</param>
+	/// <param name="elementSize">The size of a single element, in bytes</param>
+	/// <param name="regionCapacity">The number of elements in each region</param>
+	/// <param name="regionCount">The number of regions, one more than the most that may be in flight at once</param>
+	PersistentRingBuffer(const std::shared_ptr<IBuffer>& buffer, size_t elementSize, uint32_t regionCapacity, uint32_t regionCount);
+	~PersistentRingBuffer();
+
+	/// <summary>
+	/// Takes the next region in the ring for writing, waiting on the GPU if it hasn't finished with it yet
+	/// </summary>
+	Region Acquire();
+	/// <summary>
+	/// Marks a region as being read by the commands that have been issued, so it won't be handed out again until the
+	/// GPU is done with them
+	/// </summary>
+	/// <param name="region">The region, as returned by Acquire</param>
+	void Release(const Region& region);
+
+	/// <summary>
+	/// Gets the buffer the regions are in
+	/// </summary>
+	const std::shared_ptr<IBuffer>& GetBuffer() const { return _buffer; }
+	/// <summary>
+	/// Gets the number of elements each region can hold
+	/// </summary>
+	uint32_t GetRegionCapacity() const { return _regionCapacity; }
+	uint32_t GetRegionCount() const { return static_cast<uint32_t>(_fences.size()); }
+
+protected:
+	std::shared_ptr<IBuffer> _buffer;
+	uint8_t*                 _data;
+	size_t                   _elementSize;
+	uint32_t                 _regionCapacity;
+	uint32_t                 _next;
+	std::vector<GLsync>      _fences;
+};
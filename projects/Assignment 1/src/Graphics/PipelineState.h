@@ -0,0 +1,66 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+
+/// <summary>
+/// Describes the fixed function state that a draw needs (depth, blending, culling and polygon mode), so it can be
+/// attached to a material and applied as a whole with RenderState::ApplyPipeline instead of toggled piece by piece
+///
+/// The defaults are what an opaque, depth tested and back face culled draw wants
+/// </summary>
+struct PipelineState {
+	bool   DepthTest = true;
+	bool   DepthWrite = true;
+	GLenum DepthFunc = GL_LEQUAL;
+	bool   Blend = false;
+	GLenum BlendSource = GL_SRC_ALPHA;
+	GLenum BlendDestination = GL_ONE_MINUS_SRC_ALPHA;
+	// Blended draws that get accumulated by WeightedBlending instead of sorted back to front. The pass sets the blend
+	// functions for it's targets, so the ones above are ignored
+	bool   OrderIndependent = false;
+	bool   Cull = true;
+	GLenum CullFace = GL_BACK;
+	GLenum PolygonMode = GL_FILL;
+
+	/// <summary>
+	/// Gets a state for alpha blended draws, which are depth tested but don't write depth
+	/// </summary>
+	static PipelineState AlphaBlended() {
+		PipelineState result;
+		result.DepthWrite = false;
+		result.Blend = true;
+		return result;
+	}
+
+	/// <summary>
+	/// Gets a state for blended draws that don't need sorting (see WeightedBlending), their shaders need to write the
+	/// accumulation and revealage rather than a color
+	/// </summary>
+	static PipelineState WeightedBlended() {
+		PipelineState result = AlphaBlended();
+		result.OrderIndependent = true;
+		return result;
+	}
+
+	/// <summary>
+	/// Gets a small key for sorting draws by their state. Blended states sort after opaque ones, and the rest groups
+	/// draws that share a state together. Different states can share a key (ex: ones that only differ in their blend
+	/// function), which only costs an extra state change where they end up interleaved
+	/// </summary>
+	uint8_t GetSortKey() const {
+		return static_cast<uint8_t>(
+			(Blend ? 0x80 : 0) |
+			(DepthWrite ? 0 : 0x40) |
+			(DepthTest ? 0 : 0x20) |
+			((DepthFunc & 0x7) << 2) |
+			(Cull ? 0 : 0x2) |
+			(PolygonMode != GL_FILL ? 0x1 : 0));
+	}
+
+	bool operator==(const PipelineState& other) const {
+		return DepthTest == other.DepthTest && DepthWrite == other.DepthWrite && DepthFunc == other.DepthFunc &&
+			Blend == other.Blend && OrderIndependent == other.OrderIndependent && BlendSource == other.BlendSource && BlendDestination == other.BlendDestination &&
+			Cull == other.Cull && CullFace == other.CullFace && PolygonMode == other.PolygonMode;
+	}
+	bool operator!=(const PipelineState& other) const { return !(*this == other); }
+};
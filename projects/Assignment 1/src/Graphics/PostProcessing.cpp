@@ -0,0 +1,261 @@
+#include "PostProcessing.h"
+
+#include <algorithm>
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderState.h"
+#include "RenderStats.h"
+
+// Must match local_size_x and local_size_y in bloom.comp.glsl
+static const int GROUP_SIZE = 8;
+// The image unit the bloom passes write through
+static const int TARGET_IMAGE_UNIT = 0;
+// The FXAA edge detection and subpixel settings, passed to post_fxaa.frag.glsl as specialization constants
+static const float FXAA_EDGE_THRESHOLD_MIN = 0.0312f;
+static const float FXAA_EDGE_THRESHOLD_MAX = 0.125f;
+static const float FXAA_SUBPIXEL_QUALITY = 0.75f;
+
+PostProcessing::PostProcessing() :
+	_isReady(false),
+	_sceneFramebuffer(0),
+	_color(0),
+	_depth(0),
+	_emptyVao(0),
+	_width(0),
+	_height(0),
+	_previousFramebuffer(0),
+	_previousViewport{ 0, 0, 0, 0 }
+{
+	GPU_RESOURCE_OWNER("PostProcessing");
+	const char* bloomPasses[3] = { "PREFILTER", "DOWNSAMPLE", "UPSAMPLE" };
+	Shader::sptr* bloomShaders[3] = { &_prefilterShader, &_downsampleShader, &_upsampleShader };
+	_isReady = true;
+	for (int ix = 0; ix < 3; ix++) {
+		*bloomShaders[ix] = Shader::Create();
+		(*bloomShaders[ix])->LoadShaderPartFromFile("shaders/bloom.comp.glsl", GL_COMPUTE_SHADER, { bloomPasses[ix] });
+		_isReady &= (*bloomShaders[ix])->Link();
+	}
+	_tonemapShader = Shader::Create();
+	_tonemapShader->LoadShaderPartFromFile("shaders/fullscreen.vert.glsl", GL_VERTEX_SHADER);
+	_tonemapShader->LoadShaderPartFromFile("shaders/post_tonemap.frag.glsl", GL_FRAGMENT_SHADER);
+	_isReady &= _tonemapShader->Link();
+	_fxaaShader = Shader::Create();
+	_fxaaShader->LoadSpecialized({
+		{ "shaders/fullscreen.vert.glsl", GL_VERTEX_SHADER, {} },
+		{ "shaders/post_fxaa.frag.glsl", GL_FRAGMENT_SHADER, {
+			ShaderStage::Constant::Float("EDGE_THRESHOLD_MIN", 0, FXAA_EDGE_THRESHOLD_MIN),
+			ShaderStage::Constant::Float("EDGE_THRESHOLD_MAX", 1, FXAA_EDGE_THRESHOLD_MAX),
+			ShaderStage::Constant::Float("SUBPIXEL_QUALITY", 2, FXAA_SUBPIXEL_QUALITY)
+		} }
+	});
+	_isReady &= _fxaaShader->Link();
+	_upscaleShader = Shader::Create();
+	_upscaleShader->LoadShaderPartFromFile("shaders/fullscreen.vert.glsl", GL_VERTEX_SHADER);
+	_upscaleShader->LoadShaderPartFromFile("shaders/post_upscale.frag.glsl", GL_FRAGMENT_SHADER);
+	_isReady &= _upscaleShader->Link();
+	if (!_isReady) {
+		LOG_WARN("Post processing shaders failed to compile, the scene will be drawn straight to the screen");
+	}
+
+	_pool = RenderTargetPool::Create();
+	_graph = RenderGraph::Create(_pool);
+	glCreateFramebuffers(1, &_sceneFramebuffer);
+	glCreateVertexArrays(1, &_emptyVao);
+}
+
+PostProcessing::~PostProcessing() {
+	_DeleteTargets();
+	glDeleteFramebuffers(1, &_sceneFramebuffer);
+	RenderState::OnVertexArrayDeleted(_emptyVao);
+	glDeleteVertexArrays(1, &_emptyVao);
+}
+
+void PostProcessing::_DeleteTargets() {
+	const GLuint textures[2] = { _color, _depth };
+	for (GLuint texture : textures) {
+		if (texture != 0) {
+			RenderState::OnTextureDeleted(texture);
+			GpuResources::RemoveRaw(GL_TEXTURE, texture);
+		}
+	}
+	glDeleteTextures(2, textures);
+	_color = _depth = 0;
+}
+
+void PostProcessing::BeginScene(int width, int height, const glm::vec4& clearColor) {
+	GPU_RESOURCE_OWNER("PostProcessing");
+	width = std::max(width, 1);
+	height = std::max(height, 1);
+	if (width != _width || height != _height) {
+		_DeleteTargets();
+		_width = width;
+		_height = height;
+		glCreateTextures(GL_TEXTURE_2D, 1, &_color);
+		glTextureStorage2D(_color, 1, GL_RGBA16F, width, height);
+		// The bloom prefilter reads the scene with a bilinear filter
+		glTextureParameteri(_color, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(_color, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(_color, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(_color, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glCreateTextures(GL_TEXTURE_2D, 1, &_depth);
+		glTextureStorage2D(_depth, 1, GL_DEPTH_COMPONENT32F, width, height);
+		GpuResources::AddRaw(GL_TEXTURE, _color, static_cast<size_t>(width) * height * 8, "HDR Scene Color");
+		GpuResources::AddRaw(GL_TEXTURE, _depth, static_cast<size_t>(width) * height * 4, "HDR Scene Depth");
+		glNamedFramebufferTexture(_sceneFramebuffer, GL_COLOR_ATTACHMENT0, _color, 0);
+		glNamedFramebufferTexture(_sceneFramebuffer, GL_DEPTH_ATTACHMENT, _depth, 0);
+		if (glCheckNamedFramebufferStatus(_sceneFramebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR("HDR scene target is incomplete at {}x{}", width, height);
+		}
+	}
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, _previousViewport);
+	glBindFramebuffer(GL_FRAMEBUFFER, _sceneFramebuffer);
+	glViewport(0, 0, width, height);
+	const float clearDepth = 1.0f;
+	RenderState::SetDepthMask(true);
+	glClearNamedFramebufferfv(_sceneFramebuffer, GL_COLOR, 0, &clearColor[0]);
+	glClearNamedFramebufferfv(_sceneFramebuffer, GL_DEPTH, 0, &clearDepth);
+}
+
+void PostProcessing::EndScene() {
+	const RenderGraph::Handle scene = _graph->ImportTexture("Scene", _color);
+	const RenderGraph::Handle screen = _graph->ImportFramebuffer("Screen", _previousFramebuffer);
+	const RenderGraph::TextureDesc ldr = { _width, _height, InternalFormat::RGBA8 };
+
+	RenderGraph::Handle bloom = RenderGraph::INVALID;
+	if (Bloom && BloomLevels > 0) {
+		bloom = _AddBloom(scene);
+	}
+
+	// Every pass but the last draws into a target that only lives until the next pass has read it
+	const bool isScaled = _width != _previousViewport[2] || _height != _previousViewport[3];
+	RenderGraph::Handle image = RenderGraph::INVALID;
+	_graph->AddPass("Tonemap", [&](RenderGraph::Builder& builder) -> RenderGraph::ExecuteFunc {
+		builder.Read(scene);
+		if (bloom != RenderGraph::INVALID) {
+			builder.Read(bloom);
+		}
+		const RenderGraph::Handle output = builder.Write((Fxaa || isScaled) ? builder.Create("Tonemapped", ldr) : screen);
+		image = output;
+		return [this, scene, bloom, output](RenderGraph& graph) {
+			graph.BindOutput(output);
+			_tonemapShader->Bind();
+			_tonemapShader->SetUniform("u_Exposure"_hs, Exposure);
+			_tonemapShader->SetUniform("u_BloomIntensity"_hs, bloom != RenderGraph::INVALID ? BloomIntensity : 0.0f);
+			_tonemapShader->SetUniform("u_Tonemapper"_hs, (int)Tonemap);
+			// With bloom off, the unit still needs a 2D texture bound
+			const GLuint textures[2] = { graph.GetTexture(scene), graph.GetTexture(bloom != RenderGraph::INVALID ? bloom : scene) };
+			const GLuint samplers[2] = { 0, 0 };
+			RenderState::BindTextureUnits(SOURCE_UNIT, 2, textures);
+			RenderState::BindSamplers(SOURCE_UNIT, 2, samplers);
+			_DrawFullscreen();
+		};
+	});
+	if (Fxaa) {
+		_graph->AddPass("FXAA", [&](RenderGraph::Builder& builder) -> RenderGraph::ExecuteFunc {
+			const RenderGraph::Handle input = builder.Read(image);
+			const RenderGraph::Handle output = builder.Write(isScaled ? builder.Create("Antialiased", ldr) : screen);
+			image = output;
+			return [this, input, output](RenderGraph& graph) {
+				graph.BindOutput(output);
+				_fxaaShader->Bind();
+				RenderState::BindTextureUnit(SOURCE_UNIT, graph.GetTexture(input));
+				RenderState::BindSampler(SOURCE_UNIT, 0);
+				_DrawFullscreen();
+			};
+		});
+	}
+	if (isScaled) {
+		_graph->AddPass("Upscale", [&](RenderGraph::Builder& builder) -> RenderGraph::ExecuteFunc {
+			const RenderGraph::Handle input = builder.Read(image);
+			const RenderGraph::Handle output = builder.Write(screen);
+			return [this, input, output](RenderGraph& graph) {
+				// The upscale is the only pass that draws at the full size of the screen
+				glViewport(_previousViewport[0], _previousViewport[1], _previousViewport[2], _previousViewport[3]);
+				graph.BindOutput(output);
+				_upscaleShader->Bind();
+				_upscaleShader->SetUniform("u_OutputRect"_hs, glm::vec4(_previousViewport[0], _previousViewport[1], _previousViewport[2], _previousViewport[3]));
+				_upscaleShader->SetUniform("u_Sharpness"_hs, Sharpness);
+				RenderState::BindTextureUnit(SOURCE_UNIT, graph.GetTexture(input));
+				RenderState::BindSampler(SOURCE_UNIT, 0);
+				_DrawFullscreen();
+			};
+		});
+	}
+
+	// Everything from here on covers the whole screen, so there's nothing to test against
+	RenderState::SetEnabled(GL_DEPTH_TEST, false);
+	RenderState::SetDepthMask(false);
+	RenderState::BindVertexArray(_emptyVao);
+	_graph->Execute();
+	// The rest of the frame (ex: the UI) draws at the full size of the screen, into whatever was bound before
+	glBindFramebuffer(GL_FRAMEBUFFER, _previousFramebuffer);
+	glViewport(_previousViewport[0], _previousViewport[1], _previousViewport[2], _previousViewport[3]);
+	RenderState::SetEnabled(GL_DEPTH_TEST, true);
+	RenderState::SetDepthMask(true);
+	_pool->EndFrame();
+}
+
+RenderGraph::Handle PostProcessing::_AddBloom(RenderGraph::Handle scene) {
+	const int levelCount = std::min(BloomLevels, MAX_BLOOM_LEVELS);
+	RenderGraph::Handle levels[MAX_BLOOM_LEVELS];
+	int widths[MAX_BLOOM_LEVELS];
+	int heights[MAX_BLOOM_LEVELS];
+	for (int ix = 0; ix < levelCount; ix++) {
+		widths[ix] = std::max(_width >> (ix + 1), 1);
+		heights[ix] = std::max(_height >> (ix + 1), 1);
+	}
+
+	// Going down, the first pass also drops everything under the threshold
+	_graph->AddPass("BloomPrefilter", [&](RenderGraph::Builder& builder) -> RenderGraph::ExecuteFunc {
+		const RenderGraph::Handle source = builder.Read(scene);
+		const RenderGraph::Handle target = builder.Write(builder.Create("Bloom", { widths[0], heights[0], InternalFormat::RGBA16F }));
+		levels[0] = target;
+		return [this, source, target, width = widths[0], height = heights[0]](RenderGraph& graph) {
+			const float knee = std::max(BloomKnee, 0.0001f);
+			_prefilterShader->SetUniform("u_Threshold"_hs, glm::vec4(BloomThreshold, BloomThreshold - knee, knee * 2.0f, 0.25f / knee));
+			_DispatchBloom(_prefilterShader, graph.GetTexture(source), graph.GetTexture(target), width, height);
+		};
+	});
+	for (int ix = 1; ix < levelCount; ix++) {
+		_graph->AddPass("BloomDownsample", [&](RenderGraph::Builder& builder) -> RenderGraph::ExecuteFunc {
+			const RenderGraph::Handle source = builder.Read(levels[ix - 1]);
+			const RenderGraph::Handle target = builder.Write(builder.Create("Bloom", { widths[ix], heights[ix], InternalFormat::RGBA16F }));
+			levels[ix] = target;
+			return [this, source, target, width = widths[ix], height = heights[ix]](RenderGraph& graph) {
+				_DispatchBloom(_downsampleShader, graph.GetTexture(source), graph.GetTexture(target), width, height);
+			};
+		});
+	}
+	// Coming back up, each level gets the blurred one below it added on. Once a level has been added to the one above
+	// it, the graph hands it back to the pool for anything else in the frame to use
+	for (int ix = levelCount - 1; ix > 0; ix--) {
+		_graph->AddPass("BloomUpsample", [&](RenderGraph::Builder& builder) -> RenderGraph::ExecuteFunc {
+			const RenderGraph::Handle source = builder.Read(levels[ix]);
+			builder.Read(levels[ix - 1]);
+			const RenderGraph::Handle target = builder.Write(levels[ix - 1]);
+			levels[ix - 1] = target;
+			return [this, source, target, width = widths[ix - 1], height = heights[ix - 1]](RenderGraph& graph) {
+				_DispatchBloom(_upsampleShader, graph.GetTexture(source), graph.GetTexture(target), width, height);
+			};
+		});
+	}
+	return levels[0];
+}
+
+void PostProcessing::_DispatchBloom(const Shader::sptr& shader, GLuint source, GLuint target, int width, int height) {
+	shader->Bind();
+	RenderState::BindTextureUnit(SOURCE_UNIT, source);
+	RenderState::BindSampler(SOURCE_UNIT, 0);
+	glBindImageTexture(TARGET_IMAGE_UNIT, target, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+	glDispatchCompute((width + GROUP_SIZE - 1) / GROUP_SIZE, (height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+	// The next pass (or the tonemap) reads what this one wrote
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void PostProcessing::_DrawFullscreen() {
+	RenderStats::CountDraw(3);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <GLM/glm.hpp>
+
+#include "RenderGraph.h"
+#include "RenderTargetPool.h"
+#include "Shader.h"
+
+/// <summary>
+/// The curves we can bring the HDR scene down to the screen's range with. Must match post_tonemap.frag.glsl
+/// </summary>
+enum class Tonemapper {
+	// Just clamps, so anything brighter than 1 is lost
+	None     = 0,
+	Reinhard = 1,
+	Aces     = 2
+};
+
+/// <summary>
+/// Has the scene drawn into an RGBA16F target instead of the screen, then runs it through a chain of effects on the
+/// way to the screen:
+///
+///     bloom    - compute passes down and back up a chain of half, quarter, ... size targets
+///     tonemap  - adds the bloom, applies the exposure and tonemapper
+///     FXAA     - smooths out the edges, after tonemapping since it works on what the screen shows
+///     upscale  - when the scene was drawn smaller than the screen (see DynamicResolution), stretches and sharpens it
+///
+/// Everything up to the upscale runs at the resolution the scene was drawn at, so it gets cheaper along with it.
+///
+/// Each of these is a pass in a RenderGraph, which skips what isn't needed and works out how long the bloom chain and
+/// the targets between the full screen passes need to live. Those come out of a RenderTargetPool and get handed back as
+/// soon as they've been read, so later passes can reuse them
+///
+/// Usage each frame: BeginScene, draw the scene (including the sky), then EndScene before drawing the UI
+/// </summary>
+class PostProcessing final
+{
+public:
+	typedef std::shared_ptr<PostProcessing> sptr;
+	static inline sptr Create() {
+		return std::make_shared<PostProcessing>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	PostProcessing(const PostProcessing& other) = delete;
+	PostProcessing(PostProcessing&& other) = delete;
+	PostProcessing& operator=(const PostProcessing& other) = delete;
+	PostProcessing& operator=(PostProcessing&& other) = delete;
+
+public:
+	// The most levels the bloom chain can have, the first is half the size of the screen
+	static const int MAX_BLOOM_LEVELS = 8;
+	// The texture units the passes read from, they run after the scene so they can use any of them
+	static const int SOURCE_UNIT = 0;
+	static const int BLOOM_UNIT = 1;
+
+	bool       Bloom          = true;
+	// How bright a pixel needs to be to bloom, pixels within the knee below it bloom a little
+	float      BloomThreshold = 1.0f;
+	float      BloomKnee      = 0.5f;
+	float      BloomIntensity = 0.1f;
+	// How many levels the bloom chain goes down, more levels spread the glow further
+	int        BloomLevels    = 6;
+	Tonemapper Tonemap        = Tonemapper::Aces;
+	float      Exposure       = 1.0f;
+	bool       Fxaa           = true;
+	// How much the upscale sharpens, 0 is the lightest and 1 the strongest
+	float      Sharpness      = 0.5f;
+
+	/// <summary>
+	/// Creates the framebuffer and compiles the shaders, the scene targets get created the first time BeginScene
+	/// knows how big they need to be
+	/// </summary>
+	PostProcessing();
+	~PostProcessing();
+
+	/// <summary>
+	/// Returns true if all of the shaders compiled, if not the scene gets drawn straight to the screen
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Binds and clears the HDR scene target, resizing it first if the size has changed. The viewport gets set to the
+	/// size of the target until EndScene
+	/// </summary>
+	/// <param name="width">The width to draw the scene at, in pixels</param>
+	/// <param name="height">The height to draw the scene at, in pixels</param>
+	/// <param name="clearColor">The color to clear the scene to</param>
+	void BeginScene(int width, int height, const glm::vec4& clearColor);
+	/// <summary>
+	/// Runs the effects over the scene, and draws the result into whatever was bound when BeginScene was called,
+	/// stretched over the viewport that was set then
+	/// </summary>
+	void EndScene();
+
+	/// <summary>
+	/// Gets the scene's depth target, which holds the whole scene's depth from the end of the sky until the next
+	/// BeginScene. 0 until the first BeginScene
+	/// </summary>
+	GLuint GetDepth() const { return _depth; }
+	/// <summary>
+	/// Gets the size the scene targets were last created at, in pixels
+	/// </summary>
+	int GetWidth() const { return _width; }
+	int GetHeight() const { return _height; }
+	/// <summary>
+	/// Gets the pool that the transient targets come from
+	/// </summary>
+	const RenderTargetPool::sptr& GetPool() const { return _pool; }
+	/// <summary>
+	/// Gets the graph that the effects are run through
+	/// </summary>
+	const RenderGraph::sptr& GetGraph() const { return _graph; }
+	/// <summary>
+	/// Gets the number of bytes the scene targets take up per pixel, not counting the transient targets
+	/// </summary>
+	static uint32_t GetBytesPerPixel() { return 8 + 4; }
+
+protected:
+	Shader::sptr           _prefilterShader;
+	Shader::sptr           _downsampleShader;
+	Shader::sptr           _upsampleShader;
+	Shader::sptr           _tonemapShader;
+	Shader::sptr           _fxaaShader;
+	Shader::sptr           _upscaleShader;
+	bool                   _isReady;
+	RenderTargetPool::sptr _pool;
+	RenderGraph::sptr      _graph;
+
+	GLuint _sceneFramebuffer;
+	GLuint _color;
+	GLuint _depth;
+	// The full screen passes have no vertices, but drawing still needs a vertex array bound
+	GLuint _emptyVao;
+	int    _width;
+	int    _height;
+	GLint  _previousFramebuffer;
+	GLint  _previousViewport[4];
+
+	// Adds the passes for the bloom chain over the scene, returning the half size target that holds the result
+	RenderGraph::Handle _AddBloom(RenderGraph::Handle scene);
+	// Runs one of the bloom passes, reading from source and writing to a target of the given size
+	void _DispatchBloom(const Shader::sptr& shader, GLuint source, GLuint target, int width, int height);
+	// Draws a full screen triangle with the bound shader
+	void _DrawFullscreen();
+	// Deletes the scene targets, if they exist
+	void _DeleteTargets();
+};
@@ -0,0 +1,280 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+#include "GpuProfiler.h"
+#include "Logging.h"
+
+RenderGraph::Handle RenderGraph::Builder::Create(const std::string& name, const TextureDesc& desc) {
+	Resource resource;
+	resource.Name = name;
+	resource.Desc = desc;
+	resource.IsImported = false;
+	resource.IsFramebuffer = false;
+	resource.Object = 0;
+	return _graph._AddResource(resource);
+}
+
+RenderGraph::Handle RenderGraph::Builder::Read(Handle resource) {
+	LOG_ASSERT(resource >= 0 && resource < static_cast<int>(_graph._versions.size()), "Reading a resource that isn't in the graph!");
+	_graph._passes[_pass].Reads.push_back(resource);
+	return resource;
+}
+
+RenderGraph::Handle RenderGraph::Builder::Write(Handle resource) {
+	LOG_ASSERT(resource >= 0 && resource < static_cast<int>(_graph._versions.size()), "Writing a resource that isn't in the graph!");
+	Version version;
+	version.Resource = _graph._versions[resource].Resource;
+	version.Writer = _pass;
+	version.Previous = resource;
+	_graph._versions.push_back(version);
+	const Handle result = static_cast<Handle>(_graph._versions.size() - 1);
+	_graph._passes[_pass].Writes.push_back(result);
+	return result;
+}
+
+void RenderGraph::Builder::SetSideEffect() {
+	_graph._passes[_pass].HasSideEffect = true;
+}
+
+RenderGraph::RenderGraph(const RenderTargetPool::sptr& pool) :
+	_pool(pool)
+{ }
+
+RenderGraph::~RenderGraph() {
+	for (const auto& framebuffer : _framebuffers) {
+		glDeleteFramebuffers(1, &framebuffer.second.Handle);
+	}
+}
+
+RenderGraph::Handle RenderGraph::_AddResource(const Resource& resource) {
+	_resources.push_back(resource);
+	Version version;
+	version.Resource = static_cast<int>(_resources.size() - 1);
+	version.Writer = -1;
+	version.Previous = -1;
+	_versions.push_back(version);
+	return static_cast<Handle>(_versions.size() - 1);
+}
+
+RenderGraph::Handle RenderGraph::ImportTexture(const std::string& name, GLuint texture) {
+	Resource resource;
+	resource.Name = name;
+	resource.Desc = { 0, 0, InternalFormat::Unknown };
+	resource.IsImported = true;
+	resource.IsFramebuffer = false;
+	resource.Object = texture;
+	return _AddResource(resource);
+}
+
+RenderGraph::Handle RenderGraph::ImportFramebuffer(const std::string& name, GLuint framebuffer) {
+	Resource resource;
+	resource.Name = name;
+	resource.Desc = { 0, 0, InternalFormat::Unknown };
+	resource.IsImported = true;
+	resource.IsFramebuffer = true;
+	resource.Object = framebuffer;
+	return _AddResource(resource);
+}
+
+void RenderGraph::AddPass(const char* name, const SetupFunc& setup) {
+	Pass pass;
+	pass.Name = name;
+	pass.HasSideEffect = false;
+	pass.IsLive = false;
+	_passes.push_back(pass);
+	const int index = static_cast<int>(_passes.size() - 1);
+	Builder builder(*this, index);
+	_passes[index].Execute = setup(builder);
+}
+
+void RenderGraph::_Cull() {
+	// Anything written outside of the graph is what the frame is for, everything else only matters if it leads there
+	std::vector<int> stack;
+	for (size_t ix = 0; ix < _passes.size(); ix++) {
+		Pass& pass = _passes[ix];
+		pass.IsLive = pass.HasSideEffect;
+		for (Handle write : pass.Writes) {
+			pass.IsLive |= _resources[_versions[write].Resource].IsImported;
+		}
+		if (pass.IsLive) {
+			stack.push_back(static_cast<int>(ix));
+		}
+	}
+	while (!stack.empty()) {
+		const Pass& pass = _passes[stack.back()];
+		stack.pop_back();
+		for (Handle read : pass.Reads) {
+			const int writer = _versions[read].Writer;
+			if (writer != -1 && !_passes[writer].IsLive) {
+				_passes[writer].IsLive = true;
+				stack.push_back(writer);
+			}
+		}
+	}
+}
+
+std::vector<int> RenderGraph::_Sort() const {
+	// Who reads each version, so that overwriting it can wait for them
+	std::vector<std::vector<int>> readers(_versions.size());
+	for (size_t ix = 0; ix < _passes.size(); ix++) {
+		if (_passes[ix].IsLive) {
+			for (Handle read : _passes[ix].Reads) {
+				readers[read].push_back(static_cast<int>(ix));
+			}
+		}
+	}
+
+	// Each pass waits on the writers of what it reads, and on the writers and readers of what it overwrites
+	std::vector<std::vector<int>> dependents(_passes.size());
+	std::vector<int> waiting(_passes.size(), 0);
+	auto addEdge = [&](int from, int to) {
+		if (from != -1 && from != to && _passes[from].IsLive) {
+			dependents[from].push_back(to);
+			waiting[to]++;
+		}
+	};
+	for (size_t ix = 0; ix < _passes.size(); ix++) {
+		const Pass& pass = _passes[ix];
+		if (!pass.IsLive) {
+			continue;
+		}
+		const int to = static_cast<int>(ix);
+		for (Handle read : pass.Reads) {
+			addEdge(_versions[read].Writer, to);
+		}
+		for (Handle write : pass.Writes) {
+			const Handle previous = _versions[write].Previous;
+			addEdge(_versions[previous].Writer, to);
+			for (int reader : readers[previous]) {
+				addEdge(reader, to);
+			}
+		}
+	}
+
+	// Of the passes that are ready, the one that was added first goes next, so independent passes keep their order
+	std::vector<int> order;
+	std::vector<int> ready;
+	for (size_t ix = 0; ix < _passes.size(); ix++) {
+		if (_passes[ix].IsLive && waiting[ix] == 0) {
+			ready.push_back(static_cast<int>(ix));
+		}
+	}
+	while (!ready.empty()) {
+		auto next = std::min_element(ready.begin(), ready.end());
+		const int pass = *next;
+		ready.erase(next);
+		order.push_back(pass);
+		for (int dependent : dependents[pass]) {
+			if (--waiting[dependent] == 0) {
+				ready.push_back(dependent);
+			}
+		}
+	}
+
+	const size_t liveCount = std::count_if(_passes.begin(), _passes.end(), [](const Pass& pass) { return pass.IsLive; });
+	if (order.size() != liveCount) {
+		LOG_ERROR("Render graph passes depend on each other in a loop, running them in the order they were added");
+		order.clear();
+		for (size_t ix = 0; ix < _passes.size(); ix++) {
+			if (_passes[ix].IsLive) {
+				order.push_back(static_cast<int>(ix));
+			}
+		}
+	}
+	return order;
+}
+
+void RenderGraph::Execute() {
+	_Cull();
+	const std::vector<int> order = _Sort();
+
+	_stats = Stats();
+	_stats.Passes = static_cast<uint32_t>(order.size());
+	_stats.CulledPasses = static_cast<uint32_t>(_passes.size() - order.size());
+
+	// Work out how long each resource needs to live for, in terms of where the passes that use it fall in the order
+	for (Resource& resource : _resources) {
+		resource.FirstUse = -1;
+		resource.LastUse = -1;
+	}
+	for (size_t step = 0; step < order.size(); step++) {
+		const Pass& pass = _passes[order[step]];
+		for (const std::vector<Handle>* handles : { &pass.Reads, &pass.Writes }) {
+			for (Handle handle : *handles) {
+				Resource& resource = _resources[_versions[handle].Resource];
+				if (resource.FirstUse == -1) {
+					resource.FirstUse = static_cast<int>(step);
+				}
+				resource.LastUse = static_cast<int>(step);
+			}
+		}
+	}
+
+	uint32_t alive = 0;
+	for (size_t step = 0; step < order.size(); step++) {
+		for (Resource& resource : _resources) {
+			if (!resource.IsImported && resource.FirstUse == static_cast<int>(step)) {
+				resource.Object = _pool->Acquire(resource.Desc.Width, resource.Desc.Height, resource.Desc.Format);
+				_stats.Transients++;
+				_stats.PeakTransients = std::max(_stats.PeakTransients, ++alive);
+			}
+		}
+		Pass& pass = _passes[order[step]];
+		{
+			GPU_PROFILE_SCOPE(pass.Name);
+			pass.Execute(*this);
+		}
+		// Whatever this pass was the last to use is free for the passes after it
+		for (Resource& resource : _resources) {
+			if (!resource.IsImported && resource.LastUse == static_cast<int>(step)) {
+				_pool->Release(resource.Object);
+				resource.Object = 0;
+				alive--;
+			}
+		}
+	}
+
+	_passes.clear();
+	_versions.clear();
+	_resources.clear();
+	_TrimFramebuffers();
+	_stats.Framebuffers = static_cast<uint32_t>(_framebuffers.size());
+}
+
+GLuint RenderGraph::GetTexture(Handle resource) const {
+	const Resource& result = _resources[_versions[resource].Resource];
+	LOG_ASSERT(!result.IsFramebuffer, "Render graph resource \"{}\" is a framebuffer, not a texture!", result.Name);
+	return result.Object;
+}
+
+void RenderGraph::BindOutput(Handle resource) {
+	const Resource& output = _resources[_versions[resource].Resource];
+	if (output.IsFramebuffer) {
+		glBindFramebuffer(GL_FRAMEBUFFER, output.Object);
+		return;
+	}
+	auto it = _framebuffers.find(output.Object);
+	if (it == _framebuffers.end()) {
+		Framebuffer framebuffer;
+		glCreateFramebuffers(1, &framebuffer.Handle);
+		const GLenum attachment =
+			output.Desc.Format == InternalFormat::Depth ? GL_DEPTH_ATTACHMENT :
+			output.Desc.Format == InternalFormat::DepthStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_COLOR_ATTACHMENT0;
+		glNamedFramebufferTexture(framebuffer.Handle, attachment, output.Object, 0);
+		it = _framebuffers.emplace(output.Object, framebuffer).first;
+	}
+	it->second.IdleFrames = 0;
+	glBindFramebuffer(GL_FRAMEBUFFER, it->second.Handle);
+}
+
+void RenderGraph::_TrimFramebuffers() {
+	for (auto it = _framebuffers.begin(); it != _framebuffers.end();) {
+		if (++it->second.IdleFrames > MAX_IDLE_FRAMES) {
+			glDeleteFramebuffers(1, &it->second.Handle);
+			it = _framebuffers.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
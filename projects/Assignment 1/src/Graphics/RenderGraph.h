@@ -0,0 +1,198 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+#include "RenderTargetPool.h"
+#include "TextureEnums.h"
+
+/// <summary>
+/// Runs a frame's passes from what they say they read and write, instead of in a fixed order. Each frame the passes get
+/// added again, then Execute works out an order that respects their dependencies, skips any pass whose output nothing
+/// ends up using, and runs the rest
+///
+/// Transient textures only exist between the first and last pass that use them. They come out of a RenderTargetPool
+/// as the first pass that touches them starts and go back as soon as the last one finishes, so resources whose
+/// lifetimes don't overlap share the same memory. Textures and framebuffers that live outside of the graph (ex: the
+/// scene target or the screen) can be imported, and passes that write to them are never skipped
+///
+/// Writing to a resource makes a new version of it, so a pass that reads the resource only waits on the write it was
+/// given the handle for, and a pass that overwrites it waits for everything reading the version before
+/// </summary>
+class RenderGraph final
+{
+public:
+	typedef std::shared_ptr<RenderGraph> sptr;
+	static inline sptr Create(const RenderTargetPool::sptr& pool) {
+		return std::make_shared<RenderGraph>(pool);
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	RenderGraph(const RenderGraph& other) = delete;
+	RenderGraph(RenderGraph&& other) = delete;
+	RenderGraph& operator=(const RenderGraph& other) = delete;
+	RenderGraph& operator=(RenderGraph&& other) = delete;
+
+public:
+	/// <summary>
+	/// Refers to a single version of a resource in the graph, only valid until the end of the frame's Execute
+	/// </summary>
+	typedef int Handle;
+	static const Handle INVALID = -1;
+
+	// How many frames a cached framebuffer can go without being bound before it gets deleted
+	static const uint32_t MAX_IDLE_FRAMES = 3;
+
+	/// <summary>
+	/// The size and format of a transient texture
+	/// </summary>
+	struct TextureDesc {
+		int            Width;
+		int            Height;
+		InternalFormat Format;
+	};
+
+	/// <summary>
+	/// What happened the last time the graph was executed
+	/// </summary>
+	struct Stats {
+		uint32_t Passes = 0;
+		uint32_t CulledPasses = 0;
+		uint32_t Transients = 0;
+		// The most transient textures that were alive at the same time
+		uint32_t PeakTransients = 0;
+		uint32_t Framebuffers = 0;
+	};
+
+	/// <summary>
+	/// Handed to a pass's setup, to declare the resources it makes, reads and writes
+	/// </summary>
+	class Builder final {
+	public:
+		/// <summary>
+		/// Declares a transient texture, which gets allocated before the first pass that writes it
+		/// </summary>
+		Handle Create(const std::string& name, const TextureDesc& desc);
+		/// <summary>
+		/// Marks a resource as read by this pass, which then runs after the pass that wrote that version of it
+		/// </summary>
+		Handle Read(Handle resource);
+		/// <summary>
+		/// Marks a resource as written by this pass
+		/// </summary>
+		/// <returns>The new version of the resource, passes after this one read and write that instead</returns>
+		Handle Write(Handle resource);
+		/// <summary>
+		/// Keeps this pass from being skipped even if nothing reads what it writes (ex: it reads back to the CPU)
+		/// </summary>
+		void SetSideEffect();
+
+	private:
+		friend class RenderGraph;
+		Builder(RenderGraph& graph, int pass) : _graph(graph), _pass(pass) {}
+		RenderGraph& _graph;
+		int          _pass;
+	};
+
+	typedef std::function<void(RenderGraph&)>    ExecuteFunc;
+	typedef std::function<ExecuteFunc(Builder&)> SetupFunc;
+
+	RenderGraph(const RenderTargetPool::sptr& pool);
+	~RenderGraph();
+
+	/// <summary>
+	/// Brings a texture that's owned by something else into this frame's graph
+	/// </summary>
+	Handle ImportTexture(const std::string& name, GLuint texture);
+	/// <summary>
+	/// Brings a framebuffer that's owned by something else (ex: 0, for the screen) into this frame's graph, so passes
+	/// can draw into it
+	/// </summary>
+	Handle ImportFramebuffer(const std::string& name, GLuint framebuffer);
+
+	/// <summary>
+	/// Adds a pass to this frame. The setup runs straight away to declare the pass's resources, and returns the function
+	/// that issues the pass's GL calls. That runs later during Execute if the pass is needed, so it should capture the
+	/// handles it was given by value
+	/// </summary>
+	/// <param name="name">The name of the pass, also used as it's GPU profiler zone so it needs to outlive the frame's
+	/// results (ex: a string literal)</param>
+	/// <param name="setup">Declares what the pass reads and writes, returning a function that can look the resources up
+	/// with GetTexture and BindOutput</param>
+	void AddPass(const char* name, const SetupFunc& setup);
+
+	/// <summary>
+	/// Orders, culls and runs this frame's passes, then clears them out so the next frame can add it's own
+	/// </summary>
+	void Execute();
+
+	/// <summary>
+	/// Gets the texture behind a resource, only valid while one of the passes that uses it is executing
+	/// </summary>
+	GLuint GetTexture(Handle resource) const;
+	/// <summary>
+	/// Binds a framebuffer that draws into a resource. Imported framebuffers get bound as they are, textures get
+	/// attached to a framebuffer that's cached for as long as the texture keeps getting drawn into
+	/// </summary>
+	void BindOutput(Handle resource);
+
+	/// <summary>
+	/// Gets what happened the last time Execute was called
+	/// </summary>
+	const Stats& GetStats() const { return _stats; }
+
+private:
+	// A texture or framebuffer, shared by all of the versions of it
+	struct Resource {
+		std::string Name;
+		TextureDesc Desc;
+		bool        IsImported;
+		bool        IsFramebuffer;
+		// The texture or framebuffer handle, transients only have one while they're alive
+		GLuint      Object;
+		// The first and last passes (in execution order) that touch the resource
+		int         FirstUse;
+		int         LastUse;
+	};
+	// A single version of a resource
+	struct Version {
+		int Resource;
+		// The pass that wrote this version, or -1 if it's the resource's initial contents
+		int Writer;
+		// The version this one was written over, or -1 for the first version
+		int Previous;
+	};
+	struct Pass {
+		const char*         Name;
+		ExecuteFunc         Execute;
+		std::vector<Handle> Reads;
+		std::vector<Handle> Writes;
+		bool                HasSideEffect;
+		bool                IsLive;
+	};
+	struct Framebuffer {
+		GLuint   Handle;
+		uint32_t IdleFrames;
+	};
+
+	RenderTargetPool::sptr _pool;
+	std::vector<Resource>  _resources;
+	std::vector<Version>   _versions;
+	std::vector<Pass>      _passes;
+	// Framebuffers for drawing into textures, by the texture they draw into. These go idle no later than the pooled
+	// textures they draw into, so one is always trimmed before it's texture's handle can be deleted and re-used
+	std::map<GLuint, Framebuffer> _framebuffers;
+	Stats _stats;
+
+	Handle _AddResource(const Resource& resource);
+	// Marks the passes that something outside of the graph depends on, and everything they depend on
+	void _Cull();
+	// Sorts the live passes so that each runs after everything it depends on, falling back to the order they were
+	// added in if the dependencies loop
+	std::vector<int> _Sort() const;
+	// Deletes the framebuffers of textures that haven't been drawn into in a while
+	void _TrimFramebuffers();
+};
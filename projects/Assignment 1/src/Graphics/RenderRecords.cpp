@@ -0,0 +1,50 @@
+#include "RenderRecords.h"
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "Utilities/CpuProfiler.h"
+
+RenderRecords::RenderRecords() :
+	_capacity(0),
+	_applied(0),
+	_isStale(false),
+	_stats()
+{
+	GPU_RESOURCE_OWNER("RenderRecords");
+	_buffer = VertexBuffer::Create(GL_DYNAMIC_DRAW);
+	_buffer->SetDebugName("RenderRecords");
+}
+
+void RenderRecords::Apply(const RenderRecordPatch& patch) {
+	_stats = Stats();
+	if (patch.Sequence == 0) {
+		return;
+	}
+	PROFILE_SCOPE("RenderRecords");
+	if (patch.IsFull) {
+		_isStale = false;
+	} else if (patch.Sequence != _applied + 1) {
+		// Whatever the missed patch changed is still wrong, so we need everything again
+		_isStale = true;
+	}
+	_applied = patch.Sequence;
+
+	// Growing throws the old records away, but the builder sends all of them with the patch that grows it
+	if (patch.Capacity > _capacity) {
+		LOG_ASSERT(patch.IsFull, "Render records can only grow with a full patch!");
+		_capacity = patch.Capacity;
+		_buffer->LoadData(static_cast<const InstanceTransform*>(nullptr), _capacity);
+	}
+
+	const size_t count = patch.Slots.size();
+	for (size_t begin = 0; begin < count;) {
+		size_t end = begin + 1;
+		while (end < count && patch.Slots[end] == patch.Slots[end - 1] + 1) {
+			end++;
+		}
+		_buffer->UpdateSubData(patch.Slots[begin], patch.Records.data() + begin, end - begin);
+		_stats.Ranges++;
+		begin = end;
+	}
+	_stats.Uploaded = static_cast<uint32_t>(count);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "VertexBuffer.h"
+#include "Utilities/VertexTypes.h"
+
+/// <summary>
+/// The records that changed in a RenderRecords buffer between two snapshots, worked out while the snapshot is built
+/// and applied on the main thread right before it's drawn, so the buffer always matches the snapshot being drawn
+/// </summary>
+struct RenderRecordPatch {
+	// The order the patches were made in, 0 if the snapshot didn't touch the records
+	uint64_t Sequence = 0;
+	// The number of records the buffer needs room for
+	uint32_t Capacity = 0;
+	// Whether every record in use is in the patch, so the buffer doesn't depend on any earlier patches
+	bool     IsFull = false;
+	// The records that changed, in ascending order, and what they changed to
+	std::vector<uint32_t>          Slots;
+	std::vector<InstanceTransform> Records;
+
+	void Clear() {
+		Sequence = 0;
+		Capacity = 0;
+		IsFull = false;
+		Slots.clear();
+		Records.clear();
+	}
+};
+
+/// <summary>
+/// A persistent instance buffer holding a record (world matrices and material index) for each renderer, which only
+/// gets written where something changed. The renderers drawn out of it are culled on the GPU (see InstanceCuller),
+/// so a scene that mostly stands still uploads next to nothing each frame, rather than every visible instance
+///
+/// The builder owns the layout, it decides which slot each renderer gets and hands over the changes as a patch with
+/// each snapshot. Patches have to be applied in the order they were made, if one gets skipped (ex: a snapshot that was
+/// never drawn) the buffer is marked stale until a full patch comes along
+/// </summary>
+class RenderRecords final
+{
+public:
+	typedef std::shared_ptr<RenderRecords> sptr;
+	static inline sptr Create() {
+		return std::make_shared<RenderRecords>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	RenderRecords(const RenderRecords& other) = delete;
+	RenderRecords(RenderRecords&& other) = delete;
+	RenderRecords& operator=(const RenderRecords& other) = delete;
+	RenderRecords& operator=(RenderRecords&& other) = delete;
+
+	/// <summary>
+	/// What the last patch uploaded
+	/// </summary>
+	struct Stats {
+		// The records that were written, and the number of uploads they took
+		uint32_t Uploaded = 0;
+		uint32_t Ranges = 0;
+	};
+
+	RenderRecords();
+	~RenderRecords() = default;
+
+	/// <summary>
+	/// Writes the records in a patch into the buffer, growing it first if needed. Each run of neighbouring records
+	/// is uploaded in one go. Must be called on the main thread, before drawing the snapshot the patch came with
+	/// </summary>
+	/// <param name="patch">The patch to apply, patches with a sequence of 0 are ignored</param>
+	void Apply(const RenderRecordPatch& patch);
+
+	/// <summary>
+	/// Returns true if a patch was missed, the next snapshot should be built with a full patch
+	/// </summary>
+	bool IsStale() const { return _isStale; }
+	/// <summary>
+	/// Gets the buffer the records are in, it's handle stays the same as it grows
+	/// </summary>
+	const VertexBuffer::sptr& GetBuffer() const { return _buffer; }
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	VertexBuffer::sptr _buffer;
+	uint32_t           _capacity;
+	uint64_t           _applied;
+	bool               _isStale;
+	Stats              _stats;
+};
@@ -0,0 +1,200 @@
+#include "RenderState.h"
+#include "RenderStats.h"
+
+RenderState::Tracked<GLuint>   RenderState::_program;
+RenderState::Tracked<GLuint>   RenderState::_vao;
+RenderState::Tracked<GLuint>   RenderState::_textures[RenderState::MAX_TRACKED_UNITS];
+RenderState::Tracked<GLuint>   RenderState::_samplers[RenderState::MAX_TRACKED_UNITS];
+RenderState::Tracked<GLuint>   RenderState::_storageBuffers[RenderState::MAX_TRACKED_STORAGE_SLOTS];
+RenderState::Tracked<bool>     RenderState::_blend;
+RenderState::Tracked<bool>     RenderState::_depthTest;
+RenderState::Tracked<bool>     RenderState::_cullFace;
+RenderState::Tracked<uint64_t> RenderState::_blendFunc;
+RenderState::Tracked<GLenum>   RenderState::_depthFunc;
+RenderState::Tracked<bool>     RenderState::_depthMask;
+RenderState::Tracked<GLenum>   RenderState::_cullMode;
+RenderState::Tracked<GLenum>   RenderState::_polygonMode;
+RenderState::Stats             RenderState::_stats = { 0, 0 };
+
+void RenderState::UseProgram(GLuint program) {
+	if (_Update(_program, program)) {
+		RenderStats::CountProgramSwitch();
+		glUseProgram(program);
+	}
+}
+
+void RenderState::BindVertexArray(GLuint vao) {
+	if (_Update(_vao, vao)) {
+		RenderStats::CountVaoSwitch();
+		glBindVertexArray(vao);
+	}
+}
+
+void RenderState::BindTextureUnit(GLuint unit, GLuint texture) {
+	if (unit >= MAX_TRACKED_UNITS) {
+		_stats.Issued++;
+		RenderStats::CountTextureSwitch();
+		glBindTextureUnit(unit, texture);
+	}
+	else if (_Update(_textures[unit], texture)) {
+		RenderStats::CountTextureSwitch();
+		glBindTextureUnit(unit, texture);
+	}
+}
+
+void RenderState::BindSampler(GLuint unit, GLuint sampler) {
+	if (unit >= MAX_TRACKED_UNITS) {
+		_stats.Issued++;
+		glBindSampler(unit, sampler);
+	}
+	else if (_Update(_samplers[unit], sampler)) {
+		glBindSampler(unit, sampler);
+	}
+}
+
+void RenderState::BindTextureUnits(GLuint first, GLsizei count, const GLuint* textures) {
+	if (count > 0 && _UpdateRange(_textures, first, count, textures)) {
+		RenderStats::CountTextureSwitch();
+		glBindTextures(first, count, textures);
+	}
+}
+
+void RenderState::BindSamplers(GLuint first, GLsizei count, const GLuint* samplers) {
+	if (count > 0 && _UpdateRange(_samplers, first, count, samplers)) {
+		glBindSamplers(first, count, samplers);
+	}
+}
+
+void RenderState::BindStorageBuffer(GLuint slot, GLuint buffer) {
+	if (slot >= MAX_TRACKED_STORAGE_SLOTS) {
+		_stats.Issued++;
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, slot, buffer);
+	}
+	else if (_Update(_storageBuffers[slot], buffer)) {
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, slot, buffer);
+	}
+}
+
+void RenderState::SetEnabled(GLenum capability, bool enabled) {
+	Tracked<bool>* state = nullptr;
+	switch (capability) {
+		case GL_BLEND:      state = &_blend; break;
+		case GL_DEPTH_TEST: state = &_depthTest; break;
+		case GL_CULL_FACE:  state = &_cullFace; break;
+		default: break;
+	}
+	if (state == nullptr) {
+		_stats.Issued++;
+	} else if (!_Update(*state, enabled)) {
+		return;
+	}
+	if (enabled) {
+		glEnable(capability);
+	} else {
+		glDisable(capability);
+	}
+}
+
+void RenderState::SetBlendFunc(GLenum source, GLenum destination) {
+	uint64_t packed = (static_cast<uint64_t>(source) << 32) | destination;
+	if (_Update(_blendFunc, packed)) {
+		glBlendFunc(source, destination);
+	}
+}
+
+void RenderState::SetDepthFunc(GLenum func) {
+	if (_Update(_depthFunc, func)) {
+		glDepthFunc(func);
+	}
+}
+
+void RenderState::SetDepthMask(bool enabled) {
+	if (_Update(_depthMask, enabled)) {
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void RenderState::SetCullFace(GLenum face) {
+	if (_Update(_cullMode, face)) {
+		glCullFace(face);
+	}
+}
+
+void RenderState::SetPolygonMode(GLenum mode) {
+	if (_Update(_polygonMode, mode)) {
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+	}
+}
+
+void RenderState::ApplyPipeline(const PipelineState& state) {
+	SetEnabled(GL_DEPTH_TEST, state.DepthTest);
+	SetDepthMask(state.DepthWrite);
+	if (state.DepthTest) {
+		SetDepthFunc(state.DepthFunc);
+	}
+	SetEnabled(GL_BLEND, state.Blend);
+	if (state.Blend && !state.OrderIndependent) {
+		SetBlendFunc(state.BlendSource, state.BlendDestination);
+	}
+	SetEnabled(GL_CULL_FACE, state.Cull);
+	if (state.Cull) {
+		SetCullFace(state.CullFace);
+	}
+	SetPolygonMode(state.PolygonMode);
+}
+
+void RenderState::Invalidate() {
+	_program.Known = false;
+	_vao.Known = false;
+	for (int ix = 0; ix < MAX_TRACKED_UNITS; ix++) {
+		_textures[ix].Known = false;
+		_samplers[ix].Known = false;
+	}
+	for (int ix = 0; ix < MAX_TRACKED_STORAGE_SLOTS; ix++) {
+		_storageBuffers[ix].Known = false;
+	}
+	_blend.Known = false;
+	_depthTest.Known = false;
+	_cullFace.Known = false;
+	_blendFunc.Known = false;
+	_depthFunc.Known = false;
+	_depthMask.Known = false;
+	_cullMode.Known = false;
+	_polygonMode.Known = false;
+}
+
+void RenderState::OnProgramDeleted(GLuint program) {
+	if (_program.Value == program) {
+		_program.Known = false;
+	}
+}
+
+void RenderState::OnVertexArrayDeleted(GLuint vao) {
+	if (_vao.Value == vao) {
+		_vao.Known = false;
+	}
+}
+
+void RenderState::OnTextureDeleted(GLuint texture) {
+	for (int ix = 0; ix < MAX_TRACKED_UNITS; ix++) {
+		if (_textures[ix].Value == texture) {
+			_textures[ix].Known = false;
+		}
+	}
+}
+
+void RenderState::OnSamplerDeleted(GLuint sampler) {
+	for (int ix = 0; ix < MAX_TRACKED_UNITS; ix++) {
+		if (_samplers[ix].Value == sampler) {
+			_samplers[ix].Known = false;
+		}
+	}
+}
+
+void RenderState::OnBufferDeleted(GLuint buffer) {
+	for (int ix = 0; ix < MAX_TRACKED_STORAGE_SLOTS; ix++) {
+		if (_storageBuffers[ix].Value == buffer) {
+			_storageBuffers[ix].Known = false;
+		}
+	}
+}
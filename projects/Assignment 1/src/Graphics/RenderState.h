@@ -0,0 +1,179 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include "PipelineState.h"
+
+/// <summary>
+/// Tracks the OpenGL state that we change the most often (programs, VAOs, textures, samplers and the fixed function
+/// toggles), so that binding something that is already bound does not make a trip into the driver
+/// 
+/// All of the Graphics classes go through this instead of calling the GL functions directly. If something else changes
+/// the state behind our backs (ex: ImGui), call Invalidate so the next change gets issued
+/// </summary>
+class RenderState
+{
+public:
+	/// <summary>
+	/// Counters for how many state changes were sent to OpenGL, and how many were skipped because they would do nothing
+	/// </summary>
+	struct Stats {
+		int Issued;
+		int Elided;
+	};
+
+	/// <summary>
+	/// The number of texture units we track, binds to units past this are always issued
+	/// </summary>
+	static const int MAX_TRACKED_UNITS = 32;
+	/// <summary>
+	/// The number of shader storage buffer binding points we track, binds to points past this are always issued
+	/// </summary>
+	static const int MAX_TRACKED_STORAGE_SLOTS = 8;
+
+	/// <summary>
+	/// Sets the active shader program (glUseProgram)
+	/// </summary>
+	static void UseProgram(GLuint program);
+	/// <summary>
+	/// Binds a vertex array object (glBindVertexArray)
+	/// </summary>
+	static void BindVertexArray(GLuint vao);
+	/// <summary>
+	/// Binds a texture to a texture unit (glBindTextureUnit)
+	/// </summary>
+	static void BindTextureUnit(GLuint unit, GLuint texture);
+	/// <summary>
+	/// Binds a sampler object to a texture unit (glBindSampler)
+	/// </summary>
+	static void BindSampler(GLuint unit, GLuint sampler);
+	/// <summary>
+	/// Binds a range of textures to consecutive texture units, with a single glBindTextures if any of them changed
+	/// </summary>
+	static void BindTextureUnits(GLuint first, GLsizei count, const GLuint* textures);
+	/// <summary>
+	/// Binds a range of samplers to consecutive texture units, with a single glBindSamplers if any of them changed
+	/// </summary>
+	static void BindSamplers(GLuint first, GLsizei count, const GLuint* samplers);
+	/// <summary>
+	/// Binds a buffer to a shader storage buffer binding point (glBindBufferBase with GL_SHADER_STORAGE_BUFFER)
+	/// </summary>
+	static void BindStorageBuffer(GLuint slot, GLuint buffer);
+
+	/// <summary>
+	/// Enables or disables GL_BLEND, GL_DEPTH_TEST or GL_CULL_FACE. Other capabilities are not tracked and are always issued
+	/// </summary>
+	static void SetEnabled(GLenum capability, bool enabled);
+	/// <summary>
+	/// Sets the blend function (glBlendFunc)
+	/// </summary>
+	static void SetBlendFunc(GLenum source, GLenum destination);
+	/// <summary>
+	/// Sets the depth comparison function (glDepthFunc)
+	/// </summary>
+	static void SetDepthFunc(GLenum func);
+	/// <summary>
+	/// Sets whether we write to the depth buffer (glDepthMask)
+	/// </summary>
+	static void SetDepthMask(bool enabled);
+	/// <summary>
+	/// Sets which faces get culled when culling is enabled (glCullFace)
+	/// </summary>
+	static void SetCullFace(GLenum face);
+	/// <summary>
+	/// Sets how polygons are rasterized for both faces (glPolygonMode)
+	/// </summary>
+	static void SetPolygonMode(GLenum mode);
+	/// <summary>
+	/// Applies a whole pipeline state, only issuing the parts that differ from what's already set. The blend function
+	/// and cull face are left alone when blending or culling are off, as is the blend function for order independent
+	/// blending (see WeightedBlending)
+	/// </summary>
+	static void ApplyPipeline(const PipelineState& state);
+
+	/// <summary>
+	/// Forgets everything we know about the GL state, so that every next change gets issued
+	/// </summary>
+	static void Invalidate();
+	/// <summary>
+	/// Notifies the tracker that a program is being deleted, so it's handle can be safely re-used
+	/// </summary>
+	static void OnProgramDeleted(GLuint program);
+	/// <summary>
+	/// Notifies the tracker that a VAO is being deleted, so it's handle can be safely re-used
+	/// </summary>
+	static void OnVertexArrayDeleted(GLuint vao);
+	/// <summary>
+	/// Notifies the tracker that a texture is being deleted, so it's handle can be safely re-used
+	/// </summary>
+	static void OnTextureDeleted(GLuint texture);
+	/// <summary>
+	/// Notifies the tracker that a sampler is being deleted, so it's handle can be safely re-used
+	/// </summary>
+	static void OnSamplerDeleted(GLuint sampler);
+	/// <summary>
+	/// Notifies the tracker that a buffer is being deleted, so it's handle can be safely re-used
+	/// </summary>
+	static void OnBufferDeleted(GLuint buffer);
+
+	/// <summary>
+	/// Gets the number of state changes issued and elided since the last call to ResetStats
+	/// </summary>
+	static const Stats& GetStats() { return _stats; }
+	/// <summary>
+	/// Resets the state change counters, should be called once per frame
+	/// </summary>
+	static void ResetStats() { _stats = { 0, 0 }; }
+
+protected:
+	RenderState() = default;
+
+	// Helper to store a cached value along with whether we actually know what the GL state is
+	template <typename T>
+	struct Tracked {
+		T    Value;
+		bool Known = false;
+	};
+
+	// Records the change and returns true if the value is different from the one we had cached
+	template <typename T>
+	static bool _Update(Tracked<T>& state, const T& value) {
+		if (state.Known && state.Value == value) {
+			_stats.Elided++;
+			return false;
+		}
+		state.Value = value;
+		state.Known = true;
+		_stats.Issued++;
+		return true;
+	}
+
+	// Updates a range of tracked bindings, returning true if any of them changed
+	static bool _UpdateRange(Tracked<GLuint>* states, GLuint first, GLsizei count, const GLuint* values) {
+		bool changed = false;
+		for (GLsizei ix = 0; ix < count; ix++) {
+			if (first + ix >= MAX_TRACKED_UNITS) {
+				_stats.Issued++;
+				changed = true;
+			} else {
+				changed |= _Update(states[first + ix], values[ix]);
+			}
+		}
+		return changed;
+	}
+
+	static Tracked<GLuint> _program;
+	static Tracked<GLuint> _vao;
+	static Tracked<GLuint> _textures[MAX_TRACKED_UNITS];
+	static Tracked<GLuint> _samplers[MAX_TRACKED_UNITS];
+	static Tracked<GLuint> _storageBuffers[MAX_TRACKED_STORAGE_SLOTS];
+	static Tracked<bool>   _blend;
+	static Tracked<bool>   _depthTest;
+	static Tracked<bool>   _cullFace;
+	static Tracked<uint64_t> _blendFunc;
+	static Tracked<GLenum> _depthFunc;
+	static Tracked<bool>   _depthMask;
+	static Tracked<GLenum> _cullMode;
+	static Tracked<GLenum> _polygonMode;
+
+	static Stats _stats;
+};
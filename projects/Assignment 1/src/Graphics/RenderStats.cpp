@@ -0,0 +1,54 @@
+#include "RenderStats.h"
+
+RenderStats::Layer RenderStats::_layer = RenderStats::Layer::Setup;
+RenderStats::Frame RenderStats::_frame;
+RenderStats::Frame RenderStats::_last;
+
+RenderStats::Counters& RenderStats::Counters::operator+=(const Counters& other) {
+	DrawCalls += other.DrawCalls;
+	InstancedDraws += other.InstancedDraws;
+	Triangles += other.Triangles;
+	Vertices += other.Vertices;
+	ProgramSwitches += other.ProgramSwitches;
+	VaoSwitches += other.VaoSwitches;
+	TextureSwitches += other.TextureSwitches;
+	MaterialSwitches += other.MaterialSwitches;
+	UniformUploads += other.UniformUploads;
+	BufferBytes += other.BufferBytes;
+	TextureBytes += other.TextureBytes;
+	return *this;
+}
+
+const char* RenderStats::GetLayerName(Layer layer) {
+	switch (layer) {
+		case Layer::Setup:        return "Setup";
+		case Layer::Shadows:      return "Shadows";
+		case Layer::Views:        return "Views";
+		case Layer::Geometry:     return "Geometry";
+		case Layer::Lighting:     return "Lighting";
+		case Layer::DepthPrepass: return "DepthPrepass";
+		case Layer::Opaque:       return "Opaque";
+		case Layer::Fading:       return "Fading";
+		case Layer::Sky:          return "Sky";
+		case Layer::Transparent:  return "Transparent";
+		case Layer::Particles:    return "Particles";
+		case Layer::PostProcess:  return "PostProcess";
+		default:                  return "Unknown";
+	}
+}
+
+void RenderStats::SetCulled(uint32_t objects, uint32_t occluded, uint32_t lights) {
+	_frame.CulledObjects = objects;
+	_frame.OccludedObjects = occluded;
+	_frame.CulledLights = lights;
+}
+
+void RenderStats::EndFrame() {
+	_frame.Total = Counters();
+	for (const Counters& layer : _frame.Layers) {
+		_frame.Total += layer;
+	}
+	_last = _frame;
+	_frame = Frame();
+	_layer = Layer::Setup;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// Counts the work each frame sends to OpenGL: draws, the triangles and vertices they submit, state switches, uniform
+/// uploads and bytes uploaded to buffers and textures. The Graphics classes bump these as they issue the calls, and
+/// everything gets charged to whichever layer of the frame is currently set, so a frame's cost can be broken down by
+/// pass
+///
+/// The counters are only touched from the render thread, so they're plain integers. EndFrame keeps the finished frame
+/// around for the debug UI and benchmarks to read while the next one is being counted
+/// </summary>
+class RenderStats final
+{
+public:
+	/// <summary>
+	/// The parts of a frame that the counters are broken down by, roughly in the order they're drawn
+	/// </summary>
+	enum class Layer : uint8_t {
+		// Uploads and anything else that happens outside of a pass
+		Setup = 0,
+		Shadows,
+		// The extra views, drawn into their own targets
+		Views,
+		// The G-buffer fill when shading deferred
+		Geometry,
+		// The full screen deferred lighting pass
+		Lighting,
+		DepthPrepass,
+		Opaque,
+		// Impostors and the meshes fading into them
+		Fading,
+		Sky,
+		// Blended renderers, drawn back to front
+		Transparent,
+		Particles,
+		PostProcess,
+		Count
+	};
+
+	/// <summary>
+	/// The counters for a single layer (or a whole frame)
+	/// </summary>
+	struct Counters {
+		uint32_t DrawCalls = 0;
+		// Draws of more than one instance, including indirect draws
+		uint32_t InstancedDraws = 0;
+		// Only what we know about on the CPU, draws whose counts are written by the GPU aren't included
+		uint64_t Triangles = 0;
+		uint64_t Vertices = 0;
+		uint32_t ProgramSwitches = 0;
+		uint32_t VaoSwitches = 0;
+		uint32_t TextureSwitches = 0;
+		uint32_t MaterialSwitches = 0;
+		uint32_t UniformUploads = 0;
+		uint64_t BufferBytes = 0;
+		uint64_t TextureBytes = 0;
+
+		Counters& operator+=(const Counters& other);
+	};
+
+	/// <summary>
+	/// Everything counted over a single frame
+	/// </summary>
+	struct Frame {
+		Counters Layers[static_cast<int>(Layer::Count)];
+		// The sum of all the layers
+		Counters Total;
+		uint32_t CulledObjects = 0;
+		uint32_t OccludedObjects = 0;
+		uint32_t CulledLights = 0;
+	};
+
+	/// <summary>
+	/// Sets the layer that everything counted from here on is charged to
+	/// </summary>
+	static void SetLayer(Layer layer) { _layer = layer; }
+	static Layer GetLayer() { return _layer; }
+	static const char* GetLayerName(Layer layer);
+
+	/// <summary>
+	/// Counts a draw of the given number of vertices (or indices), which are assumed to be triangle lists
+	/// </summary>
+	static void CountDraw(uint64_t vertices, uint32_t instances = 1) {
+		Counters& counters = _Current();
+		counters.DrawCalls++;
+		counters.InstancedDraws += instances > 1 ? 1 : 0;
+		CountGeometry(vertices, instances);
+	}
+	/// <summary>
+	/// Counts an indirect draw, the geometry it submits can be added with CountGeometry if the commands are known on
+	/// the CPU (otherwise only the GPU knows, ex: when they're written by a compute pass)
+	/// </summary>
+	static void CountIndirectDraw() {
+		Counters& counters = _Current();
+		counters.DrawCalls++;
+		counters.InstancedDraws++;
+	}
+	/// <summary>
+	/// Counts the triangles and vertices submitted by a draw, without counting the draw itself
+	/// </summary>
+	static void CountGeometry(uint64_t vertices, uint32_t instances = 1) {
+		Counters& counters = _Current();
+		counters.Vertices += vertices * instances;
+		counters.Triangles += vertices / 3 * instances;
+	}
+	static void CountProgramSwitch() { _Current().ProgramSwitches++; }
+	static void CountVaoSwitch() { _Current().VaoSwitches++; }
+	static void CountTextureSwitch() { _Current().TextureSwitches++; }
+	static void CountMaterialSwitch() { _Current().MaterialSwitches++; }
+	static void CountUniformUpload() { _Current().UniformUploads++; }
+	static void CountBufferUpload(uint64_t bytes) { _Current().BufferBytes += bytes; }
+	static void CountTextureUpload(uint64_t bytes) { _Current().TextureBytes += bytes; }
+
+	/// <summary>
+	/// Records how much the frame's culling skipped, these are counted once per frame rather than per layer
+	/// </summary>
+	static void SetCulled(uint32_t objects, uint32_t occluded, uint32_t lights);
+
+	/// <summary>
+	/// Finishes counting the current frame, and starts the next one back on the Setup layer
+	/// </summary>
+	static void EndFrame();
+	/// <summary>
+	/// Gets the counters from the last frame that was finished with EndFrame
+	/// </summary>
+	static const Frame& GetLastFrame() { return _last; }
+
+private:
+	RenderStats() = default;
+
+	static Counters& _Current() { return _frame.Layers[static_cast<int>(_layer)]; }
+
+	static Layer _layer;
+	static Frame _frame;
+	static Frame _last;
+};
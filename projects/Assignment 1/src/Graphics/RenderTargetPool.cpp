@@ -0,0 +1,75 @@
+#include "RenderTargetPool.h"
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderState.h"
+
+RenderTargetPool::~RenderTargetPool() {
+	for (const Entry& entry : _entries) {
+		RenderState::OnTextureDeleted(entry.Texture);
+		GpuResources::RemoveRaw(GL_TEXTURE, entry.Texture);
+		glDeleteTextures(1, &entry.Texture);
+	}
+}
+
+GLuint RenderTargetPool::Acquire(int width, int height, InternalFormat format) {
+	GPU_RESOURCE_OWNER("RenderTargetPool");
+	for (Entry& entry : _entries) {
+		if (!entry.InUse && entry.Width == width && entry.Height == height && entry.Format == format) {
+			entry.InUse = true;
+			entry.IdleFrames = 0;
+			_stats.Reused++;
+			return entry.Texture;
+		}
+	}
+
+	Entry entry;
+	entry.Width = width;
+	entry.Height = height;
+	entry.Format = format;
+	entry.InUse = true;
+	entry.IdleFrames = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &entry.Texture);
+	glTextureStorage2D(entry.Texture, 1, *format, width, height);
+	glTextureParameteri(entry.Texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(entry.Texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(entry.Texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(entry.Texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	_entries.push_back(entry);
+	_stats.Created++;
+	_stats.TextureCount++;
+	_stats.MemorySize += GetTextureMemorySize(format, width, height, 1);
+	GpuResources::AddRaw(GL_TEXTURE, entry.Texture, GetTextureMemorySize(format, width, height, 1), "Pooled Render Target");
+	return entry.Texture;
+}
+
+void RenderTargetPool::Release(GLuint texture) {
+	for (Entry& entry : _entries) {
+		if (entry.Texture == texture) {
+			LOG_ASSERT(entry.InUse, "Render target {} was released twice", texture);
+			entry.InUse = false;
+			return;
+		}
+	}
+	LOG_WARN("Render target {} does not belong to this pool", texture);
+}
+
+void RenderTargetPool::EndFrame() {
+	for (size_t ix = 0; ix < _entries.size();) {
+		Entry& entry = _entries[ix];
+		if (!entry.InUse && ++entry.IdleFrames > MAX_IDLE_FRAMES) {
+			RenderState::OnTextureDeleted(entry.Texture);
+			GpuResources::RemoveRaw(GL_TEXTURE, entry.Texture);
+			glDeleteTextures(1, &entry.Texture);
+			_stats.TextureCount--;
+			_stats.MemorySize -= GetTextureMemorySize(entry.Format, entry.Width, entry.Height, 1);
+			// Order doesn't matter, so the last entry can fill the gap
+			entry = _entries.back();
+			_entries.pop_back();
+		} else {
+			ix++;
+		}
+	}
+	_stats.Reused = 0;
+	_stats.Created = 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glad/glad.h>
+
+#include "TextureEnums.h"
+
+/// <summary>
+/// Hands out 2D textures for targets that only live for part of a frame (ex: the levels of a blur chain). Released
+/// textures go back into the pool, and the next pass that asks for the same size and format gets them, so passes that
+/// run one after another end up sharing memory instead of each keeping their own targets. Textures that sit unused
+/// for a few frames (ex: after the window is resized) get deleted
+/// </summary>
+class RenderTargetPool final
+{
+public:
+	typedef std::shared_ptr<RenderTargetPool> sptr;
+	static inline sptr Create() {
+		return std::make_shared<RenderTargetPool>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	RenderTargetPool(const RenderTargetPool& other) = delete;
+	RenderTargetPool(RenderTargetPool&& other) = delete;
+	RenderTargetPool& operator=(const RenderTargetPool& other) = delete;
+	RenderTargetPool& operator=(RenderTargetPool&& other) = delete;
+
+public:
+	// How many frames a texture can go without being acquired before it gets deleted
+	static const uint32_t MAX_IDLE_FRAMES = 3;
+
+	/// <summary>
+	/// What the pool is holding onto, and how often it could reuse a texture last frame
+	/// </summary>
+	struct Stats {
+		uint32_t TextureCount = 0;
+		size_t   MemorySize   = 0;
+		uint32_t Reused       = 0;
+		uint32_t Created      = 0;
+	};
+
+	RenderTargetPool() = default;
+	~RenderTargetPool();
+
+	/// <summary>
+	/// Gets a texture with a single level of the given size and format, that nothing else is using. It's contents are
+	/// whatever was last drawn into it
+	/// </summary>
+	/// <param name="width">The width of the texture, in pixels</param>
+	/// <param name="height">The height of the texture, in pixels</param>
+	/// <param name="format">The internal format of the texture</param>
+	/// <returns>The OpenGL handle of the texture, which stays owned by the pool</returns>
+	GLuint Acquire(int width, int height, InternalFormat format);
+	/// <summary>
+	/// Hands a texture back to the pool once the last pass that reads it has been submitted
+	/// </summary>
+	/// <param name="texture">A texture returned by Acquire</param>
+	void Release(GLuint texture);
+
+	/// <summary>
+	/// Deletes the textures that haven't been used in a while, and resets the reuse counts. Call once a frame
+	/// </summary>
+	void EndFrame();
+
+	/// <summary>
+	/// Gets what the pool is holding onto
+	/// </summary>
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	struct Entry {
+		GLuint         Texture;
+		int            Width;
+		int            Height;
+		InternalFormat Format;
+		bool           InUse;
+		uint32_t       IdleFrames;
+	};
+	std::vector<Entry> _entries;
+	Stats              _stats;
+};
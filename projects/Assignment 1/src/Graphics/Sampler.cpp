@@ -0,0 +1,85 @@
+#include "Sampler.h"
+#include "RenderState.h"
+#include "Logging.h"
+#include <algorithm>
+#include <functional>
+
+std::unordered_map<SamplerDescription, Sampler::sptr, Sampler::DescriptionHasher> Sampler::_samplers;
+float Sampler::_anisotropyLimit = -1.0f;
+
+Sampler::Sampler(const SamplerDescription& description) :
+	_handle(0),
+	_description(description),
+	_hasTextureHandles(false)
+{
+	glCreateSamplers(1, &_handle);
+	glSamplerParameteri(_handle, GL_TEXTURE_WRAP_S, (GLenum)_description.WrapS);
+	glSamplerParameteri(_handle, GL_TEXTURE_WRAP_T, (GLenum)_description.WrapT);
+	glSamplerParameteri(_handle, GL_TEXTURE_WRAP_R, (GLenum)_description.WrapR);
+	glSamplerParameteri(_handle, GL_TEXTURE_MIN_FILTER, (GLenum)_description.MinificationFilter);
+	glSamplerParameteri(_handle, GL_TEXTURE_MAG_FILTER, (GLenum)_description.MagnificationFilter);
+	_UpdateAnisotropy();
+}
+
+Sampler::~Sampler() {
+	if (_handle != 0) {
+		RenderState::OnSamplerDeleted(_handle);
+		glDeleteSamplers(1, &_handle);
+		_handle = 0;
+	}
+}
+
+void Sampler::Bind(int slot) const {
+	RenderState::BindSampler(slot, _handle);
+}
+
+uint64_t Sampler::GetTextureHandle(GLuint texture) {
+	_hasTextureHandles = true;
+	return glGetTextureSamplerHandleARB(texture, _handle);
+}
+
+const Sampler::sptr& Sampler::Get(const SamplerDescription& description) {
+	sptr& result = _samplers[description];
+	if (result == nullptr) {
+		result = Create(description);
+	}
+	return result;
+}
+
+void Sampler::SetAnisotropyLimit(float level) {
+	_anisotropyLimit = level;
+	// Every texture reads their anisotropy from one of these, so this is all we need to update
+	for (auto& [description, sampler] : _samplers) {
+		sampler->_UpdateAnisotropy();
+	}
+}
+
+void Sampler::_UpdateAnisotropy() {
+	if (_hasTextureHandles) {
+		LOG_WARN("Cannot change the anisotropy of a sampler that is used by bindless textures");
+		return;
+	}
+	static float maxAnisotropy = 0.0f;
+	if (maxAnisotropy == 0.0f) {
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAnisotropy);
+	}
+	float level = _description.MaxAnisotropic < 0.0f ? maxAnisotropy : _description.MaxAnisotropic;
+	if (_anisotropyLimit >= 0.0f) {
+		level = std::min(level, _anisotropyLimit);
+	}
+	// An anisotropy of 1 is the same as turning it off, anything lower is invalid
+	glSamplerParameterf(_handle, GL_TEXTURE_MAX_ANISOTROPY, std::clamp(level, 1.0f, maxAnisotropy));
+}
+
+size_t Sampler::DescriptionHasher::operator()(const SamplerDescription& description) const {
+	size_t result = std::hash<int>()((int)description.WrapS);
+	const auto combine = [&](size_t value) {
+		result ^= value + 0x9e3779b9 + (result << 6) + (result >> 2);
+	};
+	combine(std::hash<int>()((int)description.WrapT));
+	combine(std::hash<int>()((int)description.WrapR));
+	combine(std::hash<int>()((int)description.MinificationFilter));
+	combine(std::hash<int>()((int)description.MagnificationFilter));
+	combine(std::hash<float>()(description.MaxAnisotropic));
+	return result;
+}
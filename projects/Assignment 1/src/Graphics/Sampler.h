@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <glad/glad.h>
+
+#include "TextureEnums.h"
+
+/// <summary>
+/// Describes how a texture is sampled, this is everything that used to be baked into our texture objects
+/// </summary>
+struct SamplerDescription
+{
+	WrapMode  WrapS;
+	WrapMode  WrapT;
+	WrapMode  WrapR;
+	MinFilter MinificationFilter;
+	MagFilter MagnificationFilter;
+	// The anisotropy level, or -1 for the most the GPU (and Sampler::SetAnisotropyLimit) allows
+	float     MaxAnisotropic;
+
+	SamplerDescription() :
+		WrapS(WrapMode::Repeat),
+		WrapT(WrapMode::Repeat),
+		WrapR(WrapMode::Repeat),
+		MinificationFilter(MinFilter::NearestMipLinear),
+		MagnificationFilter(MagFilter::Linear),
+		MaxAnisotropic(-1.0f)
+	{ }
+
+	bool operator==(const SamplerDescription& other) const {
+		return WrapS == other.WrapS && WrapT == other.WrapT && WrapR == other.WrapR &&
+			MinificationFilter == other.MinificationFilter && MagnificationFilter == other.MagnificationFilter &&
+			MaxAnisotropic == other.MaxAnisotropic;
+	}
+	bool operator!=(const SamplerDescription& other) const { return !(*this == other); }
+};
+
+/// <summary>
+/// Wraps an OpenGL sampler object. Samplers are shared between all the textures that use the same description, so
+/// get them through Sampler::Get instead of creating them directly
+/// </summary>
+class Sampler final
+{
+public:
+	typedef std::shared_ptr<Sampler> sptr;
+	static inline sptr Create(const SamplerDescription& description) {
+		return std::make_shared<Sampler>(description);
+	}
+	// We'll disallow moving and copying, since we want to manually control when the destructor is called
+	// We'll use these classes via pointers
+	Sampler(const Sampler& other) = delete;
+	Sampler(Sampler&& other) = delete;
+	Sampler& operator=(const Sampler& other) = delete;
+	Sampler& operator=(Sampler&& other) = delete;
+
+public:
+	Sampler(const SamplerDescription& description);
+	~Sampler();
+
+	/// <summary>
+	/// Binds this sampler to the given texture unit
+	/// </summary>
+	void Bind(int slot) const;
+
+	/// <summary>
+	/// Gets the underlying OpenGL handle for this sampler
+	/// </summary>
+	GLuint GetHandle() const { return _handle; }
+	/// <summary>
+	/// Gets the description this sampler was created with, note that the anisotropy level may be clamped by the limit
+	/// </summary>
+	const SamplerDescription& GetDescription() const { return _description; }
+
+	/// <summary>
+	/// Creates a bindless handle for a texture sampled with this sampler (glGetTextureSamplerHandleARB). Once a
+	/// handle exists this sampler's state can no longer change, so anisotropy limits will not apply to it
+	/// </summary>
+	/// <param name="texture">The OpenGL handle of the texture</param>
+	uint64_t GetTextureHandle(GLuint texture);
+
+	/// <summary>
+	/// Gets the shared sampler for a description, creating it if it does not exist yet
+	/// </summary>
+	static const sptr& Get(const SamplerDescription& description);
+	/// <summary>
+	/// Sets the highest anisotropy level any sampler will use, and updates all the existing samplers to match. This
+	/// is meant for quality settings, pass -1 to allow as much as the GPU supports
+	/// </summary>
+	static void SetAnisotropyLimit(float level);
+	/// <summary>
+	/// Gets the highest anisotropy level any sampler will use, or -1 if there is no limit
+	/// </summary>
+	static float GetAnisotropyLimit() { return _anisotropyLimit; }
+	/// <summary>
+	/// Releases all the shared samplers, any textures that still hold one will keep it alive
+	/// </summary>
+	static void ReleaseAll() { _samplers.clear(); }
+
+protected:
+	struct DescriptionHasher {
+		size_t operator()(const SamplerDescription& description) const;
+	};
+
+	GLuint             _handle;
+	SamplerDescription _description;
+	bool               _hasTextureHandles;
+
+	// Applies the anisotropy level from our description, clamped to the current limit
+	void _UpdateAnisotropy();
+
+	static std::unordered_map<SamplerDescription, sptr, DescriptionHasher> _samplers;
+	static float _anisotropyLimit;
+};
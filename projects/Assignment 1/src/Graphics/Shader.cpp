@@ -1,179 +1,745 @@
 #include "Shader.h"
+#include "GpuDeletionQueue.h"
+#include "RenderState.h"
+#include "RenderStats.h"
+#include "ShaderPreprocessor.h"
 #include "Logging.h"
 #include <fstream>
 #include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 
 Shader::Shader() :
-	_vs(0),
-	_fs(0),
-	_handle(0)
+	_status(LinkStatus::Unlinked),
+	_cacheKey(0),
+	_handle(0),
+	_lastMaterialId(UINT32_MAX)
 {
 	_handle = glCreateProgram();
 }
 
+std::unordered_set<Shader*> Shader::_fileShaders;
+std::unordered_map<Shader*, std::unique_ptr<Shader>> Shader::_reloads;
+std::recursive_mutex Shader::_fileShadersLock;
+
 Shader::~Shader() {
+	{
+		std::lock_guard<std::recursive_mutex> lock(_fileShadersLock);
+		_fileShaders.erase(this);
+		_reloads.erase(this);
+	}
 	if (_handle != 0) {
-		glDeleteProgram(_handle);
+		GpuDeletionQueue::DeleteProgram(_handle);
 		_handle = 0;
-		LOG_INFO("Deleting shader program");
+		LOG_TRACE("Deleting shader program");
 	}
 }
 
 bool Shader::LoadShaderPart(const char* source, GLenum type)
 {
-	// Creates a new shader part (VS, FS, GS, etc...)
-	GLuint handle = glCreateShader(type);
+	if (!ShaderStage::IsSupported(type)) {
+		LOG_WARN("Unsupported shader stage type {:#x}", type);
+		return false;
+	}
+	// We hold on to the source until we link, that way we can skip compiling it if the program is in the binary cache
+	AttachStage(ShaderStage::Create(type, source));
+	return true;
+}
 
-	// Load the GLSL source and compile it
-	glShaderSource(handle, 1, &source, nullptr);
-	glCompileShader(handle);
+bool Shader::LoadShaderPartFromFile(const char* path, GLenum type) {
+	return LoadShaderPartFromFile(path, type, std::vector<std::string>());
+}
 
-	// Get the compilation status for the shader part
-	GLint status = 0;
-	glGetShaderiv(handle, GL_COMPILE_STATUS, &status);
+bool Shader::LoadShaderPartFromFile(const char* path, GLenum type, const std::vector<std::string>& defines) {
+	if (!ShaderStage::IsSupported(type)) {
+		LOG_WARN("Unsupported shader stage type {:#x}", type);
+		return false;
+	}
+	// Other programs may already be using this file with the same defines, in which case we share their stage
+	AttachStage(ShaderStage::Get(path, type, defines));
+	_sourceFiles.push_back({ path, type, defines });
+	std::lock_guard<std::recursive_mutex> lock(_fileShadersLock);
+	_fileShaders.insert(this);
+	return true;
+}
 
-	if (status == GL_FALSE) {
-		// Get the size of the error log
-		GLint logSize = 0;
-		glGetShaderiv(handle, GL_INFO_LOG_LENGTH, &logSize);
+bool Shader::LoadSpecialized(const std::vector<FilePart>& parts) {
+	for (const FilePart& part : parts) {
+		if (!ShaderStage::IsSupported(part.Type)) {
+			LOG_WARN("Unsupported shader stage type {:#x}", part.Type);
+			return false;
+		}
+	}
+
+	// It's all or nothing, if any stage is missing it's module they all get compiled from GLSL
+	std::vector<ShaderStage::sptr> modules;
+	if (_stages.empty() && ShaderStage::IsSpirvEnabled()) {
+		for (const FilePart& part : parts) {
+			ShaderStage::sptr module = ShaderStage::GetSpirv(part.Path, part.Type, part.Constants);
+			if (module == nullptr) {
+				modules.clear();
+				break;
+			}
+			modules.push_back(module);
+		}
+	}
+
+	if (modules.empty()) {
+		for (const FilePart& part : parts) {
+			LoadShaderPartFromFile(part.Path.c_str(), part.Type, ShaderStage::GetDefines(part.Constants));
+		}
+		return true;
+	}
+	for (size_t ix = 0; ix < parts.size(); ix++) {
+		AttachStage(modules[ix]);
+		// Hot reloads go back to the GLSL, since the module is out of date as soon as the file changes
+		_sourceFiles.push_back({ parts[ix].Path, parts[ix].Type, ShaderStage::GetDefines(parts[ix].Constants) });
+	}
+	std::lock_guard<std::recursive_mutex> lock(_fileShadersLock);
+	_fileShaders.insert(this);
+	return true;
+}
+
+uint32_t Shader::Reload(const std::string& path) {
+	std::lock_guard<std::recursive_mutex> lock(_fileShadersLock);
+	std::vector<Shader*> targets;
+	for (Shader* shader : _fileShaders) {
+		// Includes count too, a change to a shared file rebuilds everything that pulls it in
+		const bool usesFile = std::any_of(shader->_sourceFiles.begin(), shader->_sourceFiles.end(),
+			[&](const SourceFile& file) { return ShaderPreprocessor::Reads(file.Path, path); });
+		if (usesFile) {
+			targets.push_back(shader);
+		}
+	}
+	if (targets.empty()) {
+		return 0;
+	}
+
+	// Any expansions and stages still in the caches were read before the change
+	ShaderPreprocessor::Evict(path);
+	for (Shader* target : targets) {
+		for (const SourceFile& file : target->_sourceFiles) {
+			ShaderStage::Evict(file.Path);
+		}
+	}
+	for (Shader* target : targets) {
+		// The replacement goes straight to AttachStage, so it doesn't get picked up by Reload itself
+		std::unique_ptr<Shader> replacement = std::make_unique<Shader>();
+		try {
+			for (const SourceFile& file : target->_sourceFiles) {
+				replacement->AttachStage(ShaderStage::Get(file.Path, file.Type, file.Defines));
+			}
+		} catch (const std::runtime_error&) {
+			// Editors sometimes replace a file by deleting it first, we'll get another go once it's back
+			LOG_WARN("Can't reload shader program {} while one of it's files is missing", target->_handle);
+			continue;
+		}
+		replacement->LinkAsync();
+		// A build that was already under way for an older version of the file gets dropped
+		_reloads[target] = std::move(replacement);
+	}
+	return static_cast<uint32_t>(targets.size());
+}
 
-		// Create a new character buffer for the log
-		char* log = new char[logSize];
+void Shader::UpdateReloads() {
+	std::lock_guard<std::recursive_mutex> lock(_fileShadersLock);
+	for (auto it = _reloads.begin(); it != _reloads.end();) {
+		Shader& replacement = *it->second;
+		if (!replacement.IsReady() && !replacement.HasFailed()) {
+			++it;
+			continue;
+		}
+		if (replacement.HasFailed()) {
+			LOG_WARN("Reloaded shader program {} failed to build, keeping the old one", it->first->_handle);
+		} else {
+			it->first->_TakeProgram(replacement);
+			LOG_INFO("Reloaded shader program {}", it->first->_handle);
+		}
+		// Deleting the replacement deletes the program we just swapped out of the target
+		it = _reloads.erase(it);
+	}
+}
 
-		// Get the log
-		glGetShaderInfoLog(handle, logSize, &logSize, log);
+void Shader::_TakeProgram(Shader& other) {
+	other._CopyUniforms(_handle);
+	std::swap(_handle, other._handle);
+	std::swap(_status, other._status);
+	std::swap(_cacheKey, other._cacheKey);
+	std::swap(_materialBlock, other._materialBlock);
+	std::swap(_hashedLocations, other._hashedLocations);
+	std::swap(_uniformLocs, other._uniformLocs);
+	// Uniform values live in the program, so whatever the last material set is gone
+	_lastMaterialId = UINT32_MAX;
+}
 
-		// Dump error log
-		LOG_ERROR("Failed to compile shader part:\n{}", log);
+void Shader::_CopyUniforms(GLuint from) {
+	GLint uniformCount = 0, maxNameLength = 0;
+	glGetProgramInterfaceiv(from, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+	glGetProgramInterfaceiv(from, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
 
-		// Clean up our log memory
-		delete[] log;
+	static const GLenum properties[] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE };
+	static const GLenum typeProperty[] = { GL_TYPE };
+	std::vector<char> name(maxNameLength + 1);
+	for (GLint ix = 0; ix < uniformCount; ix++) {
+		GLint values[3] = { -1, 0, 0 };
+		glGetProgramResourceiv(from, GL_UNIFORM, ix, 3, properties, 3, nullptr, values);
+		// Uniforms inside of blocks don't have a location
+		if (values[0] == -1) {
+			continue;
+		}
+		GLsizei length = 0;
+		glGetProgramResourceName(from, GL_UNIFORM, ix, static_cast<GLsizei>(name.size()), &length, name.data());
+		std::string baseName(name.data(), length);
+		if (length > 3 && baseName.compare(length - 3, 3, "[0]") == 0) {
+			baseName.resize(length - 3);
+		}
+		// The uniform might have changed type in the edit, in which case there's nothing sensible to copy
+		const GLuint index = glGetProgramResourceIndex(_handle, GL_UNIFORM, name.data());
+		GLint type = 0;
+		if (index != GL_INVALID_INDEX) {
+			glGetProgramResourceiv(_handle, GL_UNIFORM, index, 1, typeProperty, 1, nullptr, &type);
+		}
+		if (type != values[1]) {
+			continue;
+		}
 
-		// Delete the broken shader result
-		glDeleteShader(handle);
-		handle = 0;
+		for (GLint element = 0; element < values[2]; element++) {
+			const std::string elementName = values[2] > 1 ? baseName + "[" + std::to_string(element) + "]" : baseName;
+			const GLint source = glGetUniformLocation(from, elementName.c_str());
+			const GLint target = glGetUniformLocation(_handle, elementName.c_str());
+			if (source == -1 || target == -1) {
+				continue;
+			}
+			float floats[16];
+			GLint ints[4];
+			switch (type) {
+				case GL_FLOAT:      glGetUniformfv(from, source, floats); glProgramUniform1fv(_handle, target, 1, floats); break;
+				case GL_FLOAT_VEC2: glGetUniformfv(from, source, floats); glProgramUniform2fv(_handle, target, 1, floats); break;
+				case GL_FLOAT_VEC3: glGetUniformfv(from, source, floats); glProgramUniform3fv(_handle, target, 1, floats); break;
+				case GL_FLOAT_VEC4: glGetUniformfv(from, source, floats); glProgramUniform4fv(_handle, target, 1, floats); break;
+				case GL_FLOAT_MAT3: glGetUniformfv(from, source, floats); glProgramUniformMatrix3fv(_handle, target, 1, GL_FALSE, floats); break;
+				case GL_FLOAT_MAT4: glGetUniformfv(from, source, floats); glProgramUniformMatrix4fv(_handle, target, 1, GL_FALSE, floats); break;
+				case GL_INT:
+				case GL_BOOL:       glGetUniformiv(from, source, ints); glProgramUniform1iv(_handle, target, 1, ints); break;
+				case GL_INT_VEC2:
+				case GL_BOOL_VEC2:  glGetUniformiv(from, source, ints); glProgramUniform2iv(_handle, target, 1, ints); break;
+				case GL_INT_VEC3:
+				case GL_BOOL_VEC3:  glGetUniformiv(from, source, ints); glProgramUniform3iv(_handle, target, 1, ints); break;
+				case GL_INT_VEC4:
+				case GL_BOOL_VEC4:  glGetUniformiv(from, source, ints); glProgramUniform4iv(_handle, target, 1, ints); break;
+				// Samplers are bound by the shaders themselves, and nothing else we use keeps a value between frames
+				default: break;
+			}
+		}
 	}
+}
 
-	switch (type) {
-		case GL_VERTEX_SHADER: _vs = handle; break;
-		case GL_FRAGMENT_SHADER: _fs = handle; break;
-		default: LOG_WARN("Not implemented"); break;
+void Shader::AttachStage(const ShaderStage::sptr& stage) {
+	LOG_ASSERT(_status == LinkStatus::Unlinked, "Cannot attach stages to a shader that has already been linked!");
+	// Only one stage of each type is allowed, so replace any existing one. We keep them sorted by type so that
+	// the binary cache key does not depend on the order they were loaded in
+	auto it = std::find_if(_stages.begin(), _stages.end(), [&](const ShaderStage::sptr& s) { return s->GetType() >= stage->GetType(); });
+	if (it != _stages.end() && (*it)->GetType() == stage->GetType()) {
+		*it = stage;
+	} else {
+		_stages.insert(it, stage);
 	}
+}
 
-	return status != GL_FALSE;
+bool Shader::_HasStage(GLenum type) const {
+	return std::any_of(_stages.begin(), _stages.end(), [&](const ShaderStage::sptr& s) { return s->GetType() == type; });
 }
 
-bool Shader::LoadShaderPartFromFile(const char* path, GLenum type) {
-	std::ifstream file(path);
-	if (!file.is_open()) {
-		LOG_ERROR("File not found: {}", path);
-		throw std::runtime_error("File not found, see logs for more information");
+// Not in our glad loader, so we grab it ourselves (see InitParallelCompile)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+bool Shader::_isParallelCompileSupported = false;
+
+bool Shader::InitParallelCompile(GLADloadproc loader, uint32_t threadCount) {
+	_isParallelCompileSupported = false;
+	GLint extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for (GLint ix = 0; ix < extensionCount; ix++) {
+		const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, ix));
+		if (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0) {
+			_isParallelCompileSupported = true;
+			break;
+		}
 	}
-	std::stringstream stream;
-	stream << file.rdbuf();
-	bool result = LoadShaderPart(stream.str().c_str(), type);
-	file.close();
-	return result;
+	if (!_isParallelCompileSupported) {
+		LOG_INFO("Parallel shader compilation is not supported, shaders will link synchronously");
+		return false;
+	}
+
+	// Both extensions use the same entry point, just with a different suffix
+	PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsKHR");
+	if (maxThreads == nullptr) {
+		maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsARB");
+	}
+	if (maxThreads != nullptr) {
+		maxThreads(threadCount);
+	}
+	LOG_INFO("Parallel shader compilation enabled");
+	return true;
 }
 
 bool Shader::Link()
 {
-	LOG_ASSERT(_vs != 0 && _fs != 0, "Must attach both a vertex and fragment shader!");
+	LinkAsync();
+	return WaitUntilReady();
+}
+
+bool Shader::WaitUntilReady() {
+	if (_status == LinkStatus::Compiling || _status == LinkStatus::Linking) {
+		return _Poll(true);
+	}
+	return _status == LinkStatus::Ready;
+}
+
+void Shader::LinkAsync()
+{
+	LOG_ASSERT(_HasStage(GL_COMPUTE_SHADER) ? _stages.size() == 1 : (_HasStage(GL_VERTEX_SHADER) && _HasStage(GL_FRAGMENT_SHADER)),
+		"Must attach both a vertex and fragment shader, or a single compute shader!");
+	LOG_ASSERT(_status == LinkStatus::Unlinked, "Shader has already been linked!");
+
+	// If we've linked this exact program on this driver before, we can skip compiling entirely
+	_cacheKey = _ComputeCacheKey();
+	if (_LoadCachedBinary(_cacheKey)) {
+		// We don't need the stages any more
+		_stages.clear();
+		_ReflectUniforms();
+		_ReflectMaterialBlock();
+		_status = LinkStatus::Ready;
+		return;
+	}
+
+	// Shared stages may already be compiled (or compiling) for another program
+	for (const ShaderStage::sptr& stage : _stages) {
+		stage->Compile();
+	}
+	_status = LinkStatus::Compiling;
+}
 
-	// Attach our two shaders
-	glAttachShader(_handle, _vs);
-	glAttachShader(_handle, _fs);
+bool Shader::IsReady() {
+	if (_status == LinkStatus::Compiling || _status == LinkStatus::Linking) {
+		return _Poll(false);
+	}
+	return _status == LinkStatus::Ready;
+}
 
-	// Perform linking
-	glLinkProgram(_handle);
+bool Shader::_Poll(bool block) {
+	if (_status == LinkStatus::Compiling) {
+		// Without the extension, the status queries below are what block us until the work is done
+		if (!block) {
+			for (const ShaderStage::sptr& stage : _stages) {
+				if (!stage->IsComplete(_isParallelCompileSupported)) {
+					return false;
+				}
+			}
+		}
 
-	// Remove shader parts to save space (we can do this since we only needed the shader parts to compile an actual shader program)
-	glDetachShader(_handle, _vs);
-	glDeleteShader(_vs);
-	glDetachShader(_handle, _fs);
-	glDeleteShader(_fs);
+		bool compiled = true;
+		for (const ShaderStage::sptr& stage : _stages) {
+			compiled = stage->CheckStatus() && compiled;
+		}
+		if (!compiled) {
+			_stages.clear();
+			_status = LinkStatus::Failed;
+			return false;
+		}
+
+		// Attach all our stages
+		for (const ShaderStage::sptr& stage : _stages) {
+			glAttachShader(_handle, stage->GetHandle());
+		}
 
+		// Let the driver know we'll be asking for the binary, so it holds on to it
+		if (!BinaryCacheDirectory.empty()) {
+			glProgramParameteri(_handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+
+		// Perform linking
+		glLinkProgram(_handle);
+
+		// Remove shader parts to save space (we can do this since we only needed the shader parts to compile an actual shader program)
+		// The stages themselves get deleted once every program that shares them has linked
+		for (const ShaderStage::sptr& stage : _stages) {
+			glDetachShader(_handle, stage->GetHandle());
+		}
+		_stages.clear();
+		_status = LinkStatus::Linking;
+	}
+
+	if (_status == LinkStatus::Linking) {
+		if (!block && _isParallelCompileSupported) {
+			GLint done = GL_FALSE;
+			glGetProgramiv(_handle, GL_COMPLETION_STATUS_KHR, &done);
+			if (done == GL_FALSE) {
+				return false;
+			}
+		}
+
+		GLint status = 0;
+		glGetProgramiv(_handle, GL_LINK_STATUS, &status);
+
+		if (status == GL_FALSE)
+		{
+			// Get the length of the log
+			GLint length = 0;
+			glGetProgramiv(_handle, GL_INFO_LOG_LENGTH, &length);
+
+			if (length > 0) {
+				// Read the log from openGL
+				char* log = new char[length];
+				glGetProgramInfoLog(_handle, length, &length, log);
+				LOG_ERROR("Shader failed to link:\n{}", log);
+				delete[] log;
+			}
+			else {
+				LOG_ERROR("Shader failed to link for an unknown reason!");
+			}
+			_status = LinkStatus::Failed;
+		} else {
+			_SaveCachedBinary(_cacheKey);
+			_ReflectUniforms();
+			_ReflectMaterialBlock();
+			_status = LinkStatus::Ready;
+		}
+	}
+
+	return _status == LinkStatus::Ready;
+}
+
+// Header for the files in the program binary cache, the binary itself follows right after
+struct ProgramBinaryHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t Key;
+	uint32_t Format;
+	uint32_t Length;
+};
+static const uint32_t PROGRAM_BINARY_MAGIC   = 0x43425053; // "SPBC"
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+std::string Shader::BinaryCacheDirectory = "shader_cache";
+
+uint64_t Shader::_ComputeCacheKey() const {
+	// Binaries are only valid for the driver that created them, so that gets baked into the key as well
+	static const std::string driver = [] {
+		const char* vendor   = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+		const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+		const char* version  = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+		return std::string(vendor ? vendor : "") + "|" + (renderer ? renderer : "") + "|" + (version ? version : "");
+	}();
+
+	// The stage hashes cover the fully expanded source, including any injected defines
+	uint64_t hash = ShaderPreprocessor::HashCombine(ShaderPreprocessor::HASH_SEED, driver.c_str(), driver.size());
+	for (const ShaderStage::sptr& stage : _stages) {
+		const GLenum type = stage->GetType();
+		const uint64_t stageHash = stage->GetSourceHash();
+		hash = ShaderPreprocessor::HashCombine(hash, reinterpret_cast<const char*>(&type), sizeof(GLenum));
+		hash = ShaderPreprocessor::HashCombine(hash, reinterpret_cast<const char*>(&stageHash), sizeof(uint64_t));
+	}
+	return hash;
+}
+
+std::string Shader::_GetCachePath(uint64_t key) {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(BinaryCacheDirectory) / name).string();
+}
+
+bool Shader::_LoadCachedBinary(uint64_t key) {
+	if (BinaryCacheDirectory.empty()) {
+		return false;
+	}
+	std::ifstream file(_GetCachePath(key), std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	ProgramBinaryHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(ProgramBinaryHeader)) ||
+		header.Magic != PROGRAM_BINARY_MAGIC || header.Version != PROGRAM_BINARY_VERSION || header.Key != key) {
+		LOG_WARN("Ignoring invalid program binary cache entry {:016x}", key);
+		return false;
+	}
+	std::vector<char> binary(header.Length);
+	if (!file.read(binary.data(), header.Length)) {
+		LOG_WARN("Program binary cache entry {:016x} is truncated", key);
+		return false;
+	}
+
+	glProgramBinary(_handle, header.Format, binary.data(), header.Length);
+
+	// The driver is allowed to reject the binary (ex: after an update), in which case we fall back to compiling
 	GLint status = 0;
 	glGetProgramiv(_handle, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE) {
+		LOG_INFO("Driver rejected program binary {:016x}, recompiling from source", key);
+		return false;
+	}
+	return true;
+}
 
-	if (status == GL_FALSE)
-	{
-		// Get the length of the log
-		GLint length = 0;
-		glGetProgramiv(_handle, GL_INFO_LOG_LENGTH, &length);
+void Shader::_SaveCachedBinary(uint64_t key) {
+	if (BinaryCacheDirectory.empty()) {
+		return;
+	}
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	if (formatCount == 0) {
+		return;
+	}
 
-		if (length > 0) {
-			// Read the log from openGL
-			char* log = new char[length];
-			glGetProgramInfoLog(_handle, length, &length, log);
-			LOG_ERROR("Shader failed to link:\n{}", log);
-			delete[] log;
+	GLint length = 0;
+	glGetProgramiv(_handle, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(_handle, length, &length, &format, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(BinaryCacheDirectory, error);
+	std::ofstream file(_GetCachePath(key), std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		LOG_WARN("Failed to write program binary cache entry {:016x}", key);
+		return;
+	}
+	ProgramBinaryHeader header = { PROGRAM_BINARY_MAGIC, PROGRAM_BINARY_VERSION, key, format, static_cast<uint32_t>(length) };
+	file.write(reinterpret_cast<const char*>(&header), sizeof(ProgramBinaryHeader));
+	file.write(binary.data(), length);
+}
+
+void Shader::_ReflectUniforms() {
+	_hashedLocations.clear();
+
+	GLint uniformCount = 0, maxNameLength = 0;
+	glGetProgramInterfaceiv(_handle, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+	glGetProgramInterfaceiv(_handle, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+
+	static const GLenum properties[] = { GL_LOCATION };
+	std::vector<char> name(maxNameLength + 1);
+	for (GLint ix = 0; ix < uniformCount; ix++) {
+		GLint location = -1;
+		glGetProgramResourceiv(_handle, GL_UNIFORM, ix, 1, properties, 1, nullptr, &location);
+		// Uniforms inside of blocks don't have a location
+		if (location == -1) {
+			continue;
+		}
+		GLsizei length = 0;
+		glGetProgramResourceName(_handle, GL_UNIFORM, ix, static_cast<GLsizei>(name.size()), &length, name.data());
+		// Arrays are reported as name[0], but we want to be able to find them by their plain name as well
+		if (length > 3 && strncmp(name.data() + length - 3, "[0]", 3) == 0) {
+			_hashedLocations.push_back({ entt::hashed_string::value(name.data(), length - 3), location });
 		}
-		else {
-			LOG_ERROR("Shader failed to link for an unknown reason!");
+		_hashedLocations.push_back({ entt::hashed_string::value(name.data(), length), location });
+	}
+
+	std::sort(_hashedLocations.begin(), _hashedLocations.end(), [](const HashedLocation& a, const HashedLocation& b) {
+		return a.Hash < b.Hash;
+	});
+	for (size_t ix = 1; ix < _hashedLocations.size(); ix++) {
+		if (_hashedLocations[ix].Hash == _hashedLocations[ix - 1].Hash) {
+			LOG_WARN("Two uniforms in program {} have the same name hash, one of them can only be set by name", _handle);
+		}
+	}
+}
+
+bool Shader::ValidateVertexInputs(const std::vector<const std::vector<BufferAttribute>*>& streams, const std::vector<BufferAttribute>* instanceStream) {
+	if (_status != LinkStatus::Ready) {
+		return true;
+	}
+	// Finds the attribute feeding a slot, and whether it comes from the instance stream
+	auto findAttribute = [&](GLuint slot, bool& isInstanced) -> const BufferAttribute* {
+		for (const std::vector<BufferAttribute>* stream : streams) {
+			for (const BufferAttribute& attrib : *stream) {
+				if (attrib.Slot == slot) {
+					isInstanced = false;
+					return &attrib;
+				}
+			}
+		}
+		if (instanceStream != nullptr) {
+			for (const BufferAttribute& attrib : *instanceStream) {
+				if (attrib.Slot == slot) {
+					isInstanced = true;
+					return &attrib;
+				}
+			}
+		}
+		return nullptr;
+	};
+
+	GLint inputCount = 0, maxNameLength = 0;
+	glGetProgramInterfaceiv(_handle, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &inputCount);
+	glGetProgramInterfaceiv(_handle, GL_PROGRAM_INPUT, GL_MAX_NAME_LENGTH, &maxNameLength);
+	std::vector<char> name(maxNameLength + 1);
+	static const GLenum properties[] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE };
+	bool result = true;
+	for (GLint ix = 0; ix < inputCount; ix++) {
+		GLint values[3] = { -1, 0, 1 };
+		glGetProgramResourceiv(_handle, GL_PROGRAM_INPUT, ix, 3, properties, 3, nullptr, values);
+		// Built in inputs (ex: gl_VertexID) don't have a location
+		if (values[0] == -1) {
+			continue;
+		}
+		glGetProgramResourceName(_handle, GL_PROGRAM_INPUT, ix, static_cast<GLsizei>(name.size()), nullptr, name.data());
+
+		// Matrices take up a slot per column, as do arrays per element
+		GLint slotCount = values[2];
+		bool isInteger = false;
+		switch (values[1]) {
+			case GL_FLOAT_MAT2: slotCount *= 2; break;
+			case GL_FLOAT_MAT3: slotCount *= 3; break;
+			case GL_FLOAT_MAT4: slotCount *= 4; break;
+			case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+			case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+				isInteger = true;
+				break;
+			default: break;
+		}
+		for (GLint slot = values[0]; slot < values[0] + slotCount; slot++) {
+			bool isInstanced = false;
+			const BufferAttribute* attrib = findAttribute(static_cast<GLuint>(slot), isInstanced);
+			if (attrib == nullptr) {
+				LOG_WARN("Program {} reads {} from location {}, which none of it's vertex buffers feed", _handle, name.data(), slot);
+				result = false;
+				continue;
+			}
+			const bool isIntegerAttrib = isInstanced && !attrib->Normalized && (attrib->Type == GL_INT || attrib->Type == GL_UNSIGNED_INT);
+			if (isInteger != isIntegerAttrib) {
+				LOG_WARN("Program {} reads {} from location {} as {}, but it's fed as {}", _handle, name.data(), slot,
+					isInteger ? "an integer" : "a float", isIntegerAttrib ? "an integer" : "a float");
+				result = false;
+			}
+		}
+	}
+	return result;
+}
+
+int Shader::GetUniformLocation(UniformHandle handle) const {
+	auto it = std::lower_bound(_hashedLocations.begin(), _hashedLocations.end(), handle.Hash, [](const HashedLocation& entry, uint32_t hash) {
+		return entry.Hash < hash;
+	});
+	return (it != _hashedLocations.end() && it->Hash == handle.Hash) ? it->Location : -1;
+}
+
+void Shader::_ReflectMaterialBlock() {
+	_materialBlock = MaterialBlockLayout();
+
+	GLuint blockIndex = glGetProgramResourceIndex(_handle, GL_SHADER_STORAGE_BLOCK, "b_MaterialData");
+	if (blockIndex == GL_INVALID_INDEX) {
+		return;
+	}
+
+	GLint variableCount = 0, maxNameLength = 0;
+	glGetProgramInterfaceiv(_handle, GL_BUFFER_VARIABLE, GL_ACTIVE_RESOURCES, &variableCount);
+	glGetProgramInterfaceiv(_handle, GL_BUFFER_VARIABLE, GL_MAX_NAME_LENGTH, &maxNameLength);
+
+	// Members of the array are reported as u_Materials[0].<member>, the stride is the same for all of them
+	static const std::string prefix = "u_Materials[0].";
+	static const GLenum properties[] = { GL_BLOCK_INDEX, GL_OFFSET, GL_TOP_LEVEL_ARRAY_STRIDE };
+	std::vector<char> name(maxNameLength + 1);
+	for (GLint ix = 0; ix < variableCount; ix++) {
+		GLint values[3];
+		glGetProgramResourceiv(_handle, GL_BUFFER_VARIABLE, ix, 3, properties, 3, nullptr, values);
+		if (values[0] != static_cast<GLint>(blockIndex)) {
+			continue;
+		}
+		GLsizei length = 0;
+		glGetProgramResourceName(_handle, GL_BUFFER_VARIABLE, ix, static_cast<GLsizei>(name.size()), &length, name.data());
+		std::string member(name.data(), length);
+		if (member.compare(0, prefix.size(), prefix) == 0) {
+			_materialBlock.Offsets[member.substr(prefix.size())] = static_cast<uint32_t>(values[1]);
+			_materialBlock.Stride = static_cast<uint32_t>(values[2]);
 		}
 	}
-	return status != GL_FALSE;
 }
 
 void Shader::Bind() {
-	glUseProgram(_handle);
+	RenderState::UseProgram(_handle);
 }
 
 void Shader::UnBind() {
-	glUseProgram(0);
+	RenderState::UseProgram(0);
 }
 
 void Shader::SetUniformMatrix(int location, const glm::mat3* value, int count, bool transposed) {
+	RenderStats::CountUniformUpload();
 	glProgramUniformMatrix3fv(_handle, location, count, transposed, glm::value_ptr(*value));
 }
 void Shader::SetUniformMatrix(int location, const glm::mat4* value, int count, bool transposed) {
+	RenderStats::CountUniformUpload();
 	glProgramUniformMatrix4fv(_handle, location, count, transposed, glm::value_ptr(*value));
 }
 void Shader::SetUniform(int location, const float* value, int count) {
+	RenderStats::CountUniformUpload();
 	glProgramUniform1fv(_handle, location, count, value);
 }
 void Shader::SetUniform(int location, const glm::vec2* value, int count) {
+	RenderStats::CountUniformUpload();
 	glProgramUniform2fv(_handle, location, count, glm::value_ptr(*value));
 }
 void Shader::SetUniform(int location, const glm::vec3* value, int count) {
+	RenderStats::CountUniformUpload();
 	glProgramUniform3fv(_handle, location, count, glm::value_ptr(*value));
 }
 void Shader::SetUniform(int location, const glm::vec4* value, int count) {
+	RenderStats::CountUniformUpload();
 	glProgramUniform4fv(_handle, location, count, glm::value_ptr(*value));
 }
 
 void Shader::SetUniform(int location, const int* value, int count) {
+	RenderStats::CountUniformUpload();
 	glProgramUniform1iv(_handle, location, count, value);
 }
 void Shader::SetUniform(int location, const glm::ivec2* value, int count) {
+	RenderStats::CountUniformUpload();
 	glProgramUniform2iv(_handle, location, count, glm::value_ptr(*value));
 }
 void Shader::SetUniform(int location, const glm::ivec3* value, int count) {
+	RenderStats::CountUniformUpload();
 	glProgramUniform3iv(_handle, location, count, glm::value_ptr(*value));
 }
 void Shader::SetUniform(int location, const glm::ivec4* value, int count) {
+	RenderStats::CountUniformUpload();
 	glProgramUniform4iv(_handle, location, count, glm::value_ptr(*value));
 }
 
 void Shader::SetUniform(int location, const bool* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
+	RenderStats::CountUniformUpload();
 	glProgramUniform1i(location, *value, 1);
 }
 void Shader::SetUniform(int location, const glm::bvec2* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
+	RenderStats::CountUniformUpload();
 	glProgramUniform2i(location, value->x, value->y, 1);
 }
 void Shader::SetUniform(int location, const glm::bvec3* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
+	RenderStats::CountUniformUpload();
 	glProgramUniform3i(location, value->x, value->y, value->z, 1);
 }
 void Shader::SetUniform(int location, const glm::bvec4* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
+	RenderStats::CountUniformUpload();
 	glProgramUniform4i(location, value->x, value->y, value->z, value->w, 1);
 }
 
 int Shader::GetUniformLocation(const std::string& name) {
+	// We can't look anything up until the program is linked, and we don't want to cache the misses
+	if (_status != LinkStatus::Ready) {
+		return -1;
+	}
 	// Search the map for the given name
 	std::unordered_map<std::string, int>::const_iterator it = _uniformLocs.find(name);
 	int result = -1;
@@ -1,12 +1,18 @@
 #pragma once
 #include <glad/glad.h>
 #include <memory>
+#include <mutex>
 
 #include <string>               // for std::string
 #include <unordered_map>        // for std::unordered_map
+#include <unordered_set>        // for std::unordered_set
+#include <vector>               // for std::vector
 #include <GLM/glm.hpp>          // for our GLM types
 #include <GLM/gtc/type_ptr.hpp> // for glm::value_ptr
 #include "Logging.h"            // for the logging functions
+#include "BufferAttribute.h"    // for BufferAttribute
+#include "UniformHandle.h"      // for UniformHandle
+#include "ShaderStage.h"        // for ShaderStage
 
 /// <summary>
 /// This class will wrap around an OpenGL shader program
@@ -36,26 +42,115 @@ public:
 	// Note, we don't need to make this virtual since this class is marked final (basically it can't be used as a base class)
 	~Shader();
 
+	/// <summary>
+	/// The folder that linked program binaries get cached in, keyed by a hash of their source and the driver. Set to
+	/// an empty string to always compile from source
+	/// </summary>
+	static std::string BinaryCacheDirectory;
+
 	/// <summary>
 	/// Loads a single shader stage into this shader object (ex: Vertex Shader or Fragment Shader)
+	/// Note that the stage is not compiled until Link is called, so any compile errors are reported from there
 	/// </summary>
 	/// <param name="source">The source code of the shader to load</param>
-	/// <param name="type">The stage to load (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)</param>
-	/// <returns>True if the shader is loaded, false if there was an issue</returns>
+	/// <param name="type">The stage to load (GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER, GL_COMPUTE_SHADER, etc...)</param>
+	/// <returns>True if the shader is loaded, false if the stage type is not supported</returns>
 	bool LoadShaderPart(const char* source, GLenum type);
 	/// <summary>
 	/// Loads a single shader stage into this shader object (ex: Vertex Shader or Fragment Shader) from an external file (in res)
 	/// </summary>
 	/// <param name="path">The relative path to the file containing the source</param>
-	/// <param name="type">The stage to load (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)</param>
+	/// <param name="type">The stage to load (GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER, GL_COMPUTE_SHADER, etc...)</param>
 	/// <returns>True if the shader is loaded, false if there was an issue</returns>
 	bool LoadShaderPartFromFile(const char* path, GLenum type);
+	/// <summary>
+	/// Loads a single shader stage from an external file, injecting a #define for each of the given names right after
+	/// the #version directive (used to compile permutations of a single source file)
+	/// </summary>
+	/// <param name="path">The relative path to the file containing the source</param>
+	/// <param name="type">The stage to load (GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER, GL_COMPUTE_SHADER, etc...)</param>
+	/// <param name="defines">The names to #define before the rest of the source</param>
+	/// <returns>True if the shader is loaded, false if there was an issue</returns>
+	bool LoadShaderPartFromFile(const char* path, GLenum type, const std::vector<std::string>& defines);
 
 	/// <summary>
-	/// Links the vertex and fragment shader, and allows this shader program to be used
+	/// A stage to load with LoadSpecialized
+	/// </summary>
+	struct FilePart {
+		std::string Path;
+		GLenum      Type;
+		// The values for the stage's specialization constants, OpenGL won't specialize a module with constants it
+		// doesn't have so each stage only gets it's own
+		std::vector<ShaderStage::Constant> Constants;
+	};
+	/// <summary>
+	/// Loads every stage of a program from files, along with values for their specialization constants. When the
+	/// driver supports it and every stage has an up to date SPIR-V module (see ShaderCook), the modules are loaded and
+	/// specialized so the driver has no GLSL to compile. Otherwise the GLSL is compiled with each constant passed
+	/// in as a define, see shaders/include/specialization.glsl. SPIR-V and GLSL stages can't be linked together, so
+	/// this should be the only thing that loads stages into the program
+	/// </summary>
+	/// <param name="parts">The files to load each stage from, and the constants to give them</param>
+	/// <returns>True if the stages are loaded, false if a stage type is not supported</returns>
+	bool LoadSpecialized(const std::vector<FilePart>& parts);
+
+	/// <summary>
+	/// Attaches a stage to this shader, replacing any stage of the same type. Stages can be shared between programs
+	/// </summary>
+	/// <param name="stage">The stage to attach</param>
+	void AttachStage(const ShaderStage::sptr& stage);
+
+	/// <summary>
+	/// Links the vertex and fragment shader, and allows this shader program to be used. If the program binary
+	/// cache has an entry for the same source on the same driver, it is loaded instead of compiling the stages
+	/// This blocks until the program is ready, see LinkAsync for a version that lets the driver work in the background
 	/// </summary>
 	/// <returns>True if the linking was sucessful, false if otherwise</returns>
 	bool Link();
+	/// <summary>
+	/// Starts compiling and linking the program without waiting on the driver. Poll IsReady to find out when it can
+	/// be used, until then uniform lookups will fail and the shader should not be bound
+	/// </summary>
+	void LinkAsync();
+	/// <summary>
+	/// Checks whether the program has finished linking, advancing the compile if the driver is done with the
+	/// current step. This never blocks when parallel compilation is enabled
+	/// </summary>
+	/// <returns>True if the program linked and is ready to use</returns>
+	bool IsReady();
+	/// <summary>
+	/// Returns true if the program failed to compile or link
+	/// </summary>
+	bool HasFailed() const { return _status == LinkStatus::Failed; }
+	/// <summary>
+	/// Blocks until a program started with LinkAsync has finished linking
+	/// </summary>
+	/// <returns>True if the program linked and is ready to use</returns>
+	bool WaitUntilReady();
+
+	/// <summary>
+	/// Enables GL_KHR_parallel_shader_compile if the driver supports it, so that LinkAsync can run in the
+	/// background. Should be called once after the OpenGL context is created
+	/// </summary>
+	/// <param name="loader">The function to look up GL entry points with (ex: glfwGetProcAddress)</param>
+	/// <param name="threadCount">The maximum number of background compiler threads the driver may use</param>
+	/// <returns>True if parallel compilation is supported</returns>
+	static bool InitParallelCompile(GLADloadproc loader, uint32_t threadCount = 0xFFFFFFFF);
+
+	/// <summary>
+	/// Starts rebuilding every program that has a stage loaded from the given file, in the background. The programs
+	/// keep drawing with what they have until UpdateReloads swaps the new ones in, so everything holding on to them
+	/// picks up the change without being touched
+	/// </summary>
+	/// <param name="path">The path of the file that changed, as it was passed to LoadShaderPartFromFile</param>
+	/// <returns>The number of programs being rebuilt</returns>
+	static uint32_t Reload(const std::string& path);
+	/// <summary>
+	/// Swaps in the programs started by Reload that have finished linking, should be called once per frame. The
+	/// values of plain uniforms are copied over, but the material block layout (see GetMaterialBlock) is only read
+	/// by materials when they're created. Programs that fail to build keep the one they had
+	/// </summary>
+	static void UpdateReloads();
 
 	/// <summary>
 	/// Binds this shader for use
@@ -70,9 +165,75 @@ public:
 	/// Gets the underlying OpenGL handle that this class is wrapping
 	/// </summary>
 	GLuint GetHandle() const { return _handle; }
+
+	/// <summary>
+	/// Describes the layout of the per-material structure that this shader reads out of the shared material
+	/// buffer (the b_MaterialData block, see UniformBlocks.h)
+	/// </summary>
+	struct MaterialBlockLayout {
+		/// <summary>
+		/// The size of one entry in the u_Materials array, or 0 if the shader does not use the material buffer
+		/// </summary>
+		uint32_t Stride = 0;
+		/// <summary>
+		/// The byte offset of each member within an entry, keyed by member name
+		/// </summary>
+		std::unordered_map<std::string, uint32_t> Offsets;
+	};
+
+	/// <summary>
+	/// Gets the material block layout reflected from the program when it was linked
+	/// </summary>
+	const MaterialBlockLayout& GetMaterialBlock() const { return _materialBlock; }
+
+	/// <summary>
+	/// Checks the vertex shader's inputs against the vertex declarations it'll be drawn with, using the linked
+	/// program's reflection. Every input has to be fed by an attribute, and integer inputs need integer attributes
+	/// from the instance stream, since that's the only one that keeps them as integers (see VertexLayout). Anything
+	/// that doesn't line up gets logged. Meant to be called once per program and vertex type, when it's set up
+	/// </summary>
+	/// <param name="streams">The declarations of the vertex buffers the program will be drawn with</param>
+	/// <param name="instanceStream">The declaration of the per-instance buffer, or nullptr if there isn't one</param>
+	/// <returns>True if every input is fed properly, or if the program isn't linked yet</returns>
+	bool ValidateVertexInputs(const std::vector<const std::vector<BufferAttribute>*>& streams, const std::vector<BufferAttribute>* instanceStream = nullptr);
+
+	/// <summary>
+	/// Gets the ID of the material that last submitted its parameters to this shader, since uniform values are
+	/// stored per-program a material that was also the last to be applied only needs to resubmit what changed
+	/// </summary>
+	uint32_t GetLastMaterialId() const { return _lastMaterialId; }
+	/// <summary>
+	/// Records which material last submitted its parameters to this shader
+	/// </summary>
+	void SetLastMaterialId(uint32_t id) { _lastMaterialId = id; }
 	
 public:
 	int GetUniformLocation(const std::string& name);
+	/// <summary>
+	/// Gets the location of a uniform from it's compile time hashed name, this is a search over the uniforms we
+	/// reflected at link time and does not touch any strings. Returns -1 if the uniform is not active
+	/// </summary>
+	int GetUniformLocation(UniformHandle handle) const;
+	
+	template <typename T>
+	void SetUniform(UniformHandle handle, const T& value) {
+		int location = GetUniformLocation(handle);
+		if (location != -1) {
+			SetUniform(location, &value, 1);
+		}
+	}
+	template <typename T>
+	void SetUniformMatrix(UniformHandle handle, const T& value, bool transposed = false) {
+		int location = GetUniformLocation(handle);
+		if (location != -1) {
+			SetUniformMatrix(location, &value, 1, transposed);
+		}
+	}
+	// Hashed strings convert to their integer hash, so we need exact overloads to keep them from being taken as locations
+	template <typename T>
+	void SetUniform(const entt::hashed_string& name, const T& value) { SetUniform(UniformHandle(name), value); }
+	template <typename T>
+	void SetUniformMatrix(const entt::hashed_string& name, const T& value, bool transposed = false) { SetUniformMatrix(UniformHandle(name), value, transposed); }
 	
 	template <typename T>
 	void SetUniform(const std::string& name, const T& value) {
@@ -117,10 +278,69 @@ public:
 	void SetUniform(int location, const glm::bvec4* value, int count = 1);
 	
 protected:
-	GLuint _vs;
-	GLuint _fs;
+	// The stages we'll link together, sorted by type. These get released once we've linked
+	std::vector<ShaderStage::sptr> _stages;
+
+	// A stage that came from a file, so that we can build it again if the file changes
+	struct SourceFile {
+		std::string              Path;
+		GLenum                   Type;
+		std::vector<std::string> Defines;
+	};
+	std::vector<SourceFile> _sourceFiles;
+	// The programs with stages from files. Programs are made on the main thread, but the last reference to one can go
+	// anywhere (see GpuDeletionQueue), so these are locked. It's recursive since dropping a reload destroys a program
+	static std::unordered_set<Shader*> _fileShaders;
+	// The programs being built by Reload, keyed by the program they're replacing
+	static std::unordered_map<Shader*, std::unique_ptr<Shader>> _reloads;
+	static std::recursive_mutex _fileShadersLock;
+
+	// Takes over the linked program of another shader, giving it ours to delete
+	void _TakeProgram(Shader& other);
+	// Copies the values of the plain (non-block, non-sampler) uniforms from another program into ours
+	void _CopyUniforms(GLuint from);
+
+	// Where the program is in the compile, link, ready process
+	enum class LinkStatus : uint8_t {
+		Unlinked,
+		Compiling,
+		Linking,
+		Ready,
+		Failed
+	};
+	LinkStatus _status;
+	uint64_t   _cacheKey;
+
+	static bool _isParallelCompileSupported;
 	
 	GLuint _handle;
+	uint32_t _lastMaterialId;
+	MaterialBlockLayout _materialBlock;
+
+	// Returns true if we have a stage of the given type attached
+	bool _HasStage(GLenum type) const;
+	// Advances the compile and link as far as the driver allows, if block is true waits for it to finish
+	bool _Poll(bool block);
+	// Hashes the stage sources along with the driver's identity, to find the program in the binary cache
+	uint64_t _ComputeCacheKey() const;
+	// Gets the file path for a program binary cache entry
+	static std::string _GetCachePath(uint64_t key);
+	// Tries to load the program from the binary cache, returns false if it is not cached or the driver rejected it
+	bool _LoadCachedBinary(uint64_t key);
+	// Writes the linked program into the binary cache
+	void _SaveCachedBinary(uint64_t key);
+
+	// Reads the layout of the b_MaterialData block (if present) from the linked program
+	void _ReflectMaterialBlock();
+	// Builds the table of uniform name hashes to locations for all the active uniforms in the linked program
+	void _ReflectUniforms();
+
+	// A uniform's name hash and location, kept sorted by hash
+	struct HashedLocation {
+		uint32_t Hash;
+		int      Location;
+	};
+	std::vector<HashedLocation> _hashedLocations;
 
 	std::unordered_map<std::string, int> _uniformLocs;
 	
@@ -0,0 +1,87 @@
+#include "ShaderCook.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "Logging.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderStage.h"
+
+std::string ShaderCook::Compiler = "glslangValidator";
+
+bool ShaderCook::CookFile(const std::string& path) {
+	namespace fs = std::filesystem;
+	const char* stage = GetStageName(path);
+	if (stage == nullptr) {
+		return false;
+	}
+
+	// glslang doesn't know about our includes, so it gets the expanded source instead of the file
+	std::shared_ptr<const ShaderPreprocessor::Source> source;
+	try {
+		source = ShaderPreprocessor::Expand(path);
+	} catch (const std::runtime_error&) {
+		return false;
+	}
+	std::error_code error;
+	const fs::path expandedPath = fs::temp_directory_path(error) / (fs::path(path).filename().string() + ".expanded");
+	{
+		std::ofstream expanded(expandedPath, std::ios::binary);
+		expanded.write(source->Text.c_str(), source->Text.size());
+		if (!expanded.good()) {
+			LOG_WARN("Failed to write the expanded source of \"{}\" to \"{}\"", path, expandedPath.string());
+			return false;
+		}
+	}
+
+	// -G targets OpenGL rather than Vulkan, which also defines GL_SPIRV for the shaders to check
+	const std::string modulePath = ShaderStage::GetSpirvPath(path);
+	std::string command = "\"" + Compiler + "\" -G -S " + stage + " -o \"" + modulePath + "\" \"" + expandedPath.string() + "\"";
+#ifdef _WIN32
+	// cmd strips the outer quotes off of a command that starts with one
+	command = "\"" + command + "\"";
+#endif
+	const int result = std::system(command.c_str());
+	fs::remove(expandedPath, error);
+	if (result != 0) {
+		LOG_WARN("Failed to compile \"{}\" to SPIR-V, it will be compiled from GLSL when it loads", path);
+		fs::remove(modulePath, error);
+		return false;
+	}
+	LOG_INFO("Compiled \"{}\" to SPIR-V", path);
+	return true;
+}
+
+uint32_t ShaderCook::CookDirectory(const std::string& path) {
+	std::error_code error;
+	uint32_t cooked = 0;
+	for (auto it = std::filesystem::recursive_directory_iterator(path, error); it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+		if (it->is_directory() && it->path().filename() == "include") {
+			it.disable_recursion_pending();
+		} else if (it->is_regular_file() && GetStageName(it->path().string()) != nullptr) {
+			cooked += CookFile(it->path().generic_string()) ? 1 : 0;
+		}
+	}
+	if (error) {
+		LOG_WARN("Failed to search \"{}\" for shaders: {}", path, error.message());
+	}
+	return cooked;
+}
+
+const char* ShaderCook::GetStageName(const std::string& path) {
+	static const char* STAGES[] = { "vert", "tesc", "tese", "geom", "frag", "comp" };
+	const std::filesystem::path file(path);
+	if (file.extension() != ".glsl") {
+		return nullptr;
+	}
+	// The stage is the extension before .glsl
+	const std::string stage = file.stem().extension().string();
+	for (const char* name : STAGES) {
+		if (stage.size() > 1 && stage.compare(1, std::string::npos, name) == 0) {
+			return name;
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// Compiles our GLSL to SPIR-V modules ahead of time, stored next to each file as [file].spv (see
+/// ShaderStage::GetSpirvPath). Programs loaded with Shader::LoadSpecialized use the modules instead of handing the
+/// driver GLSL to compile, and set their specialization constants when they load
+///
+/// The compiling is done by glslangValidator, after our own preprocessor has expanded the #includes. Only files named
+/// after their stage (ex: post_fxaa.frag.glsl) get cooked. Shaders that set plain uniforms by name can't be used as
+/// SPIR-V in OpenGL (the names don't survive), so those fail to compile here without explicit locations and carry on
+/// using the GLSL
+/// </summary>
+class ShaderCook final
+{
+public:
+	/// <summary>
+	/// The glslangValidator to run, either a full path or a name to find on the PATH
+	/// </summary>
+	static std::string Compiler;
+
+	/// <summary>
+	/// Compiles a GLSL file to a SPIR-V module, must be called on the main thread
+	/// </summary>
+	/// <param name="path">The path of the GLSL file</param>
+	/// <returns>True if the module was written</returns>
+	static bool CookFile(const std::string& path);
+	/// <summary>
+	/// Compiles every GLSL file in a folder (and the folders under it) that's named after it's stage. Files in
+	/// folders named "include" are only ever included, so they're skipped
+	/// </summary>
+	/// <param name="path">The folder to search</param>
+	/// <returns>The number of modules that were written</returns>
+	static uint32_t CookDirectory(const std::string& path);
+
+	/// <summary>
+	/// Gets the glslangValidator name of the stage a file holds from it's name (ex: "frag" for post_fxaa.frag.glsl), or
+	/// nullptr if it isn't named after a stage
+	/// </summary>
+	static const char* GetStageName(const std::string& path);
+
+private:
+	ShaderCook() = default;
+};
@@ -0,0 +1,136 @@
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "Logging.h"
+#include "Utilities/TraceRecorder.h"
+#include "Utilities/VirtualFileSystem.h"
+
+constexpr uint64_t ShaderPreprocessor::HASH_SEED;
+std::unordered_map<std::string, std::shared_ptr<const ShaderPreprocessor::Source>> ShaderPreprocessor::_cache;
+
+std::shared_ptr<const ShaderPreprocessor::Source> ShaderPreprocessor::Expand(const std::string& path) {
+	const std::string normalized = NormalizePath(path);
+	auto cached = _cache.find(normalized);
+	if (cached != _cache.end()) {
+		return cached->second;
+	}
+
+	std::shared_ptr<Source> result = std::make_shared<Source>();
+	_Append(normalized, *result, std::string());
+	result->Hash = HashCombine(HASH_SEED, result->Text.c_str(), result->Text.size());
+	_cache[normalized] = result;
+	return result;
+}
+
+void ShaderPreprocessor::Evict(const std::string& path) {
+	const std::string normalized = NormalizePath(path);
+	for (auto it = _cache.begin(); it != _cache.end();) {
+		const std::vector<std::string>& files = it->second->Files;
+		const bool readsFile = std::find(files.begin(), files.end(), normalized) != files.end();
+		it = readsFile ? _cache.erase(it) : std::next(it);
+	}
+}
+
+bool ShaderPreprocessor::Reads(const std::string& path, const std::string& file) {
+	const std::string normalizedPath = NormalizePath(path);
+	const std::string normalizedFile = NormalizePath(file);
+	if (normalizedPath == normalizedFile) {
+		return true;
+	}
+	auto cached = _cache.find(normalizedPath);
+	if (cached == _cache.end()) {
+		return false;
+	}
+	const std::vector<std::string>& files = cached->second->Files;
+	return std::find(files.begin(), files.end(), normalizedFile) != files.end();
+}
+
+std::string ShaderPreprocessor::NormalizePath(const std::string& path) {
+	return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+uint64_t ShaderPreprocessor::HashCombine(uint64_t hash, const char* data, size_t length) {
+	for (size_t ix = 0; ix < length; ix++) {
+		hash = (hash ^ static_cast<uint8_t>(data[ix])) * 0x100000001b3ull;
+	}
+	// Separate the strings so that "ab" + "c" and "a" + "bc" hash differently
+	return (hash ^ 0xFF) * 0x100000001b3ull;
+}
+
+void ShaderPreprocessor::_Append(const std::string& path, Source& result, const std::string& includedFrom) {
+	AssetLoadScope load(path.c_str());
+	VirtualFile::sptr file = VirtualFileSystem::Open(path);
+	if (file == nullptr) {
+		if (includedFrom.empty()) {
+			LOG_ERROR("File not found: {}", path);
+		} else {
+			LOG_ERROR("File not found: {} (included from {})", path, includedFrom);
+		}
+		throw std::runtime_error("File not found, see logs for more information");
+	}
+	const std::string index = std::to_string(result.Files.size());
+	result.Files.push_back(path);
+	const std::string directory = std::filesystem::path(path).parent_path().generic_string();
+
+	const char* data = file->GetData();
+	const size_t size = file->GetSize();
+	result.Text.reserve(result.Text.size() + size);
+	uint32_t lineNumber = 0;
+	for (size_t start = 0; start < size;) {
+		const char* lineEnd = static_cast<const char*>(memchr(data + start, '\n', size - start));
+		const size_t end = lineEnd != nullptr ? lineEnd - data : size;
+		lineNumber++;
+
+		std::string name;
+		if (!_ParseInclude(data + start, end - start, name)) {
+			result.Text.append(data + start, end - start);
+			result.Text += '\n';
+		} else {
+			const std::string included = NormalizePath(directory.empty() ? name : directory + "/" + name);
+			// Files that have already been pasted in leave a blank line, so the line numbers after it don't move
+			if (std::find(result.Files.begin(), result.Files.end(), included) == result.Files.end()) {
+				result.Text += "#line 1 " + std::to_string(result.Files.size()) + "\n";
+				_Append(included, result, path + ":" + std::to_string(lineNumber));
+				result.Text += "#line " + std::to_string(lineNumber + 1) + " " + index + "\n";
+			} else {
+				result.Text += '\n';
+			}
+		}
+		start = end + 1;
+	}
+}
+
+bool ShaderPreprocessor::_ParseInclude(const char* line, size_t length, std::string& name) {
+	const char* end = line + length;
+	const auto skipSpace = [&](const char* at) {
+		while (at < end && (*at == ' ' || *at == '\t')) {
+			at++;
+		}
+		return at;
+	};
+	static const char DIRECTIVE[] = "include";
+	const size_t directiveLength = sizeof(DIRECTIVE) - 1;
+
+	const char* at = skipSpace(line);
+	if (at == end || *at != '#') {
+		return false;
+	}
+	at = skipSpace(at + 1);
+	if (end - at < static_cast<ptrdiff_t>(directiveLength) || strncmp(at, DIRECTIVE, directiveLength) != 0) {
+		return false;
+	}
+	at = skipSpace(at + directiveLength);
+	if (at == end || *at != '"') {
+		return false;
+	}
+	const char* nameEnd = std::find(at + 1, end, '"');
+	if (nameEnd == end) {
+		return false;
+	}
+	name.assign(at + 1, nameEnd);
+	return !name.empty();
+}
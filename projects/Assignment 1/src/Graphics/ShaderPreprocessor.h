@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Expands the #include "file" directives in our GLSL, since the language doesn't have them. Included paths are
+/// relative to the file doing the including, and each file is only pasted in once per expansion (as if every file
+/// had #pragma once), so a file can include what it needs without worrying about what else already did
+///
+/// The files get numbered in the order they're first read, with the file being expanded as 0. #line directives are
+/// added around every include so compile errors point at the right line of the right file, see Source::Files
+///
+/// Expansions are kept for the life of the process, along with a hash of their text. That way every variant of a
+/// shader (and every stage sharing an include) reads it's files once, and the program binary cache can be keyed off
+/// the hash instead of going back over the text. Evict drops them when a file changes on disk
+/// </summary>
+class ShaderPreprocessor final
+{
+public:
+	/// <summary>
+	/// A fully expanded file
+	/// </summary>
+	struct Source {
+		std::string              Text;
+		// A hash of Text, see HashCombine
+		uint64_t                 Hash = 0;
+		// Every file that was read, indexed by the source string numbers in the #line directives
+		std::vector<std::string> Files;
+	};
+
+	// The starting value for HashCombine
+	static constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+
+	/// <summary>
+	/// Gets the expanded text of a file, reading it (and everything it includes) if it hasn't been expanded yet.
+	/// Throws if any of the files can't be found. Must be called on the main thread
+	/// </summary>
+	/// <param name="path">The path of the file to expand</param>
+	static std::shared_ptr<const Source> Expand(const std::string& path);
+	/// <summary>
+	/// Drops every expansion that read the given file, so they get read again the next time they're asked for
+	/// </summary>
+	/// <param name="path">The path of the file that changed</param>
+	static void Evict(const std::string& path);
+	/// <summary>
+	/// Returns true if expanding a file reads another, ex: because it includes it. Only files that have been expanded
+	/// know what they include, for anything else this just compares the paths
+	/// </summary>
+	/// <param name="path">The path of the file that would be expanded</param>
+	/// <param name="file">The path of the file to look for</param>
+	static bool Reads(const std::string& path, const std::string& file);
+
+	/// <summary>
+	/// Gets a path that's spelled the same way for the same file, ex: "./shaders/a.glsl" and "shaders/a.glsl"
+	/// </summary>
+	static std::string NormalizePath(const std::string& path);
+
+	/// <summary>
+	/// Adds some data to a 64 bit FNV-1a hash. Each call is kept separate, so hashing "ab" then "c" gives a different
+	/// result than hashing "a" then "bc"
+	/// </summary>
+	/// <param name="hash">The hash so far, or HASH_SEED to start a new one</param>
+	/// <param name="data">The data to add</param>
+	/// <param name="length">The size of the data, in bytes</param>
+	static uint64_t HashCombine(uint64_t hash, const char* data, size_t length);
+
+private:
+	ShaderPreprocessor() = default;
+
+	// Appends a file to an expansion, includedFrom is empty for the file being expanded
+	static void _Append(const std::string& path, Source& result, const std::string& includedFrom);
+	// Gets the file named by an #include directive, returns false if the line isn't one
+	static bool _ParseInclude(const char* line, size_t length, std::string& name);
+
+	// Keyed by the normalized path
+	static std::unordered_map<std::string, std::shared_ptr<const Source>> _cache;
+};
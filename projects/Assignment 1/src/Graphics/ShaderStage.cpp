@@ -0,0 +1,275 @@
+#include "ShaderStage.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include "GpuDeletionQueue.h"
+#include "Logging.h"
+#include "ShaderPreprocessor.h"
+#include "Utilities/VirtualFileSystem.h"
+
+// Not in our glad loader, see Shader::InitParallelCompile
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+std::unordered_map<std::string, std::weak_ptr<ShaderStage>> ShaderStage::_cache;
+std::vector<std::string> ShaderStage::GlobalDefines;
+bool ShaderStage::PreferSpirv = true;
+
+ShaderStage::Constant ShaderStage::Constant::Int(const std::string& name, GLuint id, int32_t value) {
+	GLuint bits;
+	memcpy(&bits, &value, sizeof(GLuint));
+	return { name, id, bits, false };
+}
+
+ShaderStage::Constant ShaderStage::Constant::Float(const std::string& name, GLuint id, float value) {
+	GLuint bits;
+	memcpy(&bits, &value, sizeof(GLuint));
+	return { name, id, bits, true };
+}
+
+ShaderStage::ShaderStage(GLenum type, const std::string& source) :
+	_type(type),
+	_source(source),
+	_handle(0),
+	_status(CompileStatus::NotCompiled),
+	_sourceHash(0)
+{
+	LOG_ASSERT(IsSupported(type), "Unsupported shader stage type {:#x}", type);
+}
+
+ShaderStage::~ShaderStage() {
+	GpuDeletionQueue::DeleteShader(_handle);
+	_handle = 0;
+}
+
+void ShaderStage::Compile() {
+	if (_status != CompileStatus::NotCompiled) {
+		return;
+	}
+	// Creates a new shader part (VS, FS, GS, etc...)
+	_handle = glCreateShader(_type);
+
+	if (!_binary.empty()) {
+		// Modules are already compiled, so all that's left for the driver is to fill in the constants
+		std::vector<GLuint> ids, values;
+		for (const Constant& constant : _constants) {
+			ids.push_back(constant.Id);
+			values.push_back(constant.Value);
+		}
+		glShaderBinary(1, &_handle, GL_SHADER_BINARY_FORMAT_SPIR_V, _binary.data(), static_cast<GLsizei>(_binary.size()));
+		glSpecializeShader(_handle, "main", static_cast<GLuint>(ids.size()), ids.data(), values.data());
+		_status = CompileStatus::Compiling;
+		return;
+	}
+
+	// Load the GLSL source and compile it, note that we don't check the result here so that the driver can
+	// compile it in the background if it supports parallel compilation
+	const char* sourceText = _source.c_str();
+	glShaderSource(_handle, 1, &sourceText, nullptr);
+	glCompileShader(_handle);
+	_status = CompileStatus::Compiling;
+}
+
+bool ShaderStage::IsComplete(bool parallel) const {
+	if (_status != CompileStatus::Compiling || !parallel) {
+		return _status != CompileStatus::NotCompiled;
+	}
+	GLint done = GL_FALSE;
+	glGetShaderiv(_handle, GL_COMPLETION_STATUS_KHR, &done);
+	return done != GL_FALSE;
+}
+
+bool ShaderStage::CheckStatus() {
+	Compile();
+	if (_status == CompileStatus::Compiling) {
+		// Get the compilation status for the shader part
+		GLint status = 0;
+		glGetShaderiv(_handle, GL_COMPILE_STATUS, &status);
+
+		if (status == GL_FALSE) {
+			// Get the size of the error log
+			GLint logSize = 0;
+			glGetShaderiv(_handle, GL_INFO_LOG_LENGTH, &logSize);
+
+			// Create a new character buffer for the log
+			char* log = new char[logSize];
+
+			// Get the log
+			glGetShaderInfoLog(_handle, logSize, &logSize, log);
+
+			// Dump error log, the number before each line number is the file it's in
+			LOG_ERROR("Failed to compile shader part:\n{}", log);
+			for (size_t ix = 0; ix < _files.size(); ix++) {
+				LOG_ERROR("  {}: {}", ix, _files[ix]);
+			}
+
+			// Clean up our log memory
+			delete[] log;
+
+			_status = CompileStatus::Failed;
+		} else {
+			_status = CompileStatus::Compiled;
+		}
+	}
+	return _status == CompileStatus::Compiled;
+}
+
+uint64_t ShaderStage::GetSourceHash() const {
+	if (_sourceHash == 0) {
+		_sourceHash = ShaderPreprocessor::HashCombine(ShaderPreprocessor::HASH_SEED, _source.c_str(), _source.size());
+	}
+	return _sourceHash;
+}
+
+bool ShaderStage::IsSupported(GLenum type) {
+	switch (type) {
+		case GL_VERTEX_SHADER:
+		case GL_TESS_CONTROL_SHADER:
+		case GL_TESS_EVALUATION_SHADER:
+		case GL_GEOMETRY_SHADER:
+		case GL_FRAGMENT_SHADER:
+		case GL_COMPUTE_SHADER:
+			return true;
+		default:
+			return false;
+	}
+}
+
+ShaderStage::sptr ShaderStage::Get(const std::string& path, GLenum type, const std::vector<std::string>& stageDefines) {
+	std::vector<std::string> defines = GlobalDefines;
+	defines.insert(defines.end(), stageDefines.begin(), stageDefines.end());
+	std::string key = path + "|" + std::to_string(type);
+	for (const std::string& define : defines) {
+		key += "|" + define;
+	}
+
+	std::weak_ptr<ShaderStage>& entry = _cache[key];
+	sptr result = entry.lock();
+	if (result != nullptr) {
+		return result;
+	}
+
+	// Throws if the file (or anything it includes) is missing
+	std::shared_ptr<const ShaderPreprocessor::Source> expanded = ShaderPreprocessor::Expand(path);
+	std::string source = expanded->Text;
+	uint64_t hash = expanded->Hash;
+
+	if (!defines.empty()) {
+		// GLSL requires #version to come first, so our defines go on the line after it
+		size_t insertAt = 0;
+		size_t version = source.find("#version");
+		if (version != std::string::npos) {
+			size_t lineEnd = source.find('\n', version);
+			insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+		}
+		std::string injected;
+		for (const std::string& define : defines) {
+			injected += "#define " + define + "\n";
+		}
+		// Put the line numbers back to where they were, so errors still line up with the file
+		const size_t lineNumber = std::count(source.begin(), source.begin() + insertAt, '\n') + 1;
+		injected += "#line " + std::to_string(lineNumber) + " 0\n";
+		source.insert(insertAt, injected);
+		hash = ShaderPreprocessor::HashCombine(hash, injected.c_str(), injected.size());
+	}
+
+	result = Create(type, source);
+	result->_sourceHash = hash;
+	result->_files = expanded->Files;
+	entry = result;
+	return result;
+}
+
+ShaderStage::sptr ShaderStage::GetSpirv(const std::string& path, GLenum type, const std::vector<Constant>& constants) {
+	std::string key = path + "|spirv|" + std::to_string(type);
+	for (const Constant& constant : constants) {
+		key += "|" + std::to_string(constant.Id) + "=" + std::to_string(constant.Value);
+	}
+	std::weak_ptr<ShaderStage>& entry = _cache[key];
+	sptr result = entry.lock();
+	if (result != nullptr) {
+		return result;
+	}
+
+	const std::string modulePath = GetSpirvPath(path);
+	VirtualFile::sptr file = VirtualFileSystem::Open(modulePath);
+	if (file == nullptr) {
+		return nullptr;
+	}
+	// Modules that have been packed into an archive don't have a time to check, so we trust those
+	std::error_code error;
+	const auto moduleTime = std::filesystem::last_write_time(modulePath, error);
+	if (!error) {
+		try {
+			for (const std::string& source : ShaderPreprocessor::Expand(path)->Files) {
+				const auto sourceTime = std::filesystem::last_write_time(source, error);
+				if (!error && sourceTime > moduleTime) {
+					LOG_WARN("\"{}\" is older than \"{}\", using the GLSL until it's cooked again", modulePath, source);
+					return nullptr;
+				}
+			}
+		} catch (const std::runtime_error&) {
+			// Only the module shipped, which is fine
+		}
+	}
+
+	result = Create(type, std::string());
+	result->_binary.assign(file->GetData(), file->GetData() + file->GetSize());
+	result->_constants = constants;
+	result->_files = { modulePath };
+	uint64_t hash = ShaderPreprocessor::HashCombine(ShaderPreprocessor::HASH_SEED, result->_binary.data(), result->_binary.size());
+	for (const Constant& constant : constants) {
+		const GLuint pair[2] = { constant.Id, constant.Value };
+		hash = ShaderPreprocessor::HashCombine(hash, reinterpret_cast<const char*>(pair), sizeof(pair));
+	}
+	result->_sourceHash = hash;
+	entry = result;
+	return result;
+}
+
+bool ShaderStage::IsSpirvEnabled() {
+	static const bool isSupported = [] {
+		if (!GLAD_GL_VERSION_4_6 || glSpecializeShader == nullptr) {
+			return false;
+		}
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_SHADER_BINARY_FORMATS, &count);
+		std::vector<GLint> formats(count);
+		if (count > 0) {
+			glGetIntegerv(GL_SHADER_BINARY_FORMATS, formats.data());
+		}
+		return std::find(formats.begin(), formats.end(), GL_SHADER_BINARY_FORMAT_SPIR_V) != formats.end();
+	}();
+	return PreferSpirv && isSupported && GlobalDefines.empty();
+}
+
+std::vector<std::string> ShaderStage::GetDefines(const std::vector<Constant>& constants) {
+	std::vector<std::string> result;
+	result.reserve(constants.size());
+	for (const Constant& constant : constants) {
+		std::string value;
+		if (constant.IsFloat) {
+			float number;
+			memcpy(&number, &constant.Value, sizeof(float));
+			char text[32];
+			snprintf(text, sizeof(text), "%.9g", number);
+			value = text;
+		} else {
+			int32_t number;
+			memcpy(&number, &constant.Value, sizeof(int32_t));
+			value = std::to_string(number);
+		}
+		result.push_back("SPEC_" + constant.Name + " " + value);
+	}
+	return result;
+}
+
+void ShaderStage::Evict(const std::string& path) {
+	// The keys all start with the path, followed by the type and defines
+	const std::string prefix = path + "|";
+	for (auto it = _cache.begin(); it != _cache.end();) {
+		it = it->first.compare(0, prefix.size(), prefix) == 0 ? _cache.erase(it) : std::next(it);
+	}
+}
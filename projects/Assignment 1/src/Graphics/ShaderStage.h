@@ -0,0 +1,171 @@
+#pragma once
+#include <glad/glad.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Wraps a single compiled shader stage (ex: a vertex shader) that can be attached to any number of programs.
+/// Stages loaded from files are shared through a process wide cache, so a file that is used by several programs
+/// only gets read and compiled once
+///
+/// Stages are compiled lazily the first time a program needs them, so programs that come out of the binary cache
+/// never compile anything. The cache only holds weak references, a stage stays alive until all the programs it
+/// was loaded into have linked
+/// </summary>
+class ShaderStage final
+{
+public:
+	/// <summary>
+	/// A value to give a constant in a stage without recompiling it's source. SPIR-V modules take these as
+	/// specialization constants, and stages compiled from GLSL get them as a define instead (see GetDefines)
+	/// </summary>
+	struct Constant {
+		std::string Name;
+		// The constant_id (or local_size_x_id) in the shader
+		GLuint      Id;
+		// The raw bits of the value, see Int and Float
+		GLuint      Value;
+		bool        IsFloat;
+
+		static Constant Int(const std::string& name, GLuint id, int32_t value);
+		static Constant Float(const std::string& name, GLuint id, float value);
+	};
+
+	typedef std::shared_ptr<ShaderStage> sptr;
+	static inline sptr Create(GLenum type, const std::string& source) {
+		return std::make_shared<ShaderStage>(type, source);
+	}
+	// We'll disallow moving and copying, since we want to manually control when the destructor is called
+	// We'll use these classes via pointers
+	ShaderStage(const ShaderStage& other) = delete;
+	ShaderStage(ShaderStage&& other) = delete;
+	ShaderStage& operator=(const ShaderStage& other) = delete;
+	ShaderStage& operator=(ShaderStage&& other) = delete;
+
+public:
+	/// <summary>
+	/// Creates a new stage from source, note that this does not compile it yet
+	/// </summary>
+	/// <param name="type">The stage type (GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER, GL_COMPUTE_SHADER, etc...)</param>
+	/// <param name="source">The GLSL source for the stage</param>
+	ShaderStage(GLenum type, const std::string& source);
+	~ShaderStage();
+
+	/// <summary>
+	/// Starts compiling the stage if it has not been compiled yet, this does not wait for the result
+	/// </summary>
+	void Compile();
+	/// <summary>
+	/// Returns true if the driver has finished compiling this stage (always true when parallel compilation is off,
+	/// since checking the status will wait on the driver)
+	/// </summary>
+	/// <param name="parallel">True if we can ask the driver for GL_COMPLETION_STATUS_KHR</param>
+	bool IsComplete(bool parallel) const;
+	/// <summary>
+	/// Waits for the compile to finish and checks the result, logging any errors the first time it's called
+	/// </summary>
+	/// <returns>True if the stage compiled successfully</returns>
+	bool CheckStatus();
+
+	/// <summary>
+	/// Gets the OpenGL handle for the stage, or 0 if it has not been compiled yet
+	/// </summary>
+	GLuint GetHandle() const { return _handle; }
+	/// <summary>
+	/// Gets the type of this stage (ex: GL_VERTEX_SHADER)
+	/// </summary>
+	GLenum GetType() const { return _type; }
+	/// <summary>
+	/// Gets the full source that this stage compiles, including any injected defines
+	/// </summary>
+	const std::string& GetSource() const { return _source; }
+	/// <summary>
+	/// Gets a hash of the full source, see ShaderPreprocessor::HashCombine. Stages loaded from files build it from the
+	/// hash of their expanded file, so this never has to go over the text
+	/// </summary>
+	uint64_t GetSourceHash() const;
+
+	/// <summary>
+	/// Returns true if the given stage type is one we know how to compile
+	/// </summary>
+	static bool IsSupported(GLenum type);
+
+	/// <summary>
+	/// Gets the shared stage for a file, loading it if no live stage exists for the same path, type and defines. The
+	/// file's #includes are expanded by ShaderPreprocessor, which keeps the expanded text around so other variants
+	/// of the same file don't need to read it again
+	/// </summary>
+	/// <param name="path">The relative path to the file containing the source</param>
+	/// <param name="type">The stage type</param>
+	/// <param name="defines">The names to #define right after the #version directive</param>
+	static sptr Get(const std::string& path, GLenum type, const std::vector<std::string>& defines);
+	/// <summary>
+	/// Drops the cached stages for a file, so the next Get reads it again (ex: after it's been edited). Programs that
+	/// already have the old stages keep them
+	/// </summary>
+	/// <param name="path">The path of the file, as it was passed to Get</param>
+	static void Evict(const std::string& path);
+
+	/// <summary>
+	/// Gets the shared stage for a file's precompiled SPIR-V module (see ShaderCook), specialized with the given
+	/// constants. Returns nullptr if there's no module, or if it's older than the file (or anything it includes)
+	/// </summary>
+	/// <param name="path">The relative path to the GLSL file the module was cooked from</param>
+	/// <param name="type">The stage type</param>
+	/// <param name="constants">The values for the module's specialization constants</param>
+	static sptr GetSpirv(const std::string& path, GLenum type, const std::vector<Constant>& constants);
+	/// <summary>
+	/// Gets the path of the SPIR-V module cooked from a GLSL file
+	/// </summary>
+	static std::string GetSpirvPath(const std::string& path) { return path + ".spv"; }
+	/// <summary>
+	/// Returns true if SPIR-V modules should be used when they're available. That needs OpenGL 4.6 and PreferSpirv to be
+	/// set, and no GlobalDefines since the modules are cooked without them
+	/// </summary>
+	static bool IsSpirvEnabled();
+	/// <summary>
+	/// Gets the defines that stand in for specialization constants when a stage is compiled from GLSL, each constant
+	/// becomes SPEC_[name] (see shaders/include/specialization.glsl)
+	/// </summary>
+	static std::vector<std::string> GetDefines(const std::vector<Constant>& constants);
+
+	/// <summary>
+	/// Whether to load SPIR-V modules where they're available, on by default. See IsSpirvEnabled
+	/// </summary>
+	static bool PreferSpirv;
+	/// <summary>
+	/// Gets the files this stage was expanded from, indexed by the source string numbers in it's compile errors.
+	/// Empty for stages that were created from source
+	/// </summary>
+	const std::vector<std::string>& GetFiles() const { return _files; }
+
+	/// <summary>
+	/// Names that get #defined in every stage loaded from a file, on top of the ones passed to Get. These are for
+	/// options that apply to the whole renderer (ex: DERIVE_NORMAL_MATRIX), and should be set before any shaders load
+	/// </summary>
+	static std::vector<std::string> GlobalDefines;
+
+protected:
+	enum class CompileStatus : uint8_t {
+		NotCompiled,
+		Compiling,
+		Compiled,
+		Failed
+	};
+
+	GLenum        _type;
+	std::string   _source;
+	GLuint        _handle;
+	CompileStatus _status;
+	// 0 until it's first asked for, or filled in by Get
+	mutable uint64_t _sourceHash;
+	std::vector<std::string> _files;
+	// The SPIR-V module and it's constants, if we weren't made from source
+	std::vector<char>     _binary;
+	std::vector<Constant> _constants;
+
+	// Live stages loaded from files, keyed by path, type and defines
+	static std::unordered_map<std::string, std::weak_ptr<ShaderStage>> _cache;
+};
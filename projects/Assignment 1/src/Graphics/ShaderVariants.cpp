@@ -0,0 +1,34 @@
+#include "ShaderVariants.h"
+
+ShaderVariants::ShaderVariants(const std::string& vsPath, const std::string& fsPath, const std::vector<std::string>& features) :
+	_vsPath(vsPath),
+	_fsPath(fsPath),
+	_features(features)
+{
+	LOG_ASSERT(features.size() <= 32, "A shader can have at most 32 variant features!");
+}
+
+const Shader::sptr& ShaderVariants::Get(uint32_t featureMask) {
+	const Shader::sptr& result = GetAsync(featureMask);
+	result->WaitUntilReady();
+	return result;
+}
+
+const Shader::sptr& ShaderVariants::GetAsync(uint32_t featureMask) {
+	Shader::sptr& result = _variants[featureMask];
+	if (result == nullptr) {
+		std::vector<std::string> defines;
+		for (size_t ix = 0; ix < _features.size(); ix++) {
+			if (featureMask & (1u << ix)) {
+				defines.push_back(_features[ix]);
+			}
+		}
+
+		result = Shader::Create();
+		result->LoadShaderPartFromFile(_vsPath.c_str(), GL_VERTEX_SHADER, defines);
+		result->LoadShaderPartFromFile(_fsPath.c_str(), GL_FRAGMENT_SHADER, defines);
+		result->LinkAsync();
+		LOG_INFO("Started compiling variant {:#x} of {}", featureMask, _fsPath);
+	}
+	return result;
+}
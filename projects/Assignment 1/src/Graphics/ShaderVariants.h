@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Shader.h"
+
+/// <summary>
+/// Compiles permutations of a single vertex / fragment shader pair, where each bit in a feature mask turns on a
+/// #define in the source. Variants are compiled the first time they are requested, and cached after that
+/// </summary>
+class ShaderVariants final
+{
+public:
+	typedef std::shared_ptr<ShaderVariants> sptr;
+	static inline sptr Create(const std::string& vsPath, const std::string& fsPath, const std::vector<std::string>& features) {
+		return std::make_shared<ShaderVariants>(vsPath, fsPath, features);
+	}
+	// We'll disallow moving and copying, since we want to manually control when the destructor is called
+	// We'll use these classes via pointers
+	ShaderVariants(const ShaderVariants& other) = delete;
+	ShaderVariants(ShaderVariants&& other) = delete;
+	ShaderVariants& operator=(const ShaderVariants& other) = delete;
+	ShaderVariants& operator=(ShaderVariants&& other) = delete;
+
+public:
+	/// <summary>
+	/// Creates a new variant cache for the given shader files
+	/// </summary>
+	/// <param name="vsPath">The relative path to the vertex shader source</param>
+	/// <param name="fsPath">The relative path to the fragment shader source</param>
+	/// <param name="features">The names of the #defines, where features[n] is enabled by bit n of the feature mask</param>
+	ShaderVariants(const std::string& vsPath, const std::string& fsPath, const std::vector<std::string>& features);
+	~ShaderVariants() = default;
+
+	/// <summary>
+	/// Gets the shader compiled with the given features enabled, compiling it if this is the first time it's been requested
+	/// </summary>
+	/// <param name="featureMask">A bitmask of the features to enable</param>
+	const Shader::sptr& Get(uint32_t featureMask);
+	/// <summary>
+	/// Gets the shader compiled with the given features enabled, starting it compiling in the background if this is the
+	/// first time it's been requested. Check Shader::IsReady before using it
+	/// </summary>
+	/// <param name="featureMask">A bitmask of the features to enable</param>
+	const Shader::sptr& GetAsync(uint32_t featureMask);
+
+	/// <summary>
+	/// Gets the names of the features that this cache was created with
+	/// </summary>
+	const std::vector<std::string>& GetFeatures() const { return _features; }
+
+protected:
+	std::string _vsPath;
+	std::string _fsPath;
+	std::vector<std::string> _features;
+	std::unordered_map<uint32_t, Shader::sptr> _variants;
+};
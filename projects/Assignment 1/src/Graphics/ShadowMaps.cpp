@@ -0,0 +1,456 @@
+#include "ShadowMaps.h"
+
+#include <algorithm>
+#include <cstring>
+#include <GLM/gtc/matrix_transform.hpp>
+
+#include "Gameplay/Light.h"
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderState.h"
+
+// How much bigger than the slice of the view each cascade is, as a fraction of the slice's radius. The cascades only
+// move once the camera has moved this far, so they can keep their static layer until then
+static const float CASCADE_CACHE_MARGIN = 0.25f;
+// How far past the near plane of the cascades to look for casters, they get flattened onto the near plane
+static const float CASCADE_CASTER_DISTANCE = 500.0f;
+// The near plane of the point light cube maps
+static const float CUBE_NEAR_PLANE = 0.05f;
+
+// The direction and up vector of each face of a cube map, in the order of the cube map's layers
+static const glm::vec3 CUBE_FACES[6][2] = {
+	{ glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f) },
+	{ glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f) },
+	{ glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f) },
+	{ glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f) },
+	{ glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f) },
+	{ glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f) }
+};
+
+// Whether the driver lets vertex shaders write gl_Layer, which is all we need to draw a whole cube in one pass
+static bool IsLayerFromVertexSupported() {
+	GLint extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for (GLint ix = 0; ix < extensionCount; ix++) {
+		const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, ix));
+		if (strcmp(name, "GL_ARB_shader_viewport_layer_array") == 0 || strcmp(name, "GL_AMD_vertex_shader_layer") == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+ShadowMaps::ShadowMaps() :
+	_isReady(false),
+	_cascades(0),
+	_staticCascades(0),
+	_cubes(0),
+	_staticCubes(0),
+	_framebuffer(0)
+{
+	GPU_RESOURCE_OWNER("ShadowMaps");
+	_cascadeShader = Shader::Create();
+	_cascadeShader->LoadShaderPartFromFile("shaders/shadow_depth.vert.glsl", GL_VERTEX_SHADER);
+	_cascadeShader->LoadShaderPartFromFile("shaders/shadow_depth.frag.glsl", GL_FRAGMENT_SHADER);
+	_cubeShader = Shader::Create();
+	_cubeShader->LoadShaderPartFromFile("shaders/shadow_depth.vert.glsl", GL_VERTEX_SHADER);
+	_cubeShader->LoadShaderPartFromFile("shaders/shadow_depth.frag.glsl", GL_FRAGMENT_SHADER, { "LINEAR_DEPTH" });
+	_isReady = _cascadeShader->Link() && _cubeShader->Link();
+	if (!_isReady) {
+		LOG_WARN("Shadow depth shaders failed to compile, nothing will be shadowed");
+	} else if (IsLayerFromVertexSupported()) {
+		_layeredCubeShader = Shader::Create();
+		_layeredCubeShader->LoadShaderPartFromFile("shaders/shadow_depth.vert.glsl", GL_VERTEX_SHADER, { "LAYERED" });
+		_layeredCubeShader->LoadShaderPartFromFile("shaders/shadow_depth.frag.glsl", GL_FRAGMENT_SHADER, { "LINEAR_DEPTH" });
+		if (!_layeredCubeShader->Link()) {
+			LOG_WARN("Layered shadow depth shader failed to compile, cube faces will be drawn one at a time");
+			_layeredCubeShader = nullptr;
+		}
+	} else {
+		LOG_INFO("Vertex shaders can't pick their layer, cube faces will be drawn one at a time");
+	}
+
+	_cascades = _CreateDepthTexture(GL_TEXTURE_2D_ARRAY, CASCADE_RESOLUTION, CASCADE_COUNT);
+	_staticCascades = _CreateDepthTexture(GL_TEXTURE_2D_ARRAY, CASCADE_RESOLUTION, CASCADE_COUNT);
+	_cubes = _CreateDepthTexture(GL_TEXTURE_CUBE_MAP_ARRAY, CUBE_RESOLUTION, 6 * MAX_POINT_SHADOWS);
+	_staticCubes = _CreateDepthTexture(GL_TEXTURE_CUBE_MAP_ARRAY, CUBE_RESOLUTION, 6 * MAX_POINT_SHADOWS);
+	glCreateFramebuffers(1, &_framebuffer);
+	glNamedFramebufferDrawBuffer(_framebuffer, GL_NONE);
+	glNamedFramebufferReadBuffer(_framebuffer, GL_NONE);
+
+	_shadowData = UniformBuffer<ShadowData>::Create();
+	_shadowData->Bind(SHADOW_DATA_BINDING);
+	_instanceBuffer = VertexBuffer::Create(GL_DYNAMIC_DRAW);
+}
+
+ShadowMaps::~ShadowMaps() {
+	const GLuint textures[4] = { _cascades, _staticCascades, _cubes, _staticCubes };
+	for (GLuint texture : textures) {
+		RenderState::OnTextureDeleted(texture);
+		GpuResources::RemoveRaw(GL_TEXTURE, texture);
+	}
+	glDeleteTextures(4, textures);
+	glDeleteFramebuffers(1, &_framebuffer);
+}
+
+GLuint ShadowMaps::_CreateDepthTexture(GLenum target, int resolution, int layers) {
+	GLuint texture = 0;
+	glCreateTextures(target, 1, &texture);
+	glTextureStorage3D(texture, 1, GL_DEPTH_COMPONENT32F, resolution, resolution, layers);
+	GpuResources::AddRaw(GL_TEXTURE, texture, static_cast<size_t>(resolution) * resolution * layers * 4,
+		target == GL_TEXTURE_CUBE_MAP_ARRAY ? "Point Shadow Maps" : "Cascaded Shadow Maps");
+	// Comparing in the sampler gets us 2x2 PCF from the linear filter for free
+	glTextureParameteri(texture, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTextureParameteri(texture, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// Anything off the edge of a cascade counts as lit
+	const float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTextureParameterfv(texture, GL_TEXTURE_BORDER_COLOR, border);
+	return texture;
+}
+
+void ShadowMaps::Invalidate() {
+	for (CacheEntry& cache : _cascadeCache) {
+		cache.IsValid = false;
+	}
+	for (CacheEntry& cache : _cubeCache) {
+		cache.IsValid = false;
+	}
+}
+
+void ShadowMaps::Render(const std::vector<LightData>& lights, const ShadowCasterSet& casters, const FrameData& frame) {
+	_stats = Stats();
+	_passes.clear();
+	_draws.clear();
+	_instances.clear();
+	_layerViewProjections.clear();
+	ShadowData& data = _shadowData->GetData();
+	data.CascadeCount = 0;
+	data.DepthBias = DepthBias;
+	data.NormalBias = NormalBias;
+
+	if (_isReady) {
+		for (const LightData& light : lights) {
+			if (light.ShadowIndex < 0) {
+				continue;
+			}
+			if (light.Type == static_cast<uint32_t>(LightType::Directional)) {
+				// Only the first directional light gets the cascades
+				if (data.CascadeCount > 0) {
+					continue;
+				}
+				_FitCascades(light, frame);
+				for (uint32_t ix = 0; ix < CASCADE_COUNT; ix++) {
+					Pass view = {};
+					view.Target = _cascades;
+					view.Layer = static_cast<GLint>(ix);
+					view.ViewProjection = data.CascadeViewProjection[ix];
+					CacheEntry& cache = _cascadeCache[ix];
+					const bool isStale = !cache.IsValid || cache.StaticVersion != casters.StaticVersion || cache.ViewProjection != view.ViewProjection;
+					cache.ViewProjection = view.ViewProjection;
+					_PlanMap(cache, isStale, casters, &view, &_cascadeFrusta[ix], 1, _staticCascades, false);
+				}
+			} else if (light.ShadowIndex < MAX_POINT_SHADOWS) {
+				const glm::vec4 sphere = glm::vec4(light.Position, light.Range);
+				const glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, CUBE_NEAR_PLANE, glm::max(light.Range, CUBE_NEAR_PLANE * 2.0f));
+				Pass views[6];
+				Frustum frusta[6];
+				for (int face = 0; face < 6; face++) {
+					views[face] = {};
+					views[face].Target = _cubes;
+					views[face].Layer = light.ShadowIndex * 6 + face;
+					views[face].IsCube = true;
+					views[face].ViewProjection = projection * glm::lookAt(light.Position, light.Position + CUBE_FACES[face][0], CUBE_FACES[face][1]);
+					views[face].LightSphere = sphere;
+					frusta[face] = Frustum(views[face].ViewProjection);
+				}
+				CacheEntry& cache = _cubeCache[light.ShadowIndex];
+				const bool isStale = !cache.IsValid || cache.StaticVersion != casters.StaticVersion || cache.LightSphere != sphere;
+				cache.LightSphere = sphere;
+				_PlanMap(cache, isStale, casters, views, frusta, 6, _staticCubes, LayeredCubes && IsLayeredSupported());
+			}
+		}
+	}
+	// The lights could just as well have gone away, in which case their caches need redrawing whenever they're back
+	if (data.CascadeCount == 0) {
+		for (CacheEntry& cache : _cascadeCache) {
+			cache.IsValid = false;
+		}
+	}
+	_shadowData->Update();
+	RenderState::BindTextureUnit(SHADOW_CASCADE_UNIT, _cascades);
+	RenderState::BindSampler(SHADOW_CASCADE_UNIT, 0);
+	RenderState::BindTextureUnit(POINT_SHADOW_UNIT, _cubes);
+	RenderState::BindSampler(POINT_SHADOW_UNIT, 0);
+	if (_passes.empty()) {
+		return;
+	}
+
+	_stats.Instances = static_cast<uint32_t>(_instances.size());
+	if (!_instances.empty()) {
+		_instanceBuffer->LoadData(_instances.data(), _instances.size());
+	}
+
+	// Remember what we're drawing into, so we can put it back when we're done
+	GLint viewport[4];
+	GLint previousFramebuffer;
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	RenderState::SetEnabled(GL_DEPTH_TEST, true);
+	RenderState::SetDepthMask(true);
+	// The cube faces are mirrored, which flips their winding, so we draw both sides of everything
+	RenderState::SetEnabled(GL_CULL_FACE, false);
+	const float clearDepth = 1.0f;
+	Shader* current = nullptr;
+	for (const Pass& pass : _passes) {
+		if (pass.CopyLayers > 0) {
+			const int resolution = pass.IsCube ? CUBE_RESOLUTION : CASCADE_RESOLUTION;
+			const GLenum target = pass.IsCube ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_2D_ARRAY;
+			glCopyImageSubData(pass.CopySource, target, 0, 0, 0, pass.Layer, pass.Target, target, 0, 0, 0, pass.Layer, resolution, resolution, pass.CopyLayers);
+		}
+		if (!pass.Clear && pass.DrawCount == 0) {
+			continue;
+		}
+
+		if (pass.IsLayered) {
+			// Clearing a layered attachment would clear every light's cube, so only this one's faces get cleared
+			if (pass.Clear) {
+				glClearTexSubImage(pass.Target, 0, 0, 0, pass.Layer, CUBE_RESOLUTION, CUBE_RESOLUTION, 6, GL_DEPTH_COMPONENT, GL_FLOAT, &clearDepth);
+			}
+			if (pass.DrawCount == 0) {
+				continue;
+			}
+			glNamedFramebufferTexture(_framebuffer, GL_DEPTH_ATTACHMENT, pass.Target, 0);
+			glViewport(0, 0, CUBE_RESOLUTION, CUBE_RESOLUTION);
+			glDisable(GL_DEPTH_CLAMP);
+			if (current != _layeredCubeShader.get()) {
+				_layeredCubeShader->Bind();
+				current = _layeredCubeShader.get();
+			}
+			_layeredCubeShader->SetUniformMatrix(_layeredCubeShader->GetUniformLocation("u_LayerViewProjection"_hs), &_layerViewProjections[pass.FirstLayerView], 6);
+			_layeredCubeShader->SetUniform("u_FirstLayer"_hs, pass.Layer);
+			_layeredCubeShader->SetUniform("u_LightPos"_hs, glm::vec3(pass.LightSphere));
+			_layeredCubeShader->SetUniform("u_LightRange"_hs, pass.LightSphere.w);
+			for (size_t ix = pass.FirstDraw; ix < pass.FirstDraw + pass.DrawCount; ix++) {
+				const Draw& draw = _draws[ix];
+				draw.Mesh->SetInstanceBuffer(_instanceBuffer, InstanceTransform::V_DECL);
+				draw.Mesh->RenderInstanced(draw.InstanceCount, draw.BaseInstance);
+			}
+			_stats.Submissions++;
+			continue;
+		}
+
+		glNamedFramebufferTextureLayer(_framebuffer, GL_DEPTH_ATTACHMENT, pass.Target, 0, pass.Layer);
+		if (pass.IsCube) {
+			glViewport(0, 0, CUBE_RESOLUTION, CUBE_RESOLUTION);
+			glDisable(GL_DEPTH_CLAMP);
+		} else {
+			glViewport(0, 0, CASCADE_RESOLUTION, CASCADE_RESOLUTION);
+			// Casters in front of the cascades get flattened onto the near plane instead of clipped
+			glEnable(GL_DEPTH_CLAMP);
+		}
+		if (pass.Clear) {
+			glClearNamedFramebufferfv(_framebuffer, GL_DEPTH, 0, &clearDepth);
+		}
+		if (pass.DrawCount == 0) {
+			continue;
+		}
+
+		Shader* shader = pass.IsCube ? _cubeShader.get() : _cascadeShader.get();
+		if (shader != current) {
+			shader->Bind();
+			current = shader;
+		}
+		shader->SetUniformMatrix("u_ShadowViewProjection"_hs, pass.ViewProjection);
+		if (pass.IsCube) {
+			shader->SetUniform("u_LightPos"_hs, glm::vec3(pass.LightSphere));
+			shader->SetUniform("u_LightRange"_hs, pass.LightSphere.w);
+		}
+		for (size_t ix = pass.FirstDraw; ix < pass.FirstDraw + pass.DrawCount; ix++) {
+			const Draw& draw = _draws[ix];
+			draw.Mesh->SetInstanceBuffer(_instanceBuffer, InstanceTransform::V_DECL);
+			draw.Mesh->RenderInstanced(draw.InstanceCount, draw.BaseInstance);
+		}
+		_stats.Submissions++;
+	}
+	glDisable(GL_DEPTH_CLAMP);
+	RenderState::SetEnabled(GL_CULL_FACE, true);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	// The lit shaders sample what we just drew
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void ShadowMaps::_FitCascades(const LightData& light, const FrameData& frame) {
+	ShadowData& data = _shadowData->GetData();
+	float nearPlane, farPlane;
+	Frustum::GetClipPlanes(frame.Projection, nearPlane, farPlane);
+	nearPlane = glm::max(nearPlane, 0.01f);
+	const float shadowFar = glm::max(glm::min(farPlane, MaxDistance), nearPlane * 2.0f);
+	const glm::mat4 inverseProjection = glm::inverse(frame.Projection);
+	const glm::mat4 inverseView = glm::inverse(frame.View);
+
+	// The cascades only rotate with the light, so their texels stay put as the camera moves
+	const glm::vec3 up = glm::abs(light.Direction.z) > 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+	const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), light.Direction, up);
+
+	float sliceNear = nearPlane;
+	for (uint32_t ix = 0; ix < CASCADE_COUNT; ix++) {
+		// Blend between evenly and logarithmically spaced splits, so the near cascades aren't too big or too small
+		const float t = static_cast<float>(ix + 1) / static_cast<float>(CASCADE_COUNT);
+		const float sliceFar = glm::mix(nearPlane + (shadowFar - nearPlane) * t, nearPlane * glm::pow(shadowFar / nearPlane, t), SplitBlend);
+
+		// Find the world space corners of this slice of the view
+		glm::vec3 corners[8];
+		glm::vec3 center = glm::vec3(0.0f);
+		for (int corner = 0; corner < 4; corner++) {
+			const glm::vec2 ndc = glm::vec2((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f);
+			const glm::vec4 nearPoint = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+			const glm::vec4 farPoint = inverseProjection * glm::vec4(ndc, 1.0f, 1.0f);
+			const glm::vec3 a = glm::vec3(nearPoint) / nearPoint.w;
+			const glm::vec3 b = glm::vec3(farPoint) / farPoint.w;
+			const glm::vec3 front = glm::mix(a, b, (-sliceNear - a.z) / (b.z - a.z));
+			const glm::vec3 back = glm::mix(a, b, (-sliceFar - a.z) / (b.z - a.z));
+			corners[corner * 2] = glm::vec3(inverseView * glm::vec4(front, 1.0f));
+			corners[corner * 2 + 1] = glm::vec3(inverseView * glm::vec4(back, 1.0f));
+			center += corners[corner * 2] + corners[corner * 2 + 1];
+		}
+		center /= 8.0f;
+		// A sphere around the slice keeps the same size however the camera turns, rounded so it doesn't flicker
+		float radius = 0.0f;
+		for (const glm::vec3& corner : corners) {
+			radius = glm::max(radius, glm::length(corner - center));
+		}
+		radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+		// Snap the cascade to a grid of cells a whole number of texels across, so it stays put (and keeps it's
+		// cache) until the slice has moved a cell, and the texels don't crawl when it does move
+		const float margin = radius * CASCADE_CACHE_MARGIN;
+		const float texel = 2.0f * (radius + margin) / static_cast<float>(CASCADE_RESOLUTION);
+		const float cell = glm::max(glm::floor(margin / texel), 1.0f) * texel;
+		const float extent = radius + cell;
+		glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+		lightCenter = glm::round(lightCenter / cell) * cell;
+
+		const glm::mat4 projection = glm::ortho(
+			lightCenter.x - extent, lightCenter.x + extent,
+			lightCenter.y - extent, lightCenter.y + extent,
+			-(lightCenter.z + extent), -(lightCenter.z - extent));
+		data.CascadeViewProjection[ix] = projection * lightView;
+		// Casters between the light and the cascade still cast onto it, so we cull against a volume that reaches much
+		// further towards the light
+		const glm::mat4 culling = glm::ortho(
+			lightCenter.x - extent, lightCenter.x + extent,
+			lightCenter.y - extent, lightCenter.y + extent,
+			-(lightCenter.z + extent + CASCADE_CASTER_DISTANCE), -(lightCenter.z - extent));
+		_cascadeFrusta[ix] = Frustum(culling * lightView);
+		data.CascadeSplits[ix] = sliceFar;
+		sliceNear = sliceFar;
+	}
+	data.CascadeCount = CASCADE_COUNT;
+}
+
+void ShadowMaps::_PlanMap(CacheEntry& cache, bool isStale, const ShadowCasterSet& casters, const Pass* views, const Frustum* frusta,
+	int viewCount, GLuint staticTarget, bool isLayered)
+{
+	static const std::vector<ShadowCaster> noCasters;
+	const std::vector<ShadowCaster>& staticCasters = casters.Static != nullptr ? *casters.Static : noCasters;
+
+	// A layered pass stands in for all of the views, starting from the first one's layer
+	Pass layered = views[0];
+	if (isLayered) {
+		layered.IsLayered = true;
+		layered.FirstLayerView = _layerViewProjections.size();
+		for (int ix = 0; ix < viewCount; ix++) {
+			_layerViewProjections.push_back(views[ix].ViewProjection);
+		}
+	}
+
+	// Redraw the static layers if the light or the static casters have moved
+	if (isStale) {
+		if (isLayered) {
+			Pass pass = layered;
+			pass.Target = staticTarget;
+			pass.Clear = true;
+			_AddDraws(staticCasters, frusta, viewCount, pass);
+			_passes.push_back(pass);
+		} else {
+			for (int ix = 0; ix < viewCount; ix++) {
+				Pass pass = views[ix];
+				pass.Target = staticTarget;
+				pass.Clear = true;
+				_AddDraws(staticCasters, &frusta[ix], 1, pass);
+				_passes.push_back(pass);
+			}
+		}
+		cache.IsValid = true;
+		cache.StaticVersion = casters.StaticVersion;
+		_stats.StaticPasses += viewCount;
+	}
+
+	// Then copy the static layers over and draw the dynamic casters on top, if anything has changed since last frame
+	const size_t firstPass = _passes.size();
+	const size_t firstDraw = _draws.size();
+	const size_t firstInstance = _instances.size();
+	uint32_t dynamicViews = 0;
+	if (isLayered) {
+		Pass pass = layered;
+		_AddDraws(casters.Dynamic, frusta, viewCount, pass);
+		// Count the faces that got something, so the stats mean the same thing either way
+		uint32_t faces = 0;
+		for (size_t ix = firstInstance; ix < _instances.size(); ix++) {
+			faces |= 1u << _instances[ix].MaterialIndex;
+		}
+		for (; faces != 0; faces &= faces - 1) {
+			dynamicViews++;
+		}
+		_passes.push_back(pass);
+	} else {
+		for (int ix = 0; ix < viewCount; ix++) {
+			Pass pass = views[ix];
+			_AddDraws(casters.Dynamic, &frusta[ix], 1, pass);
+			dynamicViews += pass.DrawCount > 0 ? 1 : 0;
+			_passes.push_back(pass);
+		}
+	}
+	const bool hasDynamic = dynamicViews > 0;
+	if (isStale || hasDynamic || cache.HasDynamic) {
+		_passes[firstPass].CopyLayers = viewCount;
+		_passes[firstPass].CopySource = staticTarget;
+		_stats.DynamicPasses += dynamicViews;
+	} else {
+		_passes.resize(firstPass);
+		_draws.resize(firstDraw);
+		_instances.resize(firstInstance);
+		_stats.CachedPasses += viewCount;
+	}
+	cache.HasDynamic = hasDynamic;
+}
+
+void ShadowMaps::_AddDraws(const std::vector<ShadowCaster>& casters, const Frustum* frusta, int frustumCount, Pass& pass) {
+	_visible.clear();
+	for (const ShadowCaster& caster : casters) {
+		for (int ix = 0; ix < frustumCount; ix++) {
+			if (frusta[ix].Intersects(caster.Bounds)) {
+				_visible.emplace_back(&caster, static_cast<uint32_t>(ix));
+			}
+		}
+	}
+	// Group the casters by mesh, so each mesh only needs one instanced draw
+	std::sort(_visible.begin(), _visible.end(), [](const std::pair<const ShadowCaster*, uint32_t>& a, const std::pair<const ShadowCaster*, uint32_t>& b) {
+		return a.first->Mesh.get() < b.first->Mesh.get();
+	});
+	pass.FirstDraw = _draws.size();
+	for (const auto& [caster, view] : _visible) {
+		if (_draws.size() == pass.FirstDraw || _draws.back().Mesh != caster->Mesh.get()) {
+			_draws.push_back({ caster->Mesh.get(), static_cast<int>(_instances.size()), 0 });
+		}
+		_instances.emplace_back(caster->Model, glm::mat3(1.0f), view);
+		_draws.back().InstanceCount++;
+	}
+	pass.DrawCount = _draws.size() - pass.FirstDraw;
+}
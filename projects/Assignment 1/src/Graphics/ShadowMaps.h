@@ -0,0 +1,217 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "BoundingVolume.h"
+#include "Frustum.h"
+#include "Shader.h"
+#include "UniformBlocks.h"
+#include "UniformBuffer.h"
+#include "VertexArrayObject.h"
+#include "VertexBuffer.h"
+#include "Utilities/VertexTypes.h"
+
+/// <summary>
+/// A mesh that gets drawn into the shadow maps
+/// </summary>
+struct ShadowCaster
+{
+	VertexArrayObject::sptr Mesh;
+	glm::mat4               Model;
+	// The world space bounds of the mesh, for culling it against each shadow map's view
+	BoundingVolume          Bounds;
+};
+
+/// <summary>
+/// The casters gathered for a frame, split by whether they can move
+/// </summary>
+struct ShadowCasterSet
+{
+	// The casters that never move (anything with a StaticTag). The list only gets rebuilt when one of them is added,
+	// removed or moved, so it's shared between frames until then
+	std::shared_ptr<const std::vector<ShadowCaster>> Static;
+	// Changes whenever the static list does, so the shadow maps know when their cached static layers are stale
+	uint64_t                                         StaticVersion = 0;
+	// Everything else, gathered every frame
+	std::vector<ShadowCaster>                        Dynamic;
+};
+
+/// <summary>
+/// Renders the shadow maps for the lights of a frame: cascaded shadow maps for the first shadowed directional light,
+/// and cube maps for up to MAX_POINT_SHADOWS shadowed point or spot lights
+///
+/// Each shadow map has a static layer that only the static casters get drawn into, which is cached until the light or
+/// the static casters move. Every frame the static layer is copied into the shadow map that gets sampled, and just the
+/// dynamic casters are drawn over it, so the cost of shadows follows what moves rather than the size of the scene. The
+/// cascades are snapped to a grid a little coarser than the camera moves each frame, so they only need to be redrawn
+/// when the camera crosses into another cell
+///
+/// Where the driver lets vertex shaders pick the layer they draw to (GL_ARB_shader_viewport_layer_array, or the older
+/// GL_AMD_vertex_shader_layer), the six faces of a cube are drawn in a single pass: the whole cube map array is attached
+/// at once, and each caster gets an instance for every face it's seen by, which the shader sends to that face's layer.
+/// That turns six submissions of the casters per cube into one. The cascades each keep their own cache, so they are
+/// still drawn one at a time
+///
+/// Usage each frame: Render after the frame uniforms have been uploaded, and before anything lit gets drawn. The
+/// shadow maps and the ShadowData block stay bound to SHADOW_CASCADE_UNIT, POINT_SHADOW_UNIT and SHADOW_DATA_BINDING
+/// </summary>
+class ShadowMaps final
+{
+public:
+	typedef std::shared_ptr<ShadowMaps> sptr;
+	static inline sptr Create() {
+		return std::make_shared<ShadowMaps>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	ShadowMaps(const ShadowMaps& other) = delete;
+	ShadowMaps(ShadowMaps&& other) = delete;
+	ShadowMaps& operator=(const ShadowMaps& other) = delete;
+	ShadowMaps& operator=(ShadowMaps&& other) = delete;
+
+public:
+	// The size of each cascade and each face of the point light cube maps, in texels
+	static const int      CASCADE_RESOLUTION = 2048;
+	static const int      CUBE_RESOLUTION = 512;
+	// The number of cascades the directional light's shadows get split into, at most MAX_SHADOW_CASCADES
+	static const uint32_t CASCADE_COUNT = 3;
+
+	/// <summary>
+	/// What the last call to Render drew
+	/// </summary>
+	struct Stats {
+		// The number of shadow map views (cascades or cube faces) whose static layer had to be redrawn
+		uint32_t StaticPasses  = 0;
+		// The number of views that had dynamic casters drawn over their static layer
+		uint32_t DynamicPasses = 0;
+		// The number of views whose static layer was reused as is
+		uint32_t CachedPasses  = 0;
+		// The number of instances drawn across every pass
+		uint32_t Instances     = 0;
+		// The number of passes that drew anything, a layered pass counts once however many faces it covers
+		uint32_t Submissions   = 0;
+	};
+
+	// How far from the camera the directional light's cascades reach
+	float MaxDistance = 60.0f;
+	// How the cascade splits are spaced, 0 spaces them evenly and 1 spaces them logarithmically
+	float SplitBlend  = 0.75f;
+	// See ShadowData
+	float DepthBias   = 0.0015f;
+	float NormalBias  = 0.03f;
+	// Whether to draw all six faces of a cube in one pass, when the driver supports it (see IsLayeredSupported)
+	bool  LayeredCubes = true;
+
+	/// <summary>
+	/// Creates the shadow maps, and compiles the depth shaders
+	/// </summary>
+	ShadowMaps();
+	~ShadowMaps();
+
+	/// <summary>
+	/// Returns true if the depth shaders compiled, if not nothing will be shadowed
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+	/// <summary>
+	/// Returns true if the driver can pick layers from the vertex shader and the layered depth shader compiled, if not
+	/// the faces of each cube get drawn one at a time
+	/// </summary>
+	bool IsLayeredSupported() const { return _layeredCubeShader != nullptr; }
+
+	/// <summary>
+	/// Draws the shadow maps for the frame's shadowed lights, reusing the cached static layers wherever we can
+	/// </summary>
+	/// <param name="lights">The lights being drawn with this frame, with their ShadowIndex already assigned</param>
+	/// <param name="casters">The casters to draw into the shadow maps</param>
+	/// <param name="frame">The frame uniforms that are being drawn with, the cascades get fit to it's view</param>
+	void Render(const std::vector<LightData>& lights, const ShadowCasterSet& casters, const FrameData& frame);
+
+	/// <summary>
+	/// Throws away the cached static layers, so they get redrawn next frame
+	/// </summary>
+	void Invalidate();
+
+	/// <summary>
+	/// Gets what the last call to Render drew
+	/// </summary>
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	// What the static layer of a cascade or cube map was last drawn with
+	struct CacheEntry {
+		bool      IsValid = false;
+		// Whether dynamic casters were drawn over the static layer last frame, if so it needs copying back even if
+		// nothing moves this frame
+		bool      HasDynamic = false;
+		uint64_t  StaticVersion = 0;
+		glm::mat4 ViewProjection = glm::mat4(1.0f);
+		glm::vec4 LightSphere = glm::vec4(0.0f);
+	};
+	// A run of instances of one mesh
+	struct Draw {
+		VertexArrayObject* Mesh;
+		int                BaseInstance;
+		int                InstanceCount;
+	};
+	// One view of a shadow map to draw
+	struct Pass {
+		// The texture to draw into, and it's layer (for cubes, the layer of the face)
+		GLuint    Target;
+		GLint     Layer;
+		bool      IsCube;
+		// Layered passes draw all six faces of a cube starting from Layer, each instance says which face it's for
+		bool      IsLayered;
+		// Static passes clear the layer first, dynamic passes copy CopyLayers layers from the static texture first
+		bool      Clear;
+		GLint     CopyLayers;
+		GLuint    CopySource;
+		glm::mat4 ViewProjection;
+		// For layered passes, where the view projections of the faces start in _layerViewProjections
+		size_t    FirstLayerView;
+		// For cube faces, the position (xyz) and range (w) of the light, since they store the distance to it
+		glm::vec4 LightSphere;
+		size_t    FirstDraw;
+		size_t    DrawCount;
+	};
+
+	Shader::sptr                    _cascadeShader;
+	Shader::sptr                    _cubeShader;
+	// Only created if the driver can pick layers from the vertex shader
+	Shader::sptr                    _layeredCubeShader;
+	bool                            _isReady;
+	UniformBuffer<ShadowData>::sptr _shadowData;
+	// The cascades and cube maps that get sampled, and their cached static layers
+	GLuint                          _cascades;
+	GLuint                          _staticCascades;
+	GLuint                          _cubes;
+	GLuint                          _staticCubes;
+	GLuint                          _framebuffer;
+	VertexBuffer::sptr              _instanceBuffer;
+
+	CacheEntry                      _cascadeCache[CASCADE_COUNT];
+	// The volumes to cull casters against for each cascade, which reach further towards the light than the cascades
+	Frustum                         _cascadeFrusta[CASCADE_COUNT];
+	CacheEntry                      _cubeCache[MAX_POINT_SHADOWS];
+	// Kept between frames so planning the passes doesn't need to allocate once it's warmed up
+	std::vector<Pass>                _passes;
+	std::vector<Draw>                _draws;
+	std::vector<InstanceTransform>   _instances;
+	std::vector<glm::mat4>           _layerViewProjections;
+	// The casters that made it through culling, and the view they're visible to
+	std::vector<std::pair<const ShadowCaster*, uint32_t>> _visible;
+	Stats                            _stats;
+
+	// Fits the cascades to the view, filling in their matrices, splits and culling volumes
+	void _FitCascades(const LightData& light, const FrameData& frame);
+	// Plans the passes for a shadow map with one view per layer (one for a cascade, six for a cube). Static passes
+	// only get added if the cache is stale, and the dynamic passes get dropped if nothing needs to go over the cache.
+	// Layered maps get a single pass covering every view instead of a pass per view
+	void _PlanMap(CacheEntry& cache, bool isStale, const ShadowCasterSet& casters, const Pass* views, const Frustum* frusta,
+		int viewCount, GLuint staticTarget, bool isLayered);
+	// Adds a draw for every caster in the list that intersects any of the frusta, grouped by mesh. Casters get an
+	// instance for each frustum they intersect, which carries the frustum's index in place of a material
+	void _AddDraws(const std::vector<ShadowCaster>& casters, const Frustum* frusta, int frustumCount, Pass& pass);
+	// Creates a depth texture array (or cube map array) with the given number of layers
+	static GLuint _CreateDepthTexture(GLenum target, int resolution, int layers);
+};
@@ -0,0 +1,40 @@
+#include "SkyboxPass.h"
+
+#include "GpuResources.h"
+#include "RenderState.h"
+#include "RenderStats.h"
+
+SkyboxPass::SkyboxPass(const TextureCubeMap::sptr& environment, const glm::mat3& rotation) :
+	_environment(environment),
+	_emptyVao(0)
+{
+	GPU_RESOURCE_OWNER("SkyboxPass");
+	_shader = Shader::Create();
+	_shader->LoadShaderPartFromFile("shaders/skybox-shader.vert.glsl", GL_VERTEX_SHADER);
+	_shader->LoadShaderPartFromFile("shaders/skybox-shader.frag.glsl", GL_FRAGMENT_SHADER);
+	_shader->Link();
+	// The rotation never changes, so it only needs setting the once
+	_shader->SetUniformMatrix("u_EnvironmentRotation"_hs, rotation);
+	glCreateVertexArrays(1, &_emptyVao);
+}
+
+SkyboxPass::~SkyboxPass() {
+	RenderState::OnVertexArrayDeleted(_emptyVao);
+	glDeleteVertexArrays(1, &_emptyVao);
+}
+
+void SkyboxPass::Render() {
+	if (_environment == nullptr) {
+		return;
+	}
+	_shader->Bind();
+	_environment->Bind(ENVIRONMENT_UNIT);
+	// The triangle sits right on the far plane, so it only passes where the depth buffer is still clear. There's no
+	// need to write it's depth, since nothing gets drawn behind the sky
+	RenderState::SetDepthFunc(GL_LEQUAL);
+	RenderState::SetDepthMask(false);
+	RenderState::BindVertexArray(_emptyVao);
+	RenderStats::CountDraw(3);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	RenderState::SetDepthMask(true);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <memory>
+#include <GLM/glm.hpp>
+
+#include "Shader.h"
+#include "TextureCubeMap.h"
+
+/// <summary>
+/// Draws the sky as a single full screen triangle at the far plane, after everything opaque. The view direction of
+/// each pixel is rebuilt from the inverse of the frame's skybox matrix, so there's no mesh or per object setup, and
+/// the depth test means only the pixels nothing was drawn over get shaded
+///
+/// Usage each frame: Render after the opaque scene, with the frame uniforms uploaded
+/// </summary>
+class SkyboxPass final
+{
+public:
+	typedef std::shared_ptr<SkyboxPass> sptr;
+	static inline sptr Create(const TextureCubeMap::sptr& environment, const glm::mat3& rotation = glm::mat3(1.0f)) {
+		return std::make_shared<SkyboxPass>(environment, rotation);
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	SkyboxPass(const SkyboxPass& other) = delete;
+	SkyboxPass(SkyboxPass&& other) = delete;
+	SkyboxPass& operator=(const SkyboxPass& other) = delete;
+	SkyboxPass& operator=(SkyboxPass&& other) = delete;
+
+public:
+	// The texture unit the environment map gets bound to, materials start from 1 so this one is free
+	static const int ENVIRONMENT_UNIT = 0;
+
+	/// <summary>
+	/// Creates the sky pass, and compiles it's shader
+	/// </summary>
+	/// <param name="environment">The cube map to draw as the sky</param>
+	/// <param name="rotation">Rotates the view direction before it's looked up in the cube map (ex: to make it Z up)</param>
+	SkyboxPass(const TextureCubeMap::sptr& environment, const glm::mat3& rotation);
+	~SkyboxPass();
+
+	/// <summary>
+	/// Draws the sky behind everything that has been drawn so far
+	/// </summary>
+	void Render();
+
+	/// <summary>
+	/// Swaps the cube map that gets drawn as the sky
+	/// </summary>
+	void SetEnvironment(const TextureCubeMap::sptr& environment) { _environment = environment; }
+
+protected:
+	Shader::sptr          _shader;
+	TextureCubeMap::sptr  _environment;
+	// The pass has no vertices, but drawing still needs a vertex array bound
+	GLuint                _emptyVao;
+};
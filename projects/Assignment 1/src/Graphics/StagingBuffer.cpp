@@ -0,0 +1,89 @@
+#include "StagingBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderStats.h"
+
+// Keeps the offsets of each upload aligned for any of the vertex or index types we copy
+static const size_t STAGING_ALIGNMENT = 16;
+
+StagingBuffer::StagingBuffer(size_t size) :
+	_handle(0),
+	_data(nullptr),
+	_size(size),
+	_head(0)
+{
+	// Persistent and coherent so we can write straight into the mapping and never have to unmap it
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &_handle);
+	glNamedBufferStorage(_handle, _size, nullptr, flags);
+	GpuResources::AddRaw(GL_BUFFER, _handle, _size, "Staging Buffer");
+	_data = static_cast<uint8_t*>(glMapNamedBufferRange(_handle, 0, _size, flags));
+	LOG_ASSERT(_data != nullptr, "Failed to map staging buffer!");
+}
+
+StagingBuffer::~StagingBuffer() {
+	for (const InFlight& range : _inFlight) {
+		glDeleteSync(range.Fence);
+	}
+	if (_handle != 0) {
+		glUnmapNamedBuffer(_handle);
+		GpuResources::RemoveRaw(GL_BUFFER, _handle);
+		glDeleteBuffers(1, &_handle);
+	}
+}
+
+void StagingBuffer::Upload(GLuint destination, size_t destinationOffset, const void* data, size_t size) {
+	RenderStats::CountBufferUpload(size);
+	const uint8_t* source = static_cast<const uint8_t*>(data);
+	while (size > 0) {
+		// Uploads are split in half of the ring at most, so the next piece can be written while the GPU copies this one
+		const size_t piece = std::min(size, std::max(_size / 2, static_cast<size_t>(1)));
+		const size_t offset = _Allocate(piece);
+		memcpy(_data + offset, source, piece);
+		glCopyNamedBufferSubData(_handle, destination, offset, destinationOffset, piece);
+		_inFlight.push_back({ offset, piece, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+		source += piece;
+		destinationOffset += piece;
+		size -= piece;
+	}
+}
+
+size_t StagingBuffer::_Allocate(size_t size) {
+	size_t offset = (_head + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+	if (offset + size > _size) {
+		offset = 0;
+	}
+	const size_t end = offset + size;
+
+	// Ranges are handed out in order around the ring, so the ones we overlap are always the oldest. Fences
+	// signal in order as well, so we only need to wait on the newest one that we overlap
+	int lastOverlap = -1;
+	for (size_t ix = 0; ix < _inFlight.size(); ix++) {
+		const InFlight& range = _inFlight[ix];
+		if (range.Offset < end && offset < range.Offset + range.Size) {
+			lastOverlap = static_cast<int>(ix);
+		}
+	}
+	if (lastOverlap != -1) {
+		GLenum result = glClientWaitSync(_inFlight[lastOverlap].Fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+		if (result == GL_WAIT_FAILED) {
+			LOG_WARN("Failed to wait on a staged upload, the staging buffer may be overwritten early");
+		}
+		for (int ix = 0; ix <= lastOverlap; ix++) {
+			glDeleteSync(_inFlight.front().Fence);
+			_inFlight.pop_front();
+		}
+	}
+
+	// Clean up any other uploads that have already finished, so the list doesn't keep growing
+	while (!_inFlight.empty() && glClientWaitSync(_inFlight.front().Fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+		glDeleteSync(_inFlight.front().Fence);
+		_inFlight.pop_front();
+	}
+
+	_head = end;
+	return offset;
+}
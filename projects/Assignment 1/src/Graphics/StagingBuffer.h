@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <glad/glad.h>
+
+/// <summary>
+/// A persistently mapped ring buffer for streaming data into other buffers. Data gets written straight into the
+/// mapping, then the GPU copies it into place with glCopyNamedBufferSubData, so the CPU can get on with other work
+/// while the transfer happens. Each copy is fenced, and we only wait on the GPU when the ring wraps around onto a
+/// range it hasn't finished reading yet
+/// </summary>
+class StagingBuffer final
+{
+public:
+	typedef std::shared_ptr<StagingBuffer> sptr;
+	static inline sptr Create(size_t size) {
+		return std::make_shared<StagingBuffer>(size);
+	}
+	// We'll disallow moving and copying, since we want to manually control when the destructor is called
+	StagingBuffer(const StagingBuffer& other) = delete;
+	StagingBuffer(StagingBuffer&& other) = delete;
+	StagingBuffer& operator=(const StagingBuffer& other) = delete;
+	StagingBuffer& operator=(StagingBuffer&& other) = delete;
+
+	/// <summary>
+	/// Creates and maps a new staging buffer
+	/// </summary>
+	/// <param name="size">The size of the ring, in bytes</param>
+	StagingBuffer(size_t size);
+	~StagingBuffer();
+
+	/// <summary>
+	/// Copies data into the ring, and queues a copy from the ring into the destination buffer. Data bigger than the
+	/// ring is split up into pieces
+	/// </summary>
+	/// <param name="destination">The handle of the buffer to copy into</param>
+	/// <param name="destinationOffset">Where to copy the data to in the destination, in bytes</param>
+	/// <param name="data">The data to upload</param>
+	/// <param name="size">The number of bytes to upload</param>
+	void Upload(GLuint destination, size_t destinationOffset, const void* data, size_t size);
+
+	/// <summary>
+	/// Gets the size of the ring, in bytes
+	/// </summary>
+	size_t GetSize() const { return _size; }
+
+protected:
+	// A range of the ring that the GPU may still be reading from
+	struct InFlight {
+		size_t Offset;
+		size_t Size;
+		GLsync Fence;
+	};
+
+	GLuint               _handle;
+	uint8_t*             _data;
+	size_t               _size;
+	size_t               _head;
+	std::deque<InFlight> _inFlight;
+
+	// Finds room in the ring, waiting on the GPU if it's still using that range
+	size_t _Allocate(size_t size);
+};
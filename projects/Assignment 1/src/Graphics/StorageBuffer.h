@@ -0,0 +1,28 @@
+#pragma once
+#include "IBuffer.h"
+#include <memory>
+
+/// <summary>
+/// A storage buffer holds an array of std430 structures that shaders can read (and compute shaders can write) through
+/// a shader storage binding point
+/// </summary>
+class StorageBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<StorageBuffer> sptr;
+	static inline sptr Create(GLenum usage = GL_DYNAMIC_DRAW) {
+		return std::make_shared<StorageBuffer>(usage);
+	}
+
+public:
+	/// <summary>
+	/// Creates a new storage buffer, with the given usage. Data will still need to be uploaded before it can be used
+	/// </summary>
+	/// <param name="usage">The usage hint for the buffer, default is GL_DYNAMIC_DRAW</param>
+	StorageBuffer(GLenum usage = GL_DYNAMIC_DRAW) : IBuffer(GL_SHADER_STORAGE_BUFFER, usage) { }
+
+	/// <summary>
+	/// Unbinds the current storage buffer
+	/// </summary>
+	static void UnBind() { IBuffer::UnBind(GL_SHADER_STORAGE_BUFFER); }
+};
@@ -1,44 +1,124 @@
 #include "Texture2D.h"
 
+#include <algorithm>
+
+#include "RenderStats.h"
+#include "TextureResidency.h"
+#include "Utilities/TraceRecorder.h"
+
 Texture2D::Texture2D(const Texture2DDescription& description) :
-	ITexture(), _description(description)
+	ITexture(), _description(description), _levelCount(_GetWantedLevelCount(description.Width, description.Height)),
+	_droppedLevels(0)
 {
-
+	_UpdateSampler();
 	_RecreateTexture();
 }
 
 void Texture2D::_RecreateTexture() {
-	if (_handle != 0) {
-		glDeleteTextures(1, &_handle);
-		_handle = 0;
-	}
+	// Any bindless handle we had goes with the old storage, materials notice the new one the next time they're applied
+	_DeleteTexture();
 
 	glCreateTextures(GL_TEXTURE_2D, 1, &_handle);
+	_droppedLevels = 0;
 
-	if (_description.MaxAnisotropic < 0.0f) {
-		_description.MaxAnisotropic = ITexture::GetLimits().MAX_ANISOTROPY;
-	}
-
+	// Our sampling state lives in _sampler, so we only need to allocate storage here
 	if (_description.Width * _description.Height > 0 && _description.Format != InternalFormat::Unknown)
 	{
-		glTextureStorage2D(_handle, 1, *_description.Format, _description.Width, _description.Height);
+		glTextureStorage2D(_handle, _levelCount, *_description.Format, _description.Width, _description.Height);
+		_SetMemorySize(GetTextureMemorySize(_description.Format, _description.Width, _description.Height, _levelCount));
+	}
+}
 
-		glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, (GLenum)_description.HorizontalWrap);
-		glTextureParameteri(_handle, GL_TEXTURE_WRAP_T, (GLenum)_description.VerticalWrap);
-		glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, (GLenum)_description.MinificationFilter);
-		glTextureParameteri(_handle, GL_TEXTURE_MAG_FILTER, (GLenum)_description.MagnificationFilter);
-		glTextureParameterf(_handle, GL_TEXTURE_MAX_ANISOTROPY, _description.MaxAnisotropic);
+bool Texture2D::DropLevels(uint32_t count) {
+	// Materials hold on to bindless handles, so we can't swap out the texture underneath them
+	if (count == 0 || count >= _levelCount || _handle == 0 || _bindlessHandle != 0) {
+		return false;
 	}
+	const uint32_t width = std::max(_description.Width >> count, 1u);
+	const uint32_t height = std::max(_description.Height >> count, 1u);
+	const uint32_t levelCount = _levelCount - count;
+
+	// The smaller levels are already on the GPU, so we can copy them over without going through the CPU
+	GLuint handle = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &handle);
+	glTextureStorage2D(handle, levelCount, *_description.Format, width, height);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		const uint32_t levelWidth = std::max(width >> level, 1u);
+		const uint32_t levelHeight = std::max(height >> level, 1u);
+		glCopyImageSubData(_handle, GL_TEXTURE_2D, level + count, 0, 0, 0, handle, GL_TEXTURE_2D, level, 0, 0, 0, levelWidth, levelHeight, 1);
+	}
+
+	const uint32_t droppedLevels = _droppedLevels + count;
+	_DeleteTexture();
+	_handle = handle;
+	// Labels belong to the GL object, so the new one needs labelling again
+	SetDebugName(_debugName);
+	_description.Width = width;
+	_description.Height = height;
+	_levelCount = levelCount;
+	_droppedLevels = droppedLevels;
+	_SetMemorySize(GetTextureMemorySize(_description.Format, width, height, levelCount));
+	return true;
+}
+
+size_t Texture2D::GetFullMemorySize() const {
+	return GetTextureMemorySize(_description.Format, _description.Width << _droppedLevels, _description.Height << _droppedLevels, _levelCount + _droppedLevels);
+}
+
+uint32_t Texture2D::_GetWantedLevelCount(uint32_t width, uint32_t height) const {
+	return _description.GenerateMipMaps ? GetMipLevelCount(width, height) : 1;
+}
+
+void Texture2D::_UpdateSampler() {
+	SamplerDescription sampler;
+	sampler.WrapS               = _description.HorizontalWrap;
+	sampler.WrapT               = _description.VerticalWrap;
+	sampler.MinificationFilter  = _description.MinificationFilter;
+	sampler.MagnificationFilter = _description.MagnificationFilter;
+	sampler.MaxAnisotropic      = _description.MaxAnisotropic;
+	_sampler = Sampler::Get(sampler);
 }
 
 void Texture2D::LoadData(const Texture2DData::sptr& data) {
+	_Upload(data, data->GetDataPtr());
+}
+
+void Texture2D::LoadData(const Texture2DData::sptr& data, GLuint pixelBuffer, size_t offset) {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	_Upload(data, reinterpret_cast<const void*>(offset));
+	// Everything else uploads from client memory, so we can't leave this bound
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+Texture2DData::sptr Texture2D::GetCpuData() {
+	if (_cpuCopy != nullptr || _description.Residency == CpuResidency::GpuOnly) {
+		return _cpuCopy;
+	}
+	if (_sourcePath.empty()) {
+		LOG_WARN("Texture has no source file to load it's CPU copy from");
+		return nullptr;
+	}
+	Texture2DData::sptr result = Texture2DData::LoadFromFile(_sourcePath);
+	if (_description.Residency == CpuResidency::KeepCpuCopy) {
+		_cpuCopy = result;
+	}
+	return result;
+}
+
+void Texture2D::_Upload(const Texture2DData::sptr& data, const void* pixels) {
+	// Anything we held onto is out of date now, and we only hang onto the new data if we've been asked to
+	_cpuCopy = _description.Residency == CpuResidency::KeepCpuCopy ? data : nullptr;
+	// We also need new storage if we were holding compressed data or a different number of levels before
+	const uint32_t levelCount = _GetWantedLevelCount(data->GetWidth(), data->GetHeight());
 	if (_description.Width != data->GetWidth() ||
-		_description.Height != data->GetHeight()) 
+		_description.Height != data->GetHeight() ||
+		IsCompressedFormat(_description.Format) || _levelCount != levelCount)
 	{
 		_description.Width = data->GetWidth();
 		_description.Height = data->GetHeight();
+		_levelCount = levelCount;
 		
-		if (_description.Format == InternalFormat::Unknown) {
+		if (_description.Format == InternalFormat::Unknown || IsCompressedFormat(_description.Format)) {
 			_description.Format = data->GetRecommendedFormat();
 		}
 		
@@ -46,9 +126,7 @@ void Texture2D::LoadData(const Texture2DData::sptr& data) {
 	}
 	
 	// We can get better error logs by attaching an object label!
-	if (!data->DebugName.empty()) {
-		glObjectLabel(GL_TEXTURE, _handle, data->DebugName.length(), data->DebugName.c_str());
-	}
+	SetDebugName(data->DebugName);
 	
 	// Align the data store to the size of a single component in
 	// See https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glPixelStore.xhtml
@@ -56,56 +134,212 @@ void Texture2D::LoadData(const Texture2DData::sptr& data) {
 	glPixelStorei(GL_PACK_ALIGNMENT, componentSize);
 
 	// Upload our data to our image
-	glTextureSubImage2D(_handle, 0, 0, 0, _description.Width, _description.Height, *data->GetFormat(), *data->GetPixelType(), data->GetDataPtr());
+	glTextureSubImage2D(_handle, 0, 0, 0, _description.Width, _description.Height, *data->GetFormat(), *data->GetPixelType(), pixels);
+	RenderStats::CountTextureUpload(data->GetDataSize());
 
-	if (_description.GenerateMipMaps) {
+	// Images that haven't been cooked (see TextureCook) get their mips from the driver instead
+	if (_levelCount > 1) {
 		glGenerateTextureMipmap(_handle);
 	}
 }
 
+void Texture2D::LoadData(const MipChainData::sptr& data) {
+	_UploadLevels(data, static_cast<const uint8_t*>(data->GetDataPtr()));
+}
+
+void Texture2D::LoadData(const MipChainData::sptr& data, GLuint pixelBuffer, size_t offset) {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	_UploadLevels(data, reinterpret_cast<const uint8_t*>(offset));
+	// Everything else uploads from client memory, so we can't leave this bound
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void Texture2D::_UploadLevels(const MipChainData::sptr& data, const uint8_t* pixels) {
+	// The chain isn't kept, GetCpuData loads the top level from our source if it's asked for
+	_cpuCopy = nullptr;
+	// We only take the levels we would have generated, the rest of the chain is ignored
+	const uint32_t levelCount = std::min(_GetWantedLevelCount(data->GetWidth(), data->GetHeight()), data->GetLevelCount());
+	if (_description.Width != data->GetWidth() ||
+		_description.Height != data->GetHeight() ||
+		IsCompressedFormat(_description.Format) || _levelCount != levelCount)
+	{
+		_description.Width = data->GetWidth();
+		_description.Height = data->GetHeight();
+		_levelCount = levelCount;
+
+		if (_description.Format == InternalFormat::Unknown || IsCompressedFormat(_description.Format)) {
+			_description.Format = data->GetRecommendedFormat();
+		}
+
+		_RecreateTexture();
+	}
+
+	// We can get better error logs by attaching an object label!
+	SetDebugName(data->DebugName);
+
+	// The smaller levels are often not a multiple of 4 wide, so we still need to match the component size
+	int componentSize = (GLint)GetTexelComponentSize(data->GetPixelType());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, componentSize);
+
+	// The levels were filtered offline, so we just copy them in
+	for (uint32_t level = 0; level < _levelCount; level++) {
+		const MipChainData::MipLevel& mip = data->GetLevel(level);
+		glTextureSubImage2D(_handle, level, 0, 0, mip.Width, mip.Height, *data->GetFormat(), *data->GetPixelType(), pixels + mip.Offset);
+		RenderStats::CountTextureUpload(mip.Size);
+	}
+}
+
+// Picks the format an upload gets stored in, the same way _Upload and _UploadLevels do
+template <typename T>
+static InternalFormat GetUploadFormat(const Texture2DDescription& description, const T& data) {
+	return description.Format == InternalFormat::Unknown || IsCompressedFormat(description.Format) ? data->GetRecommendedFormat() : description.Format;
+}
+
+Texture2D::Upload Texture2D::Prepare(const Texture2DDescription& description, const Texture2DData::sptr& data) {
+	Upload result;
+	result.Width = data->GetWidth();
+	result.Height = data->GetHeight();
+	result.LevelCount = description.GenerateMipMaps ? GetMipLevelCount(result.Width, result.Height) : 1;
+	result.Format = GetUploadFormat(description, data);
+	result.Size = data->GetDataSize();
+	result.DebugName = data->DebugName;
+	result.CpuCopy = description.Residency == CpuResidency::KeepCpuCopy ? data : nullptr;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &result.Handle);
+	glTextureStorage2D(result.Handle, result.LevelCount, *result.Format, result.Width, result.Height);
+	// Unpack state belongs to the context, so we set it every time rather than trusting whoever ran last
+	glPixelStorei(GL_UNPACK_ALIGNMENT, (GLint)GetTexelComponentSize(data->GetPixelType()));
+	glTextureSubImage2D(result.Handle, 0, 0, 0, result.Width, result.Height, *data->GetFormat(), *data->GetPixelType(), data->GetDataPtr());
+	if (result.LevelCount > 1) {
+		glGenerateTextureMipmap(result.Handle);
+	}
+	return result;
+}
+
+Texture2D::Upload Texture2D::Prepare(const Texture2DDescription& description, const MipChainData::sptr& data) {
+	Upload result;
+	result.Width = data->GetWidth();
+	result.Height = data->GetHeight();
+	const uint32_t wantedLevels = description.GenerateMipMaps ? GetMipLevelCount(result.Width, result.Height) : 1;
+	result.LevelCount = std::min(wantedLevels, data->GetLevelCount());
+	result.Format = GetUploadFormat(description, data);
+	result.DebugName = data->DebugName;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &result.Handle);
+	glTextureStorage2D(result.Handle, result.LevelCount, *result.Format, result.Width, result.Height);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, (GLint)GetTexelComponentSize(data->GetPixelType()));
+	const uint8_t* pixels = static_cast<const uint8_t*>(data->GetDataPtr());
+	for (uint32_t level = 0; level < result.LevelCount; level++) {
+		const MipChainData::MipLevel& mip = data->GetLevel(level);
+		glTextureSubImage2D(result.Handle, level, 0, 0, mip.Width, mip.Height, *data->GetFormat(), *data->GetPixelType(), pixels + mip.Offset);
+		result.Size += mip.Size;
+	}
+	return result;
+}
+
+void Texture2D::Adopt(const Upload& upload) {
+	_DeleteTexture();
+	_handle = upload.Handle;
+	_description.Width = upload.Width;
+	_description.Height = upload.Height;
+	_description.Format = upload.Format;
+	_levelCount = upload.LevelCount;
+	_droppedLevels = 0;
+	_cpuCopy = upload.CpuCopy;
+	_SetMemorySize(GetTextureMemorySize(_description.Format, _description.Width, _description.Height, _levelCount));
+	// Labels belong to the GL object, so a new one needs labelling again
+	SetDebugName(upload.DebugName.empty() ? GetDebugName() : upload.DebugName);
+	RenderStats::CountTextureUpload(upload.Size);
+}
+
+void Texture2D::LoadData(const CompressedTextureData::sptr& data) {
+	_cpuCopy = nullptr;
+	// The format and number of levels are baked into our storage, so we always need to recreate it
+	_description.Width = data->GetWidth();
+	_description.Height = data->GetHeight();
+	_description.Format = data->GetFormat();
+	_levelCount = data->GetLevelCount();
+	_RecreateTexture();
+
+	// We can get better error logs by attaching an object label!
+	SetDebugName(data->DebugName);
+
+	// The mip chain comes pre-built, so there's nothing to generate
+	for (uint32_t level = 0; level < _levelCount; level++) {
+		const CompressedTextureData::MipLevel& mip = data->GetLevel(level);
+		glCompressedTextureSubImage2D(_handle, level, 0, 0, mip.Width, mip.Height, *_description.Format, (GLsizei)mip.Size, data->GetLevelData(level));
+		RenderStats::CountTextureUpload(mip.Size);
+	}
+}
+
 Texture2D::sptr Texture2D::LoadFromFile(const std::string& path) {
+	AssetLoadScope load(path);
+	if (CompressedTextureData::IsSupportedFile(path)) {
+		CompressedTextureData::sptr data = CompressedTextureData::LoadFromFile(path);
+		LOG_ASSERT(data != nullptr, "Failed to load compressed image from file!");
+		Texture2D::sptr result = Texture2D::Create();
+		result->LoadData(data);
+		result->SetSourcePath(path);
+		TextureResidency::Register(result);
+		return result;
+	}
+	Texture2D::sptr result = Texture2D::Create();
+	result->SetSourcePath(path);
+	TextureResidency::Register(result);
+	// Prefer the cooked mips if the image has them, they are filtered better than the driver does it
+	MipChainData::sptr mips = MipChainData::LoadSidecar(path);
+	if (mips != nullptr) {
+		result->LoadData(mips);
+		return result;
+	}
 	Texture2DData::sptr data = Texture2DData::LoadFromFile(path);
 	LOG_ASSERT(data != nullptr, "Failed to load image from file!");
-	Texture2D::sptr result = Texture2D::Create();
 	result->LoadData(data);
 	return result;
 }
 
 void Texture2D::SetMinFilter(MinFilter filter) {
-	_description.MinificationFilter = filter;
-	if (_handle != 0) {
-		glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, (GLenum)_description.MinificationFilter);
+	if (_bindlessHandle != 0) {
+		LOG_WARN("Cannot change the sampling state of a texture once it has a bindless handle");
+		return;
 	}
+	_description.MinificationFilter = filter;
+	_UpdateSampler();
 }
 
 void Texture2D::SetMagFilter(MagFilter filter) {
-	_description.MagnificationFilter = filter;
-	if (_handle != 0) {
-		glTextureParameteri(_handle, GL_TEXTURE_MAG_FILTER, (GLenum)_description.MagnificationFilter);
+	if (_bindlessHandle != 0) {
+		LOG_WARN("Cannot change the sampling state of a texture once it has a bindless handle");
+		return;
 	}
+	_description.MagnificationFilter = filter;
+	_UpdateSampler();
 }
 
 void Texture2D::SetWrapS(WrapMode mode) {
-	_description.HorizontalWrap = mode;
-	if (_handle != 0) {
-		glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, (GLenum)_description.HorizontalWrap);
+	if (_bindlessHandle != 0) {
+		LOG_WARN("Cannot change the sampling state of a texture once it has a bindless handle");
+		return;
 	}
+	_description.HorizontalWrap = mode;
+	_UpdateSampler();
 }
 
 void Texture2D::SetWrapT(WrapMode mode) {
-	_description.VerticalWrap = mode;
-	if (_handle != 0) {
-		glTextureParameteri(_handle, GL_TEXTURE_WRAP_T, (GLenum)_description.VerticalWrap);
+	if (_bindlessHandle != 0) {
+		LOG_WARN("Cannot change the sampling state of a texture once it has a bindless handle");
+		return;
 	}
+	_description.VerticalWrap = mode;
+	_UpdateSampler();
 }
 
 void Texture2D::SetAnisotropicFiltering(float level)
 {
-	if (level < 0.0f) {
-		level = ITexture::GetLimits().MAX_ANISOTROPY;
+	if (_bindlessHandle != 0) {
+		LOG_WARN("Cannot change the sampling state of a texture once it has a bindless handle");
+		return;
 	}
 	_description.MaxAnisotropic = level;
-	if (_handle != 0) {
-		glTextureParameterf(_handle, GL_TEXTURE_MAX_ANISOTROPY, _description.MaxAnisotropic);
-	}
+	_UpdateSampler();
 }
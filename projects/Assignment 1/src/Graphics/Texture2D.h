@@ -1,12 +1,16 @@
 #pragma once
 #include <memory>
 #include <cstdint>
+#include <string>
 #include <GLM/glm.hpp>
 
 
+#include "CpuResidency.h"
 #include "ITexture.h"
 #include "TextureEnums.h"
 #include "Texture2DData.h"
+#include "CompressedTextureData.h"
+#include "MipChainData.h"
 
 struct Texture2DDescription
 {
@@ -19,6 +23,11 @@ struct Texture2DDescription
 	MagFilter      MagnificationFilter;
 	float          MaxAnisotropic;
 	bool           GenerateMipMaps;
+	// Whether the pixels are kept in CPU memory after they've been uploaded, see GetCpuData
+	CpuResidency   Residency;
+	// Whether TextureLoader should block compress the image after decoding it (caching the result next to it), see
+	// TextureCompressor. Only for images that were never cooked offline, anything already compressed loads as it is
+	bool           Compressible;
 
 	Texture2DDescription() :
 		Width(0), Height(0),
@@ -28,7 +37,9 @@ struct Texture2DDescription
 		MinificationFilter(MinFilter::NearestMipLinear),
 		MagnificationFilter(MagFilter::Linear),
 		MaxAnisotropic(-1.0f),
-		GenerateMipMaps(true)
+		GenerateMipMaps(true),
+		Residency(CpuResidency::GpuOnly),
+		Compressible(false)
 	{ }
 };
 
@@ -64,9 +75,70 @@ public:
 	/// </summary>
 	/// <param name="data">The texture data to upload into this texture</param>
 	void LoadData(const Texture2DData::sptr& data);
+	/// <summary>
+	/// Uploads data to this texture from a pixel buffer, the pixels are read from the buffer instead of from data
+	/// </summary>
+	/// <param name="data">The texture data that describes the pixels (size, format, etc...)</param>
+	/// <param name="pixelBuffer">The OpenGL handle of the buffer holding the pixels</param>
+	/// <param name="offset">The offset of the first pixel in the buffer, in bytes</param>
+	void LoadData(const Texture2DData::sptr& data, GLuint pixelBuffer, size_t offset);
+	/// <summary>
+	/// Uploads a block compressed image and all of it's mip levels to this texture, replacing our format
+	/// </summary>
+	/// <param name="data">The compressed data to upload into this texture</param>
+	void LoadData(const CompressedTextureData::sptr& data);
+	/// <summary>
+	/// Uploads an image along with it's pre-built mip levels (see TextureCook), instead of generating them
+	/// </summary>
+	/// <param name="data">The mip chain to upload into this texture</param>
+	void LoadData(const MipChainData::sptr& data);
+	/// <summary>
+	/// Uploads a pre-built mip chain from a pixel buffer, the levels are read from the buffer instead of from data
+	/// </summary>
+	/// <param name="data">The mip chain that describes the levels (size, format, etc...)</param>
+	/// <param name="pixelBuffer">The OpenGL handle of the buffer holding the levels, laid out the same as data</param>
+	/// <param name="offset">The offset of the first level in the buffer, in bytes</param>
+	void LoadData(const MipChainData::sptr& data, GLuint pixelBuffer, size_t offset);
+
+	/// <summary>
+	/// A texture object that was made and filled in off of the main thread (see UploadContext), ready to take the
+	/// place of a texture's storage with Adopt
+	/// </summary>
+	struct Upload {
+		GLuint              Handle = 0;
+		uint32_t            Width = 0;
+		uint32_t            Height = 0;
+		uint32_t            LevelCount = 0;
+		InternalFormat      Format = InternalFormat::Unknown;
+		// The bytes that were uploaded, counted towards the frame's stats once the upload is adopted
+		size_t              Size = 0;
+		std::string         DebugName;
+		// The image, if the texture keeps it's pixels on the CPU
+		Texture2DData::sptr CpuCopy;
+	};
+	/// <summary>
+	/// Makes a new texture object and uploads an image into it, generating it's mips if the description wants them.
+	/// Only makes OpenGL calls, so it's safe to run with any context that shares objects with the main one current
+	/// </summary>
+	/// <param name="description">The description of the texture the upload is for</param>
+	/// <param name="data">The image to upload</param>
+	static Upload Prepare(const Texture2DDescription& description, const Texture2DData::sptr& data);
+	/// <summary>
+	/// Makes a new texture object and uploads a pre-built mip chain into it, see the other overload
+	/// </summary>
+	/// <param name="description">The description of the texture the upload is for</param>
+	/// <param name="data">The mip chain to upload</param>
+	static Upload Prepare(const Texture2DDescription& description, const MipChainData::sptr& data);
+	/// <summary>
+	/// Takes over a texture object made by Prepare, deleting our old storage. Must be called on the main thread once
+	/// the upload has finished on the GPU. Like any other time our storage changes, this changes our handle
+	/// </summary>
+	/// <param name="upload">The upload to take over, it's handle belongs to us afterwards</param>
+	void Adopt(const Upload& upload);
 
 	/// <summary>
-	/// Loads an image directly from a file
+	/// Loads an image directly from a file, .dds and .ktx2 files are loaded as block compressed textures. Any other
+	/// image will use it's cooked mip chain if there is one
 	/// </summary>
 	/// <param name="path">The path to load the image from</param>
 	/// <returns>A pointer to the loaded image</returns>
@@ -74,6 +146,7 @@ public:
 	
 	uint32_t GetWidth() const { return _description.Width; }
 	uint32_t GetHeight() const { return _description.Height; }
+	uint32_t GetLevelCount() const { return _levelCount; }
 	InternalFormat GetFormat() const { return _description.Format; }	
 	MinFilter GetMinFilter() const { return _description.MinificationFilter; }
 	MagFilter GetMagFilter() const { return _description.MagnificationFilter; }
@@ -87,9 +160,66 @@ public:
 	void SetAnisotropicFiltering(float level = -1.0f);
 
 	const Texture2DDescription& GetDescription() const { return _description; }
+
+	/// <summary>
+	/// Sets the file this texture was loaded from, so that it can be loaded again after TextureResidency shrinks it
+	/// </summary>
+	void SetSourcePath(const std::string& path) { _sourcePath = path; }
+	/// <summary>
+	/// Gets the file this texture was loaded from, or an empty string if it was not loaded from a file
+	/// </summary>
+	const std::string& GetSourcePath() const { return _sourcePath; }
+
+	/// <summary>
+	/// Gets a CPU copy of the texture's pixels, depending on it's residency. Textures that keep their copy hand it
+	/// straight back (textures loaded from a cooked mip chain load theirs from the source file the first time, and
+	/// keep it from then on). Textures that reload on demand decode the source file again every time, and GPU only
+	/// textures don't have a copy at all
+	/// </summary>
+	/// <returns>The pixels of the texture's largest level, or nullptr if there's no copy to be had</returns>
+	Texture2DData::sptr GetCpuData();
+
+	/// <summary>
+	/// Frees the largest levels of our mip chain, keeping the smaller levels so the texture can still be sampled.
+	/// The texture stays shrunk until new data is loaded into it. Note that this changes our handle
+	/// </summary>
+	/// <param name="count">The number of levels to drop</param>
+	/// <returns>True if the levels were dropped, textures with bindless handles can't be shrunk</returns>
+	bool DropLevels(uint32_t count);
+	/// <summary>
+	/// Marks this texture as a placeholder for an image that is count levels bigger than our storage, so it looks the
+	/// same as a texture DropLevels has shrunk (ex: TextureResidency will load the full image once it's used). The
+	/// texture stays a placeholder until new data is loaded into it
+	/// </summary>
+	/// <param name="count">The number of levels the full image has on top of ours</param>
+	void SetMissingLevels(uint32_t count) { _droppedLevels = count; }
+	/// <summary>
+	/// Gets the number of levels that have been dropped by DropLevels (or are missing from a placeholder) since data
+	/// was last loaded
+	/// </summary>
+	uint32_t GetDroppedLevels() const { return _droppedLevels; }
+	/// <summary>
+	/// Gets roughly how much memory this texture would use with all of it's levels, in bytes
+	/// </summary>
+	size_t GetFullMemorySize() const;
 	
 private:
 	Texture2DDescription _description;
+	// The number of mip levels in our storage, a full chain unless GenerateMipMaps is off or the data brings it's own
+	uint32_t             _levelCount;
+	// How many of the largest levels are missing from our storage (see DropLevels)
+	uint32_t             _droppedLevels;
+	std::string          _sourcePath;
+	// Only held onto if our residency is KeepCpuCopy
+	Texture2DData::sptr  _cpuCopy;
 
 	void _RecreateTexture();
+	// Uploads pixels for the given data, pixels is either a pointer or an offset into the bound unpack buffer
+	void _Upload(const Texture2DData::sptr& data, const void* pixels);
+	// Uploads each level of a mip chain, pixels is either a pointer or an offset into the bound unpack buffer
+	void _UploadLevels(const MipChainData::sptr& data, const uint8_t* pixels);
+	// Gets the number of levels our storage should have for an image of the given size
+	uint32_t _GetWantedLevelCount(uint32_t width, uint32_t height) const;
+	// Picks the shared sampler that matches our description
+	void _UpdateSampler();
 };
@@ -0,0 +1,60 @@
+#include "Texture2DArray.h"
+#include "RenderStats.h"
+
+Texture2DArray::Texture2DArray(const Texture2DDescription& description, uint32_t layers) :
+	ITexture(), _description(description), _layerCount(layers), _levelCount(1)
+{
+	LOG_ASSERT(description.Width * description.Height > 0 && layers > 0, "Texture arrays need a size and at least one layer!");
+	LOG_ASSERT(description.Format != InternalFormat::Unknown && !IsCompressedFormat(description.Format), "Texture arrays need an uncompressed format!");
+	if (_description.GenerateMipMaps) {
+		_levelCount = GetMipLevelCount(_description.Width, _description.Height);
+	}
+	_UpdateSampler();
+
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &_handle);
+	glTextureStorage3D(_handle, _levelCount, *_description.Format, _description.Width, _description.Height, _layerCount);
+	_SetMemorySize(GetTextureMemorySize(_description.Format, _description.Width, _description.Height, _levelCount, _layerCount));
+}
+
+void Texture2DArray::_UpdateSampler() {
+	SamplerDescription sampler;
+	sampler.WrapS               = _description.HorizontalWrap;
+	sampler.WrapT               = _description.VerticalWrap;
+	sampler.MinificationFilter  = _description.MinificationFilter;
+	sampler.MagnificationFilter = _description.MagnificationFilter;
+	sampler.MaxAnisotropic      = _description.MaxAnisotropic;
+	_sampler = Sampler::Get(sampler);
+}
+
+void Texture2DArray::LoadLayer(uint32_t layer, const Texture2DData::sptr& data) {
+	_UploadLayer(layer, data, data->GetDataPtr());
+}
+
+void Texture2DArray::LoadLayer(uint32_t layer, const Texture2DData::sptr& data, GLuint pixelBuffer, size_t offset) {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	_UploadLayer(layer, data, reinterpret_cast<const void*>(offset));
+	// Everything else uploads from client memory, so we can't leave this bound
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void Texture2DArray::_UploadLayer(uint32_t layer, const Texture2DData::sptr& data, const void* pixels) {
+	// Unlike Texture2D we can't resize to fit the data, since every other layer would have to change with it
+	if (layer >= _layerCount || data->GetWidth() != _description.Width || data->GetHeight() != _description.Height) {
+		LOG_WARN("Cannot load a {}x{} image into layer {} of a {}x{}x{} texture array", data->GetWidth(), data->GetHeight(),
+			layer, _description.Width, _description.Height, _layerCount);
+		return;
+	}
+
+	// Align the data store to the size of a single component in
+	// See https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glPixelStore.xhtml
+	int componentSize = (GLint)GetTexelComponentSize(data->GetPixelType());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, componentSize);
+
+	glTextureSubImage3D(_handle, 0, 0, 0, layer, _description.Width, _description.Height, 1, *data->GetFormat(), *data->GetPixelType(), pixels);
+	RenderStats::CountTextureUpload(data->GetDataSize());
+
+	// This regenerates every layer, but arrays are only filled in while loading so it's not worth tracking which changed
+	if (_levelCount > 1) {
+		glGenerateTextureMipmap(_handle);
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <memory>
+#include <cstdint>
+
+#include "ITexture.h"
+#include "TextureEnums.h"
+#include "Texture2D.h"
+#include "Texture2DData.h"
+
+/// <summary>
+/// Represents a wrapper around a 2D array texture, where every layer has the same size and format. Materials that
+/// only differ by which image they sample can share one of these, and pick their image with a layer index instead
+/// of binding a different texture (see TextureArrayBuilder)
+/// </summary>
+class Texture2DArray final : public ITexture
+{
+public:
+	// We'll disallow moving and copying, since we want to manually control when the destructor is called
+	// We'll use these classes via pointers
+	Texture2DArray(const Texture2DArray& other) = delete;
+	Texture2DArray(Texture2DArray&& other) = delete;
+	Texture2DArray& operator=(const Texture2DArray& other) = delete;
+	Texture2DArray& operator=(Texture2DArray&& other) = delete;
+
+	typedef std::shared_ptr<Texture2DArray> sptr;
+	static inline sptr Create(const Texture2DDescription& description, uint32_t layers) {
+		return std::make_shared<Texture2DArray>(description, layers);
+	}
+
+public:
+	/// <summary>
+	/// Creates a new array texture, the storage for all of the layers is allocated up front
+	/// </summary>
+	/// <param name="description">The size, format and sampling settings shared by every layer</param>
+	/// <param name="layers">The number of layers in the array</param>
+	Texture2DArray(const Texture2DDescription& description, uint32_t layers);
+	// ITexture handles destroying the OpenGL data, so we can use the default destructor
+	~Texture2DArray() = default;
+
+	/// <summary>
+	/// Uploads data into one of our layers, the data must be the same size as the array (see TextureCook::Resize)
+	/// </summary>
+	/// <param name="layer">The index of the layer to upload to</param>
+	/// <param name="data">The texture data to upload into the layer</param>
+	void LoadLayer(uint32_t layer, const Texture2DData::sptr& data);
+	/// <summary>
+	/// Uploads data into one of our layers from a pixel buffer, the pixels are read from the buffer instead of from data
+	/// </summary>
+	/// <param name="layer">The index of the layer to upload to</param>
+	/// <param name="data">The texture data that describes the pixels (size, format, etc...)</param>
+	/// <param name="pixelBuffer">The OpenGL handle of the buffer holding the pixels</param>
+	/// <param name="offset">The offset of the first pixel in the buffer, in bytes</param>
+	void LoadLayer(uint32_t layer, const Texture2DData::sptr& data, GLuint pixelBuffer, size_t offset);
+
+	uint32_t GetWidth() const { return _description.Width; }
+	uint32_t GetHeight() const { return _description.Height; }
+	uint32_t GetLayerCount() const { return _layerCount; }
+	uint32_t GetLevelCount() const { return _levelCount; }
+	InternalFormat GetFormat() const { return _description.Format; }
+
+	const Texture2DDescription& GetDescription() const { return _description; }
+
+private:
+	Texture2DDescription _description;
+	uint32_t             _layerCount;
+	uint32_t             _levelCount;
+
+	// Uploads pixels for the given layer, pixels is either a pointer or an offset into the bound unpack buffer
+	void _UploadLayer(uint32_t layer, const Texture2DData::sptr& data, const void* pixels);
+	// Picks the shared sampler that matches our description
+	void _UpdateSampler();
+};
@@ -1,8 +1,43 @@
 #include "Texture2DData.h"
 
 #include <filesystem>
+#include <mutex>
 #include <stb_image.h>
 
+#include "Utilities/MemoryTracker.h"
+#include "Utilities/TraceRecorder.h"
+#include "Utilities/VirtualFileSystem.h"
+
+// Gets the formats to use for an image with the given number of channels
+static bool GetFormatsForChannels(int numChannels, InternalFormat& internalFormat, PixelFormat& imageFormat) {
+	switch (numChannels) {
+	case 1:
+		internalFormat = InternalFormat::R8;
+		imageFormat = PixelFormat::Red;
+		return true;
+	case 2:
+		internalFormat = InternalFormat::RG8;
+		imageFormat = PixelFormat::RG;
+		return true;
+	case 3:
+		internalFormat = InternalFormat::RGB8;
+		imageFormat = PixelFormat::RGB;
+		return true;
+	case 4:
+		internalFormat = InternalFormat::RGBA8;
+		imageFormat = PixelFormat::RGBA;
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Gets the format to use for an HDR image with the given number of channels. Colors go into a shared exponent format,
+// which has the range of a float in a quarter of the memory of RGBA32F, anything that needs alpha has to use halfs
+static InternalFormat GetHdrFormat(int numChannels) {
+	return numChannels == 3 ? InternalFormat::RGB9_E5 : InternalFormat::RGBA16F;
+}
+
 Texture2DData::Texture2DData(uint32_t width, uint32_t height, PixelFormat format, PixelType type, void* sourceData, InternalFormat recommendedFormat) :
 	_width(width), _height(height), _format(format), _type(type), _data(nullptr), _recommendedFormat(recommendedFormat)
 {
@@ -10,24 +45,56 @@ Texture2DData::Texture2DData(uint32_t width, uint32_t height, PixelFormat format
 	_dataSize = width * (size_t)height * GetTexelSize(_format, _type);
 	_data = malloc(_dataSize);
 	LOG_ASSERT(_data != nullptr, "Failed to allocate texture data!");
+	// The pixels don't come from operator new (so they can be adopted from stb), so we charge them ourselves
+	MemoryTracker::Add(MemoryTag::Textures, static_cast<int64_t>(_dataSize));
 	if (sourceData != nullptr) {
 		memcpy(_data, sourceData, _dataSize);
 	}
 }
 
+Texture2DData::Texture2DData(AdoptData, uint32_t width, uint32_t height, PixelFormat format, PixelType type, void* ownedData, InternalFormat recommendedFormat) :
+	_width(width), _height(height), _format(format), _type(type), _data(ownedData), _recommendedFormat(recommendedFormat)
+{
+	LOG_ASSERT(width > 0 & height > 0, "Width and height must both be greater than zero! Got {}x{}", width, height);
+	_dataSize = width * (size_t)height * GetTexelSize(_format, _type);
+	MemoryTracker::Add(MemoryTag::Textures, static_cast<int64_t>(_dataSize));
+}
+
 Texture2DData::~Texture2DData() {
 	free(_data);
+	MemoryTracker::Add(MemoryTag::Textures, -static_cast<int64_t>(_dataSize));
+}
+
+void Texture2DData::InitDecoder() {
+	// The flip setting is global, so we only set it once in case we're loading on several threads at the same time
+	// (see TextureLoader)
+	static std::once_flag flipInit;
+	std::call_once(flipInit, []() { stbi_set_flip_vertically_on_load(true); });
 }
 
 Texture2DData::sptr Texture2DData::LoadFromFile(const std::string& file, bool forceRgba)
 {
+	// This gets recorded separately from the upload, so we can see how long decoding takes on it's own
+	AssetLoadScope load("Decode " + std::filesystem::path(file).filename().string());
+
 	// Variables that will store properties about our image
 	int width, height, numChannels;
 	const int targetChannels = forceRgba ? 4 : 0;
 
 	// Use STBI to load the image
-	stbi_set_flip_vertically_on_load(true);
-	uint8_t* data = stbi_load(file.c_str(), &width, &height, &numChannels, targetChannels);
+	InitDecoder();
+	// The image may be packed in an archive, so we read it through the file system and decode it from memory
+	VirtualFile::sptr source = VirtualFileSystem::Open(file);
+	const stbi_uc* bytes = source == nullptr ? nullptr : reinterpret_cast<const stbi_uc*>(source->GetData());
+	const int byteCount = source == nullptr ? 0 : static_cast<int>(source->GetSize());
+	// HDR images (ex: .hdr environments) are kept as floats, squashing them into bytes would clip everything past 1
+	const bool isHdr = bytes != nullptr && stbi_is_hdr_from_memory(bytes, byteCount) != 0;
+	void* data = nullptr;
+	if (bytes != nullptr) {
+		data = isHdr ?
+			static_cast<void*>(stbi_loadf_from_memory(bytes, byteCount, &width, &height, &numChannels, targetChannels)) :
+			static_cast<void*>(stbi_load_from_memory(bytes, byteCount, &width, &height, &numChannels, targetChannels));
+	}
 
 	// If we could not load any data, warn and return null
 	if (data == nullptr) {
@@ -42,42 +109,43 @@ Texture2DData::sptr Texture2DData::LoadFromFile(const std::string& file, bool fo
 		numChannels = targetChannels;
 
 	// We'll determine a recommended format for the image based on number of channels
-	InternalFormat internal_format;
-	PixelFormat    image_format;
-	switch (numChannels) {
-	case 1:
-		internal_format = InternalFormat::R8;
-		image_format = PixelFormat::Red;
-		break;
-	case 2:
-		internal_format = InternalFormat::RG8;
-		image_format = PixelFormat::RG;
-		break;
-	case 3:
-		internal_format = InternalFormat::RGB8;
-		image_format = PixelFormat::RGB;
-		break;
-	case 4:
-		internal_format = InternalFormat::RGBA8;
-		image_format = PixelFormat::RGBA;
-		break;
-	default:
+	InternalFormat internal_format = InternalFormat::Unknown;
+	PixelFormat    image_format = PixelFormat::RGBA;
+	if (!GetFormatsForChannels(numChannels, internal_format, image_format)) {
 		LOG_ASSERT(false, "Unsupported texture format for texture \"{}\" with {} channels", file, numChannels)
-		break;
+	}
+	if (isHdr) {
+		internal_format = GetHdrFormat(numChannels);
 	}
 	
-	// This is one of those poorly documented things in OpenGL
-	if ((numChannels * width) % 4 != 0) {
+	// This is one of those poorly documented things in OpenGL, float rows are always a multiple of 4 bytes
+	if (!isHdr && (numChannels * width) % 4 != 0) {
 		LOG_WARN("The alignment of a horizontal line is not a multiple of 4, this will require a call to glPixelStorei(GL_PACK_ALIGNMENT)");
 	}
 
-	// Create the result and store our image data in it
-	// Note that stbi will always give us an array of unsigned bytes (uint8_t)
-	Texture2DData::sptr result = std::make_shared<Texture2DData>(width, height, image_format, PixelType::UByte, data, internal_format);
+	// Create the result and hand STBI's data over to it, stbi_image_free is just free so our destructor can
+	// release it. Note that stbi gives us unsigned bytes (uint8_t), or floats for HDR images
+	const PixelType type = isHdr ? PixelType::Float : PixelType::UByte;
+	Texture2DData::sptr result = Texture2DData::sptr(new Texture2DData(AdoptData(), width, height, image_format, type, data, internal_format));
 	result->DebugName = std::filesystem::path(file).filename().string();
-	
-	// We now have a copy in our ptr, we can free STBI's copy of it
-	stbi_image_free(data);
 
 	return result;
 }
+
+bool Texture2DData::ReadInfo(const std::string& file, uint32_t& width, uint32_t& height, InternalFormat& format, bool forceRgba)
+{
+	int w, h, numChannels;
+	if (stbi_info(file.c_str(), &w, &h, &numChannels) == 0) {
+		return false;
+	}
+	PixelFormat imageFormat;
+	if (!GetFormatsForChannels(forceRgba ? 4 : numChannels, format, imageFormat)) {
+		return false;
+	}
+	if (stbi_is_hdr(file.c_str()) != 0) {
+		format = GetHdrFormat(forceRgba ? 4 : numChannels);
+	}
+	width = static_cast<uint32_t>(w);
+	height = static_cast<uint32_t>(h);
+	return true;
+}
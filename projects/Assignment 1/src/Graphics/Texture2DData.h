@@ -37,6 +37,21 @@ public:
 	/// <param name="forceRgba">True to force STBI to load 4 component texture data</param>
 	/// <returns>A pointer to the data loaded from the file, or nullptr if the file failed to load</returns>
 	static Texture2DData::sptr LoadFromFile(const std::string& file, bool forceRgba = false);
+	/// <summary>
+	/// Sets STBI up the way all of our images get decoded (flipped, so the first row is the bottom of the image).
+	/// Anything that decodes images with STBI itself should call this first, it's safe to call from any thread
+	/// </summary>
+	static void InitDecoder();
+	/// <summary>
+	/// Reads the size and recommended format of an image without decoding it, this only needs to read the header
+	/// </summary>
+	/// <param name="file">The path of the file to read</param>
+	/// <param name="width">Will store the width of the image, in pixels</param>
+	/// <param name="height">Will store the height of the image, in pixels</param>
+	/// <param name="format">Will store the format that LoadFromFile would recommend for the image</param>
+	/// <param name="forceRgba">True if the image will be loaded with forceRgba</param>
+	/// <returns>True if the file could be read</returns>
+	static bool ReadInfo(const std::string& file, uint32_t& width, uint32_t& height, InternalFormat& format, bool forceRgba = false);
 
 	/// <summary>
 	/// Gets the width of the texture data, in pixels
@@ -69,6 +84,10 @@ public:
 	const void* GetDataPtr() const { return _data; }
 
 private:
+	// Tag for the constructor that takes ownership of an existing allocation, instead of copying it
+	struct AdoptData {};
+	Texture2DData(AdoptData, uint32_t width, uint32_t height, PixelFormat format, PixelType type, void* ownedData, InternalFormat recommendedFormat);
+
 	uint32_t    _width, _height;
 	size_t      _dataSize;
 	PixelFormat _format;
@@ -0,0 +1,78 @@
+#include "TextureArrayBuilder.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "GpuResources.h"
+#include "TextureLoader.h"
+
+// Ranks the formats that images load with by how many channels they have
+static int GetChannelRank(InternalFormat format) {
+	switch (format) {
+		case InternalFormat::R8:    return 1;
+		case InternalFormat::RG8:   return 2;
+		case InternalFormat::RGB8:  return 3;
+		case InternalFormat::RGBA8: return 4;
+		default:                    return 0;
+	}
+}
+
+uint32_t TextureArrayBuilder::Add(const std::string& path) {
+	auto it = std::find(_paths.begin(), _paths.end(), path);
+	if (it != _paths.end()) {
+		return static_cast<uint32_t>(it - _paths.begin());
+	}
+	_paths.push_back(path);
+	return static_cast<uint32_t>(_paths.size() - 1);
+}
+
+Texture2DArray::sptr TextureArrayBuilder::Build(Texture2DDescription description) const {
+	GPU_RESOURCE_OWNER("TextureArrayBuilder");
+	if (_paths.empty()) {
+		LOG_WARN("Cannot build a texture array with no images in it");
+		return nullptr;
+	}
+
+	// We only need the headers to decide the shared size and format, the images get decoded in the background
+	std::map<std::pair<uint32_t, uint32_t>, uint32_t> sizeCounts;
+	InternalFormat format = InternalFormat::Unknown;
+	for (const std::string& path : _paths) {
+		uint32_t width = 0, height = 0;
+		InternalFormat imageFormat = InternalFormat::Unknown;
+		if (!Texture2DData::ReadInfo(path, width, height, imageFormat)) {
+			LOG_WARN("Failed to read image info from \"{}\", it's layer will be left white", path);
+			continue;
+		}
+		sizeCounts[{ width, height }]++;
+		if (GetChannelRank(imageFormat) > GetChannelRank(format)) {
+			format = imageFormat;
+		}
+	}
+
+	if (description.Width == 0 || description.Height == 0) {
+		// Ties go to the larger size, so we'd rather shrink an image than blow one up
+		std::pair<uint32_t, uint32_t> size(1, 1);
+		uint32_t count = 0;
+		for (const auto& kvp : sizeCounts) {
+			const uint64_t area = kvp.first.first * (uint64_t)kvp.first.second;
+			if (kvp.second > count || (kvp.second == count && area > size.first * (uint64_t)size.second)) {
+				size = kvp.first;
+				count = kvp.second;
+			}
+		}
+		description.Width = size.first;
+		description.Height = size.second;
+	}
+	if (description.Format == InternalFormat::Unknown) {
+		description.Format = format != InternalFormat::Unknown ? format : InternalFormat::RGBA8;
+	}
+
+	Texture2DArray::sptr result = Texture2DArray::Create(description, GetLayerCount());
+	result->Clear(glm::vec4(1.0f));
+	for (uint32_t layer = 0; layer < GetLayerCount(); layer++) {
+		TextureLoader::LoadLayerAsync(_paths[layer], result, layer);
+	}
+	LOG_INFO("Packed {} images into a {}x{} texture array", GetLayerCount(), description.Width, description.Height);
+	return result;
+}
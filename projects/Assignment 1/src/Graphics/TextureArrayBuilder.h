@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Texture2D.h"
+#include "Texture2DArray.h"
+
+/// <summary>
+/// Packs a set of images into the layers of a single array texture, so that materials which only differ by which
+/// of those images they use can share their textures and be drawn together. Each material picks it's image with the
+/// layer index that Add hands back
+///
+/// The images don't need to match, they are resized to a shared size and loaded in the background by TextureLoader
+/// </summary>
+class TextureArrayBuilder final
+{
+public:
+	TextureArrayBuilder() = default;
+	~TextureArrayBuilder() = default;
+
+	/// <summary>
+	/// Adds an image to the array, adding the same image twice will give back the same layer
+	/// </summary>
+	/// <param name="path">The path of the image to add</param>
+	/// <returns>The index of the layer the image will be loaded into</returns>
+	uint32_t Add(const std::string& path);
+
+	/// <summary>
+	/// Gets the number of layers that have been added so far
+	/// </summary>
+	uint32_t GetLayerCount() const { return static_cast<uint32_t>(_paths.size()); }
+
+	/// <summary>
+	/// Creates the array texture and starts loading all of the images into it. The array starts out white, and each
+	/// layer fills in as it's image finishes loading
+	/// </summary>
+	/// <param name="description">
+	/// The sampling settings for the array. If the size is left at 0 we use the size most of the images already have,
+	/// so that as few as possible need to be resized. If the format is left Unknown we use the one with the most
+	/// channels, so no image loses any
+	/// </param>
+	/// <returns>The array texture, or nullptr if no images were added</returns>
+	Texture2DArray::sptr Build(Texture2DDescription description = Texture2DDescription()) const;
+
+protected:
+	std::vector<std::string> _paths;
+};
@@ -0,0 +1,479 @@
+#include "TextureCompressor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "TextureCook.h"
+#include "Logging.h"
+
+// The same check the transform kernel uses, MSVC doesn't define __SSE2__ but always has it on x64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define TEXTURE_COMPRESSOR_SSE
+	#include <emmintrin.h>
+#endif
+
+bool        TextureCompressor::UseBC7 = false;
+const char* TextureCompressor::SIDECAR_EXTENSION = ".bc";
+
+// A 4x4 block of texels, one array per channel (RGBA) so they can be loaded 4 texels at a time
+struct alignas(16) TexelBlock {
+	float Channels[4][16];
+};
+
+// The weights BC7 blends it's endpoints with for 4 bit indices, out of 64
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+// Where each point along a BC1 line (from the first endpoint to the second) sits in the palette
+static const uint32_t BC1_INDEX_FOR_STEP[4] = { 0, 2, 3, 1 };
+static const float    BC1_WEIGHT_FOR_INDEX[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+// Copies a block out of an image, repeating the last row and column for blocks that hang off the edge
+static void GatherBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, uint32_t blockX, uint32_t blockY, TexelBlock& block) {
+	for (uint32_t y = 0; y < 4; y++) {
+		const uint32_t row = std::min(blockY * 4 + y, height - 1);
+		for (uint32_t x = 0; x < 4; x++) {
+			const uint8_t* texel = pixels + (row * (size_t)width + std::min(blockX * 4 + x, width - 1)) * channels;
+			for (uint32_t channel = 0; channel < 4; channel++) {
+				block.Channels[channel][y * 4 + x] = channel < channels ? texel[channel] : 255.0f;
+			}
+		}
+	}
+}
+
+// Projects every texel onto the line through origin along direction, storing how far along it each one lands. With
+// clamp set the distances are scaled by scale and kept between 0 and 1, for picking palette entries
+static void ProjectBlock(const TexelBlock& block, uint32_t channels, const float origin[4], const float direction[4], float scale, bool clamp, float result[16]) {
+#if defined(TEXTURE_COMPRESSOR_SSE)
+	const __m128 scales = _mm_set1_ps(scale);
+	for (uint32_t ix = 0; ix < 16; ix += 4) {
+		__m128 sum = _mm_setzero_ps();
+		for (uint32_t channel = 0; channel < channels; channel++) {
+			const __m128 offset = _mm_sub_ps(_mm_load_ps(&block.Channels[channel][ix]), _mm_set1_ps(origin[channel]));
+			sum = _mm_add_ps(sum, _mm_mul_ps(offset, _mm_set1_ps(direction[channel])));
+		}
+		sum = _mm_mul_ps(sum, scales);
+		if (clamp) {
+			sum = _mm_min_ps(_mm_max_ps(sum, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		}
+		_mm_storeu_ps(result + ix, sum);
+	}
+#else
+	for (uint32_t ix = 0; ix < 16; ix++) {
+		float sum = 0.0f;
+		for (uint32_t channel = 0; channel < channels; channel++) {
+			sum += (block.Channels[channel][ix] - origin[channel]) * direction[channel];
+		}
+		sum *= scale;
+		result[ix] = clamp ? std::clamp(sum, 0.0f, 1.0f) : sum;
+	}
+#endif
+}
+
+// Fits a line through the block's texels along their principal axis, and returns the ends of the part the texels
+// cover, pulled in slightly since the ends of a palette are rarely where the texels are densest
+static void FitLine(const TexelBlock& block, uint32_t channels, float start[4], float end[4]) {
+	float mean[4] = { 0.0f }, minimum[4], maximum[4];
+	for (uint32_t channel = 0; channel < channels; channel++) {
+		minimum[channel] = maximum[channel] = block.Channels[channel][0];
+		for (uint32_t ix = 0; ix < 16; ix++) {
+			mean[channel] += block.Channels[channel][ix];
+			minimum[channel] = std::min(minimum[channel], block.Channels[channel][ix]);
+			maximum[channel] = std::max(maximum[channel], block.Channels[channel][ix]);
+		}
+		mean[channel] /= 16.0f;
+	}
+	float covariance[4][4] = { { 0.0f } };
+	for (uint32_t ix = 0; ix < 16; ix++) {
+		for (uint32_t a = 0; a < channels; a++) {
+			for (uint32_t b = a; b < channels; b++) {
+				covariance[a][b] += (block.Channels[a][ix] - mean[a]) * (block.Channels[b][ix] - mean[b]);
+			}
+		}
+	}
+	// A few rounds of power iteration, starting from the bounding box's diagonal, is plenty for 16 texels
+	float axis[4] = { 0.0f };
+	for (uint32_t channel = 0; channel < channels; channel++) {
+		axis[channel] = maximum[channel] - minimum[channel];
+	}
+	for (int iteration = 0; iteration < 4; iteration++) {
+		float next[4] = { 0.0f };
+		float length = 0.0f;
+		for (uint32_t a = 0; a < channels; a++) {
+			for (uint32_t b = 0; b < channels; b++) {
+				next[a] += (a <= b ? covariance[a][b] : covariance[b][a]) * axis[b];
+			}
+			length = std::max(length, std::abs(next[a]));
+		}
+		if (length < 1e-6f) {
+			break;
+		}
+		for (uint32_t channel = 0; channel < channels; channel++) {
+			axis[channel] = next[channel] / length;
+		}
+	}
+	float lengthSquared = 0.0f;
+	for (uint32_t channel = 0; channel < channels; channel++) {
+		lengthSquared += axis[channel] * axis[channel];
+	}
+	// A flat block, both ends go on it's color
+	if (lengthSquared < 1e-6f) {
+		std::copy(mean, mean + 4, start);
+		std::copy(mean, mean + 4, end);
+		return;
+	}
+
+	float distances[16];
+	ProjectBlock(block, channels, mean, axis, 1.0f / lengthSquared, false, distances);
+	float low = distances[0], high = distances[0];
+	for (uint32_t ix = 1; ix < 16; ix++) {
+		low = std::min(low, distances[ix]);
+		high = std::max(high, distances[ix]);
+	}
+	const float inset = (high - low) / 32.0f;
+	for (uint32_t channel = 0; channel < channels; channel++) {
+		start[channel] = std::clamp(mean[channel] + (low + inset) * axis[channel], 0.0f, 255.0f);
+		end[channel] = std::clamp(mean[channel] + (high - inset) * axis[channel], 0.0f, 255.0f);
+	}
+}
+
+// Finds the endpoints that best fit the texels in the least squares sense, given how far along the line each texel
+// was placed (0 for all of start, 1 for all of end)
+static bool RefitLine(const TexelBlock& block, uint32_t channels, const float weights[16], float start[4], float end[4]) {
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = { 0.0f }, bx[4] = { 0.0f };
+	for (uint32_t ix = 0; ix < 16; ix++) {
+		const float b = weights[ix], a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (uint32_t channel = 0; channel < channels; channel++) {
+			ax[channel] += a * block.Channels[channel][ix];
+			bx[channel] += b * block.Channels[channel][ix];
+		}
+	}
+	const float determinant = aa * bb - ab * ab;
+	if (std::abs(determinant) < 1e-6f) {
+		return false;
+	}
+	for (uint32_t channel = 0; channel < channels; channel++) {
+		start[channel] = std::clamp((bb * ax[channel] - ab * bx[channel]) / determinant, 0.0f, 255.0f);
+		end[channel] = std::clamp((aa * bx[channel] - ab * ax[channel]) / determinant, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+// Gets the direction from start to end, and the scale that maps distances along it to between 0 and 1
+static float GetDirection(const float start[4], const float end[4], uint32_t channels, float direction[4]) {
+	float lengthSquared = 0.0f;
+	for (uint32_t channel = 0; channel < 4; channel++) {
+		direction[channel] = channel < channels ? end[channel] - start[channel] : 0.0f;
+		lengthSquared += direction[channel] * direction[channel];
+	}
+	return lengthSquared > 1e-6f ? 1.0f / lengthSquared : 0.0f;
+}
+
+static uint16_t To565(const float color[4]) {
+	const uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+	const uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+	const uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void From565(uint16_t packed, float color[4]) {
+	const uint32_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = static_cast<float>((r << 3) | (r >> 2));
+	color[1] = static_cast<float>((g << 2) | (g >> 4));
+	color[2] = static_cast<float>((b << 3) | (b >> 2));
+	color[3] = 255.0f;
+}
+
+// Picks each texel's BC1 index for a pair of endpoints, returning the indices (2 bits a texel) and the squared error
+static uint32_t PickBC1Indices(const TexelBlock& block, uint16_t first, uint16_t second, float& error) {
+	float palette[4][4];
+	From565(first, palette[0]);
+	From565(second, palette[1]);
+	for (uint32_t channel = 0; channel < 3; channel++) {
+		palette[2][channel] = (2.0f * palette[0][channel] + palette[1][channel]) / 3.0f;
+		palette[3][channel] = (palette[0][channel] + 2.0f * palette[1][channel]) / 3.0f;
+	}
+	float direction[4], distances[16];
+	const float scale = GetDirection(palette[0], palette[1], 3, direction);
+	ProjectBlock(block, 3, palette[0], direction, scale, true, distances);
+
+	uint32_t indices = 0;
+	error = 0.0f;
+	for (uint32_t ix = 0; ix < 16; ix++) {
+		const uint32_t index = BC1_INDEX_FOR_STEP[std::lround(distances[ix] * 3.0f)];
+		indices |= index << (ix * 2);
+		for (uint32_t channel = 0; channel < 3; channel++) {
+			const float difference = block.Channels[channel][ix] - palette[index][channel];
+			error += difference * difference;
+		}
+	}
+	return indices;
+}
+
+// Encodes the colors of a block as BC1 (always in 4 color mode, so it's valid as the color half of BC3 too)
+static void EncodeBC1Block(const TexelBlock& block, uint8_t* output) {
+	float start[4], end[4];
+	FitLine(block, 3, start, end);
+	uint16_t first = To565(start), second = To565(end);
+	float error;
+	uint32_t indices = PickBC1Indices(block, first, second, error);
+
+	// One round of refitting the endpoints to the indices we picked usually takes a good bite out of the error
+	float weights[16];
+	for (uint32_t ix = 0; ix < 16; ix++) {
+		weights[ix] = BC1_WEIGHT_FOR_INDEX[(indices >> (ix * 2)) & 3];
+	}
+	if (RefitLine(block, 3, weights, start, end)) {
+		const uint16_t refitFirst = To565(start), refitSecond = To565(end);
+		float refitError;
+		const uint32_t refitIndices = PickBC1Indices(block, refitFirst, refitSecond, refitError);
+		if (refitError < error) {
+			first = refitFirst;
+			second = refitSecond;
+			indices = refitIndices;
+		}
+	}
+
+	// The first endpoint has to be the larger one for 4 color mode, swapping them swaps indices 0/1 and 2/3
+	if (first < second) {
+		std::swap(first, second);
+		indices ^= 0x55555555;
+	} else if (first == second) {
+		indices = 0;
+	}
+	memcpy(output, &first, sizeof(uint16_t));
+	memcpy(output + 2, &second, sizeof(uint16_t));
+	memcpy(output + 4, &indices, sizeof(uint32_t));
+}
+
+// Encodes the alpha of a block the way BC3 (and BC4) does, with 8 steps between the largest and smallest values
+static void EncodeAlphaBlock(const TexelBlock& block, uint8_t* output) {
+	const float* alpha = block.Channels[3];
+	float low = alpha[0], high = alpha[0];
+	for (uint32_t ix = 1; ix < 16; ix++) {
+		low = std::min(low, alpha[ix]);
+		high = std::max(high, alpha[ix]);
+	}
+	const uint8_t first = static_cast<uint8_t>(std::lround(high));
+	const uint8_t second = static_cast<uint8_t>(std::lround(low));
+	uint64_t indices = 0;
+	if (first > second) {
+		const float scale = 7.0f / (static_cast<float>(first) - static_cast<float>(second));
+		for (uint32_t ix = 0; ix < 16; ix++) {
+			// Steps count up from the smaller endpoint, while the palette goes first, second, then 6 steps back down
+			const long step = std::clamp(std::lround((alpha[ix] - second) * scale), 0l, 7l);
+			const uint64_t index = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+			indices |= index << (ix * 3);
+		}
+	}
+	output[0] = first;
+	output[1] = second;
+	for (uint32_t ix = 0; ix < 6; ix++) {
+		output[2 + ix] = static_cast<uint8_t>(indices >> (ix * 8));
+	}
+}
+
+// Writes bits into a block from the lowest bit up, the way BC7 lays them out
+struct BitWriter {
+	uint8_t* Output;
+	uint32_t Position = 0;
+
+	void Write(uint32_t value, uint32_t bits) {
+		for (uint32_t ix = 0; ix < bits; ix++, Position++) {
+			Output[Position >> 3] |= static_cast<uint8_t>(((value >> ix) & 1) << (Position & 7));
+		}
+	}
+};
+
+// A BC7 mode 6 endpoint, 7 bits a channel plus a shared low bit
+struct BC7Endpoint {
+	uint32_t Channels[4];
+	uint32_t LowBit;
+
+	float Get(uint32_t channel) const { return static_cast<float>((Channels[channel] << 1) | LowBit); }
+};
+
+// Rounds an endpoint to 7 bits a channel, trying both low bits and keeping whichever lands closer
+static BC7Endpoint QuantizeBC7(const float color[4]) {
+	BC7Endpoint best = BC7Endpoint();
+	float bestError = -1.0f;
+	for (uint32_t lowBit = 0; lowBit < 2; lowBit++) {
+		BC7Endpoint candidate;
+		candidate.LowBit = lowBit;
+		float error = 0.0f;
+		for (uint32_t channel = 0; channel < 4; channel++) {
+			candidate.Channels[channel] = static_cast<uint32_t>(std::clamp(std::lround((color[channel] - lowBit) / 2.0f), 0l, 127l));
+			const float difference = candidate.Get(channel) - color[channel];
+			error += difference * difference;
+		}
+		if (bestError < 0.0f || error < bestError) {
+			best = candidate;
+			bestError = error;
+		}
+	}
+	return best;
+}
+
+// Picks each texel's BC7 index for a pair of endpoints, returning the squared error
+static float PickBC7Indices(const TexelBlock& block, const BC7Endpoint& first, const BC7Endpoint& second, uint8_t indices[16]) {
+	float start[4], end[4];
+	for (uint32_t channel = 0; channel < 4; channel++) {
+		start[channel] = first.Get(channel);
+		end[channel] = second.Get(channel);
+	}
+	float direction[4], distances[16];
+	const float scale = GetDirection(start, end, 4, direction);
+	ProjectBlock(block, 4, start, direction, scale, true, distances);
+
+	float error = 0.0f;
+	for (uint32_t ix = 0; ix < 16; ix++) {
+		// The weights are nearly even, so the nearest one is always next to where rounding puts us
+		const float target = distances[ix] * 64.0f;
+		int index = static_cast<int>(std::lround(distances[ix] * 15.0f));
+		for (int neighbour = std::max(index - 1, 0); neighbour <= std::min(index + 1, 15); neighbour++) {
+			if (std::abs(BC7_WEIGHTS[neighbour] - target) < std::abs(BC7_WEIGHTS[index] - target)) {
+				index = neighbour;
+			}
+		}
+		indices[ix] = static_cast<uint8_t>(index);
+		for (uint32_t channel = 0; channel < 4; channel++) {
+			const uint32_t a = (first.Channels[channel] << 1) | first.LowBit;
+			const uint32_t b = (second.Channels[channel] << 1) | second.LowBit;
+			const float value = static_cast<float>(((64 - BC7_WEIGHTS[index]) * a + BC7_WEIGHTS[index] * b + 32) >> 6);
+			const float difference = block.Channels[channel][ix] - value;
+			error += difference * difference;
+		}
+	}
+	return error;
+}
+
+// Encodes a block as BC7 mode 6: a single line through RGBA with 4 bit indices, which suits most photographic content
+static void EncodeBC7Block(const TexelBlock& block, uint8_t* output) {
+	float start[4], end[4];
+	FitLine(block, 4, start, end);
+	BC7Endpoint first = QuantizeBC7(start), second = QuantizeBC7(end);
+	uint8_t indices[16];
+	float error = PickBC7Indices(block, first, second, indices);
+
+	float weights[16];
+	for (uint32_t ix = 0; ix < 16; ix++) {
+		weights[ix] = BC7_WEIGHTS[indices[ix]] / 64.0f;
+	}
+	if (RefitLine(block, 4, weights, start, end)) {
+		const BC7Endpoint refitFirst = QuantizeBC7(start), refitSecond = QuantizeBC7(end);
+		uint8_t refitIndices[16];
+		if (PickBC7Indices(block, refitFirst, refitSecond, refitIndices) < error) {
+			first = refitFirst;
+			second = refitSecond;
+			std::copy(refitIndices, refitIndices + 16, indices);
+		}
+	}
+
+	// The first texel's index only gets 3 bits, so it has to be in the bottom half, flipping the line puts it there
+	if (indices[0] >= 8) {
+		std::swap(first, second);
+		for (uint8_t& index : indices) {
+			index = static_cast<uint8_t>(15 - index);
+		}
+	}
+
+	memset(output, 0, 16);
+	BitWriter writer{ output };
+	writer.Write(1 << 6, 7);
+	for (uint32_t channel = 0; channel < 4; channel++) {
+		writer.Write(first.Channels[channel], 7);
+		writer.Write(second.Channels[channel], 7);
+	}
+	writer.Write(first.LowBit, 1);
+	writer.Write(second.LowBit, 1);
+	for (uint32_t ix = 0; ix < 16; ix++) {
+		writer.Write(indices[ix], ix == 0 ? 3 : 4);
+	}
+}
+
+InternalFormat TextureCompressor::ChooseFormat(const MipChainData& mips) {
+	const uint32_t channels = static_cast<uint32_t>(GetTexelComponentCount(mips.GetFormat()));
+	if (mips.GetPixelType() != PixelType::UByte || (channels != 3 && channels != 4) || mips.GetLevelCount() == 0) {
+		return InternalFormat::Unknown;
+	}
+	if (UseBC7) {
+		return InternalFormat::BC7;
+	}
+	if (channels == 4) {
+		const MipChainData::MipLevel& level = mips.GetLevel(0);
+		const uint8_t* pixels = static_cast<const uint8_t*>(mips.GetLevelData(0));
+		for (size_t ix = 3; ix < level.Size; ix += 4) {
+			if (pixels[ix] != 255) {
+				return InternalFormat::BC3;
+			}
+		}
+	}
+	return InternalFormat::BC1;
+}
+
+CompressedTextureData::sptr TextureCompressor::Compress(const MipChainData& mips, InternalFormat format) {
+	const uint32_t channels = static_cast<uint32_t>(GetTexelComponentCount(mips.GetFormat()));
+	if (mips.GetPixelType() != PixelType::UByte || (channels != 3 && channels != 4) || mips.GetLevelCount() == 0 ||
+		(format != InternalFormat::BC1 && format != InternalFormat::BC3 && format != InternalFormat::BC7))
+	{
+		LOG_WARN("Can't compress \"{}\" to {}, only 8 bit RGB and RGBA images can be compressed to BC1, BC3 or BC7", mips.DebugName, format);
+		return nullptr;
+	}
+	CompressedTextureData::sptr result = std::make_shared<CompressedTextureData>(mips.GetWidth(), mips.GetHeight(), format);
+	result->DebugName = mips.DebugName;
+
+	const size_t blockSize = GetCompressedBlockSize(format);
+	std::vector<uint8_t> blocks;
+	TexelBlock block;
+	for (uint32_t levelIx = 0; levelIx < mips.GetLevelCount(); levelIx++) {
+		const MipChainData::MipLevel& level = mips.GetLevel(levelIx);
+		const uint8_t* pixels = static_cast<const uint8_t*>(mips.GetLevelData(levelIx));
+		const uint32_t blocksWide = (level.Width + 3) / 4, blocksHigh = (level.Height + 3) / 4;
+		blocks.resize(blocksWide * (size_t)blocksHigh * blockSize);
+		uint8_t* output = blocks.data();
+		for (uint32_t blockY = 0; blockY < blocksHigh; blockY++) {
+			for (uint32_t blockX = 0; blockX < blocksWide; blockX++, output += blockSize) {
+				GatherBlock(pixels, level.Width, level.Height, channels, blockX, blockY, block);
+				if (format == InternalFormat::BC7) {
+					EncodeBC7Block(block, output);
+				} else if (format == InternalFormat::BC3) {
+					EncodeAlphaBlock(block, output);
+					EncodeBC1Block(block, output + 8);
+				} else {
+					EncodeBC1Block(block, output);
+				}
+			}
+		}
+		result->AddLevel(blocks.data(), blocks.size());
+	}
+	return result;
+}
+
+CompressedTextureData::sptr TextureCompressor::LoadCached(const std::string& path) {
+	CompressedTextureData::sptr result = CompressedTextureData::LoadSidecar(path, SIDECAR_EXTENSION);
+	if (result != nullptr && (result->GetFormat() == InternalFormat::BC7) != UseBC7) {
+		return nullptr;
+	}
+	return result;
+}
+
+CompressedTextureData::sptr TextureCompressor::CompressAndCache(const std::string& path, MipChainData::sptr mips, const Texture2DData::sptr& image) {
+	if (mips == nullptr && image != nullptr) {
+		mips = TextureCook::GenerateMips(image);
+	}
+	if (mips == nullptr) {
+		return nullptr;
+	}
+	const InternalFormat format = ChooseFormat(*mips);
+	if (format == InternalFormat::Unknown) {
+		return nullptr;
+	}
+	CompressedTextureData::sptr result = Compress(*mips, format);
+	if (result != nullptr && result->SaveSidecar(path, SIDECAR_EXTENSION)) {
+		LOG_INFO("Compressed \"{}\" to {} ({:.1f} MB to {:.1f} MB)", path, format, mips->GetDataSize() / (1024.0 * 1024.0), result->GetDataSize() / (1024.0 * 1024.0));
+	}
+	return result;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "CompressedTextureData.h"
+#include "MipChainData.h"
+#include "Texture2DData.h"
+
+/// <summary>
+/// Block compresses images at runtime, for the ones that never went through an offline cook (ex: images dropped into
+/// images/ on site). Opaque images become BC1 and images with alpha become BC3, or both become BC7 when UseBC7 is set,
+/// which takes about 4 times as long to encode but keeps a lot more detail. The results are cached in a sidecar next
+/// to the image (see CompressedTextureData::SaveSidecar), so each image only gets compressed once per install
+///
+/// The encoders are built for speed rather than the last bit of quality: each block fits a line through it's texels
+/// (along their principal axis), picks every texel's nearest point along it, and then refits the endpoints to those
+/// picks once. The texels are projected onto the line 4 at a time with SSE where we have it. Compression runs on
+/// whichever thread calls it, TextureLoader does it on the ThreadPool's workers as part of decoding
+///
+/// Only 8 bit RGB and RGBA images can be compressed, anything else is left as it is
+/// </summary>
+class TextureCompressor final
+{
+public:
+	/// <summary>
+	/// When true, images are compressed to BC7 instead of BC1 or BC3. Images that were already cached in another format
+	/// are compressed again
+	/// </summary>
+	static bool UseBC7;
+
+	/// <summary>
+	/// The extension added to an image's path for it's compressed sidecar
+	/// </summary>
+	static const char* SIDECAR_EXTENSION;
+
+	/// <summary>
+	/// Picks the block compressed format for an image, based on whether it's largest level has any alpha that isn't
+	/// opaque
+	/// </summary>
+	/// <returns>The format to compress to, or Unknown if the image can't be compressed</returns>
+	static InternalFormat ChooseFormat(const MipChainData& mips);
+	/// <summary>
+	/// Compresses every level of a mip chain
+	/// </summary>
+	/// <param name="mips">The levels to compress, must be 8 bit RGB or RGBA</param>
+	/// <param name="format">BC1, BC3 or BC7</param>
+	/// <returns>The compressed image, or nullptr if it couldn't be compressed</returns>
+	static CompressedTextureData::sptr Compress(const MipChainData& mips, InternalFormat format);
+
+	/// <summary>
+	/// Loads an image's compressed sidecar, if there's one that's up to date and in the format we'd compress to now
+	/// </summary>
+	/// <param name="path">The path of the image</param>
+	/// <returns>The compressed image, or nullptr if it needs compressing</returns>
+	static CompressedTextureData::sptr LoadCached(const std::string& path);
+	/// <summary>
+	/// Compresses an image and writes it's sidecar, so LoadCached finds it next time
+	/// </summary>
+	/// <param name="path">The path of the image</param>
+	/// <param name="mips">The image's cooked mip chain, or nullptr to build one from image</param>
+	/// <param name="image">The decoded image, only used if there's no mip chain</param>
+	/// <returns>The compressed image, or nullptr if it can't be compressed</returns>
+	static CompressedTextureData::sptr CompressAndCache(const std::string& path, MipChainData::sptr mips, const Texture2DData::sptr& image);
+
+protected:
+	TextureCompressor() = default;
+};
@@ -0,0 +1,260 @@
+#include "TextureCook.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <future>
+#include <vector>
+
+#include "Utilities/ThreadPool.h"
+#include "Utilities/TraceRecorder.h"
+
+// How many destination texels the Kaiser filter reaches out on either side, and how sharp it's window is
+static const float KAISER_RADIUS = 3.0f;
+static const float KAISER_ALPHA  = 4.0f;
+static const float PI            = 3.14159265358979f;
+
+// A single source texel that contributes to a destination texel
+struct FilterTap {
+	uint32_t Index;
+	float    Weight;
+};
+
+// The zeroth order modified Bessel function of the first kind, used to build the Kaiser window
+static float BesselI0(float x) {
+	float result = 1.0f, term = 1.0f;
+	const float halfSq = x * x * 0.25f;
+	for (int k = 1; k < 20; k++) {
+		term *= halfSq / (float)(k * k);
+		result += term;
+	}
+	return result;
+}
+
+static float Sinc(float x) {
+	if (std::abs(x) < 1e-5f) {
+		return 1.0f;
+	}
+	x *= PI;
+	return std::sin(x) / x;
+}
+
+static float KaiserWindow(float x) {
+	if (std::abs(x) >= 1.0f) {
+		return 0.0f;
+	}
+	return BesselI0(KAISER_ALPHA * std::sqrt(1.0f - x * x)) / BesselI0(KAISER_ALPHA);
+}
+
+// Works out which source texels feed each destination texel along one axis, the weights for each texel add up to 1
+static std::vector<std::vector<FilterTap>> BuildTaps(uint32_t srcSize, uint32_t dstSize, MipFilter filter) {
+	std::vector<std::vector<FilterTap>> result(dstSize);
+	const float scale = (float)srcSize / (float)dstSize;
+	const float radius = filter == MipFilter::Kaiser ? KAISER_RADIUS : 0.5f;
+	// When we're enlarging an image the filter has to stay at least a source texel wide, or it would miss texels
+	const float width = std::max(scale, 1.0f);
+
+	for (uint32_t x = 0; x < dstSize; x++) {
+		const float center = (x + 0.5f) * scale;
+		const int first = (int)std::floor(center - radius * width);
+		const int last  = (int)std::ceil(center + radius * width);
+		float total = 0.0f;
+		for (int ix = first; ix <= last; ix++) {
+			// Distance from the center in filter widths
+			const float t = (ix + 0.5f - center) / width;
+			float weight;
+			if (filter == MipFilter::Kaiser) {
+				weight = Sinc(t) * KaiserWindow(t / radius);
+			} else {
+				weight = std::abs(t) < radius ? 1.0f : 0.0f;
+			}
+			if (weight == 0.0f) {
+				continue;
+			}
+			// Clamp to the edges, so the borders don't pick up texels from the other side
+			const uint32_t index = (uint32_t)std::clamp(ix, 0, (int)srcSize - 1);
+			result[x].push_back({ index, weight });
+			total += weight;
+		}
+		// A box narrower than a texel can land between texel centers, so fall back to the nearest one
+		if (result[x].empty()) {
+			const uint32_t index = (uint32_t)std::clamp((int)center, 0, (int)srcSize - 1);
+			result[x].push_back({ index, 1.0f });
+			total = 1.0f;
+		}
+		for (FilterTap& tap : result[x]) {
+			tap.Weight /= total;
+		}
+	}
+	return result;
+}
+
+// Resizes a level of linear float texels to the given size, one axis at a time
+static std::vector<float> Resample(const std::vector<float>& src, uint32_t srcWidth, uint32_t srcHeight,
+	uint32_t dstWidth, uint32_t dstHeight, uint32_t channels, MipFilter filter)
+{
+	const std::vector<std::vector<FilterTap>> horizontal = BuildTaps(srcWidth, dstWidth, filter);
+	const std::vector<std::vector<FilterTap>> vertical = BuildTaps(srcHeight, dstHeight, filter);
+
+	std::vector<float> rows(dstWidth * (size_t)srcHeight * channels, 0.0f);
+	for (uint32_t y = 0; y < srcHeight; y++) {
+		for (uint32_t x = 0; x < dstWidth; x++) {
+			float* out = &rows[(y * (size_t)dstWidth + x) * channels];
+			for (const FilterTap& tap : horizontal[x]) {
+				const float* in = &src[(y * (size_t)srcWidth + tap.Index) * channels];
+				for (uint32_t c = 0; c < channels; c++) {
+					out[c] += in[c] * tap.Weight;
+				}
+			}
+		}
+	}
+
+	std::vector<float> result(dstWidth * (size_t)dstHeight * channels, 0.0f);
+	for (uint32_t y = 0; y < dstHeight; y++) {
+		for (const FilterTap& tap : vertical[y]) {
+			const float* in = &rows[tap.Index * (size_t)dstWidth * channels];
+			float* out = &result[y * (size_t)dstWidth * channels];
+			for (size_t ix = 0; ix < dstWidth * (size_t)channels; ix++) {
+				out[ix] += in[ix] * tap.Weight;
+			}
+		}
+	}
+	return result;
+}
+
+static float SrgbToLinear(float value) {
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float value) {
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Converts 8 bit texels to linear floats, the first colorChannels components of each texel are treated as sRGB
+static std::vector<float> DecodeTexels(const uint8_t* pixels, size_t count, uint32_t channels, uint32_t colorChannels) {
+	float decode[256], decodeColor[256];
+	for (int ix = 0; ix < 256; ix++) {
+		decode[ix] = ix / 255.0f;
+		decodeColor[ix] = SrgbToLinear(decode[ix]);
+	}
+	std::vector<float> result(count);
+	for (size_t ix = 0; ix < count; ix++) {
+		result[ix] = (ix % channels) < colorChannels ? decodeColor[pixels[ix]] : decode[pixels[ix]];
+	}
+	return result;
+}
+
+// Converts linear floats back to 8 bit texels, the inverse of DecodeTexels
+static void EncodeTexels(const std::vector<float>& texels, std::vector<uint8_t>& result, uint32_t channels, uint32_t colorChannels) {
+	// The sinc lobes can overshoot, so we need to clamp before converting back
+	result.resize(texels.size());
+	for (size_t ix = 0; ix < texels.size(); ix++) {
+		float value = std::clamp(texels[ix], 0.0f, 1.0f);
+		if ((ix % channels) < colorChannels) {
+			value = LinearToSrgb(value);
+		}
+		result[ix] = (uint8_t)(value * 255.0f + 0.5f);
+	}
+}
+
+// Gets the number of components in each texel that hold colors, and so should be filtered in linear space
+static uint32_t GetColorChannels(uint32_t channels, const TextureCookSettings& settings) {
+	// Alpha, and the channels of one or two channel images, are never colors so they always stay linear
+	return settings.GammaCorrect && channels >= 3 ? 3 : 0;
+}
+
+MipChainData::sptr TextureCook::GenerateMips(const Texture2DData::sptr& image, const TextureCookSettings& settings) {
+	if (image->GetPixelType() != PixelType::UByte) {
+		LOG_WARN("Can only cook mips for 8 bit images, \"{}\" is {}", image->DebugName, image->GetPixelType());
+		return nullptr;
+	}
+	const uint32_t channels = (uint32_t)GetTexelComponentCount(image->GetFormat());
+	const uint32_t colorChannels = GetColorChannels(channels, settings);
+
+	uint32_t width = image->GetWidth(), height = image->GetHeight();
+	MipChainData::sptr result = std::make_shared<MipChainData>(width, height, image->GetFormat(), image->GetPixelType(), image->GetRecommendedFormat());
+	result->DebugName = image->DebugName;
+	result->AddLevel(image->GetDataPtr());
+
+	// We filter in floats the whole way down, so rounding errors don't build up from level to level
+	std::vector<float> level = DecodeTexels(static_cast<const uint8_t*>(image->GetDataPtr()), width * (size_t)height * channels, channels, colorChannels);
+
+	std::vector<uint8_t> encoded;
+	const uint32_t levelCount = GetMipLevelCount(width, height);
+	for (uint32_t ix = 1; ix < levelCount; ix++) {
+		const uint32_t nextWidth = std::max(width >> 1, 1u);
+		const uint32_t nextHeight = std::max(height >> 1, 1u);
+		level = Resample(level, width, height, nextWidth, nextHeight, channels, settings.Filter);
+		width = nextWidth;
+		height = nextHeight;
+
+		EncodeTexels(level, encoded, channels, colorChannels);
+		result->AddLevel(encoded.data());
+	}
+	return result;
+}
+
+Texture2DData::sptr TextureCook::Resize(const Texture2DData::sptr& image, uint32_t width, uint32_t height, const TextureCookSettings& settings) {
+	if (image->GetPixelType() != PixelType::UByte) {
+		LOG_WARN("Can only resize 8 bit images, \"{}\" is {}", image->DebugName, image->GetPixelType());
+		return nullptr;
+	}
+	if (image->GetWidth() == width && image->GetHeight() == height) {
+		return image;
+	}
+	const uint32_t channels = (uint32_t)GetTexelComponentCount(image->GetFormat());
+	const uint32_t colorChannels = GetColorChannels(channels, settings);
+
+	std::vector<float> texels = DecodeTexels(static_cast<const uint8_t*>(image->GetDataPtr()),
+		image->GetWidth() * (size_t)image->GetHeight() * channels, channels, colorChannels);
+	texels = Resample(texels, image->GetWidth(), image->GetHeight(), width, height, channels, settings.Filter);
+	std::vector<uint8_t> encoded;
+	EncodeTexels(texels, encoded, channels, colorChannels);
+
+	Texture2DData::sptr result = std::make_shared<Texture2DData>(width, height, image->GetFormat(), image->GetPixelType(), encoded.data(), image->GetRecommendedFormat());
+	result->DebugName = image->DebugName;
+	return result;
+}
+
+bool TextureCook::CookFile(const std::string& path, const TextureCookSettings& settings) {
+	AssetLoadScope load("Cook " + std::filesystem::path(path).filename().string());
+	Texture2DData::sptr image = Texture2DData::LoadFromFile(path);
+	if (image == nullptr) {
+		return false;
+	}
+	MipChainData::sptr mips = GenerateMips(image, settings);
+	if (mips == nullptr) {
+		return false;
+	}
+	if (!mips->SaveSidecar(path)) {
+		return false;
+	}
+	LOG_INFO("Cooked {} mip levels for \"{}\"", mips->GetLevelCount(), path);
+	return true;
+}
+
+uint32_t TextureCook::CookDirectory(const std::string& path, const TextureCookSettings& settings) {
+	std::error_code error;
+	std::vector<std::future<bool>> results;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+		if (entry.is_regular_file() && IsCookableFile(entry.path().string())) {
+			std::string file = entry.path().string();
+			results.push_back(ThreadPool::Instance().Submit([file, settings]() { return CookFile(file, settings); }));
+		}
+	}
+	if (error) {
+		LOG_WARN("Failed to search \"{}\" for images: {}", path, error.message());
+	}
+
+	uint32_t cooked = 0;
+	for (std::future<bool>& result : results) {
+		cooked += result.get() ? 1 : 0;
+	}
+	return cooked;
+}
+
+bool TextureCook::IsCookableFile(const std::string& path) {
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower(c); });
+	return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "Texture2DData.h"
+#include "MipChainData.h"
+
+// The filters we can use to shrink each mip level
+enum class MipFilter {
+	// Averages each 2x2 block, this matches what glGenerateMipmap does on most drivers
+	Box,
+	// A Kaiser windowed sinc, keeps detail sharper in the smaller levels at the cost of some ringing
+	Kaiser
+};
+
+struct TextureCookSettings
+{
+	MipFilter Filter;
+	// When true, the color channels are filtered in linear space instead of sRGB, so the smaller levels don't get
+	// darker. Should be turned off for data textures like normal maps
+	bool      GammaCorrect;
+
+	TextureCookSettings() :
+		Filter(MipFilter::Box),
+		GammaCorrect(true)
+	{ }
+};
+
+/// <summary>
+/// Pre-computes mip chains for images ahead of time, and stores them in sidecar files next to the images (see
+/// MipChainData). Texture2D and TextureLoader will upload the cooked levels instead of generating them on the GPU
+/// </summary>
+class TextureCook final
+{
+public:
+	/// <summary>
+	/// Builds a full mip chain for an image, the first level is the image itself
+	/// </summary>
+	/// <param name="image">The image to build the mips for, must be 8 bits per component</param>
+	/// <param name="settings">How the smaller levels should be filtered</param>
+	/// <returns>The mip chain, or nullptr if the image is not in a format we can filter</returns>
+	static MipChainData::sptr GenerateMips(const Texture2DData::sptr& image, const TextureCookSettings& settings = TextureCookSettings());
+
+	/// <summary>
+	/// Resizes an image with the same filtering we use for mips, used to make images fit a shared size (ex: the layers
+	/// of a texture array)
+	/// </summary>
+	/// <param name="image">The image to resize, must be 8 bits per component</param>
+	/// <param name="width">The new width, in pixels</param>
+	/// <param name="height">The new height, in pixels</param>
+	/// <param name="settings">How the image should be filtered</param>
+	/// <returns>The resized image (or image itself if it's already the right size), or nullptr if it is not in a format we can filter</returns>
+	static Texture2DData::sptr Resize(const Texture2DData::sptr& image, uint32_t width, uint32_t height, const TextureCookSettings& settings = TextureCookSettings());
+
+	/// <summary>
+	/// Builds the mip chain for an image file and writes it to the image's sidecar
+	/// </summary>
+	/// <param name="path">The path of the image to cook</param>
+	/// <param name="settings">How the smaller levels should be filtered</param>
+	/// <returns>True if the sidecar was written</returns>
+	static bool CookFile(const std::string& path, const TextureCookSettings& settings = TextureCookSettings());
+	/// <summary>
+	/// Cooks every image in a folder and all of it's sub-folders, images are cooked in parallel on the ThreadPool
+	/// </summary>
+	/// <param name="path">The folder to search for images</param>
+	/// <param name="settings">How the smaller levels should be filtered</param>
+	/// <returns>The number of images that were cooked</returns>
+	static uint32_t CookDirectory(const std::string& path, const TextureCookSettings& settings = TextureCookSettings());
+
+	/// <summary>
+	/// Returns true if the file is an image that we know how to cook
+	/// </summary>
+	static bool IsCookableFile(const std::string& path);
+
+protected:
+	TextureCook() = default;
+};
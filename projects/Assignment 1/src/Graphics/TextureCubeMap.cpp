@@ -1,32 +1,50 @@
 #include "TextureCubeMap.h"
+#include "PanoramaConverter.h"
+#include "RenderStats.h"
+#include "Utilities/TraceRecorder.h"
+
+#include <algorithm>
+#include <vector>
 
 TextureCubeMap::TextureCubeMap(const TextureCubeDesc& description) :
 	ITexture(), _description(description)
 {
-
+	_UpdateSampler();
 	_RecreateTexture();
 }
 
 void TextureCubeMap::_RecreateTexture() {
-	if (_handle != 0) {
-		glDeleteTextures(1, &_handle);
-		_handle = 0;
+	if (_bindlessHandle != 0) {
+		LOG_WARN("Recreating a texture that has a bindless handle, anything holding the old handle will need to be updated");
 	}
+	_DeleteTexture();
 
 	glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &_handle);
 
 	if (_description.Size > 0 && _description.Format != InternalFormat::Unknown)
 	{
-		glTextureStorage2D(_handle, 1, *_description.Format, _description.Size, _description.Size);
-
-		glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTextureParameteri(_handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, (GLenum)_description.MinificationFilter);
-		glTextureParameteri(_handle, GL_TEXTURE_MAG_FILTER, (GLenum)_description.MagnificationFilter);
+		// We need room for the whole chain up front, since the storage can't grow once glGenerateTextureMipmap runs
+		const uint32_t levelCount = GetLevelCount();
+		glTextureStorage2D(_handle, levelCount, *_description.Format, _description.Size, _description.Size);
+		_SetMemorySize(GetTextureMemorySize(_description.Format, _description.Size, _description.Size, levelCount, 6));
 	}
 }
 
+void TextureCubeMap::_UpdateSampler() {
+	SamplerDescription sampler;
+	sampler.WrapS               = WrapMode::ClampToEdge;
+	sampler.WrapT               = WrapMode::ClampToEdge;
+	sampler.WrapR               = WrapMode::ClampToEdge;
+	sampler.MinificationFilter  = _description.MinificationFilter;
+	sampler.MagnificationFilter = _description.MagnificationFilter;
+	// Cubemaps have never used anisotropic filtering
+	sampler.MaxAnisotropic      = 1.0f;
+	_sampler = Sampler::Get(sampler);
+}
+
 void TextureCubeMap::LoadData(const TextureCubeMapData::sptr& data) {
+	// Anything we held onto is out of date now, and we only hang onto the new data if we've been asked to
+	_cpuCopy = _description.Residency == CpuResidency::KeepCpuCopy ? data : nullptr;
 	if (_description.Size != data->GetSize())
 	{
 		_description.Size = data->GetSize();
@@ -39,8 +57,12 @@ void TextureCubeMap::LoadData(const TextureCubeMapData::sptr& data) {
 	}
 
 	// We can get better error logs by attaching an object label!
-	if (!data->DebugName.empty()) {
-		glObjectLabel(GL_TEXTURE, _handle, data->DebugName.length(), data->DebugName.c_str());
+	SetDebugName(data->DebugName);
+
+	// Panoramas fill every level on the GPU, so there's nothing to upload or generate
+	if (data->GetPanorama() != nullptr) {
+		PanoramaConverter::Get()->Convert(data->GetPanorama(), *this);
+		return;
 	}
 
 	// Align the data store to the size of a single component in
@@ -48,32 +70,113 @@ void TextureCubeMap::LoadData(const TextureCubeMapData::sptr& data) {
 	int componentSize = (GLint)GetTexelComponentSize(data->GetPixelType());
 	glPixelStorei(GL_PACK_ALIGNMENT, componentSize);
 
-	// Upload our data to our image
-	glTextureSubImage3D(_handle, 0, 0, 0, 0, _description.Size, _description.Size, 6, *data->GetFormat(), *data->GetPixelType(), data->GetDataPtr());
+	// Upload our data to our image, one face at a time since the faces are stored separately
+	for (int ix = 0; ix < 6; ix++) {
+		if (data->GetFaceDataPtr((CubeMapFace)ix) == nullptr) {
+			continue;
+		}
+		glTextureSubImage3D(_handle, 0, 0, 0, ix, _description.Size, _description.Size, 1, *data->GetFormat(), *data->GetPixelType(), data->GetFaceDataPtr((CubeMapFace)ix));
+		RenderStats::CountTextureUpload(data->GetFaceDataSize());
+	}
 
 	if (_description.GenerateMipMaps) {
 		glGenerateTextureMipmap(_handle);
 	}
 }
 
-TextureCubeMap::sptr TextureCubeMap::LoadFromImages(const std::string& path)
+void TextureCubeMap::LoadLevels(const MipChainData::sptr& data) {
+	_cpuCopy = nullptr;
+	LOG_ASSERT(data->GetWidth() * 6 == data->GetHeight(), "Cube map mip chains must have their 6 faces stacked, got a {}x{} image", data->GetWidth(), data->GetHeight());
+	if (_description.Size != data->GetWidth()) {
+		_description.Size = data->GetWidth();
+		if (_description.Format == InternalFormat::Unknown) {
+			_description.Format = data->GetRecommendedFormat();
+		}
+		_RecreateTexture();
+	}
+
+	SetDebugName(data->DebugName);
+
+	int componentSize = (GLint)GetTexelComponentSize(data->GetPixelType());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, componentSize);
+
+	// The faces of a cube map are it's layers, so each level can go up in one call
+	const uint32_t levelCount = std::min(data->GetLevelCount(), GetLevelCount());
+	for (uint32_t level = 0; level < levelCount; level++) {
+		const MipChainData::MipLevel& info = data->GetLevel(level);
+		glTextureSubImage3D(_handle, level, 0, 0, 0, info.Width, info.Width, 6, *data->GetFormat(), *data->GetPixelType(), data->GetLevelData(level));
+		RenderStats::CountTextureUpload(info.Size);
+	}
+}
+
+MipChainData::sptr TextureCubeMap::ReadLevels(PixelFormat format, PixelType type) const {
+	MipChainData::sptr result = std::make_shared<MipChainData>(_description.Size, _description.Size * 6, format, type, _description.Format);
+	const uint32_t levelCount = GetLevelCount();
+	std::vector<uint8_t> pixels;
+	glPixelStorei(GL_PACK_ALIGNMENT, (GLint)GetTexelComponentSize(type));
+	for (uint32_t level = 0; level < levelCount; level++) {
+		const uint32_t size = std::max(_description.Size >> level, 1u);
+		pixels.resize(size * (size_t)size * 6 * GetTexelSize(format, type));
+		// Reading a whole cube map level gives us every face back to back
+		glGetTextureImage(_handle, level, *format, *type, (GLsizei)pixels.size(), pixels.data());
+		result->AddLevel(pixels.data());
+	}
+	return result;
+}
+
+uint32_t TextureCubeMap::GetLevelCount() const {
+	if (_description.LevelCount > 0) {
+		return std::min(_description.LevelCount, GetMipLevelCount(_description.Size, _description.Size));
+	}
+	return _description.GenerateMipMaps ? GetMipLevelCount(_description.Size, _description.Size) : 1;
+}
+
+TextureCubeMap::sptr TextureCubeMap::LoadFromImages(const std::string& path, CpuResidency residency)
+{
+	AssetLoadScope load(path);
+	return CreateFromImages(path, TextureCubeMapData::LoadFromImages(path), residency);
+}
+
+TextureCubeMap::sptr TextureCubeMap::CreateFromImages(const std::string& path, const TextureCubeMapData::sptr& data, CpuResidency residency)
 {
-	TextureCubeMapData::sptr data = TextureCubeMapData::LoadFromImages(path);
-	TextureCubeMap::sptr result = TextureCubeMap::Create();
+	TextureCubeDesc description;
+	description.Residency = residency;
+	// Panoramas get their whole mip chain filled when they're converted
+	if (data != nullptr && data->GetPanorama() != nullptr) {
+		description.GenerateMipMaps = true;
+		description.MinificationFilter = MinFilter::LinearMipLinear;
+	}
+	TextureCubeMap::sptr result = TextureCubeMap::Create(description);
+	result->_sourcePath = path;
 	result->LoadData(data);
 	return result;
 }
 
+TextureCubeMapData::sptr TextureCubeMap::GetCpuData() {
+	if (_cpuCopy != nullptr || _description.Residency == CpuResidency::GpuOnly) {
+		return _cpuCopy;
+	}
+	if (_sourcePath.empty()) {
+		LOG_WARN("Cubemap has no source images to load it's CPU copy from");
+		return nullptr;
+	}
+	return TextureCubeMapData::LoadFromImages(_sourcePath);
+}
+
 void TextureCubeMap::SetMinFilter(MinFilter filter) {
-	_description.MinificationFilter = filter;
-	if (_handle != 0) {
-		glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, (GLenum)_description.MinificationFilter);
+	if (_bindlessHandle != 0) {
+		LOG_WARN("Cannot change the sampling state of a texture once it has a bindless handle");
+		return;
 	}
+	_description.MinificationFilter = filter;
+	_UpdateSampler();
 }
 
 void TextureCubeMap::SetMagFilter(MagFilter filter) {
-	_description.MagnificationFilter = filter;
-	if (_handle != 0) {
-		glTextureParameteri(_handle, GL_TEXTURE_MAG_FILTER, (GLenum)_description.MagnificationFilter);
+	if (_bindlessHandle != 0) {
+		LOG_WARN("Cannot change the sampling state of a texture once it has a bindless handle");
+		return;
 	}
+	_description.MagnificationFilter = filter;
+	_UpdateSampler();
 }
\ No newline at end of file
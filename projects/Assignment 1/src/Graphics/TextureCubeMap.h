@@ -1,8 +1,11 @@
 #pragma once
 #include <cstdint>
+#include <string>
 
+#include "CpuResidency.h"
 #include "ITexture.h"
 #include "TextureCubeMapData.h"
+#include "MipChainData.h"
 #include "Graphics/TextureEnums.h"
 
 struct TextureCubeDesc {
@@ -11,13 +14,20 @@ struct TextureCubeDesc {
 	MinFilter      MinificationFilter;
 	MagFilter      MagnificationFilter;
 	bool           GenerateMipMaps;
+	// The number of mip levels to allocate, 0 allocates a full chain if GenerateMipMaps is set and 1 level otherwise.
+	// Used when the levels get filled in some other way (ex: the roughness levels from EnvironmentPrefilter)
+	uint32_t       LevelCount;
+	// Whether the faces are kept in CPU memory after they've been uploaded, see GetCpuData
+	CpuResidency   Residency;
 
 	TextureCubeDesc() :
 		Size(0),
 		Format(InternalFormat::Unknown),
 		MinificationFilter(MinFilter::Linear),
 		MagnificationFilter(MagFilter::Linear),
-		GenerateMipMaps(false)
+		GenerateMipMaps(false),
+		LevelCount(0),
+		Residency(CpuResidency::GpuOnly)
 	{ }
 };
 
@@ -49,8 +59,47 @@ public:
 	/// </summary>
 	/// <param name="data">The texture data to upload into this texture</param>
 	void LoadData(const TextureCubeMapData::sptr& data);
+	/// <summary>
+	/// Uploads a mip chain to this texture, each level of the chain stores the 6 faces stacked on top of each other
+	/// (so a 64x384 level fills the 64x64 faces), in the same order as CubeMapFace. The levels past the end of our
+	/// storage are ignored
+	/// </summary>
+	/// <param name="data">The mip chain to upload, it's width must match our size</param>
+	void LoadLevels(const MipChainData::sptr& data);
+	/// <summary>
+	/// Reads back the levels of this texture into a mip chain, with the faces stacked like LoadLevels expects
+	/// </summary>
+	/// <param name="format">The layout of the pixels to read back</param>
+	/// <param name="type">The component type of the pixels to read back</param>
+	MipChainData::sptr ReadLevels(PixelFormat format, PixelType type) const;
+
+	/// <summary>
+	/// Gets the number of mip levels in this texture's storage
+	/// </summary>
+	uint32_t GetLevelCount() const;
 
-	static TextureCubeMap::sptr LoadFromImages(const std::string& path);
+	/// <summary>
+	/// Loads a cubemap from a set of images or a single panorama, see TextureCubeMapData::LoadFromImages
+	/// </summary>
+	/// <param name="path">The path of any one of the cubemap's faces, or of the panorama</param>
+	/// <param name="residency">Whether to keep the faces in CPU memory after they've been uploaded</param>
+	static TextureCubeMap::sptr LoadFromImages(const std::string& path, CpuResidency residency = CpuResidency::GpuOnly);
+	/// <summary>
+	/// Creates a cubemap from faces that have already been loaded with TextureCubeMapData::LoadFromImages, ex: on a
+	/// worker thread. The cubemap can be reloaded from the path the same as if it had loaded them itself
+	/// </summary>
+	/// <param name="path">The path the faces were loaded from</param>
+	/// <param name="data">The faces to upload</param>
+	/// <param name="residency">Whether to keep the faces in CPU memory after they've been uploaded</param>
+	static TextureCubeMap::sptr CreateFromImages(const std::string& path, const TextureCubeMapData::sptr& data, CpuResidency residency = CpuResidency::GpuOnly);
+
+	/// <summary>
+	/// Gets a CPU copy of the cubemap's faces, depending on it's residency. Cubemaps that keep their copy hand it
+	/// straight back, ones that reload on demand load the images again every time, and GPU only cubemaps (or ones
+	/// that weren't loaded from images) don't have a copy at all
+	/// </summary>
+	/// <returns>The faces of the cubemap, or nullptr if there's no copy to be had</returns>
+	TextureCubeMapData::sptr GetCpuData();
 
 	uint32_t GetSize() const { return _description.Size; }
 	InternalFormat GetFormat() const { return _description.Format; }
@@ -63,7 +112,13 @@ public:
 	const TextureCubeDesc& GetDescription() const { return _description; }
 
 private:
-	TextureCubeDesc _description;
+	TextureCubeDesc          _description;
+	// The images we were loaded from, if we were loaded by LoadFromImages or CreateFromImages
+	std::string              _sourcePath;
+	// Only held onto if our residency is KeepCpuCopy
+	TextureCubeMapData::sptr _cpuCopy;
 
 	void _RecreateTexture();
+	// Picks the shared sampler that matches our description
+	void _UpdateSampler();
 };
@@ -1,21 +1,26 @@
 #include "TextureCubeMapData.h"
 #include <filesystem>
+#include <future>
+
+#include "PanoramaConverter.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/VirtualFileSystem.h"
 
 TextureCubeMapData::TextureCubeMapData(uint32_t size, PixelFormat format, PixelType type, void* sourceData, InternalFormat recommendedFormat) :
-	_size(size), _format(format), _type(type), _data(nullptr), _recommendedFormat(recommendedFormat) {
+	_size(size), _format(format), _type(type), _recommendedFormat(recommendedFormat) {
 	LOG_ASSERT(size > 0, "Size must be greater than zero! Got {}", size)
 	_faceDataSize = (size_t)_size * _size * GetTexelSize(_format, _type);
 	_dataSize = _faceDataSize * 6;
-	_data = malloc(_dataSize);
-	LOG_ASSERT(_data != nullptr, "Failed to allocate texture data!")
+	// Faces stay empty until they get loaded, unless we were given data to copy
 	if (sourceData != nullptr) {
-		memcpy(_data, sourceData, _dataSize);
+		for (int ix = 0; ix < 6; ix++) {
+			void* faceData = static_cast<char*>(sourceData) + _faceDataSize * ix;
+			_faces[ix] = std::make_shared<Texture2DData>(size, size, format, type, faceData, recommendedFormat);
+		}
 	}
 }
 
-TextureCubeMapData::~TextureCubeMapData() {
-	free(_data);
-}
+TextureCubeMapData::~TextureCubeMapData() = default;
 
 TextureCubeMapData::sptr TextureCubeMapData::CreateFromImages(const std::vector<Texture2DData::sptr>& images)
 {
@@ -36,14 +41,9 @@ TextureCubeMapData::sptr TextureCubeMapData::CreateFromImages(const std::vector<
 	return result;
 }
 
-TextureCubeMapData::sptr TextureCubeMapData::LoadFromImages(const std::string& rootImagePath) {
+std::string TextureCubeMapData::GetFacePath(const std::string& rootImagePath, CubeMapFace face) {
 	namespace fs = std::filesystem;
-	fs::path imagePath = fs::path(rootImagePath);
-	fs::path directory = imagePath.parent_path();
-	fs::path rootFile  = directory / imagePath.stem();
-	fs::path extension = imagePath.extension();
-
-	const std::string PATHS[6] = {
+	static const std::string SUFFIXES[6] = {
 		"_pos_x",
 		"_neg_x",
 		"_pos_y",
@@ -51,19 +51,56 @@ TextureCubeMapData::sptr TextureCubeMapData::LoadFromImages(const std::string& r
 		"_pos_z",
 		"_neg_z"
 	};
+	fs::path imagePath = fs::path(rootImagePath);
+	fs::path result = imagePath.parent_path() / imagePath.stem();
+	result += SUFFIXES[(int)face];
+	result += imagePath.extension();
+	return result.string();
+}
+
+TextureCubeMapData::sptr TextureCubeMapData::CreateFromPanorama(const Texture2DData::sptr& panorama) {
+	if (panorama == nullptr) {
+		return nullptr;
+	}
+	// The faces get written as images, so HDR panoramas pack into RGB9_E5 and everything else into RGBA8 (RGB8 can't
+	// be written from a shader)
+	const InternalFormat format = panorama->GetPixelType() == PixelType::Float ? InternalFormat::RGB9_E5 : InternalFormat::RGBA8;
+	TextureCubeMapData::sptr result = std::make_shared<TextureCubeMapData>(PanoramaConverter::GetFaceSize(panorama->GetWidth()),
+		panorama->GetFormat(), panorama->GetPixelType(), nullptr, format);
+	result->_panorama = panorama;
+	result->_dataSize = panorama->GetDataSize();
+	result->DebugName = panorama->DebugName;
+	return result;
+}
+
+bool TextureCubeMapData::IsPanorama(const std::string& rootImagePath) {
+	return VirtualFileSystem::Exists(rootImagePath) && !VirtualFileSystem::Exists(GetFacePath(rootImagePath, CubeMapFace::PosX));
+}
+
+TextureCubeMapData::sptr TextureCubeMapData::LoadFromImages(const std::string& rootImagePath) {
+	if (IsPanorama(rootImagePath)) {
+		return CreateFromPanorama(Texture2DData::LoadFromFile(rootImagePath));
+	}
 
 	std::vector<Texture2DData::sptr> data;
 	data.resize(6);
+	std::future<Texture2DData::sptr> futures[6];
 
 	for(int ix = 0; ix < 6; ix++) {
-		fs::path imagePath = rootFile;
-		imagePath += PATHS[ix];
-		imagePath += extension;
-		if (fs::exists(imagePath)) {
-			data[ix] = Texture2DData::LoadFromFile(imagePath.string());
+		std::string imagePath = GetFacePath(rootImagePath, (CubeMapFace)ix);
+		if (VirtualFileSystem::Exists(imagePath)) {
+			// Each face decodes on it's own worker, so a cubemap loads about as fast as it's slowest face
+			futures[ix] = ThreadPool::Instance().Submit([path = imagePath]() {
+				return Texture2DData::LoadFromFile(path);
+			});
 		}
 		else {
-			LOG_WARN("Image \"{}\" could not be found!", imagePath.string());
+			LOG_WARN("Image \"{}\" could not be found!", imagePath);
+		}
+	}
+	for (int ix = 0; ix < 6; ix++) {
+		if (futures[ix].valid()) {
+			data[ix] = futures[ix].get();
 		}
 	}
 
@@ -76,8 +113,7 @@ void TextureCubeMapData::LoadFaceData(const Texture2DData::sptr& data, CubeMapFa
 		LOG_ASSERT(data->GetFormat() == _format, "Data format does not match! {} vs {}", data->GetFormat(), _format);
 		LOG_ASSERT(data->GetPixelType() == _type, "Data pixel type does not match! {} vs {}", data->GetPixelType(), _type);
 
-		size_t offset = (size_t)face * _faceDataSize;
-		memcpy(static_cast<char*>(_data) + offset, data->GetDataPtr(), _faceDataSize);
+		_faces[(size_t)face] = data;
 	} else {
 		LOG_WARN("Data for face {} was null, ignoring", face);
 	}
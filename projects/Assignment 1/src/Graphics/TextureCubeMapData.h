@@ -24,7 +24,8 @@ ENUM(CubeMapFace, GLint,
 );
 
 /// <summary>
-/// Stores data required to upload texture data into OpenGL
+/// Stores data required to upload texture data into OpenGL. Each face is kept as it's own Texture2DData, so faces
+/// loaded from images are used as-is without being copied into a combined buffer
 /// </summary>
 class TextureCubeMapData final
 {
@@ -65,13 +66,39 @@ public:
 	/// image_pos_y.png --> CubeMapFace::PosY
 	/// image_neg_z.png --> CubeMapFace::NegZ
 	/// image_pos_z.png --> CubeMapFace::PosZ
+	///
+	/// HDR faces (ex: image_pos_x.hdr) stay as floats, and recommend RGB9_E5 so the cubemap takes a quarter of the
+	/// memory it would as RGBA32F while keeping it's range for reflections
+	///
+	/// If the root image exists and the faces don't, it's loaded as an equirectangular panorama instead (see
+	/// CreateFromPanorama)
 	/// </summary>
 	/// <param name="rootImagePath">The base path for images, including extension. This file name will be appended with _pos_x, _neg_x, etc...</param>
 	/// <returns>A pointer to the data created from the images</returns>
 	static TextureCubeMapData::sptr LoadFromImages(const std::string& rootImagePath);
+	/// <summary>
+	/// Creates cubemap data that holds an equirectangular panorama rather than 6 faces. The faces get made from it on the
+	/// GPU when it's uploaded (see PanoramaConverter), so only one image has to be read and decoded
+	/// </summary>
+	/// <param name="panorama">The panorama, wrapping 360 degrees around it's width and 180 degrees top to bottom</param>
+	/// <returns>A pointer to the data holding the panorama, or nullptr if panorama was null</returns>
+	static TextureCubeMapData::sptr CreateFromPanorama(const Texture2DData::sptr& panorama);
+	/// <summary>
+	/// Returns true if LoadFromImages would load the given path as a panorama, which it does when the file itself
+	/// exists but it's first face doesn't
+	/// </summary>
+	/// <param name="rootImagePath">The base path for images, including extension</param>
+	static bool IsPanorama(const std::string& rootImagePath);
+	/// <summary>
+	/// Gets the path of the file that LoadFromImages loads a face from
+	/// </summary>
+	/// <param name="rootImagePath">The base path for images, including extension</param>
+	/// <param name="face">The face to get the path for</param>
+	static std::string GetFacePath(const std::string& rootImagePath, CubeMapFace face);
 
 	/// <summary>
-	/// Loads 2D image data into this cubemap data for the given face. Dimensions and format must match the existing size and formats
+	/// Loads 2D image data into this cubemap data for the given face. Dimensions and format must match the existing size and formats.
+	/// The data is shared rather than copied, so it should not be modified afterwards
 	/// </summary>
 	/// <param name="data">The data to load into the face</param>
 	/// <param name="face">The face to load data into</param>
@@ -103,17 +130,16 @@ public:
 	/// </summary>
 	/// <returns></returns>
 	size_t GetFaceDataSize() const { return _faceDataSize; }
-	/// <summary>
-	/// Gets a readonly copy of the underlying data in this image for upload
-	/// </summary>
-	const void* GetDataPtr() const { return _data; }
-
 	/// <summary>
 	/// Gets a readonly copy of the data for a single face in this cube map
 	/// </summary>
 	/// <param name="face">The face to get the data for</param>
-	/// <returns>A const pointer to the start of data for the given face</returns>
-	const void* GetFaceDataPtr(CubeMapFace face) const { return static_cast<char*>(_data) + (_faceDataSize * (size_t)face); }
+	/// <returns>A const pointer to the start of data for the given face, or nullptr if the face was never loaded</returns>
+	const void* GetFaceDataPtr(CubeMapFace face) const { return _faces[(size_t)face] != nullptr ? _faces[(size_t)face]->GetDataPtr() : nullptr; }
+	/// <summary>
+	/// Gets the panorama the faces are made from, or nullptr if the faces were loaded on their own
+	/// </summary>
+	const Texture2DData::sptr& GetPanorama() const { return _panorama; }
 
 private:
 	uint32_t    _size;
@@ -122,5 +148,6 @@ private:
 	PixelFormat _format;
 	PixelType   _type;
 	InternalFormat _recommendedFormat;
-	void* _data;
+	Texture2DData::sptr _faces[6];
+	Texture2DData::sptr _panorama;
 };
\ No newline at end of file
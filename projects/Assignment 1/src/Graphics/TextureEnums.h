@@ -1,10 +1,19 @@
 #pragma once
 
+#include <cstdint>
 #include <EnumToString.h>
 
 #include "Logging.h"
 #include "glad/glad.h"
 
+// Not in our glad loader, these come from EXT_texture_compression_s3tc which every desktop GPU supports
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 // https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glTexImage2D.xhtml
 // These are some of our more common available internal formats
 ENUM(InternalFormat, GLint,
@@ -18,11 +27,60 @@ ENUM(InternalFormat, GLint,
 	RGB10        = GL_RGB10,
 	RGB16        = GL_RGB16,
 	RGBA8        = GL_RGBA8,
-	RGBA16       = GL_RGBA16
+	RGBA16       = GL_RGBA16,
+	RGBA16F      = GL_RGBA16F,
+	// Compact HDR formats, these keep the range of floats in 32 bits a texel (see Texture2DData::LoadFromFile)
+	RGB9_E5      = GL_RGB9_E5,
+	R11G11B10F   = GL_R11F_G11F_B10F,
+
+	// Block compressed formats, these can only be loaded from pre-compressed data (see CompressedTextureData)
+	BC1          = GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+	BC1A         = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+	BC2          = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
+	BC3          = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+	BC4          = GL_COMPRESSED_RED_RGTC1,
+	BC5          = GL_COMPRESSED_RG_RGTC2,
+	BC7          = GL_COMPRESSED_RGBA_BPTC_UNORM,
+	BC7_SRGB     = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM,
+	BC6H         = GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT,
+	BC6H_SIGNED  = GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT
 
 	// Note: There are sized internal formats but there is a LOT of them
 );
 
+/*
+ * Gets the number of bytes in a single 4x4 block of the given compressed format
+ * @param format The internal format to check
+ * @returns The size of a block in bytes, or 0 if the format is not block compressed
+ */
+constexpr size_t GetCompressedBlockSize(InternalFormat format)
+{
+	switch (format)
+	{
+		case InternalFormat::BC1:
+		case InternalFormat::BC1A:
+		case InternalFormat::BC4:
+			return 8;
+		case InternalFormat::BC2:
+		case InternalFormat::BC3:
+		case InternalFormat::BC5:
+		case InternalFormat::BC7:
+		case InternalFormat::BC7_SRGB:
+		case InternalFormat::BC6H:
+		case InternalFormat::BC6H_SIGNED:
+			return 16;
+		default:
+			return 0;
+	}
+}
+
+/*
+ * Returns true if the given internal format is block compressed
+ */
+constexpr bool IsCompressedFormat(InternalFormat format) {
+	return GetCompressedBlockSize(format) != 0;
+}
+
 // The layout of the input pixel data
 ENUM(PixelFormat, GLint,
 	Red          = GL_RED,
@@ -44,6 +102,7 @@ ENUM(PixelType, GLint,
 	Short  = GL_SHORT,
 	UInt   = GL_UNSIGNED_INT,
 	Int    = GL_INT,
+	Half   = GL_HALF_FLOAT,
 	Float  = GL_FLOAT
 );
 
@@ -83,9 +142,11 @@ constexpr size_t GetTexelComponentSize(PixelType type)
 		return 1;
 	case PixelType::UShort:
 	case PixelType::Short:
+	case PixelType::Half:
 		return 2;
 	case PixelType::Int:
 	case PixelType::UInt:
+	case PixelType::Float:
 		return 4;
 	default:
 		LOG_ASSERT(false, "Unknown type: {}", type);
@@ -126,4 +187,78 @@ constexpr GLint GetTexelComponentCount(PixelFormat format)
  */
 constexpr size_t GetTexelSize(PixelFormat format, PixelType type) {
 	return GetTexelComponentSize(type) * GetTexelComponentCount(format);
-}
\ No newline at end of file
+}
+
+/*
+ * Gets the number of levels in a full mip chain for an image of the given size, down to and including 1x1
+ * @param width The width of the largest level, in pixels
+ * @param height The height of the largest level, in pixels
+ * @returns The number of mip levels, or 0 if the image is empty
+ */
+constexpr uint32_t GetMipLevelCount(uint32_t width, uint32_t height) {
+	uint32_t size = width > height ? width : height;
+	uint32_t result = 0;
+	while (size > 0) {
+		result++;
+		size >>= 1;
+	}
+	return result;
+}
+
+/*
+ * Gets roughly how many bytes the GPU uses for a single texel of an uncompressed internal format. Drivers pad
+ * 3 component formats out to 4, so we count them that way
+ * @param format The internal format to check
+ * @returns The size of a texel in bytes, or 0 if the format is block compressed or unknown
+ */
+constexpr size_t GetInternalFormatTexelSize(InternalFormat format)
+{
+	switch (format)
+	{
+		case InternalFormat::R8:
+			return 1;
+		case InternalFormat::R16:
+		case InternalFormat::RG8:
+			return 2;
+		case InternalFormat::RGB8:
+		case InternalFormat::RGB10:
+		case InternalFormat::RGBA8:
+		case InternalFormat::Depth:
+		case InternalFormat::DepthStencil:
+		case InternalFormat::RGB9_E5:
+		case InternalFormat::R11G11B10F:
+			return 4;
+		case InternalFormat::RGB16:
+		case InternalFormat::RGBA16:
+		case InternalFormat::RGBA16F:
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+/*
+ * Estimates how much GPU memory a texture's storage takes up
+ * @param format The internal format of the texture
+ * @param width The width of the largest level, in pixels
+ * @param height The height of the largest level, in pixels
+ * @param levels The number of mip levels in the storage
+ * @param layers The number of layers (or faces, for cubemaps) in the storage
+ * @returns The size of the storage, in bytes
+ */
+constexpr size_t GetTextureMemorySize(InternalFormat format, uint32_t width, uint32_t height, uint32_t levels, uint32_t layers = 1)
+{
+	const size_t blockSize = GetCompressedBlockSize(format);
+	size_t result = 0;
+	for (uint32_t level = 0; level < levels; level++) {
+		const size_t levelWidth = width >> level > 0 ? width >> level : 1;
+		const size_t levelHeight = height >> level > 0 ? height >> level : 1;
+		if (blockSize != 0) {
+			// Partial blocks on the edges still take up a full block
+			result += ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockSize;
+		} else {
+			result += levelWidth * levelHeight * GetInternalFormatTexelSize(format);
+		}
+	}
+	return result * layers;
+}
@@ -0,0 +1,409 @@
+#include "TextureLoader.h"
+#include "GpuResources.h"
+#include "Logging.h"
+#include "TextureCompressor.h"
+#include "TextureCook.h"
+#include "TextureResidency.h"
+#include "UploadContext.h"
+#include "Utilities/MemoryTracker.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/TraceRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+size_t TextureLoader::StagingBufferSize = 32 * 1024 * 1024;
+size_t TextureLoader::UploadBudget = 16 * 1024 * 1024;
+uint32_t TextureLoader::PlaceholderSize = 4;
+
+std::mutex                          TextureLoader::_mutex;
+std::condition_variable             TextureLoader::_jobDone;
+std::deque<TextureLoader::Job>      TextureLoader::_completed;
+uint32_t                            TextureLoader::_pending = 0;
+GLuint                              TextureLoader::_stagingBuffer = 0;
+uint8_t*                            TextureLoader::_stagingData = nullptr;
+size_t                              TextureLoader::_stagingHead = 0;
+std::deque<TextureLoader::InFlight> TextureLoader::_inFlight;
+std::unordered_map<std::string, Task<TextureLoader::Decoded>> TextureLoader::_prefetched;
+
+// Keeps our pixel offsets aligned for any of the formats we upload
+static const size_t STAGING_ALIGNMENT = 16;
+
+void TextureLoader::Shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_completed.clear();
+		_pending = 0;
+	}
+	_prefetched.clear();
+
+	for (const InFlight& range : _inFlight) {
+		glDeleteSync(range.Fence);
+	}
+	_inFlight.clear();
+	if (_stagingBuffer != 0) {
+		glUnmapNamedBuffer(_stagingBuffer);
+		GpuResources::RemoveRaw(GL_BUFFER, _stagingBuffer);
+		glDeleteBuffers(1, &_stagingBuffer);
+		_stagingBuffer = 0;
+		_stagingData = nullptr;
+	}
+	_stagingHead = 0;
+}
+
+Texture2D::sptr TextureLoader::LoadAsync(const std::string& path, Texture2DDescription description) {
+	// Compressed files don't need decoding and come with their own mips, so they are cheap enough to load inline
+	if (CompressedTextureData::IsSupportedFile(path)) {
+		Texture2D::sptr result = Texture2D::Create(description);
+		result->SetSourcePath(path);
+		ReloadAsync(result);
+		TextureResidency::Register(result);
+		return result;
+	}
+
+	// We only read the header here so that we can create the texture at it's final size, that way it's handle
+	// never has to change once the pixels show up
+	uint32_t width = 0, height = 0;
+	InternalFormat format = InternalFormat::Unknown;
+	if (!Texture2DData::ReadInfo(path, width, height, format)) {
+		LOG_WARN("Failed to read image info from \"{}\", using a placeholder", path);
+		width = height = 1;
+		format = InternalFormat::RGBA8;
+	}
+	description.Width = width;
+	description.Height = height;
+	if (description.Format == InternalFormat::Unknown) {
+		description.Format = format;
+	}
+	Texture2D::sptr result = Texture2D::Create(description);
+	result->Clear(glm::vec4(1.0f));
+	result->SetSourcePath(path);
+	ReloadAsync(result);
+	TextureResidency::Register(result);
+	return result;
+}
+
+Texture2D::sptr TextureLoader::LoadOnDemand(const std::string& path, Texture2DDescription description) {
+	uint32_t width = 0, height = 0;
+	InternalFormat format = InternalFormat::Unknown;
+	if (!description.GenerateMipMaps || CompressedTextureData::IsSupportedFile(path) || !Texture2DData::ReadInfo(path, width, height, format)) {
+		return LoadAsync(path, description);
+	}
+	// We keep the small end of the image's mip chain, so the full image is just the levels we're missing on top
+	const uint32_t levelCount = GetMipLevelCount(width, height);
+	uint32_t missingLevels = 0;
+	while (missingLevels + 1 < levelCount && std::max(width >> missingLevels, height >> missingLevels) > PlaceholderSize) {
+		missingLevels++;
+	}
+	// Images that are already as small as a placeholder might as well be loaded now
+	if (missingLevels == 0) {
+		return LoadAsync(path, description);
+	}
+	description.Width = std::max(width >> missingLevels, 1u);
+	description.Height = std::max(height >> missingLevels, 1u);
+	if (description.Format == InternalFormat::Unknown) {
+		description.Format = format;
+	}
+	Texture2D::sptr result = Texture2D::Create(description);
+	result->Clear(glm::vec4(1.0f));
+	result->SetSourcePath(path);
+	result->SetMissingLevels(missingLevels);
+	TextureResidency::Register(result, false);
+	return result;
+}
+
+void TextureLoader::Prefetch(const std::string& path) {
+	// Compressed files get loaded inline anyways, so there's nothing to get a head start on
+	if (CompressedTextureData::IsSupportedFile(path) || _prefetched.count(path) > 0) {
+		return;
+	}
+	_prefetched[path] = ThreadPool::Instance().Schedule([path]() { return _DecodeFile(path); });
+}
+
+void TextureLoader::ReloadAsync(const Texture2D::sptr& target) {
+	const std::string& path = target->GetSourcePath();
+	LOG_ASSERT(!path.empty(), "Cannot reload a texture that was not loaded from a file!");
+	if (CompressedTextureData::IsSupportedFile(path)) {
+		AssetLoadScope load(path);
+		CompressedTextureData::sptr data = CompressedTextureData::LoadFromFile(path);
+		if (data != nullptr) {
+			target->LoadData(data);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pending++;
+	}
+	Job job;
+	job.Path = path;
+	job.Target = target;
+	job.Compressible = target->GetDescription().Compressible;
+	Task<Decoded> prefetched = _TakePrefetched(path);
+	if (prefetched.IsValid()) {
+		prefetched.Then([job](Decoded& decoded) mutable {
+			job.Data = decoded.Data;
+			job.Mips = decoded.Mips;
+			if (job.Compressible) {
+				_Compress(job);
+			}
+			_Finish(std::move(job));
+		});
+		return;
+	}
+	ThreadPool::Instance().Submit([job]() { _Decode(job); });
+}
+
+void TextureLoader::LoadLayerAsync(const std::string& path, const Texture2DArray::sptr& target, uint32_t layer) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pending++;
+	}
+	Job job;
+	job.Path = path;
+	job.ArrayTarget = target;
+	job.Layer = layer;
+	// The array's size never changes, so it's safe for the worker to resize to it
+	const uint32_t width = target->GetWidth(), height = target->GetHeight();
+	Task<Decoded> source = _TakePrefetched(path);
+	if (!source.IsValid()) {
+		std::weak_ptr<Texture2DArray> weakTarget = target;
+		source = ThreadPool::Instance().Schedule([path, weakTarget]() {
+			Decoded result;
+			if (!weakTarget.expired()) {
+				result.Data = Texture2DData::LoadFromFile(path);
+			}
+			return result;
+		});
+	}
+	source.Then([job, width, height](Decoded& decoded) mutable {
+		if (!job.ArrayTarget.expired()) {
+			// Layers get resized to fit the array, so a prefetched mip chain is no use to us and we need the image
+			Texture2DData::sptr data = decoded.Data;
+			if (data == nullptr && decoded.Mips != nullptr) {
+				data = Texture2DData::LoadFromFile(job.Path);
+			}
+			job.Data = data != nullptr ? TextureCook::Resize(data, width, height) : nullptr;
+		}
+		_Finish(std::move(job));
+	});
+}
+
+void TextureLoader::Update() {
+	size_t uploaded = 0;
+	while (uploaded < UploadBudget) {
+		Job job;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_completed.empty()) {
+				break;
+			}
+			job = std::move(_completed.front());
+			_completed.pop_front();
+		}
+		// The upload thread's work doesn't stall our frame, so it doesn't count towards the budget
+		if (_Upload(job)) {
+			continue;
+		}
+		if (job.Compressed != nullptr) {
+			uploaded += job.Compressed->GetDataSize();
+		} else if (job.Mips != nullptr) {
+			uploaded += job.Mips->GetDataSize();
+		} else if (job.Data != nullptr) {
+			uploaded += job.Data->GetDataSize();
+		}
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pending--;
+	}
+}
+
+void TextureLoader::WaitAll() {
+	const size_t budget = UploadBudget;
+	UploadBudget = SIZE_MAX;
+	while (GetPendingCount() > 0) {
+		{
+			// Workers notify us whenever they finish something, but uploads on the UploadContext only finish once we
+			// poll their fences, so we can't wait forever
+			std::unique_lock<std::mutex> lock(_mutex);
+			_jobDone.wait_for(lock, std::chrono::milliseconds(1), []() { return !_completed.empty() || _pending == 0; });
+		}
+		UploadContext::Update();
+		Update();
+	}
+	UploadBudget = budget;
+}
+
+uint32_t TextureLoader::GetPendingCount() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _pending;
+}
+
+void TextureLoader::_Decode(Job job) {
+	// Don't bother decoding images for textures that have already been dropped
+	if (!job.Target.expired()) {
+		// A compressed copy we cached last time saves us both decoding and compressing
+		if (job.Compressible) {
+			MEMORY_SCOPE(MemoryTag::Textures);
+			job.Compressed = TextureCompressor::LoadCached(job.Path);
+		}
+		if (job.Compressed == nullptr) {
+			Decoded decoded = _DecodeFile(job.Path);
+			job.Data = decoded.Data;
+			job.Mips = decoded.Mips;
+			if (job.Compressible) {
+				_Compress(job);
+			}
+		}
+	}
+	_Finish(std::move(job));
+}
+
+void TextureLoader::_Compress(Job& job) {
+	MEMORY_SCOPE(MemoryTag::Textures);
+	job.Compressed = TextureCompressor::CompressAndCache(job.Path, job.Mips, job.Data);
+	// Images that can't be compressed (ex: HDR) just upload as they are
+	if (job.Compressed != nullptr) {
+		job.Data = nullptr;
+		job.Mips = nullptr;
+	}
+}
+
+TextureLoader::Decoded TextureLoader::_DecodeFile(const std::string& path) {
+	MEMORY_SCOPE(MemoryTag::Textures);
+	Decoded result;
+	result.Mips = MipChainData::LoadSidecar(path);
+	if (result.Mips == nullptr) {
+		result.Data = Texture2DData::LoadFromFile(path);
+	}
+	return result;
+}
+
+Task<TextureLoader::Decoded> TextureLoader::_TakePrefetched(const std::string& path) {
+	auto it = _prefetched.find(path);
+	if (it == _prefetched.end()) {
+		return Task<Decoded>();
+	}
+	Task<Decoded> result = it->second;
+	_prefetched.erase(it);
+	return result;
+}
+
+void TextureLoader::_Finish(Job&& job) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_completed.push_back(std::move(job));
+	}
+	_jobDone.notify_all();
+}
+
+bool TextureLoader::_Upload(const Job& job) {
+	Texture2D::sptr target = job.Target.lock();
+	Texture2DArray::sptr arrayTarget = job.ArrayTarget.lock();
+	if ((target == nullptr && arrayTarget == nullptr) || (job.Data == nullptr && job.Mips == nullptr && job.Compressed == nullptr)) {
+		return false;
+	}
+	AssetLoadScope load(job.Path);
+	// The texture's storage changes format, so this has to happen on the texture itself rather than on a copy
+	if (job.Compressed != nullptr) {
+		target->LoadData(job.Compressed);
+		return false;
+	}
+	if (target != nullptr && UploadContext::IsAvailable()) {
+		// The description gets copied here, the upload thread can't touch the texture itself
+		const Texture2DDescription description = target->GetDescription();
+		std::shared_ptr<Texture2D::Upload> upload = std::make_shared<Texture2D::Upload>();
+		Texture2DData::sptr data = job.Data;
+		MipChainData::sptr mips = job.Mips;
+		std::weak_ptr<Texture2D> weakTarget = job.Target;
+		UploadContext::Submit([upload, description, data, mips]() {
+			*upload = mips != nullptr ? Texture2D::Prepare(description, mips) : Texture2D::Prepare(description, data);
+		}, [upload, weakTarget]() {
+			Texture2D::sptr target = weakTarget.lock();
+			if (target != nullptr) {
+				target->Adopt(*upload);
+			} else {
+				glDeleteTextures(1, &upload->Handle);
+			}
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_pending--;
+			}
+			_jobDone.notify_all();
+		});
+		return true;
+	}
+	// The levels of a mip chain are packed together, so they can be staged in a single copy
+	const size_t size = job.Mips != nullptr ? job.Mips->GetDataSize() : job.Data->GetDataSize();
+	if (size > StagingBufferSize) {
+		if (arrayTarget != nullptr) {
+			arrayTarget->LoadLayer(job.Layer, job.Data);
+		} else if (job.Mips != nullptr) {
+			target->LoadData(job.Mips);
+		} else {
+			target->LoadData(job.Data);
+		}
+		return false;
+	}
+
+	if (_stagingBuffer == 0) {
+		// Persistent and coherent so we can write straight into the mapping and never have to unmap it
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &_stagingBuffer);
+		glNamedBufferStorage(_stagingBuffer, StagingBufferSize, nullptr, flags);
+		GpuResources::AddRaw(GL_BUFFER, _stagingBuffer, StagingBufferSize, "Texture Staging Buffer");
+		_stagingData = static_cast<uint8_t*>(glMapNamedBufferRange(_stagingBuffer, 0, StagingBufferSize, flags));
+		LOG_ASSERT(_stagingData != nullptr, "Failed to map texture staging buffer!");
+	}
+
+	size_t offset = _Allocate(size);
+	if (arrayTarget != nullptr) {
+		memcpy(_stagingData + offset, job.Data->GetDataPtr(), size);
+		arrayTarget->LoadLayer(job.Layer, job.Data, _stagingBuffer, offset);
+	} else if (job.Mips != nullptr) {
+		memcpy(_stagingData + offset, job.Mips->GetDataPtr(), size);
+		target->LoadData(job.Mips, _stagingBuffer, offset);
+	} else {
+		memcpy(_stagingData + offset, job.Data->GetDataPtr(), size);
+		target->LoadData(job.Data, _stagingBuffer, offset);
+	}
+	_inFlight.push_back({ offset, size, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+	return false;
+}
+
+size_t TextureLoader::_Allocate(size_t size) {
+	size_t offset = (_stagingHead + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+	if (offset + size > StagingBufferSize) {
+		offset = 0;
+	}
+	const size_t end = offset + size;
+
+	// Ranges are handed out in order around the ring, so the ones we overlap are always the oldest. Fences
+	// signal in order as well, so we only need to wait on the newest one that we overlap
+	int lastOverlap = -1;
+	for (size_t ix = 0; ix < _inFlight.size(); ix++) {
+		const InFlight& range = _inFlight[ix];
+		if (range.Offset < end && offset < range.Offset + range.Size) {
+			lastOverlap = static_cast<int>(ix);
+		}
+	}
+	if (lastOverlap != -1) {
+		GLenum result = glClientWaitSync(_inFlight[lastOverlap].Fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+		if (result == GL_WAIT_FAILED) {
+			LOG_WARN("Failed to wait on a texture upload, the staging buffer may be overwritten early");
+		}
+		for (int ix = 0; ix <= lastOverlap; ix++) {
+			glDeleteSync(_inFlight.front().Fence);
+			_inFlight.pop_front();
+		}
+	}
+
+	// Clean up any other uploads that have already finished, so the list doesn't keep growing
+	while (!_inFlight.empty() && glClientWaitSync(_inFlight.front().Fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+		glDeleteSync(_inFlight.front().Fence);
+		_inFlight.pop_front();
+	}
+
+	_stagingHead = end;
+	return offset;
+}
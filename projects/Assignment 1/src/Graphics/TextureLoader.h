@@ -0,0 +1,167 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <glad/glad.h>
+
+#include "CompressedTextureData.h"
+#include "Texture2D.h"
+#include "Texture2DArray.h"
+#include "Texture2DData.h"
+#include "MipChainData.h"
+#include "Utilities/ThreadPool.h"
+
+/// <summary>
+/// Loads textures in the background. The ThreadPool decodes the image files, and the main thread uploads the results
+/// through a persistently mapped pixel buffer in Update, so we never block on stb_image or on the driver copying our
+/// pixels. Images that have been cooked (see TextureCook) load their mip chain from the sidecar instead of decoding
+///
+/// Textures whose description is marked Compressible are block compressed by the worker once they're decoded, or load
+/// the compressed copy that TextureCompressor cached next to the image last time. Those are uploaded directly rather
+/// than through the staging buffer or UploadContext, since their storage has to be recreated in the new format
+///
+/// When UploadContext is running, whole images are uploaded on it's thread instead, into a new texture object that the
+/// target adopts once the GPU is done with it (see Texture2D::Adopt). Layers of array textures are written into a
+/// texture that's already being drawn with, so those stay on the staging buffer
+///
+/// LoadAsync hands back a texture straight away, it has the right size but is cleared to white until the image has
+/// been uploaded. Since the texture object stays the same, materials (and bindless handles) never need to be updated
+/// </summary>
+class TextureLoader final
+{
+public:
+	/// <summary>
+	/// The size of the pixel buffer we stage uploads through, in bytes. Images that don't fit are uploaded directly
+	/// from the decoded data instead. Must be set before the first upload
+	/// </summary>
+	static size_t StagingBufferSize;
+	/// <summary>
+	/// The most bytes we will upload in a single call to Update, so a batch of images finishing at the same time
+	/// doesn't cause a hitch. At least one image is always uploaded per Update
+	/// </summary>
+	static size_t UploadBudget;
+	/// <summary>
+	/// The largest side of the placeholders made by LoadOnDemand, in pixels
+	/// </summary>
+	static uint32_t PlaceholderSize;
+
+	/// <summary>
+	/// Releases the staging buffer, should be called after the ThreadPool has been shut down. Any loads that have not
+	/// finished are dropped
+	/// </summary>
+	static void Shutdown();
+
+	/// <summary>
+	/// Starts loading an image in the background
+	/// </summary>
+	/// <param name="path">The path to load the image from</param>
+	/// <param name="description">The sampling settings for the texture, the size and format come from the file</param>
+	/// <returns>A texture that will be filled in once the image is loaded</returns>
+	static Texture2D::sptr LoadAsync(const std::string& path, Texture2DDescription description = Texture2DDescription());
+	/// <summary>
+	/// Creates a small white placeholder for an image without loading it. The placeholder looks like a texture that
+	/// TextureResidency has shrunk, so the image gets loaded the first time something draws with it (or is about to,
+	/// see ShaderMaterial::UseTextures). Until then only the header has been read, so images that are never seen
+	/// cost next to nothing. Images without mip maps have no smaller level to stand in with, and load with LoadAsync
+	/// </summary>
+	/// <param name="path">The path to load the image from</param>
+	/// <param name="description">The sampling settings for the texture, the size and format come from the file</param>
+	/// <returns>A texture that will be filled in once it's needed and the image is loaded</returns>
+	static Texture2D::sptr LoadOnDemand(const std::string& path, Texture2DDescription description = Texture2DDescription());
+	/// <summary>
+	/// Starts decoding an image before anything has asked for it, so it can get going before there's an OpenGL
+	/// context to make textures with (ex: while the window is being created). The next LoadAsync or LoadLayerAsync
+	/// of the same path picks up the decoded image instead of decoding it again. Must be called on the main thread
+	/// </summary>
+	/// <param name="path">The path to load the image from</param>
+	static void Prefetch(const std::string& path);
+	/// <summary>
+	/// Starts loading a texture's image again from it's source path, ex: to restore it after TextureResidency shrinks it.
+	/// The texture keeps what it has until the new image is uploaded
+	/// </summary>
+	/// <param name="target">The texture to reload, must have a source path</param>
+	static void ReloadAsync(const Texture2D::sptr& target);
+	/// <summary>
+	/// Starts loading an image into a layer of an array texture in the background, the image is resized to fit the
+	/// array if it's a different size
+	/// </summary>
+	/// <param name="path">The path to load the image from</param>
+	/// <param name="target">The array texture to load the image into</param>
+	/// <param name="layer">The layer of the array to load the image into</param>
+	static void LoadLayerAsync(const std::string& path, const Texture2DArray::sptr& target, uint32_t layer);
+
+	/// <summary>
+	/// Uploads the images that the workers have finished decoding, should be called once per frame on the main thread
+	/// </summary>
+	static void Update();
+	/// <summary>
+	/// Blocks until every image that has been requested so far is uploaded
+	/// </summary>
+	static void WaitAll();
+
+	/// <summary>
+	/// Gets the number of images that have been requested but not uploaded yet
+	/// </summary>
+	static uint32_t GetPendingCount();
+
+protected:
+	TextureLoader() = default;
+
+	struct Job {
+		std::string                   Path;
+		std::weak_ptr<Texture2D>      Target;
+		// Set instead of Target when loading into a layer of an array texture
+		std::weak_ptr<Texture2DArray> ArrayTarget;
+		uint32_t                      Layer = 0;
+		Texture2DData::sptr           Data;
+		// Set instead of Data when the image had a cooked mip chain
+		MipChainData::sptr            Mips;
+		// Whether the worker should block compress the image, and the result if it did
+		bool                          Compressible = false;
+		CompressedTextureData::sptr   Compressed;
+	};
+	// A range of the staging buffer that the GPU may still be reading from
+	struct InFlight {
+		size_t Offset;
+		size_t Size;
+		GLsync Fence;
+	};
+
+	// An image decoded by Prefetch
+	struct Decoded {
+		Texture2DData::sptr Data;
+		MipChainData::sptr  Mips;
+	};
+
+	// Decodes an image on a worker thread, and hands it off to be uploaded
+	static void _Decode(Job job);
+	// Block compresses a decoded job's image (caching the result), dropping the decoded pixels if that worked
+	static void _Compress(Job& job);
+	// Loads an image's cooked mip chain, or decodes it if it hasn't been cooked
+	static Decoded _DecodeFile(const std::string& path);
+	// Takes the prefetched decode of a path if there is one, returns an invalid task if not
+	static Task<Decoded> _TakePrefetched(const std::string& path);
+	// Hands a job that a worker has finished off to the main thread to be uploaded
+	static void _Finish(Job&& job);
+	// Uploads a single decoded image or mip chain, staging it through our pixel buffer if it fits. Returns true if it
+	// was handed to the UploadContext instead, which counts it as done once the target has adopted it
+	static bool _Upload(const Job& job);
+	// Finds room in the staging buffer, waiting on the GPU if it's still using that range
+	static size_t _Allocate(size_t size);
+
+	static std::mutex               _mutex;
+	static std::condition_variable  _jobDone;
+	static std::deque<Job>          _completed;
+	static uint32_t                 _pending;
+	// Only touched on the main thread
+	static std::unordered_map<std::string, Task<Decoded>> _prefetched;
+
+	static GLuint                   _stagingBuffer;
+	static uint8_t*                 _stagingData;
+	static size_t                   _stagingHead;
+	static std::deque<InFlight>     _inFlight;
+};
@@ -0,0 +1,115 @@
+#include "TextureResidency.h"
+
+#include <algorithm>
+
+#include "TextureLoader.h"
+#include "Utilities/FrameArena.h"
+
+size_t   TextureResidency::Budget     = 512 * 1024 * 1024;
+uint32_t TextureResidency::MinSize    = 64;
+uint32_t TextureResidency::IdleFrames = 120;
+
+std::vector<TextureResidency::Entry> TextureResidency::_entries;
+uint64_t                             TextureResidency::_frame = 1;
+TextureResidency::Stats              TextureResidency::_stats = TextureResidency::Stats();
+
+void TextureResidency::Register(const Texture2D::sptr& texture, bool isUsed) {
+	LOG_ASSERT(!texture->GetSourcePath().empty(), "Only textures loaded from files can be managed, since we need to be able to load them again");
+	if (isUsed) {
+		texture->MarkUsed();
+	}
+	_entries.push_back({ texture, false });
+}
+
+bool TextureResidency::_CanShrink(const Texture2D::sptr& texture) {
+	return texture->GetLevelCount() > 1 && !texture->HasBindlessHandle() &&
+		std::max(texture->GetWidth(), texture->GetHeight()) / 2 >= MinSize;
+}
+
+void TextureResidency::Update() {
+	// Drop any textures that have been released, and catch up on the ones that have finished loading again
+	FrameVector<Texture2D::sptr> textures;
+	textures.reserve(_entries.size());
+	size_t live = 0;
+	for (Entry& entry : _entries) {
+		Texture2D::sptr texture = entry.Texture.lock();
+		if (texture == nullptr) {
+			continue;
+		}
+		if (entry.IsRestoring && texture->GetDroppedLevels() == 0) {
+			entry.IsRestoring = false;
+		}
+		_entries[live++] = entry;
+		textures.push_back(texture);
+	}
+	_entries.resize(live);
+
+	size_t total = ITexture::GetTotalMemory();
+	if (total > Budget) {
+		// Least recently used first, so we always give up the textures we're least likely to need
+		FrameVector<size_t> order(textures.size());
+		for (size_t ix = 0; ix < order.size(); ix++) {
+			order[ix] = ix;
+		}
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return textures[a]->GetLastUsedFrame() < textures[b]->GetLastUsedFrame();
+		});
+
+		// Idle textures can go all the way down, since nothing is going to notice
+		for (size_t ix : order) {
+			const Texture2D::sptr& texture = textures[ix];
+			if (total <= Budget || texture->GetLastUsedFrame() + IdleFrames > _frame) {
+				break;
+			}
+			while (total > Budget && !_entries[ix].IsRestoring && _CanShrink(texture)) {
+				const size_t size = texture->GetMemorySize();
+				if (!texture->DropLevels(1)) {
+					break;
+				}
+				total = total - size + texture->GetMemorySize();
+			}
+		}
+		// Everything left is in use, so we only take one level from each per frame, and let the budget catch up
+		for (size_t ix : order) {
+			const Texture2D::sptr& texture = textures[ix];
+			if (total <= Budget) {
+				break;
+			}
+			if (!_entries[ix].IsRestoring && _CanShrink(texture)) {
+				const size_t size = texture->GetMemorySize();
+				if (texture->DropLevels(1)) {
+					total = total - size + texture->GetMemorySize();
+				}
+			}
+		}
+	}
+
+	// Bring back anything that has been used since it was shrunk, as long as it fits. We count the full size against
+	// the budget straight away, so we don't start more loads than we have room for
+	for (size_t ix = 0; ix < textures.size(); ix++) {
+		const Texture2D::sptr& texture = textures[ix];
+		Entry& entry = _entries[ix];
+		if (entry.IsRestoring || texture->GetDroppedLevels() == 0 || texture->GetLastUsedFrame() + 1 < _frame) {
+			continue;
+		}
+		const size_t restored = total - texture->GetMemorySize() + texture->GetFullMemorySize();
+		if (restored <= Budget) {
+			TextureLoader::ReloadAsync(texture);
+			entry.IsRestoring = true;
+			total = restored;
+		}
+	}
+
+	_stats.TotalMemory    = ITexture::GetTotalMemory();
+	_stats.ManagedMemory  = 0;
+	_stats.ManagedCount   = static_cast<uint32_t>(textures.size());
+	_stats.ShrunkCount    = 0;
+	_stats.RestoringCount = 0;
+	for (size_t ix = 0; ix < textures.size(); ix++) {
+		_stats.ManagedMemory  += textures[ix]->GetMemorySize();
+		_stats.ShrunkCount    += textures[ix]->GetDroppedLevels() > 0 ? 1 : 0;
+		_stats.RestoringCount += _entries[ix].IsRestoring ? 1 : 0;
+	}
+
+	_frame++;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Texture2D.h"
+
+/// <summary>
+/// Keeps our textures within a GPU memory budget. Every texture's storage is counted (see ITexture::GetMemorySize),
+/// and when we go over the budget the textures that were loaded from files get shrunk, by dropping the largest
+/// levels of their mip chains:
+///  - Textures that haven't been used for a while are shrunk first, oldest first, all the way down to MinSize
+///  - If that isn't enough, textures that are still in use lose one level at a time, least recently used first
+///
+/// Shrunk textures keep their smaller levels so they can still be drawn. Once one is used again and there is room
+/// in the budget, it's image is streamed back in by TextureLoader. Placeholders from TextureLoader::LoadOnDemand
+/// start out looking shrunk, so they get their images the same way the first time they're used
+/// </summary>
+class TextureResidency final
+{
+public:
+	/// <summary>
+	/// The most GPU memory we want our textures to use, in bytes
+	/// </summary>
+	static size_t   Budget;
+	/// <summary>
+	/// The smallest we will shrink a texture down to, in pixels along it's largest side
+	/// </summary>
+	static uint32_t MinSize;
+	/// <summary>
+	/// The number of frames a texture needs to go unused before it counts as idle
+	/// </summary>
+	static uint32_t IdleFrames;
+
+	struct Stats {
+		// The memory used by all textures, including the ones we don't manage
+		size_t   TotalMemory;
+		// The memory used by the textures we can shrink
+		size_t   ManagedMemory;
+		uint32_t ManagedCount;
+		uint32_t ShrunkCount;
+		uint32_t RestoringCount;
+	};
+
+	/// <summary>
+	/// Starts managing a texture, it must have a source path so it can be loaded again after being shrunk
+	/// </summary>
+	/// <param name="texture">The texture to manage</param>
+	/// <param name="isUsed">Whether the texture counts as used straight away. Placeholders that should only load once
+	/// something draws with them (see TextureLoader::LoadOnDemand) pass false</param>
+	static void Register(const Texture2D::sptr& texture, bool isUsed = true);
+
+	/// <summary>
+	/// Shrinks or restores textures to keep us within our budget, should be called once per frame on the main thread
+	/// after TextureLoader::Update. This also moves us on to the next frame
+	/// </summary>
+	static void Update();
+
+	/// <summary>
+	/// Gets the index of the current frame, used to track when each texture was last used
+	/// </summary>
+	static uint64_t GetFrame() { return _frame; }
+	/// <summary>
+	/// Gets the totals as of the last Update
+	/// </summary>
+	static const Stats& GetStats() { return _stats; }
+
+protected:
+	TextureResidency() = default;
+
+	struct Entry {
+		std::weak_ptr<Texture2D> Texture;
+		// True if we've asked TextureLoader to load the full image again, and it hasn't been uploaded yet
+		bool                     IsRestoring;
+	};
+
+	// Returns true if the texture could lose another level without going under MinSize
+	static bool _CanShrink(const Texture2D::sptr& texture);
+
+	static std::vector<Entry> _entries;
+	static uint64_t           _frame;
+	static Stats              _stats;
+};
@@ -0,0 +1,107 @@
+#include "UiCache.h"
+
+#include <algorithm>
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderState.h"
+#include "RenderStats.h"
+
+UiCache::UiCache() :
+	_framebuffer(0),
+	_texture(0),
+	_emptyVao(0),
+	_width(0),
+	_height(0),
+	_previousFramebuffer(0)
+{
+	GPU_RESOURCE_OWNER("UiCache");
+	_shader = Shader::Create();
+	_shader->LoadShaderPartFromFile("shaders/fullscreen.vert.glsl", GL_VERTEX_SHADER);
+	_shader->LoadShaderPartFromFile("shaders/ui_composite.frag.glsl", GL_FRAGMENT_SHADER);
+	_shader->Link();
+	glCreateFramebuffers(1, &_framebuffer);
+	glCreateVertexArrays(1, &_emptyVao);
+}
+
+UiCache::~UiCache() {
+	_DeleteTarget();
+	glDeleteFramebuffers(1, &_framebuffer);
+	RenderState::OnVertexArrayDeleted(_emptyVao);
+	glDeleteVertexArrays(1, &_emptyVao);
+}
+
+void UiCache::_DeleteTarget() {
+	if (_texture != 0) {
+		RenderState::OnTextureDeleted(_texture);
+		GpuResources::RemoveRaw(GL_TEXTURE, _texture);
+		glDeleteTextures(1, &_texture);
+		_texture = 0;
+	}
+	_width = _height = 0;
+}
+
+void UiCache::Begin(int width, int height) {
+	if (width != _width || height != _height) {
+		GPU_RESOURCE_OWNER("UiCache");
+		_DeleteTarget();
+		_width = width;
+		_height = height;
+		glCreateTextures(GL_TEXTURE_2D, 1, &_texture);
+		glTextureStorage2D(_texture, 1, GL_RGBA8, std::max(width, 1), std::max(height, 1));
+		GpuResources::AddRaw(GL_TEXTURE, _texture, static_cast<size_t>(std::max(width, 1)) * std::max(height, 1) * 4, "UI Cache");
+		glNamedFramebufferTexture(_framebuffer, GL_COLOR_ATTACHMENT0, _texture, 0);
+		if (glCheckNamedFramebufferStatus(_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR("UI cache target is incomplete at {}x{}", width, height);
+		}
+	}
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_previousFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glClearNamedFramebufferfv(_framebuffer, GL_COLOR, 0, clearColor);
+}
+
+void UiCache::End() {
+	glBindFramebuffer(GL_FRAMEBUFFER, _previousFramebuffer);
+}
+
+void UiCache::Composite() {
+	if (_texture == 0) {
+		return;
+	}
+	// ImGui sets the state up itself without going through our tracker, so it can't be trusted to skip anything. Same
+	// as ImGui, we put back everything we change, so drawing from the cache leaves the same state as drawing the UI
+	RenderState::Invalidate();
+	const bool wasDepthTested = glIsEnabled(GL_DEPTH_TEST);
+	const bool wasCulled = glIsEnabled(GL_CULL_FACE);
+	const bool wasBlended = glIsEnabled(GL_BLEND);
+	const bool wasScissored = glIsEnabled(GL_SCISSOR_TEST);
+	GLint blendSource = GL_ONE, blendDestination = GL_ZERO;
+	glGetIntegerv(GL_BLEND_SRC_RGB, &blendSource);
+	glGetIntegerv(GL_BLEND_DST_RGB, &blendDestination);
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	_shader->Bind();
+	RenderState::BindTextureUnit(0, _texture);
+	RenderState::BindSampler(0, 0);
+	RenderState::SetEnabled(GL_DEPTH_TEST, false);
+	RenderState::SetEnabled(GL_CULL_FACE, false);
+	RenderState::SetEnabled(GL_BLEND, true);
+	RenderState::SetBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_SCISSOR_TEST);
+	glViewport(0, 0, _width, _height);
+	RenderState::BindVertexArray(_emptyVao);
+	RenderStats::CountDraw(3);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	RenderState::SetEnabled(GL_DEPTH_TEST, wasDepthTested);
+	RenderState::SetEnabled(GL_CULL_FACE, wasCulled);
+	RenderState::SetEnabled(GL_BLEND, wasBlended);
+	RenderState::SetBlendFunc(blendSource, blendDestination);
+	if (wasScissored) {
+		glEnable(GL_SCISSOR_TEST);
+	}
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
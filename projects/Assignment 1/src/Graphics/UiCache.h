@@ -0,0 +1,64 @@
+#pragma once
+#include <memory>
+#include <glad/glad.h>
+
+#include "Shader.h"
+
+/// <summary>
+/// Holds on to the last UI that was drawn, so frames where nothing on it has changed can lay the old one over the
+/// screen with a single full screen triangle instead of building and drawing the whole UI again
+///
+/// The UI gets drawn over a transparent RGBA8 target, which leaves it's colors multiplied by their alpha. The alpha
+/// itself comes out a little low where translucent widgets overlap (ImGui blends alpha the same way it does colors),
+/// which lets slightly more of the scene show through those spots than drawing straight to the screen would
+///
+/// Usage: when the UI needs redrawing, Begin, draw it, then End. Either way, Composite each frame after the scene
+/// </summary>
+class UiCache final
+{
+public:
+	typedef std::shared_ptr<UiCache> sptr;
+	static inline sptr Create() {
+		return std::make_shared<UiCache>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	UiCache(const UiCache& other) = delete;
+	UiCache(UiCache&& other) = delete;
+	UiCache& operator=(const UiCache& other) = delete;
+	UiCache& operator=(UiCache&& other) = delete;
+
+public:
+	UiCache();
+	~UiCache();
+
+	/// <summary>
+	/// Starts drawing a new UI into the cache, resizing it if the screen changed size
+	/// </summary>
+	/// <param name="width">The width of the screen, in pixels</param>
+	/// <param name="height">The height of the screen, in pixels</param>
+	void Begin(int width, int height);
+	/// <summary>
+	/// Finishes drawing the UI, and goes back to the framebuffer that was bound before Begin
+	/// </summary>
+	void End();
+	/// <summary>
+	/// Lays the cached UI over whatever is bound, does nothing if there's nothing cached
+	/// </summary>
+	void Composite();
+
+	/// <summary>
+	/// Returns true if there's a UI cached at the given screen size
+	/// </summary>
+	bool IsValid(int width, int height) const { return _texture != 0 && width == _width && height == _height; }
+
+protected:
+	Shader::sptr _shader;
+	GLuint       _framebuffer;
+	GLuint       _texture;
+	// The pass has no vertices, but drawing still needs a vertex array bound
+	GLuint       _emptyVao;
+	int          _width, _height;
+	GLint        _previousFramebuffer;
+
+	void _DeleteTarget();
+};
@@ -0,0 +1,241 @@
+#pragma once
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+// These are the uniform block binding points that we reserve for engine level data. Shaders should declare
+// their blocks with a matching layout(std140, binding = n)
+#define FRAME_DATA_BINDING 0
+
+// The shader storage binding point for the shared material buffer (see MaterialBuffer). Shaders that read their
+// material values from it declare:
+//
+// layout(std430, binding = 1) readonly buffer b_MaterialData {
+//     MaterialData u_Materials[];
+// };
+//
+// Where MaterialData is a struct whose members are named after the uniforms they replace
+#define MATERIAL_DATA_BINDING 1
+
+// The uniform block binding point for the cluster grid's layout (see ClusterData), and the shader storage binding
+// points for the lights and the lists of lights in each cluster (see ClusteredLighting). Storage bindings 2 to 5 are
+// used by the meshlet culling pass
+#define CLUSTER_DATA_BINDING 1
+#define LIGHT_DATA_BINDING 6
+#define CLUSTER_LIGHT_COUNT_BINDING 7
+#define CLUSTER_LIGHT_INDEX_BINDING 8
+
+// The uniform block binding point for the shadow map layout (see ShadowData), and the texture units that the shadow
+// maps are bound to. The units are at the top of the range so they stay clear of the ones our materials use
+#define SHADOW_DATA_BINDING 2
+#define SHADOW_CASCADE_UNIT 30
+#define POINT_SHADOW_UNIT 31
+// The most cascades the directional light's shadows can be split into, and the most point (or spot) lights that
+// can cast shadows at once
+#define MAX_SHADOW_CASCADES 4
+#define MAX_POINT_SHADOWS 4
+
+// The uniform block binding point for the scene level lighting settings (see SceneLighting)
+#define SCENE_LIGHTING_BINDING 3
+
+// The texture units that the G-buffer gets bound to for the deferred lighting pass (see DeferredShading), just
+// below the shadow maps
+#define GBUFFER_ALBEDO_UNIT 27
+#define GBUFFER_NORMAL_UNIT 28
+#define GBUFFER_DEPTH_UNIT 29
+
+// The texture unit the meshlet culling pass reads last frame's depth pyramid from (see DepthPyramid)
+#define DEPTH_PYRAMID_UNIT 26
+
+// The texture unit the lit shaders read the half resolution ambient occlusion from (see AmbientOcclusion)
+#define AMBIENT_OCCLUSION_UNIT 25
+
+// The image unit virtual textures write the pages they wanted to (see VirtualTexture). The compute passes use the low
+// units and leave them bound, so this stays at the top of the range a fragment shader is guaranteed
+#define VIRTUAL_FEEDBACK_IMAGE 7
+
+/// <summary>
+/// Uniforms that are shared by every shader program, and only change once per frame
+/// Must match the std140 layout of the b_FrameData block in shaders/include/frame_data.glsl:
+/// 
+/// layout(std140, binding = 0) uniform b_FrameData {
+///     mat4  u_View;
+///     mat4  u_Projection;
+///     mat4  u_ViewProjection;
+///     mat4  u_SkyboxMatrix;
+///     vec3  u_CamPos;
+///     float u_Time;
+/// };
+/// </summary>
+struct FrameData
+{
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::mat4 ViewProjection;
+	glm::mat4 SkyboxMatrix;
+	glm::vec3 CamPos;
+	float     Time;
+
+	FrameData() :
+		View(glm::mat4(1.0f)),
+		Projection(glm::mat4(1.0f)),
+		ViewProjection(glm::mat4(1.0f)),
+		SkyboxMatrix(glm::mat4(1.0f)),
+		CamPos(glm::vec3(0.0f)),
+		Time(0.0f)
+	{ }
+};
+
+static_assert(sizeof(FrameData) == 4 * 64 + 16, "FrameData must match the std140 layout of b_FrameData");
+
+/// <summary>
+/// A single light as the shaders see it, lights get gathered into an array of these each frame
+/// Must match the std430 layout of the LightData struct in shaders/include/light_data.glsl:
+///
+/// struct LightData {
+///     vec3  Position;
+///     float Range;
+///     vec3  Color;
+///     uint  Type;
+///     vec3  Direction;
+///     float CosOuterAngle;
+///     vec3  Attenuation;
+///     float CosInnerAngle;
+///     float AmbientStrength;
+///     float SpecularStrength;
+///     int   ShadowIndex;
+/// };
+/// </summary>
+struct LightData
+{
+	// The world space position of the light
+	glm::vec3 Position;
+	// How far the light reaches before it's too dim to see, lights only get binned into the clusters this touches
+	float     Range;
+	glm::vec3 Color;
+	// A LightType
+	uint32_t  Type;
+	// The world space direction a spot or directional light points in
+	glm::vec3 Direction;
+	float     CosOuterAngle;
+	// The constant, linear and quadratic attenuation factors
+	glm::vec3 Attenuation;
+	float     CosInnerAngle;
+	float     AmbientStrength;
+	float     SpecularStrength;
+	// Which of the shadow maps the light uses, or -1 if it doesn't cast shadows. Directional lights use the cascades,
+	// point and spot lights use this layer of the point shadow cube map array
+	int32_t   ShadowIndex;
+	float     Padding;
+};
+
+static_assert(sizeof(LightData) == 80, "LightData must match the std430 layout of LightData in the shaders");
+
+/// <summary>
+/// Describes how the view is split into clusters, so the shaders can find which cluster a fragment is in
+/// Must match the std140 layout of the b_ClusterData block in shaders/include/light_data.glsl:
+///
+/// layout(std140, binding = 1) uniform b_ClusterData {
+///     mat4  u_InverseProjection;
+///     uvec4 u_ClusterGrid;
+///     vec2  u_ScreenSize;
+///     float u_SliceScale;
+///     float u_SliceBias;
+///     float u_NearPlane;
+///     float u_FarPlane;
+///     uint  u_LightCount;
+///     uint  u_MaxClusterLights;
+/// };
+/// 
+/// The depth slices are spaced exponentially, a fragment's slice is log(viewDepth) * u_SliceScale + u_SliceBias
+/// </summary>
+struct ClusterData
+{
+	glm::mat4  InverseProjection;
+	// The number of clusters along X, Y and Z (the W component is unused)
+	glm::uvec4 Grid;
+	glm::vec2  ScreenSize;
+	float      SliceScale;
+	float      SliceBias;
+	float      NearPlane;
+	float      FarPlane;
+	uint32_t   LightCount;
+	uint32_t   MaxClusterLights;
+
+	ClusterData() :
+		InverseProjection(glm::mat4(1.0f)),
+		Grid(glm::uvec4(1u)),
+		ScreenSize(glm::vec2(1.0f)),
+		SliceScale(0.0f),
+		SliceBias(0.0f),
+		NearPlane(0.1f),
+		FarPlane(1.0f),
+		LightCount(0),
+		MaxClusterLights(0)
+	{ }
+};
+
+static_assert(sizeof(ClusterData) == 64 + 16 + 32, "ClusterData must match the std140 layout of b_ClusterData");
+
+/// <summary>
+/// Describes where the shadow maps are, so the lit shaders can look up whether a fragment is shadowed
+/// Must match the std140 layout of the b_ShadowData block in shaders/include/lighting.glsl:
+///
+/// layout(std140, binding = 2) uniform b_ShadowData {
+///     mat4  u_CascadeViewProjection[MAX_SHADOW_CASCADES];
+///     vec4  u_CascadeSplits;
+///     uint  u_CascadeCount;
+///     float u_ShadowDepthBias;
+///     float u_ShadowNormalBias;
+/// };
+/// </summary>
+struct ShadowData
+{
+	// Takes world space into the clip space of each cascade
+	glm::mat4 CascadeViewProjection[MAX_SHADOW_CASCADES];
+	// The view depth where each cascade ends
+	glm::vec4 CascadeSplits;
+	uint32_t  CascadeCount;
+	// Subtracted from the depth a fragment gets compared with, so surfaces don't shadow themselves
+	float     DepthBias;
+	// How far fragments get pushed along their normals before looking up their shadows, in world units
+	float     NormalBias;
+	float     Padding;
+
+	ShadowData() :
+		CascadeSplits(glm::vec4(0.0f)),
+		CascadeCount(0),
+		DepthBias(0.0f),
+		NormalBias(0.0f),
+		Padding(0.0f)
+	{
+		for (int ix = 0; ix < MAX_SHADOW_CASCADES; ix++) {
+			CascadeViewProjection[ix] = glm::mat4(1.0f);
+		}
+	}
+};
+
+static_assert(sizeof(ShadowData) == MAX_SHADOW_CASCADES * 64 + 32, "ShadowData must match the std140 layout of b_ShadowData");
+
+/// <summary>
+/// The lighting settings that belong to the scene rather than any one light or material, these only get uploaded when
+/// they're changed
+/// Must match the std140 layout of the b_SceneLighting block in shaders/include/lighting.glsl:
+///
+/// layout(std140, binding = 3) uniform b_SceneLighting {
+///     vec3  u_AmbientCol;
+///     float u_AmbientStrength;
+/// };
+/// </summary>
+struct SceneLighting
+{
+	// The fixed ambient light that gets added everywhere, on top of what the lights contribute
+	glm::vec3 AmbientColor;
+	float     AmbientStrength;
+
+	SceneLighting() :
+		AmbientColor(glm::vec3(1.0f)),
+		AmbientStrength(0.1f)
+	{ }
+};
+
+static_assert(sizeof(SceneLighting) == 16, "SceneLighting must match the std140 layout of b_SceneLighting");
@@ -0,0 +1,61 @@
+#pragma once
+#include "IBuffer.h"
+#include <memory>
+
+/// <summary>
+/// A uniform buffer stores a single std140 structure that can be shared between many shader programs by
+/// binding it to a fixed uniform block binding point
+/// </summary>
+/// <typeparam name="T">The structure to store, must match the std140 layout of the block in GLSL</typeparam>
+template <typename T>
+class UniformBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<UniformBuffer<T>> sptr;
+	static inline sptr Create(GLenum usage = GL_DYNAMIC_DRAW) {
+		return std::make_shared<UniformBuffer<T>>(usage);
+	}
+
+public:
+	/// <summary>
+	/// Creates a new uniform buffer, with the given usage, and allocates storage for a single T
+	/// </summary>
+	/// <param name="usage">The usage hint for the buffer, default is GL_DYNAMIC_DRAW</param>
+	UniformBuffer(GLenum usage = GL_DYNAMIC_DRAW) :
+		IBuffer(GL_UNIFORM_BUFFER, usage), _data(T()) {
+		IBuffer::LoadData(&_data, sizeof(T), 1);
+	}
+
+	/// <summary>
+	/// Gets the CPU side copy of the data, call Update to send any changes to the GPU
+	/// </summary>
+	T& GetData() { return _data; }
+	/// <summary>
+	/// Gets a readonly copy of the CPU side data
+	/// </summary>
+	const T& GetData() const { return _data; }
+
+	/// <summary>
+	/// Uploads the CPU side copy of the data to the GPU
+	/// </summary>
+	void Update() {
+		UpdateSubData(0, &_data, 1);
+	}
+
+	/// <summary>
+	/// Binds this buffer to the given uniform block binding point
+	/// </summary>
+	/// <param name="slot">The binding point to attach the buffer to (matches layout(binding = n) in GLSL)</param>
+	void Bind(GLuint slot) {
+		MarkUsed();
+		glBindBufferBase(GL_UNIFORM_BUFFER, slot, _handle);
+	}
+
+	/// <summary>
+	/// Unbinds the uniform buffer bound to the given binding point
+	/// </summary>
+	static void UnBind(GLuint slot) { glBindBufferBase(GL_UNIFORM_BUFFER, slot, 0); }
+
+protected:
+	T _data;
+};
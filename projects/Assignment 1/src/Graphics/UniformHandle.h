@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <entt.hpp>
+
+/// <summary>
+/// Identifies a uniform by a hash of it's name that is computed at compile time, so that setting it does not
+/// need to build or hash a string. Shaders resolve the hashes of all their active uniforms when they are linked
+///
+/// Create one from a hashed string literal, ex: shader->SetUniform("u_LightPos"_hs, lightPos);
+/// </summary>
+struct UniformHandle
+{
+	/// <summary>
+	/// The FNV-1a hash of the uniform's name, matches entt::hashed_string
+	/// </summary>
+	uint32_t    Hash;
+	/// <summary>
+	/// The name of the uniform, only used for debugging
+	/// </summary>
+	const char* Name;
+
+	constexpr UniformHandle(const entt::hashed_string& name) : Hash(name.value()), Name(name.data()) {}
+
+	constexpr bool operator==(const UniformHandle& other) const { return Hash == other.Hash; }
+	constexpr bool operator!=(const UniformHandle& other) const { return Hash != other.Hash; }
+};
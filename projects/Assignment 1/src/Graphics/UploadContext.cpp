@@ -0,0 +1,121 @@
+#include "UploadContext.h"
+
+#include <GLFW/glfw3.h>
+
+#include "Logging.h"
+#include "Sys.h"
+#include "Utilities/CpuProfiler.h"
+
+GLFWwindow*             UploadContext::_window = nullptr;
+std::thread             UploadContext::_thread;
+std::mutex              UploadContext::_mutex;
+std::condition_variable UploadContext::_jobReady;
+std::deque<UploadContext::Job> UploadContext::_queued;
+std::deque<UploadContext::Job> UploadContext::_issued;
+bool                    UploadContext::_isRunning = false;
+
+bool UploadContext::Init(GLFWwindow* shared) {
+	if (_window != nullptr) {
+		return true;
+	}
+	// The context only needs a window to belong to, it never gets drawn to or shown
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	_window = glfwCreateWindow(1, 1, "Uploads", nullptr, shared);
+	if (_window == nullptr) {
+		LOG_WARN("Failed to create a shared context for uploads, they'll run on the main thread");
+		return false;
+	}
+	_isRunning = true;
+	_thread = std::thread(_ThreadMain);
+	return true;
+}
+
+void UploadContext::Shutdown() {
+	if (_window == nullptr) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_isRunning = false;
+		_queued.clear();
+	}
+	_jobReady.notify_all();
+	_thread.join();
+
+	// Whatever made it to the GPU gets handed over, so the callbacks can clean up after themselves
+	while (!_issued.empty()) {
+		Job job = std::move(_issued.front());
+		_issued.pop_front();
+		glClientWaitSync(job.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+		glDeleteSync(job.Fence);
+		job.Finish();
+	}
+	glfwDestroyWindow(_window);
+	_window = nullptr;
+}
+
+void UploadContext::Submit(std::function<void()> upload, std::function<void()> finish) {
+	if (_window == nullptr) {
+		upload();
+		finish();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		Job job;
+		job.Upload = std::move(upload);
+		job.Finish = std::move(finish);
+		_queued.push_back(std::move(job));
+	}
+	_jobReady.notify_one();
+}
+
+void UploadContext::Update() {
+	while (true) {
+		Job job;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			// Fences from the one context signal in order, so once one hasn't the rest won't have either
+			if (_issued.empty() || glClientWaitSync(_issued.front().Fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+				break;
+			}
+			job = std::move(_issued.front());
+			_issued.pop_front();
+		}
+		glDeleteSync(job.Fence);
+		job.Finish();
+	}
+}
+
+uint32_t UploadContext::GetPendingCount() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return static_cast<uint32_t>(_queued.size() + _issued.size());
+}
+
+void UploadContext::_ThreadMain() {
+	glfwMakeContextCurrent(_window);
+	SystemMonitor::RegisterThread("Uploads");
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_jobReady.wait(lock, []() { return !_queued.empty() || !_isRunning; });
+			if (!_isRunning) {
+				break;
+			}
+			job = std::move(_queued.front());
+			_queued.pop_front();
+		}
+		{
+			PROFILE_SCOPE("Upload");
+			job.Upload();
+		}
+		job.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		// The fence only gets to the GPU once the commands before it are flushed, or the main thread could wait forever
+		glFlush();
+		std::lock_guard<std::mutex> lock(_mutex);
+		_issued.push_back(std::move(job));
+	}
+	glfwMakeContextCurrent(nullptr);
+	SystemMonitor::UnregisterThread();
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <glad/glad.h>
+
+struct GLFWwindow;
+
+/// <summary>
+/// A second OpenGL context that shares it's objects with the main window's, current on a thread of it's own so
+/// streamed assets can be created and filled without the main thread issuing the uploads. Textures and buffers made
+/// here can be used by the main context, but vertex arrays and framebuffers aren't shared between contexts, so those
+/// still need making on the main thread
+///
+/// Each upload gets a fence once it has been issued, and it's finish callback runs on the main thread (in Update)
+/// once that fence has signalled, which is when whatever it made is safe to draw with. Anything handed over should be
+/// a new object rather than one the main thread is already drawing with, so nothing is ever read and written from
+/// both contexts at once
+///
+/// If the context couldn't be made (or Init was never called), Submit runs both halves on the main thread right away,
+/// so callers don't need a second path
+/// </summary>
+class UploadContext final
+{
+public:
+	/// <summary>
+	/// Creates the hidden window that holds the upload context, and starts the thread that uploads through it. Must
+	/// be called on the main thread, after the main window's context has been made current and loaded
+	/// </summary>
+	/// <param name="shared">The window whose context the upload context shares objects with</param>
+	/// <returns>True if the context was made, if not uploads run on the main thread</returns>
+	static bool Init(GLFWwindow* shared);
+	/// <summary>
+	/// Stops the upload thread and destroys it's context, should be called before the main window is destroyed. Any
+	/// uploads that have been issued get finished, the ones still waiting to start are dropped
+	/// </summary>
+	static void Shutdown();
+	/// <summary>
+	/// Returns true if uploads are running on the upload thread
+	/// </summary>
+	static bool IsAvailable() { return _window != nullptr; }
+
+	/// <summary>
+	/// Queues an upload to run on the upload thread
+	/// </summary>
+	/// <param name="upload">Issues the OpenGL calls for the upload, runs with the upload context current</param>
+	/// <param name="finish">Runs on the main thread once the upload has finished on the GPU</param>
+	static void Submit(std::function<void()> upload, std::function<void()> finish);
+	/// <summary>
+	/// Runs the finish callbacks of the uploads the GPU is done with, should be called once a frame on the main thread
+	/// </summary>
+	static void Update();
+	/// <summary>
+	/// Gets the number of uploads that have been submitted but haven't finished yet
+	/// </summary>
+	static uint32_t GetPendingCount();
+
+protected:
+	UploadContext() = default;
+
+	struct Job {
+		std::function<void()> Upload;
+		std::function<void()> Finish;
+		// Signals once the upload's commands have finished, set by the upload thread
+		GLsync                Fence = nullptr;
+	};
+
+	static void _ThreadMain();
+
+	static GLFWwindow*             _window;
+	static std::thread             _thread;
+	static std::mutex              _mutex;
+	static std::condition_variable _jobReady;
+	// Waiting for the upload thread to get to them
+	static std::deque<Job>         _queued;
+	// Issued by the upload thread, in the order their fences will signal
+	static std::deque<Job>         _issued;
+	static bool                    _isRunning;
+};
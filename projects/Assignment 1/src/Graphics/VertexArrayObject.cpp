@@ -1,34 +1,39 @@
 #include "VertexArrayObject.h"
+
+#include <atomic>
+#include <string>
+
 #include "IndexBuffer.h"
 #include "Logging.h"
+#include "MeshArena.h"
+#include "RenderState.h"
+#include "RenderStats.h"
 #include "VertexBuffer.h"
 
+// Hands out the mesh IDs, since the VAO handles are shared between meshes
+static std::atomic<uint32_t> NextId(1);
+
 VertexArrayObject::VertexArrayObject() :
 	_indexBuffer(nullptr),
-	_handle(0),
-	_vertexCount(0)
-{
-	glCreateVertexArrays(1, &_handle);
-}
+	_vertexCount(0),
+	_layout(nullptr),
+	_id(NextId++)
+{ }
 
-VertexArrayObject::~VertexArrayObject()
-{
-	if (_handle != 0) {
-		glDeleteVertexArrays(1, &_handle);
-		_handle = 0;
-	}
-}
+VertexArrayObject::~VertexArrayObject() = default;
 
 void VertexArrayObject::SetDebugName(const std::string& name) {
-	glObjectLabel(GL_VERTEX_ARRAY, _handle, name.length(), name.c_str());
+	for (size_t ix = 0; ix < _vertexBuffers.size(); ix++) {
+		_vertexBuffers[ix].Buffer->SetDebugName(name + " VBO " + std::to_string(ix));
+	}
+	if (_indexBuffer != nullptr) {
+		_indexBuffer->SetDebugName(name + " EBO");
+	}
 }
 
 void VertexArrayObject::SetIndexBuffer(const IndexBuffer::sptr& ibo) {
+	// Gets attached to the layout when we're bound
 	_indexBuffer = ibo;
-	Bind();
-	if (_indexBuffer != nullptr) _indexBuffer->Bind();
-	else IndexBuffer::UnBind();
-	UnBind();
 }
 
 void VertexArrayObject::AddVertexBuffer(const VertexBuffer::sptr& buffer, const std::vector<BufferAttribute>& attributes)
@@ -38,35 +43,139 @@ void VertexArrayObject::AddVertexBuffer(const VertexBuffer::sptr& buffer, const
 	} else {
 		LOG_ASSERT(buffer->GetElementCount() == _vertexCount, "All buffers bound to a VAO should be of the same size in our implementation!");
 	}
+	LOG_ASSERT(_vertexBuffers.size() < VertexLayout::INSTANCE_BINDING, "Too many vertex buffers for one VAO!");
 	VertexBufferBinding binding;
 	binding.Buffer = buffer;
-	binding.Attributes = attributes;
 	_vertexBuffers.push_back(binding);
 
-	Bind();
-	buffer->Bind();
-	for (const BufferAttribute& attrib : attributes) {
-		glEnableVertexArrayAttrib(_handle, attrib.Slot);
-		glVertexAttribPointer(attrib.Slot, attrib.Size, attrib.Type, attrib.Normalized, attrib.Stride, (void*)attrib.Offset);
+	// Our declarations changed, so we move over to the layout that matches them. The ones we already had are the
+	// current layout's copies, so gathering them up doesn't allocate anything
+	const std::vector<BufferAttribute>* streams[VertexLayout::INSTANCE_BINDING];
+	for (size_t ix = 0; ix + 1 < _vertexBuffers.size(); ix++) {
+		streams[ix] = &_layout->GetStream(ix);
+	}
+	streams[_vertexBuffers.size() - 1] = &attributes;
+	_layout = VertexLayout::Get(streams, _vertexBuffers.size());
+}
+
+void VertexArrayObject::SetInstanceBuffer(const VertexBuffer::sptr& buffer, const std::vector<BufferAttribute>& attributes)
+{
+	if (_instanceBuffer.Buffer == buffer) {
+		return;
+	}
+	// Gets attached to the layout when we're bound
+	_instanceBuffer.Buffer = buffer;
+	_instanceBuffer.Attributes = &attributes;
+}
+
+void VertexArrayObject::AddLod(const uint32_t* indices, size_t indexCount, float error) {
+	sptr lod = Create();
+	for (size_t ix = 0; ix < _vertexBuffers.size(); ix++) {
+		lod->AddVertexBuffer(_vertexBuffers[ix].Buffer, _layout->GetStream(ix));
+	}
+	IndexBuffer::sptr ebo = IndexBuffer::Create();
+	ebo->LoadCompact(indices, indexCount, _vertexCount);
+	lod->SetIndexBuffer(ebo);
+	lod->SetBounds(_bounds);
+	if (_arenaSlice.Arena != nullptr) {
+		lod->SetArenaSlice(_arenaSlice.Arena->AllocateIndices(_arenaSlice, indices, indexCount));
 	}
-	UnBind();
+	_lods.push_back({ lod, error });
+}
+
+const TriangleBvh::sptr& VertexArrayObject::GetTriangleBvh() const {
+	if (_triangles == nullptr && _triangleSource) {
+		_triangles = _triangleSource();
+		// There's nothing to load from the second time around if it failed
+		if (_triangles == nullptr) {
+			LOG_WARN("Failed to load the triangles of a mesh on demand, it can only be picked by it's bounds");
+		}
+		_triangleSource = nullptr;
+	}
+	return _triangles;
+}
 
+void VertexArrayObject::ReplaceWith(VertexArrayObject& other) {
+	_indexBuffer = std::move(other._indexBuffer);
+	_vertexBuffers = std::move(other._vertexBuffers);
+	_instanceBuffer = std::move(other._instanceBuffer);
+	_arenaSlice = other._arenaSlice;
+	_bounds = other._bounds;
+	_meshlets = std::move(other._meshlets);
+	_triangles = std::move(other._triangles);
+	_triangleSource = std::move(other._triangleSource);
+	_lods = std::move(other._lods);
+	_vertexCount = other._vertexCount;
+	_layout = std::move(other._layout);
+	other._vertexCount = 0;
 }
 
 void VertexArrayObject::Bind() const {
-	glBindVertexArray(_handle);
+	LOG_ASSERT(_layout != nullptr, "Can't bind a mesh without any vertex buffers!");
+	_layout->Bind();
+	// The layout skips any buffers that are already attached, so meshes sharing buffers don't touch the VAO at all
+	for (size_t ix = 0; ix < _vertexBuffers.size(); ix++) {
+		_vertexBuffers[ix].Buffer->MarkUsed();
+		_layout->AttachVertexBuffer(static_cast<GLuint>(ix), _vertexBuffers[ix].Buffer->GetHandle());
+	}
+	if (_indexBuffer != nullptr) {
+		_indexBuffer->MarkUsed();
+	}
+	_layout->AttachIndexBuffer(_indexBuffer != nullptr ? _indexBuffer->GetHandle() : 0);
+	if (_instanceBuffer.Buffer != nullptr) {
+		_instanceBuffer.Buffer->MarkUsed();
+		_layout->SetInstanceFormat(*_instanceBuffer.Attributes);
+		_layout->AttachVertexBuffer(VertexLayout::INSTANCE_BINDING, _instanceBuffer.Buffer->GetHandle());
+	}
 }
 
 void VertexArrayObject::UnBind() {
-	glBindVertexArray(0);
+	RenderState::BindVertexArray(0);
 }
 
 void VertexArrayObject::Render() const {
+	// We leave the layout bound after drawing, so the state tracker can skip the bind if the next draw uses it as well
 	Bind();
 	if (_indexBuffer != nullptr) {
+		RenderStats::CountDraw(_indexBuffer->GetElementCount());
 		glDrawElements(GL_TRIANGLES, _indexBuffer->GetElementCount(), _indexBuffer->GetElementType(), nullptr);
 	} else {
+		RenderStats::CountDraw(_vertexCount / 3);
 		glDrawArrays(GL_TRIANGLES, 0, _vertexCount / 3);
 	}
-	UnBind();
+}
+
+void VertexArrayObject::RenderInstanced(int instanceCount, int baseInstance) const {
+	Bind();
+	if (_indexBuffer != nullptr) {
+		RenderStats::CountDraw(_indexBuffer->GetElementCount(), instanceCount);
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, _indexBuffer->GetElementCount(), _indexBuffer->GetElementType(), nullptr, instanceCount, baseInstance);
+	} else {
+		RenderStats::CountDraw(_vertexCount, instanceCount);
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, _vertexCount, instanceCount, baseInstance);
+	}
+}
+
+void VertexArrayObject::RenderIndirect(const IndirectBuffer::sptr& commands, int firstCommand, int commandCount, const DrawElementsIndirectCommand* cpuCommands) const {
+	LOG_ASSERT(_indexBuffer != nullptr, "Indirect rendering requires an index buffer!");
+	RenderStats::CountIndirectDraw();
+	if (cpuCommands != nullptr) {
+		for (int ix = firstCommand; ix < firstCommand + commandCount; ix++) {
+			RenderStats::CountGeometry(cpuCommands[ix].Count, cpuCommands[ix].InstanceCount);
+		}
+	}
+	Bind();
+	commands->Bind();
+	glMultiDrawElementsIndirect(GL_TRIANGLES, _indexBuffer->GetElementType(), 
+		(const void*)(firstCommand * sizeof(DrawElementsIndirectCommand)), commandCount, 0);
+}
+
+void VertexArrayObject::RenderIndirectCount(const IndirectBuffer::sptr& commands, int firstCommand, const IBuffer& counts, int countIndex, int maxCommands) const {
+	LOG_ASSERT(_indexBuffer != nullptr, "Indirect rendering requires an index buffer!");
+	RenderStats::CountIndirectDraw();
+	Bind();
+	commands->Bind();
+	glBindBuffer(GL_PARAMETER_BUFFER, counts.GetHandle());
+	glMultiDrawElementsIndirectCount(GL_TRIANGLES, _indexBuffer->GetElementType(),
+		(const void*)(firstCommand * sizeof(DrawElementsIndirectCommand)), (GLintptr)(countIndex * sizeof(GLuint)), maxCommands, 0);
 }
@@ -2,76 +2,50 @@
 #include <glad/glad.h>
 #include <cstdint>
 #include <vector>
+#include <functional>
 #include <memory>
 
+#include "BufferAttribute.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include "IndirectBuffer.h"
+#include "BoundingVolume.h"
+#include "MeshletBuffer.h"
+#include "VertexLayout.h"
+#include "Utilities/TriangleBvh.h"
 
-/// <summary>
-/// We'll use this just to make it more clear what the intended usage of an attribute is in our code!
-/// </summary>
-enum class AttribUsage
-{
-	Unknown = 0,
-	Position,
-	Color,
-	Color1,   //
-	Color2,   // Extras
-	Color3,   //
-	Texture,
-	Texture1, //
-	Texture2, // Extras
-	Texture3, //
-	Normal,
-	Tangent,
-	BiNormal,
-	User0,    //
-	User1,    //
-	User2,    // Extras
-	User3     //
-};
+// We can declare the name and assume it will get included later, helps avoid circular dependencies
+class MeshArena;
 
 /// <summary>
-/// This structure will represent the parameters passed to the glVertexAttribPointer commands
+/// Describes where a mesh lives inside of a MeshArena, matching the fields of a DrawElementsIndirectCommand
 /// </summary>
-struct BufferAttribute
+struct MeshArenaSlice
 {
 	/// <summary>
-	/// The input slot to the vertex shader that will receive the data
-	/// </summary>
-	GLuint  Slot;
-	/// <summary>
-	/// The number of elements to be passed (ex 3 for a vec3)
-	/// </summary>
-	GLint   Size;
-	/// <summary>
-	/// The type of data to be passed (ex: GL_FLOAT for a vec3)
+	/// The arena that the mesh was allocated from, or nullptr if the mesh is not in an arena
 	/// </summary>
-	GLenum  Type;
+	std::shared_ptr<MeshArena> Arena;
 	/// <summary>
-	/// Whether or not the data should be normalized into the 0-1 range (usually this is false)
+	/// The index of the mesh's first vertex within the arena's vertex buffer
 	/// </summary>
-	bool    Normalized;
+	GLint  BaseVertex;
 	/// <summary>
-	/// The total size of an element in this buffer
+	/// The index of the mesh's first index within the arena's index buffer
 	/// </summary>
-	GLsizei Stride;
+	GLuint FirstIndex;
 	/// <summary>
-	/// The offset from the start of an element to this attribute
+	/// The number of indices in the mesh
 	/// </summary>
-	size_t Offset;
+	GLuint IndexCount;
 
-	/// <summary>
-	/// The approximate usage for this attribute, does not get passed to OpenGL at all
-	/// </summary>
-	AttribUsage Usage;
-
-	BufferAttribute(uint32_t slot, uint32_t size, GLenum type, bool normalized, GLsizei stride, size_t offset, AttribUsage usage = AttribUsage::Unknown) :
-		Slot(slot), Size(size), Type(type), Normalized(normalized), Stride(stride), Offset(offset), Usage(usage) { }
+	MeshArenaSlice() : Arena(nullptr), BaseVertex(0), FirstIndex(0), IndexCount(0) { }
 };
 
 /// <summary>
-/// The Vertex Array Object wraps around an OpenGL VAO and basically represents all of the data for a mesh
+/// The Vertex Array Object represents all of the data for a mesh. The OpenGL VAO itself only holds the vertex format,
+/// and is shared with every other mesh that has the same vertex declarations (see VertexLayout), the mesh's buffers
+/// get attached to it when it's bound
 /// </summary>
 class VertexArrayObject final
 {
@@ -81,6 +55,19 @@ public:
 	static inline sptr Create(TArgs&&... args) {
 		return std::make_shared<VertexArrayObject>(std::forward<TArgs>(args)...);
 	}
+	/// <summary>
+	/// A simplified version of a mesh, for drawing it when it's small on screen
+	/// </summary>
+	struct Lod {
+		/// <summary>
+		/// The simplified mesh, it shares the vertex buffers of the full detail mesh
+		/// </summary>
+		sptr  Mesh;
+		/// <summary>
+		/// How far the simplified surface may be from the original, relative to the size of the mesh
+		/// </summary>
+		float Error;
+	};
 	// We'll disallow moving and copying, since we want to manually control when the destructor is called
 	// We'll use these classes via pointers
 	VertexArrayObject(const VertexArrayObject& other) = delete;
@@ -97,7 +84,8 @@ public:
 	~VertexArrayObject();
 
 	/// <summary>
-	/// Sets a debug name for this VAO, making debug messages clearer
+	/// Sets a debug name for this mesh's vertex and index buffers, making debug messages clearer. The VAO is shared, so
+	/// it doesn't get named
 	/// </summary>
 	/// <param name="name">The new name of the object</param>
 	void SetDebugName(const std::string& name);
@@ -113,9 +101,94 @@ public:
 	/// <param name="buffer">The buffer to add (note, does not take ownership, you will still need to delete later)</param>
 	/// <param name="attributes">A list of vertex attributes that will be fed by this buffer</param>
 	void AddVertexBuffer(const VertexBuffer::sptr& buffer, const std::vector<BufferAttribute>& attributes);
+	/// <summary>
+	/// Sets the per-instance buffer for this VAO. Attributes fed by this buffer advance once per instance instead of
+	/// once per vertex, and the buffer does not count towards the VAO's vertex count. Passing the same buffer again is a no-op
+	/// </summary>
+	/// <param name="buffer">The buffer holding the per-instance data (may be shared between many VAOs)</param>
+	/// <param name="attributes">A list of vertex attributes that will be fed by this buffer, must outlive the VAO (ex: a vertex type's V_DECL)</param>
+	void SetInstanceBuffer(const VertexBuffer::sptr& buffer, const std::vector<BufferAttribute>& attributes);
+	/// <summary>
+	/// Gets the per-instance buffer bound to this VAO, or nullptr if none has been set
+	/// </summary>
+	const VertexBuffer::sptr& GetInstanceBuffer() const { return _instanceBuffer.Buffer; }
+
+	/// <summary>
+	/// Sets the region of a shared MeshArena that holds a copy of this VAO's mesh
+	/// </summary>
+	/// <param name="slice">The slice returned by MeshArena::Allocate</param>
+	void SetArenaSlice(const MeshArenaSlice& slice) { _arenaSlice = slice; }
+	/// <summary>
+	/// Gets the region of a shared MeshArena that holds a copy of this VAO's mesh, the slice's arena will be nullptr if there is none
+	/// </summary>
+	const MeshArenaSlice& GetArenaSlice() const { return _arenaSlice; }
+
+	/// <summary>
+	/// Sets the clusters that this VAO's mesh has been split into, meshes with meshlets can be drawn through a
+	/// MeshletCuller so that the parts facing away or off screen get skipped on the GPU
+	/// </summary>
+	/// <param name="meshlets">The meshlets of the mesh, with index ranges relative to the start of the mesh's indices</param>
+	void SetMeshlets(const MeshletBuffer::sptr& meshlets) { _meshlets = meshlets; }
+	/// <summary>
+	/// Gets the clusters that this VAO's mesh has been split into, or nullptr if it's only drawn as a whole
+	/// </summary>
+	const MeshletBuffer::sptr& GetMeshlets() const { return _meshlets; }
+
+	/// <summary>
+	/// Sets the CPU side tree over this VAO's triangles, used for picking and collision against the actual surface
+	/// </summary>
+	/// <param name="triangles">The tree, built from the same positions and indices that were uploaded</param>
+	void SetTriangleBvh(const TriangleBvh::sptr& triangles) { _triangles = triangles; }
+	/// <summary>
+	/// Sets where to load the tree over this VAO's triangles from, for meshes that don't keep it resident (see
+	/// CpuResidency::ReloadOnDemand). It gets loaded the first time it's asked for, and kept from then on
+	/// </summary>
+	/// <param name="source">Loads the tree from the mesh's asset, called on whichever thread first asks for it</param>
+	void SetTriangleSource(const std::function<TriangleBvh::sptr()>& source) { _triangleSource = source; }
+	/// <summary>
+	/// Gets the tree over this VAO's triangles, or nullptr if the mesh only has it's bounds to test against. This
+	/// loads the tree if it's not resident yet, so it may be slow the first time. Must be called on the main thread
+	/// </summary>
+	const TriangleBvh::sptr& GetTriangleBvh() const;
+	/// <summary>
+	/// Returns true if the tree over this VAO's triangles is in memory, without loading it
+	/// </summary>
+	bool HasResidentTriangleBvh() const { return _triangles != nullptr; }
+
+	/// <summary>
+	/// Adds a simplified version of this VAO's mesh that re-uses it's vertices, with it's own index buffer and a
+	/// copy of the indices in the arena. The vertex buffers, bounds and arena slice must be set first. Levels should be
+	/// added from most to least detailed
+	/// </summary>
+	/// <param name="indices">The simplified triangle list, referring to the same vertices as this mesh</param>
+	/// <param name="indexCount">The number of indices</param>
+	/// <param name="error">How far the simplified surface may be from the original, relative to the size of the mesh</param>
+	void AddLod(const uint32_t* indices, size_t indexCount, float error);
+	/// <summary>
+	/// Gets the simplified versions of this VAO's mesh, from most to least detailed
+	/// </summary>
+	const std::vector<Lod>& GetLods() const { return _lods; }
+
+	/// <summary>
+	/// Sets the local space bounds of the mesh stored in this VAO
+	/// </summary>
+	/// <param name="bounds">The volume enclosing all of the mesh's vertex positions</param>
+	void SetBounds(const BoundingVolume& bounds) { _bounds = bounds; }
+	/// <summary>
+	/// Gets the local space bounds of the mesh stored in this VAO
+	/// </summary>
+	const BoundingVolume& GetBounds() const { return _bounds; }
 
 	/// <summary>
-	/// Binds this VAO as the source of data for draw operations
+	/// Takes over everything another mesh holds (buffers, arena slice, bounds, meshlets, triangles and LODs) while
+	/// keeping our ID, so anything holding on to this mesh draws the new one from then on (ex: when it's file is
+	/// reloaded). The space our old copy took up in the arena isn't given back
+	/// </summary>
+	/// <param name="other">The mesh to take from, which is left empty</param>
+	void ReplaceWith(VertexArrayObject& other);
+
+	/// <summary>
+	/// Binds this mesh's layout as the source of data for draw operations, and attaches the mesh's buffers to it
 	/// </summary>
 	void Bind() const;
 	/// <summary>
@@ -124,27 +197,75 @@ public:
 	static void UnBind();
 
 	/// <summary>
-	/// Returns the underlying OpenGL handle that this class is wrapping around
+	/// Returns the handle of the shared VAO that this mesh is drawn through, or 0 if it has no vertex buffers yet
+	/// </summary>
+	GLuint GetHandle() const { return _layout != nullptr ? _layout->GetHandle() : 0; }
+	/// <summary>
+	/// Gets the layout this mesh is drawn through, or nullptr if it has no vertex buffers yet
+	/// </summary>
+	const VertexLayout::sptr& GetLayout() const { return _layout; }
+	/// <summary>
+	/// Gets a number that's unique to this mesh, since the handle is shared
 	/// </summary>
-	GLuint GetHandle() const { return _handle; }
+	uint32_t GetId() const { return _id; }
 
 	void Render() const;
+	/// <summary>
+	/// Renders multiple instances of this VAO in a single draw call
+	/// </summary>
+	/// <param name="instanceCount">The number of instances to draw</param>
+	/// <param name="baseInstance">The index of the first element in the instance buffer to read from</param>
+	void RenderInstanced(int instanceCount, int baseInstance = 0) const;
+	/// <summary>
+	/// Renders a range of commands from an indirect buffer in a single multi-draw call. This VAO must have an index buffer
+	/// </summary>
+	/// <param name="commands">The buffer holding the DrawElementsIndirectCommands to execute</param>
+	/// <param name="firstCommand">The index of the first command in the buffer to execute</param>
+	/// <param name="commandCount">The number of commands to execute</param>
+	/// <param name="cpuCommands">The CPU side copy of the buffer's commands if there is one, only read to count the triangles for RenderStats</param>
+	void RenderIndirect(const IndirectBuffer::sptr& commands, int firstCommand, int commandCount, const DrawElementsIndirectCommand* cpuCommands = nullptr) const;
+	/// <summary>
+	/// Renders a range of commands from an indirect buffer, where the number of commands to run is read from another
+	/// buffer on the GPU (ex: written by a compute pass). This VAO must have an index buffer
+	/// </summary>
+	/// <param name="commands">The buffer holding the DrawElementsIndirectCommands to execute</param>
+	/// <param name="firstCommand">The index of the first command in the buffer to execute</param>
+	/// <param name="counts">The buffer holding the number of commands to execute, as a GLuint</param>
+	/// <param name="countIndex">The index of the GLuint within the count buffer</param>
+	/// <param name="maxCommands">The most commands to execute, regardless of the count</param>
+	void RenderIndirectCount(const IndirectBuffer::sptr& commands, int firstCommand, const IBuffer& counts, int countIndex, int maxCommands) const;
 	
 protected:
-	// Helper structure to store a buffer and the attributes
+	// Helper structure to store a buffer and the attributes. The vertex buffers' attributes are kept by the layout
+	// (see VertexLayout::GetStream), so only the instance buffer uses them
 	struct VertexBufferBinding
 	{
 		VertexBuffer::sptr Buffer;
-		std::vector<BufferAttribute> Attributes;
+		const std::vector<BufferAttribute>* Attributes = nullptr;
 	};
 	
 	// The index buffer bound to this VAO
 	IndexBuffer::sptr _indexBuffer;
 	// The vertex buffers bound to this VAO
 	std::vector<VertexBufferBinding> _vertexBuffers;
+	// The per-instance buffer bound to this VAO
+	VertexBufferBinding _instanceBuffer;
+	// The region of a shared arena holding a copy of this mesh
+	MeshArenaSlice _arenaSlice;
+	// The local space bounds of the mesh
+	BoundingVolume _bounds;
+	// The clusters of the mesh, if it was big enough to split
+	MeshletBuffer::sptr _meshlets;
+	// The tree over the mesh's triangles, for picking and collision. Filled in from the source the first time it's
+	// asked for, if it's not resident
+	mutable TriangleBvh::sptr _triangles;
+	mutable std::function<TriangleBvh::sptr()> _triangleSource;
+	// The simplified versions of the mesh
+	std::vector<Lod> _lods;
 
 	GLsizei _vertexCount;
-	
-	// The underlying OpenGL handle that this class is wrapping around
-	GLuint _handle;
+
+	// The shared VAO that holds our vertex format
+	VertexLayout::sptr _layout;
+	uint32_t _id;
 };
@@ -0,0 +1,102 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+#include "BufferAttribute.h"
+
+/// <summary>
+/// How a member of a vertex struct gets handed to GL, worked out from it's type so that a declaration never needs a
+/// size or type spelled out by hand. Matrices take up one attribute slot per column. Members that hold packed data
+/// the shader reads as something else (ex: a normal packed into a uint32_t) go through VERTEX_ATTRIB_PACKED instead
+/// </summary>
+template <typename T>
+struct AttribFormat;
+
+template <GLint size, GLenum type, size_t columns = 1, size_t columnStride = 0>
+struct AttribFormatOf {
+	static constexpr GLint  Size = size;
+	static constexpr GLenum Type = type;
+	static constexpr size_t Columns = columns;
+	static constexpr size_t ColumnStride = columnStride;
+};
+
+template <> struct AttribFormat<float>      : AttribFormatOf<1, GL_FLOAT> { };
+template <> struct AttribFormat<glm::vec2>  : AttribFormatOf<2, GL_FLOAT> { };
+template <> struct AttribFormat<glm::vec3>  : AttribFormatOf<3, GL_FLOAT> { };
+template <> struct AttribFormat<glm::vec4>  : AttribFormatOf<4, GL_FLOAT> { };
+template <> struct AttribFormat<int32_t>    : AttribFormatOf<1, GL_INT> { };
+template <> struct AttribFormat<glm::ivec2> : AttribFormatOf<2, GL_INT> { };
+template <> struct AttribFormat<glm::ivec4> : AttribFormatOf<4, GL_INT> { };
+template <> struct AttribFormat<uint32_t>   : AttribFormatOf<1, GL_UNSIGNED_INT> { };
+template <> struct AttribFormat<glm::uvec2> : AttribFormatOf<2, GL_UNSIGNED_INT> { };
+template <> struct AttribFormat<glm::uvec4> : AttribFormatOf<4, GL_UNSIGNED_INT> { };
+template <> struct AttribFormat<glm::mat3>  : AttribFormatOf<3, GL_FLOAT, 3, sizeof(glm::vec3)> { };
+template <> struct AttribFormat<glm::mat4>  : AttribFormatOf<4, GL_FLOAT, 4, sizeof(glm::vec4)> { };
+
+/// <summary>
+/// Makes the attribute for a member of a vertex struct (or one column of it, for matrices), see VERTEX_ATTRIB
+/// </summary>
+template <typename Member>
+constexpr BufferAttribute MakeVertexAttrib(GLuint slot, GLsizei stride, size_t offset, AttribUsage usage, size_t column = 0) {
+	return BufferAttribute(slot, AttribFormat<Member>::Size, AttribFormat<Member>::Type, false, stride,
+		offset + column * AttribFormat<Member>::ColumnStride, usage);
+}
+
+/// <summary>
+/// Gets the number of bytes an attribute reads from each vertex
+/// </summary>
+constexpr size_t GetAttribByteSize(GLint size, GLenum type) {
+	switch (type) {
+		case GL_INT_2_10_10_10_REV:
+		case GL_UNSIGNED_INT_2_10_10_10_REV:
+			return 4;
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return static_cast<size_t>(size);
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:
+			return static_cast<size_t>(size) * 2;
+		case GL_DOUBLE:
+			return static_cast<size_t>(size) * 8;
+		default:
+			return static_cast<size_t>(size) * 4;
+	}
+}
+
+/// <summary>
+/// Checks a declaration at compile time (ex: in a static_assert): every attribute has to share the vertex's stride,
+/// fit inside of it, have a slot of it's own, and not overlap any other attribute
+/// </summary>
+/// <param name="decl">The declaration to check</param>
+/// <param name="stride">The size of the vertex struct</param>
+template <size_t N>
+constexpr bool IsValidVertexDecl(const std::array<BufferAttribute, N>& decl, size_t stride) {
+	for (size_t ix = 0; ix < N; ix++) {
+		const BufferAttribute& attrib = decl[ix];
+		const size_t end = attrib.Offset + GetAttribByteSize(attrib.Size, attrib.Type);
+		if (static_cast<size_t>(attrib.Stride) != stride || end > stride) {
+			return false;
+		}
+		for (size_t other = ix + 1; other < N; other++) {
+			const BufferAttribute& next = decl[other];
+			const size_t nextEnd = next.Offset + GetAttribByteSize(next.Size, next.Type);
+			if (next.Slot == attrib.Slot || (next.Offset < end && attrib.Offset < nextEnd)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// An attribute fed by a member of a vertex struct, with it's size and type taken from the member's type
+#define VERTEX_ATTRIB(Vertex, Member, slot, usage) \
+	MakeVertexAttrib<decltype(Vertex::Member)>(slot, sizeof(Vertex), offsetof(Vertex, Member), usage)
+// An attribute fed by one column of a matrix member, each column needs a slot of it's own
+#define VERTEX_ATTRIB_COLUMN(Vertex, Member, column, slot, usage) \
+	MakeVertexAttrib<decltype(Vertex::Member)>(slot, sizeof(Vertex), offsetof(Vertex, Member), usage, column)
+// An attribute fed by a member holding packed data, where the size and type that GL reads it as have to be given
+#define VERTEX_ATTRIB_PACKED(Vertex, Member, slot, size, type, normalized, usage) \
+	BufferAttribute(slot, size, type, normalized, sizeof(Vertex), offsetof(Vertex, Member), usage)
@@ -0,0 +1,137 @@
+#include "VertexLayout.h"
+
+#include "GpuDeletionQueue.h"
+#include "Logging.h"
+#include "RenderState.h"
+#include "ShaderPreprocessor.h"
+
+std::unordered_map<uint64_t, VertexLayout::sptr> VertexLayout::_layouts;
+
+VertexLayout::VertexLayout(const std::vector<BufferAttribute>* const* streams, size_t streamCount) :
+	_handle(0),
+	_vertexBuffers(INSTANCE_BINDING + 1),
+	_indexBuffer(0),
+	_instanceSource(nullptr)
+{
+	LOG_ASSERT(streamCount <= INSTANCE_BINDING, "Too many vertex buffers for one layout!");
+	glCreateVertexArrays(1, &_handle);
+	_streams.reserve(streamCount);
+	for (size_t ix = 0; ix < streamCount; ix++) {
+		_streams.push_back(*streams[ix]);
+		_SetFormat(static_cast<GLuint>(ix), _streams[ix], false);
+	}
+}
+
+VertexLayout::~VertexLayout() {
+	GpuDeletionQueue::DeleteVertexArray(_handle);
+	_handle = 0;
+}
+
+const VertexLayout::sptr& VertexLayout::Get(const std::vector<BufferAttribute>* const* streams, size_t streamCount) {
+	sptr& result = _layouts[_MakeKey(streams, streamCount)];
+	if (result == nullptr) {
+		result = std::make_shared<VertexLayout>(streams, streamCount);
+	} else {
+		// Two different declarations landing on the same key would draw with the wrong format
+		bool isSame = result->_streams.size() == streamCount;
+		for (size_t ix = 0; isSame && ix < streamCount; ix++) {
+			isSame = result->_streams[ix].size() == streams[ix]->size();
+			for (size_t attrib = 0; isSame && attrib < streams[ix]->size(); attrib++) {
+				isSame = _IsSameFormat(result->_streams[ix][attrib], (*streams[ix])[attrib]);
+			}
+		}
+		LOG_ASSERT(isSame, "Two vertex declarations have the same layout key!");
+	}
+	return result;
+}
+
+void VertexLayout::OnBufferDeleted(GLuint buffer) {
+	for (auto& [key, layout] : _layouts) {
+		for (Attachment& attachment : layout->_vertexBuffers) {
+			if (attachment.Buffer == buffer) {
+				attachment.Buffer = 0;
+			}
+		}
+		if (layout->_indexBuffer == buffer) {
+			layout->_indexBuffer = 0;
+		}
+	}
+}
+
+void VertexLayout::SetInstanceFormat(const std::vector<BufferAttribute>& attributes) {
+	// This gets called every time a mesh is bound, and it's almost always with the same declaration as last time
+	if (&attributes == _instanceSource) {
+		return;
+	}
+	bool isSame = attributes.size() == _instanceFormat.size();
+	for (size_t ix = 0; isSame && ix < attributes.size(); ix++) {
+		isSame = _IsSameFormat(attributes[ix], _instanceFormat[ix]);
+	}
+	_instanceSource = &attributes;
+	if (isSame) {
+		return;
+	}
+	if (!_instanceFormat.empty()) {
+		LOG_WARN("Vertex layout is being re-formatted for a different instance declaration");
+		for (const BufferAttribute& attrib : _instanceFormat) {
+			glDisableVertexArrayAttrib(_handle, attrib.Slot);
+		}
+	}
+	_instanceFormat = attributes;
+	_SetFormat(INSTANCE_BINDING, attributes, true);
+	// Advance the instance attributes once per instance rather than once per vertex
+	glVertexArrayBindingDivisor(_handle, INSTANCE_BINDING, 1);
+}
+
+void VertexLayout::Bind() const {
+	RenderState::BindVertexArray(_handle);
+}
+
+void VertexLayout::AttachVertexBuffer(GLuint binding, GLuint buffer) {
+	Attachment& attachment = _vertexBuffers[binding];
+	if (attachment.Buffer != buffer) {
+		glVertexArrayVertexBuffer(_handle, binding, buffer, 0, attachment.Stride);
+		attachment.Buffer = buffer;
+	}
+}
+
+void VertexLayout::AttachIndexBuffer(GLuint buffer) {
+	if (_indexBuffer != buffer) {
+		glVertexArrayElementBuffer(_handle, buffer);
+		_indexBuffer = buffer;
+	}
+}
+
+void VertexLayout::_SetFormat(GLuint binding, const std::vector<BufferAttribute>& attributes, bool keepIntegers) {
+	// Every attribute in a buffer shares it's stride, it gets handed over whenever a buffer is attached
+	_vertexBuffers[binding].Stride = attributes.empty() ? 0 : attributes[0].Stride;
+	_vertexBuffers[binding].Buffer = 0;
+	for (const BufferAttribute& attrib : attributes) {
+		glEnableVertexArrayAttrib(_handle, attrib.Slot);
+		// Integer attributes that are not normalized need to stay integers (ex: indices)
+		if (keepIntegers && !attrib.Normalized && (attrib.Type == GL_INT || attrib.Type == GL_UNSIGNED_INT)) {
+			glVertexArrayAttribIFormat(_handle, attrib.Slot, attrib.Size, attrib.Type, static_cast<GLuint>(attrib.Offset));
+		} else {
+			glVertexArrayAttribFormat(_handle, attrib.Slot, attrib.Size, attrib.Type, attrib.Normalized, static_cast<GLuint>(attrib.Offset));
+		}
+		glVertexArrayAttribBinding(_handle, attrib.Slot, binding);
+	}
+}
+
+uint64_t VertexLayout::_MakeKey(const std::vector<BufferAttribute>* const* streams, size_t streamCount) {
+	uint64_t result = ShaderPreprocessor::HASH_SEED;
+	for (size_t ix = 0; ix < streamCount; ix++) {
+		for (const BufferAttribute& attrib : *streams[ix]) {
+			const uint32_t fields[6] = { attrib.Slot, static_cast<uint32_t>(attrib.Size), attrib.Type, attrib.Normalized ? 1u : 0u,
+				static_cast<uint32_t>(attrib.Stride), static_cast<uint32_t>(attrib.Offset) };
+			result = ShaderPreprocessor::HashCombine(result, reinterpret_cast<const char*>(fields), sizeof(fields));
+		}
+		// Marks where one buffer's attributes end and the next one's start
+		result = ShaderPreprocessor::HashCombine(result, "|", 1);
+	}
+	return result;
+}
+
+bool VertexLayout::_IsSameFormat(const BufferAttribute& a, const BufferAttribute& b) {
+	return a.Slot == b.Slot && a.Size == b.Size && a.Type == b.Type && a.Normalized == b.Normalized && a.Stride == b.Stride && a.Offset == b.Offset;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "BufferAttribute.h"
+
+/// <summary>
+/// A VAO that only holds a vertex format: which attributes there are, how they're laid out, and which buffer binding
+/// point feeds each of them (set up with glVertexArrayAttribFormat and glVertexArrayAttribBinding). Every mesh with the
+/// same vertex declarations shares a single layout, and just attaches it's own buffers to the binding points before
+/// it draws (with glVertexArrayVertexBuffer and glVertexArrayElementBuffer). The layout remembers what's attached, so
+/// meshes that share their buffers (ex: everything in a MeshArena) don't rebind anything at all, and drawing a
+/// different mesh with the same layout never switches VAOs
+///
+/// Vertex buffer N of a mesh goes to binding point N, the per-instance buffer goes to INSTANCE_BINDING
+///
+/// The layout keeps it's own copy of the declarations it was made from, which the meshes point at rather than each
+/// holding a copy, so adding a vertex buffer to a mesh with a layout that already exists doesn't allocate anything
+/// for it's format
+/// </summary>
+class VertexLayout final
+{
+public:
+	typedef std::shared_ptr<VertexLayout> sptr;
+	// We'll disallow moving and copying, since we own a GPU resource
+	VertexLayout(const VertexLayout& other) = delete;
+	VertexLayout(VertexLayout&& other) = delete;
+	VertexLayout& operator=(const VertexLayout& other) = delete;
+	VertexLayout& operator=(VertexLayout&& other) = delete;
+
+public:
+	/// <summary>
+	/// The binding point that per-instance buffers get attached to, the last of the 16 every GL 4.3 driver has
+	/// </summary>
+	static const GLuint INSTANCE_BINDING = 15;
+
+	/// <summary>
+	/// Creates a VAO with the given vertex format, use Get to share layouts between meshes
+	/// </summary>
+	/// <param name="streams">The attributes fed by each vertex buffer, in binding point order</param>
+	/// <param name="streamCount">The number of vertex buffers</param>
+	VertexLayout(const std::vector<BufferAttribute>* const* streams, size_t streamCount);
+	~VertexLayout();
+
+	/// <summary>
+	/// Gets the layout shared by every mesh with the given vertex declarations, making it if this is the first
+	/// </summary>
+	/// <param name="streams">The attributes fed by each vertex buffer, in binding point order</param>
+	/// <param name="streamCount">The number of vertex buffers, no more than INSTANCE_BINDING</param>
+	static const sptr& Get(const std::vector<BufferAttribute>* const* streams, size_t streamCount);
+	/// <summary>
+	/// Forgets any attachments of the given buffer, since it's handle may get re-used by a new buffer
+	/// </summary>
+	/// <param name="buffer">The handle of the buffer that's being deleted</param>
+	static void OnBufferDeleted(GLuint buffer);
+	/// <summary>
+	/// Releases all of the shared layouts, must be called before the GL context goes away
+	/// </summary>
+	static void ReleaseAll() { _layouts.clear(); }
+	/// <summary>
+	/// Gets the number of shared layouts that have been made
+	/// </summary>
+	static size_t GetCount() { return _layouts.size(); }
+
+	/// <summary>
+	/// Gets the layout's copy of the attributes fed by one of it's vertex buffers
+	/// </summary>
+	/// <param name="binding">The index of the vertex buffer</param>
+	const std::vector<BufferAttribute>& GetStream(size_t binding) const { return _streams[binding]; }
+	/// <summary>
+	/// Gets the number of vertex buffers the layout reads from
+	/// </summary>
+	size_t GetStreamCount() const { return _streams.size(); }
+
+	/// <summary>
+	/// Sets the format of the per-instance attributes. All the meshes sharing the layout are expected to use the same
+	/// instance declaration, setting a different one re-formats the layout for everyone
+	/// </summary>
+	/// <param name="attributes">The attributes fed by the per-instance buffer, must outlive the layout (ex: a vertex type's V_DECL)</param>
+	void SetInstanceFormat(const std::vector<BufferAttribute>& attributes);
+
+	/// <summary>
+	/// Binds the layout's VAO as the source of data for draw operations
+	/// </summary>
+	void Bind() const;
+	/// <summary>
+	/// Attaches a vertex buffer to one of the layout's binding points, if it's not already there
+	/// </summary>
+	/// <param name="binding">The index of the binding point</param>
+	/// <param name="buffer">The handle of the buffer to attach</param>
+	void AttachVertexBuffer(GLuint binding, GLuint buffer);
+	/// <summary>
+	/// Attaches an index buffer to the layout, if it's not already there
+	/// </summary>
+	/// <param name="buffer">The handle of the buffer to attach, or 0 for none</param>
+	void AttachIndexBuffer(GLuint buffer);
+
+	/// <summary>
+	/// Returns the underlying OpenGL handle that this class is wrapping around
+	/// </summary>
+	GLuint GetHandle() const { return _handle; }
+
+protected:
+	// The buffer attached to a binding point, and the stride it gets read with
+	struct Attachment {
+		GLuint  Buffer = 0;
+		GLsizei Stride = 0;
+	};
+
+	GLuint                       _handle;
+	// Indexed by binding point, the instance buffer's binding is the last one
+	std::vector<Attachment>      _vertexBuffers;
+	GLuint                       _indexBuffer;
+	std::vector<std::vector<BufferAttribute>> _streams;
+	std::vector<BufferAttribute> _instanceFormat;
+	// The declaration the instance format was last set from, so the same one doesn't need comparing again
+	const std::vector<BufferAttribute>* _instanceSource;
+
+	static std::unordered_map<uint64_t, sptr> _layouts;
+
+	// Points the attributes at a binding point, and sets up their formats. Integer attributes are converted to floats
+	// unless told to keep them
+	void _SetFormat(GLuint binding, const std::vector<BufferAttribute>& attributes, bool keepIntegers);
+	// Hashes the parts of a declaration that matter to GL into a key for the map of shared layouts
+	static uint64_t _MakeKey(const std::vector<BufferAttribute>* const* streams, size_t streamCount);
+	// Returns true if the parts of two attributes that matter to GL are the same
+	static bool _IsSameFormat(const BufferAttribute& a, const BufferAttribute& b);
+};
@@ -0,0 +1,78 @@
+#include "ViewTarget.h"
+
+#include <algorithm>
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderState.h"
+
+ViewTarget::ViewTarget() :
+	_framebuffer(0),
+	_color(0),
+	_depth(0),
+	_width(0),
+	_height(0),
+	_previousFramebuffer(0),
+	_previousViewport{ 0, 0, 0, 0 }
+{
+	glCreateFramebuffers(1, &_framebuffer);
+}
+
+ViewTarget::~ViewTarget() {
+	_DeleteTargets();
+	glDeleteFramebuffers(1, &_framebuffer);
+}
+
+void ViewTarget::_DeleteTargets() {
+	const GLuint textures[2] = { _color, _depth };
+	for (GLuint texture : textures) {
+		if (texture != 0) {
+			RenderState::OnTextureDeleted(texture);
+			GpuResources::RemoveRaw(GL_TEXTURE, texture);
+		}
+	}
+	glDeleteTextures(2, textures);
+	_color = _depth = 0;
+}
+
+void ViewTarget::Begin(int width, int height, const glm::vec4& clearColor) {
+	GPU_RESOURCE_OWNER("ViewTarget");
+	width = std::max(width, 1);
+	height = std::max(height, 1);
+	if (width != _width || height != _height) {
+		_DeleteTargets();
+		_width = width;
+		_height = height;
+		const GLenum formats[2] = { GL_RGBA8, GL_DEPTH_COMPONENT32F };
+		const char* names[2] = { "View Color", "View Depth" };
+		GLuint* textures[2] = { &_color, &_depth };
+		for (int ix = 0; ix < 2; ix++) {
+			glCreateTextures(GL_TEXTURE_2D, 1, textures[ix]);
+			glTextureStorage2D(*textures[ix], 1, formats[ix], width, height);
+			// The color gets shown scaled in the UI, so it's worth filtering
+			glTextureParameteri(*textures[ix], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTextureParameteri(*textures[ix], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			// Both formats are 4 bytes a pixel
+			GpuResources::AddRaw(GL_TEXTURE, *textures[ix], static_cast<size_t>(width) * height * 4, names[ix]);
+		}
+		glNamedFramebufferTexture(_framebuffer, GL_COLOR_ATTACHMENT0, _color, 0);
+		glNamedFramebufferTexture(_framebuffer, GL_DEPTH_ATTACHMENT, _depth, 0);
+		if (glCheckNamedFramebufferStatus(_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR("View target is incomplete at {}x{}", width, height);
+		}
+	}
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, _previousViewport);
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	glViewport(0, 0, _width, _height);
+	const float clearDepth = 1.0f;
+	RenderState::SetDepthMask(true);
+	glClearNamedFramebufferfv(_framebuffer, GL_COLOR, 0, &clearColor[0]);
+	glClearNamedFramebufferfv(_framebuffer, GL_DEPTH, 0, &clearDepth);
+}
+
+void ViewTarget::End() {
+	glBindFramebuffer(GL_FRAMEBUFFER, _previousFramebuffer);
+	glViewport(_previousViewport[0], _previousViewport[1], _previousViewport[2], _previousViewport[3]);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <memory>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// A color and depth target for a view that doesn't get drawn straight to the screen (ex: a mirror, a security camera
+/// or a reflection probe's face). The color can be sampled afterwards, or shown in the UI
+///
+/// Usage each frame: Begin, draw the view, End
+/// </summary>
+class ViewTarget final
+{
+public:
+	typedef std::shared_ptr<ViewTarget> sptr;
+	static inline sptr Create() {
+		return std::make_shared<ViewTarget>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	ViewTarget(const ViewTarget& other) = delete;
+	ViewTarget(ViewTarget&& other) = delete;
+	ViewTarget& operator=(const ViewTarget& other) = delete;
+	ViewTarget& operator=(ViewTarget&& other) = delete;
+
+public:
+	/// <summary>
+	/// Creates the framebuffer, the targets get created the first time Begin knows how big they need to be
+	/// </summary>
+	ViewTarget();
+	~ViewTarget();
+
+	/// <summary>
+	/// Binds and clears the target, resizing it first if needed, and sets the viewport to cover it
+	/// </summary>
+	/// <param name="width">The width of the target, in pixels</param>
+	/// <param name="height">The height of the target, in pixels</param>
+	/// <param name="clearColor">The color to clear to</param>
+	void Begin(int width, int height, const glm::vec4& clearColor);
+	/// <summary>
+	/// Goes back to drawing to whatever framebuffer and viewport were in use when Begin was called
+	/// </summary>
+	void End();
+
+	/// <summary>
+	/// Gets the texture the view was drawn into
+	/// </summary>
+	GLuint GetColor() const { return _color; }
+	/// <summary>
+	/// Gets the view's depth, which holds everything drawn into it until the next Begin
+	/// </summary>
+	GLuint GetDepth() const { return _depth; }
+	int GetWidth() const { return _width; }
+	int GetHeight() const { return _height; }
+
+protected:
+	GLuint _framebuffer;
+	GLuint _color;
+	GLuint _depth;
+	int    _width;
+	int    _height;
+	// What was being drawn to before Begin, so End can go back to it
+	GLint  _previousFramebuffer;
+	GLint  _previousViewport[4];
+
+	// Deletes the targets, if they exist
+	void _DeleteTargets();
+};
@@ -0,0 +1,464 @@
+#include "VirtualTexture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "RenderStats.h"
+#include "UniformBlocks.h"
+#include "Utilities/CpuProfiler.h"
+#include "Gameplay/ShaderMaterial.h"
+
+// Marks a slot or page with nothing in it
+static const uint32_t NONE = UINT32_MAX;
+// Bumped whenever the layout of the file changes
+static const uint32_t VIRTUAL_TEXTURE_VERSION = 1;
+
+// The start of a cooked file, followed by every page of every level from the largest down, each level in rows of pages.
+// Every page is stored with it's border as RGBA8 rows, so a page can be read with a single copy
+struct VirtualTextureHeader {
+	char     Magic[4];
+	uint32_t Version;
+	uint32_t Size;
+	uint32_t PageSize;
+	uint32_t Border;
+	uint32_t LevelCount;
+};
+
+// Gets the number of levels a virtual texture has, the last one being a single page
+static uint32_t GetVirtualLevelCount(uint32_t size, uint32_t pageSize) {
+	uint32_t result = 1;
+	while ((pageSize << (result - 1)) < size) {
+		result++;
+	}
+	return result;
+}
+
+// Gets the bytes each page takes up in the file and in the cache, border included
+static size_t GetPageBytes(uint32_t pageSize, uint32_t border) {
+	const size_t slotSize = pageSize + border * 2;
+	return slotSize * slotSize * 4;
+}
+
+VirtualTexture::sptr VirtualTexture::Load(const std::string& path, uint32_t cacheSlots) {
+	MappedFile::sptr file = MappedFile::Open(path);
+	if (file == nullptr || file->GetSize() < sizeof(VirtualTextureHeader)) {
+		LOG_WARN("Failed to open virtual texture \"{}\"", path);
+		return nullptr;
+	}
+	VirtualTextureHeader header;
+	memcpy(&header, file->GetData(), sizeof(VirtualTextureHeader));
+	if (memcmp(header.Magic, "VTEX", 4) != 0 || header.Version != VIRTUAL_TEXTURE_VERSION) {
+		LOG_WARN("\"{}\" is not a virtual texture, or was cooked by an older version", path);
+		return nullptr;
+	}
+	// The page table has 8 bits for each slot coordinate, and the feedback has 14 bits for each page coordinate
+	if (header.PageSize == 0 || header.Size < header.PageSize || header.Size % header.PageSize != 0 || (header.Size & (header.Size - 1)) != 0 ||
+		header.Size / header.PageSize > (1u << 14) || header.LevelCount != GetVirtualLevelCount(header.Size, header.PageSize) ||
+		cacheSlots == 0 || cacheSlots > 256)
+	{
+		LOG_WARN("Virtual texture \"{}\" has an unsupported layout", path);
+		return nullptr;
+	}
+	size_t pageCount = 0;
+	for (uint32_t level = 0; level < header.LevelCount; level++) {
+		const size_t pages = (header.Size >> level) / header.PageSize;
+		pageCount += pages * pages;
+	}
+	if (file->GetSize() < sizeof(VirtualTextureHeader) + pageCount * GetPageBytes(header.PageSize, header.Border)) {
+		LOG_WARN("Virtual texture \"{}\" is missing pages, it may have been cut short while cooking", path);
+		return nullptr;
+	}
+	return std::make_shared<VirtualTexture>(file, cacheSlots);
+}
+
+VirtualTexture::VirtualTexture(const MappedFile::sptr& file, uint32_t cacheSlots) :
+	_file(file),
+	_size(0),
+	_pageSize(0),
+	_border(0),
+	_levelCount(0),
+	_levelOffsets(),
+	_pageTable(nullptr),
+	_cache(nullptr),
+	_cacheSlots(cacheSlots),
+	_slots(),
+	_residency(),
+	_isTableDirty(false),
+	_loads(),
+	_feedback(0),
+	_feedbackWidth(0),
+	_feedbackHeight(0),
+	_nextReadback(0),
+	_frame(1),
+	_materials(),
+	_stats()
+{
+	GPU_RESOURCE_OWNER("VirtualTexture");
+	VirtualTextureHeader header;
+	memcpy(&header, _file->GetData(), sizeof(VirtualTextureHeader));
+	_size = header.Size;
+	_pageSize = header.PageSize;
+	_border = header.Border;
+	_levelCount = header.LevelCount;
+
+	size_t offset = 0;
+	_levelOffsets.resize(_levelCount);
+	_residency.resize(_levelCount);
+	for (uint32_t level = 0; level < _levelCount; level++) {
+		const size_t pages = _GetPageCount(level);
+		_levelOffsets[level] = offset;
+		_residency[level].assign(pages * pages, NONE);
+		offset += pages * pages;
+	}
+
+	// Each texel of the page table holds the slot of it's page in the cache, and the level that page is from. The
+	// shader fetches it's texels directly, but the levels still need mipmap filtering to be complete
+	Texture2DDescription table;
+	table.Width = table.Height = _GetPageCount(0);
+	table.Format = InternalFormat::RGBA8;
+	table.HorizontalWrap = WrapMode::ClampToEdge;
+	table.VerticalWrap = WrapMode::ClampToEdge;
+	table.MinificationFilter = MinFilter::NearestMipNearest;
+	table.MagnificationFilter = MagFilter::Nearest;
+	table.GenerateMipMaps = true;
+	_pageTable = Texture2D::Create(table);
+	_pageTable->SetDebugName("Virtual Page Table");
+
+	// The pages carry their own borders, so the cache only ever needs the one level
+	Texture2DDescription cache;
+	cache.Width = cache.Height = _cacheSlots * (_pageSize + _border * 2);
+	cache.Format = InternalFormat::RGBA8;
+	cache.HorizontalWrap = WrapMode::ClampToEdge;
+	cache.VerticalWrap = WrapMode::ClampToEdge;
+	cache.MinificationFilter = MinFilter::Linear;
+	cache.MagnificationFilter = MagFilter::Linear;
+	cache.GenerateMipMaps = false;
+	_cache = Texture2D::Create(cache);
+	_cache->SetDebugName("Virtual Page Cache");
+
+	_slots.resize(static_cast<size_t>(_cacheSlots) * _cacheSlots, { NONE, 0 });
+	for (Readback& readback : _ring) {
+		readback.Buffer = 0;
+		readback.Size = 0;
+		readback.Data = nullptr;
+		readback.Fence = nullptr;
+		readback.Width = readback.Height = 0;
+	}
+
+	// The coarsest page is loaded straight away and never leaves, so every texel of the table points somewhere
+	const uint32_t root = _MakeKey(_levelCount - 1, 0, 0);
+	_Upload(root, reinterpret_cast<const uint8_t*>(_file->GetData()) + _GetPageOffset(root));
+	_slots[_residency[_levelCount - 1][0]].LastUsed = UINT64_MAX;
+	_UpdatePageTable();
+	_stats.Capacity = static_cast<uint32_t>(_slots.size());
+}
+
+VirtualTexture::~VirtualTexture() {
+	for (const PageLoad& load : _loads) {
+		load.Cancel->Cancel();
+	}
+	for (Readback& readback : _ring) {
+		if (readback.Fence != nullptr) {
+			glDeleteSync(readback.Fence);
+		}
+		if (readback.Buffer != 0) {
+			glUnmapNamedBuffer(readback.Buffer);
+			GpuResources::RemoveRaw(GL_BUFFER, readback.Buffer);
+			glDeleteBuffers(1, &readback.Buffer);
+		}
+	}
+	if (_feedback != 0) {
+		GpuResources::RemoveRaw(GL_TEXTURE, _feedback);
+		glDeleteTextures(1, &_feedback);
+	}
+	// The loads hold onto the file themselves, so the workers can finish them after we're gone
+}
+
+bool VirtualTexture::Cook(const std::string& path, uint32_t size, const CookSource& source, uint32_t pageSize, uint32_t border) {
+	PROFILE_SCOPE("CookVirtualTexture");
+	if (pageSize == 0 || size < pageSize || size % pageSize != 0 || (size & (size - 1)) != 0) {
+		LOG_WARN("Can't cook \"{}\", the size must be a power of two and a multiple of the page size", path);
+		return false;
+	}
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		LOG_WARN("Failed to open \"{}\" to cook a virtual texture into", path);
+		return false;
+	}
+	VirtualTextureHeader header;
+	memcpy(header.Magic, "VTEX", 4);
+	header.Version = VIRTUAL_TEXTURE_VERSION;
+	header.Size = size;
+	header.PageSize = pageSize;
+	header.Border = border;
+	header.LevelCount = GetVirtualLevelCount(size, pageSize);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(VirtualTextureHeader));
+
+	// Only a row of pages is kept at a time, the largest level of a big texture wouldn't fit in memory
+	const uint32_t slotSize = pageSize + border * 2;
+	const size_t pageBytes = GetPageBytes(pageSize, border);
+	std::vector<uint8_t> row;
+	for (uint32_t level = 0; level < header.LevelCount; level++) {
+		const uint32_t pages = (size >> level) / pageSize;
+		row.resize(pages * pageBytes);
+		for (uint32_t y = 0; y < pages; y++) {
+			ThreadPool::Instance().ParallelFor(pages, 1, [&](size_t begin, size_t end) {
+				for (size_t x = begin; x < end; x++) {
+					source(level, static_cast<int32_t>(x * pageSize) - static_cast<int32_t>(border), static_cast<int32_t>(y * pageSize) - static_cast<int32_t>(border),
+						slotSize, slotSize, row.data() + x * pageBytes);
+				}
+			});
+			file.write(reinterpret_cast<const char*>(row.data()), row.size());
+		}
+	}
+	if (!file.good()) {
+		LOG_WARN("Failed to write virtual texture \"{}\"", path);
+		return false;
+	}
+	LOG_INFO("Cooked a {0}x{0} virtual texture into \"{1}\"", size, path);
+	return true;
+}
+
+void VirtualTexture::Bind(const ShaderMaterial::sptr& material, const glm::vec2& regionMin, float regionSize) {
+	material->Set("s_VirtualPageTable", _pageTable);
+	material->Set("s_VirtualCache", _cache);
+	material->Set("u_VirtualRegion", glm::vec4(regionMin, 1.0f / regionSize, 0.0f));
+	material->Set("u_VirtualInfo", glm::vec4(_size, _pageSize, _border, _levelCount - 1));
+	material->Set("u_VirtualCache", glm::vec4(1.0f / _cache->GetWidth(), FEEDBACK_SCALE, 0.0f, 0.0f));
+	if (std::find(_materials.begin(), _materials.end(), material) == _materials.end()) {
+		_materials.push_back(material);
+	}
+}
+
+void VirtualTexture::BeginFrame(int width, int height) {
+	_ResizeFeedback((width + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE, (height + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE);
+	const GLuint clear = NONE;
+	glClearTexImage(_feedback, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &clear);
+	glBindImageTexture(VIRTUAL_FEEDBACK_IMAGE, _feedback, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+
+	// Each frame a different pixel of every block writes it's request, so small details get seen eventually
+	const uint32_t step = static_cast<uint32_t>(_frame % (FEEDBACK_SCALE * FEEDBACK_SCALE));
+	const glm::vec4 settings(1.0f / _cache->GetWidth(), FEEDBACK_SCALE, step % FEEDBACK_SCALE, step / FEEDBACK_SCALE);
+	for (const ShaderMaterial::sptr& material : _materials) {
+		material->Set("u_VirtualCache", settings);
+	}
+}
+
+void VirtualTexture::EndFrame() {
+	if (_feedback == 0) {
+		return;
+	}
+	// We'd rather miss a frame's requests than wait on the GPU
+	Readback& readback = _ring[_nextReadback];
+	if (readback.Fence != nullptr) {
+		return;
+	}
+	_nextReadback = (_nextReadback + 1) % RING_SIZE;
+
+	const size_t size = static_cast<size_t>(_feedbackWidth) * _feedbackHeight * sizeof(uint32_t);
+	if (readback.Size < size) {
+		GPU_RESOURCE_OWNER("VirtualTexture");
+		if (readback.Buffer != 0) {
+			glUnmapNamedBuffer(readback.Buffer);
+			GpuResources::RemoveRaw(GL_BUFFER, readback.Buffer);
+			glDeleteBuffers(1, &readback.Buffer);
+		}
+		const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &readback.Buffer);
+		glNamedBufferStorage(readback.Buffer, size, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+		readback.Data = static_cast<uint32_t*>(glMapNamedBufferRange(readback.Buffer, 0, size, flags));
+		readback.Size = size;
+		GpuResources::AddRaw(GL_BUFFER, readback.Buffer, size, "Virtual Texture Feedback Readback");
+	}
+	readback.Width = _feedbackWidth;
+	readback.Height = _feedbackHeight;
+
+	// The requests were written by shaders, so they need to land before the copy reads them
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer);
+	glGetTextureImage(_feedback, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, static_cast<GLsizei>(size), nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void VirtualTexture::Update() {
+	PROFILE_SCOPE("VirtualTexture");
+	_frame++;
+	_stats.Uploaded = 0;
+	_stats.Evicted = 0;
+
+	for (Readback& readback : _ring) {
+		if (readback.Fence == nullptr) {
+			continue;
+		}
+		const GLenum status = glClientWaitSync(readback.Fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			continue;
+		}
+		glDeleteSync(readback.Fence);
+		readback.Fence = nullptr;
+		if (status == GL_WAIT_FAILED || readback.Data == nullptr) {
+			LOG_WARN("Failed to read back the virtual texture's feedback");
+			continue;
+		}
+		_Request(readback.Data, static_cast<size_t>(readback.Width) * readback.Height);
+	}
+
+	// Loads that couldn't find a slot get dropped, they'll be asked for again if they're still wanted
+	uint32_t uploads = 0;
+	for (auto it = _loads.begin(); it != _loads.end() && uploads < MAX_UPLOADS;) {
+		if (!it->Pixels.IsDone()) {
+			++it;
+			continue;
+		}
+		if (!it->Pixels.HasFailed() && _Upload(it->Page, reinterpret_cast<const uint8_t*>(it->Pixels.Get()->GetData()))) {
+			uploads++;
+		}
+		it = _loads.erase(it);
+	}
+	if (_isTableDirty) {
+		_UpdatePageTable();
+	}
+
+	_stats.Resident = static_cast<uint32_t>(std::count_if(_slots.begin(), _slots.end(), [](const Slot& slot) { return slot.Page != NONE; }));
+	_stats.Loading = static_cast<uint32_t>(_loads.size());
+}
+
+size_t VirtualTexture::_GetPageOffset(uint32_t key) const {
+	const uint32_t level = key >> 28;
+	const uint32_t y = (key >> 14) & 0x3FFF;
+	const uint32_t x = key & 0x3FFF;
+	const size_t page = _levelOffsets[level] + static_cast<size_t>(y) * _GetPageCount(level) + x;
+	return sizeof(VirtualTextureHeader) + page * GetPageBytes(_pageSize, _border);
+}
+
+void VirtualTexture::_Request(const uint32_t* feedback, size_t count) {
+	std::vector<uint32_t> requests;
+	for (size_t ix = 0; ix < count; ix++) {
+		const uint32_t key = feedback[ix];
+		const uint32_t level = key >> 28;
+		const uint32_t y = (key >> 14) & 0x3FFF;
+		const uint32_t x = key & 0x3FFF;
+		if (key == NONE || level >= _levelCount || x >= _GetPageCount(level) || y >= _GetPageCount(level)) {
+			continue;
+		}
+		// Every page needs the pages above it as well, so there's something close to fall back on while it loads
+		for (uint32_t parent = level; parent < _levelCount; parent++) {
+			requests.push_back(_MakeKey(parent, x >> (parent - level), y >> (parent - level)));
+		}
+	}
+	std::sort(requests.begin(), requests.end());
+	requests.erase(std::unique(requests.begin(), requests.end()), requests.end());
+	_stats.Requested = static_cast<uint32_t>(requests.size());
+
+	// Drop the reads for pages the feedback has moved on from, the ones that haven't started never touch the disk
+	_loads.erase(std::remove_if(_loads.begin(), _loads.end(), [&requests](const PageLoad& load) {
+		if (load.Pixels.IsDone() || std::binary_search(requests.begin(), requests.end(), load.Page)) {
+			return false;
+		}
+		load.Cancel->Cancel();
+		return true;
+	}), _loads.end());
+
+	// The keys sort by level, so going backwards loads the coarsest pages first, they cover the most ground
+	for (auto it = requests.rbegin(); it != requests.rend(); ++it) {
+		const uint32_t key = *it;
+		const uint32_t level = key >> 28;
+		const uint32_t slot = _residency[level][((key >> 14) & 0x3FFF) * _GetPageCount(level) + (key & 0x3FFF)];
+		if (slot != NONE) {
+			_slots[slot].LastUsed = std::max(_slots[slot].LastUsed, _frame);
+			continue;
+		}
+		if (_loads.size() >= MAX_LOADS || std::any_of(_loads.begin(), _loads.end(), [key](const PageLoad& load) { return load.Page == key; })) {
+			continue;
+		}
+		// Touching the mapping is what reads the page from disk, so the copy happens on an I/O thread. Neighbouring
+		// pages sit next to each other in the file, so a burst of them usually gets read as one
+		PageLoad load;
+		load.Page = key;
+		load.Cancel = IoCancelToken::Create();
+		load.Pixels = IoScheduler::ReadMapped(_file, _GetPageOffset(key), GetPageBytes(_pageSize, _border), IoPriority::VisibleNow, load.Cancel);
+		_loads.push_back(std::move(load));
+	}
+}
+
+bool VirtualTexture::_Upload(uint32_t key, const uint8_t* pixels) {
+	// Least recently used first, empty slots were never used. Pages asked for this frame stay where they are
+	uint32_t target = NONE;
+	uint64_t oldest = _frame;
+	for (uint32_t ix = 0; ix < _slots.size(); ix++) {
+		if (_slots[ix].LastUsed < oldest) {
+			oldest = _slots[ix].LastUsed;
+			target = ix;
+		}
+	}
+	if (target == NONE) {
+		return false;
+	}
+
+	Slot& slot = _slots[target];
+	if (slot.Page != NONE) {
+		const uint32_t level = slot.Page >> 28;
+		_residency[level][((slot.Page >> 14) & 0x3FFF) * _GetPageCount(level) + (slot.Page & 0x3FFF)] = NONE;
+		_stats.Evicted++;
+	}
+	const uint32_t level = key >> 28;
+	_residency[level][((key >> 14) & 0x3FFF) * _GetPageCount(level) + (key & 0x3FFF)] = target;
+	slot.Page = key;
+	slot.LastUsed = _frame;
+
+	const uint32_t slotSize = _pageSize + _border * 2;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTextureSubImage2D(_cache->GetHandle(), 0, (target % _cacheSlots) * slotSize, (target / _cacheSlots) * slotSize, slotSize, slotSize,
+		GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	RenderStats::CountTextureUpload(GetPageBytes(_pageSize, _border));
+	_stats.Uploaded++;
+	_isTableDirty = true;
+	return true;
+}
+
+void VirtualTexture::_UpdatePageTable() {
+	_isTableDirty = false;
+	// Filled from the coarsest level down, so a page that isn't in the cache can take it's parent's texel. Each texel
+	// is the slot's column and row, then the level of the page that's there
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> texels;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (int level = static_cast<int>(_levelCount) - 1; level >= 0; level--) {
+		const uint32_t pages = _GetPageCount(level);
+		texels.resize(static_cast<size_t>(pages) * pages);
+		for (uint32_t y = 0; y < pages; y++) {
+			for (uint32_t x = 0; x < pages; x++) {
+				const uint32_t slot = _residency[level][y * pages + x];
+				if (slot != NONE) {
+					texels[y * pages + x] = (slot % _cacheSlots) | ((slot / _cacheSlots) << 8) | (static_cast<uint32_t>(level) << 16) | 0xFF000000u;
+				} else {
+					texels[y * pages + x] = parents.empty() ? 0 : parents[(y / 2) * (pages / 2) + x / 2];
+				}
+			}
+		}
+		glTextureSubImage2D(_pageTable->GetHandle(), level, 0, 0, pages, pages, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+		RenderStats::CountTextureUpload(texels.size() * sizeof(uint32_t));
+		std::swap(parents, texels);
+	}
+}
+
+void VirtualTexture::_ResizeFeedback(int width, int height) {
+	if (_feedback != 0 && width == _feedbackWidth && height == _feedbackHeight) {
+		return;
+	}
+	GPU_RESOURCE_OWNER("VirtualTexture");
+	if (_feedback != 0) {
+		GpuResources::RemoveRaw(GL_TEXTURE, _feedback);
+		glDeleteTextures(1, &_feedback);
+	}
+	glCreateTextures(GL_TEXTURE_2D, 1, &_feedback);
+	glTextureStorage2D(_feedback, 1, GL_R32UI, width, height);
+	GpuResources::AddRaw(GL_TEXTURE, _feedback, static_cast<size_t>(width) * height * sizeof(uint32_t), "Virtual Texture Feedback");
+	_feedbackWidth = width;
+	_feedbackHeight = height;
+}
@@ -0,0 +1,195 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+#include "Texture2D.h"
+#include "Utilities/MappedFile.h"
+#include "Utilities/IoScheduler.h"
+#include "Utilities/ThreadPool.h"
+
+class ShaderMaterial;
+
+/// <summary>
+/// A sparse virtual texture, for unique ground textures far too big to keep on the GPU (ex: 8k or 16k across a whole
+/// terrain). The image and it's mips are cooked into a file of square pages (see Cook), and only the pages that have
+/// been seen recently are kept in a cache texture. A page table with a texel for each page at each level tells the
+/// shader where to find a page in the cache, or the closest coarser page that's there while it loads
+///
+/// The shader (VIRTUAL_TEXTURE in frag_blinn_phong_textured.glsl) writes the pages it wanted into a small feedback
+/// image as it draws, one pixel out of each FEEDBACK_SCALE x FEEDBACK_SCALE block, moving the pixel around the block
+/// from frame to frame. The feedback gets copied into a ring of pixel pack buffers, and once the copy is done Update
+/// reads the requests back, loads the missing pages on the workers and swaps them into the cache, replacing whichever
+/// pages have gone unused the longest. The coarsest page is always kept, so there's always something to sample
+///
+/// Usage each frame: BeginFrame before the scene is drawn, EndFrame once it's done, and Update on the main thread
+/// </summary>
+class VirtualTexture final
+{
+public:
+	typedef std::shared_ptr<VirtualTexture> sptr;
+	/// <summary>
+	/// Opens a cooked virtual texture, see Cook
+	/// </summary>
+	/// <param name="path">The path of the cooked file</param>
+	/// <param name="cacheSlots">The number of pages along each side of the cache texture</param>
+	/// <returns>The virtual texture, or nullptr if the file couldn't be opened</returns>
+	static sptr Load(const std::string& path, uint32_t cacheSlots = 16);
+	// We'll disallow moving and copying, since we own GPU resources
+	VirtualTexture(const VirtualTexture& other) = delete;
+	VirtualTexture(VirtualTexture&& other) = delete;
+	VirtualTexture& operator=(const VirtualTexture& other) = delete;
+	VirtualTexture& operator=(VirtualTexture&& other) = delete;
+
+public:
+	// How many times smaller than the view the feedback image is along each axis
+	static const uint32_t FEEDBACK_SCALE = 8;
+	// The number of feedback copies that can be on their way back from the GPU at once
+	static const int RING_SIZE = 3;
+	// The most pages that can be loading on the workers at once
+	static const uint32_t MAX_LOADS = 32;
+	// The most pages that get copied into the cache in a single Update
+	static const uint32_t MAX_UPLOADS = 16;
+
+	/// <summary>
+	/// Fills a rectangle of one level of a virtual texture while it's being cooked, with RGBA8 pixels in rows. The
+	/// rectangle can reach past the edges of the level for the page borders, what goes there is up to the source
+	/// </summary>
+	typedef std::function<void(uint32_t level, int32_t x, int32_t y, uint32_t width, uint32_t height, uint8_t* pixels)> CookSource;
+
+	/// <summary>
+	/// What the cache did over the last Update
+	/// </summary>
+	struct Stats {
+		// The pages in the cache, and how many it can hold
+		uint32_t Resident = 0;
+		uint32_t Capacity = 0;
+		// The different pages the feedback asked for
+		uint32_t Requested = 0;
+		// The pages loading on the workers
+		uint32_t Loading = 0;
+		// The pages copied into the cache, and the ones they replaced
+		uint32_t Uploaded = 0;
+		uint32_t Evicted = 0;
+	};
+
+	VirtualTexture(const MappedFile::sptr& file, uint32_t cacheSlots);
+	~VirtualTexture();
+
+	/// <summary>
+	/// Cooks a virtual texture into the tiled file Load reads. The levels are filled one row of pages at a time, the
+	/// pages in each row in parallel on the ThreadPool, so the whole image never has to fit in memory
+	/// </summary>
+	/// <param name="path">The path to write the file to</param>
+	/// <param name="size">The width and height of the largest level, a power of two that's a multiple of the page size</param>
+	/// <param name="source">Fills in each page along with it's border</param>
+	/// <param name="pageSize">The texels along each side of a page, not counting the border</param>
+	/// <param name="border">The texels each page repeats from it's neighbours, so filtering never reads past a page</param>
+	/// <returns>True if the file was written</returns>
+	static bool Cook(const std::string& path, uint32_t size, const CookSource& source, uint32_t pageSize = 128, uint32_t border = 4);
+
+	/// <summary>
+	/// Hands the page table and cache to a material drawn with the VIRTUAL_TEXTURE variant, the texture is laid over
+	/// an area of the world from above (Z up). The material gets it's feedback settings updated each frame
+	/// </summary>
+	/// <param name="material">The material to sample the texture with</param>
+	/// <param name="regionMin">The corner of the area with the smallest X and Y</param>
+	/// <param name="regionSize">The length of the area's sides</param>
+	void Bind(const std::shared_ptr<ShaderMaterial>& material, const glm::vec2& regionMin, float regionSize);
+
+	/// <summary>
+	/// Clears the feedback image for a view of a size and binds it for the shader to write to
+	/// </summary>
+	/// <param name="width">The width of the view, in pixels</param>
+	/// <param name="height">The height of the view, in pixels</param>
+	void BeginFrame(int width, int height);
+	/// <summary>
+	/// Copies the feedback into the ring so Update can read it back once the GPU gets to it. Should be called once
+	/// everything sampling the texture has been drawn. If the ring is full the frame's feedback is skipped
+	/// </summary>
+	void EndFrame();
+	/// <summary>
+	/// Reads back the feedback the GPU has finished with, starts loading the pages it asked for that aren't in the cache
+	/// yet, and copies the pages the workers have finished into it. Should be called once a frame on the main thread
+	/// </summary>
+	void Update();
+
+	uint32_t GetSize() const { return _size; }
+	uint32_t GetLevelCount() const { return _levelCount; }
+	const Texture2D::sptr& GetPageTable() const { return _pageTable; }
+	const Texture2D::sptr& GetCache() const { return _cache; }
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	// A page in the cache
+	struct Slot {
+		// The page's key (see _MakeKey), or UINT32_MAX if the slot is empty
+		uint32_t Page;
+		// The last Update the page was asked for in
+		uint64_t LastUsed;
+	};
+	// A page being read from the file on the I/O threads
+	struct PageLoad {
+		uint32_t                     Page;
+		Task<VirtualFile::sptr>      Pixels;
+		// Cancelled once the feedback stops asking for the page, so reads nobody wants anymore don't hold up the rest
+		IoCancelToken::sptr          Cancel;
+	};
+	// A copy of the feedback on it's way back from the GPU
+	struct Readback {
+		GLuint    Buffer;
+		size_t    Size;
+		// Persistently mapped, read once the fence has passed
+		uint32_t* Data;
+		GLsync    Fence;
+		int       Width;
+		int       Height;
+	};
+
+	MappedFile::sptr _file;
+	uint32_t         _size;
+	uint32_t         _pageSize;
+	uint32_t         _border;
+	uint32_t         _levelCount;
+	// Where each level's pages start in the file, counted in pages
+	std::vector<size_t> _levelOffsets;
+
+	Texture2D::sptr  _pageTable;
+	Texture2D::sptr  _cache;
+	uint32_t         _cacheSlots;
+	std::vector<Slot> _slots;
+	// The slot each page is in, level by level from the largest, or UINT32_MAX for pages that aren't in the cache
+	std::vector<std::vector<uint32_t>> _residency;
+	bool             _isTableDirty;
+	std::vector<PageLoad> _loads;
+
+	GLuint           _feedback;
+	int              _feedbackWidth;
+	int              _feedbackHeight;
+	Readback         _ring[RING_SIZE];
+	int              _nextReadback;
+	uint64_t         _frame;
+	std::vector<std::shared_ptr<ShaderMaterial>> _materials;
+	Stats            _stats;
+
+	// Packs a page's level and position into a single value, which is also what the shader writes as feedback
+	static uint32_t _MakeKey(uint32_t level, uint32_t x, uint32_t y) { return (level << 28) | (y << 14) | x; }
+	// Gets the number of pages along each side of a level
+	uint32_t _GetPageCount(uint32_t level) const { return (_size >> level) / _pageSize; }
+	// Gets how far into the file a page's pixels start
+	size_t _GetPageOffset(uint32_t key) const;
+
+	// Asks for the pages in some feedback, touching the ones in the cache and loading the rest
+	void _Request(const uint32_t* feedback, size_t count);
+	// Copies a loaded page into the least recently used slot, returns false if every slot is still in use
+	bool _Upload(uint32_t key, const uint8_t* pixels);
+	// Writes the page table again from the pages in the cache, each texel pointing at it's page or the closest
+	// coarser page that's there
+	void _UpdatePageTable();
+	// Makes the feedback image fit a view of a size
+	void _ResizeFeedback(int width, int height);
+};
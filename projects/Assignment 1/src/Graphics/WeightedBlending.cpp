@@ -0,0 +1,156 @@
+#include "WeightedBlending.h"
+
+#include <algorithm>
+
+#include "GpuResources.h"
+#include "Logging.h"
+#include "PipelineState.h"
+#include "RenderState.h"
+#include "RenderStats.h"
+
+WeightedBlending::WeightedBlending() :
+	_isReady(false),
+	_framebuffer(0),
+	_accumulation(0),
+	_revealage(0),
+	_copiedDepth(0),
+	_attachedDepth(0),
+	_emptyVao(0),
+	_width(0),
+	_height(0),
+	_copiedWidth(0),
+	_copiedHeight(0),
+	_previousFramebuffer(0)
+{
+	GPU_RESOURCE_OWNER("WeightedBlending");
+	_compositeShader = Shader::Create();
+	_compositeShader->LoadShaderPartFromFile("shaders/fullscreen.vert.glsl", GL_VERTEX_SHADER);
+	_compositeShader->LoadShaderPartFromFile("shaders/weighted_composite.frag.glsl", GL_FRAGMENT_SHADER);
+	_isReady = _compositeShader->Link();
+	if (!_isReady) {
+		LOG_WARN("Weighted blending composite shader failed to compile, blended materials will be sorted instead");
+	}
+
+	glCreateFramebuffers(1, &_framebuffer);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glNamedFramebufferDrawBuffers(_framebuffer, 2, drawBuffers);
+	glCreateVertexArrays(1, &_emptyVao);
+}
+
+WeightedBlending::~WeightedBlending() {
+	_DeleteTargets();
+	_DeleteCopiedDepth();
+	glDeleteFramebuffers(1, &_framebuffer);
+	RenderState::OnVertexArrayDeleted(_emptyVao);
+	glDeleteVertexArrays(1, &_emptyVao);
+}
+
+void WeightedBlending::_DeleteTargets() {
+	const GLuint textures[2] = { _accumulation, _revealage };
+	for (GLuint texture : textures) {
+		if (texture != 0) {
+			RenderState::OnTextureDeleted(texture);
+			GpuResources::RemoveRaw(GL_TEXTURE, texture);
+		}
+	}
+	glDeleteTextures(2, textures);
+	_accumulation = _revealage = 0;
+}
+
+void WeightedBlending::_DeleteCopiedDepth() {
+	if (_copiedDepth != 0) {
+		RenderState::OnTextureDeleted(_copiedDepth);
+		GpuResources::RemoveRaw(GL_TEXTURE, _copiedDepth);
+		glDeleteTextures(1, &_copiedDepth);
+		_copiedDepth = 0;
+	}
+}
+
+void WeightedBlending::Begin(GLuint depth, int width, int height) {
+	GPU_RESOURCE_OWNER("WeightedBlending");
+	width = std::max(width, 1);
+	height = std::max(height, 1);
+	if (width > _width || height > _height) {
+		_DeleteTargets();
+		_width = std::max(width, _width);
+		_height = std::max(height, _height);
+		// Every pixel gets read exactly once, so there's no need for filtering or mips
+		const GLenum formats[2] = { GL_RGBA16F, GL_R8 };
+		const char* names[2] = { "OIT Accumulation", "OIT Revealage" };
+		const size_t sizes[2] = { 8, 1 };
+		GLuint* textures[2] = { &_accumulation, &_revealage };
+		for (int ix = 0; ix < 2; ix++) {
+			glCreateTextures(GL_TEXTURE_2D, 1, textures[ix]);
+			glTextureStorage2D(*textures[ix], 1, formats[ix], _width, _height);
+			glTextureParameteri(*textures[ix], GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTextureParameteri(*textures[ix], GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			GpuResources::AddRaw(GL_TEXTURE, *textures[ix], static_cast<size_t>(_width) * _height * sizes[ix], names[ix]);
+		}
+		glNamedFramebufferTexture(_framebuffer, GL_COLOR_ATTACHMENT0, _accumulation, 0);
+		glNamedFramebufferTexture(_framebuffer, GL_COLOR_ATTACHMENT1, _revealage, 0);
+	}
+
+	// The scene might be going into an offscreen target (ex: PostProcessing) rather than the screen
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_previousFramebuffer);
+
+	// The screen's depth can't be attached to our framebuffer, so it gets copied into a texture of the same format
+	// (the window asks for 24 bit depth and 8 bit stencil), which a depth blit needs
+	const bool isCopied = depth == 0;
+	if (isCopied) {
+		if (width != _copiedWidth || height != _copiedHeight) {
+			_DeleteCopiedDepth();
+			_copiedWidth = width;
+			_copiedHeight = height;
+			glCreateTextures(GL_TEXTURE_2D, 1, &_copiedDepth);
+			glTextureStorage2D(_copiedDepth, 1, GL_DEPTH24_STENCIL8, width, height);
+			GpuResources::AddRaw(GL_TEXTURE, _copiedDepth, static_cast<size_t>(width) * height * 4, "OIT Depth Copy");
+		}
+		depth = _copiedDepth;
+	}
+	// The framebuffer is only as big as it's smallest attachment, so a smaller scene's depth limits it to that scene
+	if (depth != _attachedDepth) {
+		glNamedFramebufferTexture(_framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, 0, 0);
+		glNamedFramebufferTexture(_framebuffer, isCopied ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, depth, 0);
+		_attachedDepth = depth;
+		if (glCheckNamedFramebufferStatus(_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR("Weighted blending targets are incomplete at {}x{}", width, height);
+		}
+	}
+	if (isCopied) {
+		glBlitNamedFramebuffer(_previousFramebuffer, _framebuffer, 0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	// Nothing has been added yet, and all of the scene shows through
+	const float clearAccumulation[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const float clearRevealage[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glClearNamedFramebufferfv(_framebuffer, GL_COLOR, 0, clearAccumulation);
+	glClearNamedFramebufferfv(_framebuffer, GL_COLOR, 1, clearRevealage);
+
+	// The accumulation adds up, and the revealage gets multiplied by (1 - alpha). The materials leave the blend
+	// functions alone (see PipelineState::OrderIndependent), so these hold until End
+	RenderState::SetEnabled(GL_BLEND, true);
+	RenderState::SetBlendFunc(GL_ONE, GL_ONE);
+	glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+}
+
+void WeightedBlending::End() {
+	// Put the revealage's blend function back in line with the rest, which is what the state tracker thinks it is
+	glBlendFunci(1, GL_ONE, GL_ONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, _previousFramebuffer);
+}
+
+void WeightedBlending::Composite() {
+	_compositeShader->Bind();
+	const GLuint textures[2] = { _accumulation, _revealage };
+	const GLuint samplers[2] = { 0, 0 };
+	RenderState::BindTextureUnits(ACCUMULATION_UNIT, 2, textures);
+	RenderState::BindSamplers(ACCUMULATION_UNIT, 2, samplers);
+	// The average color goes over the scene by how much of it was covered, everywhere at once
+	PipelineState state = PipelineState::AlphaBlended();
+	state.DepthTest = false;
+	RenderState::ApplyPipeline(state);
+	RenderState::BindVertexArray(_emptyVao);
+	RenderStats::CountDraw(3);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
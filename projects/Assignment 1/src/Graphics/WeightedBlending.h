@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+#include "Shader.h"
+
+/// <summary>
+/// Draws blended geometry without sorting it, using weighted blended order independent transparency (McGuire and
+/// Bavoil, 2013). Each blended fragment is added into two targets, weighted by how close and how opaque it is:
+///
+///     0: RGBA16F  accumulation, the sum of the weighted premultiplied colors (rgb) and weighted alphas (a)
+///     1: R8       revealage, the product of (1 - alpha), so how much of the scene behind still shows through
+///
+/// Then a full screen pass averages the accumulation and blends it over the scene by the revealage. Since both
+/// targets only add and multiply, the order the fragments come in doesn't matter, so the blended renderers can be
+/// batched and instanced like the opaque ones. Surfaces close together in depth get averaged rather than layered,
+/// which is the price of not sorting
+///
+/// Materials opt in with PipelineState::WeightedBlended, and draw with the WEIGHTED_BLEND variant of our Blinn-Phong
+/// shader, which writes the two targets instead of a color
+///
+/// Usage: Begin with the scene's depth, draw the weighted materials, End, then Composite over the scene
+/// </summary>
+class WeightedBlending final
+{
+public:
+	typedef std::shared_ptr<WeightedBlending> sptr;
+	static inline sptr Create() {
+		return std::make_shared<WeightedBlending>();
+	}
+	// We'll disallow moving and copying, since we own GPU resources
+	WeightedBlending(const WeightedBlending& other) = delete;
+	WeightedBlending(WeightedBlending&& other) = delete;
+	WeightedBlending& operator=(const WeightedBlending& other) = delete;
+	WeightedBlending& operator=(WeightedBlending&& other) = delete;
+
+public:
+	// The texture units the composite reads the targets from, it runs after the scene so it can use any of them
+	static const int ACCUMULATION_UNIT = 0;
+	static const int REVEALAGE_UNIT = 1;
+
+	/// <summary>
+	/// Creates the framebuffer and compiles the composite shader, the targets get created the first time Begin knows
+	/// how big they need to be
+	/// </summary>
+	WeightedBlending();
+	~WeightedBlending();
+
+	/// <summary>
+	/// Returns true if the composite shader compiled, if not blended materials should be sorted instead
+	/// </summary>
+	bool IsReady() const { return _isReady; }
+
+	/// <summary>
+	/// Binds and clears the targets, with the scene's depth attached so the blended fragments are tested against it.
+	/// The targets only ever grow, so views of different sizes can share them
+	/// </summary>
+	/// <param name="depth">The depth texture of the scene being drawn, or 0 to take a copy of the bound framebuffer's depth (ex: the screen's)</param>
+	/// <param name="width">The width of the scene, in pixels</param>
+	/// <param name="height">The height of the scene, in pixels</param>
+	void Begin(GLuint depth, int width, int height);
+	/// <summary>
+	/// Goes back to drawing to whatever was bound when Begin was called
+	/// </summary>
+	void End();
+	/// <summary>
+	/// Blends what was drawn between Begin and End over the bound framebuffer with a full screen triangle
+	/// </summary>
+	void Composite();
+
+	/// <summary>
+	/// Gets the number of bytes the targets take up per pixel
+	/// </summary>
+	static uint32_t GetBytesPerPixel() { return 8 + 1; }
+
+protected:
+	Shader::sptr _compositeShader;
+	bool         _isReady;
+
+	GLuint _framebuffer;
+	GLuint _accumulation;
+	GLuint _revealage;
+	// Our own copy of the depth, for scenes whose depth isn't a texture we can attach
+	GLuint _copiedDepth;
+	// The depth that's attached, so we only re-attach when it changes
+	GLuint _attachedDepth;
+	// The composite has no vertices, but drawing still needs a vertex array bound
+	GLuint _emptyVao;
+	int    _width;
+	int    _height;
+	int    _copiedWidth;
+	int    _copiedHeight;
+	// What was being drawn to before Begin, the composite draws into it
+	GLint  _previousFramebuffer;
+
+	// Deletes the targets, if they exist
+	void _DeleteTargets();
+	// Deletes our copy of the depth, if it exists
+	void _DeleteCopiedDepth();
+};
@@ -0,0 +1,265 @@
+#include "AssetArchive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gzip/compress.hpp>
+#include <gzip/decompress.hpp>
+
+#include "Logging.h"
+
+// The start of every archive, the table of contents and the name table come after all of the entries so the
+// archive can be written in one pass
+struct ArchiveHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t EntryCount;
+	uint64_t TocOffset;
+	uint64_t NamesOffset;
+	uint64_t NamesSize;
+};
+
+static const uint32_t ARCHIVE_MAGIC   = 'T' | ('P' << 8) | ('A' << 16) | ('K' << 24);
+// Bump this whenever the layout of the archive changes
+static const uint32_t ARCHIVE_VERSION = 1;
+// Compressing an entry has to save at least this much to be worth inflating it on every load, otherwise it's stored
+// as is (ex: PNGs and JPGs are already compressed)
+static const float    ARCHIVE_MIN_SAVING = 0.1f;
+
+static uint64_t AlignEntry(uint64_t offset) {
+	return (offset + AssetArchive::ENTRY_ALIGNMENT - 1) & ~(AssetArchive::ENTRY_ALIGNMENT - 1);
+}
+
+// 64 bit FNV-1a, which is plenty for a few thousand paths and the names get compared anyways
+static uint64_t HashPath(std::string_view path) {
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : path) {
+		hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string AssetArchive::NormalizePath(std::string_view path) {
+	std::string result(path);
+	std::replace(result.begin(), result.end(), '\\', '/');
+	while (result.compare(0, 2, "./") == 0) {
+		result.erase(0, 2);
+	}
+	return result;
+}
+
+AssetArchive::sptr AssetArchive::Open(const std::string& path) {
+	MappedFile::sptr file = MappedFile::Open(path);
+	if (file == nullptr) {
+		return nullptr;
+	}
+
+	// Everything in the table of contents gets checked up front, so lookups don't need to worry about bad offsets
+	const char* data = file->GetData();
+	const uint64_t size = file->GetSize();
+	ArchiveHeader header;
+	if (size < sizeof(ArchiveHeader)) {
+		LOG_WARN("Asset archive \"{}\" is corrupted", path);
+		return nullptr;
+	}
+	memcpy(&header, data, sizeof(ArchiveHeader));
+	if (header.Magic != ARCHIVE_MAGIC || header.Version != ARCHIVE_VERSION) {
+		LOG_WARN("Asset archive \"{}\" is not an archive, or was packed by a different version", path);
+		return nullptr;
+	}
+	if (header.TocOffset % alignof(Entry) != 0 ||
+		header.TocOffset + header.EntryCount * sizeof(Entry) > size ||
+		header.NamesOffset + header.NamesSize > size)
+	{
+		LOG_WARN("Asset archive \"{}\" is corrupted", path);
+		return nullptr;
+	}
+
+	sptr result = std::make_shared<AssetArchive>();
+	result->_file = file;
+	result->_entries = reinterpret_cast<const Entry*>(data + header.TocOffset);
+	result->_entryCount = static_cast<size_t>(header.EntryCount);
+	result->_names = data + header.NamesOffset;
+	result->_namesSize = header.NamesSize;
+	for (size_t ix = 0; ix < result->_entryCount; ix++) {
+		const Entry& entry = result->_entries[ix];
+		const bool compressed = entry.Method == Compression::Gzip;
+		if (entry.Offset % ENTRY_ALIGNMENT != 0 || entry.Offset + entry.StoredSize > size ||
+			static_cast<uint64_t>(entry.NameOffset) + entry.NameLength > header.NamesSize ||
+			(entry.Method != Compression::None && !compressed) ||
+			(compressed && entry.ChunkCount != (entry.Size + CHUNK_SIZE - 1) / CHUNK_SIZE) ||
+			(compressed && entry.ChunkCount * sizeof(uint64_t) > entry.StoredSize) ||
+			(!compressed && entry.StoredSize != entry.Size) ||
+			(ix > 0 && result->_entries[ix - 1].PathHash > entry.PathHash))
+		{
+			LOG_WARN("Asset archive \"{}\" is corrupted", path);
+			return nullptr;
+		}
+	}
+	LOG_INFO("Mounted {} assets from \"{}\"", result->_entryCount, path);
+	return result;
+}
+
+uint32_t AssetArchive::Pack(const std::string& folder, const std::string& archivePath, bool compress) {
+	namespace fs = std::filesystem;
+
+	// Gather everything first, so the archive itself (which may be in the folder) can be left out
+	std::error_code error;
+	std::vector<fs::path> files;
+	for (const auto& item : fs::recursive_directory_iterator(folder, error)) {
+		std::error_code sameError;
+		if (item.is_regular_file() && !fs::equivalent(item.path(), archivePath, sameError)) {
+			files.push_back(item.path());
+		}
+	}
+	if (error) {
+		LOG_WARN("Failed to search \"{}\" for assets: {}", folder, error.message());
+		return 0;
+	}
+
+	std::ofstream stream(archivePath, std::ios::binary | std::ios::trunc);
+	if (!stream.is_open()) {
+		LOG_WARN("Failed to open \"{}\" for writing", archivePath);
+		return 0;
+	}
+	const char padding[ENTRY_ALIGNMENT] = { 0 };
+	// The header gets written last, once we know where everything is
+	stream.write(padding, ENTRY_ALIGNMENT);
+	uint64_t offset = ENTRY_ALIGNMENT;
+
+	std::vector<Entry> entries;
+	std::string names;
+	std::vector<std::string> chunks;
+	std::vector<uint64_t> chunkEnds;
+	uint64_t totalSize = 0, totalStored = 0;
+	for (const fs::path& file : files) {
+		MappedFile::sptr source = MappedFile::Open(file.string());
+		if (source == nullptr) {
+			LOG_WARN("Failed to read \"{}\", it won't be packed", file.string());
+			continue;
+		}
+		const std::string name = NormalizePath(fs::relative(file, folder, error).generic_string());
+
+		Entry entry;
+		entry.PathHash = HashPath(name);
+		entry.Offset = offset;
+		entry.Size = source->GetSize();
+		entry.NameOffset = static_cast<uint32_t>(names.size());
+		entry.NameLength = static_cast<uint32_t>(name.size());
+		entry.Method = Compression::None;
+		entry.ChunkCount = 0;
+		names += name;
+
+		// Each chunk is compressed on it's own so readers can start anywhere, the chunk table stores where each one ends
+		uint64_t compressedSize = 0;
+		chunks.clear();
+		chunkEnds.clear();
+		if (compress) {
+			for (uint64_t start = 0; start < entry.Size; start += CHUNK_SIZE) {
+				const uint64_t length = std::min(CHUNK_SIZE, entry.Size - start);
+				chunks.push_back(gzip::compress(source->GetData() + start, length, Z_BEST_COMPRESSION));
+				compressedSize += chunks.back().size();
+				chunkEnds.push_back(compressedSize);
+			}
+			compressedSize += chunkEnds.size() * sizeof(uint64_t);
+		}
+		if (compress && entry.Size > 0 && compressedSize < entry.Size * (1.0f - ARCHIVE_MIN_SAVING)) {
+			entry.Method = Compression::Gzip;
+			entry.ChunkCount = static_cast<uint32_t>(chunks.size());
+			entry.StoredSize = compressedSize;
+			stream.write(reinterpret_cast<const char*>(chunkEnds.data()), chunkEnds.size() * sizeof(uint64_t));
+			for (const std::string& chunk : chunks) {
+				stream.write(chunk.data(), chunk.size());
+			}
+		} else {
+			entry.StoredSize = entry.Size;
+			stream.write(source->GetData(), entry.Size);
+		}
+		offset = AlignEntry(entry.Offset + entry.StoredSize);
+		stream.write(padding, offset - (entry.Offset + entry.StoredSize));
+		totalSize += entry.Size;
+		totalStored += entry.StoredSize;
+		entries.push_back(entry);
+	}
+
+	// Sorting by hash lets Find binary search the table
+	std::sort(entries.begin(), entries.end(), [](const Entry& l, const Entry& r) { return l.PathHash < r.PathHash; });
+	ArchiveHeader header;
+	header.Magic = ARCHIVE_MAGIC;
+	header.Version = ARCHIVE_VERSION;
+	header.EntryCount = entries.size();
+	header.TocOffset = offset;
+	header.NamesOffset = offset + entries.size() * sizeof(Entry);
+	header.NamesSize = names.size();
+	stream.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+	stream.write(names.data(), names.size());
+	stream.seekp(0);
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(ArchiveHeader));
+	if (!stream.good()) {
+		LOG_WARN("Failed to write \"{}\"", archivePath);
+		return 0;
+	}
+	LOG_INFO("Packed {} files into \"{}\" ({} KB -> {} KB)", entries.size(), archivePath, totalSize / 1024, totalStored / 1024);
+	return static_cast<uint32_t>(entries.size());
+}
+
+const AssetArchive::Entry* AssetArchive::Find(const std::string& path) const {
+	const std::string name = NormalizePath(path);
+	const uint64_t hash = HashPath(name);
+	const Entry* end = _entries + _entryCount;
+	const Entry* it = std::lower_bound(_entries, end, hash, [](const Entry& entry, uint64_t value) { return entry.PathHash < value; });
+	for (; it != end && it->PathHash == hash; ++it) {
+		if (std::string_view(_names + it->NameOffset, it->NameLength) == name) {
+			return it;
+		}
+	}
+	return nullptr;
+}
+
+const char* AssetArchive::GetStoredData(const Entry& entry) const {
+	return entry.Method == Compression::None ? _file->GetData() + entry.Offset : nullptr;
+}
+
+bool AssetArchive::ReadRange(const Entry& entry, uint64_t offset, uint64_t size, std::string& result) const {
+	result.clear();
+	if (offset >= entry.Size) {
+		return true;
+	}
+	size = std::min(size, entry.Size - offset);
+	const char* data = _file->GetData() + entry.Offset;
+	if (entry.Method == Compression::None) {
+		result.assign(data + offset, size);
+		return true;
+	}
+
+	// Entries are page aligned, so the chunk table is safe to read in place
+	const uint64_t* chunkEnds = reinterpret_cast<const uint64_t*>(data);
+	const char* chunkData = data + entry.ChunkCount * sizeof(uint64_t);
+	const uint64_t chunkDataSize = entry.StoredSize - entry.ChunkCount * sizeof(uint64_t);
+	result.reserve(size);
+	std::string chunk;
+	for (uint64_t ix = offset / CHUNK_SIZE; ix <= (offset + size - 1) / CHUNK_SIZE; ix++) {
+		const uint64_t start = ix == 0 ? 0 : chunkEnds[ix - 1];
+		if (start > chunkEnds[ix] || chunkEnds[ix] > chunkDataSize) {
+			LOG_WARN("Asset \"{}\" is corrupted", std::string_view(_names + entry.NameOffset, entry.NameLength));
+			return false;
+		}
+		try {
+			chunk = gzip::decompress(chunkData + start, chunkEnds[ix] - start);
+		} catch (const std::exception& e) {
+			LOG_WARN("Failed to inflate \"{}\": {}", std::string_view(_names + entry.NameOffset, entry.NameLength), e.what());
+			return false;
+		}
+		// Only keep the part of the chunk that overlaps the range
+		const uint64_t chunkStart = ix * CHUNK_SIZE;
+		const uint64_t from = std::max(offset, chunkStart) - chunkStart;
+		const uint64_t to = std::min<uint64_t>(offset + size - chunkStart, chunk.size());
+		if (from >= to) {
+			LOG_WARN("Asset \"{}\" is corrupted", std::string_view(_names + entry.NameOffset, entry.NameLength));
+			return false;
+		}
+		result.append(chunk, from, to - from);
+	}
+	return result.size() == size;
+}
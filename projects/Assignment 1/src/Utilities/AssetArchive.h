@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.h"
+
+/// <summary>
+/// A read only pack of many assets in a single file, so a launch can map one file instead of opening hundreds of
+/// small ones. The table of contents is sorted by a hash of each entry's path, so looking an entry up is a binary
+/// search. Entries start on 4 KB boundaries, so uncompressed entries can be used straight out of the mapping.
+/// Compressed entries are split into chunks that are gzipped separately, so any part of an entry can be read
+/// without inflating everything before it
+///
+/// Archives are built by the cook step (--pack-assets), and read through the VirtualFileSystem
+/// </summary>
+class AssetArchive final
+{
+public:
+	AssetArchive(const AssetArchive& other) = delete;
+	AssetArchive(AssetArchive&& other) = delete;
+	AssetArchive& operator=(const AssetArchive& other) = delete;
+	AssetArchive& operator=(AssetArchive&& other) = delete;
+	typedef std::shared_ptr<AssetArchive> sptr;
+
+	// Entries start on multiples of this, so they line up with pages in the mapping
+	static const uint64_t ENTRY_ALIGNMENT = 4096;
+	// The number of uncompressed bytes in each compressed chunk
+	static const uint64_t CHUNK_SIZE      = 64 * 1024;
+
+	/// <summary>
+	/// How an entry is stored in the archive
+	/// </summary>
+	enum class Compression : uint32_t {
+		None = 0,
+		Gzip = 1
+	};
+
+	/// <summary>
+	/// A single file in the archive, as it's stored in the table of contents
+	/// </summary>
+	struct Entry {
+		// The FNV-1a hash of the entry's normalized path, the table is sorted by this
+		uint64_t    PathHash;
+		// Where the entry's data starts in the archive
+		uint64_t    Offset;
+		// The number of bytes the entry takes up in the archive, including it's chunk table if it's compressed
+		uint64_t    StoredSize;
+		// The number of bytes in the original file
+		uint64_t    Size;
+		// Where the entry's path is in the name table, so hash collisions can be told apart
+		uint32_t    NameOffset;
+		uint32_t    NameLength;
+		Compression Method;
+		// The number of chunks the entry was compressed in, 0 if it isn't compressed
+		uint32_t    ChunkCount;
+	};
+
+	/// <summary>
+	/// Maps an archive into memory and checks that it's table of contents is intact
+	/// </summary>
+	/// <param name="path">The path to the archive</param>
+	/// <returns>The archive, or nullptr if it doesn't exist or is corrupted</returns>
+	static sptr Open(const std::string& path);
+	/// <summary>
+	/// Packs every file in a folder and all of it's sub-folders into an archive. Paths in the archive are relative to
+	/// the folder, so packing the working directory lets the loaders find assets under the same paths as before
+	/// </summary>
+	/// <param name="folder">The folder to pack</param>
+	/// <param name="archivePath">The path to write the archive to</param>
+	/// <param name="compress">True to gzip the entries that get smaller from it, false to store everything as is</param>
+	/// <returns>The number of files that were packed, or 0 if the archive couldn't be written</returns>
+	static uint32_t Pack(const std::string& folder, const std::string& archivePath, bool compress = true);
+
+	/// <summary>
+	/// Converts a path to the form it's stored as in archives, with forward slashes and no leading ./
+	/// </summary>
+	static std::string NormalizePath(std::string_view path);
+
+	/// <summary>
+	/// Finds the entry with the given path
+	/// </summary>
+	/// <param name="path">The path of the file, relative to the folder that was packed</param>
+	/// <returns>The entry, or nullptr if the archive doesn't have the file</returns>
+	const Entry* Find(const std::string& path) const;
+	/// <summary>
+	/// Reads part of an entry. Only the chunks that overlap the range get inflated
+	/// </summary>
+	/// <param name="entry">The entry to read, from Find</param>
+	/// <param name="offset">The first byte to read, in the original file</param>
+	/// <param name="size">The number of bytes to read, clamped to the end of the file</param>
+	/// <param name="result">Will store the bytes that were read</param>
+	/// <returns>False if the entry's data is corrupted</returns>
+	bool ReadRange(const Entry& entry, uint64_t offset, uint64_t size, std::string& result) const;
+	/// <summary>
+	/// Gets a pointer to an uncompressed entry's data inside of the mapping, which stays valid as long as the archive
+	/// </summary>
+	/// <returns>The entry's data, or nullptr if the entry is compressed</returns>
+	const char* GetStoredData(const Entry& entry) const;
+
+	/// <summary>
+	/// Gets the memory mapping of the archive, so views into it can keep it alive
+	/// </summary>
+	const MappedFile::sptr& GetMapping() const { return _file; }
+	/// <summary>
+	/// Gets the number of files in the archive
+	/// </summary>
+	size_t GetEntryCount() const { return _entryCount; }
+
+	AssetArchive() = default;
+
+private:
+	MappedFile::sptr _file;
+	const Entry*     _entries = nullptr;
+	size_t           _entryCount = 0;
+	const char*      _names = nullptr;
+	uint64_t         _namesSize = 0;
+};
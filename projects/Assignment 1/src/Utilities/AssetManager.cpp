@@ -0,0 +1,371 @@
+#include "AssetManager.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "Graphics/GpuResources.h"
+#include "Graphics/TextureLoader.h"
+#include "MeshCook.h"
+#include "MemoryTracker.h"
+#include "Logging.h"
+#include "ObjLoader.h"
+#include "TraceRecorder.h"
+
+std::unordered_map<std::string, std::weak_ptr<VertexArrayObject>> AssetManager::_meshes;
+std::unordered_map<std::string, std::weak_ptr<Texture2D>>         AssetManager::_textures;
+std::unordered_map<std::string, std::weak_ptr<TextureCubeMap>>    AssetManager::_cubeMaps;
+std::unordered_map<std::string, std::weak_ptr<Shader>>            AssetManager::_shaders;
+std::unordered_map<const VertexArrayObject*, AssetManager::MeshSource> AssetManager::_meshSources;
+std::unordered_map<std::string, Task<VertexArrayObject::sptr>>    AssetManager::_loadingMeshes;
+std::unordered_map<std::string, Task<TextureCubeMapData::sptr>>   AssetManager::_prefetchedCubeMaps;
+uint32_t                                                          AssetManager::_hits = 0;
+
+// Drops the entries for assets that have been freed, so the caches don't keep growing as assets come and go
+template <typename T>
+static void PruneExpired(std::unordered_map<std::string, std::weak_ptr<T>>& cache) {
+	for (auto it = cache.begin(); it != cache.end();) {
+		it = it->second.expired() ? cache.erase(it) : std::next(it);
+	}
+}
+
+template <typename T>
+static uint32_t CountLoaded(const std::unordered_map<std::string, std::weak_ptr<T>>& cache) {
+	uint32_t result = 0;
+	for (const auto& entry : cache) {
+		result += entry.second.expired() ? 0 : 1;
+	}
+	return result;
+}
+
+template <typename T, typename LoadFunc>
+std::shared_ptr<T> AssetManager::_GetOrLoad(std::unordered_map<std::string, std::weak_ptr<T>>& cache, const std::string& key, LoadFunc load) {
+	auto it = cache.find(key);
+	if (it != cache.end()) {
+		std::shared_ptr<T> result = it->second.lock();
+		if (result != nullptr) {
+			_hits++;
+			return result;
+		}
+	}
+
+	std::shared_ptr<T> result = load();
+	// Only prune once in a while, we'd rather not walk the whole cache on every load
+	if (it == cache.end() && cache.size() >= 32 && (cache.size() & (cache.size() - 1)) == 0) {
+		PruneExpired(cache);
+	}
+	cache[key] = result;
+	return result;
+}
+
+VertexArrayObject::sptr AssetManager::GetMesh(const std::string& path, const glm::vec4& color, CpuResidency residency) {
+	const std::string key = _GetMeshKey(path, color);
+	// If it's already on it's way, it's quicker to wait for it than to start over
+	auto loading = _loadingMeshes.find(key);
+	if (loading != _loadingMeshes.end()) {
+		Task<VertexArrayObject::sptr> task = loading->second;
+		ThreadPool::Instance().Wait(task);
+		return task.HasFailed() ? nullptr : task.Get();
+	}
+	VertexArrayObject::sptr result = _GetOrLoad(_meshes, key, [&]() {
+		MEMORY_SCOPE(MemoryTag::Meshes);
+		GPU_RESOURCE_OWNER("Meshes");
+		VertexArrayObject::sptr mesh = ObjLoader::LoadFromFile(path, color, residency);
+		_SetTriangleSource(mesh, path, color, residency);
+		return mesh;
+	});
+	if (result != nullptr) {
+		_meshSources[result.get()] = { key, path, color, residency };
+	}
+	return result;
+}
+
+// What a worker hands back to the main thread for a mesh, either a decoded cooked sidecar or the parsed OBJ
+struct LoadedMesh {
+	CookedMesh::sptr                                  Cooked;
+	std::shared_ptr<MeshBuilder<VertexPosNormTexCol>> Parsed;
+	// Cooked meshes don't go through a builder, so their triangle tree gets built on it's own
+	TriangleBvh::sptr                                 Triangles;
+};
+
+// The part of loading a mesh that can run on a worker
+static LoadedMesh ParseMesh(const std::string& path, const glm::vec4& color, CpuResidency residency) {
+	AssetLoadScope load(path);
+	MEMORY_SCOPE(MemoryTag::Meshes);
+	LoadedMesh result;
+	// Same as ObjLoader, sidecars are cooked in white so other colors need the OBJ
+	if (color == glm::vec4(1.0f)) {
+		result.Cooked = MeshCook::OpenSidecar(path);
+	}
+	if (result.Cooked == nullptr) {
+		result.Parsed = std::make_shared<MeshBuilder<VertexPosNormTexCol>>();
+		ObjLoader::ParseFile(path, *result.Parsed, color);
+		result.Parsed->Optimize();
+		result.Parsed->BuildMeshlets();
+		result.Parsed->GenerateLods();
+		if (residency == CpuResidency::KeepCpuCopy) {
+			result.Parsed->BuildTriangleBvh();
+		}
+	} else if (residency == CpuResidency::KeepCpuCopy) {
+		result.Triangles = MeshCook::BuildTriangleBvh(result.Cooked);
+	}
+	return result;
+}
+
+// Creating the buffers needs the OpenGL context, so this part runs on the main thread
+static VertexArrayObject::sptr UploadMesh(const std::string& path, LoadedMesh& loaded) {
+	AssetLoadScope load("Upload " + path);
+	MEMORY_SCOPE(MemoryTag::Meshes);
+	GPU_RESOURCE_OWNER("Meshes");
+	if (loaded.Cooked != nullptr) {
+		VertexArrayObject::sptr result = MeshCook::UploadSidecar(loaded.Cooked);
+		result->SetTriangleBvh(loaded.Triangles);
+		return result;
+	}
+	return loaded.Parsed->Bake<VertexPackedPosNormTexCol>();
+}
+
+Task<VertexArrayObject::sptr> AssetManager::GetMeshAsync(const std::string& path, const glm::vec4& color, CpuResidency residency) {
+	const std::string key = _GetMeshKey(path, color);
+	auto loading = _loadingMeshes.find(key);
+	if (loading != _loadingMeshes.end()) {
+		// Loads that failed never reach the main thread to clean up after themselves, so we give them another go
+		if (!loading->second.IsDone()) {
+			_hits++;
+			return loading->second;
+		}
+		_loadingMeshes.erase(loading);
+	}
+	auto cached = _meshes.find(key);
+	if (cached != _meshes.end()) {
+		VertexArrayObject::sptr result = cached->second.lock();
+		if (result != nullptr) {
+			_hits++;
+			return Task<VertexArrayObject::sptr>::FromValue(result);
+		}
+	}
+
+	Task<VertexArrayObject::sptr> task = ThreadPool::Instance().Schedule([path, color, residency]() {
+		return ParseMesh(path, color, residency);
+	}).Then([key, path, color, residency](LoadedMesh& loaded) {
+		VertexArrayObject::sptr result = UploadMesh(path, loaded);
+		_SetTriangleSource(result, path, color, residency);
+		_meshes[key] = result;
+		_meshSources[result.get()] = { key, path, color, residency };
+		_loadingMeshes.erase(key);
+		return result;
+	}, JobThread::Main);
+
+	_loadingMeshes[key] = task;
+	return task;
+}
+
+Texture2D::sptr AssetManager::GetTexture(const std::string& path, const Texture2DDescription& description) {
+	return _GetOrLoad(_textures, _GetTextureKey(path, description), [&]() {
+		GPU_RESOURCE_OWNER("Textures");
+		return TextureLoader::LoadAsync(path, description);
+	});
+}
+
+Texture2D::sptr AssetManager::GetTextureOnDemand(const std::string& path, const Texture2DDescription& description) {
+	return _GetOrLoad(_textures, _GetTextureKey(path, description), [&]() {
+		GPU_RESOURCE_OWNER("Textures");
+		return TextureLoader::LoadOnDemand(path, description);
+	});
+}
+
+TextureCubeMap::sptr AssetManager::GetCubeMap(const std::string& path) {
+	const std::string key = _GetCanonicalPath(path);
+	return _GetOrLoad(_cubeMaps, key, [&]() {
+		GPU_RESOURCE_OWNER("Textures");
+		auto prefetched = _prefetchedCubeMaps.find(key);
+		if (prefetched == _prefetchedCubeMaps.end()) {
+			return TextureCubeMap::LoadFromImages(path);
+		}
+		Task<TextureCubeMapData::sptr> faces = prefetched->second;
+		_prefetchedCubeMaps.erase(prefetched);
+		ThreadPool::Instance().Wait(faces);
+		if (faces.HasFailed()) {
+			return TextureCubeMap::LoadFromImages(path);
+		}
+		AssetLoadScope load("Upload " + path);
+		return TextureCubeMap::CreateFromImages(path, faces.Get());
+	});
+}
+
+void AssetManager::PrefetchCubeMap(const std::string& path) {
+	const std::string key = _GetCanonicalPath(path);
+	if (_prefetchedCubeMaps.count(key) > 0) {
+		return;
+	}
+	_prefetchedCubeMaps[key] = ThreadPool::Instance().Schedule([path]() {
+		AssetLoadScope load(path);
+		MEMORY_SCOPE(MemoryTag::Textures);
+		return TextureCubeMapData::LoadFromImages(path);
+	});
+}
+
+Shader::sptr AssetManager::GetShader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines) {
+	std::string key = _GetCanonicalPath(vertexPath) + "|" + _GetCanonicalPath(fragmentPath);
+	for (const std::string& define : defines) {
+		key += "|" + define;
+	}
+	return _GetOrLoad(_shaders, key, [&]() {
+		Shader::sptr result = Shader::Create();
+		result->LoadShaderPartFromFile(vertexPath.c_str(), GL_VERTEX_SHADER, defines);
+		result->LoadShaderPartFromFile(fragmentPath.c_str(), GL_FRAGMENT_SHADER, defines);
+		result->LinkAsync();
+		return result;
+	});
+}
+
+bool AssetManager::GetMeshSource(const VertexArrayObject::sptr& mesh, std::string& path, glm::vec4& color) {
+	auto source = _meshSources.find(mesh.get());
+	if (source == _meshSources.end()) {
+		return false;
+	}
+	auto cached = _meshes.find(source->second.Key);
+	if (cached == _meshes.end() || cached->second.lock() != mesh) {
+		return false;
+	}
+	path  = source->second.Path;
+	color = source->second.Color;
+	return true;
+}
+
+uint32_t AssetManager::ReloadFile(const std::string& path) {
+	const std::string canonical = _GetCanonicalPath(path);
+	// Every key starts with the canonical path, followed by the options the asset was loaded with
+	const std::string prefix = canonical + "|";
+	const auto matches = [&](const std::string& key) { return key.compare(0, prefix.size(), prefix) == 0; };
+	uint32_t result = 0;
+
+	for (const auto& entry : _textures) {
+		Texture2D::sptr texture = entry.second.lock();
+		if (texture == nullptr || !matches(entry.first) || texture->GetSourcePath().empty()) {
+			continue;
+		}
+		// A texture that TextureResidency has shrunk reads the file again when it's restored, so it'll pick up the
+		// change then
+		if (texture->GetDroppedLevels() == 0) {
+			TextureLoader::ReloadAsync(texture);
+		}
+		result++;
+	}
+
+	for (const auto& entry : _cubeMaps) {
+		TextureCubeMap::sptr cubeMap = entry.second.lock();
+		if (cubeMap == nullptr) {
+			continue;
+		}
+		// Panoramas are loaded from the path itself
+		bool isFace = entry.first == canonical;
+		for (int face = 0; face < 6 && !isFace; face++) {
+			isFace = _GetCanonicalPath(TextureCubeMapData::GetFacePath(entry.first, (CubeMapFace)face)) == canonical;
+		}
+		if (!isFace) {
+			continue;
+		}
+		const std::string root = entry.first;
+		std::weak_ptr<TextureCubeMap> target = cubeMap;
+		ThreadPool::Instance().Schedule([root]() {
+			AssetLoadScope load(root);
+			MEMORY_SCOPE(MemoryTag::Textures);
+			return TextureCubeMapData::LoadFromImages(root);
+		}).Then([root, target](TextureCubeMapData::sptr& data) {
+			TextureCubeMap::sptr cubeMap = target.lock();
+			if (cubeMap != nullptr && data != nullptr) {
+				AssetLoadScope load("Upload " + root);
+				cubeMap->LoadData(data);
+			}
+			return true;
+		}, JobThread::Main);
+		result++;
+	}
+
+	for (const auto& entry : _meshes) {
+		VertexArrayObject::sptr mesh = entry.second.lock();
+		auto source = mesh != nullptr ? _meshSources.find(mesh.get()) : _meshSources.end();
+		if (source == _meshSources.end() || !matches(entry.first)) {
+			continue;
+		}
+		const std::string meshPath = source->second.Path;
+		const glm::vec4 color = source->second.Color;
+		const CpuResidency residency = source->second.Residency;
+		std::weak_ptr<VertexArrayObject> target = mesh;
+		ThreadPool::Instance().Schedule([meshPath, color, residency]() {
+			return ParseMesh(meshPath, color, residency);
+		}).Then([meshPath, color, residency, target](LoadedMesh& loaded) {
+			VertexArrayObject::sptr existing = target.lock();
+			if (existing == nullptr) {
+				return false;
+			}
+			// Swapping the contents over keeps every handle to the mesh (and it's entry in our caches) pointing at it
+			VertexArrayObject::sptr fresh = UploadMesh(meshPath, loaded);
+			existing->ReplaceWith(*fresh);
+			_SetTriangleSource(existing, meshPath, color, residency);
+			return true;
+		}, JobThread::Main);
+		result++;
+	}
+
+	result += Shader::Reload(path);
+	if (result > 0) {
+		LOG_INFO("Reloading {} asset(s) using \"{}\"", result, path);
+	}
+	return result;
+}
+
+uint32_t AssetManager::GetLoadedCount() {
+	return CountLoaded(_meshes) + CountLoaded(_textures) + CountLoaded(_cubeMaps) + CountLoaded(_shaders);
+}
+
+void AssetManager::_SetTriangleSource(const VertexArrayObject::sptr& mesh, const std::string& path, const glm::vec4& color, CpuResidency residency) {
+	if (mesh == nullptr || residency != CpuResidency::ReloadOnDemand) {
+		return;
+	}
+	mesh->SetTriangleSource([path, color]() -> TriangleBvh::sptr {
+		MEMORY_SCOPE(MemoryTag::Meshes);
+		// Same as loading, sidecars are cooked in white so other colors need the OBJ
+		if (color == glm::vec4(1.0f)) {
+			CookedMesh::sptr cooked = MeshCook::OpenSidecar(path);
+			if (cooked != nullptr) {
+				return MeshCook::BuildTriangleBvh(cooked);
+			}
+		}
+		// The triangles are numbered in the order they were drawn in, so we need to optimize the same way as loading
+		MeshBuilder<VertexPosNormTexCol> parsed;
+		ObjLoader::ParseFile(path, parsed, color);
+		parsed.Optimize();
+		parsed.BuildTriangleBvh();
+		return parsed.GetTriangleBvh();
+	});
+}
+
+std::string AssetManager::_GetTextureKey(const std::string& path, const Texture2DDescription& description) {
+	// The size comes from the file, but everything else in the description changes the texture we end up with
+	return _GetCanonicalPath(path) + "|" +
+		std::to_string(*description.Format) + "," +
+		std::to_string(*description.HorizontalWrap) + "," + std::to_string(*description.VerticalWrap) + "," +
+		std::to_string(*description.MinificationFilter) + "," + std::to_string(*description.MagnificationFilter) + "," +
+		std::to_string(description.MaxAnisotropic) + "," + std::to_string(description.GenerateMipMaps) + "," +
+		std::to_string(description.Compressible);
+}
+
+std::string AssetManager::_GetMeshKey(const std::string& path, const glm::vec4& color) {
+	return _GetCanonicalPath(path) + "|" +
+		std::to_string(color.r) + "," + std::to_string(color.g) + "," + std::to_string(color.b) + "," + std::to_string(color.a);
+}
+
+std::string AssetManager::_GetCanonicalPath(const std::string& path) {
+	std::error_code error;
+	std::filesystem::path result = std::filesystem::weakly_canonical(path, error);
+	if (error) {
+		return path;
+	}
+	std::string canonical = result.generic_string();
+#ifdef _WIN32
+	// Windows paths aren't case sensitive, so "Images/Grass.jpg" and "images/grass.jpg" are the same file
+	std::transform(canonical.begin(), canonical.end(), canonical.begin(), [](char c) { return (char)std::tolower(c); });
+#endif
+	return canonical;
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Graphics/Shader.h"
+#include "Graphics/Texture2D.h"
+#include "Graphics/TextureCubeMap.h"
+#include "Graphics/VertexArrayObject.h"
+#include "ThreadPool.h"
+
+/// <summary>
+/// Hands out shared handles to our meshes, textures, cubemaps and shaders, so that an asset used in many places
+/// only gets loaded once. Assets are keyed by their canonical path plus any options that change what gets loaded
+/// (ex: a mesh's vertex color, or a texture's sampling settings)
+///
+/// Like the ShaderStage cache, we only hold weak references. An asset is freed as soon as the last handle to it is
+/// released, and will be loaded again the next time it's asked for
+/// </summary>
+class AssetManager final
+{
+public:
+	/// <summary>
+	/// Gets a mesh loaded from an OBJ file (or it's cooked sidecar, see MeshCook). The residency decides whether
+	/// the tree over the mesh's triangles (for picking) stays in memory. By default it's only loaded again from the
+	/// file if something asks for it, since most meshes are never picked. A mesh that's already loaded keeps the
+	/// residency it was loaded with
+	/// </summary>
+	/// <param name="path">The path of the OBJ file</param>
+	/// <param name="color">The color to give every vertex in the mesh</param>
+	/// <param name="residency">Whether to keep the mesh's triangles in CPU memory</param>
+	static VertexArrayObject::sptr GetMesh(const std::string& path, const glm::vec4& color = glm::vec4(1.0f), CpuResidency residency = CpuResidency::ReloadOnDemand);
+	/// <summary>
+	/// Starts loading a mesh in the background, the file is read and parsed on a worker and the mesh is created on
+	/// the main thread. Asking for a mesh that is already loading hands back the same task
+	/// </summary>
+	/// <param name="path">The path of the OBJ file</param>
+	/// <param name="color">The color to give every vertex in the mesh</param>
+	/// <param name="residency">Whether to keep the mesh's triangles in CPU memory, see GetMesh</param>
+	/// <returns>A task that finishes on the main thread once the mesh has been created</returns>
+	static Task<VertexArrayObject::sptr> GetMeshAsync(const std::string& path, const glm::vec4& color = glm::vec4(1.0f), CpuResidency residency = CpuResidency::ReloadOnDemand);
+	/// <summary>
+	/// Gets a texture loaded from an image file. New textures are loaded in the background with TextureLoader
+	/// </summary>
+	/// <param name="path">The path of the image</param>
+	/// <param name="description">The sampling settings for the texture, the size and format come from the file</param>
+	static Texture2D::sptr GetTexture(const std::string& path, const Texture2DDescription& description = Texture2DDescription());
+	/// <summary>
+	/// Gets a texture that only loads it's image once something draws with it, see TextureLoader::LoadOnDemand. A
+	/// texture that's already loaded is handed back as it is
+	/// </summary>
+	/// <param name="path">The path of the image</param>
+	/// <param name="description">The sampling settings for the texture, the size and format come from the file</param>
+	static Texture2D::sptr GetTextureOnDemand(const std::string& path, const Texture2DDescription& description = Texture2DDescription());
+	/// <summary>
+	/// Gets a cubemap loaded from a set of images or a panorama, see TextureCubeMap::LoadFromImages
+	/// </summary>
+	/// <param name="path">The path of any one of the cubemap's faces, or of the panorama</param>
+	static TextureCubeMap::sptr GetCubeMap(const std::string& path);
+	/// <summary>
+	/// Starts loading a cubemap's faces on a worker, so they can be decoded before there's an OpenGL context to
+	/// upload them to (ex: while the window is being created). The next GetCubeMap of the same path waits for the
+	/// faces instead of loading them again
+	/// </summary>
+	/// <param name="path">The path of any one of the cubemap's faces</param>
+	static void PrefetchCubeMap(const std::string& path);
+	/// <summary>
+	/// Gets a shader program made from a vertex and fragment shader. New programs are linked with LinkAsync
+	/// </summary>
+	/// <param name="vertexPath">The path of the vertex shader</param>
+	/// <param name="fragmentPath">The path of the fragment shader</param>
+	/// <param name="defines">Extra #defines to add to both stages (ex: "USE_FOG" or "LIGHT_COUNT 4")</param>
+	static Shader::sptr GetShader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines = std::vector<std::string>());
+
+	/// <summary>
+	/// Finds the file and color a mesh was loaded with, so things that refer to the mesh can be saved
+	/// </summary>
+	/// <param name="mesh">A mesh handed out by GetMesh or GetMeshAsync</param>
+	/// <param name="path">Will store the path the mesh was loaded from</param>
+	/// <param name="color">Will store the color the mesh was loaded with</param>
+	/// <returns>True if the mesh came from the AssetManager, false otherwise</returns>
+	static bool GetMeshSource(const VertexArrayObject::sptr& mesh, std::string& path, glm::vec4& color);
+
+	/// <summary>
+	/// Loads every asset that uses a file again after it's been changed on disk, the new version is swapped into the
+	/// existing asset once it's ready so everything holding a handle to it picks up the change. Textures and cubemaps
+	/// are uploaded again, meshes are parsed again on a worker and shader programs that include the file are rebuilt
+	/// (see Shader::Reload). Must be called on the main thread
+	/// </summary>
+	/// <param name="path">The path of the file that changed</param>
+	/// <returns>The number of assets being reloaded</returns>
+	static uint32_t ReloadFile(const std::string& path);
+
+	/// <summary>
+	/// Gets the number of assets that are currently loaded (have at least one handle alive)
+	/// </summary>
+	static uint32_t GetLoadedCount();
+	/// <summary>
+	/// Gets the number of times an asset was asked for and was already loaded
+	/// </summary>
+	static uint32_t GetHitCount() { return _hits; }
+
+protected:
+	AssetManager() = default;
+
+	// Gets a path that will be the same for any spelling of the same file (ex: "./models/../models/a.obj" and "models/a.obj")
+	static std::string _GetCanonicalPath(const std::string& path);
+
+	// Gets the key we store a texture under
+	static std::string _GetTextureKey(const std::string& path, const Texture2DDescription& description);
+	// Gets the key we store a mesh under
+	static std::string _GetMeshKey(const std::string& path, const glm::vec4& color);
+	// Hands a mesh that doesn't keep it's triangles a way to load them again from it's file
+	static void _SetTriangleSource(const VertexArrayObject::sptr& mesh, const std::string& path, const glm::vec4& color, CpuResidency residency);
+
+	// Looks up a key in one of our caches, or loads the asset with the given function if it's not loaded
+	template <typename T, typename LoadFunc>
+	static std::shared_ptr<T> _GetOrLoad(std::unordered_map<std::string, std::weak_ptr<T>>& cache, const std::string& key, LoadFunc load);
+
+	static std::unordered_map<std::string, std::weak_ptr<VertexArrayObject>> _meshes;
+	static std::unordered_map<std::string, std::weak_ptr<Texture2D>>         _textures;
+	static std::unordered_map<std::string, std::weak_ptr<TextureCubeMap>>    _cubeMaps;
+	static std::unordered_map<std::string, std::weak_ptr<Shader>>            _shaders;
+	// Where each mesh we've handed out came from, checked against _meshes since a freed mesh's address may be reused
+	struct MeshSource {
+		std::string Key;
+		std::string Path;
+		glm::vec4   Color;
+		// So a reload keeps (or drops) the mesh's triangles the same way
+		CpuResidency Residency;
+	};
+	static std::unordered_map<const VertexArrayObject*, MeshSource>          _meshSources;
+	// Meshes that are still loading in the background, these go into _meshes once they're ready
+	static std::unordered_map<std::string, Task<VertexArrayObject::sptr>>    _loadingMeshes;
+	// Cubemap faces being loaded by PrefetchCubeMap, waiting for GetCubeMap to pick them up
+	static std::unordered_map<std::string, Task<TextureCubeMapData::sptr>>   _prefetchedCubeMaps;
+	static uint32_t                                                          _hits;
+};
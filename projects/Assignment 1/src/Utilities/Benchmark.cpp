@@ -0,0 +1,412 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <json.hpp>
+
+#include "CpuProfiler.h"
+#include "Logging.h"
+
+const float Benchmark::TIME_STEP = 1.0f / 60.0f;
+
+const Benchmark::Scenario*          Benchmark::_scenario = nullptr;
+std::string                         Benchmark::_outputPath;
+uint32_t                            Benchmark::_frameCount = 0;
+uint32_t                            Benchmark::_framesRun = 0;
+std::vector<Benchmark::FrameSample> Benchmark::_samples;
+std::vector<std::pair<std::string, double>> Benchmark::_parameters;
+std::map<std::string, std::vector<float>> Benchmark::_baseline;
+std::string                         Benchmark::_baselinePath;
+float                               Benchmark::_thresholdPercent = 5.0f;
+uint32_t                            Benchmark::_regressionCount = 0;
+
+// How unlikely a difference has to be to happen by chance (the test's p value) before we believe it
+static const double SIGNIFICANCE = 0.01;
+// Changes smaller than this are ignored no matter how significant they are, tiny zones can shift by a few
+// microseconds very reliably without it mattering
+static const float  MIN_CHANGE_MS = 0.02f;
+
+// Every frame's time for one metric, by name (ex: frame_ms, cpu/Render)
+typedef std::map<std::string, std::vector<float>> SeriesMap;
+
+// Gets the value a fraction of the way through the sorted values, interpolating between the two closest
+static float Percentile(const std::vector<float>& sorted, double fraction) {
+	if (sorted.empty()) {
+		return 0.0f;
+	}
+	const double position = fraction * (sorted.size() - 1);
+	const size_t below = static_cast<size_t>(position);
+	const size_t above = std::min(below + 1, sorted.size() - 1);
+	return static_cast<float>(sorted[below] + (sorted[above] - sorted[below]) * (position - below));
+}
+
+static nlohmann::json Percentiles(std::vector<float> values) {
+	std::sort(values.begin(), values.end());
+	return { { "p50", Percentile(values, 0.5) }, { "p95", Percentile(values, 0.95) }, { "p99", Percentile(values, 0.99) } };
+}
+
+// The two sided p value of a Mann-Whitney U test between two sets of samples, which is how likely the two are to come
+// from the same distribution. Frame times are far from normal (ex: a long tail of hitches), and this only looks at
+// their order, so it holds up where a t-test wouldn't. Uses the normal approximation, which is plenty for the
+// hundreds of frames a run has
+static double MannWhitneyP(const std::vector<float>& a, const std::vector<float>& b) {
+	const size_t count = a.size() + b.size();
+	if (a.empty() || b.empty()) {
+		return 1.0;
+	}
+	std::vector<std::pair<float, bool>> all;
+	all.reserve(count);
+	for (float value : a) {
+		all.emplace_back(value, true);
+	}
+	for (float value : b) {
+		all.emplace_back(value, false);
+	}
+	std::sort(all.begin(), all.end(), [](const auto& l, const auto& r) { return l.first < r.first; });
+
+	// Ties share the average of their ranks, and shrink the variance
+	double rankSumA = 0.0;
+	double tieTerm = 0.0;
+	for (size_t start = 0; start < count;) {
+		size_t end = start + 1;
+		while (end < count && all[end].first == all[start].first) {
+			end++;
+		}
+		const double rank = (start + 1 + end) / 2.0;
+		for (size_t ix = start; ix < end; ix++) {
+			rankSumA += all[ix].second ? rank : 0.0;
+		}
+		const double ties = static_cast<double>(end - start);
+		tieTerm += ties * ties * ties - ties;
+		start = end;
+	}
+
+	const double n1 = static_cast<double>(a.size()), n2 = static_cast<double>(b.size()), n = static_cast<double>(count);
+	const double u = rankSumA - n1 * (n1 + 1.0) / 2.0;
+	const double mean = n1 * n2 / 2.0;
+	const double variance = n1 * n2 / 12.0 * ((n + 1.0) - tieTerm / (n * (n - 1.0)));
+	if (variance <= 0.0) {
+		return 1.0;
+	}
+	// The continuity correction accounts for U only taking whole (or half) values
+	const double z = std::max(std::abs(u - mean) - 0.5, 0.0) / std::sqrt(variance);
+	return std::erfc(z / std::sqrt(2.0));
+}
+
+// Reads every metric's frame times back out of a run's JSON
+static SeriesMap ReadSeries(const nlohmann::json& result) {
+	SeriesMap series;
+	if (result.contains("samples")) {
+		for (const auto& sample : result["samples"]) {
+			for (const char* name : { "frame_ms", "cpu_ms", "gpu_ms" }) {
+				series[name].push_back(sample.value(name, 0.0f));
+			}
+		}
+	}
+	// Runs from before zones were recorded only have the totals
+	if (result.contains("zones")) {
+		for (const char* kind : { "cpu", "gpu" }) {
+			if (result["zones"].contains(kind)) {
+				for (const auto& [name, values] : result["zones"][kind].items()) {
+					series[std::string(kind) + "/" + name] = values.get<std::vector<float>>();
+				}
+			}
+		}
+	}
+	return series;
+}
+
+// The playground's in the middle of a 38x38 plane (Z is up), with the trees scattered around it
+static const Benchmark::Scenario SCENARIOS[] = {
+	// Circles the playground from above, which has everything in view at once
+	{ "orbit", {
+		{ 12.0f, 0.0f, 8.0f }, { 8.5f, 8.5f, 8.0f }, { 0.0f, 12.0f, 8.0f }, { -8.5f, 8.5f, 8.0f },
+		{ -12.0f, 0.0f, 8.0f }, { -8.5f, -8.5f, 8.0f }, { 0.0f, -12.0f, 8.0f }, { 8.5f, -8.5f, 8.0f }
+	}, glm::vec3(0.0f), 8.0f, 120, 1200 },
+	// Weaves through the trees at head height, so most of the scene is culled and what's left is up close
+	{ "walk", {
+		{ 16.0f, -16.0f, 1.7f }, { 6.0f, -14.0f, 1.7f }, { -6.0f, -15.0f, 1.7f }, { -16.0f, -16.0f, 1.7f },
+		{ -15.0f, 0.0f, 1.7f }, { -16.0f, 16.0f, 1.7f }, { 0.0f, 15.0f, 1.7f }, { 16.0f, 16.0f, 1.7f }, { 15.0f, 0.0f, 1.7f }
+	}, glm::vec3(0.0f, 0.0f, 1.0f), 4.0f, 120, 1800 },
+	// Sweeps low across the whole plane and back, which streams the world cells in and out
+	{ "flyover", {
+		{ -18.0f, -18.0f, 4.0f }, { 18.0f, 18.0f, 4.0f }, { 18.0f, -18.0f, 4.0f }, { -18.0f, 18.0f, 4.0f }
+	}, glm::vec3(0.0f), 12.0f, 120, 1200 }
+};
+
+const Benchmark::Scenario* Benchmark::FindScenario(const std::string& name) {
+	for (const Scenario& scenario : SCENARIOS) {
+		if (name == scenario.Name) {
+			return &scenario;
+		}
+	}
+	return nullptr;
+}
+
+std::string Benchmark::GetScenarioNames() {
+	std::string result;
+	for (const Scenario& scenario : SCENARIOS) {
+		result += result.empty() ? scenario.Name : std::string(", ") + scenario.Name;
+	}
+	return result;
+}
+
+void Benchmark::Begin(const Scenario& scenario, const std::string& outputPath, uint32_t frameCount) {
+	_scenario = &scenario;
+	_outputPath = outputPath;
+	_frameCount = frameCount > 0 ? frameCount : scenario.FrameCount;
+	_framesRun = 0;
+	_samples.clear();
+	_samples.reserve(_frameCount);
+	LOG_INFO("Running the {} benchmark, {} frames after {} to warm up", scenario.Name, _frameCount, scenario.WarmupFrames);
+}
+
+bool Benchmark::SetBaseline(const Scenario& scenario, const std::string& path, float thresholdPercent) {
+	using nlohmann::json;
+
+	_baseline.clear();
+	_baselinePath.clear();
+	std::ifstream file(path);
+	const json baseline = file.is_open() ? json::parse(file, nullptr, false) : json();
+	if (!baseline.is_object()) {
+		LOG_ERROR("Failed to read the benchmark baseline {}", path);
+		return false;
+	}
+	const std::string baselineScenario = baseline.value("scenario", "");
+	if (baselineScenario != scenario.Name) {
+		LOG_ERROR("The baseline {} is from the {} benchmark, it can't be compared against {}", path, baselineScenario, scenario.Name);
+		return false;
+	}
+	_baseline = ReadSeries(baseline);
+	_baselinePath = path;
+	_thresholdPercent = thresholdPercent;
+	LOG_INFO("Comparing against {} ({} metrics), regressions past {}%", path, _baseline.size(), thresholdPercent);
+	return true;
+}
+
+void Benchmark::SetParameter(const std::string& name, double value) {
+	for (auto& parameter : _parameters) {
+		if (parameter.first == name) {
+			parameter.second = value;
+			return;
+		}
+	}
+	_parameters.emplace_back(name, value);
+}
+
+void Benchmark::RecordFrame(const FrameSample& sample) {
+	if (_scenario == nullptr || IsFinished()) {
+		return;
+	}
+	if (_framesRun++ >= _scenario->WarmupFrames) {
+		_samples.push_back(sample);
+	}
+}
+
+bool Benchmark::Finish() {
+	using nlohmann::json;
+
+	if (_scenario == nullptr) {
+		return false;
+	}
+	const Scenario& scenario = *_scenario;
+	_scenario = nullptr;
+	_regressionCount = 0;
+	if (_samples.empty()) {
+		LOG_WARN("The {} benchmark finished without recording any frames", scenario.Name);
+		return false;
+	}
+
+	auto summarize = [&](float FrameSample::* field) {
+		std::vector<float> values;
+		values.reserve(_samples.size());
+		for (const FrameSample& sample : _samples) {
+			values.push_back(sample.*field);
+		}
+		const CpuProfiler::Summary summary = CpuProfiler::Summarize(values.data(), static_cast<int>(values.size()));
+		const float max = *std::max_element(values.begin(), values.end());
+		return json({ { "min", summary.Min }, { "avg", summary.Avg }, { "p99", summary.P99 }, { "max", max } });
+	};
+	int64_t peakHeap = 0;
+	uint64_t totalDrawCalls = 0;
+	RenderStats::Frame renderTotals;
+	for (const FrameSample& sample : _samples) {
+		peakHeap = std::max(peakHeap, sample.HeapBytes);
+		totalDrawCalls += sample.DrawCalls;
+		for (int layerIx = 0; layerIx < static_cast<int>(RenderStats::Layer::Count); layerIx++) {
+			renderTotals.Layers[layerIx] += sample.Render.Layers[layerIx];
+		}
+		renderTotals.Total += sample.Render.Total;
+	}
+	// The render counters averaged over every frame, for the whole frame and each layer that did anything
+	const double frameCount = static_cast<double>(_samples.size());
+	auto averageCounters = [&](const RenderStats::Counters& counters) {
+		return json({
+			{ "draw_calls", counters.DrawCalls / frameCount },
+			{ "instanced_draws", counters.InstancedDraws / frameCount },
+			{ "triangles", counters.Triangles / frameCount },
+			{ "vertices", counters.Vertices / frameCount },
+			{ "program_switches", counters.ProgramSwitches / frameCount },
+			{ "vao_switches", counters.VaoSwitches / frameCount },
+			{ "texture_switches", counters.TextureSwitches / frameCount },
+			{ "material_switches", counters.MaterialSwitches / frameCount },
+			{ "uniform_uploads", counters.UniformUploads / frameCount },
+			{ "buffer_bytes", counters.BufferBytes / frameCount },
+			{ "texture_bytes", counters.TextureBytes / frameCount }
+		});
+	};
+	json renderLayers = json::object();
+	for (int layerIx = 0; layerIx < static_cast<int>(RenderStats::Layer::Count); layerIx++) {
+		if (renderTotals.Layers[layerIx].DrawCalls > 0 || renderTotals.Layers[layerIx].BufferBytes > 0 || renderTotals.Layers[layerIx].TextureBytes > 0) {
+			renderLayers[RenderStats::GetLayerName(static_cast<RenderStats::Layer>(layerIx))] = averageCounters(renderTotals.Layers[layerIx]);
+		}
+	}
+	const json frameMs = summarize(&FrameSample::FrameMs);
+	const json cpuMs = summarize(&FrameSample::CpuMs);
+	const json gpuMs = summarize(&FrameSample::GpuMs);
+
+	LOG_INFO("{} benchmark, {} frames (in ms, min/avg/p99):", scenario.Name, _samples.size());
+	json parameters = json::object();
+	for (const auto& parameter : _parameters) {
+		LOG_INFO("  {} = {}", parameter.first, parameter.second);
+		parameters[parameter.first] = parameter.second;
+	}
+	LOG_INFO("  Frame {:.2f} / {:.2f} / {:.2f}", frameMs["min"].get<float>(), frameMs["avg"].get<float>(), frameMs["p99"].get<float>());
+	LOG_INFO("  CPU   {:.2f} / {:.2f} / {:.2f}", cpuMs["min"].get<float>(), cpuMs["avg"].get<float>(), cpuMs["p99"].get<float>());
+	LOG_INFO("  GPU   {:.2f} / {:.2f} / {:.2f}", gpuMs["min"].get<float>(), gpuMs["avg"].get<float>(), gpuMs["p99"].get<float>());
+	LOG_INFO("  {:.1f} draw calls per frame, {:.1f} MB peak heap", static_cast<double>(totalDrawCalls) / _samples.size(),
+		peakHeap / (1024.0 * 1024.0));
+	LOG_INFO("  {:.0f} triangles, {:.1f} program / {:.1f} material switches and {:.1f} KB uploaded per frame",
+		renderTotals.Total.Triangles / frameCount, renderTotals.Total.ProgramSwitches / frameCount, renderTotals.Total.MaterialSwitches / frameCount,
+		(renderTotals.Total.BufferBytes + renderTotals.Total.TextureBytes) / frameCount / 1024.0);
+
+	std::ofstream csv(_outputPath + ".csv");
+	if (!csv.is_open()) {
+		LOG_ERROR("Failed to open {}.csv for writing the benchmark results", _outputPath);
+		return false;
+	}
+	csv << "frame,frame_ms,cpu_ms,gpu_ms,draw_calls,instances,heap_bytes,heap_allocations,process_bytes,"
+		"gl_draw_calls,instanced_draws,triangles,vertices,program_switches,vao_switches,texture_switches,material_switches,"
+		"uniform_uploads,buffer_bytes,texture_bytes,culled,occluded,culled_lights\n";
+	json samples = json::array();
+	for (size_t ix = 0; ix < _samples.size(); ix++) {
+		const FrameSample& s = _samples[ix];
+		const RenderStats::Counters& r = s.Render.Total;
+		csv << fmt::format("{},{:.4f},{:.4f},{:.4f},{},{},{},{},{},", ix, s.FrameMs, s.CpuMs, s.GpuMs, s.DrawCalls, s.Instances,
+			s.HeapBytes, s.HeapAllocations, s.ProcessBytes);
+		csv << fmt::format("{},{},{},{},{},{},{},{},{},{},{},{},{},{}\n", r.DrawCalls, r.InstancedDraws, r.Triangles, r.Vertices,
+			r.ProgramSwitches, r.VaoSwitches, r.TextureSwitches, r.MaterialSwitches, r.UniformUploads, r.BufferBytes, r.TextureBytes,
+			s.Render.CulledObjects, s.Render.OccludedObjects, s.Render.CulledLights);
+		samples.push_back({
+			{ "frame_ms", s.FrameMs },
+			{ "cpu_ms", s.CpuMs },
+			{ "gpu_ms", s.GpuMs },
+			{ "draw_calls", s.DrawCalls },
+			{ "instances", s.Instances },
+			{ "heap_bytes", s.HeapBytes },
+			{ "heap_allocations", s.HeapAllocations },
+			{ "process_bytes", s.ProcessBytes },
+			{ "gl_draw_calls", r.DrawCalls },
+			{ "triangles", r.Triangles },
+			{ "program_switches", r.ProgramSwitches },
+			{ "material_switches", r.MaterialSwitches },
+			{ "uploaded_bytes", r.BufferBytes + r.TextureBytes },
+			{ "culled", s.Render.CulledObjects }
+		});
+	}
+
+	// Every metric's frame times, the totals and then each top level zone. A zone that didn't run in a frame took 0
+	SeriesMap series;
+	for (size_t ix = 0; ix < _samples.size(); ix++) {
+		const FrameSample& s = _samples[ix];
+		series["frame_ms"].push_back(s.FrameMs);
+		series["cpu_ms"].push_back(s.CpuMs);
+		series["gpu_ms"].push_back(s.GpuMs);
+		for (const auto& [prefix, frameZones] : { std::make_pair("cpu/", &s.CpuZones), std::make_pair("gpu/", &s.GpuZones) }) {
+			for (const auto& [name, ms] : *frameZones) {
+				std::vector<float>& values = series[std::string(prefix) + name];
+				values.resize(_samples.size(), 0.0f);
+				values[ix] += ms;
+			}
+		}
+	}
+	json zones = { { "cpu", json::object() }, { "gpu", json::object() } };
+	json percentiles = json::object();
+	for (const auto& [name, values] : series) {
+		const size_t slash = name.find('/');
+		if (slash != std::string::npos) {
+			zones[name.substr(0, slash)][name.substr(slash + 1)] = values;
+		}
+		percentiles[name] = Percentiles(values);
+	}
+
+	// Each metric is checked against the baseline, a change only counts if the test says it's real and the median
+	// moved far enough
+	json comparison = json::array();
+	if (!_baselinePath.empty()) {
+		uint32_t improvements = 0;
+		LOG_INFO("Compared to {} (median ms, change, p value):", _baselinePath);
+		for (const auto& [name, values] : series) {
+			auto baseline = _baseline.find(name);
+			if (baseline == _baseline.end() || baseline->second.empty()) {
+				continue;
+			}
+			std::vector<float> before = baseline->second, after = values;
+			std::sort(before.begin(), before.end());
+			std::sort(after.begin(), after.end());
+			const float beforeMedian = Percentile(before, 0.5), afterMedian = Percentile(after, 0.5);
+			const float changePercent = beforeMedian > 0.0f ? (afterMedian - beforeMedian) / beforeMedian * 100.0f : 0.0f;
+			const double p = MannWhitneyP(before, after);
+			const bool isChanged = p < SIGNIFICANCE && std::abs(afterMedian - beforeMedian) >= MIN_CHANGE_MS &&
+				std::abs(changePercent) >= _thresholdPercent;
+			const char* verdict = !isChanged ? "same" : changePercent > 0.0f ? "regression" : "improvement";
+			if (isChanged) {
+				(changePercent > 0.0f ? _regressionCount : improvements)++;
+				LOG_INFO("  {:<11} {:<24} {:.3f} -> {:.3f} ({:+.1f}%, p={:.2g})", verdict, name, beforeMedian, afterMedian, changePercent, p);
+			}
+			comparison.push_back({
+				{ "metric", name },
+				{ "baseline", { { "p50", beforeMedian }, { "p95", Percentile(before, 0.95) }, { "p99", Percentile(before, 0.99) } } },
+				{ "current", { { "p50", afterMedian }, { "p95", Percentile(after, 0.95) }, { "p99", Percentile(after, 0.99) } } },
+				{ "change_percent", changePercent },
+				{ "p_value", p },
+				{ "verdict", verdict }
+			});
+		}
+		LOG_INFO("  {} regressions and {} improvements past {}% across {} metrics", _regressionCount, improvements, _thresholdPercent, comparison.size());
+	}
+
+	json result = {
+		{ "scenario", scenario.Name },
+		{ "seed", SEED },
+		{ "time_step", TIME_STEP },
+		{ "warmup_frames", scenario.WarmupFrames },
+		{ "frames", _samples.size() },
+		{ "parameters", parameters },
+		{ "summary", {
+			{ "frame_ms", frameMs },
+			{ "cpu_ms", cpuMs },
+			{ "gpu_ms", gpuMs },
+			{ "draw_calls_avg", static_cast<double>(totalDrawCalls) / _samples.size() },
+			{ "heap_bytes_peak", peakHeap },
+			{ "render", averageCounters(renderTotals.Total) },
+			{ "render_layers", renderLayers },
+			{ "percentiles", percentiles }
+		} },
+		{ "samples", samples },
+		{ "zones", zones }
+	};
+	if (!_baselinePath.empty()) {
+		result["comparison"] = { { "baseline", _baselinePath }, { "threshold_percent", _thresholdPercent }, { "significance", SIGNIFICANCE }, { "metrics", comparison } };
+	}
+	std::ofstream file(_outputPath + ".json");
+	if (!file.is_open()) {
+		LOG_ERROR("Failed to open {}.json for writing the benchmark results", _outputPath);
+		return false;
+	}
+	file << result.dump(1, '\t');
+	LOG_INFO("Wrote the benchmark results to {}.csv and {}.json", _outputPath, _outputPath);
+	_samples.clear();
+	return true;
+}
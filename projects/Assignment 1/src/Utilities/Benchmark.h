@@ -0,0 +1,157 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Graphics/RenderStats.h"
+
+/// <summary>
+/// Runs a scripted flythrough for a fixed number of frames and records how each one went, so we get numbers we can
+/// compare between builds and machines. The camera follows the scenario's path with a fixed time step and everything
+/// random is seeded the same way every run, so each run draws the same frames. Frames are only timed once the
+/// warm up is over, giving streaming and shader compiles a chance to settle
+///
+/// When the run is over the samples are written to a CSV (one row per frame) and a JSON file (a summary and the same
+/// samples), with the same path and different extensions
+///
+/// A run can be compared against the JSON from an earlier run of the same scenario (see SetBaseline). Each metric (the
+/// frame, CPU and GPU times, and each top level CPU zone and GPU pass) has it's frame times checked with a Mann-Whitney U
+/// test, so a shift only counts when it's bigger than what the frames' own noise could explain. Shifts in the median
+/// past the threshold are reported as regressions or improvements
+/// </summary>
+class Benchmark final
+{
+public:
+	/// <summary>
+	/// A scripted camera path to benchmark
+	/// </summary>
+	struct Scenario {
+		const char*            Name;
+		// The points the camera flies between, in order, looping back to the first
+		std::vector<glm::vec3> Path;
+		// The point the camera keeps looking at
+		glm::vec3              Target;
+		// How fast the camera moves along the path, in units per second
+		float                  Speed;
+		// The frames that get run but not recorded before the timed frames
+		uint32_t               WarmupFrames;
+		// The frames that get recorded
+		uint32_t               FrameCount;
+	};
+
+	/// <summary>
+	/// What we measured for a single frame
+	/// </summary>
+	struct FrameSample {
+		// From the top of the frame until the swap returned
+		float    FrameMs = 0.0f;
+		// From the top of the frame until it was handed off to be presented
+		float    CpuMs = 0.0f;
+		// The most recent frame the GPU has finished, which is a few frames behind (see GpuProfiler::FRAME_LATENCY)
+		float    GpuMs = 0.0f;
+		uint32_t DrawCalls = 0;
+		uint32_t Instances = 0;
+		// Everything the frame sent to OpenGL, broken down by layer
+		RenderStats::Frame Render;
+		// Everything held across the memory tags, see MemoryTracker
+		int64_t  HeapBytes = 0;
+		uint32_t HeapAllocations = 0;
+		// The whole process, as the OS sees it
+		int64_t  ProcessBytes = 0;
+		// The time spent in each top level zone, in milliseconds. The CPU's are from the last frame the profiler finished
+		// and the GPU's from the same frame as GpuMs
+		std::vector<std::pair<const char*, float>> CpuZones;
+		std::vector<std::pair<const char*, float>> GpuZones;
+	};
+
+	/// <summary>
+	/// The seed everything random gets during a benchmark
+	/// </summary>
+	static const uint32_t SEED = 1350;
+	/// <summary>
+	/// The time step every benchmark frame advances by, in seconds
+	/// </summary>
+	static const float TIME_STEP;
+
+	/// <summary>
+	/// Finds one of the built in scenarios by name
+	/// </summary>
+	/// <param name="name">The name of the scenario</param>
+	/// <returns>The scenario, or nullptr if there isn't one with that name</returns>
+	static const Scenario* FindScenario(const std::string& name);
+	/// <summary>
+	/// Gets the names of the built in scenarios, separated by commas, for telling the user what they can pick
+	/// </summary>
+	static std::string GetScenarioNames();
+
+	/// <summary>
+	/// Starts a run of a scenario, the samples will be written next to outputPath (without an extension)
+	/// </summary>
+	/// <param name="scenario">The scenario to run, from FindScenario</param>
+	/// <param name="outputPath">The path to write the results to, without an extension</param>
+	/// <param name="frameCount">The number of frames to record, or 0 to use the scenario's</param>
+	static void Begin(const Scenario& scenario, const std::string& outputPath, uint32_t frameCount = 0);
+	/// <summary>
+	/// Loads the results the next run of a scenario gets compared against when it finishes
+	/// </summary>
+	/// <param name="scenario">The scenario that's going to be run</param>
+	/// <param name="path">The JSON file from an earlier run of the scenario</param>
+	/// <param name="thresholdPercent">How much slower a metric's median has to get (as a percent) before a significant
+	/// change counts as a regression</param>
+	/// <returns>True if the baseline was loaded, false if it couldn't be read or is from another scenario</returns>
+	static bool SetBaseline(const Scenario& scenario, const std::string& path, float thresholdPercent);
+	/// <summary>
+	/// Records something about how the run was set up (ex: the size of the scene), so results from runs with
+	/// different setups can be told apart and charted against each other. Written to the JSON file and logged
+	/// </summary>
+	/// <param name="name">The name of the parameter</param>
+	/// <param name="value">The value it had for this run</param>
+	static void SetParameter(const std::string& name, double value);
+	/// <summary>
+	/// Records the frame that just finished, skipping it if we're still warming up
+	/// </summary>
+	/// <param name="sample">What we measured for the frame</param>
+	static void RecordFrame(const FrameSample& sample);
+	/// <summary>
+	/// Writes out the results and logs a summary, should be called once IsFinished is true
+	/// </summary>
+	/// <returns>True if the results were written</returns>
+	static bool Finish();
+
+	/// <summary>
+	/// Gets the number of metrics that got significantly slower than the baseline in the last run
+	/// </summary>
+	static uint32_t GetRegressionCount() { return _regressionCount; }
+
+	/// <summary>
+	/// Returns true between Begin and Finish
+	/// </summary>
+	static bool IsRunning() { return _scenario != nullptr; }
+	/// <summary>
+	/// Returns true once every frame has been recorded
+	/// </summary>
+	static bool IsFinished() { return _scenario != nullptr && _samples.size() >= _frameCount; }
+	static const Scenario* GetScenario() { return _scenario; }
+	/// <summary>
+	/// Gets the index of the frame being run among the recorded frames, or -1 while still warming up
+	/// </summary>
+	static int64_t GetFrameIndex() {
+		return _scenario == nullptr || _framesRun < _scenario->WarmupFrames ? -1 : static_cast<int64_t>(_framesRun - _scenario->WarmupFrames);
+	}
+
+private:
+	static const Scenario*          _scenario;
+	static std::string              _outputPath;
+	static uint32_t                 _frameCount;
+	static uint32_t                 _framesRun;
+	static std::vector<FrameSample> _samples;
+	static std::vector<std::pair<std::string, double>> _parameters;
+	// Every metric's frame times from the baseline, by name (ex: frame_ms, cpu/Render)
+	static std::map<std::string, std::vector<float>> _baseline;
+	static std::string              _baselinePath;
+	static float                    _thresholdPercent;
+	static uint32_t                 _regressionCount;
+};
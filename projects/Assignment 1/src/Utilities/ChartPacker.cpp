@@ -0,0 +1,180 @@
+#include "ChartPacker.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <numeric>
+
+// Reads a vertex's position out of a strided array
+static glm::vec3 GetPosition(const float* positions, size_t stride, uint32_t index) {
+	glm::vec3 result;
+	memcpy(&result, reinterpret_cast<const uint8_t*>(positions) + index * stride, sizeof(glm::vec3));
+	return result;
+}
+
+// Finds the chart a triangle has been joined into so far, flattening the path as it goes
+static uint32_t FindRoot(std::vector<uint32_t>& parents, uint32_t triangle) {
+	while (parents[triangle] != triangle) {
+		parents[triangle] = parents[parents[triangle]];
+		triangle = parents[triangle];
+	}
+	return triangle;
+}
+
+ChartPacker::Unwrap ChartPacker::Build(const float* positions, size_t stride, size_t vertexCount, const uint32_t* indices, size_t indexCount) {
+	Unwrap result;
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0) {
+		return result;
+	}
+
+	// Vertices in the same spot get the same ID, so the charts join up across any seams the mesh already has
+	std::vector<uint32_t> order(vertexCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		const glm::vec3 pa = GetPosition(positions, stride, a);
+		const glm::vec3 pb = GetPosition(positions, stride, b);
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		return pa.z < pb.z;
+	});
+	std::vector<uint32_t> welded(vertexCount);
+	uint32_t weldId = 0;
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		if (ix > 0 && GetPosition(positions, stride, order[ix]) != GetPosition(positions, stride, order[ix - 1])) {
+			weldId++;
+		}
+		welded[order[ix]] = weldId;
+	}
+
+	// Each triangle gets projected along whichever axis it faces the most, the low bit is set for the negative side
+	std::vector<uint8_t> axes(triangleCount);
+	for (size_t tri = 0; tri < triangleCount; tri++) {
+		const glm::vec3 a = GetPosition(positions, stride, indices[tri * 3]);
+		const glm::vec3 b = GetPosition(positions, stride, indices[tri * 3 + 1]);
+		const glm::vec3 c = GetPosition(positions, stride, indices[tri * 3 + 2]);
+		const glm::vec3 normal = glm::cross(b - a, c - a);
+		const glm::vec3 size = glm::abs(normal);
+		const int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+		axes[tri] = static_cast<uint8_t>(axis * 2 + (normal[axis] < 0.0f ? 1 : 0));
+	}
+
+	// Triangles that share an edge and face the same way end up in the same chart. Sorting the edges puts the
+	// triangles on either side of each one next to each other
+	std::vector<std::pair<uint64_t, uint32_t>> edges;
+	edges.reserve(triangleCount * 3);
+	for (uint32_t tri = 0; tri < triangleCount; tri++) {
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			const uint32_t a = welded[indices[tri * 3 + corner]];
+			const uint32_t b = welded[indices[tri * 3 + (corner + 1) % 3]];
+			if (a != b) {
+				edges.emplace_back((static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b), tri);
+			}
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	std::vector<uint32_t> parents(triangleCount);
+	std::iota(parents.begin(), parents.end(), 0);
+	for (size_t first = 0; first < edges.size();) {
+		size_t last = first + 1;
+		while (last < edges.size() && edges[last].first == edges[first].first) {
+			last++;
+		}
+		for (size_t ix = first; ix < last; ix++) {
+			for (size_t jx = ix + 1; jx < last; jx++) {
+				if (axes[edges[ix].second] == axes[edges[jx].second]) {
+					parents[FindRoot(parents, edges[jx].second)] = FindRoot(parents, edges[ix].second);
+				}
+			}
+		}
+		first = last;
+	}
+
+	// Number the charts in the order their first triangle shows up
+	std::vector<uint32_t> charts(triangleCount);
+	std::vector<uint32_t> rootCharts(triangleCount, UINT32_MAX);
+	uint32_t chartCount = 0;
+	for (uint32_t tri = 0; tri < triangleCount; tri++) {
+		uint32_t& chart = rootCharts[FindRoot(parents, tri)];
+		if (chart == UINT32_MAX) {
+			chart = chartCount++;
+		}
+		charts[tri] = chart;
+	}
+
+	// Every pair of a vertex and a chart that uses it becomes a vertex of it's own
+	std::vector<uint64_t> keys(triangleCount * 3);
+	for (size_t ix = 0; ix < keys.size(); ix++) {
+		keys[ix] = (static_cast<uint64_t>(indices[ix]) << 32) | charts[ix / 3];
+	}
+	std::vector<uint64_t> unique = keys;
+	std::sort(unique.begin(), unique.end());
+	unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+	result.Indices.resize(keys.size());
+	for (size_t ix = 0; ix < keys.size(); ix++) {
+		result.Indices[ix] = static_cast<uint32_t>(std::lower_bound(unique.begin(), unique.end(), keys[ix]) - unique.begin());
+	}
+
+	// Project each vertex onto it's chart's plane, then move the charts so their corners sit at the origin
+	std::vector<uint8_t> chartAxes(chartCount);
+	for (size_t tri = 0; tri < triangleCount; tri++) {
+		chartAxes[charts[tri]] = axes[tri] / 2;
+	}
+	std::vector<glm::vec2> mins(chartCount, glm::vec2(FLT_MAX));
+	std::vector<glm::vec2> maxes(chartCount, glm::vec2(-FLT_MAX));
+	result.Remap.resize(unique.size());
+	result.Coords.resize(unique.size());
+	result.VertexCharts.resize(unique.size());
+	for (size_t ix = 0; ix < unique.size(); ix++) {
+		const uint32_t source = static_cast<uint32_t>(unique[ix] >> 32);
+		const uint32_t chart = static_cast<uint32_t>(unique[ix] & 0xFFFFFFFF);
+		const glm::vec3 position = GetPosition(positions, stride, source);
+		const int axis = chartAxes[chart];
+		const glm::vec2 coord = glm::vec2(position[(axis + 1) % 3], position[(axis + 2) % 3]);
+		result.Remap[ix] = source;
+		result.Coords[ix] = coord;
+		result.VertexCharts[ix] = chart;
+		mins[chart] = glm::min(mins[chart], coord);
+		maxes[chart] = glm::max(maxes[chart], coord);
+	}
+	for (size_t ix = 0; ix < unique.size(); ix++) {
+		result.Coords[ix] -= mins[result.VertexCharts[ix]];
+	}
+	result.ChartSizes.resize(chartCount);
+	for (uint32_t chart = 0; chart < chartCount; chart++) {
+		result.ChartSizes[chart] = maxes[chart] - mins[chart];
+	}
+	return result;
+}
+
+uint32_t ChartPacker::Pack(const std::vector<glm::uvec2>& sizes, uint32_t width, uint32_t maxHeight, std::vector<glm::uvec2>& offsets) {
+	offsets.assign(sizes.size(), glm::uvec2(0));
+	std::vector<uint32_t> order(sizes.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return sizes[a].y != sizes[b].y ? sizes[a].y > sizes[b].y : sizes[a].x > sizes[b].x;
+	});
+
+	uint32_t x = 0;
+	uint32_t y = 0;
+	uint32_t rowHeight = 0;
+	for (uint32_t ix : order) {
+		const glm::uvec2 size = sizes[ix];
+		if (size.x > width) {
+			return 0;
+		}
+		// Start a new row once this one is full, the rest of the rectangles are no taller than the row's first
+		if (x + size.x > width) {
+			y += rowHeight;
+			x = 0;
+			rowHeight = 0;
+		}
+		offsets[ix] = glm::uvec2(x, y);
+		x += size.x;
+		rowHeight = std::max(rowHeight, size.y);
+		if (y + rowHeight > maxHeight) {
+			return 0;
+		}
+	}
+	return y + rowHeight;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Unwraps meshes into flat charts and packs the charts into an atlas, for textures that need every triangle to have
+/// a spot of it's own (ex: lightmaps, see Lightmapper). Charts are made of connected triangles that face the same way
+/// along one of the 6 axes, and get projected flat onto that axis' plane, so they never overlap themselves and keep
+/// the surface's proportions. It's a lot simpler than a proper unwrap, at the cost of more seams on curved meshes
+///
+/// These work on the raw vertex and index data so they don't care about the vertex type, see
+/// MeshBuilder::GenerateLightmapCharts
+/// </summary>
+class ChartPacker final
+{
+public:
+	/// <summary>
+	/// A mesh split into charts. Vertices that are shared by triangles in different charts get split, so each vertex
+	/// belongs to one chart, and everything is measured in the units of the mesh's positions
+	/// </summary>
+	struct Unwrap {
+		// The vertex that each new vertex was copied from
+		std::vector<uint32_t>  Remap;
+		// The triangles, referring to the new vertices
+		std::vector<uint32_t>  Indices;
+		// Where each new vertex lands within it's chart, measured from the chart's corner
+		std::vector<glm::vec2> Coords;
+		// The chart each new vertex belongs to
+		std::vector<uint32_t>  VertexCharts;
+		// The width and height of each chart
+		std::vector<glm::vec2> ChartSizes;
+	};
+
+	/// <summary>
+	/// Splits an indexed triangle list into charts. Triangles are joined up across edges whose corners have the same
+	/// positions, even if the vertices were already split for something else (ex: texture seams)
+	/// </summary>
+	/// <param name="positions">The x, y and z of the first vertex's position</param>
+	/// <param name="stride">The number of bytes between the positions of one vertex and the next</param>
+	/// <param name="vertexCount">The number of vertices</param>
+	/// <param name="indices">The triangle list, 3 indices per triangle</param>
+	/// <param name="indexCount">The number of indices</param>
+	static Unwrap Build(const float* positions, size_t stride, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+
+	/// <summary>
+	/// Packs rectangles into an atlas in rows, tallest first. Fast and reasonably tight for lots of small rectangles,
+	/// which is what charts mostly are
+	/// </summary>
+	/// <param name="sizes">The size of each rectangle</param>
+	/// <param name="width">The width of the atlas</param>
+	/// <param name="maxHeight">The most rows of the atlas the rectangles may use</param>
+	/// <param name="offsets">Filled with the corner of each rectangle within the atlas</param>
+	/// <returns>The number of rows that were used, or 0 if the rectangles didn't fit</returns>
+	static uint32_t Pack(const std::vector<glm::uvec2>& sizes, uint32_t width, uint32_t maxHeight, std::vector<glm::uvec2>& offsets);
+
+protected:
+	ChartPacker() = default;
+};
@@ -0,0 +1,252 @@
+#include "CollisionCook.h"
+
+#include <cstring>
+#include <fstream>
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/CollisionShapes/btShapeHull.h>
+
+#include "Logging.h"
+#include "FileUtils.h"
+#include "MappedFile.h"
+#include "ObjLoader.h"
+#include "TraceRecorder.h"
+
+// The header at the start of every collision sidecar, followed by the position, index, hull and tree blobs
+struct CollisionHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	// Used to detect when the source file has changed since the sidecar was cooked
+	uint64_t SourceSize;
+	int64_t  SourceWriteTime;
+	uint64_t VertexCount;
+	uint64_t IndexCount;
+	uint64_t HullCount;
+	// Offsets of the blobs from the start of the file, all of them are aligned to COLLISION_BLOB_ALIGNMENT
+	uint64_t VertexOffset;
+	uint64_t IndexOffset;
+	uint64_t HullOffset;
+	// The tree is Bullet's own in place format (see btQuantizedBvh::serializeInPlace)
+	uint64_t BvhSize;
+	uint64_t BvhOffset;
+};
+
+static const uint32_t COLLISION_MAGIC          = 'T' | ('C' << 8) | ('O' << 16) | ('L' << 24);
+// Bump this whenever the layout of the file or the way the hull or tree are built changes, so old sidecars get re-cooked
+static const uint32_t COLLISION_VERSION        = 1;
+// Bullet wants the tree's buffer 16 byte aligned, the rest just keeps it company
+static const size_t   COLLISION_BLOB_ALIGNMENT = 16;
+
+static size_t AlignBlob(size_t offset) {
+	return (offset + COLLISION_BLOB_ALIGNMENT - 1) & ~(COLLISION_BLOB_ALIGNMENT - 1);
+}
+
+std::unordered_map<std::string, std::weak_ptr<CollisionMesh>> CollisionCook::_meshes;
+
+CollisionMesh::CollisionMesh() :
+	_bvhBuffer(nullptr)
+{ }
+
+CollisionMesh::~CollisionMesh() {
+	// The shape refers to the tree, so it has to go before the buffer the tree lives in
+	_shape.reset();
+	_triangles.reset();
+	if (_bvhBuffer != nullptr) {
+		btAlignedFree(_bvhBuffer);
+	}
+}
+
+std::unique_ptr<btCollisionShape> CollisionMesh::CreateHull() const {
+	return std::make_unique<btConvexHullShape>(&_hull[0].x, static_cast<int>(_hull.size()), static_cast<int>(sizeof(glm::vec3)));
+}
+
+std::unique_ptr<btCollisionShape> CollisionMesh::CreateTriangleMesh() const {
+	// The scaled shape lets every body have it's own scale without building the tree again
+	return std::make_unique<btScaledBvhTriangleMeshShape>(_shape.get(), btVector3(1.0f, 1.0f, 1.0f));
+}
+
+void CollisionMesh::_CreateTriangles() {
+	_triangles = std::make_unique<btTriangleIndexVertexArray>(
+		static_cast<int>(_indices.size() / 3), reinterpret_cast<int*>(_indices.data()), static_cast<int>(3 * sizeof(uint32_t)),
+		static_cast<int>(_positions.size()), &_positions[0].x, static_cast<int>(sizeof(glm::vec3)));
+}
+
+bool CollisionCook::CookFile(const std::string& objPath, const float* positions, size_t stride, size_t vertexCount, const uint32_t* indices, size_t indexCount) {
+	if (indexCount < 3) {
+		LOG_WARN("\"{}\" has no triangles, it won't get a collision sidecar", objPath);
+		return false;
+	}
+	CollisionMesh mesh;
+	_Build(mesh, positions, stride, vertexCount, indices, indexCount);
+
+	const btOptimizedBvh* bvh = mesh._shape->getOptimizedBvh();
+	CollisionHeader header;
+	memset(&header, 0, sizeof(CollisionHeader));
+	header.Magic        = COLLISION_MAGIC;
+	header.Version      = COLLISION_VERSION;
+	header.VertexCount  = mesh._positions.size();
+	header.IndexCount   = mesh._indices.size();
+	header.HullCount    = mesh._hull.size();
+	header.VertexOffset = AlignBlob(sizeof(CollisionHeader));
+	header.IndexOffset  = AlignBlob(header.VertexOffset + header.VertexCount * sizeof(glm::vec3));
+	header.HullOffset   = AlignBlob(header.IndexOffset + header.IndexCount * sizeof(uint32_t));
+	header.BvhSize      = bvh->calculateSerializeBufferSize();
+	header.BvhOffset    = AlignBlob(header.HullOffset + header.HullCount * sizeof(glm::vec3));
+	if (!GetFileStamp(objPath, header.SourceSize, header.SourceWriteTime)) {
+		LOG_WARN("Could not read the source model \"{}\" for a collision sidecar", objPath);
+		return false;
+	}
+
+	// Serializing fixes up the tree's pointers to be offsets in the buffer, so it can't be written out as is
+	void* bvhData = btAlignedAlloc(static_cast<size_t>(header.BvhSize), COLLISION_BLOB_ALIGNMENT);
+	const bool serialized = bvh->serializeInPlace(bvhData, static_cast<unsigned>(header.BvhSize), false);
+
+	const std::string sidecar = GetSidecarPath(objPath);
+	std::ofstream stream(sidecar, std::ios::binary | std::ios::trunc);
+	if (!serialized || !stream.is_open()) {
+		btAlignedFree(bvhData);
+		LOG_WARN("Failed to write \"{}\"", sidecar);
+		return false;
+	}
+	const char padding[COLLISION_BLOB_ALIGNMENT] = { 0 };
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(CollisionHeader));
+	stream.write(padding, header.VertexOffset - sizeof(CollisionHeader));
+	stream.write(reinterpret_cast<const char*>(mesh._positions.data()), header.VertexCount * sizeof(glm::vec3));
+	stream.write(padding, header.IndexOffset - (header.VertexOffset + header.VertexCount * sizeof(glm::vec3)));
+	stream.write(reinterpret_cast<const char*>(mesh._indices.data()), header.IndexCount * sizeof(uint32_t));
+	stream.write(padding, header.HullOffset - (header.IndexOffset + header.IndexCount * sizeof(uint32_t)));
+	stream.write(reinterpret_cast<const char*>(mesh._hull.data()), header.HullCount * sizeof(glm::vec3));
+	stream.write(padding, header.BvhOffset - (header.HullOffset + header.HullCount * sizeof(glm::vec3)));
+	stream.write(static_cast<const char*>(bvhData), header.BvhSize);
+	btAlignedFree(bvhData);
+	if (!stream.good()) {
+		LOG_WARN("Failed to write \"{}\"", sidecar);
+		return false;
+	}
+	LOG_INFO("Cooked {} triangles and a {} point hull for \"{}\"", header.IndexCount / 3, header.HullCount, objPath);
+	return true;
+}
+
+std::string CollisionCook::GetSidecarPath(const std::string& objPath) {
+	return objPath + ".collision";
+}
+
+CollisionMesh::sptr CollisionCook::GetMesh(const std::string& objPath) {
+	auto it = _meshes.find(objPath);
+	if (it != _meshes.end()) {
+		CollisionMesh::sptr result = it->second.lock();
+		if (result != nullptr) {
+			return result;
+		}
+	}
+	CollisionMesh::sptr result = _LoadSidecar(objPath);
+	if (result == nullptr) {
+		result = _Build(objPath);
+	}
+	_meshes[objPath] = result;
+	return result;
+}
+
+CollisionMesh::sptr CollisionCook::_LoadSidecar(const std::string& objPath) {
+	const std::string path = GetSidecarPath(objPath);
+	MappedFile::sptr file = MappedFile::Open(path);
+	// Missing sidecars are normal, models that haven't been cooked get built from the OBJ
+	if (file == nullptr) {
+		return nullptr;
+	}
+	const char* data = file->GetData();
+	const size_t size = file->GetSize();
+
+	if (size < sizeof(CollisionHeader)) {
+		LOG_WARN("Collision sidecar \"{}\" is truncated", path);
+		return nullptr;
+	}
+	CollisionHeader header;
+	memcpy(&header, data, sizeof(CollisionHeader));
+	if (header.Magic != COLLISION_MAGIC || header.Version != COLLISION_VERSION) {
+		LOG_WARN("Collision sidecar \"{}\" is not a sidecar we can read, it should be re-cooked", path);
+		return nullptr;
+	}
+	uint64_t sourceSize;
+	int64_t  sourceWriteTime;
+	if (GetFileStamp(objPath, sourceSize, sourceWriteTime) &&
+		(sourceSize != header.SourceSize || sourceWriteTime != header.SourceWriteTime))
+	{
+		LOG_WARN("Collision sidecar \"{}\" is older than it's model, it should be re-cooked", path);
+		return nullptr;
+	}
+	if (header.VertexCount == 0 || header.IndexCount < 3 || header.HullCount == 0 ||
+		header.VertexOffset + header.VertexCount * sizeof(glm::vec3) > size ||
+		header.IndexOffset + header.IndexCount * sizeof(uint32_t) > size ||
+		header.HullOffset + header.HullCount * sizeof(glm::vec3) > size ||
+		header.BvhOffset % COLLISION_BLOB_ALIGNMENT != 0 || header.BvhOffset + header.BvhSize > size)
+	{
+		LOG_WARN("Collision sidecar \"{}\" is corrupted", path);
+		return nullptr;
+	}
+
+	CollisionMesh::sptr result = std::make_shared<CollisionMesh>();
+	const glm::vec3* positions = reinterpret_cast<const glm::vec3*>(data + header.VertexOffset);
+	result->_positions.assign(positions, positions + header.VertexCount);
+	const uint32_t* indices = reinterpret_cast<const uint32_t*>(data + header.IndexOffset);
+	result->_indices.assign(indices, indices + header.IndexCount);
+	const glm::vec3* hull = reinterpret_cast<const glm::vec3*>(data + header.HullOffset);
+	result->_hull.assign(hull, hull + header.HullCount);
+	result->_CreateTriangles();
+
+	// The tree gets fixed up where it sits, and the mapping is read only, so it needs a copy of it's own
+	result->_bvhBuffer = btAlignedAlloc(static_cast<size_t>(header.BvhSize), COLLISION_BLOB_ALIGNMENT);
+	memcpy(result->_bvhBuffer, data + header.BvhOffset, static_cast<size_t>(header.BvhSize));
+	btOptimizedBvh* bvh = btOptimizedBvh::deSerializeInPlace(result->_bvhBuffer, static_cast<unsigned>(header.BvhSize), false);
+	if (bvh == nullptr) {
+		LOG_WARN("Collision sidecar \"{}\" is corrupted", path);
+		return nullptr;
+	}
+	result->_shape = std::make_unique<btBvhTriangleMeshShape>(result->_triangles.get(), true, false);
+	result->_shape->setOptimizedBvh(bvh);
+	return result;
+}
+
+CollisionMesh::sptr CollisionCook::_Build(const std::string& objPath) {
+	AssetLoadScope load("Collision " + objPath);
+	MeshBuilder<VertexPosNormTexCol> mesh;
+	try {
+		ObjLoader::ParseFile(objPath, mesh);
+	} catch (const std::exception& e) {
+		LOG_WARN("Failed to parse \"{}\": {}", objPath, e.what());
+		return nullptr;
+	}
+	if (mesh.GetIndexCount() < 3) {
+		LOG_WARN("\"{}\" has no triangles to collide with", objPath);
+		return nullptr;
+	}
+	LOG_INFO("Building collision for \"{}\" at runtime, cook it's meshes to skip this", objPath);
+	CollisionMesh::sptr result = std::make_shared<CollisionMesh>();
+	_Build(*result, &mesh.GetVertexDataPtr()->Position.x, sizeof(VertexPosNormTexCol), mesh.GetVertexCount(), mesh.GetIndexDataPtr(), mesh.GetIndexCount());
+	return result;
+}
+
+void CollisionCook::_Build(CollisionMesh& mesh, const float* positions, size_t stride, size_t vertexCount, const uint32_t* indices, size_t indexCount) {
+	mesh._positions.resize(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		const float* position = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + ix * stride);
+		mesh._positions[ix] = glm::vec3(position[0], position[1], position[2]);
+	}
+	mesh._indices.assign(indices, indices + indexCount - indexCount % 3);
+	mesh._CreateTriangles();
+	mesh._shape = std::make_unique<btBvhTriangleMeshShape>(mesh._triangles.get(), true, true);
+
+	// A hull around every vertex can have thousands of points, which is slow to collide with and doesn't look any
+	// different, so we cut it down to a handful
+	btConvexHullShape full(&mesh._positions[0].x, static_cast<int>(vertexCount), static_cast<int>(sizeof(glm::vec3)));
+	btShapeHull reduced(&full);
+	reduced.buildHull(full.getMargin());
+	mesh._hull.resize(reduced.numVertices());
+	for (int ix = 0; ix < reduced.numVertices(); ix++) {
+		const btVector3& point = reduced.getVertexPointer()[ix];
+		mesh._hull[ix] = glm::vec3(point.x(), point.y(), point.z());
+	}
+	// Flat or degenerate meshes can fail to reduce, Bullet copes fine with the full set of points
+	if (mesh._hull.empty()) {
+		mesh._hull = mesh._positions;
+	}
+}
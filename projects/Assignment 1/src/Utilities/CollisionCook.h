@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <GLM/glm.hpp>
+
+class btBvhTriangleMeshShape;
+class btCollisionShape;
+class btTriangleIndexVertexArray;
+
+/// <summary>
+/// The collision data for a single mesh, ready for Bullet shapes to be made from. The triangles and the tree over them
+/// are shared by every triangle mesh shape made from it, so it has to outlive them
+/// </summary>
+class CollisionMesh final
+{
+public:
+	typedef std::shared_ptr<CollisionMesh> sptr;
+
+	CollisionMesh();
+	~CollisionMesh();
+
+	CollisionMesh(const CollisionMesh& other) = delete;
+	CollisionMesh& operator=(const CollisionMesh& other) = delete;
+
+	/// <summary>
+	/// Makes a convex hull around the mesh, which any type of body can use
+	/// </summary>
+	std::unique_ptr<btCollisionShape> CreateHull() const;
+	/// <summary>
+	/// Makes a shape out of the mesh's triangles, which shares the mesh's tree. Bullet can only collide these with
+	/// other shapes, so they're only any good for static bodies
+	/// </summary>
+	std::unique_ptr<btCollisionShape> CreateTriangleMesh() const;
+
+	/// <summary>
+	/// Gets the number of triangles in the mesh
+	/// </summary>
+	size_t GetTriangleCount() const { return _indices.size() / 3; }
+	/// <summary>
+	/// Gets the number of points on the mesh's convex hull
+	/// </summary>
+	size_t GetHullPointCount() const { return _hull.size(); }
+
+private:
+	friend class CollisionCook;
+
+	std::vector<glm::vec3>                      _positions;
+	std::vector<uint32_t>                       _indices;
+	std::vector<glm::vec3>                      _hull;
+	std::unique_ptr<btTriangleIndexVertexArray> _triangles;
+	std::unique_ptr<btBvhTriangleMeshShape>     _shape;
+	// A tree loaded from a sidecar lives in place in this buffer, rather than being owned by the shape
+	void*                                       _bvhBuffer;
+
+	// Makes the mesh interface over our triangles, once they've been filled in
+	void _CreateTriangles();
+};
+
+/// <summary>
+/// Converts models ahead of time into collision sidecars next to the source file (ex: models/Ground.obj ->
+/// models/Ground.obj.collision), stored alongside the cooked mesh. The sidecar stores the positions and triangles, a
+/// reduced convex hull, and the serialized triangle tree, so loading one doesn't need to build anything. MeshCook
+/// writes these when it cooks a model
+///
+/// Models without a sidecar still work, but their hull and tree have to be built when they're first asked for, which
+/// can take seconds for big meshes
+/// </summary>
+class CollisionCook final
+{
+public:
+	/// <summary>
+	/// Builds and writes the collision sidecar for a model from it's triangles
+	/// </summary>
+	/// <param name="objPath">The path of the model the triangles came from, used for the sidecar's path and stamp</param>
+	/// <param name="positions">The position of the first vertex, each position is 3 floats</param>
+	/// <param name="stride">The number of bytes between vertices</param>
+	/// <param name="vertexCount">The number of vertices</param>
+	/// <param name="indices">The indices of the triangles</param>
+	/// <param name="indexCount">The number of indices, 3 for each triangle</param>
+	/// <returns>True if the sidecar was written</returns>
+	static bool CookFile(const std::string& objPath, const float* positions, size_t stride, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+
+	/// <summary>
+	/// Gets the path of the sidecar file that stores the collision data for a model
+	/// </summary>
+	static std::string GetSidecarPath(const std::string& objPath);
+	/// <summary>
+	/// Gets the collision data for a model, from it's sidecar if it has a valid one, or built from the model if it
+	/// doesn't. Like the AssetManager, meshes are shared while anyone is holding onto them. Main thread only
+	/// </summary>
+	/// <param name="objPath">The path of the source model (not the sidecar)</param>
+	/// <returns>The collision mesh, or nullptr if the model could not be loaded</returns>
+	static CollisionMesh::sptr GetMesh(const std::string& objPath);
+
+protected:
+	CollisionCook() = default;
+
+	static std::unordered_map<std::string, std::weak_ptr<CollisionMesh>> _meshes;
+
+	// Loads a sidecar, returns nullptr if it's missing or out of date
+	static CollisionMesh::sptr _LoadSidecar(const std::string& objPath);
+	// Builds the hull and tree from the model itself
+	static CollisionMesh::sptr _Build(const std::string& objPath);
+	// Fills in a mesh's triangles, hull and tree from a set of vertices
+	static void _Build(CollisionMesh& mesh, const float* positions, size_t stride, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+};
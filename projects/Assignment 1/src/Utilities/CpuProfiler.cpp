@@ -0,0 +1,138 @@
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <chrono>
+
+std::atomic<bool> CpuProfiler::Enabled(true);
+std::mutex CpuProfiler::_threadsLock;
+std::vector<std::unique_ptr<CpuProfiler::ThreadBuffer>> CpuProfiler::_threads;
+
+CpuProfiler::CpuProfiler() :
+	_frameStart(0),
+	_historyIx(0)
+{ }
+
+uint64_t CpuProfiler::Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CpuProfiler::ThreadBuffer& CpuProfiler::_GetThreadBuffer() {
+	thread_local ThreadBuffer* buffer = nullptr;
+	if (buffer == nullptr) {
+		std::lock_guard<std::mutex> lock(_threadsLock);
+		_threads.push_back(std::make_unique<ThreadBuffer>());
+		buffer = _threads.back().get();
+	}
+	return *buffer;
+}
+
+uint64_t CpuProfiler::BeginZone() {
+	_GetThreadBuffer().Depth++;
+	return Now();
+}
+
+void CpuProfiler::EndZone(const char* name, uint64_t start) {
+	uint64_t end = Now();
+	ThreadBuffer& buffer = _GetThreadBuffer();
+	buffer.Depth--;
+	if (!Enabled.load(std::memory_order_relaxed)) {
+		return;
+	}
+	// Only this thread writes to the head, the release lets the reader see the event once it sees the new head
+	uint32_t head = buffer.Head.load(std::memory_order_relaxed);
+	buffer.Events[head % RING_SIZE] = { name, start, end, buffer.Depth, 0 };
+	buffer.Head.store(head + 1, std::memory_order_release);
+}
+
+void CpuProfiler::BeginFrame() {
+	_frameStart = BeginZone();
+}
+
+void CpuProfiler::EndFrame() {
+	EndZone("Frame", _frameStart);
+
+	// Collect everything that has been recorded since the last frame
+	_frameEvents.clear();
+	{
+		std::lock_guard<std::mutex> lock(_threadsLock);
+		for (uint32_t threadIx = 0; threadIx < _threads.size(); threadIx++) {
+			ThreadBuffer* buffer = _threads[threadIx].get();
+			uint32_t head = buffer->Head.load(std::memory_order_acquire);
+			// If a thread recorded more than the ring can hold, the oldest events were overwritten
+			if (head - buffer->Tail > RING_SIZE) {
+				buffer->Tail = head - RING_SIZE;
+			}
+			for (; buffer->Tail != head; buffer->Tail++) {
+				_frameEvents.push_back(buffer->Events[buffer->Tail % RING_SIZE]);
+				_frameEvents.back().Thread = threadIx;
+			}
+		}
+	}
+
+	// Sort so parents come before their children, then we can rebuild the hierarchy with a stack
+	std::sort(_frameEvents.begin(), _frameEvents.end(), [](const Event& l, const Event& r) {
+		return l.Start < r.Start || (l.Start == r.Start && l.Depth < r.Depth);
+	});
+
+	_historyIx = (_historyIx + 1) % HISTORY_SIZE;
+	for (ZoneStats& zone : _zones) {
+		zone.Inclusive[_historyIx] = 0.0f;
+		zone.Exclusive[_historyIx] = 0.0f;
+	}
+
+	// The stack stores the depth and index in _zones of each open zone
+	std::vector<std::pair<uint32_t, int>> stack;
+	for (const Event& e : _frameEvents) {
+		while (!stack.empty() && stack.back().first >= e.Depth) {
+			stack.pop_back();
+		}
+		int parentIx = stack.empty() ? -1 : stack.back().second;
+		std::string path = parentIx == -1 ? e.Name : _zones[parentIx].Path + "/" + e.Name;
+		// New zones are always inserted after all of their ancestors, so the indices on the stack stay valid
+		int zoneIx = _FindOrAddZone(path, e.Name, static_cast<int>(e.Depth), parentIx);
+
+		float ms = static_cast<float>(e.End - e.Start) / 1000000.0f;
+		_zones[zoneIx].Inclusive[_historyIx] += ms;
+		_zones[zoneIx].Exclusive[_historyIx] += ms;
+		if (parentIx != -1) {
+			_zones[parentIx].Exclusive[_historyIx] -= ms;
+		}
+		stack.push_back({ e.Depth, zoneIx });
+	}
+}
+
+int CpuProfiler::_FindOrAddZone(const std::string& path, const char* name, int depth, int parentIx) {
+	for (int ix = 0; ix < static_cast<int>(_zones.size()); ix++) {
+		if (_zones[ix].Path == path) {
+			return ix;
+		}
+	}
+	// New zones go after the last existing descendant of their parent, so the list stays in hierarchy order
+	int insertIx = static_cast<int>(_zones.size());
+	if (parentIx != -1) {
+		std::string prefix = _zones[parentIx].Path + "/";
+		insertIx = parentIx + 1;
+		while (insertIx < static_cast<int>(_zones.size()) && _zones[insertIx].Path.compare(0, prefix.size(), prefix) == 0) {
+			insertIx++;
+		}
+	}
+	ZoneStats zone;
+	zone.Path = path;
+	zone.Name = name;
+	zone.Depth = depth;
+	_zones.insert(_zones.begin() + insertIx, zone);
+	return insertIx;
+}
+
+CpuProfiler::Summary CpuProfiler::Summarize(const float* samples, int count) {
+	std::vector<float> sorted(samples, samples + count);
+	std::sort(sorted.begin(), sorted.end());
+	float total = 0.0f;
+	for (float sample : sorted) {
+		total += sample;
+	}
+	Summary result;
+	result.Min = sorted.front();
+	result.Avg = total / count;
+	result.P99 = sorted[std::min(count - 1, (count * 99) / 100)];
+	return result;
+}
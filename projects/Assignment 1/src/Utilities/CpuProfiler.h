@@ -0,0 +1,171 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// A lightweight hierarchical CPU profiler. Zones are recorded into a lock-free ring buffer owned by the
+/// thread that records them (so recording never has to wait on anything), and are collected and aggregated
+/// into inclusive and exclusive timings once per frame by EndFrame
+/// 
+/// Use the PROFILE_SCOPE macro to time a block of code
+/// </summary>
+class CpuProfiler
+{
+public:
+	static CpuProfiler& Instance() {
+		static CpuProfiler instance;
+		return instance;
+	}
+
+	/// <summary>
+	/// The number of frames of timings we keep for each zone
+	/// </summary>
+	static const int HISTORY_SIZE = 128;
+	/// <summary>
+	/// The number of zones each thread can record before the oldest ones are overwritten
+	/// </summary>
+	static const uint32_t RING_SIZE = 4096;
+
+	/// <summary>
+	/// A single completed zone, as recorded by the thread that ran it
+	/// </summary>
+	struct Event {
+		const char* Name;
+		uint64_t    Start;
+		uint64_t    End;
+		uint32_t    Depth;
+		// The index of the thread that recorded the event, only filled in once the event has been collected
+		uint32_t    Thread;
+	};
+
+	/// <summary>
+	/// The aggregated timings for a single zone in the hierarchy, over the last HISTORY_SIZE frames
+	/// </summary>
+	struct ZoneStats {
+		/// <summary>
+		/// The full path to the zone in the hierarchy, ex: Frame/Render/Sort
+		/// </summary>
+		std::string Path;
+		/// <summary>
+		/// The name of the zone, without it's parents
+		/// </summary>
+		const char* Name;
+		/// <summary>
+		/// How deep the zone is in the hierarchy, 0 for the frame itself
+		/// </summary>
+		int         Depth;
+		/// <summary>
+		/// The time spent in the zone each frame, including time spent in child zones, in milliseconds
+		/// </summary>
+		float       Inclusive[HISTORY_SIZE] = { 0.0f };
+		/// <summary>
+		/// The time spent in the zone each frame, not including time spent in child zones, in milliseconds
+		/// </summary>
+		float       Exclusive[HISTORY_SIZE] = { 0.0f };
+	};
+
+	/// <summary>
+	/// The minimum, average and 99th percentile of a set of samples
+	/// </summary>
+	struct Summary {
+		float Min;
+		float Avg;
+		float P99;
+	};
+
+	/// <summary>
+	/// Gets the current time in nanoseconds, from an arbitrary point in time
+	/// </summary>
+	static uint64_t Now();
+
+	/// <summary>
+	/// Starts a zone on the calling thread, returning the start time to pass to EndZone
+	/// </summary>
+	static uint64_t BeginZone();
+	/// <summary>
+	/// Ends a zone on the calling thread, recording it into the thread's ring buffer
+	/// </summary>
+	/// <param name="name">The name of the zone, must be a string literal (or otherwise outlive the profiler)</param>
+	/// <param name="start">The time returned by BeginZone</param>
+	static void EndZone(const char* name, uint64_t start);
+
+	/// <summary>
+	/// Starts a new frame, opening a zone covering the whole frame on the calling thread
+	/// </summary>
+	void BeginFrame();
+	/// <summary>
+	/// Ends the current frame, and aggregates all of the zones that were recorded during it
+	/// </summary>
+	void EndFrame();
+
+	/// <summary>
+	/// Gets the zones we have seen, in hierarchy order (parents appear before their children)
+	/// </summary>
+	const std::vector<ZoneStats>& GetZones() const { return _zones; }
+	/// <summary>
+	/// Gets the index within the history buffers of the most recent frame
+	/// </summary>
+	int GetHistoryIndex() const { return _historyIx; }
+	/// <summary>
+	/// Gets the raw zones that were collected during the last call to EndFrame, sorted by start time
+	/// </summary>
+	const std::vector<Event>& GetFrameEvents() const { return _frameEvents; }
+	/// <summary>
+	/// Calculates the min, average and 99th percentile of a history buffer
+	/// </summary>
+	static Summary Summarize(const float* samples, int count = HISTORY_SIZE);
+
+	/// <summary>
+	/// When false, zones are not recorded (note that open zones will still be closed)
+	/// </summary>
+	static std::atomic<bool> Enabled;
+
+protected:
+	CpuProfiler();
+
+	// A ring buffer of events owned by a single thread, the owner is the only writer so no locks are needed
+	struct ThreadBuffer {
+		Event                 Events[RING_SIZE];
+		std::atomic<uint32_t> Head;
+		uint32_t              Tail;
+		uint32_t              Depth;
+
+		ThreadBuffer() : Events(), Head(0), Tail(0), Depth(0) {}
+	};
+
+	// Gets the ring buffer for the calling thread, creating and registering it on first use
+	static ThreadBuffer& _GetThreadBuffer();
+
+	// Finds the zone with the given path, adding it after it's parent if it does not exist yet
+	int _FindOrAddZone(const std::string& path, const char* name, int depth, int parentIx);
+
+	uint64_t _frameStart;
+	int      _historyIx;
+	std::vector<ZoneStats> _zones;
+	// Scratch space used while aggregating a frame, kept around to avoid re-allocating each frame
+	std::vector<Event> _frameEvents;
+
+	// All the thread buffers that have been created, only locked when a new thread records it's first zone
+	static std::mutex _threadsLock;
+	static std::vector<std::unique_ptr<ThreadBuffer>> _threads;
+};
+
+/// <summary>
+/// Helper for timing a block of code on the CPU, the zone ends when this goes out of scope
+/// </summary>
+struct CpuProfileScope final {
+	CpuProfileScope(const char* name) : _name(name), _start(CpuProfiler::BeginZone()) {}
+	~CpuProfileScope() { CpuProfiler::EndZone(_name, _start); }
+
+private:
+	const char* _name;
+	uint64_t    _start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) CpuProfileScope PROFILE_CONCAT(__cpuProfileScope, __LINE__)(name)
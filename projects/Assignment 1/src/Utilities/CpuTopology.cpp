@@ -0,0 +1,187 @@
+#include "CpuTopology.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <filesystem>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "Logging.h"
+
+std::vector<CpuTopology::Core> CpuTopology::_cores;
+uint32_t                       CpuTopology::_nodeCount = 1;
+
+// Detect only ever runs once, even if the first calls come from a few threads at a time
+static std::once_flag detected;
+
+#ifdef _WIN32
+// Fills in the cores with the node numbers the OS uses, which get renumbered afterwards
+static void ReadCores(std::vector<CpuTopology::Core>& cores) {
+	DWORD length = 0;
+	GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+	std::vector<uint8_t> buffer(length);
+	if (length == 0 || !GetLogicalProcessorInformationEx(RelationAll, reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &length)) {
+		return;
+	}
+
+	std::vector<std::pair<DWORD, GROUP_AFFINITY>> nodes;
+	std::vector<GROUP_AFFINITY> coreMasks;
+	for (DWORD offset = 0; offset < length;) {
+		const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& info = *reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+		if (info.Relationship == RelationNumaNode) {
+			nodes.emplace_back(info.NumaNode.NodeNumber, info.NumaNode.GroupMask);
+		} else if (info.Relationship == RelationProcessorCore) {
+			// A core never spans processor groups, so the first mask is all of it
+			coreMasks.push_back(info.Processor.GroupMask[0]);
+		}
+		offset += info.Size;
+	}
+
+	for (const GROUP_AFFINITY& mask : coreMasks) {
+		CpuTopology::Core core;
+		core.Node = 0;
+		for (const auto& [number, nodeMask] : nodes) {
+			if (nodeMask.Group == mask.Group && (nodeMask.Mask & mask.Mask) != 0) {
+				core.Node = number;
+				break;
+			}
+		}
+		for (uint32_t bit = 0; bit < 64; bit++) {
+			if ((mask.Mask >> bit) & 1) {
+				core.Processors.push_back(mask.Group * 64 + bit);
+			}
+		}
+		cores.push_back(std::move(core));
+	}
+}
+
+bool CpuTopology::PinThread(std::thread::native_handle_type thread, uint32_t core) {
+	Detect();
+	if (core >= _cores.size()) {
+		return false;
+	}
+	GROUP_AFFINITY affinity = {};
+	affinity.Group = static_cast<WORD>(_cores[core].Processors[0] / 64);
+	for (uint32_t processor : _cores[core].Processors) {
+		affinity.Mask |= static_cast<KAFFINITY>(1) << (processor % 64);
+	}
+	return SetThreadGroupAffinity(static_cast<HANDLE>(thread), &affinity, nullptr) != 0;
+}
+
+bool CpuTopology::PinCurrentThread(uint32_t core) {
+	return PinThread(GetCurrentThread(), core);
+}
+#else
+// Reads a single number out of a file in sysfs, or returns -1 if it isn't there
+static int ReadNumber(const std::filesystem::path& path) {
+	std::ifstream file(path);
+	int result = -1;
+	return (file >> result) ? result : -1;
+}
+
+// Fills in the cores with the node numbers the OS uses, which get renumbered afterwards
+static void ReadCores(std::vector<CpuTopology::Core>& cores) {
+	namespace fs = std::filesystem;
+	std::error_code error;
+	// Keyed on the socket and the core's index in it, core ids are only unique within a socket
+	std::map<std::pair<int, int>, CpuTopology::Core> found;
+	for (const fs::directory_entry& entry : fs::directory_iterator("/sys/devices/system/cpu", error)) {
+		const std::string name = entry.path().filename().string();
+		if (name.size() <= 3 || name.compare(0, 3, "cpu") != 0 || !std::all_of(name.begin() + 3, name.end(), ::isdigit)) {
+			continue;
+		}
+		// Offline processors don't have a topology to read
+		const int coreId = ReadNumber(entry.path() / "topology" / "core_id");
+		const int package = ReadNumber(entry.path() / "topology" / "physical_package_id");
+		if (coreId < 0) {
+			continue;
+		}
+		uint32_t node = 0;
+		for (const fs::directory_entry& link : fs::directory_iterator(entry.path(), error)) {
+			const std::string linkName = link.path().filename().string();
+			if (linkName.size() > 4 && linkName.compare(0, 4, "node") == 0) {
+				node = static_cast<uint32_t>(std::stoul(linkName.substr(4)));
+				break;
+			}
+		}
+		CpuTopology::Core& core = found[{ package, coreId }];
+		core.Node = node;
+		core.Processors.push_back(static_cast<uint32_t>(std::stoul(name.substr(3))));
+	}
+	for (auto& [key, core] : found) {
+		std::sort(core.Processors.begin(), core.Processors.end());
+		cores.push_back(std::move(core));
+	}
+}
+
+bool CpuTopology::PinThread(std::thread::native_handle_type thread, uint32_t core) {
+	Detect();
+	if (core >= _cores.size()) {
+		return false;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (uint32_t processor : _cores[core].Processors) {
+		CPU_SET(processor, &set);
+	}
+	return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+bool CpuTopology::PinCurrentThread(uint32_t core) {
+	return PinThread(pthread_self(), core);
+}
+#endif
+
+void CpuTopology::Detect() {
+	std::call_once(detected, []() {
+		ReadCores(_cores);
+		if (_cores.empty()) {
+			const uint32_t processors = std::max(std::thread::hardware_concurrency(), 1u);
+			for (uint32_t ix = 0; ix < processors; ix++) {
+				_cores.push_back(Core{ 0, { ix } });
+			}
+		}
+
+		// Number the nodes from 0 in the order the OS does, then group the cores by node
+		std::vector<uint32_t> nodes;
+		for (const Core& core : _cores) {
+			nodes.push_back(core.Node);
+		}
+		std::sort(nodes.begin(), nodes.end());
+		nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+		for (Core& core : _cores) {
+			core.Node = static_cast<uint32_t>(std::lower_bound(nodes.begin(), nodes.end(), core.Node) - nodes.begin());
+		}
+		std::stable_sort(_cores.begin(), _cores.end(), [](const Core& a, const Core& b) {
+			return a.Node != b.Node ? a.Node < b.Node : a.Processors[0] < b.Processors[0];
+		});
+		_nodeCount = static_cast<uint32_t>(nodes.size());
+		LOG_INFO("Found {} physical cores across {} NUMA nodes", _cores.size(), _nodeCount);
+	});
+}
+
+uint32_t CpuTopology::GetCoreCount() {
+	Detect();
+	return static_cast<uint32_t>(_cores.size());
+}
+
+uint32_t CpuTopology::GetNodeCount() {
+	Detect();
+	return _nodeCount;
+}
+
+const CpuTopology::Core& CpuTopology::GetCore(uint32_t index) {
+	Detect();
+	return _cores[index];
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Finds the physical cores and NUMA nodes the logical processors belong to, and pins threads to cores. Hyperthreads
+/// of the same core share it's caches and execution units, so the ThreadPool runs one worker per physical core, and on
+/// machines with more than one socket workers steal from their own node first since memory on the other node is a
+/// lot further away
+///
+/// Cores are numbered from 0 in node order, so the first few cores are always on node 0 along with the main thread.
+/// If the topology can't be read, every logical processor is treated as a core of it's own on node 0
+/// </summary>
+class CpuTopology final
+{
+public:
+	/// <summary>
+	/// A single physical core
+	/// </summary>
+	struct Core {
+		// The NUMA node the core is on
+		uint32_t              Node;
+		// The logical processors that run on this core (more than one with hyperthreading). On Windows these are
+		// numbered by processor group, group * 64 + the processor's index in the group
+		std::vector<uint32_t> Processors;
+	};
+
+	/// <summary>
+	/// Reads the topology, called automatically the first time anything else is
+	/// </summary>
+	static void Detect();
+
+	/// <summary>
+	/// Gets the number of physical cores
+	/// </summary>
+	static uint32_t GetCoreCount();
+	/// <summary>
+	/// Gets the number of NUMA nodes, 1 on most machines
+	/// </summary>
+	static uint32_t GetNodeCount();
+	/// <summary>
+	/// Gets a physical core, from 0 to GetCoreCount() - 1
+	/// </summary>
+	static const Core& GetCore(uint32_t index);
+
+	/// <summary>
+	/// Restricts the calling thread to the logical processors of a core, so the OS stops moving it between cores
+	/// </summary>
+	/// <param name="core">The core to pin to, from 0 to GetCoreCount() - 1</param>
+	/// <returns>True if the thread was pinned</returns>
+	static bool PinCurrentThread(uint32_t core);
+	/// <summary>
+	/// Restricts a thread to the logical processors of a core
+	/// </summary>
+	/// <param name="thread">The native handle of the thread (ex: from std::thread::native_handle)</param>
+	/// <param name="core">The core to pin to, from 0 to GetCoreCount() - 1</param>
+	/// <returns>True if the thread was pinned</returns>
+	static bool PinThread(std::thread::native_handle_type thread, uint32_t core);
+
+protected:
+	CpuTopology() = default;
+
+	static std::vector<Core> _cores;
+	static uint32_t          _nodeCount;
+};
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Gets the size and last write time of a file, so cooked sidecars can tell when their source file has changed
+static inline bool GetFileStamp(const std::string& file, uint64_t& size, int64_t& writeTime) {
+	std::error_code error;
+	size = static_cast<uint64_t>(std::filesystem::file_size(file, error));
+	if (error) {
+		return false;
+	}
+	writeTime = static_cast<int64_t>(std::filesystem::last_write_time(file, error).time_since_epoch().count());
+	return !error;
+}
@@ -0,0 +1,222 @@
+#include "FileWatcher.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include "Logging.h"
+
+constexpr std::chrono::milliseconds FileWatcher::SETTLE_TIME;
+
+// Big enough for a burst of changes, anything past it gets dropped by the OS
+static const size_t EVENT_BUFFER_SIZE = 64 * 1024;
+
+void FileWatcher::_Push(const std::string& path) {
+	std::string generic = path;
+	std::replace(generic.begin(), generic.end(), '\\', '/');
+	std::lock_guard<std::mutex> lock(_mutex);
+	_changed[generic] = Clock::now();
+}
+
+std::vector<std::string> FileWatcher::Poll() {
+	std::vector<std::string> result;
+	const Clock::time_point now = Clock::now();
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto it = _changed.begin(); it != _changed.end();) {
+		if (now - it->second >= SETTLE_TIME) {
+			result.push_back(it->first);
+			it = _changed.erase(it);
+		} else {
+			++it;
+		}
+	}
+	return result;
+}
+
+#ifdef _WIN32
+static_assert(sizeof(OVERLAPPED) <= 32, "OVERLAPPED doesn't fit in FileWatcher::Watch");
+
+FileWatcher::FileWatcher(const std::vector<std::string>& directories) :
+	_isStopping(false),
+	_stopEvent(nullptr)
+{
+	_watches.reserve(directories.size());
+	for (const std::string& directory : directories) {
+		HANDLE handle = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) {
+			LOG_WARN("Can't watch \"{}\" for changes", directory);
+			continue;
+		}
+		_watches.emplace_back();
+		Watch& watch = _watches.back();
+		watch.Directory = directory;
+		watch.Handle = handle;
+		watch.Event = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+		watch.Buffer.resize(EVENT_BUFFER_SIZE);
+		if (!_Read(watch)) {
+			LOG_WARN("Can't watch \"{}\" for changes", directory);
+			CloseHandle(watch.Event);
+			CloseHandle(watch.Handle);
+			_watches.pop_back();
+		}
+	}
+	if (!_watches.empty()) {
+		_stopEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+		_thread = std::thread([this]() { _Run(); });
+	}
+}
+
+FileWatcher::~FileWatcher() {
+	if (_thread.joinable()) {
+		_isStopping = true;
+		SetEvent(_stopEvent);
+		_thread.join();
+		CloseHandle(_stopEvent);
+	}
+	for (Watch& watch : _watches) {
+		CancelIoEx(watch.Handle, reinterpret_cast<OVERLAPPED*>(watch.Overlapped));
+		CloseHandle(watch.Handle);
+		CloseHandle(watch.Event);
+	}
+}
+
+bool FileWatcher::_Read(Watch& watch) {
+	OVERLAPPED* overlapped = reinterpret_cast<OVERLAPPED*>(watch.Overlapped);
+	memset(overlapped, 0, sizeof(OVERLAPPED));
+	overlapped->hEvent = watch.Event;
+	return ReadDirectoryChangesW(watch.Handle, watch.Buffer.data(), static_cast<DWORD>(watch.Buffer.size()), TRUE,
+		FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, overlapped, nullptr) != FALSE;
+}
+
+void FileWatcher::_Run() {
+	std::vector<HANDLE> events;
+	for (const Watch& watch : _watches) {
+		events.push_back(watch.Event);
+	}
+	events.push_back(_stopEvent);
+
+	while (!_isStopping) {
+		const DWORD signalled = WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, INFINITE);
+		if (signalled < WAIT_OBJECT_0 || signalled >= WAIT_OBJECT_0 + _watches.size()) {
+			break;
+		}
+		Watch& watch = _watches[signalled - WAIT_OBJECT_0];
+		DWORD size = 0;
+		if (GetOverlappedResult(watch.Handle, reinterpret_cast<OVERLAPPED*>(watch.Overlapped), &size, FALSE) && size > 0) {
+			const char* next = watch.Buffer.data();
+			while (true) {
+				const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(next);
+				if (info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+					const int length = static_cast<int>(info->FileNameLength / sizeof(WCHAR));
+					std::string name(WideCharToMultiByte(CP_UTF8, 0, info->FileName, length, nullptr, 0, nullptr, nullptr), '\0');
+					WideCharToMultiByte(CP_UTF8, 0, info->FileName, length, name.data(), static_cast<int>(name.size()), nullptr, nullptr);
+					_Push(watch.Directory + "/" + name);
+				}
+				if (info->NextEntryOffset == 0) {
+					break;
+				}
+				next += info->NextEntryOffset;
+			}
+		}
+		// A size of 0 means the buffer overflowed, there's no way to tell what changed so we just carry on
+		if (!_Read(watch)) {
+			LOG_WARN("Stopped watching \"{}\" for changes", watch.Directory);
+			break;
+		}
+	}
+}
+#else
+FileWatcher::FileWatcher(const std::vector<std::string>& directories) :
+	_isStopping(false),
+	_inotify(-1),
+	_stopPipe{ -1, -1 }
+{
+	_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_inotify < 0) {
+		LOG_WARN("Can't watch for file changes, inotify is not available");
+		return;
+	}
+	for (const std::string& directory : directories) {
+		if (!std::filesystem::is_directory(directory)) {
+			LOG_WARN("Can't watch \"{}\" for changes", directory);
+			continue;
+		}
+		// inotify only watches a single directory, so everything under it needs a watch of it's own
+		_AddWatch(directory);
+		std::error_code error;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error)) {
+			if (entry.is_directory()) {
+				_AddWatch(entry.path().generic_string());
+			}
+		}
+	}
+	if (!_watches.empty() && pipe(_stopPipe) == 0) {
+		_thread = std::thread([this]() { _Run(); });
+	}
+}
+
+FileWatcher::~FileWatcher() {
+	if (_thread.joinable()) {
+		_isStopping = true;
+		const char wake = 0;
+		(void)write(_stopPipe[1], &wake, 1);
+		_thread.join();
+	}
+	for (int fd : _stopPipe) {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+	if (_inotify >= 0) {
+		close(_inotify);
+	}
+}
+
+void FileWatcher::_AddWatch(const std::string& directory) {
+	const int watch = inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (watch >= 0) {
+		_watches[watch] = directory;
+	}
+}
+
+void FileWatcher::_Run() {
+	std::vector<char> buffer(EVENT_BUFFER_SIZE);
+	pollfd fds[2] = { { _inotify, POLLIN, 0 }, { _stopPipe[0], POLLIN, 0 } };
+	while (!_isStopping) {
+		if (poll(fds, 2, -1) < 0 || (fds[1].revents & POLLIN)) {
+			break;
+		}
+		const ssize_t size = read(_inotify, buffer.data(), buffer.size());
+		for (ssize_t offset = 0; offset < size;) {
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+			offset += sizeof(inotify_event) + event->len;
+			auto watch = _watches.find(event->wd);
+			if (watch == _watches.end() || event->len == 0) {
+				continue;
+			}
+			const std::string path = watch->second + "/" + event->name;
+			if (event->mask & IN_ISDIR) {
+				// New directories need watching too, files that land in them before the watch is added get missed
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+					_AddWatch(path);
+				}
+			} else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+				// Files are only reported once they're closed, IN_CREATE is just for the directories
+				_Push(path);
+			}
+		}
+	}
+}
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Watches a set of directories (and everything under them) for files being written, on a thread of it's own so it
+/// costs nothing until something changes. Uses ReadDirectoryChangesW on Windows and inotify everywhere else
+///
+/// Editors tend to save a file in a few steps (ex: truncate, write, rename), so a file is only handed back once it's
+/// gone SETTLE_TIME without changing again. That way a reload never sees a half written file
+/// </summary>
+class FileWatcher final
+{
+public:
+	FileWatcher(const FileWatcher& other) = delete;
+	FileWatcher(FileWatcher&& other) = delete;
+	FileWatcher& operator=(const FileWatcher& other) = delete;
+	FileWatcher& operator=(FileWatcher&& other) = delete;
+	typedef std::shared_ptr<FileWatcher> sptr;
+	static inline sptr Create(const std::vector<std::string>& directories) {
+		return std::make_shared<FileWatcher>(directories);
+	}
+
+	// How long a file has to go without changing before Poll hands it back
+	static constexpr std::chrono::milliseconds SETTLE_TIME = std::chrono::milliseconds(150);
+
+	/// <summary>
+	/// Starts watching the given directories, directories that don't exist are skipped with a warning
+	/// </summary>
+	/// <param name="directories">The directories to watch, relative to the working directory</param>
+	FileWatcher(const std::vector<std::string>& directories);
+	~FileWatcher();
+
+	/// <summary>
+	/// Takes the files that have changed and settled since the last call, each listed once. Paths are the watched
+	/// directory joined with the file's path under it, using forward slashes (ex: "shaders/fullscreen.vert.glsl")
+	/// </summary>
+	std::vector<std::string> Poll();
+
+	/// <summary>
+	/// Returns true if at least one directory is being watched
+	/// </summary>
+	bool IsWatching() const { return _thread.joinable(); }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	std::thread       _thread;
+	std::atomic<bool> _isStopping;
+	std::mutex        _mutex;
+	// The files that have changed, and when they last did
+	std::unordered_map<std::string, Clock::time_point> _changed;
+
+#ifdef _WIN32
+	struct Watch {
+		std::string       Directory;
+		void*             Handle;
+		void*             Event;
+		std::vector<char> Buffer;
+		// An OVERLAPPED, kept as bytes so we don't need Windows.h in the header
+		alignas(8) char   Overlapped[32];
+	};
+	std::vector<Watch> _watches;
+	void*              _stopEvent;
+	bool _Read(Watch& watch);
+#else
+	int _inotify;
+	// Written to by the destructor to wake the thread up
+	int _stopPipe[2];
+	// The directory each inotify watch descriptor is watching
+	std::unordered_map<int, std::string> _watches;
+	void _AddWatch(const std::string& directory);
+#endif
+
+	void _Run();
+	void _Push(const std::string& path);
+};
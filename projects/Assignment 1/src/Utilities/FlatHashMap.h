@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// An open addressing hash map with linear probing, for building lookups in hot loops (ex: de-duplicating vertices).
+/// Everything lives in one flat array, so inserts don't allocate once the map is reserved, and lookups walk through
+/// neighbouring slots instead of chasing pointers like std::unordered_map does
+///
+/// Entries can't be removed, the map is meant to be filled up, used and thrown away. The hash and equality functors
+/// can carry state, so keys can be indices into some other array (see MeshBuilder::Weld)
+/// </summary>
+/// <typeparam name="Key">The key type, should be cheap to copy</typeparam>
+/// <typeparam name="Value">The value type, must be default constructible</typeparam>
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+class FlatHashMap final
+{
+public:
+	FlatHashMap(const Hash& hash = Hash(), const Equal& equal = Equal()) :
+		_hash(hash), _equal(equal), _size(0), _shift(64) { }
+	~FlatHashMap() = default;
+
+	/// <summary>
+	/// Makes room for the given number of entries, so that adding them won't need to re-hash the map
+	/// </summary>
+	void Reserve(size_t count) {
+		// Linear probing falls apart as the map fills up, so we keep it at most 3/4 full
+		size_t capacity = 16;
+		while (capacity * 3 / 4 < count) {
+			capacity *= 2;
+		}
+		if (capacity > _slots.size()) {
+			_Rehash(capacity);
+		}
+	}
+
+	/// <summary>
+	/// Adds an entry if the key isn't in the map yet
+	/// </summary>
+	/// <param name="key">The key to look up</param>
+	/// <param name="value">The value to add if the key is missing</param>
+	/// <returns>A pointer to the value stored for the key (valid until the next insert), and whether it was added</returns>
+	std::pair<Value*, bool> TryEmplace(const Key& key, const Value& value) {
+		if ((_size + 1) * 4 > _slots.size() * 3) {
+			_Rehash(_slots.empty() ? 16 : _slots.size() * 2);
+		}
+		size_t index = _GetHome(key);
+		while (_slots[index].IsUsed) {
+			if (_equal(_slots[index].First, key)) {
+				return { &_slots[index].Second, false };
+			}
+			index = (index + 1) & (_slots.size() - 1);
+		}
+		Slot& slot = _slots[index];
+		slot.IsUsed = true;
+		slot.First = key;
+		slot.Second = value;
+		_size++;
+		return { &slot.Second, true };
+	}
+
+	/// <summary>
+	/// Looks up the value for a key
+	/// </summary>
+	/// <returns>A pointer to the value (valid until the next insert), or nullptr if the key isn't in the map</returns>
+	Value* Find(const Key& key) {
+		if (_size == 0) {
+			return nullptr;
+		}
+		for (size_t index = _GetHome(key); _slots[index].IsUsed; index = (index + 1) & (_slots.size() - 1)) {
+			if (_equal(_slots[index].First, key)) {
+				return &_slots[index].Second;
+			}
+		}
+		return nullptr;
+	}
+
+	/// <summary>
+	/// Returns the number of entries in the map
+	/// </summary>
+	size_t GetSize() const { return _size; }
+
+	/// <summary>
+	/// Removes every entry, but keeps the memory around for re-use
+	/// </summary>
+	void Clear() {
+		for (Slot& slot : _slots) {
+			slot.IsUsed = false;
+		}
+		_size = 0;
+	}
+
+private:
+	struct Slot {
+		Key   First;
+		Value Second;
+		bool  IsUsed = false;
+	};
+
+	// Hashes that leave the low bits alone (ex: std::hash on integers is often the identity) would pile up in the
+	// same slots, so we use fibonacci hashing to spread them out and take the top bits
+	size_t _GetHome(const Key& key) const {
+		const uint64_t hash = static_cast<uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ull;
+		return static_cast<size_t>(hash >> _shift);
+	}
+
+	void _Rehash(size_t capacity) {
+		std::vector<Slot> old;
+		old.swap(_slots);
+		_slots.resize(capacity);
+		_shift = 64;
+		for (size_t size = capacity; size > 1; size >>= 1) {
+			_shift--;
+		}
+		_size = 0;
+		for (const Slot& slot : old) {
+			if (slot.IsUsed) {
+				TryEmplace(slot.First, slot.Second);
+			}
+		}
+	}
+
+	Hash              _hash;
+	Equal             _equal;
+	std::vector<Slot> _slots;
+	size_t            _size;
+	// How far to shift the mixed hash down so it lands in the table, 64 - log2(capacity)
+	uint32_t          _shift;
+};
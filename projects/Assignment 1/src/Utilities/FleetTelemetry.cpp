@@ -0,0 +1,208 @@
+#include "FleetTelemetry.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <json.hpp>
+#include <Sys.h>
+
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/TraceRecorder.h"
+#include "Logging.h"
+
+bool                     FleetTelemetry::_isRunning = false;
+std::string              FleetTelemetry::_path;
+uint64_t                 FleetTelemetry::_intervalNs = 0;
+uint64_t                 FleetTelemetry::_startedAt = 0;
+uint64_t                 FleetTelemetry::_intervalStart = 0;
+std::time_t              FleetTelemetry::_intervalStartTime = 0;
+uint64_t                 FleetTelemetry::_lastMemorySample = 0;
+uint32_t                 FleetTelemetry::_intervalCount = 0;
+float                    FleetTelemetry::_medianMs = 0.0f;
+std::mutex               FleetTelemetry::_assetLock;
+FleetTelemetry::Totals   FleetTelemetry::_interval;
+FleetTelemetry::Totals   FleetTelemetry::_lifetime;
+
+// Bump this whenever the layout of the file changes
+static const int      TELEMETRY_VERSION = 1;
+// How often the process' memory gets checked for it's high-water mark, and the hitch threshold gets refreshed
+static const uint64_t SAMPLE_INTERVAL_NS = 1000000000;
+// The frames an interval needs before it's own median is trusted over the lifetime's
+static const uint64_t MIN_MEDIAN_FRAMES = 30;
+
+static double ToMB(double bytes) {
+	return bytes / (1024.0 * 1024.0);
+}
+
+static std::string FormatTime(std::time_t time) {
+	char result[32];
+	std::strftime(result, sizeof(result), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&time));
+	return result;
+}
+
+static std::string GetHostName() {
+	const char* name = std::getenv("COMPUTERNAME");
+	if (name == nullptr) {
+		name = std::getenv("HOSTNAME");
+	}
+	return name != nullptr ? name : "unknown";
+}
+
+static nlohmann::json Quantiles(const QuantileSketch& sketch) {
+	return nlohmann::json({
+		{ "count", sketch.GetCount() },
+		{ "min", sketch.GetMin() },
+		{ "avg", sketch.GetMean() },
+		{ "p50", sketch.GetQuantile(0.5) },
+		{ "p90", sketch.GetQuantile(0.9) },
+		{ "p99", sketch.GetQuantile(0.99) },
+		{ "p999", sketch.GetQuantile(0.999) },
+		{ "max", sketch.GetMax() }
+	});
+}
+
+void FleetTelemetry::Totals::Merge(const Totals& other) {
+	FrameMs.Merge(other.FrameMs);
+	AssetLoadMs.Merge(other.AssetLoadMs);
+	Hitches += other.Hitches;
+	if (other.SlowestAssetMs > SlowestAssetMs) {
+		SlowestAsset = other.SlowestAsset;
+		SlowestAssetMs = other.SlowestAssetMs;
+	}
+	PeakProcessBytes = std::max(PeakProcessBytes, other.PeakProcessBytes);
+	for (int ix = 0; ix < static_cast<int>(MemoryTag::Count); ix++) {
+		PeakTagBytes[ix] = std::max(PeakTagBytes[ix], other.PeakTagBytes[ix]);
+	}
+}
+
+void FleetTelemetry::Totals::Clear() {
+	FrameMs.Clear();
+	AssetLoadMs.Clear();
+	Hitches = 0;
+	SlowestAsset.clear();
+	SlowestAssetMs = 0.0;
+	PeakProcessBytes = 0;
+	std::fill(std::begin(PeakTagBytes), std::end(PeakTagBytes), 0);
+}
+
+void FleetTelemetry::Start(const std::string& path, double intervalSeconds) {
+	Stop();
+	_path = path;
+	_intervalNs = static_cast<uint64_t>(std::max(intervalSeconds, 1.0) * 1000000000.0);
+	_startedAt = _intervalStart = CpuProfiler::Now();
+	_intervalStartTime = std::time(nullptr);
+	_lastMemorySample = 0;
+	_intervalCount = 0;
+	_medianMs = 0.0f;
+	{
+		std::lock_guard<std::mutex> lock(_assetLock);
+		_interval.Clear();
+		_lifetime.Clear();
+		_isRunning = true;
+	}
+	LOG_INFO("Writing telemetry to \"{}\" every {} seconds", path, intervalSeconds);
+}
+
+void FleetTelemetry::Stop() {
+	if (!_isRunning) {
+		return;
+	}
+	_EndInterval(CpuProfiler::Now());
+	std::lock_guard<std::mutex> lock(_assetLock);
+	_isRunning = false;
+}
+
+void FleetTelemetry::EndFrame(float frameMs) {
+	if (!_isRunning) {
+		return;
+	}
+	const uint64_t now = CpuProfiler::Now();
+	_interval.FrameMs.Add(frameMs);
+	const TraceRecorder& traces = TraceRecorder::Instance();
+	if (_medianMs > 0.0f && frameMs > std::max(_medianMs * traces.HitchFactor, traces.HitchMinMs)) {
+		_interval.Hitches++;
+	}
+	// Reading a tag is only a few relaxed loads, so they can be checked every frame without missing a spike
+	for (int ix = 0; ix < static_cast<int>(MemoryTag::Count); ix++) {
+		_interval.PeakTagBytes[ix] = std::max(_interval.PeakTagBytes[ix], MemoryTracker::GetStats(static_cast<MemoryTag>(ix)).Current);
+	}
+	if (now - _lastMemorySample >= SAMPLE_INTERVAL_NS) {
+		_lastMemorySample = now;
+		_interval.PeakProcessBytes = std::max(_interval.PeakProcessBytes, System::GetMemoryUsageBytes());
+		const QuantileSketch& frames = _interval.FrameMs.GetCount() >= MIN_MEDIAN_FRAMES ? _interval.FrameMs : _lifetime.FrameMs;
+		_medianMs = static_cast<float>(frames.GetQuantile(0.5));
+	}
+	if (now - _intervalStart >= _intervalNs) {
+		_EndInterval(now);
+	}
+}
+
+void FleetTelemetry::RecordAssetLoad(const std::string& name, uint64_t start, uint64_t end) {
+	const double ms = static_cast<double>(end - start) / 1000000.0;
+	std::lock_guard<std::mutex> lock(_assetLock);
+	if (!_isRunning) {
+		return;
+	}
+	_interval.AssetLoadMs.Add(ms);
+	if (ms > _interval.SlowestAssetMs) {
+		_interval.SlowestAsset = name;
+		_interval.SlowestAssetMs = ms;
+	}
+}
+
+void FleetTelemetry::_EndInterval(uint64_t now) {
+	using nlohmann::json;
+
+	// Taken all at once, so a load finishing on another thread can't land in between and be missed by both
+	Totals interval;
+	{
+		std::lock_guard<std::mutex> lock(_assetLock);
+		_lifetime.Merge(_interval);
+		interval = _interval;
+		_interval.Clear();
+	}
+	auto toJson = [](const Totals& totals, double seconds) {
+		json tags = json::object();
+		for (int ix = 0; ix < static_cast<int>(MemoryTag::Count); ix++) {
+			tags[MemoryTracker::GetTagName(static_cast<MemoryTag>(ix))] = ToMB(static_cast<double>(totals.PeakTagBytes[ix]));
+		}
+		return json({
+			{ "seconds", seconds },
+			{ "frames", totals.FrameMs.GetCount() },
+			{ "frame_ms", Quantiles(totals.FrameMs) },
+			{ "hitches", totals.Hitches },
+			{ "asset_load_ms", Quantiles(totals.AssetLoadMs) },
+			{ "slowest_asset", { { "name", totals.SlowestAsset }, { "ms", totals.SlowestAssetMs } } },
+			{ "peak_memory_mb", { { "process", ToMB(static_cast<double>(totals.PeakProcessBytes)) }, { "tags", tags } } }
+		});
+	};
+	const std::time_t wallNow = std::time(nullptr);
+	json result = {
+		{ "version", TELEMETRY_VERSION },
+		{ "host", GetHostName() },
+		{ "written", FormatTime(wallNow) },
+		{ "interval", toJson(interval, static_cast<double>(now - _intervalStart) / 1000000000.0) },
+		{ "lifetime", toJson(_lifetime, static_cast<double>(now - _startedAt) / 1000000000.0) }
+	};
+	result["interval"]["index"] = _intervalCount;
+	result["interval"]["start"] = FormatTime(_intervalStartTime);
+	_intervalStart = now;
+	_intervalStartTime = wallNow;
+	_intervalCount++;
+
+	// Whoever's collecting the file could read it at any time, so it's swapped in whole
+	const std::string temporary = _path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::trunc);
+		if (!file) {
+			LOG_WARN("Failed to write telemetry to \"{}\"", temporary);
+			return;
+		}
+		file << result.dump(2);
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, _path, error);
+	if (error) {
+		LOG_WARN("Failed to replace \"{}\" with the latest telemetry: {}", _path, error.message());
+	}
+}
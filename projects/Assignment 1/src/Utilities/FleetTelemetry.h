@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+
+#include "Utilities/MemoryTracker.h"
+#include "Utilities/QuantileSketch.h"
+
+/// <summary>
+/// Sums up how a deployed unit is running for our monitoring, rather than for someone sitting at it. Every interval
+/// (a minute by default) the frame times and asset load times are boiled down to their quantiles, along with how many
+/// frames hitched and the high-water marks of the process' memory and each memory tag, and written out as JSON for the
+/// monitoring stack to pick up. A running total since startup goes out alongside each interval
+///
+/// The times are kept in QuantileSketches, so the memory we use stays the same however many months the unit's been up.
+/// The file is replaced each interval rather than appended to (written to a temporary then renamed over it, so it's
+/// never seen half written), which keeps the disk use fixed too
+///
+/// A frame counts as a hitch the same way it does for TraceRecorder's hitch capture
+/// </summary>
+class FleetTelemetry final
+{
+public:
+	/// <summary>
+	/// Starts aggregating, writing to the given file every interval
+	/// </summary>
+	/// <param name="path">The JSON file to write each interval to</param>
+	/// <param name="intervalSeconds">How long each interval lasts</param>
+	static void Start(const std::string& path, double intervalSeconds = 60.0);
+	/// <summary>
+	/// Writes out whatever's been gathered for the interval that's in progress, and stops
+	/// </summary>
+	static void Stop();
+
+	/// <summary>
+	/// Counts a frame, should be called on the main thread at the end of each one
+	/// </summary>
+	/// <param name="frameMs">How long the frame took, not including any time spent waiting for it to be due</param>
+	static void EndFrame(float frameMs);
+	/// <summary>
+	/// Counts an asset load, can be called from any thread. Every AssetLoadScope reports here
+	/// </summary>
+	/// <param name="name">The asset that was loaded</param>
+	/// <param name="start">The time the load started, from CpuProfiler::Now</param>
+	/// <param name="end">The time the load ended, from CpuProfiler::Now</param>
+	static void RecordAssetLoad(const std::string& name, uint64_t start, uint64_t end);
+
+	static bool IsRunning() { return _isRunning; }
+	static const std::string& GetPath() { return _path; }
+	/// <summary>
+	/// Gets how many intervals have been written so far
+	/// </summary>
+	static uint32_t GetIntervalCount() { return _intervalCount; }
+
+protected:
+	FleetTelemetry() = default;
+
+	// Everything gathered over a single interval, or since startup
+	struct Totals {
+		QuantileSketch FrameMs;
+		QuantileSketch AssetLoadMs;
+		uint64_t       Hitches = 0;
+		// The slowest asset load, and how long it took
+		std::string    SlowestAsset;
+		double         SlowestAssetMs = 0.0;
+		size_t         PeakProcessBytes = 0;
+		int64_t        PeakTagBytes[static_cast<int>(MemoryTag::Count)] = { 0 };
+
+		void Merge(const Totals& other);
+		void Clear();
+	};
+
+	// Rolls the interval that's in progress into the lifetime totals, writes both out and starts the next one
+	static void _EndInterval(uint64_t now);
+
+	static bool        _isRunning;
+	static std::string _path;
+	static uint64_t    _intervalNs;
+	static uint64_t    _startedAt;
+	static uint64_t    _intervalStart;
+	static std::time_t _intervalStartTime;
+	static uint64_t    _lastMemorySample;
+	static uint32_t    _intervalCount;
+	// The frame time that a frame has to be so many times over to count as a hitch, refreshed every second
+	static float       _medianMs;
+	// Asset loads can finish on any thread, so the interval's asset load fields are only touched under the lock
+	static std::mutex  _assetLock;
+	static Totals      _interval;
+	static Totals      _lifetime;
+};
@@ -0,0 +1,101 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <memory>
+
+#include "MemoryTracker.h"
+
+namespace {
+	struct Block {
+		std::unique_ptr<uint8_t[]> Data;
+		size_t                     Size;
+	};
+
+	// The blocks a thread has allocated so far, they're kept around between frames so the arena stops growing once
+	// it's big enough
+	struct ThreadArena {
+		std::vector<Block> Blocks;
+		size_t             Current = 0;
+		size_t             Offset = 0;
+	};
+
+	ThreadArena& GetThreadArena() {
+		thread_local ThreadArena arena;
+		return arena;
+	}
+
+	// Routes the pmr containers to whichever thread's arena is allocating
+	class FrameResource final : public std::pmr::memory_resource {
+	protected:
+		void* do_allocate(size_t bytes, size_t alignment) override {
+			return FrameArena::Allocate(bytes, alignment);
+		}
+		void do_deallocate(void*, size_t, size_t) override { }
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+	};
+}
+
+FrameArena::Scope::Scope() {
+	const ThreadArena& arena = GetThreadArena();
+	_block = arena.Current;
+	_offset = arena.Offset;
+}
+
+FrameArena::Scope::~Scope() {
+	ThreadArena& arena = GetThreadArena();
+	arena.Current = _block;
+	arena.Offset = _offset;
+}
+
+void FrameArena::Reset() {
+	ThreadArena& arena = GetThreadArena();
+	arena.Current = 0;
+	arena.Offset = 0;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+	ThreadArena& arena = GetThreadArena();
+	// Move along the blocks we already have until one has room, we only go to the heap once we run out
+	for (; arena.Current < arena.Blocks.size(); arena.Current++, arena.Offset = 0) {
+		const Block& block = arena.Blocks[arena.Current];
+		const uintptr_t base = reinterpret_cast<uintptr_t>(block.Data.get());
+		const uintptr_t start = (base + arena.Offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+		if (start + size <= base + block.Size) {
+			arena.Offset = start + size - base;
+			return reinterpret_cast<void*>(start);
+		}
+	}
+	// The blocks come from new, which is always aligned to at least max_align_t, so we only pad for anything over that
+	const size_t padding = alignment > alignof(std::max_align_t) ? alignment : 0;
+	MEMORY_SCOPE(MemoryTag::Transient);
+	Block block;
+	block.Size = std::max(BLOCK_SIZE, size + padding);
+	block.Data = std::make_unique<uint8_t[]>(block.Size);
+	arena.Blocks.push_back(std::move(block));
+	arena.Current = arena.Blocks.size() - 1;
+	arena.Offset = 0;
+	return Allocate(size, alignment);
+}
+
+size_t FrameArena::GetUsed() {
+	const ThreadArena& arena = GetThreadArena();
+	size_t result = arena.Offset;
+	for (size_t ix = 0; ix < arena.Current && ix < arena.Blocks.size(); ix++) {
+		result += arena.Blocks[ix].Size;
+	}
+	return result;
+}
+
+size_t FrameArena::GetCapacity() {
+	size_t result = 0;
+	for (const Block& block : GetThreadArena().Blocks) {
+		result += block.Size;
+	}
+	return result;
+}
+
+std::pmr::memory_resource* FrameArena::Resource() {
+	static FrameResource resource;
+	return &resource;
+}
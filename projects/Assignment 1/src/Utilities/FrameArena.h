@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+/// <summary>
+/// A bump pointer allocator for scratch data that only lives for part of a frame. Each thread gets it's own arena,
+/// so allocating is just rounding up and moving an offset along, with no locks and no trips to the heap once the
+/// arena has grown to fit a frame's worth of scratch. Freeing does nothing, the memory comes back all at once
+///
+/// The main thread's arena is reset at the top of every frame. Anything allocated on another thread (ex: by the
+/// snapshot builder's jobs) must be inside a Scope, which hands the memory back when it ends, since the workers don't
+/// have a point they can be reset at. Scopes can be used on the main thread as well, to give memory back early
+///
+/// Use FrameVector (or any container with a FrameAllocator), or pass Resource() to a pmr container
+/// </summary>
+class FrameArena final
+{
+public:
+	/// <summary>
+	/// The size of each block the arenas grow by, anything bigger gets a block of it's own
+	/// </summary>
+	static const size_t BLOCK_SIZE = 1 << 20;
+
+	/// <summary>
+	/// Remembers where the calling thread's arena is up to, and rewinds it back there when it goes out of scope
+	/// </summary>
+	class Scope final {
+	public:
+		Scope();
+		~Scope();
+		Scope(const Scope& other) = delete;
+		Scope& operator=(const Scope& other) = delete;
+	private:
+		size_t _block;
+		size_t _offset;
+	};
+
+	/// <summary>
+	/// Hands everything in the calling thread's arena back at once. Nothing allocated from it may be used afterwards
+	/// </summary>
+	static void Reset();
+	/// <summary>
+	/// Allocates memory from the calling thread's arena, growing it if needed
+	/// </summary>
+	/// <param name="size">The number of bytes to allocate</param>
+	/// <param name="alignment">The alignment of the allocation, must be a power of two</param>
+	static void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	/// <summary>
+	/// Gets the number of bytes in use in the calling thread's arena
+	/// </summary>
+	static size_t GetUsed();
+	/// <summary>
+	/// Gets the number of bytes the calling thread's arena has grown to
+	/// </summary>
+	static size_t GetCapacity();
+
+	/// <summary>
+	/// Gets a memory resource that allocates from the calling thread's arena, for use with the std::pmr containers
+	/// </summary>
+	static std::pmr::memory_resource* Resource();
+};
+
+/// <summary>
+/// An STL allocator that allocates from the calling thread's frame arena. Deallocating does nothing
+/// </summary>
+template <typename T>
+class FrameAllocator
+{
+public:
+	typedef T value_type;
+
+	FrameAllocator() noexcept = default;
+	template <typename U>
+	FrameAllocator(const FrameAllocator<U>&) noexcept { }
+
+	T* allocate(size_t count) {
+		return static_cast<T*>(FrameArena::Allocate(count * sizeof(T), alignof(T)));
+	}
+	void deallocate(T*, size_t) noexcept { }
+
+	template <typename U>
+	bool operator==(const FrameAllocator<U>&) const noexcept { return true; }
+	template <typename U>
+	bool operator!=(const FrameAllocator<U>&) const noexcept { return false; }
+};
+
+/// <summary>
+/// A vector whose storage comes from the calling thread's frame arena
+/// </summary>
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
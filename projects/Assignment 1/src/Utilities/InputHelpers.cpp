@@ -1,23 +1,18 @@
 #include "InputHelpers.h"
-#include <GLFW/glfw3.h>
+#include <TTK/Input.h>
 
 KeyPressWatcher::KeyPressWatcher(int keycode, const std::function<void()>& onPressed) {
-	_isPressed = false;
 	_keyCode = keycode;
 	_onPressed = onPressed;
 }
 
 bool KeyPressWatcher::Poll(GLFWwindow* window) const {
-	if (glfwGetKey(window, _keyCode) == GLFW_PRESS) {
-		if (!_isPressed) {
-			_isPressed = true;
-			if (_onPressed) {
-				_onPressed();
-			}
+	// The edge comes straight from the input events, so we don't need to track the key ourselves
+	if (TTK::Input::GetKeyPressed(static_cast<TTK::KeyCode>(_keyCode))) {
+		if (_onPressed) {
+			_onPressed();
 		}
-		return false;
-	} else {
-		_isPressed = false;
+		return true;
 	}
 	return false;
 }
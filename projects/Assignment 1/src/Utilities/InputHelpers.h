@@ -19,10 +19,14 @@ public:
 	KeyPressWatcher(int keycode, const std::function<void()>& onPressed);
 	~KeyPressWatcher() = default;
 
-	bool Poll(GLFWwindow* window) const;
+	/// <summary>
+	/// Invokes the callback if the key was pressed since the last TTK::Input::Poll
+	/// </summary>
+	/// <param name="window">Unused, key states come from TTK::Input</param>
+	/// <returns>True if the key was pressed</returns>
+	bool Poll(GLFWwindow* window = nullptr) const;
 	
 protected:
 	int _keyCode;
-	mutable bool _isPressed;
 	std::function<void()> _onPressed;
 };
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "InputRecorder.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <GLFW/glfw3.h>
+#include <TTK/Input.h>
+
+#include "Gameplay/Timing.h"
+#include "Logging.h"
+
+InputRecorder::Mode               InputRecorder::_mode = InputRecorder::Mode::Off;
+uint32_t                          InputRecorder::_seed = 0;
+uint32_t                          InputRecorder::_frameIndex = 0;
+bool                              InputRecorder::_isHooked = false;
+std::ofstream                     InputRecorder::_file;
+InputRecorder::Frame              InputRecorder::_frame = InputRecorder::Frame();
+std::vector<TTK::InputEvent>      InputRecorder::_events;
+std::vector<InputRecorder::Frame> InputRecorder::_frames;
+
+static const uint32_t RECORDING_MAGIC   = 'T' | ('I' << 8) | ('N' << 16) | ('P' << 24);
+// Bump this whenever the layout of the file changes
+static const uint32_t RECORDING_VERSION = 1;
+// A frame can only hold this many events, TTK's queue drops anything past 4096 a frame anyways
+static const size_t   MAX_FRAME_EVENTS  = 0xFFFF;
+
+// Each frame is stored as it's delta time (f32), the window's width and height (u16 each), the UI flags (u8) and the
+// event count (u16), followed by it's events. Each event is it's type with the down bit on top (u8), then either the
+// key or button (u16) or the cursor position or scroll amount (2 x f32)
+static const uint8_t  EVENT_DOWN_BIT    = 0x80;
+
+template <typename T>
+static void Append(std::vector<uint8_t>& buffer, const T& value) {
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+// Reads a value and moves past it, returns false if the data ran out
+template <typename T>
+static bool Take(const std::vector<uint8_t>& buffer, size_t& offset, T& value) {
+	if (offset + sizeof(T) > buffer.size()) {
+		return false;
+	}
+	memcpy(&value, buffer.data() + offset, sizeof(T));
+	offset += sizeof(T);
+	return true;
+}
+
+static bool HasCode(TTK::InputEvent::Type type) {
+	return type == TTK::InputEvent::Type::Key || type == TTK::InputEvent::Type::MouseButton;
+}
+
+bool InputRecorder::BeginRecording(const std::string& path, uint32_t seed) {
+	Finish();
+	_file.open(path, std::ios::binary | std::ios::trunc);
+	if (!_file) {
+		LOG_ERROR("Failed to open \"{}\" to record input to", path);
+		return false;
+	}
+	std::vector<uint8_t> header;
+	Append(header, RECORDING_MAGIC);
+	Append(header, RECORDING_VERSION);
+	Append(header, seed);
+	_file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+	_mode = Mode::Recording;
+	_seed = seed;
+	_frameIndex = 0;
+	_frame = Frame();
+	_events.clear();
+	LOG_INFO("Recording input to \"{}\" (seed {})", path, seed);
+	return true;
+}
+
+bool InputRecorder::BeginReplay(const std::string& path) {
+	Finish();
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		LOG_ERROR("Failed to open the input recording \"{}\"", path);
+		return false;
+	}
+	const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	size_t offset = 0;
+	uint32_t magic = 0, version = 0, seed = 0;
+	if (!Take(data, offset, magic) || !Take(data, offset, version) || !Take(data, offset, seed) ||
+		magic != RECORDING_MAGIC || version != RECORDING_VERSION) {
+		LOG_ERROR("\"{}\" isn't an input recording, or is from an older version", path);
+		return false;
+	}
+
+	std::vector<Frame> frames;
+	std::vector<TTK::InputEvent> events;
+	bool isTruncated = false;
+	while (offset < data.size() && !isTruncated) {
+		Frame frame = Frame();
+		uint16_t count = 0;
+		if (!Take(data, offset, frame.DeltaTime) || !Take(data, offset, frame.Width) || !Take(data, offset, frame.Height) ||
+			!Take(data, offset, frame.UiFlags) || !Take(data, offset, count)) {
+			isTruncated = true;
+			break;
+		}
+		frame.FirstEvent = static_cast<uint32_t>(events.size());
+		frame.EventCount = count;
+		for (uint16_t ix = 0; ix < count && !isTruncated; ix++) {
+			uint8_t type = 0;
+			TTK::InputEvent event = { TTK::InputEvent::Type::Key, 0, false, glm::vec2(0.0f) };
+			isTruncated = !Take(data, offset, type);
+			event.EventType = static_cast<TTK::InputEvent::Type>(type & ~EVENT_DOWN_BIT);
+			event.IsDown = (type & EVENT_DOWN_BIT) != 0;
+			if (!isTruncated && HasCode(event.EventType)) {
+				isTruncated = !Take(data, offset, event.Code);
+			} else if (!isTruncated) {
+				isTruncated = !Take(data, offset, event.Value.x) || !Take(data, offset, event.Value.y);
+			}
+			events.push_back(event);
+		}
+		if (!isTruncated) {
+			frames.push_back(frame);
+		}
+	}
+	// A session that didn't shut down cleanly can leave half a frame at the end, everything before it is still good
+	if (isTruncated) {
+		LOG_WARN("The input recording \"{}\" ends part way through a frame, playing the {} whole frames", path, frames.size());
+		events.resize(frames.empty() ? 0 : frames.back().FirstEvent + frames.back().EventCount);
+	}
+
+	_mode = Mode::Replaying;
+	_seed = seed;
+	_frameIndex = 0;
+	_frame = Frame();
+	_frames = std::move(frames);
+	_events = std::move(events);
+	LOG_INFO("Replaying {} frames of input from \"{}\" (seed {})", _frames.size(), path, seed);
+	return true;
+}
+
+void InputRecorder::Finish() {
+	if (_mode == Mode::Recording) {
+		_file.close();
+		LOG_INFO("Recorded {} frames of input", _frameIndex);
+	} else if (_mode == Mode::Replaying) {
+		// Hands the clock back to real time
+		Timing::Instance().FixedDeltaTime = 0.0f;
+	}
+	if (_isHooked) {
+		TTK::Input::SetEventListener(nullptr);
+		TTK::Input::SetReplaying(false);
+		_isHooked = false;
+	}
+	_mode = Mode::Off;
+	_events.clear();
+	_frames.clear();
+}
+
+void InputRecorder::BeginFrame(GLFWwindow* window) {
+	if (_mode == Mode::Off) {
+		return;
+	}
+	const bool isFirst = !_isHooked;
+	if (!_isHooked) {
+		if (_mode == Mode::Recording) {
+			TTK::Input::SetEventListener([](const TTK::InputEvent& event) {
+				_events.push_back(event);
+			});
+		} else {
+			TTK::Input::SetReplaying(true);
+		}
+		_isHooked = true;
+	}
+
+	if (_mode == Mode::Recording) {
+		int width, height;
+		glfwGetWindowSize(window, &width, &height);
+		_frame = Frame();
+		_frame.Width = static_cast<uint16_t>(std::clamp(width, 0, 0xFFFF));
+		_frame.Height = static_cast<uint16_t>(std::clamp(height, 0, 0xFFFF));
+		// The cursor starts wherever it was when the window opened, so the first frame puts it there on purpose
+		_events.clear();
+		if (isFirst) {
+			_events.push_back({ TTK::InputEvent::Type::MouseMove, 0, false, TTK::Input::GetMousePos() });
+		}
+		return;
+	}
+
+	if (IsFinished()) {
+		return;
+	}
+	_frame = _frames[_frameIndex];
+	int width, height;
+	glfwGetWindowSize(window, &width, &height);
+	if (_frame.Width > 0 && _frame.Height > 0 && (width != _frame.Width || height != _frame.Height)) {
+		glfwSetWindowSize(window, _frame.Width, _frame.Height);
+	}
+	for (uint32_t ix = 0; ix < _frame.EventCount; ix++) {
+		TTK::Input::Inject(_events[_frame.FirstEvent + ix]);
+	}
+	Timing::Instance().FixedDeltaTime = _frame.DeltaTime;
+}
+
+bool InputRecorder::SampleUi(UiFlag flag, bool live) {
+	const uint8_t bit = static_cast<uint8_t>(flag);
+	if (_mode == Mode::Replaying) {
+		return (_frame.UiFlags & bit) != 0;
+	}
+	_frame.UiFlags = live ? (_frame.UiFlags | bit) : (_frame.UiFlags & ~bit);
+	return live;
+}
+
+void InputRecorder::EndFrame() {
+	if (_mode == Mode::Replaying && !IsFinished()) {
+		_frameIndex++;
+		return;
+	}
+	if (_mode != Mode::Recording) {
+		return;
+	}
+
+	if (_events.size() > MAX_FRAME_EVENTS) {
+		LOG_WARN("Frame {} had {} input events, only the first {} were recorded", _frameIndex, _events.size(), MAX_FRAME_EVENTS);
+		_events.resize(MAX_FRAME_EVENTS);
+	}
+	std::vector<uint8_t> buffer;
+	buffer.reserve(12 + _events.size() * 9);
+	Append(buffer, Timing::Instance().DeltaTime);
+	Append(buffer, _frame.Width);
+	Append(buffer, _frame.Height);
+	Append(buffer, _frame.UiFlags);
+	Append(buffer, static_cast<uint16_t>(_events.size()));
+	for (const TTK::InputEvent& event : _events) {
+		Append(buffer, static_cast<uint8_t>(static_cast<uint8_t>(event.EventType) | (event.IsDown ? EVENT_DOWN_BIT : 0)));
+		if (HasCode(event.EventType)) {
+			Append(buffer, event.Code);
+		} else {
+			Append(buffer, event.Value.x);
+			Append(buffer, event.Value.y);
+		}
+	}
+	_file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	_events.clear();
+	_frameIndex++;
+}
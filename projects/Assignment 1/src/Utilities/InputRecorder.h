@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <TTK/InputQueue.h>
+
+struct GLFWwindow;
+
+/// <summary>
+/// Records the input a session gets (keys, mouse buttons, the cursor, scrolling and the window's size) to a compact
+/// binary file, and plays it back later so the same session can be run again on another build (ex: to compare perf
+/// captures frame by frame). Every frame stores it's delta time along with the events TTK::Input applied, and a replay
+/// feeds each frame's events back through TTK::Input with Timing::FixedDeltaTime set to the recorded step, so the
+/// behaviours (and anything stepped from the frame's time) see exactly what they saw the first time around. The seed
+/// the session was started with is stored too, so everything placed randomly lands in the same spot
+///
+/// The few decisions the loop makes from ImGui's state (ex: whether a click went to the UI) are recorded with
+/// SampleUi, since the UI itself keeps getting the real devices during a replay
+///
+/// Anything that depends on how long work takes (ex: when a streamed cell finishes loading) can still play out
+/// differently, so replays are as close as we can get rather than bit for bit
+/// </summary>
+class InputRecorder final
+{
+public:
+	enum class Mode {
+		Off,
+		Recording,
+		Replaying
+	};
+
+	/// <summary>
+	/// The bits of UI state that get recorded with each frame, see SampleUi
+	/// </summary>
+	enum class UiFlag : uint8_t {
+		// An ImGui window has focus, so key toggles are ignored
+		Focused    = 1 << 0,
+		// ImGui wants the mouse, so clicks don't pick
+		WantsMouse = 1 << 1
+	};
+
+	/// <summary>
+	/// Starts writing every frame's input to a file, until Finish
+	/// </summary>
+	/// <param name="path">The file to write the recording to</param>
+	/// <param name="seed">The seed the session's randomness was started with</param>
+	/// <returns>True if the file could be opened</returns>
+	static bool BeginRecording(const std::string& path, uint32_t seed);
+	/// <summary>
+	/// Loads a recording to play back, the first frame plays on the next BeginFrame
+	/// </summary>
+	/// <param name="path">The file from BeginRecording</param>
+	/// <returns>True if the recording was loaded</returns>
+	static bool BeginReplay(const std::string& path);
+	/// <summary>
+	/// Finishes writing the recording, or stops playing one back
+	/// </summary>
+	static void Finish();
+
+	/// <summary>
+	/// Starts a frame, should be called at the top of the frame before polling events. While replaying this queues
+	/// up the frame's events for TTK::Input::Poll, sets the frame's time step, and resizes the window to match
+	/// </summary>
+	static void BeginFrame(GLFWwindow* window);
+	/// <summary>
+	/// Records a bit of UI state the loop makes a decision with, or gets what it was when recording
+	/// </summary>
+	/// <param name="flag">The state being sampled</param>
+	/// <param name="live">What the state is right now</param>
+	/// <returns>The recorded state while replaying, otherwise live</returns>
+	static bool SampleUi(UiFlag flag, bool live);
+	/// <summary>
+	/// Finishes a frame, writing it out while recording
+	/// </summary>
+	static void EndFrame();
+
+	static Mode GetMode() { return _mode; }
+	static uint32_t GetSeed() { return _seed; }
+	/// <summary>
+	/// Gets the number of frames recorded or played back so far
+	/// </summary>
+	static uint32_t GetFrameIndex() { return _frameIndex; }
+	/// <summary>
+	/// Gets the number of frames in the recording being played back
+	/// </summary>
+	static uint32_t GetFrameCount() { return static_cast<uint32_t>(_frames.size()); }
+	/// <summary>
+	/// Returns true once every frame of a replay has been played
+	/// </summary>
+	static bool IsFinished() { return _mode == Mode::Replaying && _frameIndex >= _frames.size(); }
+
+protected:
+	InputRecorder() = default;
+
+	struct Frame {
+		float    DeltaTime;
+		uint16_t Width;
+		uint16_t Height;
+		uint8_t  UiFlags;
+		// Where the frame's events start in _events, and how many there are
+		uint32_t FirstEvent;
+		uint32_t EventCount;
+	};
+
+	static Mode                         _mode;
+	static uint32_t                     _seed;
+	static uint32_t                     _frameIndex;
+	// Whether we've hooked into TTK::Input yet, which isn't set up until after the recorder starts
+	static bool                         _isHooked;
+	static std::ofstream                _file;
+	// The frame being recorded, or the frame being played back
+	static Frame                        _frame;
+	// The events the frame being recorded has seen so far, or every event in the recording being played back
+	static std::vector<TTK::InputEvent> _events;
+	static std::vector<Frame>           _frames;
+};
@@ -0,0 +1,233 @@
+#include "IoScheduler.h"
+
+#include <algorithm>
+
+#include "Logging.h"
+#include "CpuProfiler.h"
+
+// The size of the pages we touch to fault a mapped file in
+static const size_t PAGE_SIZE = 4096;
+
+std::vector<std::thread>   IoScheduler::_threads;
+std::mutex                 IoScheduler::_mutex;
+std::condition_variable    IoScheduler::_requestReady;
+std::deque<IoScheduler::Request> IoScheduler::_queues[static_cast<size_t>(IoPriority::Count)];
+bool                       IoScheduler::_isRunning = false;
+IoScheduler::Stats         IoScheduler::_stats;
+
+// Reads every page of a mapping, so the OS pages it in now rather than whenever it gets parsed
+static void TouchPages(const char* data, size_t size) {
+	volatile char touched = 0;
+	for (size_t ix = 0; ix < size; ix += PAGE_SIZE) {
+		touched += data[ix];
+	}
+}
+
+void IoScheduler::Init(uint32_t threadCount) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_isRunning) {
+		return;
+	}
+	_isRunning = true;
+	_stats = Stats();
+	for (uint32_t ix = 0; ix < std::max(threadCount, 1u); ix++) {
+		_threads.emplace_back(&IoScheduler::_ThreadMain);
+	}
+}
+
+void IoScheduler::Shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_isRunning = false;
+	}
+	_requestReady.notify_all();
+	for (std::thread& thread : _threads) {
+		thread.join();
+	}
+	_threads.clear();
+
+	// Anything still waiting fails, so nobody waits on it forever
+	for (std::deque<Request>& queue : _queues) {
+		for (Request& request : queue) {
+			request.Result._Finish(true);
+		}
+		queue.clear();
+	}
+}
+
+Task<VirtualFile::sptr> IoScheduler::Read(const std::string& path, IoPriority priority, uint64_t offset, uint64_t size, const IoCancelToken::sptr& cancel) {
+	Request request;
+	request.Path = path;
+	request.Offset = offset;
+	request.Size = size;
+	request.Cancel = cancel;
+	return _Submit(std::move(request), priority);
+}
+
+Task<VirtualFile::sptr> IoScheduler::ReadMapped(const MappedFile::sptr& file, uint64_t offset, uint64_t size, IoPriority priority, const IoCancelToken::sptr& cancel) {
+	Request request;
+	request.Mapping = file;
+	request.Offset = offset;
+	// Mappings are always read a range at a time, so they can be merged
+	request.Size = std::min(size, WHOLE_FILE - 1);
+	request.Cancel = cancel;
+	return _Submit(std::move(request), priority);
+}
+
+IoScheduler::Stats IoScheduler::GetStats() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	Stats result = _stats;
+	for (size_t ix = 0; ix < static_cast<size_t>(IoPriority::Count); ix++) {
+		result.Queued[ix] = static_cast<uint32_t>(_queues[ix].size());
+	}
+	return result;
+}
+
+Task<VirtualFile::sptr> IoScheduler::_Submit(Request&& request, IoPriority priority) {
+	request.Result = Task<VirtualFile::sptr>::_Create();
+	Task<VirtualFile::sptr> result = request.Result;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_isRunning) {
+			_queues[static_cast<size_t>(priority)].push_back(std::move(request));
+			lock.unlock();
+			_requestReady.notify_one();
+			return result;
+		}
+	}
+	std::vector<Request> batch;
+	batch.push_back(std::move(request));
+	_RunBatch(batch);
+	return result;
+}
+
+void IoScheduler::_ThreadMain() {
+	while (true) {
+		std::vector<Request> batch;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_requestReady.wait(lock, []() {
+				return !_isRunning || std::any_of(std::begin(_queues), std::end(_queues), [](const std::deque<Request>& queue) { return !queue.empty(); });
+			});
+			if (!_isRunning) {
+				return;
+			}
+			batch = _TakeBatch();
+		}
+		_RunBatch(batch);
+	}
+}
+
+std::vector<IoScheduler::Request> IoScheduler::_TakeBatch() {
+	std::vector<IoScheduler::Request> batch;
+	for (std::deque<Request>& queue : _queues) {
+		if (!queue.empty()) {
+			batch.push_back(std::move(queue.front()));
+			queue.pop_front();
+			break;
+		}
+	}
+	if (batch.empty() || batch[0].Size == WHOLE_FILE) {
+		return batch;
+	}
+
+	// Grow the read to take in anything else close by in the same file, from any priority, since a prefetch right
+	// next to something visible costs almost nothing extra to read along with it
+	uint64_t begin = batch[0].Offset;
+	uint64_t end = batch[0].Offset + batch[0].Size;
+	bool hasGrown = true;
+	while (hasGrown) {
+		hasGrown = false;
+		for (std::deque<Request>& queue : _queues) {
+			for (auto it = queue.begin(); it != queue.end();) {
+				const uint64_t otherEnd = it->Offset + it->Size;
+				if (batch[0].CanMergeWith(*it) && it->Offset <= end + COALESCE_GAP && otherEnd + COALESCE_GAP >= begin &&
+					std::max(end, otherEnd) - std::min(begin, it->Offset) <= MAX_COALESCED)
+				{
+					begin = std::min(begin, it->Offset);
+					end = std::max(end, otherEnd);
+					batch.push_back(std::move(*it));
+					it = queue.erase(it);
+					hasGrown = true;
+				} else {
+					++it;
+				}
+			}
+		}
+	}
+	_stats.Coalesced += batch.size() - 1;
+	return batch;
+}
+
+void IoScheduler::_RunBatch(std::vector<Request>& batch) {
+	PROFILE_SCOPE("IoRead");
+	// Cancelled reads get dropped before anything is read for them
+	size_t cancelled = 0;
+	batch.erase(std::remove_if(batch.begin(), batch.end(), [&cancelled](Request& request) {
+		if (request.IsCancelled()) {
+			request.Result._Finish(true);
+			cancelled++;
+			return true;
+		}
+		return false;
+	}), batch.end());
+
+	uint64_t bytes = 0;
+	if (batch.size() == 1 && batch[0].Size == WHOLE_FILE && batch[0].Offset == 0) {
+		// Whole files come back as they are, usually a view of a mapping that we fault in here
+		Request& request = batch[0];
+		VirtualFile::sptr file = VirtualFileSystem::Open(request.Path);
+		if (file == nullptr) {
+			LOG_WARN("Failed to read \"{}\"", request.Path);
+			request.Result._Finish(true);
+		} else {
+			TouchPages(file->GetData(), file->GetSize());
+			bytes = file->GetSize();
+			request.Result._state->Value.emplace(std::move(file));
+			request.Result._Finish(false);
+		}
+	} else if (!batch.empty()) {
+		// Read the whole span once, then hand each request it's own slice of it
+		uint64_t begin = batch[0].Offset;
+		uint64_t end = batch[0].Size == WHOLE_FILE ? WHOLE_FILE : batch[0].Offset + batch[0].Size;
+		for (const Request& request : batch) {
+			begin = std::min(begin, request.Offset);
+			end = std::max(end, request.Size == WHOLE_FILE ? WHOLE_FILE : request.Offset + request.Size);
+		}
+
+		std::string buffer;
+		const char* span = nullptr;
+		size_t spanSize = 0;
+		bool isRead = true;
+		if (batch[0].Mapping != nullptr) {
+			const MappedFile& mapping = *batch[0].Mapping;
+			begin = std::min<uint64_t>(begin, mapping.GetSize());
+			span = mapping.GetData() + begin;
+			spanSize = static_cast<size_t>(std::min<uint64_t>(end, mapping.GetSize()) - begin);
+		} else {
+			isRead = VirtualFileSystem::ReadRange(batch[0].Path, begin, end - begin, buffer);
+			span = buffer.data();
+			spanSize = buffer.size();
+		}
+		if (!isRead) {
+			LOG_WARN("Failed to read \"{}\"", batch[0].Path);
+		}
+		bytes = spanSize;
+
+		for (Request& request : batch) {
+			if (!isRead) {
+				request.Result._Finish(true);
+				continue;
+			}
+			const size_t first = static_cast<size_t>(std::min<uint64_t>(request.Offset - begin, spanSize));
+			const size_t count = static_cast<size_t>(std::min<uint64_t>(request.Size, spanSize - first));
+			request.Result._state->Value.emplace(std::make_shared<VirtualFile>(std::string(span + first, count)));
+			request.Result._Finish(false);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stats.Completed += batch.size();
+	_stats.Cancelled += cancelled;
+	_stats.Bytes += bytes;
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "VirtualFileSystem.h"
+
+/// <summary>
+/// How urgently a read is needed, the I/O threads always take the most urgent read that's waiting
+/// </summary>
+enum class IoPriority : uint32_t {
+	// Something on screen is waiting on it (ex: a virtual texture page that's being drawn blurry)
+	VisibleNow = 0,
+	// Will be needed soon (ex: the next scene, or the world cells just past the streaming radius)
+	Prefetch   = 1,
+	// Nobody is waiting on it (ex: warming caches)
+	Background = 2,
+	Count
+};
+
+/// <summary>
+/// Cancels every read it was handed to, reads that haven't started by the time it's cancelled are dropped without
+/// touching the disk, and their tasks fail. One token is usually shared by everything a streaming target asked for,
+/// so the whole lot can be dropped when the target moves on
+/// </summary>
+class IoCancelToken final
+{
+public:
+	typedef std::shared_ptr<IoCancelToken> sptr;
+	static inline sptr Create() {
+		return std::make_shared<IoCancelToken>();
+	}
+
+	IoCancelToken() : _isCancelled(false) {}
+
+	void Cancel() { _isCancelled.store(true, std::memory_order_relaxed); }
+	bool IsCancelled() const { return _isCancelled.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<bool> _isCancelled;
+};
+
+/// <summary>
+/// Reads files on a couple of threads of it's own, so the ThreadPool's workers never sit blocked on the disk. Reads
+/// are queued by priority, can be cancelled before they start, and reads of the same file that sit close together are
+/// merged into one: the gap between them gets read too, which costs far less than another seek (or, for compressed
+/// archive entries, inflating the chunk they share twice)
+///
+/// Everything goes through the VirtualFileSystem, and most of it is memory mapped, so "reading" a whole file means
+/// touching each of it's pages so the faults happen here rather than on whoever parses it
+/// </summary>
+class IoScheduler final
+{
+public:
+	/// <summary>
+	/// Pass as the size to read everything from the offset to the end of the file
+	/// </summary>
+	static const uint64_t WHOLE_FILE = ~0ull;
+	/// <summary>
+	/// Reads of the same file with less than this many bytes between them get merged
+	/// </summary>
+	static const uint64_t COALESCE_GAP = 64 * 1024;
+	/// <summary>
+	/// The most bytes a merged read can cover, so one huge read can't hold up something more urgent for too long
+	/// </summary>
+	static const uint64_t MAX_COALESCED = 4 * 1024 * 1024;
+
+	/// <summary>
+	/// The counts since Init, for the debug UI
+	/// </summary>
+	struct Stats {
+		// Reads that are waiting, by priority
+		uint32_t Queued[static_cast<size_t>(IoPriority::Count)] = { 0 };
+		// Reads that finished, including the ones that were merged into another
+		uint64_t Completed = 0;
+		// Reads that were dropped because they were cancelled
+		uint64_t Cancelled = 0;
+		// Reads that were merged into another read instead of being read on their own
+		uint64_t Coalesced = 0;
+		// Bytes read, including the gaps between merged reads
+		uint64_t Bytes = 0;
+	};
+
+	/// <summary>
+	/// Starts the I/O threads, reads made before this run straight away on the calling thread
+	/// </summary>
+	/// <param name="threadCount">The number of I/O threads, a couple is enough to keep a disk busy</param>
+	static void Init(uint32_t threadCount = 2);
+	/// <summary>
+	/// Stops the I/O threads, any reads that haven't started fail. Should be called before the ThreadPool shuts down
+	/// </summary>
+	static void Shutdown();
+
+	/// <summary>
+	/// Reads a file (or part of it) through the VirtualFileSystem
+	/// </summary>
+	/// <param name="path">The path of the file, relative to the working directory</param>
+	/// <param name="priority">How urgently the read is needed</param>
+	/// <param name="offset">The first byte to read</param>
+	/// <param name="size">The number of bytes to read, or WHOLE_FILE</param>
+	/// <param name="cancel">Drops the read if it's cancelled before the read starts, may be nullptr</param>
+	/// <returns>A task for the contents that were read, which fails if the file couldn't be read or the read was cancelled</returns>
+	static Task<VirtualFile::sptr> Read(const std::string& path, IoPriority priority, uint64_t offset = 0, uint64_t size = WHOLE_FILE,
+		const IoCancelToken::sptr& cancel = nullptr);
+	/// <summary>
+	/// Copies part of a file that's already mapped, so the page faults that read it from the disk happen on an I/O thread
+	/// </summary>
+	/// <param name="file">The mapped file, it's kept alive until the read is done</param>
+	/// <param name="offset">The first byte to read</param>
+	/// <param name="size">The number of bytes to read, clamped to the end of the file</param>
+	/// <param name="priority">How urgently the read is needed</param>
+	/// <param name="cancel">Drops the read if it's cancelled before the read starts, may be nullptr</param>
+	/// <returns>A task for a copy of the bytes, which fails if the read was cancelled</returns>
+	static Task<VirtualFile::sptr> ReadMapped(const MappedFile::sptr& file, uint64_t offset, uint64_t size, IoPriority priority,
+		const IoCancelToken::sptr& cancel = nullptr);
+
+	/// <summary>
+	/// Gets the counts since Init
+	/// </summary>
+	static Stats GetStats();
+
+protected:
+	IoScheduler() = default;
+
+	// A single read waiting in the queue
+	struct Request {
+		// Reads come from either a path or a mapping
+		std::string                 Path;
+		MappedFile::sptr            Mapping;
+		uint64_t                    Offset = 0;
+		uint64_t                    Size = WHOLE_FILE;
+		IoCancelToken::sptr         Cancel;
+		Task<VirtualFile::sptr>     Result;
+
+		bool IsCancelled() const { return Cancel != nullptr && Cancel->IsCancelled(); }
+		// Whether a read can be merged with this one, whole files are only ever read on their own
+		bool CanMergeWith(const Request& other) const {
+			return Size != WHOLE_FILE && other.Size != WHOLE_FILE && Mapping == other.Mapping && (Mapping != nullptr || Path == other.Path);
+		}
+	};
+
+	static std::vector<std::thread>   _threads;
+	static std::mutex                 _mutex;
+	static std::condition_variable    _requestReady;
+	static std::deque<Request>        _queues[static_cast<size_t>(IoPriority::Count)];
+	static bool                       _isRunning;
+	static Stats                      _stats;
+
+	// Queues up a read, or runs it straight away if there are no I/O threads
+	static Task<VirtualFile::sptr> _Submit(Request&& request, IoPriority priority);
+	// What each I/O thread runs, until Shutdown
+	static void _ThreadMain();
+	// Takes the most urgent read and any others that can be merged with it, must be called with the mutex held
+	static std::vector<Request> _TakeBatch();
+	// Reads a batch and finishes every task in it
+	static void _RunBatch(std::vector<Request>& batch);
+};
@@ -0,0 +1,98 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Logging.h"
+
+#ifdef _WIN32
+MappedFile::MappedFile() :
+	_data(nullptr), _size(0), _file(INVALID_HANDLE_VALUE), _mapping(nullptr)
+{ }
+
+MappedFile::~MappedFile() {
+	if (_data != nullptr) {
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping != nullptr) {
+		CloseHandle(_mapping);
+	}
+	if (_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(_file);
+	}
+}
+
+MappedFile::sptr MappedFile::Open(const std::string& path) {
+	sptr result = std::make_shared<MappedFile>();
+	result->_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (result->_file == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(result->_file, &size)) {
+		return nullptr;
+	}
+	result->_size = static_cast<size_t>(size.QuadPart);
+	// Windows won't map an empty file, but there's nothing to read anyways
+	if (result->_size == 0) {
+		return result;
+	}
+	result->_mapping = CreateFileMappingA(result->_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (result->_mapping == nullptr) {
+		LOG_WARN("Failed to map \"{}\" into memory", path);
+		return nullptr;
+	}
+	result->_data = static_cast<const char*>(MapViewOfFile(result->_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (result->_data == nullptr) {
+		LOG_WARN("Failed to map \"{}\" into memory", path);
+		return nullptr;
+	}
+	return result;
+}
+#else
+MappedFile::MappedFile() :
+	_data(nullptr), _size(0), _file(-1)
+{ }
+
+MappedFile::~MappedFile() {
+	if (_data != nullptr) {
+		munmap(const_cast<char*>(_data), _size);
+	}
+	if (_file != -1) {
+		close(_file);
+	}
+}
+
+MappedFile::sptr MappedFile::Open(const std::string& path) {
+	sptr result = std::make_shared<MappedFile>();
+	result->_file = open(path.c_str(), O_RDONLY);
+	if (result->_file == -1) {
+		return nullptr;
+	}
+	struct stat info;
+	if (fstat(result->_file, &info) != 0) {
+		return nullptr;
+	}
+	result->_size = static_cast<size_t>(info.st_size);
+	if (result->_size == 0) {
+		return result;
+	}
+	void* data = mmap(nullptr, result->_size, PROT_READ, MAP_PRIVATE, result->_file, 0);
+	if (data == MAP_FAILED) {
+		LOG_WARN("Failed to map \"{}\" into memory", path);
+		return nullptr;
+	}
+	// We read from start to end, so let the OS read ahead as far as it likes
+	madvise(data, result->_size, MADV_SEQUENTIAL);
+	result->_data = static_cast<const char*>(data);
+	return result;
+}
+#endif
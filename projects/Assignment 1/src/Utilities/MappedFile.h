@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/// <summary>
+/// Maps a file into memory as read-only, so it can be parsed in place without copying it into a buffer first. The
+/// OS pages the file in as we touch it, which makes this about as fast as reading a file can get
+/// </summary>
+class MappedFile final
+{
+public:
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile(MappedFile&& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+	MappedFile& operator=(MappedFile&& other) = delete;
+	typedef std::shared_ptr<MappedFile> sptr;
+
+	/// <summary>
+	/// Maps the given file into memory
+	/// </summary>
+	/// <param name="path">The path of the file to map</param>
+	/// <returns>The mapped file, or nullptr if the file could not be opened</returns>
+	static sptr Open(const std::string& path);
+
+	MappedFile();
+	~MappedFile();
+
+	/// <summary>
+	/// Gets a pointer to the start of the file's contents, may be nullptr if the file is empty
+	/// </summary>
+	const char* GetData() const { return _data; }
+	/// <summary>
+	/// Gets the size of the file, in bytes
+	/// </summary>
+	size_t GetSize() const { return _size; }
+
+private:
+	const char* _data;
+	size_t      _size;
+#ifdef _WIN32
+	void*       _file;
+	void*       _mapping;
+#else
+	int         _file;
+#endif
+};
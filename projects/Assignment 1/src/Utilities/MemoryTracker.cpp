@@ -0,0 +1,174 @@
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "Logging.h"
+
+static const size_t TAG_COUNT = static_cast<size_t>(MemoryTag::Count);
+
+// Sits in front of every allocation, padded out so the memory after it keeps the alignment new promises
+struct alignas(alignof(std::max_align_t)) AllocationHeader {
+	MemoryTracker::Site* Owner;
+	size_t               Size;
+};
+
+// Everything here is constant initialized, so it's ready for any allocations made before main
+static MemoryTracker::Site OtherSite("(outside of any scope)", 0, MemoryTag::Other);
+static std::atomic<MemoryTracker::Site*> Sites(&OtherSite);
+static thread_local MemoryTracker::Site* CurrentSite = nullptr;
+
+static std::atomic<int64_t>  TagBytes[TAG_COUNT];
+static std::atomic<int64_t>  TagPeaks[TAG_COUNT];
+static std::atomic<uint64_t> TagAllocations[TAG_COUNT];
+
+// Only touched by the main thread
+static uint64_t TagFrameStarts[TAG_COUNT];
+static uint32_t TagLastFrame[TAG_COUNT];
+static int64_t  TagBudgets[TAG_COUNT];
+static bool     TagIsOverBudget[TAG_COUNT];
+
+uint32_t MemoryTracker::_lastFrameTotal = 0;
+uint32_t MemoryTracker::_budgetBreaches = 0;
+
+static void Charge(MemoryTag tag, int64_t bytes) {
+	const size_t ix = static_cast<size_t>(tag);
+	const int64_t current = TagBytes[ix].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	int64_t peak = TagPeaks[ix].load(std::memory_order_relaxed);
+	while (current > peak && !TagPeaks[ix].compare_exchange_weak(peak, current, std::memory_order_relaxed)) { }
+}
+
+MemoryTracker::Scope::Scope(Site& site) :
+	_previous(CurrentSite)
+{
+	// Sites only get listed once they've been entered, so we don't have to register them before main
+	if (!site.IsListed.exchange(true)) {
+		site.Next = Sites.load();
+		while (!Sites.compare_exchange_weak(site.Next, &site)) { }
+	}
+	CurrentSite = &site;
+}
+
+MemoryTracker::Scope::~Scope() {
+	CurrentSite = _previous;
+}
+
+void MemoryTracker::BeginFrame() {
+	uint32_t total = 0;
+	for (size_t ix = 0; ix < TAG_COUNT; ix++) {
+		const uint64_t allocations = TagAllocations[ix].load(std::memory_order_relaxed);
+		TagLastFrame[ix] = static_cast<uint32_t>(allocations - TagFrameStarts[ix]);
+		TagFrameStarts[ix] = allocations;
+		total += TagLastFrame[ix];
+
+		// We only warn when a tag goes over, rather than every frame it stays over
+		const bool isOver = TagBudgets[ix] > 0 && TagBytes[ix].load(std::memory_order_relaxed) > TagBudgets[ix];
+		if (isOver && !TagIsOverBudget[ix]) {
+			LOG_WARN("{} memory is over budget: {:.1f} MB of {:.1f} MB", GetTagName(static_cast<MemoryTag>(ix)),
+				TagBytes[ix].load(std::memory_order_relaxed) / (1024.0 * 1024.0), TagBudgets[ix] / (1024.0 * 1024.0));
+			_budgetBreaches++;
+		}
+		TagIsOverBudget[ix] = isOver;
+	}
+	_lastFrameTotal = total;
+}
+
+void MemoryTracker::Add(MemoryTag tag, int64_t bytes) {
+	Charge(tag, bytes);
+	if (bytes > 0) {
+		TagAllocations[static_cast<size_t>(tag)].fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void MemoryTracker::SetBudget(MemoryTag tag, int64_t bytes) {
+	TagBudgets[static_cast<size_t>(tag)] = bytes;
+}
+
+size_t MemoryTracker::GetAllocationSize(const void* memory) {
+	return (static_cast<const AllocationHeader*>(memory) - 1)->Size;
+}
+
+MemoryTracker::TagStats MemoryTracker::GetStats(MemoryTag tag) {
+	const size_t ix = static_cast<size_t>(tag);
+	TagStats result;
+	result.Current = TagBytes[ix].load(std::memory_order_relaxed);
+	result.Peak = TagPeaks[ix].load(std::memory_order_relaxed);
+	result.Allocations = TagAllocations[ix].load(std::memory_order_relaxed);
+	result.LastFrame = TagLastFrame[ix];
+	result.Budget = TagBudgets[ix];
+	return result;
+}
+
+const char* MemoryTracker::GetTagName(MemoryTag tag) {
+	switch (tag) {
+	case MemoryTag::Other:     return "Other";
+	case MemoryTag::Textures:  return "Textures";
+	case MemoryTag::Meshes:    return "Meshes";
+	case MemoryTag::ECS:       return "ECS";
+	case MemoryTag::Audio:     return "Audio";
+	case MemoryTag::Physics:   return "Physics";
+	case MemoryTag::Transient: return "Transient";
+	default:                   return "Unknown";
+	}
+}
+
+void MemoryTracker::DumpSites() {
+	std::vector<const Site*> sites;
+	for (const Site* site = Sites.load(); site != nullptr; site = site->Next) {
+		sites.push_back(site);
+	}
+	std::sort(sites.begin(), sites.end(), [](const Site* l, const Site* r) {
+		return l->Bytes.load(std::memory_order_relaxed) > r->Bytes.load(std::memory_order_relaxed);
+	});
+	LOG_INFO("Memory held by each allocation site:");
+	for (const Site* site : sites) {
+		LOG_INFO("  [{}] {}:{} {:.1f} KB held, {} allocations", GetTagName(site->Tag), site->File, site->Line,
+			site->Bytes.load(std::memory_order_relaxed) / 1024.0, site->Allocations.load(std::memory_order_relaxed));
+	}
+}
+
+// The array and sized forms fall through to these by default. The over-aligned forms are left alone, and so aren't
+// tracked, they have their own deletes so they never reach ours
+void* operator new(size_t size) {
+	MemoryTracker::Site* site = CurrentSite != nullptr ? CurrentSite : &OtherSite;
+	for (;;) {
+		if (void* memory = std::malloc(sizeof(AllocationHeader) + size)) {
+			AllocationHeader* header = static_cast<AllocationHeader*>(memory);
+			header->Owner = site;
+			header->Size = size;
+			site->Bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+			site->Allocations.fetch_add(1, std::memory_order_relaxed);
+			TagAllocations[static_cast<size_t>(site->Tag)].fetch_add(1, std::memory_order_relaxed);
+			Charge(site->Tag, static_cast<int64_t>(size));
+			return header + 1;
+		}
+		std::new_handler handler = std::get_new_handler();
+		if (handler == nullptr) {
+			throw std::bad_alloc();
+		}
+		handler();
+	}
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return operator new(size);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void operator delete(void* memory) noexcept {
+	if (memory == nullptr) {
+		return;
+	}
+	AllocationHeader* header = static_cast<AllocationHeader*>(memory) - 1;
+	header->Owner->Bytes.fetch_sub(static_cast<int64_t>(header->Size), std::memory_order_relaxed);
+	Charge(header->Owner->Tag, -static_cast<int64_t>(header->Size));
+	std::free(header);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+	operator delete(memory);
+}
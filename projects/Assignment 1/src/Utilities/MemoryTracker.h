@@ -0,0 +1,122 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// The subsystems that memory gets charged to
+/// </summary>
+enum class MemoryTag : uint8_t
+{
+	// Anything allocated outside of a MEMORY_SCOPE
+	Other = 0,
+	Textures,
+	Meshes,
+	ECS,
+	Audio,
+	Physics,
+	// The blocks backing the frame arenas
+	Transient,
+	Count
+};
+
+/// <summary>
+/// Tracks where the heap goes. Global operator new and delete are replaced in MemoryTracker.cpp, and every allocation
+/// gets a small header recording the site that made it and it's size, so it's charged to the right tag no matter which
+/// thread or scope frees it. Each tag keeps it's current and peak usage and how many allocations it's made, and can be
+/// given a budget that gets warned about when it's exceeded
+///
+/// Memory gets charged to a tag by allocating inside a MEMORY_SCOPE, which is also recorded as a call site that can be
+/// dumped to the log. Memory that doesn't come from operator new (ex: images decoded by stb) can be charged with Add
+/// </summary>
+class MemoryTracker final
+{
+public:
+	/// <summary>
+	/// A place in the code that allocates memory for a tag, declared by MEMORY_SCOPE
+	/// </summary>
+	struct Site {
+		const char*           File;
+		int                   Line;
+		MemoryTag             Tag;
+		std::atomic<int64_t>  Bytes;
+		std::atomic<uint64_t> Allocations;
+		std::atomic<bool>     IsListed;
+		Site*                 Next;
+
+		constexpr Site(const char* file, int line, MemoryTag tag) :
+			File(file), Line(line), Tag(tag), Bytes(0), Allocations(0), IsListed(false), Next(nullptr) { }
+	};
+
+	/// <summary>
+	/// Charges everything the calling thread allocates to a site until it goes out of scope, scopes nest
+	/// </summary>
+	class Scope final {
+	public:
+		Scope(Site& site);
+		~Scope();
+		Scope(const Scope& other) = delete;
+		Scope& operator=(const Scope& other) = delete;
+	private:
+		Site* _previous;
+	};
+
+	/// <summary>
+	/// The usage of a single tag
+	/// </summary>
+	struct TagStats {
+		int64_t  Current = 0;
+		int64_t  Peak = 0;
+		uint64_t Allocations = 0;
+		// The number of allocations made between the last two calls to BeginFrame
+		uint32_t LastFrame = 0;
+		// 0 for no budget
+		int64_t  Budget = 0;
+	};
+
+	/// <summary>
+	/// Marks the start of a new frame, working out each tag's allocation rate and warning about any tags that have
+	/// gone over their budgets. Must be called on the main thread
+	/// </summary>
+	static void BeginFrame();
+
+	/// <summary>
+	/// Charges memory that didn't come from operator new to a tag, or gives it back with a negative size
+	/// </summary>
+	static void Add(MemoryTag tag, int64_t bytes);
+	/// <summary>
+	/// Sets the most memory a tag should use, in bytes, or 0 for no limit
+	/// </summary>
+	static void SetBudget(MemoryTag tag, int64_t bytes);
+
+	/// <summary>
+	/// Gets the size that was asked for when a block was allocated with operator new
+	/// </summary>
+	static size_t GetAllocationSize(const void* memory);
+
+	static TagStats GetStats(MemoryTag tag);
+	static const char* GetTagName(MemoryTag tag);
+	/// <summary>
+	/// Gets the number of allocations made on every tag between the last two calls to BeginFrame
+	/// </summary>
+	static uint32_t GetLastFrameAllocations() { return _lastFrameTotal; }
+	/// <summary>
+	/// Gets the number of times a tag has gone over it's budget, so soak tests can fail on it
+	/// </summary>
+	static uint32_t GetBudgetBreaches() { return _budgetBreaches; }
+
+	/// <summary>
+	/// Logs every site that has allocated so far, from the most memory held to the least
+	/// </summary>
+	static void DumpSites();
+
+private:
+	static uint32_t _lastFrameTotal;
+	static uint32_t _budgetBreaches;
+};
+
+#define MEMORY_SCOPE_CONCAT_INNER(a, b) a##b
+#define MEMORY_SCOPE_CONCAT(a, b) MEMORY_SCOPE_CONCAT_INNER(a, b)
+#define MEMORY_SCOPE(tag) \
+	static MemoryTracker::Site MEMORY_SCOPE_CONCAT(_memorySite, __LINE__)(__FILE__, __LINE__, tag); \
+	MemoryTracker::Scope MEMORY_SCOPE_CONCAT(_memoryScope, __LINE__)(MEMORY_SCOPE_CONCAT(_memorySite, __LINE__))
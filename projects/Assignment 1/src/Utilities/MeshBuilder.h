@@ -1,6 +1,26 @@
 #pragma once
+#include <cstring>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include "Graphics/VertexArrayObject.h"
+#include "Graphics/MeshArena.h"
+#include "ChartPacker.h"
+#include "FlatHashMap.h"
+#include "MeshOptimizer.h"
+#include "TangentSpace.h"
+
+// Detects whether a vertex type has texture coordinates, so simplifying can keep the UV seams intact
+template <typename T, typename = void>
+struct HasVertexUV : std::false_type { };
+template <typename T>
+struct HasVertexUV<T, std::void_t<decltype(std::declval<T>().UV)>> : std::true_type { };
+
+// Detects whether a vertex type has a tangent, only those can have their tangents generated
+template <typename T, typename = void>
+struct HasVertexTangent : std::false_type { };
+template <typename T>
+struct HasVertexTangent<T, std::void_t<decltype(std::declval<T>().Tangent)>> : std::true_type { };
 
 template <typename VertType>
 class MeshBuilder
@@ -43,7 +63,7 @@ public:
 	/// <param name="c">The index of the third vertex</param>
 	void AddIndexTri(uint32_t a, uint32_t b, uint32_t c)
 	{
-		ReserveIndexSpace(3);
+		// Note that we don't reserve here, reserving exactly 3 more each time would re-allocate on every call
 		_indices.push_back(a);
 		_indices.push_back(b);
 		_indices.push_back(c);
@@ -65,6 +85,37 @@ public:
 	void ReserveIndexSpace(size_t extendAmount) {
 		_indices.reserve(_indices.size() + extendAmount);
 	}
+	/// <summary>
+	/// Adds room for a number of vertices to the end of the mesh, to be filled in place (ex: by several threads at once)
+	/// </summary>
+	/// <param name="count">The number of vertices to add</param>
+	/// <returns>A pointer to the first new vertex, valid only until another call to AddVertex</returns>
+	VertType* AppendVertices(size_t count) {
+		const size_t first = _vertices.size();
+		_vertices.resize(first + count);
+		return _vertices.data() + first;
+	}
+	/// <summary>
+	/// Adds room for a number of indices to the end of the mesh, to be filled in place
+	/// </summary>
+	/// <param name="count">The number of indices to add</param>
+	/// <returns>A pointer to the first new index, valid only until another call to AddIndex or AddIndexTri</returns>
+	uint32_t* AppendIndices(size_t count) {
+		const size_t first = _indices.size();
+		_indices.resize(first + count);
+		return _indices.data() + first;
+	}
+	/// <summary>
+	/// Removes all the vertices, indices, meshlets, LODs and the triangle tree from the builder, but keeps the memory around so it can
+	/// be filled again without re-allocating (ex: when streaming a mesh in chunks)
+	/// </summary>
+	void Clear() {
+		_vertices.clear();
+		_indices.clear();
+		_meshlets.clear();
+		_lods.clear();
+		_triangles = nullptr;
+	}
 
 	/// <summary>
 	/// Returns the number of vertices in this mesh
@@ -81,17 +132,243 @@ public:
 	/// </summary>
 	size_t GetTriangleCount() const { return _indices.size() > 0 ? _indices.size() / 3 : _vertices.size() / 3; }
 
+	/// <summary>
+	/// Merges vertices that are exactly the same, updating the indices to match. Meshes built from separate pieces
+	/// (ex: with MeshFactory) often end up with copies of the same vertex, which all get transformed separately.
+	/// Vertices are compared bit for bit, so vertex types shouldn't have any padding
+	/// </summary>
+	/// <returns>The number of vertices that were removed</returns>
+	size_t Weld() {
+		// The keys are indices into our vertices, so the map only needs to store a pair of integers per vertex
+		struct VertexHash {
+			const std::vector<VertType>* Vertices;
+			size_t operator()(uint32_t ix) const {
+				// 64 bit FNV-1a over the whole vertex
+				const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&(*Vertices)[ix]);
+				uint64_t hash = 14695981039346656037ull;
+				for (size_t jx = 0; jx < sizeof(VertType); jx++) {
+					hash = (hash ^ bytes[jx]) * 1099511628211ull;
+				}
+				return static_cast<size_t>(hash);
+			}
+		};
+		struct VertexEqual {
+			const std::vector<VertType>* Vertices;
+			bool operator()(uint32_t a, uint32_t b) const {
+				return memcmp(&(*Vertices)[a], &(*Vertices)[b], sizeof(VertType)) == 0;
+			}
+		};
+		FlatHashMap<uint32_t, uint32_t, VertexHash, VertexEqual> unique(VertexHash{ &_vertices }, VertexEqual{ &_vertices });
+		unique.Reserve(_vertices.size());
+
+		std::vector<uint32_t> remap(_vertices.size());
+		std::vector<VertType> welded;
+		welded.reserve(_vertices.size());
+		for (size_t ix = 0; ix < _vertices.size(); ix++) {
+			auto it = unique.TryEmplace(static_cast<uint32_t>(ix), static_cast<uint32_t>(welded.size()));
+			if (it.second) {
+				welded.push_back(_vertices[ix]);
+			}
+			remap[ix] = *it.first;
+		}
+		for (uint32_t& index : _indices) {
+			index = remap[index];
+		}
+
+		const size_t removed = _vertices.size() - welded.size();
+		_vertices.swap(welded);
+		return removed;
+	}
+
+	/// <summary>
+	/// Reorders the triangles for the post-transform vertex cache, then sorts clusters of them to cut down on
+	/// overdraw, and finally re-orders the vertices to follow the order they are first used in. Vertices that no
+	/// triangle uses are dropped. This doesn't change how the mesh looks, so it's worth doing before baking any mesh
+	/// that sticks around
+	/// </summary>
+	/// <param name="overdrawThreshold">How much worse the vertex cache is allowed to get for better overdraw, 1.05 allows 5%</param>
+	/// <returns>The ACMR (vertices transformed per triangle) before and after</returns>
+	MeshOptimizer::Stats Optimize(float overdrawThreshold = 1.05f) {
+		MeshOptimizer::Stats result;
+		if (_indices.size() < 3) {
+			return result;
+		}
+		result.AcmrBefore = MeshOptimizer::GetACMR(_indices.data(), _indices.size(), _vertices.size());
+
+		MeshOptimizer::OptimizeVertexCache(_indices.data(), _indices.size(), _vertices.size());
+		std::vector<glm::vec3> positions(_vertices.size());
+		for (size_t ix = 0; ix < _vertices.size(); ix++) {
+			positions[ix] = _vertices[ix].Position;
+		}
+		MeshOptimizer::OptimizeOverdraw(_indices.data(), _indices.size(), positions.data(), positions.size(), overdrawThreshold);
+
+		std::vector<uint32_t> remap;
+		const uint32_t used = MeshOptimizer::OptimizeVertexFetch(_indices.data(), _indices.size(), _vertices.size(), remap);
+		std::vector<VertType> vertices(used);
+		for (size_t ix = 0; ix < _vertices.size(); ix++) {
+			if (remap[ix] != UINT32_MAX) {
+				vertices[remap[ix]] = _vertices[ix];
+			}
+		}
+		result.UnusedVertices = static_cast<uint32_t>(_vertices.size() - used);
+		_vertices.swap(vertices);
+
+		result.AcmrAfter = MeshOptimizer::GetACMR(_indices.data(), _indices.size(), _vertices.size());
+		return result;
+	}
+
+	/// <summary>
+	/// Splits the mesh into clusters that the GPU can cull on their own, these get uploaded along with the mesh in
+	/// Bake. This should be the last thing done to the indices before baking, since the clusters are index ranges.
+	/// Meshes below MeshOptimizer::MESHLET_MIN_TRIANGLES are left alone unless force is set
+	/// </summary>
+	/// <param name="force">True to build meshlets regardless of the mesh's size</param>
+	/// <returns>The number of meshlets that were built</returns>
+	size_t BuildMeshlets(bool force = false) {
+		_meshlets.clear();
+		if (force || _indices.size() / 3 >= MeshOptimizer::MESHLET_MIN_TRIANGLES) {
+			const float* positions = _vertices.empty() ? nullptr : &_vertices[0].Position.x;
+			_meshlets = MeshOptimizer::BuildMeshlets(_indices.data(), _indices.size(), positions, _vertices.size(), sizeof(VertType));
+		}
+		return _meshlets.size();
+	}
+
+	/// <summary>
+	/// Builds simplified versions of the mesh for drawing it in the distance, these get uploaded along with the mesh in
+	/// Bake. Like BuildMeshlets, this should come after anything else that changes the indices. Meshes below
+	/// MeshOptimizer::LOD_MIN_TRIANGLES are left alone
+	/// </summary>
+	/// <param name="count">The most levels to build, not counting the full detail mesh</param>
+	/// <returns>The number of levels that were built</returns>
+	size_t GenerateLods(uint32_t count = MeshOptimizer::DEFAULT_LOD_COUNT) {
+		_lods.clear();
+		if (_indices.size() / 3 >= MeshOptimizer::LOD_MIN_TRIANGLES) {
+			const float* uvs = nullptr;
+			if constexpr (HasVertexUV<VertType>::value) {
+				uvs = &_vertices[0].UV.x;
+			}
+			_lods = MeshOptimizer::BuildLods(_indices.data(), _indices.size(), &_vertices[0].Position.x, _vertices.size(), sizeof(VertType),
+				uvs, sizeof(VertType), count);
+		}
+		return _lods.size();
+	}
+
+	/// <summary>
+	/// Fills in every vertex's tangent from the UVs, for normal mapping (see TangentSpace). Only vertex types with a
+	/// tangent, normal and UV can do this (ex: VertexPosNormTanTexCol). Tangents only depend on the triangles a vertex
+	/// is part of, so this can be done before or after Optimize, but anything that splits vertices (ex:
+	/// GenerateLightmapCharts) should come first
+	/// </summary>
+	/// <returns>The number of vertices that got a zero tangent, since none of their triangles had any area in UV space</returns>
+	size_t GenerateTangents() {
+		static_assert(HasVertexTangent<VertType>::value && HasVertexUV<VertType>::value, "GenerateTangents needs a vertex type with a Tangent and a UV");
+		if (_vertices.empty()) {
+			return 0;
+		}
+		return TangentSpace::Generate(&_vertices[0].Position.x, &_vertices[0].Normal.x, &_vertices[0].UV.x, sizeof(VertType), _vertices.size(),
+			_indices.data(), _indices.size(), &_vertices[0].Tangent, sizeof(VertType));
+	}
+
+	/// <summary>
+	/// Splits the mesh into flat charts for a lightmap (see ChartPacker), splitting any vertices that sit on the seams
+	/// between charts. Like Optimize, this changes the vertices and indices, so any meshlets, LODs or triangle tree
+	/// need to be built again afterwards
+	/// </summary>
+	/// <param name="transform">Where the mesh gets placed in the world, so the charts are measured in world units</param>
+	/// <returns>The charts, with one entry in the coordinates for each of our new vertices</returns>
+	ChartPacker::Unwrap GenerateLightmapCharts(const glm::mat4& transform = glm::mat4(1.0f)) {
+		std::vector<glm::vec3> positions(_vertices.size());
+		for (size_t ix = 0; ix < _vertices.size(); ix++) {
+			positions[ix] = transform * glm::vec4(_vertices[ix].Position, 1.0f);
+		}
+		ChartPacker::Unwrap result = ChartPacker::Build(positions.empty() ? nullptr : &positions[0].x, sizeof(glm::vec3), positions.size(),
+			_indices.data(), _indices.size());
+
+		std::vector<VertType> vertices;
+		vertices.reserve(result.Remap.size());
+		for (uint32_t source : result.Remap) {
+			vertices.push_back(_vertices[source]);
+		}
+		_vertices.swap(vertices);
+		_indices = result.Indices;
+		_meshlets.clear();
+		_lods.clear();
+		_triangles = nullptr;
+		return result;
+	}
+
+	/// <summary>
+	/// Builds a tree over the mesh's triangles for picking and collision, this gets attached to the mesh in Bake.
+	/// Like BuildMeshlets, this should come after anything else that changes the vertices or indices. It's all CPU
+	/// work, so it's best done on the same thread as the rest of the loading
+	/// </summary>
+	/// <returns>The number of nodes in the tree</returns>
+	size_t BuildTriangleBvh() {
+		const float* positions = _vertices.empty() ? nullptr : &_vertices[0].Position.x;
+		_triangles = TriangleBvh::Build(positions, sizeof(VertType), _vertices.size(), _indices.data(), _indices.size());
+		return _triangles != nullptr ? _triangles->GetNodeCount() : 0;
+	}
+
+	/// <summary>
+	/// Gets the tree built by BuildTriangleBvh, or nullptr if it hasn't been built
+	/// </summary>
+	const TriangleBvh::sptr& GetTriangleBvh() const { return _triangles; }
+
+	/// <summary>
+	/// Uploads the mesh to the GPU, and packs a copy into the mesh arena for the vertex type
+	/// </summary>
+	/// <typeparam name="OutVert">
+	/// The vertex type to upload, defaults to the type we were built with. Any other type needs an explicit constructor
+	/// that takes one of our vertices (ex: VertexPackedPosNormTexCol to halve the size of a VertexPosNormTexCol mesh)
+	/// </typeparam>
+	template <typename OutVert = VertType>
 	VertexArrayObject::sptr Bake() {
+		// Convert the vertices if we need to, we don't keep the converted copy since it's only needed for the upload
+		std::vector<OutVert> converted;
+		const OutVert* vertices;
+		if constexpr (std::is_same_v<OutVert, VertType>) {
+			vertices = GetVertexDataPtr();
+		} else {
+			converted.reserve(_vertices.size());
+			for (const VertType& vertex : _vertices) {
+				converted.emplace_back(vertex);
+			}
+			vertices = converted.data();
+		}
+
+		// Baked meshes never change, so they get immutable storage
 		VertexBuffer::sptr vbo = VertexBuffer::Create();
-		vbo->LoadData(GetVertexDataPtr(), _vertices.size());
+		vbo->LoadImmutable(vertices, _vertices.size());
 
+		// The arena keeps 32 bit indices since it's shared between meshes, but our own copy can often be smaller
 		IndexBuffer::sptr ebo = IndexBuffer::Create();
-		ebo->LoadData(GetIndexDataPtr(), _indices.size());
+		ebo->LoadCompact(GetIndexDataPtr(), _indices.size(), _vertices.size(), true);
 
 		VertexArrayObject::sptr result = VertexArrayObject::Create();
-		result->AddVertexBuffer(vbo, VertType::V_DECL);
+		result->AddVertexBuffer(vbo, OutVert::V_DECL);
 		result->SetIndexBuffer(ebo);
 
+		// Calculate the bounds of the mesh while we still have the vertices on hand, so we can cull it later
+		if (_vertices.size() > 0) {
+			glm::vec3 min = _vertices[0].Position;
+			glm::vec3 max = _vertices[0].Position;
+			for (const VertType& vertex : _vertices) {
+				min = glm::min(min, vertex.Position);
+				max = glm::max(max, vertex.Position);
+			}
+			result->SetBounds(BoundingVolume(min, max));
+		}
+
+		// We also pack a copy into the shared arena for our vertex type, so the mesh can be drawn with multi-draw indirect
+		result->SetArenaSlice(MeshArena::Get<OutVert>()->Allocate(vertices, _vertices.size(), GetIndexDataPtr(), _indices.size()));
+		if (!_meshlets.empty()) {
+			result->SetMeshlets(MeshletBuffer::Create(_meshlets));
+		}
+		for (const MeshOptimizer::Lod& lod : _lods) {
+			result->AddLod(lod.Indices.data(), lod.Indices.size(), lod.Error);
+		}
+		result->SetTriangleBvh(_triangles);
+
 		return result;
 	}
 	
@@ -103,6 +380,24 @@ public:
 		return _vertices.data();
 	}
 	/// <summary>
+	/// Gets a vertex to change in place, valid only until another call to AddVertex
+	/// </summary>
+	VertType& GetVertex(size_t index) {
+		return _vertices[index];
+	}
+	/// <summary>
+	/// Gets the simplified levels from the last call to GenerateLods
+	/// </summary>
+	const std::vector<MeshOptimizer::Lod>& GetLods() const {
+		return _lods;
+	}
+	/// <summary>
+	/// Gets the meshlets from the last call to BuildMeshlets
+	/// </summary>
+	const std::vector<Meshlet>& GetMeshlets() const {
+		return _meshlets;
+	}
+	/// <summary>
 	/// Gets a pointer to the underlying index data in the mesh, valid only
 	/// until another call to AddIndex or AddIndexTri
 	/// </summary>
@@ -115,4 +410,7 @@ protected:
 	
 	std::vector<VertType> _vertices;
 	std::vector<uint32_t> _indices;
+	std::vector<Meshlet>  _meshlets;
+	std::vector<MeshOptimizer::Lod> _lods;
+	TriangleBvh::sptr     _triangles;
 };
@@ -0,0 +1,227 @@
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+// SSE2 is always there on x64, anything else decodes one byte at a time
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MESH_CODEC_SSE
+	#include <emmintrin.h>
+#endif
+
+// The vertices are encoded in blocks of this many, so the decoder's scratch space stays small enough to be in cache
+static const size_t VERTEX_BLOCK = 256;
+// The bytes in a plane are stored in groups of this many, each with it's own 2 bit header
+static const size_t GROUP_SIZE = 16;
+
+// Moves the sign into the lowest bit, so values near 0 in either direction have small magnitudes
+static inline uint32_t ZigZag(int32_t value) {
+	return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+static inline int32_t UnZigZag(uint32_t value) {
+	return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+static inline uint8_t ZigZag8(uint8_t value) {
+	return static_cast<uint8_t>((value << 1) ^ (static_cast<int8_t>(value) >> 7));
+}
+static inline uint8_t UnZigZag8(uint8_t value) {
+	return static_cast<uint8_t>((value >> 1) ^ -(value & 1));
+}
+
+std::vector<uint8_t> MeshCodec::EncodeIndices(const uint32_t* indices, size_t count) {
+	std::vector<uint8_t> result;
+	result.reserve(count + count / 4);
+	uint32_t last = 0;
+	for (size_t ix = 0; ix < count; ix++) {
+		// The subtraction wraps, which turns into the right signed step for anything under 2^31 apart
+		uint32_t value = ZigZag(static_cast<int32_t>(indices[ix] - last));
+		last = indices[ix];
+		while (value >= 0x80) {
+			result.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		result.push_back(static_cast<uint8_t>(value));
+	}
+	return result;
+}
+
+bool MeshCodec::DecodeIndices(uint32_t* result, size_t count, const uint8_t* data, size_t size) {
+	const uint8_t* end = data + size;
+	uint32_t last = 0;
+	for (size_t ix = 0; ix < count; ix++) {
+		uint32_t value = 0;
+		for (int shift = 0;; shift += 7) {
+			// A 32 bit value never takes more than 5 bytes
+			if (data == end || shift > 28) {
+				return false;
+			}
+			const uint8_t byte = *data++;
+			value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) {
+				break;
+			}
+		}
+		last += static_cast<uint32_t>(UnZigZag(value));
+		result[ix] = last;
+	}
+	return data == end;
+}
+
+std::vector<uint8_t> MeshCodec::EncodeVertices(const void* vertices, size_t count, size_t stride) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+	std::vector<uint8_t> result;
+	result.reserve(count * stride / 2);
+	// The deltas carry on across blocks, the first vertex is compared against zeros
+	std::vector<uint8_t> last(stride, 0);
+	uint8_t deltas[VERTEX_BLOCK];
+
+	for (size_t first = 0; first < count; first += VERTEX_BLOCK) {
+		const size_t blockCount = std::min(VERTEX_BLOCK, count - first);
+		const size_t groupCount = (blockCount + GROUP_SIZE - 1) / GROUP_SIZE;
+		for (size_t plane = 0; plane < stride; plane++) {
+			uint8_t previous = last[plane];
+			for (size_t ix = 0; ix < blockCount; ix++) {
+				const uint8_t value = bytes[(first + ix) * stride + plane];
+				deltas[ix] = ZigZag8(static_cast<uint8_t>(value - previous));
+				previous = value;
+			}
+			last[plane] = previous;
+			// The last group gets padded out with zeros, the decoder ignores anything past the end of the block
+			memset(deltas + blockCount, 0, groupCount * GROUP_SIZE - blockCount);
+
+			// The plane's headers come first, 4 groups to a byte
+			const size_t headers = result.size();
+			result.resize(result.size() + (groupCount + 3) / 4, 0);
+			for (size_t group = 0; group < groupCount; group++) {
+				const uint8_t* values = deltas + group * GROUP_SIZE;
+				uint8_t bits = 0;
+				for (size_t ix = 0; ix < GROUP_SIZE; ix++) {
+					bits |= values[ix];
+				}
+				// 0 - all zero, 1 - 2 bits each, 2 - 4 bits each, 3 - stored as is
+				const uint8_t mode = bits == 0 ? 0 : bits < 4 ? 1 : bits < 16 ? 2 : 3;
+				result[headers + group / 4] |= static_cast<uint8_t>(mode << ((group % 4) * 2));
+				if (mode == 1) {
+					for (size_t ix = 0; ix < GROUP_SIZE; ix += 4) {
+						result.push_back(static_cast<uint8_t>(values[ix] | (values[ix + 1] << 2) | (values[ix + 2] << 4) | (values[ix + 3] << 6)));
+					}
+				} else if (mode == 2) {
+					for (size_t ix = 0; ix < GROUP_SIZE; ix += 2) {
+						result.push_back(static_cast<uint8_t>(values[ix] | (values[ix + 1] << 4)));
+					}
+				} else if (mode == 3) {
+					result.insert(result.end(), values, values + GROUP_SIZE);
+				}
+			}
+		}
+	}
+	return result;
+}
+
+// Unpacks a group of 16 deltas stored with the given mode, the caller has already checked there's enough data
+static inline void DecodeGroup(uint8_t mode, const uint8_t* data, uint8_t* result) {
+#if defined(MESH_CODEC_SSE)
+	__m128i values;
+	switch (mode) {
+		case 1: {
+			// Each byte holds 4 values, so we pull out each quarter and interleave them back into order
+			int packed;
+			memcpy(&packed, data, sizeof(int));
+			const __m128i source = _mm_cvtsi32_si128(packed);
+			const __m128i mask = _mm_set1_epi8(3);
+			const __m128i q0 = _mm_and_si128(source, mask);
+			const __m128i q1 = _mm_and_si128(_mm_srli_epi16(source, 2), mask);
+			const __m128i q2 = _mm_and_si128(_mm_srli_epi16(source, 4), mask);
+			const __m128i q3 = _mm_and_si128(_mm_srli_epi16(source, 6), mask);
+			values = _mm_unpacklo_epi16(_mm_unpacklo_epi8(q0, q1), _mm_unpacklo_epi8(q2, q3));
+			break;
+		}
+		case 2: {
+			const __m128i source = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+			const __m128i mask = _mm_set1_epi8(15);
+			values = _mm_unpacklo_epi8(_mm_and_si128(source, mask), _mm_and_si128(_mm_srli_epi16(source, 4), mask));
+			break;
+		}
+		case 3:
+			values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+			break;
+		default:
+			values = _mm_setzero_si128();
+			break;
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(result), values);
+#else
+	for (size_t ix = 0; ix < GROUP_SIZE; ix++) {
+		switch (mode) {
+			case 1:  result[ix] = (data[ix / 4] >> ((ix % 4) * 2)) & 3; break;
+			case 2:  result[ix] = (data[ix / 2] >> ((ix % 2) * 4)) & 15; break;
+			case 3:  result[ix] = data[ix]; break;
+			default: result[ix] = 0; break;
+		}
+	}
+#endif
+}
+
+bool MeshCodec::DecodeVertices(void* result, size_t count, size_t stride, const uint8_t* data, size_t size) {
+	static const size_t GROUP_BYTES[4] = { 0, GROUP_SIZE / 4, GROUP_SIZE / 2, GROUP_SIZE };
+	const uint8_t* end = data + size;
+	uint8_t* bytes = static_cast<uint8_t*>(result);
+	// The deltas for a block, laid out like the vertices so they can be added on a whole vertex at a time
+	std::vector<uint8_t> deltas(VERTEX_BLOCK * stride);
+	const std::vector<uint8_t> zeros(stride, 0);
+	uint8_t group[GROUP_SIZE];
+
+	for (size_t first = 0; first < count; first += VERTEX_BLOCK) {
+		const size_t blockCount = std::min(VERTEX_BLOCK, count - first);
+		const size_t groupCount = (blockCount + GROUP_SIZE - 1) / GROUP_SIZE;
+		for (size_t plane = 0; plane < stride; plane++) {
+			const uint8_t* headers = data;
+			data += (groupCount + 3) / 4;
+			if (data > end) {
+				return false;
+			}
+			for (size_t ix = 0; ix < groupCount; ix++) {
+				const uint8_t mode = (headers[ix / 4] >> ((ix % 4) * 2)) & 3;
+				if (static_cast<size_t>(end - data) < GROUP_BYTES[mode]) {
+					return false;
+				}
+				DecodeGroup(mode, data, group);
+				data += GROUP_BYTES[mode];
+				const size_t valid = std::min(GROUP_SIZE, blockCount - ix * GROUP_SIZE);
+				for (size_t value = 0; value < valid; value++) {
+					deltas[(ix * GROUP_SIZE + value) * stride + plane] = group[value];
+				}
+			}
+		}
+
+		// Each vertex is the one before plus it's deltas, which works on as many bytes of the vertex at once as we can
+		for (size_t ix = 0; ix < blockCount; ix++) {
+			uint8_t* vertex = bytes + (first + ix) * stride;
+			const uint8_t* previous = first + ix == 0 ? zeros.data() : vertex - stride;
+			const uint8_t* delta = deltas.data() + ix * stride;
+			size_t offset = 0;
+#if defined(MESH_CODEC_SSE)
+			const __m128i one = _mm_set1_epi8(1);
+			const __m128i low = _mm_set1_epi8(0x7F);
+			for (; offset + 16 <= stride; offset += 16) {
+				const __m128i zigzag = _mm_loadu_si128(reinterpret_cast<const __m128i*>(delta + offset));
+				const __m128i value = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(zigzag, 1), low),
+					_mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(zigzag, one)));
+				const __m128i sum = _mm_add_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + offset)), value);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(vertex + offset), sum);
+			}
+			for (; offset + 8 <= stride; offset += 8) {
+				const __m128i zigzag = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(delta + offset));
+				const __m128i value = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(zigzag, 1), low),
+					_mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(zigzag, one)));
+				const __m128i sum = _mm_add_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(previous + offset)), value);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(vertex + offset), sum);
+			}
+#endif
+			for (; offset < stride; offset++) {
+				vertex[offset] = static_cast<uint8_t>(previous[offset] + UnZigZag8(delta[offset]));
+			}
+		}
+	}
+	return data == end;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Compresses vertex and index data for cooked meshes, in the style of meshoptimizer's codecs. Neither is as tight as
+/// a general purpose compressor, but both are simple enough to decode faster than the disk can read the bytes they
+/// save, so a smaller sidecar is a faster load
+///
+/// Indices are stored as the difference from the index before, zigzagged so small negative steps stay small, in as
+/// few bytes as each one needs (LEB128). Optimized meshes mostly step through nearby vertices, so most indices take a
+/// single byte instead of 4
+///
+/// Vertices are split into byte planes, so the first byte of every vertex is stored together, then the second, etc.
+/// Each byte is stored as the (zigzagged) difference from the same byte of the vertex before, and every 16 of those
+/// share a 2 bit header saying whether they take 0, 2, 4 or 8 bits each. Bytes that barely change between vertices
+/// (ex: the high bytes of positions, colors) shrink to almost nothing
+/// </summary>
+class MeshCodec final
+{
+public:
+	/// <summary>
+	/// Encodes an index buffer
+	/// </summary>
+	/// <param name="indices">The indices to encode</param>
+	/// <param name="count">The number of indices</param>
+	/// <returns>The encoded indices</returns>
+	static std::vector<uint8_t> EncodeIndices(const uint32_t* indices, size_t count);
+	/// <summary>
+	/// Decodes an index buffer made by EncodeIndices
+	/// </summary>
+	/// <param name="result">Where to write the indices, must have room for count of them</param>
+	/// <param name="count">The number of indices that were encoded</param>
+	/// <param name="data">The encoded indices</param>
+	/// <param name="size">The size of the encoded data, in bytes</param>
+	/// <returns>True if the data held exactly count indices</returns>
+	static bool DecodeIndices(uint32_t* result, size_t count, const uint8_t* data, size_t size);
+
+	/// <summary>
+	/// Encodes a vertex buffer, the vertices can be any type as long as they're the same size
+	/// </summary>
+	/// <param name="vertices">The vertices to encode</param>
+	/// <param name="count">The number of vertices</param>
+	/// <param name="stride">The size of a vertex, in bytes</param>
+	/// <returns>The encoded vertices</returns>
+	static std::vector<uint8_t> EncodeVertices(const void* vertices, size_t count, size_t stride);
+	/// <summary>
+	/// Decodes a vertex buffer made by EncodeVertices. Uses SSE2 when the compiler allows it
+	/// </summary>
+	/// <param name="result">Where to write the vertices, must have room for count * stride bytes</param>
+	/// <param name="count">The number of vertices that were encoded</param>
+	/// <param name="stride">The size of a vertex, in bytes</param>
+	/// <param name="data">The encoded vertices</param>
+	/// <param name="size">The size of the encoded data, in bytes</param>
+	/// <returns>True if the data held exactly count vertices</returns>
+	static bool DecodeVertices(void* result, size_t count, size_t stride, const uint8_t* data, size_t size);
+
+protected:
+	MeshCodec() = default;
+};
@@ -0,0 +1,420 @@
+#include "MeshCook.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <vector>
+
+#include "Logging.h"
+#include "Graphics/GpuResources.h"
+#include "Graphics/MeshArena.h"
+#include "CollisionCook.h"
+#include "FileUtils.h"
+#include "MappedFile.h"
+#include "MeshCodec.h"
+#include "ObjLoader.h"
+#include "TangentSpace.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+#include "VertexTypes.h"
+
+// The header at the start of every sidecar, followed by a MeshAttribute for each vertex attribute and then the
+// vertex, index, meshlet, LOD and tangent blobs
+struct MeshHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t VertexStride;
+	uint32_t AttributeCount;
+	uint64_t VertexCount;
+	uint64_t IndexCount;
+	// Offsets of the blobs from the start of the file, both are aligned to MESH_BLOB_ALIGNMENT. The vertices and
+	// indices are encoded with MeshCodec, so their sizes in the file are stored separately from their counts
+	uint64_t VertexOffset;
+	uint64_t IndexOffset;
+	uint64_t VertexBytes;
+	uint64_t IndexBytes;
+	uint32_t IndexType;
+	uint32_t Reserved;
+	float    BoundsMin[3];
+	float    BoundsMax[3];
+	// Used to detect when the source file has changed since the sidecar was cooked
+	uint64_t SourceSize;
+	int64_t  SourceWriteTime;
+	// The clusters for GPU culling, only big meshes have any (see MeshOptimizer::BuildMeshlets)
+	uint64_t MeshletCount;
+	uint64_t MeshletOffset;
+	// The simplified levels, stored as a MeshLod for each level followed by all of their encoded indices back to back
+	uint64_t LodCount;
+	uint64_t LodOffset;
+	// A tangent for each vertex, packed like VertexPackedPosNormTanTexCol's and encoded with MeshCodec. They're kept
+	// apart from the vertices so they only get decoded for meshes that are normal mapped
+	uint64_t TangentOffset;
+	uint64_t TangentBytes;
+};
+// Mirrors BufferAttribute, with fixed size fields so the file reads the same on any compiler
+struct MeshAttribute {
+	uint32_t Slot;
+	int32_t  Size;
+	uint32_t Type;
+	uint32_t Normalized;
+	uint32_t Stride;
+	uint32_t Offset;
+	uint32_t Usage;
+};
+// One entry in the LOD table, the levels' indices follow the table in the same order
+struct MeshLod {
+	uint32_t IndexCount;
+	float    Error;
+	uint32_t Bytes;
+};
+
+static const uint32_t MESH_MAGIC          = 'T' | ('M' << 8) | ('S' << 16) | ('H' << 24);
+// Bump this whenever the layout of the file, the vertex format or the processing (ex: the optimizer) changes, so old
+// sidecars get re-cooked
+static const uint32_t MESH_VERSION        = 7;
+// Mapped files start on a page boundary, so aligning the blobs within the file keeps them aligned in memory
+static const size_t   MESH_BLOB_ALIGNMENT = 16;
+
+// Cooked meshes are only ever uploaded, so they're stored packed
+typedef VertexPackedPosNormTexCol CookedVertex;
+
+static size_t AlignBlob(size_t offset) {
+	return (offset + MESH_BLOB_ALIGNMENT - 1) & ~(MESH_BLOB_ALIGNMENT - 1);
+}
+
+// Checks that a cooked layout is the one we would upload today, since the shaders and the mesh arena depend on it
+static bool MatchesLayout(const MeshAttribute* attributes, uint32_t count, const std::vector<BufferAttribute>& decl) {
+	if (count != decl.size()) {
+		return false;
+	}
+	for (uint32_t ix = 0; ix < count; ix++) {
+		const MeshAttribute& a = attributes[ix];
+		const BufferAttribute& b = decl[ix];
+		if (a.Slot != b.Slot || a.Size != b.Size || a.Type != b.Type || (a.Normalized != 0) != b.Normalized ||
+			a.Stride != (uint32_t)b.Stride || a.Offset != b.Offset || a.Usage != (uint32_t)b.Usage)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool MeshCook::CookFile(const std::string& path) {
+	AssetLoadScope load("Cook " + std::filesystem::path(path).filename().string());
+
+	// Sidecars are always cooked with white vertices, ObjLoader falls back to the OBJ for any other color
+	MeshBuilder<VertexPosNormTexCol> mesh;
+	try {
+		ObjLoader::ParseFile(path, mesh);
+	} catch (const std::exception& e) {
+		LOG_WARN("Failed to parse \"{}\": {}", path, e.what());
+		return false;
+	}
+	// Cooking is done ahead of time, so this is the best place to spend time on the triangle order
+	const MeshOptimizer::Stats stats = mesh.Optimize();
+	mesh.BuildMeshlets();
+	mesh.GenerateLods();
+	// Tangents are baked in here so they never need working out at runtime, the optimizer has already settled the
+	// vertex order they follow
+	std::vector<glm::vec4> tangents(mesh.GetVertexCount());
+	if (!tangents.empty()) {
+		const VertexPosNormTexCol* first = mesh.GetVertexDataPtr();
+		TangentSpace::Generate(&first->Position.x, &first->Normal.x, &first->UV.x, sizeof(VertexPosNormTexCol), tangents.size(),
+			mesh.GetIndexDataPtr(), mesh.GetIndexCount(), tangents.data());
+	}
+	const std::vector<Meshlet>& meshlets = mesh.GetMeshlets();
+	const std::vector<MeshOptimizer::Lod>& lods = mesh.GetLods();
+
+	const std::vector<BufferAttribute>& decl = CookedVertex::V_DECL;
+	MeshHeader header;
+	memset(&header, 0, sizeof(MeshHeader));
+	header.Magic          = MESH_MAGIC;
+	header.Version        = MESH_VERSION;
+	header.VertexStride   = sizeof(CookedVertex);
+	header.AttributeCount = static_cast<uint32_t>(decl.size());
+	header.VertexCount    = mesh.GetVertexCount();
+	header.IndexCount     = mesh.GetIndexCount();
+	header.IndexType      = GL_UNSIGNED_INT;
+	if (!GetFileStamp(path, header.SourceSize, header.SourceWriteTime)) {
+		LOG_WARN("Could not read the source model \"{}\" for a cooked mesh", path);
+		return false;
+	}
+
+	// Work out the bounds now, so loading doesn't have to walk the vertices
+	const VertexPosNormTexCol* source = mesh.GetVertexDataPtr();
+	std::vector<CookedVertex> vertices;
+	vertices.reserve(header.VertexCount);
+	std::vector<uint32_t> packedTangents;
+	packedTangents.reserve(header.VertexCount);
+	glm::vec3 min = header.VertexCount > 0 ? source[0].Position : glm::vec3(0.0f);
+	glm::vec3 max = min;
+	for (size_t ix = 0; ix < header.VertexCount; ix++) {
+		min = glm::min(min, source[ix].Position);
+		max = glm::max(max, source[ix].Position);
+		vertices.emplace_back(source[ix]);
+		packedTangents.push_back(TangentSpace::Pack(tangents[ix]));
+	}
+	memcpy(header.BoundsMin, &min, sizeof(header.BoundsMin));
+	memcpy(header.BoundsMax, &max, sizeof(header.BoundsMax));
+
+	// The optimizer has already put the vertices in the order they're first used, which is what makes both codecs work
+	const std::vector<uint8_t> encodedVertices = MeshCodec::EncodeVertices(vertices.data(), vertices.size(), sizeof(CookedVertex));
+	const std::vector<uint8_t> encodedIndices = MeshCodec::EncodeIndices(mesh.GetIndexDataPtr(), header.IndexCount);
+	const std::vector<uint8_t> encodedTangents = MeshCodec::EncodeVertices(packedTangents.data(), packedTangents.size(), sizeof(uint32_t));
+	std::vector<std::vector<uint8_t>> encodedLods;
+	encodedLods.reserve(lods.size());
+	for (const MeshOptimizer::Lod& lod : lods) {
+		encodedLods.push_back(MeshCodec::EncodeIndices(lod.Indices.data(), lod.Indices.size()));
+	}
+
+	header.VertexOffset   = AlignBlob(sizeof(MeshHeader) + decl.size() * sizeof(MeshAttribute));
+	header.VertexBytes    = encodedVertices.size();
+	header.IndexOffset    = AlignBlob(header.VertexOffset + header.VertexBytes);
+	header.IndexBytes     = encodedIndices.size();
+	header.MeshletCount   = meshlets.size();
+	header.MeshletOffset  = AlignBlob(header.IndexOffset + header.IndexBytes);
+	header.LodCount       = lods.size();
+	header.LodOffset      = AlignBlob(header.MeshletOffset + header.MeshletCount * sizeof(Meshlet));
+	size_t lodEnd = header.LodOffset + header.LodCount * sizeof(MeshLod);
+	for (const std::vector<uint8_t>& encoded : encodedLods) {
+		lodEnd += encoded.size();
+	}
+	header.TangentOffset  = AlignBlob(lodEnd);
+	header.TangentBytes   = encodedTangents.size();
+
+	const std::string sidecar = GetSidecarPath(path);
+	std::ofstream stream(sidecar, std::ios::binary | std::ios::trunc);
+	if (!stream.is_open()) {
+		LOG_WARN("Failed to open \"{}\" for writing", sidecar);
+		return false;
+	}
+	const char padding[MESH_BLOB_ALIGNMENT] = { 0 };
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(MeshHeader));
+	for (const BufferAttribute& attrib : decl) {
+		MeshAttribute entry{ attrib.Slot, attrib.Size, attrib.Type, attrib.Normalized ? 1u : 0u,
+			(uint32_t)attrib.Stride, (uint32_t)attrib.Offset, (uint32_t)attrib.Usage };
+		stream.write(reinterpret_cast<const char*>(&entry), sizeof(MeshAttribute));
+	}
+	stream.write(padding, header.VertexOffset - (sizeof(MeshHeader) + decl.size() * sizeof(MeshAttribute)));
+	stream.write(reinterpret_cast<const char*>(encodedVertices.data()), header.VertexBytes);
+	stream.write(padding, header.IndexOffset - (header.VertexOffset + header.VertexBytes));
+	stream.write(reinterpret_cast<const char*>(encodedIndices.data()), header.IndexBytes);
+	stream.write(padding, header.MeshletOffset - (header.IndexOffset + header.IndexBytes));
+	stream.write(reinterpret_cast<const char*>(meshlets.data()), header.MeshletCount * sizeof(Meshlet));
+	stream.write(padding, header.LodOffset - (header.MeshletOffset + header.MeshletCount * sizeof(Meshlet)));
+	for (size_t ix = 0; ix < lods.size(); ix++) {
+		const MeshLod entry{ static_cast<uint32_t>(lods[ix].Indices.size()), lods[ix].Error, static_cast<uint32_t>(encodedLods[ix].size()) };
+		stream.write(reinterpret_cast<const char*>(&entry), sizeof(MeshLod));
+	}
+	for (const std::vector<uint8_t>& encoded : encodedLods) {
+		stream.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+	}
+	stream.write(padding, header.TangentOffset - lodEnd);
+	stream.write(reinterpret_cast<const char*>(encodedTangents.data()), header.TangentBytes);
+	if (!stream.good()) {
+		LOG_WARN("Failed to write \"{}\"", sidecar);
+		return false;
+	}
+	const size_t rawBytes = header.VertexCount * header.VertexStride + header.IndexCount * sizeof(uint32_t);
+	LOG_INFO("Cooked {} vertices, {} indices, {} meshlets and {} LODs for \"{}\" (ACMR {:.3f} -> {:.3f}, {} KB -> {} KB)", header.VertexCount, header.IndexCount, header.MeshletCount, header.LodCount, path, stats.AcmrBefore, stats.AcmrAfter, rawBytes / 1024, (header.VertexBytes + header.IndexBytes) / 1024);
+	// The collision sidecar is cooked from the same triangles, so anything we render can also be collided with
+	CollisionCook::CookFile(path, &source[0].Position.x, sizeof(VertexPosNormTexCol), header.VertexCount, mesh.GetIndexDataPtr(), header.IndexCount);
+	return true;
+}
+
+uint32_t MeshCook::CookDirectory(const std::string& path) {
+	std::error_code error;
+	std::vector<std::future<bool>> results;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+		if (entry.is_regular_file() && IsCookableFile(entry.path().string())) {
+			std::string file = entry.path().string();
+			results.push_back(ThreadPool::Instance().Submit([file]() { return CookFile(file); }));
+		}
+	}
+	if (error) {
+		LOG_WARN("Failed to search \"{}\" for models: {}", path, error.message());
+	}
+
+	uint32_t cooked = 0;
+	for (std::future<bool>& result : results) {
+		cooked += result.get() ? 1 : 0;
+	}
+	return cooked;
+}
+
+std::string MeshCook::GetSidecarPath(const std::string& objPath) {
+	return objPath + ".mesh";
+}
+
+VertexArrayObject::sptr MeshCook::LoadSidecar(const std::string& objPath, CpuResidency residency, bool withTangents) {
+	CookedMesh::sptr mesh = OpenSidecar(objPath, withTangents);
+	if (mesh == nullptr) {
+		return nullptr;
+	}
+	VertexArrayObject::sptr result = UploadSidecar(mesh);
+	if (residency == CpuResidency::KeepCpuCopy) {
+		result->SetTriangleBvh(BuildTriangleBvh(mesh));
+	}
+	return result;
+}
+
+CookedMesh::sptr MeshCook::OpenSidecar(const std::string& objPath, bool withTangents) {
+	const std::string path = GetSidecarPath(objPath);
+	MappedFile::sptr file = MappedFile::Open(path);
+	// Missing sidecars are normal, models that haven't been cooked just get parsed from the OBJ
+	if (file == nullptr) {
+		return nullptr;
+	}
+	const char* data = file->GetData();
+	const size_t size = file->GetSize();
+
+	if (size < sizeof(MeshHeader)) {
+		LOG_WARN("Cooked mesh \"{}\" is truncated", path);
+		return nullptr;
+	}
+	MeshHeader header;
+	memcpy(&header, data, sizeof(MeshHeader));
+	if (header.Magic != MESH_MAGIC || header.Version != MESH_VERSION) {
+		LOG_WARN("Cooked mesh \"{}\" is not a sidecar we can read, it should be re-cooked", path);
+		return nullptr;
+	}
+
+	// The sidecar is only as good as the model it was cooked from
+	uint64_t sourceSize;
+	int64_t  sourceWriteTime;
+	if (GetFileStamp(objPath, sourceSize, sourceWriteTime) &&
+		(sourceSize != header.SourceSize || sourceWriteTime != header.SourceWriteTime))
+	{
+		LOG_WARN("Cooked mesh \"{}\" is older than it's model, it should be re-cooked", path);
+		return nullptr;
+	}
+
+	const std::vector<BufferAttribute>& decl = CookedVertex::V_DECL;
+	if (size < sizeof(MeshHeader) + header.AttributeCount * (size_t)sizeof(MeshAttribute) ||
+		header.VertexStride != sizeof(CookedVertex) || header.IndexType != GL_UNSIGNED_INT ||
+		!MatchesLayout(reinterpret_cast<const MeshAttribute*>(data + sizeof(MeshHeader)), header.AttributeCount, decl))
+	{
+		LOG_WARN("Cooked mesh \"{}\" has a different vertex layout than we use, it should be re-cooked", path);
+		return nullptr;
+	}
+	if (header.VertexOffset % MESH_BLOB_ALIGNMENT != 0 || header.IndexOffset % MESH_BLOB_ALIGNMENT != 0 ||
+		header.MeshletOffset % MESH_BLOB_ALIGNMENT != 0 ||
+		header.VertexOffset + header.VertexBytes > size || header.IndexOffset + header.IndexBytes > size ||
+		header.MeshletOffset + header.MeshletCount * sizeof(Meshlet) > size ||
+		header.LodOffset % MESH_BLOB_ALIGNMENT != 0 || header.LodOffset + header.LodCount * sizeof(MeshLod) > size ||
+		header.TangentOffset % MESH_BLOB_ALIGNMENT != 0 || header.TangentOffset + header.TangentBytes > size)
+	{
+		LOG_WARN("Cooked mesh \"{}\" is corrupted", path);
+		return nullptr;
+	}
+	// The LOD table says how many indices follow it, so that needs checking too
+	uint64_t lodIndexEnd = header.LodOffset + header.LodCount * sizeof(MeshLod);
+	uint64_t lodIndexCount = 0;
+	for (uint64_t ix = 0; ix < header.LodCount; ix++) {
+		MeshLod lod;
+		memcpy(&lod, data + header.LodOffset + ix * sizeof(MeshLod), sizeof(MeshLod));
+		lodIndexEnd += lod.Bytes;
+		lodIndexCount += lod.IndexCount;
+	}
+	if (lodIndexEnd > size) {
+		LOG_WARN("Cooked mesh \"{}\" is corrupted", path);
+		return nullptr;
+	}
+
+	// Decoding is the expensive part of loading a sidecar, which is why this is meant to run on a worker thread
+	CookedMesh::sptr result = std::make_shared<CookedMesh>();
+	result->File = file;
+	result->Vertices.resize(header.VertexCount * header.VertexStride);
+	result->Indices.resize(header.IndexCount);
+	result->LodIndices.resize(lodIndexCount);
+	bool isValid =
+		MeshCodec::DecodeVertices(result->Vertices.data(), header.VertexCount, header.VertexStride,
+			reinterpret_cast<const uint8_t*>(data + header.VertexOffset), header.VertexBytes) &&
+		MeshCodec::DecodeIndices(result->Indices.data(), header.IndexCount,
+			reinterpret_cast<const uint8_t*>(data + header.IndexOffset), header.IndexBytes);
+	const uint8_t* encoded = reinterpret_cast<const uint8_t*>(data + header.LodOffset + header.LodCount * sizeof(MeshLod));
+	uint32_t* lodIndices = result->LodIndices.data();
+	for (uint64_t ix = 0; isValid && ix < header.LodCount; ix++) {
+		MeshLod lod;
+		memcpy(&lod, data + header.LodOffset + ix * sizeof(MeshLod), sizeof(MeshLod));
+		isValid = MeshCodec::DecodeIndices(lodIndices, lod.IndexCount, encoded, lod.Bytes);
+		lodIndices += lod.IndexCount;
+		encoded += lod.Bytes;
+	}
+	if (isValid && withTangents) {
+		result->Tangents.resize(header.VertexCount);
+		isValid = MeshCodec::DecodeVertices(result->Tangents.data(), header.VertexCount, sizeof(uint32_t),
+			reinterpret_cast<const uint8_t*>(data + header.TangentOffset), header.TangentBytes);
+	}
+	if (!isValid) {
+		LOG_WARN("Cooked mesh \"{}\" is corrupted", path);
+		return nullptr;
+	}
+	return result;
+}
+
+VertexArrayObject::sptr MeshCook::UploadSidecar(const CookedMesh::sptr& mesh) {
+	GPU_RESOURCE_OWNER("MeshCook");
+	const char* data = mesh->File->GetData();
+	MeshHeader header;
+	memcpy(&header, data, sizeof(MeshHeader));
+	const uint32_t* indices = mesh->Indices.data();
+
+	// The worker already decoded everything into the layout the GPU wants, so it goes straight into the buffers. If
+	// the tangents were asked for they need to be interleaved with the vertices first, and the mesh goes into the
+	// arena for the bigger vertex instead
+	const std::vector<BufferAttribute>* decl = &CookedVertex::V_DECL;
+	const MeshArena::sptr* arena = &MeshArena::Get<CookedVertex>();
+	const void* vertices = mesh->Vertices.data();
+	size_t stride = header.VertexStride;
+	std::vector<VertexPackedPosNormTanTexCol> withTangents;
+	if (!mesh->Tangents.empty()) {
+		const CookedVertex* cooked = reinterpret_cast<const CookedVertex*>(mesh->Vertices.data());
+		withTangents.reserve(header.VertexCount);
+		for (size_t ix = 0; ix < header.VertexCount; ix++) {
+			withTangents.emplace_back(cooked[ix], mesh->Tangents[ix]);
+		}
+		decl = &VertexPackedPosNormTanTexCol::V_DECL;
+		arena = &MeshArena::Get<VertexPackedPosNormTanTexCol>();
+		vertices = withTangents.data();
+		stride = sizeof(VertexPackedPosNormTanTexCol);
+	}
+
+	VertexBuffer::sptr vbo = VertexBuffer::Create();
+	vbo->LoadImmutable(vertices, stride, header.VertexCount);
+	IndexBuffer::sptr ebo = IndexBuffer::Create();
+	ebo->LoadCompact(indices, header.IndexCount, header.VertexCount, true);
+
+	VertexArrayObject::sptr result = VertexArrayObject::Create();
+	result->AddVertexBuffer(vbo, *decl);
+	result->SetIndexBuffer(ebo);
+	result->SetBounds(BoundingVolume(
+		glm::vec3(header.BoundsMin[0], header.BoundsMin[1], header.BoundsMin[2]),
+		glm::vec3(header.BoundsMax[0], header.BoundsMax[1], header.BoundsMax[2])));
+	result->SetArenaSlice((*arena)->Allocate(vertices, header.VertexCount, indices, header.IndexCount));
+	if (header.MeshletCount > 0) {
+		const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(data + header.MeshletOffset);
+		result->SetMeshlets(MeshletBuffer::Create(std::vector<Meshlet>(meshlets, meshlets + header.MeshletCount)));
+	}
+	const MeshLod* lods = reinterpret_cast<const MeshLod*>(data + header.LodOffset);
+	const uint32_t* lodIndices = mesh->LodIndices.data();
+	for (uint64_t ix = 0; ix < header.LodCount; ix++) {
+		result->AddLod(lodIndices, lods[ix].IndexCount, lods[ix].Error);
+		lodIndices += lods[ix].IndexCount;
+	}
+	return result;
+}
+
+TriangleBvh::sptr MeshCook::BuildTriangleBvh(const CookedMesh::sptr& mesh) {
+	// Position is the first thing in every cooked vertex, so it's right at the start of each stride
+	return TriangleBvh::Build(reinterpret_cast<const float*>(mesh->Vertices.data()), sizeof(CookedVertex),
+		mesh->Vertices.size() / sizeof(CookedVertex), mesh->Indices.data(), mesh->Indices.size());
+}
+
+bool MeshCook::IsCookableFile(const std::string& path) {
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower(c); });
+	return extension == ".obj";
+}
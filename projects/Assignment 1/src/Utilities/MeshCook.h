@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Graphics/CpuResidency.h"
+#include "Graphics/VertexArrayObject.h"
+#include "MappedFile.h"
+
+/// <summary>
+/// A cooked mesh that has been read and decoded, but not uploaded yet. None of this needs the OpenGL context, so it
+/// gets made on a worker thread and handed to the main thread to upload
+/// </summary>
+struct CookedMesh {
+	typedef std::shared_ptr<CookedMesh> sptr;
+	// The sidecar, still mapped for the parts that are stored as is (the header, meshlets and LOD table)
+	MappedFile::sptr      File;
+	std::vector<uint8_t>  Vertices;
+	std::vector<uint32_t> Indices;
+	// Every level's indices back to back, in the same order as the LOD table
+	std::vector<uint32_t> LodIndices;
+	// A packed tangent for each vertex, only decoded when OpenSidecar was asked for them
+	std::vector<uint32_t> Tangents;
+};
+
+/// <summary>
+/// Converts OBJ files ahead of time into a binary sidecar next to the source file (ex: models/Slide.obj ->
+/// models/Slide.obj.mesh). The sidecar stores the vertex layout, the bounds, and the vertex and index data already
+/// processed into the form they get uploaded in, compressed with MeshCodec, so loading one is a memory map, a decode
+/// and a copy to the GPU. ObjLoader picks these up on it's own
+/// Every sidecar also stores the mesh's tangents (see TangentSpace), off to the side of the vertices, so normal
+/// mapped meshes never work them out at runtime and every other mesh never loads them
+/// Cooking a model also writes it's collision sidecar, see CollisionCook
+/// </summary>
+class MeshCook final
+{
+public:
+	/// <summary>
+	/// Parses an OBJ file and writes it's cooked sidecar
+	/// </summary>
+	/// <param name="path">The path of the OBJ file to cook</param>
+	/// <returns>True if the sidecar was written</returns>
+	static bool CookFile(const std::string& path);
+	/// <summary>
+	/// Cooks every OBJ file in a folder and all of it's sub-folders, files are cooked in parallel on the ThreadPool
+	/// </summary>
+	/// <param name="path">The folder to search for models</param>
+	/// <returns>The number of models that were cooked</returns>
+	static uint32_t CookDirectory(const std::string& path);
+
+	/// <summary>
+	/// Gets the path of the sidecar file that stores the cooked mesh for an OBJ file
+	/// </summary>
+	static std::string GetSidecarPath(const std::string& objPath);
+	/// <summary>
+	/// Loads the cooked mesh for an OBJ file, if it's sidecar exists and was cooked from the current version of the file
+	/// </summary>
+	/// <param name="objPath">The path of the source OBJ file (not the sidecar)</param>
+	/// <param name="residency">Whether to build the tree over the mesh's triangles, only KeepCpuCopy builds it</param>
+	/// <param name="withTangents">True to load the tangents as well, the mesh then uses VertexPackedPosNormTanTexCol</param>
+	/// <returns>The mesh, or nullptr if there is no valid sidecar</returns>
+	static VertexArrayObject::sptr LoadSidecar(const std::string& objPath, CpuResidency residency = CpuResidency::KeepCpuCopy, bool withTangents = false);
+	/// <summary>
+	/// Maps, validates and decodes the cooked mesh for an OBJ file without creating anything on the GPU, so it can be
+	/// done on a worker thread. The result gets passed to UploadSidecar on the main thread
+	/// </summary>
+	/// <param name="objPath">The path of the source OBJ file (not the sidecar)</param>
+	/// <param name="withTangents">True to decode the tangents as well</param>
+	/// <returns>The decoded mesh, or nullptr if there is no valid sidecar</returns>
+	static CookedMesh::sptr OpenSidecar(const std::string& objPath, bool withTangents = false);
+	/// <summary>
+	/// Creates the mesh for a sidecar returned by OpenSidecar, must be called on the main thread. Sidecars opened with
+	/// their tangents get uploaded as VertexPackedPosNormTanTexCol, and VertexPackedPosNormTexCol otherwise
+	/// </summary>
+	static VertexArrayObject::sptr UploadSidecar(const CookedMesh::sptr& mesh);
+	/// <summary>
+	/// Builds the tree over a decoded sidecar's triangles, this doesn't need the OpenGL context so it can be done on
+	/// the same worker thread as OpenSidecar
+	/// </summary>
+	/// <param name="mesh">A sidecar returned by OpenSidecar</param>
+	static TriangleBvh::sptr BuildTriangleBvh(const CookedMesh::sptr& mesh);
+
+	/// <summary>
+	/// Returns true if the file is a model that we know how to cook
+	/// </summary>
+	static bool IsCookableFile(const std::string& path);
+
+protected:
+	MeshCook() = default;
+};
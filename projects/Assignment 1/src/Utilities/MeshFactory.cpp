@@ -90,65 +90,56 @@ Vertex CalculateSphereVert(glm::vec3 norm, glm::vec3 scale, glm::vec3 center) {
 	return vert;
 }
 
-void MeshFactory::AddIcoSphere(MeshBuilder<VertexPosNormTexCol>& data, const glm::vec3& center, float radius, int tessellation, const glm::vec4& col) {
-	AddIcoSphere(data, center, glm::vec3(radius), tessellation, col);
-}
-
-void MeshFactory::AddIcoSphere(MeshBuilder<VertexPosNormTexCol>& data, const glm::vec3& center, const glm::vec3& radii, int tessellation, const glm::vec4& col) {
-	LOG_ASSERT(tessellation >= 0, "Tessellation must be greater than zero!");
-
-	uint32_t indexOffset = data.GetVertexCount();
-	uint32_t initialIndex = data.GetIndexCount();
+// Generates an icosphere with a radius of 1 by splitting each triangle of an icosahedron into 4, tessellation times
+static void BuildIcoSphere(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, int tessellation) {
+	const glm::vec3 radii = glm::vec3(1.0f);
+	const glm::vec3 center = glm::vec3(0.0f);
 	std::vector<glm::ivec3> faces;
 
-	uint32_t estimatedFaces = 12 + pow(tessellation + 1, 3);
-
 	float t = (1.0f + sqrtf(5.0f)) / 2.0f;
 
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(-1, t, 0), radii, center));
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(1, t, 0), radii, center));
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(-1, -t, 0), radii, center));
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(1, -t, 0), radii, center));
-
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(0, -1, t), radii, center));
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(0, 1, t), radii, center));
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(0, -1, -t), radii, center));
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(0, 1, -t), radii, center));
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(-1, t, 0), radii, center));
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(1, t, 0), radii, center));
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(-1, -t, 0), radii, center));
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(1, -t, 0), radii, center));
 
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(t, 0, -1), radii, center));
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(t, 0, 1), radii, center));
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(-t, 0, -1), radii, center));
-	data._vertices.emplace_back(CalculateSphereVert(glm::vec3(-t, 0, 1), radii, center));
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(0, -1, t), radii, center));
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(0, 1, t), radii, center));
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(0, -1, -t), radii, center));
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(0, 1, -t), radii, center));
 
-	glm::ivec3 iOff = glm::ivec3(indexOffset);
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(t, 0, -1), radii, center));
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(t, 0, 1), radii, center));
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(-t, 0, -1), radii, center));
+	vertices.emplace_back(CalculateSphereVert(glm::vec3(-t, 0, 1), radii, center));
 
 	// 5 faces around point 0
-	faces.emplace_back(iOff + glm::ivec3(0, 11, 5));
-	faces.emplace_back(iOff + glm::ivec3(0, 5, 1));
-	faces.emplace_back(iOff + glm::ivec3(0, 1, 7));
-	faces.emplace_back(iOff + glm::ivec3(0, 7, 10));
-	faces.emplace_back(iOff + glm::ivec3(0, 10, 11));
+	faces.emplace_back(glm::ivec3(0, 11, 5));
+	faces.emplace_back(glm::ivec3(0, 5, 1));
+	faces.emplace_back(glm::ivec3(0, 1, 7));
+	faces.emplace_back(glm::ivec3(0, 7, 10));
+	faces.emplace_back(glm::ivec3(0, 10, 11));
 
 	// 5 adjacent faces
-	faces.emplace_back(iOff + glm::ivec3(1, 5, 9));
-	faces.emplace_back(iOff + glm::ivec3(5, 11, 4));
-	faces.emplace_back(iOff + glm::ivec3(11, 10, 2));
-	faces.emplace_back(iOff + glm::ivec3(10, 7, 6));
-	faces.emplace_back(iOff + glm::ivec3(7, 1, 8));
+	faces.emplace_back(glm::ivec3(1, 5, 9));
+	faces.emplace_back(glm::ivec3(5, 11, 4));
+	faces.emplace_back(glm::ivec3(11, 10, 2));
+	faces.emplace_back(glm::ivec3(10, 7, 6));
+	faces.emplace_back(glm::ivec3(7, 1, 8));
 
 	// 5 faces around point 3
-	faces.emplace_back(iOff + glm::ivec3(3, 9, 4));
-	faces.emplace_back(iOff + glm::ivec3(3, 4, 2));
-	faces.emplace_back(iOff + glm::ivec3(3, 2, 6));
-	faces.emplace_back(iOff + glm::ivec3(3, 6, 8));
-	faces.emplace_back(iOff + glm::ivec3(3, 8, 9));
+	faces.emplace_back(glm::ivec3(3, 9, 4));
+	faces.emplace_back(glm::ivec3(3, 4, 2));
+	faces.emplace_back(glm::ivec3(3, 2, 6));
+	faces.emplace_back(glm::ivec3(3, 6, 8));
+	faces.emplace_back(glm::ivec3(3, 8, 9));
 
 	// 5 adjacent faces
-	faces.emplace_back(iOff + glm::ivec3(4, 9, 5));
-	faces.emplace_back(iOff + glm::ivec3(2, 4, 11));
-	faces.emplace_back(iOff + glm::ivec3(6, 2, 10));
-	faces.emplace_back(iOff + glm::ivec3(8, 6, 7));
-	faces.emplace_back(iOff + glm::ivec3(9, 8, 1));
+	faces.emplace_back(glm::ivec3(4, 9, 5));
+	faces.emplace_back(glm::ivec3(2, 4, 11));
+	faces.emplace_back(glm::ivec3(6, 2, 10));
+	faces.emplace_back(glm::ivec3(8, 6, 7));
+	faces.emplace_back(glm::ivec3(9, 8, 1));
 
 	// Cache used to index our midpoints
 	std::unordered_map<uint64_t, uint32_t> midPointCache;
@@ -156,51 +147,37 @@ void MeshFactory::AddIcoSphere(MeshBuilder<VertexPosNormTexCol>& data, const glm
 	for (int ix = 0; ix < tessellation; ix++)
 	{
 		std::vector<glm::ivec3> tempFaces;
-		for (auto& indices : faces)
+		tempFaces.reserve(faces.size() * 4);
+		for (auto& face : faces)
 		{
-			uint32_t a = AddMiddlePoint(indexOffset, radii, center, indices[0], indices[1], data._vertices, midPointCache);
-			uint32_t b = AddMiddlePoint(indexOffset, radii, center, indices[1], indices[2], data._vertices, midPointCache);
-			uint32_t c = AddMiddlePoint(indexOffset, radii, center, indices[2], indices[0], data._vertices, midPointCache);
+			uint32_t a = AddMiddlePoint(0, radii, center, face[0], face[1], vertices, midPointCache);
+			uint32_t b = AddMiddlePoint(0, radii, center, face[1], face[2], vertices, midPointCache);
+			uint32_t c = AddMiddlePoint(0, radii, center, face[2], face[0], vertices, midPointCache);
 
-			tempFaces.emplace_back(glm::ivec3(indices[0], a, c));
-			tempFaces.emplace_back(glm::ivec3(indices[1], b, a));
-			tempFaces.emplace_back(glm::ivec3(indices[2], c, b));
+			tempFaces.emplace_back(glm::ivec3(face[0], a, c));
+			tempFaces.emplace_back(glm::ivec3(face[1], b, a));
+			tempFaces.emplace_back(glm::ivec3(face[2], c, b));
 			tempFaces.emplace_back(glm::ivec3(a, b, c));
 		}
-		faces = tempFaces;
+		faces = std::move(tempFaces);
 	}
 
+	indices.reserve(faces.size() * 3);
 	for (auto& face : faces) {
-		data._indices.push_back(face[0]);
-		data._indices.push_back(face[1]);
-		data._indices.push_back(face[2]);
+		indices.push_back(face[0]);
+		indices.push_back(face[1]);
+		indices.push_back(face[2]);
 	}
 
-	// Apply color to all verts we added
-	for (int ix = indexOffset; ix < data._vertices.size(); ix++) {
-		data._vertices[ix].Color = col;
-	}
-
-	CorrectUVSeams(data._vertices, data._indices, initialIndex);
-
-}
-
-void MeshFactory::AddUvSphere(MeshBuilder<VertexPosNormTexCol>& data, const glm::vec3& center, float radius, int tessellation, const glm::vec4& col) {
-	AddUvSphere(data, center, glm::vec3(radius), tessellation, col);
+	CorrectUVSeams(vertices, indices, 0);
 }
 
-void MeshFactory::AddUvSphere(MeshBuilder<VertexPosNormTexCol>& data, const glm::vec3& center, const glm::vec3& radii, int tessellation, const glm::vec4& col) {
-	LOG_ASSERT(tessellation >= 0, "Tessellation must be greater than zero!");
+// Generates a sphere with a radius of 1 out of rings of latitude and longitude, with 2^(tessellation + 1) + 1 slices
+static void BuildUvSphere(std::vector<Vertex>& verts, std::vector<uint32_t>& indices, int tessellation) {
 	int slices = 1 + pow(2, tessellation + 1);
 	int stacks = (slices / 2) + 1;
 
-
-	int numverts = (slices + 1) * (slices - 1) + 2;
-	std::vector<Vertex>& verts = data._vertices;
-
-	uint32_t offset = verts.size();
-	uint32_t initialIndex = data._indices.size();
-	verts.reserve(verts.size() + numverts);
+	verts.reserve((stacks + 1) * (slices + 1));
 
 	float stackAngle, sliceAngle;
 	float x, y, z, xy;
@@ -223,23 +200,17 @@ void MeshFactory::AddUvSphere(MeshBuilder<VertexPosNormTexCol>& data, const glm:
 			vert.Normal.x = x;
 			vert.Normal.y = y;
 			vert.Normal.z = z;
-			vert.Position = center + (vert.Normal * radii);
+			vert.Position = vert.Normal;
 			float u = (float)j / slices;
 			float v = 1.0f - (float)i / stacks;
 			vert.UV = { u, v };
 			verts.push_back(vert);
 		}
 	}
-	verts[offset].UV = { 0.5f, 1.0f };
+	verts[0].UV = { 0.5f, 1.0f };
 	verts[verts.size() - 1].UV = { 0.5f, 0.0f };
 
-	// Apply color to all verts we added
-	for(int ix = offset; ix < verts.size(); ix++) {
-		verts[ix].Color = col;
-	}
-	
-	int numIndices = (slices - 1) * slices * 6;
-	data._indices.reserve(data._indices.size() + numIndices);
+	indices.reserve((slices - 1) * slices * 6);
 
 	// Body loop
 	int k1, k2;
@@ -251,48 +222,218 @@ void MeshFactory::AddUvSphere(MeshBuilder<VertexPosNormTexCol>& data, const glm:
 		{
 			// Our top loop
 			if (i != 0) {
-				data._indices.push_back(offset + k1);
-				data._indices.push_back(offset + k2);
-				data._indices.push_back(offset + k1 + 1);
+				indices.push_back(k1);
+				indices.push_back(k2);
+				indices.push_back(k1 + 1);
 			}
 
 			// Everything but our bottom loop
 			if (i != (stacks - 1)) {
-				data._indices.push_back(offset + k1 + 1);
-				data._indices.push_back(offset + k2);
-				data._indices.push_back(offset + k2 + 1);
+				indices.push_back(k1 + 1);
+				indices.push_back(k2);
+				indices.push_back(k2 + 1);
 			}
 		}
 	}
 }
 
-void MeshFactory::AddPlane(MeshBuilder<VertexPosNormTexCol>& mesh, const glm::vec3& pos, const glm::vec3& normal,
-	const glm::vec3& tangent, const glm::vec2& scale, const glm::vec4& col)
-{
-	glm::vec3 nNorm = glm::normalize(normal);
-	glm::vec3 nTangent = glm::normalize(tangent);
-	glm::vec3 binormal = glm::cross(nNorm, nTangent);
-	glm::vec2 hScale = scale / 2.0f;
-	glm::vec3 positions[4];
-	positions[0] = pos - (nTangent * hScale.x) - (binormal * hScale.y);
-	positions[1] = pos - (nTangent * hScale.x) + (binormal * hScale.y);
-	positions[2] = pos + (nTangent * hScale.x) + (binormal * hScale.y);
-	positions[3] = pos + (nTangent * hScale.x) - (binormal * hScale.y);
-
-	glm::vec2 uvs[] = {
-		glm::vec2(0.0f, 0.0f), // 0
-		glm::vec2(0.0f, 1.0f), // 1
-		glm::vec2(1.0f, 1.0f), // 2
-		glm::vec2(1.0f, 0.0f), // 3
+// Generates a 1x1x1 cube with 4 vertices per face, so each face gets flat normals and it's own UVs
+static void BuildCube(std::vector<Vertex>& verts, std::vector<uint32_t>& indices) {
+	const glm::vec3 positions[] = {
+		glm::vec3(-0.5f, -0.5f, -0.5f),
+		glm::vec3(0.5f, -0.5f, -0.5f),
+		glm::vec3(-0.5f,  0.5f, -0.5f),
+		glm::vec3(0.5f,  0.5f, -0.5f),
+
+		glm::vec3(-0.5f, -0.5f,  0.5f),
+		glm::vec3(0.5f, -0.5f,  0.5f),
+		glm::vec3(-0.5f,  0.5f,  0.5f),
+		glm::vec3(0.5f,  0.5f,  0.5f),
 	};
 
-	const uint32_t p1 = mesh.AddVertex(positions[0], nNorm, uvs[0], col);
-	const uint32_t p2 = mesh.AddVertex(positions[1], nNorm, uvs[1], col);
-	const uint32_t p3 = mesh.AddVertex(positions[2], nNorm, uvs[2], col);
-	const uint32_t p4 = mesh.AddVertex(positions[3], nNorm, uvs[3], col);
+	const glm::vec3 normals[] = {
+		glm::vec3(-1.0f,  0.0f,  0.0f), //0
+		glm::vec3(1.0f,  0.0f,  0.0f),
+		glm::vec3(0.0f, -1.0f,  0.0f), //2
+		glm::vec3(0.0f,  1.0f,  0.0f),
+		glm::vec3(0.0f,  0.0f, -1.0f), //4
+		glm::vec3(0.0f,  0.0f,  1.0f),
+	};
 
-	mesh.AddIndexTri(p1, p3, p2);
-	mesh.AddIndexTri(p1, p4, p3);
+	const glm::vec2 uvs[] = {
+		glm::vec2(1.0f, 0.0f), // 0
+		glm::vec2(1.0f, 1.0f), // 1
+		glm::vec2(0.0f, 1.0f), // 2
+		glm::vec2(0.0f, 0.0f), // 3
+	};
+
+	// The position, normal and UV of each corner of each face, in the order that the faces get wound
+	const int corners[24][3] = {
+		// Bottom
+		{ 0, 4, 3 }, { 2, 4, 2 }, { 3, 4, 1 }, { 1, 4, 0 },
+		// Top
+		{ 6, 5, 0 }, { 4, 5, 1 }, { 5, 5, 2 }, { 7, 5, 3 },
+		// Left
+		{ 0, 0, 0 }, { 4, 0, 1 }, { 6, 0, 2 }, { 2, 0, 3 },
+		// Right
+		{ 3, 1, 0 }, { 7, 1, 1 }, { 5, 1, 2 }, { 1, 1, 3 },
+		// Front
+		{ 2, 3, 0 }, { 6, 3, 1 }, { 7, 3, 2 }, { 3, 3, 3 },
+		// Back
+		{ 1, 2, 0 }, { 5, 2, 1 }, { 4, 2, 2 }, { 0, 2, 3 },
+	};
+	verts.reserve(24);
+	for (const auto& corner : corners) {
+		verts.emplace_back(positions[corner[0]], normals[corner[1]], uvs[corner[2]], glm::vec4(1.0f));
+	}
+
+	indices.reserve(36);
+	for (uint32_t ix = 0; ix < 6; ix++) {
+		const uint32_t o = ix * 4;
+		indices.insert(indices.end(), { o + 0, o + 1, o + 2, o + 0, o + 2, o + 3 });
+	}
+}
+
+// Generates a 1x1 plane on the XY plane facing +Z, with the tangent along X
+static void BuildPlane(std::vector<Vertex>& verts, std::vector<uint32_t>& indices) {
+	const glm::vec3 normal = glm::vec3(0.0f, 0.0f, 1.0f);
+	verts.emplace_back(glm::vec3(-0.5f, -0.5f, 0.0f), normal, glm::vec2(0.0f, 0.0f), glm::vec4(1.0f));
+	verts.emplace_back(glm::vec3(-0.5f,  0.5f, 0.0f), normal, glm::vec2(0.0f, 1.0f), glm::vec4(1.0f));
+	verts.emplace_back(glm::vec3( 0.5f,  0.5f, 0.0f), normal, glm::vec2(1.0f, 1.0f), glm::vec4(1.0f));
+	verts.emplace_back(glm::vec3( 0.5f, -0.5f, 0.0f), normal, glm::vec2(1.0f, 0.0f), glm::vec4(1.0f));
+	indices.insert(indices.end(), { 0, 2, 1, 0, 3, 2 });
+}
+
+// Copies a unit mesh's vertices into place. The matrix columns are pulled out and the loop has no branches, so the
+// compiler can vectorize it. Sphere normals stay as they are, which matches how the spheres were always generated,
+// everything else gets it's normals rotated along with it
+static void TransformVertices(const Vertex* src, Vertex* dst, size_t count, const glm::mat4& transform, bool transformNormals, const glm::vec4& col) {
+	const glm::vec3 c0 = transform[0], c1 = transform[1], c2 = transform[2], c3 = transform[3];
+	if (transformNormals) {
+		for (size_t ix = 0; ix < count; ix++) {
+			const glm::vec3& p = src[ix].Position;
+			const glm::vec3& n = src[ix].Normal;
+			dst[ix].Position = c0 * p.x + c1 * p.y + c2 * p.z + c3;
+			dst[ix].Normal = c0 * n.x + c1 * n.y + c2 * n.z;
+			dst[ix].UV = src[ix].UV;
+			dst[ix].Color = col;
+		}
+	} else {
+		for (size_t ix = 0; ix < count; ix++) {
+			const glm::vec3& p = src[ix].Position;
+			dst[ix].Position = c0 * p.x + c1 * p.y + c2 * p.z + c3;
+			dst[ix].Normal = src[ix].Normal;
+			dst[ix].UV = src[ix].UV;
+			dst[ix].Color = col;
+		}
+	}
+}
+
+Primitive Primitive::Cube(const glm::vec3& pos, const glm::vec3& scale, const glm::vec3& eulerDeg, const glm::vec4& col) {
+	const glm::mat4 identity = glm::mat4(1.0f);
+	const glm::mat4 transform = glm::translate(identity, pos) * glm::mat4(glm::quat(glm::radians(eulerDeg))) * glm::scale(identity, scale);
+	return Primitive(PrimitiveType::Cube, transform, col);
+}
+
+Primitive Primitive::Sphere(PrimitiveType type, const glm::vec3& center, const glm::vec3& radii, int tessellation, const glm::vec4& col) {
+	LOG_ASSERT(type == PrimitiveType::IcoSphere || type == PrimitiveType::UvSphere, "Sphere primitives must be an ico or uv sphere!");
+	const glm::mat4 identity = glm::mat4(1.0f);
+	return Primitive(type, glm::translate(identity, center) * glm::scale(identity, radii), col, tessellation);
+}
+
+Primitive Primitive::Plane(const glm::vec3& pos, const glm::vec3& normal, const glm::vec3& tangent, const glm::vec2& scale, const glm::vec4& col) {
+	const glm::vec3 nNorm = glm::normalize(normal);
+	const glm::vec3 nTangent = glm::normalize(tangent);
+	const glm::vec3 binormal = glm::cross(nNorm, nTangent);
+	// The unit plane's X and Y get stretched along the tangent and binormal, and it's Z (the normal) is left unit length
+	const glm::mat4 transform = glm::mat4(
+		glm::vec4(nTangent * scale.x, 0.0f),
+		glm::vec4(binormal * scale.y, 0.0f),
+		glm::vec4(nNorm, 0.0f),
+		glm::vec4(pos, 1.0f));
+	return Primitive(PrimitiveType::Plane, transform, col);
+}
+
+std::unordered_map<uint64_t, MeshFactory::UnitMesh> MeshFactory::_unitMeshes;
+std::mutex                                          MeshFactory::_unitMeshMutex;
+
+const MeshFactory::UnitMesh& MeshFactory::_GetUnitMesh(PrimitiveType type, int tessellation) {
+	LOG_ASSERT(tessellation >= 0, "Tessellation must be greater than zero!");
+	// Only the spheres can be tessellated
+	if (type == PrimitiveType::Cube || type == PrimitiveType::Plane) {
+		tessellation = 0;
+	}
+	const uint64_t key = (static_cast<uint64_t>(type) << 32) | static_cast<uint32_t>(tessellation);
+
+	// References into an unordered_map stay valid as it grows, so the lock only needs to cover the lookup
+	std::lock_guard<std::mutex> lock(_unitMeshMutex);
+	auto it = _unitMeshes.find(key);
+	if (it != _unitMeshes.end()) {
+		return it->second;
+	}
+	UnitMesh& result = _unitMeshes[key];
+	switch (type) {
+		case PrimitiveType::Cube:      BuildCube(result.Vertices, result.Indices); break;
+		case PrimitiveType::IcoSphere: BuildIcoSphere(result.Vertices, result.Indices, tessellation); break;
+		case PrimitiveType::UvSphere:  BuildUvSphere(result.Vertices, result.Indices, tessellation); break;
+		case PrimitiveType::Plane:     BuildPlane(result.Vertices, result.Indices); break;
+	}
+	return result;
+}
+
+void MeshFactory::AddPrimitive(MeshBuilder<VertexPosNormTexCol>& mesh, const Primitive& primitive) {
+	const UnitMesh& unit = _GetUnitMesh(primitive.Type, primitive.Tessellation);
+	const size_t baseVertex = mesh._vertices.size();
+	const size_t baseIndex = mesh._indices.size();
+	mesh._vertices.resize(baseVertex + unit.Vertices.size());
+	mesh._indices.resize(baseIndex + unit.Indices.size());
+
+	const bool isSphere = primitive.Type == PrimitiveType::IcoSphere || primitive.Type == PrimitiveType::UvSphere;
+	TransformVertices(unit.Vertices.data(), mesh._vertices.data() + baseVertex, unit.Vertices.size(), primitive.Transform, !isSphere, primitive.Color);
+
+	const uint32_t offset = static_cast<uint32_t>(baseVertex);
+	uint32_t* indices = mesh._indices.data() + baseIndex;
+	for (size_t ix = 0; ix < unit.Indices.size(); ix++) {
+		indices[ix] = unit.Indices[ix] + offset;
+	}
+}
+
+void MeshFactory::AddPrimitives(MeshBuilder<VertexPosNormTexCol>& mesh, const std::vector<Primitive>& primitives) {
+	// Work out how big everything is first, so the mesh only needs to grow once
+	size_t vertexCount = 0, indexCount = 0;
+	for (const Primitive& primitive : primitives) {
+		const UnitMesh& unit = _GetUnitMesh(primitive.Type, primitive.Tessellation);
+		vertexCount += unit.Vertices.size();
+		indexCount += unit.Indices.size();
+	}
+	mesh.ReserveVertexSpace(vertexCount);
+	mesh.ReserveIndexSpace(indexCount);
+
+	for (const Primitive& primitive : primitives) {
+		AddPrimitive(mesh, primitive);
+	}
+}
+
+void MeshFactory::AddIcoSphere(MeshBuilder<VertexPosNormTexCol>& data, const glm::vec3& center, float radius, int tessellation, const glm::vec4& col) {
+	AddIcoSphere(data, center, glm::vec3(radius), tessellation, col);
+}
+
+void MeshFactory::AddIcoSphere(MeshBuilder<VertexPosNormTexCol>& data, const glm::vec3& center, const glm::vec3& radii, int tessellation, const glm::vec4& col) {
+	AddPrimitive(data, Primitive::Sphere(PrimitiveType::IcoSphere, center, radii, tessellation, col));
+}
+
+void MeshFactory::AddUvSphere(MeshBuilder<VertexPosNormTexCol>& data, const glm::vec3& center, float radius, int tessellation, const glm::vec4& col) {
+	AddUvSphere(data, center, glm::vec3(radius), tessellation, col);
+}
+
+void MeshFactory::AddUvSphere(MeshBuilder<VertexPosNormTexCol>& data, const glm::vec3& center, const glm::vec3& radii, int tessellation, const glm::vec4& col) {
+	AddPrimitive(data, Primitive::Sphere(PrimitiveType::UvSphere, center, radii, tessellation, col));
+}
+
+void MeshFactory::AddPlane(MeshBuilder<VertexPosNormTexCol>& mesh, const glm::vec3& pos, const glm::vec3& normal,
+	const glm::vec3& tangent, const glm::vec2& scale, const glm::vec4& col)
+{
+	AddPrimitive(mesh, Primitive::Plane(pos, normal, tangent, scale, col));
 }
 
 void MeshFactory::InvertFaces(MeshBuilder<VertexPosNormTexCol>& mesh)
@@ -315,94 +456,9 @@ void MeshFactory::InvertFaces(MeshBuilder<VertexPosNormTexCol>& mesh)
 
 void MeshFactory::AddCube(MeshBuilder<VertexPosNormTexCol>& mesh, const glm::vec3& pos, const glm::vec3& scale,
 	const glm::vec3& eulerDeg, const glm::vec4& col) {
-	const glm::mat4 transform = glm::translate(MAT4_IDENTITY, pos) * glm::mat4(glm::quat(glm::radians(eulerDeg))) * glm::scale(MAT4_IDENTITY, scale);
-	AddCube(mesh, transform, col);
+	AddPrimitive(mesh, Primitive::Cube(pos, scale, eulerDeg, col));
 }
 
 void MeshFactory::AddCube(MeshBuilder<VertexPosNormTexCol>& mesh, const glm::mat4& transform, const glm::vec4& col) {
-	glm::vec3 positions[] = {
-		glm::vec3(-0.5f, -0.5f, -0.5f),
-		glm::vec3(0.5f, -0.5f, -0.5f),
-		glm::vec3(-0.5f,  0.5f, -0.5f),
-		glm::vec3(0.5f,  0.5f, -0.5f),
-
-		glm::vec3(-0.5f, -0.5f,  0.5f),
-		glm::vec3(0.5f, -0.5f,  0.5f),
-		glm::vec3(-0.5f,  0.5f,  0.5f),
-		glm::vec3(0.5f,  0.5f,  0.5f),
-	};
-	for (auto& position : positions) {
-		position = transform * glm::vec4(position, 1.0f);
-	}
-
-	glm::vec3 normals[] = {
-		glm::vec3(-1.0f,  0.0f,  0.0f), //0
-		glm::vec3(1.0f,  0.0f,  0.0f),
-		glm::vec3(0.0f, -1.0f,  0.0f), //2
-		glm::vec3(0.0f,  1.0f,  0.0f),
-		glm::vec3(0.0f,  0.0f, -1.0f), //4
-		glm::vec3(0.0f,  0.0f,  1.0f),
-	};
-	glm::mat3 rotation = transform; // Truncate the transform to just the rotation component for normals
-	for (auto& normal : normals) {
-		normal = rotation * normal;
-	}
-
-	glm::vec2 uvs[] = {
-		glm::vec2(1.0f, 0.0f), // 0
-		glm::vec2(1.0f, 1.0f), // 1
-		glm::vec2(0.0f, 1.0f), // 2
-		glm::vec2(0.0f, 0.0f), // 3
-	};
-
-	uint32_t indices[36];
-
-	#pragma region AddVerts
-
-	mesh.ReserveVertexSpace(24);
-
-	// Bottom
-	indices[0] = mesh.AddVertex(positions[0], normals[4], uvs[3], col);
-	indices[1] = mesh.AddVertex(positions[2], normals[4], uvs[2], col);
-	indices[2] = mesh.AddVertex(positions[3], normals[4], uvs[1], col);
-	indices[3] = mesh.AddVertex(positions[1], normals[4], uvs[0], col);
-	// Top
-	indices[4] = mesh.AddVertex(positions[6], normals[5], uvs[0], col);
-	indices[5] = mesh.AddVertex(positions[4], normals[5], uvs[1], col);
-	indices[6] = mesh.AddVertex(positions[5], normals[5], uvs[2], col);
-	indices[7] = mesh.AddVertex(positions[7], normals[5], uvs[3], col);
-
-	// Left
-	indices[8]  = mesh.AddVertex(positions[0], normals[0], uvs[0], col);
-	indices[9]  = mesh.AddVertex(positions[4], normals[0], uvs[1], col);
-	indices[10] = mesh.AddVertex(positions[6], normals[0], uvs[2], col);
-	indices[11] = mesh.AddVertex(positions[2], normals[0], uvs[3], col);
-	// Right
-	indices[12] = mesh.AddVertex(positions[3], normals[1], uvs[0], col);
-	indices[13] = mesh.AddVertex(positions[7], normals[1], uvs[1], col);
-	indices[14] = mesh.AddVertex(positions[5], normals[1], uvs[2], col);
-	indices[15] = mesh.AddVertex(positions[1], normals[1], uvs[3], col);
-
-	// Front
-	indices[16] = mesh.AddVertex(positions[2], normals[3], uvs[0], col);
-	indices[17] = mesh.AddVertex(positions[6], normals[3], uvs[1], col);
-	indices[18] = mesh.AddVertex(positions[7], normals[3], uvs[2], col);
-	indices[19] = mesh.AddVertex(positions[3], normals[3], uvs[3], col);
-	// Back
-	indices[20] = mesh.AddVertex(positions[1], normals[2], uvs[0], col);
-	indices[21] = mesh.AddVertex(positions[5], normals[2], uvs[1], col);
-	indices[22] = mesh.AddVertex(positions[4], normals[2], uvs[2], col);
-	indices[23] = mesh.AddVertex(positions[0], normals[2], uvs[3], col);
-
-	#pragma endregion
-
-	#pragma region Make Triangles
-
-	for (int ix = 0; ix < 6; ix++) {
-		size_t o = ix * 4;
-		mesh.AddIndexTri(indices[o + 0], indices[o + 1], indices[o + 2]);
-		mesh.AddIndexTri(indices[o + 0], indices[o + 2], indices[o + 3]);
-	}
-
-	#pragma endregion
+	AddPrimitive(mesh, Primitive(PrimitiveType::Cube, transform, col));
 }
@@ -1,10 +1,41 @@
 #pragma once
 #include <GLM/glm.hpp>
 #include <GLM/gtc/matrix_transform.hpp>
+#include <mutex>
+#include <unordered_map>
 #include "Graphics/VertexArrayObject.h"
 #include "MeshBuilder.h"
 #include "VertexTypes.h"
 
+/// <summary>
+/// The kinds of shapes that MeshFactory can add to a mesh
+/// </summary>
+enum class PrimitiveType : uint8_t {
+	Cube,
+	IcoSphere,
+	UvSphere,
+	Plane
+};
+
+/// <summary>
+/// A shape to add to a mesh with MeshFactory::AddPrimitives, as a transform applied to a unit sized version of it
+/// (a 1x1x1 cube, a sphere with a radius of 1, or a 1x1 plane facing +Z)
+/// </summary>
+struct Primitive {
+	PrimitiveType Type;
+	// The number of subdivisions, only used by the spheres
+	int           Tessellation;
+	glm::mat4     Transform;
+	glm::vec4     Color;
+
+	Primitive(PrimitiveType type, const glm::mat4& transform, const glm::vec4& col = glm::vec4(1.0f), int tessellation = 0) :
+		Type(type), Tessellation(tessellation), Transform(transform), Color(col) {}
+
+	static Primitive Cube(const glm::vec3& pos, const glm::vec3& scale, const glm::vec3& eulerDeg = glm::vec3(0.0f), const glm::vec4& col = glm::vec4(1.0f));
+	static Primitive Sphere(PrimitiveType type, const glm::vec3& center, const glm::vec3& radii, int tessellation = 0, const glm::vec4& col = glm::vec4(1.0f));
+	static Primitive Plane(const glm::vec3& pos, const glm::vec3& normal, const glm::vec3& tangent, const glm::vec2& scale, const glm::vec4& col = glm::vec4(1.0f));
+};
+
 class MeshFactory
 {
 public:
@@ -19,11 +50,38 @@ public:
 
 	static void AddPlane(MeshBuilder<VertexPosNormTexCol>& mesh, const glm::vec3& pos, const glm::vec3& normal, const glm::vec3& tangent, const glm::vec2& scale, const glm::vec4& col = glm::vec4(1.0f));
 
+	/// <summary>
+	/// Adds a single shape to the mesh, see AddPrimitives
+	/// </summary>
+	static void AddPrimitive(MeshBuilder<VertexPosNormTexCol>& mesh, const Primitive& primitive);
+	/// <summary>
+	/// Adds a batch of shapes to the mesh, reserving space for all of them up front. Each shape is copied from a
+	/// unit sized version that only gets generated the first time it's type and tessellation are asked for, so
+	/// building thousands of spheres costs about the same as copying their vertices
+	/// </summary>
+	/// <param name="mesh">The mesh to add the shapes to</param>
+	/// <param name="primitives">The shapes to add</param>
+	static void AddPrimitives(MeshBuilder<VertexPosNormTexCol>& mesh, const std::vector<Primitive>& primitives);
+
 	static void InvertFaces(MeshBuilder<VertexPosNormTexCol>& mesh);
 	
 protected:	
 	MeshFactory() = default;
 	~MeshFactory() = default;
 
+	// The vertices and indices of a shape at unit size, centered on the origin
+	struct UnitMesh {
+		std::vector<VertexPosNormTexCol> Vertices;
+		std::vector<uint32_t>            Indices;
+	};
+	/// <summary>
+	/// Gets the unit sized version of a shape, generating it the first time it's asked for. This is safe to call from
+	/// multiple threads, and the result stays valid for the rest of the app
+	/// </summary>
+	static const UnitMesh& _GetUnitMesh(PrimitiveType type, int tessellation);
+
+	static std::unordered_map<uint64_t, UnitMesh> _unitMeshes;
+	static std::mutex                             _unitMeshMutex;
+
 	inline static const glm::mat4 MAT4_IDENTITY = glm::mat4(1.0f);
 };
\ No newline at end of file
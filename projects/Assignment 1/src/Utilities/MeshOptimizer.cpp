@@ -0,0 +1,795 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "FlatHashMap.h"
+
+// The LRU cache that Forsyth's scoring is tuned for, it's larger than the FIFO we measure with on purpose so the
+// order holds up on GPUs with bigger caches
+static const uint32_t FORSYTH_CACHE_SIZE   = 32;
+// Vertices with more triangles left than this all score the same
+static const uint32_t FORSYTH_MAX_VALENCE  = 32;
+static const float    FORSYTH_DECAY_POWER  = 1.5f;
+static const float    FORSYTH_LAST_TRI     = 0.75f;
+static const float    FORSYTH_VALENCE_SCALE = 2.0f;
+static const float    FORSYTH_VALENCE_POWER = 0.5f;
+
+static const uint32_t INVALID_INDEX = UINT32_MAX;
+
+// The score tables are the same for every mesh, so we only work them out once
+struct ForsythTables {
+	float Cache[FORSYTH_CACHE_SIZE];
+	float Valence[FORSYTH_MAX_VALENCE + 1];
+
+	ForsythTables() {
+		for (uint32_t ix = 0; ix < FORSYTH_CACHE_SIZE; ix++) {
+			// The last triangle's vertices get a fixed score, so we don't favour any one of them over the others
+			if (ix < 3) {
+				Cache[ix] = FORSYTH_LAST_TRI;
+			} else {
+				const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+				Cache[ix] = std::pow(1.0f - (ix - 3) * scaler, FORSYTH_DECAY_POWER);
+			}
+		}
+		Valence[0] = 0.0f;
+		for (uint32_t ix = 1; ix <= FORSYTH_MAX_VALENCE; ix++) {
+			// Vertices with only a few triangles left get a boost, so we finish them off instead of leaving stragglers
+			Valence[ix] = FORSYTH_VALENCE_SCALE * std::pow((float)ix, -FORSYTH_VALENCE_POWER);
+		}
+	}
+};
+
+static float GetVertexScore(const ForsythTables& tables, int cachePos, uint32_t remaining) {
+	// Vertices with no triangles left can't help us any more
+	if (remaining == 0) {
+		return -1.0f;
+	}
+	const float cacheScore = cachePos >= 0 ? tables.Cache[cachePos] : 0.0f;
+	return cacheScore + tables.Valence[std::min(remaining, FORSYTH_MAX_VALENCE)];
+}
+
+// Feeds a triangle through a simulated FIFO cache, returning how many of it's vertices missed. A vertex is in the
+// cache if fewer than cacheSize misses have happened since it was last loaded
+static uint32_t SimulateTriangle(const uint32_t* tri, std::vector<uint32_t>& cacheTime, uint32_t& timestamp, uint32_t cacheSize) {
+	uint32_t misses = 0;
+	for (int ix = 0; ix < 3; ix++) {
+		const uint32_t vertex = tri[ix];
+		if (timestamp - cacheTime[vertex] > cacheSize) {
+			cacheTime[vertex] = timestamp++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+	static const ForsythTables tables;
+	const size_t triCount = indexCount / 3;
+	if (triCount == 0) {
+		return;
+	}
+	const std::vector<uint32_t> source(indices, indices + triCount * 3);
+
+	// Build the list of triangles that use each vertex, packed into one array. The first remaining[v] entries in a
+	// vertex's range are the triangles that haven't been emitted yet
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : source) {
+		remaining[index]++;
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		offsets[ix + 1] = offsets[ix] + remaining[ix];
+	}
+	std::vector<uint32_t> adjacency(source.size());
+	{
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t ix = 0; ix < source.size(); ix++) {
+			adjacency[cursor[source[ix]]++] = static_cast<uint32_t>(ix / 3);
+		}
+	}
+
+	std::vector<int> cachePos(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		vertexScore[ix] = GetVertexScore(tables, -1, remaining[ix]);
+	}
+	std::vector<float> triScore(triCount);
+	std::vector<bool> emitted(triCount, false);
+	uint32_t best = 0;
+	for (size_t ix = 0; ix < triCount; ix++) {
+		const uint32_t* tri = &source[ix * 3];
+		triScore[ix] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+		if (triScore[ix] > triScore[best]) {
+			best = static_cast<uint32_t>(ix);
+		}
+	}
+
+	// Room for a full cache plus the 3 vertices pushed in front of it
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	uint32_t cacheCount = 0;
+	size_t scan = 0;
+	for (size_t output = 0; output < triCount; output++) {
+		// Nothing in the cache has triangles left, so start again from the next triangle we haven't used
+		if (best == INVALID_INDEX) {
+			while (emitted[scan]) {
+				scan++;
+			}
+			best = static_cast<uint32_t>(scan);
+		}
+
+		const uint32_t* tri = &source[best * 3];
+		memcpy(&indices[output * 3], tri, sizeof(uint32_t) * 3);
+		emitted[best] = true;
+
+		// Take the triangle out of it's vertices' lists
+		for (int ix = 0; ix < 3; ix++) {
+			const uint32_t vertex = tri[ix];
+			uint32_t* list = &adjacency[offsets[vertex]];
+			for (uint32_t jx = 0; jx < remaining[vertex]; jx++) {
+				if (list[jx] == best) {
+					list[jx] = list[remaining[vertex] - 1];
+					break;
+				}
+			}
+			remaining[vertex]--;
+		}
+
+		// Move the triangle's vertices to the front of the cache, pushing everything else back
+		uint32_t next[FORSYTH_CACHE_SIZE + 3] = { tri[0], tri[1], tri[2] };
+		uint32_t nextCount = 3;
+		for (uint32_t ix = 0; ix < cacheCount; ix++) {
+			const uint32_t vertex = cache[ix];
+			if (vertex != tri[0] && vertex != tri[1] && vertex != tri[2]) {
+				next[nextCount++] = vertex;
+			}
+		}
+
+		// Re-score everything that moved, including what just fell out of the cache, and pick the best triangle
+		// that's still waiting on one of them
+		for (uint32_t ix = 0; ix < nextCount; ix++) {
+			const uint32_t vertex = next[ix];
+			cachePos[vertex] = ix < FORSYTH_CACHE_SIZE ? static_cast<int>(ix) : -1;
+			vertexScore[vertex] = GetVertexScore(tables, cachePos[vertex], remaining[vertex]);
+		}
+		best = INVALID_INDEX;
+		float bestScore = -1.0f;
+		for (uint32_t ix = 0; ix < nextCount; ix++) {
+			const uint32_t vertex = next[ix];
+			const uint32_t* list = &adjacency[offsets[vertex]];
+			for (uint32_t jx = 0; jx < remaining[vertex]; jx++) {
+				const uint32_t candidate = list[jx];
+				const uint32_t* corners = &source[candidate * 3];
+				triScore[candidate] = vertexScore[corners[0]] + vertexScore[corners[1]] + vertexScore[corners[2]];
+				if (triScore[candidate] > bestScore) {
+					bestScore = triScore[candidate];
+					best = candidate;
+				}
+			}
+		}
+
+		cacheCount = std::min(nextCount, FORSYTH_CACHE_SIZE);
+		memcpy(cache, next, sizeof(uint32_t) * cacheCount);
+	}
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t vertexCount, float threshold) {
+	const size_t triCount = indexCount / 3;
+	if (triCount == 0) {
+		return;
+	}
+	const uint32_t cacheSize = DEFAULT_CACHE_SIZE;
+
+	// Hard boundaries are where the cache order starts over (all 3 vertices miss), moving the clusters between these
+	// around costs us nothing
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+	std::vector<size_t> hard;
+	for (size_t ix = 0; ix < triCount; ix++) {
+		if (SimulateTriangle(&indices[ix * 3], cacheTime, timestamp, cacheSize) == 3) {
+			hard.push_back(ix);
+		}
+	}
+	hard.push_back(triCount);
+
+	// Soft boundaries split the hard clusters up further, as long as flushing the cache at the split keeps the
+	// cluster's ACMR within the threshold of what it was. Smaller clusters give the sort more to work with
+	std::vector<size_t> clusters;
+	for (size_t cx = 0; cx + 1 < hard.size(); cx++) {
+		const size_t start = hard[cx], end = hard[cx + 1];
+
+		// Skipping the timestamp ahead by a whole cache flushes it
+		timestamp += cacheSize + 1;
+		uint32_t clusterMisses = 0;
+		for (size_t ix = start; ix < end; ix++) {
+			clusterMisses += SimulateTriangle(&indices[ix * 3], cacheTime, timestamp, cacheSize);
+		}
+		const float target = threshold * (float)clusterMisses / (float)(end - start);
+
+		timestamp += cacheSize + 1;
+		clusters.push_back(start);
+		uint32_t misses = 0;
+		size_t count = 0;
+		for (size_t ix = start; ix < end; ix++) {
+			misses += SimulateTriangle(&indices[ix * 3], cacheTime, timestamp, cacheSize);
+			count++;
+			if (ix + 1 < end && (float)misses / (float)count <= target) {
+				clusters.push_back(ix + 1);
+				timestamp += cacheSize + 1;
+				misses = 0;
+				count = 0;
+			}
+		}
+	}
+	clusters.push_back(triCount);
+
+	// Work out the area weighted center and facing of each cluster, and the center of the whole mesh
+	const size_t clusterCount = clusters.size() - 1;
+	std::vector<glm::vec3> centers(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCenter = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+	for (size_t cx = 0; cx < clusterCount; cx++) {
+		float clusterArea = 0.0f;
+		for (size_t ix = clusters[cx]; ix < clusters[cx + 1]; ix++) {
+			const glm::vec3& a = positions[indices[ix * 3 + 0]];
+			const glm::vec3& b = positions[indices[ix * 3 + 1]];
+			const glm::vec3& c = positions[indices[ix * 3 + 2]];
+			const glm::vec3 normal = glm::cross(b - a, c - a);
+			const float area = glm::length(normal);
+			centers[cx] += (a + b + c) * (area / 3.0f);
+			normals[cx] += normal;
+			clusterArea += area;
+		}
+		meshCenter += centers[cx];
+		meshArea += clusterArea;
+		centers[cx] = clusterArea > 0.0f ? centers[cx] / clusterArea : positions[indices[clusters[cx] * 3]];
+	}
+	meshCenter = meshArea > 0.0f ? meshCenter / meshArea : glm::vec3(0.0f);
+
+	// Clusters facing away from the center are the ones most likely to be in front, so they draw first and the
+	// depth test can throw out more of what's behind them
+	std::vector<float> keys(clusterCount);
+	for (size_t cx = 0; cx < clusterCount; cx++) {
+		const float length = glm::length(normals[cx]);
+		keys[cx] = length > 0.0f ? glm::dot(centers[cx] - meshCenter, normals[cx] / length) : 0.0f;
+	}
+	std::vector<uint32_t> order(clusterCount);
+	for (size_t cx = 0; cx < clusterCount; cx++) {
+		order[cx] = static_cast<uint32_t>(cx);
+	}
+	std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+	const std::vector<uint32_t> source(indices, indices + triCount * 3);
+	size_t output = 0;
+	for (uint32_t cx : order) {
+		const size_t count = (clusters[cx + 1] - clusters[cx]) * 3;
+		memcpy(&indices[output], &source[clusters[cx] * 3], sizeof(uint32_t) * count);
+		output += count;
+	}
+}
+
+uint32_t MeshOptimizer::OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap) {
+	remap.assign(vertexCount, INVALID_INDEX);
+	uint32_t next = 0;
+	for (size_t ix = 0; ix < indexCount; ix++) {
+		uint32_t& mapped = remap[indices[ix]];
+		if (mapped == INVALID_INDEX) {
+			mapped = next++;
+		}
+		indices[ix] = mapped;
+	}
+	return next;
+}
+
+// Reads the position of a vertex out of a strided array
+static glm::vec3 GetPosition(const float* positions, size_t stride, uint32_t index) {
+	const float* position = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + index * stride);
+	return glm::vec3(position[0], position[1], position[2]);
+}
+
+// Works out the bounding sphere and normal cone for the triangles of a finished cluster
+static void FinishMeshlet(Meshlet& meshlet, const uint32_t* indices, const float* positions, size_t stride) {
+	const uint32_t* tris = indices + meshlet.FirstIndex;
+	const uint32_t triCount = meshlet.IndexCount / 3;
+
+	// The sphere around the center of the box is a bit looser than the smallest one, but it's cheap and stable
+	glm::vec3 min = GetPosition(positions, stride, tris[0]);
+	glm::vec3 max = min;
+	for (uint32_t ix = 1; ix < meshlet.IndexCount; ix++) {
+		const glm::vec3 position = GetPosition(positions, stride, tris[ix]);
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+	}
+	meshlet.Center = (min + max) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t ix = 0; ix < meshlet.IndexCount; ix++) {
+		radius = std::max(radius, glm::length(GetPosition(positions, stride, tris[ix]) - meshlet.Center));
+	}
+	meshlet.Radius = radius;
+
+	// The cone axis is the average of the face normals, degenerate triangles don't face anywhere so they're skipped
+	glm::vec3 axis = glm::vec3(0.0f);
+	for (uint32_t ix = 0; ix < triCount; ix++) {
+		const glm::vec3 a = GetPosition(positions, stride, tris[ix * 3 + 0]);
+		const glm::vec3 b = GetPosition(positions, stride, tris[ix * 3 + 1]);
+		const glm::vec3 c = GetPosition(positions, stride, tris[ix * 3 + 2]);
+		const glm::vec3 normal = glm::cross(b - a, c - a);
+		const float length = glm::length(normal);
+		if (length > 0.0f) {
+			axis += normal / length;
+		}
+	}
+	meshlet.ConeApex = meshlet.Center;
+	meshlet.ConeAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.ConeCutoff = 2.0f;
+	const float axisLength = glm::length(axis);
+	if (axisLength <= 0.0f) {
+		return;
+	}
+	axis /= axisLength;
+
+	float minDot = 1.0f;
+	for (uint32_t ix = 0; ix < triCount; ix++) {
+		const glm::vec3 a = GetPosition(positions, stride, tris[ix * 3 + 0]);
+		const glm::vec3 normal = glm::cross(GetPosition(positions, stride, tris[ix * 3 + 1]) - a, GetPosition(positions, stride, tris[ix * 3 + 2]) - a);
+		const float length = glm::length(normal);
+		if (length > 0.0f) {
+			minDot = std::min(minDot, glm::dot(normal / length, axis));
+		}
+	}
+	// Once the normals spread past ~85 degrees from the axis the cone is so wide it would hardly ever cull anything
+	meshlet.ConeAxis = axis;
+	if (minDot <= 0.1f) {
+		return;
+	}
+
+	// The apex gets pushed back along the axis until every triangle's plane is in front of it, that way any camera
+	// inside the cone (as seen from the apex) is behind all of the triangles
+	float maxT = 0.0f;
+	for (uint32_t ix = 0; ix < triCount; ix++) {
+		const glm::vec3 a = GetPosition(positions, stride, tris[ix * 3 + 0]);
+		glm::vec3 normal = glm::cross(GetPosition(positions, stride, tris[ix * 3 + 1]) - a, GetPosition(positions, stride, tris[ix * 3 + 2]) - a);
+		const float length = glm::length(normal);
+		if (length > 0.0f) {
+			normal /= length;
+			maxT = std::max(maxT, glm::dot(meshlet.Center - a, normal) / glm::dot(axis, normal));
+		}
+	}
+	meshlet.ConeApex = meshlet.Center - axis * maxT;
+	meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+std::vector<Meshlet> MeshOptimizer::BuildMeshlets(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount,
+	size_t positionStride, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	std::vector<Meshlet> result;
+	const size_t triCount = indexCount / 3;
+	if (triCount == 0 || maxVertices < 3 || maxTriangles == 0) {
+		return result;
+	}
+	result.reserve(triCount / maxTriangles + 1);
+
+	// Stamps each vertex with the cluster that last used it, so we can count the unique vertices without clearing a set
+	std::vector<uint32_t> lastUsed(vertexCount, INVALID_INDEX);
+	Meshlet current;
+	memset(&current, 0, sizeof(Meshlet));
+	for (size_t ix = 0; ix < triCount; ix++) {
+		const uint32_t* tri = &indices[ix * 3];
+		uint32_t id = static_cast<uint32_t>(result.size());
+		// A triangle can use the same vertex more than once, it only counts the first time
+		const uint32_t added =
+			(lastUsed[tri[0]] != id ? 1 : 0) +
+			(lastUsed[tri[1]] != id && tri[1] != tri[0] ? 1 : 0) +
+			(lastUsed[tri[2]] != id && tri[2] != tri[0] && tri[2] != tri[1] ? 1 : 0);
+
+		// Close off the cluster once the next triangle wouldn't fit, this triangle then starts a new one
+		if (current.IndexCount > 0 && (current.VertexCount + added > maxVertices || current.IndexCount / 3 >= maxTriangles)) {
+			FinishMeshlet(current, indices, positions, positionStride);
+			result.push_back(current);
+			memset(&current, 0, sizeof(Meshlet));
+			current.FirstIndex = static_cast<uint32_t>(ix * 3);
+			id++;
+		}
+		for (int corner = 0; corner < 3; corner++) {
+			if (lastUsed[tri[corner]] != id) {
+				lastUsed[tri[corner]] = id;
+				current.VertexCount++;
+			}
+		}
+		current.IndexCount += 3;
+	}
+	FinishMeshlet(current, indices, positions, positionStride);
+	result.push_back(current);
+	return result;
+}
+
+// A symmetric 4x4 matrix that measures the sum of squared distances to a set of planes, along with the total weight
+// of the planes so the error can be averaged
+struct Quadric {
+	float A00, A11, A22, A01, A02, A12;
+	float B0, B1, B2;
+	float C;
+	float Weight;
+
+	Quadric() : A00(0), A11(0), A22(0), A01(0), A02(0), A12(0), B0(0), B1(0), B2(0), C(0), Weight(0) { }
+	// The quadric for the plane dot(normal, p) + distance = 0, the normal must be unit length
+	Quadric(const glm::vec3& normal, float distance, float weight) :
+		A00(normal.x * normal.x * weight), A11(normal.y * normal.y * weight), A22(normal.z * normal.z * weight),
+		A01(normal.x * normal.y * weight), A02(normal.x * normal.z * weight), A12(normal.y * normal.z * weight),
+		B0(normal.x * distance * weight), B1(normal.y * distance * weight), B2(normal.z * distance * weight),
+		C(distance * distance * weight), Weight(weight) { }
+
+	Quadric& operator+=(const Quadric& other) {
+		A00 += other.A00; A11 += other.A11; A22 += other.A22;
+		A01 += other.A01; A02 += other.A02; A12 += other.A12;
+		B0 += other.B0; B1 += other.B1; B2 += other.B2;
+		C += other.C;
+		Weight += other.Weight;
+		return *this;
+	}
+
+	// The weighted sum of squared distances from the point to the planes
+	float Evaluate(const glm::vec3& p) const {
+		const float result =
+			A00 * p.x * p.x + A11 * p.y * p.y + A22 * p.z * p.z +
+			2.0f * (A01 * p.x * p.y + A02 * p.x * p.z + A12 * p.y * p.z) +
+			2.0f * (B0 * p.x + B1 * p.y + B2 * p.z) + C;
+		return std::max(result, 0.0f);
+	}
+};
+
+// How a position is allowed to move while simplifying
+enum class VertexKind : uint8_t {
+	// Inside of the surface, can collapse onto any neighbour
+	Manifold,
+	// On an open edge of the surface, can only collapse along that edge so the outline keeps it's shape
+	Border,
+	// Sits on an edge shared by more than two triangles, there's no telling which way is safe so it never moves
+	Locked
+};
+
+// Border edges are pulled back towards their original line much harder than faces are, since moving them is very
+// visible (they're the silhouette of things like leaf cards)
+static const float SIMPLIFY_BORDER_WEIGHT = 10.0f;
+// Collapses that turn a triangle further than this (as the cosine of the angle) are rejected, since they fold the surface
+static const float SIMPLIFY_MAX_FLIP      = 0.25f;
+
+static uint64_t GetEdgeKey(uint32_t a, uint32_t b) {
+	return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+// Checks whether two vertices have the same texture coordinates, meshes without texture coordinates always match
+static bool SameUV(const float* uvs, size_t stride, uint32_t a, uint32_t b) {
+	if (uvs == nullptr) {
+		return true;
+	}
+	const float* uvA = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(uvs) + a * stride);
+	const float* uvB = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(uvs) + b * stride);
+	return std::abs(uvA[0] - uvB[0]) <= 1e-5f && std::abs(uvA[1] - uvB[1]) <= 1e-5f;
+}
+
+// Lists the triangles that use each entry of a triangle list, as offsets into a flat array like a CSR matrix
+static void BuildTriangleAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& start, std::vector<uint32_t>& triangles) {
+	start.assign(vertexCount + 1, 0);
+	for (uint32_t index : indices) {
+		start[index + 1]++;
+	}
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		start[ix + 1] += start[ix];
+	}
+	triangles.resize(indices.size());
+	std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+	for (size_t ix = 0; ix < indices.size(); ix++) {
+		triangles[fill[indices[ix]]++] = static_cast<uint32_t>(ix / 3);
+	}
+}
+
+float MeshOptimizer::Simplify(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride,
+	size_t targetIndexCount, float targetError, std::vector<uint32_t>& result, const float* uvs, size_t uvStride)
+{
+	result.assign(indices, indices + (indexCount / 3) * 3);
+	if (result.size() <= targetIndexCount || vertexCount == 0) {
+		return 0.0f;
+	}
+
+	// Work in a unit sized copy of the positions, so the errors come out relative to the size of the mesh
+	std::vector<glm::vec3> points(vertexCount);
+	glm::vec3 min = GetPosition(positions, positionStride, 0);
+	glm::vec3 max = min;
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		points[ix] = GetPosition(positions, positionStride, static_cast<uint32_t>(ix));
+		min = glm::min(min, points[ix]);
+		max = glm::max(max, points[ix]);
+	}
+	const float extent = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+	if (extent <= 0.0f) {
+		return 0.0f;
+	}
+	for (glm::vec3& point : points) {
+		point = (point - min) / extent;
+	}
+
+	// Vertices that only differ in their other attributes (ex: either side of a UV seam) share a position. The topology
+	// is worked out on the positions so that seams don't look like holes, each position is represented by the first
+	// vertex that has it
+	std::vector<uint32_t> canonical(vertexCount);
+	{
+		struct PositionHash {
+			const std::vector<glm::vec3>* Points;
+			size_t operator()(uint32_t ix) const {
+				uint32_t bits[3];
+				memcpy(bits, &(*Points)[ix], sizeof(bits));
+				return static_cast<size_t>(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+			}
+		};
+		struct PositionEqual {
+			const std::vector<glm::vec3>* Points;
+			bool operator()(uint32_t a, uint32_t b) const { return (*Points)[a] == (*Points)[b]; }
+		};
+		FlatHashMap<uint32_t, uint32_t, PositionHash, PositionEqual> unique(PositionHash{ &points }, PositionEqual{ &points });
+		unique.Reserve(vertexCount);
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			canonical[ix] = *unique.TryEmplace(static_cast<uint32_t>(ix), static_cast<uint32_t>(ix)).first;
+		}
+	}
+
+	// Every position starts with the planes of the triangles around it, weighted by area so slivers don't dominate
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t ix = 0; ix < result.size(); ix += 3) {
+		const glm::vec3& a = points[result[ix]];
+		const glm::vec3 normal = glm::cross(points[result[ix + 1]] - a, points[result[ix + 2]] - a);
+		const float area = glm::length(normal);
+		if (area > 0.0f) {
+			const Quadric plane(normal / area, -glm::dot(normal / area, a), area * 0.5f);
+			for (int corner = 0; corner < 3; corner++) {
+				quadrics[canonical[result[ix + corner]]] += plane;
+			}
+		}
+	}
+
+	struct Collapse {
+		uint32_t From;
+		uint32_t To;
+		float    Error;
+	};
+	std::vector<uint32_t>   topology;
+	std::vector<VertexKind> kinds(vertexCount);
+	std::vector<Collapse>   collapses;
+	// Where each position and each vertex goes this pass
+	std::vector<uint32_t>   positionRemap(vertexCount);
+	std::vector<uint32_t>   vertexRemap(vertexCount);
+	std::vector<uint8_t>    collapsed(vertexCount);
+	// The triangles around each position and around each vertex, and the vertices that share each position
+	std::vector<uint32_t>   positionStart, positionTriangles;
+	std::vector<uint32_t>   vertexStart, vertexTriangles;
+	std::vector<uint32_t>   wedgeStart, wedges;
+	std::vector<std::pair<uint32_t, uint32_t>> moves;
+	FlatHashMap<uint64_t, uint32_t> edges;
+	bool addedBorders = false;
+	float resultError = 0.0f;
+	const float maxError = targetError * targetError;
+
+	while (result.size() > targetIndexCount) {
+		topology.resize(result.size());
+		for (size_t ix = 0; ix < result.size(); ix++) {
+			topology[ix] = canonical[result[ix]];
+		}
+
+		// Find the open edges of the surface as it is now, an edge is open if no triangle runs along it the other way
+		edges.Clear();
+		edges.Reserve(topology.size());
+		for (size_t ix = 0; ix < topology.size(); ix += 3) {
+			for (int corner = 0; corner < 3; corner++) {
+				const uint32_t a = topology[ix + corner], b = topology[ix + (corner + 1) % 3];
+				(*edges.TryEmplace(GetEdgeKey(a, b), 0).first)++;
+			}
+		}
+		std::fill(kinds.begin(), kinds.end(), VertexKind::Manifold);
+		for (size_t ix = 0; ix < topology.size(); ix += 3) {
+			for (int corner = 0; corner < 3; corner++) {
+				const uint32_t a = topology[ix + corner], b = topology[ix + (corner + 1) % 3];
+				const uint32_t* count = edges.Find(GetEdgeKey(a, b));
+				const uint32_t* reverse = edges.Find(GetEdgeKey(b, a));
+				if (*count > 1 || (reverse != nullptr && *reverse > 1)) {
+					kinds[a] = kinds[b] = VertexKind::Locked;
+				} else if (reverse == nullptr) {
+					for (uint32_t vertex : { a, b }) {
+						kinds[vertex] = kinds[vertex] == VertexKind::Locked ? VertexKind::Locked : VertexKind::Border;
+					}
+					// The first time through, border edges also get a plane at right angles to their triangle so
+					// collapses that pull the outline in are expensive
+					if (!addedBorders) {
+						const glm::vec3 edge = points[b] - points[a];
+						const glm::vec3 faceNormal = glm::cross(edge, points[topology[ix + (corner + 2) % 3]] - points[a]);
+						const glm::vec3 normal = glm::cross(edge, faceNormal);
+						const float length = glm::length(normal);
+						if (length > 0.0f) {
+							const Quadric plane(normal / length, -glm::dot(normal / length, points[a]), glm::dot(edge, edge) * SIMPLIFY_BORDER_WEIGHT);
+							quadrics[a] += plane;
+							quadrics[b] += plane;
+						}
+					}
+				}
+			}
+		}
+		addedBorders = true;
+
+		// Gather every edge that one of it's ends can collapse along, and what it would cost
+		collapses.clear();
+		for (size_t ix = 0; ix < topology.size(); ix += 3) {
+			for (int corner = 0; corner < 3; corner++) {
+				const uint32_t a = topology[ix + corner], b = topology[ix + (corner + 1) % 3];
+				const bool isBorderEdge = edges.Find(GetEdgeKey(b, a)) == nullptr;
+				for (int direction = 0; direction < 2; direction++) {
+					const uint32_t from = direction == 0 ? a : b;
+					const uint32_t to = direction == 0 ? b : a;
+					if (kinds[from] == VertexKind::Locked || (kinds[from] == VertexKind::Border && !isBorderEdge)) {
+						continue;
+					}
+					Quadric sum = quadrics[from];
+					sum += quadrics[to];
+					collapses.push_back({ from, to, sum.Evaluate(points[to]) / std::max(sum.Weight, 1e-12f) });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.Error < r.Error; });
+
+		BuildTriangleAdjacency(topology, vertexCount, positionStart, positionTriangles);
+		BuildTriangleAdjacency(result, vertexCount, vertexStart, vertexTriangles);
+		wedgeStart.assign(vertexCount + 1, 0);
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			wedgeStart[canonical[ix] + 1] += vertexStart[ix + 1] > vertexStart[ix] ? 1 : 0;
+		}
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			wedgeStart[ix + 1] += wedgeStart[ix];
+		}
+		wedges.resize(wedgeStart[vertexCount]);
+		{
+			std::vector<uint32_t> fill(wedgeStart.begin(), wedgeStart.end() - 1);
+			for (size_t ix = 0; ix < vertexCount; ix++) {
+				if (vertexStart[ix + 1] > vertexStart[ix]) {
+					wedges[fill[canonical[ix]]++] = static_cast<uint32_t>(ix);
+				}
+			}
+		}
+
+		// Each interior collapse removes two triangles, so this is roughly how many we can do before hitting the target.
+		// Positions only get touched once per pass, so the triangles around them are still as we listed them
+		const size_t budget = (result.size() - targetIndexCount) / 3;
+		size_t removed = 0;
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			positionRemap[ix] = static_cast<uint32_t>(ix);
+			vertexRemap[ix] = static_cast<uint32_t>(ix);
+		}
+		std::fill(collapsed.begin(), collapsed.end(), 0);
+		for (const Collapse& collapse : collapses) {
+			if (collapse.Error > maxError || removed >= budget) {
+				break;
+			}
+			if (collapsed[collapse.From] || collapsed[collapse.To]) {
+				continue;
+			}
+
+			// Reject collapses that would flip any of the triangles that stay around, using the collapses done so far
+			bool rejected = false;
+			uint32_t lost = 0;
+			for (uint32_t jx = positionStart[collapse.From]; jx < positionStart[collapse.From + 1] && !rejected; jx++) {
+				const uint32_t* tri = &topology[positionTriangles[jx] * 3];
+				uint32_t corners[3] = { positionRemap[tri[0]], positionRemap[tri[1]], positionRemap[tri[2]] };
+				if (corners[0] == collapse.To || corners[1] == collapse.To || corners[2] == collapse.To) {
+					lost++;
+					continue;
+				}
+				const glm::vec3 before = glm::cross(points[corners[1]] - points[corners[0]], points[corners[2]] - points[corners[0]]);
+				for (uint32_t& corner : corners) {
+					corner = corner == collapse.From ? collapse.To : corner;
+				}
+				const glm::vec3 after = glm::cross(points[corners[1]] - points[corners[0]], points[corners[2]] - points[corners[0]]);
+				const float lengths = glm::length(before) * glm::length(after);
+				rejected = lengths > 0.0f && glm::dot(before, after) < SIMPLIFY_MAX_FLIP * lengths;
+			}
+
+			// Each vertex at the old position needs a vertex at the new one to take it's place. Picking one that shares
+			// a triangle with it keeps the attributes on the same side of any seam
+			moves.clear();
+			for (uint32_t jx = wedgeStart[collapse.From]; jx < wedgeStart[collapse.From + 1] && !rejected; jx++) {
+				const uint32_t wedge = wedges[jx];
+				uint32_t target = UINT32_MAX;
+				for (uint32_t kx = vertexStart[wedge]; kx < vertexStart[wedge + 1] && target == UINT32_MAX; kx++) {
+					const uint32_t* tri = &result[vertexTriangles[kx] * 3];
+					for (int corner = 0; corner < 3; corner++) {
+						if (canonical[tri[corner]] == collapse.To) {
+							target = tri[corner];
+						}
+					}
+				}
+				moves.push_back({ wedge, target });
+			}
+			// Vertices that don't touch the new position (ex: flat shaded faces, where every face has it's own normals)
+			// can borrow the target of a vertex with the same UV, so the texture stays put and only the normals change.
+			// If no vertex with the same UV touches the new position, the collapse would drag part of the texture
+			// across a seam so we leave it be
+			for (size_t jx = 0; jx < moves.size() && !rejected; jx++) {
+				if (moves[jx].second != UINT32_MAX) {
+					continue;
+				}
+				for (size_t kx = 0; kx < moves.size() && moves[jx].second == UINT32_MAX; kx++) {
+					const uint32_t target = moves[kx].second;
+					if (target != UINT32_MAX && target != moves[jx].first && SameUV(uvs, uvStride, moves[jx].first, moves[kx].first)) {
+						moves[jx].second = target;
+					}
+				}
+				rejected = moves[jx].second == UINT32_MAX;
+			}
+			if (rejected) {
+				continue;
+			}
+			for (const std::pair<uint32_t, uint32_t>& move : moves) {
+				vertexRemap[move.first] = move.second;
+			}
+			positionRemap[collapse.From] = collapse.To;
+			quadrics[collapse.To] += quadrics[collapse.From];
+			collapsed[collapse.From] = collapsed[collapse.To] = 1;
+			resultError = std::max(resultError, collapse.Error);
+			removed += lost;
+		}
+		if (removed == 0) {
+			break;
+		}
+
+		// Move the collapsed corners and drop the triangles that have shrunk down to a line
+		size_t write = 0;
+		for (size_t ix = 0; ix < result.size(); ix += 3) {
+			const uint32_t a = vertexRemap[result[ix]], b = vertexRemap[result[ix + 1]], c = vertexRemap[result[ix + 2]];
+			if (canonical[a] != canonical[b] && canonical[b] != canonical[c] && canonical[a] != canonical[c]) {
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+		}
+		result.resize(write);
+	}
+	return std::sqrt(resultError);
+}
+
+std::vector<MeshOptimizer::Lod> MeshOptimizer::BuildLods(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount,
+	size_t positionStride, const float* uvs, size_t uvStride, uint32_t lodCount, float reduction, float maxError)
+{
+	std::vector<Lod> result;
+	const uint32_t* source = indices;
+	size_t sourceCount = indexCount;
+	float sourceError = 0.0f;
+	for (uint32_t level = 0; level < lodCount; level++) {
+		// Simplifying the last level instead of the original is much faster, and the errors just add up
+		const size_t target = static_cast<size_t>(sourceCount / 3 * reduction) * 3;
+		Lod lod;
+		const float error = Simplify(source, sourceCount, positions, vertexCount, positionStride, target, maxError - sourceError, lod.Indices, uvs, uvStride);
+		// Stop once simplifying doesn't get rid of enough to be worth another mesh
+		if (lod.Indices.empty() || lod.Indices.size() > sourceCount * (1.0f + reduction) * 0.5f) {
+			break;
+		}
+		OptimizeVertexCache(lod.Indices.data(), lod.Indices.size(), vertexCount);
+		lod.Error = sourceError + error;
+		result.push_back(std::move(lod));
+		source = result.back().Indices.data();
+		sourceCount = result.back().Indices.size();
+		sourceError = result.back().Error;
+	}
+	return result;
+}
+
+float MeshOptimizer::GetACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+	const size_t triCount = indexCount / 3;
+	if (triCount == 0) {
+		return 0.0f;
+	}
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+	size_t misses = 0;
+	for (size_t ix = 0; ix < triCount; ix++) {
+		misses += SimulateTriangle(&indices[ix * 3], cacheTime, timestamp, cacheSize);
+	}
+	return (float)misses / (float)triCount;
+}
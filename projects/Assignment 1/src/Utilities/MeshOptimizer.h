@@ -0,0 +1,143 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <GLM/glm.hpp>
+
+#include "Graphics/MeshletBuffer.h"
+
+/// <summary>
+/// Reorders indexed triangle lists so they draw faster, without changing what gets drawn. These work on the raw index
+/// data so they don't care about the vertex type, MeshBuilder::Optimize runs all of them in the right order
+///
+/// See: Forsyth, "Linear-Speed Vertex Cache Optimisation" and Sander et al. "Fast Triangle Reordering for Vertex
+/// Locality and Reduced Overdraw"
+/// </summary>
+class MeshOptimizer final
+{
+public:
+	// The FIFO size we assume when measuring, roughly what the post-transform cache on desktop GPUs behaves like
+	static const uint32_t DEFAULT_CACHE_SIZE = 16;
+	// The largest cluster BuildMeshlets will make, these fit the limits most GPUs like for mesh shaders and keep the
+	// clusters small enough that the culling tests stay tight
+	static const uint32_t MESHLET_MAX_VERTICES  = 64;
+	static const uint32_t MESHLET_MAX_TRIANGLES = 124;
+	// Meshes with fewer triangles than this aren't worth splitting, culling them as a whole costs less than the pass
+	static const uint32_t MESHLET_MIN_TRIANGLES = 4096;
+	// Meshes with fewer triangles than this are already cheap enough to draw at any distance, so they don't get LODs
+	static const uint32_t LOD_MIN_TRIANGLES     = 512;
+	// The number of simplified levels BuildLods makes by default, not counting the original mesh
+	static const uint32_t DEFAULT_LOD_COUNT     = 3;
+
+	/// <summary>
+	/// The vertex cache numbers for a mesh before and after it was optimized
+	/// </summary>
+	struct Stats {
+		float AcmrBefore = 0.0f;
+		float AcmrAfter  = 0.0f;
+		// The number of vertices that were dropped because no triangle used them
+		uint32_t UnusedVertices = 0;
+	};
+
+	/// <summary>
+	/// Reorders triangles so that they re-use recently transformed vertices as much as possible
+	/// </summary>
+	/// <param name="indices">The triangle list to reorder in place</param>
+	/// <param name="indexCount">The number of indices, should be a multiple of 3</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+	/// <summary>
+	/// Splits a cache optimized triangle list into clusters, and sorts them so the outward facing ones draw first.
+	/// Should be run after OptimizeVertexCache, since the clusters follow the breaks in the cache order
+	/// </summary>
+	/// <param name="indices">The triangle list to reorder in place</param>
+	/// <param name="indexCount">The number of indices, should be a multiple of 3</param>
+	/// <param name="positions">The position of each vertex</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <param name="threshold">How much worse the ACMR is allowed to get for the sake of smaller clusters, 1.05 allows 5%</param>
+	static void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t vertexCount, float threshold = 1.05f);
+	/// <summary>
+	/// Works out a new order for the vertices that follows the order the indices first use them, so vertex fetches
+	/// walk through memory instead of jumping around. The indices are updated to the new order
+	/// </summary>
+	/// <param name="indices">The triangle list to remap in place</param>
+	/// <param name="indexCount">The number of indices</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <param name="remap">Filled with the new index of each old vertex, or UINT32_MAX for vertices that are never used</param>
+	/// <returns>The number of vertices that are used</returns>
+	static uint32_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap);
+	/// <summary>
+	/// Splits a triangle list into clusters of neighbouring triangles, each with a bounding sphere and a cone around
+	/// it's normals so the GPU can cull it on it's own (see MeshletCuller). Triangles are taken in the order they are
+	/// in, so each cluster is a contiguous range of the existing indices. Should be run after the other optimizations,
+	/// since the cache order already keeps neighbouring triangles together
+	/// </summary>
+	/// <param name="indices">The triangle list to split, it is not modified</param>
+	/// <param name="indexCount">The number of indices, should be a multiple of 3</param>
+	/// <param name="positions">The x, y and z of the first vertex's position</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <param name="positionStride">The number of bytes between the positions of one vertex and the next</param>
+	/// <param name="maxVertices">The most unique vertices a cluster may use</param>
+	/// <param name="maxTriangles">The most triangles a cluster may hold</param>
+	static std::vector<Meshlet> BuildMeshlets(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount,
+		size_t positionStride = sizeof(glm::vec3), uint32_t maxVertices = MESHLET_MAX_VERTICES, uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+	/// <summary>
+	/// A simplified version of a mesh, made by BuildLods
+	/// </summary>
+	struct Lod {
+		// The triangle list, referring to the same vertices as the original mesh
+		std::vector<uint32_t> Indices;
+		// How far the surface may have moved from the original, relative to the size of the mesh
+		float                 Error = 0.0f;
+	};
+
+	/// <summary>
+	/// Reduces the number of triangles in a mesh by collapsing edges, picking the collapses that move the surface the
+	/// least as measured by quadric error metrics. The vertices are left alone, the result refers to a subset of them.
+	/// Vertices that share a position (ex: seams, or flat shaded faces) are moved together, collapses that would move a
+	/// UV seam are skipped, and vertices on open borders only slide along the border
+	///
+	/// See: Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics"
+	/// </summary>
+	/// <param name="indices">The triangle list to simplify</param>
+	/// <param name="indexCount">The number of indices, should be a multiple of 3</param>
+	/// <param name="positions">The x, y and z of the first vertex's position</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <param name="positionStride">The number of bytes between the positions of one vertex and the next</param>
+	/// <param name="targetIndexCount">The number of indices to stop at, the result may have more if the error limit is hit first</param>
+	/// <param name="targetError">How far the surface may move, relative to the size of the mesh (ex: 0.01 for 1%)</param>
+	/// <param name="result">Will store the simplified triangle list</param>
+	/// <param name="uvs">The u and v of the first vertex's texture coordinates, or nullptr if the mesh isn't textured</param>
+	/// <param name="uvStride">The number of bytes between the texture coordinates of one vertex and the next</param>
+	/// <returns>How far the surface moved, relative to the size of the mesh</returns>
+	static float Simplify(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride,
+		size_t targetIndexCount, float targetError, std::vector<uint32_t>& result, const float* uvs = nullptr, size_t uvStride = 0);
+	/// <summary>
+	/// Builds a chain of simplified meshes, each with roughly reduction times the triangles of the one before. The
+	/// chain stops early once simplifying stops paying off, so it may be shorter than lodCount. Each level is
+	/// optimized for the vertex cache
+	/// </summary>
+	/// <param name="indices">The triangle list of the full detail mesh</param>
+	/// <param name="indexCount">The number of indices, should be a multiple of 3</param>
+	/// <param name="positions">The x, y and z of the first vertex's position</param>
+	/// <param name="vertexCount">The number of vertices the indices refer to</param>
+	/// <param name="positionStride">The number of bytes between the positions of one vertex and the next</param>
+	/// <param name="uvs">The u and v of the first vertex's texture coordinates, or nullptr if the mesh isn't textured</param>
+	/// <param name="uvStride">The number of bytes between the texture coordinates of one vertex and the next</param>
+	/// <param name="lodCount">The most levels to make</param>
+	/// <param name="reduction">The fraction of triangles each level keeps from the one before</param>
+	/// <param name="maxError">The furthest any level's surface may move, relative to the size of the mesh</param>
+	static std::vector<Lod> BuildLods(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount,
+		size_t positionStride = sizeof(glm::vec3), const float* uvs = nullptr, size_t uvStride = 0,
+		uint32_t lodCount = DEFAULT_LOD_COUNT, float reduction = 0.5f, float maxError = 0.05f);
+
+	/// <summary>
+	/// Measures the average cache miss ratio of a triangle list, which is the number of vertices that need to be
+	/// transformed per triangle. 3 is the worst case, around 0.5 - 0.7 is about as good as real meshes get
+	/// </summary>
+	static float GetACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+protected:
+	MeshOptimizer() = default;
+};
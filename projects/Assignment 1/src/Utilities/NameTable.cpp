@@ -0,0 +1,56 @@
+#include "NameTable.h"
+#include <cstring>
+#include <entt.hpp>
+
+#include "Logging.h"
+
+// The empty string is added up front, so it's always id 0
+std::deque<NameTable::Entry>                    NameTable::_entries = { { "", entt::hashed_string::value("", 0) } };
+std::unordered_multimap<uint32_t, NameTable::Id> NameTable::_ids = { { entt::hashed_string::value("", 0), NameTable::EMPTY } };
+std::mutex                                      NameTable::_lock;
+
+NameTable::Id NameTable::Intern(const char* name, size_t length) {
+	if (length == 0) {
+		return EMPTY;
+	}
+	const uint32_t hash = entt::hashed_string::value(name, length);
+	std::lock_guard<std::mutex> lock(_lock);
+	Id result;
+	if (_Find(name, length, hash, result)) {
+		return result;
+	}
+	result = static_cast<Id>(_entries.size());
+	_entries.push_back({ std::string(name, length), hash });
+	_ids.emplace(hash, result);
+	return result;
+}
+
+bool NameTable::Find(const std::string& name, Id& id) {
+	const uint32_t hash = entt::hashed_string::value(name.data(), name.size());
+	std::lock_guard<std::mutex> lock(_lock);
+	return _Find(name.data(), name.size(), hash, id);
+}
+
+const std::string& NameTable::Get(Id id) {
+	std::lock_guard<std::mutex> lock(_lock);
+	LOG_ASSERT(id < _entries.size(), "Name id is not in the table!");
+	return _entries[id].Name;
+}
+
+uint32_t NameTable::GetHash(Id id) {
+	std::lock_guard<std::mutex> lock(_lock);
+	LOG_ASSERT(id < _entries.size(), "Name id is not in the table!");
+	return _entries[id].Hash;
+}
+
+bool NameTable::_Find(const char* name, size_t length, uint32_t hash, Id& id) {
+	const auto range = _ids.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		const std::string& existing = _entries[it->second].Name;
+		if (existing.size() == length && std::memcmp(existing.data(), name, length) == 0) {
+			id = it->second;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// <summary>
+/// Stores every distinct name once, and hands out small ids for them, so things that carry a name (ex: GameObjectTag)
+/// can be copied and moved around without allocating. Looking up a name that has already been interned doesn't
+/// allocate either
+///
+/// Names are never removed, so the ids stay valid for as long as the program runs. Safe to use from any thread
+/// </summary>
+class NameTable final
+{
+public:
+	typedef uint32_t Id;
+
+	/// <summary>
+	/// The id of the empty string, which is always in the table
+	/// </summary>
+	static const Id EMPTY = 0;
+
+	/// <summary>
+	/// Gets the id for a name, adding it to the table if it's not there yet
+	/// </summary>
+	static Id Intern(const char* name, size_t length);
+	static Id Intern(const char* name) { return Intern(name, std::char_traits<char>::length(name)); }
+	static Id Intern(const std::string& name) { return Intern(name.data(), name.size()); }
+
+	/// <summary>
+	/// Gets the id for a name without adding it to the table
+	/// </summary>
+	/// <param name="name">The name to look up</param>
+	/// <param name="id">Will store the id of the name if it was found</param>
+	/// <returns>True if the name has been interned before, false if not</returns>
+	static bool Find(const std::string& name, Id& id);
+
+	/// <summary>
+	/// Gets the name for an id, the reference stays valid forever
+	/// </summary>
+	static const std::string& Get(Id id);
+	/// <summary>
+	/// Gets the entt::hashed_string value of the name for an id, computed once when the name was interned
+	/// </summary>
+	static uint32_t GetHash(Id id);
+
+protected:
+	NameTable() = default;
+	~NameTable() = default;
+
+	struct Entry {
+		std::string Name;
+		uint32_t    Hash;
+	};
+
+	// A deque so that references to names stay valid as more get added
+	static std::deque<Entry>                    _entries;
+	// Maps hashes to the entries with them, different names can share a hash so we still compare the names
+	static std::unordered_multimap<uint32_t, Id> _ids;
+	static std::mutex                           _lock;
+
+	// Finds an entry with the given name and hash, the lock must be held
+	static bool _Find(const char* name, size_t length, uint32_t hash, Id& id);
+};
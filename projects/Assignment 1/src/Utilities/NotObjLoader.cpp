@@ -1,112 +1,105 @@
 #include "NotObjLoader.h"
 
 #include <string>
-#include <sstream>
-#include <fstream>
-#include <iostream>
 
-#include "StringUtils.h"
+#include "VirtualFileSystem.h"
+#include "TextScanner.h"
+#include "ThreadPool.h"
 
-VertexArrayObject::sptr NotObjLoader::LoadFromFile(const std::string& filename)
-{
-	// Open our file in binary mode
-	std::ifstream file;
-	file.open(filename, std::ios::binary);
+// The size of the pieces a file gets split into, so big scenes can be parsed across the ThreadPool
+static const size_t PARSE_CHUNK_SIZE = 256 * 1024;
 
-	// If our file fails to open, we will throw an error
-	if (!file) {
-		throw std::runtime_error("Failed to open file");
-	}
+// Reads the optional trailing color on a shape line, either rgb or rgba
+static glm::vec4 ReadColor(TextScanner& scanner) {
+	glm::vec4 color = glm::vec4(1.0f);
+	scanner.Read(&color.r, 4);
+	return color;
+}
+
+// Parses the shapes in one piece of the file
+static void ParseShapes(std::string_view text, std::vector<Primitive>& primitives)
+{
+	TextScanner scanner(text.data(), text.data() + text.size());
 
-	MeshBuilder<VertexPosNormTexCol> mesh;
-	std::string line;
-	
 	// Iterate as long as there is content to read
-	while (std::getline(file, line)) {
-		trim(line);
-		if (line.substr(0, 1) == "#")
-		{
-			// Comment, no-op
-		}
-		else if (line.substr(0, 5) == "cube ") // We can do equality check this way since the left side is a string and not a char*
+	while (!scanner.IsEnd()) {
+		// Comments and empty lines don't match any of our commands, so they just get skipped
+		std::string_view command = scanner.ReadToken();
+		if (command == "cube")
 		{
-			std::istringstream ss = std::istringstream(line.substr(5));
-			glm::vec3 pos;
-			ss >> pos.x >> pos.y >> pos.z;
-			
-			glm::vec3 scale;
-			ss >> scale.x >> scale.y >> scale.z;
-			
-			glm::vec3 eulerDeg;
-			ss >> eulerDeg.x >> eulerDeg.y >> eulerDeg.z;
-			
-			glm::vec4 color = glm::vec4(1.0f);
-			if (ss.rdbuf()->in_avail() > 0) {
-				ss >> color.r >> color.g >> color.b;
-			}
-			if (ss.rdbuf()->in_avail() > 0) {
-				ss >> color.a;
-			}
+			glm::vec3 pos(0.0f), scale(0.0f), eulerDeg(0.0f);
+			scanner.Read(&pos.x, 3);
+			scanner.Read(&scale.x, 3);
+			scanner.Read(&eulerDeg.x, 3);
+			glm::vec4 color = ReadColor(scanner);
 
-			MeshFactory::AddCube(mesh, pos, scale, eulerDeg, color);
-			
+			primitives.push_back(Primitive::Cube(pos, scale, eulerDeg, color));
 		}
-		else if (line.substr(0, 6) == "plane ")
+		else if (command == "plane")
 		{
-			std::istringstream ss = std::istringstream(line.substr(6));
-			glm::vec3 pos;
-			ss >> pos.x >> pos.y >> pos.z;
-			glm::vec3 normal;
-			ss >> normal.x >> normal.y >> normal.z;
-			glm::vec3 tangent;
-			ss >> tangent.x >> tangent.y >> tangent.z;
-			glm::vec2 size;
-			ss >> size.x >> size.y;
-			glm::vec4 color = glm::vec4(1.0f);
-			if (ss.rdbuf()->in_avail() > 0) {
-				ss >> color.r >> color.g >> color.b;
-			}
-			if (ss.rdbuf()->in_avail() > 0) {
-				ss >> color.a;
-			}
-			
-			MeshFactory::AddPlane(mesh, pos, normal, tangent, size, color);
+			glm::vec3 pos(0.0f), normal(0.0f), tangent(0.0f);
+			glm::vec2 size(0.0f);
+			scanner.Read(&pos.x, 3);
+			scanner.Read(&normal.x, 3);
+			scanner.Read(&tangent.x, 3);
+			scanner.Read(&size.x, 2);
+			glm::vec4 color = ReadColor(scanner);
+
+			primitives.push_back(Primitive::Plane(pos, normal, tangent, size, color));
 		}
-		else if (line.substr(0, 7) == "sphere ")
+		else if (command == "sphere")
 		{
-			std::istringstream ss = std::istringstream(line.substr(7));
-
-			std::string mode;
-			ss >> mode;
+			std::string_view mode = scanner.ReadToken();
 
 			int tesselation = 0;
-			ss >> tesselation;
+			scanner.Read(tesselation);
 
-			glm::vec3 pos;
-			ss >> pos.x >> pos.y >> pos.z;
+			glm::vec3 pos(0.0f), radii(0.0f);
+			scanner.Read(&pos.x, 3);
+			scanner.Read(&radii.x, 3);
+			glm::vec4 color = ReadColor(scanner);
 
-			glm::vec3 radii;
-			ss >> radii.x >> radii.y >> radii.z;
-			
-			glm::vec4 color = glm::vec4(1.0f);
-			if (ss.rdbuf()->in_avail() > 0) {
-				ss >> color.r >> color.g >> color.b;
-			}
-			if (ss.rdbuf()->in_avail() > 0) {
-				ss >> color.a;
-			}
-						
 			if (mode == "ico") {
-				MeshFactory::AddIcoSphere(mesh, pos, radii, tesselation, color);
+				primitives.push_back(Primitive::Sphere(PrimitiveType::IcoSphere, pos, radii, tesselation, color));
 			} else if (mode == "uv") {
-				MeshFactory::AddUvSphere(mesh, pos, radii, tesselation, color);
+				primitives.push_back(Primitive::Sphere(PrimitiveType::UvSphere, pos, radii, tesselation, color));
 			}
 		}
+		scanner.SkipLine();
+	}
+}
+
+VertexArrayObject::sptr NotObjLoader::LoadFromFile(const std::string& filename)
+{
+	// Map the file straight into memory (or out of an archive), so we can parse it in place without any copies
+	VirtualFile::sptr file = VirtualFileSystem::Open(filename);
+
+	// If our file fails to open, we will throw an error
+	if (file == nullptr) {
+		throw std::runtime_error("Failed to open file");
 	}
 
-	// Note: with actual OBJ files you're going to run into the issue where faces are composited of different indices
-	// You'll need to keep track of these and create vertex entries for each vertex in the face
-	// If you want to get fancy, you can track which vertices you've already added
+	// Every line is a shape on it's own, so the pieces can be parsed in any order and joined back up afterwards
+	const std::vector<std::string_view> pieces = TextScanner::SplitLines(file->GetData(), file->GetData() + file->GetSize(), PARSE_CHUNK_SIZE);
+	std::vector<std::vector<Primitive>> parsed(pieces.size());
+	ThreadPool::Instance().ParallelFor(pieces.size(), 1, [&](size_t first, size_t last) {
+		for (size_t ix = first; ix < last; ix++) {
+			ParseShapes(pieces[ix], parsed[ix]);
+		}
+	});
+
+	// The shapes get gathered up first, so the mesh can be sized for all of them at once
+	std::vector<Primitive> primitives;
+	size_t count = 0;
+	for (const std::vector<Primitive>& piece : parsed) {
+		count += piece.size();
+	}
+	primitives.reserve(count);
+	for (const std::vector<Primitive>& piece : parsed) {
+		primitives.insert(primitives.end(), piece.begin(), piece.end());
+	}
 
+	MeshBuilder<VertexPosNormTexCol> mesh;
+	MeshFactory::AddPrimitives(mesh, primitives);
 	return mesh.Bake();
 }
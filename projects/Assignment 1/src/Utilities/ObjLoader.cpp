@@ -1,15 +1,495 @@
 #include "ObjLoader.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <functional>
 #include <string>
 #include <sstream>
 #include <fstream>
-#include <iostream>
 #include <unordered_map>
 
+#include "Logging.h"
+#include "Graphics/MeshUploadStream.h"
+#include "FlatHashMap.h"
+#include "MeshCook.h"
 #include "StringUtils.h"
+#include "TextScanner.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+#include "VirtualFileSystem.h"
 
-VertexArrayObject::sptr ObjLoader::LoadFromFile(const std::string& filename, const glm::vec4& inColor)
-{	
+// The number of each element in a file, found with a quick first pass so we can size everything up front
+struct ObjCounts {
+	size_t Positions = 0;
+	size_t Normals   = 0;
+	size_t UVs       = 0;
+	size_t Indices   = 0;
+};
+
+// We can construct a key using a bitmask of the attribute indices
+// This let's us quickly look up a combination of attributes to see if it's already been added
+// Note that this limits us to 2,097,150 unique attributes for positions, normals and textures
+static inline uint64_t MakeVertexKey(uint64_t position, uint64_t uv, uint64_t normal) {
+	const uint64_t mask = 0b0'000000000000000000000'000000000000000000000'111111111111111111111;
+	return ((position & mask) << 42) | ((uv & mask) << 21) | (normal & mask);
+}
+
+// The OBJ format can have negative values, which are a reference from the last added attributes (-1 is the last one)
+static inline int ResolveIndex(int index, size_t count) {
+	return index < 0 ? static_cast<int>(count) + index + 1 : index;
+}
+
+static ObjCounts CountElements(const char* begin, const char* end) {
+	ObjCounts result;
+	TextScanner scanner(begin, end);
+	while (!scanner.IsEnd()) {
+		std::string_view command = scanner.ReadToken();
+		if (command == "v") {
+			result.Positions++;
+		} else if (command == "vn") {
+			result.Normals++;
+		} else if (command == "vt") {
+			result.UVs++;
+		} else if (command == "f") {
+			size_t corners = 0;
+			while (!scanner.IsLineEnd()) {
+				scanner.ReadToken();
+				corners++;
+			}
+			// Faces are split into a fan of triangles
+			if (corners >= 3) {
+				result.Indices += (corners - 2) * 3;
+			}
+		}
+		scanner.SkipLine();
+	}
+	return result;
+}
+
+// Called with each chunk of a streamed mesh, the indices in the chunk are relative to the first vertex of the whole mesh
+typedef std::function<void(MeshBuilder<VertexPosNormTexCol>&)> ObjChunkCallback;
+
+// Parses the OBJ into the mesh. If a chunk size and callback are given, the mesh is handed to the callback and cleared
+// whenever it reaches the chunk size (in vertices, or triangles), so it never holds more than one chunk at a time
+static void ParseObj(const char* begin, const char* end, const ObjCounts& counts, const glm::vec4& inColor, MeshBuilder<VertexPosNormTexCol>& mesh,
+	size_t chunkSize = 0, const ObjChunkCallback& onChunk = nullptr)
+{
+	const bool streaming = chunkSize > 0 && onChunk != nullptr;
+
+	// Stores attributes
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoords;
+	positions.reserve(counts.Positions);
+	normals.reserve(counts.Normals);
+	textureCoords.reserve(counts.UVs);
+
+	// Most faces share their corners with their neighbours, so we'll usually end up with about as many vertices as
+	// the largest attribute list. It's only a guess, but it saves most of the re-allocations
+	const size_t expectedVertices = std::max({ counts.Positions, counts.Normals, counts.UVs });
+	if (streaming) {
+		// Faces can push a chunk a little over before we flush it, so leave room for a few extra corners
+		mesh.ReserveVertexSpace(chunkSize + 64);
+		mesh.ReserveIndexSpace(chunkSize * 3 + 192);
+	} else {
+		mesh.ReserveVertexSpace(expectedVertices);
+		mesh.ReserveIndexSpace(counts.Indices);
+	}
+	// The number of vertices that have already been handed off in earlier chunks
+	size_t flushedVertices = 0;
+
+	// We'll use bitmask keys and a map to avoid duplicate vertices. Every face corner does a lookup, so we use a flat
+	// map that doesn't allocate per vertex. We reserve for the same guess as the vertices rather than for every face
+	// corner, on smooth meshes that would be several times too big and the extra memory costs more than a re-hash
+	FlatHashMap<uint64_t, uint32_t> indexMap;
+	indexMap.Reserve(expectedVertices);
+
+	// The vertex indices for the face we are reading, these can have any number of corners
+	std::vector<uint32_t> corners;
+	corners.reserve(8);
+	size_t badFaces = 0;
+
+	TextScanner scanner(begin, end);
+	while (!scanner.IsEnd()) {
+		std::string_view command = scanner.ReadToken();
+
+		// Load in vertex positions
+		if (command == "v") {
+			glm::vec3 value(0.0f);
+			scanner.Read(&value.x, 3);
+			positions.push_back(value);
+		}
+		// Load in vertex normals
+		else if (command == "vn") {
+			glm::vec3 value(0.0f);
+			scanner.Read(&value.x, 3);
+			normals.push_back(value);
+		}
+		// Load in UV coordinates
+		else if (command == "vt") {
+			glm::vec2 value(0.0f);
+			scanner.Read(&value.x, 2);
+			textureCoords.push_back(value);
+		}
+		// Load in face lines
+		else if (command == "f") {
+			corners.clear();
+			bool valid = true;
+			while (!scanner.IsLineEnd()) {
+				// Corners come as v, v/vt, v//vn or v/vt/vn
+				int position = 0, uv = 0, normal = 0;
+				if (!scanner.Read(position)) {
+					valid = false;
+					scanner.ReadToken();
+					continue;
+				}
+				if (scanner.Consume('/')) {
+					if (!scanner.Consume('/')) {
+						scanner.Read(uv);
+						if (scanner.Consume('/')) {
+							scanner.Read(normal);
+						}
+					} else {
+						scanner.Read(normal);
+					}
+				}
+				position = ResolveIndex(position, positions.size());
+				uv = ResolveIndex(uv, textureCoords.size());
+				normal = ResolveIndex(normal, normals.size());
+				if (position < 1 || position > (int)positions.size() ||
+					uv < 0 || uv > (int)textureCoords.size() ||
+					normal < 0 || normal > (int)normals.size())
+				{
+					valid = false;
+					continue;
+				}
+
+				// Find the index associated with the combination of attributes, or add a new vertex if there isn't one
+				auto it = indexMap.TryEmplace(MakeVertexKey(position, uv, normal), static_cast<uint32_t>(flushedVertices + mesh.GetVertexCount()));
+				if (it.second) {
+					VertexPosNormTexCol vertex;
+					vertex.Position = positions[position - 1];
+					vertex.UV = uv != 0 ? textureCoords[uv - 1] : glm::vec2(0.0f);
+					vertex.Normal = normal != 0 ? normals[normal - 1] : glm::vec3(0.0f, 0.0f, 1.0f);
+					vertex.Color = inColor;
+					mesh.AddVertex(vertex);
+				}
+				corners.push_back(*it.first);
+			}
+
+			if (!valid || corners.size() < 3) {
+				badFaces++;
+			} else {
+				// Split the face into a fan around the first corner, this covers triangles, quads and any convex polygon
+				for (size_t ix = 2; ix < corners.size(); ix++) {
+					mesh.AddIndexTri(corners[0], corners[ix - 1], corners[ix]);
+				}
+				if (streaming && (mesh.GetVertexCount() >= chunkSize || mesh.GetIndexCount() >= chunkSize * 3)) {
+					flushedVertices += mesh.GetVertexCount();
+					onChunk(mesh);
+					mesh.Clear();
+				}
+			}
+		}
+		scanner.SkipLine();
+	}
+	if (streaming && mesh.GetIndexCount() > 0) {
+		onChunk(mesh);
+		mesh.Clear();
+	}
+
+	if (badFaces > 0) {
+		LOG_WARN("Skipped {} faces with missing or out of range indices", badFaces);
+	}
+}
+
+// A face corner as it was written in the file, before any of the indices are resolved
+struct ObjCorner {
+	int Position;
+	int UV;
+	int Normal;
+};
+// A face in a chunk, with the number of each attribute the chunk had read before it. Indices can only refer to the
+// attributes before their face, and negative ones count back from there, but a chunk doesn't know how many came
+// before it until every chunk has been parsed
+struct ObjFace {
+	uint32_t Corners;
+	uint32_t Positions;
+	uint32_t UVs;
+	uint32_t Normals;
+};
+
+// Everything one worker pulls out of it's piece of the file, plus where it lands in the whole mesh
+struct ObjChunk {
+	std::string_view       Text;
+	std::vector<glm::vec3> Positions;
+	std::vector<glm::vec3> Normals;
+	std::vector<glm::vec2> UVs;
+	std::vector<ObjCorner> Corners;
+	// The faces, in the same order as their corners
+	std::vector<ObjFace>   Faces;
+	// The vertex key for each corner, once the indices have been resolved
+	std::vector<uint64_t>  Keys;
+	size_t BadFaces = 0;
+	// Where this chunk's attributes, corners, new vertices and indices start in the whole file
+	size_t FirstPosition = 0;
+	size_t FirstNormal   = 0;
+	size_t FirstUV       = 0;
+	size_t FirstCorner   = 0;
+	size_t FirstVertex   = 0;
+	size_t FirstIndex    = 0;
+	size_t VertexCount   = 0;
+	size_t IndexCount    = 0;
+};
+
+// Spreads the vertex keys over the de-duplication partitions, the keys themselves are bit fields so their low bits
+// would clump (ex: every corner of a mesh without normals has a normal index of 0)
+static inline size_t GetKeyPartition(uint64_t key, size_t count) {
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDull;
+	key ^= key >> 33;
+	return static_cast<size_t>(key % count);
+}
+
+// Parses the attribute and face lines in one piece of the file into the chunk, without resolving anything
+static void ParseObjChunk(ObjChunk& chunk) {
+	TextScanner scanner(chunk.Text.data(), chunk.Text.data() + chunk.Text.size());
+	while (!scanner.IsEnd()) {
+		std::string_view command = scanner.ReadToken();
+		if (command == "v") {
+			glm::vec3 value(0.0f);
+			scanner.Read(&value.x, 3);
+			chunk.Positions.push_back(value);
+		} else if (command == "vn") {
+			glm::vec3 value(0.0f);
+			scanner.Read(&value.x, 3);
+			chunk.Normals.push_back(value);
+		} else if (command == "vt") {
+			glm::vec2 value(0.0f);
+			scanner.Read(&value.x, 2);
+			chunk.UVs.push_back(value);
+		} else if (command == "f") {
+			const size_t first = chunk.Corners.size();
+			bool valid = true;
+			while (!scanner.IsLineEnd()) {
+				// Same as ParseObj, corners come as v, v/vt, v//vn or v/vt/vn
+				ObjCorner corner{ 0, 0, 0 };
+				if (!scanner.Read(corner.Position)) {
+					valid = false;
+					scanner.ReadToken();
+					continue;
+				}
+				if (scanner.Consume('/')) {
+					if (!scanner.Consume('/')) {
+						scanner.Read(corner.UV);
+						if (scanner.Consume('/')) {
+							scanner.Read(corner.Normal);
+						}
+					} else {
+						scanner.Read(corner.Normal);
+					}
+				}
+				chunk.Corners.push_back(corner);
+			}
+			const size_t count = chunk.Corners.size() - first;
+			if (!valid || count < 3) {
+				chunk.Corners.resize(first);
+				chunk.BadFaces++;
+			} else {
+				chunk.Faces.push_back({ static_cast<uint32_t>(count), static_cast<uint32_t>(chunk.Positions.size()),
+					static_cast<uint32_t>(chunk.UVs.size()), static_cast<uint32_t>(chunk.Normals.size()) });
+			}
+		}
+		scanner.SkipLine();
+	}
+}
+
+// Parses the OBJ into the mesh across the ThreadPool, giving the same vertices and indices as ParseObj. The file is
+// split at line breaks and each piece is parsed on it's own, then the pieces are stitched back together with prefix
+// sums of their counts. Vertices get de-duplicated by splitting the keys into partitions, each with it's own map, and
+// numbered in the order they first appear so the result doesn't depend on how the work was split up
+static void ParseObjParallel(const char* begin, const char* end, const glm::vec4& inColor, MeshBuilder<VertexPosNormTexCol>& mesh) {
+	ThreadPool& pool = ThreadPool::Instance();
+	const std::vector<std::string_view> pieces = TextScanner::SplitLines(begin, end, ObjLoader::ParallelChunkSize);
+	std::vector<ObjChunk> chunks(pieces.size());
+	for (size_t ix = 0; ix < pieces.size(); ix++) {
+		chunks[ix].Text = pieces[ix];
+	}
+	pool.ParallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+		for (size_t ix = first; ix < last; ix++) {
+			ParseObjChunk(chunks[ix]);
+		}
+	});
+
+	// Now that we know how many attributes each chunk has, we know where they all start
+	size_t positionCount = 0, normalCount = 0, uvCount = 0;
+	for (ObjChunk& chunk : chunks) {
+		chunk.FirstPosition = positionCount;
+		chunk.FirstNormal = normalCount;
+		chunk.FirstUV = uvCount;
+		positionCount += chunk.Positions.size();
+		normalCount += chunk.Normals.size();
+		uvCount += chunk.UVs.size();
+	}
+	std::vector<glm::vec3> positions(positionCount);
+	std::vector<glm::vec3> normals(normalCount);
+	std::vector<glm::vec2> textureCoords(uvCount);
+
+	// Gather the attributes, and resolve every corner into a key. Faces with a corner out of range get dropped, and
+	// the keys are packed down over their corners
+	pool.ParallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+		for (size_t ix = first; ix < last; ix++) {
+			ObjChunk& chunk = chunks[ix];
+			std::copy(chunk.Positions.begin(), chunk.Positions.end(), positions.begin() + chunk.FirstPosition);
+			std::copy(chunk.Normals.begin(), chunk.Normals.end(), normals.begin() + chunk.FirstNormal);
+			std::copy(chunk.UVs.begin(), chunk.UVs.end(), textureCoords.begin() + chunk.FirstUV);
+
+			chunk.Keys.reserve(chunk.Corners.size());
+			size_t corner = 0, kept = 0;
+			for (const ObjFace& face : chunk.Faces) {
+				// The same checks as ParseObj, against how many of each attribute the file had read by this face
+				const size_t positionCount = chunk.FirstPosition + face.Positions;
+				const size_t uvCount = chunk.FirstUV + face.UVs;
+				const size_t normalCount = chunk.FirstNormal + face.Normals;
+				const size_t faceStart = chunk.Keys.size();
+				bool valid = true;
+				for (size_t jx = 0; jx < face.Corners; jx++) {
+					const ObjCorner& c = chunk.Corners[corner + jx];
+					const int position = ResolveIndex(c.Position, positionCount);
+					const int uv = ResolveIndex(c.UV, uvCount);
+					const int normal = ResolveIndex(c.Normal, normalCount);
+					if (position < 1 || position > (int)positionCount || uv < 0 || uv > (int)uvCount ||
+						normal < 0 || normal > (int)normalCount)
+					{
+						valid = false;
+						break;
+					}
+					chunk.Keys.push_back(MakeVertexKey(position, uv, normal));
+				}
+				corner += face.Corners;
+				if (valid) {
+					chunk.Faces[kept++] = face;
+					chunk.IndexCount += (face.Corners - 2) * 3;
+				} else {
+					chunk.Keys.resize(faceStart);
+					chunk.BadFaces++;
+				}
+			}
+			chunk.Faces.resize(kept);
+			chunk.Corners = std::vector<ObjCorner>();
+		}
+	});
+
+	size_t cornerCount = 0, badFaces = 0;
+	for (ObjChunk& chunk : chunks) {
+		chunk.FirstCorner = cornerCount;
+		cornerCount += chunk.Keys.size();
+		badFaces += chunk.BadFaces;
+	}
+
+	// Each partition owns the keys that hash into it, and records the first corner that used each of them. Every
+	// partition reads all of the keys, but only ever writes the corners it owns, so none of them overlap
+	const size_t partitionCount = pool.GetThreadCount() + 1;
+	const size_t expectedVertices = std::max({ positionCount, normalCount, uvCount });
+	std::vector<uint32_t> firstCorner(cornerCount);
+	pool.ParallelFor(partitionCount, 1, [&](size_t first, size_t last) {
+		for (size_t partition = first; partition < last; partition++) {
+			FlatHashMap<uint64_t, uint32_t> indexMap;
+			indexMap.Reserve(expectedVertices / partitionCount);
+			for (const ObjChunk& chunk : chunks) {
+				for (size_t ix = 0; ix < chunk.Keys.size(); ix++) {
+					if (GetKeyPartition(chunk.Keys[ix], partitionCount) == partition) {
+						const uint32_t corner = static_cast<uint32_t>(chunk.FirstCorner + ix);
+						firstCorner[corner] = *indexMap.TryEmplace(chunk.Keys[ix], corner).first;
+					}
+				}
+			}
+		}
+	});
+
+	// The corners that came first are the ones that make a vertex, so counting them gives each chunk's vertex range
+	pool.ParallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+		for (size_t ix = first; ix < last; ix++) {
+			ObjChunk& chunk = chunks[ix];
+			for (size_t jx = 0; jx < chunk.Keys.size(); jx++) {
+				chunk.VertexCount += firstCorner[chunk.FirstCorner + jx] == chunk.FirstCorner + jx ? 1 : 0;
+			}
+		}
+	});
+	const size_t baseVertex = mesh.GetVertexCount();
+	size_t vertexCount = 0, indexCount = 0;
+	for (ObjChunk& chunk : chunks) {
+		chunk.FirstVertex = baseVertex + vertexCount;
+		chunk.FirstIndex = indexCount;
+		vertexCount += chunk.VertexCount;
+		indexCount += chunk.IndexCount;
+	}
+
+	// Build the vertices where they first appear, and remember which vertex each of those corners made
+	VertexPosNormTexCol* vertices = mesh.AppendVertices(vertexCount);
+	std::vector<uint32_t> cornerVertex(cornerCount);
+	pool.ParallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+		for (size_t ix = first; ix < last; ix++) {
+			const ObjChunk& chunk = chunks[ix];
+			uint32_t next = static_cast<uint32_t>(chunk.FirstVertex);
+			for (size_t jx = 0; jx < chunk.Keys.size(); jx++) {
+				const size_t corner = chunk.FirstCorner + jx;
+				if (firstCorner[corner] != corner) {
+					continue;
+				}
+				// Unpack the attribute indices back out of the key
+				const uint64_t key = chunk.Keys[jx];
+				const size_t position = static_cast<size_t>((key >> 42) & 0x1FFFFF);
+				const size_t uv = static_cast<size_t>((key >> 21) & 0x1FFFFF);
+				const size_t normal = static_cast<size_t>(key & 0x1FFFFF);
+				VertexPosNormTexCol& vertex = vertices[next - baseVertex];
+				vertex.Position = positions[position - 1];
+				vertex.UV = uv != 0 ? textureCoords[uv - 1] : glm::vec2(0.0f);
+				vertex.Normal = normal != 0 ? normals[normal - 1] : glm::vec3(0.0f, 0.0f, 1.0f);
+				vertex.Color = inColor;
+				cornerVertex[corner] = next++;
+			}
+		}
+	});
+
+	// Then split every face into a fan, same as ParseObj
+	uint32_t* indices = mesh.AppendIndices(indexCount);
+	pool.ParallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+		for (size_t ix = first; ix < last; ix++) {
+			const ObjChunk& chunk = chunks[ix];
+			uint32_t* out = indices + chunk.FirstIndex;
+			size_t corner = chunk.FirstCorner;
+			for (const ObjFace& face : chunk.Faces) {
+				const uint32_t anchor = cornerVertex[firstCorner[corner]];
+				for (size_t jx = 2; jx < face.Corners; jx++) {
+					*out++ = anchor;
+					*out++ = cornerVertex[firstCorner[corner + jx - 1]];
+					*out++ = cornerVertex[firstCorner[corner + jx]];
+				}
+				corner += face.Corners;
+			}
+		}
+	});
+
+	if (badFaces > 0) {
+		LOG_WARN("Skipped {} faces with missing or out of range indices", badFaces);
+	}
+}
+
+// Parses a whole file into the mesh, across the ThreadPool if it's big enough to be worth splitting up
+static void ParseObjFile(const char* begin, const char* end, const glm::vec4& inColor, MeshBuilder<VertexPosNormTexCol>& mesh) {
+	const size_t size = static_cast<size_t>(end - begin);
+	if (ObjLoader::ParallelThreshold > 0 && size >= ObjLoader::ParallelThreshold && ThreadPool::Instance().GetThreadCount() > 0) {
+		ParseObjParallel(begin, end, inColor, mesh);
+	} else {
+		ParseObj(begin, end, CountElements(begin, end), inColor, mesh);
+	}
+}
+
+// The original iostream based parser, kept around so we have something to benchmark against
+static void ParseObjLegacy(const std::string& filename, const glm::vec4& inColor, MeshBuilder<VertexPosNormTexCol>& mesh) {
 	// Open our file in binary mode
 	std::ifstream file;
 	file.open(filename, std::ios::binary);
@@ -27,103 +507,245 @@ VertexArrayObject::sptr ObjLoader::LoadFromFile(const std::string& filename, con
 	// We'll use bitmask keys and a map to avoid duplicate vertices
 	std::unordered_map<uint64_t, uint32_t> indexMap;
 
-	// We'll leverage the mesh builder class
-	MeshBuilder<VertexPosNormTexCol> mesh;
-
 	// Temporaries for loading data
 	glm::vec3 temp;
 	glm::ivec3 vertexIndices;
-	
-	std::string line;
+
 	// Iterate as long as there is content to read
 	while (file.peek() != EOF) {
 		std::string command;
 		file >> command;
 
-		// Load in vertex positions
 		if (command == "v") {
 			file >> temp.x >> temp.y >> temp.z;
 			positions.push_back(temp);
 		}
-		// Load in vertex normals
 		else if (command == "vn") {
 			file >> temp.x >> temp.y >> temp.z;
 			normals.push_back(temp);
 		}
-		// Load in UV coordinates
 		else if (command == "vt") {
 			file >> temp.x >> temp.y;
 			textureCoords.push_back(temp);
 		}
-		// Load in face lines
 		else if (command == "f") {
-			// Read the entire line, trim it, and stuff it into a string stream
 			std::string line;
 			std::getline(file, line);
-			trim(line);			
+			trim(line);
 			std::stringstream stream = std::stringstream(line);
 
-			// We'll store the edges in case we added a quad
 			uint32_t edges[4];
 			int ix = 0;
-			// Iterate over up to 4 sets of attributes
 			for (; ix < 4; ix++) {
 				if (stream.peek() != EOF) {
-					// Load in the faces, split up by slashes
 					char tempChar;
 					vertexIndices = glm::ivec3(0);
 					stream >> vertexIndices.x >> tempChar >> vertexIndices.y >> tempChar >> vertexIndices.z;
-					// The OBJ format can have negative values, which are a reference from the last added attributes
 					if (vertexIndices.x < 0) { vertexIndices.x = positions.size() - 1 + vertexIndices.x; }
 					if (vertexIndices.y < 0) { vertexIndices.y = textureCoords.size() - 1 + vertexIndices.y; }
 					if (vertexIndices.z < 0) { vertexIndices.z = normals.size() - 1 + vertexIndices.z; }
-					// We can construct a key using a bitmask of the attribute indices
-					// This let's us quickly look up a combination of attributes to see if it's already been added
-					// Note that this limits us to 2,097,150 unique attributes for positions, normals and textures
-					const uint64_t mask = 0b0'000000000000000000000'000000000000000000000'111111111111111111111;
-					uint64_t key = ((vertexIndices.x & mask) << 42) | ((vertexIndices.y & mask) << 21) | (vertexIndices.z & mask);
+					uint64_t key = MakeVertexKey(vertexIndices.x, vertexIndices.y, vertexIndices.z);
 
-					// Find the index associated with the combination of attributes
 					auto it = indexMap.find(key);
-
-					// If it exists, we push the index to our indices
 					if (it != indexMap.end()) {
 						edges[ix] = it->second;
 					}
 					else {
-						// Construct a new vertex using the indices for the vertex
 						VertexPosNormTexCol vertex;
 						vertex.Position = positions[vertexIndices.x - 1];
 						vertex.UV = vertexIndices.y != 0 ? textureCoords[vertexIndices.y - 1] : glm::vec2(0.0f);
 						vertex.Normal = vertexIndices.z != 0 ? normals[vertexIndices.z - 1] : glm::vec3(0.0f, 0.0f, 1.0f);
 						vertex.Color = inColor;
 
-						// Add to the mesh, get index of the added vertex
 						uint32_t index = mesh.AddVertex(vertex);
-						// Cache the index based on our key
 						indexMap[key] = index;
-						// Add index to mesh, and add to edges list for if we are using quads
 						edges[ix] = index;
 					}
 				} else {
 					break;
 				}
 			}
-			// Handling for trangle faces
 			if (ix == 3) {
 				mesh.AddIndexTri(edges[0], edges[1], edges[2]);
 			}
-			// Handling for quad faces
 			else if (ix == 4) {
 				mesh.AddIndexTri(edges[0], edges[1], edges[2]);
 				mesh.AddIndexTri(edges[0], edges[2], edges[3]);
 			}
 		}
 	}
+}
+
+// Parses the file a chunk at a time, packing each chunk and sending it off to the GPU before parsing the next
+static VertexArrayObject::sptr StreamObj(const VirtualFile& file, const glm::vec4& inColor, size_t chunkSize) {
+	const char* begin = file.GetData();
+	const char* end = begin + file.GetSize();
+	const ObjCounts counts = CountElements(begin, end);
+
+	// The GPU buffers can be sized from the counts up front, it's only the CPU side we're keeping small
+	MeshUploadStream stream(VertexPackedPosNormTexCol::V_DECL, sizeof(VertexPackedPosNormTexCol),
+		std::max({ counts.Positions, counts.Normals, counts.UVs }), counts.Indices);
+
+	// We never have the whole mesh, so the bounds get built up one chunk at a time
+	glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+	std::vector<VertexPackedPosNormTexCol> packed;
+	packed.reserve(chunkSize + 64);
+	MeshBuilder<VertexPosNormTexCol> mesh;
+	ParseObj(begin, end, counts, inColor, mesh, std::max(chunkSize, static_cast<size_t>(1)), [&](MeshBuilder<VertexPosNormTexCol>& chunk) {
+		const VertexPosNormTexCol* vertices = chunk.GetVertexDataPtr();
+		packed.clear();
+		for (size_t ix = 0; ix < chunk.GetVertexCount(); ix++) {
+			packed.emplace_back(vertices[ix]);
+			min = glm::min(min, vertices[ix].Position);
+			max = glm::max(max, vertices[ix].Position);
+		}
+		stream.AppendVertices(packed.data(), packed.size());
+		stream.AppendIndices(chunk.GetIndexDataPtr(), chunk.GetIndexCount());
+	});
+
+	VertexArrayObject::sptr result = stream.Finish(BoundingVolume(min, max), MeshArena::Get<VertexPackedPosNormTexCol>());
+	// Files without any faces still get a mesh, same as LoadFromFile
+	return result != nullptr ? result : mesh.Bake<VertexPackedPosNormTexCol>();
+}
+
+size_t ObjLoader::StreamingThreshold = 64 * 1024 * 1024;
+size_t ObjLoader::StreamingChunkSize = 64 * 1024;
+size_t ObjLoader::ParallelThreshold = 4 * 1024 * 1024;
+size_t ObjLoader::ParallelChunkSize = 1024 * 1024;
+
+VertexArrayObject::sptr ObjLoader::LoadFromFile(const std::string& filename, const glm::vec4& inColor, CpuResidency residency)
+{
+	AssetLoadScope load(filename);
+
+	// Use the cooked copy when we have one, those are always cooked in white so other colors need the OBJ
+	if (inColor == glm::vec4(1.0f)) {
+		VertexArrayObject::sptr cooked = MeshCook::LoadSidecar(filename, residency);
+		if (cooked != nullptr) {
+			return cooked;
+		}
+	}
+
+	// Map the file straight into memory (or out of an archive), so we can parse it in place without any copies
+	VirtualFile::sptr file = VirtualFileSystem::Open(filename);
+	if (file == nullptr) {
+		throw std::runtime_error("Failed to open file");
+	}
+
+	// Really big files get streamed straight to the GPU instead, since holding the whole mesh (and the copies that
+	// optimizing makes) could use more memory than we have
+	if (StreamingThreshold > 0 && file->GetSize() >= StreamingThreshold) {
+		return StreamObj(*file, inColor, StreamingChunkSize);
+	}
+
+	// We'll leverage the mesh builder class
+	MeshBuilder<VertexPosNormTexCol> mesh;
+	ParseObjFile(file->GetData(), file->GetData() + file->GetSize(), inColor, mesh);
+	mesh.Optimize();
+	mesh.BuildMeshlets();
+	mesh.GenerateLods();
+	if (residency == CpuResidency::KeepCpuCopy) {
+		mesh.BuildTriangleBvh();
+	}
+	// Models are only ever drawn once they're loaded, so we can pack the vertices down to half the size
+	return mesh.Bake<VertexPackedPosNormTexCol>();
+}
+
+VertexArrayObject::sptr ObjLoader::LoadNormalMapped(const std::string& filename, CpuResidency residency)
+{
+	AssetLoadScope load(filename);
+
+	VertexArrayObject::sptr cooked = MeshCook::LoadSidecar(filename, residency, true);
+	if (cooked != nullptr) {
+		return cooked;
+	}
+	LOG_INFO("Working out tangents for \"{}\" while loading, cook it to have them baked in", filename);
+
+	MeshBuilder<VertexPosNormTexCol> parsed;
+	ParseFile(filename, parsed);
+	// Copy it over to a vertex with room for the tangents, before any of the processing so it all follows the new vertices
+	MeshBuilder<VertexPosNormTanTexCol> mesh;
+	VertexPosNormTanTexCol* vertices = mesh.AppendVertices(parsed.GetVertexCount());
+	const VertexPosNormTexCol* source = parsed.GetVertexDataPtr();
+	for (size_t ix = 0; ix < parsed.GetVertexCount(); ix++) {
+		vertices[ix] = VertexPosNormTanTexCol(source[ix]);
+	}
+	memcpy(mesh.AppendIndices(parsed.GetIndexCount()), parsed.GetIndexDataPtr(), parsed.GetIndexCount() * sizeof(uint32_t));
+	parsed.Clear();
+
+	mesh.GenerateTangents();
+	mesh.Optimize();
+	mesh.BuildMeshlets();
+	mesh.GenerateLods();
+	if (residency == CpuResidency::KeepCpuCopy) {
+		mesh.BuildTriangleBvh();
+	}
+	return mesh.Bake<VertexPackedPosNormTanTexCol>();
+}
+
+void ObjLoader::ParseFile(const std::string& filename, MeshBuilder<VertexPosNormTexCol>& mesh, const glm::vec4& inColor)
+{
+	// Map the file straight into memory (or out of an archive), so we can parse it in place without any copies
+	VirtualFile::sptr file = VirtualFileSystem::Open(filename);
+
+	// If our file fails to open, we will throw an error
+	if (file == nullptr) {
+		throw std::runtime_error("Failed to open file");
+	}
+	ParseObjFile(file->GetData(), file->GetData() + file->GetSize(), inColor, mesh);
+}
+
+VertexArrayObject::sptr ObjLoader::LoadStreamed(const std::string& filename, const glm::vec4& inColor, size_t chunkSize)
+{
+	AssetLoadScope load(filename);
+	VirtualFile::sptr file = VirtualFileSystem::Open(filename);
+	if (file == nullptr) {
+		throw std::runtime_error("Failed to open file");
+	}
+	return StreamObj(*file, inColor, chunkSize);
+}
+
+void ObjLoader::Benchmark(const std::string& filename, uint32_t iterations)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	iterations = std::max(iterations, 1u);
+
+	double legacyTotal = 0.0, legacyBest = DBL_MAX;
+	double mappedTotal = 0.0, mappedBest = DBL_MAX;
+	size_t legacyVertices = 0, legacyIndices = 0;
+	size_t mappedVertices = 0, mappedIndices = 0;
+	for (uint32_t ix = 0; ix < iterations; ix++) {
+		{
+			MeshBuilder<VertexPosNormTexCol> mesh;
+			Clock::time_point start = Clock::now();
+			ParseObjLegacy(filename, glm::vec4(1.0f), mesh);
+			const double time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			legacyTotal += time;
+			legacyBest = std::min(legacyBest, time);
+			legacyVertices = mesh.GetVertexCount();
+			legacyIndices = mesh.GetIndexCount();
+		}
+		{
+			MeshBuilder<VertexPosNormTexCol> mesh;
+			Clock::time_point start = Clock::now();
+			ParseFile(filename, mesh);
+			const double time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			mappedTotal += time;
+			mappedBest = std::min(mappedBest, time);
+			mappedVertices = mesh.GetVertexCount();
+			mappedIndices = mesh.GetIndexCount();
+		}
+	}
 
-	// Note: with actual OBJ files you're going to run into the issue where faces are composited of different indices
-	// You'll need to keep track of these and create vertex entries for each vertex in the face
-	// If you want to get fancy, you can track which vertices you've already added
+	LOG_INFO("Parsed \"{}\" {} times", filename, iterations);
+	LOG_INFO("  iostream: {:.2f}ms average, {:.2f}ms best ({} vertices, {} indices)", legacyTotal / iterations, legacyBest, legacyVertices, legacyIndices);
+	LOG_INFO("  mapped:   {:.2f}ms average, {:.2f}ms best ({} vertices, {} indices)", mappedTotal / iterations, mappedBest, mappedVertices, mappedIndices);
+	LOG_INFO("  speedup:  {:.1f}x", legacyTotal / std::max(mappedTotal, 1e-6));
 
-	return mesh.Bake();
+	// Also report what the mesh optimizer does for the file, since that's the other half of what loading costs us
+	MeshBuilder<VertexPosNormTexCol> mesh;
+	ParseFile(filename, mesh);
+	Clock::time_point start = Clock::now();
+	const MeshOptimizer::Stats stats = mesh.Optimize();
+	const double time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	LOG_INFO("  optimize: {:.2f}ms, ACMR {:.3f} -> {:.3f} ({} unused vertices dropped)", time, stats.AcmrBefore, stats.AcmrAfter, stats.UnusedVertices);
 }
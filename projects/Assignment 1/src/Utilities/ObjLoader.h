@@ -1,12 +1,75 @@
 #pragma once
+#include "Graphics/CpuResidency.h"
 #include "MeshFactory.h"
 
 class ObjLoader
 {
 public:
-	static VertexArrayObject::sptr LoadFromFile(const std::string& filename, const glm::vec4& inColor = glm::vec4(1.0f));
+	/// <summary>
+	/// OBJ files at least this big (in bytes) are loaded with LoadStreamed instead of being parsed all at once, 0 to
+	/// never stream. Streamed meshes skip optimizing, meshlets and LODs, since those all need the whole mesh
+	/// </summary>
+	static size_t StreamingThreshold;
+	/// <summary>
+	/// The chunk size (in vertices) that LoadFromFile uses for files over the StreamingThreshold
+	/// </summary>
+	static size_t StreamingChunkSize;
+	/// <summary>
+	/// OBJ files at least this big (in bytes) are parsed across the ThreadPool, 0 to always parse on the calling
+	/// thread. Small files aren't worth the extra passes that stitching the pieces back together takes
+	/// </summary>
+	static size_t ParallelThreshold;
+	/// <summary>
+	/// The size (in bytes) of the pieces a file gets split into when it's parsed across the ThreadPool
+	/// </summary>
+	static size_t ParallelChunkSize;
+
+	/// <summary>
+	/// Loads an OBJ file (or it's cooked sidecar, see MeshCook)
+	/// </summary>
+	/// <param name="filename">The path of the OBJ file to load</param>
+	/// <param name="inColor">The color to give every vertex</param>
+	/// <param name="residency">
+	/// Whether to build the tree over the mesh's triangles while loading, anything other than KeepCpuCopy leaves it
+	/// for the caller to load on demand (see VertexArrayObject::SetTriangleSource)
+	/// </param>
+	static VertexArrayObject::sptr LoadFromFile(const std::string& filename, const glm::vec4& inColor = glm::vec4(1.0f), CpuResidency residency = CpuResidency::KeepCpuCopy);
+
+	/// <summary>
+	/// Loads an OBJ file (or it's cooked sidecar) with tangents, for drawing with a normal map (see NORMAL_MAP in
+	/// vertex_shader.glsl). The mesh uses VertexPackedPosNormTanTexCol, and lives in that type's arena. Cooked models
+	/// already have their tangents, anything else gets them worked out while it loads
+	/// </summary>
+	/// <param name="filename">The path of the OBJ file to load</param>
+	/// <param name="residency">Whether to build the tree over the mesh's triangles while loading, see LoadFromFile</param>
+	static VertexArrayObject::sptr LoadNormalMapped(const std::string& filename, CpuResidency residency = CpuResidency::KeepCpuCopy);
+
+	/// <summary>
+	/// Loads an OBJ file a chunk at a time, uploading each chunk while the next one is parsed. Only one chunk of
+	/// vertices and indices is held on the CPU at once, though the attribute lists and vertex map still grow with the
+	/// file since faces can refer back to any earlier attribute. Must be called from the main thread
+	/// </summary>
+	/// <param name="filename">The path of the OBJ file to load</param>
+	/// <param name="inColor">The color to give every vertex</param>
+	/// <param name="chunkSize">The number of vertices (or triangles) to parse before sending them to the GPU</param>
+	static VertexArrayObject::sptr LoadStreamed(const std::string& filename, const glm::vec4& inColor = glm::vec4(1.0f), size_t chunkSize = 64 * 1024);
+
+	/// <summary>
+	/// Parses an OBJ file into a mesh builder without uploading anything, so it can be used without an OpenGL context
+	/// </summary>
+	/// <param name="filename">The path of the OBJ file to parse</param>
+	/// <param name="mesh">The builder to append the vertices and indices to</param>
+	/// <param name="inColor">The color to give every vertex</param>
+	static void ParseFile(const std::string& filename, MeshBuilder<VertexPosNormTexCol>& mesh, const glm::vec4& inColor = glm::vec4(1.0f));
+
+	/// <summary>
+	/// Times how long it takes to parse a file with our parser and the old iostream based one, and logs the results
+	/// </summary>
+	/// <param name="filename">The path of the OBJ file to parse</param>
+	/// <param name="iterations">The number of times to parse the file with each parser</param>
+	static void Benchmark(const std::string& filename, uint32_t iterations = 10);
 
 protected:
 	ObjLoader() = default;
 	~ObjLoader() = default;
-};
\ No newline at end of file
+};
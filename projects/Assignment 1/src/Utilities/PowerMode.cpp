@@ -0,0 +1,149 @@
+#include "PowerMode.h"
+
+#include <GLFW/glfw3.h>
+
+bool     PowerMode::Enabled           = false;
+uint32_t PowerMode::IdleFrames        = 60;
+double   PowerMode::HeartbeatInterval = 1.0;
+
+std::atomic<bool> PowerMode::_hasInput(false);
+int               PowerMode::_heldCount = 0;
+uint32_t          PowerMode::_quietFrames = 0;
+double            PowerMode::_lastFrameTime = 0.0;
+PowerMode::Stats  PowerMode::_stats = PowerMode::Stats();
+
+// Whatever was installed before us, which we pass every event on to
+static GLFWkeyfun             previousKey = nullptr;
+static GLFWcharfun            previousChar = nullptr;
+static GLFWmousebuttonfun     previousMouseButton = nullptr;
+static GLFWcursorposfun       previousCursorPos = nullptr;
+static GLFWscrollfun          previousScroll = nullptr;
+static GLFWwindowfocusfun     previousFocus = nullptr;
+static GLFWwindowrefreshfun   previousRefresh = nullptr;
+static GLFWframebuffersizefun previousFramebufferSize = nullptr;
+
+void PowerMode::Install(GLFWwindow* window) {
+	previousKey = glfwSetKeyCallback(window, _OnKey);
+	previousChar = glfwSetCharCallback(window, _OnChar);
+	previousMouseButton = glfwSetMouseButtonCallback(window, _OnMouseButton);
+	previousCursorPos = glfwSetCursorPosCallback(window, _OnCursorPos);
+	previousScroll = glfwSetScrollCallback(window, _OnScroll);
+	previousFocus = glfwSetWindowFocusCallback(window, _OnFocus);
+	previousRefresh = glfwSetWindowRefreshCallback(window, _OnRefresh);
+	previousFramebufferSize = glfwSetFramebufferSizeCallback(window, _OnFramebufferSize);
+	_lastFrameTime = glfwGetTime();
+}
+
+PowerMode::WakeReason PowerMode::WaitForFrame() {
+	_stats.IsIdle = false;
+	if (!Enabled || _heldCount > 0 || _quietFrames < IdleFrames) {
+		_lastFrameTime = glfwGetTime();
+		return WakeReason::Active;
+	}
+
+	// Nothing has happened for a while, so we leave the last frame on screen and sleep until something does. The
+	// callbacks run from inside of the wait, so they'll have set the flag by the time it returns
+	_stats.IsIdle = true;
+	const double start = glfwGetTime();
+	WakeReason result = WakeReason::Heartbeat;
+	while (true) {
+		if (_hasInput) {
+			result = WakeReason::Input;
+			break;
+		}
+		const double remaining = HeartbeatInterval - (glfwGetTime() - _lastFrameTime);
+		if (remaining <= 0.0) {
+			break;
+		}
+		glfwWaitEventsTimeout(remaining);
+	}
+	const double now = glfwGetTime();
+	_stats.IdleSeconds += now - start;
+	_lastFrameTime = now;
+	if (result == WakeReason::Input) {
+		// Straight back to full rate, EndFrame will see the input and start counting again from 0
+		_stats.Wakeups++;
+	} else {
+		_stats.Heartbeats++;
+	}
+	return result;
+}
+
+void PowerMode::EndFrame(bool isActive) {
+	if (_hasInput.exchange(false) || isActive) {
+		_quietFrames = 0;
+	} else if (_quietFrames < IdleFrames) {
+		_quietFrames++;
+	}
+}
+
+void PowerMode::Wake() {
+	_hasInput = true;
+	// Breaks the main thread out of glfwWaitEventsTimeout, which is safe to call from any thread
+	glfwPostEmptyEvent();
+}
+
+void PowerMode::_OnKey(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	_hasInput = true;
+	_heldCount += action == GLFW_PRESS ? 1 : action == GLFW_RELEASE ? -1 : 0;
+	_heldCount = _heldCount < 0 ? 0 : _heldCount;
+	if (previousKey != nullptr) {
+		previousKey(window, key, scancode, action, mods);
+	}
+}
+
+void PowerMode::_OnChar(GLFWwindow* window, unsigned int codepoint) {
+	_hasInput = true;
+	if (previousChar != nullptr) {
+		previousChar(window, codepoint);
+	}
+}
+
+void PowerMode::_OnMouseButton(GLFWwindow* window, int button, int action, int mods) {
+	_hasInput = true;
+	_heldCount += action == GLFW_PRESS ? 1 : action == GLFW_RELEASE ? -1 : 0;
+	_heldCount = _heldCount < 0 ? 0 : _heldCount;
+	if (previousMouseButton != nullptr) {
+		previousMouseButton(window, button, action, mods);
+	}
+}
+
+void PowerMode::_OnCursorPos(GLFWwindow* window, double x, double y) {
+	_hasInput = true;
+	if (previousCursorPos != nullptr) {
+		previousCursorPos(window, x, y);
+	}
+}
+
+void PowerMode::_OnScroll(GLFWwindow* window, double x, double y) {
+	_hasInput = true;
+	if (previousScroll != nullptr) {
+		previousScroll(window, x, y);
+	}
+}
+
+void PowerMode::_OnFocus(GLFWwindow* window, int isFocused) {
+	_hasInput = true;
+	// Releases don't get sent to a window that has lost focus, so anything held down has to be let go of here
+	if (!isFocused) {
+		_heldCount = 0;
+	}
+	if (previousFocus != nullptr) {
+		previousFocus(window, isFocused);
+	}
+}
+
+void PowerMode::_OnRefresh(GLFWwindow* window) {
+	// The window's contents got lost (ex: it was uncovered without a compositor), so we need to draw again
+	_hasInput = true;
+	if (previousRefresh != nullptr) {
+		previousRefresh(window);
+	}
+}
+
+void PowerMode::_OnFramebufferSize(GLFWwindow* window, int width, int height) {
+	_hasInput = true;
+	if (previousFramebufferSize != nullptr) {
+		previousFramebufferSize(window, width, height);
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+struct GLFWwindow;
+
+/// <summary>
+/// Lets the game loop go to sleep while nothing is happening (ex: a kiosk nobody is using). Once a number of frames
+/// in a row have gone by with no input and nothing changing in the scene, the loop blocks in glfwWaitEventsTimeout
+/// instead of drawing, so the last frame we swapped just stays on screen. Any input wakes it straight back up to full
+/// rate, and a heartbeat frame still runs every so often so anything on a timer gets a chance to wake us too
+///
+/// Input is picked up by callbacks chained in front of whatever was already installed (ex: ImGui's), everything else
+/// the loop has to report through EndFrame
+/// </summary>
+class PowerMode final
+{
+public:
+	/// <summary>
+	/// Why WaitForFrame let the loop carry on
+	/// </summary>
+	enum class WakeReason {
+		// We weren't idle, so there was no wait
+		Active,
+		// There was input while we were idle
+		Input,
+		// We were idle for HeartbeatInterval without any input
+		Heartbeat
+	};
+
+	/// <summary>
+	/// Whether the loop is allowed to go idle at all
+	/// </summary>
+	static bool     Enabled;
+	/// <summary>
+	/// The number of frames in a row with nothing happening before we go idle
+	/// </summary>
+	static uint32_t IdleFrames;
+	/// <summary>
+	/// How often a frame still runs while we're idle, in seconds
+	/// </summary>
+	static double   HeartbeatInterval;
+
+	struct Stats {
+		// Whether the last call to WaitForFrame waited
+		bool     IsIdle;
+		// The total time spent asleep, in seconds
+		double   IdleSeconds;
+		uint64_t Heartbeats;
+		uint64_t Wakeups;
+	};
+
+	/// <summary>
+	/// Chains our callbacks in front of the window's, must be called after anything else installs it's own (ex: after
+	/// ImGui_ImplGlfw_InitForOpenGL)
+	/// </summary>
+	static void Install(GLFWwindow* window);
+
+	/// <summary>
+	/// Blocks while we're idle, until there's input or it's time for a heartbeat. Should be called at the very top of
+	/// the loop, before polling events
+	/// </summary>
+	/// <returns>Why the loop gets to carry on</returns>
+	static WakeReason WaitForFrame();
+	/// <summary>
+	/// Counts the frame towards going idle, should be called at the end of each frame
+	/// </summary>
+	/// <param name="isActive">Whether anything in the scene changed or is still going on this frame (ex: objects
+	/// moving, particles, loads in flight)</param>
+	static void EndFrame(bool isActive);
+	/// <summary>
+	/// Keeps us awake for another IdleFrames, can be called from any thread (ex: when a load finishes)
+	/// </summary>
+	static void Wake();
+
+	static const Stats& GetStats() { return _stats; }
+
+protected:
+	PowerMode() = default;
+
+	// Set by the callbacks (or Wake) whenever something happens, cleared once a frame has seen it
+	static std::atomic<bool> _hasInput;
+	// The keys and buttons being held down, which keep us awake even though they don't send any events
+	static int               _heldCount;
+	static uint32_t          _quietFrames;
+	static double            _lastFrameTime;
+	static Stats             _stats;
+
+	static void _OnKey(GLFWwindow* window, int key, int scancode, int action, int mods);
+	static void _OnChar(GLFWwindow* window, unsigned int codepoint);
+	static void _OnMouseButton(GLFWwindow* window, int button, int action, int mods);
+	static void _OnCursorPos(GLFWwindow* window, double x, double y);
+	static void _OnScroll(GLFWwindow* window, double x, double y);
+	static void _OnFocus(GLFWwindow* window, int isFocused);
+	static void _OnRefresh(GLFWwindow* window);
+	static void _OnFramebufferSize(GLFWwindow* window, int width, int height);
+};
@@ -0,0 +1,64 @@
+#include "QuantileSketch.h"
+#include <algorithm>
+#include <cmath>
+
+#include "Logging.h"
+
+QuantileSketch::QuantileSketch(double relativeAccuracy, double minValue, double maxValue) :
+	_buckets(), _count(0), _sum(0.0), _min(0.0), _max(0.0)
+{
+	LOG_ASSERT(relativeAccuracy > 0.0 && relativeAccuracy < 1.0 && minValue > 0.0 && maxValue > minValue, "Invalid quantile sketch settings!");
+	_gamma = (1.0 + relativeAccuracy) / (1.0 - relativeAccuracy);
+	_logGamma = std::log(_gamma);
+	_offset = static_cast<int>(std::ceil(std::log(minValue) / _logGamma));
+	const int last = static_cast<int>(std::ceil(std::log(maxValue) / _logGamma));
+	_buckets.resize(static_cast<size_t>(last - _offset + 1), 0);
+}
+
+void QuantileSketch::Add(double value) {
+	// Bucket i holds the values in (gamma^(i-1), gamma^i]
+	const int index = value > 0.0 ? static_cast<int>(std::ceil(std::log(value) / _logGamma)) - _offset : 0;
+	_buckets[static_cast<size_t>(std::clamp(index, 0, static_cast<int>(_buckets.size()) - 1))]++;
+	_min = _count == 0 ? value : std::min(_min, value);
+	_max = _count == 0 ? value : std::max(_max, value);
+	_sum += value;
+	_count++;
+}
+
+void QuantileSketch::Merge(const QuantileSketch& other) {
+	LOG_ASSERT(other._buckets.size() == _buckets.size() && other._offset == _offset, "Can only merge sketches with the same settings!");
+	if (other._count == 0) {
+		return;
+	}
+	for (size_t ix = 0; ix < _buckets.size(); ix++) {
+		_buckets[ix] += other._buckets[ix];
+	}
+	_min = _count == 0 ? other._min : std::min(_min, other._min);
+	_max = _count == 0 ? other._max : std::max(_max, other._max);
+	_sum += other._sum;
+	_count += other._count;
+}
+
+void QuantileSketch::Clear() {
+	std::fill(_buckets.begin(), _buckets.end(), 0);
+	_count = 0;
+	_sum = _min = _max = 0.0;
+}
+
+double QuantileSketch::GetQuantile(double quantile) const {
+	if (_count == 0) {
+		return 0.0;
+	}
+	const uint64_t rank = static_cast<uint64_t>(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(_count - 1));
+	uint64_t seen = 0;
+	size_t ix = 0;
+	for (; ix < _buckets.size(); ix++) {
+		seen += _buckets[ix];
+		if (seen > rank) {
+			break;
+		}
+	}
+	// The middle of the bucket (relative to it's width) is within the accuracy of anything in it
+	const double upper = std::pow(_gamma, static_cast<double>(static_cast<int>(ix) + _offset));
+	return std::clamp(2.0 * upper / (_gamma + 1.0), _min, _max);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Estimates the quantiles of a stream of positive values in a fixed amount of memory, no matter how many values it's
+/// seen. Values are counted into buckets whose bounds grow geometrically, so any quantile comes back within a relative
+/// error of the value that's really there (ex: a 1% sketch reports a 40 ms p99 as somewhere between 39.6 and 40.4 ms).
+/// Sketches with the same settings can be merged, so a long running total can be built up out of short intervals
+///
+/// Values below the smallest value the sketch was made for land in it's first bucket, and values above the largest in
+/// it's last, the min and max are still tracked exactly
+/// </summary>
+class QuantileSketch final
+{
+public:
+	/// <param name="relativeAccuracy">How far a quantile can be from the real value, as a fraction of it</param>
+	/// <param name="minValue">The smallest value that gets it's own bucket</param>
+	/// <param name="maxValue">The largest value that gets it's own bucket</param>
+	QuantileSketch(double relativeAccuracy = 0.01, double minValue = 0.01, double maxValue = 100000.0);
+
+	void Add(double value);
+	/// <summary>
+	/// Adds everything another sketch has seen, which must have been made with the same settings
+	/// </summary>
+	void Merge(const QuantileSketch& other);
+	void Clear();
+
+	/// <summary>
+	/// Estimates the value that the given fraction of the values are at or below, 0 if nothing's been added
+	/// </summary>
+	/// <param name="quantile">The fraction, between 0 and 1 (ex: 0.99 for the 99th percentile)</param>
+	double GetQuantile(double quantile) const;
+
+	uint64_t GetCount() const { return _count; }
+	double GetMin() const { return _count > 0 ? _min : 0.0; }
+	double GetMax() const { return _count > 0 ? _max : 0.0; }
+	double GetMean() const { return _count > 0 ? _sum / static_cast<double>(_count) : 0.0; }
+	/// <summary>
+	/// Gets the number of buckets, the sketch's memory is fixed at this many counters
+	/// </summary>
+	size_t GetBucketCount() const { return _buckets.size(); }
+
+private:
+	// The ratio between the bounds of neighbouring buckets, and it's log
+	double _gamma;
+	double _logGamma;
+	// The index that the smallest value's bucket would have, so the first bucket can sit at 0
+	int    _offset;
+	std::vector<uint64_t> _buckets;
+	uint64_t _count;
+	double   _sum;
+	double   _min;
+	double   _max;
+};
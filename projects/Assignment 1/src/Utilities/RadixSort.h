@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// Sorts items by a 32 bit Key member in linear time, for lists that get sorted again every frame (ex: blended draws
+/// by their depth). Each pass buckets the items by 8 bits of their keys, least significant first, and passes where
+/// every item falls in the same bucket are skipped, so keys that sit close together (ex: depths in a small range)
+/// only pay for the bits that differ
+///
+/// SortCoherent is for lists that start out close to where they ended up last frame. It checks the order first, and
+/// only falls back to the radix passes if an insertion sort would have too much moving to do
+/// </summary>
+class RadixSort final
+{
+public:
+	/// <summary>
+	/// Maps a float to a key that orders the same way when compared as an unsigned integer
+	/// </summary>
+	static uint32_t FloatToKey(float value) {
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		// Negatives have all their bits flipped so bigger magnitudes come first, positives just need to go after them
+		return (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+	}
+
+	/// <summary>
+	/// Sorts the items by their keys, smallest first. Items with the same key keep their order
+	/// </summary>
+	/// <param name="items">The items to sort, anything with a uint32_t Key member</param>
+	/// <param name="scratch">Somewhere to move the items while sorting, kept between calls so it doesn't need to allocate</param>
+	template <typename T>
+	static void Sort(std::vector<T>& items, std::vector<T>& scratch) {
+		const size_t count = items.size();
+		if (count < 2) {
+			return;
+		}
+		uint32_t histograms[4][256] = {};
+		for (const T& item : items) {
+			for (int pass = 0; pass < 4; pass++) {
+				histograms[pass][(item.Key >> (pass * 8)) & 0xFF]++;
+			}
+		}
+		scratch.resize(count);
+		T* source = items.data();
+		T* target = scratch.data();
+		for (int pass = 0; pass < 4; pass++) {
+			const int shift = pass * 8;
+			uint32_t* histogram = histograms[pass];
+			// Every item has the same digit, so this pass wouldn't move anything
+			if (histogram[(source[0].Key >> shift) & 0xFF] == count) {
+				continue;
+			}
+			uint32_t offset = 0;
+			for (int digit = 0; digit < 256; digit++) {
+				const uint32_t digitCount = histogram[digit];
+				histogram[digit] = offset;
+				offset += digitCount;
+			}
+			for (size_t ix = 0; ix < count; ix++) {
+				target[histogram[(source[ix].Key >> shift) & 0xFF]++] = source[ix];
+			}
+			std::swap(source, target);
+		}
+		if (source != items.data()) {
+			items.swap(scratch);
+		}
+	}
+
+	/// <summary>
+	/// Sorts items that are probably in nearly the right order already (ex: last frame's order). Lists that are in
+	/// order cost a single pass to check, and ones with a few items out of place get insertion sorted
+	/// </summary>
+	/// <param name="items">The items to sort, anything with a uint32_t Key member</param>
+	/// <param name="scratch">Somewhere to move the items if it comes to a radix sort</param>
+	/// <returns>True if the items needed the radix passes</returns>
+	template <typename T>
+	static bool SortCoherent(std::vector<T>& items, std::vector<T>& scratch) {
+		// An insertion sort that moves items this many places in total costs about the same as the radix passes
+		const size_t maxMoves = items.size() * 4;
+		size_t moves = 0;
+		for (size_t ix = 1; ix < items.size(); ix++) {
+			if (!(items[ix].Key < items[ix - 1].Key)) {
+				continue;
+			}
+			const T item = items[ix];
+			size_t jx = ix;
+			for (; jx > 0 && item.Key < items[jx - 1].Key; jx--) {
+				items[jx] = items[jx - 1];
+			}
+			items[jx] = item;
+			moves += ix - jx;
+			// What's been insertion sorted so far is still a fine place for the radix passes to start from
+			if (moves > maxMoves) {
+				Sort(items, scratch);
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	RadixSort() = default;
+};
@@ -0,0 +1,369 @@
+#include "RemoteProfiler.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "Graphics/GpuProfiler.h"
+#include "Graphics/RenderStats.h"
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/MemoryTracker.h"
+#include "Logging.h"
+
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+typedef int    SocketLength;
+#else
+typedef int       SocketHandle;
+typedef socklen_t SocketLength;
+static const SocketHandle INVALID_SOCKET = -1;
+static int closesocket(SocketHandle socket) { return close(socket); }
+#endif
+
+bool                                            RemoteProfiler::_isRunning = false;
+uint16_t                                        RemoteProfiler::_port = 0;
+std::thread                                     RemoteProfiler::_thread;
+std::atomic<bool>                               RemoteProfiler::_isStopping(false);
+std::atomic<bool>                               RemoteProfiler::_isConnected(false);
+std::atomic<uint32_t>                           RemoteProfiler::_connection(0);
+std::vector<std::unique_ptr<RemoteProfiler::Packet>> RemoteProfiler::_packets;
+TTK::SpscQueue<RemoteProfiler::Packet*, RemoteProfiler::PACKET_COUNT> RemoteProfiler::_outgoing;
+TTK::SpscQueue<RemoteProfiler::Packet*, RemoteProfiler::PACKET_COUNT> RemoteProfiler::_free;
+uint32_t                                        RemoteProfiler::_nameConnection = 0;
+std::unordered_map<const char*, uint16_t>       RemoteProfiler::_names;
+uint64_t                                        RemoteProfiler::_gpuVersion = 0;
+uint64_t                                        RemoteProfiler::_lastSystemSample = 0;
+SystemMonitor::Snapshot                         RemoteProfiler::_system;
+uint32_t                                        RemoteProfiler::_frameIndex = 0;
+uint32_t                                        RemoteProfiler::_sentFrames = 0;
+uint32_t                                        RemoteProfiler::_droppedFrames = 0;
+
+static const uint32_t PROTOCOL_MAGIC = 'T' | ('P' << 8) | ('R' << 16) | ('F' << 24);
+// The size of the size and type in front of every message
+static const size_t   MESSAGE_HEADER_SIZE = 5;
+// The system monitor only samples 4 times a second, so there's no point copying it out any more often than that
+static const uint64_t SYSTEM_INTERVAL_NS = 250000000;
+// How long the network thread waits on the socket before checking if it's being stopped
+static const long     POLL_INTERVAL_US = 2000;
+// A frame can't have more zones than this, anything past it gets left off
+static const size_t   MAX_ZONES = 0xFFFF;
+
+template <typename T>
+static void Append(std::vector<uint8_t>& buffer, const T& value) {
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+static void AppendString(std::vector<uint8_t>& buffer, const char* value) {
+	const size_t length = std::min(strlen(value), static_cast<size_t>(0xFF));
+	Append(buffer, static_cast<uint8_t>(length));
+	buffer.insert(buffer.end(), value, value + length);
+}
+
+// Starts a message, returning where it's size needs to be written once it's finished
+static size_t BeginMessage(std::vector<uint8_t>& buffer, RemoteProfiler::MessageType type) {
+	const size_t offset = buffer.size();
+	Append(buffer, static_cast<uint32_t>(0));
+	Append(buffer, type);
+	return offset;
+}
+
+static void EndMessage(std::vector<uint8_t>& buffer, size_t offset) {
+	const uint32_t size = static_cast<uint32_t>(buffer.size() - offset - MESSAGE_HEADER_SIZE);
+	memcpy(buffer.data() + offset, &size, sizeof(uint32_t));
+}
+
+static uint32_t ClampNs(uint64_t value) {
+	return static_cast<uint32_t>(std::min(value, static_cast<uint64_t>(UINT32_MAX)));
+}
+
+// Waits up to POLL_INTERVAL_US for a socket to be readable
+static bool IsReadable(SocketHandle socket) {
+	fd_set sockets;
+	FD_ZERO(&sockets);
+	FD_SET(socket, &sockets);
+	timeval timeout = { 0, POLL_INTERVAL_US };
+	return select(static_cast<int>(socket + 1), &sockets, nullptr, nullptr, &timeout) > 0;
+}
+
+static bool SendAll(SocketHandle socket, const uint8_t* data, size_t size) {
+	while (size > 0) {
+		const int sent = send(socket, reinterpret_cast<const char*>(data), static_cast<int>(std::min(size, static_cast<size_t>(INT32_MAX))), 0);
+		if (sent <= 0) {
+			return false;
+		}
+		data += sent;
+		size -= static_cast<size_t>(sent);
+	}
+	return true;
+}
+
+bool RemoteProfiler::Start(uint16_t port) {
+	if (_isRunning) {
+		return true;
+	}
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+		LOG_ERROR("Failed to start Winsock, the remote profiler is off");
+		return false;
+	}
+#endif
+	SocketHandle listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	sockaddr_in address = sockaddr_in();
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	const int reuse = 1;
+	if (listener != INVALID_SOCKET) {
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+	}
+	if (listener == INVALID_SOCKET || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 1) != 0) {
+		LOG_ERROR("Failed to listen for the remote profiler on port {}", port);
+		if (listener != INVALID_SOCKET) {
+			closesocket(listener);
+		}
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		return false;
+	}
+
+	_packets.clear();
+	for (size_t ix = 0; ix < PACKET_COUNT; ix++) {
+		_packets.push_back(std::make_unique<Packet>());
+		// Nothing else is touching the queue until the thread starts, so the main thread can fill it
+		_free.Push(_packets.back().get());
+	}
+	_port = port;
+	_isRunning = true;
+	_isStopping = false;
+	_thread = std::thread(&RemoteProfiler::_Run, static_cast<uint64_t>(listener));
+	LOG_INFO("Remote profiler listening on port {}", port);
+	return true;
+}
+
+void RemoteProfiler::Stop() {
+	if (!_isRunning) {
+		return;
+	}
+	_isStopping = true;
+	_thread.join();
+	_isRunning = false;
+	_isConnected = false;
+	// The thread's gone, so we're the only one left touching either queue
+	Packet* packet;
+	while (_outgoing.Pop(packet)) {}
+	while (_free.Pop(packet)) {}
+	_packets.clear();
+	_names.clear();
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+uint16_t RemoteProfiler::_GetNameId(Packet& packet, const char* name) {
+	auto it = _names.find(name);
+	if (it != _names.end()) {
+		return it->second;
+	}
+	const uint16_t id = static_cast<uint16_t>(_names.size());
+	_names[name] = id;
+	const size_t message = BeginMessage(packet.Data, MessageType::Name);
+	Append(packet.Data, id);
+	AppendString(packet.Data, name);
+	EndMessage(packet.Data, message);
+	return id;
+}
+
+void RemoteProfiler::EndFrame() {
+	_frameIndex++;
+	if (!_isRunning || !_isConnected.load(std::memory_order_acquire)) {
+		return;
+	}
+	Packet* packet;
+	if (!_free.Pop(packet)) {
+		_droppedFrames++;
+		return;
+	}
+	// A new viewer hasn't seen any of the names, so they all get sent again
+	const uint32_t connection = _connection.load(std::memory_order_acquire);
+	if (connection != _nameConnection) {
+		_names.clear();
+		_gpuVersion = 0;
+		_nameConnection = connection;
+	}
+	packet->Connection = connection;
+	std::vector<uint8_t>& data = packet->Data;
+	data.clear();
+
+	// The names go in ahead of the frame, so they need working out first
+	const std::vector<CpuProfiler::Event>& cpuEvents = CpuProfiler::Instance().GetFrameEvents();
+	const size_t cpuCount = std::min(cpuEvents.size(), MAX_ZONES);
+	static std::vector<uint16_t> cpuNames;
+	cpuNames.resize(cpuCount);
+	for (size_t ix = 0; ix < cpuCount; ix++) {
+		cpuNames[ix] = _GetNameId(*packet, cpuEvents[ix].Name);
+	}
+	const GpuProfiler& gpu = GpuProfiler::Instance();
+	const bool hasGpu = gpu.GetResultsVersion() != _gpuVersion && !gpu.GetResults().empty();
+	const size_t gpuCount = hasGpu ? std::min(gpu.GetResults().size(), MAX_ZONES) : 0;
+	static std::vector<uint16_t> gpuNames;
+	gpuNames.resize(gpuCount);
+	for (size_t ix = 0; ix < gpuCount; ix++) {
+		gpuNames[ix] = _GetNameId(*packet, gpu.GetResults()[ix].Name);
+	}
+	_gpuVersion = gpu.GetResultsVersion();
+
+	const size_t message = BeginMessage(data, MessageType::Frame);
+	// The events are sorted by start, so every other zone starts after the first
+	const uint64_t cpuStart = cpuEvents.empty() ? 0 : cpuEvents.front().Start;
+	Append(data, _frameIndex);
+	Append(data, cpuStart);
+	Append(data, static_cast<uint16_t>(cpuCount));
+	for (size_t ix = 0; ix < cpuCount; ix++) {
+		const CpuProfiler::Event& event = cpuEvents[ix];
+		Append(data, cpuNames[ix]);
+		Append(data, static_cast<uint8_t>(std::min(event.Thread, 0xFFu)));
+		Append(data, static_cast<uint8_t>(std::min(event.Depth, 0xFFu)));
+		Append(data, ClampNs(event.Start - cpuStart));
+		Append(data, ClampNs(event.End - event.Start));
+	}
+
+	Append(data, static_cast<uint16_t>(gpuCount));
+	if (gpuCount > 0) {
+		const std::vector<GpuProfiler::Zone>& zones = gpu.GetResults();
+		const uint64_t gpuStart = zones.front().Start;
+		Append(data, static_cast<uint64_t>(static_cast<int64_t>(gpuStart) + gpu.GetCpuClockOffset()));
+		for (size_t ix = 0; ix < gpuCount; ix++) {
+			Append(data, gpuNames[ix]);
+			Append(data, static_cast<uint8_t>(0));
+			Append(data, static_cast<uint8_t>(std::clamp(zones[ix].Depth, 0, 0xFF)));
+			Append(data, ClampNs(zones[ix].Start > gpuStart ? zones[ix].Start - gpuStart : 0));
+			Append(data, ClampNs(zones[ix].End > zones[ix].Start ? zones[ix].End - zones[ix].Start : 0));
+		}
+	}
+
+	const RenderStats::Frame& stats = RenderStats::GetLastFrame();
+	const RenderStats::Counters& total = stats.Total;
+	for (uint64_t counter : { (uint64_t)total.DrawCalls, (uint64_t)total.InstancedDraws, total.Triangles, total.Vertices,
+		(uint64_t)total.ProgramSwitches, (uint64_t)total.VaoSwitches, (uint64_t)total.TextureSwitches,
+		(uint64_t)total.MaterialSwitches, (uint64_t)total.UniformUploads, total.BufferBytes, total.TextureBytes }) {
+		Append(data, counter);
+	}
+	for (const RenderStats::Counters& layer : stats.Layers) {
+		Append(data, layer.DrawCalls);
+	}
+	Append(data, stats.CulledObjects);
+	Append(data, stats.OccludedObjects);
+	Append(data, stats.CulledLights);
+
+	for (int ix = 0; ix < static_cast<int>(MemoryTag::Count); ix++) {
+		Append(data, MemoryTracker::GetStats(static_cast<MemoryTag>(ix)).Current);
+	}
+
+	const uint64_t now = CpuProfiler::Now();
+	if (_lastSystemSample == 0 || now - _lastSystemSample >= SYSTEM_INTERVAL_NS) {
+		SystemMonitor::GetSnapshot(_system);
+		_lastSystemSample = now;
+	}
+	const int newest = (_system.Offset + SystemMonitor::HISTORY_SIZE - 1) % SystemMonitor::HISTORY_SIZE;
+	Append(data, _system.MemoryMB[newest]);
+	Append(data, _system.PeakMemoryMB);
+	Append(data, _system.GpuFreeMB[newest]);
+	Append(data, _system.GpuTotalMB);
+	Append(data, _system.CpuUsage[newest]);
+	EndMessage(data, message);
+
+	// There are only ever PACKET_COUNT packets, so there's always room for the one we took
+	_outgoing.Push(packet);
+	_sentFrames++;
+}
+
+void RemoteProfiler::_Run(uint64_t listenSocket) {
+	SystemMonitor::RegisterThread("Remote Profiler");
+	const SocketHandle listener = static_cast<SocketHandle>(listenSocket);
+	SocketHandle client = INVALID_SOCKET;
+	Packet* packet;
+
+	while (!_isStopping.load(std::memory_order_acquire)) {
+		if (client == INVALID_SOCKET) {
+			if (!IsReadable(listener)) {
+				continue;
+			}
+			sockaddr_in address;
+			SocketLength addressLength = sizeof(address);
+			client = accept(listener, reinterpret_cast<sockaddr*>(&address), &addressLength);
+			if (client == INVALID_SOCKET) {
+				continue;
+			}
+			// Packets are already batched by frame, so there's no point in waiting to fill a segment
+			const int noDelay = 1;
+			setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+			std::vector<uint8_t> hello;
+			const size_t message = BeginMessage(hello, MessageType::Hello);
+			Append(hello, PROTOCOL_MAGIC);
+			Append(hello, PROTOCOL_VERSION);
+			Append(hello, static_cast<uint8_t>(MemoryTag::Count));
+			for (int ix = 0; ix < static_cast<int>(MemoryTag::Count); ix++) {
+				AppendString(hello, MemoryTracker::GetTagName(static_cast<MemoryTag>(ix)));
+			}
+			Append(hello, static_cast<uint8_t>(RenderStats::Layer::Count));
+			for (int ix = 0; ix < static_cast<int>(RenderStats::Layer::Count); ix++) {
+				AppendString(hello, RenderStats::GetLayerName(static_cast<RenderStats::Layer>(ix)));
+			}
+			EndMessage(hello, message);
+			if (!SendAll(client, hello.data(), hello.size())) {
+				closesocket(client);
+				client = INVALID_SOCKET;
+				continue;
+			}
+			char host[INET_ADDRSTRLEN] = "?";
+			inet_ntop(AF_INET, &address.sin_addr, host, sizeof(host));
+			LOG_INFO("Remote profiler connected to {}", host);
+			_connection.fetch_add(1, std::memory_order_release);
+			_isConnected.store(true, std::memory_order_release);
+		}
+
+		bool isClosed = false;
+		if (_outgoing.Pop(packet)) {
+			if (packet->Connection == _connection.load(std::memory_order_relaxed)) {
+				isClosed = !SendAll(client, packet->Data.data(), packet->Data.size());
+			}
+			_free.Push(packet);
+		} else if (IsReadable(client)) {
+			// The viewer never sends us anything, so the socket only becomes readable when it hangs up
+			char discard[256];
+			isClosed = recv(client, discard, sizeof(discard), 0) <= 0;
+		}
+		if (isClosed) {
+			LOG_INFO("Remote profiler disconnected");
+			_isConnected.store(false, std::memory_order_release);
+			closesocket(client);
+			client = INVALID_SOCKET;
+			// Anything still queued was for the viewer that just left
+			while (_outgoing.Pop(packet)) {
+				_free.Push(packet);
+			}
+		}
+	}
+
+	if (client != INVALID_SOCKET) {
+		closesocket(client);
+	}
+	closesocket(listener);
+	SystemMonitor::UnregisterThread();
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <Sys.h>
+#include <TTK/InputQueue.h>
+
+/// <summary>
+/// Streams the profiler to a viewer over TCP, so machines running fullscreen without the debug UI can still be
+/// profiled from another one. Each frame's CPU zones, the GPU zones when new ones get read back, the render stats,
+/// each memory tag's usage and the system monitor's latest sample are packed into a single compact binary packet,
+/// which is handed to a network thread through a lock-free queue. The frame never waits on the network, if the viewer
+/// can't keep up the packets it hasn't taken yet are reused and frames get dropped instead
+///
+/// Only one viewer is served at a time. Nothing is built while nobody is connected, so leaving it listening costs the
+/// frame a single atomic load
+///
+/// Every message starts with it's size (u32, not including the 5 byte header) and it's type (u8), everything is little
+/// endian:
+///		Hello - the magic (u32), the version (u16), then the memory tags and render layers, each as a count (u8) followed
+///			by their names (a u8 length then the characters). Sent once when a viewer connects
+///		Name - the id (u16) that stands in for a zone's name from here on, then the name (a u8 length then the
+///			characters). Sent the first time each zone is seen on a connection, ahead of the frame that uses it
+///		Frame - see EndFrame for the layout
+/// </summary>
+class RemoteProfiler final
+{
+public:
+	/// <summary>
+	/// The port we listen on when one isn't given
+	/// </summary>
+	static const uint16_t DEFAULT_PORT = 28960;
+
+	enum class MessageType : uint8_t {
+		Hello = 1,
+		Name,
+		Frame
+	};
+
+	/// <summary>
+	/// Starts listening for a viewer on the given port
+	/// </summary>
+	/// <returns>True if the port could be bound</returns>
+	static bool Start(uint16_t port = DEFAULT_PORT);
+	/// <summary>
+	/// Disconnects the viewer and stops listening, should be called before SystemMonitor::Stop
+	/// </summary>
+	static void Stop();
+
+	/// <summary>
+	/// Sends the frame that just finished to the viewer if one is connected, should be called on the main thread right
+	/// after CpuProfiler::EndFrame. A frame is laid out as:
+	///		the frame's index (u32), the start of it's first zone on the CPU profiler's clock in nanoseconds (u64)
+	///		the CPU zone count (u16), then for each the name's id (u16), thread (u8), depth (u8) and it's start from the
+	///			first zone and duration in nanoseconds (u32 each)
+	///		the GPU zone count (u16, 0 unless new results were read back), then the start of the first one on the CPU
+	///			profiler's clock (u64) if there are any, followed by each zone in the same layout as the CPU's
+	///		the render stats, the frame's totals in the order RenderStats::Counters declares them (11 x u64), each
+	///			layer's draw calls (u32 each), and the culled objects, occluded objects and culled lights (u32 each)
+	///		each memory tag's current usage in bytes (i64 each)
+	///		the process' memory and peak memory, the GPU's free and total memory (in MB) and the CPU usage (percent
+	///			of all cores) from the latest system monitor sample (5 x f32)
+	/// </summary>
+	static void EndFrame();
+
+	static bool IsListening() { return _isRunning; }
+	static bool IsConnected() { return _isConnected.load(std::memory_order_acquire); }
+	static uint16_t GetPort() { return _port; }
+	/// <summary>
+	/// Gets how many frames have been handed to the network thread, and how many were dropped because it was behind
+	/// </summary>
+	static uint32_t GetSentFrames() { return _sentFrames; }
+	static uint32_t GetDroppedFrames() { return _droppedFrames; }
+
+protected:
+	RemoteProfiler() = default;
+
+	// Bump this whenever the layout of a message changes
+	static const uint16_t PROTOCOL_VERSION = 1;
+	// How many packets can be waiting for the network thread at once, this many frames can be buffered
+	static const size_t   PACKET_COUNT = 32;
+
+	struct Packet {
+		// The connection the packet was built for, packets for an older one are thrown away rather than sent
+		uint32_t             Connection;
+		std::vector<uint8_t> Data;
+	};
+
+	// Finds the id for a zone's name, adding a Name message to the packet the first time it's seen
+	static uint16_t _GetNameId(Packet& packet, const char* name);
+	static void _Run(uint64_t listenSocket);
+
+	static bool                                     _isRunning;
+	static uint16_t                                 _port;
+	static std::thread                              _thread;
+	static std::atomic<bool>                        _isStopping;
+	static std::atomic<bool>                        _isConnected;
+	// Bumped by the network thread every time a viewer connects, the main thread starts the names over when it changes
+	static std::atomic<uint32_t>                    _connection;
+	static std::vector<std::unique_ptr<Packet>>     _packets;
+	// Packets go out to the network thread through _outgoing, and come back through _free once they've been sent
+	static TTK::SpscQueue<Packet*, PACKET_COUNT>    _outgoing;
+	static TTK::SpscQueue<Packet*, PACKET_COUNT>    _free;
+
+	// Only touched by the main thread
+	static uint32_t                                 _nameConnection;
+	static std::unordered_map<const char*, uint16_t> _names;
+	static uint64_t                                 _gpuVersion;
+	static uint64_t                                 _lastSystemSample;
+	static SystemMonitor::Snapshot                  _system;
+	static uint32_t                                 _frameIndex;
+	static uint32_t                                 _sentFrames;
+	static uint32_t                                 _droppedFrames;
+};
@@ -0,0 +1,208 @@
+#include "StartupReport.h"
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+
+#include "CpuProfiler.h"
+#include "Logging.h"
+
+std::atomic<bool>                StartupReport::_isRecording(false);
+std::mutex                       StartupReport::_lock;
+std::vector<StartupReport::Span> StartupReport::_spans;
+std::thread::id                  StartupReport::_mainThread;
+uint64_t                         StartupReport::_begin = 0;
+std::string                      StartupReport::_stageName;
+uint64_t                         StartupReport::_stageStart = 0;
+double                           StartupReport::_timeToFirstFrame = 0.0;
+
+// How many of the biggest contributors get logged, the rest only go to the file
+static const size_t LOGGED_ENTRIES = 12;
+
+namespace {
+	// Everything recorded under one name, ex: a mesh's parse on a worker and it's upload on the main thread
+	struct Entry {
+		std::string Name;
+		uint64_t    Wall = 0;
+		uint64_t    Critical = 0;
+		uint32_t    Count = 0;
+		bool        OnMain = false;
+		bool        OnWorker = false;
+	};
+}
+
+StartupReport::Scope::Scope(const std::string& name, SpanKind kind) :
+	_name(name), _kind(kind), _start(CpuProfiler::Now()) { }
+
+StartupReport::Scope::~Scope() {
+	Record(_name, _kind, _start, CpuProfiler::Now());
+}
+
+void StartupReport::Begin() {
+	std::lock_guard<std::mutex> lock(_lock);
+	_spans.clear();
+	_mainThread = std::this_thread::get_id();
+	_begin = CpuProfiler::Now();
+	_stageName = "Startup";
+	_stageStart = _begin;
+	_timeToFirstFrame = 0.0;
+	_isRecording = true;
+}
+
+void StartupReport::BeginStage(const char* name) {
+	if (!IsRecording()) {
+		return;
+	}
+	const uint64_t now = CpuProfiler::Now();
+	Record(_stageName, SpanKind::Stage, _stageStart, now);
+	_stageName = name;
+	_stageStart = now;
+}
+
+void StartupReport::Record(const std::string& name, SpanKind kind, uint64_t start, uint64_t end) {
+	if (!IsRecording() || end <= start) {
+		return;
+	}
+	const bool isMainThread = std::this_thread::get_id() == _mainThread;
+	std::lock_guard<std::mutex> lock(_lock);
+	_spans.push_back({ name, kind, isMainThread, start, end });
+}
+
+void StartupReport::Finish(const std::string& path) {
+	if (!IsRecording()) {
+		return;
+	}
+	const uint64_t finish = CpuProfiler::Now();
+	Record(_stageName, SpanKind::Stage, _stageStart, finish);
+	_isRecording = false;
+	_timeToFirstFrame = (finish - _begin) / 1000000.0;
+
+	std::vector<Span> spans;
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		spans.swap(_spans);
+	}
+
+	std::vector<Entry> entries;
+	std::unordered_map<std::string, size_t> entryIndices;
+	auto getEntry = [&](const std::string& name) -> Entry& {
+		auto it = entryIndices.find(name);
+		if (it == entryIndices.end()) {
+			it = entryIndices.emplace(name, entries.size()).first;
+			entries.push_back(Entry());
+			entries.back().Name = name;
+		}
+		return entries[it->second];
+	};
+
+	std::vector<const Span*> mainSpans;
+	std::vector<const Span*> workerSpans;
+	for (const Span& span : spans) {
+		// Stages are already in the timeline, and waits are what we're charging to everything else
+		if (span.Kind == SpanKind::Asset) {
+			Entry& entry = getEntry(span.Name);
+			entry.Wall += span.End - span.Start;
+			entry.Count++;
+			(span.IsMainThread ? entry.OnMain : entry.OnWorker) = true;
+		} else if (span.Kind == SpanKind::Stage) {
+			getEntry(span.Name).Count++;
+		}
+		(span.IsMainThread ? mainSpans : workerSpans).push_back(&span);
+	}
+
+	// Charges a stretch of the main thread being blocked to the worker loads running during it. At any moment the
+	// one that's going to finish last is what's holding us up, so that's the one that gets charged
+	auto chargeWait = [&](uint64_t begin, uint64_t end) {
+		std::vector<uint64_t> cuts = { begin, end };
+		for (const Span* span : workerSpans) {
+			if (span->Kind == SpanKind::Asset && span->Start < end && span->End > begin) {
+				cuts.push_back(std::max(span->Start, begin));
+				cuts.push_back(std::min(span->End, end));
+			}
+		}
+		std::sort(cuts.begin(), cuts.end());
+		cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+		for (size_t ix = 0; ix + 1 < cuts.size(); ix++) {
+			const Span* holdup = nullptr;
+			for (const Span* span : workerSpans) {
+				if (span->Kind == SpanKind::Asset && span->Start <= cuts[ix] && span->End >= cuts[ix + 1] &&
+					(holdup == nullptr || span->End > holdup->End || (span->End == holdup->End && span->Start > holdup->Start))) {
+					holdup = span;
+				}
+			}
+			getEntry(holdup != nullptr ? holdup->Name : "(waiting, no loads running)").Critical += cuts[ix + 1] - cuts[ix];
+		}
+	};
+	// The innermost span on the main thread owns each stretch of it's time
+	auto charge = [&](const Span* owner, uint64_t begin, uint64_t end) {
+		if (end <= begin) {
+			return;
+		}
+		if (owner == nullptr) {
+			getEntry("(main thread, untracked)").Critical += end - begin;
+		} else if (owner->Kind == SpanKind::Wait) {
+			chargeWait(begin, end);
+		} else {
+			Entry& entry = getEntry(owner->Name);
+			entry.Critical += end - begin;
+			if (owner->Kind == SpanKind::Stage) {
+				entry.Wall += end - begin;
+				entry.OnMain = true;
+			}
+		}
+	};
+
+	// Spans on one thread nest, so sorting outer spans first lets us sweep the timeline with a stack
+	std::sort(mainSpans.begin(), mainSpans.end(), [](const Span* l, const Span* r) {
+		return l->Start != r->Start ? l->Start < r->Start : l->End > r->End;
+	});
+	std::vector<const Span*> stack;
+	uint64_t cursor = _begin;
+	for (const Span* span : mainSpans) {
+		while (!stack.empty() && stack.back()->End <= span->Start) {
+			charge(stack.back(), cursor, stack.back()->End);
+			cursor = std::max(cursor, stack.back()->End);
+			stack.pop_back();
+		}
+		charge(stack.empty() ? nullptr : stack.back(), cursor, span->Start);
+		cursor = std::max(cursor, span->Start);
+		stack.push_back(span);
+	}
+	while (!stack.empty()) {
+		charge(stack.back(), cursor, std::min(stack.back()->End, finish));
+		cursor = std::max(cursor, std::min(stack.back()->End, finish));
+		stack.pop_back();
+	}
+	charge(nullptr, cursor, finish);
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& l, const Entry& r) {
+		return l.Critical != r.Critical ? l.Critical > r.Critical : l.Wall > r.Wall;
+	});
+	auto formatEntry = [](const Entry& entry) {
+		const char* thread = entry.OnMain ? (entry.OnWorker ? "both" : "main") : "worker";
+		return fmt::format("{:>10.2f} {:>10.2f} {:>7} {:>5}  {}", entry.Critical / 1000000.0, entry.Wall / 1000000.0,
+			thread, entry.Count, entry.Name);
+	};
+	const std::string header = fmt::format("{:>10} {:>10} {:>7} {:>5}  {}", "critical", "wall", "thread", "count", "name");
+
+	LOG_INFO("First frame presented {:.2f}ms after startup, biggest contributors (in ms):", _timeToFirstFrame);
+	LOG_INFO("  {}", header);
+	for (size_t ix = 0; ix < entries.size() && ix < LOGGED_ENTRIES; ix++) {
+		LOG_INFO("  {}", formatEntry(entries[ix]));
+	}
+
+	if (!path.empty()) {
+		std::ofstream file(path);
+		if (!file) {
+			LOG_WARN("Failed to write the startup report to {}", path);
+			return;
+		}
+		file << fmt::format("Time to first frame: {:.2f}ms\n", _timeToFirstFrame);
+		file << "Times are in milliseconds. Critical is how much of the time to first frame the entry held up the main\n";
+		file << "thread for, wall is how long it took on whichever threads ran it\n\n";
+		file << header << "\n";
+		for (const Entry& entry : entries) {
+			file << formatEntry(entry) << "\n";
+		}
+		LOG_INFO("Wrote the startup report to {}", path);
+	}
+}
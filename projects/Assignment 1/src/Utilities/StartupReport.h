@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Measures how long it takes to get from the top of main to the first frame on screen, and what that time went to.
+/// The main thread marks off the stages of startup, every asset load (see AssetLoadScope) is recorded on whichever
+/// thread ran it, and the time the main thread spends blocked waiting on jobs is recorded as well
+///
+/// Once the first frame is presented, Finish walks the main thread's timeline. Time spent in a stage or a load on the
+/// main thread is on the critical path outright, while time spent waiting is charged to the worker loads that were
+/// still running, the one finishing last first, since those are what held the main thread up. Everything else was
+/// hidden behind the main thread, and only shows up as wall time
+/// </summary>
+class StartupReport final
+{
+public:
+	enum class SpanKind : uint8_t {
+		// A step of startup on the main thread, marked with BeginStage
+		Stage,
+		// An asset being loaded, decoded or uploaded, on any thread
+		Asset,
+		// The main thread blocked on jobs it's waiting for
+		Wait
+	};
+
+	/// <summary>
+	/// Records a span for as long as it's in scope
+	/// </summary>
+	class Scope final {
+	public:
+		Scope(const std::string& name, SpanKind kind);
+		~Scope();
+		Scope(const Scope& other) = delete;
+		Scope& operator=(const Scope& other) = delete;
+	private:
+		std::string _name;
+		SpanKind    _kind;
+		uint64_t    _start;
+	};
+
+	/// <summary>
+	/// Starts the clock, should be the first thing main does. The calling thread is treated as the main thread
+	/// </summary>
+	static void Begin();
+	/// <summary>
+	/// Ends the current stage of startup and starts the next one, must be called on the main thread
+	/// </summary>
+	/// <param name="name">The name of the stage</param>
+	static void BeginStage(const char* name);
+	/// <summary>
+	/// Records a span that has finished, can be called from any thread. Ignored once the report has been finished
+	/// </summary>
+	/// <param name="name">The name of the stage or asset</param>
+	/// <param name="kind">What the span was doing</param>
+	/// <param name="start">The time the span started, from CpuProfiler::Now</param>
+	/// <param name="end">The time the span ended, from CpuProfiler::Now</param>
+	static void Record(const std::string& name, SpanKind kind, uint64_t start, uint64_t end);
+	/// <summary>
+	/// Stops recording and works out the report, logging the biggest contributors. Should be called once the first
+	/// frame has been presented
+	/// </summary>
+	/// <param name="path">A file to write the full report to, or empty to only log it</param>
+	static void Finish(const std::string& path = "");
+
+	/// <summary>
+	/// Returns true between Begin and Finish
+	/// </summary>
+	static bool IsRecording() { return _isRecording.load(std::memory_order_relaxed); }
+	/// <summary>
+	/// Gets the time from Begin to Finish in milliseconds, or 0 if the report isn't finished yet
+	/// </summary>
+	static double GetTimeToFirstFrame() { return _timeToFirstFrame; }
+
+private:
+	struct Span {
+		std::string Name;
+		SpanKind    Kind;
+		bool        IsMainThread;
+		uint64_t    Start;
+		uint64_t    End;
+	};
+
+	static std::atomic<bool> _isRecording;
+	static std::mutex        _lock;
+	static std::vector<Span> _spans;
+	static std::thread::id   _mainThread;
+	static uint64_t          _begin;
+	static std::string       _stageName;
+	static uint64_t          _stageStart;
+	static double            _timeToFirstFrame;
+};
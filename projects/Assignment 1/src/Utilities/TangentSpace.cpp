@@ -0,0 +1,127 @@
+#include "TangentSpace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <GLM/gtc/packing.hpp>
+
+#include "ThreadPool.h"
+
+// The fewest triangles (or vertices) worth handing to another thread, either pass only does a little math for each
+static const size_t MIN_BATCH = 4096;
+// Anything shorter than this is treated as zero, which is far below what the packed formats can hold anyways
+static const float  EPSILON   = 1e-12f;
+
+// Reads a vector out of a strided array
+template <typename T>
+static T Fetch(const float* data, size_t stride, uint32_t index) {
+	T result;
+	memcpy(&result, reinterpret_cast<const uint8_t*>(data) + index * stride, sizeof(T));
+	return result;
+}
+
+// Normalizes a vector, leaving it zero if it's too short to have a direction
+static glm::vec3 SafeNormalize(const glm::vec3& v) {
+	const float lengthSq = glm::dot(v, v);
+	return lengthSq > EPSILON ? v / glm::sqrt(lengthSq) : glm::vec3(0.0f);
+}
+
+// What each triangle hands to the vertices at it's corners
+struct TriangleFrame {
+	// The directions that U and V increase in across the triangle, zero if the triangle has no area in UV space
+	glm::vec3 Tangent;
+	glm::vec3 Bitangent;
+	// The angle at each corner, used to weight the corners when they get added up
+	float     Angles[3];
+};
+
+size_t TangentSpace::Generate(const float* positions, const float* normals, const float* uvs, size_t stride, size_t vertexCount,
+	const uint32_t* indices, size_t indexCount, glm::vec4* tangents, size_t tangentStride)
+{
+	const size_t triangleCount = indexCount / 3;
+	uint8_t* output = reinterpret_cast<uint8_t*>(tangents);
+
+	// First the triangles, which are all independent of each other
+	std::vector<TriangleFrame> frames(triangleCount);
+	ThreadPool::Instance().ParallelFor(triangleCount, MIN_BATCH, [&](size_t begin, size_t end) {
+		for (size_t tri = begin; tri < end; tri++) {
+			const uint32_t* corners = indices + tri * 3;
+			const glm::vec3 p[3] = {
+				Fetch<glm::vec3>(positions, stride, corners[0]),
+				Fetch<glm::vec3>(positions, stride, corners[1]),
+				Fetch<glm::vec3>(positions, stride, corners[2])
+			};
+			const glm::vec2 t0 = Fetch<glm::vec2>(uvs, stride, corners[0]);
+			const glm::vec2 t1 = Fetch<glm::vec2>(uvs, stride, corners[1]);
+			const glm::vec2 t2 = Fetch<glm::vec2>(uvs, stride, corners[2]);
+
+			// Solve for how the position changes with U and V. Rather than dividing by the determinant we only take it's
+			// sign, since the lengths get thrown away anyways and tiny UV triangles would blow up otherwise
+			const glm::vec3 e1 = p[1] - p[0];
+			const glm::vec3 e2 = p[2] - p[0];
+			const glm::vec2 d1 = t1 - t0;
+			const glm::vec2 d2 = t2 - t0;
+			const float det = d1.x * d2.y - d2.x * d1.y;
+			TriangleFrame& frame = frames[tri];
+			if (glm::abs(det) > EPSILON) {
+				const float orientation = det > 0.0f ? 1.0f : -1.0f;
+				frame.Tangent   = SafeNormalize((e1 * d2.y - e2 * d1.y) * orientation);
+				frame.Bitangent = SafeNormalize((e2 * d1.x - e1 * d2.x) * orientation);
+			} else {
+				frame.Tangent = frame.Bitangent = glm::vec3(0.0f);
+			}
+			for (int corner = 0; corner < 3; corner++) {
+				const glm::vec3 a = SafeNormalize(p[(corner + 1) % 3] - p[corner]);
+				const glm::vec3 b = SafeNormalize(p[(corner + 2) % 3] - p[corner]);
+				frame.Angles[corner] = glm::acos(glm::clamp(glm::dot(a, b), -1.0f, 1.0f));
+			}
+		}
+	});
+
+	// Group the corners by vertex, so each vertex can add up it's own corners without any other thread touching it
+	std::vector<uint32_t> firstCorner(vertexCount + 1, 0);
+	for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+		firstCorner[indices[ix] + 1]++;
+	}
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		firstCorner[ix + 1] += firstCorner[ix];
+	}
+	std::vector<uint32_t> corners(triangleCount * 3);
+	std::vector<uint32_t> cursor(firstCorner.begin(), firstCorner.end() - 1);
+	for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+		corners[cursor[indices[ix]]++] = static_cast<uint32_t>(ix);
+	}
+
+	std::vector<uint8_t> missing(vertexCount, 0);
+	ThreadPool::Instance().ParallelFor(vertexCount, MIN_BATCH, [&](size_t begin, size_t end) {
+		for (size_t vertex = begin; vertex < end; vertex++) {
+			const glm::vec3 normal = SafeNormalize(Fetch<glm::vec3>(normals, stride, static_cast<uint32_t>(vertex)));
+			glm::vec3 tangent(0.0f);
+			glm::vec3 bitangent(0.0f);
+			for (uint32_t ix = firstCorner[vertex]; ix < firstCorner[vertex + 1]; ix++) {
+				const TriangleFrame& frame = frames[corners[ix] / 3];
+				const float angle = frame.Angles[corners[ix] % 3];
+				// Each corner's directions get flattened onto the vertex's tangent plane before they're weighted
+				tangent   += SafeNormalize(frame.Tangent - normal * glm::dot(normal, frame.Tangent)) * angle;
+				bitangent += SafeNormalize(frame.Bitangent - normal * glm::dot(normal, frame.Bitangent)) * angle;
+			}
+
+			// Gram-Schmidt against the normal once more, since the sum of the corners can drift off the plane
+			tangent = SafeNormalize(tangent - normal * glm::dot(normal, tangent));
+			glm::vec4 result(0.0f);
+			if (tangent != glm::vec3(0.0f) && normal != glm::vec3(0.0f)) {
+				const float handedness = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+				result = glm::vec4(tangent, handedness);
+			} else {
+				missing[vertex] = 1;
+			}
+			memcpy(output + vertex * tangentStride, &result, sizeof(glm::vec4));
+		}
+	});
+	return static_cast<size_t>(std::count(missing.begin(), missing.end(), static_cast<uint8_t>(1)));
+}
+
+uint32_t TangentSpace::Pack(const glm::vec4& tangent) {
+	return glm::packSnorm3x10_1x2(tangent);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Works out the tangents that normal maps are sampled with, following the same conventions as MikkTSpace so that
+/// normal maps baked against MikkTSpace (which most tools do) come out right:
+///   - each corner of a triangle gets the direction that the U and V coordinates run in across the triangle,
+///     projected onto the plane of that corner's vertex normal, and weighted by the angle of the corner
+///   - each vertex's tangent is the sum over it's corners, orthonormalized against the normal, with the handedness
+///     of it's bitangent stored in w
+///   - the bitangent is never stored, the shader rebuilds it as cross(normal, tangent) * w, without normalizing
+/// Unlike MikkTSpace we don't split vertices where the tangents disagree, vertices are only split where the UVs or
+/// normals already are (as the OBJ loader does), which covers mirrored UV islands since their UVs differ
+///
+/// The triangles are done in parallel on the ThreadPool, then each vertex gathers it's corners in parallel, so no
+/// two threads ever add into the same vertex and the result is the same regardless of the thread count
+///
+/// These work on the raw vertex and index data so they don't care about the vertex type, see
+/// MeshBuilder::GenerateTangents
+/// </summary>
+class TangentSpace final
+{
+public:
+	/// <summary>
+	/// Works out a tangent for every vertex of an indexed triangle list. Vertices that no triangle uses, or whose
+	/// triangles have no area in UV space, get a zero tangent (the shaders fall back to the vertex normal for those)
+	/// </summary>
+	/// <param name="positions">The x, y and z of the first vertex's position</param>
+	/// <param name="normals">The x, y and z of the first vertex's normal</param>
+	/// <param name="uvs">The u and v of the first vertex's texture coordinates</param>
+	/// <param name="stride">The number of bytes between one vertex and the next, for all three attributes</param>
+	/// <param name="vertexCount">The number of vertices</param>
+	/// <param name="indices">The triangle list, 3 indices per triangle</param>
+	/// <param name="indexCount">The number of indices</param>
+	/// <param name="tangents">Filled with the tangent for each vertex, must have room for vertexCount tangents</param>
+	/// <param name="tangentStride">The number of bytes between one tangent and the next</param>
+	/// <returns>The number of vertices that got a zero tangent</returns>
+	static size_t Generate(const float* positions, const float* normals, const float* uvs, size_t stride, size_t vertexCount,
+		const uint32_t* indices, size_t indexCount, glm::vec4* tangents, size_t tangentStride = sizeof(glm::vec4));
+
+	/// <summary>
+	/// Packs a tangent down to 10:10:10:2 signed normalized, the same way the packed vertex types store them
+	/// </summary>
+	static uint32_t Pack(const glm::vec4& tangent);
+
+protected:
+	TangentSpace() = default;
+};
@@ -0,0 +1,128 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/// <summary>
+/// A small forward-only tokenizer for line based text formats (OBJ and friends). It works directly on a block of
+/// memory (ex: a MappedFile), and never allocates or copies, numbers are parsed in place with std::from_chars
+/// </summary>
+class TextScanner final
+{
+public:
+	TextScanner(const char* begin, const char* end) :
+		_pos(begin), _end(end) { }
+	~TextScanner() = default;
+
+	/// <summary>
+	/// Splits a block of text into pieces of roughly the given size, each ending on a line break, so the pieces can
+	/// be scanned on different threads without any line getting cut in half
+	/// </summary>
+	/// <param name="begin">The start of the text</param>
+	/// <param name="end">The end of the text</param>
+	/// <param name="chunkSize">The size to aim for, in bytes. Pieces run on to the end of the line they land in</param>
+	/// <returns>The pieces, in the order they appear in the text</returns>
+	static std::vector<std::string_view> SplitLines(const char* begin, const char* end, size_t chunkSize) {
+		std::vector<std::string_view> result;
+		chunkSize = chunkSize > 0 ? chunkSize : 1;
+		while (begin < end) {
+			const char* split = static_cast<size_t>(end - begin) > chunkSize ? begin + chunkSize : end;
+			while (split < end && split[-1] != '\n') {
+				split++;
+			}
+			result.emplace_back(begin, split - begin);
+			begin = split;
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// Returns true once we have reached the end of the text
+	/// </summary>
+	bool IsEnd() const { return _pos >= _end; }
+
+	/// <summary>
+	/// Skips spaces and tabs, but stops at the end of the line
+	/// </summary>
+	void SkipSpaces() {
+		while (_pos < _end && (*_pos == ' ' || *_pos == '\t')) {
+			_pos++;
+		}
+	}
+	/// <summary>
+	/// Skips the rest of the current line, including it's line ending
+	/// </summary>
+	void SkipLine() {
+		while (_pos < _end && *_pos != '\n') {
+			_pos++;
+		}
+		if (_pos < _end) {
+			_pos++;
+		}
+	}
+	/// <summary>
+	/// Skips any trailing spaces, and returns true if there is nothing left on the current line
+	/// </summary>
+	bool IsLineEnd() {
+		SkipSpaces();
+		return _pos >= _end || *_pos == '\n' || *_pos == '\r' || *_pos == '#';
+	}
+
+	/// <summary>
+	/// Reads the next run of non-whitespace characters on this line
+	/// </summary>
+	/// <returns>A view of the token within the text, empty if there was nothing left on the line</returns>
+	std::string_view ReadToken() {
+		SkipSpaces();
+		const char* start = _pos;
+		while (_pos < _end && *_pos != ' ' && *_pos != '\t' && *_pos != '\n' && *_pos != '\r') {
+			_pos++;
+		}
+		return std::string_view(start, _pos - start);
+	}
+
+	/// <summary>
+	/// Consumes the given character if it is the next one in the text
+	/// </summary>
+	/// <returns>True if the character was consumed</returns>
+	bool Consume(char c) {
+		if (_pos < _end && *_pos == c) {
+			_pos++;
+			return true;
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// Reads a number after skipping any leading spaces, the value is left untouched if there is no number to read
+	/// </summary>
+	/// <returns>True if a number was read</returns>
+	template <typename T>
+	bool Read(T& value) {
+		SkipSpaces();
+		// from_chars doesn't accept a leading plus, but plenty of exporters write them
+		const char* start = (_pos < _end && *_pos == '+') ? _pos + 1 : _pos;
+		std::from_chars_result result = std::from_chars(start, _end, value);
+		if (result.ec != std::errc()) {
+			return false;
+		}
+		_pos = result.ptr;
+		return true;
+	}
+
+	/// <summary>
+	/// Reads up to count numbers into values, stopping at the first token that isn't a number
+	/// </summary>
+	/// <returns>The number of values that were read</returns>
+	template <typename T>
+	int Read(T* values, int count) {
+		int ix = 0;
+		for (; ix < count && Read(values[ix]); ix++) { }
+		return ix;
+	}
+
+private:
+	const char* _pos;
+	const char* _end;
+};
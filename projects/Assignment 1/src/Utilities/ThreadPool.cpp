@@ -0,0 +1,298 @@
+#include "ThreadPool.h"
+#include "CpuProfiler.h"
+#include "CpuTopology.h"
+#include "Logging.h"
+#include "StartupReport.h"
+#include "Sys.h"
+
+#include <chrono>
+
+// The index of the worker running on this thread, or -1 if this isn't one of our workers
+static thread_local int workerIndex = -1;
+thread_local bool ThreadPool::_isInParallelFor = false;
+
+// How long a waiting thread sleeps before checking for work again, in case it misses a wake up
+static const std::chrono::milliseconds WAIT_TIMEOUT(2);
+// The fewest physical cores worth pinning workers on, below this we let the OS spread the threads over what there is
+static const uint32_t MIN_PINNED_CORES = 3;
+// The fewest physical cores where we can give one up to the audio thread, on smaller machines it shares with the workers
+static const uint32_t MIN_AUDIO_CORES = 8;
+
+ThreadPool::ThreadPool() :
+	_mainThread(std::this_thread::get_id()),
+	_reservedCores(0),
+	_queued(0),
+	_queuedFrame(0),
+	_isRunning(false)
+{ }
+
+ThreadPool::~ThreadPool() {
+	Shutdown();
+}
+
+void ThreadPool::Init(uint32_t threadCount) {
+	LOG_ASSERT(!_isRunning, "Thread pool has already been initialized!");
+	_reservedCores = 0;
+	const uint32_t cores = CpuTopology::GetCoreCount();
+	if (threadCount == 0 && cores >= MIN_PINNED_CORES) {
+		// A worker on each physical core that isn't kept for the main thread (which is still doing all the
+		// rendering) or the audio thread, a second worker on a hyperthread would only fight the first over the core
+		_reservedCores = cores >= MIN_AUDIO_CORES ? 2 : 1;
+		threadCount = cores - _reservedCores;
+		if (!CpuTopology::PinCurrentThread(0)) {
+			LOG_WARN("Failed to pin the main thread to it's core");
+		}
+	} else if (threadCount == 0) {
+		// Leave a core for the main thread, which is still doing all the rendering
+		uint32_t processors = std::thread::hardware_concurrency();
+		threadCount = processors > 1 ? processors - 1 : 1;
+	}
+	_mainThread = std::this_thread::get_id();
+	_isRunning = true;
+	// Every queue needs to exist before any of the workers start looking for work to steal
+	std::vector<uint32_t> nodes(threadCount, 0);
+	for (uint32_t ix = 0; ix < threadCount; ix++) {
+		_workers.push_back(std::make_unique<Worker>());
+		if (_reservedCores > 0) {
+			nodes[ix] = CpuTopology::GetCore(_reservedCores + ix).Node;
+		}
+	}
+	// Steal from the workers after us first, so idle workers don't all pile onto the same queue, but stay on our own
+	// node for as long as there's anything there
+	for (uint32_t ix = 0; ix < threadCount; ix++) {
+		std::vector<uint32_t>& victims = _workers[ix]->Victims;
+		for (uint32_t offset = 1; offset < threadCount; offset++) {
+			victims.push_back((ix + offset) % threadCount);
+		}
+		std::stable_partition(victims.begin(), victims.end(), [&nodes, ix](uint32_t victim) { return nodes[victim] == nodes[ix]; });
+	}
+	for (uint32_t ix = 0; ix < threadCount; ix++) {
+		_workers[ix]->Thread = std::thread(&ThreadPool::_WorkerMain, this, ix);
+		if (_reservedCores > 0 && !CpuTopology::PinThread(_workers[ix]->Thread.native_handle(), _reservedCores + ix)) {
+			LOG_WARN("Failed to pin worker {} to it's core", ix);
+		}
+	}
+	if (_reservedCores > 0) {
+		LOG_INFO("Started thread pool with {} threads, pinned across {} cores on {} nodes", threadCount, cores, CpuTopology::GetNodeCount());
+	} else {
+		LOG_INFO("Started thread pool with {} threads", threadCount);
+	}
+}
+
+void ThreadPool::Shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_isRunning) {
+			return;
+		}
+		_isRunning = false;
+		for (std::deque<std::function<void()>>& jobs : _jobs) {
+			jobs.clear();
+		}
+	}
+	_jobReady.notify_all();
+	for (std::unique_ptr<Worker>& worker : _workers) {
+		worker->Thread.join();
+	}
+	_workers.clear();
+	_queued = 0;
+	_queuedFrame = 0;
+	_reservedCores = 0;
+
+	std::lock_guard<std::mutex> lock(_mainMutex);
+	_mainJobs.clear();
+}
+
+bool ThreadPool::IsWorkerThread() {
+	return workerIndex != -1;
+}
+
+int ThreadPool::GetWorkerIndex() {
+	return workerIndex;
+}
+
+int ThreadPool::GetReservedCore(ReservedCore thread) const {
+	const uint32_t core = static_cast<uint32_t>(thread);
+	return core < _reservedCores ? static_cast<int>(core) : -1;
+}
+
+uint32_t ThreadPool::RunMainThreadJobs(double maxMilliseconds) {
+	LOG_ASSERT(IsMainThread(), "Main thread jobs can only be run from the main thread!");
+	typedef std::chrono::high_resolution_clock Clock;
+	const Clock::time_point start = Clock::now();
+	uint32_t count = 0;
+	while (true) {
+		std::function<void()> job;
+		{
+			std::lock_guard<std::mutex> lock(_mainMutex);
+			if (_mainJobs.empty()) {
+				break;
+			}
+			job = std::move(_mainJobs.front());
+			_mainJobs.pop_front();
+		}
+		job();
+		count++;
+		if (std::chrono::duration<double, std::milli>(Clock::now() - start).count() >= maxMilliseconds) {
+			break;
+		}
+	}
+	return count;
+}
+
+void ThreadPool::_Post(std::function<void()>&& job, JobThread thread, JobPriority priority) {
+	if (thread == JobThread::Main) {
+		{
+			std::lock_guard<std::mutex> lock(_mainMutex);
+			_mainJobs.push_back(std::move(job));
+		}
+		_progress.notify_all();
+		return;
+	}
+
+	// With no workers, there's nobody else to run the job
+	if (_workers.empty()) {
+		job();
+		return;
+	}
+
+	const size_t level = static_cast<size_t>(priority);
+	if (workerIndex != -1) {
+		// Our own queue stays hot in our cache, and anyone who runs out of work will come and steal from it
+		Worker& worker = *_workers[workerIndex];
+		std::lock_guard<std::mutex> lock(worker.Mutex);
+		worker.Jobs[level].push_back(std::move(job));
+	} else {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs[level].push_back(std::move(job));
+	}
+	{
+		// Bumping the count under the lock means a worker can't miss it between checking and going to sleep
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queued++;
+		if (priority == JobPriority::Frame) {
+			_queuedFrame++;
+		}
+	}
+	_jobReady.notify_one();
+}
+
+bool ThreadPool::_PopWorkerJob(std::function<void()>& job) {
+	// A Frame job anywhere goes before a Background job on our own queue, since the frame can't end without it
+	if (_queuedFrame > 0 && _PopWorkerJob(job, JobPriority::Frame)) {
+		return true;
+	}
+	return _PopWorkerJob(job, JobPriority::Background);
+}
+
+bool ThreadPool::_PopWorkerJob(std::function<void()>& job, JobPriority priority) {
+	const size_t level = static_cast<size_t>(priority);
+	// Counts a job as taken, under whichever lock it was taken with
+	auto take = [this, &job, priority](std::deque<std::function<void()>>& jobs, bool newest) {
+		if (newest) {
+			job = std::move(jobs.back());
+			jobs.pop_back();
+		} else {
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		_queued--;
+		if (priority == JobPriority::Frame) {
+			_queuedFrame--;
+		}
+	};
+
+	const int self = workerIndex;
+	if (self != -1) {
+		Worker& worker = *_workers[self];
+		std::lock_guard<std::mutex> lock(worker.Mutex);
+		if (!worker.Jobs[level].empty()) {
+			take(worker.Jobs[level], true);
+			return true;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_jobs[level].empty()) {
+			take(_jobs[level], false);
+			return true;
+		}
+	}
+	// Threads that aren't workers have no node of their own, so they just go through everyone in order
+	const size_t count = self != -1 ? _workers[self]->Victims.size() : _workers.size();
+	for (size_t ix = 0; ix < count; ix++) {
+		Worker& worker = *_workers[self != -1 ? _workers[self]->Victims[ix] : ix];
+		std::lock_guard<std::mutex> lock(worker.Mutex);
+		if (!worker.Jobs[level].empty()) {
+			take(worker.Jobs[level], false);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ThreadPool::_RunOneJob() {
+	std::function<void()> job;
+	// The main thread's own jobs can only run here, so they go first
+	if (IsMainThread()) {
+		std::lock_guard<std::mutex> lock(_mainMutex);
+		if (!_mainJobs.empty()) {
+			job = std::move(_mainJobs.front());
+			_mainJobs.pop_front();
+		}
+	}
+	if (!job && !_PopWorkerJob(job)) {
+		return false;
+	}
+	job();
+	return true;
+}
+
+void ThreadPool::_WaitForProgress(const std::function<bool()>& isDone) {
+	std::unique_lock<std::mutex> lock(_mainMutex);
+	const bool isMain = IsMainThread();
+	_progress.wait_for(lock, WAIT_TIMEOUT, [&]() {
+		return (isMain && !_mainJobs.empty()) || _queued > 0 || isDone();
+	});
+}
+
+void ThreadPool::_NotifyProgress() {
+	{
+		// Taking the lock makes sure a waiting thread is either asleep or hasn't checked yet
+		std::lock_guard<std::mutex> lock(_mainMutex);
+	}
+	_progress.notify_all();
+}
+
+void ThreadPool::_WorkerMain(uint32_t index) {
+	workerIndex = static_cast<int>(index);
+	SystemMonitor::RegisterThread("Worker " + std::to_string(index));
+	while (true) {
+		std::function<void()> job;
+		if (_PopWorkerJob(job)) {
+			job();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(_mutex);
+		_jobReady.wait(lock, [this]() { return _queued > 0 || !_isRunning; });
+		if (!_isRunning) {
+			break;
+		}
+	}
+	SystemMonitor::UnregisterThread();
+}
+
+void ThreadPool::_LogJobError(const char* message) {
+	LOG_ERROR("Job failed: {}", message);
+}
+
+uint64_t ThreadPool::_GetWaitStart() {
+	return StartupReport::IsRecording() ? CpuProfiler::Now() : 0;
+}
+
+void ThreadPool::_RecordWait(uint64_t start) {
+	// Only the main thread's waits hold up the first frame, workers waiting on each other is already counted
+	if (start != 0 && Instance().IsMainThread()) {
+		StartupReport::Record("Waiting on jobs", StartupReport::SpanKind::Wait, start, CpuProfiler::Now());
+	}
+}
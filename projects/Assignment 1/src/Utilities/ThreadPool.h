@@ -0,0 +1,487 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// <summary>
+/// The threads that a job can be scheduled on
+/// </summary>
+enum class JobThread {
+	// Any of the worker threads, for work that doesn't touch OpenGL (file reads, parsing, decoding, etc...)
+	Worker,
+	// The main thread, for work that needs the OpenGL context. These run whenever the main thread calls
+	// RunMainThreadJobs or waits on a task
+	Main
+};
+
+/// <summary>
+/// How soon a worker job needs to run, workers take every waiting Frame job (from any queue) before any Background one
+/// </summary>
+enum class JobPriority {
+	// Something this frame is waiting on (ex: the physics step, the behaviour systems, a ParallelFor)
+	Frame,
+	// Everything else (ex: decoding textures, loading scenes, cooking)
+	Background,
+	Count
+};
+
+template <typename T>
+class Task;
+
+// Gets the type a continuation's task finishes with, continuations that return a task finish with that task's result
+template <typename T>
+struct TaskResult {
+	typedef T Type;
+	static constexpr bool IsTask = false;
+};
+template <typename T>
+struct TaskResult<Task<T>> {
+	typedef T Type;
+	static constexpr bool IsTask = true;
+};
+
+/// <summary>
+/// A work-stealing pool of worker threads for loading work (image decoding, file reads, etc...). Each worker has it's
+/// own queue, jobs scheduled from a worker go on that worker's queue and idle workers steal from the others. Jobs
+/// should not touch OpenGL, since the context only lives on the main thread, anything that does can be scheduled on
+/// the main thread's queue instead
+///
+/// When the pool picks it's own thread count it runs one worker per physical core (see CpuTopology), each pinned to
+/// it's core so the OS can't shuffle them around mid-frame, with the first cores kept for the main thread and the
+/// audio thread. Workers steal from the workers on their own NUMA node before going across to the other
+///
+/// Submit hands back a std::future, and jobs submitted from a worker thread run inline so that a pool full of jobs
+/// blocking on futures can't deadlock itself. Schedule hands back a Task, which can have continuations attached with
+/// Then, and can be waited on from any thread without blocking the pool
+/// </summary>
+class ThreadPool
+{
+public:
+	static ThreadPool& Instance() {
+		static ThreadPool instance;
+		return instance;
+	}
+
+	/// <summary>
+	/// The threads that get a core to themselves when the pool pins it's workers
+	/// </summary>
+	enum class ReservedCore {
+		// The thread that called Init, which does all the rendering
+		Main,
+		// FMOD's update thread, only reserved on machines with enough cores to spare one
+		Audio
+	};
+
+	/// <summary>
+	/// Starts the worker threads, jobs submitted before this run inline on the calling thread. The calling thread
+	/// becomes the main thread, which runs the jobs scheduled with JobThread::Main
+	/// </summary>
+	/// <param name="threadCount">The number of worker threads to start, or 0 to run one per physical core, pinned</param>
+	void Init(uint32_t threadCount = 0);
+	/// <summary>
+	/// Stops the worker threads, jobs that have not started yet are dropped
+	/// </summary>
+	void Shutdown();
+
+	/// <summary>
+	/// Queues up a job to run on one of the workers
+	/// </summary>
+	/// <param name="job">The function to run</param>
+	/// <returns>A future for the result of the job</returns>
+	template <typename Func>
+	auto Submit(Func&& job) -> std::future<decltype(job())> {
+		typedef decltype(job()) Result;
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(job));
+		std::future<Result> result = task->get_future();
+		if (_workers.empty() || IsWorkerThread()) {
+			(*task)();
+		} else {
+			_Post([task]() { (*task)(); }, JobThread::Worker);
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// Queues up a job to run on the given thread
+	/// </summary>
+	/// <param name="job">The function to run</param>
+	/// <param name="thread">The thread to run the job on</param>
+	/// <param name="priority">How soon the job needs to run, main thread jobs always run in order</param>
+	/// <returns>A task for the result of the job, which can be waited on or continued with Then</returns>
+	template <typename Func>
+	auto Schedule(Func&& job, JobThread thread = JobThread::Worker, JobPriority priority = JobPriority::Background)
+		-> Task<std::decay_t<std::invoke_result_t<std::decay_t<Func>&>>>;
+
+	/// <summary>
+	/// Runs the jobs that have been scheduled on the main thread, must be called from the main thread
+	/// </summary>
+	/// <param name="maxMilliseconds">Stops starting new jobs after this long, so a burst of jobs doesn't cause a hitch</param>
+	/// <returns>The number of jobs that were run</returns>
+	uint32_t RunMainThreadJobs(double maxMilliseconds = 1e30);
+
+	/// <summary>
+	/// Waits for a task to finish. Rather than blocking, the calling thread runs other jobs while it waits (and the
+	/// main thread runs it's own jobs), so it's safe to wait on tasks that depend on main thread work
+	/// </summary>
+	/// <param name="task">The task to wait for</param>
+	template <typename T>
+	void Wait(const Task<T>& task);
+
+	/// <summary>
+	/// Splits a range of indices into batches and runs them across the workers and the calling thread, returning once
+	/// every batch is done. The caller claims batches too, so this never waits on workers that are busy with other
+	/// jobs. Small ranges, and calls made from inside another ParallelFor, just run on the calling thread. Someone is
+	/// always waiting on the batches, so they go out as Frame jobs
+	/// </summary>
+	/// <param name="count">The number of indices in the range</param>
+	/// <param name="minBatch">The smallest number of indices worth handing to another thread</param>
+	/// <param name="body">The function to run, will be passed the begin and end of each batch</param>
+	template <typename Func>
+	void ParallelFor(size_t count, size_t minBatch, Func&& body);
+
+	/// <summary>
+	/// Gets the number of worker threads in the pool
+	/// </summary>
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(_workers.size()); }
+	/// <summary>
+	/// Gets the physical core kept for a thread (see CpuTopology), or -1 if that thread isn't pinned, either because
+	/// the workers weren't pinned or because the machine doesn't have a core to spare for it
+	/// </summary>
+	int GetReservedCore(ReservedCore thread) const;
+	/// <summary>
+	/// Returns true if the calling thread is one of our workers
+	/// </summary>
+	static bool IsWorkerThread();
+	/// <summary>
+	/// Gets the index of the worker running on the calling thread, from 0 to GetThreadCount() - 1, or -1 if the
+	/// calling thread isn't one of our workers
+	/// </summary>
+	static int GetWorkerIndex();
+	/// <summary>
+	/// Returns true if the calling thread is the one that called Init
+	/// </summary>
+	bool IsMainThread() const { return std::this_thread::get_id() == _mainThread; }
+
+protected:
+	template <typename T>
+	friend class Task;
+
+	ThreadPool();
+	~ThreadPool();
+
+	static constexpr size_t PRIORITY_COUNT = static_cast<size_t>(JobPriority::Count);
+
+	struct Worker {
+		std::thread                       Thread;
+		std::mutex                        Mutex;
+		std::deque<std::function<void()>> Jobs[PRIORITY_COUNT];
+		// The other workers in the order we steal from them, the ones on our own NUMA node first
+		std::vector<uint32_t>             Victims;
+	};
+
+	// Adds a job to the right queue and wakes up someone to run it
+	void _Post(std::function<void()>&& job, JobThread thread, JobPriority priority = JobPriority::Background);
+	// Takes the next job a worker should run, any Frame job before any Background one
+	bool _PopWorkerJob(std::function<void()>& job);
+	// Takes the next job of a priority: the newest job on our own queue, then the oldest shared job, then the oldest
+	// job on another worker's queue
+	bool _PopWorkerJob(std::function<void()>& job, JobPriority priority);
+	// Runs a single job on the calling thread if there is one, returns false if there was nothing to run
+	bool _RunOneJob();
+	// Blocks until something happens that a waiting thread might care about (a task finishing, a new main thread
+	// job) or a short timeout passes
+	void _WaitForProgress(const std::function<bool()>& isDone);
+	// Wakes up anyone blocked in _WaitForProgress
+	void _NotifyProgress();
+	// The loop each worker thread runs
+	void _WorkerMain(uint32_t index);
+
+	// Runs a job, storing it's result in the task and finishing it
+	template <typename R, typename Func>
+	static void _Run(const Task<R>& task, Func&& job);
+	// Logs a job that threw, so we don't need to pull the logger into this header
+	static void _LogJobError(const char* message);
+	// Records the time the main thread spends in Wait for the startup report, for the same reason
+	static uint64_t _GetWaitStart();
+	static void _RecordWait(uint64_t start);
+
+	// Whether the calling thread is running a batch of a ParallelFor
+	static thread_local bool _isInParallelFor;
+
+	std::vector<std::unique_ptr<Worker>> _workers;
+	std::thread::id                      _mainThread;
+	// The number of cores kept for threads that aren't workers, 0 if the workers aren't pinned
+	uint32_t                             _reservedCores;
+
+	// Jobs posted from threads that aren't workers, and the count of every worker job that is waiting to run (and of
+	// just the Frame ones, so workers can skip looking for them when there are none)
+	std::mutex                           _mutex;
+	std::condition_variable              _jobReady;
+	std::deque<std::function<void()>>    _jobs[PRIORITY_COUNT];
+	std::atomic<int>                     _queued;
+	std::atomic<int>                     _queuedFrame;
+	bool                                 _isRunning;
+
+	std::mutex                           _mainMutex;
+	std::condition_variable              _progress;
+	std::deque<std::function<void()>>    _mainJobs;
+};
+
+/// <summary>
+/// The result of a job scheduled on the ThreadPool, which will be filled in once the job finishes. Tasks are cheap to
+/// copy, every copy refers to the same job. More work can be chained on with Then, which runs once the task finishes
+///
+/// If a job throws, the error is logged and the task (and anything continued from it) is marked as failed
+/// </summary>
+template <typename T>
+class Task
+{
+public:
+	// Tasks that don't return anything still need to store something, so we use a bool to mark them as finished
+	typedef std::conditional_t<std::is_void_v<T>, bool, T> ValueType;
+
+	Task() : _state(nullptr) { }
+
+	/// <summary>
+	/// Creates a task that has already finished with the given result
+	/// </summary>
+	static Task FromValue(ValueType value) {
+		Task result = _Create();
+		result._state->Value.emplace(std::move(value));
+		result._state->IsDone = true;
+		return result;
+	}
+
+	/// <summary>
+	/// Returns true if this task refers to a job, default constructed tasks do not
+	/// </summary>
+	bool IsValid() const { return _state != nullptr; }
+	/// <summary>
+	/// Returns true once the job has finished (or failed)
+	/// </summary>
+	bool IsDone() const {
+		std::lock_guard<std::mutex> lock(_state->Mutex);
+		return _state->IsDone;
+	}
+	/// <summary>
+	/// Returns true if the job, or a task it was continued from, threw an error
+	/// </summary>
+	bool HasFailed() const {
+		std::lock_guard<std::mutex> lock(_state->Mutex);
+		return _state->HasFailed;
+	}
+	/// <summary>
+	/// Gets the result of the job, only valid once IsDone returns true and HasFailed returns false
+	/// </summary>
+	ValueType& Get() const { return *_state->Value; }
+
+	/// <summary>
+	/// Schedules another job to run with the result of this one once it finishes. If the job returns a task of it's
+	/// own (ex: AssetManager::GetMeshAsync), the returned task waits for that one too and finishes with it's result,
+	/// so a load that hops between threads and waits on other assets reads as one flat chain:
+	///
+	///     Schedule(read).Then(decode).Then(upload, JobThread::Main).Then(getMesh, JobThread::Main).Then(attach, JobThread::Main)
+	/// </summary>
+	/// <param name="job">The function to run, will be passed a reference to our result (unless we don't have one)</param>
+	/// <param name="thread">The thread to run the job on, ex: JobThread::Main for work that creates OpenGL objects</param>
+	/// <returns>A task for the result of the new job, or of the task it returned</returns>
+	template <typename Func>
+	auto Then(Func&& job, JobThread thread = JobThread::Worker) const;
+
+protected:
+	friend class ThreadPool;
+	friend class IoScheduler;
+	template <typename U>
+	friend class Task;
+
+	struct State {
+		std::mutex                             Mutex;
+		bool                                   IsDone = false;
+		bool                                   HasFailed = false;
+		std::optional<ValueType>               Value;
+		std::vector<std::function<void(bool)>> Continuations;
+	};
+
+	static Task _Create() {
+		Task result;
+		result._state = std::make_shared<State>();
+		return result;
+	}
+
+	// Marks the task as finished and runs anything that was waiting on it, with whether the task failed
+	void _Finish(bool failed) const {
+		std::vector<std::function<void(bool)>> continuations;
+		{
+			std::lock_guard<std::mutex> lock(_state->Mutex);
+			_state->IsDone = true;
+			_state->HasFailed = failed;
+			continuations.swap(_state->Continuations);
+		}
+		for (const std::function<void(bool)>& continuation : continuations) {
+			continuation(failed);
+		}
+		ThreadPool::Instance()._NotifyProgress();
+	}
+
+	// Adds a function to run once the task finishes, or runs it straight away if it already has
+	void _OnDone(std::function<void(bool)>&& callback) const {
+		bool failed;
+		{
+			std::lock_guard<std::mutex> lock(_state->Mutex);
+			if (!_state->IsDone) {
+				_state->Continuations.push_back(std::move(callback));
+				return;
+			}
+			failed = _state->HasFailed;
+		}
+		callback(failed);
+	}
+
+	std::shared_ptr<State> _state;
+};
+
+template <typename Func>
+auto ThreadPool::Schedule(Func&& job, JobThread thread, JobPriority priority) -> Task<std::decay_t<std::invoke_result_t<std::decay_t<Func>&>>> {
+	typedef std::decay_t<std::invoke_result_t<std::decay_t<Func>&>> Result;
+	Task<Result> result = Task<Result>::_Create();
+	// std::function needs to be copyable, so we share the job instead of copying it around
+	auto shared = std::make_shared<std::decay_t<Func>>(std::forward<Func>(job));
+	_Post([result, shared]() { _Run(result, *shared); }, thread, priority);
+	return result;
+}
+
+template <typename Func>
+void ThreadPool::ParallelFor(size_t count, size_t minBatch, Func&& body) {
+	minBatch = std::max(minBatch, static_cast<size_t>(1));
+	if (count <= minBatch || _workers.empty() || _isInParallelFor) {
+		body(static_cast<size_t>(0), count);
+		return;
+	}
+
+	// A few batches per thread lets anyone who finishes early pick up the slack
+	const size_t maxBatches = (_workers.size() + 1) * 4;
+	const size_t batchSize = std::max(minBatch, (count + maxBatches - 1) / maxBatches);
+	const size_t batches = (count + batchSize - 1) / batchSize;
+
+	// Helpers that only get to run after every batch has been claimed just see there's nothing left, so the counters
+	// are shared with them, but the body is only touched while we're still waiting here
+	struct State {
+		std::atomic<size_t> Next{ 0 };
+		std::atomic<size_t> Done{ 0 };
+	};
+	std::shared_ptr<State> state = std::make_shared<State>();
+	auto* job = &body;
+	auto run = [state, job, batches, batchSize, count]() {
+		// Anything the body splits up again stays on this thread, every other thread is already busy with our batches
+		const bool wasInParallelFor = _isInParallelFor;
+		_isInParallelFor = true;
+		for (size_t batch = state->Next++; batch < batches; batch = state->Next++) {
+			const size_t begin = batch * batchSize;
+			(*job)(begin, std::min(begin + batchSize, count));
+			state->Done++;
+		}
+		_isInParallelFor = wasInParallelFor;
+	};
+	const size_t helpers = std::min(_workers.size(), batches - 1);
+	for (size_t ix = 0; ix < helpers; ix++) {
+		_Post(run, JobThread::Worker, JobPriority::Frame);
+	}
+	run();
+	while (state->Done < batches) {
+		std::this_thread::yield();
+	}
+}
+
+template <typename T>
+void ThreadPool::Wait(const Task<T>& task) {
+	if (task.IsDone()) {
+		return;
+	}
+	const uint64_t start = _GetWaitStart();
+	while (!task.IsDone()) {
+		if (!_RunOneJob()) {
+			_WaitForProgress([&task]() { return task.IsDone(); });
+		}
+	}
+	_RecordWait(start);
+}
+
+template <typename R, typename Func>
+void ThreadPool::_Run(const Task<R>& task, Func&& job) {
+	bool failed = false;
+	try {
+		if constexpr (std::is_void_v<R>) {
+			job();
+			task._state->Value.emplace(true);
+		} else {
+			task._state->Value.emplace(job());
+		}
+	} catch (const std::exception& e) {
+		_LogJobError(e.what());
+		failed = true;
+	}
+	task._Finish(failed);
+}
+
+template <typename T>
+template <typename Func>
+auto Task<T>::Then(Func&& job, JobThread thread) const {
+	typedef std::decay_t<Func> Job;
+	typedef std::conditional_t<std::is_void_v<T>, std::invoke_result<Job&>, std::invoke_result<Job&, ValueType&>> Invoked;
+	typedef std::decay_t<typename Invoked::type> Result;
+	typedef typename TaskResult<Result>::Type NextResult;
+
+	Task<NextResult> next = Task<NextResult>::_Create();
+	auto shared = std::make_shared<Job>(std::forward<Func>(job));
+	std::shared_ptr<State> state = _state;
+	_OnDone([state, next, shared, thread](bool failed) {
+		// Failures carry on down the chain, so anything waiting on the end of it still finishes
+		if (failed) {
+			next._Finish(true);
+			return;
+		}
+		ThreadPool::Instance()._Post([state, next, shared]() {
+			auto invoke = [&]() -> decltype(auto) {
+				if constexpr (std::is_void_v<T>) {
+					return (*shared)();
+				} else {
+					return (*shared)(*state->Value);
+				}
+			};
+			if constexpr (TaskResult<Result>::IsTask) {
+				// The job handed back another task, so we finish along with that one instead of with the job
+				Result inner;
+				try {
+					inner = invoke();
+				} catch (const std::exception& e) {
+					ThreadPool::_LogJobError(e.what());
+					next._Finish(true);
+					return;
+				}
+				if (!inner.IsValid()) {
+					next._Finish(true);
+					return;
+				}
+				inner._OnDone([inner, next](bool innerFailed) {
+					if (!innerFailed) {
+						next._state->Value.emplace(*inner._state->Value);
+					}
+					next._Finish(innerFailed);
+				});
+			} else {
+				ThreadPool::_Run(next, invoke);
+			}
+		}, thread);
+	});
+	return next;
+}
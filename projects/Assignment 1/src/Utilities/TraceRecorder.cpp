@@ -0,0 +1,320 @@
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <unordered_map>
+#include <json.hpp>
+
+#include "Logging.h"
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/FleetTelemetry.h"
+#include "Utilities/StartupReport.h"
+#include "Graphics/GpuProfiler.h"
+
+// Tracks for the trace viewer, CPU threads use their thread index as their track
+#define GPU_TRACK     1000
+#define ASSET_TRACK   2000
+#define MESSAGE_TRACK 3000
+
+// The number of frames the median frame time is taken over, no hitches are looked for until we've seen this many
+static const size_t MEDIAN_FRAMES = 120;
+// The most zones the rolling window holds, no matter how long it is, so a flood of tiny zones can't eat all our memory
+static const size_t MAX_RING_EVENTS = 1 << 18;
+// The most zones listed in a hitch's summary
+static const size_t HITCH_TOP_ZONES = 10;
+// The category driver messages are recorded with, they show up as instants rather than spans
+static const char*  MESSAGE_CATEGORY = "message";
+
+TraceRecorder::TraceRecorder() :
+	_framesRemaining(0),
+	_gpuFramesRemaining(0),
+	_gpuResultsVersion(0),
+	_assetTrackCount(0),
+	_hitchCapture(false),
+	_hitchCount(0),
+	_recentFrameMs(MEDIAN_FRAMES, 0.0f),
+	_recentFrameIx(0),
+	_lastFrameEnd(0),
+	_ringGpuVersion(0),
+	_hitch({ 0, 0 }),
+	_hitchMs(0.0f),
+	_hitchMedianMs(0.0f),
+	_hitchDumpIn(0),
+	_lastDump(0)
+{ }
+
+void TraceRecorder::StartCapture(int frameCount, const std::string& path) {
+	if (IsCapturing()) {
+		LOG_WARN("A trace capture is already in progress, ignoring request to capture to {}", path);
+		return;
+	}
+	LOG_INFO("Capturing {} frames to {}", frameCount, path);
+	_framesRemaining = frameCount;
+	_path = path;
+	_events.clear();
+	// We don't want to pick up the GPU results from before the capture started
+	_gpuResultsVersion = GpuProfiler::Instance().GetResultsVersion();
+}
+
+void TraceRecorder::SetHitchCapture(bool enabled) {
+	_hitchCapture = enabled;
+	// Whatever was in the window is stale once we've stopped filling it, and the frame times may be too
+	_ring.clear();
+	_ringFrames.clear();
+	_recentFrameIx = 0;
+	_hitchDumpIn = 0;
+	std::lock_guard<std::mutex> lock(_assetLock);
+	_messages.clear();
+}
+
+void TraceRecorder::EndFrame() {
+	const uint64_t now = CpuProfiler::Now();
+	if (_hitchCapture) {
+		_UpdateWindow(now);
+	}
+	_lastFrameEnd = now;
+	if (!IsCapturing()) {
+		return;
+	}
+
+	// GPU results lag a few frames behind, so we pick them up whenever a new set gets read back
+	const GpuProfiler& gpu = GpuProfiler::Instance();
+	if (gpu.GetResultsVersion() != _gpuResultsVersion) {
+		_gpuResultsVersion = gpu.GetResultsVersion();
+		for (const GpuProfiler::Zone& zone : gpu.GetResults()) {
+			_events.push_back({ zone.Name, "gpu", GPU_TRACK, zone.Start + gpu.GetCpuClockOffset(), zone.End + gpu.GetCpuClockOffset() });
+		}
+	}
+
+	if (_framesRemaining > 0) {
+		for (const CpuProfiler::Event& e : CpuProfiler::Instance().GetFrameEvents()) {
+			_events.push_back({ e.Name, "cpu", e.Thread, e.Start, e.End });
+		}
+		// Once we have all our CPU frames, we need to wait for the GPU to catch up before writing
+		if (--_framesRemaining == 0) {
+			_gpuFramesRemaining = GpuProfiler::FRAME_LATENCY;
+		}
+	} else if (--_gpuFramesRemaining == 0) {
+		_Write();
+	}
+}
+
+void TraceRecorder::RecordAssetLoad(const std::string& name, uint64_t start, uint64_t end) {
+	// Loads on different threads overlap, so they need separate tracks to show up properly
+	thread_local int32_t track = -1;
+	std::lock_guard<std::mutex> lock(_assetLock);
+	if (track == -1) {
+		track = static_cast<int32_t>(_assetTrackCount++);
+	}
+	_assetLoads.push_back({ name, "asset", ASSET_TRACK + static_cast<uint32_t>(track), start, end });
+}
+
+void TraceRecorder::RecordMessage(const std::string& message) {
+	const uint64_t now = CpuProfiler::Now();
+	std::lock_guard<std::mutex> lock(_assetLock);
+	if (_hitchCapture) {
+		_messages.push_back({ message, MESSAGE_CATEGORY, MESSAGE_TRACK, now, now });
+	}
+}
+
+void TraceRecorder::_UpdateWindow(uint64_t now) {
+	// Everything the last frame recorded goes in, the GPU's as soon as it's read back (a few frames late)
+	for (const CpuProfiler::Event& e : CpuProfiler::Instance().GetFrameEvents()) {
+		_ring.push_back({ e.Name, "cpu", e.Thread, e.Depth, e.Start, e.End });
+	}
+	const GpuProfiler& gpu = GpuProfiler::Instance();
+	if (gpu.GetResultsVersion() != _ringGpuVersion) {
+		_ringGpuVersion = gpu.GetResultsVersion();
+		for (const GpuProfiler::Zone& zone : gpu.GetResults()) {
+			_ring.push_back({ zone.Name, "gpu", GPU_TRACK, static_cast<uint32_t>(zone.Depth), zone.Start + gpu.GetCpuClockOffset(), zone.End + gpu.GetCpuClockOffset() });
+		}
+	}
+	if (_lastFrameEnd != 0) {
+		_ringFrames.push_back({ _lastFrameEnd, now });
+	}
+
+	// Then whatever has fallen out of the window goes
+	const uint64_t window = static_cast<uint64_t>(HitchWindowSeconds * 1000000000.0);
+	const uint64_t windowStart = now > window ? now - window : 0;
+	while (!_ring.empty() && (_ring.front().End < windowStart || _ring.size() > MAX_RING_EVENTS)) {
+		_ring.pop_front();
+	}
+	while (!_ringFrames.empty() && _ringFrames.front().End < windowStart) {
+		_ringFrames.pop_front();
+	}
+	{
+		std::lock_guard<std::mutex> lock(_assetLock);
+		while (!_messages.empty() && _messages.front().End < windowStart) {
+			_messages.pop_front();
+		}
+	}
+
+	// A hitch waits for the GPU to catch up with it before it's written, so it's passes make it into the dump
+	if (_hitchDumpIn > 0 && --_hitchDumpIn == 0) {
+		_DumpHitch();
+	}
+	if (_lastFrameEnd == 0) {
+		return;
+	}
+
+	const float frameMs = static_cast<float>(now - _lastFrameEnd) / 1000000.0f;
+	const uint64_t cooldown = static_cast<uint64_t>(HitchCooldownSeconds * 1000000000.0);
+	if (_recentFrameIx >= MEDIAN_FRAMES && _hitchDumpIn == 0 && (_lastDump == 0 || now - _lastDump >= cooldown)) {
+		std::vector<float> sorted = _recentFrameMs;
+		std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+		const float medianMs = sorted[sorted.size() / 2];
+		if (frameMs > medianMs * HitchFactor && frameMs > HitchMinMs) {
+			_hitch = { _lastFrameEnd, now };
+			_hitchMs = frameMs;
+			_hitchMedianMs = medianMs;
+			_hitchDumpIn = GpuProfiler::FRAME_LATENCY + 1;
+			_lastDump = now;
+		}
+	}
+	_recentFrameMs[_recentFrameIx % MEDIAN_FRAMES] = frameMs;
+	_recentFrameIx++;
+}
+
+void TraceRecorder::_DumpHitch() {
+	using nlohmann::json;
+
+	// The main thread is whichever one recorded the frame zone
+	uint32_t mainTrack = 0;
+	for (const RingEvent& e : _ring) {
+		if (e.Depth == 0 && strcmp(e.Category, "cpu") == 0 && strcmp(e.Name, "Frame") == 0) {
+			mainTrack = e.Track;
+			break;
+		}
+	}
+
+	// Each top level zone's time in the hitch, against it's usual time per frame over the rest of the window. GPU passes
+	// are counted by whatever ran on the GPU while the hitch was going on
+	struct ZoneTime {
+		const char* Category;
+		double      HitchMs = 0.0;
+		double      OtherMs = 0.0;
+	};
+	std::unordered_map<std::string, ZoneTime> zones;
+	for (const RingEvent& e : _ring) {
+		const bool isCpu = strcmp(e.Category, "cpu") == 0;
+		if (e.Depth != 1 || (isCpu && e.Track != mainTrack)) {
+			continue;
+		}
+		ZoneTime& zone = zones[std::string(e.Category) + "/" + e.Name];
+		zone.Category = e.Category;
+		const uint64_t overlapStart = std::max(e.Start, _hitch.Start);
+		const uint64_t overlapEnd = std::min(e.End, _hitch.End);
+		const double overlapMs = overlapEnd > overlapStart ? (overlapEnd - overlapStart) / 1000000.0 : 0.0;
+		zone.HitchMs += overlapMs;
+		zone.OtherMs += (e.End - e.Start) / 1000000.0 - overlapMs;
+	}
+	const double otherFrames = static_cast<double>(std::max<size_t>(_ringFrames.size(), 2) - 1);
+	std::vector<std::pair<std::string, ZoneTime>> sorted(zones.begin(), zones.end());
+	auto overMs = [otherFrames](const ZoneTime& zone) { return zone.HitchMs - zone.OtherMs / otherFrames; };
+	std::sort(sorted.begin(), sorted.end(), [&](const auto& l, const auto& r) { return overMs(l.second) > overMs(r.second); });
+	sorted.resize(std::min(sorted.size(), HITCH_TOP_ZONES));
+
+	_hitchCount++;
+	LOG_WARN("Hitch: a {:.1f}ms frame (median {:.1f}ms), the zones furthest over their usual time:", _hitchMs, _hitchMedianMs);
+	json topZones = json::array();
+	for (const auto& [name, zone] : sorted) {
+		const double usualMs = zone.OtherMs / otherFrames;
+		LOG_WARN("  {:<28} {:.2f}ms (usually {:.2f}ms, {:+.2f}ms)", name, zone.HitchMs, usualMs, zone.HitchMs - usualMs);
+		topZones.push_back({ { "zone", name }, { "ms", zone.HitchMs }, { "usual_ms", usualMs }, { "over_ms", zone.HitchMs - usualMs } });
+	}
+	const json summary = {
+		{ "frame_ms", _hitchMs },
+		{ "median_ms", _hitchMedianMs },
+		{ "threshold_ms", std::max(_hitchMedianMs * HitchFactor, HitchMinMs) },
+		{ "top_zones", topZones }
+	};
+
+	// The hitch itself gets a span on the main thread's track, so it's easy to find in the viewer
+	std::vector<TraceEvent> events;
+	events.reserve(_ring.size() + _messages.size() + 1);
+	for (const RingEvent& e : _ring) {
+		events.push_back({ e.Name, e.Category, e.Track, e.Start, e.End });
+	}
+	{
+		std::lock_guard<std::mutex> lock(_assetLock);
+		events.insert(events.end(), _messages.begin(), _messages.end());
+	}
+	events.push_back({ fmt::format("Hitch ({:.1f}ms)", _hitchMs), "hitch", mainTrack, _hitch.Start, _hitch.End });
+
+	const uint64_t start = _ringFrames.empty() ? _hitch.Start : _ringFrames.front().Start;
+	const std::string path = "hitch_" + std::to_string(static_cast<long long>(std::time(nullptr))) + "_" + std::to_string(_hitchCount) + ".json";
+	_WriteTrace(path, events, start, CpuProfiler::Now(), "hitch", summary.dump());
+}
+
+void TraceRecorder::_Write() {
+	_WriteTrace(_path, _events, 0, 0, "", "");
+	_events.clear();
+}
+
+void TraceRecorder::_WriteTrace(const std::string& path, const std::vector<TraceEvent>& traceEvents, uint64_t start, uint64_t end, const std::string& extraName, const std::string& extraJson) {
+	using nlohmann::json;
+
+	json events = json::array();
+	// Name our tracks so they are easy to tell apart in the viewer
+	auto nameTrack = [&](uint32_t track, const std::string& name) {
+		events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 0 }, { "tid", track }, { "args", { { "name", name } } } });
+	};
+	nameTrack(0, "CPU Main Thread");
+	nameTrack(GPU_TRACK, "GPU");
+	nameTrack(MESSAGE_TRACK, "Driver Messages");
+	std::lock_guard<std::mutex> lock(_assetLock);
+	for (uint32_t ix = 0; ix < _assetTrackCount; ix++) {
+		nameTrack(ASSET_TRACK + ix, ix == 0 ? std::string("Asset Loading") : "Asset Loading " + std::to_string(ix));
+	}
+
+	size_t count = 0;
+	auto writeEvent = [&](const TraceEvent& e) {
+		// The trace format uses microseconds, messages are a single point in time rather than a span
+		if (e.Category == MESSAGE_CATEGORY) {
+			events.push_back({ { "name", e.Name }, { "cat", e.Category }, { "ph", "i" }, { "s", "t" }, { "pid", 0 }, { "tid", e.Track }, { "ts", e.Start / 1000.0 } });
+		} else {
+			events.push_back({
+				{ "name", e.Name },
+				{ "cat", e.Category },
+				{ "ph", "X" },
+				{ "pid", 0 },
+				{ "tid", e.Track },
+				{ "ts", e.Start / 1000.0 },
+				{ "dur", (e.End - e.Start) / 1000.0 }
+			});
+		}
+		count++;
+	};
+	// A window only gets the loads that overlap it
+	for (const TraceEvent& e : _assetLoads) {
+		if (end == 0 || (e.End >= start && e.Start <= end)) {
+			writeEvent(e);
+		}
+	}
+	for (const TraceEvent& e : traceEvents) {
+		writeEvent(e);
+	}
+
+	json result = { { "traceEvents", events }, { "displayTimeUnit", "ms" } };
+	if (!extraName.empty()) {
+		result[extraName] = json::parse(extraJson);
+	}
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		LOG_ERROR("Failed to open {} for writing the trace", path);
+		return;
+	}
+	file << result;
+	LOG_INFO("Wrote {} trace events to {}", count, path);
+}
+
+AssetLoadScope::AssetLoadScope(const std::string& name) :
+	_name(name), _start(CpuProfiler::Now()) { }
+
+AssetLoadScope::~AssetLoadScope() {
+	const uint64_t end = CpuProfiler::Now();
+	TraceRecorder::Instance().RecordAssetLoad(_name, _start, end);
+	StartupReport::Record(_name, StartupReport::SpanKind::Asset, _start, end);
+	FleetTelemetry::RecordAssetLoad(_name, _start, end);
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Captures CPU and GPU profiler zones for a number of frames and writes them out as a JSON file that can be opened
+/// with chrome://tracing or https://ui.perfetto.dev. Asset loads are always recorded, and get included in every capture
+///
+/// With hitch capture on, the last few seconds of zones, asset loads and driver performance warnings are also kept in a
+/// rolling window. Whenever a frame takes much longer than the frames before it (ex: 2x the median), the window around
+/// it is written out to a trace of it's own, along with a summary of which zones ran the furthest over their usual
+/// time, so hitches we can't reproduce still leave something behind to look at
+/// </summary>
+class TraceRecorder
+{
+public:
+	/// <summary>
+	/// Whether the rolling window is kept and dumped on hitches, see SetHitchCapture
+	/// </summary>
+	bool   IsHitchCaptureEnabled() const { return _hitchCapture; }
+	/// <summary>
+	/// A frame is a hitch when it takes this many times longer than the median of the frames before it
+	/// </summary>
+	float  HitchFactor = 2.0f;
+	/// <summary>
+	/// Frames shorter than this are never hitches, in milliseconds, so noise at high frame rates doesn't count
+	/// </summary>
+	float  HitchMinMs = 10.0f;
+	/// <summary>
+	/// How much history the rolling window keeps, and so how far before a hitch each dump goes back, in seconds
+	/// </summary>
+	double HitchWindowSeconds = 3.0;
+	/// <summary>
+	/// The least time between two dumps, in seconds, so a run of bad frames only writes one trace
+	/// </summary>
+	double HitchCooldownSeconds = 10.0;
+
+	static TraceRecorder& Instance() {
+		static TraceRecorder instance;
+		return instance;
+	}
+
+	/// <summary>
+	/// Starts recording the next frameCount frames, writing the result to the given file once done. Ignored if a capture is
+	/// already in progress
+	/// </summary>
+	/// <param name="frameCount">The number of frames to record</param>
+	/// <param name="path">The file to write the trace to</param>
+	void StartCapture(int frameCount, const std::string& path);
+	/// <summary>
+	/// Returns true if a capture is in progress
+	/// </summary>
+	bool IsCapturing() const { return _framesRemaining > 0 || _gpuFramesRemaining > 0; }
+
+	/// <summary>
+	/// Should be called once per frame after CpuProfiler::EndFrame, collects the frame's zones if we are capturing
+	/// </summary>
+	void EndFrame();
+
+	/// <summary>
+	/// Records an asset being loaded, this can be called from any thread and each thread gets it's own track
+	/// </summary>
+	/// <param name="name">The name of the asset (ex: it's file path)</param>
+	/// <param name="start">The time the load started, from CpuProfiler::Now</param>
+	/// <param name="end">The time the load finished, from CpuProfiler::Now</param>
+	void RecordAssetLoad(const std::string& name, uint64_t start, uint64_t end);
+	/// <summary>
+	/// Records a message from the driver (ex: a GL performance warning) as a point in time in the rolling window, can be
+	/// called from any thread. Ignored while hitch capture is off
+	/// </summary>
+	/// <param name="message">The message to show in the trace</param>
+	void RecordMessage(const std::string& message);
+
+	/// <summary>
+	/// Turns the rolling window (and dumping it whenever there's a hitch) on or off
+	/// </summary>
+	void SetHitchCapture(bool enabled);
+	/// <summary>
+	/// Gets how many hitches have been written out
+	/// </summary>
+	uint32_t GetHitchCount() const { return _hitchCount; }
+
+protected:
+	TraceRecorder();
+
+	// A zone that will be written to the trace, with times in nanoseconds on the CPU profiler clock
+	struct TraceEvent {
+		std::string Name;
+		const char* Category;
+		uint32_t    Track;
+		uint64_t    Start;
+		uint64_t    End;
+	};
+
+	// A zone kept in the rolling window, the names all come from the profilers so they don't need copying
+	struct RingEvent {
+		const char* Name;
+		const char* Category;
+		uint32_t    Track;
+		uint32_t    Depth;
+		uint64_t    Start;
+		uint64_t    End;
+	};
+	// A frame in the rolling window, on the CPU profiler clock
+	struct RingFrame {
+		uint64_t Start;
+		uint64_t End;
+	};
+
+	// Writes the captured events to _path
+	void _Write();
+	// Writes events to a trace file, along with the asset loads between start and end (or all of them when end is 0),
+	// and anything extra to put at the top level of the file (ex: a hitch summary)
+	void _WriteTrace(const std::string& path, const std::vector<TraceEvent>& events, uint64_t start, uint64_t end, const std::string& extraName, const std::string& extraJson);
+	// Adds the last frame to the rolling window, drops whatever has fallen out of it, and looks for a hitch
+	void _UpdateWindow(uint64_t now);
+	// Writes out the window around the hitch, once the GPU has caught up with it
+	void _DumpHitch();
+
+	int         _framesRemaining;
+	int         _gpuFramesRemaining;
+	uint64_t    _gpuResultsVersion;
+	std::string _path;
+	std::vector<TraceEvent> _events;
+	std::vector<TraceEvent> _assetLoads;
+	// Asset loads (and driver messages) can come in from other threads, so they need to be locked
+	std::mutex              _assetLock;
+	uint32_t                _assetTrackCount;
+
+	bool                    _hitchCapture;
+	uint32_t                _hitchCount;
+	std::deque<RingEvent>   _ring;
+	std::deque<RingFrame>   _ringFrames;
+	std::deque<TraceEvent>  _messages;
+	// The frame times (in ms) the median is taken over, and where the next one goes
+	std::vector<float>      _recentFrameMs;
+	size_t                  _recentFrameIx;
+	uint64_t                _lastFrameEnd;
+	uint64_t                _ringGpuVersion;
+	// The hitch waiting for the GPU to catch up before it's written, and how many more frames it has to wait
+	RingFrame               _hitch;
+	float                   _hitchMs;
+	float                   _hitchMedianMs;
+	int                     _hitchDumpIn;
+	uint64_t                _lastDump;
+};
+
+/// <summary>
+/// Helper for recording an asset load, the load ends when this goes out of scope
+/// </summary>
+struct AssetLoadScope final {
+	AssetLoadScope(const std::string& name);
+	~AssetLoadScope();
+
+private:
+	std::string _name;
+	uint64_t    _start;
+};
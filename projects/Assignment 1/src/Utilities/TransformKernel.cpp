@@ -0,0 +1,244 @@
+#include "TransformKernel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <random>
+#include <GLM/gtc/matrix_transform.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <GLM/gtx/quaternion.hpp>
+
+#include "Logging.h"
+
+// Pick the widest instruction set the compiler is allowed to use. MSVC only defines __AVX2__ with /arch:AVX2, but
+// SSE2 is always there on x64
+#if defined(__AVX2__)
+	#define TRANSFORM_KERNEL_AVX2
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define TRANSFORM_KERNEL_SSE
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	#define TRANSFORM_KERNEL_NEON
+	#include <arm_neon.h>
+#endif
+
+void TransformSoA::Resize(size_t count) {
+	for (std::vector<float>* component : { &PositionX, &PositionY, &PositionZ, &RotationX, &RotationY, &RotationZ, &RotationW, &ScaleX, &ScaleY, &ScaleZ }) {
+		component->resize(count);
+	}
+}
+
+void TransformSoA::Set(size_t index, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+	PositionX[index] = position.x; PositionY[index] = position.y; PositionZ[index] = position.z;
+	RotationX[index] = rotation.x; RotationY[index] = rotation.y; RotationZ[index] = rotation.z; RotationW[index] = rotation.w;
+	ScaleX[index] = scale.x; ScaleY[index] = scale.y; ScaleZ[index] = scale.z;
+}
+
+// The plain version of the kernel, used for whatever is left over after the last full block (and as the fallback
+// when we have no vector instructions)
+struct ScalarOps {
+	typedef float V;
+	static inline V Load(const float* data) { return *data; }
+	static inline V Set(float value) { return value; }
+	static inline V Add(V a, V b) { return a + b; }
+	static inline V Sub(V a, V b) { return a - b; }
+	static inline V Mul(V a, V b) { return a * b; }
+	static inline void StoreColumn(glm::mat4* out, int column, V x, V y, V z, V w) {
+		out[0][column] = glm::vec4(x, y, z, w);
+	}
+};
+
+// Each instruction set gets a small wrapper with the handful of operations the kernel needs, so the math itself only
+// has to be written once in ComposeBlock
+#if defined(TRANSFORM_KERNEL_AVX2)
+struct SimdOps {
+	typedef __m256 V;
+	static const size_t WIDTH = 8;
+	static inline V Load(const float* data) { return _mm256_loadu_ps(data); }
+	static inline V Set(float value) { return _mm256_set1_ps(value); }
+	static inline V Add(V a, V b) { return _mm256_add_ps(a, b); }
+	static inline V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+	static inline V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+	// Writes one column of each matrix, the components come in as one lane per matrix so they need transposing
+	static inline void StoreColumn(glm::mat4* out, int column, V x, V y, V z, V w) {
+		for (int half = 0; half < 2; half++) {
+			__m128 r0 = half == 0 ? _mm256_castps256_ps128(x) : _mm256_extractf128_ps(x, 1);
+			__m128 r1 = half == 0 ? _mm256_castps256_ps128(y) : _mm256_extractf128_ps(y, 1);
+			__m128 r2 = half == 0 ? _mm256_castps256_ps128(z) : _mm256_extractf128_ps(z, 1);
+			__m128 r3 = half == 0 ? _mm256_castps256_ps128(w) : _mm256_extractf128_ps(w, 1);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(&out[half * 4 + 0][column][0], r0);
+			_mm_storeu_ps(&out[half * 4 + 1][column][0], r1);
+			_mm_storeu_ps(&out[half * 4 + 2][column][0], r2);
+			_mm_storeu_ps(&out[half * 4 + 3][column][0], r3);
+		}
+	}
+};
+#elif defined(TRANSFORM_KERNEL_SSE)
+struct SimdOps {
+	typedef __m128 V;
+	static const size_t WIDTH = 4;
+	static inline V Load(const float* data) { return _mm_loadu_ps(data); }
+	static inline V Set(float value) { return _mm_set1_ps(value); }
+	static inline V Add(V a, V b) { return _mm_add_ps(a, b); }
+	static inline V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+	static inline V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+	static inline void StoreColumn(glm::mat4* out, int column, V x, V y, V z, V w) {
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(&out[0][column][0], x);
+		_mm_storeu_ps(&out[1][column][0], y);
+		_mm_storeu_ps(&out[2][column][0], z);
+		_mm_storeu_ps(&out[3][column][0], w);
+	}
+};
+#elif defined(TRANSFORM_KERNEL_NEON)
+struct SimdOps {
+	typedef float32x4_t V;
+	static const size_t WIDTH = 4;
+	static inline V Load(const float* data) { return vld1q_f32(data); }
+	static inline V Set(float value) { return vdupq_n_f32(value); }
+	static inline V Add(V a, V b) { return vaddq_f32(a, b); }
+	static inline V Sub(V a, V b) { return vsubq_f32(a, b); }
+	static inline V Mul(V a, V b) { return vmulq_f32(a, b); }
+	static inline void StoreColumn(glm::mat4* out, int column, V x, V y, V z, V w) {
+		float32x4x2_t xy = vtrnq_f32(x, y);
+		float32x4x2_t zw = vtrnq_f32(z, w);
+		vst1q_f32(&out[0][column][0], vcombine_f32(vget_low_f32(xy.val[0]), vget_low_f32(zw.val[0])));
+		vst1q_f32(&out[1][column][0], vcombine_f32(vget_low_f32(xy.val[1]), vget_low_f32(zw.val[1])));
+		vst1q_f32(&out[2][column][0], vcombine_f32(vget_high_f32(xy.val[0]), vget_high_f32(zw.val[0])));
+		vst1q_f32(&out[3][column][0], vcombine_f32(vget_high_f32(xy.val[1]), vget_high_f32(zw.val[1])));
+	}
+};
+#else
+// Without any vector instructions we just do one transform at a time, the compiler may still vectorize it
+struct SimdOps : ScalarOps {
+	static const size_t WIDTH = 1;
+};
+#endif
+
+const size_t TransformKernel::WIDTH = SimdOps::WIDTH;
+
+// Composes SimdOps::WIDTH transforms starting at the given index. This is the same expansion glm::toMat4 uses for
+// a unit quaternion, with each rotation column multiplied by it's scale and the position dropped into the last column
+template <typename Ops>
+static inline void ComposeBlock(const TransformSoA& input, size_t index, glm::mat4* out) {
+	typedef typename Ops::V V;
+	const V x = Ops::Load(&input.RotationX[index]);
+	const V y = Ops::Load(&input.RotationY[index]);
+	const V z = Ops::Load(&input.RotationZ[index]);
+	const V w = Ops::Load(&input.RotationW[index]);
+	const V two = Ops::Set(2.0f);
+	const V one = Ops::Set(1.0f);
+	const V zero = Ops::Set(0.0f);
+
+	const V x2 = Ops::Mul(x, two), y2 = Ops::Mul(y, two), z2 = Ops::Mul(z, two);
+	const V xx = Ops::Mul(x, x2), yy = Ops::Mul(y, y2), zz = Ops::Mul(z, z2);
+	const V xy = Ops::Mul(x, y2), xz = Ops::Mul(x, z2), yz = Ops::Mul(y, z2);
+	const V wx = Ops::Mul(w, x2), wy = Ops::Mul(w, y2), wz = Ops::Mul(w, z2);
+
+	const V sx = Ops::Load(&input.ScaleX[index]);
+	const V sy = Ops::Load(&input.ScaleY[index]);
+	const V sz = Ops::Load(&input.ScaleZ[index]);
+
+	Ops::StoreColumn(out, 0,
+		Ops::Mul(Ops::Sub(one, Ops::Add(yy, zz)), sx),
+		Ops::Mul(Ops::Add(xy, wz), sx),
+		Ops::Mul(Ops::Sub(xz, wy), sx),
+		zero);
+	Ops::StoreColumn(out, 1,
+		Ops::Mul(Ops::Sub(xy, wz), sy),
+		Ops::Mul(Ops::Sub(one, Ops::Add(xx, zz)), sy),
+		Ops::Mul(Ops::Add(yz, wx), sy),
+		zero);
+	Ops::StoreColumn(out, 2,
+		Ops::Mul(Ops::Add(xz, wy), sz),
+		Ops::Mul(Ops::Sub(yz, wx), sz),
+		Ops::Mul(Ops::Sub(one, Ops::Add(xx, yy)), sz),
+		zero);
+	Ops::StoreColumn(out, 3,
+		Ops::Load(&input.PositionX[index]),
+		Ops::Load(&input.PositionY[index]),
+		Ops::Load(&input.PositionZ[index]),
+		one);
+}
+
+void TransformKernel::Compose(const TransformSoA& input, size_t first, size_t count, glm::mat4* output) {
+	LOG_ASSERT(first + count <= input.Size(), "Range is outside of the input!");
+	size_t ix = 0;
+	for (; ix + SimdOps::WIDTH <= count; ix += SimdOps::WIDTH) {
+		ComposeBlock<SimdOps>(input, first + ix, output + ix);
+	}
+	for (; ix < count; ix++) {
+		ComposeBlock<ScalarOps>(input, first + ix, output + ix);
+	}
+}
+
+const char* TransformKernel::GetInstructionSet() {
+#if defined(TRANSFORM_KERNEL_AVX2)
+	return "AVX2";
+#elif defined(TRANSFORM_KERNEL_SSE)
+	return "SSE";
+#elif defined(TRANSFORM_KERNEL_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+void TransformKernel::Benchmark(size_t count, uint32_t iterations) {
+	typedef std::chrono::high_resolution_clock Clock;
+	count = std::max(count, static_cast<size_t>(1));
+	iterations = std::max(iterations, 1u);
+	const glm::mat4 identity = glm::mat4(1.0f);
+
+	// Fixed seed, so runs can be compared with each other
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> range(-10.0f, 10.0f);
+	std::vector<glm::vec3> positions(count), scales(count);
+	std::vector<glm::quat> rotations(count);
+	TransformSoA soa;
+	soa.Resize(count);
+	for (size_t ix = 0; ix < count; ix++) {
+		positions[ix] = glm::vec3(range(random), range(random), range(random));
+		rotations[ix] = glm::normalize(glm::quat(range(random), range(random), range(random), range(random)));
+		scales[ix] = glm::abs(glm::vec3(range(random), range(random), range(random))) * 0.1f + 0.1f;
+		soa.Set(ix, positions[ix], rotations[ix], scales[ix]);
+	}
+
+	std::vector<glm::mat4> scalar(count), batched(count);
+	double scalarTotal = 0.0, scalarBest = DBL_MAX;
+	double batchedTotal = 0.0, batchedBest = DBL_MAX;
+	for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+		{
+			Clock::time_point start = Clock::now();
+			// The same way Transform used to build it's local matrix
+			for (size_t ix = 0; ix < count; ix++) {
+				scalar[ix] = glm::translate(identity, positions[ix]) * glm::toMat4(rotations[ix]) * glm::scale(identity, scales[ix]);
+			}
+			const double time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			scalarTotal += time;
+			scalarBest = std::min(scalarBest, time);
+		}
+		{
+			Clock::time_point start = Clock::now();
+			Compose(soa, 0, count, batched.data());
+			const double time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			batchedTotal += time;
+			batchedBest = std::min(batchedBest, time);
+		}
+	}
+
+	float maxError = 0.0f;
+	for (size_t ix = 0; ix < count; ix++) {
+		for (int col = 0; col < 4; col++) {
+			const glm::vec4 difference = glm::abs(scalar[ix][col] - batched[ix][col]);
+			maxError = std::max(maxError, std::max(std::max(difference.x, difference.y), std::max(difference.z, difference.w)));
+		}
+	}
+
+	LOG_INFO("Composed {} transforms {} times", count, iterations);
+	LOG_INFO("  glm:     {:.3f}ms average, {:.3f}ms best", scalarTotal / iterations, scalarBest);
+	LOG_INFO("  {:<7}  {:.3f}ms average, {:.3f}ms best", std::string(GetInstructionSet()) + ":", batchedTotal / iterations, batchedBest);
+	LOG_INFO("  speedup: {:.1f}x, largest difference {}", scalarTotal / std::max(batchedTotal, 1e-6), maxError);
+}
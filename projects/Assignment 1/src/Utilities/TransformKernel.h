@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+/// <summary>
+/// Positions, rotations and scales for many transforms, stored as one array per component so the kernel can load
+/// several transforms' worth of each component at once
+/// </summary>
+struct TransformSoA {
+	std::vector<float> PositionX, PositionY, PositionZ;
+	std::vector<float> RotationX, RotationY, RotationZ, RotationW;
+	std::vector<float> ScaleX, ScaleY, ScaleZ;
+
+	/// <summary>
+	/// Resizes every component array to hold the given number of transforms
+	/// </summary>
+	void Resize(size_t count);
+	/// <summary>
+	/// Gets the number of transforms in the arrays
+	/// </summary>
+	size_t Size() const { return PositionX.size(); }
+	/// <summary>
+	/// Stores a single transform's components at the given index
+	/// </summary>
+	void Set(size_t index, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+};
+
+/// <summary>
+/// Builds translate * rotate * scale matrices for many transforms at once. The instruction set is picked when we
+/// compile (AVX2, SSE or NEON, falling back to plain C++), and the results match glm::translate * glm::toMat4 *
+/// glm::scale for unit quaternions
+/// </summary>
+class TransformKernel final
+{
+public:
+	/// <summary>
+	/// The number of transforms the kernel handles per step, batches smaller than this aren't worth gathering
+	/// </summary>
+	static const size_t WIDTH;
+
+	/// <summary>
+	/// Composes the matrices for a range of transforms
+	/// </summary>
+	/// <param name="input">The components of the transforms, rotations must be unit quaternions</param>
+	/// <param name="first">The index of the first transform in the input to compose</param>
+	/// <param name="count">The number of transforms to compose</param>
+	/// <param name="output">Will store the matrices, must have room for count matrices</param>
+	static void Compose(const TransformSoA& input, size_t first, size_t count, glm::mat4* output);
+
+	/// <summary>
+	/// Gets the name of the instruction set the kernel was compiled for
+	/// </summary>
+	static const char* GetInstructionSet();
+
+	/// <summary>
+	/// Times the kernel against composing each matrix with GLM, and logs the results
+	/// </summary>
+	/// <param name="count">The number of transforms to compose per iteration</param>
+	/// <param name="iterations">The number of times to compose all of them with each method</param>
+	static void Benchmark(size_t count = 10000, uint32_t iterations = 100);
+
+protected:
+	TransformKernel() = default;
+	~TransformKernel() = default;
+};
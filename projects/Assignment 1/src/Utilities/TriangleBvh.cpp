@@ -0,0 +1,272 @@
+#include "TriangleBvh.h"
+#include <algorithm>
+#include <limits>
+
+#include "Logging.h"
+
+// The number of buckets that triangles get sorted into along each axis when looking for a split
+static const uint32_t BIN_COUNT = 12;
+
+// Half the surface area of a box, which is proportional to the chance that a random ray hits it
+static float GetArea(const glm::vec3& min, const glm::vec3& max) {
+	const glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+TriangleBvh::sptr TriangleBvh::Build(const float* positions, size_t stride, size_t vertexCount, const uint32_t* indices, size_t indexCount) {
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || positions == nullptr) {
+		return nullptr;
+	}
+
+	auto getPosition = [&](uint32_t index) {
+		LOG_ASSERT(index < vertexCount, "Index is outside of the vertices!");
+		const float* position = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + stride * index);
+		return glm::vec3(position[0], position[1], position[2]);
+	};
+
+	std::vector<BuildTriangle> triangles(triangleCount);
+	for (size_t ix = 0; ix < triangleCount; ix++) {
+		const glm::vec3 a = getPosition(indices[ix * 3 + 0]);
+		const glm::vec3 b = getPosition(indices[ix * 3 + 1]);
+		const glm::vec3 c = getPosition(indices[ix * 3 + 2]);
+		BuildTriangle& triangle = triangles[ix];
+		triangle.Min = glm::min(a, glm::min(b, c));
+		triangle.Max = glm::max(a, glm::max(b, c));
+		triangle.Centroid = (triangle.Min + triangle.Max) * 0.5f;
+		triangle.Id = static_cast<uint32_t>(ix);
+	}
+
+	sptr result = std::make_shared<TriangleBvh>();
+	result->_nodes.reserve(triangleCount * 2 / MAX_LEAF_TRIANGLES + 1);
+	result->_nodes.emplace_back();
+	result->_BuildNode(triangles, 0, 0, static_cast<uint32_t>(triangleCount), 0);
+
+	// Copy the corners out in the order the leaves ended up in
+	result->_corners.resize(triangleCount * 3);
+	result->_triangleIds.resize(triangleCount);
+	result->_treeOrder.resize(triangleCount);
+	for (size_t ix = 0; ix < triangleCount; ix++) {
+		const uint32_t id = triangles[ix].Id;
+		result->_corners[ix * 3 + 0] = getPosition(indices[id * 3 + 0]);
+		result->_corners[ix * 3 + 1] = getPosition(indices[id * 3 + 1]);
+		result->_corners[ix * 3 + 2] = getPosition(indices[id * 3 + 2]);
+		result->_triangleIds[ix] = id;
+		result->_treeOrder[id] = static_cast<uint32_t>(ix);
+	}
+	result->_nodes.shrink_to_fit();
+	return result;
+}
+
+void TriangleBvh::_BuildNode(std::vector<BuildTriangle>& triangles, uint32_t node, uint32_t first, uint32_t count, uint32_t depth) {
+	glm::vec3 min = triangles[first].Min;
+	glm::vec3 max = triangles[first].Max;
+	glm::vec3 centroidMin = triangles[first].Centroid;
+	glm::vec3 centroidMax = triangles[first].Centroid;
+	for (uint32_t ix = first + 1; ix < first + count; ix++) {
+		min = glm::min(min, triangles[ix].Min);
+		max = glm::max(max, triangles[ix].Max);
+		centroidMin = glm::min(centroidMin, triangles[ix].Centroid);
+		centroidMax = glm::max(centroidMax, triangles[ix].Centroid);
+	}
+	_nodes[node].Min = min;
+	_nodes[node].Max = max;
+
+	auto makeLeaf = [&]() {
+		_nodes[node].First = first;
+		_nodes[node].Count = count;
+	};
+	if (count <= MAX_LEAF_TRIANGLES) {
+		makeLeaf();
+		return;
+	}
+
+	// Sort the centroids into bins along each axis, and find the bin boundary that's cheapest to split at
+	const glm::vec3 extents = centroidMax - centroidMin;
+	int bestAxis = -1;
+	uint32_t bestSplit = 0;
+	float bestCost = GetArea(min, max) * static_cast<float>(count);
+	if (depth < MAX_SAH_DEPTH) {
+		for (int axis = 0; axis < 3; axis++) {
+			if (extents[axis] <= 0.0f) {
+				continue;
+			}
+			struct Bin {
+				glm::vec3 Min = glm::vec3(std::numeric_limits<float>::max());
+				glm::vec3 Max = glm::vec3(-std::numeric_limits<float>::max());
+				uint32_t  Count = 0;
+			} bins[BIN_COUNT];
+			const float scale = BIN_COUNT / extents[axis];
+			for (uint32_t ix = first; ix < first + count; ix++) {
+				const uint32_t bin = std::min(BIN_COUNT - 1, static_cast<uint32_t>((triangles[ix].Centroid[axis] - centroidMin[axis]) * scale));
+				bins[bin].Min = glm::min(bins[bin].Min, triangles[ix].Min);
+				bins[bin].Max = glm::max(bins[bin].Max, triangles[ix].Max);
+				bins[bin].Count++;
+			}
+
+			// Sweep from the right to get the cost of everything past each boundary, then from the left to total it up
+			float rightCost[BIN_COUNT];
+			glm::vec3 sweepMin = bins[BIN_COUNT - 1].Min;
+			glm::vec3 sweepMax = bins[BIN_COUNT - 1].Max;
+			uint32_t sweepCount = 0;
+			for (uint32_t bin = BIN_COUNT - 1; bin > 0; bin--) {
+				sweepMin = glm::min(sweepMin, bins[bin].Min);
+				sweepMax = glm::max(sweepMax, bins[bin].Max);
+				sweepCount += bins[bin].Count;
+				rightCost[bin] = sweepCount > 0 ? GetArea(sweepMin, sweepMax) * static_cast<float>(sweepCount) : 0.0f;
+			}
+			sweepMin = bins[0].Min;
+			sweepMax = bins[0].Max;
+			sweepCount = 0;
+			for (uint32_t bin = 1; bin < BIN_COUNT; bin++) {
+				sweepMin = glm::min(sweepMin, bins[bin - 1].Min);
+				sweepMax = glm::max(sweepMax, bins[bin - 1].Max);
+				sweepCount += bins[bin - 1].Count;
+				if (sweepCount == 0 || sweepCount == count) {
+					continue;
+				}
+				const float cost = GetArea(sweepMin, sweepMax) * static_cast<float>(sweepCount) + rightCost[bin];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = bin;
+				}
+			}
+		}
+	}
+
+	uint32_t leftCount;
+	if (bestAxis >= 0) {
+		const float scale = BIN_COUNT / extents[bestAxis];
+		const float boundary = centroidMin[bestAxis];
+		auto middle = std::partition(triangles.begin() + first, triangles.begin() + first + count, [&](const BuildTriangle& t) {
+			return std::min(BIN_COUNT - 1, static_cast<uint32_t>((t.Centroid[bestAxis] - boundary) * scale)) < bestSplit;
+		});
+		leftCount = static_cast<uint32_t>(middle - (triangles.begin() + first));
+	} else {
+		// Either we're too deep, or no split beats keeping the triangles together (ex: the centroids are all in the
+		// same spot), but the leaf would be too big so just split down the middle
+		const glm::vec3 size = extents;
+		const int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+		leftCount = count / 2;
+		std::nth_element(triangles.begin() + first, triangles.begin() + first + leftCount, triangles.begin() + first + count,
+			[axis](const BuildTriangle& l, const BuildTriangle& r) { return l.Centroid[axis] < r.Centroid[axis]; });
+	}
+
+	// Children are kept next to each other so a branch only needs to store where the left one is
+	const uint32_t left = static_cast<uint32_t>(_nodes.size());
+	_nodes.emplace_back();
+	_nodes.emplace_back();
+	_nodes[node].First = left;
+	_nodes[node].Count = 0;
+	_BuildNode(triangles, left, first, leftCount, depth + 1);
+	_BuildNode(triangles, left + 1, first + leftCount, count - leftCount, depth + 1);
+}
+
+// Gets the distance along a ray that it enters a box, or returns false if it misses the box before maxDistance
+static bool RayBox(const glm::vec3& origin, const glm::vec3& inverseDir, const glm::vec3& min, const glm::vec3& max, float maxDistance, float& enter) {
+	const glm::vec3 t0 = (min - origin) * inverseDir;
+	const glm::vec3 t1 = (max - origin) * inverseDir;
+	const glm::vec3 near = glm::min(t0, t1);
+	const glm::vec3 far = glm::max(t0, t1);
+	enter = glm::max(glm::max(near.x, near.y), glm::max(near.z, 0.0f));
+	const float exit = glm::min(glm::min(far.x, far.y), glm::min(far.z, maxDistance));
+	return enter <= exit;
+}
+
+bool TriangleBvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, TriangleHit& hit) const {
+	if (_nodes.empty()) {
+		return false;
+	}
+	const glm::vec3 inverseDir = 1.0f / direction;
+	float closest = maxDistance;
+	uint32_t closestIx = UINT32_MAX;
+	glm::vec2 closestUv;
+
+	float enter;
+	if (!RayBox(origin, inverseDir, _nodes[0].Min, _nodes[0].Max, closest, enter)) {
+		return false;
+	}
+	struct Entry { uint32_t Node; float Enter; };
+	Entry stack[64];
+	uint32_t top = 0;
+	stack[top++] = { 0, enter };
+	while (top > 0) {
+		const Entry entry = stack[--top];
+		// Something closer was found since this node got pushed
+		if (entry.Enter > closest) {
+			continue;
+		}
+		const Node& node = _nodes[entry.Node];
+		if (node.Count > 0) {
+			for (uint32_t ix = node.First; ix < node.First + node.Count; ix++) {
+				// Möller-Trumbore, without culling the back faces
+				const glm::vec3* corners = &_corners[ix * 3];
+				const glm::vec3 edge1 = corners[1] - corners[0];
+				const glm::vec3 edge2 = corners[2] - corners[0];
+				const glm::vec3 p = glm::cross(direction, edge2);
+				const float determinant = glm::dot(edge1, p);
+				if (glm::abs(determinant) < 1e-12f) {
+					continue;
+				}
+				const float inverseDet = 1.0f / determinant;
+				const glm::vec3 s = origin - corners[0];
+				const float u = glm::dot(s, p) * inverseDet;
+				if (u < 0.0f || u > 1.0f) {
+					continue;
+				}
+				const glm::vec3 q = glm::cross(s, edge1);
+				const float v = glm::dot(direction, q) * inverseDet;
+				if (v < 0.0f || u + v > 1.0f) {
+					continue;
+				}
+				const float t = glm::dot(edge2, q) * inverseDet;
+				if (t >= 0.0f && t < closest) {
+					closest = t;
+					closestIx = ix;
+					closestUv = glm::vec2(u, v);
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first, so it's hits can rule out the further one
+		float leftEnter, rightEnter;
+		const bool hitLeft = RayBox(origin, inverseDir, _nodes[node.First].Min, _nodes[node.First].Max, closest, leftEnter);
+		const bool hitRight = RayBox(origin, inverseDir, _nodes[node.First + 1].Min, _nodes[node.First + 1].Max, closest, rightEnter);
+		if (hitLeft && hitRight) {
+			if (leftEnter < rightEnter) {
+				stack[top++] = { node.First + 1, rightEnter };
+				stack[top++] = { node.First, leftEnter };
+			} else {
+				stack[top++] = { node.First, leftEnter };
+				stack[top++] = { node.First + 1, rightEnter };
+			}
+		} else if (hitLeft) {
+			stack[top++] = { node.First, leftEnter };
+		} else if (hitRight) {
+			stack[top++] = { node.First + 1, rightEnter };
+		}
+	}
+
+	if (closestIx == UINT32_MAX) {
+		return false;
+	}
+	hit.Distance = closest;
+	hit.Triangle = _triangleIds[closestIx];
+	hit.Barycentric = closestUv;
+	return true;
+}
+
+void TriangleBvh::GetTriangle(uint32_t triangle, glm::vec3& a, glm::vec3& b, glm::vec3& c) const {
+	LOG_ASSERT(triangle < _treeOrder.size(), "Triangle is outside of the tree!");
+	const glm::vec3* corners = &_corners[_treeOrder[triangle] * 3];
+	a = corners[0];
+	b = corners[1];
+	c = corners[2];
+}
+
+size_t TriangleBvh::GetMemoryUsage() const {
+	return _nodes.capacity() * sizeof(Node) + _corners.capacity() * sizeof(glm::vec3) +
+		(_triangleIds.capacity() + _treeOrder.capacity()) * sizeof(uint32_t);
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Where a ray hit a triangle in a TriangleBvh
+/// </summary>
+struct TriangleHit {
+	// How far along the ray the hit is, in units of the ray's direction
+	float    Distance = 0.0f;
+	// The index of the triangle that was hit, in the order of the indices the tree was built from
+	uint32_t Triangle = 0;
+	// The weights of the triangle's second and third corners at the hit point
+	glm::vec2 Barycentric = glm::vec2(0.0f);
+};
+
+/// <summary>
+/// A static bounding volume hierarchy over the triangles of a mesh, for ray picking and collision queries against
+/// the actual surface rather than it's bounds. These are built once when the mesh gets loaded (on the loading thread,
+/// since it's all CPU work), and keep their own copy of the triangles so they don't need the mesh to stick around
+/// </summary>
+class TriangleBvh final
+{
+public:
+	typedef std::shared_ptr<TriangleBvh> sptr;
+
+	/// <summary>
+	/// The most triangles to keep in a single leaf of the tree
+	/// </summary>
+	static const uint32_t MAX_LEAF_TRIANGLES = 4;
+	/// <summary>
+	/// How deep the surface area heuristic may take the tree before we fall back to median splits, this keeps the
+	/// tree shallow enough for the fixed traversal stacks
+	/// </summary>
+	static const uint32_t MAX_SAH_DEPTH = 24;
+
+	/// <summary>
+	/// Builds a tree over an indexed triangle list, splitting nodes with a binned surface area heuristic
+	/// </summary>
+	/// <param name="positions">The first vertex's position, as 3 floats</param>
+	/// <param name="stride">The number of bytes from one vertex's position to the next</param>
+	/// <param name="vertexCount">The number of vertices</param>
+	/// <param name="indices">The triangle list, 3 indices per triangle</param>
+	/// <param name="indexCount">The number of indices</param>
+	/// <returns>The new tree, or nullptr if there are no triangles</returns>
+	static sptr Build(const float* positions, size_t stride, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+
+	/// <summary>
+	/// Finds the closest triangle that a ray hits, triangles are hit from both sides
+	/// </summary>
+	/// <param name="origin">The start of the ray, in the mesh's space</param>
+	/// <param name="direction">The direction of the ray, does not need to be normalized</param>
+	/// <param name="maxDistance">The furthest along the ray to look, in units of direction</param>
+	/// <param name="hit">Will store the closest hit, if there is one</param>
+	/// <returns>True if the ray hit a triangle</returns>
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, TriangleHit& hit) const;
+
+	/// <summary>
+	/// Visits every triangle whose bounds overlap a box, for collision tests against the mesh
+	/// </summary>
+	/// <param name="min">The minimum corner of the box, in the mesh's space</param>
+	/// <param name="max">The maximum corner of the box, in the mesh's space</param>
+	/// <param name="visit">Called with the triangle's index and a pointer to it's three corners</param>
+	template <typename Func>
+	void QueryBox(const glm::vec3& min, const glm::vec3& max, Func visit) const {
+		if (_nodes.empty()) {
+			return;
+		}
+		uint32_t stack[64];
+		uint32_t top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node& node = _nodes[stack[--top]];
+			if (glm::any(glm::greaterThan(node.Min, max)) || glm::any(glm::lessThan(node.Max, min))) {
+				continue;
+			}
+			if (node.Count > 0) {
+				for (uint32_t ix = node.First; ix < node.First + node.Count; ix++) {
+					const glm::vec3* corners = &_corners[ix * 3];
+					const glm::vec3 triMin = glm::min(corners[0], glm::min(corners[1], corners[2]));
+					const glm::vec3 triMax = glm::max(corners[0], glm::max(corners[1], corners[2]));
+					if (glm::all(glm::lessThanEqual(triMin, max)) && glm::all(glm::greaterThanEqual(triMax, min))) {
+						visit(_triangleIds[ix], corners);
+					}
+				}
+			} else {
+				stack[top++] = node.First;
+				stack[top++] = node.First + 1;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Gets the corners of a triangle, by it's index in the original triangle list
+	/// </summary>
+	void GetTriangle(uint32_t triangle, glm::vec3& a, glm::vec3& b, glm::vec3& c) const;
+	/// <summary>
+	/// Gets the number of triangles in the tree
+	/// </summary>
+	size_t GetTriangleCount() const { return _triangleIds.size(); }
+	/// <summary>
+	/// Gets the number of nodes in the tree
+	/// </summary>
+	size_t GetNodeCount() const { return _nodes.size(); }
+	/// <summary>
+	/// Gets the number of bytes that the tree is using
+	/// </summary>
+	size_t GetMemoryUsage() const;
+
+	TriangleBvh() = default;
+	TriangleBvh(const TriangleBvh& other) = delete;
+	TriangleBvh& operator=(const TriangleBvh& other) = delete;
+
+private:
+	struct Node {
+		glm::vec3 Min;
+		// For leaves, the first triangle in _corners, otherwise the left child (the right one is right after it)
+		uint32_t  First;
+		glm::vec3 Max;
+		// The number of triangles in a leaf, or 0 for branches
+		uint32_t  Count;
+	};
+	// A triangle that hasn't been placed in the tree yet
+	struct BuildTriangle {
+		glm::vec3 Min, Max, Centroid;
+		uint32_t  Id;
+	};
+
+	// Sorted so that every leaf's triangles are next to each other, with the corners copied out so hits don't need
+	// to go through the indices
+	std::vector<Node>      _nodes;
+	std::vector<glm::vec3> _corners;
+	// Maps triangles in the tree's order back to the original triangle list
+	std::vector<uint32_t>  _triangleIds;
+	// Maps triangles in the original triangle list to the tree's order
+	std::vector<uint32_t>  _treeOrder;
+
+	// Splits a range of triangles into a node and it's children
+	void _BuildNode(std::vector<BuildTriangle>& triangles, uint32_t node, uint32_t first, uint32_t count, uint32_t depth);
+};
@@ -71,7 +71,7 @@ int Util::GetRandomNumberBetween(int from, int to, int avoidFrom, int avoidTo)
     }
     else
     {
-        GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
+        return GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
     }
 }
 
@@ -95,7 +95,7 @@ float Util::GetRandomNumberBetween(float from, float to, float avoidFrom, float
     }
     else
     {
-        GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
+        return GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
     }
 }
 
@@ -112,7 +112,7 @@ glm::vec2 Util::GetRandomNumberBetween(glm::vec2 from, glm::vec2 to, glm::vec2 a
     }
     else
     {
-        GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
+        return GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
     }
 }
 
@@ -130,7 +130,7 @@ glm::vec3 Util::GetRandomNumberBetween(glm::vec3 from, glm::vec3 to, glm::vec3 a
     }
     else
     {
-        GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
+        return GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
     }
 }
 
@@ -149,6 +149,6 @@ glm::vec3 Util::GetRandomNumberBetween(glm::vec4 from, glm::vec4 to, glm::vec4 a
     }
     else
     {
-        GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
+        return GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
     }
 }
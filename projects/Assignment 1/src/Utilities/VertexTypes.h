@@ -1,7 +1,14 @@
 #pragma once
 
+#include <array>
 #include <GLM/glm.hpp>
+#include <GLM/gtc/packing.hpp>
 #include "Graphics/VertexArrayObject.h"
+#include "Graphics/VertexDeclaration.h"
+
+// Each vertex type has it's attributes declared twice over: V_LAYOUT is worked out from the struct at compile time
+// (see VertexDeclaration.h) and checked with a static_assert, and V_DECL is a copy of it in the form the rest of our
+// code takes. The layouts are defined at the bottom, once the structs are complete
 
 struct VertexPosCol {
 	glm::vec3 Position;
@@ -13,6 +20,7 @@ struct VertexPosCol {
 	VertexPosCol(float x, float y, float z, float r, float g, float b, float a = 1.0f) :
 		Position({x, y, z}), Color({r, g, b, a}) {}
 
+	static const std::array<BufferAttribute, 2> V_LAYOUT;
 	static const std::vector<BufferAttribute> V_DECL;
 };
 
@@ -27,6 +35,7 @@ struct VertexPosNormCol {
 	VertexPosNormCol(float x, float y, float z, float nX, float nY, float nZ, float r, float g, float b, float a = 1.0f) :
 		Position({ x, y, z }), Normal({nX, nY, nZ}), Color({ r, g, b, a }) {}
 	
+	static const std::array<BufferAttribute, 3> V_LAYOUT;
 	static const std::vector<BufferAttribute> V_DECL;
 };
 
@@ -41,6 +50,7 @@ struct VertexPosNormTex {
 	VertexPosNormTex(float x, float y, float z, float nX, float nY, float nZ, float u, float v) :
 		Position({ x, y, z }), Normal({ nX, nY, nZ }), UV({ u, v }) {}
 
+	static const std::array<BufferAttribute, 3> V_LAYOUT;
 	static const std::vector<BufferAttribute> V_DECL;
 };
 
@@ -56,5 +66,166 @@ struct VertexPosNormTexCol {
 	VertexPosNormTexCol(float x, float y, float z, float nX, float nY, float nZ, float u, float v, float r, float g, float b, float a = 1.0f) :
 		Position({ x, y, z }), Normal({ nX, nY, nZ }), UV({ u, v }), Color({r, g, b, a}) {}
 
+	static const std::array<BufferAttribute, 4> V_LAYOUT;
+	static const std::vector<BufferAttribute> V_DECL;
+};
+
+/// <summary>
+/// A packed copy of VertexPosNormTexCol at half the size (24 bytes instead of 48), for meshes that are loaded once
+/// and never touched on the CPU again. Every attribute still arrives in the shader as the same vec type, so any shader
+/// that works with VertexPosNormTexCol works with this as well:
+///   Position - 3 floats, positions need the full range since meshes share arenas with different bounds
+///   Normal   - 10:10:10:2 signed normalized, plenty of precision for lighting
+///   UV       - 2 half floats
+///   Color    - RGBA8 unsigned normalized
+/// </summary>
+struct VertexPackedPosNormTexCol {
+	glm::vec3 Position;
+	uint32_t  Normal;
+	uint32_t  UV;
+	uint32_t  Color;
+
+	VertexPackedPosNormTexCol() : Position(glm::vec3(0.0f)), Normal(0), UV(0), Color(0xFF000000) {}
+	explicit VertexPackedPosNormTexCol(const VertexPosNormTexCol& vertex) :
+		Position(vertex.Position),
+		Normal(glm::packSnorm3x10_1x2(glm::vec4(vertex.Normal, 0.0f))),
+		UV(glm::packHalf2x16(vertex.UV)),
+		Color(glm::packUnorm4x8(vertex.Color)) {}
+
+	static const std::array<BufferAttribute, 4> V_LAYOUT;
+	static const std::vector<BufferAttribute> V_DECL;
+};
+
+/// <summary>
+/// A VertexPosNormTexCol with a tangent for normal mapping, this is what MeshBuilder::GenerateTangents fills in. The
+/// tangent's w holds the handedness of the UVs (+1 or -1), the bitangent is rebuilt in the shader as
+/// cross(normal, tangent) * w, the same convention as MikkTSpace. A zero tangent means there wasn't one (ex: the
+/// vertex's triangles have no UV area), and the shaders fall back to the vertex normal
+/// </summary>
+struct VertexPosNormTanTexCol {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::vec4 Tangent;
+	glm::vec2 UV;
+	glm::vec4 Color;
+
+	VertexPosNormTanTexCol() : Position(glm::vec3(0.0f)), Normal(glm::vec3(0.0f)), Tangent(glm::vec4(0.0f)), UV(glm::vec2(0.0f)), Color(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)) {}
+	VertexPosNormTanTexCol(const glm::vec3& pos, const glm::vec3& norm, const glm::vec4& tangent, const glm::vec2& uv, const glm::vec4& col) :
+		Position(pos), Normal(norm), Tangent(tangent), UV(uv), Color(col) {}
+	// Leaves the tangent empty, for filling in with MeshBuilder::GenerateTangents
+	explicit VertexPosNormTanTexCol(const VertexPosNormTexCol& vertex) :
+		Position(vertex.Position), Normal(vertex.Normal), Tangent(glm::vec4(0.0f)), UV(vertex.UV), Color(vertex.Color) {}
+
+	static const std::array<BufferAttribute, 5> V_LAYOUT;
+	static const std::vector<BufferAttribute> V_DECL;
+};
+
+/// <summary>
+/// A packed copy of VertexPosNormTanTexCol, which is VertexPackedPosNormTexCol with a tangent added (28 bytes instead
+/// of 60). The tangent is packed the same way as the normal, with the handedness in the 2 bit component
+/// </summary>
+struct VertexPackedPosNormTanTexCol {
+	glm::vec3 Position;
+	uint32_t  Normal;
+	uint32_t  Tangent;
+	uint32_t  UV;
+	uint32_t  Color;
+
+	VertexPackedPosNormTanTexCol() : Position(glm::vec3(0.0f)), Normal(0), Tangent(0), UV(0), Color(0xFF000000) {}
+	explicit VertexPackedPosNormTanTexCol(const VertexPosNormTanTexCol& vertex) :
+		Position(vertex.Position),
+		Normal(glm::packSnorm3x10_1x2(glm::vec4(vertex.Normal, 0.0f))),
+		Tangent(glm::packSnorm3x10_1x2(vertex.Tangent)),
+		UV(glm::packHalf2x16(vertex.UV)),
+		Color(glm::packUnorm4x8(vertex.Color)) {}
+	// Adds an already packed tangent to a packed vertex, for cooked meshes that store their tangents separately
+	VertexPackedPosNormTanTexCol(const VertexPackedPosNormTexCol& vertex, uint32_t tangent) :
+		Position(vertex.Position), Normal(vertex.Normal), Tangent(tangent), UV(vertex.UV), Color(vertex.Color) {}
+
+	static const std::array<BufferAttribute, 5> V_LAYOUT;
+	static const std::vector<BufferAttribute> V_DECL;
+};
+
+/// <summary>
+/// The per-instance data streamed to the vertex shader when drawing instanced meshes
+/// </summary>
+struct InstanceTransform {
+	glm::mat4 Model;
+	glm::mat3 NormalMatrix;
+	// The entry in the material buffer to read this instance's material values from
+	uint32_t  MaterialIndex;
+
+	InstanceTransform() : Model(glm::mat4(1.0f)), NormalMatrix(glm::mat3(1.0f)), MaterialIndex(0) {}
+	InstanceTransform(const glm::mat4& model, const glm::mat3& normalMatrix, uint32_t materialIndex = 0) :
+		Model(model), NormalMatrix(normalMatrix), MaterialIndex(materialIndex) {}
+
+	static const std::array<BufferAttribute, 8> V_LAYOUT;
 	static const std::vector<BufferAttribute> V_DECL;
-};
\ No newline at end of file
+};
+
+inline constexpr std::array<BufferAttribute, 2> VertexPosCol::V_LAYOUT = {
+	VERTEX_ATTRIB(VertexPosCol, Position, 0, AttribUsage::Position),
+	VERTEX_ATTRIB(VertexPosCol, Color,    1, AttribUsage::Color),
+};
+inline constexpr std::array<BufferAttribute, 3> VertexPosNormCol::V_LAYOUT = {
+	VERTEX_ATTRIB(VertexPosNormCol, Position, 0, AttribUsage::Position),
+	VERTEX_ATTRIB(VertexPosNormCol, Color,    1, AttribUsage::Color),
+	VERTEX_ATTRIB(VertexPosNormCol, Normal,   2, AttribUsage::Normal),
+};
+inline constexpr std::array<BufferAttribute, 3> VertexPosNormTex::V_LAYOUT = {
+	VERTEX_ATTRIB(VertexPosNormTex, Position, 0, AttribUsage::Position),
+	VERTEX_ATTRIB(VertexPosNormTex, Normal,   2, AttribUsage::Normal),
+	VERTEX_ATTRIB(VertexPosNormTex, UV,       3, AttribUsage::Texture),
+};
+inline constexpr std::array<BufferAttribute, 4> VertexPosNormTexCol::V_LAYOUT = {
+	VERTEX_ATTRIB(VertexPosNormTexCol, Position, 0, AttribUsage::Position),
+	VERTEX_ATTRIB(VertexPosNormTexCol, Color,    1, AttribUsage::Color),
+	VERTEX_ATTRIB(VertexPosNormTexCol, Normal,   2, AttribUsage::Normal),
+	VERTEX_ATTRIB(VertexPosNormTexCol, UV,       3, AttribUsage::Texture),
+};
+// Uses the same slots as VertexPosNormTexCol, so the same shaders can draw either
+inline constexpr std::array<BufferAttribute, 4> VertexPackedPosNormTexCol::V_LAYOUT = {
+	VERTEX_ATTRIB(VertexPackedPosNormTexCol, Position, 0, AttribUsage::Position),
+	VERTEX_ATTRIB_PACKED(VertexPackedPosNormTexCol, Color,  1, 4, GL_UNSIGNED_BYTE, true, AttribUsage::Color),
+	VERTEX_ATTRIB_PACKED(VertexPackedPosNormTexCol, Normal, 2, 4, GL_INT_2_10_10_10_REV, true, AttribUsage::Normal),
+	VERTEX_ATTRIB_PACKED(VertexPackedPosNormTexCol, UV,     3, 2, GL_HALF_FLOAT, false, AttribUsage::Texture),
+};
+// The tangent goes after the instance data's slots, so these draw with the same shaders as the types above (the
+// shaders only read it with NORMAL_MAP defined)
+inline constexpr std::array<BufferAttribute, 5> VertexPosNormTanTexCol::V_LAYOUT = {
+	VERTEX_ATTRIB(VertexPosNormTanTexCol, Position, 0,  AttribUsage::Position),
+	VERTEX_ATTRIB(VertexPosNormTanTexCol, Color,    1,  AttribUsage::Color),
+	VERTEX_ATTRIB(VertexPosNormTanTexCol, Normal,   2,  AttribUsage::Normal),
+	VERTEX_ATTRIB(VertexPosNormTanTexCol, UV,       3,  AttribUsage::Texture),
+	VERTEX_ATTRIB(VertexPosNormTanTexCol, Tangent,  12, AttribUsage::Tangent),
+};
+inline constexpr std::array<BufferAttribute, 5> VertexPackedPosNormTanTexCol::V_LAYOUT = {
+	VERTEX_ATTRIB(VertexPackedPosNormTanTexCol, Position, 0, AttribUsage::Position),
+	VERTEX_ATTRIB_PACKED(VertexPackedPosNormTanTexCol, Color,   1,  4, GL_UNSIGNED_BYTE, true, AttribUsage::Color),
+	VERTEX_ATTRIB_PACKED(VertexPackedPosNormTanTexCol, Normal,  2,  4, GL_INT_2_10_10_10_REV, true, AttribUsage::Normal),
+	VERTEX_ATTRIB_PACKED(VertexPackedPosNormTanTexCol, UV,      3,  2, GL_HALF_FLOAT, false, AttribUsage::Texture),
+	VERTEX_ATTRIB_PACKED(VertexPackedPosNormTanTexCol, Tangent, 12, 4, GL_INT_2_10_10_10_REV, true, AttribUsage::Tangent),
+};
+// Matrices take up one attribute slot per column, so the model matrix uses slots 4-7 and the normal matrix 8-10
+inline constexpr std::array<BufferAttribute, 8> InstanceTransform::V_LAYOUT = {
+	VERTEX_ATTRIB_COLUMN(InstanceTransform, Model, 0, 4, AttribUsage::User0),
+	VERTEX_ATTRIB_COLUMN(InstanceTransform, Model, 1, 5, AttribUsage::User0),
+	VERTEX_ATTRIB_COLUMN(InstanceTransform, Model, 2, 6, AttribUsage::User0),
+	VERTEX_ATTRIB_COLUMN(InstanceTransform, Model, 3, 7, AttribUsage::User0),
+	VERTEX_ATTRIB_COLUMN(InstanceTransform, NormalMatrix, 0, 8,  AttribUsage::User1),
+	VERTEX_ATTRIB_COLUMN(InstanceTransform, NormalMatrix, 1, 9,  AttribUsage::User1),
+	VERTEX_ATTRIB_COLUMN(InstanceTransform, NormalMatrix, 2, 10, AttribUsage::User1),
+	VERTEX_ATTRIB(InstanceTransform, MaterialIndex, 11, AttribUsage::User2),
+};
+
+static_assert(IsValidVertexDecl(VertexPosCol::V_LAYOUT, sizeof(VertexPosCol)), "VertexPosCol's layout doesn't fit it");
+static_assert(IsValidVertexDecl(VertexPosNormCol::V_LAYOUT, sizeof(VertexPosNormCol)), "VertexPosNormCol's layout doesn't fit it");
+static_assert(IsValidVertexDecl(VertexPosNormTex::V_LAYOUT, sizeof(VertexPosNormTex)), "VertexPosNormTex's layout doesn't fit it");
+static_assert(IsValidVertexDecl(VertexPosNormTexCol::V_LAYOUT, sizeof(VertexPosNormTexCol)), "VertexPosNormTexCol's layout doesn't fit it");
+static_assert(IsValidVertexDecl(VertexPackedPosNormTexCol::V_LAYOUT, sizeof(VertexPackedPosNormTexCol)), "VertexPackedPosNormTexCol's layout doesn't fit it");
+static_assert(IsValidVertexDecl(VertexPosNormTanTexCol::V_LAYOUT, sizeof(VertexPosNormTanTexCol)), "VertexPosNormTanTexCol's layout doesn't fit it");
+static_assert(IsValidVertexDecl(VertexPackedPosNormTanTexCol::V_LAYOUT, sizeof(VertexPackedPosNormTanTexCol)), "VertexPackedPosNormTanTexCol's layout doesn't fit it");
+static_assert(IsValidVertexDecl(InstanceTransform::V_LAYOUT, sizeof(InstanceTransform)), "InstanceTransform's layout doesn't fit it");
+// The packing is only worth it while it stays at half the size
+static_assert(sizeof(VertexPackedPosNormTexCol) == 24, "VertexPackedPosNormTexCol should be half the size of VertexPosNormTexCol");
+static_assert(sizeof(VertexPackedPosNormTanTexCol) == 28, "VertexPackedPosNormTanTexCol should only add the packed tangent");
@@ -0,0 +1,82 @@
+#include "VirtualFileSystem.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "Logging.h"
+
+std::vector<AssetArchive::sptr> VirtualFileSystem::_archives;
+
+bool VirtualFileSystem::Mount(const std::string& archivePath) {
+	AssetArchive::sptr archive = AssetArchive::Open(archivePath);
+	if (archive == nullptr) {
+		return false;
+	}
+	_archives.push_back(archive);
+	return true;
+}
+
+void VirtualFileSystem::UnmountAll() {
+	_archives.clear();
+}
+
+const AssetArchive::Entry* VirtualFileSystem::_Find(const std::string& path, const AssetArchive** archive) {
+	for (auto it = _archives.rbegin(); it != _archives.rend(); ++it) {
+		const AssetArchive::Entry* entry = (*it)->Find(path);
+		if (entry != nullptr) {
+			*archive = it->get();
+			return entry;
+		}
+	}
+	return nullptr;
+}
+
+VirtualFile::sptr VirtualFileSystem::Open(const std::string& path) {
+	const AssetArchive* archive = nullptr;
+	const AssetArchive::Entry* entry = _Find(path, &archive);
+	if (entry != nullptr) {
+		// Stored entries can be used right out of the archive's mapping
+		const char* stored = archive->GetStoredData(*entry);
+		if (stored != nullptr) {
+			return std::make_shared<VirtualFile>(archive->GetMapping(), stored, static_cast<size_t>(entry->Size));
+		}
+		std::string buffer;
+		if (!archive->ReadRange(*entry, 0, entry->Size, buffer)) {
+			return nullptr;
+		}
+		return std::make_shared<VirtualFile>(std::move(buffer));
+	}
+
+	MappedFile::sptr file = MappedFile::Open(path);
+	if (file == nullptr) {
+		return nullptr;
+	}
+	return std::make_shared<VirtualFile>(file, file->GetData(), file->GetSize());
+}
+
+bool VirtualFileSystem::ReadRange(const std::string& path, uint64_t offset, uint64_t size, std::string& result) {
+	const AssetArchive* archive = nullptr;
+	const AssetArchive::Entry* entry = _Find(path, &archive);
+	if (entry != nullptr) {
+		return archive->ReadRange(*entry, offset, size, result);
+	}
+
+	MappedFile::sptr file = MappedFile::Open(path);
+	if (file == nullptr) {
+		return false;
+	}
+	result.clear();
+	if (offset < file->GetSize()) {
+		result.assign(file->GetData() + offset, static_cast<size_t>(std::min<uint64_t>(size, file->GetSize() - offset)));
+	}
+	return true;
+}
+
+bool VirtualFileSystem::Exists(const std::string& path) {
+	const AssetArchive* archive = nullptr;
+	if (_Find(path, &archive) != nullptr) {
+		return true;
+	}
+	std::error_code error;
+	return std::filesystem::is_regular_file(path, error);
+}
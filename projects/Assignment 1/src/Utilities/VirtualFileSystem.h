@@ -0,0 +1,96 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AssetArchive.h"
+#include "MappedFile.h"
+
+/// <summary>
+/// The contents of a file opened through the VirtualFileSystem. Files that are stored as is (loose files, or
+/// uncompressed archive entries) are views into a memory mapping, compressed entries get inflated into a buffer
+/// </summary>
+class VirtualFile final
+{
+public:
+	VirtualFile(const VirtualFile& other) = delete;
+	VirtualFile(VirtualFile&& other) = delete;
+	VirtualFile& operator=(const VirtualFile& other) = delete;
+	VirtualFile& operator=(VirtualFile&& other) = delete;
+	typedef std::shared_ptr<VirtualFile> sptr;
+
+	/// <summary>
+	/// Creates a file that views part of a mapping, which it keeps alive
+	/// </summary>
+	VirtualFile(const MappedFile::sptr& mapping, const char* data, size_t size) :
+		_mapping(mapping), _data(data), _size(size) {}
+	/// <summary>
+	/// Creates a file that owns it's contents
+	/// </summary>
+	VirtualFile(std::string&& buffer) :
+		_buffer(std::move(buffer)), _data(_buffer.data()), _size(_buffer.size()) {}
+
+	/// <summary>
+	/// Gets a pointer to the start of the file's contents, may be nullptr if the file is empty
+	/// </summary>
+	const char* GetData() const { return _data; }
+	/// <summary>
+	/// Gets the size of the file, in bytes
+	/// </summary>
+	size_t GetSize() const { return _size; }
+
+private:
+	MappedFile::sptr _mapping;
+	std::string      _buffer;
+	const char*      _data;
+	size_t           _size;
+};
+
+/// <summary>
+/// Lets the loaders read assets without caring whether they're loose files or packed into an AssetArchive. Mounted
+/// archives are searched first (most recently mounted first), then we fall back to the disk
+///
+/// Archives should be mounted before anything starts loading, since lookups from the workers don't lock
+/// </summary>
+class VirtualFileSystem final
+{
+public:
+	/// <summary>
+	/// Maps an archive so it's files can be opened through the file system
+	/// </summary>
+	/// <param name="archivePath">The path to the archive</param>
+	/// <returns>True if the archive was mounted, false if it doesn't exist or is corrupted</returns>
+	static bool Mount(const std::string& archivePath);
+	/// <summary>
+	/// Unmounts all archives, files that are already open stay valid
+	/// </summary>
+	static void UnmountAll();
+
+	/// <summary>
+	/// Opens a file, from an archive if one has it or from the disk otherwise
+	/// </summary>
+	/// <param name="path">The path of the file, relative to the working directory</param>
+	/// <returns>The file's contents, or nullptr if the file doesn't exist or couldn't be read</returns>
+	static VirtualFile::sptr Open(const std::string& path);
+	/// <summary>
+	/// Reads part of a file, only inflating the parts of a compressed archive entry that are needed
+	/// </summary>
+	/// <param name="path">The path of the file, relative to the working directory</param>
+	/// <param name="offset">The first byte to read</param>
+	/// <param name="size">The number of bytes to read, clamped to the end of the file</param>
+	/// <param name="result">Will store the bytes that were read</param>
+	/// <returns>True if the file exists and could be read</returns>
+	static bool ReadRange(const std::string& path, uint64_t offset, uint64_t size, std::string& result);
+	/// <summary>
+	/// Checks whether a file exists in an archive or on the disk
+	/// </summary>
+	static bool Exists(const std::string& path);
+
+protected:
+	VirtualFileSystem() = default;
+
+	static std::vector<AssetArchive::sptr> _archives;
+
+	// Finds the most recently mounted archive that has the file
+	static const AssetArchive::Entry* _Find(const std::string& path, const AssetArchive** archive);
+};
@@ -1,4 +1,5 @@
 #include <Logging.h>
+#include <Sys.h>
 #include <iostream>
 
 #include <glad/glad.h>
@@ -7,80 +8,149 @@
 #include <filesystem>
 #include <json.hpp>
 #include <fstream>
+#include <ctime>
+#include <algorithm>
+#include <map>
 
 #include <GLM/glm.hpp>
 #include <GLM/gtc/matrix_transform.hpp>
 #include <GLM/gtc/type_ptr.hpp>
+#include <GLM/gtc/random.hpp>
+#include <GLM/gtc/noise.hpp>
 
 #include "Graphics/IndexBuffer.h"
+#include "Graphics/Frustum.h"
+#include "Graphics/GlDebugOutput.h"
+#include "Graphics/GpuDeletionQueue.h"
+#include "Graphics/GpuProfiler.h"
+#include "Graphics/GpuResources.h"
+#include "Graphics/IndirectBuffer.h"
+#include "Graphics/InstanceStream.h"
+#include "Graphics/MaterialBuffer.h"
+#include "Graphics/MeshArena.h"
+#include "Graphics/MeshUploadStream.h"
+#include "Graphics/ClusteredLighting.h"
+#include "Graphics/CommandList.h"
+#include "Graphics/DeferredShading.h"
+#include "Graphics/WeightedBlending.h"
+#include "Graphics/DepthPyramid.h"
+#include "Graphics/AmbientOcclusion.h"
+#include "Graphics/OcclusionQueries.h"
+#include "Graphics/FrameCapture.h"
+#include "Graphics/DynamicResolution.h"
+#include "Graphics/EnvironmentPrefilter.h"
+#include "Graphics/PanoramaConverter.h"
+#include "Graphics/ShadowMaps.h"
+#include "Graphics/SkyboxPass.h"
+#include "Graphics/MeshletCuller.h"
+#include "Graphics/InstanceCuller.h"
+#include "Graphics/RenderRecords.h"
+#include "Graphics/PostProcessing.h"
+#include "Graphics/RenderState.h"
+#include "Graphics/RenderStats.h"
 #include "Graphics/VertexBuffer.h"
 #include "Graphics/VertexArrayObject.h"
 #include "Graphics/Shader.h"
+#include "Graphics/ShaderCook.h"
+#include "Graphics/ShaderStage.h"
+#include "Graphics/ShaderVariants.h"
+#include "Graphics/UiCache.h"
+#include "Graphics/ViewTarget.h"
 #include "Gameplay/Camera.h"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "Behaviours/CameraControlBehaviour.h"
 #include "Behaviours/FollowPathBehaviour.h"
+#include "Gameplay/PathFollowSystem.h"
 #include "Behaviours/SimpleMoveBehaviour.h"
+#include "AudioEngine.h"
 #include "Gameplay/Application.h"
+#include "Gameplay/AudioComponents.h"
 #include "Gameplay/GameObjectTag.h"
 #include "Gameplay/IBehaviour.h"
+#include "Gameplay/Impostor.h"
+#include "Gameplay/Lightmapper.h"
+#include "Gameplay/Light.h"
+#include "Gameplay/ParticleEmitter.h"
+#include "Gameplay/ParticleSystem.h"
+#include "Gameplay/PhysicsWorld.h"
+#include "Gameplay/BehaviourSystems.h"
 #include "Gameplay/Transform.h"
 #include "Graphics/Texture2D.h"
 #include "Graphics/Texture2DData.h"
+#include "Graphics/TextureCompressor.h"
+#include "Graphics/TextureArrayBuilder.h"
+#include "Graphics/TextureCook.h"
+#include "Graphics/TextureLoader.h"
+#include "Graphics/TextureResidency.h"
+#include "Utilities/AssetManager.h"
+#include "Utilities/Benchmark.h"
+#include "Utilities/CpuProfiler.h"
+#include "Utilities/CpuTopology.h"
+#include "Utilities/FileWatcher.h"
+#include "Utilities/FleetTelemetry.h"
+#include "Utilities/FrameArena.h"
 #include "Utilities/InputHelpers.h"
+#include "Utilities/InputRecorder.h"
+#include "Utilities/IoScheduler.h"
+#include "Utilities/MemoryTracker.h"
+#include "TTK/Input.h"
 #include "Utilities/MeshBuilder.h"
+#include "Utilities/MeshCook.h"
 #include "Utilities/MeshFactory.h"
 #include "Utilities/NotObjLoader.h"
+#include "Utilities/PowerMode.h"
+#include "Utilities/RemoteProfiler.h"
+#include "Utilities/StartupReport.h"
+#include "Utilities/TraceRecorder.h"
 #include "Utilities/ObjLoader.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/TransformKernel.h"
 #include "Utilities/VertexTypes.h"
+#include "Utilities/VirtualFileSystem.h"
 #include "Gameplay/Scene.h"
+#include "Gameplay/SceneManager.h"
+#include "Gameplay/SceneSerializer.h"
+#include "Gameplay/FrameScheduler.h"
+#include "Gameplay/SpatialIndex.h"
 #include "Gameplay/ShaderMaterial.h"
+#include "Gameplay/StaticBatcher.h"
 #include "Gameplay/RendererComponent.h"
+#include "Gameplay/RigidBody.h"
+#include "Gameplay/SceneAudio.h"
+#include "Gameplay/RenderSnapshot.h"
+#include "Gameplay/GpuPicker.h"
+#include "Gameplay/Scatter.h"
+#include "Gameplay/Terrain.h"
+#include "Gameplay/VertexAnimationTexture.h"
+#include "Gameplay/StressScene.h"
 #include "Gameplay/Timing.h"
+#include "Gameplay/TransformInterpolation.h"
+#include "Gameplay/WorldPartition.h"
 #include "Graphics/TextureCubeMap.h"
 #include "Graphics/TextureCubeMapData.h"
+#include "Graphics/UniformBuffer.h"
+#include "Graphics/UniformBlocks.h"
+#include "Graphics/UploadContext.h"
+#include "Graphics/VirtualTexture.h"
 #include "Utilities/Util.h"
 
-#define LOG_GL_NOTIFICATIONS
-#define NUM_TREES 25
+#define TREE_SPACING 6.0f
 #define PLANE_X 19.0f
 #define PLANE_Y 19.0f
 #define DNS_X 3.0f
 #define DNS_Y 3.0f
-
-/*
-	Handles debug messages from OpenGL
-	https://www.khronos.org/opengl/wiki/Debug_Output#Message_Components
-	@param source    Which part of OpenGL dispatched the message
-	@param type      The type of message (ex: error, performance issues, deprecated behavior)
-	@param id        The ID of the error or message (to distinguish between different types of errors, like nullref or index out of range)
-	@param severity  The severity of the message (from High to Notification)
-	@param length    The length of the message
-	@param message   The human readable message from OpenGL
-	@param userParam The pointer we set with glDebugMessageCallback (should be the game pointer)
-*/
-void GlDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam) {
-	std::string sourceTxt;
-	switch (source) {
-	case GL_DEBUG_SOURCE_API: sourceTxt = "DEBUG"; break;
-	case GL_DEBUG_SOURCE_WINDOW_SYSTEM: sourceTxt = "WINDOW"; break;
-	case GL_DEBUG_SOURCE_SHADER_COMPILER: sourceTxt = "SHADER"; break;
-	case GL_DEBUG_SOURCE_THIRD_PARTY: sourceTxt = "THIRD PARTY"; break;
-	case GL_DEBUG_SOURCE_APPLICATION: sourceTxt = "APP"; break;
-	case GL_DEBUG_SOURCE_OTHER: default: sourceTxt = "OTHER"; break;
-	}
-	switch (severity) {
-	case GL_DEBUG_SEVERITY_LOW:          LOG_INFO("[{}] {}", sourceTxt, message); break;
-	case GL_DEBUG_SEVERITY_MEDIUM:       LOG_WARN("[{}] {}", sourceTxt, message); break;
-	case GL_DEBUG_SEVERITY_HIGH:         LOG_ERROR("[{}] {}", sourceTxt, message); break;
-		#ifdef LOG_GL_NOTIFICATIONS
-	case GL_DEBUG_SEVERITY_NOTIFICATION: LOG_INFO("[{}] {}", sourceTxt, message); break;
-		#endif
-	default: break;
-	}
-}
+#define TRACE_FRAME_COUNT 120
+#define WORLD_CELL_SIZE 10.0f
+// The most time (in ms) we spend each frame on loading work that has to run on the main thread
+#define MAIN_THREAD_JOB_BUDGET 2.0
+// How many frames ahead we guess where the camera is heading, so textures can be loaded before they come into view
+#define LOAD_PREDICTION_FRAMES 30.0f
+// How often (in seconds) a cached UI gets rebuilt when there's no input, so the stats on it keep ticking over
+#define UI_IDLE_REFRESH_INTERVAL 0.1
+// The width and height of the terrain's virtual ground texture, in texels
+#define VIRTUAL_GROUND_SIZE 8192
 
 GLFWwindow* window;
 
@@ -91,7 +161,7 @@ void GlfwWindowResizedCallback(GLFWwindow* window, int width, int height) {
 	});
 }
 
-bool InitGLFW() {
+bool InitGLFW(bool isVisible) {
 	if (glfwInit() == GLFW_FALSE) {
 		LOG_ERROR("Failed to initialize GLFW");
 		return false;
@@ -100,6 +170,8 @@ bool InitGLFW() {
 #ifdef _DEBUG
 	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true);
 #endif
+	// A hidden window still gets a context and a default framebuffer, it just never shows up on screen
+	glfwWindowHint(GLFW_VISIBLE, isVisible);
 	
 	//Create a new GLFW window
 	window = glfwCreateWindow(800, 800, "INFR1350U", nullptr, nullptr);
@@ -131,10 +203,13 @@ void InitImGui() {
 	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
 	// Allow docking to our window
 	io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
-	// Allow multiple viewports (so we can drag ImGui off our window)
+#ifdef _DEBUG
+	// Allow multiple viewports (so we can drag ImGui off our window). Each one is a window of it's own that gets drawn
+	// every frame, so they're only worth it while debugging
 	io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
 	// Allow our viewports to use transparent backbuffers
 	io.ConfigFlags |= ImGuiConfigFlags_TransparentBackbuffers;
+#endif
 
 	// Set up the ImGui implementation for OpenGL
 	ImGui_ImplGlfw_InitForOpenGL(window, true);
@@ -162,7 +237,57 @@ void ShutdownImGui()
 }
 
 std::vector<std::function<void()>> imGuiCallbacks;
+// When set, the UI only gets rebuilt when there's input (or every UI_IDLE_REFRESH_INTERVAL), and the last one is drawn
+// from uiCache the rest of the time
+bool isUiCached = true;
+UiCache::sptr uiCache = nullptr;
+double lastUiRebuild = 0.0;
+
+/// <summary>
+/// Returns true if the user did anything since the last frame that the UI might need to respond to. This needs
+/// calling every frame, since it keeps track of where the cursor was
+/// </summary>
+bool HasUiInput() {
+	static double lastCursorX = 0.0, lastCursorY = 0.0;
+	static bool wasHeld = false;
+	ImGuiIO& io = ImGui::GetIO();
+	double cursorX, cursorY;
+	glfwGetCursorPos(window, &cursorX, &cursorY);
+	bool result = cursorX != lastCursorX || cursorY != lastCursorY;
+	lastCursorX = cursorX;
+	lastCursorY = cursorY;
+	// The wheel and typed characters pile up until the UI's next frame reads them
+	result |= io.MouseWheel != 0.0f || io.MouseWheelH != 0.0f || io.InputQueueCharacters.Size > 0;
+	// Text boxes need redrawing for the cursor to blink
+	result |= io.WantTextInput;
+
+	bool isHeld = false;
+	for (int button = 0; button <= GLFW_MOUSE_BUTTON_LAST && !isHeld; button++) {
+		isHeld = glfwGetMouseButton(window, button) == GLFW_PRESS;
+	}
+	for (int key = 0; key < IM_ARRAYSIZE(io.KeysDown) && !isHeld; key++) {
+		isHeld = io.KeysDown[key];
+	}
+	// Letting go needs a redraw as well
+	result |= isHeld || wasHeld;
+	wasHeld = isHeld;
+	return result;
+}
+
 void RenderImGui() {
+	ImGuiIO& io = ImGui::GetIO();
+	int width{ 0 }, height{ 0 };
+	glfwGetFramebufferSize(window, &width, &height);
+	const bool hasInput = HasUiInput();
+	// With viewports on, some of the UI gets drawn into windows of it's own, which we can't cache
+	const bool isCached = isUiCached && uiCache != nullptr && !(io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable);
+	const double now = glfwGetTime();
+	if (isCached && !hasInput && uiCache->IsValid(width, height) && now - lastUiRebuild < UI_IDLE_REFRESH_INTERVAL) {
+		uiCache->Composite();
+		return;
+	}
+	lastUiRebuild = now;
+
 	// Implementation new frame
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
@@ -176,16 +301,17 @@ void RenderImGui() {
 		}
 		ImGui::End();
 	}
-	
-	// Make sure ImGui knows how big our window is
-	ImGuiIO& io = ImGui::GetIO();
-	int width{ 0 }, height{ 0 };
-	glfwGetWindowSize(window, &width, &height);
-	io.DisplaySize = ImVec2((float)width, (float)height);
 
-	// Render all of our ImGui elements
+	// Render all of our ImGui elements, ImGui_ImplGlfw_NewFrame already told ImGui how big our window is
 	ImGui::Render();
-	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	if (isCached) {
+		uiCache->Begin(width, height);
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		uiCache->End();
+		uiCache->Composite();
+	} else {
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	}
 
 	// If we have multiple viewports enabled (can drag into a new window)
 	if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
@@ -197,48 +323,496 @@ void RenderImGui() {
 	}
 }
 
-void RenderVAO(
-	const Shader::sptr& shader,
-	const VertexArrayObject::sptr& vao,
-	const glm::mat4& viewProjection,
-	const Transform& transform)
+/*
+	The features that can be toggled on our textured Blinn-Phong shader, each one gets compiled into it's own variant
+*/
+enum LightingFeature : uint32_t {
+	LightingOff     = 1 << 0,
+	AmbientOnly     = 1 << 1,
+	SpecularOnly    = 1 << 2,
+	AmbientSpecular = 1 << 3,
+	Toon            = 1 << 4,
+	// Not a lighting mode, reads the diffuse map from a layer of a shared texture array (see TextureArrayBuilder)
+	DiffuseArray    = 1 << 5,
+	// Not lighting modes either, for deferred shading the geometry writes the G-buffer and a full screen pass lights
+	// it (see DeferredShading)
+	GBuffer          = 1 << 6,
+	DeferredLighting = 1 << 7,
+	// Not lighting modes, impostors read their surface from a baked atlas (see Impostor), and meshes with dithered
+	// fading fade out as their impostors fade in
+	ImpostorAtlas    = 1 << 8,
+	DitherFade       = 1 << 9,
+	// Not a lighting mode, static geometry reads it's diffuse lighting from a baked atlas (see Lightmapper)
+	Lightmapped      = 1 << 10,
+	// Not a lighting mode, the terrain reads it's diffuse map from a virtual texture (see VirtualTexture)
+	VirtualDiffuse   = 1 << 11,
+	// Not a lighting mode, blended materials add themselves into the order independent targets (see WeightedBlending)
+	WeightedBlend    = 1 << 12,
+	// Not a lighting mode, perturbs the normal with the material's s_NormalMap. The mesh needs tangents (see
+	// ObjLoader::LoadNormalMapped), so this only works with vertex_shader.glsl
+	NormalMapped     = 1 << 13
+};
+
+/*
+	Represents a run of batches that share the same material and mesh arena, and can be drawn with a single multi-draw call
+	@param Material     The material that all batches in the run use
+	@param Arena        The mesh arena that all the batches' meshes were allocated from
+	@param Instances    The instance buffer that all the batches draw from
+	@param FirstCommand The index of the run's first command in the indirect buffer
+	@param CommandCount The number of commands (one per batch) in the run
+	@param MeshletBatch The batch in the meshlet culler that draws this run instead of the commands, or -1
+	@param Query        The key of the occlusion query the run is drawn conditionally on, or OcclusionQueries::NONE
+	@param InstanceBatch The batch in the instance culler that draws this run instead of the commands, or -1
+*/
+struct IndirectRun {
+	ShaderMaterial::sptr Material;
+	MeshArena::sptr      Arena;
+	VertexBuffer::sptr   Instances;
+	int                  FirstCommand;
+	int                  CommandCount;
+	int                  MeshletBatch;
+	uint32_t             Query = OcclusionQueries::NONE;
+	int                  InstanceBatch = -1;
+};
+
+/*
+	A camera that gets drawn from the same snapshot as the main one, into a texture of it's own
+	@param Name The name of the camera's object, so it can be found again if the scene gets loaded
+	@param Object The object with the view's Camera and Transform
+	@param Target Where the view gets drawn
+	@param VisibleCount How many instances the view could see the last time it was drawn
+*/
+struct ExtraView {
+	std::string      Name;
+	GameObject       Object;
+	ViewTarget::sptr Target;
+	int              VisibleCount;
+};
+
+// The size of the extra views' targets, in pixels
+static const int EXTRA_VIEW_WIDTH = 384;
+static const int EXTRA_VIEW_HEIGHT = 216;
+
+void RenderBatch(const VertexBuffer::sptr& instanceBuffer, const DrawBatch& batch)
+{
+	// The instance buffer is shared by every mesh, so we only need to attach it to each VAO once. Batches with
+	// instances of their own (ex: scatters) bring their own buffer
+	batch.Mesh->SetInstanceBuffer(batch.Instances != nullptr ? batch.Instances : instanceBuffer, InstanceTransform::V_DECL);
+	batch.Mesh->RenderInstanced(batch.InstanceCount, batch.BaseInstance);
+}
+
+/*
+	Records a run of batches into a command list, the same as applying each batch's material and calling RenderBatch.
+	Nothing here touches OpenGL, so the lists for different views can be recorded on the workers at the same time
+	@param list The list to record into
+	@param instanceBuffer The buffer the batches' instances are in, unless they bring their own
+	@param batches The batches to record, in draw order
+*/
+void RecordBatches(CommandList& list, const VertexBuffer::sptr& instanceBuffer, const std::vector<DrawBatch>& batches)
 {
-	shader->SetUniformMatrix("u_ModelViewProjection", viewProjection * transform.WorldTransform());
-	shader->SetUniformMatrix("u_Model", transform.WorldTransform()); 
-	shader->SetUniformMatrix("u_NormalMatrix", transform.WorldNormalMatrix());
-	vao->Render();
+	ShaderMaterial::sptr currentMat = nullptr;
+	for (const DrawBatch& batch : batches) {
+		if (currentMat != batch.Material) {
+			currentMat = batch.Material;
+			list.BindShader(currentMat->Shader);
+			list.Call([material = currentMat]() { material->Apply(); });
+			list.SetPipeline(currentMat->Pipeline);
+		}
+		list.DrawInstanced(batch.Mesh, batch.Instances != nullptr ? batch.Instances : instanceBuffer, InstanceTransform::V_DECL,
+			batch.InstanceCount, batch.BaseInstance);
+	}
+}
+
+/*
+	Handles running the app as our asset cook step, which converts assets ahead of time instead of opening a window.
+	--cook-textures <folder> [--kaiser] [--linear] builds the mip chains for every image in the folder, and
+	--cook-meshes <folder> converts every OBJ file in the folder to a binary mesh, and --cook-shaders <folder>
+	[--glslang <path>] compiles the shaders named after their stage to SPIR-V modules. Any of them can be given at once.
+	--pack-assets <folder> <archive> [--store] packs everything in the folder into an archive, after any cooking
+	@param argc The number of command line arguments
+	@param argv The command line arguments
+	@param exitCode Will store the code the app should exit with, if we cooked
+	@returns True if the app was asked to cook anything
+*/
+bool RunCook(int argc, char** argv, int& exitCode) {
+	std::string textureFolder, meshFolder, shaderFolder, packFolder, packArchive;
+	bool compressPack = true;
+	TextureCookSettings settings;
+	for (int ix = 1; ix < argc; ix++) {
+		std::string arg = argv[ix];
+		if (arg == "--cook-textures" && ix + 1 < argc) {
+			textureFolder = argv[++ix];
+		} else if (arg == "--cook-meshes" && ix + 1 < argc) {
+			meshFolder = argv[++ix];
+		} else if (arg == "--cook-shaders" && ix + 1 < argc) {
+			shaderFolder = argv[++ix];
+		} else if (arg == "--glslang" && ix + 1 < argc) {
+			ShaderCook::Compiler = argv[++ix];
+		} else if (arg == "--pack-assets" && ix + 2 < argc) {
+			packFolder = argv[++ix];
+			packArchive = argv[++ix];
+		} else if (arg == "--store") {
+			compressPack = false;
+		} else if (arg == "--kaiser") {
+			settings.Filter = MipFilter::Kaiser;
+		} else if (arg == "--linear") {
+			settings.GammaCorrect = false;
+		}
+	}
+	if (textureFolder.empty() && meshFolder.empty() && shaderFolder.empty() && packFolder.empty()) {
+		return false;
+	}
+
+	// Cooking doesn't touch OpenGL, so all we need is the workers
+	ThreadPool::Instance().Init();
+	exitCode = 0;
+	if (!textureFolder.empty()) {
+		uint32_t cooked = TextureCook::CookDirectory(textureFolder, settings);
+		LOG_INFO("Cooked mips for {} images in \"{}\"", cooked, textureFolder);
+		exitCode = cooked > 0 ? exitCode : 1;
+	}
+	if (!meshFolder.empty()) {
+		uint32_t cooked = MeshCook::CookDirectory(meshFolder);
+		LOG_INFO("Cooked {} meshes in \"{}\"", cooked, meshFolder);
+		exitCode = cooked > 0 ? exitCode : 1;
+	}
+	if (!shaderFolder.empty()) {
+		uint32_t cooked = ShaderCook::CookDirectory(shaderFolder);
+		LOG_INFO("Compiled {} shaders in \"{}\" to SPIR-V", cooked, shaderFolder);
+		exitCode = cooked > 0 ? exitCode : 1;
+	}
+	// Packing goes last, so the archive picks up anything that was just cooked
+	if (!packFolder.empty()) {
+		uint32_t packed = AssetArchive::Pack(packFolder, packArchive, compressPack);
+		exitCode = packed > 0 ? exitCode : 1;
+	}
+	ThreadPool::Instance().Shutdown();
+	return true;
 }
 
-void SetupShaderForFrame(const Shader::sptr& shader, const glm::mat4& view, const glm::mat4& projection) {
-	shader->Bind();
-	// These are the uniforms that update only once per frame
-	shader->SetUniformMatrix("u_View", view);
-	shader->SetUniformMatrix("u_ViewProjection", projection * view);
-	shader->SetUniformMatrix("u_SkyboxMatrix", projection * glm::mat4(glm::mat3(view)));
-	glm::vec3 camPos = glm::inverse(view) * glm::vec4(0,0,0,1);
-	shader->SetUniform("u_CamPos", camPos);
+// Handles the --benchmark-obj [file] [iterations] command line, times our OBJ parser against the old one and exits
+bool RunObjBenchmark(int argc, char** argv) {
+	for (int ix = 1; ix < argc; ix++) {
+		if (std::string(argv[ix]) == "--benchmark-obj" && ix + 1 < argc) {
+			const uint32_t iterations = ix + 2 < argc ? (uint32_t)std::max(std::atoi(argv[ix + 2]), 1) : 10;
+			ObjLoader::Benchmark(argv[ix + 1], iterations);
+			return true;
+		}
+	}
+	return false;
 }
 
-int main() {
+// Handles the --benchmark-transforms [count] [iterations] command line, times the batched transform kernel against
+// GLM and exits
+bool RunTransformBenchmark(int argc, char** argv) {
+	for (int ix = 1; ix < argc; ix++) {
+		if (std::string(argv[ix]) == "--benchmark-transforms") {
+			const size_t count = ix + 1 < argc ? (size_t)std::max(std::atoi(argv[ix + 1]), 1) : 10000;
+			const uint32_t iterations = ix + 2 < argc ? (uint32_t)std::max(std::atoi(argv[ix + 2]), 1) : 100;
+			TransformKernel::Benchmark(count, iterations);
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char** argv) {
+	// Time to first frame is measured from here, see the end of the first frame
+	StartupReport::Begin();
 	Logger::Init(); // We'll borrow the logger from the toolkit, but we need to initialize it
+	// Bullet and FMOD have to be handed our allocator before they allocate anything, so their memory gets tracked
+	PhysicsWorld::TrackAllocations();
+	SceneAudio::TrackAllocations();
+
+	int cookResult = 0;
+	if (RunCook(argc, argv, cookResult)) {
+		Logger::Uninitialize();
+		return cookResult;
+	}
+	if (RunObjBenchmark(argc, argv) || RunTransformBenchmark(argc, argv)) {
+		Logger::Uninitialize();
+		return 0;
+	}
+	// If the assets have been packed, load them out of the archive instead of opening every file on it's own
+	VirtualFileSystem::Mount("assets.pak");
+	// --derive-normals has the shaders build each instance's normal matrix from it's model matrix instead of reading
+	// the one we upload, which trades a few cross products per vertex for the attribute fetch
+	// --memory-budget [tag] [MB] warns whenever a tag goes over the budget, and exits with an error if any did (for
+	// soak tests)
+	// --startup-report [file] writes out where the time to the first frame went, it's always logged
+	// --benchmark [scenario] flies the camera along a scripted path with a fixed time step and seed, and writes how
+	// each frame went to benchmark_[scenario].csv and .json (or --benchmark-out [path], without an extension), then
+	// exits. --benchmark-frames [count] overrides how many frames get recorded, --no-ui skips drawing ImGui, and
+	// --headless keeps the window hidden. --benchmark-capture [interval] saves every interval'th recorded frame next
+	// to the results as a reference image, the read back doesn't wait on the GPU so the timings stay comparable.
+	// --benchmark-baseline [file] compares the run against the JSON from an earlier one, and exits with an error if any
+	// metric got significantly slower by more than --benchmark-threshold [percent] (5 by default)
+	// --stress [count] adds a generated scene of that many renderers, see StressScene. It's shaped by
+	// --stress-meshes [count], --stress-materials [count], --stress-depth [links per chain], --stress-moving [percent]
+	// and --stress-lights [count]
+	// --no-spirv compiles every shader from GLSL, even where there's a cooked SPIR-V module for it
+	// --hot-reload watches the shaders, images and models for changes and reloads whatever uses them, it's always on
+	// in debug builds
+	// --hitch-capture keeps the last few seconds of profiler zones around, and writes them to a trace whenever a frame
+	// takes much longer than usual, see TraceRecorder
+	// --record [file] writes the session's input to a file, which --replay [file] plays back with the same seed and
+	// time steps (as fast as it can) and then exits, see InputRecorder
+	// --remote-profiler [port] streams the profiler to a viewer that connects on the port (28960 if it's left off), see
+	// RemoteProfiler
+	// --telemetry [file] writes the frame time quantiles, hitches, memory high-water marks and asset load times to a
+	// JSON file every --telemetry-interval [seconds] (60 by default) for our monitoring, see FleetTelemetry
+	// --bc7 block compresses images to BC7 instead of BC1 and BC3, which is slower to encode but looks better, see
+	// TextureCompressor
+	// --gpu-picking picks with an ID pass on the GPU instead of raycasting the scene, see GpuPicker
+	bool hasMemoryBudgets = false;
+	bool useGpuPicking = false;
+#ifdef _DEBUG
+	bool isHotReloading = true;
+#else
+	bool isHotReloading = false;
+#endif
+	StressSceneSettings stress;
+	std::string startupReportPath;
+	const Benchmark::Scenario* benchmark = nullptr;
+	std::string benchmarkPath;
+	uint32_t benchmarkFrames = 0;
+	uint32_t benchmarkCaptureInterval = 0;
+	std::string benchmarkBaselinePath;
+	float benchmarkThreshold = 5.0f;
+	bool isUiDrawn = true;
+	bool isHeadless = false;
+	// Lets the loop sleep while nobody is using it, see PowerMode
+	bool isPowerSaving = false;
+	std::string recordPath;
+	std::string replayPath;
+	// 0 when we're not streaming to a remote viewer
+	uint16_t remoteProfilerPort = 0;
+	std::string telemetryPath;
+	double telemetryInterval = 60.0;
+	bool isBenchmarkWritten = false;
+	for (int ix = 1; ix < argc; ix++) {
+		if (std::string(argv[ix]) == "--derive-normals") {
+			ShaderStage::GlobalDefines.push_back("DERIVE_NORMAL_MATRIX");
+		} else if (std::string(argv[ix]) == "--startup-report" && ix + 1 < argc) {
+			startupReportPath = argv[++ix];
+		} else if (std::string(argv[ix]) == "--benchmark" && ix + 1 < argc) {
+			benchmark = Benchmark::FindScenario(argv[++ix]);
+			if (benchmark == nullptr) {
+				LOG_ERROR("Unknown benchmark \"{}\", the benchmarks are: {}", argv[ix], Benchmark::GetScenarioNames());
+				Logger::Uninitialize();
+				return 1;
+			}
+		} else if (std::string(argv[ix]) == "--benchmark-out" && ix + 1 < argc) {
+			benchmarkPath = argv[++ix];
+		} else if (std::string(argv[ix]) == "--benchmark-frames" && ix + 1 < argc) {
+			benchmarkFrames = static_cast<uint32_t>(std::max(std::atoi(argv[++ix]), 1));
+		} else if (std::string(argv[ix]) == "--benchmark-capture" && ix + 1 < argc) {
+			benchmarkCaptureInterval = static_cast<uint32_t>(std::max(std::atoi(argv[++ix]), 1));
+		} else if (std::string(argv[ix]) == "--benchmark-baseline" && ix + 1 < argc) {
+			benchmarkBaselinePath = argv[++ix];
+		} else if (std::string(argv[ix]) == "--benchmark-threshold" && ix + 1 < argc) {
+			benchmarkThreshold = std::max(static_cast<float>(std::atof(argv[++ix])), 0.0f);
+		} else if (std::string(argv[ix]) == "--no-ui") {
+			isUiDrawn = false;
+		} else if (std::string(argv[ix]) == "--headless") {
+			isHeadless = true;
+		} else if (std::string(argv[ix]) == "--power-save") {
+			isPowerSaving = true;
+		} else if (std::string(argv[ix]) == "--hitch-capture") {
+			TraceRecorder::Instance().SetHitchCapture(true);
+		} else if (std::string(argv[ix]) == "--remote-profiler") {
+			remoteProfilerPort = RemoteProfiler::DEFAULT_PORT;
+			if (ix + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[ix + 1][0]))) {
+				remoteProfilerPort = static_cast<uint16_t>(std::clamp(std::atoi(argv[++ix]), 1, 0xFFFF));
+			}
+		} else if (std::string(argv[ix]) == "--telemetry" && ix + 1 < argc) {
+			telemetryPath = argv[++ix];
+		} else if (std::string(argv[ix]) == "--telemetry-interval" && ix + 1 < argc) {
+			telemetryInterval = std::max(std::atof(argv[++ix]), 1.0);
+		} else if (std::string(argv[ix]) == "--bc7") {
+			TextureCompressor::UseBC7 = true;
+		} else if (std::string(argv[ix]) == "--gpu-picking") {
+			useGpuPicking = true;
+		} else if (std::string(argv[ix]) == "--record" && ix + 1 < argc) {
+			recordPath = argv[++ix];
+		} else if (std::string(argv[ix]) == "--replay" && ix + 1 < argc) {
+			replayPath = argv[++ix];
+		} else if (std::string(argv[ix]) == "--no-spirv") {
+			ShaderStage::PreferSpirv = false;
+		} else if (std::string(argv[ix]) == "--hot-reload") {
+			isHotReloading = true;
+		} else if (std::string(argv[ix]) == "--stress" && ix + 1 < argc) {
+			stress.EntityCount = static_cast<uint32_t>(std::max(std::atoi(argv[++ix]), 0));
+		} else if (std::string(argv[ix]) == "--stress-meshes" && ix + 1 < argc) {
+			stress.UniqueMeshes = static_cast<uint32_t>(std::max(std::atoi(argv[++ix]), 1));
+		} else if (std::string(argv[ix]) == "--stress-materials" && ix + 1 < argc) {
+			stress.UniqueMaterials = static_cast<uint32_t>(std::max(std::atoi(argv[++ix]), 1));
+		} else if (std::string(argv[ix]) == "--stress-depth" && ix + 1 < argc) {
+			stress.HierarchyDepth = static_cast<uint32_t>(std::max(std::atoi(argv[++ix]), 1));
+		} else if (std::string(argv[ix]) == "--stress-moving" && ix + 1 < argc) {
+			stress.MovingFraction = glm::clamp(static_cast<float>(std::atof(argv[++ix])) / 100.0f, 0.0f, 1.0f);
+		} else if (std::string(argv[ix]) == "--stress-lights" && ix + 1 < argc) {
+			stress.LightCount = static_cast<uint32_t>(std::max(std::atoi(argv[++ix]), 0));
+		} else if (std::string(argv[ix]) == "--memory-budget" && ix + 2 < argc) {
+			const std::string tag = argv[ix + 1];
+			const double megabytes = std::atof(argv[ix + 2]);
+			bool found = false;
+			for (uint8_t tagIx = 0; tagIx < static_cast<uint8_t>(MemoryTag::Count); tagIx++) {
+				if (tag == MemoryTracker::GetTagName(static_cast<MemoryTag>(tagIx))) {
+					MemoryTracker::SetBudget(static_cast<MemoryTag>(tagIx), static_cast<int64_t>(megabytes * 1024.0 * 1024.0));
+					hasMemoryBudgets = found = true;
+				}
+			}
+			if (!found) {
+				LOG_WARN("Unknown memory tag \"{}\"", tag);
+			}
+			ix += 2;
+		}
+	}
+
+	// Benchmarks fly their own path, so they can't be driven by a recording as well
+	if (benchmark != nullptr && (!recordPath.empty() || !replayPath.empty())) {
+		LOG_WARN("Input can't be recorded or replayed during a benchmark, ignoring --record and --replay");
+	} else if (!replayPath.empty()) {
+		InputRecorder::BeginReplay(replayPath);
+	} else if (!recordPath.empty()) {
+		InputRecorder::BeginRecording(recordPath, static_cast<uint32_t>(time(nullptr)));
+	}
+	// The seed everything random is placed with, a replay needs the one it was recorded with
+	const uint32_t sessionSeed = benchmark != nullptr ? Benchmark::SEED :
+		InputRecorder::GetMode() != InputRecorder::Mode::Off ? InputRecorder::GetSeed() : static_cast<uint32_t>(time(nullptr));
+	if (benchmark != nullptr || InputRecorder::GetMode() != InputRecorder::Mode::Off) {
+		// glm's random functions are built on rand, so seeding it makes anything they place the same every run
+		std::srand(sessionSeed);
+	}
+	if (benchmark != nullptr && benchmarkPath.empty()) {
+		benchmarkPath = std::string("benchmark_") + benchmark->Name;
+	}
+	// A baseline that can't be compared against would make the whole run pointless, so we stop before it starts
+	if (benchmark != nullptr && !benchmarkBaselinePath.empty() && !Benchmark::SetBaseline(*benchmark, benchmarkBaselinePath, benchmarkThreshold)) {
+		Logger::Uninitialize();
+		return 1;
+	}
+	stress.Seed = sessionSeed;
+	stress.UniqueMeshes = std::min(stress.UniqueMeshes, static_cast<uint32_t>(StressScene::MESH_PATHS.size()));
+
+	// Our images get decoded and our meshes parsed on worker threads, and none of that needs OpenGL, so we get it
+	// going before the window even exists. Only creating the GL objects has to wait for the context, and that
+	// happens on the main thread as each one is asked for (the meshes' uploads run whenever we wait on jobs)
+	StartupReport::BeginStage("Prefetch assets");
+	ThreadPool::Instance().Init();
+	IoScheduler::Init();
+	// The material textures load on demand, so only the array layers (which have to be in place to build the array)
+	// are worth getting started on
+	for (const char* path : { "images/grass.jpg", "images/Dunce.png", "images/Duncet.png", "images/Slide.png",
+		"images/Swing.png", "images/Table.png", "images/TreeBig.png", "images/BalloonRed.png", "images/BalloonYellow.png" }) {
+		TextureLoader::Prefetch(path);
+	}
+	AssetManager::PrefetchCubeMap("images/cubemaps/skybox/ocean.jpg");
+	// We hold onto the meshes until the scene has them, since the cache only keeps weak references
+	std::vector<Task<VertexArrayObject::sptr>> prefetchedMeshes;
+	for (const char* path : { "models/Ground.obj", "models/Dunce.obj", "models/Duncet.obj", "models/Slide.obj",
+		"models/Balloon.obj", "models/TreeBig.obj", "models/Swing.obj", "models/Table.obj" }) {
+		prefetchedMeshes.push_back(AssetManager::GetMeshAsync(path));
+	}
 
 	//Initialize GLFW
-	if (!InitGLFW())
+	StartupReport::BeginStage("Create window");
+	if (!InitGLFW(!isHeadless))
 		return 1;
 
 	//Initialize GLAD
+	StartupReport::BeginStage("Load OpenGL");
 	if (!InitGLAD())
 		return 1;
 
+	// Let the driver compile shaders in the background while we load everything else
+	Shader::InitParallelCompile((GLADloadproc)glfwGetProcAddress);
+	// Memory and CPU usage get sampled on their own thread, so graphing them costs the frame nothing
+	SystemMonitor::Start();
+	SystemMonitor::RegisterThread("Main");
+	if (remoteProfilerPort != 0) {
+		RemoteProfiler::Start(remoteProfilerPort);
+	}
+	if (!telemetryPath.empty()) {
+		FleetTelemetry::Start(telemetryPath, telemetryInterval);
+	}
+	// Streamed textures get uploaded through a second context on a thread of it's own, if the driver lets us make one
+	UploadContext::Init(window);
+	SystemMonitor::Snapshot systemSnapshot;
+	std::vector<GlDebugOutput::PerfWarning> perfWarnings;
+
 	int frameIx = 0;
 	float fpsBuffer[128];
 	float minFps, maxFps, avgFps;
 	int selectedVao = 0; // select cube by default
+	int drawCallCount = 0;
+	int instanceCount = 0;
+	bool useMultiDrawIndirect = true;
+	bool usePipelinedRendering = true;
+	bool useFrustumCulling = true;
+	bool useMeshletCulling = true;
+	bool useGpuCulling = true;
+	bool useDepthPrepass = false;
+	bool useLods = true;
+	float lodPixelError = 1.0f;
+	int lodCount = 0;
+	int transparentCount = 0;
+	int weightedCount = 0;
+	bool useExtraViews = false;
+	std::vector<ExtraView> extraViews;
+	int impostorCount = 0;
+	int scatterImpostorCount = 0;
+	int scatterCount = 0;
+	int scatterCellCount = 0;
+	int terrainPatchCount = 0;
+	// How far from the camera the trees switch over to their impostors, and how long they take to fade across
+	float impostorDistance = 25.0f;
+	float impostorFadeWidth = 5.0f;
+	int visibleCount = 0;
+	int culledCount = 0;
+	int occludedCount = 0;
+	int pendingCount = 0;
+	int lightCount = 0;
+	int culledLightCount = 0;
+	bool useShadows = true;
+	ShadowMaps::Stats shadowStats;
+	StaticBatcher::Stats staticStats;
+	WorldPartition::sptr world = nullptr;
+	PhysicsWorld::sptr physics = nullptr;
+	AudioEngine::sptr audio = nullptr;
+	SceneAudio::sptr sceneAudio = nullptr;
+	MeshletCuller::sptr meshletCuller = nullptr;
+	InstanceCuller::sptr instanceCuller = nullptr;
+	RenderRecords::sptr renderRecords = nullptr;
+	int gpuCulledCount = 0;
+	DepthPyramid::sptr depthPyramid = nullptr;
+	AmbientOcclusion::sptr ambientOcclusion = nullptr;
+	bool useAmbientOcclusion = true;
+	OcclusionQueries::sptr occlusionQueries = nullptr;
+	bool useOcclusionQueries = true;
+	FrameCapture::sptr frameCapture = nullptr;
+	Lightmapper::sptr lightmapper = nullptr;
+	VirtualTexture::sptr virtualGround = nullptr;
+	bool useVirtualGround = true;
+	bool useOcclusionCulling = false;
+	ClusteredLighting::sptr clusteredLighting = nullptr;
+	ShadowMaps::sptr shadowMaps = nullptr;
+	GpuPicker::sptr gpuPicker = nullptr;
+	double gpuPickStart = 0.0;
+	DeferredShading::sptr deferredShading = nullptr;
+	WeightedBlending::sptr weightedBlending = nullptr;
+	SkyboxPass::sptr skyboxPass = nullptr;
+	ParticleSystem::sptr particleSystem = nullptr;
+	bool useParticles = true;
+	PostProcessing::sptr postProcessing = nullptr;
+	bool usePostProcessing = true;
+	DynamicResolution::sptr dynamicResolution = nullptr;
+	bool useDynamicResolution = false;
 	std::vector<GameObject> controllables;
 
-	// Let OpenGL know that we want debug output, and route it to our handler function
-	glEnable(GL_DEBUG_OUTPUT);
-	glDebugMessageCallback(GlDebugMessage, nullptr);
+	// Route OpenGL's debug output to our log (only on by default in debug builds)
+	GlDebugOutput::Init();
 
 	// Enable texturing
 	glEnable(GL_TEXTURE_2D);
@@ -246,76 +820,138 @@ int main() {
 	// Push another scope so most memory should be freed *before* we exit the app
 	{
 		#pragma region Shader and ImGui
-
-		// Load our shaders
-		Shader::sptr shader = Shader::Create();
-		shader->LoadShaderPartFromFile("shaders/vertex_shader.glsl", GL_VERTEX_SHADER);
-		shader->LoadShaderPartFromFile("shaders/frag_blinn_phong_textured.glsl", GL_FRAGMENT_SHADER);
-		shader->Link();
-
-		glm::vec3 lightPos = glm::vec3(0.0f, 0.0f, 2.0f);
-		glm::vec3 lightCol = glm::vec3(0.9f, 0.85f, 0.5f);
-		float     lightAmbientPow = 0.7f;
-		float     lightSpecularPow = 1.0f;
-		glm::vec3 ambientCol = glm::vec3(1.0f);
-		float     ambientPow = 0.1f;
-		float     lightLinearFalloff = 0.009;
-		float     lightQuadraticFalloff = 0.032f;
-		
-		int lightoff = 0;
-		int ambientonly = 0;
-		int specularonly = 0;
-		int ambientandspecular = 0;
-		int ambientspeculartoon = 0;
-
-		// These are our application / scene level uniforms that don't necessarily update
-		// every frame
-		shader->SetUniform("u_LightPos", lightPos);
-		shader->SetUniform("u_LightCol", lightCol);
-		shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-		shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
-		shader->SetUniform("u_AmbientCol", ambientCol);
-		shader->SetUniform("u_AmbientStrength", ambientPow);
-		shader->SetUniform("u_LightAttenuationConstant", 1.0f);
-		shader->SetUniform("u_LightAttenuationLinear", lightLinearFalloff);
-		shader->SetUniform("u_LightAttenuationQuadratic", lightQuadraticFalloff);
-		shader->SetUniform("u_lightoff", lightoff);
-		shader->SetUniform("u_ambient", ambientonly);
-		shader->SetUniform("u_specular", specularonly);
-		shader->SetUniform("u_ambientspecular", ambientandspecular);
-		shader->SetUniform("u_ambientspeculartoon", ambientspeculartoon);
+		StartupReport::BeginStage("Start shader compiles");
+
+		// Load our shaders, each lighting mode is compiled as it's own variant so the fragment shader does not need to branch
+		// Note that the order of the names needs to match the bits in LightingFeature
+		const std::vector<std::string> lightingFeatureNames = { "LIGHTING_OFF", "AMBIENT_ONLY", "SPECULAR_ONLY", "AMBIENT_SPECULAR", "TOON", "DIFFUSE_ARRAY", "GBUFFER", "DEFERRED_LIGHTING", "IMPOSTOR", "DITHER_FADE", "LIGHTMAPPED", "VIRTUAL_TEXTURE", "WEIGHTED_BLEND", "NORMAL_MAP" };
+		ShaderVariants::sptr lightingVariants = ShaderVariants::Create("shaders/vertex_shader.glsl", "shaders/frag_blinn_phong_textured.glsl", lightingFeatureNames);
+		// Impostors are lit the same way, but their quads get turned to face the camera
+		ShaderVariants::sptr impostorVariants = ShaderVariants::Create("shaders/impostor.vert.glsl", "shaders/frag_blinn_phong_textured.glsl", lightingFeatureNames);
+		// The deferred lighting pass is the same shader drawn full screen, reading the surface back from the G-buffer
+		ShaderVariants::sptr deferredVariants = ShaderVariants::Create("shaders/fullscreen.vert.glsl", "shaders/frag_blinn_phong_textured.glsl", lightingFeatureNames);
+		// The terrain is lit the same way too, but it's grid gets displaced by the heightmap
+		ShaderVariants::sptr terrainVariants = ShaderVariants::Create("shaders/terrain.vert.glsl", "shaders/frag_blinn_phong_textured.glsl", lightingFeatureNames);
+		// And so are the animated props, which play their vertex animations back in the vertex shader
+		ShaderVariants::sptr animatedVariants = ShaderVariants::Create("shaders/vertex_animation.vert.glsl", "shaders/frag_blinn_phong_textured.glsl", lightingFeatureNames);
+		// This is the variant for the current lighting mode, it compiles in the background while we load the rest
+		// Our lit materials all share one diffuse array, so every variant we use needs to read from it
+		Shader::sptr shader = lightingVariants->GetAsync(DiffuseArray);
+		// The variant we're waiting on to finish compiling before we switch to it
+		Shader::sptr pendingShader = shader;
+		// The current lighting mode, and whether it's shaded deferred. When it is, the lit materials draw with the
+		// G-buffer variant and this variant lights them, otherwise it's null
+		uint32_t     lightingFeatures = 0;
+		bool         useDeferred = false;
+		Shader::sptr deferredShader = nullptr;
+		Shader::sptr pendingDeferredShader = nullptr;
+		// The variants for meshes that fade out into their impostors, and for the impostors, in the same lighting mode.
+		// The material buffer's layout depends on the features, so these keep the diffuse array's layer too
+		Shader::sptr fadeShader = lightingVariants->GetAsync(DiffuseArray | DitherFade);
+		Shader::sptr pendingFadeShader = fadeShader;
+		Shader::sptr impostorShader = impostorVariants->GetAsync(DiffuseArray | ImpostorAtlas);
+		Shader::sptr pendingImpostorShader = impostorShader;
+		// Blended materials can't go through the G-buffer, so they always draw with the forward variant of the mode. By
+		// default they don't get sorted, and add themselves into the weighted blending targets instead
+		bool         useWeightedBlending = true;
+		Shader::sptr transparentShader = lightingVariants->GetAsync(DiffuseArray | WeightedBlend);
+		Shader::sptr pendingTransparentShader = transparentShader;
+		// The terrain's own features on top of the lighting mode, it moves over to the virtual ground once it's ready
+		uint32_t     terrainFeatures = 0;
+		Shader::sptr terrainShader = terrainVariants->GetAsync(DiffuseArray);
+		Shader::sptr pendingTerrainShader = terrainShader;
+		Shader::sptr animatedShader = animatedVariants->GetAsync(DiffuseArray);
+		Shader::sptr pendingAnimatedShader = animatedShader;
+		// Lightmapped geometry always draws forward, it's lighting is a texture fetch so the G-buffer wouldn't save anything
+		Shader::sptr lightmappedShader = lightingVariants->GetAsync(DiffuseArray | Lightmapped);
+		Shader::sptr pendingLightmappedShader = lightmappedShader;
+
+		// These are our scene level lighting settings, they're shared by every program (and so every variant and material)
+		// through a uniform block, so an edit is a single upload. The lights themselves are components, and reach the
+		// shaders through the light buffer (see ClusteredLighting)
+		UniformBuffer<SceneLighting>::sptr sceneLighting = UniformBuffer<SceneLighting>::Create();
+		sceneLighting->Bind(SCENE_LIGHTING_BINDING);
+
+		// The materials that use the lighting variants, so we can move them over when the mode changes
+		std::vector<ShaderMaterial::sptr> litMaterials;
+		std::vector<ShaderMaterial::sptr> fadeMaterials;
+		std::vector<ShaderMaterial::sptr> impostorMaterials;
+		std::vector<ShaderMaterial::sptr> transparentMaterials;
+		std::vector<ShaderMaterial::sptr> terrainMaterials;
+		std::vector<ShaderMaterial::sptr> animatedMaterials;
+		std::vector<ShaderMaterial::sptr> lightmappedMaterials;
+		// Starts compiling the variant for a lighting mode, we keep drawing with the current one until it's ready
+		auto selectLightingMode = [&](uint32_t features) {
+			lightingFeatures = features;
+			const uint32_t base = useDeferred ? GBuffer : features;
+			pendingShader = lightingVariants->GetAsync(base | DiffuseArray);
+			pendingFadeShader = lightingVariants->GetAsync(base | DiffuseArray | DitherFade);
+			pendingImpostorShader = impostorVariants->GetAsync(base | DiffuseArray | ImpostorAtlas);
+			pendingTransparentShader = lightingVariants->GetAsync(features | DiffuseArray | (useWeightedBlending ? WeightedBlend : 0));
+			pendingTerrainShader = terrainVariants->GetAsync(base | DiffuseArray | terrainFeatures);
+			pendingAnimatedShader = animatedVariants->GetAsync(base | DiffuseArray);
+			pendingLightmappedShader = lightingVariants->GetAsync(features | DiffuseArray | Lightmapped);
+			pendingDeferredShader = useDeferred ? deferredVariants->GetAsync(features | DeferredLighting) : nullptr;
+		};
+		// Called every frame, switches over to the pending variants once the driver is done with all of them
+		auto pollLightingMode = [&]() {
+			if (pendingShader == nullptr || !pendingShader->IsReady() || !pendingFadeShader->IsReady() || !pendingImpostorShader->IsReady() ||
+				!pendingTransparentShader->IsReady() || !pendingTerrainShader->IsReady() || !pendingAnimatedShader->IsReady() ||
+				!pendingLightmappedShader->IsReady() ||
+				(pendingDeferredShader != nullptr && !pendingDeferredShader->IsReady())) {
+				return;
+			}
+			for (const ShaderMaterial::sptr& material : litMaterials) {
+				material->SetShader(pendingShader);
+			}
+			for (const ShaderMaterial::sptr& material : fadeMaterials) {
+				material->SetShader(pendingFadeShader);
+			}
+			for (const ShaderMaterial::sptr& material : impostorMaterials) {
+				material->SetShader(pendingImpostorShader);
+			}
+			// The blended materials' pipelines follow their variant, nothing is building a snapshot at this point
+			for (const ShaderMaterial::sptr& material : transparentMaterials) {
+				material->SetShader(pendingTransparentShader);
+				material->Pipeline = useWeightedBlending ? PipelineState::WeightedBlended() : PipelineState::AlphaBlended();
+			}
+			for (const ShaderMaterial::sptr& material : terrainMaterials) {
+				material->SetShader(pendingTerrainShader);
+			}
+			for (const ShaderMaterial::sptr& material : animatedMaterials) {
+				material->SetShader(pendingAnimatedShader);
+			}
+			for (const ShaderMaterial::sptr& material : lightmappedMaterials) {
+				material->SetShader(pendingLightmappedShader);
+			}
+			shader = pendingShader;
+			fadeShader = pendingFadeShader;
+			impostorShader = pendingImpostorShader;
+			transparentShader = pendingTransparentShader;
+			terrainShader = pendingTerrainShader;
+			animatedShader = pendingAnimatedShader;
+			lightmappedShader = pendingLightmappedShader;
+			deferredShader = pendingDeferredShader;
+			pendingShader = nullptr;
+			pendingFadeShader = nullptr;
+			pendingImpostorShader = nullptr;
+			pendingTransparentShader = nullptr;
+			pendingTerrainShader = nullptr;
+			pendingAnimatedShader = nullptr;
+			pendingLightmappedShader = nullptr;
+			pendingDeferredShader = nullptr;
+		};
 
 		// We'll add some ImGui controls to control our shader
 
 		imGuiCallbacks.push_back([&]() {
 			if (ImGui::CollapsingHeader("Scene Level Lighting Settings"))
 			{
-				if (ImGui::ColorPicker3("Ambient Color", glm::value_ptr(ambientCol))) {
-					shader->SetUniform("u_AmbientCol", ambientCol);
-				}
-				if (ImGui::SliderFloat("Fixed Ambient Power", &ambientPow, 0.01f, 1.0f)) {
-					shader->SetUniform("u_AmbientStrength", ambientPow);
-				}
-			}
-			if (ImGui::CollapsingHeader("Light Level Lighting Settings"))
-			{
-				if (ImGui::DragFloat3("Light Pos", glm::value_ptr(lightPos), 0.01f, -10.0f, 10.0f)) {
-					shader->SetUniform("u_LightPos", lightPos);
-				}
-				if (ImGui::ColorPicker3("Light Col", glm::value_ptr(lightCol))) {
-					shader->SetUniform("u_LightCol", lightCol);
-				}
-				if (ImGui::SliderFloat("Light Ambient Power", &lightAmbientPow, 0.0f, 1.0f)) {
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-				}
-				if (ImGui::SliderFloat("Light Specular Power", &lightSpecularPow, 0.0f, 1.0f)) {
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
-				}
-				if (ImGui::DragFloat("Light Linear Falloff", &lightLinearFalloff, 0.01f, 0.0f, 1.0f)) {
-					shader->SetUniform("u_LightAttenuationLinear", lightLinearFalloff);
-				}
-				if (ImGui::DragFloat("Light Quadratic Falloff", &lightQuadraticFalloff, 0.01f, 0.0f, 1.0f)) {
-					shader->SetUniform("u_LightAttenuationQuadratic", lightQuadraticFalloff);
+				SceneLighting& lighting = sceneLighting->GetData();
+				bool changed = ImGui::ColorPicker3("Ambient Color", glm::value_ptr(lighting.AmbientColor));
+				changed |= ImGui::SliderFloat("Fixed Ambient Power", &lighting.AmbientStrength, 0.01f, 1.0f);
+				if (changed) {
+					sceneLighting->Update();
 				}
 			}
 
@@ -323,56 +959,92 @@ int main() {
 			if (ImGui::CollapsingHeader("Toggle buttons"))
 			{
 				if (ImGui::Button("No Lighting")) {
-					shader->SetUniform("u_lightoff", lightoff = 1);
-					shader->SetUniform("u_ambient", ambientonly = 0);
-					shader->SetUniform("u_specular", specularonly = 0);
-					shader->SetUniform("u_ambientspecular", ambientandspecular = 0);
-					shader->SetUniform("u_ambientspeculartoon", ambientspeculartoon = 0);
+					selectLightingMode(LightingOff);
 				}
 
 				if (ImGui::Button("Ambient only"))
 				{
-					shader->SetUniform("u_lightoff", lightoff = 0);
-					shader->SetUniform("u_ambient", ambientonly = 1);
-					shader->SetUniform("u_specular", specularonly = 0);
-					shader->SetUniform("u_ambientspecular", ambientandspecular = 0);
-					shader->SetUniform("u_ambientspeculartoon", ambientspeculartoon = 0);
+					selectLightingMode(AmbientOnly);
 				}
 
 				if (ImGui::Button("specular only"))
 				{
-					shader->SetUniform("u_lightoff", lightoff = 0);
-					shader->SetUniform("u_ambient", ambientonly = 0);
-					shader->SetUniform("u_specular", specularonly = 1);
-					shader->SetUniform("u_ambientspecular", ambientandspecular = 0);
-					shader->SetUniform("u_ambientspeculartoon", ambientspeculartoon = 0);
+					selectLightingMode(SpecularOnly);
 				}
 
 				if (ImGui::Button("Ambient and Specular"))
 				{
-					shader->SetUniform("u_lightoff", lightoff = 0);
-					shader->SetUniform("u_ambient", ambientonly = 0);
-					shader->SetUniform("u_specular", specularonly = 0);
-					shader->SetUniform("u_ambientspecular", ambientandspecular = 1);
-					shader->SetUniform("u_ambientspeculartoon", ambientspeculartoon = 0);
+					selectLightingMode(AmbientSpecular);
 				}
 
 				if (ImGui::Button("Ambient, Specular, and Toon Shading"))
 				{
-					shader->SetUniform("u_lightoff", lightoff = 0);
-					shader->SetUniform("u_ambient", ambientonly = 0);
-					shader->SetUniform("u_specular", specularonly = 0);
-					shader->SetUniform("u_ambientspecular", ambientandspecular = 0);
-					shader->SetUniform("u_ambientspeculartoon", ambientspeculartoon = 1);
+					selectLightingMode(Toon);
+				}
+
+				// Deferred shading lights each pixel once, however many surfaces get drawn over it
+				if (ImGui::Checkbox("Deferred Shading", &useDeferred)) {
+					selectLightingMode(lightingFeatures);
 				}
+				ImGui::Text("G-buffer: %d bytes per pixel", (int)DeferredShading::GetBytesPerPixel());
+				// Weighted blending draws the blended materials in any order, rather than sorting them back to front
+				if (ImGui::Checkbox("Weighted blended transparency", &useWeightedBlending)) {
+					useWeightedBlending &= weightedBlending->IsReady();
+					selectLightingMode(lightingFeatures);
+				}
+				ImGui::Text("Weighted blending: %d bytes per pixel", (int)WeightedBlending::GetBytesPerPixel());
+			}
+			if (ImGui::CollapsingHeader("Post Processing"))
+			{
+				// The scene gets drawn in HDR and brought down to the screen by the tonemapper
+				ImGui::Checkbox("HDR + post processing", &usePostProcessing);
+				ImGui::Checkbox("Bloom", &postProcessing->Bloom);
+				ImGui::SliderFloat("Bloom threshold", &postProcessing->BloomThreshold, 0.0f, 4.0f);
+				ImGui::SliderFloat("Bloom knee", &postProcessing->BloomKnee, 0.0f, 1.0f);
+				ImGui::SliderFloat("Bloom intensity", &postProcessing->BloomIntensity, 0.0f, 1.0f);
+				ImGui::SliderInt("Bloom levels", &postProcessing->BloomLevels, 1, PostProcessing::MAX_BLOOM_LEVELS);
+				int tonemapper = (int)postProcessing->Tonemap;
+				if (ImGui::Combo("Tonemapper", &tonemapper, "None\0Reinhard\0ACES\0")) {
+					postProcessing->Tonemap = (Tonemapper)tonemapper;
+				}
+				ImGui::SliderFloat("Exposure", &postProcessing->Exposure, 0.1f, 4.0f);
+				ImGui::Checkbox("FXAA", &postProcessing->Fxaa);
+				// Trades pixels for frame rate, the scene is drawn smaller and sharpened on the way up to the screen
+				ImGui::Checkbox("Dynamic resolution", &useDynamicResolution);
+				ImGui::SliderFloat("GPU budget (ms)", &dynamicResolution->BudgetMs, 4.0f, 50.0f);
+				ImGui::SliderFloat("Min scale", &dynamicResolution->MinScale, 0.25f, 1.0f);
+				ImGui::SliderFloat("Sharpness", &postProcessing->Sharpness, 0.0f, 1.0f);
+				ImGui::Text("Render scale: %.2f (GPU frame %.2f ms)", dynamicResolution->GetScale(), dynamicResolution->GetFrameMs());
+				const RenderTargetPool::Stats& poolStats = postProcessing->GetPool()->GetStats();
+				ImGui::Text("Scene targets: %d bytes per pixel", (int)PostProcessing::GetBytesPerPixel());
+				ImGui::Text("Pooled targets: %d (%.2f MB)", poolStats.TextureCount, poolStats.MemorySize / (1024.0f * 1024.0f));
+				const RenderGraph::Stats& graphStats = postProcessing->GetGraph()->GetStats();
+				ImGui::Text("Graph passes: %d (%d culled) Transients: %d (%d at once)", graphStats.Passes, graphStats.CulledPasses, graphStats.Transients, graphStats.PeakTransients);
 			}
+			if (ImGui::CollapsingHeader("Texture Quality"))
+			{
+				// All our textures share a handful of samplers, so this only touches those
+				static float maxAnisotropy = ITexture::GetLimits().MAX_ANISOTROPY;
+				if (ImGui::SliderFloat("Max Anisotropy", &maxAnisotropy, 1.0f, ITexture::GetLimits().MAX_ANISOTROPY)) {
+					Sampler::SetAnisotropyLimit(maxAnisotropy);
+				}
+				// Textures get shrunk to fit in this, so lower end GPUs don't run out of memory
+				static int budgetMb = static_cast<int>(TextureResidency::Budget / (1024 * 1024));
+				if (ImGui::SliderInt("Texture Budget (MB)", &budgetMb, 32, 4096)) {
+					TextureResidency::Budget = static_cast<size_t>(budgetMb) * 1024 * 1024;
+				}
+			}
+			const TextureResidency::Stats& textureStats = TextureResidency::GetStats();
+			ImGui::Text("Texture memory: %.1f MB (%.1f MB streamable) Budget: %.1f MB", textureStats.TotalMemory / (1024.0f * 1024.0f),
+				textureStats.ManagedMemory / (1024.0f * 1024.0f), TextureResidency::Budget / (1024.0f * 1024.0f));
+			ImGui::Text("Textures: %d Shrunk: %d Restoring: %d", textureStats.ManagedCount, textureStats.ShrunkCount, textureStats.RestoringCount);
 
-			auto name = controllables[selectedVao].get<GameObjectTag>().Name;
+			const std::string& name = controllables[selectedVao].get<GameObjectTag>().GetName();
 			ImGui::Text(name.c_str());
 			auto behaviour = BehaviourBinding::Get<SimpleMoveBehaviour>(controllables[selectedVao]);
 			ImGui::Checkbox("Relative Rotation", &behaviour->Relative);
 
-			ImGui::Text("Q/E -> Yaw\nLeft/Right -> Roll\nUp/Down -> Pitch\nY -> Toggle Mode");
+			ImGui::Text("Q/E -> Yaw\nLeft/Right -> Roll\nUp/Down -> Pitch\nY -> Toggle Mode\nF9 -> Capture Trace");
 
 			minFps = FLT_MAX;
 			maxFps = 0;
@@ -384,35 +1056,377 @@ int main() {
 			}
 			ImGui::PlotLines("FPS", fpsBuffer, 128);
 			ImGui::Text("MIN: %f MAX: %f AVG: %f", minFps, maxFps, avgFps / 128.0f);
+			// The UI only gets rebuilt on input or a few times a second, so the numbers above tick over at that rate too
+			ImGui::Checkbox("Cache UI between changes", &isUiCached);
+
+			SystemMonitor::GetSnapshot(systemSnapshot);
+			const int newest = (systemSnapshot.Offset + SystemMonitor::HISTORY_SIZE - 1) % SystemMonitor::HISTORY_SIZE;
+			ImGui::PlotLines("Memory (MB)", systemSnapshot.MemoryMB, SystemMonitor::HISTORY_SIZE, systemSnapshot.Offset);
+			ImGui::Text("Memory: %.1f MB Peak: %.1f MB", systemSnapshot.MemoryMB[newest], systemSnapshot.PeakMemoryMB);
+			ImGui::Text("Heap allocations: %u last frame Frame arena: %.1f KB of %.1f KB", MemoryTracker::GetLastFrameAllocations(),
+				FrameArena::GetUsed() / 1024.0f, FrameArena::GetCapacity() / 1024.0f);
+			if (ImGui::CollapsingHeader("Memory by subsystem")) {
+				ImGui::Columns(5, "MemoryTags");
+				ImGui::Text("Tag"); ImGui::NextColumn();
+				ImGui::Text("Current"); ImGui::NextColumn();
+				ImGui::Text("Peak"); ImGui::NextColumn();
+				ImGui::Text("Allocs/frame"); ImGui::NextColumn();
+				ImGui::Text("Budget"); ImGui::NextColumn();
+				ImGui::Separator();
+				for (uint8_t tagIx = 0; tagIx < static_cast<uint8_t>(MemoryTag::Count); tagIx++) {
+					const MemoryTracker::TagStats stats = MemoryTracker::GetStats(static_cast<MemoryTag>(tagIx));
+					const bool isOver = stats.Budget > 0 && stats.Current > stats.Budget;
+					ImGui::TextColored(isOver ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f) : ImVec4(1.0f, 1.0f, 1.0f, 1.0f), "%s", MemoryTracker::GetTagName(static_cast<MemoryTag>(tagIx)));
+					ImGui::NextColumn();
+					ImGui::Text("%.2f MB", stats.Current / (1024.0f * 1024.0f)); ImGui::NextColumn();
+					ImGui::Text("%.2f MB", stats.Peak / (1024.0f * 1024.0f)); ImGui::NextColumn();
+					ImGui::Text("%u", stats.LastFrame); ImGui::NextColumn();
+					if (stats.Budget > 0) {
+						ImGui::Text("%.0f MB", stats.Budget / (1024.0f * 1024.0f));
+					} else {
+						ImGui::Text("-");
+					}
+					ImGui::NextColumn();
+				}
+				ImGui::Columns(1);
+				if (ImGui::Button("Dump allocation sites")) {
+					MemoryTracker::DumpSites();
+				}
+			}
+			ImGui::PlotLines("CPU (%)", systemSnapshot.CpuUsage, SystemMonitor::HISTORY_SIZE, systemSnapshot.Offset, nullptr, 0.0f, 100.0f);
+			if (systemSnapshot.GpuFreeMB[newest] > 0.0f) {
+				ImGui::PlotLines("GPU free (MB)", systemSnapshot.GpuFreeMB, SystemMonitor::HISTORY_SIZE, systemSnapshot.Offset, nullptr, 0.0f, FLT_MAX);
+				ImGui::Text("GPU memory: %.0f MB free of %.0f MB", systemSnapshot.GpuFreeMB[newest], systemSnapshot.GpuTotalMB);
+			}
+			// Each thread's usage is out of a single core, so a busy worker sits near 100
+			if (ImGui::CollapsingHeader("Thread CPU")) {
+				for (const SystemMonitor::ThreadHistory& thread : systemSnapshot.Threads) {
+					ImGui::PlotLines(thread.Name.c_str(), thread.Usage, SystemMonitor::HISTORY_SIZE, systemSnapshot.Offset, nullptr, 0.0f, 100.0f);
+				}
+			}
+
+			// CPU timings for each phase of the game loop over the last few frames
+			if (ImGui::CollapsingHeader("CPU Timings", ImGuiTreeNodeFlags_DefaultOpen)) {
+				ImGui::Columns(5, "CpuTimings");
+				ImGui::Text("Zone"); ImGui::NextColumn();
+				ImGui::Text("Incl. avg"); ImGui::NextColumn();
+				ImGui::Text("Excl. avg"); ImGui::NextColumn();
+				ImGui::Text("Incl. min"); ImGui::NextColumn();
+				ImGui::Text("Incl. p99"); ImGui::NextColumn();
+				ImGui::Separator();
+				for (const CpuProfiler::ZoneStats& zone : CpuProfiler::Instance().GetZones()) {
+					CpuProfiler::Summary inclusive = CpuProfiler::Summarize(zone.Inclusive);
+					CpuProfiler::Summary exclusive = CpuProfiler::Summarize(zone.Exclusive);
+					ImGui::Text("%*s%s", zone.Depth * 2, "", zone.Name); ImGui::NextColumn();
+					ImGui::Text("%.3f ms", inclusive.Avg); ImGui::NextColumn();
+					ImGui::Text("%.3f ms", exclusive.Avg); ImGui::NextColumn();
+					ImGui::Text("%.3f ms", inclusive.Min); ImGui::NextColumn();
+					ImGui::Text("%.3f ms", inclusive.P99); ImGui::NextColumn();
+				}
+				ImGui::Columns(1);
+			}
+
+			// GPU timings are a few frames behind, but tell us whether the GPU is what's holding up the frame
+			if (ImGui::CollapsingHeader("GPU Timings", ImGuiTreeNodeFlags_DefaultOpen)) {
+				for (const GpuProfiler::Zone& zone : GpuProfiler::Instance().GetResults()) {
+					ImGui::Text("%*s%-12s %7.3f ms", zone.Depth * 2, "", zone.Name, zone.GetMilliseconds());
+				}
+				for (const auto& kvp : GpuProfiler::Instance().GetHistory()) {
+					ImGui::PlotLines(kvp.first.c_str(), kvp.second.Samples, GpuProfiler::HISTORY_SIZE, kvp.second.Index);
+				}
+				// The driver's performance warnings are counted instead of logged, so they show up here
+				if (GlDebugOutput::IsEnabled()) {
+					GlDebugOutput::GetPerfWarnings(perfWarnings);
+					ImGui::Text("Driver perf warnings: %u last frame", GlDebugOutput::GetPerfWarningsLastFrame());
+					for (const GlDebugOutput::PerfWarning& warning : perfWarnings) {
+						ImGui::TextWrapped("%u (x%u): %s", warning.Id, warning.Count, warning.Message.c_str());
+					}
+				}
+			}
+			if (ImGui::CollapsingHeader("GL Debug Output")) {
+				bool debugOutput = GlDebugOutput::IsEnabled();
+				if (ImGui::Checkbox("Enabled", &debugOutput)) {
+					GlDebugOutput::SetEnabled(debugOutput);
+				}
+				bool callStacks = GlDebugOutput::IsCapturingCallStacks();
+				if (ImGui::Checkbox("Capture call stacks (slow)", &callStacks)) {
+					GlDebugOutput::SetCaptureCallStacks(callStacks);
+				}
+				bool notifications = GlDebugOutput::IsLoggingNotifications();
+				if (ImGui::Checkbox("Log notifications", &notifications)) {
+					GlDebugOutput::SetLogNotifications(notifications);
+				}
+			}
+			// Frames that take much longer than usual get the seconds leading up to them written out as a trace
+			if (ImGui::CollapsingHeader("Hitch Capture")) {
+				TraceRecorder& traces = TraceRecorder::Instance();
+				bool hitchCapture = traces.IsHitchCaptureEnabled();
+				if (ImGui::Checkbox("Capture hitches", &hitchCapture)) {
+					traces.SetHitchCapture(hitchCapture);
+				}
+				ImGui::SliderFloat("Times the median", &traces.HitchFactor, 1.25f, 8.0f);
+				ImGui::SliderFloat("Shortest hitch (ms)", &traces.HitchMinMs, 0.0f, 100.0f);
+				ImGui::Text("Hitches captured: %u", traces.GetHitchCount());
+			}
+			if (RemoteProfiler::IsListening() && ImGui::CollapsingHeader("Remote Profiler")) {
+				ImGui::Text("Port %u, %s", RemoteProfiler::GetPort(), RemoteProfiler::IsConnected() ? "viewer connected" : "waiting for a viewer");
+				ImGui::Text("Frames sent: %u, dropped: %u", RemoteProfiler::GetSentFrames(), RemoteProfiler::GetDroppedFrames());
+			}
+			if (ImGui::CollapsingHeader("Frame Pacing")) {
+				Timing& timing = Timing::Instance();
+				static const char* vsyncModes[] = { "Off", "On", "Adaptive" };
+				int vsync = timing.GetVSync() == VSyncMode::Adaptive ? 2 : (int)timing.GetVSync();
+				if (ImGui::Combo("VSync", &vsync, vsyncModes, 3)) {
+					timing.SetVSync(vsync == 2 ? VSyncMode::Adaptive : (VSyncMode)vsync);
+				}
+				ImGui::DragFloat("Frame cap (0 = off)", &timing.TargetFrameRate, 1.0f, 0.0f, 500.0f, "%.0f fps");
+				float spinMs = (float)(timing.SpinTime * 1000.0);
+				if (ImGui::DragFloat("Spin time", &spinMs, 0.05f, 0.0f, 10.0f, "%.2f ms")) {
+					timing.SpinTime = spinMs / 1000.0;
+				}
+				float leadMs = (float)(timing.InputLeadTime * 1000.0);
+				if (ImGui::DragFloat("Input lead time", &leadMs, 0.05f, 0.0f, 50.0f, "%.2f ms")) {
+					timing.InputLeadTime = leadMs / 1000.0;
+				}
+			}
+			ImGui::Checkbox("Multi-draw indirect", &useMultiDrawIndirect);
+			// Draws last frame's snapshot while this frame's gets built, at the cost of a frame of latency
+			ImGui::Checkbox("Pipelined rendering", &usePipelinedRendering);
+			ImGui::Text("Draw calls: %d Instances: %d", drawCallCount, instanceCount);
+			ImGui::Text("State changes issued: %d elided: %d", RenderState::GetStats().Issued, RenderState::GetStats().Elided);
+			// What last frame sent to OpenGL, broken down by the pass it was sent from. Layers that did nothing are left out
+			if (ImGui::CollapsingHeader("Render Statistics")) {
+				const RenderStats::Frame& renderStats = RenderStats::GetLastFrame();
+				ImGui::Columns(8, "RenderStats");
+				ImGui::Text("Layer"); ImGui::NextColumn();
+				ImGui::Text("Draws (inst.)"); ImGui::NextColumn();
+				ImGui::Text("Triangles"); ImGui::NextColumn();
+				ImGui::Text("Vertices"); ImGui::NextColumn();
+				ImGui::Text("Prog/VAO/Tex"); ImGui::NextColumn();
+				ImGui::Text("Mat/Uniforms"); ImGui::NextColumn();
+				ImGui::Text("Buffers"); ImGui::NextColumn();
+				ImGui::Text("Textures"); ImGui::NextColumn();
+				ImGui::Separator();
+				auto drawCounters = [](const char* name, const RenderStats::Counters& counters) {
+					ImGui::Text("%s", name); ImGui::NextColumn();
+					ImGui::Text("%u (%u)", counters.DrawCalls, counters.InstancedDraws); ImGui::NextColumn();
+					ImGui::Text("%llu", (unsigned long long)counters.Triangles); ImGui::NextColumn();
+					ImGui::Text("%llu", (unsigned long long)counters.Vertices); ImGui::NextColumn();
+					ImGui::Text("%u/%u/%u", counters.ProgramSwitches, counters.VaoSwitches, counters.TextureSwitches); ImGui::NextColumn();
+					ImGui::Text("%u/%u", counters.MaterialSwitches, counters.UniformUploads); ImGui::NextColumn();
+					ImGui::Text("%.1f KB", counters.BufferBytes / 1024.0f); ImGui::NextColumn();
+					ImGui::Text("%.1f KB", counters.TextureBytes / 1024.0f); ImGui::NextColumn();
+				};
+				for (int layerIx = 0; layerIx < static_cast<int>(RenderStats::Layer::Count); layerIx++) {
+					const RenderStats::Counters& counters = renderStats.Layers[layerIx];
+					if (counters.DrawCalls > 0 || counters.ProgramSwitches > 0 || counters.UniformUploads > 0 ||
+						counters.BufferBytes > 0 || counters.TextureBytes > 0) {
+						drawCounters(RenderStats::GetLayerName(static_cast<RenderStats::Layer>(layerIx)), counters);
+					}
+				}
+				ImGui::Separator();
+				drawCounters("Total", renderStats.Total);
+				ImGui::Columns(1);
+				ImGui::Text("Culled: %u objects, %u occluded, %u lights", renderStats.CulledObjects, renderStats.OccludedObjects, renderStats.CulledLights);
+			}
+			if (ImGui::CollapsingHeader("GPU Resources")) {
+				// Clicking a column's header sorts by it, clicking it again flips the order
+				static int sortColumn = 3;
+				static bool sortDescending = true;
+				std::vector<GpuResources::Resource> resources = GpuResources::Collect();
+				std::sort(resources.begin(), resources.end(), [](const GpuResources::Resource& a, const GpuResources::Resource& b) {
+					int order = 0;
+					switch (sortColumn) {
+						case 0: order = strcmp(a.Kind, b.Kind); break;
+						case 1: order = a.Name.compare(b.Name); break;
+						case 2: order = strcmp(a.Owner, b.Owner); break;
+						case 3: order = a.Bytes < b.Bytes ? -1 : a.Bytes > b.Bytes ? 1 : 0; break;
+						default: order = a.LastUsedFrame < b.LastUsedFrame ? -1 : a.LastUsedFrame > b.LastUsedFrame ? 1 : 0; break;
+					}
+					return sortDescending ? order > 0 : order < 0;
+				});
+
+				size_t totalBytes = 0;
+				std::map<std::string, size_t> ownerBytes;
+				for (const GpuResources::Resource& resource : resources) {
+					totalBytes += resource.Bytes;
+					ownerBytes[resource.Owner] += resource.Bytes;
+				}
+				ImGui::Text("%d resources, %.1f MB", (int)resources.size(), totalBytes / (1024.0f * 1024.0f));
+				for (const auto& [owner, bytes] : ownerBytes) {
+					ImGui::BulletText("%s: %.1f MB", owner.c_str(), bytes / (1024.0f * 1024.0f));
+				}
+
+				const char* headers[] = { "Kind", "Name", "Owner", "Size", "Last used" };
+				const uint64_t frame = TextureResidency::GetFrame();
+				ImGui::BeginChild("GpuResourceList", ImVec2(0, 300), true);
+				ImGui::Columns(5, "GpuResources");
+				for (int columnIx = 0; columnIx < 5; columnIx++) {
+					if (ImGui::Selectable(headers[columnIx], sortColumn == columnIx)) {
+						sortDescending = sortColumn == columnIx ? !sortDescending : true;
+						sortColumn = columnIx;
+					}
+					ImGui::NextColumn();
+				}
+				ImGui::Separator();
+				for (const GpuResources::Resource& resource : resources) {
+					ImGui::Text("%s", resource.Kind); ImGui::NextColumn();
+					if (resource.Name.empty()) {
+						ImGui::TextDisabled("#%u", resource.Handle);
+					} else {
+						ImGui::Text("%s", resource.Name.c_str());
+					}
+					ImGui::NextColumn();
+					ImGui::Text("%s", resource.Owner); ImGui::NextColumn();
+					ImGui::Text("%.1f KB", resource.Bytes / 1024.0f); ImGui::NextColumn();
+					if (resource.LastUsedFrame == 0) {
+						ImGui::TextDisabled("-");
+					} else {
+						ImGui::Text("%llu frames ago", (unsigned long long)(frame - resource.LastUsedFrame));
+					}
+					ImGui::NextColumn();
+				}
+				ImGui::Columns(1);
+				ImGui::EndChild();
+			}
+			ImGui::Checkbox("Frustum culling", &useFrustumCulling);
+			ImGui::Text("Visible: %d Culled: %d Waiting on shaders: %d", visibleCount, culledCount, pendingCount);
+			// Tests against the depth the scene was drawn with a few frames ago, which needs the HDR target's depth
+			ImGui::Checkbox("Occlusion culling (needs post processing)", &useOcclusionCulling);
+			ImGui::Text("Occluded: %d", occludedCount);
+			// A few expensive meshes get a hardware query each instead, and are drawn conditionally on last frame's result
+			if (ImGui::Checkbox("Occlusion queries", &useOcclusionQueries) && !useOcclusionQueries) {
+				occlusionQueries->Reset();
+			}
+			const OcclusionQueries::Stats& queryStats = occlusionQueries->GetStats();
+			ImGui::Text("Queries: %d Conditional draws: %d Skipped: %d", queryStats.Queries, queryStats.ConditionalDraws, queryStats.Skipped);
+			ImGui::Text("Static batches: %d (from %d renderers)", staticStats.Batches, staticStats.Merged);
+			if (world != nullptr && world->GetCellCount() > 0) {
+				ImGui::Text("World cells: %d loaded, %d pending (of %d)", world->GetLoadedCount(), world->GetPendingCount(), (int)world->GetCellCount());
+			}
+			if (physics != nullptr) {
+				ImGui::Text("Physics bodies: %d Active: %d Static chunks: %d Queries: %d", physics->GetBodyCount(), physics->GetActiveCount(), physics->GetStaticChunkCount(), physics->GetQueryCount());
+			}
+			const FrameScheduler::Stats sliceStats = FrameScheduler::GetStats();
+			ImGui::Text("Amortized tasks: %d Slices: %d Used: %.2f/%.2f ms", sliceStats.Tasks, sliceStats.Slices, sliceStats.UsedMs, sliceStats.BudgetMs);
+			ImGui::SliderFloat("Amortized budget (ms)", &FrameScheduler::MaxBudgetMs, 0.0f, 8.0f);
+			const IoScheduler::Stats ioStats = IoScheduler::GetStats();
+			ImGui::Text("I/O queued: %d/%d/%d Done: %d Merged: %d Cancelled: %d (%.1f MB)", ioStats.Queued[0], ioStats.Queued[1], ioStats.Queued[2],
+				(int)ioStats.Completed, (int)ioStats.Coalesced, (int)ioStats.Cancelled, ioStats.Bytes / (1024.0 * 1024.0));
+			// Moving the mouse over the window is input, so the stats below will only ever show us awake
+			ImGui::Checkbox("Power save", &PowerMode::Enabled);
+			const PowerMode::Stats& powerStats = PowerMode::GetStats();
+			ImGui::Text("Idle: %.1f s Heartbeats: %d Wakeups: %d", powerStats.IdleSeconds, (int)powerStats.Heartbeats, (int)powerStats.Wakeups);
+			if (sceneAudio != nullptr) {
+				ImGui::Text("Audio sources: %d playing, %d virtual, %d waiting (%d banks loading)", sceneAudio->GetPlayingCount(), sceneAudio->GetVirtualCount(), sceneAudio->GetWaitingCount(), audio->GetLoadingBankCount());
+				int voiceLimit = (int)sceneAudio->GetVoiceLimit();
+				if (ImGui::SliderInt("Audio voices", &voiceLimit, 1, 128)) {
+					sceneAudio->SetVoiceLimit((uint32_t)voiceLimit);
+				}
+			}
+			// Meshlets are culled in the multi-draw path, since the surviving clusters are drawn from an arena
+			ImGui::Checkbox("Meshlet culling", &useMeshletCulling);
+			// As are the scatters' instances, the snapshot hands them over whole instead of culling their cells
+			ImGui::Checkbox("GPU instance culling", &useGpuCulling);
+			// Trades an extra position only pass for shading each pixel once, see the DepthPrepass GPU zone
+			ImGui::Checkbox("Depth pre-pass", &useDepthPrepass);
+			// Worked out from the depth, so forward shading gets a pre-pass whether it's ticked or not
+			if (ImGui::Checkbox("Ambient occlusion", &useAmbientOcclusion) && !useAmbientOcclusion) {
+				ambientOcclusion->Reset();
+			}
+			if (useAmbientOcclusion) {
+				ImGui::SliderFloat("AO radius", &ambientOcclusion->Radius, 0.1f, 3.0f);
+				ImGui::SliderFloat("AO intensity", &ambientOcclusion->Intensity, 0.5f, 4.0f);
+				ImGui::SliderInt("AO steps", &ambientOcclusion->StepCount, 1, 8);
+			}
+			ImGui::Text("Meshlets tested: %d", meshletCuller != nullptr ? meshletCuller->GetTestedCount() : 0);
+			ImGui::Text("Instances tested on the GPU: %d", instanceCuller != nullptr ? instanceCuller->GetTestedCount() : 0);
+			if (renderRecords != nullptr) {
+				ImGui::Text("Renderers culled on the GPU: %d (%u records uploaded in %u ranges)", gpuCulledCount,
+					renderRecords->GetStats().Uploaded, renderRecords->GetStats().Ranges);
+			}
+			ImGui::Text("Lights: %d binned, %d culled (%dx%dx%d clusters)", lightCount, culledLightCount,
+				ClusteredLighting::GRID_X, ClusteredLighting::GRID_Y, ClusteredLighting::GRID_Z);
+			// Static casters only get redrawn when they or the light move, everything else is drawn over the cache
+			ImGui::Checkbox("Shadows", &useShadows);
+			ImGui::Text("Shadow views: %d static, %d dynamic, %d cached (%d instances in %d passes)", shadowStats.StaticPasses,
+				shadowStats.DynamicPasses, shadowStats.CachedPasses, shadowStats.Instances, shadowStats.Submissions);
+			if (shadowMaps != nullptr && shadowMaps->IsLayeredSupported()) {
+				ImGui::Checkbox("Draw cube shadows in one pass", &shadowMaps->LayeredCubes);
+			}
+			if (gpuPicker != nullptr && gpuPicker->IsReady()) {
+				ImGui::Checkbox("Pick on the GPU", &useGpuPicking);
+			}
+			ImGui::Checkbox("Levels of detail", &useLods);
+			ImGui::SliderFloat("LOD pixel error", &lodPixelError, 0.25f, 8.0f);
+			ImGui::Text("Drawn at reduced detail: %d", lodCount);
+			ImGui::Text("Drawn back to front: %d", transparentCount);
+			ImGui::Text("Blended without sorting: %d", weightedCount);
+			// The extra views are culled along with the main one and draw out of the same instances, only their frame
+			// uniforms and light clusters are their own. The lit materials only have a G-buffer variant when deferred
+			ImGui::Checkbox("Extra views (forward shading only)", &useExtraViews);
+			if (useExtraViews) {
+				for (const ExtraView& view : extraViews) {
+					ImGui::Text("%s: %d visible", view.Name.c_str(), view.VisibleCount);
+					// Textures are stored bottom row first, so the image gets flipped
+					ImGui::Image((ImTextureID)(intptr_t)view.Target->GetColor(), ImVec2(EXTRA_VIEW_WIDTH * 0.5f, EXTRA_VIEW_HEIGHT * 0.5f), ImVec2(0, 1), ImVec2(1, 0));
+				}
+			}
+			// Far away trees are drawn as a single quad, with their mesh dithered out over the fade
+			ImGui::SliderFloat("Impostor distance", &impostorDistance, 5.0f, 100.0f);
+			ImGui::SliderFloat("Impostor fade", &impostorFadeWidth, 0.0f, 20.0f);
+			ImGui::Text("Drawn as impostors: %d", impostorCount + scatterImpostorCount);
+			ImGui::Text("Scattered: %d drawn from %d cells", scatterCount, scatterCellCount);
+			ImGui::Text("Terrain patches: %d", terrainPatchCount);
+			// Particles are simulated and drawn on the GPU, the CPU only hands each emitter it's settings
+			ImGui::Checkbox("Particles", &useParticles);
+			if (particleSystem != nullptr) {
+				const ParticleSystem::Stats& particleStats = particleSystem->GetStats();
+				ImGui::Text("Particle emitters: %d Capacity: %d Emitting: %d/frame", particleStats.Emitters, (int)particleStats.Capacity, (int)particleStats.Emitted);
+			}
+			ImGui::Text("Textures loading: %d", TextureLoader::GetPendingCount());
+			ImGui::Text("Assets loaded: %d Reused: %d", AssetManager::GetLoadedCount(), AssetManager::GetHitCount());
 			});
 
 		#pragma endregion 
 
-		// GL states
-		glEnable(GL_DEPTH_TEST);
-		glEnable(GL_CULL_FACE);
-		glDepthFunc(GL_LEQUAL); // New 
+		// GL states, the scene's draws set their own from their material's pipeline state
+		RenderState::ApplyPipeline(PipelineState());
 
 		#pragma region TEXTURE LOADING
-
-		// Load some textures from files
-		Texture2D::sptr diffuse = Texture2D::LoadFromFile("images/Stone_001_Diffuse.png");
-		Texture2D::sptr diffuseGround = Texture2D::LoadFromFile("images/grass.jpg");
-		Texture2D::sptr diffuseDunce = Texture2D::LoadFromFile("images/Dunce.png");
-		Texture2D::sptr diffuseDuncet = Texture2D::LoadFromFile("images/Duncet.png");
-		Texture2D::sptr diffuseSlide = Texture2D::LoadFromFile("images/Slide.png");
-		Texture2D::sptr diffuseSwing = Texture2D::LoadFromFile("images/Swing.png");
-		Texture2D::sptr diffuseTable = Texture2D::LoadFromFile("images/Table.png");
-		Texture2D::sptr diffuseTreeBig = Texture2D::LoadFromFile("images/TreeBig.png");
-		Texture2D::sptr diffuseRedBalloon = Texture2D::LoadFromFile("images/BalloonRed.png");
-		Texture2D::sptr diffuseYellowBalloon = Texture2D::LoadFromFile("images/BalloonYellow.png");
-		Texture2D::sptr diffuse2 = Texture2D::LoadFromFile("images/box.bmp");
-		Texture2D::sptr specular = Texture2D::LoadFromFile("images/Stone_001_Specular.png");
-		Texture2D::sptr reflectivity = Texture2D::LoadFromFile("images/box-reflections.bmp");
+		StartupReport::BeginStage("Create textures");
+
+		// Load some textures from files, these start out as small white placeholders and only get loaded once
+		// something using them is drawn (or is about to be). They get block compressed as they load, see
+		// TextureCompressor
+		Texture2DDescription imageDesc = Texture2DDescription();
+		imageDesc.Compressible = true;
+		Texture2D::sptr diffuse = AssetManager::GetTextureOnDemand("images/Stone_001_Diffuse.png", imageDesc);
+		// The lit materials only differ by their diffuse maps, so we pack those into one array and have each material
+		// pick it's layer, that way they can all be drawn together
+		TextureArrayBuilder diffuseArrayBuilder;
+		uint32_t layerGround = diffuseArrayBuilder.Add("images/grass.jpg");
+		uint32_t layerDunce = diffuseArrayBuilder.Add("images/Dunce.png");
+		uint32_t layerDuncet = diffuseArrayBuilder.Add("images/Duncet.png");
+		uint32_t layerSlide = diffuseArrayBuilder.Add("images/Slide.png");
+		uint32_t layerSwing = diffuseArrayBuilder.Add("images/Swing.png");
+		uint32_t layerTable = diffuseArrayBuilder.Add("images/Table.png");
+		uint32_t layerTreeBig = diffuseArrayBuilder.Add("images/TreeBig.png");
+		uint32_t layerRedBalloon = diffuseArrayBuilder.Add("images/BalloonRed.png");
+		uint32_t layerYellowBalloon = diffuseArrayBuilder.Add("images/BalloonYellow.png");
+		Texture2DArray::sptr diffuseArray = diffuseArrayBuilder.Build();
+		Texture2D::sptr diffuse2 = AssetManager::GetTextureOnDemand("images/box.bmp", imageDesc);
+		Texture2D::sptr specular = AssetManager::GetTextureOnDemand("images/Stone_001_Specular.png", imageDesc);
+		Texture2D::sptr reflectivity = AssetManager::GetTextureOnDemand("images/box-reflections.bmp", imageDesc);
 
 		// Load the cube map
-		//TextureCubeMap::sptr environmentMap = TextureCubeMap::LoadFromImages("images/cubemaps/skybox/sample.jpg");
-		TextureCubeMap::sptr environmentMap = TextureCubeMap::LoadFromImages("images/cubemaps/skybox/ocean.jpg"); 
+		//TextureCubeMap::sptr environmentMap = AssetManager::GetCubeMap("images/cubemaps/skybox/sample.jpg");
+		TextureCubeMap::sptr environmentMap = AssetManager::GetCubeMap("images/cubemaps/skybox/ocean.jpg"); 
+		// The reflections read blurred copies of it, these only get filtered the first time and are cached after that.
+		// The prefilter's shaders aren't needed again, so it doesn't need to stick around
+		EnvironmentPrefilter::Result prefilteredEnvironment = EnvironmentPrefilter::Create()->Load("images/cubemaps/skybox/ocean.jpg", environmentMap);
+		TextureCubeMap::sptr reflectionMap = prefilteredEnvironment.Specular != nullptr ? prefilteredEnvironment.Specular : environmentMap;
+		TextureCubeMap::sptr irradianceMap = prefilteredEnvironment.Irradiance != nullptr ? prefilteredEnvironment.Irradiance : environmentMap;
 
 		// Creating an empty texture
 		Texture2DDescription desc = Texture2DDescription();  
@@ -427,32 +1441,68 @@ int main() {
 
 		///////////////////////////////////// Scene Generation //////////////////////////////////////////////////
 		#pragma region Scene Generation
-		
-		// We need to tell our scene system what extra component types we want to support
+		StartupReport::BeginStage("Build scene");
+
+		// We need to tell our scene system what extra component types we want to support, registering them with the
+		// serializer also registers them with the scene
 		GameScene::RegisterComponentType<RendererComponent>();
+		GameScene::RegisterComponentType<ScatterComponent>();
+		GameScene::RegisterComponentType<TerrainComponent>();
+		GameScene::RegisterComponentType<ParticleEmitter>();
 		GameScene::RegisterComponentType<BehaviourBinding>();
 		GameScene::RegisterComponentType<Camera>();
+		SceneSerializer::RegisterComponentType<StaticTag>("Static");
+		SceneSerializer::RegisterComponentType<FollowPathComponent>("FollowPath");
+		SceneSerializer::RegisterComponentType<SimpleMoveComponent>("SimpleMove");
+		SceneSerializer::RegisterComponentType<InterpolatedTransform>("InterpolatedTransform");
+		SceneSerializer::RegisterComponentType<RigidBody>("RigidBody");
+		SceneSerializer::RegisterComponentType<AudioSource>("AudioSource");
+		SceneSerializer::RegisterComponentType<AudioListener>("AudioListener");
+		SceneSerializer::RegisterComponentType<Light>("Light");
+		SceneSerializer::RegisterBehaviour<CameraControlBehaviour>("CameraControl");
+		SceneSerializer::RegisterBehaviour<FollowPathBehaviour>("FollowPath");
+		SceneSerializer::RegisterBehaviour<SimpleMoveBehaviour>("SimpleMove");
+
+		// Behaviours that lots of entities share run as systems, once per frame for all of them
+		BehaviourSystems::RegisterFixed("FollowPath", &PathFollowSystem::Update,
+			SystemAccess().Writes<FollowPathComponent, Transform>());
+		// Input can only be read on the main thread
+		BehaviourSystems::Register("SimpleMove", &SimpleMoveBehaviour::UpdateSystem,
+			SystemAccess().Reads<SimpleMoveComponent>().Writes<Transform>().OnMainThread());
 
 		// Create a scene, and set it to be the active scene in the application
 		GameScene::sptr scene = GameScene::Create("test");
 		Application::Instance().ActiveScene = scene;
 
-		// We can create a group ahead of time to make iterating on the group faster
-		entt::basic_group<entt::entity, entt::exclude_t<>, entt::get_t<Transform>, RendererComponent> renderGroup =
-			scene->Registry().group<RendererComponent>(entt::get_t<Transform>());
+		// We can create the render group ahead of time to make iterating on the group faster, the builder does that
+		// and turns the group into something we can draw each frame
+		RenderSnapshotBuilder snapshotBuilder(*scene);
 
 		// Create a material and set some properties for it
 		ShaderMaterial::sptr materialGround = ShaderMaterial::Create();  
 		materialGround->Shader = shader;
-		materialGround->Set("s_Diffuse", diffuseGround);
+		materialGround->Set("s_DiffuseArray", diffuseArray);
+		materialGround->Set("u_DiffuseLayer", (float)layerGround);
 		materialGround->Set("s_Diffuse2", diffuse2);
 		materialGround->Set("s_Specular", specular);
 		materialGround->Set("u_Shininess", 8.0f);
 		materialGround->Set("u_TextureMix", 0.0f); 
+
+		// The terrain around the playground uses the same grass, the heightmap gets added once it's built
+		ShaderMaterial::sptr materialTerrain = ShaderMaterial::Create();
+		materialTerrain->Shader = terrainShader;
+		materialTerrain->Set("s_DiffuseArray", diffuseArray);
+		materialTerrain->Set("u_DiffuseLayer", (float)layerGround);
+		materialTerrain->Set("s_Diffuse2", diffuse2);
+		materialTerrain->Set("s_Specular", specular);
+		materialTerrain->Set("u_Shininess", 8.0f);
+		materialTerrain->Set("u_TextureMix", 0.0f);
+		terrainMaterials = { materialTerrain };
 		
 		ShaderMaterial::sptr materialDunce = ShaderMaterial::Create();  
 		materialDunce->Shader = shader;
-		materialDunce->Set("s_Diffuse", diffuseDunce);
+		materialDunce->Set("s_DiffuseArray", diffuseArray);
+		materialDunce->Set("u_DiffuseLayer", (float)layerDunce);
 		materialDunce->Set("s_Diffuse2", diffuse2);
 		materialDunce->Set("s_Specular", specular);
 		materialDunce->Set("u_Shininess", 8.0f);
@@ -460,7 +1510,8 @@ int main() {
 		
 		ShaderMaterial::sptr materialDuncet = ShaderMaterial::Create();  
 		materialDuncet->Shader = shader;
-		materialDuncet->Set("s_Diffuse", diffuseDuncet);
+		materialDuncet->Set("s_DiffuseArray", diffuseArray);
+		materialDuncet->Set("u_DiffuseLayer", (float)layerDuncet);
 		materialDuncet->Set("s_Diffuse2", diffuse2);
 		materialDuncet->Set("s_Specular", specular);
 		materialDuncet->Set("u_Shininess", 8.0f);
@@ -468,15 +1519,18 @@ int main() {
 
 		ShaderMaterial::sptr materialSlide = ShaderMaterial::Create();  
 		materialSlide->Shader = shader;
-		materialSlide->Set("s_Diffuse", diffuseSlide);
+		materialSlide->Set("s_DiffuseArray", diffuseArray);
+		materialSlide->Set("u_DiffuseLayer", (float)layerSlide);
 		materialSlide->Set("s_Diffuse2", diffuse2);
 		materialSlide->Set("s_Specular", specular);
 		materialSlide->Set("u_Shininess", 8.0f);
 		materialSlide->Set("u_TextureMix", 0.0f);
 		
+		// The swing's seats rock on their chains, which gets baked into a vertex animation once the mesh has loaded
 		ShaderMaterial::sptr materialSwing = ShaderMaterial::Create();  
-		materialSwing->Shader = shader;
-		materialSwing->Set("s_Diffuse", diffuseSwing);
+		materialSwing->Shader = animatedShader;
+		materialSwing->Set("s_DiffuseArray", diffuseArray);
+		materialSwing->Set("u_DiffuseLayer", (float)layerSwing);
 		materialSwing->Set("s_Diffuse2", diffuse2);
 		materialSwing->Set("s_Specular", specular);
 		materialSwing->Set("u_Shininess", 8.0f);
@@ -484,47 +1538,81 @@ int main() {
 		
 		ShaderMaterial::sptr materialTable = ShaderMaterial::Create();  
 		materialTable->Shader = shader;
-		materialTable->Set("s_Diffuse", diffuseTable);
+		materialTable->Set("s_DiffuseArray", diffuseArray);
+		materialTable->Set("u_DiffuseLayer", (float)layerTable);
 		materialTable->Set("s_Diffuse2", diffuse2);
 		materialTable->Set("s_Specular", specular);
 		materialTable->Set("u_Shininess", 8.0f);
 		materialTable->Set("u_TextureMix", 0.0f);
 		
+		// The trees fade out into their impostors once they're far enough away
 		ShaderMaterial::sptr materialTreeBig = ShaderMaterial::Create();  
-		materialTreeBig->Shader = shader;
-		materialTreeBig->Set("s_Diffuse", diffuseTreeBig);
+		materialTreeBig->Shader = fadeShader;
+		materialTreeBig->Set("s_DiffuseArray", diffuseArray);
+		materialTreeBig->Set("u_DiffuseLayer", (float)layerTreeBig);
 		materialTreeBig->Set("s_Diffuse2", diffuse2);
 		materialTreeBig->Set("s_Specular", specular);
 		materialTreeBig->Set("u_Shininess", 8.0f);
 		materialTreeBig->Set("u_TextureMix", 0.0f);
 		
 		ShaderMaterial::sptr materialredballoon = ShaderMaterial::Create();  
-		materialredballoon->Shader = shader;
-		materialredballoon->Set("s_Diffuse", diffuseRedBalloon);
+		// The balloons blend, so they get drawn after the rest of the scene
+		materialredballoon->Shader = transparentShader;
+		materialredballoon->Pipeline = PipelineState::WeightedBlended();
+		materialredballoon->Set("s_DiffuseArray", diffuseArray);
+		materialredballoon->Set("u_DiffuseLayer", (float)layerRedBalloon);
 		materialredballoon->Set("s_Diffuse2", diffuse2);
 		materialredballoon->Set("s_Specular", specular);
 		materialredballoon->Set("u_Shininess", 8.0f);
 		materialredballoon->Set("u_TextureMix", 0.0f);
 		
 		ShaderMaterial::sptr materialyellowballoon = ShaderMaterial::Create();  
-		materialyellowballoon->Shader = shader;
-		materialyellowballoon->Set("s_Diffuse", diffuseYellowBalloon);
+		materialyellowballoon->Shader = transparentShader;
+		materialyellowballoon->Pipeline = PipelineState::WeightedBlended();
+		materialyellowballoon->Set("s_DiffuseArray", diffuseArray);
+		materialyellowballoon->Set("u_DiffuseLayer", (float)layerYellowBalloon);
 		materialyellowballoon->Set("s_Diffuse2", diffuse2);
 		materialyellowballoon->Set("s_Specular", specular);
 		materialyellowballoon->Set("u_Shininess", 8.0f);
 		materialyellowballoon->Set("u_TextureMix", 0.0f);
 		
 
+		// All of these use the lighting variants, so they need to follow the lighting mode
+		litMaterials = { materialGround, materialDunce, materialDuncet, materialSlide, materialTable };
+		animatedMaterials = { materialSwing };
+		transparentMaterials = { materialredballoon, materialyellowballoon };
+
+		// The stress scene's materials cycle through the diffuse layers and shininesses, so each one really is it's
+		// own material rather than a copy the batching could fold together
+		std::vector<ShaderMaterial::sptr> stressMaterials;
+		if (stress.EntityCount > 0) {
+			const float stressLayers[] = { (float)layerDunce, (float)layerDuncet, (float)layerSlide, (float)layerSwing,
+				(float)layerTable, (float)layerRedBalloon, (float)layerYellowBalloon, (float)layerTreeBig, (float)layerGround };
+			for (uint32_t ix = 0; ix < stress.UniqueMaterials; ix++) {
+				ShaderMaterial::sptr material = ShaderMaterial::Create();
+				material->Shader = shader;
+				material->Set("s_DiffuseArray", diffuseArray);
+				material->Set("u_DiffuseLayer", stressLayers[ix % 9]);
+				material->Set("s_Diffuse2", diffuse2);
+				material->Set("s_Specular", specular);
+				material->Set("u_Shininess", 4.0f + ix);
+				material->Set("u_TextureMix", 0.0f);
+				stressMaterials.push_back(material);
+			}
+			litMaterials.insert(litMaterials.end(), stressMaterials.begin(), stressMaterials.end());
+		}
+		fadeMaterials = { materialTreeBig };
+
 		// Load a second material for our reflective material!
-		Shader::sptr reflectiveShader = Shader::Create();
-		reflectiveShader->LoadShaderPartFromFile("shaders/vertex_shader.glsl", GL_VERTEX_SHADER);
-		reflectiveShader->LoadShaderPartFromFile("shaders/frag_reflection.frag.glsl", GL_FRAGMENT_SHADER);
-		reflectiveShader->Link();
-
-		Shader::sptr reflective = Shader::Create();
-		reflective->LoadShaderPartFromFile("shaders/vertex_shader.glsl", GL_VERTEX_SHADER);
-		reflective->LoadShaderPartFromFile("shaders/frag_blinn_phong_reflection.glsl", GL_FRAGMENT_SHADER);
-		reflective->Link();
+		// Everything opaque that gets drawn forward goes through this first when the depth pre-pass is on. There's nothing
+		// to shade, so it shares the shadow pass's empty fragment shader
+		Shader::sptr depthPrepassShader = AssetManager::GetShader("shaders/depth_prepass.vert.glsl", "shaders/shadow_depth.frag.glsl");
+
+		Shader::sptr reflectiveShader = AssetManager::GetShader("shaders/vertex_shader.glsl", "shaders/frag_reflection.frag.glsl");
+		Shader::sptr reflective = AssetManager::GetShader("shaders/vertex_shader.glsl", "shaders/frag_blinn_phong_reflection.glsl");
+		// Our meshes are all VertexPosNormTexCol (or it's packed copy, which feeds the same slots) drawn with
+		// InstanceTransforms, so the programs that draw them get their inputs checked against that once they've linked
+		std::vector<Shader::sptr> uncheckedShaders = { shader, depthPrepassShader, reflectiveShader, reflective };
 		
 		// 
 		ShaderMaterial::sptr material1 = ShaderMaterial::Create(); 
@@ -533,39 +1621,59 @@ int main() {
 		material1->Set("s_Diffuse2", diffuse2);
 		material1->Set("s_Specular", specular);
 		material1->Set("s_Reflectivity", reflectivity); 
-		material1->Set("s_Environment", environmentMap); 
-		material1->Set("u_LightPos", lightPos);
-		material1->Set("u_LightCol", lightCol);
-		material1->Set("u_AmbientLightStrength", lightAmbientPow); 
-		material1->Set("u_SpecularLightStrength", lightSpecularPow); 
-		material1->Set("u_AmbientCol", ambientCol);
-		material1->Set("u_AmbientStrength", ambientPow);
-		material1->Set("u_LightAttenuationConstant", 1.0f);
-		material1->Set("u_LightAttenuationLinear", lightLinearFalloff);
-		material1->Set("u_LightAttenuationQuadratic", lightQuadraticFalloff);
+		material1->Set("s_Environment", reflectionMap);
+		material1->Set("s_Irradiance", irradianceMap);
 		material1->Set("u_Shininess", 8.0f);
 		material1->Set("u_TextureMix", 0.5f);
 		material1->Set("u_EnvironmentRotation", glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0))));
 		
 		ShaderMaterial::sptr reflectiveMat = ShaderMaterial::Create();
 		reflectiveMat->Shader = reflectiveShader;
-		reflectiveMat->Set("s_Environment", environmentMap);
+		reflectiveMat->Set("s_Environment", reflectionMap);
 		reflectiveMat->Set("u_EnvironmentRotation", glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0))));
 
+		// Scene files refer to materials by name, since they're made here rather than loaded from a file
+		SceneAssets sceneAssets;
+		sceneAssets.Materials = {
+			{ "Ground", materialGround }, { "Dunce", materialDunce }, { "Duncet", materialDuncet }, { "Slide", materialSlide },
+			{ "Swing", materialSwing }, { "Table", materialTable }, { "TreeBig", materialTreeBig },
+			{ "RedBalloon", materialredballoon }, { "YellowBalloon", materialyellowballoon },
+			{ "Blinn", material1 }, { "Reflective", reflectiveMat }
+		};
+		for (auto& material : sceneAssets.Materials) {
+			material.second->DebugName = material.first;
+		}
+
+		// Our meshes are read and parsed on the workers while we set up the rest of the scene, each renderer gets it's
+		// mesh on the main thread once it has been uploaded. We wait for all of them before the first frame
+		std::vector<Task<void>> sceneLoads;
+		auto setMeshAsync = [&sceneLoads](GameObject object, const std::string& path) {
+			sceneLoads.push_back(AssetManager::GetMeshAsync(path).Then([object](VertexArrayObject::sptr& vao) mutable {
+				object.get<RendererComponent>().SetMesh(vao);
+			}, JobThread::Main));
+		};
+
 		GameObject objGround = scene->CreateEntity("Ground"); 
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/Ground.obj");
-			objGround.emplace<RendererComponent>().SetMesh(vao).SetMaterial(materialGround);
+			objGround.emplace<StaticTag>();
+			objGround.emplace<RendererComponent>().SetMaterial(materialGround);
+			setMeshAsync(objGround, "models/Ground.obj");
 			objGround.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
 			objGround.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			objGround.get<Transform>().SetLocalScale(0.5f, 0.25f, 0.5f);
 			BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(objGround);
+
+			// Anything dropped on the ground lands on it's actual triangles, hills and all
+			RigidBody& body = objGround.emplace<RigidBody>();
+			body.Type = RigidBodyType::Static;
+			body.Collider = ColliderType::TriangleMesh;
+			body.Mesh = "models/Ground.obj";
 		}
 
 		GameObject objDunce = scene->CreateEntity("Dunce");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/Dunce.obj");
-			objDunce.emplace<RendererComponent>().SetMesh(vao).SetMaterial(materialDunce);
+			objDunce.emplace<RendererComponent>().SetMaterial(materialDunce);
+			setMeshAsync(objDunce, "models/Dunce.obj");
 			objDunce.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.9f);
 			objDunce.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			objDunce.get<Transform>().SetLocalScale(1.0f, 1.0f, 1.0f);
@@ -574,8 +1682,8 @@ int main() {
 
 		GameObject objDuncet = scene->CreateEntity("Duncet");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/Duncet.obj");
-			objDuncet.emplace<RendererComponent>().SetMesh(vao).SetMaterial(materialDuncet);
+			objDuncet.emplace<RendererComponent>().SetMaterial(materialDuncet);
+			setMeshAsync(objDuncet, "models/Duncet.obj");
 			objDuncet.get<Transform>().SetLocalPosition(2.0f, 0.0f, 0.8f);
 			objDuncet.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			objDuncet.get<Transform>().SetLocalScale(1.0f, 1.0f, 1.0f);
@@ -585,8 +1693,10 @@ int main() {
 
 		GameObject objSlide = scene->CreateEntity("Slide");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/Slide.obj");
-			objSlide.emplace<RendererComponent>().SetMesh(vao).SetMaterial(materialSlide);
+			objSlide.emplace<StaticTag>();
+			// The slide is one of our heaviest meshes, so it only gets drawn if it's bounds weren't hidden last frame
+			objSlide.emplace<RendererComponent>().SetMaterial(materialSlide).SetQueryOcclusion(true);
+			setMeshAsync(objSlide, "models/Slide.obj");
 			objSlide.get<Transform>().SetLocalPosition(0.0f, 5.0f, 3.0f);
 			objSlide.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			objSlide.get<Transform>().SetLocalScale(0.5f, 0.5f, 0.5f);
@@ -595,62 +1705,173 @@ int main() {
 		
 		GameObject objRedBalloon = scene->CreateEntity("Redballoon");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/Balloon.obj");
-			objRedBalloon.emplace<RendererComponent>().SetMesh(vao).SetMaterial(materialredballoon);
+			objRedBalloon.emplace<RendererComponent>().SetMaterial(materialredballoon);
+			setMeshAsync(objRedBalloon, "models/Balloon.obj");
 			objRedBalloon.get<Transform>().SetLocalPosition(2.5f, -10.0f, 3.0f);
 			objRedBalloon.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			objRedBalloon.get<Transform>().SetLocalScale(0.5f, 0.5f, 0.5f);
 			BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(objRedBalloon);
 
-			// Bind returns a smart pointer to the behaviour that was added
-			auto pathing = BehaviourBinding::Bind<FollowPathBehaviour>(objRedBalloon);
-			// Set up a path for the object to follow
-			pathing->Points.push_back({ -2.5f, -10.0f, 3.0f });
-			pathing->Points.push_back({ 2.5f, -10.0f, 3.0f });
-			pathing->Points.push_back({ 2.5f, -5.0f, 3.0f });
-			pathing->Points.push_back({ -2.5f, -5.0f, 3.0f });
-			pathing->Speed = 2.0f;
+			// Path following runs as a fixed rate system, so we just need to give it somewhere to go, and smooth
+			// out it's movement between steps
+			FollowPathComponent& pathing = objRedBalloon.emplace<FollowPathComponent>();
+			objRedBalloon.emplace<InterpolatedTransform>();
+			pathing.Path = PathAsset::Create({
+				{ -2.5f, -10.0f, 3.0f },
+				{ 2.5f, -10.0f, 3.0f },
+				{ 2.5f, -5.0f, 3.0f },
+				{ -2.5f, -5.0f, 3.0f }
+			});
+			pathing.Speed = 2.0f;
+
+			// Confetti that puffs up off the balloon and drifts down behind it, the flakes cover each other so they get sorted
+			ParticleEmitter& confetti = objRedBalloon.emplace<ParticleEmitter>()
+				.SetCapacity(2048, 300.0f)
+				.SetLifetime(2.0f, 3.0f)
+				.SetDirection(glm::vec3(0.0f, 1.0f, 0.0f), 60.0f)
+				.SetSpeed(0.5f, 1.5f)
+				.SetColors(glm::vec4(1.0f, 0.3f, 0.3f, 1.0f), glm::vec4(1.0f, 0.3f, 0.3f, 0.0f))
+				.SetSize(0.08f, 0.06f)
+				.SetBlend(ParticleBlend::Alpha);
+			confetti.Gravity = glm::vec3(0.0f, 0.0f, -1.5f);
+			confetti.Drag = 1.0f;
+			confetti.EmitRadius = 0.3f;
+			confetti.HueVariation = 1.0f;
 		}
 		
 		GameObject objYellowBalloon = scene->CreateEntity("Yellowballoon");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/Balloon.obj");
-			objYellowBalloon.emplace<RendererComponent>().SetMesh(vao).SetMaterial(materialyellowballoon);
+			objYellowBalloon.emplace<RendererComponent>().SetMaterial(materialyellowballoon);
+			setMeshAsync(objYellowBalloon, "models/Balloon.obj");
 			objYellowBalloon.get<Transform>().SetLocalPosition(-2.5f, -10.0f, 3.0f);
 			objYellowBalloon.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			objYellowBalloon.get<Transform>().SetLocalScale(0.5f, 0.5f, 0.5f);
 			BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(objYellowBalloon);
 
-			// Bind returns a smart pointer to the behaviour that was added
-			auto pathing = BehaviourBinding::Bind<FollowPathBehaviour>(objYellowBalloon);
-			// Set up a path for the object to follow
-			pathing->Points.push_back({ 2.5f, -10.0f, 3.0f });
-			pathing->Points.push_back({ -2.5f, -10.0f, 3.0f });
-			pathing->Points.push_back({ -2.5f,  -5.0f, 3.0f });
-			pathing->Points.push_back({ 2.5f,  -5.0f, 3.0f });
-			pathing->Speed = 2.0f;
+			// Path following runs as a fixed rate system, so we just need to give it somewhere to go, and smooth
+			// out it's movement between steps
+			FollowPathComponent& pathing = objYellowBalloon.emplace<FollowPathComponent>();
+			objYellowBalloon.emplace<InterpolatedTransform>();
+			pathing.Path = PathAsset::Create({
+				{ 2.5f, -10.0f, 3.0f },
+				{ -2.5f, -10.0f, 3.0f },
+				{ -2.5f,  -5.0f, 3.0f },
+				{ 2.5f,  -5.0f, 3.0f }
+			});
+			pathing.Speed = 2.0f;
+
+			// Confetti that puffs up off the balloon and drifts down behind it, the flakes cover each other so they get sorted
+			ParticleEmitter& confetti = objYellowBalloon.emplace<ParticleEmitter>()
+				.SetCapacity(2048, 300.0f)
+				.SetLifetime(2.0f, 3.0f)
+				.SetDirection(glm::vec3(0.0f, 1.0f, 0.0f), 60.0f)
+				.SetSpeed(0.5f, 1.5f)
+				.SetColors(glm::vec4(1.0f, 0.9f, 0.3f, 1.0f), glm::vec4(1.0f, 0.9f, 0.3f, 0.0f))
+				.SetSize(0.08f, 0.06f)
+				.SetBlend(ParticleBlend::Alpha);
+			confetti.Gravity = glm::vec3(0.0f, 0.0f, -1.5f);
+			confetti.Drag = 1.0f;
+			confetti.EmitRadius = 0.3f;
+			confetti.HueVariation = 1.0f;
 		}
 		
-		//Taken from week 3 tutorial because I wanted random trees from our game
-		std::vector<GameObject> randomTrees;
+		// The trees only differ by where they are, so they're scattered over the ground (around the Dunces) without an
+		// entity for each one. They get generated once the mesh has loaded and the material is ready
+		GameObject objTrees = scene->CreateEntity("Trees");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/TreeBig.obj");
-			for (int i = 0; i < NUM_TREES / 2; i++)
-			{
-				randomTrees.push_back(scene->CreateEntity("simplePine" + (std::to_string(i + 1))));
-				randomTrees[i].emplace<RendererComponent>().SetMesh(vao).SetMaterial(materialTreeBig);
-				//Randomly places
-				randomTrees[i].get<Transform>().SetLocalPosition(glm::vec3(Util::GetRandomNumberBetween(glm::vec2(-PLANE_X, -PLANE_Y), glm::vec2(PLANE_X, PLANE_Y), glm::vec2(-DNS_X, -DNS_Y), glm::vec2(DNS_X, DNS_Y)), 6.0f));
-				randomTrees[i].get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
-				randomTrees[i].get<Transform>().SetLocalScale(0.5f, 0.5f, 0.5f);
+			ScatterComponent& scatter = objTrees.emplace<ScatterComponent>();
+			scatter.SetMaterial(materialTreeBig);
+			scatter.SetRegion(glm::vec2(-PLANE_X, -PLANE_Y), glm::vec2(PLANE_X, PLANE_Y), 6.0f);
+			scatter.AddExclusion(glm::vec2(-DNS_X, -DNS_Y), glm::vec2(DNS_X, DNS_Y));
+			scatter.SetSpacing(TREE_SPACING);
+			scatter.Seed = sessionSeed;
+			scatter.Rotation = glm::quat(glm::radians(glm::vec3(90.0f, 0.0f, 0.0f)));
+			scatter.ScaleRange = glm::vec2(0.45f, 0.55f);
+			sceneLoads.push_back(AssetManager::GetMeshAsync("models/TreeBig.obj").Then([objTrees](VertexArrayObject::sptr& vao) mutable {
+				objTrees.get<ScatterComponent>().SetMesh(vao);
+			}, JobThread::Main));
+		}
+
+		// Rolling hills out to the horizon around the playground. The heights are flat (just under the ground) over the
+		// ground's footprint, and blend up into a few octaves of noise outside of it
+		GameObject objTerrain = scene->CreateEntity("Terrain");
+		{
+			const uint32_t samples = 513;
+			const glm::vec2 regionMin(-128.0f);
+			const float regionSize = 256.0f;
+			const glm::vec2 flatExtents(24.0f, 35.0f);
+			std::vector<uint16_t> heights(static_cast<size_t>(samples) * samples);
+			for (uint32_t y = 0; y < samples; y++) {
+				for (uint32_t x = 0; x < samples; x++) {
+					const glm::vec2 position = regionMin + glm::vec2(x, y) * (regionSize / (samples - 1));
+					float noise = 0.0f;
+					float amplitude = 0.5f;
+					float frequency = 0.01f;
+					for (int octave = 0; octave < 5; octave++) {
+						noise += glm::simplex(position * frequency) * amplitude;
+						amplitude *= 0.5f;
+						frequency *= 2.0f;
+					}
+					const float outside = glm::length(glm::max(glm::abs(position) - flatExtents, glm::vec2(0.0f)));
+					const float height = glm::clamp(noise * 0.5f + 0.5f, 0.0f, 1.0f) * glm::smoothstep(0.0f, 30.0f, outside);
+					heights[y * samples + x] = static_cast<uint16_t>(height * 65535.0f);
+				}
 			}
+			TerrainComponent& terrain = objTerrain.emplace<TerrainComponent>();
+			terrain.SetMaterial(materialTerrain);
+			terrain.SetRegion(regionMin, regionSize);
+			terrain.SetHeightRange(-0.05f, 24.0f);
+			terrain.SetHeights(samples, samples, std::move(heights));
+		}
+
+		// A fountain of a couple hundred thousand glowing droplets, added together so they never need sorting
+		GameObject objFountain = scene->CreateEntity("Fountain");
+		{
+			objFountain.get<Transform>().SetLocalPosition(8.0f, -8.0f, 0.0f);
+			ParticleEmitter& fountain = objFountain.emplace<ParticleEmitter>()
+				.SetCapacity(262144, 60000.0f)
+				.SetLifetime(2.5f, 4.0f)
+				.SetDirection(glm::vec3(0.0f, 0.0f, 1.0f), 8.0f)
+				.SetSpeed(6.0f, 8.0f)
+				.SetColors(glm::vec4(0.3f, 0.6f, 1.0f, 0.6f), glm::vec4(0.1f, 0.2f, 0.6f, 0.0f))
+				.SetSize(0.05f, 0.03f);
+			fountain.EmitRadius = 0.1f;
+			fountain.HueVariation = 0.1f;
 		}
 
 		GameObject objSwing = scene->CreateEntity("Swing");
 		{
-			// Build a mesh
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/Swing.obj");
-			objSwing.emplace<RendererComponent>().SetMesh(vao).SetMaterial(materialSwing);
+			// The animation lives in the mesh's own space, so the swing can't be merged into a static batch
+			objSwing.emplace<RendererComponent>().SetMaterial(materialSwing).SetQueryOcclusion(true);
+			sceneLoads.push_back(ThreadPool::Instance().Schedule([]() {
+				MeshBuilder<VertexPosNormTexCol> mesh;
+				ObjLoader::ParseFile("models/Swing.obj", mesh);
+				return mesh;
+			}).Then([objSwing, materialSwing, &sceneAssets](MeshBuilder<VertexPosNormTexCol>& mesh) mutable {
+				// The seats and chains hang between the legs (which are past 5 units along Z) and below the bar, and
+				// swing around the bar's middle. The mesh is Y up, with the bar along Z
+				const glm::vec3 pivot(-0.03f, 2.83f, 0.0f);
+				const float duration = 2.5f;
+				VertexAnimationTexture::sptr animation = VertexAnimationTexture::Bake(mesh, 48, duration,
+					[&](float time, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) {
+						const float angle = glm::radians(25.0f) * glm::sin(time / duration * glm::two_pi<float>());
+						const glm::mat3 rotation = glm::mat3(glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 0.0f, 1.0f)));
+						for (size_t ix = 0; ix < positions.size(); ix++) {
+							if (glm::abs(positions[ix].z) < 5.0f && positions[ix].y < 2.55f) {
+								positions[ix] = pivot + rotation * (positions[ix] - pivot);
+								normals[ix] = rotation * normals[ix];
+							}
+						}
+					});
+				if (animation != nullptr) {
+					animation->Apply(materialSwing);
+					objSwing.get<RendererComponent>().SetMesh(animation->GetMesh());
+					// The baked mesh didn't come from the AssetManager, so scenes refer to it by name
+					sceneAssets.Meshes["AnimatedSwing"] = animation->GetMesh();
+				} else {
+					objSwing.get<RendererComponent>().SetMesh(mesh.Bake<VertexPackedPosNormTexCol>());
+				}
+			}, JobThread::Main));
 			objSwing.get<Transform>().SetLocalPosition(-5.0f, 0.0f, 3.5f);
 			objSwing.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			objSwing.get<Transform>().SetLocalScale(0.5f, 0.5f, 0.5f);
@@ -659,17 +1880,18 @@ int main() {
 			// Bind returns a smart pointer to the behaviour that was added
 			/*auto pathing = BehaviourBinding::Bind<FollowPathBehaviour>(obj4);
 			// Set up a path for the object to follow
-			pathing->Points.push_back({ -4.0f, -4.0f, 0.0f });
-			pathing->Points.push_back({ 4.0f, -4.0f, 0.0f });
-			pathing->Points.push_back({ 4.0f,  4.0f, 0.0f });
-			pathing->Points.push_back({ -4.0f,  4.0f, 0.0f });
-			pathing->Speed = 2.0f;*/
+			pathing.Points.push_back({ -4.0f, -4.0f, 0.0f });
+			pathing.Points.push_back({ 4.0f, -4.0f, 0.0f });
+			pathing.Points.push_back({ 4.0f,  4.0f, 0.0f });
+			pathing.Points.push_back({ -4.0f,  4.0f, 0.0f });
+			pathing.Speed = 2.0f;*/
 		}
 
 		GameObject objTable = scene->CreateEntity("table");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/Table.obj");
-			objTable.emplace<RendererComponent>().SetMesh(vao).SetMaterial(materialTable);
+			objTable.emplace<StaticTag>();
+			objTable.emplace<RendererComponent>().SetMaterial(materialTable);
+			setMeshAsync(objTable, "models/Table.obj");
 			objTable.get<Transform>().SetLocalPosition(5.0f, 0.0f, 1.25f);
 			objTable.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			objTable.get<Transform>().SetLocalScale(0.35f, 0.35f, 0.35f);
@@ -677,9 +1899,9 @@ int main() {
 			
 			/*auto pathing = BehaviourBinding::Bind<FollowPathBehaviour>(obj6);
 			// Set up a path for the object to follow
-			pathing->Points.push_back({ 0.0f, 0.0f, 1.0f });
-			pathing->Points.push_back({ 0.0f, 0.0f, 3.0f });
-			pathing->Speed = 2.0f;*/
+			pathing.Points.push_back({ 0.0f, 0.0f, 1.0f });
+			pathing.Points.push_back({ 0.0f, 0.0f, 3.0f });
+			pathing.Speed = 2.0f;*/
 		}
 		
 		// Create an object to be our camera
@@ -695,34 +1917,121 @@ int main() {
 			camera.SetFovDegrees(90.0f); // Set an initial FOV
 			camera.SetOrthoHeight(3.0f);
 			BehaviourBinding::Bind<CameraControlBehaviour>(cameraObject);
+			// We hear the scene from wherever we're looking at it from
+			cameraObject.emplace<AudioListener>();
+
+			// Benchmarks take the camera out of the user's hands and fly it along the scenario's path instead
+			if (benchmark != nullptr) {
+				BehaviourBinding::Get<CameraControlBehaviour>(cameraObject)->Enabled = false;
+				cameraObject.get<Transform>().SetLocalPosition(benchmark->Path[0]).LookAt(benchmark->Target);
+				FollowPathComponent& pathing = cameraObject.emplace<FollowPathComponent>();
+				pathing.Path = PathAsset::Create(benchmark->Path);
+				pathing.Speed = benchmark->Speed;
+			}
+		}
+
+		// A couple of fixed cameras for the extra views, these get drawn alongside the main one when turned on
+		for (const auto& [name, position] : { std::make_pair("Overhead Camera", glm::vec3(0.0f, -12.0f, 14.0f)), std::make_pair("Side Camera", glm::vec3(14.0f, 4.0f, 3.0f)) }) {
+			GameObject viewObject = scene->CreateEntity(name);
+			viewObject.get<Transform>().SetLocalPosition(position).LookAt(glm::vec3(0.0f));
+			Camera& viewCamera = viewObject.emplace<Camera>();
+			viewCamera.SetFovDegrees(70.0f);
+			extraViews.push_back({ name, viewObject, ViewTarget::Create(), 0 });
+		}
+
+		// Create our main light, it hangs over the middle of the scene (if made into a spot light, it points straight down)
+		GameObject lightObject = scene->CreateEntity("Light");
+		{
+			lightObject.get<Transform>().SetLocalPosition(0.0f, 0.0f, 2.0f);
+			Light& light = lightObject.emplace<Light>();
+			light.Color = glm::vec3(0.9f, 0.85f, 0.5f);
+			light.AmbientStrength = 0.7f;
+			light.SpecularStrength = 1.0f;
+			light.AttenuationLinear = 0.009f;
+			light.AttenuationQuadratic = 0.032f;
+			light.CastShadows = true;
+		}
+
+		// A dim moon over the whole scene, to show off the cascades
+		GameObject moonObject = scene->CreateEntity("Moon");
+		{
+			moonObject.get<Transform>().SetLocalPosition(0.0f, 0.0f, 10.0f).LookAt(glm::vec3(-3.0f, -2.0f, 0.0f));
+			Light& moon = moonObject.emplace<Light>();
+			moon.Type = LightType::Directional;
+			moon.Color = glm::vec3(0.15f, 0.18f, 0.3f);
+			moon.SpecularStrength = 0.25f;
+			moon.CastShadows = true;
 		}
 
+		// The lights can't be touched while a snapshot is being built, so the UI edits a copy of the main light, which
+		// gets written back (along with any lamps we've asked for) once the build is done
+		Light     lightEdit = lightObject.get<Light>();
+		glm::vec3 lightEditPos = lightObject.get<Transform>().GetLocalPosition();
+		bool      isLightEdited = false;
+		int       lampsToScatter = 0;
+		imGuiCallbacks.push_back([&]() {
+			if (ImGui::CollapsingHeader("Light Level Lighting Settings"))
+			{
+				int type = static_cast<int>(lightEdit.Type);
+				if (ImGui::Combo("Light Type", &type, "Point\0Spot\0Directional\0")) {
+					lightEdit.Type = static_cast<LightType>(type);
+					isLightEdited = true;
+				}
+				isLightEdited |= ImGui::DragFloat3("Light Pos", glm::value_ptr(lightEditPos), 0.01f, -10.0f, 10.0f);
+				isLightEdited |= ImGui::ColorPicker3("Light Col", glm::value_ptr(lightEdit.Color));
+				isLightEdited |= ImGui::SliderFloat("Light Ambient Power", &lightEdit.AmbientStrength, 0.0f, 1.0f);
+				isLightEdited |= ImGui::SliderFloat("Light Specular Power", &lightEdit.SpecularStrength, 0.0f, 1.0f);
+				isLightEdited |= ImGui::DragFloat("Light Linear Falloff", &lightEdit.AttenuationLinear, 0.01f, 0.0f, 1.0f);
+				isLightEdited |= ImGui::DragFloat("Light Quadratic Falloff", &lightEdit.AttenuationQuadratic, 0.01f, 0.0f, 1.0f);
+				if (lightEdit.Type == LightType::Spot) {
+					isLightEdited |= ImGui::SliderFloat("Spot Inner Angle", &lightEdit.InnerAngle, 0.0f, 90.0f);
+					isLightEdited |= ImGui::SliderFloat("Spot Outer Angle", &lightEdit.OuterAngle, 0.0f, 90.0f);
+				}
+				isLightEdited |= ImGui::Checkbox("Light Casts Shadows", &lightEdit.CastShadows);
+				ImGui::Text("Light range: %.2f", lightEdit.GetRange());
+				// Our night scenes have hundreds of lamps, this lets us see how the clustering copes with that many
+				if (ImGui::Button("Scatter 100 lamps")) {
+					lampsToScatter += 100;
+				}
+			}
+			if (lightmapper != nullptr && ImGui::CollapsingHeader("Lightmaps"))
+			{
+				// The static geometry's lighting is baked, so it needs baking again to pick up changes to the lights
+				bool useLightmaps = lightmapper->IsEnabled();
+				if (ImGui::Checkbox("Use lightmaps", &useLightmaps)) {
+					lightmapper->SetEnabled(*scene, useLightmaps);
+				}
+				if (lightmapper->IsBaking()) {
+					ImGui::Text("Baking...");
+				} else if (ImGui::Button("Rebake lightmaps")) {
+					lightmapper->Bake(*scene, litMaterials, lightmappedShader, Lightmapper::Settings());
+				}
+				const Lightmapper::Stats& lightmapStats = lightmapper->GetStats();
+				ImGui::Text("Atlas: %dx%d Receivers: %d Charts: %d", lightmapStats.Width, lightmapStats.Height, lightmapStats.Receivers, lightmapStats.Charts);
+				ImGui::Text("Texels per unit: %.2f Baked in %.1f ms", lightmapStats.TexelsPerUnit, lightmapStats.Milliseconds);
+			}
+			if (virtualGround != nullptr && ImGui::CollapsingHeader("Virtual Texture"))
+			{
+				// Turning it off goes back to the tiled grass, the cache keeps it's pages for when it's turned back on
+				if (ImGui::Checkbox("Virtual ground", &useVirtualGround)) {
+					terrainFeatures = useVirtualGround ? VirtualDiffuse : 0;
+					selectLightingMode(lightingFeatures);
+				}
+				const VirtualTexture::Stats& virtualStats = virtualGround->GetStats();
+				ImGui::Text("Size: %dx%d Levels: %d", virtualGround->GetSize(), virtualGround->GetSize(), virtualGround->GetLevelCount());
+				ImGui::Text("Resident pages: %d / %d Requested: %d", virtualStats.Resident, virtualStats.Capacity, virtualStats.Requested);
+				ImGui::Text("Loading: %d Uploaded: %d Evicted: %d", virtualStats.Loading, virtualStats.Uploaded, virtualStats.Evicted);
+			}
+		});
+
 		#pragma endregion 
 		//////////////////////////////////////////////////////////////////////////////////////////
 
 		/////////////////////////////////// SKYBOX ///////////////////////////////////////////////
-		{
-			// Load our shaders
-			Shader::sptr skybox = std::make_shared<Shader>();
-			skybox->LoadShaderPartFromFile("shaders/skybox-shader.vert.glsl", GL_VERTEX_SHADER);
-			skybox->LoadShaderPartFromFile("shaders/skybox-shader.frag.glsl", GL_FRAGMENT_SHADER);
-			skybox->Link();
-
-			ShaderMaterial::sptr skyboxMat = ShaderMaterial::Create();
-			skyboxMat->Shader = skybox;  
-			skyboxMat->Set("s_Environment", environmentMap);
-			skyboxMat->Set("u_EnvironmentRotation", glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0))));
-			skyboxMat->RenderLayer = 100;
-
-			MeshBuilder<VertexPosNormTexCol> mesh;
-			MeshFactory::AddIcoSphere(mesh, glm::vec3(0.0f), 1.0f);
-			MeshFactory::InvertFaces(mesh);
-			VertexArrayObject::sptr meshVao = mesh.Bake();
-			
-			GameObject skyboxObj = scene->CreateEntity("skybox");  
-			skyboxObj.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
-			skyboxObj.get_or_emplace<RendererComponent>().SetMesh(meshVao).SetMaterial(skyboxMat);
-		}
+		StartupReport::BeginStage("Create render passes");
+		// The sky gets it's own pass after the opaque scene, rather than being a renderer, so it only shades what's
+		// left uncovered. Our cube maps are Y up, so we turn them to match our Z up world
+		skyboxPass = SkyboxPass::Create(environmentMap, glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0))));
 		////////////////////////////////////////////////////////////////////////////////////////
 
 
@@ -735,6 +2044,23 @@ int main() {
 			// use std::bind
 			keyToggles.emplace_back(GLFW_KEY_T, [&]() { cameraObject.get<Camera>().ToggleOrtho(); });
 
+			// Capture the next few frames to a trace file we can open in chrome://tracing or Perfetto
+			keyToggles.emplace_back(GLFW_KEY_F9, [&]() {
+				std::string path = "trace_" + std::to_string(static_cast<long long>(std::time(nullptr))) + ".json";
+				TraceRecorder::Instance().StartCapture(TRACE_FRAME_COUNT, path);
+			});
+			// Save a screenshot, or start and stop recording every frame as raw images
+			keyToggles.emplace_back(GLFW_KEY_F12, [&]() {
+				frameCapture->RequestScreenshot("screenshot_" + std::to_string(static_cast<long long>(std::time(nullptr))) + ".png");
+			});
+			keyToggles.emplace_back(GLFW_KEY_F10, [&]() {
+				if (frameCapture->IsRecording()) {
+					frameCapture->StopRecording();
+				} else {
+					frameCapture->StartRecording("capture_" + std::to_string(static_cast<long long>(std::time(nullptr))));
+				}
+			});
+
 			controllables.push_back(objDunce);
 			controllables.push_back(objDuncet);
 
@@ -757,23 +2083,342 @@ int main() {
 				auto behaviour = BehaviourBinding::Get<SimpleMoveBehaviour>(controllables[selectedVao]);
 				behaviour->Relative = !behaviour->Relative;
 				});
+
+			// Drops a balloon over the middle of the playground, the physics world takes it from there
+			keyToggles.emplace_back(GLFW_KEY_B, [&]() {
+				GameObject balloon = scene->CreateEntity("DroppedBalloon");
+				balloon.emplace<RendererComponent>().SetMaterial(materialredballoon).SetMesh(AssetManager::GetMesh("models/Balloon.obj"));
+				balloon.get<Transform>().SetLocalPosition(glm::linearRand(-2.0f, 2.0f), glm::linearRand(-9.0f, -5.0f), 8.0f);
+				balloon.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
+				balloon.get<Transform>().SetLocalScale(0.5f, 0.5f, 0.5f);
+				balloon.emplace<InterpolatedTransform>();
+				RigidBody& body = balloon.emplace<RigidBody>();
+				body.Collider = ColliderType::Sphere;
+				body.Radius = 1.2f;
+				body.Restitution = 0.6f;
+				});
 		}
 		
+		// The frame level uniforms are shared by every shader, so we bind the buffer once and update it once per frame
+		UniformBuffer<FrameData>::sptr frameUniforms = UniformBuffer<FrameData>::Create();
+		frameUniforms->Bind(FRAME_DATA_BINDING);
+
+		// Per instance model and normal matrices for the whole frame get written straight into this buffer by the
+		// snapshot builder, with a region for each frame in flight
+		InstanceStream::sptr instanceStream = InstanceStream::Create(sizeof(InstanceTransform));
+		// One snapshot gets built from the scene while the other one is drawn, then they trade places
+		RenderSnapshot snapshots[2];
+		int buildingSnapshot = 0;
+		bool hasSnapshot = false;
+
+		// When using multi-draw indirect, each batch becomes a command, and runs of commands sharing a material get drawn together
+		IndirectBuffer::sptr indirectBuffer = IndirectBuffer::Create();
+		std::vector<DrawElementsIndirectCommand> indirectCommands;
+		std::vector<IndirectRun> indirectRuns;
+		// The extra views' opaque, weighted and blended draws, three lists to a view. Kept between frames so recording
+		// doesn't need to allocate once they've warmed up
+		std::vector<CommandList::sptr> extraViewCommands;
+		// Big meshes that were split into meshlets get culled cluster by cluster on the GPU before they're drawn
+		meshletCuller = MeshletCuller::Create();
+		// As do the scatters' instances, which also get their levels of detail picked there
+		instanceCuller = InstanceCuller::Create();
+		// Along with the opaque renderers, which draw out of records that only get written when they change
+		renderRecords = RenderRecords::Create();
+		depthPyramid = DepthPyramid::Create();
+		// Nothing is occluded until the first frame that works it out
+		ambientOcclusion = AmbientOcclusion::Create();
+		ambientOcclusion->Unbind();
+		occlusionQueries = OcclusionQueries::Create();
+		frameCapture = FrameCapture::Create();
+		// Lights get binned into clusters of the view, so each fragment only shades the lights near it
+		clusteredLighting = ClusteredLighting::Create();
+		shadowMaps = ShadowMaps::Create();
+		gpuPicker = GpuPicker::Create();
+		deferredShading = DeferredShading::Create();
+		// Without the composite the blended materials go back to being sorted
+		weightedBlending = WeightedBlending::Create();
+		if (!weightedBlending->IsReady()) {
+			useWeightedBlending = false;
+			selectLightingMode(lightingFeatures);
+		}
+		particleSystem = ParticleSystem::Create();
+		postProcessing = PostProcessing::Create();
+		dynamicResolution = DynamicResolution::Create();
+
+		StartupReport::BeginStage("Init ImGui");
 		InitImGui();
+		uiCache = UiCache::Create();
+		// Goes after ImGui, so every event still gets passed on to it. A hidden window never gets any input to wake it
+		PowerMode::Install(window);
+		PowerMode::Enabled = isPowerSaving && !isHeadless;
+		// Files in a mounted archive are read from the archive, so editing the loose copies won't change anything
+		FileWatcher::sptr assetWatcher = isHotReloading ? FileWatcher::Create({ "shaders", "images", "models" }) : nullptr;
+		// Input gets queued up by GLFW's callbacks, this goes after ImGui so that ImGui still sees every event too
+		TTK::Input::Init(window);
+
+		// Everything else is set up, so all that's left is to help the workers finish off our meshes
+		StartupReport::BeginStage("Finish meshes");
+		for (const Task<void>& load : sceneLoads) {
+			ThreadPool::Instance().Wait(load);
+		}
+		prefetchedMeshes.clear();
+
+		if (stress.EntityCount > 0) {
+			StartupReport::BeginStage("Build stress scene");
+			std::vector<VertexArrayObject::sptr> stressMeshes;
+			for (uint32_t ix = 0; ix < stress.UniqueMeshes; ix++) {
+				stressMeshes.push_back(AssetManager::GetMesh(StressScene::MESH_PATHS[ix]));
+			}
+			StressScene::Build(*scene, stress, stressMeshes, stressMaterials);
+			// So runs at different scales can be charted against each other
+			Benchmark::SetParameter("stress_entities", stress.EntityCount);
+			Benchmark::SetParameter("stress_meshes", stress.UniqueMeshes);
+			Benchmark::SetParameter("stress_materials", stress.UniqueMaterials);
+			Benchmark::SetParameter("stress_depth", stress.HierarchyDepth);
+			Benchmark::SetParameter("stress_moving", stress.MovingFraction);
+			Benchmark::SetParameter("stress_lights", stress.LightCount);
+		}
+
+		// The trees' impostor gets baked once the G-buffer variant has compiled and the diffuse array has finished
+		// loading, so the views don't capture the placeholder textures. Until then the trees are always drawn as meshes
+		Impostor::sptr treeImpostor = nullptr;
+		bool hasBakedImpostors = false;
+		const Shader::sptr impostorBakeShader = lightingVariants->GetAsync(GBuffer | DiffuseArray);
+		auto pollImpostors = [&]() {
+			if (!hasBakedImpostors) {
+				VertexArrayObject::sptr treeMesh = nullptr;
+				scene->Registry().view<ScatterComponent>().each([&](ScatterComponent& scatter) {
+					if (scatter.Material == materialTreeBig && scatter.Mesh != nullptr) {
+						treeMesh = scatter.Mesh;
+					}
+				});
+				if (treeMesh == nullptr || !impostorBakeShader->IsReady() || TextureLoader::GetPendingCount() > 0) {
+					return;
+				}
+				hasBakedImpostors = true;
+				treeImpostor = Impostor::Bake(treeMesh, materialTreeBig, impostorBakeShader, impostorShader);
+				if (treeImpostor == nullptr) {
+					return;
+				}
+				impostorMaterials.push_back(treeImpostor->GetMaterial());
+				scene->Registry().view<ScatterComponent>().each([&](ScatterComponent& scatter) {
+					if (scatter.Material == materialTreeBig) {
+						scatter.Billboard = treeImpostor;
+					}
+				});
+				scene->Registry().view<RendererComponent>().each([&](RendererComponent& renderer) {
+					if (renderer.Material == materialTreeBig) {
+						renderer.Billboard = treeImpostor;
+					}
+				});
+			}
+			if (treeImpostor == nullptr) {
+				return;
+			}
+			const float fadeEnd = impostorDistance + impostorFadeWidth;
+			if (treeImpostor->GetFadeStart() != impostorDistance || treeImpostor->GetFadeEnd() != fadeEnd) {
+				treeImpostor->SetFadeRange(impostorDistance, fadeEnd);
+			}
+		};
+		// --save-scene [file] writes out the scene we just built, --load-scene [file] swaps it for one saved earlier
+		for (int ix = 1; ix + 1 < argc; ix++) {
+			const std::string arg = argv[ix];
+			if (arg == "--save-scene") {
+				const std::string path = argv[ix + 1];
+				SceneSerializer::Save(*scene, path, sceneAssets, path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0 ? SceneFormat::Json : SceneFormat::Binary);
+				LOG_INFO("Saved scene to {}", path);
+			} else if (arg == "--load-scene") {
+				const double start = glfwGetTime();
+				SceneSerializer::Load(*scene, argv[ix + 1], sceneAssets);
+				LOG_INFO("Loaded scene from {} in {:.2f}ms", argv[ix + 1], (glfwGetTime() - start) * 1000.0);
+				cameraObject = scene->FindFirst("Camera");
+				LOG_ASSERT(cameraObject.entity() != entt::null, "Scene file has no camera!");
+				// The extra views' cameras get found again by name, any the scene doesn't have are dropped
+				for (ExtraView& view : extraViews) {
+					view.Object = scene->FindFirst(view.Name);
+				}
+				extraViews.erase(std::remove_if(extraViews.begin(), extraViews.end(), [](const ExtraView& view) {
+					return view.Object.entity() == entt::null || !view.Object.has<Camera>();
+				}), extraViews.end());
+				// Older scene files were saved before lights were components, so they might not have one
+				lightObject = scene->FindFirst("Light");
+				if (lightObject.entity() != entt::null && lightObject.has<Light>()) {
+					lightEdit = lightObject.get<Light>();
+					lightEditPos = lightObject.get<Transform>().GetLocalPosition();
+				}
+			}
+		}
+		// --partition-world [folder] moves the scenery out into cells in the folder, --stream-world [folder] streams
+		// the cells of a partitioned world back in around the camera as it moves
+		StartupReport::BeginStage("Create world");
+		world = WorldPartition::Create(*scene, sceneAssets);
+		physics = PhysicsWorld::Create(*scene);
+		// Audio updates on a thread of it's own, and every bank in the audio folder loads in the background
+		audio = AudioEngine::Create();
+		if (audio->Init()) {
+			// The update thread gets a core of it's own when there's one to spare, so a busy frame can't starve it
+			const int audioCore = ThreadPool::Instance().GetReservedCore(ThreadPool::ReservedCore::Audio);
+			if (audioCore != -1 && !CpuTopology::PinThread(audio->GetUpdateThread(), static_cast<uint32_t>(audioCore))) {
+				LOG_WARN("Failed to pin the audio thread to it's core");
+			}
+			std::error_code error;
+			for (const auto& entry : std::filesystem::directory_iterator("audio", error)) {
+				if (entry.is_regular_file() && entry.path().extension() == ".bank") {
+					audio->LoadBank(entry.path().string());
+				}
+			}
+		}
+		sceneAudio = SceneAudio::Create(*scene, audio);
+		for (int ix = 1; ix + 1 < argc; ix++) {
+			const std::string arg = argv[ix];
+			if (arg == "--partition-world") {
+				const uint32_t cells = WorldPartition::Partition(*scene, argv[ix + 1], WORLD_CELL_SIZE, sceneAssets);
+				LOG_INFO("Partitioned the scenery into {} cells in {}", cells, argv[ix + 1]);
+			} else if (arg == "--stream-world") {
+				world->Open(argv[ix + 1]);
+			}
+		}
+		// With every mesh in place, the scenery that never moves can be merged into a few big meshes
+		StartupReport::BeginStage("Bake static batches");
+		staticStats = StaticBatcher::Bake(*scene);
+		// Then their lighting gets baked on the workers, they're lit in real time until it's done
+		StartupReport::BeginStage("Start lightmap bake");
+		lightmapper = Lightmapper::Create();
+		lightmapper->Bake(*scene, litMaterials, lightmappedShader, Lightmapper::Settings());
+		// The copies of the materials that draw with the lightmap follow the lighting mode like the originals
+		auto pollLightmaps = [&]() {
+			if (lightmapper->Poll(*scene)) {
+				lightmappedMaterials = lightmapper->GetMaterials();
+				for (const ShaderMaterial::sptr& material : lightmappedMaterials) {
+					material->SetShader(lightmappedShader);
+				}
+			}
+		};
+		// Benchmarks wait for the bake, so every frame they measure draws the same way
+		if (benchmark != nullptr) {
+			lightmapper->Wait();
+			pollLightmaps();
+		}
+		// The terrain's ground is a unique virtual texture rather than the tiled grass. It gets cooked from the grass the
+		// first time we run, tinted by noise so no two stretches of ground look the same, and swapped in once it's ready
+		StartupReport::BeginStage("Start virtual texture cook");
+		const std::string virtualGroundPath = "images/terrain_ground.vtex";
+		const glm::vec2 virtualRegionMin = objTerrain.get<TerrainComponent>().RegionMin;
+		const float virtualRegionSize = objTerrain.get<TerrainComponent>().Size;
+		const float virtualRepeats = virtualRegionSize * objTerrain.get<TerrainComponent>().TextureTiling;
+		Task<bool> virtualGroundCook = std::filesystem::exists(virtualGroundPath) ? Task<bool>::FromValue(true) :
+			ThreadPool::Instance().Schedule([virtualGroundPath, virtualRegionMin, virtualRegionSize, virtualRepeats]() {
+				Texture2DData::sptr grass = Texture2DData::LoadFromFile("images/grass.jpg", true);
+				MipChainData::sptr grassMips = grass != nullptr ? TextureCook::GenerateMips(grass) : nullptr;
+				if (grassMips == nullptr) {
+					return false;
+				}
+				return VirtualTexture::Cook(virtualGroundPath, VIRTUAL_GROUND_SIZE, [&](uint32_t level, int32_t x, int32_t y, uint32_t width, uint32_t height, uint8_t* pixels) {
+					// The grass comes from whichever of it's levels has about as many texels per repeat as this level
+					const int32_t levelSize = static_cast<int32_t>(VIRTUAL_GROUND_SIZE >> level);
+					uint32_t grassLevel = 0;
+					while (grassLevel + 1 < grassMips->GetLevelCount() && grassMips->GetLevel(grassLevel).Width > levelSize / virtualRepeats) {
+						grassLevel++;
+					}
+					const MipChainData::MipLevel& mip = grassMips->GetLevel(grassLevel);
+					const uint8_t* grassPixels = static_cast<const uint8_t*>(grassMips->GetLevelData(grassLevel));
+					for (uint32_t row = 0; row < height; row++) {
+						for (uint32_t column = 0; column < width; column++) {
+							// The borders past the edges repeat the edge texels
+							const glm::ivec2 texel = glm::clamp(glm::ivec2(x + column, y + row), glm::ivec2(0), glm::ivec2(levelSize - 1));
+							const glm::vec2 uv = (glm::vec2(texel) + 0.5f) / static_cast<float>(levelSize);
+							const glm::vec2 world = virtualRegionMin + uv * virtualRegionSize;
+							const glm::uvec2 grassTexel = glm::min(glm::uvec2(glm::fract(uv * virtualRepeats) * glm::vec2(mip.Width, mip.Height)), glm::uvec2(mip.Width - 1, mip.Height - 1));
+							const uint8_t* source = grassPixels + (static_cast<size_t>(grassTexel.y) * mip.Width + grassTexel.x) * 4;
+							// Broad patches of drier grass, with bare dirt where they're driest
+							const float dryness = glm::simplex(world * 0.015f) * 0.35f + glm::simplex(world * 0.06f) * 0.15f + 0.5f;
+							const float dirt = glm::smoothstep(0.7f, 0.85f, dryness + glm::simplex(world * 0.25f) * 0.05f);
+							glm::vec3 color = glm::vec3(source[0], source[1], source[2]) / 255.0f;
+							color *= glm::mix(glm::vec3(0.9f, 1.0f, 0.9f), glm::vec3(1.2f, 1.05f, 0.65f), glm::clamp(dryness, 0.0f, 1.0f));
+							color = glm::mix(color, glm::vec3(0.42f, 0.33f, 0.24f) * (0.75f + color.g * 0.5f), dirt);
+							uint8_t* target = pixels + (static_cast<size_t>(row) * width + column) * 4;
+							const glm::u8vec3 result(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+							target[0] = result.r;
+							target[1] = result.g;
+							target[2] = result.b;
+							target[3] = 255;
+						}
+					}
+				});
+			});
+		// Swaps the terrain over to the virtual ground once it's cooked, the variant compiles like any other mode change
+		auto pollVirtualGround = [&]() {
+			if (!virtualGroundCook.IsValid() || !virtualGroundCook.IsDone()) {
+				return;
+			}
+			if (!virtualGroundCook.HasFailed() && virtualGroundCook.Get()) {
+				virtualGround = VirtualTexture::Load(virtualGroundPath);
+			}
+			virtualGroundCook = Task<bool>();
+			if (virtualGround != nullptr) {
+				virtualGround->Bind(materialTerrain, virtualRegionMin, virtualRegionSize);
+				terrainFeatures = useVirtualGround ? VirtualDiffuse : 0;
+				selectLightingMode(lightingFeatures);
+			}
+		};
+		if (benchmark != nullptr) {
+			ThreadPool::Instance().Wait(virtualGroundCook);
+			pollVirtualGround();
+		}
+		StartupReport::BeginStage("First frame");
 
 		// Initialize our timing instance and grab a reference for our use
 		Timing& time = Timing::Instance();
-		time.LastFrame = glfwGetTime();
+		time.SetVSync(VSyncMode::On);
+		time.LastFrame = time.GetTime();
+		// With vsync on, the display's refresh is the deadline the amortized work has to fit around
+		const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+		if (videoMode != nullptr && videoMode->refreshRate > 0) {
+			time.DefaultFramePeriod = 1.0 / videoMode->refreshRate;
+		}
+		// Benchmarks run as fast as they can, with every frame (and simulation step) moving the same amount of time
+		if (benchmark != nullptr) {
+			time.SetVSync(VSyncMode::Off);
+			time.TargetFrameRate = 0.0f;
+			time.FixedDeltaTime = Benchmark::TIME_STEP;
+			time.FixedTimeStep = Benchmark::TIME_STEP;
+			Benchmark::Begin(*benchmark, benchmarkPath, benchmarkFrames);
+		}
+		// Replays run as fast as they can too, each frame's step comes from the recording
+		if (InputRecorder::GetMode() == InputRecorder::Mode::Replaying) {
+			time.SetVSync(VSyncMode::Off);
+			time.TargetFrameRate = 0.0f;
+		}
+		// Where the camera was last frame, for guessing where it's going next
+		glm::vec3 lastCamPos = cameraObject.get<Transform>().GetLocalPosition();
+		// The view we last drew with, so an idle loop can tell when the camera moves on it's own
+		glm::mat4 lastView = cameraObject.get<Camera>().GetView();
 
 		///// Game loop /////
 		while (!glfwWindowShouldClose(window)) {
-			glfwPollEvents();
+			// Sleep while nothing is going on, leaving the last frame on screen. The time spent asleep shouldn't land in
+			// one big step, so the frame after it moves things as if it came right after the last one
+			if (PowerMode::WaitForFrame() != PowerMode::WakeReason::Active) {
+				time.LastFrame = time.GetTime() - time.GetFramePeriod();
+			}
+			// Hold off until the frame is due (if we're capped), so the input we poll next is as fresh as it can be
+			time.WaitForNextFrame();
+			const uint64_t frameStart = CpuProfiler::Now();
+			CpuProfiler::Instance().BeginFrame();
+			// Last frame's scratch is done with, and we start counting this frame's trips to the heap
+			FrameArena::Reset();
+			MemoryTracker::BeginFrame();
+			{
+				PROFILE_SCOPE("PollEvents");
+				// A replay queues up the frame's recorded events here, which Poll applies in place of the real ones
+				InputRecorder::BeginFrame(window);
+				glfwPollEvents();
+				TTK::Input::Poll();
+			}
+			RenderState::ResetStats();
 
 			// Update the timing
-			time.CurrentFrame = glfwGetTime();
-			time.DeltaTime = static_cast<float>(time.CurrentFrame - time.LastFrame);
-
-			time.DeltaTime = time.DeltaTime > 1.0f ? 1.0f : time.DeltaTime;
+			time.BeginFrame();
 
 			// Update our FPS tracker data
 			fpsBuffer[frameIx] = 1.0f / time.DeltaTime;
@@ -782,7 +2427,7 @@ int main() {
 				frameIx = 0;
 
 			// We'll make sure our UI isn't focused before we start handling input for our game
-			if (!ImGui::IsAnyWindowFocused()) {
+			if (!InputRecorder::SampleUi(InputRecorder::UiFlag::Focused, ImGui::IsAnyWindowFocused())) {
 				// We need to poll our key watchers so they can do their logic with the GLFW state
 				// Note that since we want to make sure we don't copy our key handlers, we need a const
 				// reference!
@@ -791,86 +2436,905 @@ int main() {
 				}
 			}
 
-			// Iterate over all the behaviour binding components
-			scene->Registry().view<BehaviourBinding>().each([&](entt::entity entity, BehaviourBinding& binding) {
-				// Iterate over all the behaviour scripts attached to the entity, and update them in sequence (if enabled)
-				for (const auto& behaviour : binding.Behaviours) {
-					if (behaviour->Enabled) {
-						behaviour->Update(entt::handle(scene->Registry(), entity));
+			// Swap in the lighting variant once it's finished compiling
+			pollLightingMode();
+			// And bake the impostors once everything they need has loaded
+			pollImpostors();
+			// And swap in the lightmaps once they've finished baking
+			pollLightmaps();
+			// Scatters generate their instances once their mesh and material are ready, and again if they change
+			scene->Registry().view<ScatterComponent>().each([](ScatterComponent& scatter) {
+				scatter.Update();
+			});
+			// Terrains build their heightmap and grids once they have heights and a material
+			scene->Registry().view<TerrainComponent>().each([](TerrainComponent& terrain) {
+				terrain.Update();
+			});
+
+			// Run any loading work that needs the OpenGL context, then upload any textures that have finished loading
+			ThreadPool::Instance().RunMainThreadJobs(MAIN_THREAD_JOB_BUDGET);
+			UploadContext::Update();
+			TextureLoader::Update();
+			// Moves any scene that's being preloaded along, and cleans up after scenes that were switched away from
+			SceneManager::Update();
+			// The virtual ground swaps in the pages last frame's feedback asked for
+			pollVirtualGround();
+			if (virtualGround != nullptr) {
+				virtualGround->Update();
+			}
+			// Any assets whose files have been edited get loaded again, and shaders that finished rebuilding get swapped in
+			if (assetWatcher != nullptr) {
+				for (const std::string& path : assetWatcher->Poll()) {
+					AssetManager::ReloadFile(path);
+				}
+			}
+			Shader::UpdateReloads();
+			for (auto it = uncheckedShaders.begin(); it != uncheckedShaders.end();) {
+				if (!(*it)->IsReady() && !(*it)->HasFailed()) {
+					++it;
+					continue;
+				}
+				(*it)->ValidateVertexInputs({ &VertexPosNormTexCol::V_DECL }, &InstanceTransform::V_DECL);
+				it = uncheckedShaders.erase(it);
+			}
+			// Then make sure everything still fits in our texture budget
+			TextureResidency::Update();
+
+			{
+				PROFILE_SCOPE("Behaviours");
+				MEMORY_SCOPE(MemoryTag::ECS);
+				BehaviourSystems::Update(*scene, Timing::Instance().DeltaTime);
+				// Iterate over all the behaviour binding components
+				scene->Registry().view<BehaviourBinding>().each([&](entt::entity entity, BehaviourBinding& binding) {
+					// Iterate over all the behaviour scripts attached to the entity, and update them in sequence (if enabled)
+					for (const auto& behaviour : binding.Behaviours) {
+						if (behaviour->Enabled) {
+							behaviour->Update(entt::handle(scene->Registry(), entity));
+						}
+					}
+				});
+			}
+
+			uint32_t fixedSteps = 0;
+			{
+				PROFILE_SCOPE("FixedUpdate");
+				// The simulation runs at a fixed rate no matter how fast we're drawing, so it might take a few steps
+				// to catch up this frame, or none at all
+				fixedSteps = time.AccumulateFixedSteps(time.DeltaTime);
+				for (uint32_t step = 0; step < fixedSteps; step++) {
+					TransformInterpolation::BeginFixedStep(scene->Registry());
+					// Last frame's physics steps land on the first step, so they get interpolated like anything else
+					if (step == 0) {
+						physics->Sync();
 					}
+					BehaviourSystems::FixedUpdate(*scene, time.FixedTimeStep);
+					scene->Registry().view<BehaviourBinding>().each([&](entt::entity entity, BehaviourBinding& binding) {
+						for (const auto& behaviour : binding.Behaviours) {
+							if (behaviour->Enabled) {
+								behaviour->FixedUpdate(entt::handle(scene->Registry(), entity));
+							}
+						}
+					});
 				}
-			});
+				// Then we draw whatever has been moved by the simulation part way between it's last two steps
+				TransformInterpolation::Interpolate(scene->Registry(), time.Alpha, fixedSteps > 0);
+			}
+			// The path only moves the benchmark's camera, so we keep it pointed at what the scenario wants to see
+			if (Benchmark::IsRunning()) {
+				cameraObject.get<Transform>().LookAt(Benchmark::GetScenario()->Target);
+			}
+
+			{
+				PROFILE_SCOPE("LateUpdate");
+				scene->Registry().view<BehaviourBinding>().each([&](entt::entity entity, BehaviourBinding& binding) {
+					for (const auto& behaviour : binding.Behaviours) {
+						if (behaviour->Enabled) {
+							behaviour->LateUpdate(entt::handle(scene->Registry(), entity));
+						}
+					}
+				});
+			}
+
+			GpuProfiler::Instance().BeginFrame();
+			SystemMonitor::SampleGpu();
 
 			// Clear the screen
-			glClearColor(0.08f, 0.17f, 0.31f, 1.0f);
-			glEnable(GL_DEPTH_TEST);
+			const glm::vec4 clearColor(0.08f, 0.17f, 0.31f, 1.0f);
+			glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+			// Clearing depth is masked like any other depth write, and the last pipeline state may have turned it off
+			RenderState::SetDepthMask(true);
 			glClearDepth(1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-			// Update all world matrices for this frame
-			scene->Registry().view<Transform>().each([](entt::entity entity, Transform& t) {
-				t.UpdateWorldMatrix();
-			});
+			// Stream the world in around where the camera was last frame, before anything new needs it's world matrix
+			world->Update(cameraObject.get<Transform>().GetLocalPosition(), time.DeltaTime);
+
+			{
+				PROFILE_SCOPE("UpdateWorldMatrix");
+				// Update all world matrices for this frame
+				Transform::UpdateWorldMatrices(scene->Registry());
+			}
+			// Anything that moved gets it's world bounds (and it's place in the BVH) updated
+			scene->Spatial().Update();
+			// The simulation catches up on this frame's steps on a worker while we draw
+			physics->Step(fixedSteps, time.FixedTimeStep);
+			// Listeners and sources follow their world transforms, so this has to wait for them too
+			sceneAudio->Update(time.DeltaTime);
+			// Emitters follow their world transforms too, their particles are left for the GPU to move
+			if (useParticles) {
+				particleSystem->Update(scene->Registry(), time.DeltaTime);
+			}
 			
-			// Grab out camera info from the camera object
-			Transform& camTransform = cameraObject.get<Transform>();
-			glm::mat4 view = glm::inverse(camTransform.LocalTransform());
-			glm::mat4 projection = cameraObject.get<Camera>().GetProjection();
-			glm::mat4 viewProjection = projection * view;
-						
-			// Sort the renderers by shader and material, we will go for a minimizing context switches approach here,
-			// but you could for instance sort front to back to optimize for fill rate if you have intensive fragment shaders
-			renderGroup.sort<RendererComponent>([](const RendererComponent& l, const RendererComponent& r) {
-				// Sort by render layer first, higher numbers get drawn last
-				if (l.Material->RenderLayer < r.Material->RenderLayer) return true;
-				if (l.Material->RenderLayer > r.Material->RenderLayer) return false;
-
-				// Sort by shader pointer next (so materials using the same shader run sequentially where possible)
-				if (l.Material->Shader < r.Material->Shader) return true;
-				if (l.Material->Shader > r.Material->Shader) return false;
-
-				// Sort by material pointer last (so we can minimize switching between materials)
-				if (l.Material < r.Material) return true;
-				if (l.Material > r.Material) return false;
-				
-				return false;
-			});
+			// The camera follows it's object, and only works out it's matrices and frustum again if it moved
+			Camera& camera = cameraObject.get<Camera>();
+			camera.Update(cameraObject.get<Transform>());
+			const glm::mat4& projection = camera.GetProjection();
+
+			// The frame level uniforms for all our shaders, these go into the snapshot and get uploaded when it's drawn
+			RenderSnapshot& building = snapshots[buildingSnapshot];
+			FrameData& frameData = building.Frame;
+			frameData.View = camera.GetView();
+			frameData.Projection = projection;
+			frameData.ViewProjection = camera.GetViewProjection();
+			frameData.SkyboxMatrix = camera.GetViewProjNoTranslation();
+			frameData.CamPos = camera.GetPosition();
+			building.ViewFrustum = camera.GetFrustum();
+			frameData.Time = static_cast<float>(time.CurrentFrame);
+			// The extra views get built into the same snapshot, culled and sorted along with the main one
+			building.Views.resize(useExtraViews && deferredShader == nullptr ? extraViews.size() : 0);
+			for (size_t ix = 0; ix < building.Views.size(); ix++) {
+				Camera& viewCamera = extraViews[ix].Object.get<Camera>();
+				// Resizing the window gives every camera the window's aspect, these have their own
+				if (viewCamera.GetAspectRatio() != static_cast<float>(EXTRA_VIEW_WIDTH) / static_cast<float>(EXTRA_VIEW_HEIGHT)) {
+					viewCamera.ResizeWindow(EXTRA_VIEW_WIDTH, EXTRA_VIEW_HEIGHT);
+				}
+				viewCamera.Update(extraViews[ix].Object.get<Transform>());
+				SnapshotView& view = building.Views[ix];
+				view.Frame.View = viewCamera.GetView();
+				view.Frame.Projection = viewCamera.GetProjection();
+				view.Frame.ViewProjection = viewCamera.GetViewProjection();
+				view.Frame.SkyboxMatrix = viewCamera.GetViewProjNoTranslation();
+				view.Frame.CamPos = viewCamera.GetPosition();
+				view.Frame.Time = frameData.Time;
+				view.ViewFrustum = viewCamera.GetFrustum();
+			}
 
-			// Start by assuming no shader or material is applied
-			Shader::sptr current = nullptr;
-			ShaderMaterial::sptr currentMat = nullptr;
-
-			// Iterate over the render group components and draw them
-			renderGroup.each( [&](entt::entity e, RendererComponent& renderer, Transform& transform) {
-				// If the shader has changed, set up it's uniforms
-				if (current != renderer.Material->Shader) {
-					current = renderer.Material->Shader;
-					current->Bind();
-					SetupShaderForFrame(current, view, projection);
-				}
-				// If the material has changed, apply it
-				if (currentMat != renderer.Material) {
-					currentMat = renderer.Material;
-					currentMat->Apply();
-				}
-				// Render the mesh
-				RenderVAO(renderer.Material->Shader, renderer.Mesh, viewProjection, transform);
-			});
+			// Levels of detail are picked by how far their simplified surface moves on screen, which depends on the FOV
+			// and how many pixels tall the view is
+			int viewWidth, viewHeight;
+			glfwGetFramebufferSize(window, &viewWidth, &viewHeight);
+			// The scene can be drawn smaller than the screen and stretched up by the post processing, which needs the
+			// HDR target to draw into. The UI always goes on at the full size of the screen
+			const bool isPostProcessed = usePostProcessing && postProcessing->IsReady();
+			int renderWidth = viewWidth, renderHeight = viewHeight;
+			if (isPostProcessed && useDynamicResolution) {
+				dynamicResolution->Update();
+				dynamicResolution->GetRenderSize(viewWidth, viewHeight, renderWidth, renderHeight);
+			} else {
+				dynamicResolution->Reset();
+			}
+			RenderSnapshotSettings snapshotSettings;
+			snapshotSettings.FrustumCulling = useFrustumCulling;
+			snapshotSettings.Lods = useLods;
+			snapshotSettings.Shadows = useShadows && shadowMaps->IsReady();
+			snapshotSettings.LodPixelError = lodPixelError;
+			snapshotSettings.PixelsPerUnit = projection[1][1] * renderHeight * 0.5f;
+			// Hidden renderers get culled against the latest depth pyramid to make it back from the GPU
+			const bool cullOcclusion = useOcclusionCulling && isPostProcessed && depthPyramid->IsReady();
+			if (cullOcclusion) {
+				snapshotSettings.Occlusion = depthPyramid->GetOcclusionMap();
+			} else {
+				depthPyramid->Reset();
+			}
+			snapshotSettings.QueryOcclusion = useOcclusionQueries && occlusionQueries->IsReady();
+			// The culling pass writes it's commands for the multi-draw path, the other path would draw every instance
+			snapshotSettings.GpuCulling = useGpuCulling && useMultiDrawIndirect && instanceCuller->IsReady();
+			snapshotSettings.Records = renderRecords;
+			snapshotSettings.RefreshRecords = renderRecords->IsStale();
+			// The ID pass needs to know which entity is behind each instance
+			snapshotSettings.GatherEntities = useGpuPicking && gpuPicker->IsReady();
+			// If the camera keeps going the way it's going, anything it'll see soon gets it's textures loaded now, so
+			// there's less placeholder on screen when it arrives. We only follow it's movement, not it's turning
+			const glm::vec3 camMotion = glm::vec3(frameData.CamPos) - lastCamPos;
+			lastCamPos = glm::vec3(frameData.CamPos);
+			if (glm::dot(camMotion, camMotion) > 0.0f) {
+				snapshotSettings.PredictView = true;
+				snapshotSettings.PredictedViewProjection = frameData.ViewProjection * glm::translate(glm::mat4(1.0f), -camMotion * LOAD_PREDICTION_FRAMES);
+			}
+
+			// Picking one of the things we can move around selects it, same as cycling to it with the keypad
+			auto selectPicked = [&](entt::entity picked) {
+				for (int ix = 0; ix < static_cast<int>(controllables.size()); ix++) {
+					if (controllables[ix].entity() == picked && ix != selectedVao) {
+						BehaviourBinding::Get<SimpleMoveBehaviour>(controllables[selectedVao])->Enabled = false;
+						selectedVao = ix;
+						BehaviourBinding::Get<SimpleMoveBehaviour>(controllables[selectedVao])->Enabled = true;
+					}
+				}
+			};
+			// Picks made on the GPU come back a frame or so after they were asked for, the entity may be gone by then
+			entt::entity gpuPicked;
+			if (gpuPicker->Poll(gpuPicked)) {
+				const double pickTime = (glfwGetTime() - gpuPickStart) * 1000.0;
+				if (gpuPicked != entt::null && scene->Registry().valid(gpuPicked)) {
+					const GameObjectTag* tag = scene->Registry().try_get<GameObjectTag>(gpuPicked);
+					LOG_INFO("Picked \"{}\" on the GPU in {:.3f}ms ({} instances drawn)", tag != nullptr ? tag->GetName() : "", pickTime, gpuPicker->GetDrawnCount());
+					selectPicked(gpuPicked);
+				} else {
+					LOG_INFO("Picked nothing on the GPU in {:.3f}ms ({} instances drawn)", pickTime, gpuPicker->GetDrawnCount());
+				}
+			}
+
+			// Clicking on something in the scene selects it, as long as the UI doesn't want the mouse
+			if (TTK::Input::GetMousePressed(TTK::MouseButton::Left) && !InputRecorder::SampleUi(InputRecorder::UiFlag::WantsMouse, ImGui::GetIO().WantCaptureMouse)) {
+				PROFILE_SCOPE("Pick");
+				// The cursor comes from TTK rather than the window, so a replayed click picks what the recorded one did
+				const double cursorX = TTK::Input::GetMouseX(), cursorY = TTK::Input::GetMouseY();
+				int windowWidth, windowHeight;
+				glfwGetWindowSize(window, &windowWidth, &windowHeight);
+				if (useGpuPicking && gpuPicker->IsReady()) {
+					// Drawn along with the snapshot below, and picked up by the poll above once it's made it back
+					gpuPicker->Request(windowWidth, windowHeight, cursorX, cursorY);
+					gpuPickStart = glfwGetTime();
+				} else {
+					// Un-project the cursor onto the near and far planes, the ray between them covers everything we can see
+					const glm::vec2 ndc(cursorX / windowWidth * 2.0 - 1.0, 1.0 - cursorY / windowHeight * 2.0);
+					const glm::mat4& toWorld = camera.GetInverseViewProjection();
+					glm::vec4 nearPoint = toWorld * glm::vec4(ndc, -1.0f, 1.0f);
+					glm::vec4 farPoint = toWorld * glm::vec4(ndc, 1.0f, 1.0f);
+					nearPoint /= nearPoint.w;
+					farPoint /= farPoint.w;
+
+					const double pickStart = glfwGetTime();
+					float distance;
+					TriangleHit triangle;
+					const entt::entity picked = scene->Spatial().Raycast(glm::vec3(nearPoint), glm::vec3(farPoint - nearPoint), 1.0f, distance, &triangle);
+					const double pickTime = (glfwGetTime() - pickStart) * 1000.0;
+					if (picked != entt::null) {
+						const GameObjectTag* tag = scene->Registry().try_get<GameObjectTag>(picked);
+						LOG_INFO("Picked \"{}\" (triangle {}) in {:.3f}ms", tag != nullptr ? tag->GetName() : "", triangle.Triangle, pickTime);
+						selectPicked(picked);
+					} else {
+						LOG_INFO("Picked nothing in {:.3f}ms", pickTime);
+					}
+				}
+			}
+
+			// The simulation is done with the scene for this frame, so a worker can sort, cull and gather it into a
+			// snapshot while we draw the one from last frame. Nothing may touch the renderers, transforms or spatial
+			// index until the build is joined below. The build splits itself up across the rest of the workers
+			// Renderers fading over to their impostors take an extra instance each, last frame's impostors cover about
+			// as many as we'll need. The terrains need room for their nodes in every view on top
+			building.Instances = instanceStream->Acquire(static_cast<uint32_t>(snapshotBuilder.GetGroup().size() + impostorCount) +
+				snapshotBuilder.GetTerrainCapacity(static_cast<uint32_t>(building.Views.size() + 1)));
+			Task<void> snapshotBuild = ThreadPool::Instance().Schedule([&snapshotBuilder, &building, snapshotSettings]() {
+				snapshotBuilder.Build(building, snapshotSettings);
+			}, JobThread::Worker, JobPriority::Frame);
+			// Without pipelining (or before there's anything to draw) we wait and draw the snapshot we just built
+			const bool drawLastSnapshot = usePipelinedRendering && hasSnapshot;
+			if (!drawLastSnapshot) {
+				PROFILE_SCOPE("WaitForSnapshot");
+				ThreadPool::Instance().Wait(snapshotBuild);
+			}
+			const RenderSnapshot& drawing = drawLastSnapshot ? snapshots[1 - buildingSnapshot] : building;
+			visibleCount = drawing.VisibleCount;
+			culledCount = drawing.CulledCount;
+			occludedCount = drawing.OccludedCount;
+			pendingCount = drawing.PendingCount;
+			lodCount = drawing.LodCount;
+			transparentCount = drawing.TransparentCount;
+			weightedCount = drawing.WeightedCount;
+			impostorCount = drawing.ImpostorCount;
+			scatterImpostorCount = drawing.ScatterImpostorCount;
+			scatterCount = drawing.ScatterCount;
+			scatterCellCount = drawing.ScatterCellCount;
+			terrainPatchCount = drawing.TerrainPatchCount;
+			gpuCulledCount = drawing.GpuCulledCount;
+
+			{
+				PROFILE_SCOPE("Submit");
+				// Bring the records up to date with the snapshot, before anything draws out of them
+				renderRecords->Apply(drawing.RecordPatch);
+				// Upload the frame level uniforms that the snapshot was built with, so the camera matches what's drawn
+				frameUniforms->GetData() = drawing.Frame;
+				frameUniforms->Update();
+				// The snapshot wrote it's instances straight into the mapped stream
+				RenderStats::CountBufferUpload(static_cast<uint64_t>(drawing.InstanceCount) * sizeof(InstanceTransform));
+				{
+					PROFILE_SCOPE("Shadows");
+					RenderStats::SetLayer(RenderStats::Layer::Shadows);
+					shadowMaps->Render(drawing.Lights, drawing.Shadows, drawing.Frame);
+					shadowStats = shadowMaps->GetStats();
+					RenderStats::SetLayer(RenderStats::Layer::Setup);
+				}
+				if (gpuPicker->IsPending()) {
+					GPU_PROFILE_SCOPE("Pick");
+					gpuPicker->Render(drawing, renderRecords->GetBuffer());
+				}
+				lightCount = static_cast<int>(drawing.Lights.size());
+				culledLightCount = drawing.CulledLightCount;
+				RenderStats::SetCulled(static_cast<uint32_t>(culledCount), static_cast<uint32_t>(occludedCount), static_cast<uint32_t>(culledLightCount));
+				const VertexBuffer::sptr& instanceBuffer = drawing.Instances.Buffer;
+				drawCallCount = static_cast<int>(drawing.Batches.size());
+				instanceCount = drawing.InstanceCount;
+
+				// Start by assuming no shader or material is applied
+				Shader::sptr current = nullptr;
+				ShaderMaterial::sptr currentMat = nullptr;
+
+				// We time each group of render layers as it's own pass on the GPU
+				int currentLayer = 0;
+				bool isPassOpen = false;
+
+				// Once the depth pre-pass has laid down depth, opaque draws only pass where they match it exactly
+				bool isDepthEqual = false;
+				// Sets the material's pipeline state, only issuing what differs from the last draw's
+				auto applyPipeline = [&](const ShaderMaterial::sptr& material) {
+					PipelineState state = material->Pipeline;
+					if (isDepthEqual && state.DepthWrite) {
+						state.DepthFunc = GL_EQUAL;
+						state.DepthWrite = false;
+					}
+					RenderState::ApplyPipeline(state);
+				};
+				// Binds the material's shader and applies the material, skipping whatever is already bound
+				auto applyMaterial = [&](const ShaderMaterial::sptr& material) {
+					// If we've moved to a new render layer, start a new GPU timing zone for it
+					if (!isPassOpen || currentLayer != material->RenderLayer) {
+						if (isPassOpen) {
+							GpuProfiler::Instance().EndZone();
+						}
+						currentLayer = material->RenderLayer;
+						GpuProfiler::Instance().BeginZone("Scene");
+						isPassOpen = true;
+					}
+					// If the shader has changed, bind it (the frame level uniforms come from the shared uniform buffer)
+					if (current != material->Shader) {
+						current = material->Shader;
+						current->Bind();
+					}
+					// If the material has changed, apply it
+					if (currentMat != material) {
+						currentMat = material;
+						currentMat->Apply();
+					}
+					applyPipeline(material);
+				};
+
+				// Anything drawn with the virtual ground writes the pages it wanted into it's feedback, extra views included
+				const bool isVirtualGroundDrawn = virtualGround != nullptr && (terrainFeatures & VirtualDiffuse) != 0;
+				if (isVirtualGroundDrawn) {
+					virtualGround->BeginFrame(renderWidth, renderHeight);
+				}
+
+				// The extra views draw forward into their own targets, out of the same instances as the main view. Each
+				// needs it's own frame uniforms and light clusters, so the main view's go up after them. Deferred frames
+				// skip them, since the lit materials only have their G-buffer variant then
+				int extraViewDrawCount = 0;
+				if (!drawing.Views.empty() && deferredShader == nullptr) {
+					GPU_PROFILE_SCOPE("ExtraViews");
+					RenderStats::SetLayer(RenderStats::Layer::Views);
+					// Every view's draws get recorded across the workers first, only replaying them needs the context
+					const size_t viewCount = std::min(drawing.Views.size(), extraViews.size());
+					while (extraViewCommands.size() < viewCount * 3) {
+						extraViewCommands.push_back(CommandList::Create());
+					}
+					{
+						PROFILE_SCOPE("RecordViews");
+						ThreadPool::Instance().ParallelFor(viewCount * 3, 1, [&](size_t first, size_t last) {
+							for (size_t jx = first; jx < last; jx++) {
+								const SnapshotView& view = drawing.Views[jx / 3];
+								const std::vector<DrawBatch>* lists[3] = { &view.Batches, &view.WeightedBatches, &view.TransparentBatches };
+								extraViewCommands[jx]->Reset();
+								RecordBatches(*extraViewCommands[jx], instanceBuffer, *lists[jx % 3]);
+							}
+						});
+					}
+					for (size_t ix = 0; ix < viewCount; ix++) {
+						const SnapshotView& view = drawing.Views[ix];
+						frameUniforms->GetData() = view.Frame;
+						frameUniforms->Update();
+						clusteredLighting->Update(drawing.Lights, view.Frame, EXTRA_VIEW_WIDTH, EXTRA_VIEW_HEIGHT);
+						extraViews[ix].Target->Begin(EXTRA_VIEW_WIDTH, EXTRA_VIEW_HEIGHT, clearColor);
+						extraViewCommands[ix * 3]->Execute();
+						skyboxPass->Render();
+						if (!view.WeightedBatches.empty()) {
+							weightedBlending->Begin(extraViews[ix].Target->GetDepth(), EXTRA_VIEW_WIDTH, EXTRA_VIEW_HEIGHT);
+							extraViewCommands[ix * 3 + 1]->Execute();
+							weightedBlending->End();
+							weightedBlending->Composite();
+						}
+						extraViewCommands[ix * 3 + 2]->Execute();
+						extraViews[ix].Target->End();
+						extraViews[ix].VisibleCount = view.VisibleCount;
+						extraViewDrawCount += static_cast<int>(view.Batches.size() + view.WeightedBatches.size() + view.TransparentBatches.size());
+					}
+					// The lists bound shaders and applied materials behind our backs, so nothing we tracked is still bound
+					current = nullptr;
+					currentMat = nullptr;
+					frameUniforms->GetData() = drawing.Frame;
+					frameUniforms->Update();
+					RenderStats::SetLayer(RenderStats::Layer::Setup);
+				}
+				{
+					PROFILE_SCOPE("ClusterLights");
+					clusteredLighting->Update(drawing.Lights, drawing.Frame, renderWidth, renderHeight);
+				}
+				// Last frame's occlusion queries are what this frame's conditional draws go on
+				occlusionQueries->BeginFrame();
+
+				if (useMultiDrawIndirect) {
+					// Turn each batch into an indirect command, merging batches that share an arena into one run. Batches
+					// whose materials only differ in values from the material buffer can share a run, since each instance
+					// carries it's own material index
+					indirectCommands.clear();
+					indirectRuns.clear();
+					const bool cullMeshlets = useMeshletCulling && meshletCuller->IsReady();
+					if (cullMeshlets) {
+						meshletCuller->BeginFrame(drawing.ViewFrustum, cullOcclusion ? depthPyramid : nullptr);
+					}
+					const bool cullInstances = instanceCuller->IsReady();
+					bool hasCulledInstances = false;
+					if (cullInstances) {
+						instanceCuller->BeginFrame(drawing.ViewFrustum, cullOcclusion ? depthPyramid : nullptr, snapshotSettings.PixelsPerUnit,
+							useLods ? lodPixelError : 0.0f);
+					}
+					for (const DrawBatch& batch : drawing.Batches) {
+						const MeshArenaSlice& slice = batch.Mesh->GetArenaSlice();
+						LOG_ASSERT(slice.Arena != nullptr, "Multi-draw indirect requires all meshes to be baked into an arena!");
+						const VertexBuffer::sptr& instances = batch.Instances != nullptr ? batch.Instances : instanceBuffer;
+						// Batches culled instance by instance get their own run, since the culling pass writes the commands for them
+						if (cullInstances && batch.GpuCulled) {
+							const int instanceBatch = instanceCuller->Cull(batch.Mesh, batch.CullBounds, batch.DrawRange, instances, batch.BaseInstance, batch.InstanceCount);
+							indirectRuns.push_back({ batch.Material, slice.Arena, instances, 0, 0, -1, batch.Query, instanceBatch });
+							hasCulledInstances = true;
+							continue;
+						}
+						// As do meshes with meshlets
+						if (cullMeshlets && batch.Mesh->GetMeshlets() != nullptr) {
+							const int meshletBatch = meshletCuller->Cull(batch.Mesh, instances, batch.BaseInstance, batch.InstanceCount);
+							indirectRuns.push_back({ batch.Material, slice.Arena, instances, 0, 0, meshletBatch, batch.Query });
+							continue;
+						}
+						// As do the batches drawn conditionally on their occlusion queries, since the condition covers the whole draw
+						if (indirectRuns.empty() ||
+							indirectRuns.back().MeshletBatch != -1 ||
+							indirectRuns.back().InstanceBatch != -1 ||
+							indirectRuns.back().Query != OcclusionQueries::NONE ||
+							batch.Query != OcclusionQueries::NONE ||
+							!indirectRuns.back().Material->CanShareDrawWith(batch.Material) ||
+							indirectRuns.back().Arena != slice.Arena ||
+							indirectRuns.back().Instances != instances)
+						{
+							indirectRuns.push_back({ batch.Material, slice.Arena, instances, static_cast<int>(indirectCommands.size()), 0, -1, batch.Query });
+						} else if (indirectRuns.back().Material != batch.Material) {
+							// Only the run's first material gets applied, the others still need their textures loading
+							batch.Material->UseTextures();
+						}
+						indirectCommands.push_back({ slice.IndexCount, static_cast<GLuint>(batch.InstanceCount), slice.FirstIndex, slice.BaseVertex, static_cast<GLuint>(batch.BaseInstance) });
+						indirectRuns.back().CommandCount++;
+					}
+					indirectBuffer->LoadData(indirectCommands.data(), indirectCommands.size());
+					drawCallCount = static_cast<int>(indirectRuns.size());
+					// The culling has to finish before any of the draws that read it's commands
+					if (cullMeshlets) {
+						meshletCuller->EndFrame();
+					}
+					if (hasCulledInstances) {
+						instanceCuller->EndFrame();
+					}
+				}
+
+				// In deferred mode the lit materials draw with the G-buffer variant, everything else is always forward
+				const bool isDeferredFrame = deferredShader != nullptr;
+				auto isDeferred = [&](const ShaderMaterial::sptr& material) {
+					return isDeferredFrame && (material->Shader == shader || material->Shader == fadeShader || material->Shader == impostorShader ||
+						material->Shader == terrainShader || material->Shader == animatedShader);
+				};
+				// Forward impostors, the meshes fading into them, the terrain and animated props get drawn on their own after
+				// the depth pre-pass, since the quads can't lay down the surface's depth, the pre-pass can't dither, and it
+				// can't move the terrain's or props' vertices. Draws conditional on an occlusion query go late too, or a query
+				// that finishes between the pre-pass and the colour pass could leave depth with nothing shaded on it
+				auto isSkipped = [&](const ShaderMaterial::sptr& material, uint32_t query, bool deferred, bool fading) {
+					const bool isLate = material->Shader == impostorShader || material->Shader == fadeShader ||
+						material->Shader == terrainShader || material->Shader == animatedShader || query != OcclusionQueries::NONE;
+					return isDeferred(material) != deferred || (!deferred && isLate != fading);
+				};
+				// Draws the runs (or batches) whose materials are either all deferred, or all forward. Forward draws pick
+				// between the fading materials and everything else. A depth only draw leaves the shader to the caller
+				auto drawScene = [&](bool deferred, bool depthOnly, bool fading) {
+					if (useMultiDrawIndirect) {
+						// Iterate over the runs and draw them, the base instance of each command selects it's transforms from the instance buffer
+						for (const IndirectRun& run : indirectRuns) {
+							if (isSkipped(run.Material, run.Query, deferred, fading)) {
+								continue;
+							}
+							if (!depthOnly) {
+								applyMaterial(run.Material);
+							} else {
+								applyPipeline(run.Material);
+							}
+							const VertexArrayObject::sptr& vao = run.Arena->GetVao();
+							vao->SetInstanceBuffer(run.Instances, InstanceTransform::V_DECL);
+							const bool isConditional = occlusionQueries->BeginConditional(run.Query);
+							if (run.InstanceBatch != -1) {
+								instanceCuller->Render(run.InstanceBatch, vao);
+							} else if (run.MeshletBatch != -1) {
+								meshletCuller->Render(run.MeshletBatch, vao);
+							} else {
+								vao->RenderIndirect(indirectBuffer, run.FirstCommand, run.CommandCount, indirectCommands.data());
+							}
+							if (isConditional) {
+								occlusionQueries->EndConditional();
+							}
+						}
+					} else {
+						// Iterate over the batches and draw them
+						for (const DrawBatch& batch : drawing.Batches) {
+							if (isSkipped(batch.Material, batch.Query, deferred, fading)) {
+								continue;
+							}
+							if (!depthOnly) {
+								applyMaterial(batch.Material);
+							} else {
+								applyPipeline(batch.Material);
+							}
+							// Render all the instances in the batch
+							const bool isConditional = occlusionQueries->BeginConditional(batch.Query);
+							RenderBatch(instanceBuffer, batch);
+							if (isConditional) {
+								occlusionQueries->EndConditional();
+							}
+						}
+					}
+				};
+
+				// The ambient occlusion is worked out from the depth before anything gets lit, from the G-buffer when
+				// shading deferred, or from a depth pre-pass into the HDR target when shading forward
+				const bool isOccluded = useAmbientOcclusion && ambientOcclusion->IsReady() && (isDeferredFrame || isPostProcessed);
+				auto computeOcclusion = [&](GLuint depth) {
+					GPU_PROFILE_SCOPE("AmbientOcclusion");
+					RenderStats::SetLayer(RenderStats::Layer::Lighting);
+					ambientOcclusion->Compute(depth, renderWidth, renderHeight, drawing.Frame.View, drawing.Frame.Projection);
+					ambientOcclusion->Bind();
+					// The passes read through the low texture units, so the next material needs to bind it's own again
+					current = nullptr;
+					currentMat = nullptr;
+				};
+
+				// With post processing on, everything up to the sky goes into the HDR target instead of the screen
+				if (isPostProcessed) {
+					postProcessing->BeginScene(renderWidth, renderHeight, clearColor);
+				}
+				if (isDeferredFrame) {
+					RenderStats::SetLayer(RenderStats::Layer::Geometry);
+					deferredShading->BeginGeometry(renderWidth, renderHeight);
+					drawScene(true, false, false);
+					deferredShading->EndGeometry();
+					if (isPassOpen) {
+						GpuProfiler::Instance().EndZone();
+						isPassOpen = false;
+					}
+					if (isOccluded) {
+						computeOcclusion(deferredShading->GetDepth());
+					}
+					{
+						GPU_PROFILE_SCOPE("DeferredLighting");
+						RenderStats::SetLayer(RenderStats::Layer::Lighting);
+						deferredShading->Light(deferredShader);
+					}
+					current = deferredShader;
+				}
+				// The opaque forward materials can lay down their depth first, so the colour pass only shades the
+				// front-most surface of each pixel
+				if (useDepthPrepass || (isOccluded && !isDeferredFrame)) {
+					GPU_PROFILE_SCOPE("DepthPrepass");
+					RenderStats::SetLayer(RenderStats::Layer::DepthPrepass);
+					depthPrepassShader->Bind();
+					current = depthPrepassShader;
+					glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+					drawScene(false, true, false);
+					glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+					isDepthEqual = true;
+				}
+				if (isOccluded && !isDeferredFrame) {
+					if (isPassOpen) {
+						GpuProfiler::Instance().EndZone();
+						isPassOpen = false;
+					}
+					computeOcclusion(postProcessing->GetDepth());
+				}
+				// The rest (or everything, when shading forward) gets drawn straight to the screen
+				RenderStats::SetLayer(RenderStats::Layer::Opaque);
+				drawScene(false, false, false);
+				isDepthEqual = false;
+				RenderStats::SetLayer(RenderStats::Layer::Fading);
+				drawScene(false, false, true);
+				// The opaque depth is finished, so the queried renderers' bounds get tested against it for next frame.
+				// They're charged to the opaque layer, since that's what they save
+				if (!drawing.QueryBoxes.empty()) {
+					GPU_PROFILE_SCOPE("OcclusionQueries");
+					RenderStats::SetLayer(RenderStats::Layer::Opaque);
+					occlusionQueries->Render(drawing.QueryBoxes, glm::vec3(drawing.Frame.CamPos));
+					current = nullptr;
+				}
+				// The terrain has been drawn, so the feedback can start it's way back
+				if (isVirtualGroundDrawn) {
+					virtualGround->EndFrame();
+				}
+
+				// Close the last render pass timing zone
+				if (isPassOpen) {
+					GpuProfiler::Instance().EndZone();
+					isPassOpen = false;
+				}
+				// The sky goes last, so it only gets shaded where nothing else was drawn
+				{
+					GPU_PROFILE_SCOPE("Skybox");
+					RenderStats::SetLayer(RenderStats::Layer::Sky);
+					skyboxPass->Render();
+				}
+				// Order independent blended renderers go over the finished opaque scene and the sky in the same runs they
+				// were batched in, then get blended over it all at once. Without post processing the screen's depth gets
+				// copied for them to test against
+				if (!drawing.WeightedBatches.empty()) {
+					GPU_PROFILE_SCOPE("WeightedBlend");
+					RenderStats::SetLayer(RenderStats::Layer::Transparent);
+					weightedBlending->Begin(isPostProcessed ? postProcessing->GetDepth() : 0, renderWidth, renderHeight);
+					for (const DrawBatch& batch : drawing.WeightedBatches) {
+						applyMaterial(batch.Material);
+						RenderBatch(instanceBuffer, batch);
+					}
+					if (isPassOpen) {
+						GpuProfiler::Instance().EndZone();
+						isPassOpen = false;
+					}
+					weightedBlending->End();
+					weightedBlending->Composite();
+					current = nullptr;
+					drawCallCount += static_cast<int>(drawing.WeightedBatches.size()) + 1;
+				}
+				// Blended renderers go over the finished opaque scene and the sky, back to front. They're always drawn
+				// forward, one batch at a time, since merging them into runs would lose their order
+				if (!drawing.TransparentBatches.empty()) {
+					GPU_PROFILE_SCOPE("Transparent");
+					RenderStats::SetLayer(RenderStats::Layer::Transparent);
+					for (const DrawBatch& batch : drawing.TransparentBatches) {
+						applyMaterial(batch.Material);
+						RenderBatch(instanceBuffer, batch);
+					}
+					if (isPassOpen) {
+						GpuProfiler::Instance().EndZone();
+						isPassOpen = false;
+					}
+					drawCallCount += static_cast<int>(drawing.TransparentBatches.size());
+				}
+				// Everything that's lit from the main view has been drawn, so the other views see an open sky again
+				if (isOccluded) {
+					ambientOcclusion->Unbind();
+				}
+				drawCallCount += extraViewDrawCount;
+				// Particles are blended over the finished scene, they're depth tested against it but don't write depth
+				if (useParticles) {
+					GPU_PROFILE_SCOPE("Particles");
+					RenderStats::SetLayer(RenderStats::Layer::Particles);
+					particleSystem->Simulate();
+					particleSystem->Render();
+				}
+				// Building the depth pyramid is counted with the post processing, it works on the finished frame the same way
+				RenderStats::SetLayer(RenderStats::Layer::PostProcess);
+				// The scene's depth is finished now, so next frame can cull against it
+				if (cullOcclusion) {
+					GPU_PROFILE_SCOPE("DepthPyramid");
+					depthPyramid->Build(postProcessing->GetDepth(), postProcessing->GetWidth(), postProcessing->GetHeight(), drawing.Frame.ViewProjection);
+				}
+				if (isPostProcessed) {
+					GPU_PROFILE_SCOPE("PostProcess");
+					postProcessing->EndScene();
+				}
+				RenderStats::SetLayer(RenderStats::Layer::Setup);
+
+				// The snapshot's instances can be overwritten once the GPU is done with these draws
+				instanceStream->Release(drawing.Instances);
+			}
 
 			// Draw our ImGui content
-			RenderImGui();
+			{
+				PROFILE_SCOPE("RenderImGui");
+				GPU_PROFILE_SCOPE("ImGui");
+				if (isUiDrawn) {
+					RenderImGui();
+				}
+			}
+			// Grab the finished frame if anything wants it, the benchmark's reference frames are numbered by their sample
+			if (benchmarkCaptureInterval > 0 && Benchmark::GetFrameIndex() >= 0 && Benchmark::GetFrameIndex() % benchmarkCaptureInterval == 0) {
+				frameCapture->RequestScreenshot(benchmarkPath + "_frame" + std::to_string(Benchmark::GetFrameIndex()) + ".png");
+			}
+			frameCapture->Capture(viewWidth, viewHeight);
+			// ImGui changes the GL state without going through our state tracker
+			RenderState::Invalidate();
+
+			GpuProfiler::Instance().EndFrame();
+			GlDebugOutput::EndFrame();
+
+			// Join up with the snapshot build before anything else can change the scene
+			{
+				PROFILE_SCOPE("WaitForSnapshot");
+				ThreadPool::Instance().Wait(snapshotBuild);
+			}
+			// The builder can't ask the driver how the shaders it skipped are coming along, so we do it for them
+			for (const ShaderMaterial::sptr& pending : building.PendingMaterials) {
+				pending->Prepare();
+			}
+			// Anything about to come into view gets it's textures loaded, just as if it had been drawn
+			for (const ShaderMaterial::sptr& upcoming : building.UpcomingMaterials) {
+				upcoming->UseTextures();
+			}
+			// Now that nothing is reading the scene, the light edits from the UI can go in
+			if (isLightEdited && lightObject.entity() != entt::null && lightObject.has<Light>()) {
+				lightObject.get<Light>() = lightEdit;
+				lightObject.get<Transform>().SetLocalPosition(lightEditPos);
+			}
+			isLightEdited = false;
+			for (; lampsToScatter > 0; lampsToScatter--) {
+				GameObject lamp = scene->CreateEntity("Lamp");
+				lamp.get<Transform>().SetLocalPosition(glm::linearRand(glm::vec3(-10.0f, -10.0f, 0.25f), glm::vec3(10.0f, 10.0f, 1.5f)));
+				Light& light = lamp.emplace<Light>();
+				light.Color = glm::linearRand(glm::vec3(0.2f), glm::vec3(1.0f));
+				light.AttenuationLinear = 0.7f;
+				light.AttenuationQuadratic = 1.8f;
+			}
+			hasSnapshot = true;
+			buildingSnapshot = 1 - buildingSnapshot;
 
 			scene->Poll();
-			glfwSwapBuffers(window);
+			// Whatever is left of the frame goes to the work that can wait, now that nothing is reading the scene
+			FrameScheduler::Run();
+			const uint64_t cpuEnd = CpuProfiler::Now();
+			{
+				PROFILE_SCOPE("SwapBuffers");
+				glfwSwapBuffers(window);
+			}
+			RenderStats::EndFrame();
+			// Anything released this frame gets deleted once the GPU is a couple of frames past it
+			GpuDeletionQueue::EndFrame();
+			if (Benchmark::IsRunning()) {
+				Benchmark::FrameSample sample;
+				sample.FrameMs = (CpuProfiler::Now() - frameStart) / 1000000.0f;
+				sample.CpuMs = (cpuEnd - frameStart) / 1000000.0f;
+				for (const GpuProfiler::Zone& zone : GpuProfiler::Instance().GetResults()) {
+					if (zone.Depth == 0) {
+						sample.GpuMs = zone.GetMilliseconds();
+					} else if (zone.Depth == 1) {
+						sample.GpuZones.emplace_back(zone.Name, zone.GetMilliseconds());
+					}
+				}
+				// Only the main thread's stages, the workers' zones are counted within whichever stage waited on them
+				const CpuProfiler& profiler = CpuProfiler::Instance();
+				for (const CpuProfiler::ZoneStats& zone : profiler.GetZones()) {
+					if (zone.Depth == 1 && zone.Path.compare(0, 6, "Frame/") == 0) {
+						sample.CpuZones.emplace_back(zone.Name, zone.Inclusive[profiler.GetHistoryIndex()]);
+					}
+				}
+				sample.DrawCalls = static_cast<uint32_t>(drawCallCount);
+				sample.Instances = static_cast<uint32_t>(instanceCount);
+				sample.Render = RenderStats::GetLastFrame();
+				for (uint8_t tagIx = 0; tagIx < static_cast<uint8_t>(MemoryTag::Count); tagIx++) {
+					sample.HeapBytes += MemoryTracker::GetStats(static_cast<MemoryTag>(tagIx)).Current;
+				}
+				sample.HeapAllocations = MemoryTracker::GetLastFrameAllocations();
+				sample.ProcessBytes = static_cast<int64_t>(System::GetMemoryUsageBytes());
+				Benchmark::RecordFrame(sample);
+				if (Benchmark::IsFinished()) {
+					isBenchmarkWritten = Benchmark::Finish();
+					glfwSetWindowShouldClose(window, true);
+				}
+			}
+			if (StartupReport::IsRecording()) {
+				StartupReport::Finish(startupReportPath);
+			}
+			InputRecorder::EndFrame();
+			if (InputRecorder::IsFinished()) {
+				LOG_INFO("Finished replaying {} frames", InputRecorder::GetFrameCount());
+				glfwSetWindowShouldClose(window, true);
+			}
+			// Anything still moving, loading or baking keeps us awake, input is picked up by PowerMode itself
+			{
+				const glm::mat4& view = cameraObject.get<Camera>().GetView();
+				const IoScheduler::Stats ioStats = IoScheduler::GetStats();
+				const SceneManager::LoadState loadState = SceneManager::GetLoadState();
+				const bool isActive =
+					Benchmark::IsRunning() || InputRecorder::GetMode() == InputRecorder::Mode::Replaying ||
+					view != lastView ||
+					scene->Spatial().GetMovedCount() > 0 ||
+					(physics != nullptr && physics->GetActiveCount() > 0) ||
+					(useParticles && particleSystem->GetStats().Emitters > 0) ||
+					VertexAnimationTexture::GetLiveCount() > 0 ||
+					(lightmapper != nullptr && lightmapper->IsBaking()) ||
+					(world != nullptr && world->GetPendingCount() > 0) ||
+					(loadState == SceneManager::LoadState::Reading || loadState == SceneManager::LoadState::LoadingAssets) ||
+					TextureLoader::GetPendingCount() > 0 || UploadContext::GetPendingCount() > 0 ||
+					ioStats.Queued[0] + ioStats.Queued[1] + ioStats.Queued[2] > 0 ||
+					FrameScheduler::GetStats().Tasks > 0 ||
+					!uncheckedShaders.empty() || !hasBakedImpostors;
+				lastView = view;
+				PowerMode::EndFrame(isActive);
+			}
 			time.LastFrame = time.CurrentFrame;
+			CpuProfiler::Instance().EndFrame();
+			TraceRecorder::Instance().EndFrame();
+			RemoteProfiler::EndFrame();
+			FleetTelemetry::EndFrame(static_cast<float>(CpuProfiler::Now() - frameStart) / 1000000.0f);
 		}
 
+		// The physics world refers to the scene and may still be stepping, so it goes first
+		physics = nullptr;
+		// Sources hold onto event instances, which have to be released before the engine goes
+		sceneAudio = nullptr;
+		audio->Shutdown();
+		audio = nullptr;
+		// Any scenes still loading or being torn down in the background refer to GPU resources
+		SceneManager::Shutdown();
 		// Nullify scene so that we can release references
 		Application::Instance().ActiveScene = nullptr;
+		treeImpostor = nullptr;
+		MeshArena::ReleaseAll();
+		VertexLayout::ReleaseAll();
+		MeshUploadStream::ReleaseAll();
+		MaterialBuffer::ReleaseAll();
+		Sampler::ReleaseAll();
+		PanoramaConverter::ReleaseAll();
+		PathAsset::ReleaseAll();
+		meshletCuller = nullptr;
+		instanceCuller = nullptr;
+		renderRecords = nullptr;
+		depthPyramid = nullptr;
+		ambientOcclusion = nullptr;
+		occlusionQueries = nullptr;
+		// Anything still being captured gets written out before the workers go away
+		frameCapture = nullptr;
+		lightmapper = nullptr;
+		virtualGround = nullptr;
+		clusteredLighting = nullptr;
+		shadowMaps = nullptr;
+		gpuPicker = nullptr;
+		deferredShading = nullptr;
+		weightedBlending = nullptr;
+		skyboxPass = nullptr;
+		particleSystem = nullptr;
+		postProcessing = nullptr;
+		IoScheduler::Shutdown();
+		ThreadPool::Instance().Shutdown();
+		UploadContext::Shutdown();
+		FleetTelemetry::Stop();
+		RemoteProfiler::Stop();
+		SystemMonitor::UnregisterThread();
+		SystemMonitor::Stop();
+		TextureLoader::Shutdown();
+		InputRecorder::Finish();
+		TTK::Input::Uninitialize();
+		assetWatcher = nullptr;
+		uiCache = nullptr;
 		ShutdownImGui();
 	}	
+	// Everything that was holding on to GPU resources has gone by now, the context is still around to delete them with
+	GpuDeletionQueue::Flush();
+
+	int result = 0;
+	if (benchmark != nullptr && !isBenchmarkWritten) {
+		LOG_ERROR("The benchmark didn't finish");
+		result = 3;
+	} else if (Benchmark::GetRegressionCount() > 0) {
+		LOG_ERROR("The benchmark regressed in {} metrics", Benchmark::GetRegressionCount());
+		result = 4;
+	}
+	if (hasMemoryBudgets && MemoryTracker::GetBudgetBreaches() > 0) {
+		LOG_ERROR("Memory went over budget {} times", MemoryTracker::GetBudgetBreaches());
+		MemoryTracker::DumpSites();
+		result = 2;
+	}
 
 	// Clean up the toolkit logger so we don't leak memory
 	Logger::Uninitialize();
-	return 0;
+	return result;
 }
\ No newline at end of file